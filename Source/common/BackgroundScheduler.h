@@ -0,0 +1,116 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_BACKGROUNDSCHEDULER_H
+#define SANTA_COMMON_BACKGROUNDSCHEDULER_H
+
+#include <dispatch/dispatch.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace santa {
+
+// Runs deferrable background work, such as telemetry export and database
+// maintenance, only when doing so is cheap for the machine. While the
+// machine is on battery, under thermal pressure or in low power mode, jobs
+// are held until conditions improve. Each job has a deadline after which it
+// runs regardless, so no work is deferred forever.
+class BackgroundScheduler {
+ public:
+  struct Conditions {
+    bool on_battery = false;
+    bool thermal_pressure = false;
+    bool low_power_mode = false;
+
+    bool ShouldDefer() const {
+      return on_battery || thermal_pressure || low_power_mode;
+    }
+  };
+
+  using ConditionsFunction = std::function<Conditions()>;
+
+  // Counts are since the last reset. `pending` is whether the job is
+  // currently waiting to run.
+  struct JobStats {
+    uint64_t submitted = 0;
+    // Submissions that had to wait, not counting those coalesced
+    uint64_t deferred = 0;
+    // Submissions folded into a run of the same job that was already waiting
+    uint64_t coalesced = 0;
+    // Waiting runs started because their deadline passed
+    uint64_t forced = 0;
+    bool pending = false;
+  };
+
+  // How often conditions are re-checked while jobs are waiting
+  static constexpr uint64_t kDefaultRecheckIntervalNanos = 60 * NSEC_PER_SEC;
+
+  // Uses the current power and thermal state, and re-checks it as soon as
+  // the system reports a change.
+  static BackgroundScheduler& Shared();
+
+  static Conditions CurrentConditions();
+
+  explicit BackgroundScheduler(
+      ConditionsFunction conditions,
+      uint64_t recheck_interval_nanos = kDefaultRecheckIntervalNanos);
+
+  // Jobs still waiting are dropped
+  ~BackgroundScheduler();
+
+  BackgroundScheduler(BackgroundScheduler&& other) = delete;
+  BackgroundScheduler& operator=(BackgroundScheduler&& rhs) = delete;
+  BackgroundScheduler(const BackgroundScheduler& other) = delete;
+  BackgroundScheduler& operator=(const BackgroundScheduler& other) = delete;
+
+  // Run `job` on `queue` now if conditions allow, otherwise once they do or
+  // `max_delay_nanos` has passed. Submitting a job under a name that is
+  // already waiting replaces the waiting block but keeps the earlier
+  // deadline, so repeated timer fires coalesce into one run.
+  void Submit(std::string name, uint64_t max_delay_nanos,
+              dispatch_queue_t queue, void (^job)(void));
+
+  // Check conditions now rather than at the next recheck
+  void Reevaluate();
+
+  absl::flat_hash_map<std::string, JobStats> GetStats(bool reset);
+
+ private:
+  struct PendingJob {
+    uint64_t deadline;
+    dispatch_queue_t queue;
+    void (^job)(void);
+  };
+
+  // All of the following must be called on q_
+  void EvaluateSerialized();
+  void RunSerialized(const std::string& name, bool forced);
+  void ArmTimerSerialized();
+
+  ConditionsFunction conditions_;
+  const uint64_t recheck_interval_nanos_;
+  dispatch_queue_t q_;
+  dispatch_source_t timer_;
+  absl::flat_hash_map<std::string, PendingJob> pending_;
+  absl::flat_hash_map<std::string, JobStats> stats_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_BACKGROUNDSCHEDULER_H
@@ -0,0 +1,185 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/BackgroundScheduler.h"
+
+#import <Foundation/Foundation.h>
+#include <time.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Source/common/PowerMonitor.h"
+
+namespace santa {
+
+BackgroundScheduler& BackgroundScheduler::Shared() {
+  static BackgroundScheduler* shared = [] {
+    BackgroundScheduler* scheduler =
+        new BackgroundScheduler(&BackgroundScheduler::CurrentConditions);
+
+    // Power source changes aren't posted here and are picked up by the
+    // periodic recheck instead
+    for (NSNotificationName name in @[
+           NSProcessInfoThermalStateDidChangeNotification,
+           NSProcessInfoPowerStateDidChangeNotification
+         ]) {
+      [[NSNotificationCenter defaultCenter] addObserverForName:name
+                                                        object:nil
+                                                         queue:nil
+                                                    usingBlock:^(NSNotification*) {
+                                                      scheduler->Reevaluate();
+                                                    }];
+    }
+    return scheduler;
+  }();
+  return *shared;
+}
+
+BackgroundScheduler::Conditions BackgroundScheduler::CurrentConditions() {
+  NSProcessInfo* processInfo = [NSProcessInfo processInfo];
+  return Conditions{
+      .on_battery = PowerMonitor::IsOnBatteryPower(),
+      .thermal_pressure = processInfo.thermalState >= NSProcessInfoThermalStateSerious,
+      .low_power_mode = processInfo.isLowPowerModeEnabled,
+  };
+}
+
+BackgroundScheduler::BackgroundScheduler(ConditionsFunction conditions,
+                                         uint64_t recheck_interval_nanos)
+    : conditions_(std::move(conditions)),
+      recheck_interval_nanos_(recheck_interval_nanos),
+      q_(dispatch_queue_create(
+          "com.northpolesec.santa.background_scheduler",
+          dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0))) {
+  timer_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q_);
+  dispatch_source_set_event_handler(timer_, ^{
+    EvaluateSerialized();
+  });
+  dispatch_source_set_timer(timer_, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+  dispatch_resume(timer_);
+}
+
+BackgroundScheduler::~BackgroundScheduler() {
+  dispatch_source_cancel(timer_);
+  // Wait for any evaluation already running to finish
+  dispatch_sync(q_, ^{
+                });
+}
+
+void BackgroundScheduler::Submit(std::string name, uint64_t max_delay_nanos,
+                                 dispatch_queue_t queue, void (^job)(void)) {
+  __block std::string block_name = std::move(name);
+  dispatch_async(q_, ^{
+    JobStats& stats = stats_[block_name];
+    stats.submitted++;
+
+    auto it = pending_.find(block_name);
+    if (it != pending_.end()) {
+      it->second.queue = queue;
+      it->second.job = job;
+      stats.coalesced++;
+    } else {
+      pending_.emplace(block_name,
+                       PendingJob{
+                           .deadline = clock_gettime_nsec_np(CLOCK_MONOTONIC) + max_delay_nanos,
+                           .queue = queue,
+                           .job = job,
+                       });
+      stats.pending = true;
+      if (conditions_().ShouldDefer()) {
+        stats.deferred++;
+      }
+    }
+
+    EvaluateSerialized();
+  });
+}
+
+void BackgroundScheduler::Reevaluate() {
+  dispatch_async(q_, ^{
+    EvaluateSerialized();
+  });
+}
+
+void BackgroundScheduler::EvaluateSerialized() {
+  if (pending_.empty()) {
+    return;
+  }
+
+  bool defer = conditions_().ShouldDefer();
+  uint64_t now = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+
+  std::vector<std::pair<std::string, bool>> runnable;
+  for (const auto& [name, pending] : pending_) {
+    if (!defer || pending.deadline <= now) {
+      runnable.emplace_back(name, defer);
+    }
+  }
+  for (const auto& [name, forced] : runnable) {
+    RunSerialized(name, forced);
+  }
+
+  ArmTimerSerialized();
+}
+
+void BackgroundScheduler::RunSerialized(const std::string& name, bool forced) {
+  auto node = pending_.extract(name);
+  if (node.empty()) {
+    return;
+  }
+
+  JobStats& stats = stats_[name];
+  stats.pending = false;
+  if (forced) {
+    stats.forced++;
+  }
+  dispatch_async(node.mapped().queue, node.mapped().job);
+}
+
+void BackgroundScheduler::ArmTimerSerialized() {
+  if (pending_.empty()) {
+    dispatch_source_set_timer(timer_, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+    return;
+  }
+
+  uint64_t now = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  uint64_t next = now + recheck_interval_nanos_;
+  for (const auto& [name, pending] : pending_) {
+    next = std::min(next, pending.deadline);
+  }
+
+  // Allow some leeway so the wakeup can be coalesced with others
+  uint64_t delay = next > now ? next - now : 0;
+  dispatch_source_set_timer(timer_, dispatch_time(DISPATCH_TIME_NOW, delay),
+                            DISPATCH_TIME_FOREVER, delay / 10);
+}
+
+absl::flat_hash_map<std::string, BackgroundScheduler::JobStats> BackgroundScheduler::GetStats(
+    bool reset) {
+  __block absl::flat_hash_map<std::string, JobStats> stats;
+  dispatch_sync(q_, ^{
+    stats = stats_;
+    if (reset) {
+      for (auto& [name, job_stats] : stats_) {
+        job_stats = JobStats{.pending = job_stats.pending};
+      }
+    }
+  });
+  return stats;
+}
+
+}  // namespace santa
@@ -0,0 +1,98 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/BackgroundScheduler.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <memory>
+
+using santa::BackgroundScheduler;
+
+@interface BackgroundSchedulerTest : XCTestCase
+@end
+
+@implementation BackgroundSchedulerTest
+
+- (void)testRunsImmediatelyOnACPower {
+  BackgroundScheduler sut([] { return BackgroundScheduler::Conditions{}; });
+  dispatch_queue_t q = dispatch_queue_create("test", DISPATCH_QUEUE_SERIAL);
+
+  XCTestExpectation* ran = [self expectationWithDescription:@"Job ran"];
+  sut.Submit("job", 60 * NSEC_PER_SEC, q, ^{
+    [ran fulfill];
+  });
+  [self waitForExpectations:@[ ran ] timeout:5];
+
+  auto stats = sut.GetStats(false);
+  XCTAssertEqual(stats["job"].submitted, 1);
+  XCTAssertEqual(stats["job"].deferred, 0);
+  XCTAssertFalse(stats["job"].pending);
+}
+
+- (void)testDefersAndCoalescesUntilConditionsImprove {
+  auto on_battery = std::make_shared<std::atomic<bool>>(true);
+  BackgroundScheduler sut([on_battery] {
+    return BackgroundScheduler::Conditions{.on_battery = on_battery->load()};
+  });
+  dispatch_queue_t q = dispatch_queue_create("test", DISPATCH_QUEUE_SERIAL);
+
+  __block std::atomic<int> firstRuns{0};
+  __block std::atomic<int> secondRuns{0};
+  sut.Submit("job", 60 * NSEC_PER_SEC, q, ^{
+    firstRuns++;
+  });
+  sut.Submit("job", 60 * NSEC_PER_SEC, q, ^{
+    secondRuns++;
+  });
+
+  auto stats = sut.GetStats(false);
+  XCTAssertEqual(stats["job"].submitted, 2);
+  XCTAssertEqual(stats["job"].deferred, 1);
+  XCTAssertEqual(stats["job"].coalesced, 1);
+  XCTAssertTrue(stats["job"].pending);
+
+  on_battery->store(false);
+  sut.Reevaluate();
+  sut.GetStats(false);
+  dispatch_sync(q, ^{
+                });
+
+  // Only the most recently submitted block runs
+  XCTAssertEqual(firstRuns.load(), 0);
+  XCTAssertEqual(secondRuns.load(), 1);
+  XCTAssertFalse(sut.GetStats(false)["job"].pending);
+}
+
+- (void)testDeadlineForcesRun {
+  BackgroundScheduler sut(
+      [] { return BackgroundScheduler::Conditions{.thermal_pressure = true}; });
+  dispatch_queue_t q = dispatch_queue_create("test", DISPATCH_QUEUE_SERIAL);
+
+  XCTestExpectation* ran = [self expectationWithDescription:@"Job ran"];
+  sut.Submit("job", 50 * NSEC_PER_MSEC, q, ^{
+    [ran fulfill];
+  });
+  [self waitForExpectations:@[ ran ] timeout:5];
+
+  auto stats = sut.GetStats(true);
+  XCTAssertEqual(stats["job"].deferred, 1);
+  XCTAssertEqual(stats["job"].forced, 1);
+  XCTAssertEqual(sut.GetStats(false)["job"].forced, 0);
+}
+
+@end
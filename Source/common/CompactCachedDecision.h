@@ -0,0 +1,151 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_COMPACTCACHEDDECISION_H
+#define SANTA_COMMON_COMPACTCACHEDDECISION_H
+
+#import <Foundation/Foundation.h>
+#include <dispatch/dispatch.h>
+#include <sys/types.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#import "Source/common/SNTCachedDecision.h"
+#import "Source/common/SNTCommonEnums.h"
+#include "Source/common/PathInternPool.h"
+#include "Source/common/SantaVnode.h"
+
+namespace santa {
+
+// A string that may be nil. Equal strings share storage in a process wide
+// pool.
+class CompactString {
+ public:
+  CompactString() = default;
+  explicit CompactString(NSString* str);
+
+  NSString* ToNSString() const;
+  bool IsNil() const { return is_nil_; }
+
+ private:
+  InternedPath str_;
+  bool is_nil_ = true;
+};
+
+// A string that is usually the lowercase hex encoding of N bytes, such as a
+// SHA-256 or CDHash. Those are stored as raw bytes. Anything else falls back
+// to a CompactString so that conversions always round trip.
+template <size_t N>
+class CompactHexString {
+ public:
+  CompactHexString() = default;
+  explicit CompactHexString(NSString* str);
+
+  NSString* ToNSString() const;
+  bool IsNil() const { return !is_hex_ && fallback_.IsNil(); }
+
+ private:
+  std::array<uint8_t, N> bytes_{};
+  bool is_hex_ = false;
+  CompactString fallback_;
+};
+
+// Immutable, compact form of an SNTCachedDecision for long lived caches.
+//
+// Digests are stored as fixed width binary, identifiers are interned and
+// certificate chains are shared between decisions with the same chain.
+// Entitlement dictionaries are retained as is since they are already shared
+// with the code signing info they came from. SNTCachedDecision views are
+// only created when something needs the ObjC form.
+class CompactCachedDecision {
+ public:
+  // Returns nullptr if `cd` is nil
+  static std::shared_ptr<const CompactCachedDecision> FromDecision(SNTCachedDecision* cd);
+
+  // Creates a new SNTCachedDecision with the same contents. Changes to the
+  // returned object are not reflected here.
+  SNTCachedDecision* ToDecision() const;
+
+  // Returns a copy with the SHA-256 computed in the background filled in and
+  // the pending hash cleared
+  std::shared_ptr<const CompactCachedDecision> WithResolvedSHA256() const;
+
+  // Returns YES if any identifier of the decision is in `identifiers`
+  BOOL MayMatchIdentifiers(NSSet<NSString*>* identifiers) const;
+
+  SantaVnode vnode() const { return vnode_; }
+  SNTEventState decision() const { return decision_; }
+  bool cacheable_for_euid() const { return cacheable_for_euid_; }
+  uid_t cache_euid() const { return cache_euid_; }
+  bool hold_and_ask() const { return hold_and_ask_; }
+  NSString* SHA256() const;
+  NSString* CertSHA256() const { return cert_sha256_.ToNSString(); }
+
+  // The decision whose SHA-256 is still being computed, if any
+  SNTCachedDecision* pending_sha256_source() const { return pending_sha256_source_; }
+
+ private:
+  CompactCachedDecision() = default;
+
+  SantaVnode vnode_;
+  SNTEventState decision_;
+  SNTClientMode decision_client_mode_;
+  SNTSigningStatus signing_status_;
+  uint32_t codesigning_flags_;
+  uid_t cache_euid_;
+  int64_t rule_id_;
+  CFAbsoluteTime secure_signing_time_;
+  CFAbsoluteTime signing_time_;
+
+  CompactHexString<32> sha256_;
+  CompactHexString<32> cert_sha256_;
+  CompactHexString<20> cdhash_;
+  CompactString cert_common_name_;
+  CompactString team_id_;
+  CompactString signing_id_;
+  CompactString raw_signing_id_;
+  CompactString decision_extra_;
+  CompactString quarantine_url_;
+  CompactString custom_msg_;
+  CompactString custom_url_;
+
+  NSArray<MOLCertificate*>* cert_chain_;
+  NSDictionary* entitlements_;
+  NSDictionary* raw_entitlements_;
+  NSNumber* touch_id_cooldown_minutes_;
+  // Holds the original decision while its SHA-256 is computed in the
+  // background so the digest can be picked up once it is known.
+  SNTCachedDecision* pending_sha256_source_;
+
+  bool has_secure_signing_time_ : 1;
+  bool has_signing_time_ : 1;
+  bool entitlements_filtered_ : 1;
+  bool platform_binary_ : 1;
+  bool silent_block_ : 1;
+  bool seatbelt_required_ : 1;
+  bool static_rule_ : 1;
+  bool cacheable_ : 1;
+  bool hold_and_ask_ : 1;
+  bool silent_touch_id_ : 1;
+  bool cacheable_for_euid_ : 1;
+  bool audit_return_ : 1;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_COMPACTCACHEDDECISION_H
@@ -0,0 +1,269 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/CompactCachedDecision.h"
+
+#include <string>
+#include <string_view>
+
+#import "Source/common/MOLCertificate.h"
+#include "Source/common/String.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+namespace {
+
+// Identifiers are kept in their own pool so that they don't show up in the
+// path pool's telemetry stats
+PathInternPool& IdentifierPool() {
+  static PathInternPool* pool = new PathInternPool();
+  return *pool;
+}
+
+// Most binaries on a host are signed by a small number of distinct chains,
+// so decisions share one array per chain instead of holding their own copy
+// of every certificate. The pool stops growing once full.
+class CertChainPool {
+ public:
+  static constexpr size_t kMaxChains = 4096;
+
+  static CertChainPool& Shared() {
+    static CertChainPool* pool = new CertChainPool();
+    return *pool;
+  }
+
+  NSArray<MOLCertificate*>* Intern(NSArray<MOLCertificate*>* chain) {
+    if (chain.count == 0) {
+      return chain;
+    }
+
+    std::string key;
+    for (MOLCertificate* cert in chain) {
+      key.append(NSStringToUTF8StringView(cert.SHA256));
+    }
+
+    absl::MutexLock lock(&mtx_);
+    auto it = chains_.find(key);
+    if (it != chains_.end()) {
+      return it->second;
+    }
+    if (chains_.size() < kMaxChains) {
+      chains_.emplace(std::move(key), chain);
+    }
+    return chain;
+  }
+
+ private:
+  absl::Mutex mtx_;
+  absl::flat_hash_map<std::string, NSArray<MOLCertificate*>*> chains_ ABSL_GUARDED_BY(mtx_);
+};
+
+int HexValue(unichar c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+}  // namespace
+
+CompactString::CompactString(NSString* str) {
+  if (str) {
+    str_ = IdentifierPool().Intern(NSStringToUTF8StringView(str));
+    is_nil_ = false;
+  }
+}
+
+NSString* CompactString::ToNSString() const {
+  if (is_nil_) {
+    return nil;
+  }
+  std::string_view view = str_.View();
+  return [[NSString alloc] initWithBytes:view.data()
+                                  length:view.length()
+                                encoding:NSUTF8StringEncoding];
+}
+
+template <size_t N>
+CompactHexString<N>::CompactHexString(NSString* str) {
+  if (str.length == N * 2) {
+    is_hex_ = true;
+    for (size_t i = 0; i < N && is_hex_; i++) {
+      int hi = HexValue([str characterAtIndex:2 * i]);
+      int lo = HexValue([str characterAtIndex:2 * i + 1]);
+      if (hi < 0 || lo < 0) {
+        is_hex_ = false;
+      } else {
+        bytes_[i] = (uint8_t)((hi << 4) | lo);
+      }
+    }
+  }
+
+  if (!is_hex_) {
+    fallback_ = CompactString(str);
+  }
+}
+
+template <size_t N>
+NSString* CompactHexString<N>::ToNSString() const {
+  if (!is_hex_) {
+    return fallback_.ToNSString();
+  }
+  return @(BufToHexString(bytes_.data(), bytes_.size()).c_str());
+}
+
+template class CompactHexString<20>;
+template class CompactHexString<32>;
+
+std::shared_ptr<const CompactCachedDecision> CompactCachedDecision::FromDecision(
+    SNTCachedDecision* cd) {
+  if (!cd) {
+    return nullptr;
+  }
+
+  // The constructor is private, so make_shared can't be used
+  std::shared_ptr<CompactCachedDecision> c(new CompactCachedDecision());
+  c->vnode_ = cd.vnodeId;
+  c->decision_ = cd.decision;
+  c->decision_client_mode_ = cd.decisionClientMode;
+  c->signing_status_ = cd.signingStatus;
+  c->codesigning_flags_ = cd.codesigningFlags;
+  c->cache_euid_ = cd.cacheEUID;
+  c->rule_id_ = cd.ruleId;
+  c->has_secure_signing_time_ = (cd.secureSigningTime != nil);
+  c->secure_signing_time_ = cd.secureSigningTime.timeIntervalSinceReferenceDate;
+  c->has_signing_time_ = (cd.signingTime != nil);
+  c->signing_time_ = cd.signingTime.timeIntervalSinceReferenceDate;
+
+  // Check for a pending hash before reading the digest. If the hash finishes
+  // in between, the source still has it.
+  if (cd.pendingSHA256) {
+    c->pending_sha256_source_ = cd;
+  }
+  c->sha256_ = CompactHexString<32>(cd.sha256);
+  c->cert_sha256_ = CompactHexString<32>(cd.certSHA256);
+  c->cdhash_ = CompactHexString<20>(cd.cdhash);
+  c->cert_common_name_ = CompactString(cd.certCommonName);
+  c->team_id_ = CompactString(cd.teamID);
+  c->signing_id_ = CompactString(cd.signingID);
+  c->raw_signing_id_ = CompactString(cd.rawSigningID);
+  c->decision_extra_ = CompactString(cd.decisionExtra);
+  c->quarantine_url_ = CompactString(cd.quarantineURL);
+  c->custom_msg_ = CompactString(cd.customMsg);
+  c->custom_url_ = CompactString(cd.customURL);
+
+  c->cert_chain_ = CertChainPool::Shared().Intern(cd.certChain);
+  c->entitlements_ = cd.entitlements;
+  c->raw_entitlements_ = cd.rawEntitlements;
+  c->touch_id_cooldown_minutes_ = cd.touchIDCooldownMinutes;
+
+  c->entitlements_filtered_ = cd.entitlementsFiltered;
+  c->platform_binary_ = cd.platformBinary;
+  c->silent_block_ = cd.silentBlock;
+  c->seatbelt_required_ = cd.seatbeltRequired;
+  c->static_rule_ = cd.staticRule;
+  c->cacheable_ = cd.cacheable;
+  c->hold_and_ask_ = cd.holdAndAsk;
+  c->silent_touch_id_ = cd.silentTouchID;
+  c->cacheable_for_euid_ = cd.cacheableForEUID;
+  c->audit_return_ = cd.auditReturn;
+
+  return c;
+}
+
+SNTCachedDecision* CompactCachedDecision::ToDecision() const {
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] initWithVnode:vnode_];
+  cd.decision = decision_;
+  cd.decisionClientMode = decision_client_mode_;
+  cd.signingStatus = signing_status_;
+  cd.codesigningFlags = codesigning_flags_;
+  cd.cacheEUID = cache_euid_;
+  cd.ruleId = rule_id_;
+  if (has_secure_signing_time_) {
+    cd.secureSigningTime = [NSDate dateWithTimeIntervalSinceReferenceDate:secure_signing_time_];
+  }
+  if (has_signing_time_) {
+    cd.signingTime = [NSDate dateWithTimeIntervalSinceReferenceDate:signing_time_];
+  }
+
+  cd.sha256 = SHA256();
+  cd.certSHA256 = cert_sha256_.ToNSString();
+  cd.cdhash = cdhash_.ToNSString();
+  cd.certCommonName = cert_common_name_.ToNSString();
+  cd.teamID = team_id_.ToNSString();
+  cd.signingID = signing_id_.ToNSString();
+  cd.rawSigningID = raw_signing_id_.ToNSString();
+  cd.decisionExtra = decision_extra_.ToNSString();
+  cd.quarantineURL = quarantine_url_.ToNSString();
+  cd.customMsg = custom_msg_.ToNSString();
+  cd.customURL = custom_url_.ToNSString();
+
+  cd.certChain = cert_chain_;
+  cd.entitlements = entitlements_;
+  cd.rawEntitlements = raw_entitlements_;
+  cd.touchIDCooldownMinutes = touch_id_cooldown_minutes_;
+  cd.pendingSHA256 = pending_sha256_source_.pendingSHA256;
+
+  cd.entitlementsFiltered = entitlements_filtered_;
+  cd.platformBinary = platform_binary_;
+  cd.silentBlock = silent_block_;
+  cd.seatbeltRequired = seatbelt_required_;
+  cd.staticRule = static_rule_;
+  cd.cacheable = cacheable_;
+  cd.holdAndAsk = hold_and_ask_;
+  cd.silentTouchID = silent_touch_id_;
+  cd.cacheableForEUID = cacheable_for_euid_;
+  cd.auditReturn = audit_return_;
+
+  return cd;
+}
+
+std::shared_ptr<const CompactCachedDecision> CompactCachedDecision::WithResolvedSHA256() const {
+  std::shared_ptr<CompactCachedDecision> c(new CompactCachedDecision(*this));
+  if (pending_sha256_source_) {
+    c->sha256_ = CompactHexString<32>(pending_sha256_source_.sha256);
+    c->pending_sha256_source_ = nil;
+  }
+  return c;
+}
+
+NSString* CompactCachedDecision::SHA256() const {
+  if (sha256_.IsNil() && pending_sha256_source_) {
+    return pending_sha256_source_.sha256;
+  }
+  return sha256_.ToNSString();
+}
+
+BOOL CompactCachedDecision::MayMatchIdentifiers(NSSet<NSString*>* identifiers) const {
+  for (NSString* identifier :
+       {SHA256(), cdhash_.ToNSString(), signing_id_.ToNSString(), team_id_.ToNSString(),
+        cert_sha256_.ToNSString()}) {
+    if (identifier && [identifiers containsObject:identifier]) {
+      return YES;
+    }
+  }
+
+  for (MOLCertificate* cert in cert_chain_) {
+    if (cert.SHA256 && [identifiers containsObject:cert.SHA256]) {
+      return YES;
+    }
+  }
+
+  return NO;
+}
+
+}  // namespace santa
@@ -0,0 +1,152 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/CompactCachedDecision.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+
+#import "Source/common/SNTCachedDecision.h"
+#include "Source/common/TestUtils.h"
+
+using santa::CompactCachedDecision;
+
+static NSString* const kSHA256 =
+    @"a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90";
+static NSString* const kCDHash = @"0123456789abcdef0123456789abcdef01234567";
+
+@interface CompactCachedDecisionTest : XCTestCase
+@end
+
+@implementation CompactCachedDecisionTest
+
+- (void)testRoundTrip {
+  struct stat sb = MakeStat();
+  es_file_t file = MakeESFile("foo", sb);
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] initWithEndpointSecurityFile:&file];
+  cd.decision = SNTEventStateAllowSigningID;
+  cd.decisionClientMode = SNTClientModeLockdown;
+  cd.decisionExtra = @"extra";
+  cd.sha256 = kSHA256;
+  cd.certSHA256 = kSHA256;
+  cd.cdhash = kCDHash;
+  cd.certCommonName = @"Developer ID Application: Foo";
+  cd.teamID = @"EQHXZ8M8AV";
+  cd.signingID = @"EQHXZ8M8AV:com.example.foo";
+  cd.entitlements = @{@"com.apple.security.app-sandbox" : @YES};
+  cd.platformBinary = YES;
+  cd.codesigningFlags = 0x2000;
+  cd.signingStatus = SNTSigningStatusProduction;
+  cd.signingTime = [NSDate dateWithTimeIntervalSinceReferenceDate:12345.5];
+  cd.customMsg = @"msg";
+  cd.ruleId = 42;
+  cd.cacheable = YES;
+  cd.touchIDCooldownMinutes = @(5);
+  cd.cacheableForEUID = YES;
+  cd.cacheEUID = 501;
+
+  std::shared_ptr<const CompactCachedDecision> compact = CompactCachedDecision::FromDecision(cd);
+  SNTCachedDecision* got = compact->ToDecision();
+
+  XCTAssertNotEqual(got, cd);
+  XCTAssertEqual(got.vnodeId.fileid, cd.vnodeId.fileid);
+  XCTAssertEqual(got.vnodeId.fsid, cd.vnodeId.fsid);
+  XCTAssertEqual(got.decision, cd.decision);
+  XCTAssertEqual(got.decisionClientMode, cd.decisionClientMode);
+  XCTAssertEqualObjects(got.decisionExtra, cd.decisionExtra);
+  XCTAssertEqualObjects(got.sha256, kSHA256);
+  XCTAssertEqualObjects(got.certSHA256, kSHA256);
+  XCTAssertEqualObjects(got.cdhash, kCDHash);
+  XCTAssertEqualObjects(got.certCommonName, cd.certCommonName);
+  XCTAssertEqualObjects(got.teamID, cd.teamID);
+  XCTAssertEqualObjects(got.signingID, cd.signingID);
+  XCTAssertEqualObjects(got.entitlements, cd.entitlements);
+  XCTAssertEqual(got.platformBinary, YES);
+  XCTAssertEqual(got.codesigningFlags, cd.codesigningFlags);
+  XCTAssertEqual(got.signingStatus, cd.signingStatus);
+  XCTAssertEqualObjects(got.signingTime, cd.signingTime);
+  XCTAssertEqualObjects(got.customMsg, cd.customMsg);
+  XCTAssertEqual(got.ruleId, 42);
+  XCTAssertEqual(got.cacheable, YES);
+  XCTAssertEqualObjects(got.touchIDCooldownMinutes, @(5));
+  XCTAssertEqual(got.cacheableForEUID, YES);
+  XCTAssertEqual(got.cacheEUID, 501);
+
+  // Unset fields stay nil
+  XCTAssertNil(got.rawSigningID);
+  XCTAssertNil(got.secureSigningTime);
+  XCTAssertNil(got.quarantineURL);
+  XCTAssertNil(got.customURL);
+  XCTAssertNil(got.certChain);
+  XCTAssertNil(got.pendingSHA256);
+
+  XCTAssertEqual(compact->vnode().fileid, cd.vnodeId.fileid);
+  XCTAssertEqual(compact->decision(), cd.decision);
+  XCTAssertEqualObjects(compact->SHA256(), kSHA256);
+}
+
+- (void)testNonHexDigestsRoundTrip {
+  // Values that aren't lowercase hex of the expected width are kept verbatim
+  for (NSString* value in @[ @"abc123", kSHA256.uppercaseString, @"", @"zz" ]) {
+    SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+    cd.sha256 = value;
+    cd.cdhash = value;
+
+    SNTCachedDecision* got = CompactCachedDecision::FromDecision(cd)->ToDecision();
+    XCTAssertEqualObjects(got.sha256, value);
+    XCTAssertEqualObjects(got.cdhash, value);
+  }
+
+  XCTAssertTrue(CompactCachedDecision::FromDecision(nil) == nullptr);
+}
+
+- (void)testMayMatchIdentifiers {
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.sha256 = kSHA256;
+  cd.cdhash = kCDHash;
+  cd.teamID = @"EQHXZ8M8AV";
+
+  std::shared_ptr<const CompactCachedDecision> compact = CompactCachedDecision::FromDecision(cd);
+  XCTAssertFalse(compact->MayMatchIdentifiers([NSSet set]));
+  XCTAssertFalse(compact->MayMatchIdentifiers([NSSet setWithObject:@"ABCDEF"]));
+  XCTAssertTrue(compact->MayMatchIdentifiers([NSSet setWithObject:kSHA256]));
+  XCTAssertTrue(compact->MayMatchIdentifiers([NSSet setWithObject:kCDHash]));
+  XCTAssertTrue(compact->MayMatchIdentifiers([NSSet setWithObject:@"EQHXZ8M8AV"]));
+}
+
+- (void)testPendingSHA256 {
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.pendingSHA256 = dispatch_group_create();
+
+  std::shared_ptr<const CompactCachedDecision> compact = CompactCachedDecision::FromDecision(cd);
+  XCTAssertEqual(compact->pending_sha256_source(), cd);
+  XCTAssertNotNil(compact->ToDecision().pendingSHA256);
+  XCTAssertNil(compact->SHA256());
+
+  // The digest is visible as soon as the source has it
+  cd.sha256 = kSHA256;
+  cd.pendingSHA256 = nil;
+  XCTAssertEqualObjects(compact->SHA256(), kSHA256);
+  XCTAssertNil(compact->ToDecision().pendingSHA256);
+
+  std::shared_ptr<const CompactCachedDecision> resolved = compact->WithResolvedSHA256();
+  XCTAssertNil(resolved->pending_sha256_source());
+  XCTAssertEqualObjects(resolved->SHA256(), kSHA256);
+  XCTAssertEqualObjects(resolved->ToDecision().sha256, kSHA256);
+}
+
+@end
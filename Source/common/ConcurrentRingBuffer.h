@@ -0,0 +1,226 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_CONCURRENTRINGBUFFER_H
+#define SANTA_COMMON_CONCURRENTRINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace santa {
+
+namespace ringbuffer_internal {
+
+// Keep producer and consumer positions on separate cache lines
+inline constexpr size_t kCacheLineSize = 128;
+
+inline size_t RoundUpToPowerOfTwo(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+}  // namespace ringbuffer_internal
+
+// Bounded lock-free single-producer single-consumer ring.
+//
+// Storage is allocated once at construction with a power of two number of
+// slots. When the ring is full, TryPush drops the new value and counts it
+// rather than blocking the producer or overwriting values the consumer hasn't
+// seen yet.
+template <typename T>
+class SPSCRingBuffer {
+ public:
+  explicit SPSCRingBuffer(size_t capacity)
+      : mask_(ringbuffer_internal::RoundUpToPowerOfTwo(capacity) - 1),
+        slots_(std::make_unique<std::optional<T>[]>(mask_ + 1)) {
+    if (capacity == 0) {
+      std::abort();
+    }
+  }
+
+  SPSCRingBuffer(SPSCRingBuffer&& other) = delete;
+  SPSCRingBuffer& operator=(SPSCRingBuffer&& rhs) = delete;
+  SPSCRingBuffer(const SPSCRingBuffer& other) = delete;
+  SPSCRingBuffer& operator=(const SPSCRingBuffer& other) = delete;
+
+  inline size_t Capacity() const { return mask_ + 1; }
+
+  // Must only be called from the producer thread. Returns false if the ring
+  // was full and the value was dropped.
+  bool TryPush(T value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+
+    slots_[tail & mask_].emplace(std::move(value));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Must only be called from the consumer thread
+  std::optional<T> TryPop() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return std::nullopt;
+      }
+    }
+
+    std::optional<T>& slot = slots_[head & mask_];
+    std::optional<T> value = std::move(slot);
+    slot.reset();
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+  // Safe to call from any thread, but only a snapshot
+  bool Empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  // Number of values dropped because the ring was full
+  uint64_t Dropped(bool reset) {
+    return reset ? dropped_.exchange(0, std::memory_order_relaxed)
+                 : dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  const size_t mask_;
+  std::unique_ptr<std::optional<T>[]> slots_;
+  std::atomic<uint64_t> dropped_{0};
+
+  // Consumer side
+  alignas(ringbuffer_internal::kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0;
+
+  // Producer side
+  alignas(ringbuffer_internal::kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0;
+};
+
+// Bounded lock-free multi-producer single-consumer ring.
+//
+// Each slot carries a sequence number that tells producers when it is free
+// and the consumer when it holds a value, so producers only contend on the
+// CAS that claims a position. Like SPSCRingBuffer, values pushed while the
+// ring is full are dropped and counted.
+template <typename T>
+class MPSCRingBuffer {
+ public:
+  explicit MPSCRingBuffer(size_t capacity)
+      : mask_(ringbuffer_internal::RoundUpToPowerOfTwo(capacity) - 1),
+        slots_(std::make_unique<Slot[]>(mask_ + 1)) {
+    if (capacity == 0) {
+      std::abort();
+    }
+    for (size_t i = 0; i <= mask_; i++) {
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPSCRingBuffer(MPSCRingBuffer&& other) = delete;
+  MPSCRingBuffer& operator=(MPSCRingBuffer&& rhs) = delete;
+  MPSCRingBuffer(const MPSCRingBuffer& other) = delete;
+  MPSCRingBuffer& operator=(const MPSCRingBuffer& other) = delete;
+
+  inline size_t Capacity() const { return mask_ + 1; }
+
+  // Safe to call from any thread. Returns false if the ring was full and the
+  // value was dropped.
+  bool TryPush(T value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      size_t seq = slot.seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value.emplace(std::move(value));
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // The slot still holds a value from the previous lap
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Must only be called by one thread at a time
+  std::optional<T> TryPop() {
+    Slot& slot = slots_[head_ & mask_];
+    if (slot.seq.load(std::memory_order_acquire) != head_ + 1) {
+      return std::nullopt;
+    }
+
+    std::optional<T> value = std::move(slot.value);
+    slot.value.reset();
+    slot.seq.store(head_ + mask_ + 1, std::memory_order_release);
+    head_++;
+    return value;
+  }
+
+  // Pops every value currently available, passing each to `f` in push order.
+  // Returns the number of values popped.
+  template <typename F>
+  size_t Drain(F&& f) {
+    size_t count = 0;
+    while (std::optional<T> value = TryPop()) {
+      f(std::move(*value));
+      count++;
+    }
+    return count;
+  }
+
+  // Number of values dropped because the ring was full
+  uint64_t Dropped(bool reset) {
+    return reset ? dropped_.exchange(0, std::memory_order_relaxed)
+                 : dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    std::optional<T> value;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> dropped_{0};
+
+  alignas(ringbuffer_internal::kCacheLineSize) std::atomic<size_t> tail_{0};
+  alignas(ringbuffer_internal::kCacheLineSize) size_t head_ = 0;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_CONCURRENTRINGBUFFER_H
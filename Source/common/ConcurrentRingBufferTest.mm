@@ -0,0 +1,274 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ConcurrentRingBuffer.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using santa::MPSCRingBuffer;
+using santa::SPSCRingBuffer;
+
+@interface ConcurrentRingBufferTest : XCTestCase
+@end
+
+@implementation ConcurrentRingBufferTest
+
+- (void)testSPSCBasic {
+  SPSCRingBuffer<int> sut(3);
+  XCTAssertEqual(sut.Capacity(), 4);
+  XCTAssertTrue(sut.Empty());
+  XCTAssertFalse(sut.TryPop().has_value());
+
+  for (int i = 0; i < 4; i++) {
+    XCTAssertTrue(sut.TryPush(i));
+  }
+
+  // Values pushed while full are dropped, earlier values are kept
+  XCTAssertFalse(sut.TryPush(4));
+  XCTAssertEqual(sut.Dropped(false), 1);
+
+  for (int i = 0; i < 4; i++) {
+    XCTAssertEqual(sut.TryPop().value_or(-1), i);
+  }
+  XCTAssertTrue(sut.Empty());
+
+  // Positions wrap around the storage
+  XCTAssertTrue(sut.TryPush(5));
+  XCTAssertEqual(sut.TryPop().value_or(-1), 5);
+
+  XCTAssertEqual(sut.Dropped(true), 1);
+  XCTAssertEqual(sut.Dropped(false), 0);
+}
+
+- (void)testSPSCConcurrent {
+  auto sut = std::make_shared<SPSCRingBuffer<uint64_t>>(64);
+  const uint64_t count = 100000;
+
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    for (uint64_t i = 1; i <= count; i++) {
+      while (!sut->TryPush(i)) {
+      }
+    }
+  });
+
+  // Every value arrives once, in order
+  uint64_t expected = 1;
+  while (expected <= count) {
+    if (std::optional<uint64_t> value = sut->TryPop()) {
+      XCTAssertEqual(*value, expected);
+      expected++;
+    }
+  }
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+  XCTAssertTrue(sut->Empty());
+}
+
+- (void)testMPSCBasic {
+  MPSCRingBuffer<int> sut(2);
+  XCTAssertEqual(sut.Capacity(), 2);
+  XCTAssertFalse(sut.TryPop().has_value());
+
+  XCTAssertTrue(sut.TryPush(1));
+  XCTAssertTrue(sut.TryPush(2));
+  XCTAssertFalse(sut.TryPush(3));
+  XCTAssertEqual(sut.Dropped(false), 1);
+
+  XCTAssertEqual(sut.TryPop().value_or(-1), 1);
+  XCTAssertTrue(sut.TryPush(4));
+
+  std::vector<int> drained;
+  XCTAssertEqual(sut.Drain([&](int&& v) { drained.push_back(v); }), 2);
+  XCTAssertEqual(drained, (std::vector<int>{2, 4}));
+  XCTAssertEqual(sut.Drain([](int&&) {}), 0);
+}
+
+- (void)testMPSCHoldsObjects {
+  MPSCRingBuffer<NSString*> sut(4);
+  @autoreleasepool {
+    XCTAssertTrue(sut.TryPush([NSString stringWithFormat:@"pid: %d", getpid()]));
+  }
+  XCTAssertEqualObjects(sut.TryPop().value_or(nil),
+                        ([NSString stringWithFormat:@"pid: %d", getpid()]));
+}
+
+- (void)testMPSCConcurrentProducers {
+  auto sut = std::make_shared<MPSCRingBuffer<uint64_t>>(128);
+  const int producers = 8;
+  const uint64_t perProducer = 10000;
+
+  // Consume concurrently with the producers. Every value is either popped or
+  // counted as dropped, and each producer's values stay in order.
+  std::atomic<bool> done{false};
+  std::vector<uint64_t> lastSeen(producers, 0);
+  uint64_t popped = 0;
+  uint64_t outOfOrder = 0;
+  std::atomic<bool>* donePtr = &done;
+  std::vector<uint64_t>* lastSeenPtr = &lastSeen;
+  uint64_t* poppedPtr = &popped;
+  uint64_t* outOfOrderPtr = &outOfOrder;
+
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    auto consume = [&](uint64_t&& v) {
+      uint64_t producer = v / perProducer;
+      uint64_t seq = v % perProducer + 1;
+      if (seq <= (*lastSeenPtr)[producer]) (*outOfOrderPtr)++;
+      (*lastSeenPtr)[producer] = seq;
+      (*poppedPtr)++;
+    };
+    while (!donePtr->load()) {
+      sut->Drain(consume);
+    }
+    sut->Drain(consume);
+  });
+
+  dispatch_apply(producers, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t p) {
+    for (uint64_t i = 0; i < perProducer; i++) {
+      sut->TryPush(p * perProducer + i);
+    }
+  });
+  done.store(true);
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+  XCTAssertEqual(outOfOrder, 0);
+  XCTAssertEqual(popped + sut->Dropped(false), producers * perProducer);
+}
+
+@end
+
+@implementation ConcurrentRingBufferTest
+
+- (void)testSPSCBasic {
+  SPSCRingBuffer<int> sut(3);
+  XCTAssertEqual(sut.Capacity(), 4);
+  XCTAssertTrue(sut.Empty());
+  XCTAssertFalse(sut.TryPop().has_value());
+
+  for (int i = 0; i < 4; i++) {
+    XCTAssertTrue(sut.TryPush(i));
+  }
+
+  // Values pushed while full are dropped, earlier values are kept
+  XCTAssertFalse(sut.TryPush(4));
+  XCTAssertEqual(sut.Dropped(false), 1);
+
+  for (int i = 0; i < 4; i++) {
+    XCTAssertEqual(sut.TryPop().value_or(-1), i);
+  }
+  XCTAssertTrue(sut.Empty());
+
+  // Positions wrap around the storage
+  XCTAssertTrue(sut.TryPush(5));
+  XCTAssertEqual(sut.TryPop().value_or(-1), 5);
+
+  XCTAssertEqual(sut.Dropped(true), 1);
+  XCTAssertEqual(sut.Dropped(false), 0);
+}
+
+- (void)testSPSCConcurrent {
+  auto sut = std::make_shared<SPSCRingBuffer<uint64_t>>(64);
+  const uint64_t count = 100000;
+
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    for (uint64_t i = 1; i <= count; i++) {
+      while (!sut->TryPush(i)) {
+      }
+    }
+  });
+
+  // Every value arrives once, in order
+  uint64_t expected = 1;
+  while (expected <= count) {
+    if (std::optional<uint64_t> value = sut->TryPop()) {
+      XCTAssertEqual(*value, expected);
+      expected++;
+    }
+  }
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+  XCTAssertTrue(sut->Empty());
+}
+
+- (void)testMPSCBasic {
+  MPSCRingBuffer<int> sut(2);
+  XCTAssertEqual(sut.Capacity(), 2);
+  XCTAssertFalse(sut.TryPop().has_value());
+
+  XCTAssertTrue(sut.TryPush(1));
+  XCTAssertTrue(sut.TryPush(2));
+  XCTAssertFalse(sut.TryPush(3));
+  XCTAssertEqual(sut.Dropped(false), 1);
+
+  XCTAssertEqual(sut.TryPop().value_or(-1), 1);
+  XCTAssertTrue(sut.TryPush(4));
+
+  std::vector<int> drained;
+  XCTAssertEqual(sut.Drain([&](int&& v) { drained.push_back(v); }), 2);
+  XCTAssertEqual(drained, (std::vector<int>{2, 4}));
+  XCTAssertEqual(sut.Drain([](int&&) {}), 0);
+}
+
+- (void)testMPSCHoldsObjects {
+  MPSCRingBuffer<NSString*> sut(4);
+  @autoreleasepool {
+    XCTAssertTrue(sut.TryPush([NSString stringWithFormat:@"pid: %d", getpid()]));
+  }
+  XCTAssertEqualObjects(sut.TryPop().value_or(nil),
+                        ([NSString stringWithFormat:@"pid: %d", getpid()]));
+}
+
+- (void)testMPSCConcurrentProducers {
+  auto sut = std::make_shared<MPSCRingBuffer<uint64_t>>(128);
+  const int producers = 8;
+  const uint64_t perProducer = 10000;
+
+  // Consume concurrently with the producers. Every value is either popped or
+  // counted as dropped, and each producer's values stay in order.
+  __block std::atomic<bool> done{false};
+  __block std::vector<uint64_t> lastSeen(producers, 0);
+  __block uint64_t popped = 0;
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    auto consume = [&](uint64_t&& v) {
+      uint64_t producer = v / perProducer;
+      uint64_t seq = v % perProducer + 1;
+      XCTAssertGreaterThan(seq, lastSeen[producer]);
+      lastSeen[producer] = seq;
+      popped++;
+    };
+    while (!done.load()) {
+      sut->Drain(consume);
+    }
+    sut->Drain(consume);
+  });
+
+  dispatch_apply(producers, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t p) {
+    for (uint64_t i = 0; i < perProducer; i++) {
+      sut->TryPush(p * perProducer + i);
+    }
+  });
+  done.store(true);
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+  XCTAssertEqual(popped + sut->Dropped(false), producers * perProducer);
+}
+
+@end
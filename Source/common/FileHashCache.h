@@ -0,0 +1,80 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_FILEHASHCACHE_H
+#define SANTA_COMMON_FILEHASHCACHE_H
+
+#import <Foundation/Foundation.h>
+#include <sys/stat.h>
+
+#include <memory>
+
+#include "Source/common/SantaCache.h"
+#include "Source/common/SantaVnode.h"
+
+namespace santa {
+
+// Process wide cache of file digests so that unchanged files aren't re-read
+// and re-hashed every time a hash is needed.
+//
+// Entries are keyed by vnode and only returned while the file's size, mtime
+// and ctime still match those recorded when the digests were stored, so a
+// modified file is never served a stale digest even if an invalidation is
+// missed.
+class FileHashCache {
+ public:
+  static FileHashCache& Shared();
+
+  explicit FileHashCache(uint64_t max_size);
+
+  FileHashCache(FileHashCache&& other) = delete;
+  FileHashCache& operator=(FileHashCache&& rhs) = delete;
+  FileHashCache(const FileHashCache& other) = delete;
+  FileHashCache& operator=(const FileHashCache& other) = delete;
+
+  // Fills in the requested digests and returns true only if every non-NULL
+  // digest was found for the file described by `sb`.
+  bool Lookup(const struct stat& sb, NSString** sha1, NSString** sha256);
+
+  // Store digests for the file described by `sb`. Digests already stored for
+  // the same version of the file are kept when a nil digest is given.
+  void Store(const struct stat& sb, NSString* sha1, NSString* sha256);
+
+  void Invalidate(const SantaVnode& vnode);
+  void Clear();
+  uint64_t Count() const;
+
+  // Returns true if both stats describe the same version of the same file
+  static bool IsSameVersion(const struct stat& lhs, const struct stat& rhs);
+
+ private:
+  struct Entry {
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+    NSString* sha1;
+    NSString* sha256;
+
+    bool Matches(const struct stat& sb) const;
+    bool operator==(const Entry& rhs) const;
+    bool operator!=(const Entry& rhs) const { return !(*this == rhs); }
+  };
+
+  std::unique_ptr<SantaCache<SantaVnode, Entry>> cache_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_FILEHASHCACHE_H
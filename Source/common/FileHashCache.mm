@@ -0,0 +1,98 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/FileHashCache.h"
+
+namespace santa {
+
+namespace {
+
+// Enough for every binary in a handful of large app bundles and toolchains
+constexpr uint64_t kMaxHashCacheEntries = 8192;
+
+bool TimespecEqual(const struct timespec& lhs, const struct timespec& rhs) {
+  return lhs.tv_sec == rhs.tv_sec && lhs.tv_nsec == rhs.tv_nsec;
+}
+
+}  // namespace
+
+bool FileHashCache::Entry::Matches(const struct stat& sb) const {
+  return size == sb.st_size && TimespecEqual(mtime, sb.st_mtimespec) &&
+         TimespecEqual(ctime, sb.st_ctimespec);
+}
+
+bool FileHashCache::Entry::operator==(const Entry& rhs) const {
+  return size == rhs.size && TimespecEqual(mtime, rhs.mtime) && TimespecEqual(ctime, rhs.ctime) &&
+         sha1 == rhs.sha1 && sha256 == rhs.sha256;
+}
+
+bool FileHashCache::IsSameVersion(const struct stat& lhs, const struct stat& rhs) {
+  return lhs.st_dev == rhs.st_dev && lhs.st_ino == rhs.st_ino && lhs.st_size == rhs.st_size &&
+         TimespecEqual(lhs.st_mtimespec, rhs.st_mtimespec) &&
+         TimespecEqual(lhs.st_ctimespec, rhs.st_ctimespec);
+}
+
+FileHashCache& FileHashCache::Shared() {
+  static FileHashCache* shared = new FileHashCache(kMaxHashCacheEntries);
+  return *shared;
+}
+
+FileHashCache::FileHashCache(uint64_t max_size)
+    : cache_(std::make_unique<SantaCache<SantaVnode, Entry>>(max_size, 5,
+                                                             SantaCacheEvictionPolicy::kClock)) {}
+
+bool FileHashCache::Lookup(const struct stat& sb, NSString** sha1, NSString** sha256) {
+  Entry entry = cache_->get(SantaVnode::VnodeForFile(sb));
+  if (!entry.Matches(sb) || (sha1 && !entry.sha1) || (sha256 && !entry.sha256)) {
+    return false;
+  }
+
+  if (sha1) *sha1 = entry.sha1;
+  if (sha256) *sha256 = entry.sha256;
+  return true;
+}
+
+void FileHashCache::Store(const struct stat& sb, NSString* sha1, NSString* sha256) {
+  if (!sha1 && !sha256) return;
+
+  SantaVnode vnode = SantaVnode::VnodeForFile(sb);
+  Entry entry = cache_->get(vnode);
+  if (entry.Matches(sb)) {
+    if (!sha1) sha1 = entry.sha1;
+    if (!sha256) sha256 = entry.sha256;
+  }
+
+  cache_->set(vnode, Entry{
+                         .size = sb.st_size,
+                         .mtime = sb.st_mtimespec,
+                         .ctime = sb.st_ctimespec,
+                         .sha1 = sha1,
+                         .sha256 = sha256,
+                     });
+}
+
+void FileHashCache::Invalidate(const SantaVnode& vnode) {
+  cache_->remove(vnode);
+}
+
+void FileHashCache::Clear() {
+  cache_->clear();
+}
+
+uint64_t FileHashCache::Count() const {
+  return cache_->count();
+}
+
+}  // namespace santa
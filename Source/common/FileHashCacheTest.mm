@@ -0,0 +1,118 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/FileHashCache.h"
+
+#import <XCTest/XCTest.h>
+
+using santa::FileHashCache;
+
+static struct stat MakeStat(ino_t ino, off_t size, time_t mtime) {
+  struct stat sb = {};
+  sb.st_dev = 1;
+  sb.st_ino = ino;
+  sb.st_size = size;
+  sb.st_mtimespec = {.tv_sec = mtime, .tv_nsec = 500};
+  sb.st_ctimespec = {.tv_sec = mtime, .tv_nsec = 600};
+  return sb;
+}
+
+@interface FileHashCacheTest : XCTestCase
+@end
+
+@implementation FileHashCacheTest
+
+- (void)testLookupRequiresMatchingStat {
+  FileHashCache sut(16);
+  struct stat sb = MakeStat(100, 1024, 1000);
+  sut.Store(sb, @"sha1", @"sha256");
+
+  NSString* sha1;
+  NSString* sha256;
+  XCTAssertTrue(sut.Lookup(sb, &sha1, &sha256));
+  XCTAssertEqualObjects(sha1, @"sha1");
+  XCTAssertEqualObjects(sha256, @"sha256");
+
+  // Any change to the size or times is a different version of the file
+  struct stat modified = sb;
+  modified.st_size++;
+  XCTAssertFalse(sut.Lookup(modified, NULL, &sha256));
+
+  modified = sb;
+  modified.st_mtimespec.tv_nsec++;
+  XCTAssertFalse(sut.Lookup(modified, NULL, &sha256));
+
+  modified = sb;
+  modified.st_ctimespec.tv_sec++;
+  XCTAssertFalse(sut.Lookup(modified, NULL, &sha256));
+
+  XCTAssertFalse(sut.Lookup(MakeStat(101, 1024, 1000), NULL, &sha256));
+}
+
+- (void)testStoreMergesDigests {
+  FileHashCache sut(16);
+  struct stat sb = MakeStat(100, 1024, 1000);
+
+  sut.Store(sb, nil, @"sha256");
+  NSString* sha1;
+  NSString* sha256;
+  XCTAssertTrue(sut.Lookup(sb, NULL, &sha256));
+  XCTAssertFalse(sut.Lookup(sb, &sha1, &sha256));
+
+  sut.Store(sb, @"sha1", nil);
+  XCTAssertTrue(sut.Lookup(sb, &sha1, &sha256));
+  XCTAssertEqualObjects(sha1, @"sha1");
+  XCTAssertEqualObjects(sha256, @"sha256");
+
+  // Digests for an older version of the file are dropped
+  struct stat modified = MakeStat(100, 2048, 2000);
+  sut.Store(modified, @"newsha1", nil);
+  XCTAssertFalse(sut.Lookup(modified, NULL, &sha256));
+  XCTAssertFalse(sut.Lookup(sb, &sha1, NULL));
+  XCTAssertEqual(sut.Count(), 1);
+}
+
+- (void)testInvalidate {
+  FileHashCache sut(16);
+  struct stat sb = MakeStat(100, 1024, 1000);
+  sut.Store(sb, @"sha1", @"sha256");
+
+  sut.Invalidate(SantaVnode::VnodeForFile(sb));
+  XCTAssertFalse(sut.Lookup(sb, NULL, NULL));
+  XCTAssertEqual(sut.Count(), 0);
+}
+
+- (void)testBounded {
+  FileHashCache sut(8);
+  for (ino_t i = 1; i <= 100; i++) {
+    sut.Store(MakeStat(i, 1024, 1000), nil, @"sha256");
+  }
+  XCTAssertLessThanOrEqual(sut.Count(), 8);
+}
+
+- (void)testIsSameVersion {
+  struct stat sb = MakeStat(100, 1024, 1000);
+  XCTAssertTrue(FileHashCache::IsSameVersion(sb, sb));
+
+  struct stat other = sb;
+  other.st_dev = 2;
+  XCTAssertFalse(FileHashCache::IsSameVersion(sb, other));
+
+  other = sb;
+  other.st_atimespec.tv_sec = 5000;
+  XCTAssertTrue(FileHashCache::IsSameVersion(sb, other));
+}
+
+@end
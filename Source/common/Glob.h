@@ -17,13 +17,25 @@
 
 #import <Foundation/Foundation.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace santa {
 
+struct GlobStats {
+  uint64_t directories_read = 0;
+};
+
 std::vector<std::string> FindMatches(NSString* path);
 
+/// Expands all paths at once, returning the matches for each path in the same
+/// order. The globs are merged into a single tree of path components so each
+/// directory shared by several globs is only read once, and independent
+/// subtrees are expanded concurrently on a small bounded pool.
+std::vector<std::vector<std::string>> FindMatches(const std::vector<std::string>& paths,
+                                                  GlobStats* stats = nullptr);
+
 }  // namespace santa
 
 #endif  // SANTA_COMMON_GLOB_H
@@ -12,124 +12,330 @@
 /// See the License for the specific language governing permissions and
 /// limitations under the License.
 
+
 #include "Source/common/Glob.h"
 
-#include <glob.h>
+#include <dirent.h>
+#include <dispatch/dispatch.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
 
 #import "Source/common/SNTLogging.h"
-#include "absl/cleanup/cleanup.h"
 
 namespace santa {
 
-void FindMatches(NSString* base, NSMutableArray<NSString*>* path_components, NSUInteger idx,
-                 std::vector<std::string>& matches) {
-  if (path_components.count == idx) {
-    // Nothing left to match, add the current full base path
-    matches.push_back(base.UTF8String);
-    return;
+namespace {
+
+// Semi-arbitrary to prevent run away recursion. We could consider increasing this if
+// anyone ever has a good use case.
+constexpr NSUInteger kMaxPathComponents = 40;
+constexpr size_t kMaxExpansionWorkers = 4;
+
+// Mirrors what glob(3) treats as magic: unescaped `*` and `?`, and `[` only
+// when a closing bracket follows.
+bool HasMagic(std::string_view pattern) {
+  for (size_t i = 0; i < pattern.size(); i++) {
+    switch (pattern[i]) {
+      case '\\': i++; break;
+      case '*':
+      case '?': return true;
+      case '[': {
+        size_t start = i + 1;
+        if (start < pattern.size() && pattern[start] == '!') start++;
+        if (start < pattern.size() && pattern.find(']', start + 1) != std::string_view::npos) {
+          return true;
+        }
+        break;
+      }
+      default: break;
+    }
+  }
+  return false;
+}
+
+std::string Unescape(std::string_view component) {
+  std::string unescaped;
+  unescaped.reserve(component.size());
+  for (size_t i = 0; i < component.size(); i++) {
+    if (component[i] == '\\' && i + 1 < component.size()) {
+      i++;
+    }
+    unescaped.push_back(component[i]);
+  }
+  return unescaped;
+}
+
+// Splits the path into components for matching. Every component but the last
+// gets a trailing slash so that only directories match it. The last component
+// keeps the trailing slash only if the path ended with one.
+std::vector<std::string> SplitComponents(NSString* path) {
+  NSArray<NSString*>* path_components = [path pathComponents];
+  // Callers ensure the given path starts with a /, so must be at least two entries
+  assert(path_components.count > 1);
+
+  std::vector<std::string> components;
+  NSUInteger limit = [path hasSuffix:@"/"] ? path_components.count - 1 : path_components.count;
+  for (NSUInteger i = 1; i < limit; i++) {
+    std::string component = path_components[i].UTF8String;
+    if (i != limit - 1 || [path hasSuffix:@"/"]) {
+      component.push_back('/');
+    }
+    components.push_back(std::move(component));
   }
+  return components;
+}
+
+struct Node {
+  Node(std::string c, size_t d)
+      : component(std::move(c)), depth(d), magic(HasMagic(component)) {}
+
+  bool RequiresDirectory() const { return !component.empty() && component.back() == '/'; }
 
-  NSString* path = [NSString stringWithFormat:@"%@%@", base, path_components[idx]];
+  std::string component;
+  size_t depth;
+  bool magic;
+  // Globs whose last component is this node
+  std::vector<size_t> ending;
+  // Globs that pass through this node
+  std::vector<size_t> globs;
+  std::vector<std::unique_ptr<Node>> children;
+};
 
-  glob_t* g = (glob_t*)alloca(sizeof(glob_t));
-  // Ensure gl_pathv is NULL so globfree can always safely be called
-  g->gl_pathv = NULL;
+struct WorkItem {
+  const Node* node;
+  std::string base;
+};
 
-  // Ensure globfree is always called
-  absl::Cleanup glob_cleanup = ^{
-    globfree(g);
-  };
+struct WorkerResults {
+  std::vector<WorkItem> next;
+  std::vector<std::pair<size_t, std::string>> matches;
+  uint64_t directories_read = 0;
+};
 
-  int err = glob(path.UTF8String, GLOB_NOSORT, nullptr, g);
-  if (err != 0 && err != GLOB_NOMATCH) {
-    LOGE(@"Failed to generate path names from glob: %@", path);
-    return;
+class Expansion {
+ public:
+  explicit Expansion(const std::vector<std::vector<std::string>>& components)
+      : components_(components), root_(std::string(), 0) {
+    for (size_t i = 0; i < components_.size(); i++) {
+      Insert(i);
+    }
   }
 
-  if (g->gl_pathc == 0) {
-    // If there were no hits...
-    if ((g->gl_flags & GLOB_MAGCHAR) == 0) {
-      // As long as there are no remaining magic chars in any of the path
-      // components, we can add a watch item
-      NSArray<NSString*>* remaining_components =
-          (idx == path_components.count - 1)
-              ? @[]
-              : [path_components
-                    subarrayWithRange:NSMakeRange(idx + 1, path_components.count - idx - 1)];
-      NSString* remaining_path = [remaining_components componentsJoinedByString:@""];
-
-      // Need to manually globfree here since we're about to re-glob
-      globfree(g);
-      glob(remaining_path.UTF8String, 0, NULL, g);
-      if ((g->gl_flags & GLOB_MAGCHAR) == 0) {
-        matches.push_back([NSString stringWithFormat:@"%@%@", path, remaining_path].UTF8String);
+  std::vector<std::vector<std::string>> Run(GlobStats* stats) {
+    std::vector<std::vector<std::string>> matches(components_.size());
+    std::vector<WorkItem> frontier = {{&root_, "/"}};
+    uint64_t directories_read = 0;
+
+    // Expand one level of the tree at a time, spreading the directories to
+    // read at each level across the pool
+    while (!frontier.empty()) {
+      size_t workers = std::min(kMaxExpansionWorkers, frontier.size());
+      std::vector<WorkerResults> results(workers);
+      std::atomic<size_t> next_item{0};
+
+      Expansion* expansion = this;
+      const std::vector<WorkItem>* items = &frontier;
+      std::vector<WorkerResults>* worker_results = &results;
+      std::atomic<size_t>* next = &next_item;
+      dispatch_apply(workers, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t w) {
+        for (size_t i = next->fetch_add(1); i < items->size(); i = next->fetch_add(1)) {
+          expansion->Expand((*items)[i], (*worker_results)[w]);
+        }
+      });
+
+      frontier.clear();
+      for (WorkerResults& result : results) {
+        std::move(result.next.begin(), result.next.end(), std::back_inserter(frontier));
+        for (auto& [glob, match] : result.matches) {
+          matches[glob].push_back(std::move(match));
+        }
+        directories_read += result.directories_read;
       }
-    } else {
-      // There was a magic char but no FS match. No paths will be watched.
     }
-  } else {
-    // For every subpath match, recurse into
-    for (size_t i = g->gl_offs; i < g->gl_pathc; i++) {
-      FindMatches(@(g->gl_pathv[i]), path_components, idx + 1, matches);
+
+    // Workers finish in any order, sort so results are stable
+    for (std::vector<std::string>& glob_matches : matches) {
+      std::sort(glob_matches.begin(), glob_matches.end());
+    }
+
+    if (stats) {
+      stats->directories_read += directories_read;
     }
+
+    return matches;
   }
-}
 
-std::vector<std::string> FindMatches(NSString* path) {
-  if (!path) {
-    return {};
+ private:
+  void Insert(size_t glob) {
+    Node* node = &root_;
+    for (size_t depth = 0; depth < components_[glob].size(); depth++) {
+      const std::string& component = components_[glob][depth];
+      auto it = std::find_if(node->children.begin(), node->children.end(),
+                             [&component](const auto& child) {
+                               return child->component == component;
+                             });
+      if (it == node->children.end()) {
+        node->children.push_back(std::make_unique<Node>(component, depth));
+        it = node->children.end() - 1;
+      }
+      node = it->get();
+      node->globs.push_back(glob);
+    }
+    node->ending.push_back(glob);
   }
 
-  if (![path hasPrefix:@"/"]) {
-    path = [NSString stringWithFormat:@"/%@", path];
+  void Expand(const WorkItem& item, WorkerResults& results) const {
+    for (size_t glob : item.node->ending) {
+      results.matches.emplace_back(glob, item.base);
+    }
+
+    bool has_magic_children = false;
+    for (const auto& child : item.node->children) {
+      if (child->magic) {
+        has_magic_children = true;
+      } else {
+        ExpandLiteral(item.base, *child, results);
+      }
+    }
+
+    if (has_magic_children) {
+      ExpandMagic(item, results);
+    }
   }
 
-  glob_t* g = (glob_t*)alloca(sizeof(glob_t));
-  // Ensure gl_pathv is NULL so globfree can always safely be called
-  g->gl_pathv = NULL;
+  void ExpandLiteral(const std::string& base, const Node& child, WorkerResults& results) const {
+    std::string path = base + Unescape(child.component);
+    struct stat sb;
+    if (lstat(path.c_str(), &sb) == 0) {
+      results.next.push_back({&child, std::move(path)});
+      return;
+    }
 
-  // Ensure globfree is always called
-  absl::Cleanup glob_cleanup = ^{
-    globfree(g);
-  };
+    // The path doesn't exist yet. As long as there are no magic chars in any
+    // of the remaining components, the full path can still be watched.
+    for (size_t glob : child.globs) {
+      const std::vector<std::string>& components = components_[glob];
+      bool remaining_magic =
+          std::any_of(components.begin() + child.depth + 1, components.end(),
+                      [](const std::string& component) { return HasMagic(component); });
+      if (remaining_magic) {
+        continue;
+      }
 
-  int err = glob(path.UTF8String, 0, nullptr, g);
-  if (err != 0 && err != GLOB_NOMATCH) {
-    LOGE(@"Failed to generate path names from glob: %@", path);
-    return {};
+      std::string missing = base;
+      for (size_t i = child.depth; i < components.size(); i++) {
+        missing.append(components[i]);
+      }
+      results.matches.emplace_back(glob, std::move(missing));
+    }
   }
 
-  // If the path had no glob char, begin watching it whether or not it exists
-  if ((g->gl_flags & GLOB_MAGCHAR) == 0) {
-    return {path.UTF8String};
+  // Reads the directory once and matches every entry against each magic child
+  void ExpandMagic(const WorkItem& item, WorkerResults& results) const {
+    DIR* dir = opendir(item.base.c_str());
+    if (!dir) {
+      return;
+    }
+    results.directories_read++;
+
+    std::vector<std::pair<std::string, uint8_t>> entries;
+    while (struct dirent* entry = readdir(dir)) {
+      entries.emplace_back(entry->d_name, entry->d_type);
+    }
+    closedir(dir);
+
+    for (const auto& child : item.node->children) {
+      if (!child->magic) {
+        continue;
+      }
+
+      std::string pattern = child->component;
+      bool requires_directory = child->RequiresDirectory();
+      if (requires_directory) {
+        pattern.pop_back();
+      }
+
+      for (const auto& [name, type] : entries) {
+        // Like glob(3), hidden entries are only matched by a leading period
+        if (name[0] == '.' && pattern[0] != '.') {
+          continue;
+        }
+        if (fnmatch(pattern.c_str(), name.c_str(), 0) != 0) {
+          continue;
+        }
+
+        std::string path = item.base + name;
+        if (requires_directory) {
+          if (type != DT_DIR) {
+            struct stat sb;
+            if (type != DT_LNK && type != DT_UNKNOWN) continue;
+            if (stat(path.c_str(), &sb) != 0 || !S_ISDIR(sb.st_mode)) continue;
+          }
+          path.push_back('/');
+        }
+        results.next.push_back({child.get(), std::move(path)});
+      }
+    }
   }
 
-  NSArray<NSString*>* path_components = [path pathComponents];
-  // Code above enforces the given path starts with a /, so must be at least two entries
-  assert(path_components.count > 1);
+  const std::vector<std::vector<std::string>>& components_;
+  Node root_;
+};
 
-  // Semi-arbitrary to prevent run away recursion. We could consider increasing this if
-  // anyone ever has a good use case.
-  if (path_components.count > 40) {
-    LOGW(@"Glob path contained too many components, skipping: %@", path);
+}  // namespace
+
+std::vector<std::string> FindMatches(NSString* path) {
+  if (!path) {
     return {};
   }
 
-  // Modify each path component to have a trailing slash. This is to ensure that when path
-  // components are appended for recursive glob searches, only directory results will be returned.
-  NSMutableArray<NSString*>* modified_path_components = [NSMutableArray array];
-  NSUInteger limit = [path hasSuffix:@"/"] ? path_components.count - 1 : path_components.count;
-  for (NSUInteger i = 1; i < limit; i++) {
-    // If adding the last component and the input doesn't end with a slash, don't append the slash
-    if (i == limit - 1 && ![path hasSuffix:@"/"]) {
-      [modified_path_components addObject:path_components[i]];
-    } else {
-      [modified_path_components addObject:[NSString stringWithFormat:@"%@/", path_components[i]]];
+  return FindMatches(std::vector<std::string>{path.UTF8String})[0];
+}
+
+std::vector<std::vector<std::string>> FindMatches(const std::vector<std::string>& paths,
+                                                  GlobStats* stats) {
+  std::vector<std::vector<std::string>> matches(paths.size());
+
+  // Only globs with magic chars are expanded, the rest are watched whether or
+  // not they exist
+  std::vector<size_t> glob_indexes;
+  std::vector<std::vector<std::string>> components;
+  for (size_t i = 0; i < paths.size(); i++) {
+    NSString* path = @(paths[i].c_str());
+    if (!path) {
+      continue;
+    }
+    if (![path hasPrefix:@"/"]) {
+      path = [NSString stringWithFormat:@"/%@", path];
     }
+
+    if (!HasMagic(path.UTF8String)) {
+      matches[i].push_back(path.UTF8String);
+      continue;
+    }
+
+    if ([path pathComponents].count > kMaxPathComponents) {
+      LOGW(@"Glob path contained too many components, skipping: %@", path);
+      continue;
+    }
+
+    glob_indexes.push_back(i);
+    components.push_back(SplitComponents(path));
   }
 
-  std::vector<std::string> matches;
-  FindMatches(@"/", modified_path_components, 0, matches);
+  if (!glob_indexes.empty()) {
+    std::vector<std::vector<std::string>> expanded = Expansion(components).Run(stats);
+    for (size_t i = 0; i < glob_indexes.size(); i++) {
+      matches[glob_indexes[i]] = std::move(expanded[i]);
+    }
+  }
 
   return matches;
 }
@@ -0,0 +1,99 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_GLOBWATCHER_H
+#define SANTA_COMMON_GLOBWATCHER_H
+
+#include <CoreServices/CoreServices.h>
+#include <dispatch/dispatch.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+/// Watches the directories that glob patterns are expanded from and reports
+/// which patterns may now expand differently.
+///
+/// Each pattern is watched from its deepest existing directory that contains
+/// no glob characters. FSEvents reports changed directories under those roots,
+/// and a pattern is reported only if the changed directory matches one of its
+/// leading components. Patterns without glob characters are ignored.
+class GlobWatcher {
+ public:
+  using GlobsChangedBlock = void (^)(const absl::flat_hash_set<std::string>& globs);
+
+  /// `globs_changed` is called on `q` with the patterns that may have changed.
+  static std::unique_ptr<GlobWatcher> Create(dispatch_queue_t q, GlobsChangedBlock globs_changed);
+
+  GlobWatcher(dispatch_queue_t q, GlobsChangedBlock globs_changed);
+  ~GlobWatcher();
+
+  GlobWatcher(GlobWatcher&& other) = delete;
+  GlobWatcher& operator=(GlobWatcher&& rhs) = delete;
+  GlobWatcher(const GlobWatcher& other) = delete;
+  GlobWatcher& operator=(const GlobWatcher& other) = delete;
+
+  /// Replace the set of watched patterns. Returns false if the FSEvents
+  /// stream could not be started, in which case changes won't be reported.
+  bool Watch(absl::flat_hash_set<std::string> globs);
+
+  /// Whether the path contains glob characters
+  static bool IsGlob(std::string_view path);
+
+  /// The deepest leading directory of the pattern without glob characters,
+  /// e.g. "/Users" for "/Users/*/Library"
+  static std::string WatchRoot(std::string_view glob);
+
+  /// Whether changing the entries of directory `dir` can change what `glob`
+  /// expands to
+  static bool MayAffect(std::string_view glob, std::string_view dir);
+
+ private:
+  static void StreamCallback(ConstFSEventStreamRef stream, void* info, size_t num_events,
+                             void* event_paths, const FSEventStreamEventFlags event_flags[],
+                             const FSEventStreamEventId event_ids[]);
+
+  void HandleEvents(size_t num_events, const char* const* paths,
+                    const FSEventStreamEventFlags flags[]);
+  void StopStreamLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Rewrites event paths under a resolved root back to the root as the
+  // patterns spell it, e.g. /private/tmp back to /tmp
+  std::string UnresolvePathLocked(std::string path) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  struct Root {
+    std::string path;
+    std::string resolved_path;
+  };
+
+  dispatch_queue_t q_;
+  dispatch_queue_t stream_q_;
+  GlobsChangedBlock globs_changed_;
+
+  absl::Mutex lock_;
+  absl::flat_hash_set<std::string> globs_ ABSL_GUARDED_BY(lock_);
+  std::vector<Root> roots_ ABSL_GUARDED_BY(lock_);
+  FSEventStreamRef stream_ ABSL_GUARDED_BY(lock_) = nullptr;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_GLOBWATCHER_H
@@ -0,0 +1,238 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/GlobWatcher.h"
+
+#include <fnmatch.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <utility>
+
+#import "Source/common/SNTLogging.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+
+namespace santa {
+
+namespace {
+
+// Coalesce bursts of changes, e.g. an installer creating many directories
+constexpr CFTimeInterval kStreamLatencySecs = 1.0;
+
+std::vector<std::string_view> PathComponents(std::string_view path) {
+  return absl::StrSplit(path, '/', absl::SkipEmpty());
+}
+
+bool IsDirectory(const std::string& path) {
+  struct stat sb;
+  return stat(path.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode);
+}
+
+}  // namespace
+
+std::unique_ptr<GlobWatcher> GlobWatcher::Create(dispatch_queue_t q,
+                                                 GlobsChangedBlock globs_changed) {
+  return std::make_unique<GlobWatcher>(q, globs_changed);
+}
+
+GlobWatcher::GlobWatcher(dispatch_queue_t q, GlobsChangedBlock globs_changed)
+    : q_(q),
+      stream_q_(dispatch_queue_create("com.northpolesec.santa.glob_watcher.stream",
+                                      DISPATCH_QUEUE_SERIAL)),
+      globs_changed_(globs_changed) {}
+
+GlobWatcher::~GlobWatcher() {
+  {
+    absl::MutexLock lock(lock_);
+    StopStreamLocked();
+  }
+
+  // Wait for any callback that was already running. Callbacks never hold a
+  // reference that could cause the watcher to be destroyed on stream_q_.
+  dispatch_sync(stream_q_, ^{
+                });
+}
+
+bool GlobWatcher::IsGlob(std::string_view path) {
+  return path.find_first_of("*?[") != std::string_view::npos;
+}
+
+std::string GlobWatcher::WatchRoot(std::string_view glob) {
+  std::vector<std::string_view> literal_components;
+  for (std::string_view component : PathComponents(glob)) {
+    if (IsGlob(component)) {
+      break;
+    }
+    literal_components.push_back(component);
+  }
+  return "/" + absl::StrJoin(literal_components, "/");
+}
+
+bool GlobWatcher::MayAffect(std::string_view glob, std::string_view dir) {
+  std::vector<std::string_view> glob_components = PathComponents(glob);
+  std::vector<std::string_view> dir_components = PathComponents(dir);
+
+  // Entries of the directory are matched against the next glob component, so
+  // directories at or below the depth of the whole pattern don't matter
+  if (dir_components.size() >= glob_components.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < dir_components.size(); i++) {
+    std::string pattern(glob_components[i]);
+    std::string component(dir_components[i]);
+    // FNM_PERIOD matches glob(3), which requires leading periods be explicit
+    if (fnmatch(pattern.c_str(), component.c_str(), FNM_PERIOD) != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool GlobWatcher::Watch(absl::flat_hash_set<std::string> globs) {
+  absl::erase_if(globs, [](const std::string& glob) { return !IsGlob(glob); });
+
+  absl::MutexLock lock(lock_);
+  if (stream_ && globs == globs_) {
+    return true;
+  }
+
+  StopStreamLocked();
+  globs_ = std::move(globs);
+
+  absl::flat_hash_set<std::string> root_paths;
+  for (const std::string& glob : globs_) {
+    // FSEvents can't watch a directory that doesn't exist yet, so watch its
+    // nearest existing ancestor instead
+    std::string root = WatchRoot(glob);
+    while (root != "/" && !IsDirectory(root)) {
+      size_t slash = root.find_last_of('/');
+      root = slash == 0 ? "/" : root.substr(0, slash);
+    }
+    root_paths.insert(std::move(root));
+  }
+
+  if (root_paths.empty()) {
+    return true;
+  }
+
+  CFMutableArrayRef cf_paths =
+      CFArrayCreateMutable(kCFAllocatorDefault, root_paths.size(), &kCFTypeArrayCallBacks);
+  for (const std::string& path : root_paths) {
+    char resolved[PATH_MAX];
+    roots_.push_back({
+        .path = path,
+        .resolved_path = realpath(path.c_str(), resolved) ? resolved : path,
+    });
+
+    CFStringRef cf_path =
+        CFStringCreateWithCString(kCFAllocatorDefault, path.c_str(), kCFStringEncodingUTF8);
+    if (cf_path) {
+      CFArrayAppendValue(cf_paths, cf_path);
+      CFRelease(cf_path);
+    }
+  }
+
+  FSEventStreamContext context = {
+      .version = 0,
+      .info = this,
+  };
+  stream_ = FSEventStreamCreate(kCFAllocatorDefault, &GlobWatcher::StreamCallback, &context,
+                                cf_paths, kFSEventStreamEventIdSinceNow, kStreamLatencySecs,
+                                kFSEventStreamCreateFlagNone);
+  CFRelease(cf_paths);
+
+  if (!stream_) {
+    LOGW(@"Failed to create FSEvents stream for %zu watch item glob roots", roots_.size());
+    roots_.clear();
+    return false;
+  }
+
+  FSEventStreamSetDispatchQueue(stream_, stream_q_);
+  if (!FSEventStreamStart(stream_)) {
+    LOGW(@"Failed to start FSEvents stream for %zu watch item glob roots", roots_.size());
+    StopStreamLocked();
+    return false;
+  }
+
+  return true;
+}
+
+void GlobWatcher::StopStreamLocked() {
+  if (stream_) {
+    FSEventStreamStop(stream_);
+    FSEventStreamInvalidate(stream_);
+    FSEventStreamRelease(stream_);
+    stream_ = nullptr;
+  }
+  roots_.clear();
+}
+
+void GlobWatcher::StreamCallback(ConstFSEventStreamRef stream, void* info, size_t num_events,
+                                 void* event_paths, const FSEventStreamEventFlags event_flags[],
+                                 const FSEventStreamEventId event_ids[]) {
+  static_cast<GlobWatcher*>(info)->HandleEvents(num_events, static_cast<char**>(event_paths),
+                                                event_flags);
+}
+
+std::string GlobWatcher::UnresolvePathLocked(std::string path) {
+  for (const Root& root : roots_) {
+    if (root.path != root.resolved_path && path.starts_with(root.resolved_path) &&
+        (path.size() == root.resolved_path.size() || path[root.resolved_path.size()] == '/')) {
+      return root.path + path.substr(root.resolved_path.size());
+    }
+  }
+  return path;
+}
+
+void GlobWatcher::HandleEvents(size_t num_events, const char* const* paths,
+                               const FSEventStreamEventFlags flags[]) {
+  absl::flat_hash_set<std::string> changed;
+  {
+    absl::MutexLock lock(lock_);
+    for (size_t i = 0; i < num_events && changed.size() < globs_.size(); i++) {
+      // When events were dropped there's no telling what changed
+      if (flags[i] & (kFSEventStreamEventFlagUserDropped | kFSEventStreamEventFlagKernelDropped |
+                      kFSEventStreamEventFlagRootChanged)) {
+        changed = globs_;
+        break;
+      }
+
+      // Coalesced changes below the directory (MustScanSubDirs) can only
+      // matter to patterns that the directory itself is along, so they're
+      // handled the same as a change to the directory.
+      std::string dir = UnresolvePathLocked(paths[i]);
+      for (const std::string& glob : globs_) {
+        if (MayAffect(glob, dir)) {
+          changed.insert(glob);
+        }
+      }
+    }
+  }
+
+  if (changed.empty()) {
+    return;
+  }
+
+  GlobsChangedBlock globs_changed = globs_changed_;
+  dispatch_async(q_, ^{
+    globs_changed(changed);
+  });
+}
+
+}  // namespace santa
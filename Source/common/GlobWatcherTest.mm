@@ -0,0 +1,62 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/GlobWatcher.h"
+
+#import <XCTest/XCTest.h>
+
+using santa::GlobWatcher;
+
+@interface GlobWatcherTest : XCTestCase
+@end
+
+@implementation GlobWatcherTest
+
+- (void)testIsGlob {
+  XCTAssertTrue(GlobWatcher::IsGlob("/Users/*/Library"));
+  XCTAssertTrue(GlobWatcher::IsGlob("/tmp/f?"));
+  XCTAssertTrue(GlobWatcher::IsGlob("/tmp/[ab]"));
+  XCTAssertFalse(GlobWatcher::IsGlob("/Users/foo/Library"));
+}
+
+- (void)testWatchRoot {
+  XCTAssertEqual(GlobWatcher::WatchRoot("/Users/*/Library"), "/Users");
+  XCTAssertEqual(GlobWatcher::WatchRoot("/a/b/c*/d/e?"), "/a/b");
+  XCTAssertEqual(GlobWatcher::WatchRoot("/*"), "/");
+  XCTAssertEqual(GlobWatcher::WatchRoot("/a//b/*"), "/a/b");
+}
+
+- (void)testMayAffect {
+  std::string glob = "/Users/*/Library/Keychains";
+
+  // Directories along the pattern
+  XCTAssertTrue(GlobWatcher::MayAffect(glob, "/Users/"));
+  XCTAssertTrue(GlobWatcher::MayAffect(glob, "/Users/alice"));
+  XCTAssertTrue(GlobWatcher::MayAffect(glob, "/Users/alice/Library/"));
+
+  // Directories at or below the depth of the pattern
+  XCTAssertFalse(GlobWatcher::MayAffect(glob, "/Users/alice/Library/Keychains"));
+  XCTAssertFalse(GlobWatcher::MayAffect(glob, "/Users/alice/Library/Keychains/x"));
+
+  // Directories off the pattern
+  XCTAssertFalse(GlobWatcher::MayAffect(glob, "/Users/alice/Documents"));
+  XCTAssertFalse(GlobWatcher::MayAffect(glob, "/Applications"));
+
+  // Like glob(3), wildcards don't match a leading period
+  XCTAssertFalse(GlobWatcher::MayAffect(glob, "/Users/.hidden"));
+  XCTAssertTrue(GlobWatcher::MayAffect("/Users/.*/Library", "/Users/.hidden"));
+}
+
+@end
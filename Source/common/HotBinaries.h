@@ -0,0 +1,79 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_HOTBINARIES_H
+#define SANTA_COMMON_HOTBINARIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Tracks the binaries that cost the most evaluation time in total, keyed by
+// cdhash or, for unsigned binaries, path.
+//
+// Uses the space-saving algorithm: once all `capacity` slots are in use, a
+// new key replaces the entry with the lowest total and inherits that total as
+// its starting point. Every binary whose true total exceeds the smallest
+// tracked total is guaranteed to be present, and an entry's total is never
+// overestimated by more than its `error_nanos`.
+class HotBinaries {
+ public:
+  struct Entry {
+    std::string key;
+    std::string path;
+    uint64_t count = 0;
+    uint64_t total_nanos = 0;
+    uint64_t max_nanos = 0;
+    // Upper bound on how much of total_nanos came from evicted entries
+    uint64_t error_nanos = 0;
+  };
+
+  static constexpr size_t kDefaultCapacity = 64;
+
+  // Process wide record of exec evaluation costs
+  static HotBinaries& Shared();
+
+  explicit HotBinaries(size_t capacity = kDefaultCapacity);
+
+  HotBinaries(HotBinaries&& other) = delete;
+  HotBinaries& operator=(HotBinaries&& rhs) = delete;
+  HotBinaries(const HotBinaries& other) = delete;
+  HotBinaries& operator=(const HotBinaries& other) = delete;
+
+  // Attributes `nanos` of evaluation time to `key`. The path is kept for
+  // display and updated to the most recently seen path for the key.
+  void Record(std::string_view key, std::string_view path, uint64_t nanos);
+
+  // Up to `limit` entries, highest total first
+  std::vector<Entry> Top(size_t limit) const;
+
+ private:
+  const size_t capacity_;
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_HOTBINARIES_H
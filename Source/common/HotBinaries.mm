@@ -0,0 +1,75 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/HotBinaries.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace santa {
+
+HotBinaries& HotBinaries::Shared() {
+  static HotBinaries* shared = new HotBinaries();
+  return *shared;
+}
+
+HotBinaries::HotBinaries(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+void HotBinaries::Record(std::string_view key, std::string_view path, uint64_t nanos) {
+  absl::MutexLock lock(&mu_);
+
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    uint64_t inherited = 0;
+    if (entries_.size() >= capacity_) {
+      auto coldest = std::min_element(
+          entries_.begin(), entries_.end(), [](const auto& a, const auto& b) {
+            return a.second.total_nanos < b.second.total_nanos;
+          });
+      inherited = coldest->second.total_nanos;
+      entries_.erase(coldest);
+    }
+    Entry entry{.key = std::string(key), .total_nanos = inherited, .error_nanos = inherited};
+    it = entries_.emplace(entry.key, std::move(entry)).first;
+  }
+
+  Entry& entry = it->second;
+  if (entry.path != path) {
+    entry.path = std::string(path);
+  }
+  entry.count++;
+  entry.total_nanos += nanos;
+  entry.max_nanos = std::max(entry.max_nanos, nanos);
+}
+
+std::vector<HotBinaries::Entry> HotBinaries::Top(size_t limit) const {
+  std::vector<Entry> top;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    top.reserve(entries_.size());
+    for (const auto& [key, entry] : entries_) {
+      top.push_back(entry);
+    }
+  }
+
+  std::sort(top.begin(), top.end(),
+            [](const Entry& a, const Entry& b) { return a.total_nanos > b.total_nanos; });
+  if (top.size() > limit) {
+    top.resize(limit);
+  }
+  return top;
+}
+
+}  // namespace santa
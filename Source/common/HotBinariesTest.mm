@@ -0,0 +1,115 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/HotBinaries.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using santa::HotBinaries;
+
+@interface HotBinariesTest : XCTestCase
+@end
+
+@implementation HotBinariesTest
+
+- (void)testAggregatesByKey {
+  HotBinaries sut(4);
+  sut.Record("aa", "/a", 100);
+  sut.Record("aa", "/a2", 300);
+  sut.Record("bb", "/b", 50);
+
+  std::vector<HotBinaries::Entry> top = sut.Top(10);
+  XCTAssertEqual(top.size(), 2);
+  XCTAssertEqual(top[0].key, "aa");
+  XCTAssertEqual(top[0].path, "/a2");
+  XCTAssertEqual(top[0].count, 2);
+  XCTAssertEqual(top[0].total_nanos, 400);
+  XCTAssertEqual(top[0].max_nanos, 300);
+  XCTAssertEqual(top[0].error_nanos, 0);
+  XCTAssertEqual(top[1].key, "bb");
+
+  XCTAssertEqual(sut.Top(1).size(), 1);
+}
+
+- (void)testRanksByTotalNotMax {
+  HotBinaries sut(4);
+  // One slow evaluation
+  sut.Record("slow", "/slow", 1000);
+  // Many cheap evaluations that add up to more
+  for (int i = 0; i < 50; i++) {
+    sut.Record("busy", "/busy", 100);
+  }
+
+  std::vector<HotBinaries::Entry> top = sut.Top(10);
+  XCTAssertEqual(top[0].key, "busy");
+  XCTAssertEqual(top[0].total_nanos, 5000);
+  XCTAssertEqual(top[1].key, "slow");
+}
+
+- (void)testReplacesColdestWhenFull {
+  HotBinaries sut(2);
+  sut.Record("a", "/a", 100);
+  sut.Record("b", "/b", 200);
+
+  // Replaces the coldest entry, inheriting its total as error
+  sut.Record("c", "/c", 10);
+
+  std::vector<HotBinaries::Entry> top = sut.Top(10);
+  XCTAssertEqual(top.size(), 2);
+  XCTAssertEqual(top[0].key, "b");
+  XCTAssertEqual(top[1].key, "c");
+  XCTAssertEqual(top[1].count, 1);
+  XCTAssertEqual(top[1].total_nanos, 110);
+  XCTAssertEqual(top[1].error_nanos, 100);
+  XCTAssertEqual(top[1].max_nanos, 10);
+}
+
+- (void)testHeavyHitterSurvivesChurn {
+  HotBinaries sut(8);
+  for (int i = 0; i < 1000; i++) {
+    sut.Record("hot", "/hot", 1000);
+    sut.Record(std::to_string(i), "/cold", 10);
+  }
+
+  std::vector<HotBinaries::Entry> top = sut.Top(1);
+  XCTAssertEqual(top[0].key, "hot");
+  XCTAssertEqual(top[0].count, 1000);
+  XCTAssertEqual(top[0].total_nanos - top[0].error_nanos, 1000 * 1000);
+}
+
+- (void)testConcurrentRecording {
+  auto sut = std::make_shared<HotBinaries>(8);
+
+  dispatch_apply(8, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t t) {
+    std::string key = std::to_string(t);
+    for (uint64_t i = 1; i <= 1000; i++) {
+      sut->Record(key, "/bin/" + key, i);
+    }
+  });
+
+  std::vector<HotBinaries::Entry> top = sut->Top(10);
+  XCTAssertEqual(top.size(), 8);
+  for (const auto& entry : top) {
+    XCTAssertEqual(entry.count, 1000);
+    XCTAssertEqual(entry.total_nanos, 500500);
+  }
+}
+
+@end
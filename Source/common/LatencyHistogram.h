@@ -0,0 +1,146 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_LATENCYHISTOGRAM_H
+#define SANTA_COMMON_LATENCYHISTOGRAM_H
+
+#include <EndpointSecurity/ESTypes.h>
+#include <time.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+namespace santa {
+
+// Log-linear histogram of nanosecond latencies.
+//
+// Values are grouped by their highest set bit and each group is split into
+// kSubBuckets linear sub-buckets, which bounds the relative error of any
+// reported value to 1/kSubBuckets. Recording is wait-free: threads are spread
+// across kStripes independent sets of counters that are merged when a
+// snapshot is taken.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+  static constexpr int kStripes = 8;
+
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t max = 0;
+    std::array<uint64_t, kNumBuckets> buckets{};
+
+    // Returns the upper bound of the bucket containing the given percentile,
+    // in the range [0, 100], or 0 if no values were recorded.
+    uint64_t Percentile(double percentile) const;
+  };
+
+  LatencyHistogram() = default;
+
+  LatencyHistogram(LatencyHistogram&& other) = delete;
+  LatencyHistogram& operator=(LatencyHistogram&& rhs) = delete;
+  LatencyHistogram(const LatencyHistogram& other) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram& other) = delete;
+
+  void Record(uint64_t nanos);
+
+  // Merge all stripes. When `reset` is true the recorded values are cleared
+  // so that the next snapshot only covers values recorded after this one.
+  Snapshot TakeSnapshot(bool reset);
+
+  static int BucketForValue(uint64_t value);
+  static uint64_t BucketUpperBound(int bucket);
+
+ private:
+  struct alignas(64) Stripe {
+    std::array<std::atomic<uint32_t>, kNumBuckets> buckets{};
+    std::atomic<uint64_t> max{0};
+  };
+
+  std::array<Stripe, kStripes> stripes_;
+};
+
+// Stages of event processing with latency tracked per ES event type
+enum class LatencyStage {
+  kEnrich = 0,
+  kCacheCheck,
+  kRuleLookup,
+  kCELEvaluation,
+  kHashing,
+  kRespond,
+  kMaxStage = kRespond,
+};
+
+// Process wide set of latency histograms keyed by stage and event type.
+// Histograms are only allocated once a value is recorded for them.
+class StageLatencies {
+ public:
+  static StageLatencies& Shared();
+
+  StageLatencies() = default;
+  ~StageLatencies();
+
+  StageLatencies(StageLatencies&& other) = delete;
+  StageLatencies& operator=(StageLatencies&& rhs) = delete;
+  StageLatencies(const StageLatencies& other) = delete;
+  StageLatencies& operator=(const StageLatencies& other) = delete;
+
+  void Record(LatencyStage stage, es_event_type_t event_type, uint64_t nanos);
+
+  // Visit a snapshot of every histogram that has recorded values
+  void ForEach(bool reset,
+               const std::function<void(LatencyStage, es_event_type_t,
+                                        const LatencyHistogram::Snapshot&)>&
+                   callback);
+
+ private:
+  static constexpr size_t kNumStages =
+      static_cast<size_t>(LatencyStage::kMaxStage) + 1;
+  static constexpr size_t kNumEventTypes = ES_EVENT_TYPE_LAST + 1;
+
+  std::array<std::array<std::atomic<LatencyHistogram*>, kNumEventTypes>,
+             kNumStages>
+      histograms_{};
+};
+
+// Records the time from construction until destruction for the given stage
+class ScopedStageLatency {
+ public:
+  ScopedStageLatency(LatencyStage stage, es_event_type_t event_type)
+      : stage_(stage),
+        event_type_(event_type),
+        start_(clock_gettime_nsec_np(CLOCK_MONOTONIC)) {}
+
+  ~ScopedStageLatency() {
+    StageLatencies::Shared().Record(
+        stage_, event_type_, clock_gettime_nsec_np(CLOCK_MONOTONIC) - start_);
+  }
+
+  ScopedStageLatency(ScopedStageLatency&& other) = delete;
+  ScopedStageLatency& operator=(ScopedStageLatency&& rhs) = delete;
+  ScopedStageLatency(const ScopedStageLatency& other) = delete;
+  ScopedStageLatency& operator=(const ScopedStageLatency& other) = delete;
+
+ private:
+  LatencyStage stage_;
+  es_event_type_t event_type_;
+  uint64_t start_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_LATENCYHISTOGRAM_H
@@ -0,0 +1,156 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace santa {
+
+namespace {
+
+// Threads are assigned stripes round robin the first time they record a value
+int StripeForCurrentThread() {
+  static std::atomic<uint32_t> next_stripe{0};
+  thread_local int stripe =
+      next_stripe.fetch_add(1, std::memory_order_relaxed) % LatencyHistogram::kStripes;
+  return stripe;
+}
+
+}  // namespace
+
+int LatencyHistogram::BucketForValue(uint64_t value) {
+  if (value < kSubBuckets) {
+    return (int)value;
+  }
+
+  int msb = 63 - __builtin_clzll(value);
+  int shift = msb - kSubBucketBits;
+  int sub_bucket = (int)((value >> shift) & (kSubBuckets - 1));
+  return (shift + 1) * kSubBuckets + sub_bucket;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+
+  int shift = bucket / kSubBuckets - 1;
+  uint64_t sub_bucket = bucket % kSubBuckets;
+  uint64_t lower = (kSubBuckets + sub_bucket) << shift;
+  return lower + ((1ull << shift) - 1);
+}
+
+void LatencyHistogram::Record(uint64_t nanos) {
+  Stripe& stripe = stripes_[StripeForCurrentThread()];
+  stripe.buckets[BucketForValue(nanos)].fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t prev_max = stripe.max.load(std::memory_order_relaxed);
+  while (nanos > prev_max &&
+         !stripe.max.compare_exchange_weak(prev_max, nanos, std::memory_order_relaxed)) {
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::TakeSnapshot(bool reset) {
+  Snapshot snapshot;
+  for (Stripe& stripe : stripes_) {
+    for (int i = 0; i < kNumBuckets; i++) {
+      uint64_t count = reset ? stripe.buckets[i].exchange(0, std::memory_order_relaxed)
+                             : stripe.buckets[i].load(std::memory_order_relaxed);
+      snapshot.buckets[i] += count;
+      snapshot.count += count;
+    }
+
+    uint64_t max = reset ? stripe.max.exchange(0, std::memory_order_relaxed)
+                         : stripe.max.load(std::memory_order_relaxed);
+    snapshot.max = std::max(snapshot.max, max);
+  }
+  return snapshot;
+}
+
+uint64_t LatencyHistogram::Snapshot::Percentile(double percentile) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(percentile / 100.0 * count));
+
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // The bucket bound can overshoot the largest value actually recorded
+      return std::min(BucketUpperBound(i), max);
+    }
+  }
+  return max;
+}
+
+StageLatencies& StageLatencies::Shared() {
+  static StageLatencies* shared = new StageLatencies();
+  return *shared;
+}
+
+StageLatencies::~StageLatencies() {
+  for (auto& stage : histograms_) {
+    for (auto& histogram : stage) {
+      delete histogram.load(std::memory_order_acquire);
+    }
+  }
+}
+
+void StageLatencies::Record(LatencyStage stage, es_event_type_t event_type, uint64_t nanos) {
+  size_t stage_idx = static_cast<size_t>(stage);
+  if (stage_idx >= kNumStages || event_type >= kNumEventTypes) {
+    return;
+  }
+
+  std::atomic<LatencyHistogram*>& slot = histograms_[stage_idx][event_type];
+  LatencyHistogram* histogram = slot.load(std::memory_order_acquire);
+  if (!histogram) {
+    LatencyHistogram* new_histogram = new LatencyHistogram();
+    if (slot.compare_exchange_strong(histogram, new_histogram, std::memory_order_acq_rel)) {
+      histogram = new_histogram;
+    } else {
+      // Another thread won the race, `histogram` now holds its value
+      delete new_histogram;
+    }
+  }
+
+  histogram->Record(nanos);
+}
+
+void StageLatencies::ForEach(
+    bool reset,
+    const std::function<void(LatencyStage, es_event_type_t, const LatencyHistogram::Snapshot&)>&
+        callback) {
+  for (size_t stage = 0; stage < kNumStages; stage++) {
+    for (size_t event_type = 0; event_type < kNumEventTypes; event_type++) {
+      LatencyHistogram* histogram = histograms_[stage][event_type].load(std::memory_order_acquire);
+      if (!histogram) {
+        continue;
+      }
+
+      LatencyHistogram::Snapshot snapshot = histogram->TakeSnapshot(reset);
+      if (snapshot.count > 0) {
+        callback(static_cast<LatencyStage>(stage), static_cast<es_event_type_t>(event_type),
+                 snapshot);
+      }
+    }
+  }
+}
+
+}  // namespace santa
@@ -0,0 +1,132 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/LatencyHistogram.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <memory>
+
+using santa::LatencyHistogram;
+using santa::LatencyStage;
+using santa::StageLatencies;
+
+@interface LatencyHistogramTest : XCTestCase
+@end
+
+@implementation LatencyHistogramTest
+
+- (void)testBucketBounds {
+  // Small values are exact
+  for (uint64_t i = 0; i < LatencyHistogram::kSubBuckets; i++) {
+    XCTAssertEqual(LatencyHistogram::BucketForValue(i), i);
+    XCTAssertEqual(LatencyHistogram::BucketUpperBound((int)i), i);
+  }
+
+  // Every value falls within its bucket and buckets are within 1/kSubBuckets
+  for (uint64_t v : {8ull, 9ull, 100ull, 1000ull, 123456789ull, 1ull << 40, UINT64_MAX}) {
+    int bucket = LatencyHistogram::BucketForValue(v);
+    XCTAssertLessThan(bucket, LatencyHistogram::kNumBuckets);
+    uint64_t upper = LatencyHistogram::BucketUpperBound(bucket);
+    XCTAssertGreaterThanOrEqual(upper, v);
+    XCTAssertLessThanOrEqual((double)(upper - v), (double)v / LatencyHistogram::kSubBuckets);
+    if (bucket > 0) {
+      XCTAssertLessThan(LatencyHistogram::BucketUpperBound(bucket - 1), v);
+    }
+  }
+}
+
+- (void)testPercentiles {
+  auto sut = std::make_unique<LatencyHistogram>();
+
+  XCTAssertEqual(sut->TakeSnapshot(false).Percentile(50), 0);
+
+  for (uint64_t i = 1; i <= 1000; i++) {
+    sut->Record(i * 1000);
+  }
+
+  LatencyHistogram::Snapshot snapshot = sut->TakeSnapshot(false);
+  XCTAssertEqual(snapshot.count, 1000);
+  XCTAssertEqual(snapshot.max, 1000000);
+
+  // Reported percentiles are within the relative error of the true value
+  auto check = ^(double percentile, uint64_t want) {
+    uint64_t got = snapshot.Percentile(percentile);
+    XCTAssertGreaterThanOrEqual(got, want);
+    XCTAssertLessThanOrEqual((double)got, want * (1.0 + 1.0 / LatencyHistogram::kSubBuckets));
+  };
+  check(50, 500000);
+  check(90, 900000);
+  check(99, 990000);
+  XCTAssertEqual(snapshot.Percentile(100), 1000000);
+}
+
+- (void)testSnapshotReset {
+  auto sut = std::make_unique<LatencyHistogram>();
+
+  sut->Record(100);
+  sut->Record(200);
+  XCTAssertEqual(sut->TakeSnapshot(true).count, 2);
+
+  LatencyHistogram::Snapshot snapshot = sut->TakeSnapshot(false);
+  XCTAssertEqual(snapshot.count, 0);
+  XCTAssertEqual(snapshot.max, 0);
+}
+
+- (void)testConcurrentRecording {
+  auto sut = std::make_shared<LatencyHistogram>();
+
+  dispatch_apply(16, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t t) {
+    for (uint64_t i = 0; i < 10000; i++) {
+      sut->Record(i + t);
+    }
+  });
+
+  LatencyHistogram::Snapshot snapshot = sut->TakeSnapshot(false);
+  XCTAssertEqual(snapshot.count, 16 * 10000);
+  XCTAssertEqual(snapshot.max, 9999 + 15);
+}
+
+- (void)testStageLatencies {
+  StageLatencies sut;
+  sut.Record(LatencyStage::kEnrich, ES_EVENT_TYPE_AUTH_EXEC, 100);
+  sut.Record(LatencyStage::kEnrich, ES_EVENT_TYPE_AUTH_EXEC, 300);
+  sut.Record(LatencyStage::kRespond, ES_EVENT_TYPE_AUTH_OPEN, 50);
+
+  __block int visited = 0;
+  sut.ForEach(true, ^(LatencyStage stage, es_event_type_t eventType,
+                      const LatencyHistogram::Snapshot& snapshot) {
+    visited++;
+    if (stage == LatencyStage::kEnrich) {
+      XCTAssertEqual(eventType, ES_EVENT_TYPE_AUTH_EXEC);
+      XCTAssertEqual(snapshot.count, 2);
+      XCTAssertEqual(snapshot.max, 300);
+    } else {
+      XCTAssertEqual(stage, LatencyStage::kRespond);
+      XCTAssertEqual(eventType, ES_EVENT_TYPE_AUTH_OPEN);
+      XCTAssertEqual(snapshot.count, 1);
+    }
+  });
+  XCTAssertEqual(visited, 2);
+
+  // Histograms with no values since the last reset are skipped
+  visited = 0;
+  sut.ForEach(false, ^(LatencyStage, es_event_type_t, const LatencyHistogram::Snapshot&) {
+    visited++;
+  });
+  XCTAssertEqual(visited, 0);
+}
+
+@end
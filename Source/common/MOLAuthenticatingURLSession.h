@@ -24,11 +24,12 @@
 @interface MOLAuthenticatingURLSession : NSObject <NSURLSessionDelegate, NSURLSessionDataDelegate>
 
 /**
-  Returns a new NSURLSession configured with the correct delegate and session configuration.
+  Returns an NSURLSession configured with the correct delegate and session configuration.
 
-  You can either retrieve this instance and re-use it or keep calling session to get a new session
-  every time. The properties below, with the exception of userAgent, will be updated even in
-  already-created session objects.
+  The same session is returned until it is invalidated, so that connections and their TLS sessions
+  are reused across requests. Setting userAgent finishes the current session's tasks and
+  invalidates it, and the next call returns a new session with the updated configuration. The
+  other properties below take effect in the existing session.
 */
 @property(readonly) NSURLSession* session;
 
@@ -36,7 +37,7 @@
   If set, this is the user-agent to send with requests, otherwise remains the default
   CFNetwork-based name.
 
-  This property does not update existing session objects retrieved with the session property.
+  Changing this property invalidates the session previously returned by the session property.
 */
 @property(copy, nonatomic) NSString* userAgent;
 
@@ -15,7 +15,9 @@
 
 #import "MOLAuthenticatingURLSession.h"
 #include <Security/SecKey.h>
+#include <notify.h>
 
+#include <atomic>
 #include <tuple>
 
 #import <Foundation/Foundation.h>
@@ -30,18 +32,48 @@ using ScopedCFDataRef = santa::ScopedCFTypeRef<CFDataRef>;
 using ScopedSecKeyRef = santa::ScopedCFTypeRef<SecKeyRef>;
 using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
 
+// Posted by securityd whenever an item in one of the keychains changes.
+static const char* const kKeychainChangedNotification = "com.apple.security.keychainchanged";
+
+// Incremented on every keychain change, invalidating all cached client credentials.
+static std::atomic<uint64_t> gKeychainGeneration{0};
+
+static uint64_t KeychainGeneration() {
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    int token;
+    notify_register_dispatch(kKeychainChangedNotification, &token,
+                             dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(int) {
+                               gKeychainGeneration.fetch_add(1, std::memory_order_relaxed);
+                             });
+  });
+  return gKeychainGeneration.load(std::memory_order_relaxed);
+}
+
 @interface MOLAuthenticatingURLSession ()
 @property NSURLSessionConfiguration* sessionConfig;
 @property(copy, nonatomic) NSArray* anchors;
 @property(readwrite, nonatomic) MOLCertificate* clientCertificate;
+
+// The client credential resolved by the last client certificate challenge, reused for later
+// challenges as long as the inputs to the lookup in cachedCredentialKey are unchanged.
+@property NSURLCredential* cachedCredential;
+@property NSArray* cachedCredentialKey;
+
+// Expiry dates of successful server trust evaluations, keyed by host and leaf certificate SHA-256.
+// Cleared whenever the anchors change.
+@property NSMutableDictionary<NSString*, NSDate*>* trustedLeaves;
 @end
 
-@implementation MOLAuthenticatingURLSession
+@implementation MOLAuthenticatingURLSession {
+  NSURLSession* _session;
+}
 
 - (instancetype)initWithSessionConfiguration:(NSURLSessionConfiguration*)configuration {
   self = [super init];
   if (self) {
     _sessionConfig = configuration;
+    _trustedLeaves = [NSMutableDictionary dictionary];
   }
   return self;
 }
@@ -56,7 +88,23 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
 #pragma mark Session Fetching
 
 - (NSURLSession*)session {
-  return [NSURLSession sessionWithConfiguration:self.sessionConfig delegate:self delegateQueue:nil];
+  @synchronized(self) {
+    if (!_session) {
+      _session = [NSURLSession sessionWithConfiguration:self.sessionConfig
+                                               delegate:self
+                                          delegateQueue:nil];
+    }
+    return _session;
+  }
+}
+
+// Sessions copy their configuration when created, so the next call to session has to create a new
+// one to pick up configuration changes.
+- (void)resetSession {
+  @synchronized(self) {
+    [_session finishTasksAndInvalidate];
+    _session = nil;
+  }
 }
 
 #pragma mark User Agent property
@@ -70,6 +118,7 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
   if (!addlHeaders) addlHeaders = [NSMutableDictionary dictionary];
   addlHeaders[@"User-Agent"] = userAgent;
   self.sessionConfig.HTTPAdditionalHeaders = addlHeaders;
+  [self resetSession];
 }
 
 #pragma mark Server Roots
@@ -101,6 +150,14 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
     return;
   }
 
+  // The same roots, e.g. the pinned ones, are set on every new session, so keep them parsed.
+  static NSCache<NSString*, NSArray*>* parsedRoots = [[NSCache alloc] init];
+  NSArray* cachedRefs = [parsedRoots objectForKey:serverRootsPemString];
+  if (cachedRefs) {
+    self.anchors = cachedRefs;
+    return;
+  }
+
   NSArray* certs = [MOLCertificate certificatesFromPEM:serverRootsPemString];
   if (!certs.count) {
     return [self log:@"Unable to read server root certificates from data %@", serverRootsPemString];
@@ -110,11 +167,26 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
   for (MOLCertificate* cert in certs) {
     [certRefs addObject:(id)cert.certRef];
   }
-  self.anchors = certRefs;
+  cachedRefs = [certRefs copy];
+  [parsedRoots setObject:cachedRefs forKey:serverRootsPemString];
+  self.anchors = cachedRefs;
+}
+
+- (void)setAnchors:(NSArray*)anchors {
+  @synchronized(self) {
+    _anchors = [anchors copy];
+    [self.trustedLeaves removeAllObjects];
+  }
 }
 
 #pragma mark NSURLSessionDelegate methods
 
+- (void)URLSession:(NSURLSession*)session didBecomeInvalidWithError:(NSError*)error {
+  @synchronized(self) {
+    if (_session == session) _session = nil;
+  }
+}
+
 - (void)URLSession:(NSURLSession*)session
     didReceiveChallenge:(NSURLAuthenticationChallenge*)challenge
       completionHandler:(void (^)(NSURLSessionAuthChallengeDisposition disposition,
@@ -122,6 +194,8 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
   NSURLProtectionSpace* protectionSpace = challenge.protectionSpace;
 
   if (challenge.previousFailureCount > 0) {
+    // The credential may be the reason for the failure, look it up again next time.
+    self.cachedCredential = nil;
     completionHandler(NSURLSessionAuthChallengeCancelAuthenticationChallenge, nil);
     return;
   }
@@ -216,9 +290,53 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
 ///  Mode 4: use the list of issuer details sent down by the server to find an identity in the
 ///          keychain.
 ///
-///  If a valid identity cannot be found, returns nil.
+///  If a valid identity cannot be found, returns nil. A credential that was found is reused for
+///  later challenges until the keychain or any of the settings above change.
 ///
 - (NSURLCredential*)clientCredentialForProtectionSpace:(NSURLProtectionSpace*)protectionSpace {
+  NSArray* key = [self credentialKeyForProtectionSpace:protectionSpace];
+  @synchronized(self) {
+    if (self.cachedCredential && [self.cachedCredentialKey isEqual:key]) {
+      [self log:@"[Client Trust] Using cached certificate: %@", self.clientCertificate];
+      return self.cachedCredential;
+    }
+  }
+
+  NSURLCredential* cred = [self resolveClientCredentialForProtectionSpace:protectionSpace];
+  if (cred) {
+    @synchronized(self) {
+      self.cachedCredential = cred;
+      self.cachedCredentialKey = key;
+    }
+  }
+  return cred;
+}
+
+///
+///  Everything that determines which identity clientCredentialForProtectionSpace: selects. Keychain
+///  changes are covered by a generation count, certificate files by their size and modification
+///  date.
+///
+- (NSArray*)credentialKeyForProtectionSpace:(NSURLProtectionSpace*)protectionSpace {
+  NSNull* none = [NSNull null];
+  NSDictionary* fileAttrs =
+      self.clientCertFile
+          ? [[NSFileManager defaultManager] attributesOfItemAtPath:self.clientCertFile error:NULL]
+          : nil;
+  return @[
+    @(KeychainGeneration()),
+    self.clientCertFile ?: none,
+    self.clientCertPassword ?: none,
+    fileAttrs.fileModificationDate ?: none,
+    @(fileAttrs.fileSize),
+    self.clientCertCommonName ?: none,
+    self.clientCertIssuerCn ?: none,
+    protectionSpace.distinguishedNames ?: none,
+  ];
+}
+
+- (NSURLCredential*)resolveClientCredentialForProtectionSpace:
+    (NSURLProtectionSpace*)protectionSpace {
   __block SecIdentityRef foundIdentity = NULL;
 
   NSArray* allCerts;
@@ -373,10 +491,26 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
 
   // Print details about the server's leaf certificate.
   NSArray* certChain = CFBridgingRelease(SecTrustCopyCertificateChain(protectionSpace.serverTrust));
+  NSString* trustKey;
   if (certChain.firstObject) {
     MOLCertificate* cert = [[MOLCertificate alloc]
         initWithSecCertificateRef:(__bridge SecCertificateRef)certChain.firstObject];
     [self log:@"[Server Trust] Certificate: %@", cert];
+    if (cert.SHA256) {
+      trustKey = [NSString stringWithFormat:@"%@/%@", protectionSpace.host, cert.SHA256];
+    }
+  }
+
+  // A chain that was trusted before stays trusted until one of its certificates expires, so
+  // repeated connections to the same server skip the full evaluation.
+  if (trustKey) {
+    @synchronized(self) {
+      NSDate* expiry = self.trustedLeaves[trustKey];
+      if (expiry && expiry.timeIntervalSinceNow > 0) {
+        [self log:@"[Server Trust] Using cached evaluation"];
+        return [NSURLCredential credentialForTrust:protectionSpace.serverTrust];
+      }
+    }
   }
 
   // Evaluate the server's cert chain.
@@ -391,6 +525,24 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
     return nil;
   }
 
+  if (trustKey) {
+    NSDate* expiry = [NSDate distantFuture];
+    for (id certRef in certChain) {
+      MOLCertificate* cert =
+          [[MOLCertificate alloc] initWithSecCertificateRef:(__bridge SecCertificateRef)certRef];
+      if (!cert.validUntil) {
+        expiry = nil;
+        break;
+      }
+      expiry = [expiry earlierDate:cert.validUntil];
+    }
+    if (expiry) {
+      @synchronized(self) {
+        self.trustedLeaves[trustKey] = expiry;
+      }
+    }
+  }
+
   // Create and return the credential
   return [NSURLCredential credentialForTrust:protectionSpace.serverTrust];
 }
@@ -25,6 +25,8 @@
                               issuerCountryName:(NSString*)issuerCountryName
                                   issuerOrgName:(NSString*)issuerOrgName
                                   issuerOrgUnit:(NSString*)issuerOrgUnit;
+- (NSArray*)credentialKeyForProtectionSpace:(NSURLProtectionSpace*)protectionSpace;
+- (NSArray*)anchors;
 @end
 
 @interface MOLAuthenticatingURLSessionTest : XCTestCase
@@ -58,4 +60,57 @@
   XCTAssertEqualObjects(got, want, @"");
 }
 
+- (void)testSessionIsReused {
+  MOLAuthenticatingURLSession* s = [[MOLAuthenticatingURLSession alloc] init];
+
+  NSURLSession* first = s.session;
+  XCTAssertEqual(s.session, first);
+
+  // Changing the user agent requires a new session
+  s.userAgent = @"santa-test";
+  NSURLSession* second = s.session;
+  XCTAssertNotEqual(second, first);
+  XCTAssertEqualObjects(second.configuration.HTTPAdditionalHeaders[@"User-Agent"], @"santa-test");
+
+  // Once the session is invalidated a new one is created
+  [second invalidateAndCancel];
+  [s URLSession:second didBecomeInvalidWithError:nil];
+  XCTAssertNotEqual(s.session, second);
+}
+
+- (void)testServerRootsParsedOnce {
+  NSBundle* bundle = [NSBundle bundleForClass:[self class]];
+  NSString* path = [bundle pathForResource:@"example_org_client_cert" ofType:@"pem"];
+  NSString* pem = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL];
+
+  MOLAuthenticatingURLSession* s1 = [[MOLAuthenticatingURLSession alloc] init];
+  MOLAuthenticatingURLSession* s2 = [[MOLAuthenticatingURLSession alloc] init];
+  [s1 setServerRootsPemString:pem];
+  [s2 setServerRootsPemString:pem];
+
+  XCTAssertEqual(s1.anchors.count, 1);
+  XCTAssertEqual(s1.anchors, s2.anchors);
+
+  [s1 setServerRootsPemString:nil];
+  XCTAssertNil(s1.anchors);
+}
+
+- (void)testCredentialKey {
+  MOLAuthenticatingURLSession* s = [[MOLAuthenticatingURLSession alloc] init];
+  NSURLProtectionSpace* space =
+      [[NSURLProtectionSpace alloc] initWithHost:@"example.org"
+                                            port:443
+                                        protocol:NSURLProtectionSpaceHTTPS
+                                           realm:nil
+                            authenticationMethod:NSURLAuthenticationMethodClientCertificate];
+
+  s.clientCertCommonName = @"Example Organization Client Certificate";
+  NSArray* key = [s credentialKeyForProtectionSpace:space];
+  XCTAssertEqualObjects([s credentialKeyForProtectionSpace:space], key);
+
+  // Any change to the lookup settings invalidates the cached credential
+  s.clientCertCommonName = @"Other Client Certificate";
+  XCTAssertNotEqualObjects([s credentialKeyForProtectionSpace:space], key);
+}
+
 @end
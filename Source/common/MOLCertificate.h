@@ -62,6 +62,8 @@
 /**
   Returns an array of `MOLCertificate's` for each SecCertificateRef in `array`.
 
+  Recently seen chains are cached, so the returned objects may be shared with earlier callers.
+
   @param array NSArray of SecCertificateRef's.
   @return An array of `MOLCertificate` objects for each SecCertificateRef in `array`.
 */
@@ -111,16 +111,63 @@ static NSString* const kCertDataKey = @"certData";
   return certs;
 }
 
+/**
+  Chains returned by certificatesFromArray:, keyed by the SHA-256 of the leaf certificate.
+
+  Most binaries on a host are signed by a handful of chains and MOLCertificate memoizes every
+  value it decodes, so handing back the same objects for a chain that was seen recently lets
+  repeated signature checks skip decoding the certificates again.
+*/
+static const NSUInteger kMaxCachedChains = 256;
+
++ (NSCache<NSData*, NSArray<MOLCertificate*>*>*)chainCache {
+  static NSCache* cache;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    cache = [[NSCache alloc] init];
+    cache.countLimit = kMaxCachedChains;
+  });
+  return cache;
+}
+
 + (NSArray*)certificatesFromArray:(NSArray*)array {
-  NSMutableArray* newArray = [NSMutableArray arrayWithCapacity:array.count];
+  NSMutableArray* certRefs = [NSMutableArray arrayWithCapacity:array.count];
   for (id object in array) {
     if (CFGetTypeID((__bridge CFTypeRef)object) == SecCertificateGetTypeID()) {
-      SecCertificateRef cert = (__bridge SecCertificateRef)object;
-      MOLCertificate* molCert = [[MOLCertificate alloc] initWithSecCertificateRef:cert];
-      if (molCert) [newArray addObject:molCert];
+      [certRefs addObject:object];
+    }
+  }
+  if (certRefs.count == 0) return @[];
+
+  NSData* leafData =
+      CFBridgingRelease(SecCertificateCopyData((__bridge SecCertificateRef)certRefs[0]));
+  unsigned char leafSHA256[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256(leafData.bytes, (CC_LONG)leafData.length, leafSHA256);
+  NSData* key = [NSData dataWithBytes:leafSHA256 length:sizeof(leafSHA256)];
+
+  // The same leaf can be issued under more than one intermediate, so the whole chain must match
+  NSArray<MOLCertificate*>* cached = [[self chainCache] objectForKey:key];
+  if (cached.count == certRefs.count) {
+    BOOL matches = YES;
+    for (NSUInteger i = 0; i < certRefs.count; ++i) {
+      if (!CFEqual(cached[i].certRef, (__bridge CFTypeRef)certRefs[i])) {
+        matches = NO;
+        break;
+      }
     }
+    if (matches) return cached;
   }
-  return [newArray copy];
+
+  NSMutableArray* newArray = [NSMutableArray arrayWithCapacity:certRefs.count];
+  for (id object in certRefs) {
+    SecCertificateRef cert = (__bridge SecCertificateRef)object;
+    MOLCertificate* molCert = [[MOLCertificate alloc] initWithSecCertificateRef:cert];
+    if (molCert) [newArray addObject:molCert];
+  }
+
+  NSArray* chain = [newArray copy];
+  [[self chainCache] setObject:chain forKey:key];
+  return chain;
 }
 
 - (instancetype)init {
@@ -176,26 +223,27 @@ static NSString* const kCertDataKey = @"certData";
   For a given selector, caches the value that selector would return on subsequent invocations,
   using the provided block to get the value on the first invocation.
 
-  Assumes the selector's value will never change.
+  Assumes the selector's value will never change. Instances are shared between threads through
+  the chain cache, so access is synchronized. The lock is recursive, which memoized values that
+  are derived from other memoized values rely on.
 */
 - (id)memoizedSelector:(SEL)selector forBlock:(id (^)(void))block {
   NSString* selName = NSStringFromSelector(selector);
 
-  if (!self.memoizedData) {
-    self.memoizedData = [NSMutableDictionary dictionary];
-  }
+  @synchronized(self) {
+    if (!self.memoizedData) {
+      self.memoizedData = [NSMutableDictionary dictionary];
+    }
 
-  if (!self.memoizedData[selName]) {
-    id val = block();
-    if (val) {
+    id val = self.memoizedData[selName];
+    if (!val) {
+      val = block() ?: [NSNull null];
       self.memoizedData[selName] = val;
-    } else {
-      self.memoizedData[selName] = [NSNull null];
     }
-  }
 
-  // Return the value if there is one, or nil if the value is NSNull
-  return self.memoizedData[selName] != [NSNull null] ? self.memoizedData[selName] : nil;
+    // Return the value if there is one, or nil if the value is NSNull
+    return val != [NSNull null] ? val : nil;
+  }
 }
 
 - (NSDictionary*)allCertificateValues {
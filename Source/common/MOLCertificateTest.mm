@@ -194,6 +194,29 @@
   XCTAssertEqualObjects([certs[1] commonName], @"www.apple.com");
 }
 
+- (void)testArrayOfCertsReusesCachedChain {
+  MOLCertificate* leaf = [[MOLCertificate alloc] initWithCertificateDataDER:self.testDataDER1];
+  MOLCertificate* other = [[MOLCertificate alloc] initWithCertificateDataDER:self.testDataDER2];
+  NSArray* refs = @[ (__bridge id)leaf.certRef, (__bridge id)other.certRef ];
+
+  NSArray* first = [MOLCertificate certificatesFromArray:refs];
+  XCTAssertEqual(first.count, 2);
+  XCTAssertEqualObjects([first[0] commonName], @"Google Internet Authority G2");
+
+  // The same chain hands back the same, already decoded, objects
+  NSArray* second = [MOLCertificate certificatesFromArray:refs];
+  XCTAssertEqual(first[0], second[0]);
+  XCTAssertEqual(first[1], second[1]);
+
+  // A different chain under the same leaf doesn't reuse the cached one
+  NSArray* leafOnly = [MOLCertificate certificatesFromArray:@[ (__bridge id)leaf.certRef ]];
+  XCTAssertEqual(leafOnly.count, 1);
+  XCTAssertEqualObjects(leafOnly[0], first[0]);
+
+  XCTAssertEqual([MOLCertificate certificatesFromArray:@[]].count, 0);
+  XCTAssertEqual([MOLCertificate certificatesFromArray:@[ @"not a cert" ]].count, 0);
+}
+
 - (void)testPlainInit {
   XCTAssertThrows([[MOLCertificate alloc] init]);
 }
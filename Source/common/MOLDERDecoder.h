@@ -16,8 +16,9 @@
 #import <Foundation/Foundation.h>
 
 ///
-/// This is a simple ASN.1 decoder that utilizes Apple's SecAsn1Decode
-/// to parse the @c distinguishedNames property of NSURLProtectionSpace.
+/// This is a simple DER decoder to parse the @c distinguishedNames property
+/// of NSURLProtectionSpace. Fields are read in place from the data passed to
+/// the initializer and are only decoded when requested.
 ///
 @interface MOLDERDecoder : NSObject
 
@@ -15,11 +15,108 @@
 
 #import "MOLDERDecoder.h"
 
-#import <Security/SecAsn1Coder.h>
-#import <Security/SecAsn1Templates.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace {
+
+constexpr uint8_t kTagObjectIdentifier = 0x06;
+constexpr uint8_t kTagSequence = 0x30;
+constexpr uint8_t kTagSet = 0x31;
+
+// Encoded contents of the attribute type OIDs exposed by MOLDERDecoder
+constexpr uint8_t kOIDCommonName[] = {0x55, 0x04, 0x03};
+constexpr uint8_t kOIDCountryName[] = {0x55, 0x04, 0x06};
+constexpr uint8_t kOIDOrganizationName[] = {0x55, 0x04, 0x0A};
+constexpr uint8_t kOIDOrganizationalUnitName[] = {0x55, 0x04, 0x0B};
+
+// Reads consecutive DER elements from a borrowed buffer. Element contents are
+// returned as views into the buffer, nothing is copied or allocated.
+class DERReader {
+ public:
+  explicit DERReader(std::span<const uint8_t> buf) : buf_(buf) {}
+
+  bool Empty() const { return buf_.empty(); }
+
+  // Only low tag numbers and definite lengths are supported, which covers
+  // everything that can appear in a Name.
+  bool Next(uint8_t& tag, std::span<const uint8_t>& contents) {
+    if (buf_.size() < 2) return false;
+
+    tag = buf_[0];
+    if ((tag & 0x1F) == 0x1F) return false;
+
+    size_t header = 2;
+    size_t length = buf_[1];
+    if (length & 0x80) {
+      size_t num_bytes = length & 0x7F;
+      if (num_bytes == 0 || num_bytes > sizeof(size_t) || buf_.size() < header + num_bytes) {
+        return false;
+      }
+      length = 0;
+      for (size_t i = 0; i < num_bytes; ++i) {
+        length = (length << 8) | buf_[header + i];
+      }
+      header += num_bytes;
+    }
+    if (length > buf_.size() - header) return false;
+
+    contents = buf_.subspan(header, length);
+    buf_ = buf_.subspan(header + length);
+    return true;
+  }
+
+ private:
+  std::span<const uint8_t> buf_;
+};
+
+// Calls `visitor(oid, value)` with the encoded type and raw value contents of
+// the first attribute in each RDN of a DER encoded Name. Returns false if the
+// data isn't a well-formed Name, or if the visitor returns false.
+template <typename Visitor>
+bool ForEachAttribute(std::span<const uint8_t> der, Visitor visitor) {
+  uint8_t tag;
+  std::span<const uint8_t> name;
+  DERReader outer(der);
+  if (!outer.Next(tag, name) || tag != kTagSequence) return false;
+
+  DERReader rdns(name);
+  while (!rdns.Empty()) {
+    std::span<const uint8_t> rdn, attribute, oid, value;
+    if (!rdns.Next(tag, rdn) || tag != kTagSet) return false;
+
+    DERReader attributes(rdn);
+    if (!attributes.Next(tag, attribute) || tag != kTagSequence) return false;
+
+    DERReader fields(attribute);
+    if (!fields.Next(tag, oid) || tag != kTagObjectIdentifier) return false;
+    if (!fields.Next(tag, value)) return false;
+
+    if (!visitor(oid, value)) return false;
+  }
+  return true;
+}
+
+// First try creating as a UTF-8 string. If that fails, fallback to trying as
+// an ASCII string.
+NSString* StringFromValue(std::span<const uint8_t> value) {
+  NSString* str = [[NSString alloc] initWithBytes:value.data()
+                                           length:value.size()
+                                         encoding:NSUTF8StringEncoding];
+  if (!str) {
+    str = [[NSString alloc] initWithBytes:value.data()
+                                   length:value.size()
+                                 encoding:NSASCIIStringEncoding];
+  }
+  return str;
+}
+
+}  // namespace
 
 @interface MOLDERDecoder ()
-@property NSDictionary* decodedObjects;
+@property NSData* data;
 @end
 
 @implementation MOLDERDecoder
@@ -30,9 +127,17 @@
   self = [super init];
   if (self) {
     if (!data) return nil;
-
-    _decodedObjects = [self decodeData:data];
-    if (!_decodedObjects || [_decodedObjects count] == 0) return nil;
+    _data = [data copy];
+
+    // The whole Name must be well-formed and have at least one attribute
+    // with a usable string value.
+    bool found = false;
+    bool wellFormed = ForEachAttribute(
+        [self derBytes], [&found](std::span<const uint8_t>, std::span<const uint8_t> value) {
+          if (!found) found = StringFromValue(value) != nil;
+          return true;
+        });
+    if (!wellFormed || !found) return nil;
   }
   return self;
 }
@@ -51,23 +156,27 @@
 #pragma mark Accessors
 
 - (NSString*)commonName {
-  return self.decodedObjects[(__bridge id)kSecOIDCommonName];
+  return [self valueForOID:kOIDCommonName];
 }
 
 - (NSString*)organizationName {
-  return self.decodedObjects[(__bridge id)kSecOIDOrganizationName];
+  return [self valueForOID:kOIDOrganizationName];
 }
 
 - (NSString*)organizationalUnit {
-  return self.decodedObjects[(__bridge id)kSecOIDOrganizationalUnitName];
+  return [self valueForOID:kOIDOrganizationalUnitName];
 }
 
 - (NSString*)countryName {
-  return self.decodedObjects[(__bridge id)kSecOIDCountryName];
+  return [self valueForOID:kOIDCountryName];
 }
 
 #pragma mark Private
 
+- (std::span<const uint8_t>)derBytes {
+  return std::span<const uint8_t>(static_cast<const uint8_t*>(self.data.bytes), self.data.length);
+}
+
 /**
  * The DER data provided by NSURLProtectionSpace.distinguishedNames looks like
  * this:
@@ -87,89 +196,21 @@
  *   }
  * }
  *
- * This method assumes the passed in data will be in that format. If it isn't,
- * the DER decoding will fail and this method will return nil.
+ * The data is walked in place each time a field is requested and only the
+ * requested value is turned into a string. If an attribute appears more than
+ * once the last usable value wins.
  **/
-- (NSDictionary*)decodeData:(NSData*)data {
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated-declarations"
-  typedef struct {
-    SecAsn1Oid oid;
-    SecAsn1Item value;
-  } OIDKeyValue;
-
-  static const SecAsn1Template kOIDValueTemplate[] = {
-      {SEC_ASN1_SEQUENCE, 0, NULL, sizeof(OIDKeyValue)},
-      {SEC_ASN1_OBJECT_ID, offsetof(OIDKeyValue, oid), NULL, 0},
-      {SEC_ASN1_ANY_CONTENTS, offsetof(OIDKeyValue, value), NULL, 0},
-      {0, 0, NULL, 0}};
-
-  typedef struct {
-    OIDKeyValue** vals;
-  } OIDKeyValueList;
-
-  static const SecAsn1Template kSetOfOIDValueTemplate[] = {
-      {SEC_ASN1_SET_OF, 0, kOIDValueTemplate, sizeof(OIDKeyValueList)}, {0, 0, NULL, 0}};
-
-  typedef struct {
-    OIDKeyValueList** lists;
-  } OIDKeyValueListSeq;
-
-  static const SecAsn1Template kSequenceOfSetOfOIDValueTemplate[] = {
-      {SEC_ASN1_SEQUENCE_OF, 0, kSetOfOIDValueTemplate, sizeof(OIDKeyValueListSeq)},
-      {0, 0, NULL, 0}};
-
-  OSStatus err = errSecSuccess;
-  SecAsn1CoderRef coder;
-
-  err = SecAsn1CoderCreate(&coder);
-  if (err != errSecSuccess) return nil;
-
-  OIDKeyValueListSeq a;
-  err = SecAsn1Decode(coder, data.bytes, data.length, kSequenceOfSetOfOIDValueTemplate, &a);
-  if (err != errSecSuccess) {
-    SecAsn1CoderRelease(coder);
-    return nil;
-  }
-
-  // The data is decoded but now it's in a number of embedded structs.
-  // Massage that into a nice dictionary of OID->String pairs.
-  NSMutableDictionary* dict = [NSMutableDictionary dictionary];
-  OIDKeyValueList* anAttr;
-  for (NSUInteger i = 0; (anAttr = a.lists[i]); ++i) {
-    OIDKeyValue* keyValue = anAttr->vals[0];
-
-    // Sanity check
-    if (keyValue->value.Length > data.length) {
-      SecAsn1CoderRelease(coder);
-      return nil;
-    }
-
-    // Get the string value. First try creating as a UTF-8 string. If that fails,
-    // fallback to trying as an ASCII string. If it still doesn't work, continue on
-    // to the next value.
-    NSString* valueString;
-    valueString = [[NSString alloc] initWithBytes:keyValue->value.Data
-                                           length:keyValue->value.Length
-                                         encoding:NSUTF8StringEncoding];
-    if (!valueString) {
-      valueString = [[NSString alloc] initWithBytes:keyValue->value.Data
-                                             length:keyValue->value.Length
-                                           encoding:NSASCIIStringEncoding];
-    }
-    if (!valueString) continue;
-
-    // The OID is still encoded, so we need to decode it.
-    NSString* objectId = [MOLDERDecoder decodeOIDWithBytes:keyValue->oid.Data
-                                                    length:keyValue->oid.Length];
-
-    // Add to the dictionary
-    dict[objectId] = valueString;
-  }
-
-  SecAsn1CoderRelease(coder);
-  return dict;
-#pragma clang diagnostic pop
+- (NSString*)valueForOID:(std::span<const uint8_t>)wantOID {
+  NSString* result;
+  ForEachAttribute([self derBytes],
+                   [&](std::span<const uint8_t> oid, std::span<const uint8_t> value) {
+                     if (std::equal(oid.begin(), oid.end(), wantOID.begin(), wantOID.end())) {
+                       NSString* str = StringFromValue(value);
+                       if (str) result = str;
+                     }
+                     return true;
+                   });
+  return result;
 }
 
 /**
@@ -13,6 +13,7 @@
 /// See the License for the specific language governing permissions and
 /// limitations under the License.
 
+#import <Security/Security.h>
 #import <XCTest/XCTest.h>
 
 #import "Source/common/MOLCertificate.h"
@@ -38,6 +39,77 @@
   XCTAssertEqualObjects(sut.countryName, @"US");
 }
 
+- (void)testMalformedData {
+  NSString* file = [[NSBundle bundleForClass:[self class]] pathForResource:@"dn" ofType:@"plist"];
+  NSData* dn = [[NSArray arrayWithContentsOfFile:file] firstObject];
+
+  XCTAssertNil([[MOLDERDecoder alloc] initWithData:[NSData data]]);
+  XCTAssertNil([[MOLDERDecoder alloc] initWithData:[dn subdataWithRange:NSMakeRange(0, 1)]]);
+  XCTAssertNil([[MOLDERDecoder alloc]
+      initWithData:[dn subdataWithRange:NSMakeRange(0, dn.length - 1)]]);
+
+  // A well-formed but empty Name has nothing to decode
+  const uint8_t emptyName[] = {0x30, 0x00};
+  XCTAssertNil([[MOLDERDecoder alloc] initWithData:[NSData dataWithBytes:emptyName
+                                                                  length:sizeof(emptyName)]]);
+
+  // Lengths running past the end of the data are rejected
+  const uint8_t badLength[] = {0x30, 0x84, 0xFF, 0xFF, 0xFF, 0xFF, 0x31, 0x00};
+  XCTAssertNil([[MOLDERDecoder alloc] initWithData:[NSData dataWithBytes:badLength
+                                                                  length:sizeof(badLength)]]);
+}
+
+- (void)testCertificateNames {
+  for (NSString* name in @[ @"example_org_client_cert", @"internet_widgits_client_cert" ]) {
+    NSString* file = [[NSBundle bundleForClass:[self class]] pathForResource:name ofType:@"pem"];
+    NSString* pem = [NSString stringWithContentsOfFile:file
+                                              encoding:NSUTF8StringEncoding
+                                                 error:nil];
+    MOLCertificate* cert = [[MOLCertificate alloc] initWithCertificateDataPEM:pem];
+    XCTAssertNotNil(cert);
+
+    NSData* issuer = CFBridgingRelease(SecCertificateCopyNormalizedIssuerSequence(cert.certRef));
+    MOLDERDecoder* sut = [[MOLDERDecoder alloc] initWithData:issuer];
+    XCTAssertNotNil(sut);
+
+    // Normalized sequences are case folded
+    XCTAssertEqual([sut.commonName caseInsensitiveCompare:cert.issuerCommonName], NSOrderedSame);
+    XCTAssertEqual([sut.countryName caseInsensitiveCompare:cert.issuerCountryName], NSOrderedSame);
+  }
+}
+
+- (void)testDecodingPerformance {
+  NSMutableArray<NSData*>* names = [NSMutableArray array];
+  NSString* file = [[NSBundle bundleForClass:[self class]] pathForResource:@"dn" ofType:@"plist"];
+  [names addObjectsFromArray:[NSArray arrayWithContentsOfFile:file]];
+
+  for (NSString* name in @[
+         @"example_org_client_cert", @"example_org_client_cert_old", @"internet_widgits_client_cert"
+       ]) {
+    file = [[NSBundle bundleForClass:[self class]] pathForResource:name ofType:@"pem"];
+    NSString* pem = [NSString stringWithContentsOfFile:file
+                                              encoding:NSUTF8StringEncoding
+                                                 error:nil];
+    for (MOLCertificate* cert in [MOLCertificate certificatesFromPEM:pem]) {
+      SecCertificateRef ref = cert.certRef;
+      [names addObject:CFBridgingRelease(SecCertificateCopyNormalizedSubjectSequence(ref))];
+      [names addObject:CFBridgingRelease(SecCertificateCopyNormalizedIssuerSequence(ref))];
+    }
+  }
+  XCTAssertGreaterThan(names.count, 1);
+
+  [self measureBlock:^{
+    NSUInteger decoded = 0;
+    for (int i = 0; i < 10000; i++) {
+      for (NSData* dn in names) {
+        MOLDERDecoder* sut = [[MOLDERDecoder alloc] initWithData:dn];
+        decoded += (sut.commonName != nil);
+      }
+    }
+    XCTAssertGreaterThan(decoded, 0);
+  }];
+}
+
 - (void)testOIDDecoding {
   unsigned char oidBytes1[] = {0x2b, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x15, 0x14};
   NSString* oidStr = [MOLDERDecoder decodeOIDWithBytes:oidBytes1 length:sizeof(oidBytes1)];
@@ -0,0 +1,99 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_MPSCQUEUE_H
+#define SANTA_COMMON_MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace santa {
+
+// Unbounded lock-free multi-producer single-consumer queue.
+//
+// Producers push onto an intrusive stack with a single CAS. The consumer
+// takes the whole stack with one exchange and reverses it, so values are
+// drained in the order they were pushed. Push reports whether the queue was
+// empty, letting producers schedule a single consumer wakeup per burst
+// instead of one per value.
+template <typename T>
+class MPSCQueue {
+ public:
+  MPSCQueue() = default;
+
+  ~MPSCQueue() {
+    Drain([](T&&) {});
+  }
+
+  MPSCQueue(MPSCQueue&& other) = delete;
+  MPSCQueue& operator=(MPSCQueue&& rhs) = delete;
+  MPSCQueue(const MPSCQueue& other) = delete;
+  MPSCQueue& operator=(const MPSCQueue& other) = delete;
+
+  // Safe to call from any thread. Returns true if the queue was empty, in
+  // which case the caller is responsible for arranging a call to Drain.
+  bool Push(T value) {
+    Node* node =
+        new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+    while (!head_.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+    return node->next == nullptr;
+  }
+
+  // Must only be called by one thread at a time. Passes every value pushed
+  // before the call to `f` in push order and returns the number drained.
+  template <typename F>
+  size_t Drain(F&& f) {
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+
+    // Reverse the stack into push order
+    Node* ordered = nullptr;
+    while (node) {
+      Node* next = node->next;
+      node->next = ordered;
+      ordered = node;
+      node = next;
+    }
+
+    size_t count = 0;
+    while (ordered) {
+      Node* next = ordered->next;
+      f(std::move(ordered->value));
+      delete ordered;
+      ordered = next;
+      count++;
+    }
+    return count;
+  }
+
+  bool Empty() const {
+    return head_.load(std::memory_order_relaxed) == nullptr;
+  }
+
+ private:
+  struct Node {
+    T value;
+    Node* next;
+  };
+
+  std::atomic<Node*> head_{nullptr};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_MPSCQUEUE_H
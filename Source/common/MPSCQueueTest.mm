@@ -0,0 +1,98 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/MPSCQueue.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <memory>
+#include <vector>
+
+using santa::MPSCQueue;
+
+@interface MPSCQueueTest : XCTestCase
+@end
+
+@implementation MPSCQueueTest
+
+- (void)testPushReportsEmpty {
+  MPSCQueue<int> sut;
+  XCTAssertTrue(sut.Empty());
+  XCTAssertTrue(sut.Push(1));
+  XCTAssertFalse(sut.Push(2));
+  XCTAssertFalse(sut.Empty());
+
+  XCTAssertEqual(sut.Drain([](int&&) {}), 2);
+  XCTAssertTrue(sut.Empty());
+  XCTAssertEqual(sut.Drain([](int&&) {}), 0);
+
+  // The queue is empty again after draining
+  XCTAssertTrue(sut.Push(3));
+}
+
+- (void)testDrainPreservesOrder {
+  MPSCQueue<std::unique_ptr<int>> sut;
+  for (int i = 0; i < 100; i++) {
+    sut.Push(std::make_unique<int>(i));
+  }
+
+  std::vector<int> got;
+  sut.Drain([&got](std::unique_ptr<int>&& val) {
+    got.push_back(*val);
+  });
+
+  XCTAssertEqual(got.size(), 100);
+  for (int i = 0; i < 100; i++) {
+    XCTAssertEqual(got[i], i);
+  }
+}
+
+- (void)testConcurrentProducers {
+  constexpr int kProducers = 8;
+  constexpr int kPerProducer = 10000;
+  auto sut = std::make_shared<MPSCQueue<std::pair<int, int>>>();
+
+  // Drain while producers are still pushing
+  __block std::vector<int> lastSeen(kProducers, -1);
+  __block int total = 0;
+  __block bool inOrder = true;
+  auto drain = ^{
+    total += sut->Drain([&](std::pair<int, int>&& val) {
+      inOrder &= (val.second == lastSeen[val.first] + 1);
+      lastSeen[val.first] = val.second;
+    });
+  };
+
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    dispatch_apply(kProducers, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t p) {
+      for (int i = 0; i < kPerProducer; i++) {
+        sut->Push({(int)p, i});
+      }
+    });
+  });
+
+  while (dispatch_group_wait(group, DISPATCH_TIME_NOW) != 0) {
+    drain();
+  }
+  drain();
+
+  XCTAssertEqual(total, kProducers * kPerProducer);
+  XCTAssertTrue(inOrder);
+  XCTAssertTrue(sut->Empty());
+}
+
+@end
@@ -15,8 +15,14 @@
 #ifndef SANTA_COMMON_MEMOIZER_H
 #define SANTA_COMMON_MEMOIZER_H
 
+#include <cstdint>
 #include <functional>
 #include <optional>
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 
 namespace santa {
 
@@ -32,14 +38,12 @@ class Memoizer {
   // Mark this as const to allow it to be called from const methods. It
   // technically isn't const given that cache_ is updated but we mark that field
   // as mutable.
-  T operator()() const {
-    if (cache_.has_value()) {
-      return *cache_;
+  // The returned reference remains valid for the lifetime of the Memoizer.
+  const T& operator()() const {
+    if (!cache_.has_value()) {
+      cache_ = func_();
     }
-
-    T result = func_();
-    cache_ = result;
-    return result;
+    return *cache_;
   }
 
   bool HasValue() const { return cache_.has_value(); }
@@ -49,6 +53,91 @@ class Memoizer {
   mutable std::optional<T> cache_;
 };
 
+// ConcurrentMemoizer memoizes the result of a function call that requires no
+// arguments for up to `ttl`, and is safe to call from any thread.
+//
+// Calls are single flight: when the value is missing or expired, one caller
+// computes it and concurrent callers wait for that result instead of computing
+// it themselves. Invalidate drops the cached value so that the next call
+// recomputes it. A computation that is running when Invalidate is called
+// still returns its result to its callers, but the result isn't cached.
+template <typename T>
+class ConcurrentMemoizer {
+ public:
+  ConcurrentMemoizer(std::function<T()> func,
+                     absl::Duration ttl = absl::InfiniteDuration(),
+                     std::function<absl::Time()> now = absl::Now)
+      : func_(std::move(func)), ttl_(ttl), now_(std::move(now)) {}
+
+  ConcurrentMemoizer(ConcurrentMemoizer&& other) = delete;
+  ConcurrentMemoizer& operator=(ConcurrentMemoizer&& rhs) = delete;
+  ConcurrentMemoizer(const ConcurrentMemoizer& other) = delete;
+  ConcurrentMemoizer& operator=(const ConcurrentMemoizer& other) = delete;
+
+  // Returns a copy, since another thread may replace the cached value at any
+  // time
+  T operator()() const {
+    {
+      absl::ReaderMutexLock lock(&mtx_);
+      if (cache_.has_value() && now_() < expires_) {
+        return *cache_;
+      }
+    }
+
+    uint64_t generation;
+    {
+      absl::MutexLock lock(&mtx_);
+      while (true) {
+        if (cache_.has_value() && now_() < expires_) {
+          return *cache_;
+        }
+        if (!computing_) break;
+        computed_.Wait(&mtx_);
+      }
+      computing_ = true;
+      generation = generation_;
+    }
+
+    T value = func_();
+
+    absl::MutexLock lock(&mtx_);
+    computing_ = false;
+    computed_.SignalAll();
+    if (generation == generation_) {
+      cache_ = value;
+      expires_ = ttl_ == absl::InfiniteDuration() ? absl::InfiniteFuture()
+                                                  : now_() + ttl_;
+    } else {
+      // Invalidated while computing, callers that were waiting will retry
+      cache_.reset();
+    }
+    return value;
+  }
+
+  void Invalidate() {
+    absl::MutexLock lock(&mtx_);
+    cache_.reset();
+    generation_++;
+  }
+
+  bool HasValue() const {
+    absl::ReaderMutexLock lock(&mtx_);
+    return cache_.has_value() && now_() < expires_;
+  }
+
+ private:
+  std::function<T()> func_;
+  absl::Duration ttl_;
+  std::function<absl::Time()> now_;
+
+  mutable absl::Mutex mtx_;
+  mutable absl::CondVar computed_;
+  mutable std::optional<T> cache_ ABSL_GUARDED_BY(mtx_);
+  mutable absl::Time expires_ ABSL_GUARDED_BY(mtx_);
+  mutable bool computing_ ABSL_GUARDED_BY(mtx_) = false;
+  uint64_t generation_ ABSL_GUARDED_BY(mtx_) = 0;
+};
+
 }  // namespace santa
 
 #endif  // SANTA_COMMON_MEMOIZER_H
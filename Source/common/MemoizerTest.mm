@@ -0,0 +1,104 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/Memoizer.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <memory>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+using santa::ConcurrentMemoizer;
+using santa::Memoizer;
+
+@interface MemoizerTest : XCTestCase
+@end
+
+@implementation MemoizerTest
+
+- (void)testMemoizer {
+  int calls = 0;
+  Memoizer<int> sut([&calls] { return ++calls; });
+  XCTAssertFalse(sut.HasValue());
+  XCTAssertEqual(sut(), 1);
+  XCTAssertEqual(sut(), 1);
+  XCTAssertTrue(sut.HasValue());
+  XCTAssertEqual(calls, 1);
+}
+
+- (void)testConcurrentMemoizerTTL {
+  int calls = 0;
+  absl::Time now = absl::UnixEpoch();
+  ConcurrentMemoizer<int> sut([&calls] { return ++calls; }, absl::Seconds(10),
+                              [&now] { return now; });
+
+  XCTAssertFalse(sut.HasValue());
+  XCTAssertEqual(sut(), 1);
+  XCTAssertTrue(sut.HasValue());
+
+  now += absl::Seconds(9);
+  XCTAssertEqual(sut(), 1);
+
+  // Expired values are recomputed
+  now += absl::Seconds(1);
+  XCTAssertFalse(sut.HasValue());
+  XCTAssertEqual(sut(), 2);
+  XCTAssertEqual(sut(), 2);
+}
+
+- (void)testConcurrentMemoizerInvalidate {
+  int calls = 0;
+  ConcurrentMemoizer<int> sut([&calls] { return ++calls; });
+
+  XCTAssertEqual(sut(), 1);
+  XCTAssertEqual(sut(), 1);
+
+  sut.Invalidate();
+  XCTAssertFalse(sut.HasValue());
+  XCTAssertEqual(sut(), 2);
+  XCTAssertEqual(sut(), 2);
+}
+
+- (void)testConcurrentMemoizerSingleFlight {
+  auto calls = std::make_shared<std::atomic<int>>(0);
+  auto release = std::make_shared<absl::Notification>();
+  auto sut = std::make_shared<ConcurrentMemoizer<int>>([calls, release] {
+    release->WaitForNotification();
+    return ++(*calls);
+  });
+
+  // All callers block on the first computation rather than starting their own
+  dispatch_group_t group = dispatch_group_create();
+  auto results = std::make_shared<std::atomic<int>>(0);
+  for (int i = 0; i < 8; i++) {
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+      results->fetch_add((*sut)());
+    });
+  }
+
+  usleep(50000);
+  release->Notify();
+  XCTAssertEqual(
+      dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+
+  XCTAssertEqual(calls->load(), 1);
+  XCTAssertEqual(results->load(), 8);
+}
+
+@end
@@ -0,0 +1,111 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_MEMORYACCOUNTING_H
+#define SANTA_COMMON_MEMORYACCOUNTING_H
+
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Tracks the approximate heap usage of the process's large structures, and
+// optionally shrinks them when the system is under memory pressure.
+//
+// Sizes are reported by each structure and are estimates. They cover the
+// structure's own allocations but usually not memory that keys or values
+// share with other structures.
+class MemoryAccounting {
+ public:
+  // When a structure is shrunk under memory pressure. Structures are shrunk
+  // in level order, then in the order they were registered.
+  enum class ShrinkLevel {
+    // Shrunk as soon as pressure is reported. For structures that are cheap
+    // to rebuild on demand.
+    kWarning,
+    // Shrunk only once pressure is critical. For structures whose loss costs
+    // extra work on hot paths until they are rebuilt.
+    kCritical,
+  };
+
+  using BytesFunction = std::function<size_t()>;
+  using ShrinkFunction = std::function<void()>;
+
+  struct Stats {
+    uint64_t warning_events = 0;
+    uint64_t critical_events = 0;
+  };
+
+  static MemoryAccounting& Shared();
+
+  MemoryAccounting() = default;
+
+  MemoryAccounting(MemoryAccounting&& other) = delete;
+  MemoryAccounting& operator=(MemoryAccounting&& rhs) = delete;
+  MemoryAccounting(const MemoryAccounting& other) = delete;
+  MemoryAccounting& operator=(const MemoryAccounting& other) = delete;
+
+  // Report `bytes` under `name`. Registering a name again replaces it. The
+  // functions may be called from any thread.
+  void Register(std::string name, BytesFunction bytes);
+  void Register(std::string name, BytesFunction bytes, ShrinkLevel level,
+                ShrinkFunction shrink);
+
+  // The approximate size of each registered structure, in registration order
+  std::vector<std::pair<std::string, size_t>> Usage();
+
+  // Shrink every structure registered at `level` or below. Returns the
+  // number of structures shrunk.
+  size_t Shrink(ShrinkLevel level);
+
+  // Shrink structures whenever the system reports memory pressure from now
+  // on. Has no effect after the first call.
+  void EnableMemoryPressureHandler();
+
+  // Counts of memory pressure events handled since the last reset
+  Stats GetStats(bool reset);
+
+ private:
+  struct Entry {
+    std::string name;
+    BytesFunction bytes;
+    std::optional<ShrinkLevel> level;
+    ShrinkFunction shrink;
+  };
+
+  void Add(Entry entry);
+
+  absl::Mutex lock_;
+  std::vector<Entry> entries_ ABSL_GUARDED_BY(lock_);
+
+  std::atomic<bool> pressure_handler_enabled_{false};
+  dispatch_source_t pressure_source_;
+  std::atomic<uint64_t> warning_events_{0};
+  std::atomic<uint64_t> critical_events_{0};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_MEMORYACCOUNTING_H
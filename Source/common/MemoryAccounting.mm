@@ -0,0 +1,132 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/MemoryAccounting.h"
+
+#include <algorithm>
+
+#import "Source/common/SNTLogging.h"
+
+namespace santa {
+
+MemoryAccounting& MemoryAccounting::Shared() {
+  static MemoryAccounting* shared = new MemoryAccounting();
+  return *shared;
+}
+
+void MemoryAccounting::Register(std::string name, BytesFunction bytes) {
+  Add({.name = std::move(name), .bytes = std::move(bytes)});
+}
+
+void MemoryAccounting::Register(std::string name, BytesFunction bytes, ShrinkLevel level,
+                                ShrinkFunction shrink) {
+  Add({
+      .name = std::move(name),
+      .bytes = std::move(bytes),
+      .level = level,
+      .shrink = std::move(shrink),
+  });
+}
+
+void MemoryAccounting::Add(Entry entry) {
+  absl::MutexLock lock(lock_);
+  for (Entry& existing : entries_) {
+    if (existing.name == entry.name) {
+      existing = std::move(entry);
+      return;
+    }
+  }
+  entries_.push_back(std::move(entry));
+}
+
+std::vector<std::pair<std::string, size_t>> MemoryAccounting::Usage() {
+  // Structures are measured without the lock held so that a slow measurement
+  // doesn't hold up registration
+  std::vector<Entry> entries;
+  {
+    absl::MutexLock lock(lock_);
+    entries = entries_;
+  }
+
+  std::vector<std::pair<std::string, size_t>> usage;
+  usage.reserve(entries.size());
+  for (const Entry& entry : entries) {
+    usage.emplace_back(entry.name, entry.bytes ? entry.bytes() : 0);
+  }
+  return usage;
+}
+
+size_t MemoryAccounting::Shrink(ShrinkLevel level) {
+  std::vector<Entry> entries;
+  {
+    absl::MutexLock lock(lock_);
+    entries = entries_;
+  }
+
+  std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    return a.level < b.level;
+  });
+
+  size_t shrunk = 0;
+  for (const Entry& entry : entries) {
+    if (!entry.level.has_value() || !entry.shrink || *entry.level > level) {
+      continue;
+    }
+    entry.shrink();
+    shrunk++;
+  }
+  return shrunk;
+}
+
+void MemoryAccounting::EnableMemoryPressureHandler() {
+  if (pressure_handler_enabled_.exchange(true)) {
+    return;
+  }
+
+  dispatch_queue_t q = dispatch_queue_create(
+      "com.northpolesec.santa.memory_pressure",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+  pressure_source_ =
+      dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                             DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, q);
+
+  dispatch_source_t source = pressure_source_;
+  dispatch_source_set_event_handler(pressure_source_, ^{
+    unsigned long pressure = dispatch_source_get_data(source);
+    if (pressure & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+      critical_events_.fetch_add(1, std::memory_order_relaxed);
+      size_t shrunk = Shrink(ShrinkLevel::kCritical);
+      LOGW(@"Critical memory pressure, shrank %zu structures", shrunk);
+    } else if (pressure & DISPATCH_MEMORYPRESSURE_WARN) {
+      warning_events_.fetch_add(1, std::memory_order_relaxed);
+      size_t shrunk = Shrink(ShrinkLevel::kWarning);
+      LOGI(@"Memory pressure warning, shrank %zu structures", shrunk);
+    }
+  });
+  dispatch_resume(pressure_source_);
+}
+
+MemoryAccounting::Stats MemoryAccounting::GetStats(bool reset) {
+  auto read = [reset](std::atomic<uint64_t>& counter) {
+    return reset ? counter.exchange(0, std::memory_order_relaxed)
+                 : counter.load(std::memory_order_relaxed);
+  };
+  return Stats{
+      .warning_events = read(warning_events_),
+      .critical_events = read(critical_events_),
+  };
+}
+
+}  // namespace santa
@@ -0,0 +1,73 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/MemoryAccounting.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using santa::MemoryAccounting;
+
+@interface MemoryAccountingTest : XCTestCase
+@end
+
+@implementation MemoryAccountingTest
+
+- (void)testUsage {
+  auto sut = std::make_unique<MemoryAccounting>();
+  XCTAssertTrue(sut->Usage().empty());
+
+  sut->Register("a", [] { return 100; });
+  sut->Register("b", [] { return 200; });
+
+  std::vector<std::pair<std::string, size_t>> want = {{"a", 100}, {"b", 200}};
+  XCTAssertTrue(sut->Usage() == want);
+
+  // Registering a name again replaces it in place
+  sut->Register("a", [] { return 300; });
+  want = {{"a", 300}, {"b", 200}};
+  XCTAssertTrue(sut->Usage() == want);
+}
+
+- (void)testShrinkOrder {
+  auto sut = std::make_unique<MemoryAccounting>();
+  auto order = std::make_shared<std::vector<std::string>>();
+
+  auto shrinker = [order](std::string name) {
+    return [order, name] { order->push_back(name); };
+  };
+  auto bytes = [] { return 0; };
+
+  sut->Register("critical", bytes, MemoryAccounting::ShrinkLevel::kCritical, shrinker("critical"));
+  sut->Register("warning1", bytes, MemoryAccounting::ShrinkLevel::kWarning, shrinker("warning1"));
+  sut->Register("unshrinkable", bytes);
+  sut->Register("warning2", bytes, MemoryAccounting::ShrinkLevel::kWarning, shrinker("warning2"));
+
+  XCTAssertEqual(sut->Shrink(MemoryAccounting::ShrinkLevel::kWarning), 2);
+  std::vector<std::string> want = {"warning1", "warning2"};
+  XCTAssertTrue(*order == want);
+
+  // Critical pressure shrinks everything, cheapest first
+  order->clear();
+  XCTAssertEqual(sut->Shrink(MemoryAccounting::ShrinkLevel::kCritical), 3);
+  want = {"warning1", "warning2", "critical"};
+  XCTAssertTrue(*order == want);
+}
+
+@end
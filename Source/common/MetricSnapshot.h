@@ -0,0 +1,120 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_METRICSNAPSHOT_H
+#define SANTA_COMMON_METRICSNAPSHOT_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace santa {
+
+// Name of the shared memory object santad publishes metric snapshots to
+inline constexpr char kMetricSnapshotName[] = "/com.northpolesec.santa.mtr";
+
+// Fixed layout at the start of the shared memory region. The payload follows
+// the header. Readers must check the magic and version before trusting any
+// other field.
+//
+// The payload is guarded by a seqlock: `sequence` is odd while the single
+// writer is updating the region, and readers retry until they see the same
+// even sequence before and after copying.
+struct MetricSnapshotHeader {
+  static constexpr uint32_t kMagic = 0x4d544e53;  // "SNTM"
+  static constexpr uint32_t kVersion = 1;
+
+  uint32_t magic;
+  uint32_t version;
+  // Bytes available for the payload
+  uint64_t capacity;
+  // How often the writer publishes, so readers can tell a stale snapshot
+  uint64_t interval_ns;
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> length;
+  // Wall clock time of the last publish, in nanoseconds since the epoch
+  std::atomic<int64_t> published_at_ns;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Shared memory seqlock requires lock free atomics");
+
+struct MetricSnapshot {
+  std::vector<uint8_t> payload;
+  int64_t published_at_ns;
+  uint64_t interval_ns;
+};
+
+// Owns the shared memory region. Only one writer may exist for a name.
+class MetricSnapshotWriter {
+ public:
+  // Replaces any existing object with the given name. The region is readable
+  // by all users.
+  static std::unique_ptr<MetricSnapshotWriter> Create(const char* name,
+                                                      size_t capacity,
+                                                      uint64_t interval_ns);
+
+  MetricSnapshotWriter(const char* name, MetricSnapshotHeader* header,
+                       size_t mapped_size);
+  ~MetricSnapshotWriter();
+
+  MetricSnapshotWriter(MetricSnapshotWriter&& other) = delete;
+  MetricSnapshotWriter& operator=(MetricSnapshotWriter&& rhs) = delete;
+  MetricSnapshotWriter(const MetricSnapshotWriter& other) = delete;
+  MetricSnapshotWriter& operator=(const MetricSnapshotWriter& other) = delete;
+
+  // Returns false if the payload doesn't fit. The region is then left
+  // empty so that readers don't show an outdated snapshot.
+  bool Publish(const void* payload, size_t length, int64_t published_at_ns);
+
+ private:
+  std::string name_;
+  MetricSnapshotHeader* header_;
+  size_t mapped_size_;
+};
+
+class MetricSnapshotReader {
+ public:
+  // Returns nullptr if the region doesn't exist, isn't owned by
+  // `expected_owner`, or has an unknown layout version
+  static std::unique_ptr<MetricSnapshotReader> Open(const char* name,
+                                                    uid_t expected_owner);
+
+  MetricSnapshotReader(const MetricSnapshotHeader* header, size_t mapped_size);
+  ~MetricSnapshotReader();
+
+  MetricSnapshotReader(MetricSnapshotReader&& other) = delete;
+  MetricSnapshotReader& operator=(MetricSnapshotReader&& rhs) = delete;
+  MetricSnapshotReader(const MetricSnapshotReader& other) = delete;
+  MetricSnapshotReader& operator=(const MetricSnapshotReader& other) = delete;
+
+  // Returns a consistent copy of the latest snapshot, or nullopt if nothing
+  // has been published or the writer kept racing with the read
+  std::optional<MetricSnapshot> Read() const;
+
+ private:
+  const MetricSnapshotHeader* header_;
+  size_t mapped_size_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_METRICSNAPSHOT_H
@@ -0,0 +1,179 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/MetricSnapshot.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <new>
+
+namespace santa {
+
+namespace {
+
+// Bounds how long a reader spins if the writer keeps publishing
+constexpr int kMaxReadAttempts = 100;
+
+uint8_t* PayloadStart(MetricSnapshotHeader* header) {
+  return reinterpret_cast<uint8_t*>(header + 1);
+}
+
+const uint8_t* PayloadStart(const MetricSnapshotHeader* header) {
+  return reinterpret_cast<const uint8_t*>(header + 1);
+}
+
+}  // namespace
+
+std::unique_ptr<MetricSnapshotWriter> MetricSnapshotWriter::Create(const char* name,
+                                                                   size_t capacity,
+                                                                   uint64_t interval_ns) {
+  // Start from a fresh object so that no other process can hold a writable
+  // mapping of it
+  shm_unlink(name);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  size_t mapped_size = sizeof(MetricSnapshotHeader) + capacity;
+  void* addr = MAP_FAILED;
+  if (fchmod(fd, 0644) == 0 && ftruncate(fd, mapped_size) == 0) {
+    addr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if (addr == MAP_FAILED) {
+    shm_unlink(name);
+    return nullptr;
+  }
+
+  MetricSnapshotHeader* header = new (addr) MetricSnapshotHeader();
+  header->capacity = capacity;
+  header->interval_ns = interval_ns;
+  header->version = MetricSnapshotHeader::kVersion;
+  // The magic is written last so readers never see a partially set up header
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = MetricSnapshotHeader::kMagic;
+
+  return std::make_unique<MetricSnapshotWriter>(name, header, mapped_size);
+}
+
+MetricSnapshotWriter::MetricSnapshotWriter(const char* name, MetricSnapshotHeader* header,
+                                           size_t mapped_size)
+    : name_(name), header_(header), mapped_size_(mapped_size) {}
+
+MetricSnapshotWriter::~MetricSnapshotWriter() {
+  munmap(header_, mapped_size_);
+  shm_unlink(name_.c_str());
+}
+
+bool MetricSnapshotWriter::Publish(const void* payload, size_t length, int64_t published_at_ns) {
+  bool fits = length <= header_->capacity;
+
+  uint64_t seq = header_->sequence.load(std::memory_order_relaxed);
+  header_->sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (fits) {
+    memcpy(PayloadStart(header_), payload, length);
+  }
+  header_->length.store(fits ? length : 0, std::memory_order_relaxed);
+  header_->published_at_ns.store(published_at_ns, std::memory_order_relaxed);
+
+  header_->sequence.store(seq + 2, std::memory_order_release);
+  return fits;
+}
+
+std::unique_ptr<MetricSnapshotReader> MetricSnapshotReader::Open(const char* name,
+                                                                 uid_t expected_owner) {
+  int fd = shm_open(name, O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat sb;
+  void* addr = MAP_FAILED;
+  size_t mapped_size = 0;
+  if (fstat(fd, &sb) == 0 && sb.st_uid == expected_owner &&
+      sb.st_size >= (off_t)sizeof(MetricSnapshotHeader)) {
+    mapped_size = (size_t)sb.st_size;
+    addr = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+
+  const MetricSnapshotHeader* header = static_cast<const MetricSnapshotHeader*>(addr);
+  if (header->magic != MetricSnapshotHeader::kMagic ||
+      header->version != MetricSnapshotHeader::kVersion ||
+      header->capacity > mapped_size - sizeof(MetricSnapshotHeader)) {
+    munmap(addr, mapped_size);
+    return nullptr;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  return std::make_unique<MetricSnapshotReader>(header, mapped_size);
+}
+
+MetricSnapshotReader::MetricSnapshotReader(const MetricSnapshotHeader* header,
+                                           size_t mapped_size)
+    : header_(header), mapped_size_(mapped_size) {}
+
+MetricSnapshotReader::~MetricSnapshotReader() {
+  munmap(const_cast<MetricSnapshotHeader*>(header_), mapped_size_);
+}
+
+std::optional<MetricSnapshot> MetricSnapshotReader::Read() const {
+  MetricSnapshot snapshot;
+  snapshot.interval_ns = header_->interval_ns;
+
+  for (int attempt = 0; attempt < kMaxReadAttempts; attempt++) {
+    uint64_t seq = header_->sequence.load(std::memory_order_acquire);
+    if (seq & 1) {
+      sched_yield();
+      continue;
+    }
+
+    uint64_t length = header_->length.load(std::memory_order_relaxed);
+    if (length > header_->capacity) {
+      // Only possible mid-write, the sequence check below would fail anyway
+      continue;
+    }
+    snapshot.payload.assign(PayloadStart(header_), PayloadStart(header_) + length);
+    snapshot.published_at_ns = header_->published_at_ns.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->sequence.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+
+    // Nothing published yet, or the last snapshot didn't fit
+    if (seq == 0 || length == 0) {
+      return std::nullopt;
+    }
+    return snapshot;
+  }
+
+  return std::nullopt;
+}
+
+}  // namespace santa
@@ -0,0 +1,119 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/MetricSnapshot.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+using santa::MetricSnapshot;
+using santa::MetricSnapshotReader;
+using santa::MetricSnapshotWriter;
+
+@interface MetricSnapshotTest : XCTestCase
+@end
+
+@implementation MetricSnapshotTest {
+  std::string _name;
+}
+
+- (void)setUp {
+  _name = "/santa.mst." + std::to_string(getpid());
+}
+
+- (void)testPublishAndRead {
+  auto writer = MetricSnapshotWriter::Create(_name.c_str(), 64, 5 * NSEC_PER_SEC);
+  XCTAssertNotEqual(writer.get(), nullptr);
+
+  auto reader = MetricSnapshotReader::Open(_name.c_str(), getuid());
+  XCTAssertNotEqual(reader.get(), nullptr);
+
+  // Nothing has been published yet
+  XCTAssertFalse(reader->Read().has_value());
+
+  std::string payload = "hello";
+  XCTAssertTrue(writer->Publish(payload.data(), payload.size(), 1234));
+
+  std::optional<MetricSnapshot> snapshot = reader->Read();
+  XCTAssertTrue(snapshot.has_value());
+  XCTAssertEqual(std::string(snapshot->payload.begin(), snapshot->payload.end()), payload);
+  XCTAssertEqual(snapshot->published_at_ns, 1234);
+  XCTAssertEqual(snapshot->interval_ns, 5 * NSEC_PER_SEC);
+
+  // Payloads that don't fit clear the region
+  std::string tooLarge(65, 'x');
+  XCTAssertFalse(writer->Publish(tooLarge.data(), tooLarge.size(), 5678));
+  XCTAssertFalse(reader->Read().has_value());
+}
+
+- (void)testOpenChecksOwner {
+  auto writer = MetricSnapshotWriter::Create(_name.c_str(), 64, NSEC_PER_SEC);
+  XCTAssertNotEqual(writer.get(), nullptr);
+
+  XCTAssertEqual(MetricSnapshotReader::Open(_name.c_str(), getuid() + 1).get(), nullptr);
+  XCTAssertEqual(MetricSnapshotReader::Open("/santa.mst.missing", getuid()).get(), nullptr);
+
+  // The region is removed along with the writer
+  writer.reset();
+  XCTAssertEqual(MetricSnapshotReader::Open(_name.c_str(), getuid()).get(), nullptr);
+}
+
+- (void)testConsistentReads {
+  constexpr size_t kPayloadSize = 4096;
+  auto writer = MetricSnapshotWriter::Create(_name.c_str(), kPayloadSize, NSEC_PER_SEC);
+  auto reader = MetricSnapshotReader::Open(_name.c_str(), getuid());
+  XCTAssertNotEqual(writer.get(), nullptr);
+  XCTAssertNotEqual(reader.get(), nullptr);
+
+  std::vector<uint8_t> payload(kPayloadSize, 0);
+  XCTAssertTrue(writer->Publish(payload.data(), payload.size(), 0));
+
+  // Every published payload is uniform, so a torn read would mix values
+  std::atomic<bool> done{false};
+  std::atomic<bool>* donePtr = &done;
+  MetricSnapshotReader* rawReader = reader.get();
+  __block bool torn = false;
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    while (!donePtr->load()) {
+      std::optional<MetricSnapshot> snapshot = rawReader->Read();
+      if (!snapshot) {
+        continue;
+      }
+      for (uint8_t b : snapshot->payload) {
+        if (b != snapshot->payload[0]) {
+          torn = true;
+        }
+      }
+    }
+  });
+
+  for (int i = 1; i <= 10000; i++) {
+    std::fill(payload.begin(), payload.end(), (uint8_t)i);
+    writer->Publish(payload.data(), payload.size(), i);
+  }
+  done.store(true);
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+  XCTAssertFalse(torn);
+}
+
+@end
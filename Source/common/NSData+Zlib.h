@@ -25,3 +25,20 @@
 - (NSData*)gzipDecompressed;
 
 @end
+
+/// Compresses data as it is appended, so a large body produced in pieces is never held in memory
+/// uncompressed as a whole. Deflate state is pooled and reset between compressors rather than set
+/// up again each time. Not thread-safe; a compressor must only be used from one thread at a time.
+@interface SNTZlibCompressor : NSObject
+
+/// Returns nil if the deflate state could not be set up.
+- (instancetype)initWithGzipHeader:(BOOL)includeHeader;
+
+/// Returns NO if compression failed, after which all further calls fail.
+- (BOOL)appendBytes:(const void*)bytes length:(NSUInteger)length;
+
+/// Completes the stream and returns the compressed data, or nil if compression failed. The
+/// compressor can't be used afterwards.
+- (NSData*)finish;
+
+@end
@@ -17,42 +17,164 @@
 
 #include <zlib.h>
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
 static constexpr NSUInteger kChunkSize = 16384;
 static constexpr int kWindowSizeZlib = 15;
 static constexpr int kWindowSizeGzip = kWindowSizeZlib + 16;
 
-@implementation NSData (Zlib)
+// Idle deflate streams kept for reuse per window size
+static constexpr size_t kMaxIdleStreams = 4;
 
-- (NSData*)compressIncludingGzipHeader:(BOOL)includeHeader {
-  if ([self length]) {
-    z_stream stream;
-    stream.zalloc = Z_NULL;
-    stream.zfree = Z_NULL;
-    stream.opaque = Z_NULL;
-    stream.avail_in = (uint)[self length];
-    stream.next_in = (Bytef*)[self bytes];
-    stream.total_out = 0;
-    stream.avail_out = 0;
+namespace {
 
-    int windowSize = includeHeader ? kWindowSizeGzip : kWindowSizeZlib;
+// Deflate streams for one window size. deflateInit2 allocates a few hundred KiB of state,
+// deflateReset only clears it.
+class DeflatePool {
+ public:
+  explicit DeflatePool(int window_bits) : window_bits_(window_bits) {}
 
-    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowSize, 8,
-                     Z_DEFAULT_STRATEGY) == Z_OK) {
-      NSMutableData* data = [NSMutableData dataWithLength:kChunkSize];
-      while (stream.avail_out == 0) {
-        if (stream.total_out >= [data length]) {
-          data.length += kChunkSize;
-        }
-        stream.next_out = (uint8_t*)[data mutableBytes] + stream.total_out;
-        stream.avail_out = (uInt)([data length] - stream.total_out);
-        deflate(&stream, Z_FINISH);
+  z_stream* Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!idle_.empty()) {
+        z_stream* stream = idle_.back();
+        idle_.pop_back();
+        return stream;
       }
-      deflateEnd(&stream);
-      data.length = stream.total_out;
-      return data;
     }
+
+    z_stream* stream = new z_stream{};
+    if (deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits_, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      delete stream;
+      return nullptr;
+    }
+    return stream;
   }
-  return nil;
+
+  void Release(z_stream* stream) {
+    if (deflateReset(stream) == Z_OK) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (idle_.size() < kMaxIdleStreams) {
+        idle_.push_back(stream);
+        return;
+      }
+    }
+    deflateEnd(stream);
+    delete stream;
+  }
+
+ private:
+  const int window_bits_;
+  std::mutex mutex_;
+  std::vector<z_stream*> idle_;
+};
+
+DeflatePool& PoolForHeader(BOOL includeHeader) {
+  static DeflatePool* zlib_pool = new DeflatePool(kWindowSizeZlib);
+  static DeflatePool* gzip_pool = new DeflatePool(kWindowSizeGzip);
+  return includeHeader ? *gzip_pool : *zlib_pool;
+}
+
+// Deflate the pending input of `stream` into `data` past its first `total_out` bytes, growing it
+// as needed. With Z_FINISH this runs until the stream is complete. Returns false on error.
+bool Deflate(z_stream* stream, NSMutableData* data, int flush) {
+  while (true) {
+    if (stream->total_out >= [data length]) {
+      data.length += MAX(kChunkSize, [data length] / 2);
+    }
+    stream->next_out = (uint8_t*)[data mutableBytes] + stream->total_out;
+    stream->avail_out = (uInt)([data length] - stream->total_out);
+
+    int status = deflate(stream, flush);
+    if (status == Z_STREAM_END) return true;
+    if (status != Z_OK) return false;
+    if (flush != Z_FINISH && stream->avail_in == 0 && stream->avail_out != 0) return true;
+  }
+}
+
+}  // namespace
+
+@implementation SNTZlibCompressor {
+  DeflatePool* _pool;
+  z_stream* _stream;
+  NSMutableData* _data;
+}
+
+- (instancetype)initWithGzipHeader:(BOOL)includeHeader {
+  self = [super init];
+  if (self) {
+    _pool = &PoolForHeader(includeHeader);
+    _stream = _pool->Acquire();
+    if (!_stream) return nil;
+    _data = [NSMutableData dataWithLength:kChunkSize];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  [self releaseStream];
+}
+
+- (void)releaseStream {
+  if (_stream) {
+    _pool->Release(_stream);
+    _stream = nullptr;
+  }
+}
+
+- (BOOL)appendBytes:(const void*)bytes length:(NSUInteger)length {
+  if (!_stream) return NO;
+
+  const Bytef* next = (const Bytef*)bytes;
+  while (length > 0) {
+    uInt chunk = (uInt)std::min<NSUInteger>(length, UINT_MAX);
+    _stream->next_in = (Bytef*)next;
+    _stream->avail_in = chunk;
+    if (!Deflate(_stream, _data, Z_NO_FLUSH)) {
+      [self releaseStream];
+      return NO;
+    }
+    next += chunk;
+    length -= chunk;
+  }
+  return YES;
+}
+
+- (NSData*)finish {
+  if (!_stream) return nil;
+
+  BOOL ok = Deflate(_stream, _data, Z_FINISH);
+  _data.length = _stream->total_out;
+  [self releaseStream];
+
+  NSData* data = ok ? _data : nil;
+  _data = nil;
+  return data;
+}
+
+@end
+
+@implementation NSData (Zlib)
+
+- (NSData*)compressIncludingGzipHeader:(BOOL)includeHeader {
+  if (![self length] || [self length] > UINT_MAX) return nil;
+
+  DeflatePool& pool = PoolForHeader(includeHeader);
+  z_stream* stream = pool.Acquire();
+  if (!stream) return nil;
+
+  // The whole buffer is compressed in a single Z_FINISH pass
+  stream->next_in = (Bytef*)[self bytes];
+  stream->avail_in = (uInt)[self length];
+  NSMutableData* data = [NSMutableData dataWithLength:kChunkSize];
+  bool ok = Deflate(stream, data, Z_FINISH);
+  data.length = stream->total_out;
+  pool.Release(stream);
+  return ok ? data : nil;
 }
 
 - (NSData*)decompressIncludingGzipHeader:(BOOL)includeHeader {
@@ -0,0 +1,32 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+/// Category on NSData providing the option of getting zstd compressed data.
+///
+/// Compression and decompression contexts are kept per thread and reused between calls, so
+/// repeatedly compressing small payloads doesn't pay for setting up a new context each time.
+@interface NSData (Zstd)
+
+- (NSData*)zstdCompressed;
+
+/// Returns nil if the data isn't a complete zstd frame or fails to decompress.
+- (NSData*)zstdDecompressed;
+
+/// Returns YES if the data starts with the zstd frame magic number.
+- (BOOL)hasZstdFrameHeader;
+
+@end
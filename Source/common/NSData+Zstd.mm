@@ -0,0 +1,114 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/common/NSData+Zstd.h"
+
+#include <memory>
+
+#include "zstd.h"
+
+static constexpr int kCompressionLevel = ZSTD_CLEVEL_DEFAULT;
+
+// Upper bound on the buffer allocated up front from the size in a frame header, which could be
+// anything. Larger content still decompresses, the buffer just grows as it's written.
+static constexpr NSUInteger kMaxInitialDecompressedSize = 64 * 1024 * 1024;
+
+namespace {
+
+ZSTD_CCtx* ThreadCompressionContext() {
+  thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(),
+                                                                         ZSTD_freeCCtx);
+  return cctx.get();
+}
+
+ZSTD_DCtx* ThreadDecompressionContext() {
+  thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(),
+                                                                         ZSTD_freeDCtx);
+  return dctx.get();
+}
+
+}  // namespace
+
+@implementation NSData (Zstd)
+
+- (NSData*)zstdCompressed {
+  ZSTD_CCtx* cctx = ThreadCompressionContext();
+  if (![self length] || !cctx) return nil;
+
+  // Reset parameters in case an earlier call on this thread failed part way through
+  ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters);
+  if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, kCompressionLevel))) {
+    return nil;
+  }
+
+  NSMutableData* data = [NSMutableData dataWithLength:ZSTD_compressBound([self length])];
+  size_t size =
+      ZSTD_compress2(cctx, [data mutableBytes], [data length], [self bytes], [self length]);
+  if (ZSTD_isError(size)) return nil;
+
+  data.length = size;
+  return data;
+}
+
+- (NSData*)zstdDecompressed {
+  ZSTD_DCtx* dctx = ThreadDecompressionContext();
+  if (![self length] || !dctx) return nil;
+
+  ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+
+  // Servers streaming their responses may not record the content size in the frame header, so
+  // grow the output as needed rather than relying on it.
+  unsigned long long contentSize = ZSTD_getFrameContentSize([self bytes], [self length]);
+  if (contentSize == ZSTD_CONTENTSIZE_ERROR) return nil;
+  NSUInteger initialLength = [self length] * 4;
+  if (contentSize != ZSTD_CONTENTSIZE_UNKNOWN) {
+    initialLength = (NSUInteger)MIN(contentSize, kMaxInitialDecompressedSize);
+  }
+
+  NSMutableData* data = [NSMutableData dataWithLength:MAX(initialLength, ZSTD_DStreamOutSize())];
+  ZSTD_inBuffer input = {.src = [self bytes], .size = [self length], .pos = 0};
+  ZSTD_outBuffer output = {.dst = [data mutableBytes], .size = [data length], .pos = 0};
+
+  while (true) {
+    size_t remaining = ZSTD_decompressStream(dctx, &output, &input);
+    if (ZSTD_isError(remaining)) return nil;
+
+    if (remaining == 0) {
+      // A frame ended. Any further input is another frame and decoding continues.
+      if (input.pos == input.size) break;
+    } else if (input.pos == input.size && output.pos < output.size) {
+      // Out of input part way through a frame
+      return nil;
+    }
+
+    if (output.pos == output.size) {
+      data.length += MAX(data.length / 2, ZSTD_DStreamOutSize());
+      output.dst = [data mutableBytes];
+      output.size = [data length];
+    }
+  }
+
+  data.length = output.pos;
+  return data;
+}
+
+- (BOOL)hasZstdFrameHeader {
+  if ([self length] < 4) return NO;
+  const uint8_t* bytes = (const uint8_t*)[self bytes];
+  uint32_t magic = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+  return magic == ZSTD_MAGICNUMBER;
+}
+
+@end
@@ -60,6 +60,44 @@
   XCTAssertEqualObjects([sut gzipDecompressed], want);
 }
 
+- (void)testZlibCompressorChunked {
+  NSData* input = [self dataFromFixture:@"compression_test_uncompressed.json"];
+
+  // Compressors reuse pooled deflate state, so run several of each kind in a row
+  for (int i = 0; i < 6; i++) {
+    BOOL gzip = (i % 2 == 1);
+    SNTZlibCompressor* sut = [[SNTZlibCompressor alloc] initWithGzipHeader:gzip];
+    XCTAssertNotNil(sut);
+
+    const uint8_t* bytes = (const uint8_t*)input.bytes;
+    for (NSUInteger off = 0; off < input.length; off += 1000) {
+      XCTAssertTrue([sut appendBytes:bytes + off length:MIN(1000, input.length - off)]);
+    }
+    NSData* compressed = [sut finish];
+    XCTAssertNotNil(compressed);
+    XCTAssertLessThan(compressed.length, input.length);
+    XCTAssertEqualObjects(gzip ? [compressed gzipDecompressed] : [compressed zlibDecompressed],
+                          input);
+
+    // The compressor is done once finished
+    XCTAssertFalse([sut appendBytes:bytes length:1]);
+    XCTAssertNil([sut finish]);
+  }
+}
+
+- (void)testZlibCompressorAbandoned {
+  NSData* input = [self dataFromFixture:@"compression_test_uncompressed.json"];
+
+  // A compressor released without finishing returns its state to the pool reset
+  @autoreleasepool {
+    SNTZlibCompressor* abandoned = [[SNTZlibCompressor alloc] initWithGzipHeader:NO];
+    XCTAssertTrue([abandoned appendBytes:input.bytes length:input.length / 2]);
+  }
+
+  XCTAssertEqualObjects([input zlibCompressed],
+                        [self dataFromFixture:@"compression_test_zlib.z"]);
+}
+
 - (void)testCompressEmpty {
   NSData* sut = [NSData data];
   XCTAssertNil([sut zlibCompressed]);
@@ -0,0 +1,104 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <XCTest/XCTest.h>
+
+#import "Source/common/NSData+Zstd.h"
+
+#include "zstd.h"
+
+@interface NSDataZstdTest : XCTestCase
+@end
+
+@implementation NSDataZstdTest
+
+- (NSData*)dataFromFixture:(NSString*)file {
+  NSString* path = [[NSBundle bundleForClass:[self class]] pathForResource:file ofType:nil];
+  XCTAssertNotNil(path, @"failed to load testdata: %@", file);
+  return [NSData dataWithContentsOfFile:path];
+}
+
+- (void)testRoundTrip {
+  NSData* want = [self dataFromFixture:@"compression_test_uncompressed.json"];
+
+  NSData* compressed = [want zstdCompressed];
+  XCTAssertNotNil(compressed);
+  XCTAssertLessThan(compressed.length, want.length);
+  XCTAssertTrue([compressed hasZstdFrameHeader]);
+  XCTAssertFalse([want hasZstdFrameHeader]);
+
+  XCTAssertEqualObjects([compressed zstdDecompressed], want);
+}
+
+- (void)testContextReuse {
+  // Contexts are reused between calls, make sure nothing carries over
+  NSMutableString* str = [NSMutableString string];
+  for (int i = 0; i < 100; i++) {
+    [str appendFormat:@"%d,", i];
+    NSData* want = [str dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects([[want zstdCompressed] zstdDecompressed], want);
+  }
+}
+
+- (void)testDecompressUnknownContentSize {
+  // Streamed frames don't record their size, so the output buffer has to grow
+  NSMutableData* want = [NSMutableData dataWithLength:1024 * 1024];
+  memset(want.mutableBytes, 'x', want.length);
+
+  ZSTD_CCtx* cctx = ZSTD_createCCtx();
+  NSMutableData* compressed = [NSMutableData dataWithLength:ZSTD_compressBound(want.length)];
+  ZSTD_inBuffer input = {.src = want.bytes, .size = want.length, .pos = 0};
+  ZSTD_outBuffer output = {.dst = compressed.mutableBytes, .size = compressed.length, .pos = 0};
+  XCTAssertEqual(ZSTD_compressStream2(cctx, &output, &input, ZSTD_e_end), 0);
+  ZSTD_freeCCtx(cctx);
+  compressed.length = output.pos;
+  XCTAssertEqual(ZSTD_getFrameContentSize(compressed.bytes, compressed.length),
+                 ZSTD_CONTENTSIZE_UNKNOWN);
+
+  XCTAssertEqualObjects([compressed zstdDecompressed], want);
+}
+
+- (void)testDecompressMultipleFrames {
+  NSData* first = [@"first frame" dataUsingEncoding:NSUTF8StringEncoding];
+  NSData* second = [@"second frame" dataUsingEncoding:NSUTF8StringEncoding];
+
+  NSMutableData* sut = [[first zstdCompressed] mutableCopy];
+  [sut appendData:[second zstdCompressed]];
+
+  NSMutableData* want = [first mutableCopy];
+  [want appendData:second];
+  XCTAssertEqualObjects([sut zstdDecompressed], want);
+}
+
+- (void)testDecompressInvalid {
+  NSData* compressed =
+      [[self dataFromFixture:@"compression_test_uncompressed.json"] zstdCompressed];
+
+  // Truncated frames fail
+  XCTAssertNil([[compressed subdataWithRange:NSMakeRange(0, compressed.length - 8)]
+      zstdDecompressed]);
+
+  // So does data that was never compressed
+  XCTAssertNil([[self dataFromFixture:@"compression_test_gzip.gz"] zstdDecompressed]);
+}
+
+- (void)testCompressEmpty {
+  NSData* sut = [NSData data];
+  XCTAssertNil([sut zstdCompressed]);
+  XCTAssertNil([sut zstdDecompressed]);
+  XCTAssertFalse([sut hasZstdFrameHeader]);
+}
+
+@end
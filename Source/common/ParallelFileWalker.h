@@ -0,0 +1,60 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_PARALLELFILEWALKER_H
+#define SANTA_COMMON_PARALLELFILEWALKER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace santa {
+
+// Walks directory trees on a bounded pool of worker threads.
+//
+// Each worker keeps its own queue of directories to read and files to visit,
+// and idle workers steal from the others, so a single large directory doesn't
+// leave the rest of the pool waiting. Every worker holds at most one file or
+// directory open at a time, and no more than `max_open_files` are open across
+// the pool.
+//
+// Like NSDirectoryEnumerator, symlinks to directories aren't followed.
+// Symlinks to regular files are visited.
+class ParallelFileWalker {
+ public:
+  struct Options {
+    size_t max_threads = 4;
+    size_t max_open_files = 4;
+    // Only visit Mach-O files. Files are checked by reading their magic number
+    // before the callback is called.
+    bool macho_only = false;
+  };
+
+  using FileCallback = std::function<void(const std::string& path)>;
+
+  // Calls `callback` concurrently from worker threads for every regular file
+  // found under `roots`. Roots that are regular files are visited directly.
+  // Returns when the whole tree has been visited.
+  static void Walk(const std::vector<std::string>& roots,
+                   const Options& options, FileCallback callback);
+
+  // Returns true if the file descriptor refers to a thin or fat Mach-O file
+  static bool IsMachO(int fd);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_PARALLELFILEWALKER_H
@@ -0,0 +1,228 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ParallelFileWalker.h"
+
+#include <dirent.h>
+#include <dispatch/dispatch.h>
+#include <fcntl.h>
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace santa {
+
+namespace {
+
+struct WorkItem {
+  std::string path;
+  bool is_dir;
+};
+
+class Walker {
+ public:
+  Walker(size_t workers, size_t max_open_files, bool macho_only,
+         ParallelFileWalker::FileCallback callback)
+      : open_files_sema_(dispatch_semaphore_create((long)max_open_files)),
+        macho_only_(macho_only),
+        callback_(std::move(callback)) {
+    for (size_t i = 0; i < workers; i++) {
+      queues_.push_back(std::make_unique<Queue>());
+    }
+  }
+
+  void Push(size_t worker, WorkItem item) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    Queue& q = *queues_[worker];
+    absl::MutexLock lock(&q.mtx);
+    q.items.push_back(std::move(item));
+  }
+
+  void Run(size_t worker) {
+    while (true) {
+      std::optional<WorkItem> item = Pop(worker);
+      if (!item) {
+        if (pending_.load(std::memory_order_acquire) == 0) return;
+        // Other workers are still reading directories that may produce more
+        // work, wait briefly and try to steal again
+        absl::MutexLock lock(&idle_mtx_);
+        idle_cv_.WaitWithTimeout(&idle_mtx_, absl::Milliseconds(1));
+        continue;
+      }
+
+      if (item->is_dir) {
+        ReadDirectory(worker, item->path);
+      } else {
+        VisitFile(item->path);
+      }
+
+      if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        absl::MutexLock lock(&idle_mtx_);
+        idle_cv_.SignalAll();
+      }
+    }
+  }
+
+ private:
+  struct Queue {
+    absl::Mutex mtx;
+    std::deque<WorkItem> items;
+  };
+
+  // Workers take the newest item from their own queue and steal the oldest
+  // from others. Old items are more likely to be directories near the top of
+  // the tree, which gives the thief a large batch of work.
+  std::optional<WorkItem> Pop(size_t worker) {
+    {
+      Queue& q = *queues_[worker];
+      absl::MutexLock lock(&q.mtx);
+      if (!q.items.empty()) {
+        WorkItem item = std::move(q.items.back());
+        q.items.pop_back();
+        return item;
+      }
+    }
+
+    for (size_t i = 1; i < queues_.size(); i++) {
+      Queue& q = *queues_[(worker + i) % queues_.size()];
+      absl::MutexLock lock(&q.mtx);
+      if (!q.items.empty()) {
+        WorkItem item = std::move(q.items.front());
+        q.items.pop_front();
+        return item;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  void ReadDirectory(size_t worker, const std::string& path) {
+    // Entries are collected before any are processed so the directory is
+    // closed before this worker opens anything else
+    std::vector<WorkItem> children;
+    dispatch_semaphore_wait(open_files_sema_, DISPATCH_TIME_FOREVER);
+    if (DIR* dir = opendir(path.c_str())) {
+      while (struct dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+          continue;
+        }
+
+        std::string child = path + "/" + entry->d_name;
+        switch (entry->d_type) {
+          case DT_DIR: children.push_back({std::move(child), true}); break;
+          case DT_REG: children.push_back({std::move(child), false}); break;
+          case DT_LNK:
+          case DT_UNKNOWN: {
+            // Follow symlinks to files but not to directories
+            struct stat sb;
+            struct stat lsb;
+            if (lstat(child.c_str(), &lsb) == 0 && S_ISDIR(lsb.st_mode)) {
+              children.push_back({std::move(child), true});
+            } else if (stat(child.c_str(), &sb) == 0 && S_ISREG(sb.st_mode)) {
+              children.push_back({std::move(child), false});
+            }
+            break;
+          }
+          default: break;
+        }
+      }
+      closedir(dir);
+    }
+    dispatch_semaphore_signal(open_files_sema_);
+
+    for (WorkItem& child : children) {
+      Push(worker, std::move(child));
+    }
+  }
+
+  void VisitFile(const std::string& path) {
+    dispatch_semaphore_wait(open_files_sema_, DISPATCH_TIME_FOREVER);
+    bool visit = true;
+    if (macho_only_) {
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      visit = fd >= 0 && ParallelFileWalker::IsMachO(fd);
+      if (fd >= 0) close(fd);
+    }
+    if (visit) {
+      callback_(path);
+    }
+    dispatch_semaphore_signal(open_files_sema_);
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  // Items that have been pushed but not yet fully processed
+  std::atomic<size_t> pending_{0};
+  absl::Mutex idle_mtx_;
+  absl::CondVar idle_cv_;
+  dispatch_semaphore_t open_files_sema_;
+  bool macho_only_;
+  ParallelFileWalker::FileCallback callback_;
+};
+
+}  // namespace
+
+void ParallelFileWalker::Walk(const std::vector<std::string>& roots, const Options& options,
+                              FileCallback callback) {
+  size_t workers = std::max<size_t>(1, options.max_threads);
+  Walker walker(workers, std::max<size_t>(1, options.max_open_files), options.macho_only,
+                std::move(callback));
+
+  for (size_t i = 0; i < roots.size(); i++) {
+    struct stat sb;
+    if (stat(roots[i].c_str(), &sb) != 0) continue;
+    if (S_ISDIR(sb.st_mode)) {
+      walker.Push(i % workers, {roots[i], true});
+    } else if (S_ISREG(sb.st_mode)) {
+      walker.Push(i % workers, {roots[i], false});
+    }
+  }
+
+  Walker* w = &walker;
+  dispatch_apply(workers, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
+    w->Run(i);
+  });
+}
+
+bool ParallelFileWalker::IsMachO(int fd) {
+  uint32_t magic = 0;
+  if (pread(fd, &magic, sizeof(magic), 0) != sizeof(magic)) {
+    return false;
+  }
+
+  switch (magic) {
+    case MH_MAGIC:
+    case MH_CIGAM:
+    case MH_MAGIC_64:
+    case MH_CIGAM_64:
+    case FAT_MAGIC:
+    case FAT_CIGAM:
+    case FAT_MAGIC_64:
+    case FAT_CIGAM_64: return true;
+    default: return false;
+  }
+}
+
+}  // namespace santa
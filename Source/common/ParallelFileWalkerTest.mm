@@ -0,0 +1,156 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ParallelFileWalker.h"
+
+#import <XCTest/XCTest.h>
+#include <fcntl.h>
+#include <mach-o/loader.h>
+#include <unistd.h>
+
+#include <set>
+#include <string>
+
+#include "absl/synchronization/mutex.h"
+
+using santa::ParallelFileWalker;
+
+@interface ParallelFileWalkerTest : XCTestCase
+@property NSString* tempDir;
+@end
+
+@implementation ParallelFileWalkerTest
+
+- (void)setUp {
+  self.tempDir = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+  [[NSFileManager defaultManager] createDirectoryAtPath:self.tempDir
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.tempDir error:nil];
+}
+
+- (NSString*)createFile:(NSString*)relPath contents:(NSData*)contents {
+  NSString* path = [self.tempDir stringByAppendingPathComponent:relPath];
+  [[NSFileManager defaultManager] createDirectoryAtPath:[path stringByDeletingLastPathComponent]
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  [contents writeToFile:path atomically:NO];
+  return path;
+}
+
+- (NSData*)machOHeader {
+  uint32_t header[8] = {MH_MAGIC_64};
+  return [NSData dataWithBytes:header length:sizeof(header)];
+}
+
+- (std::set<std::string>)walk:(NSArray<NSString*>*)roots
+                      options:(ParallelFileWalker::Options)options {
+  std::vector<std::string> rootPaths;
+  for (NSString* root in roots) {
+    rootPaths.push_back(root.UTF8String);
+  }
+
+  absl::Mutex mtx;
+  std::set<std::string> visited;
+  absl::Mutex* mtxPtr = &mtx;
+  std::set<std::string>* visitedPtr = &visited;
+  ParallelFileWalker::Walk(rootPaths, options, ^(const std::string& path) {
+    absl::MutexLock lock(mtxPtr);
+    // Each file is visited exactly once
+    XCTAssertTrue(visitedPtr->insert(path).second);
+  });
+  return visited;
+}
+
+- (void)testWalkVisitsAllFiles {
+  std::set<std::string> want;
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 10; j++) {
+      NSString* relPath = [NSString stringWithFormat:@"d%d/e%d/f", i, j];
+      want.insert([self createFile:relPath contents:[self machOHeader]].UTF8String);
+    }
+  }
+
+  ParallelFileWalker::Options options;
+  options.max_threads = 4;
+  options.max_open_files = 2;
+  XCTAssertTrue([self walk:@[ self.tempDir ] options:options] == want);
+
+  // A single worker visits the same files
+  options.max_threads = 1;
+  options.max_open_files = 1;
+  XCTAssertTrue([self walk:@[ self.tempDir ] options:options] == want);
+}
+
+- (void)testWalkMachOOnly {
+  NSString* macho = [self createFile:@"a/macho" contents:[self machOHeader]];
+  [self createFile:@"a/text" contents:[@"#!/bin/sh\n" dataUsingEncoding:NSUTF8StringEncoding]];
+  [self createFile:@"a/empty" contents:[NSData data]];
+
+  ParallelFileWalker::Options options;
+  options.macho_only = true;
+  std::set<std::string> want = {macho.UTF8String};
+  XCTAssertTrue([self walk:@[ self.tempDir ] options:options] == want);
+
+  options.macho_only = false;
+  XCTAssertEqual([self walk:@[ self.tempDir ] options:options].size(), 3);
+}
+
+- (void)testWalkSymlinks {
+  NSString* file = [self createFile:@"real/file" contents:[self machOHeader]];
+  NSString* walkDir = [self.tempDir stringByAppendingPathComponent:@"walk"];
+  NSFileManager* fm = [NSFileManager defaultManager];
+  [fm createDirectoryAtPath:walkDir withIntermediateDirectories:YES attributes:nil error:nil];
+
+  // Symlinks to files are visited, symlinks to directories are not followed
+  NSString* fileLink = [walkDir stringByAppendingPathComponent:@"filelink"];
+  [fm createSymbolicLinkAtPath:fileLink withDestinationPath:file error:nil];
+  [fm createSymbolicLinkAtPath:[walkDir stringByAppendingPathComponent:@"dirlink"]
+           withDestinationPath:[file stringByDeletingLastPathComponent]
+                         error:nil];
+
+  ParallelFileWalker::Options options;
+  std::set<std::string> want = {fileLink.UTF8String};
+  XCTAssertTrue([self walk:@[ walkDir ] options:options] == want);
+}
+
+- (void)testWalkFileRoots {
+  NSString* file = [self createFile:@"file" contents:[self machOHeader]];
+  ParallelFileWalker::Options options;
+  std::set<std::string> want = {file.UTF8String};
+  XCTAssertTrue([self walk:@[ file, @"/does/not/exist" ] options:options] == want);
+}
+
+- (void)testIsMachO {
+  NSString* macho = [self createFile:@"macho" contents:[self machOHeader]];
+  NSString* text = [self createFile:@"text"
+                           contents:[@"hello" dataUsingEncoding:NSUTF8StringEncoding]];
+
+  int fd = open(macho.UTF8String, O_RDONLY);
+  XCTAssertTrue(ParallelFileWalker::IsMachO(fd));
+  close(fd);
+
+  fd = open(text.UTF8String, O_RDONLY);
+  XCTAssertFalse(ParallelFileWalker::IsMachO(fd));
+  close(fd);
+}
+
+@end
@@ -0,0 +1,126 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_PATHINTERNPOOL_H
+#define SANTA_COMMON_PATHINTERNPOOL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+class PathInternPool;
+
+// A refcounted, immutable handle to a path stored in a PathInternPool. Copies
+// share the same storage. The viewed data is always null-terminated.
+class InternedPath {
+ public:
+  InternedPath() = default;
+  ~InternedPath();
+
+  InternedPath(const InternedPath& other);
+  InternedPath& operator=(const InternedPath& other);
+  InternedPath(InternedPath&& other) : entry_(other.entry_) {
+    other.entry_ = nullptr;
+  }
+  InternedPath& operator=(InternedPath&& other);
+
+  std::string_view View() const;
+  const char* c_str() const { return entry_ ? entry_->data() : ""; }
+  operator std::string_view() const { return View(); }
+
+  // Returns true if both handles refer to the same pool storage
+  bool SharesStorage(const InternedPath& other) const {
+    return entry_ == other.entry_;
+  }
+
+ private:
+  friend class PathInternPool;
+
+  struct Entry {
+    PathInternPool* pool;
+    std::atomic<uint32_t> refs;
+    uint32_t length;
+
+    // Path bytes are stored immediately after the entry
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+  };
+
+  explicit InternedPath(Entry* entry) : entry_(entry) {}
+  void Release();
+
+  Entry* entry_ = nullptr;
+};
+
+// Process wide pool of deduplicated paths. Telemetry sees the same
+// executable, parent and target paths over and over; interning them means
+// each distinct path is stored once no matter how many events reference it.
+//
+// Entries are removed as soon as their last handle is released, so the pool
+// only ever holds paths that are currently referenced. A pool must outlive
+// every handle it has vended.
+class PathInternPool {
+ public:
+  static constexpr size_t kNumShards = 16;
+
+  struct Stats {
+    uint64_t size = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  static PathInternPool& Shared();
+
+  PathInternPool() = default;
+
+  PathInternPool(PathInternPool&& other) = delete;
+  PathInternPool& operator=(PathInternPool&& rhs) = delete;
+  PathInternPool(const PathInternPool& other) = delete;
+  PathInternPool& operator=(const PathInternPool& other) = delete;
+
+  InternedPath Intern(std::string_view path);
+
+  // When `reset` is true the hit and miss counts are cleared so that the next
+  // call only covers lookups made after this one. The size is never reset.
+  Stats GetStats(bool reset);
+
+ private:
+  friend class InternedPath;
+
+  struct alignas(64) Shard {
+    absl::Mutex mtx;
+    absl::flat_hash_map<std::string_view, InternedPath::Entry*> map
+        ABSL_GUARDED_BY(mtx);
+  };
+
+  Shard& ShardFor(std::string_view path);
+  void Release(InternedPath::Entry* entry);
+
+  std::array<Shard, kNumShards> shards_;
+  std::atomic<uint64_t> size_{0};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_PATHINTERNPOOL_H
@@ -0,0 +1,137 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/PathInternPool.h"
+
+#include <cstring>
+#include <new>
+
+#include "absl/hash/hash.h"
+
+namespace santa {
+
+InternedPath::~InternedPath() {
+  Release();
+}
+
+InternedPath::InternedPath(const InternedPath& other) : entry_(other.entry_) {
+  if (entry_) {
+    entry_->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+InternedPath& InternedPath::operator=(const InternedPath& other) {
+  if (entry_ != other.entry_) {
+    Release();
+    entry_ = other.entry_;
+    if (entry_) {
+      entry_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  return *this;
+}
+
+InternedPath& InternedPath::operator=(InternedPath&& other) {
+  if (this != &other) {
+    Release();
+    entry_ = other.entry_;
+    other.entry_ = nullptr;
+  }
+  return *this;
+}
+
+std::string_view InternedPath::View() const {
+  return entry_ ? std::string_view(entry_->data(), entry_->length) : std::string_view();
+}
+
+void InternedPath::Release() {
+  if (entry_ && entry_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    entry_->pool->Release(entry_);
+  }
+  entry_ = nullptr;
+}
+
+PathInternPool& PathInternPool::Shared() {
+  static PathInternPool* shared = new PathInternPool();
+  return *shared;
+}
+
+PathInternPool::Shard& PathInternPool::ShardFor(std::string_view path) {
+  return shards_[absl::Hash<std::string_view>{}(path) % kNumShards];
+}
+
+InternedPath PathInternPool::Intern(std::string_view path) {
+  Shard& shard = ShardFor(path);
+  absl::MutexLock lock(shard.mtx);
+
+  auto it = shard.map.find(path);
+  if (it != shard.map.end()) {
+    // An entry whose count already hit zero is being released on another
+    // thread and must not be revived; replace it with a fresh one instead.
+    uint32_t refs = it->second->refs.load(std::memory_order_relaxed);
+    while (refs > 0) {
+      if (it->second->refs.compare_exchange_weak(refs, refs + 1, std::memory_order_relaxed)) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return InternedPath(it->second);
+      }
+    }
+    shard.map.erase(it);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  misses_.fetch_add(1, std::memory_order_relaxed);
+
+  void* mem = ::operator new(sizeof(InternedPath::Entry) + path.length() + 1);
+  InternedPath::Entry* entry = new (mem) InternedPath::Entry{
+      .pool = this,
+      .refs = 1,
+      .length = (uint32_t)path.length(),
+  };
+  memcpy(entry->data(), path.data(), path.length());
+  entry->data()[path.length()] = '\0';
+
+  shard.map.emplace(std::string_view(entry->data(), entry->length), entry);
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return InternedPath(entry);
+}
+
+void PathInternPool::Release(InternedPath::Entry* entry) {
+  std::string_view path(entry->data(), entry->length);
+  Shard& shard = ShardFor(path);
+  {
+    absl::MutexLock lock(shard.mtx);
+    // The entry may already have been replaced by a concurrent Intern
+    auto it = shard.map.find(path);
+    if (it != shard.map.end() && it->second == entry) {
+      shard.map.erase(it);
+      size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  entry->~Entry();
+  ::operator delete(entry);
+}
+
+PathInternPool::Stats PathInternPool::GetStats(bool reset) {
+  return Stats{
+      .size = size_.load(std::memory_order_relaxed),
+      .hits = reset ? hits_.exchange(0, std::memory_order_relaxed)
+                    : hits_.load(std::memory_order_relaxed),
+      .misses = reset ? misses_.exchange(0, std::memory_order_relaxed)
+                      : misses_.load(std::memory_order_relaxed),
+  };
+}
+
+}  // namespace santa
@@ -0,0 +1,130 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/PathInternPool.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <malloc/malloc.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using santa::InternedPath;
+using santa::PathInternPool;
+
+static size_t BlocksInUse() {
+  malloc_statistics_t stats;
+  malloc_zone_statistics(NULL, &stats);
+  return stats.blocks_in_use;
+}
+
+@interface PathInternPoolTest : XCTestCase
+@end
+
+@implementation PathInternPoolTest
+
+- (void)testInternSharesStorage {
+  auto sut = std::make_unique<PathInternPool>();
+
+  InternedPath a = sut->Intern("/usr/bin/true");
+  InternedPath b = sut->Intern(std::string("/usr/bin/") + "true");
+  InternedPath c = sut->Intern("/usr/bin/false");
+
+  XCTAssertTrue(a.SharesStorage(b));
+  XCTAssertFalse(a.SharesStorage(c));
+  XCTAssertTrue(a.View() == "/usr/bin/true");
+  XCTAssertEqual(strcmp(c.c_str(), "/usr/bin/false"), 0);
+
+  PathInternPool::Stats stats = sut->GetStats(true);
+  XCTAssertEqual(stats.size, 2);
+  XCTAssertEqual(stats.hits, 1);
+  XCTAssertEqual(stats.misses, 2);
+
+  stats = sut->GetStats(false);
+  XCTAssertEqual(stats.size, 2);
+  XCTAssertEqual(stats.hits, 0);
+  XCTAssertEqual(stats.misses, 0);
+}
+
+- (void)testEntriesAreReleasedWithLastHandle {
+  auto sut = std::make_unique<PathInternPool>();
+
+  {
+    InternedPath a = sut->Intern("/tmp/foo");
+    InternedPath copy = a;
+    InternedPath moved = std::move(a);
+    XCTAssertTrue(a.View().empty());
+    XCTAssertTrue(copy.SharesStorage(moved));
+
+    copy = InternedPath();
+    XCTAssertEqual(sut->GetStats(false).size, 1);
+  }
+
+  XCTAssertEqual(sut->GetStats(false).size, 0);
+
+  // Re-interning after release creates a new entry
+  InternedPath again = sut->Intern("/tmp/foo");
+  XCTAssertTrue(again.View() == "/tmp/foo");
+  XCTAssertEqual(sut->GetStats(false).misses, 2);
+}
+
+- (void)testConcurrentInternAndRelease {
+  auto sut = std::make_shared<PathInternPool>();
+
+  dispatch_apply(16, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t t) {
+    std::string path = "/Applications/App" + std::to_string(t % 4) + ".app";
+    for (int i = 0; i < 10000; i++) {
+      InternedPath p = sut->Intern(path);
+      XCTAssertTrue(p.View() == path);
+    }
+  });
+
+  PathInternPool::Stats stats = sut->GetStats(false);
+  XCTAssertEqual(stats.size, 0);
+  XCTAssertEqual(stats.hits + stats.misses, 16 * 10000);
+}
+
+- (void)testRepeatedPathsDoNotAllocate {
+  auto sut = std::make_unique<PathInternPool>();
+  const int kEvents = 10000;
+  // Long enough to defeat the small string optimization
+  const std::string path = "/Users/someone/Library/Application Support/App/data.sqlite-wal";
+
+  std::vector<std::string> copies;
+  copies.reserve(kEvents);
+  size_t before = BlocksInUse();
+  for (int i = 0; i < kEvents; i++) {
+    copies.push_back(path);
+  }
+  size_t copyAllocations = BlocksInUse() - before;
+
+  std::vector<InternedPath> interned;
+  interned.reserve(kEvents);
+  before = BlocksInUse();
+  for (int i = 0; i < kEvents; i++) {
+    interned.push_back(sut->Intern(path));
+  }
+  size_t internAllocations = BlocksInUse() - before;
+
+  NSLog(@"Retaining %d copies of a path: %zu allocations as std::string, %zu interned", kEvents,
+        copyAllocations, internAllocations);
+  XCTAssertGreaterThanOrEqual(copyAllocations, kEvents);
+  // Allow some slack for unrelated allocations made by other threads
+  XCTAssertLessThan(internAllocations, 100);
+}
+
+@end
@@ -39,6 +39,13 @@ class PowerMonitor : public PassKey<PowerMonitor> {
  public:
   static std::unique_ptr<PowerMonitor> Create(PowerEventBlock callback);
 
+  // Returns true if the system is currently drawing from a battery
+  static bool IsOnBatteryPower();
+
+  // Returns how long it has been since the last keyboard or mouse input, or 0
+  // if it can't be determined
+  static uint64_t SecondsSinceLastUserInput();
+
   PowerMonitor(PassKey, PowerEventBlock callback, io_connect_t connect,
                IONotificationPortRef notify_port, io_object_t notifier, dispatch_queue_t queue);
 
@@ -14,7 +14,10 @@
 
 #include "Source/common/PowerMonitor.h"
 
+#include <CoreFoundation/CoreFoundation.h>
 #include <IOKit/IOMessage.h>
+#include <IOKit/ps/IOPSKeys.h>
+#include <IOKit/ps/IOPowerSources.h>
 #include <IOKit/pwr_mgt/IOPMLib.h>
 
 #import "Source/common/SNTLogging.h"
@@ -86,6 +89,39 @@ PowerMonitor::~PowerMonitor() {
   }
 }
 
+bool PowerMonitor::IsOnBatteryPower() {
+  CFTypeRef info = IOPSCopyPowerSourcesInfo();
+  if (!info) {
+    return false;
+  }
+
+  CFStringRef source = IOPSGetProvidingPowerSourceType(info);
+  bool on_battery = source && CFEqual(source, CFSTR(kIOPMBatteryPowerKey));
+  CFRelease(info);
+  return on_battery;
+}
+
+uint64_t PowerMonitor::SecondsSinceLastUserInput() {
+  io_service_t hid_system =
+      IOServiceGetMatchingService(kIOMainPortDefault, IOServiceMatching("IOHIDSystem"));
+  if (hid_system == IO_OBJECT_NULL) {
+    return 0;
+  }
+
+  uint64_t idle_nanos = 0;
+  CFTypeRef idle_time =
+      IORegistryEntryCreateCFProperty(hid_system, CFSTR("HIDIdleTime"), kCFAllocatorDefault, 0);
+  if (idle_time) {
+    if (CFGetTypeID(idle_time) == CFNumberGetTypeID()) {
+      CFNumberGetValue((CFNumberRef)idle_time, kCFNumberSInt64Type, &idle_nanos);
+    }
+    CFRelease(idle_time);
+  }
+  IOObjectRelease(hid_system);
+
+  return idle_nanos / NSEC_PER_SEC;
+}
+
 void PowerMonitor::PowerCallback(void* refcon, io_service_t service, natural_t message_type,
                                  void* message_argument) {
   auto* monitor = static_cast<PowerMonitor*>(refcon);
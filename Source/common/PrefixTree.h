@@ -16,10 +16,19 @@
 #ifndef SANTA_COMMON_PREFIXTREE_H
 #define SANTA_COMMON_PREFIXTREE_H
 
+#include <string.h>
 #include <sys/syslimits.h>
 
+#include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "Source/common/Published.h"
 #import "Source/common/SNTLogging.h"
 #include "absl/synchronization/mutex.h"
 
@@ -31,7 +40,20 @@
 
 namespace santa {
 
-template <typename ValueT>
+///
+///  Determines how PrefixTree stores its nodes.
+///
+enum class PrefixTreeLayout {
+  // One node per byte, each with a 256 entry child table.
+  kByteTrie,
+  // Path compressed radix tree. See the kRadix specialization below.
+  kRadix,
+};
+
+template <typename ValueT, PrefixTreeLayout Layout>
+class PublishedPrefixTree;
+
+template <typename ValueT, PrefixTreeLayout Layout = PrefixTreeLayout::kByteTrie>
 class PrefixTree {
  private:
   // Forward declaration
@@ -64,6 +86,28 @@ class PrefixTree {
     return LookupLongestMatchingPrefixLocked(input);
   }
 
+  /// Look up the longest matching prefix of each of the `count` null
+  /// terminated `inputs`, storing the result for `inputs[i]` in `results[i]`.
+  /// The tree is locked once for the whole batch.
+  void LookupLongestMatchingPrefixes(const char* const* inputs, size_t count,
+                                     std::optional<ValueT>* results) {
+    absl::ReaderMutexLock lock(lock_);
+    LookupLongestMatchingPrefixesLocked(inputs, count, results);
+  }
+
+  /// Lookups that don't take the tree's lock. These are only safe on a tree
+  /// that is no longer modified, such as one owned by a published snapshot.
+  std::optional<ValueT> LookupLongestMatchingPrefixUnlocked(const std::string& input)
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    return LookupLongestMatchingPrefixLocked(input);
+  }
+
+  void LookupLongestMatchingPrefixesUnlocked(const char* const* inputs, size_t count,
+                                             std::optional<ValueT>* results)
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    LookupLongestMatchingPrefixesLocked(inputs, count, results);
+  }
+
   /// Returns true if the tree contains any prefix or literal
   /// string that matches the input, otherwise false.
   bool Contains(const char* input) {
@@ -87,6 +131,13 @@ class PrefixTree {
     return node_count_;
   }
 
+  /// Approximate bytes used by the tree's nodes, not including memory owned
+  /// by values.
+  size_t ApproximateBytes() {
+    absl::ReaderMutexLock lock(lock_);
+    return sizeof(*this) + ((size_t)node_count_ + 1) * sizeof(TreeNode);
+  }
+
 #if SANTA_PREFIX_TREE_DEBUG
   void Print() {
     std::vector<char> buf(max_depth_ + 1);
@@ -97,6 +148,9 @@ class PrefixTree {
 #endif
 
  private:
+  template <typename, PrefixTreeLayout>
+  friend class PublishedPrefixTree;
+
   ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_)
   bool InsertLocked(const char* input, ValueT value, NodeType node_type) {
     const char* p = input;
@@ -188,9 +242,24 @@ class PrefixTree {
 
   ABSL_SHARED_LOCKS_REQUIRED(lock_)
   std::optional<ValueT> LookupLongestMatchingPrefixLocked(const std::string& input) {
+    TreeNode* match = FindLongestMatchLocked(input.c_str());
+    return match ? std::make_optional<ValueT>(match->value_) : std::nullopt;
+  }
+
+  ABSL_SHARED_LOCKS_REQUIRED(lock_)
+  void LookupLongestMatchingPrefixesLocked(const char* const* inputs, size_t count,
+                                           std::optional<ValueT>* results) {
+    for (size_t i = 0; i < count; i++) {
+      TreeNode* match = FindLongestMatchLocked(inputs[i]);
+      results[i] = match ? std::make_optional<ValueT>(match->value_) : std::nullopt;
+    }
+  }
+
+  ABSL_SHARED_LOCKS_REQUIRED(lock_)
+  TreeNode* FindLongestMatchLocked(const char* input) {
     TreeNode* node = root_;
     TreeNode* match = nullptr;
-    const char* p = input.c_str();
+    const char* p = input;
 
     while (*p) {
       node = node->children_[(uint8_t)*p++];
@@ -205,7 +274,7 @@ class PrefixTree {
       }
     }
 
-    return match ? std::make_optional<ValueT>(match->value_) : std::nullopt;
+    return match;
   }
 
   ABSL_SHARED_LOCKS_REQUIRED(lock_)
@@ -311,7 +380,7 @@ class PrefixTree {
   ///  byte), would drastically decrease the memory footprint but would double
   ///  required dereferences.
   ///
-  ///  TODO(bur): Potentially convert this into a full on radix tree.
+  ///  See PrefixTreeLayout::kRadix for a path compressed alternative.
   ///
   class TreeNode {
    public:
@@ -328,6 +397,470 @@ class PrefixTree {
   absl::Mutex lock_;
 };
 
+///
+///  A path compressed variant of PrefixTree, selected with
+///  PrefixTreeLayout::kRadix. The public interface is identical.
+///
+///  Each node holds the label of the edge leading to it, so a run of bytes
+///  with no branches costs one node instead of one node per byte. The first
+///  byte of every child's label is kept in a contiguous array next to the
+///  child pointers. Finding a child scans that array, 16 bytes at a time with
+///  NEON where available. Lookups never allocate.
+///
+///  NodeCount returns the number of radix nodes, which is at most twice the
+///  number of inserted strings.
+///
+template <typename ValueT>
+class PrefixTree<ValueT, PrefixTreeLayout::kRadix> {
+ private:
+  enum class NodeType;
+  struct RadixNode;
+
+ public:
+  PrefixTree(uint32_t max_depth = PATH_MAX)
+      : root_(new RadixNode()), max_depth_(max_depth), node_count_(0) {}
+
+  ~PrefixTree() { PruneLocked(root_); }
+
+  bool InsertPrefix(const char* s, ValueT value) {
+    absl::MutexLock lock(lock_);
+    return InsertLocked(s, value, NodeType::kPrefix);
+  }
+
+  bool InsertLiteral(const char* s, ValueT value) {
+    absl::MutexLock lock(lock_);
+    return InsertLocked(s, value, NodeType::kLiteral);
+  }
+
+  bool HasPrefix(const char* input) {
+    absl::ReaderMutexLock lock(lock_);
+    return HasPrefixLocked(input);
+  }
+
+  std::optional<ValueT> LookupLongestMatchingPrefix(const std::string& input) {
+    absl::ReaderMutexLock lock(lock_);
+    return LookupLongestMatchingPrefixLocked(input);
+  }
+
+  /// Look up the longest matching prefix of each of the `count` null
+  /// terminated `inputs`, storing the result for `inputs[i]` in `results[i]`.
+  /// The tree is locked once for the whole batch.
+  void LookupLongestMatchingPrefixes(const char* const* inputs, size_t count,
+                                     std::optional<ValueT>* results) {
+    absl::ReaderMutexLock lock(lock_);
+    LookupLongestMatchingPrefixesLocked(inputs, count, results);
+  }
+
+  /// Lookups that don't take the tree's lock. These are only safe on a tree
+  /// that is no longer modified, such as one owned by a published snapshot.
+  std::optional<ValueT> LookupLongestMatchingPrefixUnlocked(const std::string& input)
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    return LookupLongestMatchingPrefixLocked(input);
+  }
+
+  void LookupLongestMatchingPrefixesUnlocked(const char* const* inputs, size_t count,
+                                             std::optional<ValueT>* results)
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    LookupLongestMatchingPrefixesLocked(inputs, count, results);
+  }
+
+  /// Returns true if the tree contains any prefix or literal
+  /// string that matches the input, otherwise false.
+  bool Contains(const char* input) {
+    if (!input) {
+      return false;
+    }
+
+    absl::ReaderMutexLock lock(lock_);
+    return ContainsLocked(input);
+  }
+
+  void Reset() {
+    absl::MutexLock lock(lock_);
+    PruneLocked(root_);
+    root_ = new RadixNode();
+    node_count_ = 0;
+  }
+
+  uint32_t NodeCount() {
+    absl::ReaderMutexLock lock(lock_);
+    return node_count_;
+  }
+
+  size_t ApproximateBytes() {
+    absl::ReaderMutexLock lock(lock_);
+    size_t bytes = sizeof(*this);
+    std::vector<const RadixNode*> stack = {root_};
+    while (!stack.empty()) {
+      const RadixNode* node = stack.back();
+      stack.pop_back();
+      bytes += sizeof(RadixNode) + node->label.capacity() + node->child_keys.capacity() +
+               node->children.capacity() * sizeof(RadixNode*);
+      stack.insert(stack.end(), node->children.begin(), node->children.end());
+    }
+    return bytes;
+  }
+
+#if SANTA_PREFIX_TREE_DEBUG
+  void Print() {
+    std::string buf;
+
+    absl::ReaderMutexLock lock(lock_);
+    PrintLocked(root_, buf);
+  }
+#endif
+
+ private:
+  template <typename, PrefixTreeLayout>
+  friend class PublishedPrefixTree;
+
+  // Number of leading bytes of `p` that match `label`. Labels never contain
+  // a null byte so the end of `p` always stops the comparison.
+  static size_t MatchLength(const std::string& label, const char* p) {
+    size_t i = 0;
+    while (i < label.size() && label[i] == p[i]) {
+      i++;
+    }
+    return i;
+  }
+
+  // Index of the child whose label starts with `byte`, or -1 if none.
+  static int FindChild(const RadixNode* node, uint8_t byte) {
+    const uint8_t* keys = node->child_keys.data();
+    size_t count = node->child_keys.size();
+    size_t i = 0;
+#if defined(__aarch64__)
+    uint8x16_t needle = vdupq_n_u8(byte);
+    for (; i + 16 <= count; i += 16) {
+      uint8x16_t eq = vceqq_u8(vld1q_u8(keys + i), needle);
+      // Narrow each 8-bit lane to 4 bits so the result fits in 64 bits
+      uint64_t mask =
+          vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+      if (mask) {
+        return (int)(i + (__builtin_ctzll(mask) >> 2));
+      }
+    }
+#endif
+    for (; i < count; i++) {
+      if (keys[i] == byte) {
+        return (int)i;
+      }
+    }
+    return -1;
+  }
+
+  static void AddChild(RadixNode* node, RadixNode* child) {
+    node->child_keys.push_back((uint8_t)child->label[0]);
+    node->children.push_back(child);
+  }
+
+  ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_)
+  RadixNode* NewNodeLocked(const char* label, size_t length) {
+    RadixNode* node = new RadixNode();
+    node->label.assign(label, length);
+    node_count_++;
+    return node;
+  }
+
+  ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_)
+  bool InsertLocked(const char* input, ValueT value, NodeType node_type) {
+    size_t length = strlen(input);
+    if (length == 0 || length > max_depth_) {
+      return false;
+    }
+
+    const char* p = input;
+    RadixNode* node = root_;
+
+    while (true) {
+      int idx = FindChild(node, (uint8_t)*p);
+      if (idx < 0) {
+        // No edge starts with the next byte, the rest of the input becomes
+        // a new leaf
+        RadixNode* leaf = NewNodeLocked(p, input + length - p);
+        leaf->node_type = node_type;
+        leaf->value = value;
+        AddChild(node, leaf);
+        return true;
+      }
+
+      RadixNode* child = node->children[idx];
+      size_t matched = MatchLength(child->label, p);
+      if (matched < child->label.size()) {
+        // The input diverges from, or ends within, the child's label. Split
+        // the edge so the shared part gets its own node.
+        RadixNode* mid = NewNodeLocked(child->label.data(), matched);
+        child->label.erase(0, matched);
+        AddChild(mid, child);
+        node->children[idx] = mid;
+        child = mid;
+      }
+
+      p += matched;
+      if (*p == '\0') {
+        // Note: The node's data will be overwritten
+        child->node_type = node_type;
+        child->value = value;
+        return true;
+      }
+
+      node = child;
+    }
+  }
+
+  ABSL_SHARED_LOCKS_REQUIRED(lock_)
+  bool HasPrefixLocked(const char* input) {
+    return FindLongestMatchLocked(input, true) != nullptr;
+  }
+
+  ABSL_SHARED_LOCKS_REQUIRED(lock_)
+  std::optional<ValueT> LookupLongestMatchingPrefixLocked(const std::string& input) {
+    RadixNode* match = FindLongestMatchLocked(input.c_str(), false);
+    return match ? std::make_optional<ValueT>(match->value) : std::nullopt;
+  }
+
+  ABSL_SHARED_LOCKS_REQUIRED(lock_)
+  bool ContainsLocked(const char* input) {
+    return FindLongestMatchLocked(input, true) != nullptr;
+  }
+
+  // Inputs in a batch often share a leading path, e.g. the source and
+  // destination of a rename within one directory. Each input resumes the walk
+  // of the previous one from the deepest node lying within their common
+  // prefix instead of starting again at the root.
+  ABSL_SHARED_LOCKS_REQUIRED(lock_)
+  void LookupLongestMatchingPrefixesLocked(const char* const* inputs, size_t count,
+                                           std::optional<ValueT>* results) {
+    WalkState trail[kMaxTrail];
+    size_t trail_len = 0;
+    const char* prev = nullptr;
+
+    for (size_t i = 0; i < count; i++) {
+      const char* input = inputs[i];
+      WalkState state{0, root_, nullptr};
+
+      if (prev) {
+        size_t common = 0;
+        while (prev[common] && prev[common] == input[common]) {
+          common++;
+        }
+
+        // A step that ends exactly where the inputs diverge can only be reused
+        // if both inputs end there, since literal matches depend on it
+        while (trail_len > 0 &&
+               (trail[trail_len - 1].consumed > common ||
+                (trail[trail_len - 1].consumed == common && input[common] != prev[common]))) {
+          trail_len--;
+        }
+        if (trail_len > 0) {
+          state = trail[trail_len - 1];
+        }
+      }
+
+      const char* p = input + state.consumed;
+      RadixNode* node = state.node;
+      RadixNode* match = state.match;
+
+      while (*p) {
+        int idx = FindChild(node, (uint8_t)*p);
+        if (idx < 0) {
+          break;
+        }
+
+        node = node->children[idx];
+        size_t matched = MatchLength(node->label, p);
+        if (matched < node->label.size()) {
+          break;
+        }
+        p += matched;
+
+        if (node->node_type == NodeType::kPrefix ||
+            (*p == '\0' && node->node_type == NodeType::kLiteral)) {
+          match = node;
+        }
+
+        if (trail_len < kMaxTrail) {
+          trail[trail_len++] = {(size_t)(p - input), node, match};
+        }
+      }
+
+      results[i] = match ? std::make_optional<ValueT>(match->value) : std::nullopt;
+      prev = input;
+    }
+  }
+
+  // Returns the deepest node that matches the input, or nullptr. When
+  // `first` is true the first match is returned instead.
+  ABSL_SHARED_LOCKS_REQUIRED(lock_)
+  RadixNode* FindLongestMatchLocked(const char* input, bool first) {
+    RadixNode* node = root_;
+    RadixNode* match = nullptr;
+    const char* p = input;
+
+    while (*p) {
+      int idx = FindChild(node, (uint8_t)*p);
+      if (idx < 0) {
+        break;
+      }
+
+      node = node->children[idx];
+      size_t matched = MatchLength(node->label, p);
+      if (matched < node->label.size()) {
+        break;
+      }
+      p += matched;
+
+      if (node->node_type == NodeType::kPrefix ||
+          (*p == '\0' && node->node_type == NodeType::kLiteral)) {
+        match = node;
+        if (first) {
+          break;
+        }
+      }
+    }
+
+    return match;
+  }
+
+  ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_)
+  void PruneLocked(RadixNode* target) {
+    if (!target) {
+      return;
+    }
+
+    // Walk the tree without recursion since it may be deep
+    std::vector<RadixNode*> stack;
+    stack.push_back(target);
+
+    while (!stack.empty()) {
+      RadixNode* node = stack.back();
+      stack.pop_back();
+      stack.insert(stack.end(), node->children.begin(), node->children.end());
+
+      if (node != root_) {
+        --node_count_;
+      }
+      delete node;
+    }
+  }
+
+#if SANTA_PREFIX_TREE_DEBUG
+  ABSL_SHARED_LOCKS_REQUIRED(lock_)
+  void PrintLocked(RadixNode* node, std::string& buf) {
+    for (RadixNode* child : node->children) {
+      size_t len = buf.size();
+      buf += child->label;
+      if (child->node_type != NodeType::kInner) {
+        printf("\t%s (type: %s)\n", buf.c_str(),
+               child->node_type == NodeType::kPrefix ? "prefix" : "literal");
+      }
+      PrintLocked(child, buf);
+      buf.resize(len);
+    }
+  }
+#endif
+
+  enum class NodeType {
+    kInner = 0,
+    kPrefix,
+    kLiteral,
+  };
+
+  // A point in a walk: `consumed` bytes of the input led to `node`, and
+  // `match` is the deepest match seen on the way.
+  struct WalkState {
+    size_t consumed;
+    RadixNode* node;
+    RadixNode* match;
+  };
+
+  // Walks deeper than this are not resumed past the last recorded node
+  static constexpr size_t kMaxTrail = 32;
+
+  struct RadixNode {
+    // Label of the edge from the parent. Empty only for the root.
+    std::string label;
+    // First byte of each child's label, in the same order as `children`
+    std::vector<uint8_t> child_keys;
+    std::vector<RadixNode*> children;
+    NodeType node_type = NodeType::kInner;
+    ValueT value;
+  };
+
+  RadixNode* root_;
+  const uint32_t max_depth_;
+  uint32_t node_count_ ABSL_GUARDED_BY(lock_);
+  absl::Mutex lock_;
+};
+
+///
+///  Holds an immutable PrefixTree that readers query without taking any lock.
+///  See Published for how readers and Publish interact. A read only lasts as
+///  long as the lookup itself.
+///
+template <typename ValueT, PrefixTreeLayout Layout = PrefixTreeLayout::kByteTrie>
+class PublishedPrefixTree {
+ public:
+  using Tree = PrefixTree<ValueT, Layout>;
+
+  PublishedPrefixTree() : PublishedPrefixTree(std::make_shared<Tree>()) {}
+
+  explicit PublishedPrefixTree(std::shared_ptr<Tree> tree) : published_(std::move(tree)) {}
+
+  PublishedPrefixTree(PublishedPrefixTree&& other) = delete;
+  PublishedPrefixTree& operator=(PublishedPrefixTree&& rhs) = delete;
+  PublishedPrefixTree(const PublishedPrefixTree& other) = delete;
+  PublishedPrefixTree& operator=(const PublishedPrefixTree& other) = delete;
+
+  /// Replace the tree seen by readers. The tree must not be modified after it
+  /// has been published.
+  void Publish(std::shared_ptr<Tree> tree) { published_.Publish(std::move(tree)); }
+
+  bool HasPrefix(const char* input) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    ReadGuard tree(published_);
+    return tree->HasPrefixLocked(input);
+  }
+
+  std::optional<ValueT> LookupLongestMatchingPrefix(const std::string& input)
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    ReadGuard tree(published_);
+    return tree->LookupLongestMatchingPrefixLocked(input);
+  }
+
+  void LookupLongestMatchingPrefixes(const char* const* inputs, size_t count,
+                                     std::optional<ValueT>* results)
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    ReadGuard tree(published_);
+    tree->LookupLongestMatchingPrefixesLocked(inputs, count, results);
+  }
+
+  /// Returns true if the tree contains any prefix or literal
+  /// string that matches the input, otherwise false.
+  bool Contains(const char* input) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    if (!input) {
+      return false;
+    }
+
+    ReadGuard tree(published_);
+    return tree->ContainsLocked(input);
+  }
+
+  uint32_t NodeCount() {
+    ReadGuard tree(published_);
+    return tree->NodeCount();
+  }
+
+  size_t ApproximateBytes() {
+    ReadGuard tree(published_);
+    return tree->ApproximateBytes();
+  }
+
+ private:
+  using ReadGuard = typename Published<Tree>::ReadGuard;
+
+  Published<Tree> published_;
+};
+
 }  // namespace santa
 
 #endif  // SANTA_COMMON_PREFIXTREE_H
@@ -17,12 +17,23 @@
 #include "Source/common/PrefixTree.h"
 
 #import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
 
 #include "Source/common/Unit.h"
 
 using santa::PrefixTree;
+using santa::PrefixTreeLayout;
+using santa::PublishedPrefixTree;
 using santa::Unit;
 
+template <typename ValueT>
+using RadixTree = PrefixTree<ValueT, PrefixTreeLayout::kRadix>;
+
 @interface PrefixTreeTest : XCTestCase
 @end
 
@@ -246,4 +257,262 @@ using santa::Unit;
   stop = YES;
 }
 
+- (void)testRadixBasic {
+  RadixTree<int> tree;
+
+  XCTAssertTrue(tree.InsertPrefix("/foo", 12));
+  XCTAssertTrue(tree.InsertPrefix("/bar", 34));
+  XCTAssertTrue(tree.InsertLiteral("/foo/bar", 56));
+  XCTAssertTrue(tree.InsertPrefix("/foo/bar.txt", 78));
+
+  XCTAssertTrue(tree.HasPrefix("/foo/bar/baz"));
+  XCTAssertTrue(tree.Contains("/bar"));
+  XCTAssertFalse(tree.Contains("/ba"));
+  XCTAssertFalse(tree.HasPrefix("/baz"));
+
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/foo/bar").value_or(0), 56);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/foo/bar/baz").value_or(0), 12);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/foo/bar.txt.tmp").value_or(0), 78);
+  XCTAssertFalse(tree.LookupLongestMatchingPrefix("/fo").has_value());
+
+  // Empty and overly long strings are not supported
+  XCTAssertFalse(tree.InsertLiteral("", 0));
+  XCTAssertFalse(tree.InsertPrefix(std::string(PATH_MAX + 1, 'A').c_str(), 0));
+}
+
+- (void)testRadixNodeCounts {
+  RadixTree<int> tree;
+
+  // A single string is one node regardless of length
+  XCTAssertTrue(tree.InsertPrefix("asdf", 0));
+  XCTAssertEqual(tree.NodeCount(), 1);
+
+  // Extending it adds one node
+  XCTAssertTrue(tree.InsertPrefix("asdfgh", 0));
+  XCTAssertEqual(tree.NodeCount(), 2);
+
+  // Diverging in the middle of an edge splits it
+  XCTAssertTrue(tree.InsertPrefix("asxy", 0));
+  XCTAssertEqual(tree.NodeCount(), 4);
+
+  // Ending on an existing split point only changes the node type
+  XCTAssertTrue(tree.InsertLiteral("as", 0));
+  XCTAssertEqual(tree.NodeCount(), 4);
+  XCTAssertFalse(tree.HasPrefix("asz"));
+
+  tree.Reset();
+  XCTAssertEqual(tree.NodeCount(), 0);
+  XCTAssertFalse(tree.HasPrefix("asdf"));
+}
+
+- (void)testApproximateBytes {
+  PrefixTree<int> trie;
+  RadixTree<int> radix;
+  size_t trie_empty = trie.ApproximateBytes();
+  size_t radix_empty = radix.ApproximateBytes();
+
+  for (const char* path : {"/usr/bin", "/usr/lib", "/private/var/folders"}) {
+    XCTAssertTrue(trie.InsertPrefix(path, 0));
+    XCTAssertTrue(radix.InsertPrefix(path, 0));
+  }
+
+  XCTAssertGreaterThan(trie.ApproximateBytes(), trie_empty);
+  XCTAssertGreaterThan(radix.ApproximateBytes(), radix_empty);
+
+  // Path compression is the point of the radix layout
+  XCTAssertLessThan(radix.ApproximateBytes(), trie.ApproximateBytes());
+}
+
+- (void)testRadixWideFanout {
+  // Enough children on one node to cover the vectorized child search
+  RadixTree<int> tree;
+  for (int i = 0; i < 200; i++) {
+    std::string s = "/";
+    s += (char)(i + 1);
+    XCTAssertTrue(tree.InsertPrefix(s.c_str(), i));
+  }
+
+  for (int i = 0; i < 200; i++) {
+    std::string s = "/";
+    s += (char)(i + 1);
+    s += "/file";
+    XCTAssertEqual(tree.LookupLongestMatchingPrefix(s).value_or(-1), i);
+  }
+  XCTAssertFalse(tree.HasPrefix("/"));
+}
+
+- (void)testRadixMatchesByteTrie {
+  std::mt19937 gen(0xBEEFCAFE);
+  auto randomString = [&gen]() {
+    static const char kAlphabet[] = "ab/c";
+    std::string s;
+    size_t length = gen() % 24;
+    for (size_t i = 0; i < length; i++) {
+      s += kAlphabet[gen() % 4];
+    }
+    return s;
+  };
+
+  for (int round = 0; round < 100; round++) {
+    PrefixTree<int> byteTrie(16);
+    RadixTree<int> radix(16);
+
+    for (int i = 0; i < 32; i++) {
+      std::string s = randomString();
+      int value = (int)(gen() % 100);
+      if (gen() % 2) {
+        XCTAssertEqual(byteTrie.InsertPrefix(s.c_str(), value),
+                       radix.InsertPrefix(s.c_str(), value));
+      } else {
+        XCTAssertEqual(byteTrie.InsertLiteral(s.c_str(), value),
+                       radix.InsertLiteral(s.c_str(), value));
+      }
+    }
+
+    for (int i = 0; i < 256; i++) {
+      std::string s = randomString();
+      XCTAssertEqual(byteTrie.HasPrefix(s.c_str()), radix.HasPrefix(s.c_str()));
+      XCTAssertEqual(byteTrie.Contains(s.c_str()), radix.Contains(s.c_str()));
+      XCTAssertTrue(byteTrie.LookupLongestMatchingPrefix(s) ==
+                    radix.LookupLongestMatchingPrefix(s));
+    }
+  }
+}
+
+- (void)testBatchedLookupMatchesSingleLookups {
+  std::mt19937 gen(0xFACEFEED);
+  auto randomString = [&gen]() {
+    static const char kAlphabet[] = "ab/c";
+    std::string s;
+    size_t length = gen() % 24;
+    for (size_t i = 0; i < length; i++) {
+      s += kAlphabet[gen() % 4];
+    }
+    return s;
+  };
+
+  for (int round = 0; round < 100; round++) {
+    PrefixTree<int> byteTrie;
+    RadixTree<int> radix;
+
+    for (int i = 0; i < 32; i++) {
+      std::string s = randomString();
+      int value = (int)(gen() % 100);
+      if (gen() % 2) {
+        byteTrie.InsertPrefix(s.c_str(), value);
+        radix.InsertPrefix(s.c_str(), value);
+      } else {
+        byteTrie.InsertLiteral(s.c_str(), value);
+        radix.InsertLiteral(s.c_str(), value);
+      }
+    }
+
+    for (int i = 0; i < 64; i++) {
+      // Inputs often extend or truncate the previous one so that batched
+      // walks are resumed from many different points
+      std::string inputs[4];
+      const char* ptrs[4];
+      for (int k = 0; k < 4; k++) {
+        if (k > 0 && gen() % 2) {
+          inputs[k] = inputs[k - 1].substr(0, gen() % (inputs[k - 1].size() + 1));
+          if (gen() % 2) {
+            inputs[k] += randomString();
+          }
+        } else {
+          inputs[k] = randomString();
+        }
+        ptrs[k] = inputs[k].c_str();
+      }
+
+      std::optional<int> byteTrieResults[4];
+      std::optional<int> radixResults[4];
+      byteTrie.LookupLongestMatchingPrefixes(ptrs, 4, byteTrieResults);
+      radix.LookupLongestMatchingPrefixes(ptrs, 4, radixResults);
+
+      for (int k = 0; k < 4; k++) {
+        std::optional<int> want = byteTrie.LookupLongestMatchingPrefix(inputs[k]);
+        XCTAssertTrue(byteTrieResults[k] == want);
+        XCTAssertTrue(radixResults[k] == want);
+      }
+    }
+  }
+}
+
+- (void)testPublishedBasic {
+  PublishedPrefixTree<int> published;
+  XCTAssertFalse(published.HasPrefix("/foo"));
+  XCTAssertEqual(published.NodeCount(), 0);
+
+  auto tree = std::make_shared<PrefixTree<int>>();
+  tree->InsertPrefix("/foo", 1);
+  tree->InsertLiteral("/bar", 2);
+  published.Publish(tree);
+
+  XCTAssertTrue(published.HasPrefix("/foo/baz"));
+  XCTAssertFalse(published.HasPrefix("/bar/baz"));
+  XCTAssertTrue(published.Contains("/bar"));
+  XCTAssertFalse(published.Contains(nullptr));
+  XCTAssertEqual(published.LookupLongestMatchingPrefix("/foo/baz").value_or(0), 1);
+  XCTAssertEqual(published.NodeCount(), 2);
+
+  // Publishing a new tree replaces the old one entirely
+  auto next = std::make_shared<PrefixTree<int>>();
+  next->InsertPrefix("/bar", 3);
+  published.Publish(next);
+
+  XCTAssertFalse(published.HasPrefix("/foo/baz"));
+  XCTAssertEqual(published.LookupLongestMatchingPrefix("/bar/baz").value_or(0), 3);
+
+  // The published tree holds its own reference
+  tree.reset();
+  next.reset();
+  XCTAssertTrue(published.HasPrefix("/bar/baz"));
+}
+
+- (void)testPublishedRadix {
+  auto tree = std::make_shared<RadixTree<int>>();
+  tree->InsertPrefix("/usr/lib", 1);
+  tree->InsertPrefix("/usr/local", 2);
+
+  PublishedPrefixTree<int, PrefixTreeLayout::kRadix> published(tree);
+  XCTAssertEqual(published.LookupLongestMatchingPrefix("/usr/local/bin").value_or(0), 2);
+  XCTAssertFalse(published.HasPrefix("/usr/bin"));
+}
+
+- (void)testPublishedConcurrentReaders {
+  auto makeTree = [](int value) {
+    auto tree = std::make_shared<PrefixTree<int>>();
+    tree->InsertPrefix("/a", value);
+    tree->InsertPrefix("/b", value);
+    return tree;
+  };
+
+  auto published = std::make_shared<PublishedPrefixTree<int>>(makeTree(0));
+  __block std::atomic<bool> done{false};
+  __block std::atomic<int> bad{0};
+
+  // Every published tree is complete, so readers must always find both
+  // prefixes no matter how lookups interleave with publishes
+  dispatch_group_t group = dispatch_group_create();
+  for (int i = 0; i < 8; i++) {
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+      while (!done.load()) {
+        if (!published->LookupLongestMatchingPrefix("/a/file").has_value() ||
+            !published->HasPrefix("/b/file")) {
+          bad++;
+        }
+      }
+    });
+  }
+
+  for (int i = 1; i <= 1000; i++) {
+    published->Publish(makeTree(i));
+  }
+
+  done = true;
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+  XCTAssertEqual(bad.load(), 0);
+  XCTAssertEqual(published->LookupLongestMatchingPrefix("/a").value_or(0), 1000);
+}
+
 @end
@@ -0,0 +1,132 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_PUBLISHED_H
+#define SANTA_COMMON_PUBLISHED_H
+
+#include <sched.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+///
+///  Holds an immutable value that readers access without taking any lock.
+///
+///  Writers build a complete value and Publish it. Readers see either the
+///  previous value or the new one, never one that is partially built. Each
+///  read registers on a per-thread stripe of reader counters, so that reads on
+///  different cores don't contend on a shared cache line. Publish waits for
+///  reads that may still be using the previous value before releasing it, and
+///  must not be called from within a read. Reads should be kept short since
+///  they delay Publish.
+///
+///  The two reader epochs work like SRCU. A reader loads the epoch, counts
+///  itself in that epoch, and then loads the value. After swapping the value,
+///  Publish flips the epoch twice and waits each time for the epoch it left
+///  to drain.
+///
+template <typename T>
+class Published {
+ private:
+  // Forward declaration
+  struct Stripe;
+
+ public:
+  static constexpr int kStripes = 16;
+
+  explicit Published(std::shared_ptr<T> value) : value_(value.get()), owner_(std::move(value)) {}
+
+  Published(Published&& other) = delete;
+  Published& operator=(Published&& rhs) = delete;
+  Published(const Published& other) = delete;
+  Published& operator=(const Published& other) = delete;
+
+  /// Replace the value seen by readers. The value must not be null and must
+  /// not be modified after it has been published.
+  void Publish(std::shared_ptr<T> value) {
+    absl::MutexLock lock(publish_lock_);
+    value_.store(value.get(), std::memory_order_seq_cst);
+
+    for (int i = 0; i < 2; i++) {
+      uint32_t prev = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+      while (ActiveReaders(prev) != 0) {
+        sched_yield();
+      }
+    }
+
+    // No reader can still be using the previous value
+    owner_ = std::move(value);
+  }
+
+  /// Keeps the value that was current when it was created alive for as long
+  /// as it exists.
+  class ReadGuard {
+   public:
+    explicit ReadGuard(Published& published)
+        : stripe_(published.stripes_[StripeForCurrentThread()]),
+          epoch_(published.epoch_.load(std::memory_order_seq_cst) & 1) {
+      stripe_.readers[epoch_].fetch_add(1, std::memory_order_seq_cst);
+      value_ = published.value_.load(std::memory_order_seq_cst);
+    }
+
+    ~ReadGuard() { stripe_.readers[epoch_].fetch_sub(1, std::memory_order_release); }
+
+    ReadGuard(const ReadGuard& other) = delete;
+    ReadGuard& operator=(const ReadGuard& other) = delete;
+
+    T& operator*() const { return *value_; }
+    T* operator->() const { return value_; }
+
+   private:
+    Stripe& stripe_;
+    uint32_t epoch_;
+    T* value_;
+  };
+
+ private:
+  struct alignas(64) Stripe {
+    std::atomic<int64_t> readers[2] = {0, 0};
+  };
+
+  // Threads are assigned stripes round robin the first time they read
+  static int StripeForCurrentThread() {
+    static std::atomic<uint32_t> next_stripe{0};
+    thread_local int stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+    return stripe;
+  }
+
+  int64_t ActiveReaders(uint32_t epoch) {
+    int64_t count = 0;
+    for (Stripe& stripe : stripes_) {
+      count += stripe.readers[epoch].load(std::memory_order_acquire);
+    }
+    return count;
+  }
+
+  std::atomic<T*> value_;
+  std::atomic<uint32_t> epoch_{0};
+  Stripe stripes_[kStripes];
+  absl::Mutex publish_lock_;
+  std::shared_ptr<T> owner_ ABSL_GUARDED_BY(publish_lock_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_PUBLISHED_H
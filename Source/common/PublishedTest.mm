@@ -0,0 +1,92 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/Published.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <memory>
+
+using santa::Published;
+
+namespace {
+
+struct Pair {
+  int first;
+  int second;
+};
+
+}  // namespace
+
+@interface PublishedTest : XCTestCase
+@end
+
+@implementation PublishedTest
+
+- (void)testPublish {
+  Published<const Pair> published(std::make_shared<const Pair>(Pair{1, 1}));
+  {
+    Published<const Pair>::ReadGuard value(published);
+    XCTAssertEqual(value->first, 1);
+  }
+
+  auto next = std::make_shared<const Pair>(Pair{2, 2});
+  std::weak_ptr<const Pair> weakNext = next;
+  published.Publish(std::move(next));
+  {
+    Published<const Pair>::ReadGuard value(published);
+    XCTAssertEqual((*value).second, 2);
+  }
+
+  // The published value holds its own reference and releases it once replaced
+  XCTAssertFalse(weakNext.expired());
+  published.Publish(std::make_shared<const Pair>(Pair{3, 3}));
+  XCTAssertTrue(weakNext.expired());
+}
+
+- (void)testConcurrentReaders {
+  auto published = std::make_shared<Published<const Pair>>(std::make_shared<const Pair>(Pair{}));
+  __block std::atomic<bool> done{false};
+  __block std::atomic<int> bad{0};
+
+  // Every published value is complete, so readers must never see the two
+  // fields disagree no matter how reads interleave with publishes
+  dispatch_group_t group = dispatch_group_create();
+  for (int i = 0; i < 8; i++) {
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+      while (!done.load()) {
+        Published<const Pair>::ReadGuard value(*published);
+        if (value->first != value->second) {
+          bad++;
+        }
+      }
+    });
+  }
+
+  for (int i = 1; i <= 1000; i++) {
+    published->Publish(std::make_shared<const Pair>(Pair{i, i}));
+  }
+
+  done = true;
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+  XCTAssertEqual(bad.load(), 0);
+
+  Published<const Pair>::ReadGuard value(*published);
+  XCTAssertEqual(value->first, 1000);
+}
+
+@end
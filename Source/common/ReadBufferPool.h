@@ -0,0 +1,89 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_READBUFFERPOOL_H
+#define SANTA_COMMON_READBUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace santa {
+
+// Page-aligned buffers for reading files that are being hashed. Every hash
+// of a large binary needs a read window of kBufferSize, and leasing it from
+// here rather than malloc avoids large-allocation churn in the malloc zone
+// when many binaries are hashed at once.
+//
+// Requests of up to kBufferSize bytes are served from a small cache owned
+// by the calling thread, and buffers go back to the cache of the thread
+// that releases them. Larger requests are allocated and freed directly.
+// Each thread caches at most kMaxBuffersPerThread buffers, and at most
+// kMaxCachedBytes are cached across all threads.
+class ReadBufferPool {
+ public:
+  static constexpr size_t kBufferSize = 1u << 20;
+  static constexpr size_t kMaxBuffersPerThread = 4;
+  static constexpr size_t kMaxCachedBytes = 16u << 20;
+
+  // A leased buffer, returned to the pool when destroyed
+  class Buffer {
+   public:
+    Buffer() = default;
+    ~Buffer();
+
+    Buffer(Buffer&& other) noexcept;
+    Buffer& operator=(Buffer&& rhs) noexcept;
+    Buffer(const Buffer& other) = delete;
+    Buffer& operator=(const Buffer& other) = delete;
+
+    uint8_t* data() const { return data_; }
+    // The size that was requested, the allocation may be larger
+    size_t size() const { return size_; }
+
+   private:
+    friend class ReadBufferPool;
+    Buffer(uint8_t* data, size_t size, size_t capacity)
+        : data_(data), size_(size), capacity_(capacity) {}
+
+    void Release();
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+  };
+
+  struct Stats {
+    // Requests served from a thread's cache, and requests that allocated
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Bytes allocated by the pool, whether leased or cached, now and at
+    // the most since the last reset
+    uint64_t current_bytes = 0;
+    uint64_t peak_bytes = 0;
+  };
+
+  // Leases a buffer of at least `size` bytes with uninitialized contents.
+  // Throws std::bad_alloc if memory can not be allocated.
+  static Buffer Acquire(size_t size);
+
+  static Stats GetStats(bool reset);
+
+  // Frees the buffers cached by the calling thread
+  static void TrimCurrentThread();
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_READBUFFERPOOL_H
@@ -0,0 +1,172 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ReadBufferPool.h"
+
+#include <mach/mach.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <utility>
+
+namespace santa {
+
+namespace {
+
+std::atomic<uint64_t> hits{0};
+std::atomic<uint64_t> misses{0};
+std::atomic<uint64_t> current_bytes{0};
+std::atomic<uint64_t> peak_bytes{0};
+std::atomic<uint64_t> cached_bytes{0};
+
+uint8_t* AllocateAligned(size_t capacity) {
+  void* p = nullptr;
+  if (posix_memalign(&p, vm_page_size, capacity) != 0) {
+    throw std::bad_alloc();
+  }
+
+  uint64_t now = current_bytes.fetch_add(capacity, std::memory_order_relaxed) + capacity;
+  uint64_t prev_peak = peak_bytes.load(std::memory_order_relaxed);
+  while (now > prev_peak &&
+         !peak_bytes.compare_exchange_weak(prev_peak, now, std::memory_order_relaxed)) {
+  }
+  return static_cast<uint8_t*>(p);
+}
+
+void FreeAligned(uint8_t* p, size_t capacity) {
+  free(p);
+  current_bytes.fetch_sub(capacity, std::memory_order_relaxed);
+}
+
+// Trivially destructible, so it can still be read while other thread
+// locals are torn down on thread exit
+thread_local bool thread_cache_destroyed = false;
+
+struct ThreadCache {
+  ~ThreadCache() {
+    Trim();
+    thread_cache_destroyed = true;
+  }
+
+  void Trim() {
+    for (size_t i = 0; i < count; i++) {
+      FreeAligned(buffers[i], ReadBufferPool::kBufferSize);
+    }
+    cached_bytes.fetch_sub(count * ReadBufferPool::kBufferSize, std::memory_order_relaxed);
+    count = 0;
+  }
+
+  uint8_t* buffers[ReadBufferPool::kMaxBuffersPerThread] = {};
+  size_t count = 0;
+};
+
+ThreadCache* CurrentThreadCache() {
+  if (thread_cache_destroyed) {
+    return nullptr;
+  }
+  thread_local ThreadCache cache;
+  return &cache;
+}
+
+}  // namespace
+
+ReadBufferPool::Buffer::~Buffer() {
+  Release();
+}
+
+ReadBufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      capacity_(std::exchange(other.capacity_, 0)) {}
+
+ReadBufferPool::Buffer& ReadBufferPool::Buffer::operator=(Buffer&& rhs) noexcept {
+  if (this != &rhs) {
+    Release();
+    data_ = std::exchange(rhs.data_, nullptr);
+    size_ = std::exchange(rhs.size_, 0);
+    capacity_ = std::exchange(rhs.capacity_, 0);
+  }
+  return *this;
+}
+
+void ReadBufferPool::Buffer::Release() {
+  if (!data_) {
+    return;
+  }
+
+  uint8_t* data = std::exchange(data_, nullptr);
+  size_t capacity = std::exchange(capacity_, 0);
+  size_ = 0;
+
+  ThreadCache* cache = capacity == kBufferSize ? CurrentThreadCache() : nullptr;
+  if (cache && cache->count < kMaxBuffersPerThread) {
+    if (cached_bytes.fetch_add(capacity, std::memory_order_relaxed) + capacity <=
+        kMaxCachedBytes) {
+      cache->buffers[cache->count++] = data;
+      return;
+    }
+    cached_bytes.fetch_sub(capacity, std::memory_order_relaxed);
+  }
+
+  FreeAligned(data, capacity);
+}
+
+ReadBufferPool::Buffer ReadBufferPool::Acquire(size_t size) {
+  if (size == 0) {
+    return Buffer();
+  }
+
+  if (size > kBufferSize) {
+    misses.fetch_add(1, std::memory_order_relaxed);
+    size_t capacity = (size + vm_page_size - 1) & ~(size_t)(vm_page_size - 1);
+    return Buffer(AllocateAligned(capacity), size, capacity);
+  }
+
+  ThreadCache* cache = CurrentThreadCache();
+  if (cache && cache->count > 0) {
+    hits.fetch_add(1, std::memory_order_relaxed);
+    cached_bytes.fetch_sub(kBufferSize, std::memory_order_relaxed);
+    return Buffer(cache->buffers[--cache->count], size, kBufferSize);
+  }
+
+  misses.fetch_add(1, std::memory_order_relaxed);
+  return Buffer(AllocateAligned(kBufferSize), size, kBufferSize);
+}
+
+ReadBufferPool::Stats ReadBufferPool::GetStats(bool reset) {
+  Stats stats;
+  stats.current_bytes = current_bytes.load(std::memory_order_relaxed);
+  if (reset) {
+    stats.hits = hits.exchange(0, std::memory_order_relaxed);
+    stats.misses = misses.exchange(0, std::memory_order_relaxed);
+    stats.peak_bytes = peak_bytes.exchange(stats.current_bytes, std::memory_order_relaxed);
+  } else {
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.peak_bytes = peak_bytes.load(std::memory_order_relaxed);
+  }
+  stats.peak_bytes = std::max(stats.peak_bytes, stats.current_bytes);
+  return stats;
+}
+
+void ReadBufferPool::TrimCurrentThread() {
+  if (ThreadCache* cache = CurrentThreadCache()) {
+    cache->Trim();
+  }
+}
+
+}  // namespace santa
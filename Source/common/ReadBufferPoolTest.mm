@@ -0,0 +1,142 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ReadBufferPool.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <mach/mach.h>
+
+#include <cstring>
+#include <vector>
+
+using santa::ReadBufferPool;
+
+@interface ReadBufferPoolTest : XCTestCase
+@end
+
+@implementation ReadBufferPoolTest
+
+- (void)setUp {
+  ReadBufferPool::TrimCurrentThread();
+  ReadBufferPool::GetStats(true);
+}
+
+- (void)tearDown {
+  ReadBufferPool::TrimCurrentThread();
+}
+
+- (void)testAcquireIsPageAligned {
+  for (size_t size : {1ul, 4096ul, ReadBufferPool::kBufferSize, ReadBufferPool::kBufferSize + 1}) {
+    ReadBufferPool::Buffer buf = ReadBufferPool::Acquire(size);
+    XCTAssertNotEqual(buf.data(), nullptr);
+    XCTAssertEqual(buf.size(), size);
+    XCTAssertEqual((uintptr_t)buf.data() % vm_page_size, 0);
+    std::memset(buf.data(), 0xab, buf.size());
+  }
+
+  XCTAssertEqual(ReadBufferPool::Acquire(0).data(), nullptr);
+}
+
+- (void)testReleasedBuffersAreReused {
+  uint8_t* first;
+  {
+    ReadBufferPool::Buffer buf = ReadBufferPool::Acquire(ReadBufferPool::kBufferSize);
+    first = buf.data();
+  }
+
+  // Smaller requests are served from the same size class
+  ReadBufferPool::Buffer buf = ReadBufferPool::Acquire(100);
+  XCTAssertEqual(buf.data(), first);
+
+  ReadBufferPool::Stats stats = ReadBufferPool::GetStats(false);
+  XCTAssertEqual(stats.hits, 1);
+  XCTAssertEqual(stats.misses, 1);
+}
+
+- (void)testLargeBuffersAreNotCached {
+  { ReadBufferPool::Buffer buf = ReadBufferPool::Acquire(ReadBufferPool::kBufferSize * 2); }
+  { ReadBufferPool::Buffer buf = ReadBufferPool::Acquire(ReadBufferPool::kBufferSize * 2); }
+
+  ReadBufferPool::Stats stats = ReadBufferPool::GetStats(false);
+  XCTAssertEqual(stats.hits, 0);
+  XCTAssertEqual(stats.misses, 2);
+  XCTAssertEqual(stats.current_bytes, 0);
+  XCTAssertEqual(stats.peak_bytes, ReadBufferPool::kBufferSize * 2);
+}
+
+- (void)testCacheIsBounded {
+  {
+    std::vector<ReadBufferPool::Buffer> bufs;
+    for (size_t i = 0; i < ReadBufferPool::kMaxBuffersPerThread * 2; i++) {
+      bufs.push_back(ReadBufferPool::Acquire(ReadBufferPool::kBufferSize));
+    }
+    XCTAssertEqual(ReadBufferPool::GetStats(false).current_bytes,
+                   ReadBufferPool::kMaxBuffersPerThread * 2 * ReadBufferPool::kBufferSize);
+  }
+
+  // Only the first kMaxBuffersPerThread released buffers were kept
+  ReadBufferPool::Stats stats = ReadBufferPool::GetStats(true);
+  XCTAssertEqual(stats.current_bytes,
+                 ReadBufferPool::kMaxBuffersPerThread * ReadBufferPool::kBufferSize);
+  XCTAssertEqual(stats.peak_bytes,
+                 ReadBufferPool::kMaxBuffersPerThread * 2 * ReadBufferPool::kBufferSize);
+
+  // Resetting brings the peak back down to what is currently allocated
+  XCTAssertEqual(ReadBufferPool::GetStats(false).peak_bytes, stats.current_bytes);
+
+  ReadBufferPool::TrimCurrentThread();
+  XCTAssertEqual(ReadBufferPool::GetStats(false).current_bytes, 0);
+}
+
+- (void)testBuffersReturnToTheReleasingThread {
+  __block ReadBufferPool::Buffer buf = ReadBufferPool::Acquire(ReadBufferPool::kBufferSize);
+  uint8_t* data = buf.data();
+
+  // dispatch_sync could run the block on this thread, so wait for an async one
+  __block uint8_t* reused;
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    buf = ReadBufferPool::Buffer();
+    ReadBufferPool::Buffer other = ReadBufferPool::Acquire(ReadBufferPool::kBufferSize);
+    reused = other.data();
+    other = ReadBufferPool::Buffer();
+    ReadBufferPool::TrimCurrentThread();
+    dispatch_semaphore_signal(sema);
+  });
+  XCTAssertEqual(
+      dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+  XCTAssertEqual(reused, data);
+
+  // Nothing was released on this thread, so this allocates
+  ReadBufferPool::Buffer mine = ReadBufferPool::Acquire(ReadBufferPool::kBufferSize);
+  XCTAssertEqual(ReadBufferPool::GetStats(false).misses, 2);
+}
+
+- (void)testMoveTransfersOwnership {
+  ReadBufferPool::Buffer a = ReadBufferPool::Acquire(64);
+  uint8_t* data = a.data();
+
+  ReadBufferPool::Buffer b = std::move(a);
+  XCTAssertEqual(a.data(), nullptr);
+  XCTAssertEqual(a.size(), 0);
+  XCTAssertEqual(b.data(), data);
+  XCTAssertEqual(b.size(), 64);
+
+  b = ReadBufferPool::Buffer();
+  XCTAssertEqual(ReadBufferPool::Acquire(64).data(), data);
+}
+
+@end
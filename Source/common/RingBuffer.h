@@ -17,18 +17,33 @@
 
 #import <Foundation/Foundation.h>
 
+#include <cstddef>
 #include <cstdlib>
-#include <deque>
+#include <iterator>
 #include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "Source/common/SNTLogging.h"
 
 namespace santa {
 
+// Fixed capacity FIFO that overwrites its oldest value when full.
+//
+// Values live in one contiguous allocation made at construction time, sized
+// to the next power of two so that positions wrap with a mask. Not thread
+// safe, see ConcurrentRingBuffer.h for cross-thread handoff.
 template <typename T>
 class RingBuffer {
+  template <bool IsConst>
+  class Iterator;
+
  public:
-  RingBuffer(size_t capacity) : capacity_(capacity) {
+  RingBuffer(size_t capacity)
+      : capacity_(capacity),
+        mask_(RoundUpToPowerOfTwo(capacity) - 1),
+        buffer_(mask_ + 1) {
     if (capacity == 0) {
       LOGE(@"RingBuffer capacity must be greater than 0");
       std::abort();
@@ -43,72 +58,166 @@ class RingBuffer {
   RingBuffer& operator=(const RingBuffer& other) = delete;
 
   inline size_t Capacity() const { return capacity_; }
-  inline bool Empty() const { return buffer_.size() == 0; };
-  inline bool Full() const { return buffer_.size() == capacity_; };
+  inline size_t Size() const { return size_; }
+  inline bool Empty() const { return size_ == 0; };
+  inline bool Full() const { return size_ == capacity_; };
 
-  std::optional<T> Enqueue(const T& val) {
-    std::optional<T> removed_value;
-    if (Full()) {
-      removed_value = std::move(buffer_.front());
-      buffer_.pop_front();
-    }
-    buffer_.push_back(val);
-    return removed_value;
-  }
+  std::optional<T> Enqueue(const T& val) { return Enqueue(T(val)); }
 
   std::optional<T> Enqueue(T&& val) {
     std::optional<T> removed_value;
     if (Full()) {
-      removed_value = std::move(buffer_.front());
-      buffer_.pop_front();
+      removed_value = Dequeue();
     }
-    buffer_.push_back(std::move(val));
+    At(size_) = std::move(val);
+    size_++;
     return removed_value;
   }
 
   std::optional<T> Dequeue() {
     if (Empty()) {
       return std::nullopt;
-    } else {
-      T value = std::move(buffer_.front());
-      buffer_.pop_front();
-      return std::make_optional<T>(value);
     }
+
+    // Leave a default value behind so the slot doesn't keep the old value
+    // (e.g. an object reference) alive
+    std::optional<T> value = std::exchange(At(0), T());
+    head_ = (head_ + 1) & mask_;
+    size_--;
+    return value;
   }
 
-  using iterator = typename std::deque<T>::iterator;
-  using const_iterator = typename std::deque<T>::const_iterator;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
 
   // Erase methods similar to std::vector
   iterator Erase(const_iterator pos) {
     // Validate iterator
-    if (pos < buffer_.cbegin() || pos >= buffer_.cend()) {
+    if (pos.ring_ != this || pos.pos_ >= size_) {
       LOGE(@"RingBuffer iterator out of range");
       std::abort();
     }
-    return buffer_.erase(pos);
+    return Erase(pos, std::next(pos));
   }
 
   iterator Erase(const_iterator first, const_iterator last) {
     // Validate iterators
-    if (first < buffer_.cbegin() || last > buffer_.cend() || first > last) {
+    if (first.ring_ != this || last.ring_ != this || last.pos_ > size_ ||
+        first.pos_ > last.pos_) {
       LOGE(@"RingBuffer iterator out of range");
       std::abort();
     }
-    return buffer_.erase(first, last);
+
+    // Shift the values after the erased range down, then reset the now
+    // unused slots at the back
+    size_t count = last.pos_ - first.pos_;
+    for (size_t i = last.pos_; i < size_; i++) {
+      At(i - count) = std::move(At(i));
+    }
+    for (size_t i = size_ - count; i < size_; i++) {
+      At(i) = T();
+    }
+    size_ -= count;
+    return iterator(this, first.pos_);
   }
 
   // Iterator support
-  iterator begin() { return buffer_.begin(); }
-  iterator end() { return buffer_.end(); }
-  const_iterator begin() const { return buffer_.begin(); }
-  const_iterator end() const { return buffer_.end(); }
-  const_iterator cbegin() const { return buffer_.cbegin(); }
-  const_iterator cend() const { return buffer_.cend(); }
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+  const_iterator cbegin() const { return const_iterator(this, 0); }
+  const_iterator cend() const { return const_iterator(this, size_); }
 
  private:
+  template <bool IsConst>
+  class Iterator {
+    using Ring = std::conditional_t<IsConst, const RingBuffer, RingBuffer>;
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+
+    Iterator() = default;
+    Iterator(Ring* ring, size_t pos) : ring_(ring), pos_(pos) {}
+
+    // Allow iterator -> const_iterator conversion
+    template <bool C = IsConst, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false>& other)
+        : ring_(other.ring_), pos_(other.pos_) {}
+
+    reference operator*() const { return ring_->At(pos_); }
+    pointer operator->() const { return &ring_->At(pos_); }
+    reference operator[](difference_type n) const {
+      return ring_->At(pos_ + n);
+    }
+
+    Iterator& operator++() {
+      pos_++;
+      return *this;
+    }
+    Iterator operator++(int) { return Iterator(ring_, pos_++); }
+    Iterator& operator--() {
+      pos_--;
+      return *this;
+    }
+    Iterator operator--(int) { return Iterator(ring_, pos_--); }
+    Iterator& operator+=(difference_type n) {
+      pos_ += n;
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) {
+      pos_ -= n;
+      return *this;
+    }
+    Iterator operator+(difference_type n) const {
+      return Iterator(ring_, pos_ + n);
+    }
+    friend Iterator operator+(difference_type n, const Iterator& it) {
+      return it + n;
+    }
+    Iterator operator-(difference_type n) const {
+      return Iterator(ring_, pos_ - n);
+    }
+    difference_type operator-(const Iterator& other) const {
+      return (difference_type)pos_ - (difference_type)other.pos_;
+    }
+
+    bool operator==(const Iterator& other) const { return pos_ == other.pos_; }
+    bool operator!=(const Iterator& other) const { return pos_ != other.pos_; }
+    bool operator<(const Iterator& other) const { return pos_ < other.pos_; }
+    bool operator>(const Iterator& other) const { return pos_ > other.pos_; }
+    bool operator<=(const Iterator& other) const { return pos_ <= other.pos_; }
+    bool operator>=(const Iterator& other) const { return pos_ >= other.pos_; }
+
+   private:
+    friend class RingBuffer;
+    friend class Iterator<!IsConst>;
+
+    Ring* ring_ = nullptr;
+    size_t pos_ = 0;
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+  }
+
+  // Access by position relative to the oldest value
+  inline T& At(size_t pos) { return buffer_[(head_ + pos) & mask_]; }
+  inline const T& At(size_t pos) const {
+    return buffer_[(head_ + pos) & mask_];
+  }
+
   size_t capacity_;
-  std::deque<T> buffer_;
+  size_t mask_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  std::vector<T> buffer_;
 };
 
 }  // namespace santa
@@ -144,6 +144,24 @@ using santa::RingBuffer;
   }
 }
 
+- (void)testWrapAround {
+  // Capacity isn't a power of two, storage is rounded up but the ring still
+  // only holds the requested number of values
+  RingBuffer<int> rb(3);
+  for (int i = 0; i < 10; i++) {
+    rb.Enqueue(i);
+    XCTAssertLessThanOrEqual(rb.Size(), 3);
+  }
+  XCTAssertTrue(rb.Full());
+
+  // Erase from the middle while the oldest value isn't at the start of storage
+  rb.Erase(rb.begin() + 1);
+  XCTAssertEqual(rb.Size(), 2);
+  XCTAssertEqual(rb.Dequeue().value_or(-1), 7);
+  XCTAssertEqual(rb.Dequeue().value_or(-1), 9);
+  XCTAssertTrue(rb.Empty());
+}
+
 - (void)testErase {
   struct Foo {
     int x;
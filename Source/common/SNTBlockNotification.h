@@ -0,0 +1,42 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+#import "Source/common/SNTConfigState.h"
+#import "Source/common/SNTStoredExecutionEvent.h"
+
+/// A block notification sent by santad to the GUI in a batch. Notifications in a batch
+/// don't have reply blocks, those that need one are still sent individually.
+@interface SNTBlockNotification : NSObject <NSSecureCoding>
+
+- (instancetype)initWithEvent:(SNTStoredExecutionEvent*)event
+                customMessage:(NSString*)customMessage
+                    customURL:(NSString*)customURL
+                  configState:(SNTConfigState*)configState
+                  repeatCount:(NSUInteger)repeatCount;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@property(readonly) SNTStoredExecutionEvent* event;
+@property(readonly) NSString* customMessage;
+@property(readonly) NSString* customURL;
+@property(readonly) SNTConfigState* configState;
+
+/// The number of identical blocks, for the same binary and user, that were coalesced into
+/// this notification. Always at least 1.
+@property(readonly) NSUInteger repeatCount;
+
+@end
@@ -0,0 +1,62 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/common/SNTBlockNotification.h"
+
+#import "Source/common/CoderMacros.h"
+
+@implementation SNTBlockNotification
+
+- (instancetype)initWithEvent:(SNTStoredExecutionEvent*)event
+                customMessage:(NSString*)customMessage
+                    customURL:(NSString*)customURL
+                  configState:(SNTConfigState*)configState
+                  repeatCount:(NSUInteger)repeatCount {
+  self = [super init];
+  if (self) {
+    _event = event;
+    _customMessage = [customMessage copy];
+    _customURL = [customURL copy];
+    _configState = configState;
+    _repeatCount = repeatCount;
+  }
+  return self;
+}
+
++ (BOOL)supportsSecureCoding {
+  return YES;
+}
+
+- (void)encodeWithCoder:(NSCoder*)coder {
+  ENCODE(coder, event);
+  ENCODE(coder, customMessage);
+  ENCODE(coder, customURL);
+  ENCODE(coder, configState);
+  ENCODE_BOXABLE(coder, repeatCount);
+}
+
+- (instancetype)initWithCoder:(NSCoder*)decoder {
+  self = [super init];
+  if (self) {
+    DECODE(decoder, event, SNTStoredExecutionEvent);
+    DECODE(decoder, customMessage, NSString);
+    DECODE(decoder, customURL, NSString);
+    DECODE(decoder, configState, SNTConfigState);
+    DECODE_SELECTOR(decoder, repeatCount, NSNumber, unsignedIntegerValue);
+  }
+  return self;
+}
+
+@end
@@ -75,6 +75,14 @@
 @property BOOL silentTouchID;
 @property NSNumber* touchIDCooldownMinutes;  // nil = no caching (prompt every time)
 
+/// YES if a CEL rule made the decision uncacheable, but the rule can only read the identity of
+/// the file and the effective UID of the exec. The decision then holds for every exec of the same
+/// file with the same cacheEUID.
+@property BOOL cacheableForEUID;
+
+/// The effective UID of the exec the decision was made for.
+@property uid_t cacheEUID;
+
 /// YES if the matching CEL rule returned AUDIT. The execution itself is
 /// allowed (the decision is set to the underlying allow event state, e.g.
 /// SNTEventStateAllowBinary or SNTEventStateAllowCELFallback) but the event
@@ -82,4 +90,9 @@
 /// distinguished from regular allow decisions on the server.
 @property BOOL auditReturn;
 
+/// Set while the SHA-256 of a decision that was made without hashing the file is being computed
+/// in the background. Cleared once it finishes, after sha256 has been filled in if possible.
+/// Not copied.
+@property dispatch_group_t pendingSHA256;
+
 @end
@@ -87,6 +87,8 @@
   copy.holdAndAsk = _holdAndAsk;
   copy.silentTouchID = _silentTouchID;
   copy.touchIDCooldownMinutes = _touchIDCooldownMinutes;
+  copy.cacheableForEUID = _cacheableForEUID;
+  copy.cacheEUID = _cacheEUID;
   copy.auditReturn = _auditReturn;
   return copy;
 }
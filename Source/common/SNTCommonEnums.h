@@ -147,6 +147,7 @@ typedef NS_ENUM(NSInteger, SNTEventLogType) {
   SNTEventLogTypeProtobufStreamZstd,
   SNTEventLogTypeJSON,
   SNTEventLogTypeNull,
+  SNTEventLogTypeProtobufColumnar,
 };
 
 // The return status of a sync.
@@ -169,6 +170,7 @@ typedef NS_ENUM(NSInteger, SNTSyncContentEncoding) {
   SNTSyncContentEncodingNone,
   SNTSyncContentEncodingDeflate,
   SNTSyncContentEncodingGzip,
+  SNTSyncContentEncodingZstd,
 };
 
 typedef NS_ENUM(NSInteger, SNTMetricFormatType) {
@@ -176,6 +178,7 @@ typedef NS_ENUM(NSInteger, SNTMetricFormatType) {
   SNTMetricFormatTypeRawJSON,
   SNTMetricFormatTypeMonarchJSON,
   SNTMetricFormatTypeProto,
+  SNTMetricFormatTypeOpenMetrics,
 };
 
 typedef NS_ENUM(NSInteger, SNTOverrideFileAccessAction) {
@@ -167,6 +167,25 @@
 ///
 @property(nullable, readonly, nonatomic) NSArray* fileChangesPrefixFilters;
 
+///
+///  Array of dictionaries describing file change events that should be dropped before they are
+///  enriched and logged. Each dictionary may contain a "Name" used in metrics, a "PathPrefixes"
+///  array matched against the event's target path, and a "SigningIDs" array matched against the
+///  instigating process, in "TEAMID:signing_id" or "platform:signing_id" form. An event is dropped
+///  if it matches every list given in any filter.
+///
+///  Filters are only applied on santad startup.
+///
+@property(nullable, readonly, nonatomic) NSArray<NSDictionary*>* fileChangesTelemetryFilters;
+
+///
+///  If greater than zero, repeated writes to the same file by the same process are only logged
+///  once per this many milliseconds. Changes take effect after santad restarts. Values above
+///  60000 are clamped.
+///  Defaults to 0 (disabled).
+///
+@property(readonly, nonatomic) uint32_t fileChangesDeduplicationWindowMs;
+
 ///
 ///  Enable __PAGEZERO protection, defaults to YES
 ///  If this flag is set to NO, 32-bit binaries that are missing
@@ -220,6 +239,8 @@
 ///      output is compressed as gzip.
 ///    SNTEventLogTypeProtobufStreamZstd "protobufstreamzstd": Similar to "protobufstream", but
 ///      output is compressed as zstd.
+///    SNTEventLogTypeProtobufColumnar "protobufcolumnar": Similar to "protobuf", but each batch
+///      is a ColumnarBatch with records split into columns by SantaMessage field.
 ///    Defaults to SNTEventLogTypeFilelog.
 ///    For mobileconfigs use EventLogType as the key and syslog or filelog strings as the value.
 ///
@@ -242,6 +263,16 @@
 ///
 @property(nonnull, readonly, nonatomic) NSString* eventLogPath;
 
+///
+///  If set, exec, fork, exit, open, close and rename messages received from EndpointSecurity are
+///  recorded to this path so the workload can be replayed with the es_replay_bench tool. This is
+///  meant for short profiling sessions, the trace grows without bound and holds unredacted paths
+///  and arguments.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(nullable, readonly, nonatomic) NSString* eventTracePath;
+
 ///
 ///  Array of strings of telemetry events that should be logged.
 ///
@@ -747,6 +778,14 @@ extern NSString* _Nonnull const kEnableMenuItemUserOverride;
 ///
 @property(readonly, nonatomic) BOOL syncEnableProtoTransfer;
 
+///
+///  If enabled, event upload and rule download run concurrently once preflight
+///  has completed, instead of one after the other. Only enable this for sync
+///  servers that don't create rules in response to uploaded events during the
+///  same sync. Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL syncEnableConcurrentStages;
+
 ///
 ///  Proxy settings for syncing.
 ///  This dictionary is passed directly to NSURLSession. The allowed keys
@@ -1043,6 +1082,243 @@ extern NSString* _Nonnull const kEnableMenuItemUserOverride;
 ///
 @property(readonly, nonatomic) BOOL ignoreOtherEndpointSecurityClients;
 
+///
+///  If true, the exec decision cache is served from a lock-free table so that concurrent
+///  lookups never wait on each other. Changes take effect after santad restarts.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableLockFreeAuthCacheReads;
+
+///
+///  If greater than 1500, files that keep being denied are cached for twice as long on each
+///  consecutive deny, up to this many milliseconds. Because caches are not flushed when allow
+///  rules are added, a newly allowed file may stay blocked for up to this long. Changes take
+///  effect after santad restarts. Defaults to 0, which disables the extension.
+///
+@property(readonly, nonatomic) uint32_t authCacheMaxDenyTimeMs;
+
+///
+///  If true, allowed entries in the exec decision cache are periodically saved to disk and
+///  restored when santad starts, as long as the rules and the files themselves are unchanged.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableAuthCacheWarmStart;
+
+///
+///  If greater than zero, AUTH events are processed on this many serial queues instead of a
+///  single concurrent queue. Events for the same executable are always handled in order on the
+///  same queue, and new work is steered away from queues stuck on a slow event. Changes take
+///  effect after santad restarts. Values above 64 are clamped.
+///  Defaults to 0 (disabled).
+///
+@property(readonly, nonatomic) uint32_t authQueueShardCount;
+
+///
+///  If greater than zero, NOTIFY events are processed on this many serial queues instead of a
+///  single concurrent queue. Events from the same instigating process are always handled in order
+///  on the same queue. Changes take effect after santad restarts. Values above 64 are clamped.
+///  Defaults to 0 (disabled).
+///
+@property(readonly, nonatomic) uint32_t notifyQueueShardCount;
+
+///
+///  If true, pending AUTH events are processed earliest-deadline-first, with events that can be
+///  answered cheaply (e.g. exec decision cache hits) ahead of all others. Ignored when
+///  authQueueShardCount is set. Changes take effect after santad restarts.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableDeadlineAwareAuthScheduling;
+
+///
+///  If true, the authorizer, recorder and device manager share a single EndpointSecurity client
+///  instead of each creating their own. The shared client subscribes to the union of their
+///  events and hands each message to every subsystem interested in its event type, so events
+///  they have in common are only copied out of the kernel once. Changes take effect after
+///  santad restarts.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableMultiplexedESClient;
+
+///
+///  If true, santad keeps a copy of all execution rules in memory and answers rule lookups from
+///  it instead of querying the rules database. The copy is rebuilt in the background whenever
+///  rules change, with lookups falling back to the database until it is ready. Increases memory
+///  use in proportion to the number of rules. Changes take effect after santad restarts.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableInMemoryRuleIndex;
+
+///
+///  If true, santad writes a compact, memory-mapped snapshot of the execution rules next to the
+///  rules database and answers rule lookups from it instead of querying the database. The
+///  snapshot is rewritten in the background whenever rules change. Uses less memory than
+///  enableInMemoryRuleIndex, which takes precedence when both are set. Changes take effect after
+///  santad restarts.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableRuleSnapshot;
+
+///
+///  If greater than zero, the rules database is switched to WAL mode and up to this many
+///  read-only connections are used for rule lookups, counts and exports. Reads then no longer
+///  wait behind rule updates or each other. Changes take effect after santad restarts. Values
+///  above 16 are clamped.
+///  Defaults to 0 (disabled).
+///
+@property(readonly, nonatomic) uint32_t ruleDatabaseReadConnections;
+
+///
+///  If true, executions of validly signed binaries are first checked against CDHash, Signing ID
+///  and Team ID rules using only the identity reported by EndpointSecurity. When that identity
+///  alone resolves to an allow rule that no Binary or Certificate rule could override, the binary
+///  is allowed without opening or hashing the file. Such executions are logged without the file's
+///  SHA-256 unless it was already cached, and without certificate or entitlement details. Only
+///  takes effect with enableInMemoryRuleIndex, and is ignored when enableAllEventUpload is set.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableIdentityOnlyExecDecisions;
+
+///
+///  If true, executions allowed by enableIdentityOnlyExecDecisions are still hashed, but only
+///  after the exec has been responded to, on a low priority background queue. The SHA-256 is
+///  attached to the decision once known, and the execution's telemetry waits briefly for it.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableDeferredExecHashing;
+
+///
+///  If true, executables that are written to disk are hashed and have their code signature read
+///  on a background queue as soon as they're closed, so the first execution finds them cached
+///  rather than doing that work inside the authorization deadline. The cached signing details are
+///  only used for an execution whose cdhash matches the one that was read. Files over 256MB are
+///  skipped.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableSpeculativeExecPrefetch;
+
+///
+///  If true and the event log type is syslog, up to four event lines are combined into each log
+///  message so that logd sees a fraction of the message rate and is less likely to throttle
+///  santad. Lines are held for at most a second before being logged. Requires restarting the
+///  daemon to take effect.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableSyslogBatching;
+
+///
+///  If greater than zero, telemetry events are serialized on this many background queues instead
+///  of on the thread that received them. Events about the same process are still written in
+///  order. If too many events are waiting to be serialized, new events are dropped. Changes take
+///  effect after santad restarts. Values above 16 are clamped.
+///  Defaults to 0 (disabled).
+///
+@property(readonly, nonatomic) uint32_t eventLogSerializationWorkers;
+
+///
+///  Path to a zstd dictionary, trained offline with `zstd --train` on existing spool files, used
+///  to compress telemetry when EventLogType is protobufstreamzstd. The dictionary ID is recorded
+///  in each batch so that `santactl printlog` can find the matching dictionary, which it also
+///  reads from this key. Dictionaries without an ID are rejected. Changes take effect after
+///  santad restarts.
+///
+@property(nullable, readonly, nonatomic) NSString* eventLogZstdDictionaryPath;
+
+///
+///  If true and EventLogType is protobufstreamzstd, the compression level of each spool batch is
+///  chosen from the current conditions: cheaper compression while on battery power and stronger
+///  compression when the spool is close to SpoolDirectorySizeThresholdMB. Has no effect on
+///  batches compressed with EventLogZstdDictionaryPath. Changes take effect after santad restarts.
+///  Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL enableAdaptiveEventLogCompression;
+
+///
+///  If true and EventLogType is one of the protobufstream types, each spool batch ends with an
+///  index of the offset, event type and event time of its records. Zstd batches are also split
+///  into independently decompressible frames described by a zstd seekable format seek table, so
+///  readers can decompress only the records they need. Readers older than this option stop at the
+///  index. Changes take effect after santad restarts.
+///  Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL enableEventLogBatchIndex;
+
+///
+///  If true and EventLogType is protobufstreamgzip or protobufstreamzstd, records in spool batches
+///  are no longer individually hashed. Each batch instead relies on the checksums of its
+///  compressed stream: the gzip CRC-32, or a content checksum in every zstd frame. This saves the
+///  per-record hash and most of the per-record framing. Readers older than this option can't read
+///  these batches. Changes take effect after santad restarts.
+///  Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL enableEventLogFrameChecksums;
+
+///
+///  If true and EventLogType is protobufcolumnar, the processes referenced by events are stored
+///  once per spool batch in a process dictionary instead of being repeated in every event. Readers
+///  older than this option can't read these batches. Changes take effect after santad restarts.
+///  Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL enableColumnarProcessDictionary;
+
+///
+///  If true and EnableTelemetryExport is also true, spool batches are exported as soon as they are
+///  finalized instead of waiting for the next TelemetryExportIntervalSec. The periodic export
+///  still runs to retry batches that failed to export. Changes take effect after santad restarts.
+///  Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL enableStreamingTelemetryExport;
+
+///
+///  If greater than 0 and EventLogType is one of the protobuf types, a snapshot of the process
+///  tree is logged this often. Each snapshot lists the pid, pidversion, parent, cdhash and
+///  annotations of the processes that changed since the previous snapshot, with a full snapshot
+///  every 12 snapshots. Values below 60 are raised to 60. Changes take effect after santad
+///  restarts.
+///  Defaults to 0 (disabled).
+///
+@property(readonly, nonatomic) uint32_t processTreeSnapshotIntervalSec;
+
+///
+///  How often, in milliseconds, santad samples its own threads to attribute the CPU time it uses
+///  to subsystems such as auth, notify and the spool writer. The breakdown is reported by
+///  `santactl status --verbose` and in metrics. Set to 0 to disable. Values below 100 are raised
+///  to 100. Changes take effect after santad restarts.
+///  Defaults to 1000.
+///
+@property(readonly, nonatomic) uint32_t selfProfilingIntervalMs;
+
+///
+///  If greater than 0, santad publishes its metrics to a read-only shared memory region this often.
+///  `santactl metrics` reads the most recent snapshot from the region instead of asking santad,
+///  so values may be up to this many seconds old. Changes take effect after santad restarts.
+///  Defaults to 0 (disabled).
+///
+@property(readonly, nonatomic) uint32_t metricSnapshotIntervalSec;
+
+///
+///  If greater than 0, the total number of bytes of exec arguments logged for each execution.
+///  Arguments past the limit are dropped, the argument that crosses it is cut short, and the event
+///  is marked as truncated. CEL rules still see every argument. Changes take effect after santad
+///  restarts.
+///  Defaults to 0 (unlimited).
+///
+@property(readonly, nonatomic) uint32_t telemetryExecArgsMaxBytes;
+
+///
+///  Like TelemetryExecArgsMaxBytes, but for the environment variables logged for each execution.
+///  Defaults to 0 (unlimited).
+///
+@property(readonly, nonatomic) uint32_t telemetryExecEnvsMaxBytes;
+
+///
+///  If true, santad shrinks its caches when the system reports memory pressure. On a warning,
+///  compiled CEL programs, pooled event log buffers and cached user and group names are dropped.
+///  On critical pressure, cached non-root auth results and execution decisions are dropped too.
+///  Changes take effect after santad restarts.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableMemoryPressureCacheShrinking;
+
 ///
 ///  If true, compressed requests from "santactl sync" will set "Content-Encoding" to "zlib"
 ///  instead of the new default "deflate". If syncing with Upvote deployed at commit 0b4477d
@@ -1053,7 +1329,11 @@ extern NSString* _Nonnull const kEnableMenuItemUserOverride;
 
 ///
 /// If set, "santactl sync" will use the supplied "Content-Encoding", possible
-/// settings include "gzip", "deflate", "none". If empty defaults to "deflate".
+/// settings include "zstd", "gzip", "deflate", "none". If empty defaults to "deflate".
+///
+/// "zstd" is only used once the sync server has advertised support for it by including zstd
+/// in an Accept-Encoding response header, until then requests use "deflate". It also allows
+/// the server to send zstd compressed responses.
 ///
 @property(readonly, nonatomic) SNTSyncContentEncoding syncClientContentEncoding;
 
@@ -1114,6 +1394,12 @@ extern NSString* _Nonnull const kEnableMenuItemUserOverride;
 ///
 @property(readonly, nonatomic) NSUInteger metricExportTimeout;
 
+///
+/// If true, metrics exported over HTTP only include values that changed since
+/// the previous export. Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL metricExportDeltas;
+
 ///
 /// List of prefix strings for which individual entitlement keys with a matching
 /// prefix should not be logged.
@@ -1174,8 +1460,19 @@ extern NSString* _Nonnull const kEnableMenuItemUserOverride;
 ///  crash the daemon, by design. Callers should gate any post-commit
 ///  work that depends on durable state on the return value.
 ///
+///  If the block leaves every key with its previous value, nothing is
+///  assigned or written and no KVO fires; this still returns `YES`.
+///
 - (BOOL)performSyncStateBatch:(nonnull void(NS_NOESCAPE ^)(void))block;
 
+///
+///  As `performSyncStateBatch:`, additionally returning the sync state keys
+///  whose values the batch changed. `changedKeys` is set to nil if the batch
+///  was skipped because it was nested.
+///
+- (BOOL)performSyncStateBatch:(nonnull void(NS_NOESCAPE ^)(void))block
+                  changedKeys:(NSSet<NSString*>* _Nullable __autoreleasing* _Nullable)changedKeys;
+
 ///
 ///  Validate the configuration profile.
 ///
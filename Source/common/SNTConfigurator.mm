@@ -55,6 +55,34 @@ static NSArray<NSString*>* EnsureArrayOfStrings(id obj) {
   return obj;
 }
 
+// Compares two sync state values. NSRegularExpression doesn't implement value
+// equality, so regexes are compared by pattern and options.
+static BOOL SyncStateValuesEqual(id lhs, id rhs) {
+  if (lhs == rhs) return YES;
+  if (!lhs || !rhs) return NO;
+  if ([lhs isKindOfClass:[NSRegularExpression class]] &&
+      [rhs isKindOfClass:[NSRegularExpression class]]) {
+    return [[lhs pattern] isEqualToString:[rhs pattern]] && [lhs options] == [rhs options];
+  }
+  return [lhs isEqual:rhs];
+}
+
+// Returns the keys whose values differ between two sync states
+static NSSet<NSString*>* ChangedSyncStateKeys(NSDictionary* before, NSDictionary* after) {
+  NSMutableSet<NSString*>* changed = [NSMutableSet set];
+  for (NSString* key in before) {
+    if (!SyncStateValuesEqual(before[key], after[key])) {
+      [changed addObject:key];
+    }
+  }
+  for (NSString* key in after) {
+    if (!before[key]) {
+      [changed addObject:key];
+    }
+  }
+  return changed;
+}
+
 static SNTRemovableMediaAction ActionFromString(NSString* action) {
   if (!action) return SNTRemovableMediaActionAllow;
   if ([action caseInsensitiveCompare:@"Allow"] == NSOrderedSame) {
@@ -87,6 +115,10 @@ static SNTRemovableMediaAction ActionFromString(NSString* action) {
 /// thread, matching the convention enforced by `updateSyncStateForKey:value:`.
 @property(nonatomic) NSMutableDictionary* batchedSyncState;
 
+/// Set when the in-memory syncState has changes that failed to save, so that
+/// an otherwise unchanged batch still retries the write. Main thread only.
+@property(nonatomic) BOOL syncStateNeedsSave;
+
 @property(readonly, nonatomic) NSString* syncStateFilePath;
 @property(readonly, nonatomic) NSString* stateFilePath;
 
@@ -128,6 +160,7 @@ static const CFStringRef kMobileConfigDomain = CFSTR("com.northpolesec.santa");
 static NSString* const kStaticRulesKey = @"StaticRules";
 static NSString* const kSyncBaseURLKey = @"SyncBaseURL";
 static NSString* const kSyncEnableProtoTransfer = @"SyncEnableProtoTransfer";
+static NSString* const kSyncEnableConcurrentStages = @"SyncEnableConcurrentStages";
 static NSString* const kSyncProxyConfigKey = @"SyncProxyConfiguration";
 static NSString* const kSyncExtraHeadersKey = @"SyncExtraHeaders";
 static NSString* const kSyncEnableCleanSyncEventUpload = @"SyncEnableCleanSyncEventUpload";
@@ -180,9 +213,12 @@ static NSString* const kDisableUnknownEventUploadKey = @"DisableUnknownEventUplo
 
 static NSString* const kFileChangesRegexKey = @"FileChangesRegex";
 static NSString* const kFileChangesPrefixFiltersKey = @"FileChangesPrefixFilters";
+static NSString* const kFileChangesTelemetryFiltersKey = @"FileChangesTelemetryFilters";
+static NSString* const kFileChangesDeduplicationWindowMsKey = @"FileChangesDeduplicationWindowMs";
 
 static NSString* const kEventLogType = @"EventLogType";
 static NSString* const kEventLogPath = @"EventLogPath";
+static NSString* const kEventTracePath = @"EventTracePath";
 static NSString* const kSpoolDirectory = @"SpoolDirectory";
 static NSString* const kSpoolDirectoryFileSizeThresholdKB = @"SpoolDirectoryFileSizeThresholdKB";
 static NSString* const kSpoolDirectorySizeThresholdMB = @"SpoolDirectorySizeThresholdMB";
@@ -205,6 +241,34 @@ static NSString* const kTelemetryExportMaxFilesPerBatch = @"TelemetryExportMaxFi
 static NSString* const kEnableMachineIDDecoration = @"EnableMachineIDDecoration";
 
 static NSString* const kIgnoreOtherEndpointSecurityClients = @"IgnoreOtherEndpointSecurityClients";
+static NSString* const kEnableLockFreeAuthCacheReads = @"EnableLockFreeAuthCacheReads";
+static NSString* const kAuthCacheMaxDenyTimeMs = @"AuthCacheMaxDenyTimeMs";
+static NSString* const kEnableAuthCacheWarmStart = @"EnableAuthCacheWarmStart";
+static NSString* const kAuthQueueShardCount = @"AuthQueueShardCount";
+static NSString* const kNotifyQueueShardCount = @"NotifyQueueShardCount";
+static NSString* const kEnableDeadlineAwareAuthScheduling = @"EnableDeadlineAwareAuthScheduling";
+static NSString* const kEnableMultiplexedESClient = @"EnableMultiplexedESClient";
+static NSString* const kEnableInMemoryRuleIndex = @"EnableInMemoryRuleIndex";
+static NSString* const kEnableRuleSnapshot = @"EnableRuleSnapshot";
+static NSString* const kRuleDatabaseReadConnections = @"RuleDatabaseReadConnections";
+static NSString* const kEnableIdentityOnlyExecDecisions = @"EnableIdentityOnlyExecDecisions";
+static NSString* const kEnableDeferredExecHashing = @"EnableDeferredExecHashing";
+static NSString* const kEnableSpeculativeExecPrefetch = @"EnableSpeculativeExecPrefetch";
+static NSString* const kEnableSyslogBatching = @"EnableSyslogBatching";
+static NSString* const kEventLogSerializationWorkers = @"EventLogSerializationWorkers";
+static NSString* const kEventLogZstdDictionaryPath = @"EventLogZstdDictionaryPath";
+static NSString* const kEnableAdaptiveEventLogCompression = @"EnableAdaptiveEventLogCompression";
+static NSString* const kEnableEventLogBatchIndex = @"EnableEventLogBatchIndex";
+static NSString* const kEnableEventLogFrameChecksums = @"EnableEventLogFrameChecksums";
+static NSString* const kEnableColumnarProcessDictionary = @"EnableColumnarProcessDictionary";
+static NSString* const kEnableStreamingTelemetryExport = @"EnableStreamingTelemetryExport";
+static NSString* const kProcessTreeSnapshotIntervalSec = @"ProcessTreeSnapshotIntervalSec";
+static NSString* const kSelfProfilingIntervalMs = @"SelfProfilingIntervalMs";
+static NSString* const kMetricSnapshotIntervalSec = @"MetricSnapshotIntervalSec";
+static NSString* const kTelemetryExecArgsMaxBytes = @"TelemetryExecArgsMaxBytes";
+static NSString* const kTelemetryExecEnvsMaxBytes = @"TelemetryExecEnvsMaxBytes";
+static NSString* const kEnableMemoryPressureCacheShrinking =
+    @"EnableMemoryPressureCacheShrinking";
 static NSString* const kTelemetryKey = @"Telemetry";
 
 static NSString* const kClientContentEncoding = @"SyncClientContentEncoding";
@@ -230,6 +294,7 @@ static NSString* const kMetricURL = @"MetricURL";
 static NSString* const kMetricExportInterval = @"MetricExportInterval";
 static NSString* const kMetricExportTimeout = @"MetricExportTimeout";
 static NSString* const kMetricExtraLabels = @"MetricExtraLabels";
+static NSString* const kMetricExportDeltas = @"MetricExportDeltas";
 
 static NSString* const kEnabledProcessAnnotations = @"EnabledProcessAnnotations";
 static NSString* const kAllowedSantaCommandsKey = @"AllowedSantaCommands";
@@ -341,6 +406,8 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kEnableTransitiveRulesKeyDeprecated : number,
       kFileChangesRegexKey : re,
       kFileChangesPrefixFiltersKey : array,
+      kFileChangesTelemetryFiltersKey : array,
+      kFileChangesDeduplicationWindowMsKey : number,
       kAllowedPathRegexKey : re,
       kAllowedPathRegexKeyDeprecated : re,
       kBlockedPathRegexKey : re,
@@ -380,6 +447,7 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kStaticRulesKey : array,
       kSyncBaseURLKey : string,
       kSyncEnableProtoTransfer : number,
+      kSyncEnableConcurrentStages : number,
       kSyncEnableCleanSyncEventUpload : number,
       kSyncProxyConfigKey : dictionary,
       kSyncExtraHeadersKey : dictionary,
@@ -400,6 +468,7 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kMachineIDPlistKeyKey : string,
       kEventLogType : string,
       kEventLogPath : string,
+      kEventTracePath : string,
       kSpoolDirectory : string,
       kSpoolDirectoryFileSizeThresholdKB : number,
       kSpoolDirectorySizeThresholdMB : number,
@@ -417,6 +486,33 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kTelemetryExportMaxFilesPerBatch : number,
       kEnableMachineIDDecoration : number,
       kIgnoreOtherEndpointSecurityClients : number,
+      kEnableLockFreeAuthCacheReads : number,
+      kAuthCacheMaxDenyTimeMs : number,
+      kEnableAuthCacheWarmStart : number,
+      kAuthQueueShardCount : number,
+      kNotifyQueueShardCount : number,
+      kEnableDeadlineAwareAuthScheduling : number,
+      kEnableMultiplexedESClient : number,
+      kEnableInMemoryRuleIndex : number,
+      kEnableRuleSnapshot : number,
+      kRuleDatabaseReadConnections : number,
+      kEnableIdentityOnlyExecDecisions : number,
+      kEnableDeferredExecHashing : number,
+      kEnableSpeculativeExecPrefetch : number,
+      kEnableSyslogBatching : number,
+      kEventLogSerializationWorkers : number,
+      kEventLogZstdDictionaryPath : string,
+      kEnableAdaptiveEventLogCompression : number,
+      kEnableEventLogBatchIndex : number,
+      kEnableEventLogFrameChecksums : number,
+      kEnableColumnarProcessDictionary : number,
+      kEnableStreamingTelemetryExport : number,
+      kProcessTreeSnapshotIntervalSec : number,
+      kSelfProfilingIntervalMs : number,
+      kMetricSnapshotIntervalSec : number,
+      kTelemetryExecArgsMaxBytes : number,
+      kTelemetryExecEnvsMaxBytes : number,
+      kEnableMemoryPressureCacheShrinking : number,
       kFCMProject : string,
       kFCMEntity : string,
       kFCMAPIKey : string,
@@ -428,6 +524,7 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kMetricExportInterval : number,
       kMetricExportTimeout : number,
       kMetricExtraLabels : dictionary,
+      kMetricExportDeltas : number,
       kEnableAllEventUploadKey : number,
       kDisableUnknownEventUploadKey : number,
       kOverrideFileAccessActionKey : string,
@@ -555,7 +652,15 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
-+ (NSSet*)keyPathsForValuesAffectingFileChangesPrefixFiltersKey {
++ (NSSet*)keyPathsForValuesAffectingFileChangesPrefixFilters {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingFileChangesTelemetryFilters {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingFileChangesDeduplicationWindowMs {
   return [self configStateSet];
 }
 
@@ -575,6 +680,10 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet*)keyPathsForValuesAffectingSyncEnableConcurrentStages {
+  return [self configStateSet];
+}
+
 + (NSSet*)keyPathsForValuesAffectingSyncExtraHeaders {
   return [self configStateSet];
 }
@@ -723,6 +832,10 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet*)keyPathsForValuesAffectingEventTracePath {
+  return [self configStateSet];
+}
+
 + (NSSet*)keyPathsForValuesAffectingSpoolDirectory {
   return [self configStateSet];
 }
@@ -783,6 +896,114 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet*)keyPathsForValuesAffectingEnableLockFreeAuthCacheReads {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingAuthCacheMaxDenyTimeMs {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableAuthCacheWarmStart {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingAuthQueueShardCount {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingNotifyQueueShardCount {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableDeadlineAwareAuthScheduling {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableMultiplexedESClient {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableInMemoryRuleIndex {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableRuleSnapshot {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingRuleDatabaseReadConnections {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableIdentityOnlyExecDecisions {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableDeferredExecHashing {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableSpeculativeExecPrefetch {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableSyslogBatching {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEventLogSerializationWorkers {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEventLogZstdDictionaryPath {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableAdaptiveEventLogCompression {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableEventLogBatchIndex {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableEventLogFrameChecksums {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableColumnarProcessDictionary {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableStreamingTelemetryExport {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingProcessTreeSnapshotIntervalSec {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingSelfProfilingIntervalMs {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingMetricSnapshotIntervalSec {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingTelemetryExecArgsMaxBytes {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingTelemetryExecEnvsMaxBytes {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEnableMemoryPressureCacheShrinking {
+  return [self configStateSet];
+}
+
 + (NSSet*)keyPathsForValuesAffectingDnsUpstreamTimeoutSecs {
   return [self configStateSet];
 }
@@ -1115,6 +1336,21 @@ static SNTConfigurator* sharedConfigurator = nil;
   return filters;
 }
 
+- (NSArray<NSDictionary*>*)fileChangesTelemetryFilters {
+  NSArray* filters = self.configState[kFileChangesTelemetryFiltersKey];
+  for (id filter in filters) {
+    if (![filter isKindOfClass:[NSDictionary class]]) {
+      return nil;
+    }
+  }
+  return filters;
+}
+
+- (uint32_t)fileChangesDeduplicationWindowMs {
+  NSNumber* number = self.configState[kFileChangesDeduplicationWindowMsKey];
+  return number ? MIN([number unsignedIntValue], 60000u) : 0;
+}
+
 - (SNTDeviceManagerStartupPreferences)onStartUSBOptions {
   NSString* action = [self.configState[kOnStartUSBOptions] lowercaseString];
 
@@ -1171,6 +1407,11 @@ static SNTConfigurator* sharedConfigurator = nil;
   return number ? [number boolValue] : NO;
 }
 
+- (BOOL)syncEnableConcurrentStages {
+  NSNumber* number = self.configState[kSyncEnableConcurrentStages];
+  return number ? [number boolValue] : NO;
+}
+
 - (NSDictionary*)syncProxyConfig {
   return self.configState[kSyncProxyConfigKey];
 }
@@ -1352,6 +1593,8 @@ static SNTConfigurator* sharedConfigurator = nil;
     return SNTSyncContentEncodingDeflate;
   } else if ([contentEncoding isEqualToString:@"gzip"]) {
     return SNTSyncContentEncodingGzip;
+  } else if ([contentEncoding isEqualToString:@"zstd"]) {
+    return SNTSyncContentEncodingZstd;
   } else if ([contentEncoding isEqualToString:@"none"]) {
     return SNTSyncContentEncodingNone;
   } else {
@@ -1483,6 +1726,8 @@ static SNTConfigurator* sharedConfigurator = nil;
     return SNTEventLogTypeProtobufStreamGzip;
   } else if ([logType isEqualToString:@"protobufstreamzstd"]) {
     return SNTEventLogTypeProtobufStreamZstd;
+  } else if ([logType isEqualToString:@"protobufcolumnar"]) {
+    return SNTEventLogTypeProtobufColumnar;
   } else if ([logType isEqualToString:@"syslog"]) {
     return SNTEventLogTypeSyslog;
   } else if ([logType isEqualToString:@"null"]) {
@@ -1504,6 +1749,10 @@ static SNTConfigurator* sharedConfigurator = nil;
   return self.configState[kEventLogPath] ?: @"/var/db/santa/santa.log";
 }
 
+- (NSString*)eventTracePath {
+  return self.configState[kEventTracePath];
+}
+
 - (NSString*)spoolDirectory {
   return self.configState[kSpoolDirectory] ?: @"/var/db/santa/spool";
 }
@@ -1648,6 +1897,141 @@ static SNTConfigurator* sharedConfigurator = nil;
   return number ? [number boolValue] : NO;
 }
 
+- (BOOL)enableLockFreeAuthCacheReads {
+  NSNumber* number = self.configState[kEnableLockFreeAuthCacheReads];
+  return number ? [number boolValue] : NO;
+}
+
+- (uint32_t)authCacheMaxDenyTimeMs {
+  NSNumber* number = self.configState[kAuthCacheMaxDenyTimeMs];
+  return number ? [number unsignedIntValue] : 0;
+}
+
+- (BOOL)enableAuthCacheWarmStart {
+  NSNumber* number = self.configState[kEnableAuthCacheWarmStart];
+  return number ? [number boolValue] : NO;
+}
+
+- (uint32_t)authQueueShardCount {
+  NSNumber* number = self.configState[kAuthQueueShardCount];
+  return number ? MIN([number unsignedIntValue], 64u) : 0;
+}
+
+- (uint32_t)notifyQueueShardCount {
+  NSNumber* number = self.configState[kNotifyQueueShardCount];
+  return number ? MIN([number unsignedIntValue], 64u) : 0;
+}
+
+- (BOOL)enableDeadlineAwareAuthScheduling {
+  NSNumber* number = self.configState[kEnableDeadlineAwareAuthScheduling];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableMultiplexedESClient {
+  NSNumber* number = self.configState[kEnableMultiplexedESClient];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableInMemoryRuleIndex {
+  NSNumber* number = self.configState[kEnableInMemoryRuleIndex];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableRuleSnapshot {
+  NSNumber* number = self.configState[kEnableRuleSnapshot];
+  return number ? [number boolValue] : NO;
+}
+
+- (uint32_t)ruleDatabaseReadConnections {
+  NSNumber* number = self.configState[kRuleDatabaseReadConnections];
+  return number ? MIN([number unsignedIntValue], 16u) : 0;
+}
+
+- (NSString*)eventLogZstdDictionaryPath {
+  return self.configState[kEventLogZstdDictionaryPath];
+}
+
+- (BOOL)enableAdaptiveEventLogCompression {
+  NSNumber* number = self.configState[kEnableAdaptiveEventLogCompression];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableEventLogBatchIndex {
+  NSNumber* number = self.configState[kEnableEventLogBatchIndex];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableEventLogFrameChecksums {
+  NSNumber* number = self.configState[kEnableEventLogFrameChecksums];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableColumnarProcessDictionary {
+  NSNumber* number = self.configState[kEnableColumnarProcessDictionary];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableStreamingTelemetryExport {
+  NSNumber* number = self.configState[kEnableStreamingTelemetryExport];
+  return number ? [number boolValue] : NO;
+}
+
+- (uint32_t)processTreeSnapshotIntervalSec {
+  uint32_t interval = [self.configState[kProcessTreeSnapshotIntervalSec] unsignedIntValue];
+  return interval == 0 ? 0 : MAX(interval, 60u);
+}
+
+- (uint32_t)selfProfilingIntervalMs {
+  NSNumber* number = self.configState[kSelfProfilingIntervalMs];
+  if (!number) {
+    return 1000;
+  }
+  uint32_t interval = [number unsignedIntValue];
+  return interval == 0 ? 0 : MAX(interval, 100u);
+}
+
+- (uint32_t)metricSnapshotIntervalSec {
+  return [self.configState[kMetricSnapshotIntervalSec] unsignedIntValue];
+}
+
+- (uint32_t)telemetryExecArgsMaxBytes {
+  return [self.configState[kTelemetryExecArgsMaxBytes] unsignedIntValue];
+}
+
+- (uint32_t)telemetryExecEnvsMaxBytes {
+  return [self.configState[kTelemetryExecEnvsMaxBytes] unsignedIntValue];
+}
+
+- (BOOL)enableMemoryPressureCacheShrinking {
+  NSNumber* number = self.configState[kEnableMemoryPressureCacheShrinking];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableIdentityOnlyExecDecisions {
+  NSNumber* number = self.configState[kEnableIdentityOnlyExecDecisions];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableDeferredExecHashing {
+  NSNumber* number = self.configState[kEnableDeferredExecHashing];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableSpeculativeExecPrefetch {
+  NSNumber* number = self.configState[kEnableSpeculativeExecPrefetch];
+  return number ? [number boolValue] : NO;
+}
+
+- (BOOL)enableSyslogBatching {
+  NSNumber* number = self.configState[kEnableSyslogBatching];
+  return number ? [number boolValue] : NO;
+}
+
+- (uint32_t)eventLogSerializationWorkers {
+  NSNumber* number = self.configState[kEventLogSerializationWorkers];
+  return number ? MIN([number unsignedIntValue], 16u) : 0;
+}
+
 - (NSTimeInterval)dnsUpstreamTimeoutSecs {
   NSNumber* v = self.configState[kDNSUpstreamTimeoutSecondsKey];
   return v ? v.doubleValue : 0;  // 0 == unset
@@ -1890,6 +2274,8 @@ static SNTConfigurator* sharedConfigurator = nil;
     return SNTMetricFormatTypeMonarchJSON;
   } else if ([normalized isEqualToString:@"proto"]) {
     return SNTMetricFormatTypeProto;
+  } else if ([normalized isEqualToString:@"openmetrics"]) {
+    return SNTMetricFormatTypeOpenMetrics;
   } else if (normalized.length == 0 && santa::IsDomainPinned([self syncBaseURL])) {
     return SNTMetricFormatTypeProto;
   } else {
@@ -1928,6 +2314,11 @@ static SNTConfigurator* sharedConfigurator = nil;
   return self.configState[kMetricExtraLabels];
 }
 
+- (BOOL)metricExportDeltas {
+  NSNumber* number = self.configState[kMetricExportDeltas];
+  return number ? [number boolValue] : NO;
+}
+
 - (NSArray<NSString*>*)enabledProcessAnnotations {
   NSArray<NSString*>* annotations = self.configState[kEnabledProcessAnnotations];
   for (id annotation in annotations) {
@@ -1960,7 +2351,8 @@ static SNTConfigurator* sharedConfigurator = nil;
 #pragma mark - Private
 
 ///
-///  Update the syncState. Triggers a KVO event for all dependents.
+///  Update the syncState. Triggers a KVO event for all dependents unless the
+///  value is unchanged.
 ///
 ///  This operation blocks to allow the caller to read the written values
 ///  immediately after the call completes.
@@ -1971,6 +2363,9 @@ static SNTConfigurator* sharedConfigurator = nil;
       self.batchedSyncState[key] = value;
       return;
     }
+    if (SyncStateValuesEqual(self.syncState[key], value) && !self.syncStateNeedsSave) {
+      return;
+    }
     NSMutableDictionary* syncState = self.syncState.mutableCopy;
     syncState[key] = value;
     self.syncState = syncState;
@@ -1986,17 +2381,34 @@ static SNTConfigurator* sharedConfigurator = nil;
 }
 
 - (BOOL)performSyncStateBatch:(void(NS_NOESCAPE ^)(void))block {
+  return [self performSyncStateBatch:block changedKeys:NULL];
+}
+
+- (BOOL)performSyncStateBatch:(void(NS_NOESCAPE ^)(void))block
+                  changedKeys:(NSSet<NSString*>* __autoreleasing*)changedKeys {
   __block BOOL committed = NO;
+  __block NSSet<NSString*>* changed;
   void (^run)(void) = ^{
     if (self.batchedSyncState != nil) {
       NSAssert(NO, @"Sync-state batches do not nest");
       LOGE(@"Sync-state batches do not nest; skipping nested batch");
       return;
     }
-    self.batchedSyncState = self.syncState.mutableCopy;
+    NSDictionary* original = self.syncState;
+    self.batchedSyncState = original.mutableCopy;
     block();
-    self.syncState = self.batchedSyncState;
+    NSDictionary* batched = self.batchedSyncState;
     self.batchedSyncState = nil;
+
+    changed = ChangedSyncStateKeys(original, batched);
+    if (changed.count == 0 && !self.syncStateNeedsSave) {
+      // Nothing to apply: skip the KVO fan-out and the disk write
+      committed = YES;
+      return;
+    }
+    if (changed.count > 0) {
+      self.syncState = batched;
+    }
     committed = [self saveSyncStateToDisk];
   };
   if ([NSThread isMainThread]) {
@@ -2004,6 +2416,9 @@ static SNTConfigurator* sharedConfigurator = nil;
   } else {
     dispatch_sync(dispatch_get_main_queue(), run);
   }
+  if (changedKeys) {
+    *changedKeys = changed;
+  }
   return committed;
 }
 
@@ -2090,8 +2505,10 @@ static SNTConfigurator* sharedConfigurator = nil;
   syncState[kBlockedPathRegexKey] = [syncState[kBlockedPathRegexKey] pattern];
   if (![syncState writeToFile:self.syncStateFilePath atomically:YES]) {
     LOGE(@"Failed to write sync state to %@", self.syncStateFilePath);
+    self.syncStateNeedsSave = YES;
     return NO;
   }
+  self.syncStateNeedsSave = NO;
   [[NSFileManager defaultManager] setAttributes:@{NSFilePosixPermissions : @0600}
                                    ofItemAtPath:self.syncStateFilePath
                                           error:NULL];
@@ -2110,6 +2527,7 @@ static SNTConfigurator* sharedConfigurator = nil;
       return;
     }
     self.syncState = [NSMutableDictionary dictionary];
+    self.syncStateNeedsSave = NO;
     [[NSFileManager defaultManager] removeItemAtPath:self.syncStateFilePath error:NULL];
   };
   if ([NSThread isMainThread]) {
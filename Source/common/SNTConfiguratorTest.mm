@@ -402,6 +402,57 @@ typedef BOOL (^StateFileAccessAuthorizer)(void);
   XCTAssertTrue([self.fileMgr removeItemAtPath:plistPath error:nil]);
 }
 
+- (void)testPerformSyncStateBatchSkipsUnchangedState {
+  NSString* plistPath = [NSString stringWithFormat:@"%@/batch-unchanged.plist", self.testDir];
+  SNTConfigurator* cfg = [self configuratorWithEmptySyncStateAtPath:plistPath];
+
+  NSSet<NSString*>* changedKeys;
+  [cfg performSyncStateBatch:^{
+    [cfg setSyncServerClientMode:SNTClientModeLockdown];
+    [cfg setSyncServerAllowedPathRegex:[NSRegularExpression regularExpressionWithPattern:@"^/foo"
+                                                                                 options:0
+                                                                                   error:NULL]];
+  }
+                 changedKeys:&changedKeys];
+  XCTAssertEqualObjects(changedKeys,
+                        ([NSSet setWithArray:@[ @"ClientMode", @"AllowedPathRegex" ]]));
+
+  __block NSUInteger kvoCount = 0;
+  [cfg addObserver:self
+        forKeyPath:@"syncState"
+           options:NSKeyValueObservingOptionNew
+           context:&kvoCount];
+
+  // Resending the same values, even after a clear, changes nothing
+  BOOL committed = [cfg performSyncStateBatch:^{
+    [cfg clearSyncState];
+    [cfg setSyncServerClientMode:SNTClientModeLockdown];
+    [cfg setSyncServerAllowedPathRegex:[NSRegularExpression regularExpressionWithPattern:@"^/foo"
+                                                                                 options:0
+                                                                                   error:NULL]];
+  }
+                                  changedKeys:&changedKeys];
+  XCTAssertTrue(committed);
+  XCTAssertEqual(changedKeys.count, 0);
+  XCTAssertEqual(kvoCount, 0);
+
+  // Only the fields that differ are reported
+  [cfg performSyncStateBatch:^{
+    [cfg setSyncServerClientMode:SNTClientModeLockdown];
+    [cfg setEnableBundles:YES];
+  }
+                 changedKeys:&changedKeys];
+  XCTAssertEqualObjects(changedKeys, [NSSet setWithObject:@"EnableBundles"]);
+  XCTAssertEqual(kvoCount, 1);
+
+  // One-shot updates with the current value are dropped too
+  [cfg setEnableBundles:YES];
+  XCTAssertEqual(kvoCount, 1);
+
+  [cfg removeObserver:self forKeyPath:@"syncState" context:&kvoCount];
+  XCTAssertTrue([self.fileMgr removeItemAtPath:plistPath error:nil]);
+}
+
 - (void)testPerformSyncStateBatchReturnsNoWhenDiskWriteFails {
   // Pointing the configurator at an unwritable path forces saveSyncStateToDisk
   // to fail. The in-memory commit still happens (KVO still fires) but the
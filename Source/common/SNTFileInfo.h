@@ -86,6 +86,12 @@
 ///
 - (NSString*)SHA256;
 
+///
+///  @return YES if the SHA-256 of this version of the file is already known, so calling SHA256
+///  won't read the file.
+///
+- (BOOL)hasKnownSHA256;
+
 ///
 ///  @return The architectures included in this binary (e.g. x86_64, ppc).
 ///
@@ -27,19 +27,25 @@
 #include <sys/xattr.h>
 
 #import "Source/common/CertificateHelpers.h"
+#include "Source/common/FileHashCache.h"
 #import "Source/common/MOLCodesignChecker.h"
+#include "Source/common/ReadBufferPool.h"
 #import "Source/common/SNTError.h"
 #import "Source/common/SNTLogging.h"
+#include "Source/common/verifyinghasher/FileReader.h"
+#include "Source/common/verifyinghasher/HeaderParser.h"
 
 // Simple class to hold the data of a mach_header and the offset within the file
 // in which that header was found.
 @interface MachHeaderWithOffset : NSObject
 @property NSData* data;
-@property uint32_t offset;
-- (instancetype)initWithData:(NSData*)data offset:(uint32_t)offset;
+@property uint64_t offset;
+// Whether the first load command is __PAGEZERO, nil if it couldn't be read.
+@property NSNumber* firstSegmentIsPageZero;
+- (instancetype)initWithData:(NSData*)data offset:(uint64_t)offset;
 @end
 @implementation MachHeaderWithOffset
-- (instancetype)initWithData:(NSData*)data offset:(uint32_t)offset {
+- (instancetype)initWithData:(NSData*)data offset:(uint64_t)offset {
   self = [super init];
   if (self) {
     _data = data;
@@ -66,7 +72,10 @@
 @property(nonatomic) NSError* codesignCheckerError;
 @end
 
-@implementation SNTFileInfo
+@implementation SNTFileInfo {
+  // The stat used to initialize this object, identifies the version of the file being hashed
+  struct stat _fileStat;
+}
 
 - (instancetype)initWithResolvedPath:(NSString*)path error:(NSError**)error {
   struct stat fileStat;
@@ -106,6 +115,7 @@
       return nil;
     }
 
+    _fileStat = *fileStat;
     _fileSize = fileStat->st_size;
     _vnode = (SantaVnode){.fsid = fileStat->st_dev, .fileid = fileStat->st_ino};
 
@@ -154,9 +164,15 @@
 #pragma mark Hashing
 
 - (void)hashSHA1:(NSString**)sha1 SHA256:(NSString**)sha256 {
-  const int MAX_CHUNK_SIZE = 256 * 1024;  // 256 KB
-  const size_t chunkSize = _fileSize > MAX_CHUNK_SIZE ? MAX_CHUNK_SIZE : _fileSize;
-  char* chunk = static_cast<char*>(malloc(chunkSize));
+  if (santa::FileHashCache::Shared().Lookup(_fileStat, sha1, sha256)) return;
+
+  // Leased rather than malloc'd, so hashing many files in a row on a thread
+  // reuses the same read window
+  const size_t chunkSize = _fileSize > santa::ReadBufferPool::kBufferSize
+                               ? santa::ReadBufferPool::kBufferSize
+                               : _fileSize;
+  santa::ReadBufferPool::Buffer buffer = santa::ReadBufferPool::Acquire(chunkSize);
+  char* chunk = reinterpret_cast<char*>(buffer.data());
 
   @try {
     CC_SHA1_CTX c1;
@@ -190,12 +206,15 @@
 
     // We turn off Read Ahead that we turned on
     fcntl(fd, F_RDAHEAD, 0);
+
+    NSString* sha1String;
+    NSString* sha256String;
     if (sha1) {
       unsigned char digest[CC_SHA1_DIGEST_LENGTH];
       CC_SHA1_Final(digest, &c1);
       NSString* const SHA1FormatString =
           @"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x";
-      *sha1 = [[NSString alloc]
+      sha1String = [[NSString alloc]
           initWithFormat:SHA1FormatString, digest[0], digest[1], digest[2], digest[3], digest[4],
                          digest[5], digest[6], digest[7], digest[8], digest[9], digest[10],
                          digest[11], digest[12], digest[13], digest[14], digest[15], digest[16],
@@ -208,7 +227,7 @@
           @"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x"
            "%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x";
 
-      *sha256 = [[NSString alloc]
+      sha256String = [[NSString alloc]
           initWithFormat:SHA256FormatString, digest[0], digest[1], digest[2], digest[3], digest[4],
                          digest[5], digest[6], digest[7], digest[8], digest[9], digest[10],
                          digest[11], digest[12], digest[13], digest[14], digest[15], digest[16],
@@ -216,8 +235,19 @@
                          digest[23], digest[24], digest[25], digest[26], digest[27], digest[28],
                          digest[29], digest[30], digest[31]];
     }
+
+    // Only cache the digests if the file still matches the stat this object was created with,
+    // otherwise they may belong to a different version of the file.
+    struct stat currentStat;
+    if (fstat(fd, &currentStat) == 0 &&
+        santa::FileHashCache::IsSameVersion(currentStat, _fileStat)) {
+      santa::FileHashCache::Shared().Store(_fileStat, sha1String, sha256String);
+    }
+
+    if (sha1) *sha1 = sha1String;
+    if (sha256) *sha256 = sha256String;
   } @finally {
-    free(chunk);
+    buffer = santa::ReadBufferPool::Buffer();
   }
 }
 
@@ -237,6 +267,15 @@
   return self.sha256Storage;
 }
 
+- (BOOL)hasKnownSHA256 {
+  if (self.sha256Storage) return YES;
+
+  NSString* sha256;
+  if (!santa::FileHashCache::Shared().Lookup(_fileStat, NULL, &sha256)) return NO;
+  self.sha256Storage = sha256;
+  return YES;
+}
+
 #pragma mark File Type Info
 
 - (NSArray*)architectures {
@@ -313,23 +352,12 @@
   struct mach_header* mh = (struct mach_header*)[x86Header.data bytes];
   if (mh->filetype != MH_EXECUTE) return NO;
 
-  NSRange range =
-      NSMakeRange(x86Header.offset + sizeof(struct mach_header), sizeof(struct segment_command));
-  NSData* lcData = [self safeSubdataWithRange:range];
-  if (!lcData) return NO;
-
   // This code assumes the __PAGEZERO is always the first load-command in the file.
   // Given that the macOS ABI says "the static linker creates a __PAGEZERO segment
   // as the first segment of an executable file." this should be OK.
-  struct load_command* lc = (struct load_command*)[lcData bytes];
-  if (lc->cmd == LC_SEGMENT) {
-    struct segment_command* segment = (struct segment_command*)lc;
-    if (segment->vmaddr == 0 && segment->vmsize != 0 && segment->initprot == 0 &&
-        segment->maxprot == 0 && strcmp("__PAGEZERO", segment->segname) == 0) {
-      return NO;
-    }
-  }
-  return YES;
+  // The first load command was read along with the header in machHeaders.
+  if (!x86Header.firstSegmentIsPageZero) return NO;
+  return ![x86Header.firstSegmentIsPageZero boolValue];
 }
 
 #pragma mark Bundle Information
@@ -490,46 +518,26 @@
   if (self.cachedHeaders) return self.cachedHeaders;
 
   // Sanity check file length
-  if (self.fileSize < sizeof(struct mach_header)) {
+  if (self.fileSize < sizeof(struct mach_header) || !self.fileHandle) {
     self.cachedHeaders = [NSDictionary dictionary];
     return self.cachedHeaders;
   }
 
-  NSMutableDictionary* machHeaders = [NSMutableDictionary dictionary];
+  // The fat table and every slice header are read together, rather than
+  // reading each slice in full just to look at its first few bytes.
+  santa::FdFileReader reader(self.fileHandle.fileDescriptor, self.fileSize);
+  std::optional<santa::MachOHeaders> headers = santa::ReadMachOHeaders(reader);
 
-  NSData* machHeader =
-      [self parseSingleMachHeader:[self safeSubdataWithRange:NSMakeRange(0, 4096)]];
-  if (machHeader) {
-    struct mach_header* mh = (struct mach_header*)[machHeader bytes];
-    MachHeaderWithOffset* mhwo = [[MachHeaderWithOffset alloc] initWithData:machHeader offset:0];
-    machHeaders[[self nameForCPUType:mh->cputype cpuSubType:mh->cpusubtype]] = mhwo;
-  } else {
-    NSRange range = NSMakeRange(0, sizeof(struct fat_header));
-    NSData* fatHeader = [self safeSubdataWithRange:range];
-    struct fat_header* fh = (struct fat_header*)[fatHeader bytes];
-
-    if (fatHeader && (fh->magic == FAT_CIGAM || fh->magic == FAT_MAGIC)) {
-      int nfat_arch = OSSwapBigToHostInt32(fh->nfat_arch);
-      range = NSMakeRange(sizeof(struct fat_header), sizeof(struct fat_arch) * nfat_arch);
-      NSMutableData* fatArchs = [[self safeSubdataWithRange:range] mutableCopy];
-      if (fatArchs) {
-        struct fat_arch* fat_arch = (struct fat_arch*)[fatArchs mutableBytes];
-        for (int i = 0; i < nfat_arch; ++i) {
-          int offset = OSSwapBigToHostInt32(fat_arch[i].offset);
-          int size = OSSwapBigToHostInt32(fat_arch[i].size);
-          int cputype = OSSwapBigToHostInt(fat_arch[i].cputype);
-          int cpusubtype = OSSwapBigToHostInt(fat_arch[i].cpusubtype);
-
-          range = NSMakeRange(offset, size);
-          NSData* machHeader = [self parseSingleMachHeader:[self safeSubdataWithRange:range]];
-          if (machHeader) {
-            NSString* key = [self nameForCPUType:cputype cpuSubType:cpusubtype];
-            MachHeaderWithOffset* mhwo = [[MachHeaderWithOffset alloc] initWithData:machHeader
-                                                                             offset:offset];
-            machHeaders[key] = mhwo;
-          }
-        }
+  NSMutableDictionary* machHeaders = [NSMutableDictionary dictionary];
+  if (headers) {
+    for (const santa::MachOSliceHeader& slice : headers->slices) {
+      NSData* machHeader = [NSData dataWithBytes:&slice.header length:sizeof(slice.header)];
+      MachHeaderWithOffset* mhwo = [[MachHeaderWithOffset alloc] initWithData:machHeader
+                                                                       offset:slice.slice_offset];
+      if (slice.first_segment_is_page_zero) {
+        mhwo.firstSegmentIsPageZero = @(*slice.first_segment_is_page_zero);
       }
+      machHeaders[[self nameForCPUType:slice.cputype cpuSubType:slice.cpusubtype]] = mhwo;
     }
   }
 
@@ -537,34 +545,6 @@
   return self.cachedHeaders;
 }
 
-- (NSData*)parseSingleMachHeader:(NSData*)inputData {
-  if (inputData.length < sizeof(struct mach_header)) return nil;
-  struct mach_header* mh = (struct mach_header*)[inputData bytes];
-
-  if (mh->magic == MH_CIGAM || mh->magic == MH_CIGAM_64) {
-    NSMutableData* mutableInput = [inputData mutableCopy];
-    mh = (struct mach_header*)[mutableInput mutableBytes];
-
-    // swap_mach_header() was deprecated in macOS 13 and there is no replacement.
-    // This is probably because both Intel and Apple Silicon are little-endian and
-    // almost every Mach-O file we'll ever see will be too but _just in case_ we
-    // ever see a big-endian binary we still support reading the header.
-    mh->magic = OSSwapInt32(mh->magic);
-    mh->cputype = OSSwapInt32(mh->cputype);
-    mh->cpusubtype = OSSwapInt32(mh->cpusubtype);
-    mh->filetype = OSSwapInt32(mh->filetype);
-    mh->ncmds = OSSwapInt32(mh->ncmds);
-    mh->sizeofcmds = OSSwapInt32(mh->sizeofcmds);
-    mh->flags = OSSwapInt32(mh->flags);
-  }
-
-  if (mh->magic == MH_MAGIC || mh->magic == MH_MAGIC_64) {
-    return [NSData dataWithBytes:mh length:sizeof(struct mach_header)];
-  }
-
-  return nil;
-}
-
 ///
 ///  Locate an embedded plist in the file
 ///
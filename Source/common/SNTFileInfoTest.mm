@@ -66,6 +66,27 @@
                         @"5e089b65a1e7a4696d84a34510710b6993d1de21250c41daaec63d9981083eba");
 }
 
+- (void)testHashesFollowFileModification {
+  NSString* path = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+  XCTAssertTrue([@"hello" writeToFile:path atomically:NO encoding:NSUTF8StringEncoding error:nil]);
+
+  XCTAssertFalse([[SNTFileInfo alloc] initWithPath:path].hasKnownSHA256);
+  NSString* first = [[SNTFileInfo alloc] initWithPath:path].SHA256;
+  XCTAssertEqualObjects(first, @"2cf24dba5fb0a30e26e83b2ac5b9e29e1b161e5c1fa7425e73043362938b9824");
+
+  // A second instance for the same unmodified file gets the same digest
+  XCTAssertTrue([[SNTFileInfo alloc] initWithPath:path].hasKnownSHA256);
+  XCTAssertEqualObjects([[SNTFileInfo alloc] initWithPath:path].SHA256, first);
+
+  XCTAssertTrue([@"world" writeToFile:path atomically:NO encoding:NSUTF8StringEncoding error:nil]);
+  XCTAssertFalse([[SNTFileInfo alloc] initWithPath:path].hasKnownSHA256);
+  XCTAssertEqualObjects([[SNTFileInfo alloc] initWithPath:path].SHA256,
+                        @"486ea46224d1bb4fb680f34f7c9ad96a8f24ec88be73ea8e5a6c65260e9cb8a7");
+
+  [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
 - (void)testExecutable {
   SNTFileInfo* sut = [[SNTFileInfo alloc] initWithPath:@"/sbin/launchd"];
 
@@ -32,6 +32,7 @@
  *     * `SNTMetricGaugeDouble`
  *     * `SNTMetricString`
  *     * `SNTMetricBool`
+ *     * `SNTMetricHistogram`
  */
 
 NS_ASSUME_NONNULL_BEGIN
@@ -47,6 +48,7 @@ typedef NS_ENUM(NSInteger, SNTMetricType) {
   SNTMetricTypeGaugeInt64 = 7,
   SNTMetricTypeGaugeDouble = 8,
   SNTMetricTypeCounter = 9,
+  SNTMetricTypeHistogram = 10,
 };
 
 NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType);
@@ -81,6 +83,18 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType);
 - (BOOL)getBoolValueForFieldValues:(NSArray<NSString*>*)fieldValues;
 @end
 
+/**
+ * A cumulative distribution of values over fixed buckets. Bucket i counts values less than
+ * bucketBounds[i] that aren't counted by an earlier bucket, and a final bucket counts the rest.
+ *
+ * Each exported value is a dictionary with the "count", "mean", "sum_of_squared_deviation",
+ * "bucket_bounds" and "bucket_counts" of the distribution.
+ */
+@interface SNTMetricHistogram : SNTMetric
+- (void)record:(double)value forFieldValues:(NSArray<NSString*>*)fieldValues;
+- (NSDictionary*)getDistributionForFieldValues:(NSArray<NSString*>*)fieldValues;
+@end
+
 /**
  * A registry of metrics with associated fields.
  */
@@ -171,6 +185,20 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType);
                                     fieldNames:(NSArray<NSString*>*)fieldNames
                                       helpText:(NSString*)helpText;
 
+/**
+ * Returns a histogram metric with the given name, help text and bucket bounds,
+ * registered with this metric set.
+ *
+ * @param name The metric name, for example @"/santa/auth_latency_ms".
+ * @param fieldNames The metric's field names, for example @[@"event"].
+ * @param helpText The metric's help description.
+ * @param bucketBounds Upper bounds of the buckets, in increasing order.
+ */
+- (SNTMetricHistogram*)histogramWithName:(NSString*)name
+                              fieldNames:(NSArray<NSString*>*)fieldNames
+                                helpText:(NSString*)helpText
+                            bucketBounds:(NSArray<NSNumber*>*)bucketBounds;
+
 /** Creates a constant metric with a string value and no fields. */
 - (void)addConstantStringWithName:(NSString*)name
                          helpText:(NSString*)helpText
@@ -199,4 +227,11 @@ NSString* SNTMetricStringFromMetricFormatType(SNTMetricFormatType format);
  */
 NSDictionary* SNTMetricConvertDatesToISO8601Strings(NSDictionary* metrics);
 
+/** Returns a copy of an exported dictionary with only the metric values that
+ *  differ from those in a previous export, or are new since it. Metrics left
+ *  with no values are omitted.
+ */
+NSDictionary* SNTMetricChangedSinceExport(NSDictionary* _Nullable previous,
+                                          NSDictionary* current);
+
 NS_ASSUME_NONNULL_END
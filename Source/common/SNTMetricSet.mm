@@ -16,6 +16,14 @@
 #import "SNTMetricSet.h"
 #import "SNTCommonEnums.h"
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Source/common/ShardedCounter.h"
+#include "absl/synchronization/mutex.h"
+
 NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
   NSString* typeStr;
   switch (metricType) {
@@ -28,6 +36,7 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
     case SNTMetricTypeGaugeInt64: typeStr = @"SNTMetricTypeGaugeInt64"; break;
     case SNTMetricTypeGaugeDouble: typeStr = @"SNTMetricTypeGaugeDouble"; break;
     case SNTMetricTypeCounter: typeStr = @"SNTMetricTypeCounter"; break;
+    case SNTMetricTypeHistogram: typeStr = @"SNTMetricTypeHistogram"; break;
     default: typeStr = [NSString stringWithFormat:@"SNTMetricTypeUnknown %ld", metricType]; break;
   }
   return typeStr;
@@ -41,6 +50,9 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
  *  It is intended to only be used by SNTMetrics;
  */
 @interface SNTMetricValue : NSObject
+/** Initialize a value holding a distribution over the given bucket bounds. */
+- (instancetype)initWithBucketBounds:(std::vector<double>)bucketBounds;
+
 /** Increment the counter by the step value, updating timestamps appropriately. */
 - (void)addInt64:(long long)step;
 
@@ -56,6 +68,9 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 /** Set the BOOL string value. */
 - (void)setBool:(BOOL)value;
 
+/** Record a value in the distribution. Only valid if initialized with bucket bounds. */
+- (void)recordDistributionValue:(double)value;
+
 /**
  * Clears the last update timestamp.
  *
@@ -67,11 +82,12 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 - (long long)getInt64Value;
 - (double)getDoubleValue;
 - (NSString*)getStringValue;
+- (NSDictionary*)getDistributionValue;
 @end
 
 @implementation SNTMetricValue {
-  /** The int64 value for the SNTMetricValue, if set. */
-  long long _int64Value;
+  /** The int64 value and last update time, sharded so that increments don't contend. */
+  std::unique_ptr<santa::ShardedCounter> _counter;
 
   /** The double value for the SNTMetricValue, if set. */
   double _doubleValue;
@@ -82,47 +98,48 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
   /** The boolean value for the SNTMetricValue, if set. */
   BOOL _boolValue;
 
+  /** The distribution for the SNTMetricValue, if initialized with bucket bounds. */
+  std::unique_ptr<santa::ShardedHistogram> _histogram;
+
   /** The first time this cell got created in the current process. */
   NSDate* _creationTime;
-
-  /** The last time that the counter value was changed. */
-  NSDate* _lastUpdate;
 }
 
 - (instancetype)init {
   self = [super init];
   if (self) {
+    _counter = std::make_unique<santa::ShardedCounter>();
     _creationTime = [NSDate date];
-    _lastUpdate = _creationTime;
+    _counter->Touch(_creationTime.timeIntervalSinceReferenceDate);
   }
   return self;
 }
 
-- (void)addInt64:(long long)step {
-  @synchronized(self) {
-    _int64Value += step;
-    _lastUpdate = [NSDate date];
+- (instancetype)initWithBucketBounds:(std::vector<double>)bucketBounds {
+  self = [self init];
+  if (self) {
+    _histogram = std::make_unique<santa::ShardedHistogram>(std::move(bucketBounds));
   }
+  return self;
+}
+
+- (void)addInt64:(long long)step {
+  _counter->Add(step, [NSDate date].timeIntervalSinceReferenceDate);
 }
 
 - (void)setInt64:(long long)value {
-  @synchronized(self) {
-    _int64Value = value;
-    _lastUpdate = [NSDate date];
-  }
+  _counter->Set(value, [NSDate date].timeIntervalSinceReferenceDate);
 }
 
 - (long long)getInt64Value {
-  @synchronized(self) {
-    return _int64Value;
-  }
+  return _counter->Value();
 }
 
 - (void)setDouble:(double)value {
   @synchronized(self) {
     _doubleValue = value;
-    _lastUpdate = [NSDate date];
   }
+  _counter->Touch([NSDate date].timeIntervalSinceReferenceDate);
 }
 
 - (double)getDoubleValue {
@@ -134,8 +151,8 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 - (void)setString:(NSString*)value {
   @synchronized(self) {
     _stringValue = [value copy];
-    _lastUpdate = [NSDate date];
   }
+  _counter->Touch([NSDate date].timeIntervalSinceReferenceDate);
 }
 
 - (NSString*)getStringValue {
@@ -147,8 +164,8 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 - (void)setBool:(BOOL)value {
   @synchronized(self) {
     _boolValue = value;
-    _lastUpdate = [NSDate date];
   }
+  _counter->Touch([NSDate date].timeIntervalSinceReferenceDate);
 }
 
 - (BOOL)getBoolValue {
@@ -157,26 +174,53 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
   }
 }
 
-- (void)clearLastUpdateTimestamp {
-  @synchronized(self) {
-    _lastUpdate = nil;
+- (void)recordDistributionValue:(double)value {
+  _histogram->Record(value);
+  _counter->Touch([NSDate date].timeIntervalSinceReferenceDate);
+}
+
+- (NSDictionary*)getDistributionValue {
+  if (!_histogram) {
+    return nil;
+  }
+
+  santa::ShardedHistogram::Snapshot snapshot = _histogram->TakeSnapshot();
+  double mean = snapshot.count ? snapshot.sum / snapshot.count : 0;
+  // Clamp rounding errors that could otherwise make this slightly negative
+  double sumOfSquaredDeviation = std::max(0.0, snapshot.sum_of_squares - snapshot.sum * mean);
+
+  NSMutableArray<NSNumber*>* bounds = [NSMutableArray array];
+  for (double bound : _histogram->Bounds()) {
+    [bounds addObject:@(bound)];
   }
+  NSMutableArray<NSNumber*>* counts = [NSMutableArray array];
+  for (uint64_t count : snapshot.bucket_counts) {
+    [counts addObject:@(count)];
+  }
+
+  return @{
+    @"count" : @(snapshot.count),
+    @"mean" : @(mean),
+    @"sum_of_squared_deviation" : @(sumOfSquaredDeviation),
+    @"bucket_bounds" : bounds,
+    @"bucket_counts" : counts,
+  };
+}
+
+- (void)clearLastUpdateTimestamp {
+  _counter->ClearLastUpdate();
 }
 
 - (NSDate*)getLastUpdatedTimestamp {
-  NSDate* updated = nil;
-  @synchronized(self) {
-    updated = [_lastUpdate copy];
+  double lastUpdate = _counter->LastUpdate();
+  if (lastUpdate == 0) {
+    return nil;
   }
-  return updated;
+  return [NSDate dateWithTimeIntervalSinceReferenceDate:lastUpdate];
 }
 
 - (NSDate*)getCreatedTimestamp {
-  NSDate* created = nil;
-  @synchronized(self) {
-    created = [_creationTime copy];
-  }
-  return created;
+  return _creationTime;
 }
 @end
 
@@ -192,6 +236,8 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
   /** Mapping of field values to actual metric values (e.g. metric /proc/cpu_usage @"mode"=@"user"
    * -> 0.89 */
   NSMutableDictionary<NSArray<NSString*>*, SNTMetricValue*>* _metricsForFieldValues;
+  /** Guards _metricsForFieldValues. Lookups of existing values only need a reader lock. */
+  absl::Mutex _metricsForFieldValuesLock;
   /** the type of metric this is e.g. counter, gauge etc. **/
   SNTMetricType _type;
 }
@@ -223,22 +269,32 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
          [_fieldNames isEqualTo:other->_fieldNames] && _type == other->_type;
 }
 
+/** Creates the SNTMetricValue for a new set of field values. */
+- (SNTMetricValue*)newMetricValue {
+  return [[SNTMetricValue alloc] init];
+}
+
 /** Retrieves the SNTMetricValue for a given field value.
    Creates a new SNTMetricValue if none is present. */
 - (SNTMetricValue*)metricValueForFieldValues:(NSArray<NSString*>*)fieldValues {
   NSParameterAssert(fieldValues.count == _fieldNames.count);
-  SNTMetricValue* metricValue = nil;
-  @synchronized(self) {
-    metricValue = _metricsForFieldValues[fieldValues];
-
-    if (!metricValue) {
-      // Deep copy to prevent mutations to the keys we store in the dictionary.
-      fieldValues = [fieldValues copy];
-      metricValue = [[SNTMetricValue alloc] init];
-      _metricsForFieldValues[fieldValues] = metricValue;
+  {
+    absl::ReaderMutexLock lock(_metricsForFieldValuesLock);
+    SNTMetricValue* metricValue = _metricsForFieldValues[fieldValues];
+    if (metricValue) {
+      return metricValue;
     }
   }
 
+  absl::MutexLock lock(_metricsForFieldValuesLock);
+  SNTMetricValue* metricValue = _metricsForFieldValues[fieldValues];
+  if (!metricValue) {
+    // Deep copy to prevent mutations to the keys we store in the dictionary.
+    fieldValues = [fieldValues copy];
+    metricValue = [self newMetricValue];
+    _metricsForFieldValues[fieldValues] = metricValue;
+  }
+
   return metricValue;
 }
 
@@ -267,6 +323,7 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
       break;
     case SNTMetricTypeConstantString:
     case SNTMetricTypeGaugeString: fieldDict[@"data"] = [metricValue getStringValue]; break;
+    case SNTMetricTypeHistogram: fieldDict[@"data"] = [metricValue getDistributionValue]; break;
     default: break;
   }
   return fieldDict;
@@ -283,6 +340,7 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
   } else {
     NSMutableArray* fieldVals = [[NSMutableArray alloc] init];
 
+    absl::ReaderMutexLock lock(_metricsForFieldValuesLock);
     for (NSArray<NSString*>* fieldValues in _metricsForFieldValues) {
       [fieldVals addObject:[self encodeMetricValueForFieldValues:fieldValues]];
     }
@@ -432,6 +490,48 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 }
 @end
 
+@implementation SNTMetricHistogram {
+  std::vector<double> _bucketBounds;
+}
+
+- (instancetype)initWithName:(NSString*)name
+                  fieldNames:(NSArray<NSString*>*)fieldNames
+                    helpText:(NSString*)helpText
+                bucketBounds:(NSArray<NSNumber*>*)bucketBounds {
+  self = [super initWithName:name
+                  fieldNames:fieldNames
+                    helpText:helpText
+                        type:SNTMetricTypeHistogram];
+  if (self) {
+    for (NSNumber* bound in bucketBounds) {
+      _bucketBounds.push_back(bound.doubleValue);
+    }
+    NSAssert(std::is_sorted(_bucketBounds.begin(), _bucketBounds.end()),
+             @"histogram bucket bounds must be sorted: %@", name);
+  }
+  return self;
+}
+
+- (BOOL)hasSameSchemaAsMetric:(SNTMetric*)other {
+  return [super hasSameSchemaAsMetric:other] &&
+         _bucketBounds == ((SNTMetricHistogram*)other)->_bucketBounds;
+}
+
+- (SNTMetricValue*)newMetricValue {
+  return [[SNTMetricValue alloc] initWithBucketBounds:_bucketBounds];
+}
+
+- (void)record:(double)value forFieldValues:(NSArray<NSString*>*)fieldValues {
+  SNTMetricValue* metricValue = [self metricValueForFieldValues:fieldValues];
+  [metricValue recordDistributionValue:value];
+}
+
+- (NSDictionary*)getDistributionForFieldValues:(NSArray<NSString*>*)fieldValues {
+  SNTMetricValue* metricValue = [self metricValueForFieldValues:fieldValues];
+  return [metricValue getDistributionValue];
+}
+@end
+
 /**
  *  SNTMetricSet is the top level container for all metrics and metrics value
  *  its is abstracted from specific implementations but is close to Google's
@@ -565,6 +665,17 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
   return (SNTMetricBooleanGauge*)[self registerMetric:b];
 }
 
+- (SNTMetricHistogram*)histogramWithName:(NSString*)name
+                              fieldNames:(NSArray<NSString*>*)fieldNames
+                                helpText:(NSString*)helpText
+                            bucketBounds:(NSArray<NSNumber*>*)bucketBounds {
+  SNTMetricHistogram* h = [[SNTMetricHistogram alloc] initWithName:name
+                                                        fieldNames:fieldNames
+                                                          helpText:helpText
+                                                      bucketBounds:bucketBounds];
+  return (SNTMetricHistogram*)[self registerMetric:h];
+}
+
 - (void)addConstantStringWithName:(NSString*)name
                          helpText:(NSString*)helpText
                             value:(NSString*)value {
@@ -637,6 +748,7 @@ NSString* SNTMetricStringFromMetricFormatType(SNTMetricFormatType format) {
     case SNTMetricFormatTypeRawJSON: return @"rawjson";
     case SNTMetricFormatTypeMonarchJSON: return @"monarchjson";
     case SNTMetricFormatTypeProto: return @"proto";
+    case SNTMetricFormatTypeOpenMetrics: return @"openmetrics";
     default: return @"Unknown Metric Format";
   }
 }
@@ -665,3 +777,42 @@ NSDictionary* SNTMetricConvertDatesToISO8601Strings(NSDictionary* metrics) {
 }
 
 @end
+
+NSDictionary* SNTMetricChangedSinceExport(NSDictionary* _Nullable previous,
+                                          NSDictionary* current) {
+  NSMutableDictionary* changedMetrics = [[NSMutableDictionary alloc] init];
+
+  for (NSString* metricName in current[@"metrics"]) {
+    NSDictionary* metric = current[@"metrics"][metricName];
+    NSDictionary* previousFields = previous[@"metrics"][metricName][@"fields"];
+    NSMutableDictionary* changedFields = [[NSMutableDictionary alloc] init];
+
+    for (NSString* field in metric[@"fields"]) {
+      NSMutableDictionary* previousData = [[NSMutableDictionary alloc] init];
+      for (NSDictionary* entry in previousFields[field]) {
+        previousData[entry[@"value"]] = entry[@"data"];
+      }
+
+      NSMutableArray* changedEntries = [[NSMutableArray alloc] init];
+      for (NSDictionary* entry in metric[@"fields"][field]) {
+        if (![previousData[entry[@"value"]] isEqual:entry[@"data"]]) {
+          [changedEntries addObject:entry];
+        }
+      }
+
+      if (changedEntries.count > 0) {
+        changedFields[field] = changedEntries;
+      }
+    }
+
+    if (changedFields.count > 0) {
+      NSMutableDictionary* changedMetric = [metric mutableCopy];
+      changedMetric[@"fields"] = changedFields;
+      changedMetrics[metricName] = changedMetric;
+    }
+  }
+
+  NSMutableDictionary* changed = [current mutableCopy];
+  changed[@"metrics"] = changedMetrics;
+  return changed;
+}
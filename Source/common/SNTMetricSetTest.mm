@@ -31,6 +31,9 @@
 @interface SNTMetricStringGaugeTest : XCTestCase
 @end
 
+@interface SNTMetricHistogramTest : XCTestCase
+@end
+
 @interface SNTMetricSetTest : XCTestCase
 @end
 
@@ -349,6 +352,81 @@
 
 @end
 
+@implementation SNTMetricHistogramTest
+- (void)testSimpleHistogram {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
+  SNTMetricHistogram* h = [metricSet histogramWithName:@"/santa/latency"
+                                            fieldNames:@[ @"stage" ]
+                                              helpText:@"Latency in milliseconds."
+                                          bucketBounds:@[ @1, @10 ]];
+  XCTAssertNotNil(h);
+  for (NSNumber* value in @[ @0.5, @1, @2, @4, @100 ]) {
+    [h record:value.doubleValue forFieldValues:@[ @"auth" ]];
+  }
+
+  NSDictionary* distribution = [h getDistributionForFieldValues:@[ @"auth" ]];
+  XCTAssertEqualObjects(distribution[@"count"], @5);
+  XCTAssertEqualWithAccuracy([distribution[@"mean"] doubleValue], 21.5, 0.0001);
+  // Squared deviations from the mean of 21.5: 441 + 420.25 + 380.25 + 306.25 + 6162.25
+  XCTAssertEqualWithAccuracy([distribution[@"sum_of_squared_deviation"] doubleValue], 7710,
+                             0.0001);
+  XCTAssertEqualObjects(distribution[@"bucket_bounds"], (@[ @1, @10 ]));
+  XCTAssertEqualObjects(distribution[@"bucket_counts"], (@[ @1, @3, @1 ]));
+
+  // Other field values have their own distribution
+  XCTAssertEqualObjects([h getDistributionForFieldValues:@[ @"hash" ]][@"count"], @0);
+}
+
+- (void)testExportNSDictionary {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
+  SNTMetricHistogram* h = [metricSet histogramWithName:@"/santa/latency"
+                                            fieldNames:@[]
+                                              helpText:@"Latency in milliseconds."
+                                          bucketBounds:@[ @5 ]];
+  [h record:2 forFieldValues:@[]];
+  [h record:4 forFieldValues:@[]];
+
+  NSDictionary* expected = @{
+    @"type" : [NSNumber numberWithInt:(int)SNTMetricTypeHistogram],
+    @"description" : @"Latency in milliseconds.",
+    @"fields" : @{
+      @"" : @[ @{
+        @"value" : @"",
+        @"created" : [NSDate date],
+        @"last_updated" : [NSDate date],
+        @"data" : @{
+          @"count" : @2,
+          @"mean" : @3,
+          @"sum_of_squared_deviation" : @2,
+          @"bucket_bounds" : @[ @5 ],
+          @"bucket_counts" : @[ @2, @0 ],
+        }
+      } ]
+    }
+  };
+
+  XCTAssertEqualObjects([h export], expected);
+}
+
+- (void)testAddingHistogramWithDifferentBucketsFails {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
+  SNTMetricHistogram* a = [metricSet histogramWithName:@"/santa/latency"
+                                            fieldNames:@[]
+                                              helpText:@"Latency in milliseconds."
+                                          bucketBounds:@[ @1, @10 ]];
+  SNTMetricHistogram* b = [metricSet histogramWithName:@"/santa/latency"
+                                            fieldNames:@[]
+                                              helpText:@"Latency in milliseconds."
+                                          bucketBounds:@[ @1, @10 ]];
+  XCTAssertEqual(a, b, @"Unexpected new histogram returned.");
+
+  XCTAssertThrows([metricSet histogramWithName:@"/santa/latency"
+                                    fieldNames:@[]
+                                      helpText:@"Latency in milliseconds."
+                                  bucketBounds:@[ @1, @100 ]]);
+}
+@end
+
 @implementation SNTMetricSetTest
 - (void)testRootLabels {
   SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
@@ -677,6 +755,10 @@
     @{
       @"input" : [NSNumber numberWithInt:SNTMetricTypeCounter],
       @"expected" : @"SNTMetricTypeCounter"
+    },
+    @{
+      @"input" : [NSNumber numberWithInt:SNTMetricTypeHistogram],
+      @"expected" : @"SNTMetricTypeHistogram"
     }
   ];
 
@@ -718,4 +800,42 @@
   NSDictionary* got = [metricSet export][@"metrics"];
   XCTAssertEqualObjects(expected, got, @"metrics do not match expected");
 }
+
+- (void)testChangedSinceExport {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] initWithHostname:@"testHost"
+                                                          username:@"testUser"];
+  [metricSet addConstantStringWithName:@"/build/label" helpText:@"Version" value:@"1.0"];
+  SNTMetricCounter* c = [metricSet counterWithName:@"/santa/events"
+                                        fieldNames:@[ @"rule_type" ]
+                                          helpText:@"Count of events"];
+  [c incrementForFieldValues:@[ @"binary" ]];
+  [c incrementForFieldValues:@[ @"certificate" ]];
+
+  NSDictionary* first = [metricSet export];
+
+  // Without a previous export everything has changed
+  XCTAssertEqualObjects(SNTMetricChangedSinceExport(nil, first), first);
+
+  // Nothing changed, but the root labels are kept
+  NSDictionary* unchanged = SNTMetricChangedSinceExport(first, [metricSet export]);
+  XCTAssertEqualObjects(unchanged[@"metrics"], @{});
+  XCTAssertEqualObjects(unchanged[@"root_labels"], first[@"root_labels"]);
+
+  [c incrementForFieldValues:@[ @"binary" ]];
+  [c incrementForFieldValues:@[ @"teamid" ]];
+
+  NSDictionary* changed = SNTMetricChangedSinceExport(first, [metricSet export]);
+  XCTAssertEqualObjects([changed[@"metrics"] allKeys], @[ @"/santa/events" ]);
+
+  NSArray* entries = changed[@"metrics"][@"/santa/events"][@"fields"][@"rule_type"];
+  XCTAssertEqual(entries.count, 2);
+  for (NSDictionary* entry in entries) {
+    if ([entry[@"value"] isEqualToString:@"binary"]) {
+      XCTAssertEqualObjects(entry[@"data"], @2);
+    } else {
+      XCTAssertEqualObjects(entry[@"value"], @"teamid");
+      XCTAssertEqualObjects(entry[@"data"], @1);
+    }
+  }
+}
 @end
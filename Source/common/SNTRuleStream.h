@@ -0,0 +1,63 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+#import "Source/common/SNTRule.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+///
+///  Streams rules between processes over a file descriptor, e.g. a pipe sent over XPC, as a
+///  sequence of length delimited protobufs. This avoids archiving and unarchiving every rule and
+///  lets the receiver handle rules as they arrive instead of holding the whole set twice.
+///
+///  Static rules can't be streamed, they are received as regular rules.
+///
+@interface SNTRuleStream : NSObject
+
+///
+///  Returns the read end of a pipe and writes the rules to the other end on a background queue,
+///  closing it when done. The returned handle can be sent over XPC.
+///
++ (NSFileHandle*)fileHandleStreamingRules:(NSArray<SNTRule*>*)rules;
+
+///
+///  Writes the rules to the handle. The handle is not closed. Returns NO if writing failed, e.g.
+///  because the reader went away.
+///
++ (BOOL)writeRules:(NSArray<SNTRule*>*)rules toFileHandle:(NSFileHandle*)handle;
+
+///
+///  Reads rules until the end of the stream, passing them to the handler in batches of up to
+///  batchSize as they are parsed. Returns NO if the stream is malformed, contains an invalid rule
+///  or the handler returns NO. Rules passed to the handler before a failure are not rolled back.
+///
++ (BOOL)readRulesFromFileHandle:(NSFileHandle*)handle
+                      batchSize:(NSUInteger)batchSize
+                        handler:(BOOL (^)(NSArray<SNTRule*>*))handler
+                          error:(NSError* _Nullable* _Nullable)error;
+
+///
+///  Reads all rules until the end of the stream. Returns nil on failure.
+///
++ (nullable NSArray<SNTRule*>*)readRulesFromFileHandle:(NSFileHandle*)handle
+                                                 error:(NSError* _Nullable* _Nullable)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
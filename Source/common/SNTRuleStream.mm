@@ -0,0 +1,189 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/common/SNTRuleStream.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "Source/common/String.h"
+#import "Source/common/SNTError.h"
+#include "Source/common/rule_stream.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+namespace pbrs = ::santa::pb::v1::rule_stream;
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::FileInputStream;
+using google::protobuf::io::FileOutputStream;
+using santa::NSStringToUTF8String;
+using santa::StringToNSString;
+
+namespace {
+
+// Rules are small, anything larger than this is a corrupt stream
+constexpr uint32_t kMaxRuleSize = 1 << 20;
+
+void EncodeRule(SNTRule* rule, pbrs::Rule* pb) {
+  pb->Clear();
+  pb->set_identifier(NSStringToUTF8String(rule.identifier));
+  pb->set_state(rule.state);
+  pb->set_type(rule.type);
+  if (rule.customMsg) pb->set_custom_msg(NSStringToUTF8String(rule.customMsg));
+  if (rule.customURL) pb->set_custom_url(NSStringToUTF8String(rule.customURL));
+  pb->set_timestamp(rule.timestamp);
+  if (rule.comment) pb->set_comment(NSStringToUTF8String(rule.comment));
+  if (rule.celExpr) pb->set_cel_expr(NSStringToUTF8String(rule.celExpr));
+  if (rule.seatbeltPolicy) pb->set_seatbelt_policy(NSStringToUTF8String(rule.seatbeltPolicy));
+  pb->set_rule_id(rule.ruleId);
+}
+
+NSString* StringOrNil(bool has, const std::string& value) {
+  return has ? StringToNSString(value) : nil;
+}
+
+SNTRule* DecodeRule(const pbrs::Rule& pb, NSError** error) {
+  NSError* err;
+  SNTRule* rule =
+      [[SNTRule alloc] initWithIdentifier:StringToNSString(pb.identifier())
+                                    state:(SNTRuleState)pb.state()
+                                     type:(SNTRuleType)pb.type()
+                                customMsg:StringOrNil(pb.has_custom_msg(), pb.custom_msg())
+                                customURL:StringOrNil(pb.has_custom_url(), pb.custom_url())
+                                timestamp:pb.timestamp()
+                                  comment:StringOrNil(pb.has_comment(), pb.comment())
+                                  celExpr:StringOrNil(pb.has_cel_expr(), pb.cel_expr())
+                           seatbeltPolicy:StringOrNil(pb.has_seatbelt_policy(),
+                                                      pb.seatbelt_policy())
+                                   ruleId:pb.rule_id()
+                                    error:&err];
+  if (!rule && error) {
+    *error = err ?: [SNTError createErrorWithCode:SNTErrorCodeRuleInvalid
+                                           format:@"Rule stream contains an invalid rule"];
+  }
+  return rule;
+}
+
+}  // namespace
+
+@implementation SNTRuleStream
+
++ (NSFileHandle*)fileHandleStreamingRules:(NSArray<SNTRule*>*)rules {
+  NSPipe* pipe = [NSPipe pipe];
+  NSFileHandle* writeHandle = pipe.fileHandleForWriting;
+
+  // If the reader goes away, fail the write rather than killing this process
+  fcntl(writeHandle.fileDescriptor, F_SETNOSIGPIPE, 1);
+
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+    [self writeRules:rules toFileHandle:writeHandle];
+    [writeHandle closeFile];
+  });
+
+  return pipe.fileHandleForReading;
+}
+
++ (BOOL)writeRules:(NSArray<SNTRule*>*)rules toFileHandle:(NSFileHandle*)handle {
+  FileOutputStream output(handle.fileDescriptor);
+  bool ok = true;
+  {
+    CodedOutputStream coded(&output);
+    pbrs::Rule pb;
+    for (SNTRule* rule in rules) {
+      @autoreleasepool {
+        EncodeRule(rule, &pb);
+        coded.WriteVarint32((uint32_t)pb.ByteSizeLong());
+        pb.SerializeWithCachedSizes(&coded);
+      }
+      if (coded.HadError()) {
+        ok = false;
+        break;
+      }
+    }
+  }
+  return output.Flush() && ok;
+}
+
++ (BOOL)readRulesFromFileHandle:(NSFileHandle*)handle
+                      batchSize:(NSUInteger)batchSize
+                        handler:(BOOL (^)(NSArray<SNTRule*>*))handler
+                          error:(NSError**)error {
+  FileInputStream input(handle.fileDescriptor);
+  NSMutableArray<SNTRule*>* batch = [NSMutableArray array];
+  pbrs::Rule pb;
+
+  while (true) {
+    // Each message gets a fresh CodedInputStream so the total bytes limit applies per rule. It
+    // returns any read ahead to the underlying stream when destroyed.
+    CodedInputStream coded(&input);
+    uint32_t size;
+    int start = coded.CurrentPosition();
+    if (!coded.ReadVarint32(&size)) {
+      if (coded.CurrentPosition() == start && input.GetErrno() == 0) {
+        break;  // End of stream
+      }
+      [SNTError populateError:error
+                     withCode:SNTErrorCodeFailedToParseProto
+                       format:@"Rule stream ended unexpectedly"];
+      return NO;
+    }
+
+    if (size > kMaxRuleSize) {
+      [SNTError populateError:error
+                     withCode:SNTErrorCodeFailedToParseProto
+                       format:@"Rule stream contains an oversized rule: %u bytes", size];
+      return NO;
+    }
+
+    CodedInputStream::Limit limit = coded.PushLimit(size);
+    if (!pb.ParseFromCodedStream(&coded) || !coded.ConsumedEntireMessage() ||
+        coded.BytesUntilLimit() != 0) {
+      [SNTError populateError:error
+                     withCode:SNTErrorCodeFailedToParseProto
+                       format:@"Rule stream contains a malformed rule"];
+      return NO;
+    }
+    coded.PopLimit(limit);
+
+    SNTRule* rule = DecodeRule(pb, error);
+    if (!rule) return NO;
+    [batch addObject:rule];
+
+    if (batch.count >= batchSize) {
+      if (!handler([batch copy])) return NO;
+      [batch removeAllObjects];
+    }
+  }
+
+  return batch.count == 0 || handler([batch copy]);
+}
+
++ (NSArray<SNTRule*>*)readRulesFromFileHandle:(NSFileHandle*)handle error:(NSError**)error {
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  BOOL ok = [self readRulesFromFileHandle:handle
+                                batchSize:NSUIntegerMax
+                                  handler:^BOOL(NSArray<SNTRule*>* batch) {
+                                    [rules addObjectsFromArray:batch];
+                                    return YES;
+                                  }
+                                    error:error];
+  return ok ? rules : nil;
+}
+
+@end
@@ -0,0 +1,144 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <XCTest/XCTest.h>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTError.h"
+#import "Source/common/SNTRule.h"
+#import "Source/common/SNTRuleStream.h"
+
+@interface SNTRuleStreamTest : XCTestCase
+@end
+
+@implementation SNTRuleStreamTest
+
+- (NSArray<SNTRule*>*)rulesWithCount:(NSUInteger)count {
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray arrayWithCapacity:count];
+  for (NSUInteger i = 0; i < count; i++) {
+    NSString* identifier = [NSString stringWithFormat:@"%064lx", (unsigned long)i];
+    [rules addObject:[[SNTRule alloc] initWithIdentifier:identifier
+                                                   state:SNTRuleStateBlock
+                                                    type:SNTRuleTypeBinary
+                                               customMsg:(i % 2) ? @"Blocked" : nil
+                                               customURL:nil
+                                               timestamp:i
+                                                 comment:nil
+                                                 celExpr:nil
+                                          seatbeltPolicy:nil
+                                                  ruleId:(int64_t)i + 1
+                                                   error:nil]];
+  }
+  return rules;
+}
+
+- (void)testRoundTrip {
+  SNTRule* cel = [[SNTRule alloc] initWithIdentifier:@"EQHXZ8M8AV"
+                                               state:SNTRuleStateCEL
+                                                type:SNTRuleTypeTeamID
+                                           customMsg:@"msg"
+                                           customURL:@"https://example.com"
+                                           timestamp:0
+                                             comment:@"comment"
+                                             celExpr:@"target.signing_time > 0"
+                                      seatbeltPolicy:nil
+                                              ruleId:42
+                                               error:nil];
+  XCTAssertNotNil(cel);
+  NSArray<SNTRule*>* rules = [[self rulesWithCount:3] arrayByAddingObject:cel];
+
+  NSError* err;
+  NSArray<SNTRule*>* got =
+      [SNTRuleStream readRulesFromFileHandle:[SNTRuleStream fileHandleStreamingRules:rules]
+                                       error:&err];
+  XCTAssertNil(err);
+  XCTAssertEqualObjects(got, rules);
+
+  for (NSUInteger i = 0; i < rules.count; i++) {
+    XCTAssertEqualObjects(got[i].customMsg, rules[i].customMsg);
+    XCTAssertEqualObjects(got[i].customURL, rules[i].customURL);
+    XCTAssertEqualObjects(got[i].comment, rules[i].comment);
+    XCTAssertEqual(got[i].timestamp, rules[i].timestamp);
+    XCTAssertEqual(got[i].ruleId, rules[i].ruleId);
+  }
+}
+
+- (void)testEmptyStream {
+  NSError* err;
+  NSArray<SNTRule*>* got =
+      [SNTRuleStream readRulesFromFileHandle:[SNTRuleStream fileHandleStreamingRules:@[]]
+                                       error:&err];
+  XCTAssertNil(err);
+  XCTAssertEqualObjects(got, @[]);
+}
+
+- (void)testReadsInBatches {
+  // Larger than a pipe buffer, so reading has to happen while the rules are being written
+  NSArray<SNTRule*>* rules = [self rulesWithCount:25000];
+
+  __block NSMutableArray<NSNumber*>* batchSizes = [NSMutableArray array];
+  __block NSMutableArray<SNTRule*>* got = [NSMutableArray array];
+  BOOL ok = [SNTRuleStream readRulesFromFileHandle:[SNTRuleStream fileHandleStreamingRules:rules]
+                                         batchSize:10000
+                                           handler:^BOOL(NSArray<SNTRule*>* batch) {
+                                             [batchSizes addObject:@(batch.count)];
+                                             [got addObjectsFromArray:batch];
+                                             return YES;
+                                           }
+                                             error:nil];
+  XCTAssertTrue(ok);
+  XCTAssertEqualObjects(batchSizes, (@[ @10000, @10000, @5000 ]));
+  XCTAssertEqualObjects(got, rules);
+}
+
+- (void)testHandlerCanStopReading {
+  __block int batches = 0;
+  BOOL ok = [SNTRuleStream
+      readRulesFromFileHandle:[SNTRuleStream fileHandleStreamingRules:[self rulesWithCount:100]]
+                    batchSize:10
+                      handler:^BOOL(NSArray<SNTRule*>* batch) {
+                        batches++;
+                        return NO;
+                      }
+                        error:nil];
+  XCTAssertFalse(ok);
+  XCTAssertEqual(batches, 1);
+}
+
+- (void)testMalformedStream {
+  NSPipe* pipe = [NSPipe pipe];
+  // A length prefix claiming more bytes than follow
+  const uint8_t truncated[] = {0x10, 0x0a, 0x02};
+  [pipe.fileHandleForWriting writeData:[NSData dataWithBytes:truncated length:sizeof(truncated)]];
+  [pipe.fileHandleForWriting closeFile];
+
+  NSError* err;
+  XCTAssertNil([SNTRuleStream readRulesFromFileHandle:pipe.fileHandleForReading error:&err]);
+  XCTAssertEqual(err.code, SNTErrorCodeFailedToParseProto);
+}
+
+- (void)testInvalidRule {
+  NSPipe* pipe = [NSPipe pipe];
+  // A rule with no identifier: state and type set, identifier missing
+  const uint8_t invalid[] = {0x04, 0x10, 0x01, 0x18, 0x01};
+  [pipe.fileHandleForWriting writeData:[NSData dataWithBytes:invalid length:sizeof(invalid)]];
+  [pipe.fileHandleForWriting closeFile];
+
+  NSError* err;
+  XCTAssertNil([SNTRuleStream readRulesFromFileHandle:pipe.fileHandleForReading error:&err]);
+  XCTAssertNotNil(err);
+}
+
+@end
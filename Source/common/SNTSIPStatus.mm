@@ -17,6 +17,7 @@
 #include <sys/cdefs.h>
 
 #import "Source/common/SNTLogging.h"
+#include "Source/common/Memoizer.h"
 
 __BEGIN_DECLS
 
@@ -31,6 +32,14 @@ __END_DECLS;
 @implementation SNTSIPStatus
 
 + (csr_config_t)currentStatus {
+  // The active configuration can only change across a reboot
+  static auto* status = new santa::ConcurrentMemoizer<csr_config_t>([] {
+    return [SNTSIPStatus readActiveConfig];
+  });
+  return (*status)();
+}
+
++ (csr_config_t)readActiveConfig {
   if (csr_get_active_config == NULL) {
     LOGW(@"csr_get_active_config is not available");
     // Returning MAX to indicate that we have been unable to get the status as returning
@@ -24,6 +24,13 @@
 /// An index for this event, randomly generated during initialization.
 @property(nonnull) NSNumber* idx;
 
+/// The number of times this event occurred while waiting to be uploaded, including the first.
+/// Later occurrences with the same `uniqueID` are merged into the stored event.
+@property NSUInteger occurrenceCount;
+
+/// The date and time of the most recent merged occurrence, nil if there were none.
+@property(nullable) NSDate* lastOccurrenceDate;
+
 // Subclasses are required to define: `uniqueID`.
 // The base class implementation will throw an exception.
 - (nullable NSString*)uniqueID;
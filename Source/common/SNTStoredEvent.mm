@@ -26,6 +26,8 @@
 - (void)encodeWithCoder:(NSCoder*)coder {
   ENCODE(coder, idx);
   ENCODE(coder, occurrenceDate);
+  ENCODE_BOXABLE(coder, occurrenceCount);
+  ENCODE(coder, lastOccurrenceDate);
 }
 
 - (instancetype)init {
@@ -33,6 +35,7 @@
   if (self) {
     _idx = @(arc4random());
     _occurrenceDate = [NSDate date];
+    _occurrenceCount = 1;
   }
   return self;
 }
@@ -42,6 +45,10 @@
   if (self) {
     DECODE(decoder, idx, NSNumber);
     DECODE(decoder, occurrenceDate, NSDate);
+    DECODE_SELECTOR(decoder, occurrenceCount, NSNumber, unsignedIntegerValue);
+    DECODE(decoder, lastOccurrenceDate, NSDate);
+    // Archives from before occurrences were counted
+    if (_occurrenceCount == 0) _occurrenceCount = 1;
   }
   return self;
 }
@@ -16,6 +16,11 @@
 #import "Source/common/SNTSystemInfo.h"
 #include <sys/sysctl.h>
 
+#include "Source/common/Memoizer.h"
+
+// The hostname can change at any time but rarely does, and it is read for every block message.
+static constexpr absl::Duration kHostnameTTL = absl::Seconds(30);
+
 @implementation SNTSystemInfo
 
 + (NSString*)serialNumber {
@@ -84,16 +89,26 @@
 }
 
 + (NSString*)longHostname {
-  char hostname[MAXHOSTNAMELEN];
-  gethostname(hostname, (int)sizeof(hostname));
-  return @(hostname);
+  static auto* hostname = new santa::ConcurrentMemoizer<NSString*>(
+      [] {
+        char name[MAXHOSTNAMELEN];
+        gethostname(name, (int)sizeof(name));
+        return @(name);
+      },
+      kHostnameTTL);
+  return (*hostname)();
 }
 
 + (NSString*)modelIdentifier {
-  char model[32];
-  size_t len = 32;
-  sysctlbyname("hw.model", model, &len, NULL, 0);
-  return @(model);
+  static NSString* modelIdentifier;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    char model[32];
+    size_t len = 32;
+    sysctlbyname("hw.model", model, &len, NULL, 0);
+    modelIdentifier = @(model);
+  });
+  return modelIdentifier;
 }
 
 + (NSString*)santaProductVersion {
@@ -113,9 +128,15 @@
 
 #pragma mark - Internal
 
+// The OS version can only change across a reboot, so the plist is only read once per process.
 + (NSDictionary*)_systemVersionDictionary {
-  return [NSDictionary
-      dictionaryWithContentsOfFile:@"/System/Library/CoreServices/SystemVersion.plist"];
+  static NSDictionary* systemVersion;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    systemVersion = [NSDictionary
+        dictionaryWithContentsOfFile:@"/System/Library/CoreServices/SystemVersion.plist"];
+  });
+  return systemVersion;
 }
 
 @end
@@ -35,6 +35,14 @@
 ///
 - (void)flushCache:(void (^)(BOOL))reply;
 
+///
+///  Debugging ops
+///
+///  Enable or disable os_signpost intervals for santad's startup and event processing. The
+///  setting persists across restarts so that startup can be traced.
+///
+- (void)setSignpostsEnabled:(BOOL)enabled reply:(void (^)(void))reply;
+
 ///
 ///  Database ops
 ///
@@ -48,12 +56,58 @@ typedef NS_ENUM(NSInteger, SNTRuleAddSource) {
                           ruleCleanup:(SNTRuleCleanup)cleanupType
                                source:(SNTRuleAddSource)source
                                 reply:(void (^)(BOOL, NSArray<NSError*>* error))reply;
-- (void)databaseEventsPending:(void (^)(NSArray<SNTStoredEvent*>* events))reply;
+///
+///  Large rule sets can be sent in batches. Each batch of execution rules is staged by santad
+///  and the whole set is applied in a single transaction when it is committed, together with any
+///  file access and network flow rules. `count` is the total number of execution rules staged.
+///  Staging a new set starts by discarding any previous one.
+///
+- (void)databaseRuleDiscardStagedRules:(void (^)(void))reply;
+- (void)databaseRuleStageExecutionRules:(NSArray<SNTRule*>*)executionRules
+                                 source:(SNTRuleAddSource)source
+                                  reply:(void (^)(BOOL, NSArray<NSError*>* error))reply;
+///
+///  Same as databaseRuleStageExecutionRules:source:reply: but the rules are read from a stream
+///  written with SNTRuleStream and staged as they arrive, without archiving each rule.
+///
+- (void)databaseRuleStageExecutionRulesFromStream:(NSFileHandle*)stream
+                                           source:(SNTRuleAddSource)source
+                                            reply:(void (^)(BOOL, NSArray<NSError*>* error))reply;
+- (void)databaseRuleAddStagedExecutionRules:(NSUInteger)count
+                            fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+                           networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                                ruleCleanup:(SNTRuleCleanup)cleanupType
+                                     source:(SNTRuleAddSource)source
+                                      reply:(void (^)(BOOL, NSArray<NSError*>* error))reply;
+- (void)databaseEventsPendingAfterIndex:(NSNumber*)idx
+                                  limit:(NSUInteger)limit
+                                  reply:(void (^)(NSArray<SNTStoredEvent*>* events))reply;
 - (void)databaseRemoveEventsWithIDs:(NSArray*)ids;
 - (void)retrieveAllExecutionRules:(void (^)(NSArray<SNTRule*>* rules, NSError* error))reply;
 - (void)retrieveAllFileAccessRules:
     (void (^)(NSDictionary<NSString*, NSDictionary*>* fileAccessRules, NSError* error))reply;
 
+///
+///  Everything preflight reports about the rules database and client mode, in one reply rather
+///  than one round trip each.
+///
+- (void)preflightInfo:(void (^)(struct RuleCounts ruleCounts, SNTClientMode clientMode,
+                                NSString* executionRulesHash, NSString* fileAccessRulesHash,
+                                NSString* networkFlowRulesHash))reply;
+
+///
+///  Performance diagnostics, gathered in one reply for `santactl doctor --perf`. The reply
+///  dictionary holds:
+///    uptime_seconds       NSNumber, time since santad started
+///    metrics              The same export as `metrics:`
+///    stage_latencies      Array of {event, stage, count, p50, p99, max} with times in
+///                         nanoseconds, since the last metrics export
+///    slowest_evaluations  Array of {path, count, max, total} with times in nanoseconds, for
+///                         the binaries that took the longest to evaluate
+///    databases            Dictionary of database name to {size, free_page_ratio}
+///
+- (void)performanceDiagnostics:(void (^)(NSDictionary*))reply;
+
 ///
 ///  Config ops
 ///
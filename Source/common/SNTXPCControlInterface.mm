@@ -54,7 +54,7 @@ static NSString* const kSantanetdExtensionBundleID = @"com.northpolesec.santa.ne
 
 + (void)initializeControlInterface:(NSXPCInterface*)r {
   [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTStoredEvent class], nil]
-        forSelector:@selector(databaseEventsPending:)
+        forSelector:@selector(databaseEventsPendingAfterIndex:limit:reply:)
       argumentIndex:0
             ofReply:YES];
 
@@ -82,6 +82,42 @@ static NSString* const kSantanetdExtensionBundleID = @"com.northpolesec.santa.ne
       argumentIndex:1
             ofReply:YES];
 
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTRule class], nil]
+        forSelector:@selector(databaseRuleStageExecutionRules:source:reply:)
+      argumentIndex:0
+            ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [NSError class], nil]
+        forSelector:@selector(databaseRuleStageExecutionRules:source:reply:)
+      argumentIndex:1
+            ofReply:YES];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [NSError class], nil]
+        forSelector:@selector(databaseRuleStageExecutionRulesFromStream:source:reply:)
+      argumentIndex:1
+            ofReply:YES];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTFileAccessRule class], nil]
+        forSelector:@selector
+        (databaseRuleAddStagedExecutionRules:
+                             fileAccessRules:networkFlowRules:ruleCleanup:source:reply:)
+      argumentIndex:1
+            ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTNetworkFlowRule class], nil]
+        forSelector:@selector
+        (databaseRuleAddStagedExecutionRules:
+                             fileAccessRules:networkFlowRules:ruleCleanup:source:reply:)
+      argumentIndex:2
+            ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [NSError class], nil]
+        forSelector:@selector
+        (databaseRuleAddStagedExecutionRules:
+                             fileAccessRules:networkFlowRules:ruleCleanup:source:reply:)
+      argumentIndex:1
+            ofReply:YES];
+
   [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTRule class], nil]
         forSelector:@selector(retrieveAllExecutionRules:)
       argumentIndex:0
@@ -20,6 +20,7 @@
 #import "Source/common/SNTConfigState.h"
 #import "Source/common/SNTXPCBundleServiceInterface.h"
 
+@class SNTBlockNotification;
 @class SNTDeviceEvent;
 @class SNTStoredExecutionEvent;
 @class SNTStoredFileAccessEvent;
@@ -32,6 +33,7 @@
                     customURL:(NSString*)url
                   configState:(SNTConfigState*)configState
                      andReply:(void (^)(BOOL authenticated))reply;
+- (void)postBlockNotifications:(NSArray<SNTBlockNotification*>*)notifications;
 - (void)postUSBBlockNotification:(SNTDeviceEvent*)event configBundle:(SNTConfigBundle*)configBundle;
 - (void)postNetworkMountNotification:(SNTStoredNetworkMountEvent*)event
                         configBundle:(SNTConfigBundle*)configBundle;
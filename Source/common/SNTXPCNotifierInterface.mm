@@ -15,10 +15,19 @@
 
 #import "Source/common/SNTXPCNotifierInterface.h"
 
+#import "Source/common/SNTBlockNotification.h"
+
 @implementation SNTXPCNotifierInterface
 
 + (NSXPCInterface*)notifierInterface {
-  return [NSXPCInterface interfaceWithProtocol:@protocol(SNTNotifierXPC)];
+  NSXPCInterface* r = [NSXPCInterface interfaceWithProtocol:@protocol(SNTNotifierXPC)];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTBlockNotification class], nil]
+        forSelector:@selector(postBlockNotifications:)
+      argumentIndex:0
+            ofReply:NO];
+
+  return r;
 }
 
 @end
@@ -58,6 +58,10 @@ struct RuleCounts {
 - (void)databaseRulesHash:(void (^)(NSString* executionRulesHash, NSString* fileAccessRulesHash,
                                     NSString* networkFlowRulesHash))reply;
 - (void)databaseRuleForIdentifiers:(SNTRuleIdentifiers*)identifiers reply:(void (^)(SNTRule*))reply;
+/// Look up many sets of identifiers in a single round trip. The reply contains one entry per
+/// element of `identifiers`, in order: the matching SNTRule or NSNull.
+- (void)databaseRulesForIdentifiers:(NSArray<SNTRuleIdentifiers*>*)identifiers
+                              reply:(void (^)(NSArray* rules))reply;
 - (void)staticDecisionForFilePath:(NSString*)filePath
                       identifiers:(SNTRuleIdentifiers*)identifiers
                             reply:(void (^)(SNTRule* rule, NSString* decision))reply;
@@ -67,6 +71,14 @@ struct RuleCounts {
 ///
 - (void)isSyncV2Enabled:(void (^)(BOOL))reply;
 - (void)watchdogInfo:(void (^)(uint64_t, uint64_t, double, double))reply;
+- (void)selfProfile:(void (^)(NSDictionary<NSString*, NSNumber*>* cpuSecondsBySubsystem,
+                              uint64_t interruptWakeups, uint64_t idleWakeups))reply;
+- (void)memoryUsage:(void (^)(NSDictionary<NSString*, NSNumber*>* bytesByStructure))reply;
+/// The binaries that have cost the most evaluation time since santad started, highest total
+/// first. Each entry holds {key, path, count, total, max, error} with times in nanoseconds. The
+/// key is the cdhash, or the path for unsigned binaries, and `error` bounds how much of `total`
+/// may belong to binaries that were evicted from the tracker.
+- (void)hotBinaries:(void (^)(NSArray<NSDictionary*>* binaries))reply;
 - (void)watchItemsState:(void (^)(BOOL, uint64_t, NSString*,
                                   santa::WatchItems::DataSource dataSource, NSString*,
                                   NSTimeInterval))reply;
@@ -17,6 +17,7 @@
 
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/SNTRule.h"
+#import "Source/common/SNTRuleIdentifiers.h"
 #import "Source/common/SNTStoredEvent.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 
@@ -28,6 +29,16 @@
         forSelector:@selector(syncBundleEvent:relatedEvents:)
       argumentIndex:1
             ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTRuleIdentifiers class], nil]
+        forSelector:@selector(databaseRulesForIdentifiers:reply:)
+      argumentIndex:0
+            ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTRule class], [NSNull class], nil]
+        forSelector:@selector(databaseRulesForIdentifiers:reply:)
+      argumentIndex:0
+            ofReply:YES];
 }
 
 + (NSXPCInterface*)controlInterface {
@@ -25,36 +25,66 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
+#include <vector>
 
 #include "Source/common/BranchPrediction.h"
 #include "absl/hash/hash.h"
 
+/**
+  Determines what SantaCache does when a new entry would exceed the maximum
+  size of the cache.
+*/
+enum class SantaCacheEvictionPolicy {
+  // Remove every entry in the cache.
+  kClearAll,
+  // Remove a single entry chosen by the CLOCK (second chance) algorithm.
+  // Entries read via `get` since the clock hand last passed them survive.
+  kClock,
+};
+
+/**
+  Determines how SantaCache stores its entries.
+*/
+enum class SantaCacheLayout {
+  // Buckets of heap-allocated, linked entries.
+  kChained,
+  // Fixed-size shards of inline entries using open addressing.
+  kOpenAddressed,
+};
+
 /**
   A somewhat simple, concurrent linked-list hash table.
 
   The type used for keys must overload the == operator and a specialization of
   SantaCacheHasher must exist for it.
 
-  Enforces a maximum size by clearing all entries if a new value
-  is added that would go over the maximum size declared at creation.
+  Enforces a maximum size by either clearing all entries or evicting a single
+  entry if a new value is added that would go over the maximum size declared at
+  creation. See SantaCacheEvictionPolicy.
 
   The number of buckets is calculated as `maximum_size` / `per_bucket`
   rounded up to the next power of 2. Locking is done per-bucket using
   os_unfair_lock for priority inheritance support.
 */
-template <typename KeyT, typename ValueT, class Hasher = absl::Hash<KeyT>>
+template <typename KeyT, typename ValueT, class Hasher = absl::Hash<KeyT>,
+          SantaCacheLayout Layout = SantaCacheLayout::kChained>
 class SantaCache {
  public:
   /**
     Initialize a newly created cache.
 
     @param maximum_size The maximum number of entries in this cache. Once this
-        number is reached all the entries will be purged.
+        number is reached entries are evicted according to eviction_policy.
     @param per_bucket The target number of entries in each bucket when cache is
     full. A higher number will result in better performance but higher memory
     usage. Cannot be higher than 64 to try and ensure buckets don't overflow.
+    @param eviction_policy How to make room for new entries once full.
   */
-  SantaCache(uint64_t maximum_size = 10000, uint8_t per_bucket = 5) {
+  SantaCache(uint64_t maximum_size = 10000, uint8_t per_bucket = 5,
+             SantaCacheEvictionPolicy eviction_policy =
+                 SantaCacheEvictionPolicy::kClearAll)
+      : eviction_policy_(eviction_policy) {
     if (unlikely(per_bucket > maximum_size)) per_bucket = (uint8_t)maximum_size;
     if (unlikely(per_bucket < 1)) per_bucket = 1;
     if (unlikely(per_bucket > 64)) per_bucket = 64;
@@ -87,11 +117,14 @@ class SantaCache {
     while (entry != nullptr) {
       if (entry->key == key) {
         ValueT val = entry->value;
+        entry->referenced = true;
+        ++bucket->hits;
         unlock(bucket);
         return val;
       }
       entry = entry->next;
     }
+    ++bucket->misses;
     unlock(bucket);
     return zero_;
   }
@@ -313,6 +346,39 @@ class SantaCache {
     return count_.load(std::memory_order_relaxed);
   }
 
+  /**
+    Return the approximate number of bytes used by the cache, not including
+    memory owned by keys and values.
+  */
+  uint64_t approximate_bytes() const {
+    return sizeof(*this) + (uint64_t)bucket_count_ * sizeof(struct bucket) +
+           count() * sizeof(struct entry);
+  }
+
+  struct Stats {
+    // Number of `get` calls that found an entry
+    uint64_t hits;
+    // Number of `get` calls that did not find an entry
+    uint64_t misses;
+    // Number of entries removed to make room for new entries
+    uint64_t evictions;
+  };
+
+  /**
+    Return the cumulative lookup and eviction statistics for this cache.
+  */
+  Stats stats() const {
+    Stats stats = {0, 0, evictions_.load(std::memory_order_relaxed)};
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      struct bucket* bucket = &buckets_[i];
+      lock(bucket);
+      stats.hits += bucket->hits;
+      stats.misses += bucket->misses;
+      unlock(bucket);
+    }
+    return stats;
+  }
+
   /**
     Fill in the per_bucket_counts array with the number of entries in each
     bucket.
@@ -361,11 +427,17 @@ class SantaCache {
     KeyT key;
     ValueT value = {};
     struct entry* next = nullptr;
+    // Set on reads and cleared as the CLOCK hand passes. Protected by the
+    // bucket lock.
+    bool referenced = false;
   };
 
   struct bucket {
     struct entry* head = nullptr;
     os_unfair_lock lock = OS_UNFAIR_LOCK_INIT;
+    // Lookup statistics, protected by lock
+    uint64_t hits = 0;
+    uint64_t misses = 0;
   };
 
   /**
@@ -412,6 +484,7 @@ class SantaCache {
 
             entry->value = value;
           }
+          entry->referenced = true;
 
           if (!update_only && value == zero_) {
             if (previous_entry != nullptr) {
@@ -444,18 +517,25 @@ class SantaCache {
       if (count_.load(std::memory_order_relaxed) + 1 > max_size_) {
         unlock(bucket);
         lock(&clear_bucket_);
-        // Check again in case clear has already run while waiting for lock
-        if (count_.load(std::memory_order_relaxed) + 1 > max_size_) {
-          clear();
+        // Check again in case room was made while waiting for lock
+        uint64_t count = count_.load(std::memory_order_relaxed);
+        if (count + 1 > max_size_) {
+          if (eviction_policy_ == SantaCacheEvictionPolicy::kClock) {
+            evict_one();
+          } else {
+            evictions_.fetch_add(count, std::memory_order_relaxed);
+            clear();
+          }
         }
         unlock(&clear_bucket_);
-        // Bucket was unlocked during the clear path. Another thread may have
+        // Bucket was unlocked during the eviction path. Another thread may have
         // inserted the same key, so retry the lookup from scratch.
         continue;
       }
 
       // Key not found and cache has capacity. Insert at head.
       struct entry* new_entry = new struct entry(key);
+      new_entry->referenced = true;
       if (update_block) {
         update_block(new_entry->value);
       } else {
@@ -470,6 +550,40 @@ class SantaCache {
     }
   }
 
+  /**
+    Evict a single entry using the CLOCK algorithm. Referenced entries have
+    their bit cleared and are given a second chance. Buckets are locked one at
+    a time and the caller must hold clear_bucket_, which protects clock_hand_.
+  */
+  void evict_one() {
+    // Two sweeps are enough to find a victim since the first clears all bits.
+    for (uint64_t step = 0; step <= 2 * (uint64_t)bucket_count_; ++step) {
+      struct bucket* bucket = &buckets_[clock_hand_];
+      lock(bucket);
+      struct entry* entry = bucket->head;
+      struct entry* prev = nullptr;
+      while (entry != nullptr) {
+        if (!entry->referenced) {
+          if (prev) {
+            prev->next = entry->next;
+          } else {
+            bucket->head = entry->next;
+          }
+          delete entry;
+          count_.fetch_sub(1, std::memory_order_relaxed);
+          evictions_.fetch_add(1, std::memory_order_relaxed);
+          unlock(bucket);
+          return;
+        }
+        entry->referenced = false;
+        prev = entry;
+        entry = entry->next;
+      }
+      unlock(bucket);
+      clock_hand_ = (clock_hand_ + 1) % bucket_count_;
+    }
+  }
+
   /**
     Lock a bucket using os_unfair_lock for kernel-mediated priority inheritance.
   */
@@ -485,6 +599,11 @@ class SantaCache {
   }
 
   std::atomic<uint64_t> count_ = 0;
+  std::atomic<uint64_t> evictions_ = 0;
+
+  SantaCacheEvictionPolicy eviction_policy_;
+  // Next bucket to inspect when evicting. Protected by clear_bucket_.
+  uint32_t clock_hand_ = 0;
 
   uint64_t max_size_;
   uint32_t bucket_count_;
@@ -511,4 +630,498 @@ class SantaCache {
   }
 };
 
+/**
+  An open-addressed variant of SantaCache, selected with
+  SantaCacheLayout::kOpenAddressed. The public interface is identical.
+
+  Entries are stored inline in fixed-size shards of `kShardSlots` slots. Each
+  shard has a cache-line sized array of control bytes holding a 7-bit
+  fingerprint of the key's hash, which lets lookups skip most key comparisons
+  without touching the slots themselves. Collisions are resolved with linear
+  probing inside the shard and deletions leave tombstones that are purged once
+  they accumulate. Locking is done per-shard using os_unfair_lock.
+
+  Shards are sized so the table is at most ~87% full when the cache holds
+  `maximum_size` entries. If an individual shard fills before the cache does,
+  an entry in that shard is evicted using CLOCK regardless of the eviction
+  policy.
+
+  The `per_bucket` constructor parameter is accepted for compatibility and
+  ignored. Both KeyT and ValueT must be default constructible.
+*/
+template <typename KeyT, typename ValueT, class Hasher>
+class SantaCache<KeyT, ValueT, Hasher, SantaCacheLayout::kOpenAddressed> {
+ public:
+  static constexpr uint32_t kShardSlots = 64;
+
+  SantaCache(uint64_t maximum_size = 10000, uint8_t per_bucket = 5,
+             SantaCacheEvictionPolicy eviction_policy =
+                 SantaCacheEvictionPolicy::kClearAll)
+      : eviction_policy_(eviction_policy) {
+    (void)per_bucket;
+    if (unlikely(maximum_size < 1)) maximum_size = 1;
+    max_size_ = maximum_size;
+    uint64_t slots = (maximum_size * 8 + 6) / 7;
+    uint64_t shard_count = (slots + kShardSlots - 1) / kShardSlots;
+    if (unlikely(shard_count > UINT32_MAX)) shard_count = UINT32_MAX;
+    shard_count_ = (uint32_t)shard_count;
+    shards_ = new struct shard[shard_count_];
+  }
+
+  ~SantaCache() { delete[] shards_; }
+
+  /**
+    Get an element from the cache. Returns zero_ if item doesn't exist.
+  */
+  ValueT get(KeyT key) const {
+    uint64_t h = Hasher{}(key);
+    struct shard* shard = shard_for_hash(h);
+    lock(shard);
+    int i = find(shard, key, h);
+    if (i >= 0) {
+      ValueT val = shard->slots[i].value;
+      shard->slots[i].referenced = true;
+      ++shard->hits;
+      unlock(shard);
+      return val;
+    }
+    ++shard->misses;
+    unlock(shard);
+    return zero_;
+  }
+
+  bool set(const KeyT& key, const ValueT& value) {
+    return set(key, value, nullptr, {}, false);
+  }
+
+  bool set(const KeyT& key, const ValueT& value, const ValueT& previous_value) {
+    return set(key, value, nullptr, previous_value, true);
+  }
+
+  bool update(const KeyT& key, std::function<void(ValueT&)> update_block) {
+    return set(key, zero_, update_block, {}, false);
+  }
+
+  void foreach(std::function<void(KeyT&, ValueT&)> foreach_block) {
+    assert(foreach_block != nullptr);
+
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      lock(&shards_[i]);
+    }
+
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      struct shard* shard = &shards_[i];
+      for (uint32_t j = 0; j < kShardSlots; ++j) {
+        if (is_full(shard->ctrl[j])) {
+          foreach_block(shard->slots[j].key, shard->slots[j].value);
+        }
+      }
+    }
+
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      unlock(&shards_[i]);
+    }
+  }
+
+  inline void remove(const KeyT& key) { set(key, zero_); }
+
+  bool contains(const KeyT& key,
+                std::function<bool(const ValueT&)> contains_block) const {
+    uint64_t h = Hasher{}(key);
+    struct shard* shard = shard_for_hash(h);
+    lock(shard);
+    int i = find(shard, key, h);
+    bool result = false;
+    if (i >= 0) {
+      result = contains_block ? contains_block(shard->slots[i].value) : true;
+    }
+    unlock(shard);
+    return result;
+  }
+
+  bool contains(const KeyT& key) const { return contains(key, nullptr); }
+
+  /**
+    @see The chained layout of SantaCache::remove_if. The same restrictions on
+        the predicate apply.
+  */
+  uint64_t remove_if(std::function<bool(const KeyT&, ValueT&)> predicate) {
+    assert(predicate != nullptr);
+
+    uint64_t removed = 0;
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      struct shard* shard = &shards_[i];
+      lock(shard);
+      for (uint32_t j = 0; j < kShardSlots; ++j) {
+        if (is_full(shard->ctrl[j]) &&
+            predicate(shard->slots[j].key, shard->slots[j].value)) {
+          erase_slot(shard, j);
+          ++removed;
+        }
+      }
+      maybe_purge_tombstones(shard);
+      unlock(shard);
+    }
+    return removed;
+  }
+
+  void clear(std::function<void(KeyT&, ValueT&)> clear_block) {
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      struct shard* shard = &shards_[i];
+      lock(shard);
+      for (uint32_t j = 0; j < kShardSlots; ++j) {
+        if (is_full(shard->ctrl[j])) {
+          if (clear_block) {
+            clear_block(shard->slots[j].key, shard->slots[j].value);
+          }
+          reset_slot(&shard->slots[j]);
+        }
+      }
+      memset(shard->ctrl, kEmpty, sizeof(shard->ctrl));
+      shard->size = 0;
+      shard->tombstones = 0;
+    }
+
+    count_.store(0, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      unlock(&shards_[i]);
+    }
+  }
+
+  void clear() { clear(nullptr); }
+
+  inline uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t approximate_bytes() const {
+    return sizeof(*this) + (uint64_t)shard_count_ * sizeof(struct shard);
+  }
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+  };
+
+  Stats stats() const {
+    Stats stats = {0, 0, evictions_.load(std::memory_order_relaxed)};
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      struct shard* shard = &shards_[i];
+      lock(shard);
+      stats.hits += shard->hits;
+      stats.misses += shard->misses;
+      unlock(shard);
+    }
+    return stats;
+  }
+
+  /**
+    Same as the chained layout, except counts are reported per-shard.
+  */
+  void bucket_counts(uint16_t* per_bucket_counts, uint16_t* array_size,
+                     uint64_t* start_bucket) {
+    if (per_bucket_counts == nullptr || array_size == nullptr ||
+        start_bucket == nullptr)
+      return;
+
+    uint64_t start = *start_bucket;
+    if (start >= shard_count_) {
+      *start_bucket = 0;
+      return;
+    }
+
+    uint16_t size = *array_size;
+    if (start + size > shard_count_) size = (uint16_t)(shard_count_ - start);
+
+    for (uint16_t i = 0; i < size; ++i) {
+      uint16_t count = 0;
+      struct shard* shard = &shards_[start++];
+      lock(shard);
+      for (uint32_t j = 0; j < kShardSlots; ++j) {
+        if (is_full(shard->ctrl[j]) && shard->slots[j].value != zero_) ++count;
+      }
+      unlock(shard);
+      per_bucket_counts[i] = count;
+    }
+
+    *array_size = size;
+    *start_bucket = (start >= shard_count_) ? 0 : start;
+  }
+
+ private:
+  static constexpr uint32_t kSlotMask = kShardSlots - 1;
+  static constexpr uint8_t kEmpty = 0x80;
+  static constexpr uint8_t kDeleted = 0xFE;
+  static constexpr uint32_t kMaxTombstones = kShardSlots / 4;
+
+  struct slot {
+    KeyT key = {};
+    ValueT value = {};
+    bool referenced = false;
+  };
+
+  struct alignas(64) shard {
+    shard() { memset(ctrl, kEmpty, sizeof(ctrl)); }
+
+    // One control byte per slot holding either kEmpty, kDeleted or the low
+    // 7 bits of the key's hash.
+    uint8_t ctrl[kShardSlots];
+    os_unfair_lock lock = OS_UNFAIR_LOCK_INIT;
+    uint32_t size = 0;
+    uint32_t tombstones = 0;
+    uint32_t clock_hand = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    struct slot slots[kShardSlots];
+  };
+
+  static inline bool is_full(uint8_t ctrl) { return (ctrl & 0x80) == 0; }
+  static inline uint8_t fingerprint(uint64_t h) { return (uint8_t)(h & 0x7F); }
+  static inline uint32_t home_slot(uint64_t h) {
+    return (uint32_t)(h >> 7) & kSlotMask;
+  }
+
+  /**
+    Map the upper 32 bits of the hash onto [0, shard_count_) without division.
+  */
+  inline struct shard* shard_for_hash(uint64_t h) const {
+    return &shards_[((h >> 32) * (uint64_t)shard_count_) >> 32];
+  }
+
+  /**
+    Return the slot index containing key, or -1. The shard must be locked.
+  */
+  int find(const struct shard* shard, const KeyT& key, uint64_t h) const {
+    uint8_t fp = fingerprint(h);
+    uint32_t start = home_slot(h);
+    for (uint32_t n = 0; n < kShardSlots; ++n) {
+      uint32_t i = (start + n) & kSlotMask;
+      uint8_t ctrl = shard->ctrl[i];
+      if (ctrl == kEmpty) return -1;
+      if (ctrl == fp && shard->slots[i].key == key) return (int)i;
+    }
+    return -1;
+  }
+
+  /**
+    Return the first empty or deleted slot for the hash, or -1 if the shard
+    is full. The shard must be locked.
+  */
+  int find_insert_slot(const struct shard* shard, uint64_t h) const {
+    uint32_t start = home_slot(h);
+    for (uint32_t n = 0; n < kShardSlots; ++n) {
+      uint32_t i = (start + n) & kSlotMask;
+      if (!is_full(shard->ctrl[i])) return (int)i;
+    }
+    return -1;
+  }
+
+  static inline void reset_slot(struct slot* slot) {
+    // Assigning fresh values releases any resources held by the entry
+    slot->key = KeyT{};
+    slot->value = ValueT{};
+    slot->referenced = false;
+  }
+
+  void erase_slot(struct shard* shard, uint32_t i) {
+    reset_slot(&shard->slots[i]);
+    // A slot followed by an empty slot cannot be part of another key's probe
+    // sequence and so doesn't need a tombstone.
+    if (shard->ctrl[(i + 1) & kSlotMask] == kEmpty) {
+      shard->ctrl[i] = kEmpty;
+    } else {
+      shard->ctrl[i] = kDeleted;
+      ++shard->tombstones;
+    }
+    --shard->size;
+    count_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /**
+    Rebuild the shard in place once enough tombstones accumulate that they
+    noticeably lengthen probe sequences. The shard must be locked.
+  */
+  void maybe_purge_tombstones(struct shard* shard) {
+    if (shard->tombstones < kMaxTombstones) return;
+
+    std::vector<struct slot> live;
+    live.reserve(shard->size);
+    for (uint32_t i = 0; i < kShardSlots; ++i) {
+      if (is_full(shard->ctrl[i])) {
+        live.push_back(std::move(shard->slots[i]));
+        reset_slot(&shard->slots[i]);
+      }
+    }
+
+    memset(shard->ctrl, kEmpty, sizeof(shard->ctrl));
+    shard->tombstones = 0;
+
+    for (struct slot& entry : live) {
+      uint64_t h = Hasher{}(entry.key);
+      int i = find_insert_slot(shard, h);
+      shard->ctrl[i] = fingerprint(h);
+      shard->slots[i] = std::move(entry);
+    }
+  }
+
+  /**
+    Evict one entry from a shard using CLOCK. The shard must be locked and
+    must contain at least one entry.
+  */
+  void evict_from_shard(struct shard* shard) {
+    for (uint32_t n = 0; n <= 2 * kShardSlots; ++n) {
+      uint32_t i = shard->clock_hand;
+      shard->clock_hand = (i + 1) & kSlotMask;
+      if (!is_full(shard->ctrl[i])) continue;
+      if (shard->slots[i].referenced) {
+        shard->slots[i].referenced = false;
+        continue;
+      }
+      erase_slot(shard, i);
+      evictions_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  /**
+    Evict a single entry from the next non-empty shard. The caller must hold
+    clear_lock_, which protects clock_shard_.
+  */
+  void evict_one() {
+    for (uint32_t n = 0; n < shard_count_; ++n) {
+      struct shard* shard = &shards_[clock_shard_];
+      clock_shard_ = (clock_shard_ + 1) % shard_count_;
+      lock(shard);
+      if (shard->size > 0) {
+        evict_from_shard(shard);
+        maybe_purge_tombstones(shard);
+        unlock(shard);
+        return;
+      }
+      unlock(shard);
+    }
+  }
+
+  bool set(const KeyT& key, const ValueT& value,
+           std::function<void(ValueT&)> update_block,
+           const ValueT& previous_value, bool has_prev_value) {
+    // Only either value or update block can be set
+    assert(!(value != zero_ && update_block != nullptr));
+    bool update_only = (update_block != nullptr);
+
+    uint64_t h = Hasher{}(key);
+    struct shard* shard = shard_for_hash(h);
+
+    while (true) {
+      lock(shard);
+      int i = find(shard, key, h);
+      if (i >= 0) {
+        struct slot* slot = &shard->slots[i];
+        if (update_only) {
+          update_block(slot->value);
+        } else {
+          if (has_prev_value && previous_value != slot->value) {
+            unlock(shard);
+            return false;
+          }
+          slot->value = value;
+        }
+        slot->referenced = true;
+
+        if (!update_only && value == zero_) {
+          erase_slot(shard, (uint32_t)i);
+          maybe_purge_tombstones(shard);
+        }
+
+        unlock(shard);
+        return true;
+      }
+
+      // If value is zero_, we're clearing but there's nothing to clear
+      // so we don't need to do anything else. Alternatively, if has_prev_value
+      // is true and is not zero_ we don't want to set a value.
+      if (!update_only &&
+          (value == zero_ || (has_prev_value && previous_value != zero_))) {
+        unlock(shard);
+        return false;
+      }
+
+      // Check that adding this new item won't take the cache
+      // over its maximum size.
+      if (count_.load(std::memory_order_relaxed) + 1 > max_size_) {
+        unlock(shard);
+        os_unfair_lock_lock(&clear_lock_);
+        uint64_t count = count_.load(std::memory_order_relaxed);
+        if (count + 1 > max_size_) {
+          if (eviction_policy_ == SantaCacheEvictionPolicy::kClock) {
+            evict_one();
+          } else {
+            evictions_.fetch_add(count, std::memory_order_relaxed);
+            clear();
+          }
+        }
+        os_unfair_lock_unlock(&clear_lock_);
+        // The shard was unlocked, so retry the lookup from scratch.
+        continue;
+      }
+
+      if (shard->size == kShardSlots) {
+        evict_from_shard(shard);
+      }
+
+      i = find_insert_slot(shard, h);
+      if (shard->ctrl[i] == kDeleted) {
+        --shard->tombstones;
+      }
+      shard->ctrl[i] = fingerprint(h);
+
+      struct slot* slot = &shard->slots[i];
+      slot->key = key;
+      if (update_block) {
+        update_block(slot->value);
+      } else {
+        slot->value = value;
+      }
+      slot->referenced = true;
+      ++shard->size;
+      count_.fetch_add(1, std::memory_order_relaxed);
+
+      unlock(shard);
+      return true;
+    }
+  }
+
+  inline void lock(struct shard* shard) const {
+    os_unfair_lock_lock(&shard->lock);
+  }
+
+  inline void unlock(struct shard* shard) const {
+    os_unfair_lock_unlock(&shard->lock);
+  }
+
+  std::atomic<uint64_t> count_ = 0;
+  std::atomic<uint64_t> evictions_ = 0;
+
+  SantaCacheEvictionPolicy eviction_policy_;
+  // Next shard to evict from. Protected by clear_lock_.
+  uint32_t clock_shard_ = 0;
+
+  uint64_t max_size_;
+  uint32_t shard_count_;
+
+  struct shard* shards_;
+
+  /**
+    Holder for a 'zero' entry for the current type
+  */
+  const ValueT zero_ = {};
+
+  /**
+    Serializes automatic eviction when the cache is full.
+  */
+  os_unfair_lock clear_lock_ = OS_UNFAIR_LOCK_INIT;
+};
+
 #endif  // SANTA_COMMON_SANTACACHE_H
@@ -86,6 +86,73 @@
   XCTAssertEqual(sut.get(6), 42);
 }
 
+- (void)testClockEvictsSingleEntryAtLimit {
+  auto sut = SantaCache<uint64_t, uint64_t>(5, 1, SantaCacheEvictionPolicy::kClock);
+
+  for (uint64_t i = 1; i <= 5; ++i) {
+    sut.set(i, 42);
+  }
+  XCTAssertEqual(sut.count(), 5);
+
+  sut.set(6, 42);
+  XCTAssertEqual(sut.count(), 5);
+  XCTAssertEqual(sut.get(6), 42);
+  XCTAssertEqual(sut.stats().evictions, 1);
+
+  int present = 0;
+  for (uint64_t i = 1; i <= 5; ++i) {
+    if (sut.get(i) == 42) ++present;
+  }
+  XCTAssertEqual(present, 4);
+}
+
+- (void)testClockGivesReferencedEntriesSecondChance {
+  auto sut = SantaCache<uint64_t, uint64_t>(5, 1, SantaCacheEvictionPolicy::kClock);
+
+  for (uint64_t i = 1; i <= 6; ++i) {
+    sut.set(i, 42);
+  }
+
+  // The first eviction cleared the reference bits of all surviving entries.
+  // Touch every survivor except one, which must be the next victim.
+  uint64_t cold = 0;
+  for (uint64_t i = 1; i <= 5; ++i) {
+    if (!sut.contains(i)) continue;
+    if (cold == 0) {
+      cold = i;
+    } else {
+      sut.get(i);
+    }
+  }
+  XCTAssertNotEqual(cold, 0);
+
+  sut.set(7, 42);
+  XCTAssertEqual(sut.count(), 5);
+  XCTAssertFalse(sut.contains(cold));
+  XCTAssertTrue(sut.contains(6));
+  XCTAssertTrue(sut.contains(7));
+}
+
+- (void)testStats {
+  auto sut = SantaCache<uint64_t, uint64_t>(5);
+
+  sut.set(1, 42);
+  sut.get(1);
+  sut.get(1);
+  sut.get(2);
+
+  SantaCache<uint64_t, uint64_t>::Stats stats = sut.stats();
+  XCTAssertEqual(stats.hits, 2);
+  XCTAssertEqual(stats.misses, 1);
+  XCTAssertEqual(stats.evictions, 0);
+
+  // Overflowing with the default policy counts every purged entry
+  for (uint64_t i = 2; i <= 6; ++i) {
+    sut.set(i, 42);
+  }
+  XCTAssertEqual(sut.stats().evictions, 5);
+}
+
 // Helper to test bucket distributions for uint64_t/uint64_t combinations.
 - (void)distributionTestHelper:(SantaCache<uint64_t, uint64_t>*)sut bucketRatio:(int)br {
   uint16_t count[512];
@@ -180,6 +247,26 @@
   XCTAssertEqual(sut.count(), 2);
 }
 
+- (void)testApproximateBytes {
+  auto sut = SantaCache<uint64_t, int>(1000, 5);
+  uint64_t empty = sut.approximate_bytes();
+  XCTAssertGreaterThan(empty, 0);
+
+  // Chained entries are allocated as they are added
+  sut.set(1, 1);
+  sut.set(2, 2);
+  XCTAssertGreaterThan(sut.approximate_bytes(), empty);
+
+  sut.clear();
+  XCTAssertEqual(sut.approximate_bytes(), empty);
+
+  // Open addressed shards are allocated up front
+  auto open = SantaCache<uint64_t, int, absl::Hash<uint64_t>, SantaCacheLayout::kOpenAddressed>();
+  uint64_t open_empty = open.approximate_bytes();
+  open.set(1, 1);
+  XCTAssertEqual(open.approximate_bytes(), open_empty);
+}
+
 - (void)testDoubles {
   auto sut = SantaCache<double, double>();
 
@@ -1094,3 +1181,209 @@ struct S {
 }
 
 @end
+
+template <typename KeyT, typename ValueT>
+using FlatCache = SantaCache<KeyT, ValueT, absl::Hash<KeyT>, SantaCacheLayout::kOpenAddressed>;
+
+@interface SantaCacheOpenAddressedTest : XCTestCase
+@end
+
+@implementation SantaCacheOpenAddressedTest
+
+- (void)setUp {
+  self.continueAfterFailure = NO;
+}
+
+- (void)testSetGetAndRemove {
+  auto sut = FlatCache<uint64_t, uint64_t>();
+
+  sut.set(72057611258548992llu, 10000192);
+  XCTAssertEqual(sut.get(72057611258548992llu), 10000192);
+  XCTAssertEqual(sut.count(), 1);
+
+  sut.remove(72057611258548992llu);
+  XCTAssertEqual(sut.get(72057611258548992llu), 0);
+  XCTAssertEqual(sut.count(), 0);
+}
+
+- (void)testCacheResetAtLimit {
+  auto sut = FlatCache<uint64_t, uint64_t>(5);
+
+  for (uint64_t i = 1; i <= 5; ++i) {
+    sut.set(i, 42);
+  }
+  XCTAssertEqual(sut.get(3), 42);
+  sut.set(6, 42);
+  XCTAssertEqual(sut.get(3), 0);
+  XCTAssertEqual(sut.get(6), 42);
+  XCTAssertEqual(sut.count(), 1);
+}
+
+- (void)testClockEvictsSingleEntryAtLimit {
+  auto sut = FlatCache<uint64_t, uint64_t>(5, 1, SantaCacheEvictionPolicy::kClock);
+
+  for (uint64_t i = 1; i <= 6; ++i) {
+    sut.set(i, 42);
+  }
+  XCTAssertEqual(sut.count(), 5);
+  XCTAssertEqual(sut.get(6), 42);
+  XCTAssertEqual(sut.stats().evictions, 1);
+}
+
+- (void)testCompareAndSwap {
+  auto sut = FlatCache<uint64_t, uint64_t>(100);
+
+  sut.set(1, 42);
+  sut.set(1, 666, 1);
+  sut.set(1, 666, 0);
+  XCTAssertEqual(sut.get(1), 42);
+
+  sut.set(1, 0);
+  sut.set(1, 42, 1);
+  XCTAssertEqual(sut.get(1), 0);
+
+  sut.set(1, 42, 0);
+  XCTAssertEqual(sut.get(1), 42);
+  sut.set(1, 0, 42);
+  XCTAssertEqual(sut.get(1), 0);
+}
+
+- (void)testStrings {
+  auto sut = FlatCache<std::string, std::string>();
+
+  sut.set("foo", "bar");
+  sut.set("bar", "foo");
+  XCTAssertEqual(sut.get("foo"), "bar");
+  XCTAssertEqual(sut.get("bar"), "foo");
+  XCTAssertEqual(sut.get("baz"), "");
+}
+
+- (void)testStructKeys {
+  auto sut = FlatCache<S, uint64_t>(10);
+
+  S s1 = {1024, 2048};
+  S s2 = {4096, 8192};
+  sut.set(s1, 10);
+  sut.set(s2, 20);
+  XCTAssertEqual(sut.get(s1), 10);
+  XCTAssertEqual(sut.get(s2), 20);
+}
+
+- (void)testUpdateAndContains {
+  auto sut = FlatCache<int, std::shared_ptr<std::set<int>>>();
+
+  sut.update(1, ^(std::shared_ptr<std::set<int>>& val) {
+    val = std::make_shared<std::set<int>>();
+    val->insert(5);
+  });
+  sut.update(1, ^(std::shared_ptr<std::set<int>>& val) {
+    val->insert(6);
+  });
+
+  XCTAssertEqual(sut.get(1)->size(), 2);
+  XCTAssertTrue(sut.contains(1));
+  XCTAssertFalse(sut.contains(2));
+  XCTAssertTrue(sut.contains(1, ^bool(const std::shared_ptr<std::set<int>>& val) {
+    return val->count(6) > 0;
+  }));
+}
+
+- (void)testRemovedValuesAreReleased {
+  auto sut = FlatCache<int, std::shared_ptr<int>>();
+  auto val = std::make_shared<int>(42);
+
+  sut.set(1, val);
+  XCTAssertEqual(val.use_count(), 2);
+  sut.remove(1);
+  XCTAssertEqual(val.use_count(), 1);
+
+  sut.set(1, val);
+  sut.clear();
+  XCTAssertEqual(val.use_count(), 1);
+}
+
+- (void)testForeachAndRemoveIf {
+  auto sut = FlatCache<uint64_t, uint64_t>();
+
+  for (uint64_t i = 1; i <= 100; ++i) {
+    sut.set(i, i);
+  }
+
+  __block uint64_t sum = 0;
+  sut.foreach (^(uint64_t& k, uint64_t& v) {
+    sum += v;
+  });
+  XCTAssertEqual(sum, 5050);
+
+  uint64_t removed = sut.remove_if(^bool(const uint64_t& k, uint64_t& v) {
+    return k % 2 == 0;
+  });
+  XCTAssertEqual(removed, 50);
+  XCTAssertEqual(sut.count(), 50);
+  for (uint64_t i = 1; i <= 100; ++i) {
+    XCTAssertEqual(sut.get(i), (i % 2) ? i : 0);
+  }
+}
+
+// Filling well beyond the shard size exercises probing, tombstones and
+// tombstone purging.
+- (void)testChurn {
+  auto sut = FlatCache<uint64_t, uint64_t>(2000);
+
+  for (int round = 0; round < 20; ++round) {
+    for (uint64_t i = 1; i <= 1000; ++i) {
+      sut.set(i + round * 1000, i);
+    }
+    for (uint64_t i = 1; i <= 1000; ++i) {
+      if (i % 3) sut.remove(i + round * 1000);
+    }
+    for (uint64_t i = 1; i <= 1000; ++i) {
+      uint64_t expected = (i % 3) ? 0 : i;
+      XCTAssertEqual(sut.get(i + round * 1000), expected);
+    }
+    sut.clear();
+  }
+}
+
+- (void)testConcurrentReadersAndWriters {
+  auto sut = new FlatCache<uint64_t, uint64_t>(20000);
+  const int kKeyRange = 1000;
+
+  for (int i = 0; i < kKeyRange; ++i) {
+    sut->set(i, i + 1);
+  }
+
+  dispatch_group_t group = dispatch_group_create();
+
+  for (int t = 0; t < 4; ++t) {
+    dispatch_group_enter(group);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0), ^{
+      for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < kKeyRange; ++i) {
+          uint64_t val = sut->get(i);
+          XCTAssertTrue(val == (uint64_t)(i + 1) || val == (uint64_t)(i + 10001),
+                        @"Unexpected value %llu for key %d", val, i);
+        }
+      }
+      dispatch_group_leave(group);
+    });
+  }
+
+  for (int t = 0; t < 2; ++t) {
+    dispatch_group_enter(group);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+      for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < kKeyRange; ++i) {
+          sut->set(i, i + 10001);
+        }
+      }
+      dispatch_group_leave(group);
+    });
+  }
+
+  XCTAssertFalse(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)),
+                 @"Timed out");
+  delete sut;
+}
+
+@end
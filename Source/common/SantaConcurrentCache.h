@@ -0,0 +1,400 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SANTACONCURRENTCACHE_H
+#define SANTA_COMMON_SANTACONCURRENTCACHE_H
+
+#include <os/lock.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#include "Source/common/BranchPrediction.h"
+#include "absl/hash/hash.h"
+
+/**
+  A fixed-capacity, set-associative concurrent hash table whose readers do not
+  take locks.
+
+  Each bucket holds up to `kWays` entries inline along with a per-bucket
+  sequence counter (a seqlock). Writers serialize on a per-bucket
+  os_unfair_lock and bump the sequence counter around each mutation. Readers
+  snapshot the bucket optimistically and retry if the sequence counter changed
+  underneath them. After a small number of failed optimistic attempts, readers
+  fall back to taking the bucket lock so that a preempted low priority writer
+  still receives priority inheritance.
+
+  Because readers may observe partially written entries before detecting the
+  conflict, both KeyT and ValueT must be trivially copyable. Entries are stored
+  as arrays of relaxed atomic words so concurrent reads are well defined.
+
+  Unlike SantaCache, a full cache does not purge every entry. When a new key
+  maps to a bucket with no free ways, the next entry in that bucket is evicted
+  in round-robin order.
+
+  The type used for keys must overload the == operator and the type used for
+  values must overload == and != operators.
+*/
+template <typename KeyT, typename ValueT, class Hasher = absl::Hash<KeyT>>
+class SantaConcurrentCache {
+  static_assert(std::is_trivially_copyable_v<KeyT>,
+                "SantaConcurrentCache keys must be trivially copyable");
+  static_assert(std::is_trivially_copyable_v<ValueT>,
+                "SantaConcurrentCache values must be trivially copyable");
+
+ public:
+  /// Number of entries held by each bucket. Tags for every way in a bucket
+  /// are packed into a single 64-bit word.
+  static constexpr uint32_t kWays = 8;
+
+  /**
+    Initialize a newly created cache.
+
+    @param maximum_size The minimum number of entries this cache must be able
+        to hold. The actual capacity is rounded up so that the number of
+        buckets is a power of 2.
+  */
+  SantaConcurrentCache(uint64_t maximum_size = 10000) {
+    if (unlikely(maximum_size < 1)) maximum_size = 1;
+    uint64_t needed = (maximum_size + kWays - 1) / kWays;
+    bucket_count_ = 1;
+    while (bucket_count_ < needed && bucket_count_ < (1u << 31)) {
+      bucket_count_ <<= 1;
+    }
+    bucket_mask_ = bucket_count_ - 1;
+    buckets_ = new struct bucket[bucket_count_];
+  }
+
+  ~SantaConcurrentCache() { delete[] buckets_; }
+
+  SantaConcurrentCache(SantaConcurrentCache&& other) = delete;
+  SantaConcurrentCache& operator=(SantaConcurrentCache&& rhs) = delete;
+  SantaConcurrentCache(const SantaConcurrentCache& other) = delete;
+  SantaConcurrentCache& operator=(const SantaConcurrentCache& other) = delete;
+
+  /**
+    Get an element from the cache. Returns zero_ if item doesn't exist.
+    Does not block on other readers and only blocks on writers after
+    repeated conflicts in the same bucket.
+  */
+  ValueT get(const KeyT& key) const {
+    uint64_t h = Hasher{}(key);
+    const struct bucket* bucket = &buckets_[h & bucket_mask_];
+    uint8_t tag = Tag(h);
+
+    for (int attempt = 0; attempt < kMaxOptimisticReads; ++attempt) {
+      uint32_t seq = bucket->seq.load(std::memory_order_acquire);
+      if (unlikely(seq & 1)) {
+        // A writer is mid-update
+        continue;
+      }
+
+      ValueT result = zero_;
+      FindWay(bucket, key, tag, &result);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (likely(bucket->seq.load(std::memory_order_relaxed) == seq)) {
+        return result;
+      }
+    }
+
+    // Too many conflicts, wait for the writer with priority inheritance.
+    lock(bucket);
+    ValueT result = zero_;
+    FindWay(bucket, key, tag, &result);
+    unlock(bucket);
+    return result;
+  }
+
+  /**
+    Set an element in the cache. Setting a value of zero_ removes the key.
+
+    @return true if the value was set.
+  */
+  bool set(const KeyT& key, const ValueT& value) {
+    return set(key, value, zero_, false);
+  }
+
+  /**
+    Set an element in the cache only if the existing value is equal to
+    previous_value. This allows set to become a CAS operation.
+
+    @return true if the value was set.
+  */
+  bool set(const KeyT& key, const ValueT& value, const ValueT& previous_value) {
+    return set(key, value, previous_value, true);
+  }
+
+  /**
+    An alias for `set(key, zero_)`
+  */
+  inline void remove(const KeyT& key) { set(key, zero_); }
+
+  /**
+    Iterate over all entries. Each bucket is locked while it is visited so
+    foreach_block must not call back into the cache.
+  */
+  void foreach(
+      std::function<void(const KeyT&, const ValueT&)> foreach_block) const {
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      const struct bucket* bucket = &buckets_[i];
+      lock(bucket);
+      uint64_t tags = bucket->tags.load(std::memory_order_relaxed);
+      for (uint32_t way = 0; way < kWays; ++way) {
+        if (TagAt(tags, way) == 0) continue;
+        struct entry e = LoadEntry(&bucket->entries[way]);
+        foreach_block(e.key, e.value);
+      }
+      unlock(bucket);
+    }
+  }
+
+  /**
+    Remove all entries.
+  */
+  void clear() {
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      struct bucket* bucket = &buckets_[i];
+      lock(bucket);
+      uint64_t tags = bucket->tags.load(std::memory_order_relaxed);
+      if (tags != 0) {
+        BeginWrite(bucket);
+        bucket->tags.store(0, std::memory_order_relaxed);
+        EndWrite(bucket);
+        count_.fetch_sub(PopulatedWays(tags), std::memory_order_relaxed);
+      }
+      unlock(bucket);
+    }
+  }
+
+  /**
+    Return number of entries currently in cache.
+  */
+  inline uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  /**
+    Return the maximum number of entries the cache can hold.
+  */
+  inline uint64_t capacity() const { return (uint64_t)bucket_count_ * kWays; }
+
+  /**
+    Return the approximate number of bytes used by the cache.
+  */
+  inline uint64_t approximate_bytes() const {
+    return sizeof(*this) + (uint64_t)bucket_count_ * sizeof(struct bucket);
+  }
+
+  /**
+    Return the number of entries that have been evicted to make room for new
+    keys since the cache was created.
+  */
+  inline uint64_t evictions() const {
+    return evictions_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr int kMaxOptimisticReads = 16;
+
+  struct entry {
+    KeyT key;
+    ValueT value;
+  };
+
+  static constexpr size_t kWordsPerEntry = (sizeof(struct entry) + 7) / 8;
+
+  struct entry_storage {
+    std::atomic<uint64_t> words[kWordsPerEntry];
+  };
+
+  struct alignas(64) bucket {
+    std::atomic<uint32_t> seq = 0;
+    os_unfair_lock lock = OS_UNFAIR_LOCK_INIT;
+    // One byte per way. A zero byte marks an empty way.
+    std::atomic<uint64_t> tags = 0;
+    // Protected by lock
+    uint32_t next_victim = 0;
+    struct entry_storage entries[kWays] = {};
+  };
+
+  bool set(const KeyT& key, const ValueT& value, const ValueT& previous_value,
+           bool has_prev_value) {
+    uint64_t h = Hasher{}(key);
+    struct bucket* bucket = &buckets_[h & bucket_mask_];
+    uint8_t tag = Tag(h);
+
+    lock(bucket);
+
+    ValueT existing_value = zero_;
+    int way = FindWay(bucket, key, tag, &existing_value);
+    if (way >= 0) {
+      if (has_prev_value && previous_value != existing_value) {
+        unlock(bucket);
+        return false;
+      }
+
+      BeginWrite(bucket);
+      if (value == zero_) {
+        SetTag(bucket, way, 0);
+        count_.fetch_sub(1, std::memory_order_relaxed);
+      } else {
+        StoreEntry(&bucket->entries[way], {key, value});
+      }
+      EndWrite(bucket);
+
+      unlock(bucket);
+      return true;
+    }
+
+    // If value is zero_, we're clearing but there's nothing to clear.
+    // Alternatively, if has_prev_value is true and is not zero_ we don't want
+    // to set a value.
+    if (value == zero_ || (has_prev_value && previous_value != zero_)) {
+      unlock(bucket);
+      return false;
+    }
+
+    uint64_t tags = bucket->tags.load(std::memory_order_relaxed);
+    way = -1;
+    for (uint32_t i = 0; i < kWays; ++i) {
+      if (TagAt(tags, i) == 0) {
+        way = (int)i;
+        break;
+      }
+    }
+
+    if (way < 0) {
+      way = (int)(bucket->next_victim++ % kWays);
+      evictions_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    BeginWrite(bucket);
+    StoreEntry(&bucket->entries[way], {key, value});
+    SetTag(bucket, way, tag);
+    EndWrite(bucket);
+
+    unlock(bucket);
+    return true;
+  }
+
+  /**
+    Find the way containing key. Returns the way index, or -1 if not found.
+    When found and `value` is non-null, it is set to the stored value.
+
+    May race with writers, callers must validate the bucket sequence number
+    or hold the bucket lock.
+  */
+  int FindWay(const struct bucket* bucket, const KeyT& key, uint8_t tag,
+              ValueT* value) const {
+    uint64_t tags = bucket->tags.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < kWays; ++i) {
+      if (TagAt(tags, i) != tag) continue;
+      struct entry e = LoadEntry(&bucket->entries[i]);
+      if (e.key == key) {
+        if (value) *value = e.value;
+        return (int)i;
+      }
+    }
+    return -1;
+  }
+
+  static inline struct entry LoadEntry(const struct entry_storage* storage) {
+    uint64_t words[kWordsPerEntry];
+    for (size_t i = 0; i < kWordsPerEntry; ++i) {
+      words[i] = storage->words[i].load(std::memory_order_relaxed);
+    }
+    struct entry e;
+    memcpy(&e, words, sizeof(e));
+    return e;
+  }
+
+  static inline void StoreEntry(struct entry_storage* storage,
+                                const struct entry& e) {
+    uint64_t words[kWordsPerEntry] = {};
+    memcpy(words, &e, sizeof(e));
+    for (size_t i = 0; i < kWordsPerEntry; ++i) {
+      storage->words[i].store(words[i], std::memory_order_relaxed);
+    }
+  }
+
+  static inline uint8_t Tag(uint64_t hash) {
+    uint8_t tag = (uint8_t)(hash >> 56);
+    return tag ?: 1;
+  }
+
+  static inline uint8_t TagAt(uint64_t tags, uint32_t way) {
+    return (uint8_t)(tags >> (way * 8));
+  }
+
+  static inline void SetTag(struct bucket* bucket, int way, uint8_t tag) {
+    uint64_t tags = bucket->tags.load(std::memory_order_relaxed);
+    tags &= ~(0xFFull << (way * 8));
+    tags |= ((uint64_t)tag << (way * 8));
+    bucket->tags.store(tags, std::memory_order_relaxed);
+  }
+
+  static inline uint64_t PopulatedWays(uint64_t tags) {
+    uint64_t n = 0;
+    for (uint32_t i = 0; i < kWays; ++i) {
+      if (TagAt(tags, i) != 0) ++n;
+    }
+    return n;
+  }
+
+  /**
+    Mark the start of a mutation. Must be called with the bucket lock held.
+  */
+  static inline void BeginWrite(struct bucket* bucket) {
+    bucket->seq.store(bucket->seq.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  /**
+    Mark the end of a mutation. Must be called with the bucket lock held.
+  */
+  static inline void EndWrite(struct bucket* bucket) {
+    bucket->seq.store(bucket->seq.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+  }
+
+  inline void lock(const struct bucket* bucket) const {
+    os_unfair_lock_lock(const_cast<os_unfair_lock*>(&bucket->lock));
+  }
+
+  inline void unlock(const struct bucket* bucket) const {
+    os_unfair_lock_unlock(const_cast<os_unfair_lock*>(&bucket->lock));
+  }
+
+  std::atomic<uint64_t> count_ = 0;
+  std::atomic<uint64_t> evictions_ = 0;
+
+  uint32_t bucket_count_;
+  uint64_t bucket_mask_;
+
+  struct bucket* buckets_;
+
+  /**
+    Holder for a 'zero' entry for the current type
+  */
+  const ValueT zero_ = {};
+};
+
+#endif  // SANTA_COMMON_SANTACONCURRENTCACHE_H
@@ -0,0 +1,228 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/SantaConcurrentCache.h"
+
+#import <XCTest/XCTest.h>
+
+#include <atomic>
+
+struct TestValue {
+  uint64_t a;
+  uint64_t b;
+
+  bool operator==(const TestValue& rhs) const { return a == rhs.a && b == rhs.b; }
+  bool operator!=(const TestValue& rhs) const { return !(*this == rhs); }
+};
+
+@interface SantaConcurrentCacheTest : XCTestCase
+@end
+
+@implementation SantaConcurrentCacheTest
+
+- (void)setUp {
+  self.continueAfterFailure = NO;
+}
+
+- (void)testSetAndGet {
+  auto sut = SantaConcurrentCache<uint64_t, uint64_t>();
+
+  XCTAssertTrue(sut.set(72057611258548992llu, 10000192));
+  XCTAssertEqual(sut.get(72057611258548992llu), 10000192);
+  XCTAssertEqual(sut.get(1234), 0);
+  XCTAssertEqual(sut.count(), 1);
+}
+
+- (void)testRemove {
+  auto sut = SantaConcurrentCache<uint64_t, uint64_t>();
+
+  sut.set(0xDEADBEEF, 42);
+  sut.remove(0xDEADBEEF);
+
+  XCTAssertEqual(sut.get(0xDEADBEEF), 0);
+  XCTAssertEqual(sut.count(), 0);
+
+  // Removing a missing key is a no-op
+  XCTAssertFalse(sut.set(0xDEADBEEF, 0));
+  XCTAssertEqual(sut.count(), 0);
+}
+
+- (void)testCompareAndSwap {
+  auto sut = SantaConcurrentCache<uint64_t, uint64_t>();
+
+  // A CAS against a non-zero previous value for a missing key must fail
+  XCTAssertFalse(sut.set(1, 42, 10));
+  XCTAssertEqual(sut.get(1), 0);
+
+  XCTAssertTrue(sut.set(1, 42, 0));
+  XCTAssertFalse(sut.set(1, 50, 0));
+  XCTAssertEqual(sut.get(1), 42);
+
+  XCTAssertTrue(sut.set(1, 50, 42));
+  XCTAssertEqual(sut.get(1), 50);
+}
+
+- (void)testCapacityRounding {
+  auto sut = SantaConcurrentCache<uint64_t, uint64_t>(100);
+
+  // 100 entries / 8 ways => 13 buckets, rounded to 16
+  XCTAssertEqual(sut.capacity(), 16 * SantaConcurrentCache<uint64_t, uint64_t>::kWays);
+}
+
+- (void)testEvictsInsteadOfClearing {
+  auto sut = SantaConcurrentCache<uint64_t, uint64_t>(1);
+  XCTAssertEqual(sut.capacity(), SantaConcurrentCache<uint64_t, uint64_t>::kWays);
+
+  for (uint64_t i = 1; i <= sut.capacity(); ++i) {
+    sut.set(i, i);
+  }
+  XCTAssertEqual(sut.count(), sut.capacity());
+  XCTAssertEqual(sut.evictions(), 0);
+
+  // One more entry evicts exactly one existing entry
+  sut.set(1000, 1000);
+  XCTAssertEqual(sut.count(), sut.capacity());
+  XCTAssertEqual(sut.evictions(), 1);
+  XCTAssertEqual(sut.get(1000), 1000);
+
+  int present = 0;
+  for (uint64_t i = 1; i <= sut.capacity(); ++i) {
+    if (sut.get(i) == i) ++present;
+  }
+  XCTAssertEqual(present, sut.capacity() - 1);
+}
+
+- (void)testClear {
+  auto sut = SantaConcurrentCache<uint64_t, uint64_t>();
+
+  for (uint64_t i = 1; i <= 500; ++i) {
+    sut.set(i, i);
+  }
+  XCTAssertEqual(sut.count(), 500);
+
+  sut.clear();
+  XCTAssertEqual(sut.count(), 0);
+  for (uint64_t i = 1; i <= 500; ++i) {
+    XCTAssertEqual(sut.get(i), 0);
+  }
+}
+
+- (void)testForeach {
+  auto sut = SantaConcurrentCache<uint64_t, uint64_t>();
+
+  for (uint64_t i = 1; i <= 100; ++i) {
+    sut.set(i, i * 2);
+  }
+  sut.remove(50);
+
+  uint64_t visited = 0;
+  uint64_t sum = 0;
+  sut.foreach([&](const uint64_t& key, const uint64_t& value) {
+    XCTAssertEqual(value, key * 2);
+    ++visited;
+    sum += key;
+  });
+
+  XCTAssertEqual(visited, 99);
+  XCTAssertEqual(sum, (100 * 101 / 2) - 50);
+}
+
+- (void)testStructValues {
+  auto sut = SantaConcurrentCache<uint64_t, TestValue>();
+
+  sut.set(1, {1, 2});
+  sut.set(2, {3, 4});
+
+  XCTAssertTrue((sut.get(1) == TestValue{1, 2}));
+  XCTAssertTrue((sut.get(2) == TestValue{3, 4}));
+  XCTAssertTrue((sut.get(3) == TestValue{0, 0}));
+}
+
+// Readers must never observe a torn value while writers rewrite entries.
+- (void)testConcurrentReadersAndWriters {
+  auto sut = new SantaConcurrentCache<uint64_t, TestValue>(20000);
+  const int kKeyRange = 1000;
+
+  for (int i = 0; i < kKeyRange; ++i) {
+    sut->set(i, {(uint64_t)i + 1, (uint64_t)i + 1});
+  }
+
+  dispatch_group_t group = dispatch_group_create();
+
+  for (int t = 0; t < 4; ++t) {
+    dispatch_group_enter(group);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0), ^{
+      for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < kKeyRange; ++i) {
+          TestValue val = sut->get(i);
+          XCTAssertEqual(val.a, val.b, @"Torn read for key %d", i);
+          XCTAssertTrue(val.a == (uint64_t)(i + 1) || val.a == (uint64_t)(i + 10001),
+                        @"Unexpected value %llu for key %d", val.a, i);
+        }
+      }
+      dispatch_group_leave(group);
+    });
+  }
+
+  for (int t = 0; t < 2; ++t) {
+    dispatch_group_enter(group);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+      for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < kKeyRange; ++i) {
+          uint64_t v = (round % 2) ? (uint64_t)i + 1 : (uint64_t)i + 10001;
+          sut->set(i, {v, v});
+        }
+      }
+      dispatch_group_leave(group);
+    });
+  }
+
+  XCTAssertFalse(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)),
+                 @"Timed out");
+  XCTAssertEqual(sut->count(), kKeyRange);
+  delete sut;
+}
+
+- (void)testConcurrentClearCountConsistency {
+  auto sut = new SantaConcurrentCache<uint64_t, uint64_t>(1000);
+  auto stop = new std::atomic<bool>{false};
+
+  dispatch_group_t group = dispatch_group_create();
+
+  dispatch_group_enter(group);
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    uint64_t i = 1;
+    while (!stop->load()) {
+      sut->set(i, i);
+      i = (i % 5000) + 1;
+    }
+    dispatch_group_leave(group);
+  });
+
+  for (int i = 0; i < 100; ++i) {
+    sut->clear();
+  }
+  stop->store(true);
+
+  XCTAssertFalse(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)),
+                 @"Timed out");
+
+  sut->clear();
+  XCTAssertEqual(sut->count(), 0);
+
+  delete stop;
+  delete sut;
+}
+
+@end
@@ -17,32 +17,172 @@
 
 #include <dispatch/dispatch.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "Source/common/SantaCache.h"
 #include "absl/container/flat_hash_map.h"
-#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/hash/hash.h"
 #include "absl/synchronization/mutex.h"
 
 namespace santa {
 
-/// This is a bespoke cache for mapping some key to a set of values. Both
-/// the size of the outer map and inner set size are constrianed by given
-/// parameters at time of construction.
+/// The set of values stored for a single key of a SantaSetCache. Up to
+/// kInlineValues values are stored inline, larger sets spill to a hash map.
+/// Each value remembers when it was last used so the least recently used
+/// values can be trimmed. The number of values held is tracked in a counter
+/// shared by every set of the owning cache.
+template <typename ValueT>
+class SantaSetCacheValues {
+ public:
+  static constexpr size_t kInlineValues = 4;
+
+  explicit SantaSetCacheValues(std::shared_ptr<std::atomic<size_t>> total_values)
+      : total_values_(std::move(total_values)) {}
+
+  ~SantaSetCacheValues() { total_values_->fetch_sub(size(), std::memory_order_relaxed); }
+
+  SantaSetCacheValues(const SantaSetCacheValues& other) = delete;
+  SantaSetCacheValues& operator=(const SantaSetCacheValues& other) = delete;
+  SantaSetCacheValues(SantaSetCacheValues&& other) = delete;
+  SantaSetCacheValues& operator=(SantaSetCacheValues&& rhs) = delete;
+
+  size_t size() const { return spilled_ ? spilled_->size() : inline_.size(); }
+
+  size_t count(const ValueT& val) const {
+    if (spilled_) {
+      return spilled_->count(val);
+    }
+    return std::any_of(inline_.begin(), inline_.end(),
+                       [&val](const auto& entry) { return entry.first == val; })
+               ? 1
+               : 0;
+  }
+
+  /// Marks `val` as the most recently used value. Returns false if the set
+  /// doesn't contain `val`.
+  bool Touch(const ValueT& val) {
+    uint64_t* last_used = FindLastUsed(val);
+    if (!last_used) {
+      return false;
+    }
+    *last_used = ++clock_;
+    return true;
+  }
+
+  /// Adds `val`, which must not already be in the set, as the most recently
+  /// used value.
+  void Insert(ValueT val) {
+    uint64_t last_used = ++clock_;
+    if (!spilled_ && inline_.size() < kInlineValues) {
+      inline_.emplace_back(std::move(val), last_used);
+    } else {
+      if (!spilled_) {
+        spilled_ = std::make_unique<absl::flat_hash_map<ValueT, uint64_t>>(inline_.begin(),
+                                                                           inline_.end());
+        inline_.clear();
+      }
+      spilled_->emplace(std::move(val), last_used);
+    }
+    total_values_->fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Removes all values for which `pred` returns true.
+  void EraseIf(const std::function<bool(const ValueT&)>& pred) {
+    size_t before = size();
+    if (spilled_) {
+      absl::erase_if(*spilled_, [&pred](const auto& entry) { return pred(entry.first); });
+    } else {
+      inline_.erase(std::remove_if(inline_.begin(), inline_.end(),
+                                   [&pred](const auto& entry) { return pred(entry.first); }),
+                    inline_.end());
+    }
+    total_values_->fetch_sub(before - size(), std::memory_order_relaxed);
+  }
+
+  /// Removes the least recently used values until at most `keep` remain.
+  void TrimTo(size_t keep) {
+    size_t before = size();
+    if (before <= keep) {
+      return;
+    }
+
+    // Values are last used at distinct clock values, so everything at or
+    // before the cutoff is exactly the set of values to drop.
+    std::vector<uint64_t> last_used;
+    last_used.reserve(before);
+    ForEachLastUsed([&last_used](uint64_t t) { last_used.push_back(t); });
+    auto cutoff_it = last_used.begin() + (before - keep - 1);
+    std::nth_element(last_used.begin(), cutoff_it, last_used.end());
+    uint64_t cutoff = *cutoff_it;
+
+    if (spilled_) {
+      absl::erase_if(*spilled_, [cutoff](const auto& entry) { return entry.second <= cutoff; });
+    } else {
+      inline_.erase(std::remove_if(inline_.begin(), inline_.end(),
+                                   [cutoff](const auto& entry) { return entry.second <= cutoff; }),
+                    inline_.end());
+    }
+    total_values_->fetch_sub(before - size(), std::memory_order_relaxed);
+  }
+
+ private:
+  uint64_t* FindLastUsed(const ValueT& val) {
+    if (spilled_) {
+      auto it = spilled_->find(val);
+      return it != spilled_->end() ? &it->second : nullptr;
+    }
+    for (auto& entry : inline_) {
+      if (entry.first == val) {
+        return &entry.second;
+      }
+    }
+    return nullptr;
+  }
+
+  template <typename F>
+  void ForEachLastUsed(F f) const {
+    if (spilled_) {
+      for (const auto& entry : *spilled_) f(entry.second);
+    } else {
+      for (const auto& entry : inline_) f(entry.second);
+    }
+  }
+
+  absl::InlinedVector<std::pair<ValueT, uint64_t>, kInlineValues> inline_;
+  std::unique_ptr<absl::flat_hash_map<ValueT, uint64_t>> spilled_;
+  uint64_t clock_ = 0;
+  std::shared_ptr<std::atomic<size_t>> total_values_;
+};
+
+/// This is a bespoke cache for mapping some key to a set of values. The
+/// number of keys, the size of each inner set and the total number of values
+/// across all sets are constrained by parameters given at construction.
 template <typename KeyT, typename ValueT, class Hasher = absl::Hash<KeyT>>
 class SantaSetCache {
  public:
-  using ValueSet = absl::flat_hash_set<ValueT>;
+  using ValueSet = SantaSetCacheValues<ValueT>;
   using SharedValueSet = std::shared_ptr<ValueSet>;
   using SharedConstValueSet = std::shared_ptr<const ValueSet>;
 
-  static std::unique_ptr<SantaSetCache> Create(size_t capacity, size_t per_entry_capacity) {
-    return std::make_unique<SantaSetCache>(capacity, per_entry_capacity);
+  static std::unique_ptr<SantaSetCache> Create(
+      size_t capacity, size_t per_entry_capacity,
+      size_t value_budget = std::numeric_limits<size_t>::max()) {
+    return std::make_unique<SantaSetCache>(capacity, per_entry_capacity, value_budget);
   }
 
-  SantaSetCache(size_t capacity, size_t per_entry_capacity)
-      : cache_(capacity), per_entry_capacity_(per_entry_capacity) {}
+  SantaSetCache(size_t capacity, size_t per_entry_capacity,
+                size_t value_budget = std::numeric_limits<size_t>::max())
+      : cache_(capacity),
+        per_entry_capacity_(per_entry_capacity),
+        value_budget_(value_budget),
+        total_values_(std::make_shared<std::atomic<size_t>>(0)) {}
 
   // Not copyable
   SantaSetCache(const SantaSetCache& other) = delete;
@@ -52,43 +192,58 @@ class SantaSetCache {
   SantaSetCache(SantaSetCache&& other) = delete;
   SantaSetCache& operator=(SantaSetCache&& rhs) = delete;
 
-  /// Check if the set at the given key contained the given value.
+  /// Check if the set at the given key contained the given value. A hit
+  /// marks the value as recently used.
   bool Contains(const KeyT& key, const ValueT& val) const {
     return cache_.contains(key, ^bool(const SharedValueSet& set) {
-      return set && set->count(val) > 0;
+      return set && set->Touch(val);
     });
   }
 
   /// Adds the value to the set contained at given key. The
   /// set is created if one didn't previously exist. If adding
-  /// the key causes the cache capacity to overflow, the cache
-  /// is cleared. If adding the value to the set causes it to
-  /// overflow, it is first cleared.
+  /// the key causes the cache capacity to overflow, or the total
+  /// number of values across all keys has reached the value
+  /// budget, the cache is cleared. If adding the value to the
+  /// set causes it to overflow, values for which `is_stale`
+  /// returns true are removed first, and if that doesn't make
+  /// room the least recently used half of the set is removed.
   /// Return true if the new value was inserted into the inner
   /// set. Otherwise returns false if the inner set already
   /// contained the value.
-  bool Set(const KeyT& key, ValueT val) {
+  bool Set(const KeyT& key, ValueT val,
+           const std::function<bool(const ValueT&)>& is_stale = nullptr) {
+    if (total_values_->load(std::memory_order_relaxed) >= value_budget_) {
+      cache_.clear();
+      budget_clear_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
     __block bool did_set = false;
     __block ValueT tmp_val = std::move(val);
 
     cache_.update(key, ^(SharedValueSet& set) {
       ValueT moved_val = std::move(tmp_val);
       if (!set) {
-        set = std::make_shared<ValueSet>();
+        set = std::make_shared<ValueSet>(total_values_);
       }
 
       // Check if the entry already exists
-      if (set->count(moved_val) > 0) {
+      if (set->Touch(moved_val)) {
         did_set = false;
         return;
       }
 
       // Check if we'll exceed capacity with the new entry
-      if (set->size() >= per_entry_capacity_) {
-        set->clear();
+      size_t capacity = per_entry_capacity_.load(std::memory_order_relaxed);
+      if (set->size() >= capacity && is_stale) {
+        set->EraseIf(is_stale);
+      }
+      if (set->size() >= capacity) {
+        set->TrimTo(capacity / 2);
+        overflow_count_.fetch_add(1, std::memory_order_relaxed);
       }
 
-      set->insert(std::move(moved_val));
+      set->Insert(std::move(moved_val));
 
       // Value was set, return info to caller
       did_set = true;
@@ -111,6 +266,26 @@ class SantaSetCache {
   /// Size of the cache
   size_t Size() const { return cache_.count(); }
 
+  /// Total number of values across all inner sets
+  size_t ValueCount() const { return total_values_->load(std::memory_order_relaxed); }
+
+  /// Change the capacity of each inner set. Sets that are already larger
+  /// shrink the next time a value is added to them.
+  void SetPerEntryCapacity(size_t per_entry_capacity) {
+    per_entry_capacity_.store(per_entry_capacity, std::memory_order_relaxed);
+  }
+
+  size_t PerEntryCapacity() const { return per_entry_capacity_.load(std::memory_order_relaxed); }
+
+  /// Number of times an inner set was trimmed because it was full
+  uint64_t OverflowCount(bool reset) {
+    return reset ? overflow_count_.exchange(0, std::memory_order_relaxed)
+                 : overflow_count_.load(std::memory_order_relaxed);
+  }
+
+  /// Number of times the cache was cleared because the value budget was reached
+  uint64_t BudgetClearCount() const { return budget_clear_count_.load(std::memory_order_relaxed); }
+
   /// Size of the underlying set in the cache at the given key
   size_t Size(const KeyT& key) const {
     SharedValueSet set = cache_.get(key);
@@ -124,7 +299,11 @@ class SantaSetCache {
  private:
   SantaCache<KeyT, SharedValueSet, Hasher> cache_;
 
-  size_t per_entry_capacity_;
+  std::atomic<size_t> per_entry_capacity_;
+  const size_t value_budget_;
+  std::shared_ptr<std::atomic<size_t>> total_values_;
+  std::atomic<uint64_t> overflow_count_{0};
+  std::atomic<uint64_t> budget_clear_count_{0};
 };
 
 }  // namespace santa
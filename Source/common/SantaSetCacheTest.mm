@@ -77,12 +77,12 @@ using IntSantaSetCache = SantaSetCache<int, int>;
   IntSantaSetCache::SharedConstValueSet val = cache.UnsafeGet(1);
   XCTAssertEqual(val->size(), 2);
 
-  // Overflow the inner set so that the initial values are cleared
+  // Overflow the inner set so that the least recently used value is trimmed
   XCTAssertTrue(cache.Set(1, 3));
   val = cache.UnsafeGet(1);
-  XCTAssertEqual(val->size(), 1);
+  XCTAssertEqual(val->size(), 2);
   XCTAssertEqual(val->count(1), 0);
-  XCTAssertEqual(val->count(2), 0);
+  XCTAssertEqual(val->count(2), 1);
   XCTAssertEqual(val->count(3), 1);
 
   // Max out outer cache size
@@ -97,7 +97,7 @@ using IntSantaSetCache = SantaSetCache<int, int>;
 
   // Old inner set should still exist
   val = cache.UnsafeGet(1);
-  XCTAssertEqual(val->size(), 1);
+  XCTAssertEqual(val->size(), 2);
   XCTAssertEqual(val->count(3), 1);
 
   // Overflow the outer cache
@@ -113,6 +113,115 @@ using IntSantaSetCache = SantaSetCache<int, int>;
   XCTAssertEqual(val->count(1), 1);
 }
 
+- (void)testStaleValuesRemovedOnOverflow {
+  IntSantaSetCache cache(3, 3);
+  auto isOdd = [](const int& v) { return v % 2 != 0; };
+
+  XCTAssertTrue(cache.Set(1, 1, isOdd));
+  XCTAssertTrue(cache.Set(1, 2, isOdd));
+  XCTAssertTrue(cache.Set(1, 3, isOdd));
+
+  // Only the stale values make room for the new one
+  XCTAssertTrue(cache.Set(1, 4, isOdd));
+  XCTAssertEqual(cache.Size(1), 2);
+  XCTAssertTrue(cache.Contains(1, 2));
+  XCTAssertTrue(cache.Contains(1, 4));
+  XCTAssertEqual(cache.OverflowCount(false), 0);
+
+  // Nothing is stale, so only the most recently used value is kept
+  XCTAssertTrue(cache.Set(1, 6, isOdd));
+  XCTAssertTrue(cache.Set(1, 8, isOdd));
+  XCTAssertEqual(cache.Size(1), 2);
+  XCTAssertTrue(cache.Contains(1, 6));
+  XCTAssertTrue(cache.Contains(1, 8));
+  XCTAssertEqual(cache.OverflowCount(true), 1);
+  XCTAssertEqual(cache.OverflowCount(false), 0);
+}
+
+- (void)testSetPerEntryCapacity {
+  IntSantaSetCache cache(3, 2);
+  XCTAssertEqual(cache.PerEntryCapacity(), 2);
+
+  cache.SetPerEntryCapacity(4);
+  for (int i = 0; i < 4; i++) {
+    XCTAssertTrue(cache.Set(1, i));
+  }
+  XCTAssertEqual(cache.Size(1), 4);
+
+  // Shrinking takes effect on the next insert
+  cache.SetPerEntryCapacity(2);
+  XCTAssertEqual(cache.Size(1), 4);
+  XCTAssertTrue(cache.Set(1, 4));
+  XCTAssertEqual(cache.Size(1), 2);
+  XCTAssertTrue(cache.Contains(1, 3));
+  XCTAssertTrue(cache.Contains(1, 4));
+  XCTAssertEqual(cache.OverflowCount(false), 1);
+}
+
+- (void)testInlineValuesSpill {
+  IntSantaSetCache cache(3, 64);
+  const int numValues = (int)IntSantaSetCache::ValueSet::kInlineValues * 4;
+
+  for (int i = 0; i < numValues; i++) {
+    XCTAssertTrue(cache.Set(1, i));
+  }
+  XCTAssertEqual(cache.Size(1), numValues);
+  XCTAssertEqual(cache.ValueCount(), numValues);
+
+  for (int i = 0; i < numValues; i++) {
+    XCTAssertTrue(cache.Contains(1, i));
+    XCTAssertFalse(cache.Set(1, i));
+  }
+  XCTAssertFalse(cache.Contains(1, numValues));
+  XCTAssertEqual(cache.OverflowCount(false), 0);
+}
+
+- (void)testLeastRecentlyUsedValuesTrimmed {
+  IntSantaSetCache cache(3, 8);
+
+  for (int i = 0; i < 8; i++) {
+    XCTAssertTrue(cache.Set(1, i));
+  }
+
+  // Hits refresh values so they survive the next trim
+  XCTAssertTrue(cache.Contains(1, 0));
+  XCTAssertTrue(cache.Contains(1, 1));
+
+  XCTAssertTrue(cache.Set(1, 8));
+  XCTAssertEqual(cache.Size(1), 5);
+  XCTAssertEqual(cache.ValueCount(), 5);
+  XCTAssertEqual(cache.OverflowCount(false), 1);
+
+  for (int i : {0, 1, 6, 7, 8}) {
+    XCTAssertTrue(cache.Contains(1, i));
+  }
+  for (int i : {2, 3, 4, 5}) {
+    XCTAssertFalse(cache.Contains(1, i));
+  }
+}
+
+- (void)testValueBudget {
+  IntSantaSetCache cache(16, 8, 4);
+
+  XCTAssertTrue(cache.Set(1, 1));
+  XCTAssertTrue(cache.Set(1, 2));
+  XCTAssertTrue(cache.Set(2, 1));
+  XCTAssertTrue(cache.Set(3, 1));
+  XCTAssertEqual(cache.ValueCount(), 4);
+  XCTAssertEqual(cache.BudgetClearCount(), 0);
+
+  // Reaching the budget clears the cache before the next value is added
+  XCTAssertTrue(cache.Set(4, 1));
+  XCTAssertEqual(cache.Size(), 1);
+  XCTAssertEqual(cache.ValueCount(), 1);
+  XCTAssertEqual(cache.BudgetClearCount(), 1);
+  XCTAssertFalse(cache.Contains(1, 1));
+
+  // Removed entries give their values back to the budget
+  cache.Remove(4);
+  XCTAssertEqual(cache.ValueCount(), 0);
+}
+
 - (void)testObjects {
   SantaSetCache<int, std::pair<std::string, std::string>> cache(3, 2);
 
@@ -123,11 +232,13 @@ using IntSantaSetCache = SantaSetCache<int, int>;
   auto val = cache.UnsafeGet(1);
   XCTAssertEqual(val->size(), 2);
 
+  // The re-added value was used most recently, so it survives the trim
   XCTAssertTrue(cache.Set(1, {"foo", "bar"}));
   val = cache.UnsafeGet(1);
-  XCTAssertEqual(val->size(), 1);
-  XCTAssertTrue(cache.Set(1, {"hi", "bye"}));
   XCTAssertEqual(val->size(), 2);
+  XCTAssertEqual(val->count({"hi", "bye"}), 1);
+  XCTAssertEqual(val->count({"bye", "hi"}), 0);
+  XCTAssertFalse(cache.Set(1, {"hi", "bye"}));
 }
 
 @end
@@ -0,0 +1,123 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_SELFPROFILER_H
+#define SANTA_COMMON_SELFPROFILER_H
+
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Attributes the process's own CPU time to the subsystems that used it.
+//
+// Threads are sampled periodically and the CPU time each used since the
+// previous sample is charged to what it is doing when sampled: the innermost
+// ScopedSubsystem on the thread, else the subsystem of the registered queue
+// it is draining, else the subsystem it last worked for, else its thread
+// name. Work that starts and finishes between samples is charged to whatever
+// the thread is doing at the next one, so the breakdown is only meaningful
+// over many samples.
+class SelfProfiler {
+ public:
+  struct CPUTime {
+    uint64_t user_nanos = 0;
+    uint64_t system_nanos = 0;
+  };
+
+  // Process wide wakeups. Mach doesn't report wakeups per thread.
+  struct Wakeups {
+    uint64_t interrupt = 0;
+    uint64_t platform_idle = 0;
+  };
+
+  static SelfProfiler& Shared();
+
+  SelfProfiler() = default;
+
+  SelfProfiler(SelfProfiler&& other) = delete;
+  SelfProfiler& operator=(SelfProfiler&& rhs) = delete;
+  SelfProfiler(const SelfProfiler& other) = delete;
+  SelfProfiler& operator=(const SelfProfiler& other) = delete;
+
+  // Charge time spent draining `queue` to `subsystem`, which must outlive
+  // the profiler, e.g. a string literal. Queues are only compared by address
+  // and never dereferenced, so registrations are expected to last for the
+  // life of the process.
+  void RegisterQueue(dispatch_queue_t queue, const char* subsystem);
+
+  // Sample every `interval_ms` from now on. Has no effect if the interval is
+  // 0 or sampling was already started.
+  void Start(uint32_t interval_ms);
+
+  // Sample all threads once. Samples are normally taken by the timer set up
+  // by Start.
+  void Sample();
+
+  // CPU time charged to each subsystem since the first sample
+  absl::flat_hash_map<std::string, CPUTime> CPUTimeBySubsystem();
+
+  static Wakeups GetWakeups();
+
+  // Charges the calling thread to `subsystem` while in scope, for work that
+  // runs on queues belonging to other subsystems. `subsystem` must outlive
+  // the profiler, e.g. a string literal.
+  class ScopedSubsystem {
+   public:
+    explicit ScopedSubsystem(const char* subsystem);
+    ~ScopedSubsystem();
+
+    ScopedSubsystem(ScopedSubsystem&& other) = delete;
+    ScopedSubsystem& operator=(ScopedSubsystem&& rhs) = delete;
+    ScopedSubsystem(const ScopedSubsystem& other) = delete;
+    ScopedSubsystem& operator=(const ScopedSubsystem& other) = delete;
+
+   private:
+    std::atomic<const char*>* slot_;
+    const char* previous_;
+  };
+
+ private:
+  struct ThreadState {
+    CPUTime cpu;
+    // Subsystem of the last registered queue the thread was seen draining
+    const char* last_subsystem;
+  };
+
+  absl::Mutex queues_lock_;
+  absl::flat_hash_map<uintptr_t, const char*> queues_
+      ABSL_GUARDED_BY(queues_lock_);
+
+  absl::Mutex sample_lock_;
+  absl::flat_hash_map<uint64_t, ThreadState> threads_
+      ABSL_GUARDED_BY(sample_lock_);
+  absl::flat_hash_map<std::string, CPUTime> totals_
+      ABSL_GUARDED_BY(sample_lock_);
+  bool primed_ ABSL_GUARDED_BY(sample_lock_) = false;
+
+  std::atomic<bool> started_{false};
+  dispatch_source_t timer_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_SELFPROFILER_H
@@ -0,0 +1,251 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/SelfProfiler.h"
+
+#include <mach/mach.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+namespace santa {
+
+namespace {
+
+// Subsystems set by ScopedSubsystem are published through a fixed table so
+// that the sampler can read them for threads other than its own. Threads
+// claim a slot the first time they enter a ScopedSubsystem and give it back
+// when they exit. Threads that find the table full go unattributed.
+static constexpr size_t kNumScopedSlots = 256;
+
+struct ScopedSlot {
+  std::atomic<uint64_t> thread_id{0};
+  std::atomic<const char*> subsystem{nullptr};
+};
+
+std::array<ScopedSlot, kNumScopedSlots>& ScopedSlots() {
+  static auto* slots = new std::array<ScopedSlot, kNumScopedSlots>();
+  return *slots;
+}
+
+class ScopedSlotOwner {
+ public:
+  ScopedSlotOwner() {
+    uint64_t tid = 0;
+    pthread_threadid_np(nullptr, &tid);
+    for (ScopedSlot& slot : ScopedSlots()) {
+      uint64_t expected = 0;
+      if (slot.thread_id.compare_exchange_strong(expected, tid, std::memory_order_acq_rel)) {
+        slot_ = &slot;
+        break;
+      }
+    }
+  }
+
+  ~ScopedSlotOwner() {
+    if (slot_) {
+      slot_->subsystem.store(nullptr, std::memory_order_relaxed);
+      slot_->thread_id.store(0, std::memory_order_release);
+    }
+  }
+
+  std::atomic<const char*>* Subsystem() { return slot_ ? &slot_->subsystem : nullptr; }
+
+ private:
+  ScopedSlot* slot_ = nullptr;
+};
+
+const char* ScopedSubsystemForThread(uint64_t tid) {
+  for (ScopedSlot& slot : ScopedSlots()) {
+    if (slot.thread_id.load(std::memory_order_acquire) == tid) {
+      return slot.subsystem.load(std::memory_order_relaxed);
+    }
+  }
+  return nullptr;
+}
+
+// Returns the queue the thread is currently draining, or 0 if none. The
+// thread may move on at any time, so the slot is read in a way that fails
+// cleanly rather than faulting if it's gone.
+uintptr_t CurrentQueue(const thread_identifier_info_data_t& ident) {
+  if (ident.dispatch_qaddr == 0) {
+    return 0;
+  }
+
+  uintptr_t queue = 0;
+  vm_size_t size = 0;
+  if (vm_read_overwrite(mach_task_self(), (vm_address_t)ident.dispatch_qaddr, sizeof(queue),
+                        (vm_address_t)&queue, &size) != KERN_SUCCESS ||
+      size != sizeof(queue)) {
+    return 0;
+  }
+  return queue;
+}
+
+}  // namespace
+
+SelfProfiler& SelfProfiler::Shared() {
+  static SelfProfiler* shared = new SelfProfiler();
+  return *shared;
+}
+
+void SelfProfiler::RegisterQueue(dispatch_queue_t queue, const char* subsystem) {
+  if (!queue || !subsystem) {
+    return;
+  }
+
+  absl::MutexLock lock(&queues_lock_);
+  queues_.insert_or_assign((uintptr_t)(__bridge void*)queue, subsystem);
+}
+
+void SelfProfiler::Start(uint32_t interval_ms) {
+  if (interval_ms == 0 || started_.exchange(true)) {
+    return;
+  }
+
+  dispatch_queue_t q = dispatch_queue_create(
+      "com.northpolesec.santa.self_profiler",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+  RegisterQueue(q, "self_profiler");
+
+  timer_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
+  uint64_t interval_ns = (uint64_t)interval_ms * NSEC_PER_MSEC;
+  dispatch_source_set_timer(timer_, dispatch_time(DISPATCH_TIME_NOW, 0), interval_ns,
+                            interval_ns / 10);
+  dispatch_source_set_event_handler(timer_, ^{
+    Sample();
+  });
+  dispatch_resume(timer_);
+}
+
+void SelfProfiler::Sample() {
+  thread_act_array_t threads;
+  mach_msg_type_number_t thread_count = 0;
+  if (task_threads(mach_task_self(), &threads, &thread_count) != KERN_SUCCESS) {
+    return;
+  }
+
+  absl::MutexLock sample_lock(&sample_lock_);
+  absl::flat_hash_map<uint64_t, ThreadState> seen;
+  seen.reserve(thread_count);
+
+  for (mach_msg_type_number_t i = 0; i < thread_count; i++) {
+    thread_identifier_info_data_t ident;
+    mach_msg_type_number_t ident_count = THREAD_IDENTIFIER_INFO_COUNT;
+    thread_extended_info_data_t ext;
+    mach_msg_type_number_t ext_count = THREAD_EXTENDED_INFO_COUNT;
+
+    bool ok = thread_info(threads[i], THREAD_IDENTIFIER_INFO, (thread_info_t)&ident,
+                          &ident_count) == KERN_SUCCESS &&
+              thread_info(threads[i], THREAD_EXTENDED_INFO, (thread_info_t)&ext, &ext_count) ==
+                  KERN_SUCCESS;
+    mach_port_deallocate(mach_task_self(), threads[i]);
+    if (!ok) {
+      continue;
+    }
+
+    const char* queue_subsystem = nullptr;
+    bool draining = false;
+    if (uintptr_t queue = CurrentQueue(ident); queue) {
+      draining = true;
+      absl::ReaderMutexLock lock(&queues_lock_);
+      if (auto it = queues_.find(queue); it != queues_.end()) {
+        queue_subsystem = it->second;
+      }
+    }
+
+    ThreadState state = {
+        .cpu = {.user_nanos = ext.pth_user_time, .system_nanos = ext.pth_system_time},
+        .last_subsystem = queue_subsystem,
+    };
+
+    auto prev = threads_.find(ident.thread_id);
+    if (prev != threads_.end() && !draining) {
+      state.last_subsystem = prev->second.last_subsystem;
+    }
+
+    // Threads created since the last sample are charged for all of their
+    // time. The first sample only records baselines.
+    CPUTime delta = state.cpu;
+    if (prev != threads_.end()) {
+      delta.user_nanos -= std::min(delta.user_nanos, prev->second.cpu.user_nanos);
+      delta.system_nanos -= std::min(delta.system_nanos, prev->second.cpu.system_nanos);
+    }
+
+    if (primed_ && (delta.user_nanos > 0 || delta.system_nanos > 0)) {
+      std::string subsystem;
+      if (const char* scoped = ScopedSubsystemForThread(ident.thread_id); scoped) {
+        subsystem = scoped;
+      } else if (queue_subsystem) {
+        subsystem = queue_subsystem;
+      } else if (draining) {
+        subsystem = "other";
+      } else if (state.last_subsystem) {
+        subsystem = state.last_subsystem;
+      } else if (ext.pth_name[0] != '\0') {
+        subsystem = std::string(ext.pth_name, strnlen(ext.pth_name, sizeof(ext.pth_name)));
+      } else {
+        subsystem = "other";
+      }
+
+      CPUTime& total = totals_[subsystem];
+      total.user_nanos += delta.user_nanos;
+      total.system_nanos += delta.system_nanos;
+    }
+
+    seen.insert_or_assign(ident.thread_id, state);
+  }
+
+  vm_deallocate(mach_task_self(), (vm_address_t)threads, thread_count * sizeof(thread_act_t));
+
+  // Threads that have exited are dropped along with their baselines
+  threads_ = std::move(seen);
+  primed_ = true;
+}
+
+absl::flat_hash_map<std::string, SelfProfiler::CPUTime> SelfProfiler::CPUTimeBySubsystem() {
+  absl::MutexLock lock(&sample_lock_);
+  return totals_;
+}
+
+SelfProfiler::Wakeups SelfProfiler::GetWakeups() {
+  task_power_info_data_t info;
+  mach_msg_type_number_t count = TASK_POWER_INFO_COUNT;
+  if (task_info(mach_task_self(), TASK_POWER_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+    return {};
+  }
+
+  return {
+      .interrupt = info.task_interrupt_wakeups,
+      .platform_idle = info.task_platform_idle_wakeups,
+  };
+}
+
+SelfProfiler::ScopedSubsystem::ScopedSubsystem(const char* subsystem) {
+  thread_local ScopedSlotOwner owner;
+  slot_ = owner.Subsystem();
+  previous_ = slot_ ? slot_->exchange(subsystem, std::memory_order_relaxed) : nullptr;
+}
+
+SelfProfiler::ScopedSubsystem::~ScopedSubsystem() {
+  if (slot_) {
+    slot_->store(previous_, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace santa
@@ -0,0 +1,108 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/SelfProfiler.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+
+using santa::SelfProfiler;
+
+namespace {
+
+// Burn roughly `nanos` of CPU time on the calling thread
+void Spin(uint64_t nanos) {
+  uint64_t start = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+  while (clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID) - start < nanos) {
+  }
+}
+
+uint64_t TotalNanos(const SelfProfiler::CPUTime& cpu) {
+  return cpu.user_nanos + cpu.system_nanos;
+}
+
+}  // namespace
+
+@interface SelfProfilerTest : XCTestCase
+@end
+
+@implementation SelfProfilerTest
+
+- (void)testQueueAttribution {
+  auto sut = std::make_unique<SelfProfiler>();
+  dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.test.self_profiler",
+                                             DISPATCH_QUEUE_SERIAL);
+  sut->RegisterQueue(q, "test_queue");
+
+  // Nothing is charged until a baseline exists
+  sut->Sample();
+  XCTAssertTrue(sut->CPUTimeBySubsystem().empty());
+
+  SelfProfiler* profiler = sut.get();
+  dispatch_sync(q, ^{
+    Spin(20 * NSEC_PER_MSEC);
+    profiler->Sample();
+  });
+
+  auto totals = sut->CPUTimeBySubsystem();
+  auto it = totals.find("test_queue");
+  XCTAssertTrue(it != totals.end());
+  if (it != totals.end()) {
+    XCTAssertGreaterThanOrEqual(TotalNanos(it->second), 20 * NSEC_PER_MSEC);
+  }
+}
+
+- (void)testScopedSubsystem {
+  auto sut = std::make_unique<SelfProfiler>();
+  sut->Sample();
+
+  {
+    SelfProfiler::ScopedSubsystem outer("test_outer");
+    {
+      SelfProfiler::ScopedSubsystem inner("test_inner");
+      Spin(20 * NSEC_PER_MSEC);
+      sut->Sample();
+    }
+
+    // Leaving the inner scope restores the outer subsystem
+    Spin(20 * NSEC_PER_MSEC);
+    sut->Sample();
+  }
+
+  auto totals = sut->CPUTimeBySubsystem();
+  for (const char* subsystem : {"test_inner", "test_outer"}) {
+    auto it = totals.find(subsystem);
+    XCTAssertTrue(it != totals.end(), @"%s", subsystem);
+    if (it != totals.end()) {
+      XCTAssertGreaterThanOrEqual(TotalNanos(it->second), 20 * NSEC_PER_MSEC, @"%s", subsystem);
+    }
+  }
+}
+
+- (void)testGetWakeups {
+  SelfProfiler::Wakeups first = SelfProfiler::GetWakeups();
+  usleep(10000);
+  SelfProfiler::Wakeups second = SelfProfiler::GetWakeups();
+
+  // Counters are cumulative for the life of the process
+  XCTAssertGreaterThanOrEqual(second.interrupt, first.interrupt);
+  XCTAssertGreaterThanOrEqual(second.platform_idle, first.platform_idle);
+}
+
+@end
@@ -0,0 +1,118 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_SHARDEDCOUNTER_H
+#define SANTA_COMMON_SHARDEDCOUNTER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace santa {
+
+// 64-bit counter that many threads can update without contending.
+//
+// Threads are spread across kShards cache-line sized shards, each holding a
+// partial count and the time of its last update. Shards are only combined
+// when the value is read, which is expected to be rare compared to updates
+// (e.g. at metric export time).
+class ShardedCounter {
+ public:
+  static constexpr int kShards = 16;
+
+  ShardedCounter() = default;
+
+  ShardedCounter(ShardedCounter&& other) = delete;
+  ShardedCounter& operator=(ShardedCounter&& rhs) = delete;
+  ShardedCounter(const ShardedCounter& other) = delete;
+  ShardedCounter& operator=(const ShardedCounter& other) = delete;
+
+  // Updates take the caller's current time, in any units where later times
+  // compare greater and 0 means "never".
+  void Add(int64_t step, double now);
+
+  // Replace the value. Adds racing with a Set may be lost, which is fine for
+  // gauges where the most recent Set wins anyway.
+  void Set(int64_t value, double now);
+
+  // Record an update without changing the value.
+  void Touch(double now);
+
+  // Sum of all shards.
+  int64_t Value() const;
+
+  // Time of the most recent update, or 0 if there hasn't been one since the
+  // last call to ClearLastUpdate.
+  double LastUpdate() const;
+  void ClearLastUpdate();
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+    std::atomic<double> last_update{0};
+  };
+
+  std::array<Shard, kShards> shards_;
+};
+
+// Distribution of double values over fixed buckets that many threads can
+// record into without contending, sharded the same way as ShardedCounter.
+//
+// Bucket i counts values less than bounds[i] and not counted by an earlier
+// bucket. A final overflow bucket counts everything else, so there is one
+// more bucket than there are bounds.
+class ShardedHistogram {
+ public:
+  static constexpr int kShards = ShardedCounter::kShards;
+
+  struct Snapshot {
+    std::vector<uint64_t> bucket_counts;
+    uint64_t count = 0;
+    double sum = 0;
+    double sum_of_squares = 0;
+  };
+
+  // `bounds` must be sorted in increasing order.
+  explicit ShardedHistogram(std::vector<double> bounds);
+
+  ShardedHistogram(ShardedHistogram&& other) = delete;
+  ShardedHistogram& operator=(ShardedHistogram&& rhs) = delete;
+  ShardedHistogram(const ShardedHistogram& other) = delete;
+  ShardedHistogram& operator=(const ShardedHistogram& other) = delete;
+
+  void Record(double value);
+
+  // Merge all shards.
+  Snapshot TakeSnapshot() const;
+
+  const std::vector<double>& Bounds() const { return bounds_; }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> count{0};
+    std::atomic<double> sum{0};
+    std::atomic<double> sum_of_squares{0};
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+  };
+
+  std::vector<double> bounds_;
+  std::array<Shard, kShards> shards_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_SHARDEDCOUNTER_H
@@ -0,0 +1,116 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ShardedCounter.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace santa {
+
+namespace {
+
+// Threads are assigned shards round robin the first time they update any
+// counter or histogram, so each thread always uses the same shard index.
+int ShardForCurrentThread() {
+  static std::atomic<uint32_t> next_shard{0};
+  thread_local int shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % ShardedCounter::kShards;
+  return shard;
+}
+
+void AtomicAdd(std::atomic<double>& target, double value) {
+  double prev = target.load(std::memory_order_relaxed);
+  while (!target.compare_exchange_weak(prev, prev + value, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+void ShardedCounter::Add(int64_t step, double now) {
+  Shard& shard = shards_[ShardForCurrentThread()];
+  shard.value.fetch_add(step, std::memory_order_relaxed);
+  shard.last_update.store(now, std::memory_order_relaxed);
+}
+
+void ShardedCounter::Set(int64_t value, double now) {
+  // Every Set writes the first shard, so concurrent Sets still leave exactly
+  // one of their values behind.
+  for (int i = 1; i < kShards; i++) {
+    shards_[i].value.store(0, std::memory_order_relaxed);
+  }
+  shards_[0].value.store(value, std::memory_order_relaxed);
+  Touch(now);
+}
+
+void ShardedCounter::Touch(double now) {
+  shards_[ShardForCurrentThread()].last_update.store(now, std::memory_order_relaxed);
+}
+
+int64_t ShardedCounter::Value() const {
+  int64_t sum = 0;
+  for (const Shard& shard : shards_) {
+    sum += shard.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+double ShardedCounter::LastUpdate() const {
+  double last = 0;
+  for (const Shard& shard : shards_) {
+    last = std::max(last, shard.last_update.load(std::memory_order_relaxed));
+  }
+  return last;
+}
+
+void ShardedCounter::ClearLastUpdate() {
+  for (Shard& shard : shards_) {
+    shard.last_update.store(0, std::memory_order_relaxed);
+  }
+}
+
+ShardedHistogram::ShardedHistogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+  for (Shard& shard : shards_) {
+    shard.buckets = std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1);
+  }
+}
+
+void ShardedHistogram::Record(double value) {
+  size_t bucket = std::upper_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+
+  // Threads only share a shard once there are more than kShards of them, so
+  // the loops updating the sums rarely retry.
+  Shard& shard = shards_[ShardForCurrentThread()];
+  shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  AtomicAdd(shard.sum, value);
+  AtomicAdd(shard.sum_of_squares, value * value);
+}
+
+ShardedHistogram::Snapshot ShardedHistogram::TakeSnapshot() const {
+  Snapshot snapshot;
+  snapshot.bucket_counts.resize(bounds_.size() + 1);
+  for (const Shard& shard : shards_) {
+    for (size_t i = 0; i < snapshot.bucket_counts.size(); i++) {
+      snapshot.bucket_counts[i] += shard.buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count += shard.count.load(std::memory_order_relaxed);
+    snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    snapshot.sum_of_squares += shard.sum_of_squares.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+}  // namespace santa
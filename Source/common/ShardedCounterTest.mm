@@ -0,0 +1,109 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ShardedCounter.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <memory>
+#include <vector>
+
+using santa::ShardedCounter;
+using santa::ShardedHistogram;
+
+@interface ShardedCounterTest : XCTestCase
+@end
+
+@implementation ShardedCounterTest
+
+- (void)testAddAndSet {
+  auto sut = std::make_unique<ShardedCounter>();
+  XCTAssertEqual(sut->Value(), 0);
+  XCTAssertEqual(sut->LastUpdate(), 0);
+
+  sut->Add(5, 10);
+  sut->Add(-2, 20);
+  XCTAssertEqual(sut->Value(), 3);
+  XCTAssertEqual(sut->LastUpdate(), 20);
+
+  sut->Set(42, 30);
+  XCTAssertEqual(sut->Value(), 42);
+  XCTAssertEqual(sut->LastUpdate(), 30);
+
+  sut->ClearLastUpdate();
+  XCTAssertEqual(sut->LastUpdate(), 0);
+  XCTAssertEqual(sut->Value(), 42);
+
+  sut->Touch(40);
+  XCTAssertEqual(sut->LastUpdate(), 40);
+  XCTAssertEqual(sut->Value(), 42);
+}
+
+- (void)testConcurrentAdds {
+  auto sut = std::make_shared<ShardedCounter>();
+
+  dispatch_apply(32, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t t) {
+    for (int i = 0; i < 10000; i++) {
+      sut->Add(1, t + 1);
+    }
+  });
+
+  XCTAssertEqual(sut->Value(), 32 * 10000);
+  XCTAssertGreaterThan(sut->LastUpdate(), 0);
+
+  // A Set replaces the value, even though other threads' shards held part of it
+  sut->Set(7, 33);
+  XCTAssertEqual(sut->Value(), 7);
+}
+
+- (void)testHistogramBuckets {
+  auto sut = std::make_unique<ShardedHistogram>(std::vector<double>{1, 10});
+
+  ShardedHistogram::Snapshot empty = sut->TakeSnapshot();
+  XCTAssertEqual(empty.count, 0);
+  XCTAssertEqual(empty.bucket_counts.size(), 3);
+
+  // Values equal to a bound belong to the next bucket
+  for (double v : {0.5, 1.0, 9.0, 10.0, 50.0}) {
+    sut->Record(v);
+  }
+
+  ShardedHistogram::Snapshot snapshot = sut->TakeSnapshot();
+  XCTAssertEqual(snapshot.count, 5);
+  XCTAssertEqual(snapshot.sum, 70.5);
+  XCTAssertEqual(snapshot.sum_of_squares, 0.25 + 1 + 81 + 100 + 2500);
+  XCTAssertEqual(snapshot.bucket_counts[0], 1);
+  XCTAssertEqual(snapshot.bucket_counts[1], 2);
+  XCTAssertEqual(snapshot.bucket_counts[2], 2);
+}
+
+- (void)testConcurrentHistogramRecording {
+  auto sut = std::make_shared<ShardedHistogram>(std::vector<double>{100});
+
+  dispatch_apply(32, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t t) {
+    for (int i = 0; i < 1000; i++) {
+      sut->Record(i % 200);
+    }
+  });
+
+  ShardedHistogram::Snapshot snapshot = sut->TakeSnapshot();
+  XCTAssertEqual(snapshot.count, 32 * 1000);
+  XCTAssertEqual(snapshot.bucket_counts[0], 32 * 500);
+  XCTAssertEqual(snapshot.bucket_counts[1], 32 * 500);
+  XCTAssertEqual(snapshot.sum, 32 * 5 * 19900);
+}
+
+@end
@@ -0,0 +1,76 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_SIGNPOSTS_H
+#define SANTA_COMMON_SIGNPOSTS_H
+
+#include <os/signpost.h>
+
+#include <cstdint>
+
+namespace santa {
+
+// Stages of santad startup and event processing that can be traced as
+// os_signpost intervals in Instruments.
+enum class SignpostPhase {
+  kSantadDeps,
+  kESSubscribe,
+  kProcessTreeBackfill,
+  kDecisionCacheBackfill,
+  kWatchItemsReload,
+  kDatabaseMigration,
+  kAuthEvent,
+  kNotifyEvent,
+};
+
+// Signposts are off by default and can be toggled at runtime. Even when
+// enabled, nothing is emitted unless a tool such as Instruments is recording.
+// If `persist` is true the setting is saved and restored by
+// LoadPersistedSignpostsSetting, so that startup can be traced too.
+void SetSignpostsEnabled(bool enabled, bool persist = false);
+bool SignpostsEnabled();
+
+// Apply the setting last saved by SetSignpostsEnabled. Call once at startup.
+void LoadPersistedSignpostsSetting();
+
+// Begin an interval for `phase`. `event_id` identifies the event or object
+// being processed and is attached to the interval. Returns
+// OS_SIGNPOST_ID_NULL if signposts are disabled.
+os_signpost_id_t BeginSignpost(SignpostPhase phase, uint64_t event_id = 0);
+
+// End an interval started by BeginSignpost. Does nothing for
+// OS_SIGNPOST_ID_NULL.
+void EndSignpost(SignpostPhase phase, os_signpost_id_t id);
+
+// Signpost interval covering the lifetime of the object.
+class ScopedSignpost {
+ public:
+  explicit ScopedSignpost(SignpostPhase phase, uint64_t event_id = 0)
+      : phase_(phase), id_(BeginSignpost(phase, event_id)) {}
+  ~ScopedSignpost() { EndSignpost(phase_, id_); }
+
+  ScopedSignpost(ScopedSignpost&& other) = delete;
+  ScopedSignpost& operator=(ScopedSignpost&& rhs) = delete;
+  ScopedSignpost(const ScopedSignpost& other) = delete;
+  ScopedSignpost& operator=(const ScopedSignpost& other) = delete;
+
+ private:
+  SignpostPhase phase_;
+  os_signpost_id_t id_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_SIGNPOSTS_H
@@ -0,0 +1,138 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/Signposts.h"
+
+#include <fcntl.h>
+#include <os/log.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace santa {
+
+namespace {
+
+// Existence of this file enables signposts at launch
+constexpr const char* kPersistedSettingPath = "/var/db/santa/signposts.enabled";
+
+std::atomic_bool signposts_enabled{false};
+
+os_log_t SignpostLog() {
+  static os_log_t log = os_log_create("com.northpolesec.santa", "Timeline");
+  return log;
+}
+
+}  // namespace
+
+void SetSignpostsEnabled(bool enabled, bool persist) {
+  signposts_enabled.store(enabled, std::memory_order_relaxed);
+
+  if (persist) {
+    if (enabled) {
+      int fd = open(kPersistedSettingPath, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+      if (fd >= 0) {
+        close(fd);
+      }
+    } else {
+      unlink(kPersistedSettingPath);
+    }
+  }
+}
+
+void LoadPersistedSignpostsSetting() {
+  signposts_enabled.store(access(kPersistedSettingPath, F_OK) == 0, std::memory_order_relaxed);
+}
+
+bool SignpostsEnabled() {
+  return signposts_enabled.load(std::memory_order_relaxed);
+}
+
+os_signpost_id_t BeginSignpost(SignpostPhase phase, uint64_t event_id) {
+  if (!SignpostsEnabled()) {
+    return OS_SIGNPOST_ID_NULL;
+  }
+
+  os_log_t log = SignpostLog();
+  if (!os_signpost_enabled(log)) {
+    return OS_SIGNPOST_ID_NULL;
+  }
+
+  os_signpost_id_t id = os_signpost_id_generate(log);
+  // Signpost names must be string literals, so each phase needs its own call
+  switch (phase) {
+    case SignpostPhase::kSantadDeps:
+      os_signpost_interval_begin(log, id, "SantadDeps", "event_id=%llu", event_id);
+      break;
+    case SignpostPhase::kESSubscribe:
+      os_signpost_interval_begin(log, id, "ESSubscribe", "event_id=%llu", event_id);
+      break;
+    case SignpostPhase::kProcessTreeBackfill:
+      os_signpost_interval_begin(log, id, "ProcessTreeBackfill", "event_id=%llu", event_id);
+      break;
+    case SignpostPhase::kDecisionCacheBackfill:
+      os_signpost_interval_begin(log, id, "DecisionCacheBackfill", "event_id=%llu", event_id);
+      break;
+    case SignpostPhase::kWatchItemsReload:
+      os_signpost_interval_begin(log, id, "WatchItemsReload", "event_id=%llu", event_id);
+      break;
+    case SignpostPhase::kDatabaseMigration:
+      os_signpost_interval_begin(log, id, "DatabaseMigration", "event_id=%llu", event_id);
+      break;
+    case SignpostPhase::kAuthEvent:
+      os_signpost_interval_begin(log, id, "AuthEvent", "event_id=%llu", event_id);
+      break;
+    case SignpostPhase::kNotifyEvent:
+      os_signpost_interval_begin(log, id, "NotifyEvent", "event_id=%llu", event_id);
+      break;
+  }
+  return id;
+}
+
+void EndSignpost(SignpostPhase phase, os_signpost_id_t id) {
+  if (id == OS_SIGNPOST_ID_NULL) {
+    return;
+  }
+
+  os_log_t log = SignpostLog();
+  switch (phase) {
+    case SignpostPhase::kSantadDeps:
+      os_signpost_interval_end(log, id, "SantadDeps");
+      break;
+    case SignpostPhase::kESSubscribe:
+      os_signpost_interval_end(log, id, "ESSubscribe");
+      break;
+    case SignpostPhase::kProcessTreeBackfill:
+      os_signpost_interval_end(log, id, "ProcessTreeBackfill");
+      break;
+    case SignpostPhase::kDecisionCacheBackfill:
+      os_signpost_interval_end(log, id, "DecisionCacheBackfill");
+      break;
+    case SignpostPhase::kWatchItemsReload:
+      os_signpost_interval_end(log, id, "WatchItemsReload");
+      break;
+    case SignpostPhase::kDatabaseMigration:
+      os_signpost_interval_end(log, id, "DatabaseMigration");
+      break;
+    case SignpostPhase::kAuthEvent:
+      os_signpost_interval_end(log, id, "AuthEvent");
+      break;
+    case SignpostPhase::kNotifyEvent:
+      os_signpost_interval_end(log, id, "NotifyEvent");
+      break;
+  }
+}
+
+}  // namespace santa
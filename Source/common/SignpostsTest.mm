@@ -0,0 +1,57 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/Signposts.h"
+
+#import <XCTest/XCTest.h>
+
+using santa::BeginSignpost;
+using santa::EndSignpost;
+using santa::SignpostPhase;
+
+@interface SignpostsTest : XCTestCase
+@end
+
+@implementation SignpostsTest
+
+- (void)tearDown {
+  santa::SetSignpostsEnabled(false);
+}
+
+- (void)testDisabledByDefault {
+  XCTAssertFalse(santa::SignpostsEnabled());
+  XCTAssertEqual(BeginSignpost(SignpostPhase::kAuthEvent, 1), OS_SIGNPOST_ID_NULL);
+
+  // Ending a null interval is a no-op
+  EndSignpost(SignpostPhase::kAuthEvent, OS_SIGNPOST_ID_NULL);
+}
+
+- (void)testToggle {
+  santa::SetSignpostsEnabled(true);
+  XCTAssertTrue(santa::SignpostsEnabled());
+
+  // Intervals still work whether or not anything is recording them
+  os_signpost_id_t id = BeginSignpost(SignpostPhase::kNotifyEvent, 2);
+  EndSignpost(SignpostPhase::kNotifyEvent, id);
+  {
+    santa::ScopedSignpost signpost(SignpostPhase::kSantadDeps);
+  }
+
+  santa::SetSignpostsEnabled(false);
+  XCTAssertFalse(santa::SignpostsEnabled());
+  XCTAssertEqual(BeginSignpost(SignpostPhase::kNotifyEvent, 3), OS_SIGNPOST_ID_NULL);
+}
+
+@end
@@ -0,0 +1,77 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_SLOWESTEVALUATIONS_H
+#define SANTA_COMMON_SLOWESTEVALUATIONS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Tracks the binaries that took the longest to evaluate, keyed by path.
+//
+// Only the slowest `capacity` paths are kept. Once full, evaluations faster
+// than the quickest tracked entry are rejected with a single atomic load, so
+// the common case never takes the lock.
+class SlowestEvaluations {
+ public:
+  struct Entry {
+    std::string path;
+    uint64_t count = 0;
+    uint64_t max_nanos = 0;
+    uint64_t total_nanos = 0;
+  };
+
+  static constexpr size_t kDefaultCapacity = 32;
+
+  // Process wide record of slow exec evaluations
+  static SlowestEvaluations& Shared();
+
+  explicit SlowestEvaluations(size_t capacity = kDefaultCapacity);
+
+  SlowestEvaluations(SlowestEvaluations&& other) = delete;
+  SlowestEvaluations& operator=(SlowestEvaluations&& rhs) = delete;
+  SlowestEvaluations(const SlowestEvaluations& other) = delete;
+  SlowestEvaluations& operator=(const SlowestEvaluations& other) = delete;
+
+  void Record(std::string_view path, uint64_t nanos);
+
+  // Up to `limit` entries, slowest first
+  std::vector<Entry> Top(size_t limit) const;
+
+ private:
+  // Recomputes admission_floor_ from the tracked entries
+  void UpdateFloorLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const size_t capacity_;
+  // Evaluations at or below this are not recorded. Zero until full.
+  std::atomic<uint64_t> admission_floor_{0};
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_SLOWESTEVALUATIONS_H
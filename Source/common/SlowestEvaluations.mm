@@ -0,0 +1,89 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/SlowestEvaluations.h"
+
+#include <algorithm>
+
+namespace santa {
+
+SlowestEvaluations& SlowestEvaluations::Shared() {
+  static SlowestEvaluations* shared = new SlowestEvaluations();
+  return *shared;
+}
+
+SlowestEvaluations::SlowestEvaluations(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)) {}
+
+void SlowestEvaluations::Record(std::string_view path, uint64_t nanos) {
+  if (nanos <= admission_floor_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  absl::MutexLock lock(&mu_);
+
+  auto it = entries_.find(path);
+  if (it == entries_.end()) {
+    if (entries_.size() >= capacity_) {
+      // Replace the entry with the fastest worst case
+      auto fastest = std::min_element(
+          entries_.begin(), entries_.end(), [](const auto& a, const auto& b) {
+            return a.second.max_nanos < b.second.max_nanos;
+          });
+      if (fastest->second.max_nanos >= nanos) {
+        return;
+      }
+      entries_.erase(fastest);
+    }
+    it = entries_.emplace(std::string(path), Entry{.path = std::string(path)}).first;
+  }
+
+  Entry& entry = it->second;
+  entry.count++;
+  entry.total_nanos += nanos;
+  entry.max_nanos = std::max(entry.max_nanos, nanos);
+
+  if (entries_.size() >= capacity_) {
+    UpdateFloorLocked();
+  }
+}
+
+void SlowestEvaluations::UpdateFloorLocked() {
+  uint64_t floor = UINT64_MAX;
+  for (const auto& [path, entry] : entries_) {
+    floor = std::min(floor, entry.max_nanos);
+  }
+  admission_floor_.store(floor, std::memory_order_relaxed);
+}
+
+std::vector<SlowestEvaluations::Entry> SlowestEvaluations::Top(size_t limit) const {
+  std::vector<Entry> top;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    top.reserve(entries_.size());
+    for (const auto& [path, entry] : entries_) {
+      top.push_back(entry);
+    }
+  }
+
+  std::sort(top.begin(), top.end(),
+            [](const Entry& a, const Entry& b) { return a.max_nanos > b.max_nanos; });
+  if (top.size() > limit) {
+    top.resize(limit);
+  }
+  return top;
+}
+
+}  // namespace santa
@@ -0,0 +1,81 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/SlowestEvaluations.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <memory>
+#include <string>
+
+using santa::SlowestEvaluations;
+
+@interface SlowestEvaluationsTest : XCTestCase
+@end
+
+@implementation SlowestEvaluationsTest
+
+- (void)testAggregatesByPath {
+  SlowestEvaluations sut(4);
+  sut.Record("/a", 100);
+  sut.Record("/a", 300);
+  sut.Record("/b", 200);
+
+  std::vector<SlowestEvaluations::Entry> top = sut.Top(10);
+  XCTAssertEqual(top.size(), 2);
+  XCTAssertEqual(top[0].path, "/a");
+  XCTAssertEqual(top[0].count, 2);
+  XCTAssertEqual(top[0].max_nanos, 300);
+  XCTAssertEqual(top[0].total_nanos, 400);
+  XCTAssertEqual(top[1].path, "/b");
+
+  XCTAssertEqual(sut.Top(1).size(), 1);
+}
+
+- (void)testKeepsSlowestWhenFull {
+  SlowestEvaluations sut(2);
+  sut.Record("/a", 100);
+  sut.Record("/b", 200);
+
+  // Faster than everything tracked, dropped
+  sut.Record("/c", 50);
+  // Slower than /a, replaces it
+  sut.Record("/d", 150);
+
+  std::vector<SlowestEvaluations::Entry> top = sut.Top(10);
+  XCTAssertEqual(top.size(), 2);
+  XCTAssertEqual(top[0].path, "/b");
+  XCTAssertEqual(top[1].path, "/d");
+}
+
+- (void)testConcurrentRecording {
+  auto sut = std::make_shared<SlowestEvaluations>(8);
+
+  dispatch_apply(8, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t t) {
+    std::string path = "/bin/" + std::to_string(t);
+    for (uint64_t i = 1; i <= 1000; i++) {
+      sut->Record(path, i);
+    }
+  });
+
+  std::vector<SlowestEvaluations::Entry> top = sut->Top(10);
+  XCTAssertEqual(top.size(), 8);
+  for (const auto& entry : top) {
+    XCTAssertEqual(entry.max_nanos, 1000);
+  }
+}
+
+@end
@@ -18,8 +18,12 @@
 #import <EndpointSecurity/ESTypes.h>
 #import <Foundation/Foundation.h>
 
+#include <array>
+#include <set>
 #include <type_traits>
 
+#include "Source/common/Platform.h"
+
 namespace santa {
 
 // clang-format off
@@ -54,27 +58,27 @@ enum class TelemetryEvent : uint64_t {
 };
 // clang-format on
 
-inline TelemetryEvent operator|(TelemetryEvent lhs, TelemetryEvent rhs) {
+constexpr TelemetryEvent operator|(TelemetryEvent lhs, TelemetryEvent rhs) {
   return static_cast<TelemetryEvent>(static_cast<std::underlying_type_t<TelemetryEvent>>(lhs) |
                                      static_cast<std::underlying_type_t<TelemetryEvent>>(rhs));
 }
 
-inline TelemetryEvent& operator|=(TelemetryEvent& lhs, TelemetryEvent rhs) {
+constexpr TelemetryEvent& operator|=(TelemetryEvent& lhs, TelemetryEvent rhs) {
   lhs = lhs | rhs;
   return lhs;
 }
 
-inline TelemetryEvent operator&(TelemetryEvent lhs, TelemetryEvent rhs) {
+constexpr TelemetryEvent operator&(TelemetryEvent lhs, TelemetryEvent rhs) {
   return static_cast<TelemetryEvent>(static_cast<std::underlying_type_t<TelemetryEvent>>(lhs) &
                                      static_cast<std::underlying_type_t<TelemetryEvent>>(rhs));
 }
 
-inline TelemetryEvent& operator&=(TelemetryEvent& lhs, TelemetryEvent rhs) {
+constexpr TelemetryEvent& operator&=(TelemetryEvent& lhs, TelemetryEvent rhs) {
   lhs = lhs & rhs;
   return lhs;
 }
 
-inline TelemetryEvent operator~(TelemetryEvent rhs) {
+constexpr TelemetryEvent operator~(TelemetryEvent rhs) {
   return static_cast<TelemetryEvent>(~static_cast<std::underlying_type_t<TelemetryEvent>>(rhs));
 }
 
@@ -84,8 +88,74 @@ inline TelemetryEvent operator~(TelemetryEvent rhs) {
 // If `Telemetry` is not set, `everything` (all events) are assumed.
 TelemetryEvent TelemetryConfigToBitmask(NSArray<NSString*>* telemetry);
 
+namespace internal {
+
+struct ESEventTelemetry {
+  es_event_type_t event;
+  TelemetryEvent telemetry;
+};
+
+// ES events that map to a `TelemetryEvent`, all others map to `kNone`
+inline constexpr ESEventTelemetry kESEventTelemetry[] = {
+    {ES_EVENT_TYPE_NOTIFY_CLONE, TelemetryEvent::kClone},
+    {ES_EVENT_TYPE_NOTIFY_CLOSE, TelemetryEvent::kClose},
+    {ES_EVENT_TYPE_NOTIFY_COPYFILE, TelemetryEvent::kCopyfile},
+    {ES_EVENT_TYPE_NOTIFY_CS_INVALIDATED, TelemetryEvent::kCodesigningInvalidated},
+    {ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA, TelemetryEvent::kExchangeData},
+    {ES_EVENT_TYPE_NOTIFY_EXEC, TelemetryEvent::kExecution},
+    {ES_EVENT_TYPE_NOTIFY_EXIT, TelemetryEvent::kExit},
+    {ES_EVENT_TYPE_NOTIFY_FORK, TelemetryEvent::kFork},
+    {ES_EVENT_TYPE_NOTIFY_LINK, TelemetryEvent::kLink},
+    {ES_EVENT_TYPE_NOTIFY_RENAME, TelemetryEvent::kRename},
+    {ES_EVENT_TYPE_NOTIFY_UNLINK, TelemetryEvent::kUnlink},
+    {ES_EVENT_TYPE_NOTIFY_AUTHENTICATION, TelemetryEvent::kAuthentication},
+    {ES_EVENT_TYPE_NOTIFY_LOGIN_LOGIN, TelemetryEvent::kLoginLogout},
+    {ES_EVENT_TYPE_NOTIFY_LOGIN_LOGOUT, TelemetryEvent::kLoginLogout},
+    {ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOGIN, TelemetryEvent::kLoginWindowSession},
+    {ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOGOUT, TelemetryEvent::kLoginWindowSession},
+    {ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOCK, TelemetryEvent::kLoginWindowSession},
+    {ES_EVENT_TYPE_NOTIFY_LW_SESSION_UNLOCK, TelemetryEvent::kLoginWindowSession},
+    {ES_EVENT_TYPE_NOTIFY_SCREENSHARING_ATTACH, TelemetryEvent::kScreenSharing},
+    {ES_EVENT_TYPE_NOTIFY_SCREENSHARING_DETACH, TelemetryEvent::kScreenSharing},
+    {ES_EVENT_TYPE_NOTIFY_OPENSSH_LOGIN, TelemetryEvent::kOpenSSH},
+    {ES_EVENT_TYPE_NOTIFY_OPENSSH_LOGOUT, TelemetryEvent::kOpenSSH},
+    {ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_ADD, TelemetryEvent::kLaunchItem},
+    {ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_REMOVE, TelemetryEvent::kLaunchItem},
+    {ES_EVENT_TYPE_NOTIFY_XP_MALWARE_DETECTED, TelemetryEvent::kXProtect},
+    {ES_EVENT_TYPE_NOTIFY_XP_MALWARE_REMEDIATED, TelemetryEvent::kXProtect},
+#if HAVE_MACOS_15
+    {ES_EVENT_TYPE_NOTIFY_GATEKEEPER_USER_OVERRIDE, TelemetryEvent::kGatekeeperOverride},
+#endif  // HAVE_MACOS_15
+#if HAVE_MACOS_15_4
+    {ES_EVENT_TYPE_NOTIFY_TCC_MODIFY, TelemetryEvent::kTCCModification},
+#endif  // HAVE_MACOS_15_4
+    {ES_EVENT_TYPE_NOTIFY_PROC_SUSPEND_RESUME, TelemetryEvent::kProcSuspendResume},
+};
+
+constexpr std::array<TelemetryEvent, ES_EVENT_TYPE_LAST> MakeESEventTelemetryTable() {
+  std::array<TelemetryEvent, ES_EVENT_TYPE_LAST> table{};
+  for (const ESEventTelemetry& entry : kESEventTelemetry) {
+    table[entry.event] = entry.telemetry;
+  }
+  return table;
+}
+
+// Indexed by `es_event_type_t`, built at compile time
+inline constexpr std::array<TelemetryEvent, ES_EVENT_TYPE_LAST> kESEventTelemetryTable =
+    MakeESEventTelemetryTable();
+
+}  // namespace internal
+
 // Returns the appropriate `TelemetryEvent` enum value for a given ES event
-TelemetryEvent ESEventToTelemetryEvent(es_event_type_t event);
+constexpr TelemetryEvent ESEventToTelemetryEvent(es_event_type_t event) {
+  return event < ES_EVENT_TYPE_LAST ? internal::kESEventTelemetryTable[event]
+                                    : TelemetryEvent::kNone;
+}
+
+// Returns the subset of `events` that would be logged with the given mask.
+// Events without a `TelemetryEvent` are always included.
+std::set<es_event_type_t> ESEventsForTelemetryMask(const std::set<es_event_type_t>& events,
+                                                   TelemetryEvent mask);
 
 }  // namespace santa
 
@@ -16,57 +16,76 @@
 
 #include <EndpointSecurity/ESTypes.h>
 
+#include <algorithm>
+#include <iterator>
 #include <string_view>
 
-#include "Source/common/Platform.h"
 #include "Source/common/String.h"
-#include "absl/container/flat_hash_map.h"
 
 namespace santa {
 
-static inline TelemetryEvent EventNameToMask(std::string_view event) {
-  static absl::flat_hash_map<std::string_view, TelemetryEvent> event_name_to_mask = {
-      {"execution", TelemetryEvent::kExecution},
-      {"fork", TelemetryEvent::kFork},
-      {"exit", TelemetryEvent::kExit},
-      {"close", TelemetryEvent::kClose},
-      {"rename", TelemetryEvent::kRename},
-      {"unlink", TelemetryEvent::kUnlink},
-      {"link", TelemetryEvent::kLink},
-      {"exchangedata", TelemetryEvent::kExchangeData},
-      {"disk", TelemetryEvent::kDisk},
-      {"bundle", TelemetryEvent::kBundle},
-      {"allowlist", TelemetryEvent::kAllowlist},
-      {"fileaccess", TelemetryEvent::kFileAccess},
-      {"codesigninginvalidated", TelemetryEvent::kCodesigningInvalidated},
-      {"loginwindowsession", TelemetryEvent::kLoginWindowSession},
-      {"loginlogout", TelemetryEvent::kLoginLogout},
-      {"screensharing", TelemetryEvent::kScreenSharing},
-      {"openssh", TelemetryEvent::kOpenSSH},
-      {"authentication", TelemetryEvent::kAuthentication},
-      {"clone", TelemetryEvent::kClone},
-      {"copyfile", TelemetryEvent::kCopyfile},
-      {"gatekeeperoverride", TelemetryEvent::kGatekeeperOverride},
-      {"launchitem", TelemetryEvent::kLaunchItem},
-      {"tccmodification", TelemetryEvent::kTCCModification},
-      {"xprotect", TelemetryEvent::kXProtect},
-      {"procsuspendresume", TelemetryEvent::kProcSuspendResume},
-      // IMPORTANT: When adding new keys to the map, keep the set of keys in
-      // `docs/src/lib/santaconfig.ts` in sync.
-
-      // special cases
-      {"none", TelemetryEvent::kNone},
-      {"everything", TelemetryEvent::kEverything},
-  };
-
-  auto search = event_name_to_mask.find(event);
-  if (search != event_name_to_mask.end()) {
-    return search->second;
+namespace {
+
+struct EventName {
+  std::string_view name;
+  TelemetryEvent mask;
+};
+
+// Sorted by name so lookups can binary search
+// IMPORTANT: When adding new names, keep the set of keys in
+// `docs/src/lib/santaconfig.ts` in sync.
+constexpr EventName kEventNames[] = {
+    {"allowlist", TelemetryEvent::kAllowlist},
+    {"authentication", TelemetryEvent::kAuthentication},
+    {"bundle", TelemetryEvent::kBundle},
+    {"clone", TelemetryEvent::kClone},
+    {"close", TelemetryEvent::kClose},
+    {"codesigninginvalidated", TelemetryEvent::kCodesigningInvalidated},
+    {"copyfile", TelemetryEvent::kCopyfile},
+    {"disk", TelemetryEvent::kDisk},
+    {"everything", TelemetryEvent::kEverything},  // special case
+    {"exchangedata", TelemetryEvent::kExchangeData},
+    {"execution", TelemetryEvent::kExecution},
+    {"exit", TelemetryEvent::kExit},
+    {"fileaccess", TelemetryEvent::kFileAccess},
+    {"fork", TelemetryEvent::kFork},
+    {"gatekeeperoverride", TelemetryEvent::kGatekeeperOverride},
+    {"launchitem", TelemetryEvent::kLaunchItem},
+    {"link", TelemetryEvent::kLink},
+    {"loginlogout", TelemetryEvent::kLoginLogout},
+    {"loginwindowsession", TelemetryEvent::kLoginWindowSession},
+    {"none", TelemetryEvent::kNone},  // special case
+    {"openssh", TelemetryEvent::kOpenSSH},
+    {"procsuspendresume", TelemetryEvent::kProcSuspendResume},
+    {"rename", TelemetryEvent::kRename},
+    {"screensharing", TelemetryEvent::kScreenSharing},
+    {"tccmodification", TelemetryEvent::kTCCModification},
+    {"unlink", TelemetryEvent::kUnlink},
+    {"xprotect", TelemetryEvent::kXProtect},
+};
+
+constexpr bool EventNameLess(const EventName& lhs, const EventName& rhs) {
+  return lhs.name < rhs.name;
+}
+
+static_assert(std::is_sorted(std::begin(kEventNames), std::end(kEventNames), EventNameLess),
+              "kEventNames must be sorted by name");
+
+constexpr TelemetryEvent EventNameToMask(std::string_view event) {
+  const EventName* it = std::lower_bound(std::begin(kEventNames), std::end(kEventNames),
+                                         EventName{event, TelemetryEvent::kNone}, EventNameLess);
+  if (it != std::end(kEventNames) && it->name == event) {
+    return it->mask;
   } else {
     return TelemetryEvent::kNone;
   }
 }
 
+static_assert(EventNameToMask("execution") == TelemetryEvent::kExecution);
+static_assert(EventNameToMask("unknown") == TelemetryEvent::kNone);
+
+}  // namespace
+
 TelemetryEvent TelemetryConfigToBitmask(NSArray<NSString*>* telemetry) {
   TelemetryEvent mask = TelemetryEvent::kNone;
 
@@ -81,43 +100,16 @@ TelemetryEvent TelemetryConfigToBitmask(NSArray<NSString*>* telemetry) {
   return mask;
 }
 
-TelemetryEvent ESEventToTelemetryEvent(es_event_type_t event) {
-  switch (event) {
-    case ES_EVENT_TYPE_NOTIFY_CLONE: return TelemetryEvent::kClone;
-    case ES_EVENT_TYPE_NOTIFY_CLOSE: return TelemetryEvent::kClose;
-    case ES_EVENT_TYPE_NOTIFY_COPYFILE: return TelemetryEvent::kCopyfile;
-    case ES_EVENT_TYPE_NOTIFY_CS_INVALIDATED: return TelemetryEvent::kCodesigningInvalidated;
-    case ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA: return TelemetryEvent::kExchangeData;
-    case ES_EVENT_TYPE_NOTIFY_EXEC: return TelemetryEvent::kExecution;
-    case ES_EVENT_TYPE_NOTIFY_EXIT: return TelemetryEvent::kExit;
-    case ES_EVENT_TYPE_NOTIFY_FORK: return TelemetryEvent::kFork;
-    case ES_EVENT_TYPE_NOTIFY_LINK: return TelemetryEvent::kLink;
-    case ES_EVENT_TYPE_NOTIFY_RENAME: return TelemetryEvent::kRename;
-    case ES_EVENT_TYPE_NOTIFY_UNLINK: return TelemetryEvent::kUnlink;
-    case ES_EVENT_TYPE_NOTIFY_AUTHENTICATION: return TelemetryEvent::kAuthentication;
-    case ES_EVENT_TYPE_NOTIFY_LOGIN_LOGIN: return TelemetryEvent::kLoginLogout;
-    case ES_EVENT_TYPE_NOTIFY_LOGIN_LOGOUT: return TelemetryEvent::kLoginLogout;
-    case ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOGIN: return TelemetryEvent::kLoginWindowSession;
-    case ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOGOUT: return TelemetryEvent::kLoginWindowSession;
-    case ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOCK: return TelemetryEvent::kLoginWindowSession;
-    case ES_EVENT_TYPE_NOTIFY_LW_SESSION_UNLOCK: return TelemetryEvent::kLoginWindowSession;
-    case ES_EVENT_TYPE_NOTIFY_SCREENSHARING_ATTACH: return TelemetryEvent::kScreenSharing;
-    case ES_EVENT_TYPE_NOTIFY_SCREENSHARING_DETACH: return TelemetryEvent::kScreenSharing;
-    case ES_EVENT_TYPE_NOTIFY_OPENSSH_LOGIN: return TelemetryEvent::kOpenSSH;
-    case ES_EVENT_TYPE_NOTIFY_OPENSSH_LOGOUT: return TelemetryEvent::kOpenSSH;
-    case ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_ADD: return TelemetryEvent::kLaunchItem;
-    case ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_REMOVE: return TelemetryEvent::kLaunchItem;
-    case ES_EVENT_TYPE_NOTIFY_XP_MALWARE_DETECTED: return TelemetryEvent::kXProtect;
-    case ES_EVENT_TYPE_NOTIFY_XP_MALWARE_REMEDIATED: return TelemetryEvent::kXProtect;
-#if HAVE_MACOS_15
-    case ES_EVENT_TYPE_NOTIFY_GATEKEEPER_USER_OVERRIDE: return TelemetryEvent::kGatekeeperOverride;
-#endif  // HAVE_MACOS_15
-#if HAVE_MACOS_15_4
-    case ES_EVENT_TYPE_NOTIFY_TCC_MODIFY: return TelemetryEvent::kTCCModification;
-#endif  // HAVE_MACOS_15_4
-    case ES_EVENT_TYPE_NOTIFY_PROC_SUSPEND_RESUME: return TelemetryEvent::kProcSuspendResume;
-    default: return TelemetryEvent::kNone;
+std::set<es_event_type_t> ESEventsForTelemetryMask(const std::set<es_event_type_t>& events,
+                                                   TelemetryEvent mask) {
+  std::set<es_event_type_t> enabled;
+  for (es_event_type_t event : events) {
+    TelemetryEvent telemetry_event = ESEventToTelemetryEvent(event);
+    if ((telemetry_event & mask) == telemetry_event) {
+      enabled.insert(event);
+    }
   }
+  return enabled;
 }
 
 }  // namespace santa
@@ -19,10 +19,12 @@
 #import <XCTest/XCTest.h>
 
 #include <map>
+#include <set>
 #include <string_view>
 
 #include "Source/common/Platform.h"
 
+using santa::ESEventsForTelemetryMask;
 using santa::ESEventToTelemetryEvent;
 using santa::TelemetryConfigToBitmask;
 using santa::TelemetryEvent;
@@ -134,6 +136,36 @@ using santa::TelemetryEvent;
 
     XCTAssertEqual(ESEventToTelemetryEvent((es_event_type_t)event), wantTelemetryEvent);
   }
+  // Out of range event types map to nothing
+  XCTAssertEqual(ESEventToTelemetryEvent(ES_EVENT_TYPE_LAST), TelemetryEvent::kNone);
+
+  // The table is usable in constant expressions
+  static_assert(ESEventToTelemetryEvent(ES_EVENT_TYPE_NOTIFY_EXEC) == TelemetryEvent::kExecution);
+}
+
+- (void)testESEventsForTelemetryMask {
+  std::set<es_event_type_t> events = {
+      ES_EVENT_TYPE_NOTIFY_EXEC,
+      ES_EVENT_TYPE_NOTIFY_LOGIN_LOGIN,
+      ES_EVENT_TYPE_NOTIFY_LOGIN_LOGOUT,
+      ES_EVENT_TYPE_NOTIFY_UNLINK,
+      // No TelemetryEvent, always included
+      ES_EVENT_TYPE_AUTH_OPEN,
+  };
+
+  XCTAssertTrue(ESEventsForTelemetryMask(events, TelemetryEvent::kEverything) == events);
+
+  std::set<es_event_type_t> want = {ES_EVENT_TYPE_AUTH_OPEN};
+  XCTAssertTrue(ESEventsForTelemetryMask(events, TelemetryEvent::kNone) == want);
+
+  want = {
+      ES_EVENT_TYPE_AUTH_OPEN,
+      ES_EVENT_TYPE_NOTIFY_LOGIN_LOGIN,
+      ES_EVENT_TYPE_NOTIFY_LOGIN_LOGOUT,
+      ES_EVENT_TYPE_NOTIFY_UNLINK,
+  };
+  XCTAssertTrue(ESEventsForTelemetryMask(
+                    events, TelemetryEvent::kLoginLogout | TelemetryEvent::kUnlink) == want);
 }
 
 @end
@@ -20,9 +20,12 @@
 #include <sys/qos.h>
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <string>
 
 #import "Source/common/SNTLogging.h"
+#include "Source/common/TimerWheel.h"
 
 namespace santa {
 
@@ -33,6 +36,10 @@ namespace santa {
 // NB: This class is thread safe. Public methods use dispatch_queue_set_specific to detect
 // reentrant calls from the timer queue (e.g. destructor triggered from callback, or
 // OnTimer calling back into public methods) and avoid deadlocking on dispatch_sync.
+//
+// Timers are scheduled on the shared TimerWheel so that the periodic work of every timer in
+// the process is batched into as few wakeups as possible. Each timer may fire up to
+// `leeway_percent` of its interval late.
 template <typename T>
 class Timer : public std::enable_shared_from_this<Timer<T>> {
  public:
@@ -50,16 +57,20 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
     kWaitOneCycle,
   };
 
+  static constexpr uint32_t kDefaultLeewayPercent = 10;
+
   Timer(uint32_t minimum_interval, uint32_t maximum_interval, OnStart startup_option,
         std::string backing_config_var,
         RescheduleMode reschedule_mode = RescheduleMode::kLeadingEdge,
-        dispatch_qos_class_t qos_class = QOS_CLASS_UTILITY)
+        dispatch_qos_class_t qos_class = QOS_CLASS_UTILITY,
+        uint32_t leeway_percent = kDefaultLeewayPercent)
       : interval_seconds_(minimum_interval),
         minimum_interval_(minimum_interval),
         maximum_interval_(maximum_interval),
         startup_option_(startup_option),
         backing_config_var_(std::move(backing_config_var)),
-        reschedule_mode_(reschedule_mode) {
+        reschedule_mode_(reschedule_mode),
+        leeway_percent_(std::min(leeway_percent, 100u)) {
     static_assert(
         requires(T t) {
           { t.OnTimer() } -> std::same_as<bool>;
@@ -141,11 +152,11 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
 
   bool IsStarted() const {
     if (OnTimerQueue()) {
-      return timer_source_ != nullptr;
+      return timer_id_ != 0;
     }
     __block bool is_started;
     dispatch_sync(timer_queue_, ^{
-      is_started = (timer_source_ != nullptr);
+      is_started = (timer_id_ != 0);
     });
     return is_started;
   }
@@ -163,6 +174,9 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
     return std::weak_ptr<U>(std::static_pointer_cast<U>(this->shared_from_this()));
   }
 
+  // The queue OnTimer is called on
+  dispatch_queue_t TimerQueue() const { return timer_queue_; }
+
   // Like SetTimerInterval, but doesn't clamp to min/max
   // This is a protected interface that is exposed for testing.
   void ForceSetIntervalForTestingUnsafe(uint32_t interval_seconds) {
@@ -174,24 +188,42 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
   inline bool StartTimerSerialized() { return StartTimerSerialized(startup_option_); }
 
   bool StartTimerSerialized(OnStart on_start) {
-    if (timer_source_) {
+    if (timer_id_) {
       return false;  // No-op if already running
     }
 
-    timer_source_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, timer_queue_);
+    ScheduleSerialized(on_start);
+    return true;
+  }
 
+  void ScheduleSerialized(OnStart on_start) {
+    // Callbacks from a schedule that has since been replaced or stopped are ignored
+    uint64_t generation = ++generation_;
     std::weak_ptr<Timer<T>> weak_self = this->shared_from_this();
-    dispatch_source_set_event_handler(timer_source_, ^{
-      if (auto strong_self = weak_self.lock()) {
-        strong_self->TimerCallback();
-      }
-    });
-
-    UpdateTimingParametersSerialized(on_start);
-
-    dispatch_resume(timer_source_);
-
-    return true;
+    dispatch_queue_t timer_queue = timer_queue_;
+    std::shared_ptr<std::atomic_bool> callback_pending = callback_pending_;
+
+    uint64_t interval_nanos = interval_seconds_ * NSEC_PER_SEC;
+    uint64_t delay_nanos = (on_start == OnStart::kFireImmediately) ? 0 : interval_nanos;
+    // For trailing edge scheduling, set up a one-time timer
+    uint64_t repeat_nanos =
+        (reschedule_mode_ == RescheduleMode::kTrailingEdge) ? 0 : interval_nanos;
+
+    timer_id_ = TimerWheel::Shared().Schedule(
+        delay_nanos, repeat_nanos, interval_nanos / 100 * leeway_percent_, ^{
+          // Called on the wheel's queue. Like a dispatch timer source, fires that happen while
+          // a callback is still waiting to run are coalesced into it.
+          if (callback_pending->exchange(true)) {
+            return;
+          }
+          dispatch_async(timer_queue, ^{
+            callback_pending->store(false);
+            auto strong_self = weak_self.lock();
+            if (strong_self && strong_self->generation_ == generation) {
+              strong_self->TimerCallback();
+            }
+          });
+        });
   }
 
   /// Update the timer firing settings.
@@ -199,25 +231,12 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
   /// Otherwise, the startup delay is based on `startup_option_` to determine if
   /// the timer should fire immediately or wait a full cycle first.
   void UpdateTimingParametersSerialized(OnStart on_start) {
-    if (!timer_source_) {
+    if (!timer_id_) {
       return;
     }
 
-    dispatch_time_t start_time;
-
-    if (on_start == OnStart::kFireImmediately) {
-      start_time = dispatch_time(DISPATCH_WALLTIME_NOW, 0);
-    } else {
-      start_time = dispatch_time(DISPATCH_WALLTIME_NOW, interval_seconds_ * NSEC_PER_SEC);
-    }
-
-    if (reschedule_mode_ == RescheduleMode::kTrailingEdge) {
-      // For trailing edge scheduling, set up a one-time timer
-      dispatch_source_set_timer(timer_source_, start_time, DISPATCH_TIME_FOREVER, 0);
-    } else {
-      // For leading edge scheduling, set up repeating timer
-      dispatch_source_set_timer(timer_source_, start_time, interval_seconds_ * NSEC_PER_SEC, 0);
-    }
+    TimerWheel::Shared().Cancel(timer_id_);
+    ScheduleSerialized(on_start);
   }
 
   void SetTimerIntervalSerialized(uint32_t interval_seconds) {
@@ -232,11 +251,12 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
 
   inline bool OnTimerQueue() const { return dispatch_get_specific(&queue_key_) == &queue_key_; }
 
-  /// Cancels the dispatch timer source.
+  /// Cancels the timer.
   inline bool StopTimerSerialized() {
-    if (timer_source_) {
-      dispatch_source_cancel(timer_source_);
-      timer_source_ = nullptr;
+    if (timer_id_) {
+      TimerWheel::Shared().Cancel(timer_id_);
+      timer_id_ = 0;
+      generation_++;
       return true;
     } else {
       return false;
@@ -244,13 +264,16 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
   }
 
   dispatch_queue_t timer_queue_{nullptr};
-  dispatch_source_t timer_source_{nullptr};
+  TimerWheel::TimerId timer_id_{0};
+  uint64_t generation_{0};
+  std::shared_ptr<std::atomic_bool> callback_pending_{std::make_shared<std::atomic_bool>(false)};
   uint32_t interval_seconds_;
   uint32_t minimum_interval_;
   uint32_t maximum_interval_;
   OnStart startup_option_;
   std::string backing_config_var_;
   RescheduleMode reschedule_mode_;
+  uint32_t leeway_percent_;
   char queue_key_;
 };
 
@@ -0,0 +1,123 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_TIMERWHEEL_H
+#define SANTA_COMMON_TIMERWHEEL_H
+
+#include <dispatch/dispatch.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// A hierarchical timer wheel driven by a single dispatch timer, so that the
+// periodic work of many timers is batched into as few wakeups as possible.
+//
+// Each timer has a leeway and may fire up to that long after its deadline.
+// The wheel wakes at the latest time that is still within every pending
+// timer's leeway and fires all timers whose deadlines have passed together.
+class TimerWheel {
+ public:
+  using TimerId = uint64_t;
+  using Callback = void (^)(void);
+
+  // Wheel resolution. Deadlines are rounded up to a whole tick.
+  static constexpr uint64_t kTickNanos = 100 * NSEC_PER_MSEC;
+
+  struct Stats {
+    uint64_t wakeups = 0;
+    uint64_t fired = 0;
+  };
+
+  static TimerWheel& Shared();
+
+  TimerWheel();
+  ~TimerWheel();
+
+  TimerWheel(TimerWheel&& other) = delete;
+  TimerWheel& operator=(TimerWheel&& rhs) = delete;
+  TimerWheel(const TimerWheel& other) = delete;
+  TimerWheel& operator=(const TimerWheel& other) = delete;
+
+  // Call `callback` once `delay_nanos` have passed and, if `interval_nanos`
+  // is non-zero, every `interval_nanos` after that until cancelled. It may
+  // be called up to `leeway_nanos` late. Callbacks are called on the wheel's
+  // queue and must not block; typically they dispatch to another queue.
+  TimerId Schedule(uint64_t delay_nanos, uint64_t interval_nanos,
+                   uint64_t leeway_nanos, Callback callback);
+
+  // Stop calling the timer's callback. A callback already being called may
+  // still finish.
+  void Cancel(TimerId id);
+
+  // Counts since the last reset
+  Stats GetStats(bool reset);
+
+ private:
+  static constexpr int kSlotBits = 6;
+  static constexpr uint64_t kSlots = 1 << kSlotBits;
+  static constexpr uint64_t kSlotMask = kSlots - 1;
+  static constexpr int kLevels = 4;
+
+  struct Entry {
+    uint64_t deadline_tick;
+    uint64_t interval_nanos;
+    uint64_t leeway_nanos;
+    Callback callback;
+  };
+
+  static uint64_t NowNanos();
+  static uint64_t TickForNanos(uint64_t nanos);
+
+  void OnWakeup();
+
+  // Place `id` in the slot for its deadline, or in `expired` if the deadline
+  // has already passed
+  void InsertLocked(TimerId id, const Entry& entry,
+                    std::vector<TimerId>& expired)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Move the wheel forward to `tick`, collecting every timer that expired
+  void AdvanceLocked(uint64_t tick, std::vector<TimerId>& expired)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void CascadeLocked(int level, uint64_t slot, std::vector<TimerId>& expired)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void ArmLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  dispatch_queue_t q_;
+  dispatch_source_t source_;
+
+  absl::Mutex lock_;
+  TimerId next_id_ ABSL_GUARDED_BY(lock_) = 1;
+  // The last tick processed
+  uint64_t current_tick_ ABSL_GUARDED_BY(lock_);
+  absl::flat_hash_map<TimerId, Entry> entries_ ABSL_GUARDED_BY(lock_);
+  // Cancelled ids are only removed from `entries_` and are skipped when
+  // their slot is processed
+  std::array<std::array<std::vector<TimerId>, kSlots>, kLevels> slots_
+      ABSL_GUARDED_BY(lock_);
+  // The time the dispatch timer is armed for, or 0 if it isn't
+  uint64_t armed_nanos_ ABSL_GUARDED_BY(lock_) = 0;
+  Stats stats_ ABSL_GUARDED_BY(lock_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_TIMERWHEEL_H
@@ -0,0 +1,244 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/TimerWheel.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace santa {
+
+TimerWheel& TimerWheel::Shared() {
+  static TimerWheel* shared = new TimerWheel();
+  return *shared;
+}
+
+uint64_t TimerWheel::NowNanos() {
+  // Unlike CLOCK_UPTIME_RAW, this keeps counting while the machine sleeps
+  return clock_gettime_nsec_np(CLOCK_MONOTONIC);
+}
+
+uint64_t TimerWheel::TickForNanos(uint64_t nanos) {
+  return (nanos + kTickNanos - 1) / kTickNanos;
+}
+
+TimerWheel::TimerWheel()
+    : q_(dispatch_queue_create(
+          "com.northpolesec.santa.timer_wheel",
+          dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0))),
+      current_tick_(NowNanos() / kTickNanos) {
+  source_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q_);
+  dispatch_source_set_event_handler(source_, ^{
+    OnWakeup();
+  });
+  dispatch_source_set_timer(source_, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+  dispatch_resume(source_);
+}
+
+TimerWheel::~TimerWheel() {
+  dispatch_source_cancel(source_);
+  // Wait for a wakeup already in progress to finish
+  dispatch_sync(q_, ^{
+                });
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(uint64_t delay_nanos, uint64_t interval_nanos,
+                                         uint64_t leeway_nanos, Callback callback) {
+  Entry entry{
+      .deadline_tick = TickForNanos(NowNanos() + delay_nanos),
+      .interval_nanos = interval_nanos,
+      .leeway_nanos = leeway_nanos,
+      .callback = [callback copy],
+  };
+
+  absl::MutexLock lock(lock_);
+  // Ticks up to current_tick_ have already been processed
+  entry.deadline_tick = std::max(entry.deadline_tick, current_tick_ + 1);
+
+  TimerId id = next_id_++;
+  std::vector<TimerId> expired;
+  InsertLocked(id, entry, expired);
+  entries_.emplace(id, std::move(entry));
+  ArmLocked();
+  return id;
+}
+
+void TimerWheel::Cancel(TimerId id) {
+  absl::MutexLock lock(lock_);
+  if (entries_.erase(id) > 0) {
+    ArmLocked();
+  }
+}
+
+TimerWheel::Stats TimerWheel::GetStats(bool reset) {
+  absl::MutexLock lock(lock_);
+  Stats stats = stats_;
+  if (reset) {
+    stats_ = Stats{};
+  }
+  return stats;
+}
+
+void TimerWheel::OnWakeup() {
+  std::vector<Callback> callbacks;
+  {
+    absl::MutexLock lock(lock_);
+    armed_nanos_ = 0;
+    stats_.wakeups++;
+
+    uint64_t now = NowNanos();
+    std::vector<TimerId> expired;
+    AdvanceLocked(now / kTickNanos, expired);
+
+    for (TimerId id : expired) {
+      auto it = entries_.find(id);
+      if (it == entries_.end()) {
+        continue;
+      }
+
+      Entry& entry = it->second;
+      callbacks.push_back(entry.callback);
+      if (entry.interval_nanos == 0) {
+        entries_.erase(it);
+        continue;
+      }
+
+      // Keep the timer's phase, skipping any intervals that were missed
+      // entirely, e.g. while the machine was asleep
+      uint64_t next = entry.deadline_tick * kTickNanos + entry.interval_nanos;
+      if (next <= now) {
+        next += ((now - next) / entry.interval_nanos + 1) * entry.interval_nanos;
+      }
+      entry.deadline_tick = TickForNanos(next);
+
+      std::vector<TimerId> unused;
+      InsertLocked(id, entry, unused);
+    }
+
+    stats_.fired += callbacks.size();
+    ArmLocked();
+  }
+
+  for (Callback callback : callbacks) {
+    callback();
+  }
+}
+
+void TimerWheel::InsertLocked(TimerId id, const Entry& entry, std::vector<TimerId>& expired) {
+  uint64_t deadline = entry.deadline_tick;
+  if (deadline <= current_tick_) {
+    expired.push_back(id);
+    return;
+  }
+
+  // Use the finest level whose slots still distinguish the deadline from
+  // the current tick
+  for (int level = 0; level < kLevels; level++) {
+    int shift = kSlotBits * level;
+    if ((deadline >> shift) - (current_tick_ >> shift) < kSlots) {
+      slots_[level][(deadline >> shift) & kSlotMask].push_back(id);
+      return;
+    }
+  }
+
+  // Beyond the wheel's range. Park the timer in the furthest slot, it is
+  // placed again when that slot cascades.
+  int shift = kSlotBits * (kLevels - 1);
+  slots_[kLevels - 1][((current_tick_ >> shift) + kSlots - 1) & kSlotMask].push_back(id);
+}
+
+void TimerWheel::AdvanceLocked(uint64_t tick, std::vector<TimerId>& expired) {
+  if (tick <= current_tick_) {
+    return;
+  }
+
+  // After a long gap, e.g. the machine sleeping, placing every timer again
+  // is cheaper than walking each tick that passed
+  if (tick - current_tick_ > kSlots) {
+    for (auto& level : slots_) {
+      for (auto& slot : level) {
+        slot.clear();
+      }
+    }
+    current_tick_ = tick;
+    for (const auto& [id, entry] : entries_) {
+      InsertLocked(id, entry, expired);
+    }
+    return;
+  }
+
+  while (current_tick_ < tick) {
+    current_tick_++;
+
+    // Coarser levels first, they may cascade into finer slots that are due
+    for (int level = kLevels - 1; level > 0; level--) {
+      int shift = kSlotBits * level;
+      if ((current_tick_ & ((1ull << shift) - 1)) == 0) {
+        CascadeLocked(level, (current_tick_ >> shift) & kSlotMask, expired);
+      }
+    }
+
+    std::vector<TimerId> due;
+    std::swap(due, slots_[0][current_tick_ & kSlotMask]);
+    for (TimerId id : due) {
+      auto it = entries_.find(id);
+      if (it != entries_.end()) {
+        InsertLocked(id, it->second, expired);
+      }
+    }
+  }
+}
+
+void TimerWheel::CascadeLocked(int level, uint64_t slot, std::vector<TimerId>& expired) {
+  std::vector<TimerId> ids;
+  std::swap(ids, slots_[level][slot]);
+  for (TimerId id : ids) {
+    auto it = entries_.find(id);
+    if (it != entries_.end()) {
+      InsertLocked(id, it->second, expired);
+    }
+  }
+}
+
+void TimerWheel::ArmLocked() {
+  if (entries_.empty()) {
+    if (armed_nanos_ != 0) {
+      dispatch_source_set_timer(source_, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+      armed_nanos_ = 0;
+    }
+    return;
+  }
+
+  // Waking at the earliest point any timer's leeway runs out lets every
+  // other timer due by then fire in the same wakeup
+  uint64_t wake = std::numeric_limits<uint64_t>::max();
+  for (const auto& [id, entry] : entries_) {
+    wake = std::min(wake, entry.deadline_tick * kTickNanos + entry.leeway_nanos);
+  }
+  if (wake == armed_nanos_) {
+    return;
+  }
+
+  armed_nanos_ = wake;
+  uint64_t now = NowNanos();
+  uint64_t delay = wake > now ? wake - now : 0;
+  dispatch_source_set_timer(source_, dispatch_time(DISPATCH_WALLTIME_NOW, delay),
+                            DISPATCH_TIME_FOREVER, kTickNanos);
+}
+
+}  // namespace santa
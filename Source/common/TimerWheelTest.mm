@@ -0,0 +1,105 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/TimerWheel.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <memory>
+
+using santa::TimerWheel;
+
+@interface TimerWheelTest : XCTestCase
+@end
+
+@implementation TimerWheelTest
+
+- (void)testOneShot {
+  TimerWheel sut;
+  XCTestExpectation* fired = [self expectationWithDescription:@"Timer fired"];
+  sut.Schedule(200 * NSEC_PER_MSEC, 0, 0, ^{
+    [fired fulfill];
+  });
+  [self waitForExpectations:@[ fired ] timeout:5];
+
+  XCTAssertEqual(sut.GetStats(false).fired, 1);
+}
+
+- (void)testPeriodicUntilCancelled {
+  TimerWheel sut;
+  auto count = std::make_shared<std::atomic<int>>(0);
+  XCTestExpectation* fired = [self expectationWithDescription:@"Timer fired repeatedly"];
+  fired.expectedFulfillmentCount = 3;
+  fired.assertForOverFulfill = NO;
+
+  TimerWheel::TimerId id = sut.Schedule(0, 200 * NSEC_PER_MSEC, 0, ^{
+    (*count)++;
+    [fired fulfill];
+  });
+  [self waitForExpectations:@[ fired ] timeout:5];
+
+  sut.Cancel(id);
+  int seen = count->load();
+  [NSThread sleepForTimeInterval:0.5];
+  XCTAssertEqual(count->load(), seen);
+}
+
+- (void)testCancelledTimerDoesNotFire {
+  TimerWheel sut;
+  auto count = std::make_shared<std::atomic<int>>(0);
+  TimerWheel::TimerId id = sut.Schedule(100 * NSEC_PER_MSEC, 0, 0, ^{
+    (*count)++;
+  });
+  sut.Cancel(id);
+
+  [NSThread sleepForTimeInterval:0.4];
+  XCTAssertEqual(count->load(), 0);
+}
+
+- (void)testTimersWithinLeewayShareAWakeup {
+  TimerWheel sut;
+  XCTestExpectation* fired = [self expectationWithDescription:@"Timers fired"];
+  fired.expectedFulfillmentCount = 2;
+
+  // The first timer can wait long enough for the second to be due too
+  sut.Schedule(100 * NSEC_PER_MSEC, 0, 1 * NSEC_PER_SEC, ^{
+    [fired fulfill];
+  });
+  sut.Schedule(500 * NSEC_PER_MSEC, 0, 1 * NSEC_PER_SEC, ^{
+    [fired fulfill];
+  });
+  [self waitForExpectations:@[ fired ] timeout:5];
+
+  TimerWheel::Stats stats = sut.GetStats(true);
+  XCTAssertEqual(stats.fired, 2);
+  XCTAssertEqual(stats.wakeups, 1);
+  XCTAssertEqual(sut.GetStats(false).wakeups, 0);
+}
+
+- (void)testFarFutureTimersCanBeCancelled {
+  TimerWheel sut;
+  // Beyond the range of the finest levels and of the wheel itself
+  TimerWheel::TimerId hour = sut.Schedule(3600 * NSEC_PER_SEC, 0, 0, ^{
+  });
+  TimerWheel::TimerId year = sut.Schedule(365 * 86400 * NSEC_PER_SEC, 0, 0, ^{
+  });
+  sut.Cancel(hour);
+  sut.Cancel(year);
+  XCTAssertEqual(sut.GetStats(false).wakeups, 0);
+}
+
+@end
@@ -15,7 +15,11 @@
 #ifndef SANTA_COMMON_CEL_ACTIVATION_H
 #define SANTA_COMMON_CEL_ACTIVATION_H
 
+#include <array>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <optional>
 #include <type_traits>
 #include <vector>
 
@@ -36,8 +40,26 @@
 namespace santa {
 namespace cel {
 
+// Bits for the attributes of an exec that can differ between executions of
+// the same file. The target and the return value constants are the same for
+// every execution of a file so have no bit.
+using ExecAttributes = uint32_t;
+constexpr ExecAttributes kExecAttributeArgs = 1 << 0;
+constexpr ExecAttributes kExecAttributeEnvs = 1 << 1;
+constexpr ExecAttributes kExecAttributeEuid = 1 << 2;
+constexpr ExecAttributes kExecAttributeCwd = 1 << 3;
+constexpr ExecAttributes kExecAttributePath = 1 << 4;
+constexpr ExecAttributes kExecAttributeAncestors = 1 << 5;
+constexpr ExecAttributes kExecAttributeFds = 1 << 6;
+// Set for any variable that isn't recognized, so it must be assumed to vary.
+constexpr ExecAttributes kExecAttributeUnknown = 1u << 31;
+
 // SantaActivation is a CEL activation that provides lookups of values from the
 // ExecutionContext message, and easy access to variables for return values.
+//
+// Every attribute is computed the first time an expression reads it and the
+// converted CEL value is kept for the lifetime of the activation, so several
+// expressions evaluated against the same activation share the work.
 template <bool IsV2>
 class Activation : public ::google::api::expr::runtime::BaseActivation {
  public:
@@ -47,11 +69,26 @@ class Activation : public ::google::api::expr::runtime::BaseActivation {
   using AncestorT = typename Traits::AncestorT;
   using FileDescriptorT = typename Traits::FileDescriptorT;
 
+  Activation(std::unique_ptr<ExecutableFileT> (^file)(), std::vector<std::string> (^args)(),
+             std::map<std::string, std::string> (^envs)(), uid_t (^euid)(), std::string (^cwd)(),
+             std::string (^path)(), std::vector<AncestorT> (^ancestors)(),
+             std::vector<FileDescriptorT> (^fds)())
+      : file_([file]() -> std::shared_ptr<const ExecutableFileT> { return file(); }),
+        args_(args),
+        envs_(envs),
+        euid_(euid),
+        cwd_(cwd),
+        path_(path),
+        ancestors_(ancestors),
+        fds_(fds) {};
+
   Activation(std::unique_ptr<ExecutableFileT> file, std::vector<std::string> (^args)(),
              std::map<std::string, std::string> (^envs)(), uid_t (^euid)(), std::string (^cwd)(),
              std::string (^path)(), std::vector<AncestorT> (^ancestors)(),
              std::vector<FileDescriptorT> (^fds)())
-      : file_(std::move(file)),
+      : file_([shared = std::shared_ptr<const ExecutableFileT>(std::move(file))]() {
+          return shared;
+        }),
         args_(args),
         envs_(envs),
         euid_(euid),
@@ -61,6 +98,9 @@ class Activation : public ::google::api::expr::runtime::BaseActivation {
         fds_(fds) {};
   ~Activation() = default;
 
+  Activation(const Activation&) = delete;
+  Activation& operator=(const Activation&) = delete;
+
   std::optional<::google::api::expr::runtime::CelValue> FindValue(
       absl::string_view name, google::protobuf::Arena* arena) const override;
 
@@ -73,11 +113,34 @@ class Activation : public ::google::api::expr::runtime::BaseActivation {
   static std::vector<std::pair<absl::string_view, ::cel::Type>> GetVariables(
       google::protobuf::Arena* arena);
 
+  // Bytes allocated for the converted values of attributes read so far.
+  uint64_t ValuesSpaceUsed() const { return values_arena_.SpaceUsed(); }
+
+  // Return the per-exec attribute read by the variable `name`, if any.
+  static ExecAttributes AttributesForVariable(absl::string_view name);
+
   template <bool V2>
   friend class Evaluator;
 
  private:
-  std::unique_ptr<ExecutableFileT> file_;
+  enum class Attribute {
+    kTarget = 0,
+    kArgs,
+    kEnvs,
+    kEuid,
+    kCwd,
+    kPath,
+    kAncestors,
+    kFds,
+    kNumAttributes,
+  };
+
+  // Return the converted value of `attr`, calling `convert` with the
+  // activation's own arena the first time it is requested.
+  template <typename F>
+  ::google::api::expr::runtime::CelValue CachedValue(Attribute attr, F convert) const;
+
+  Memoizer<std::shared_ptr<const ExecutableFileT>> file_;
   Memoizer<std::vector<std::string>> args_;
   Memoizer<std::map<std::string, std::string>> envs_;
   Memoizer<uid_t> euid_;
@@ -86,6 +149,13 @@ class Activation : public ::google::api::expr::runtime::BaseActivation {
   Memoizer<std::vector<AncestorT>> ancestors_;
   Memoizer<std::vector<FileDescriptorT>> fds_;
 
+  // Converted values are allocated on values_arena_ rather than the
+  // evaluation arena so that they stay valid across evaluations.
+  mutable google::protobuf::Arena values_arena_;
+  mutable std::array<std::optional<::google::api::expr::runtime::CelValue>,
+                     static_cast<size_t>(Attribute::kNumAttributes)>
+      values_;
+
   bool IsResultCacheable() const;
 
   static ::cel::Type CELType(google::protobuf::FieldDescriptor::CppType type,
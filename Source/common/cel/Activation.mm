@@ -119,6 +119,16 @@ cel_runtime::CelValue Activation<IsV2>::CELValue(const std::map<K, V>& v,
   return CreateCELValue(v, arena);
 }
 
+template <bool IsV2>
+template <typename F>
+cel_runtime::CelValue Activation<IsV2>::CachedValue(Attribute attr, F convert) const {
+  std::optional<cel_runtime::CelValue>& value = values_[static_cast<size_t>(attr)];
+  if (!value.has_value()) {
+    value = convert(&values_arena_);
+  }
+  return *value;
+}
+
 template <bool IsV2>
 std::optional<cel_runtime::CelValue> Activation<IsV2>::FindValue(
     absl::string_view name, google::protobuf::Arena* arena) const {
@@ -147,44 +157,52 @@ std::optional<cel_runtime::CelValue> Activation<IsV2>::FindValue(
   }
 
   // Handle the fields from the CELContext message.
-  if (name == "target" && file_ != nullptr) {
-    return cel_runtime::CelProtoWrapper::CreateMessage(file_.get(), arena);
+  if (name == "target") {
+    if (file_() == nullptr) {
+      return {};
+    }
+    return CachedValue(Attribute::kTarget, [this](google::protobuf::Arena* a) {
+      return cel_runtime::CelProtoWrapper::CreateMessage(file_().get(), a);
+    });
   } else if (name == "args") {
-    return CELValue(args_(), arena);
+    return CachedValue(Attribute::kArgs,
+                       [this](google::protobuf::Arena* a) { return CELValue(args_(), a); });
   } else if (name == "envs") {
-    return CELValue(envs_(), arena);
+    return CachedValue(Attribute::kEnvs,
+                       [this](google::protobuf::Arena* a) { return CELValue(envs_(), a); });
   } else if (name == "euid") {
-    return CELValue(euid_(), arena);
+    return CachedValue(Attribute::kEuid,
+                       [this](google::protobuf::Arena* a) { return CELValue(euid_(), a); });
   } else if (name == "cwd") {
-    return CELValue(cwd_(), arena);
+    return CachedValue(Attribute::kCwd,
+                       [this](google::protobuf::Arena* a) { return CELValue(cwd_(), a); });
   } else if (name == "path") {
-    return CELValue(path_(), arena);
+    return CachedValue(Attribute::kPath,
+                       [this](google::protobuf::Arena* a) { return CELValue(path_(), a); });
   }
 
   // Handle the V2 specific fields
   if constexpr (IsV2) {
     if (name == "ancestors") {
-      // Convert ancestors to CEL list of proto messages
-      std::vector<cel_runtime::CelValue> ancestorValues;
-      for (const auto& ancestor : ancestors_()) {
-        // Create a copy of the proto on the arena and wrap it
-        auto* proto = arena->Create<AncestorT>(arena);
-        proto->CopyFrom(ancestor);
-        ancestorValues.push_back(cel_runtime::CelProtoWrapper::CreateMessage(proto, arena));
-      }
-      return cel_runtime::CelValue::CreateList(
-          arena->Create<cel_runtime::ContainerBackedListImpl>(arena, ancestorValues));
+      return CachedValue(Attribute::kAncestors, [this](google::protobuf::Arena* a) {
+        // Convert ancestors to CEL list of proto messages
+        std::vector<cel_runtime::CelValue> ancestorValues;
+        for (const auto& ancestor : ancestors_()) {
+          ancestorValues.push_back(cel_runtime::CelProtoWrapper::CreateMessage(&ancestor, a));
+        }
+        return cel_runtime::CelValue::CreateList(
+            a->Create<cel_runtime::ContainerBackedListImpl>(a, ancestorValues));
+      });
     }
     if (name == "fds") {
-      using FileDescriptorT = typename Traits::FileDescriptorT;
-      std::vector<cel_runtime::CelValue> fdValues;
-      for (const auto& fd : fds_()) {
-        auto* proto = arena->Create<FileDescriptorT>(arena);
-        proto->CopyFrom(fd);
-        fdValues.push_back(cel_runtime::CelProtoWrapper::CreateMessage(proto, arena));
-      }
-      return cel_runtime::CelValue::CreateList(
-          arena->Create<cel_runtime::ContainerBackedListImpl>(arena, fdValues));
+      return CachedValue(Attribute::kFds, [this](google::protobuf::Arena* a) {
+        std::vector<cel_runtime::CelValue> fdValues;
+        for (const auto& fd : fds_()) {
+          fdValues.push_back(cel_runtime::CelProtoWrapper::CreateMessage(&fd, a));
+        }
+        return cel_runtime::CelValue::CreateList(
+            a->Create<cel_runtime::ContainerBackedListImpl>(a, fdValues));
+      });
     }
   }
   return {};
@@ -247,6 +265,41 @@ std::vector<std::pair<absl::string_view, ::cel::Type>> Activation<IsV2>::GetVari
   return v;
 }
 
+template <bool IsV2>
+ExecAttributes Activation<IsV2>::AttributesForVariable(absl::string_view name) {
+  if (Traits::ReturnValue_descriptor()->FindValueByName(name) != nullptr) {
+    return 0;
+  }
+  if constexpr (IsV2) {
+    if (Traits::FDType_descriptor()->FindValueByName(name) != nullptr) {
+      return 0;
+    }
+  }
+
+  if (name == "target") {
+    return 0;
+  } else if (name == "args") {
+    return kExecAttributeArgs;
+  } else if (name == "envs") {
+    return kExecAttributeEnvs;
+  } else if (name == "euid") {
+    return kExecAttributeEuid;
+  } else if (name == "cwd") {
+    return kExecAttributeCwd;
+  } else if (name == "path") {
+    return kExecAttributePath;
+  }
+
+  if constexpr (IsV2) {
+    if (name == "ancestors") {
+      return kExecAttributeAncestors;
+    } else if (name == "fds") {
+      return kExecAttributeFds;
+    }
+  }
+  return kExecAttributeUnknown;
+}
+
 template <bool IsV2>
 bool Activation<IsV2>::IsResultCacheable() const {
   if (args_.HasValue() || envs_.HasValue() || euid_.HasValue() || cwd_.HasValue() ||
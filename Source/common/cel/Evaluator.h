@@ -77,9 +77,11 @@ class Evaluator {
 
   // Compile a CEL expression from a string into an expression plan
   // ready for evaluation. The caller-provided arena is used for constant
-  // folding and must outlive the returned expression plan.
+  // folding and must outlive the returned expression plan. If `referenced`
+  // is set, it receives every per-exec attribute the expression could read.
   absl::StatusOr<std::unique_ptr<::google::api::expr::runtime::CelExpression>>
-  Compile(absl::string_view cel_expr, google::protobuf::Arena* arena);
+  Compile(absl::string_view cel_expr, google::protobuf::Arena* arena,
+          ExecAttributes* referenced = nullptr);
 
   // Evaluate an expression plan with a SantaActivation object. The
   // caller-provided arena is used for evaluation temporaries.
@@ -92,6 +94,11 @@ class Evaluator {
   absl::StatusOr<EvaluationResultT> CompileAndEvaluate(
       absl::string_view cel_expr, const ActivationT& activation);
 
+  // Bytes allocated by the arena backing the compiler's type information
+  uint64_t ArenaBytes() const {
+    return compiler_arena_ ? compiler_arena_->SpaceAllocated() : 0;
+  }
+
  private:
   std::unique_ptr<::cel::Compiler> compiler_;
   std::unique_ptr<google::protobuf::Arena>
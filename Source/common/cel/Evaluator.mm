@@ -104,7 +104,7 @@ absl::StatusOr<std::unique_ptr<Evaluator<IsV2>>> Evaluator<IsV2>::Create() {
 
 template <bool IsV2>
 absl::StatusOr<std::unique_ptr<::cel_runtime::CelExpression>> Evaluator<IsV2>::Compile(
-    absl::string_view expr, google::protobuf::Arena* arena) {
+    absl::string_view expr, google::protobuf::Arena* arena, ExecAttributes* referenced) {
   if (!compiler_) {
     return absl::InvalidArgumentError("Evaluator not properly initialized");
   }
@@ -124,6 +124,17 @@ absl::StatusOr<std::unique_ptr<::cel_runtime::CelExpression>> Evaluator<IsV2>::C
     return status;
   }
 
+  // Every variable an expression reads is resolved by the checker, whether or
+  // not evaluation ends up reaching it. Function references are skipped.
+  if (referenced) {
+    *referenced = 0;
+    for (const auto& [id, reference] : cel_expr.reference_map()) {
+      if (reference.overload_id_size() == 0 && !reference.name().empty()) {
+        *referenced |= Activation<IsV2>::AttributesForVariable(reference.name());
+      }
+    }
+  }
+
   // Setup a default environment for building expressions.
   cel_runtime::InterpreterOptions options;
   options.constant_folding = true;
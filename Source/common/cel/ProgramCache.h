@@ -0,0 +1,95 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_CEL_PROGRAMCACHE_H
+#define SANTA_COMMON_CEL_PROGRAMCACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "Source/common/SantaCache.h"
+#include "Source/common/cel/Evaluator.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace santa {
+namespace cel {
+
+// A bounded cache of compiled expression plans, keyed by a hash of the
+// expression and whether it was compiled for CEL v2. Each program owns the
+// arena used to compile it, so callers can keep using a program they hold
+// after it has been evicted or the cache has been flushed.
+class ProgramCache {
+ public:
+  struct Program {
+    std::string expr;
+    // Declared before `plan` so that the plan is destroyed first, then the
+    // arena it references.
+    std::unique_ptr<google::protobuf::Arena> arena;
+    std::unique_ptr<::google::api::expr::runtime::CelExpression> plan;
+    // Per-exec attributes the expression could read
+    ExecAttributes referenced = 0;
+  };
+
+  using CompileFunction = std::function<absl::StatusOr<
+      std::unique_ptr<::google::api::expr::runtime::CelExpression>>(
+      absl::string_view, google::protobuf::Arena*, ExecAttributes*)>;
+
+  // Counts and times since the last reset, shared by all caches. Times are
+  // in nanoseconds. `compile_nanos` only includes compilations done on a
+  // miss and `eval_nanos` only includes evaluations reported through
+  // RecordEvaluation.
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evaluations = 0;
+    uint64_t compile_nanos = 0;
+    uint64_t eval_nanos = 0;
+  };
+
+  static constexpr uint64_t kDefaultCapacity = 256;
+
+  explicit ProgramCache(uint64_t capacity = kDefaultCapacity);
+
+  // Return the cached program for `expr`, calling `compile` with a new arena
+  // to create it on a miss. `compile` also records the attributes the
+  // expression references. Failed compilations are not cached.
+  absl::StatusOr<std::shared_ptr<const Program>> GetOrCompile(
+      absl::string_view expr, bool is_v2, const CompileFunction& compile);
+
+  // Drop every cached program, e.g. when rules have been synced.
+  void Flush();
+
+  uint64_t Count() const;
+
+  // Approximate bytes used by the cache, including the arenas and expression
+  // text of the cached programs
+  uint64_t ApproximateBytes();
+
+  static void RecordEvaluation(uint64_t nanos);
+  static Stats GetStats(bool reset);
+
+ private:
+  using Key = std::pair<uint64_t, bool>;
+  SantaCache<Key, std::shared_ptr<const Program>> cache_;
+};
+
+}  // namespace cel
+}  // namespace santa
+
+#endif  // SANTA_COMMON_CEL_PROGRAMCACHE_H
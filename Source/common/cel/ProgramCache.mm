@@ -0,0 +1,114 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/cel/ProgramCache.h"
+
+#include <time.h>
+
+#include <atomic>
+
+#include "absl/hash/hash.h"
+
+namespace santa {
+namespace cel {
+
+namespace {
+
+std::atomic<uint64_t> g_hits{0};
+std::atomic<uint64_t> g_misses{0};
+std::atomic<uint64_t> g_evaluations{0};
+std::atomic<uint64_t> g_compile_nanos{0};
+std::atomic<uint64_t> g_eval_nanos{0};
+
+}  // namespace
+
+ProgramCache::ProgramCache(uint64_t capacity)
+    : cache_(capacity, 4, SantaCacheEvictionPolicy::kClock) {}
+
+absl::StatusOr<std::shared_ptr<const ProgramCache::Program>> ProgramCache::GetOrCompile(
+    absl::string_view expr, bool is_v2, const CompileFunction& compile) {
+  Key key{absl::Hash<absl::string_view>{}(expr), is_v2};
+
+  // The full expression is compared so that a hash collision is treated as a
+  // miss rather than evaluating the wrong program.
+  std::shared_ptr<const Program> program = cache_.get(key);
+  if (program && program->expr == expr) {
+    g_hits.fetch_add(1, std::memory_order_relaxed);
+    return program;
+  }
+  g_misses.fetch_add(1, std::memory_order_relaxed);
+
+  auto compiled = std::make_shared<Program>();
+  compiled->expr = std::string(expr);
+  compiled->arena = std::make_unique<google::protobuf::Arena>();
+
+  uint64_t start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  auto plan = compile(expr, compiled->arena.get(), &compiled->referenced);
+  g_compile_nanos.fetch_add(clock_gettime_nsec_np(CLOCK_MONOTONIC) - start,
+                            std::memory_order_relaxed);
+  if (!plan.ok()) {
+    return plan.status();
+  }
+  compiled->plan = std::move(*plan);
+
+  // Two threads missing on the same expression both compile it and the last
+  // one to finish wins. Both programs are valid so this is harmless.
+  cache_.set(key, compiled);
+  return compiled;
+}
+
+void ProgramCache::Flush() {
+  cache_.clear();
+}
+
+uint64_t ProgramCache::Count() const {
+  return cache_.count();
+}
+
+uint64_t ProgramCache::ApproximateBytes() {
+  uint64_t bytes = cache_.approximate_bytes();
+  cache_.foreach([&bytes](Key&, std::shared_ptr<const Program>& program) {
+    if (!program) {
+      return;
+    }
+    bytes += sizeof(Program) + program->expr.capacity();
+    if (program->arena) {
+      bytes += program->arena->SpaceAllocated();
+    }
+  });
+  return bytes;
+}
+
+void ProgramCache::RecordEvaluation(uint64_t nanos) {
+  g_evaluations.fetch_add(1, std::memory_order_relaxed);
+  g_eval_nanos.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+ProgramCache::Stats ProgramCache::GetStats(bool reset) {
+  auto read = [reset](std::atomic<uint64_t>& counter) {
+    return reset ? counter.exchange(0, std::memory_order_relaxed)
+                 : counter.load(std::memory_order_relaxed);
+  };
+  return Stats{
+      .hits = read(g_hits),
+      .misses = read(g_misses),
+      .evaluations = read(g_evaluations),
+      .compile_nanos = read(g_compile_nanos),
+      .eval_nanos = read(g_eval_nanos),
+  };
+}
+
+}  // namespace cel
+}  // namespace santa
@@ -0,0 +1,115 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/cel/ProgramCache.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+
+#include "Source/common/cel/Evaluator.h"
+#include "absl/status/statusor.h"
+
+using santa::cel::ProgramCache;
+
+@interface ProgramCacheTest : XCTestCase
+@end
+
+@implementation ProgramCacheTest
+
+- (void)setUp {
+  ProgramCache::GetStats(true);
+}
+
+- (void)testGetOrCompile {
+  auto evaluator = santa::cel::Evaluator<true>::Create();
+  XCTAssertTrue(evaluator.ok());
+
+  int compiles = 0;
+  ProgramCache::CompileFunction compile =
+      [&](absl::string_view expr, google::protobuf::Arena* arena,
+          santa::cel::ExecAttributes* referenced) {
+        compiles++;
+        return (*evaluator)->Compile(expr, arena, referenced);
+      };
+
+  ProgramCache sut;
+  auto first = sut.GetOrCompile("target.signing_id == 'foo'", true, compile);
+  XCTAssertTrue(first.ok());
+  XCTAssertNotEqual((*first)->plan, nullptr);
+  XCTAssertEqual((*first)->referenced, 0);
+  XCTAssertEqual(compiles, 1);
+
+  // The same expression is only compiled once per version
+  auto second = sut.GetOrCompile("target.signing_id == 'foo'", true, compile);
+  XCTAssertTrue(second.ok());
+  XCTAssertEqual(first->get(), second->get());
+  XCTAssertEqual(compiles, 1);
+
+  auto v1 = sut.GetOrCompile("target.signing_id == 'foo'", false, compile);
+  XCTAssertTrue(v1.ok());
+  XCTAssertNotEqual(first->get(), v1->get());
+  XCTAssertEqual(compiles, 2);
+  XCTAssertEqual(sut.Count(), 2);
+
+  ProgramCache::Stats stats = ProgramCache::GetStats(true);
+  XCTAssertEqual(stats.hits, 1);
+  XCTAssertEqual(stats.misses, 2);
+  XCTAssertGreaterThan(stats.compile_nanos, 0);
+
+  // Programs held by callers remain usable after a flush
+  sut.Flush();
+  XCTAssertEqual(sut.Count(), 0);
+  XCTAssertNotEqual((*first)->plan, nullptr);
+
+  auto third = sut.GetOrCompile("target.signing_id == 'foo'", true, compile);
+  XCTAssertTrue(third.ok());
+  XCTAssertNotEqual(first->get(), third->get());
+  XCTAssertEqual(compiles, 3);
+}
+
+- (void)testCompileFailureNotCached {
+  auto evaluator = santa::cel::Evaluator<true>::Create();
+  XCTAssertTrue(evaluator.ok());
+
+  int compiles = 0;
+  ProgramCache::CompileFunction compile =
+      [&](absl::string_view expr, google::protobuf::Arena* arena,
+          santa::cel::ExecAttributes* referenced) {
+        compiles++;
+        return (*evaluator)->Compile(expr, arena, referenced);
+      };
+
+  ProgramCache sut;
+  XCTAssertFalse(sut.GetOrCompile("this is not cel", true, compile).ok());
+  XCTAssertFalse(sut.GetOrCompile("this is not cel", true, compile).ok());
+  XCTAssertEqual(compiles, 2);
+  XCTAssertEqual(sut.Count(), 0);
+}
+
+- (void)testRecordEvaluation {
+  ProgramCache::RecordEvaluation(100);
+  ProgramCache::RecordEvaluation(200);
+
+  ProgramCache::Stats stats = ProgramCache::GetStats(true);
+  XCTAssertEqual(stats.evaluations, 2);
+  XCTAssertEqual(stats.eval_nanos, 300);
+
+  stats = ProgramCache::GetStats(false);
+  XCTAssertEqual(stats.evaluations, 0);
+  XCTAssertEqual(stats.eval_nanos, 0);
+}
+
+@end
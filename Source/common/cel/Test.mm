@@ -640,4 +640,97 @@
   XCTAssertFalse(result.ok());
 }
 
+- (void)testAttributesAreLazyAndShared {
+  using ReturnValue = santa::cel::CELProtoTraits<true>::ReturnValue;
+  using ExecutableFileT = santa::cel::CELProtoTraits<true>::ExecutableFileT;
+  using AncestorT = santa::cel::CELProtoTraits<true>::AncestorT;
+  using FileDescriptorT = santa::cel::CELProtoTraits<true>::FileDescriptorT;
+
+  __block int fileCalls = 0;
+  __block int argsCalls = 0;
+  __block int ancestorsCalls = 0;
+  santa::cel::Activation<true> activation(
+      ^std::unique_ptr<ExecutableFileT>() {
+        fileCalls++;
+        auto f = std::make_unique<ExecutableFileT>();
+        f->set_team_id("EQHXZ8M8AV");
+        return f;
+      },
+      ^std::vector<std::string>() {
+        argsCalls++;
+        return {"hello", "world"};
+      },
+      ^std::map<std::string, std::string>() {
+        return {};
+      },
+      ^uid_t() {
+        return 0;
+      },
+      ^std::string() {
+        return "/";
+      },
+      ^std::string() {
+        return "/usr/bin/test";
+      },
+      ^std::vector<AncestorT>() {
+        ancestorsCalls++;
+        AncestorT ancestor;
+        ancestor.set_path("/bin/zsh");
+        return {ancestor};
+      },
+      ^std::vector<FileDescriptorT>() {
+        return {};
+      });
+
+  auto sut = santa::cel::Evaluator<true>::Create();
+  XCTAssertTrue(sut.ok());
+
+  // Nothing is computed until an expression reads it
+  auto result = sut.value()->CompileAndEvaluate("ALLOWLIST", activation);
+  XCTAssertTrue(result.ok());
+  XCTAssertEqual(fileCalls, 0);
+  XCTAssertEqual(argsCalls, 0);
+  XCTAssertEqual(ancestorsCalls, 0);
+
+  // Several expressions evaluated against the same activation compute each
+  // attribute once
+  for (absl::string_view expr : {
+           "target.team_id == 'EQHXZ8M8AV' && 'hello' in args ? ALLOWLIST : BLOCKLIST",
+           "args[1] == 'world' && ancestors[0].path == '/bin/zsh' ? ALLOWLIST : BLOCKLIST",
+           "target.team_id == 'EQHXZ8M8AV' && ancestors.size() == 1 ? ALLOWLIST : BLOCKLIST",
+       }) {
+    result = sut.value()->CompileAndEvaluate(expr, activation);
+    XCTAssertTrue(result.ok());
+    XCTAssertEqual(result.value().value, ReturnValue::ALLOWLIST);
+  }
+  XCTAssertEqual(fileCalls, 1);
+  XCTAssertEqual(argsCalls, 1);
+  XCTAssertEqual(ancestorsCalls, 1);
+}
+
+- (void)testCompileReferencedAttributes {
+  auto sut = santa::cel::Evaluator<true>::Create();
+  XCTAssertTrue(sut.ok());
+
+  auto check = [&](absl::string_view expr, santa::cel::ExecAttributes want) {
+    google::protobuf::Arena arena;
+    santa::cel::ExecAttributes got = santa::cel::kExecAttributeUnknown;
+    auto result = sut.value()->Compile(expr, &arena, &got);
+    XCTAssertTrue(result.ok());
+    XCTAssertEqual(got, want, @"%s", std::string(expr).c_str());
+  };
+
+  check("target.team_id == 'EQHXZ8M8AV' ? ALLOWLIST : BLOCKLIST", 0);
+  check("euid == 0 ? BLOCKLIST : ALLOWLIST", santa::cel::kExecAttributeEuid);
+  // Attributes count even if the evaluation might never reach them
+  check("target.is_platform_binary || 'x' in args", santa::cel::kExecAttributeArgs);
+  check("args.exists(a, a == 'x') && has(envs.FOO)",
+        santa::cel::kExecAttributeArgs | santa::cel::kExecAttributeEnvs);
+  check("ancestors.exists(a, a.path == cwd) || size(fds) > 0",
+        santa::cel::kExecAttributeAncestors | santa::cel::kExecAttributeCwd |
+            santa::cel::kExecAttributeFds);
+  // Fields of other messages named like attributes don't count
+  check("target.signing_id == 'x' && size(target.entitlements) > 0", 0);
+}
+
 @end
@@ -29,6 +29,8 @@ enum class Processor {
   kTamperResistance,
   kDataFileAccessAuthorizer,
   kProcessFileAccessAuthorizer,
+  // The client shared by subsystems when the multiplexed ES client is enabled
+  kMultiplexer,
 };
 
 enum class EventDisposition {
@@ -44,6 +46,18 @@ class ESMetricsObserver {
   virtual void SetEventMetrics(Processor processor,
                                EventDisposition disposition, int64_t nanos,
                                es_event_type_t event_type) = 0;
+
+  // Called when a sharded AUTH queue begins processing a message. `depth` is
+  // the number of messages queued on the shard, including this one, and
+  // `wait_nanos` is how long the message waited before it started.
+  virtual void SetAuthQueueMetrics(Processor processor, uint32_t shard,
+                                   int64_t depth, int64_t wait_nanos) {}
+
+  // Called after responding to an AUTH message with the time that remained
+  // before its deadline. Negative values mean the deadline had passed.
+  virtual void SetAuthResponseBudget(Processor processor,
+                                     es_event_type_t event_type,
+                                     int64_t remaining_nanos) {}
 };
 
 }  // namespace santa
@@ -50,6 +50,12 @@ bool EndpointSecurityAPI::Subscribe(const Client& client,
   return es_subscribe(client.Get(), subs.data(), (uint32_t)subs.size()) == ES_RETURN_SUCCESS;
 }
 
+bool EndpointSecurityAPI::Unsubscribe(const Client& client,
+                                      const std::set<es_event_type_t>& event_types) {
+  std::vector<es_event_type_t> subs(event_types.begin(), event_types.end());
+  return es_unsubscribe(client.Get(), subs.data(), (uint32_t)subs.size()) == ES_RETURN_SUCCESS;
+}
+
 bool EndpointSecurityAPI::UnsubscribeAll(const Client& client) {
   return es_unsubscribe_all(client.Get()) == ES_RETURN_SUCCESS;
 }
@@ -145,8 +151,10 @@ es_string_token_t EndpointSecurityAPI::ExecArg(const es_event_exec_t* event, uin
 
 std::vector<std::string> EndpointSecurityAPI::ExecArgs(const es_event_exec_t* event) {
   std::vector<std::string> args;
-  for (uint32_t i = 0; i < es_exec_arg_count(event); i++) {
-    args.push_back(StringTokenToString(es_exec_arg(event, i)));
+  // Go through the virtual accessors so that subclasses supplying their own
+  // arguments are honored
+  for (uint32_t i = 0; i < ExecArgCount(event); i++) {
+    args.push_back(StringTokenToString(ExecArg(event, i)));
   }
   return args;
 }
@@ -161,8 +169,8 @@ es_string_token_t EndpointSecurityAPI::ExecEnv(const es_event_exec_t* event, uin
 
 std::map<std::string, std::string> EndpointSecurityAPI::ExecEnvs(const es_event_exec_t* event) {
   std::map<std::string, std::string> envs;
-  for (uint32_t i = 0; i < es_exec_env_count(event); i++) {
-    auto s = santa::StringTokenToString(es_exec_env(event, i));
+  for (uint32_t i = 0; i < ExecEnvCount(event); i++) {
+    auto s = santa::StringTokenToString(ExecEnv(event, i));
     auto npos = s.find("=");
     if (npos == ::std::string::npos) {
       envs[s] = "SANTA_ENV_VAL_MISSING_PLACEHOLDER";
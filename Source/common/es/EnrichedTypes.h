@@ -21,8 +21,10 @@
 #define SANTA_COMMON_ES_ENRICHEDTYPES_H
 
 #include <EndpointSecurity/EndpointSecurity.h>
+#include <sys/types.h>
 #include <time.h>
 
+#include <memory>
 #include <optional>
 #include <string>
 #include <variant>
@@ -31,9 +33,97 @@
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/es/Message.h"
 #include "Source/common/processtree/process_tree.pb.h"
+#include "absl/base/call_once.h"
 
 namespace santa {
 
+enum class EnrichOptions {
+  // Specifies default enricher operation.
+  kDefault,
+
+  // This option tells the enricher to only enrich with information that can be
+  // gathered without potentially triggering work from external processes.
+  kLocalOnly,
+};
+
+// Source of the user and group names of lazily enriched fields.
+class NameResolver {
+ public:
+  virtual ~NameResolver() = default;
+
+  virtual std::optional<std::shared_ptr<std::string>> UsernameForUID(
+      uid_t uid, EnrichOptions options) = 0;
+  virtual std::optional<std::shared_ptr<std::string>> UsernameForGID(
+      gid_t gid, EnrichOptions options) = 0;
+};
+
+// A user or group name that is only resolved the first time it is read.
+// Most events are never serialized with every name they carry (and some are
+// never serialized at all), so resolution is deferred until a serializer asks.
+// Safe to read concurrently; the lookup happens at most once.
+class LazyName {
+ public:
+  using Value = std::optional<std::shared_ptr<std::string>>;
+
+  enum class Kind {
+    kUser,
+    kGroup,
+  };
+
+  // An already resolved name.
+  explicit LazyName(Value value) : value_(std::move(value)), resolved_(true) {
+    absl::call_once(once_, [] {});
+  }
+
+  LazyName(std::shared_ptr<NameResolver> resolver, Kind kind, uint32_t id,
+           EnrichOptions options)
+      : resolver_(std::move(resolver)),
+        kind_(kind),
+        id_(id),
+        options_(options),
+        resolved_(false) {}
+
+  // Moves must not race with reads of `other`.
+  LazyName(LazyName&& other)
+      : resolver_(std::move(other.resolver_)),
+        kind_(other.kind_),
+        id_(other.id_),
+        options_(other.options_),
+        value_(std::move(other.value_)),
+        resolved_(other.resolved_) {
+    if (resolved_) {
+      absl::call_once(once_, [] {});
+    }
+  }
+
+  LazyName& operator=(LazyName&& other) = delete;
+  LazyName(const LazyName& other) = delete;
+  LazyName& operator=(const LazyName& other) = delete;
+
+  const Value& Get() const {
+    absl::call_once(once_, [this] {
+      if (resolver_) {
+        value_ = kind_ == Kind::kUser
+                     ? resolver_->UsernameForUID((uid_t)id_, options_)
+                     : resolver_->UsernameForGID((gid_t)id_, options_);
+        // The resolver is no longer needed, don't keep it alive
+        resolver_.reset();
+      }
+      resolved_ = true;
+    });
+    return value_;
+  }
+
+ private:
+  mutable std::shared_ptr<NameResolver> resolver_;
+  Kind kind_ = Kind::kUser;
+  uint32_t id_ = 0;
+  EnrichOptions options_ = EnrichOptions::kDefault;
+  mutable Value value_;
+  mutable bool resolved_;
+  mutable absl::once_flag once_;
+};
+
 class EnrichedFile {
  public:
   EnrichedFile()
@@ -46,6 +136,12 @@ class EnrichedFile {
         group_(std::move(group)),
         hash_(std::move(hash)) {}
 
+  EnrichedFile(LazyName&& user, LazyName&& group,
+               std::optional<std::shared_ptr<std::string>>&& hash)
+      : user_(std::move(user)),
+        group_(std::move(group)),
+        hash_(std::move(hash)) {}
+
   EnrichedFile(EnrichedFile&& other)
       : user_(std::move(other.user_)),
         group_(std::move(other.group_)),
@@ -58,15 +154,15 @@ class EnrichedFile {
   EnrichedFile& operator=(const EnrichedFile& other) = delete;
 
   const std::optional<std::shared_ptr<std::string>>& user() const {
-    return user_;
+    return user_.Get();
   }
   const std::optional<std::shared_ptr<std::string>>& group() const {
-    return group_;
+    return group_.Get();
   }
 
  private:
-  std::optional<std::shared_ptr<std::string>> user_;
-  std::optional<std::shared_ptr<std::string>> group_;
+  LazyName user_;
+  LazyName group_;
   std::optional<std::shared_ptr<std::string>> hash_;
 };
 
@@ -93,6 +189,17 @@ class EnrichedProcess {
         executable_(std::move(executable)),
         annotations_(std::move(annotations)) {}
 
+  EnrichedProcess(
+      LazyName&& effective_user, LazyName&& effective_group,
+      LazyName&& real_user, LazyName&& real_group, EnrichedFile&& executable,
+      std::optional<santa::pb::v1::process_tree::Annotations>&& annotations)
+      : effective_user_(std::move(effective_user)),
+        effective_group_(std::move(effective_group)),
+        real_user_(std::move(real_user)),
+        real_group_(std::move(real_group)),
+        executable_(std::move(executable)),
+        annotations_(std::move(annotations)) {}
+
   EnrichedProcess(EnrichedProcess&& other)
       : effective_user_(std::move(other.effective_user_)),
         effective_group_(std::move(other.effective_group_)),
@@ -108,16 +215,16 @@ class EnrichedProcess {
   EnrichedProcess& operator=(const EnrichedProcess& other) = delete;
 
   const std::optional<std::shared_ptr<std::string>>& effective_user() const {
-    return effective_user_;
+    return effective_user_.Get();
   }
   const std::optional<std::shared_ptr<std::string>>& effective_group() const {
-    return effective_group_;
+    return effective_group_.Get();
   }
   const std::optional<std::shared_ptr<std::string>>& real_user() const {
-    return real_user_;
+    return real_user_.Get();
   }
   const std::optional<std::shared_ptr<std::string>>& real_group() const {
-    return real_group_;
+    return real_group_.Get();
   }
   const EnrichedFile& executable() const { return executable_; }
   const std::optional<santa::pb::v1::process_tree::Annotations>& annotations()
@@ -126,10 +233,10 @@ class EnrichedProcess {
   }
 
  private:
-  std::optional<std::shared_ptr<std::string>> effective_user_;
-  std::optional<std::shared_ptr<std::string>> effective_group_;
-  std::optional<std::shared_ptr<std::string>> real_user_;
-  std::optional<std::shared_ptr<std::string>> real_group_;
+  LazyName effective_user_;
+  LazyName effective_group_;
+  LazyName real_user_;
+  LazyName real_group_;
   EnrichedFile executable_;
   std::optional<santa::pb::v1::process_tree::Annotations> annotations_;
 };
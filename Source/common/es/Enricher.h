@@ -19,22 +19,17 @@
 #include <memory>
 #include <string_view>
 
-#include "Source/common/SantaCache.h"
 #include "Source/common/es/EnrichedTypes.h"
+#include "Source/common/es/NameCache.h"
 #include "Source/common/processtree/process_tree.h"
 
 namespace santa {
 
-enum class EnrichOptions {
-  // Specifies default enricher operation.
-  kDefault,
-
-  // This option tells the enricher to only enrich with information that can be
-  // gathered without potentially triggering work from external processes.
-  kLocalOnly,
-};
-
-class Enricher {
+// User and group names of enriched processes and files are resolved lazily
+// when the Enricher is owned by a shared_ptr. Otherwise (e.g. a temporary
+// Enricher) they are resolved during enrichment.
+class Enricher : public NameResolver,
+                 public std::enable_shared_from_this<Enricher> {
  public:
   Enricher(
       std::shared_ptr<santa::santad::process_tree::ProcessTree> pt = nullptr);
@@ -52,10 +47,10 @@ class Enricher {
       const es_file_t* es_file,
       EnrichOptions options = EnrichOptions::kDefault);
 
-  virtual std::optional<std::shared_ptr<std::string>> UsernameForUID(
-      uid_t uid, EnrichOptions options = EnrichOptions::kDefault);
-  virtual std::optional<std::shared_ptr<std::string>> UsernameForGID(
-      gid_t gid, EnrichOptions options = EnrichOptions::kDefault);
+  std::optional<std::shared_ptr<std::string>> UsernameForUID(
+      uid_t uid, EnrichOptions options = EnrichOptions::kDefault) override;
+  std::optional<std::shared_ptr<std::string>> UsernameForGID(
+      gid_t gid, EnrichOptions options = EnrichOptions::kDefault) override;
 
   // This method does not chache. It should not be used on a hot path.
   virtual std::optional<uid_t> UIDForUsername(
@@ -63,10 +58,11 @@ class Enricher {
       EnrichOptions options = EnrichOptions::kDefault);
 
  private:
-  SantaCache<uid_t, std::optional<std::shared_ptr<std::string>>>
-      username_cache_;
-  SantaCache<gid_t, std::optional<std::shared_ptr<std::string>>>
-      groupname_cache_;
+  LazyName NameForID(const std::shared_ptr<NameResolver>& resolver,
+                     LazyName::Kind kind, uint32_t id, EnrichOptions options);
+
+  std::shared_ptr<NameCache> username_cache_;
+  std::shared_ptr<NameCache> groupname_cache_;
   std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree_;
 };
 
@@ -17,13 +17,13 @@
 
 #include <EndpointSecurity/ESTypes.h>
 #include <bsm/libbsm.h>
-#include <grp.h>
 #include <pwd.h>
 #include <sys/types.h>
 
 #include <memory>
 #include <optional>
 
+#include "Source/common/LatencyHistogram.h"
 #include "Source/common/Platform.h"
 #include "Source/common/SNTLogging.h"
 #include "Source/common/String.h"
@@ -35,9 +35,13 @@
 namespace santa {
 
 Enricher::Enricher(std::shared_ptr<::santa::santad::process_tree::ProcessTree> pt)
-    : username_cache_(256), groupname_cache_(256), process_tree_(std::move(pt)) {}
+    : username_cache_(NameCache::Usernames()),
+      groupname_cache_(NameCache::Groupnames()),
+      process_tree_(std::move(pt)) {}
 
 std::unique_ptr<EnrichedMessage> Enricher::Enrich(Message&& es_msg) {
+  ScopedStageLatency latency(LatencyStage::kEnrich, es_msg->event_type);
+
   // TODO(mlw): Consider potential design patterns that could help reduce memory usage under load
   // (such as maybe the flyweight pattern)
   switch (es_msg->event_type) {
@@ -208,12 +212,24 @@ std::optional<EnrichedProcess> Enricher::Enrich(const es_process_t* es_proc,
   return es_proc ? std::make_optional<EnrichedProcess>(Enrich(*es_proc, options)) : std::nullopt;
 }
 
+LazyName Enricher::NameForID(const std::shared_ptr<NameResolver>& resolver, LazyName::Kind kind,
+                             uint32_t id, EnrichOptions options) {
+  if (resolver) {
+    return LazyName(resolver, kind, id, options);
+  }
+  return LazyName(kind == LazyName::Kind::kUser ? UsernameForUID((uid_t)id, options)
+                                                : UsernameForGID((gid_t)id, options));
+}
+
 EnrichedProcess Enricher::Enrich(const es_process_t& es_proc, EnrichOptions options) {
+  std::shared_ptr<NameResolver> resolver = weak_from_this().lock();
   return EnrichedProcess(
-      UsernameForUID(audit_token_to_euid(es_proc.audit_token), options),
-      UsernameForGID(audit_token_to_egid(es_proc.audit_token), options),
-      UsernameForUID(audit_token_to_ruid(es_proc.audit_token), options),
-      UsernameForGID(audit_token_to_rgid(es_proc.audit_token), options),
+      NameForID(resolver, LazyName::Kind::kUser, audit_token_to_euid(es_proc.audit_token), options),
+      NameForID(resolver, LazyName::Kind::kGroup, audit_token_to_egid(es_proc.audit_token),
+                options),
+      NameForID(resolver, LazyName::Kind::kUser, audit_token_to_ruid(es_proc.audit_token), options),
+      NameForID(resolver, LazyName::Kind::kGroup, audit_token_to_rgid(es_proc.audit_token),
+                options),
       Enrich(*es_proc.executable, options),
       process_tree_ ? process_tree_->ExportAnnotations(
                           santa::santad::process_tree::PidFromAuditToken(es_proc.audit_token))
@@ -227,54 +243,22 @@ std::optional<EnrichedFile> Enricher::Enrich(const es_file_t* es_file, EnrichOpt
 EnrichedFile Enricher::Enrich(const es_file_t& es_file, EnrichOptions options) {
   // TODO(mlw): Consider having the enricher perform file hashing. This will
   // make more sense if we start including hashes in more event types.
-  return EnrichedFile(UsernameForUID(es_file.stat.st_uid, options),
-                      UsernameForGID(es_file.stat.st_gid, options), std::nullopt);
+  std::shared_ptr<NameResolver> resolver = weak_from_this().lock();
+  return EnrichedFile(NameForID(resolver, LazyName::Kind::kUser, es_file.stat.st_uid, options),
+                      NameForID(resolver, LazyName::Kind::kGroup, es_file.stat.st_gid, options),
+                      std::nullopt);
 }
 
 std::optional<std::shared_ptr<std::string>> Enricher::UsernameForUID(uid_t uid,
                                                                      EnrichOptions options) {
-  std::optional<std::shared_ptr<std::string>> username = username_cache_.get(uid);
-
-  if (username.has_value()) {
-    return username;
-  } else if (options == EnrichOptions::kLocalOnly) {
-    // If `kLocalOnly` option is set, do not attempt a lookup
-    return std::nullopt;
-  } else {
-    struct passwd* pw = getpwuid(uid);
-    if (pw) {
-      username = std::make_shared<std::string>(pw->pw_name);
-    } else {
-      username = std::nullopt;
-    }
-
-    username_cache_.set(uid, username);
-
-    return username;
-  }
+  // If `kLocalOnly` option is set, do not attempt a lookup
+  return username_cache_->Get(uid, options != EnrichOptions::kLocalOnly);
 }
 
 std::optional<std::shared_ptr<std::string>> Enricher::UsernameForGID(gid_t gid,
                                                                      EnrichOptions options) {
-  std::optional<std::shared_ptr<std::string>> groupname = groupname_cache_.get(gid);
-
-  if (groupname.has_value()) {
-    return groupname;
-  } else if (options == EnrichOptions::kLocalOnly) {
-    // If `kLocalOnly` option is set, do not attempt a lookup
-    return std::nullopt;
-  } else {
-    struct group* gr = getgrgid(gid);
-    if (gr) {
-      groupname = std::make_shared<std::string>(gr->gr_name);
-    } else {
-      groupname = std::nullopt;
-    }
-
-    groupname_cache_.set(gid, groupname);
-
-    return groupname;
-  }
+  // If `kLocalOnly` option is set, do not attempt a lookup
+  return groupname_cache_->Get(gid, options != EnrichOptions::kLocalOnly);
 }
 
 std::optional<uid_t> Enricher::UIDForUsername(std::string_view username, EnrichOptions options) {
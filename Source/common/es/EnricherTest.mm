@@ -19,7 +19,26 @@
 #include "Source/common/TestUtils.h"
 #include "Source/common/es/Enricher.h"
 
+#include <memory>
+
+using santa::EnrichedFile;
 using santa::Enricher;
+using santa::EnrichOptions;
+
+namespace {
+
+class CountingEnricher : public Enricher {
+ public:
+  std::optional<std::shared_ptr<std::string>> UsernameForUID(uid_t uid,
+                                                             EnrichOptions options) override {
+    uid_lookups++;
+    return Enricher::UsernameForUID(uid, options);
+  }
+
+  int uid_lookups = 0;
+};
+
+}  // namespace
 
 @interface EnricherTest : XCTestCase
 @end
@@ -47,4 +66,34 @@ using santa::Enricher;
   XCTAssertFalse(invalidGroup.has_value());
 }
 
+- (void)testNamesAreResolvedOnFirstAccess {
+  auto enricher = std::make_shared<CountingEnricher>();
+  es_file_t file = MakeESFile("foo");
+  file.stat.st_uid = NOBODY_UID;
+  file.stat.st_gid = NOGROUP_GID;
+
+  EnrichedFile enrichedFile = enricher->Enrich(file);
+  XCTAssertEqual(enricher->uid_lookups, 0);
+
+  XCTAssertEqual(strcmp(enrichedFile.user()->get()->c_str(), "nobody"), 0);
+  XCTAssertEqual(strcmp(enrichedFile.group()->get()->c_str(), "nogroup"), 0);
+  XCTAssertEqual(enricher->uid_lookups, 1);
+
+  // The result is memoized, including across moves
+  EnrichedFile moved(std::move(enrichedFile));
+  XCTAssertEqual(strcmp(moved.user()->get()->c_str(), "nobody"), 0);
+  XCTAssertEqual(enricher->uid_lookups, 1);
+}
+
+- (void)testNamesAreResolvedEagerlyWithoutSharedOwnership {
+  CountingEnricher enricher;
+  es_file_t file = MakeESFile("foo");
+  file.stat.st_uid = NOBODY_UID;
+
+  EnrichedFile enrichedFile = enricher.Enrich(file);
+  XCTAssertEqual(enricher.uid_lookups, 1);
+  XCTAssertEqual(strcmp(enrichedFile.user()->get()->c_str(), "nobody"), 0);
+  XCTAssertEqual(enricher.uid_lookups, 1);
+}
+
 @end
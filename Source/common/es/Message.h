@@ -17,12 +17,17 @@
 #define SANTA_COMMON_ES_MESSAGE_H
 
 #include <EndpointSecurity/EndpointSecurity.h>
+#include <os/lock.h>
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
 #include <variant>
+#include <vector>
 
+#include "Source/common/PathInternPool.h"
 #include "Source/common/processtree/process_tree.h"
 
 namespace santa {
@@ -34,9 +39,9 @@ class Message {
   // Small structure to hold event target information.
   struct PathTarget {
     // Simple paths hold a string_view into the retained es_message_t (zero
-    // copy). Compound paths (dir + "/" + filename) hold a materialized string.
-    // Both variants are null-terminated.
-    std::variant<std::string_view, std::string> path;
+    // copy). Compound paths (dir + "/" + filename) are interned so repeated
+    // destinations share a single copy. Both variants are null-terminated.
+    std::variant<std::string_view, InternedPath> path;
     bool is_readable;
     // This is a pointer into an es_message_t. The message must be valid for
     // this pointer to be valid. The interfaces in the Message class will vend
@@ -50,11 +55,25 @@ class Message {
 
     // Returns a view of the path, regardless of which variant is held.
     std::string_view Path() const {
-      return std::visit([](const auto& p) -> std::string_view { return p; },
-                        path);
+      return std::visit(
+          [](const auto& p) -> std::string_view { return std::string_view(p); },
+          path);
     }
   };
 
+  // Counts since the last reset. `handle_copies` is the number of times a
+  // Message was copied. Copies share the retain taken when the first handle
+  // was created, so each copy is an es_retain_message call that was avoided.
+  // State structures are handed out from a free list when one is available.
+  struct Stats {
+    uint64_t messages = 0;
+    uint64_t handle_copies = 0;
+    uint64_t pool_hits = 0;
+    uint64_t pool_misses = 0;
+  };
+
+  static Stats GetStats(bool reset);
+
   Message(std::shared_ptr<EndpointSecurityAPI> esapi,
           const es_message_t* es_msg);
   ~Message();
@@ -63,6 +82,8 @@ class Message {
   // Note: Safe to implement this, just not currently needed so left deleted.
   Message& operator=(Message&& rhs) = delete;
 
+  // Copies share the underlying es_message_t and path targets with the
+  // original. Copying only bumps an intrusive reference count.
   Message(const Message& other);
   Message& operator=(const Message& other) = delete;
 
@@ -76,31 +97,56 @@ class Message {
   // Used for things like es_exec_arg_count.
   // We should ideally rework this to somehow present these functions as methods
   // on the Message, however this would be a bit of a bigger lift.
-  std::shared_ptr<EndpointSecurityAPI> ESAPI() const { return esapi_; }
+  std::shared_ptr<EndpointSecurityAPI> ESAPI() const {
+    return state_ ? state_->esapi : nullptr;
+  }
 
   std::string ParentProcessName() const;
   std::string ParentProcessPath() const;
 
-  // This method is not thread safe until after the first completed call.
-  const std::vector<Message::PathTarget> PathTargets();
+  // Targets are computed on the first call and shared by all copies of the
+  // message. The returned reference is valid for the lifetime of this object.
+  const std::vector<Message::PathTarget>& PathTargets();
 
+  // Only targets computed by a previous call to PathTargets on this message
+  // or one of its copies are visible.
   inline bool HasPathTarget(size_t index) const {
-    return index < path_targets_.size();
+    return state_ &&
+           state_->path_targets_populated.load(std::memory_order_acquire) &&
+           index < state_->path_targets.size();
   }
 
   inline const Message::PathTarget& PathTargetAtIndex(size_t index) const {
-    return path_targets_.at(index);
+    return state_->path_targets.at(index);
   }
 
  private:
+  // Shared by every copy of a Message. The es_message_t is retained once when
+  // the state is acquired and released when the last copy is destroyed, after
+  // which the state is returned to a free list. The path target buffer keeps
+  // its capacity across reuse.
+  struct StatePool;
+  struct State {
+    std::atomic<uint32_t> refs;
+    std::shared_ptr<EndpointSecurityAPI> esapi;
+    const es_message_t* es_msg;
+    os_unfair_lock path_targets_lock = OS_UNFAIR_LOCK_INIT;
+    std::atomic<bool> path_targets_populated;
+    std::vector<PathTarget> path_targets;
+  };
+
+  static State* AcquireState();
+  void Release();
+
   std::string GetProcessName(pid_t pid) const;
   std::string GetProcessPath(audit_token_t* tok) const;
-  void PopulatePathTargets();
+  void PopulatePathTargets(std::vector<PathTarget>& targets) const;
 
-  std::shared_ptr<EndpointSecurityAPI> esapi_;
+  State* state_;
+  // Cached from the state so that accessing the message avoids an extra
+  // indirection.
   const es_message_t* es_msg_;
   std::optional<santa::santad::process_tree::ProcessToken> process_token_;
-  std::vector<PathTarget> path_targets_;
 };
 
 }  // namespace santa
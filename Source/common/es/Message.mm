@@ -31,43 +31,130 @@ static inline void PushBackPathTarget(std::vector<Message::PathTarget>& vec,
                  esFile->path_truncated});
 }
 
-// Compound path (dir + "/" + filename): must materialize a std::string.
+// Compound path (dir + "/" + filename): must be materialized, so it is
+// assembled in a per-thread scratch buffer and interned.
 static inline void PushBackPathTarget(std::vector<Message::PathTarget>& vec, const es_file_t* dir,
                                       const es_string_token_t& name) {
-  std::string full_path;
-  full_path.reserve(dir->path.length + 1 + name.length);
+  thread_local std::string full_path;
+  full_path.clear();
   full_path.append(dir->path.data, dir->path.length);
   full_path += '/';
   full_path.append(name.data, name.length);
-  vec.push_back({std::move(full_path), false, nullptr, dir->path_truncated});
+  vec.push_back(
+      {PathInternPool::Shared().Intern(full_path), false, nullptr, dir->path_truncated});
+}
+
+namespace {
+
+std::atomic<uint64_t> g_messages{0};
+std::atomic<uint64_t> g_handle_copies{0};
+std::atomic<uint64_t> g_pool_hits{0};
+std::atomic<uint64_t> g_pool_misses{0};
+
+}  // namespace
+
+// Free list of released states. The number of states in flight is bounded
+// by how many messages ES has outstanding, so the list is capped to avoid
+// holding on to a burst's worth of memory forever.
+struct Message::StatePool {
+  static constexpr size_t kMaxFreeStates = 1024;
+
+  static StatePool& Shared() {
+    static StatePool* shared = new StatePool();
+    return *shared;
+  }
+
+  State* Get() {
+    os_unfair_lock_lock(&lock);
+    State* state = nullptr;
+    if (!free_states.empty()) {
+      state = free_states.back();
+      free_states.pop_back();
+    }
+    os_unfair_lock_unlock(&lock);
+    return state;
+  }
+
+  void Put(State* state) {
+    os_unfair_lock_lock(&lock);
+    if (free_states.size() < kMaxFreeStates) {
+      free_states.push_back(state);
+      state = nullptr;
+    }
+    os_unfair_lock_unlock(&lock);
+    delete state;
+  }
+
+  os_unfair_lock lock = OS_UNFAIR_LOCK_INIT;
+  std::vector<State*> free_states;
+};
+
+Message::Stats Message::GetStats(bool reset) {
+  auto read = [reset](std::atomic<uint64_t>& counter) {
+    return reset ? counter.exchange(0, std::memory_order_relaxed)
+                 : counter.load(std::memory_order_relaxed);
+  };
+  return Stats{
+      .messages = read(g_messages),
+      .handle_copies = read(g_handle_copies),
+      .pool_hits = read(g_pool_hits),
+      .pool_misses = read(g_pool_misses),
+  };
+}
+
+Message::State* Message::AcquireState() {
+  State* state = StatePool::Shared().Get();
+  if (state) {
+    g_pool_hits.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    g_pool_misses.fetch_add(1, std::memory_order_relaxed);
+    state = new State();
+  }
+  return state;
 }
 
 Message::Message(std::shared_ptr<EndpointSecurityAPI> esapi, const es_message_t* es_msg)
-    : esapi_(std::move(esapi)), es_msg_(es_msg), process_token_(std::nullopt) {
-  esapi_->RetainMessage(es_msg);
+    : state_(AcquireState()), es_msg_(es_msg), process_token_(std::nullopt) {
+  state_->refs.store(1, std::memory_order_relaxed);
+  state_->esapi = std::move(esapi);
+  state_->es_msg = es_msg;
+  state_->path_targets_populated.store(false, std::memory_order_relaxed);
+  state_->esapi->RetainMessage(es_msg);
+  g_messages.fetch_add(1, std::memory_order_relaxed);
 }
 
 Message::~Message() {
-  if (es_msg_) {
-    esapi_->ReleaseMessage(es_msg_);
-  }
+  Release();
 }
 
-Message::Message(Message&& other) {
-  esapi_ = std::move(other.esapi_);
-  es_msg_ = other.es_msg_;
-  path_targets_ = std::move(other.path_targets_);
+Message::Message(Message&& other)
+    : state_(other.state_),
+      es_msg_(other.es_msg_),
+      process_token_(std::move(other.process_token_)) {
+  other.state_ = nullptr;
   other.es_msg_ = nullptr;
-  process_token_ = std::move(other.process_token_);
   other.process_token_ = std::nullopt;
 }
 
-Message::Message(const Message& other) {
-  esapi_ = other.esapi_;
-  es_msg_ = other.es_msg_;
-  esapi_->RetainMessage(es_msg_);
-  path_targets_ = other.path_targets_;
-  process_token_ = other.process_token_;
+Message::Message(const Message& other)
+    : state_(other.state_), es_msg_(other.es_msg_), process_token_(other.process_token_) {
+  if (state_) {
+    state_->refs.fetch_add(1, std::memory_order_relaxed);
+    g_handle_copies.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Message::Release() {
+  if (state_ && state_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    state_->esapi->ReleaseMessage(state_->es_msg);
+    state_->esapi.reset();
+    state_->es_msg = nullptr;
+    // Clearing keeps the buffer's capacity for the next message
+    state_->path_targets.clear();
+    StatePool::Shared().Put(state_);
+  }
+  state_ = nullptr;
+  es_msg_ = nullptr;
 }
 
 void Message::SetProcessToken(santa::santad::process_tree::ProcessToken tok) {
@@ -102,16 +189,20 @@ std::string Message::GetProcessPath(audit_token_t* tok) const {
   }
 }
 
-const std::vector<Message::PathTarget> Message::PathTargets() {
-  if (path_targets_.size() == 0) {
-    PopulatePathTargets();
+const std::vector<Message::PathTarget>& Message::PathTargets() {
+  if (!state_->path_targets_populated.load(std::memory_order_acquire)) {
+    os_unfair_lock_lock(&state_->path_targets_lock);
+    if (!state_->path_targets_populated.load(std::memory_order_relaxed)) {
+      PopulatePathTargets(state_->path_targets);
+      state_->path_targets_populated.store(true, std::memory_order_release);
+    }
+    os_unfair_lock_unlock(&state_->path_targets_lock);
   }
 
-  return path_targets_;
+  return state_->path_targets;
 }
 
-void Message::PopulatePathTargets() {
-  std::vector<Message::PathTarget> targets;
+void Message::PopulatePathTargets(std::vector<Message::PathTarget>& targets) const {
   targets.reserve(2);
 
   switch (es_msg_->event_type) {
@@ -180,8 +271,6 @@ void Message::PopulatePathTargets() {
 
     default: break;
   }
-
-  path_targets_.swap(targets);
 }
 
 }  // namespace santa
@@ -96,8 +96,8 @@ std::string GetProcessPath(pid_t pid) {
 
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   EXPECT_CALL(*mockESApi, ReleaseMessage(testing::_))
-      .Times(2)
-      .After(EXPECT_CALL(*mockESApi, RetainMessage(testing::_)).Times(2));
+      .Times(1)
+      .After(EXPECT_CALL(*mockESApi, RetainMessage(testing::_)).Times(1));
 
   {
     Message msg1(mockESApi, &esMsg);
@@ -106,12 +106,80 @@ std::string GetProcessPath(pid_t pid) {
     // Both messages should now point to the same `es_message_t`
     XCTAssertEqual(msg1.operator->(), &esMsg);
     XCTAssertEqual(msg2.operator->(), &esMsg);
+
+    // Copies share the original retain, which is only released once the
+    // last copy is gone.
+    {
+      Message msg3(msg2);
+      Message msg4(std::move(msg3));
+      XCTAssertEqual(msg4.operator->(), &esMsg);
+    }
   }
 
   // Ensure the retain/release mocks were called the expected number of times
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testCopiesSharePathTargets {
+  es_file_t testFile = MakeESFile("test_file");
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_OPEN, &proc);
+  esMsg.event.open.file = &testFile;
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  Message msg1(mockESApi, &esMsg);
+  Message msg2(msg1);
+  XCTAssertFalse(msg2.HasPathTarget(0));
+
+  // Targets computed through one copy are visible through the others
+  const std::vector<Message::PathTarget>& targets = msg1.PathTargets();
+  XCTAssertEqual(targets.size(), 1);
+  XCTAssertTrue(msg2.HasPathTarget(0));
+  XCTAssertEqual(&msg2.PathTargets(), &targets);
+  XCTAssertEqual(msg2.PathTargetAtIndex(0).unsafe_file, &testFile);
+}
+
+- (void)testStatsAndStateReuse {
+  es_file_t testFile = MakeESFile("test_file");
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_OPEN, &proc);
+  esMsg.event.open.file = &testFile;
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  // Ensure at least one released state is available for reuse
+  { Message msg(mockESApi, &esMsg); }
+  Message::GetStats(true);
+
+  {
+    Message msg1(mockESApi, &esMsg);
+    msg1.PathTargets();
+    Message msg2(msg1);
+    Message msg3(msg2);
+  }
+
+  Message::Stats stats = Message::GetStats(true);
+  XCTAssertEqual(stats.messages, 1);
+  XCTAssertEqual(stats.handle_copies, 2);
+  XCTAssertEqual(stats.pool_hits, 1);
+  XCTAssertEqual(stats.pool_misses, 0);
+
+  // A reused state doesn't carry over the previous message's targets
+  es_message_t exitMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXIT, &proc);
+  Message msg(mockESApi, &exitMsg);
+  XCTAssertFalse(msg.HasPathTarget(0));
+  XCTAssertEqual(msg.PathTargets().size(), 0);
+
+  stats = Message::GetStats(false);
+  XCTAssertEqual(stats.messages, 1);
+  XCTAssertEqual(stats.handle_copies, 0);
+}
+
 - (void)testGetParentProcessName {
   // Construct a message where the parent pid is ourself
   es_file_t procFile = MakeESFile("foo");
@@ -36,6 +36,7 @@ class MockEndpointSecurityAPI : public santa::EndpointSecurityAPI {
   MOCK_METHOD(santa::Client, NewClient, (void (^message_handler)(es_client_t*, santa::Message)));
 
   MOCK_METHOD(bool, Subscribe, (const santa::Client&, const std::set<es_event_type_t>&));
+  MOCK_METHOD(bool, Unsubscribe, (const santa::Client&, const std::set<es_event_type_t>&));
   MOCK_METHOD(bool, UnsubscribeAll, (const Client& client));
 
   MOCK_METHOD(bool, UnmuteAllPaths, (const Client& client));
@@ -0,0 +1,123 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_ES_NAMECACHE_H
+#define SANTA_COMMON_ES_NAMECACHE_H
+
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Caches the results of user and group name lookups.
+//
+// Lookups can end up in opendirectoryd and block for a long time when
+// directory services are slow, so both found and not found results are
+// cached, each with their own TTL. Once an entry expires the stale value
+// keeps being returned while a fresh lookup runs in the background, so only
+// the very first lookup for an ID ever blocks the caller.
+class NameCache : public std::enable_shared_from_this<NameCache> {
+ public:
+  using Value = std::optional<std::shared_ptr<std::string>>;
+  using Lookup = std::function<Value(uint32_t id)>;
+
+  struct Stats {
+    uint64_t hits = 0;
+    // Hits on an expired entry that triggered a background refresh
+    uint64_t stale_hits = 0;
+    uint64_t misses = 0;
+    // Lookups that took longer than the slow lookup threshold
+    uint64_t slow_lookups = 0;
+  };
+
+  static constexpr uint64_t kDefaultPositiveTTLNanos = 10 * 60 * NSEC_PER_SEC;
+  static constexpr uint64_t kDefaultNegativeTTLNanos = 60 * NSEC_PER_SEC;
+  static constexpr uint64_t kDefaultSlowLookupNanos = 10 * NSEC_PER_MSEC;
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  // Process wide caches of user and group names
+  static std::shared_ptr<NameCache> Usernames();
+  static std::shared_ptr<NameCache> Groupnames();
+
+  static std::shared_ptr<NameCache> Create(
+      const char* label, Lookup lookup,
+      uint64_t positive_ttl_nanos = kDefaultPositiveTTLNanos,
+      uint64_t negative_ttl_nanos = kDefaultNegativeTTLNanos,
+      uint64_t slow_lookup_nanos = kDefaultSlowLookupNanos,
+      size_t capacity = kDefaultCapacity);
+
+  NameCache(const char* label, Lookup lookup, uint64_t positive_ttl_nanos,
+            uint64_t negative_ttl_nanos, uint64_t slow_lookup_nanos,
+            size_t capacity);
+
+  NameCache(NameCache&& other) = delete;
+  NameCache& operator=(NameCache&& rhs) = delete;
+  NameCache(const NameCache& other) = delete;
+  NameCache& operator=(const NameCache& other) = delete;
+
+  // Returns the cached name for `id`. If nothing is cached and `allow_lookup`
+  // is false, std::nullopt is returned without performing a lookup.
+  Value Get(uint32_t id, bool allow_lookup = true);
+
+  // When `reset` is true the counts are cleared so that the next call only
+  // covers lookups made after this one.
+  Stats GetStats(bool reset);
+
+  // Approximate bytes used by cached entries and names
+  size_t ApproximateBytes();
+
+  // Drop every cached entry, e.g. under memory pressure
+  void Clear();
+
+ private:
+  struct Entry {
+    Value value;
+    uint64_t expires_at;
+    bool refreshing = false;
+  };
+
+  Value LookupAndStore(uint32_t id);
+  void StoreLocked(uint32_t id, Value value, uint64_t now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_);
+
+  const Lookup lookup_;
+  const uint64_t positive_ttl_nanos_;
+  const uint64_t negative_ttl_nanos_;
+  const uint64_t slow_lookup_nanos_;
+  const size_t capacity_;
+  dispatch_queue_t refresh_queue_;
+
+  absl::Mutex mtx_;
+  absl::flat_hash_map<uint32_t, Entry> entries_ ABSL_GUARDED_BY(mtx_);
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> stale_hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> slow_lookups_{0};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_ES_NAMECACHE_H
@@ -0,0 +1,199 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/es/NameCache.h"
+
+#include <errno.h>
+#include <grp.h>
+#include <pwd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <utility>
+#include <vector>
+
+namespace santa {
+
+namespace {
+
+// Calls a getpwuid_r/getgrgid_r style function, growing the buffer as needed
+template <typename T, typename F>
+NameCache::Value LookupName(int buf_size_name, F&& f, char* T::* name) {
+  long initial_size = sysconf(buf_size_name);
+  std::vector<char> buf(initial_size > 0 ? initial_size : 4096);
+
+  T entry;
+  T* result = nullptr;
+  int err;
+  while ((err = f(&entry, buf.data(), buf.size(), &result)) == ERANGE &&
+         buf.size() < 1024 * 1024) {
+    buf.resize(buf.size() * 2);
+  }
+
+  if (err != 0 || !result) {
+    return std::nullopt;
+  }
+  return std::make_shared<std::string>(result->*name);
+}
+
+uint64_t Now() {
+  return clock_gettime_nsec_np(CLOCK_MONOTONIC);
+}
+
+}  // namespace
+
+std::shared_ptr<NameCache> NameCache::Usernames() {
+  static std::shared_ptr<NameCache>* shared = new std::shared_ptr<NameCache>(
+      Create("com.northpolesec.santa.name_cache.users", [](uint32_t uid) {
+        return LookupName<struct passwd>(
+            _SC_GETPW_R_SIZE_MAX,
+            [uid](struct passwd* pw, char* buf, size_t len, struct passwd** result) {
+              return getpwuid_r((uid_t)uid, pw, buf, len, result);
+            },
+            &passwd::pw_name);
+      }));
+  return *shared;
+}
+
+std::shared_ptr<NameCache> NameCache::Groupnames() {
+  static std::shared_ptr<NameCache>* shared = new std::shared_ptr<NameCache>(
+      Create("com.northpolesec.santa.name_cache.groups", [](uint32_t gid) {
+        return LookupName<struct group>(
+            _SC_GETGR_R_SIZE_MAX,
+            [gid](struct group* gr, char* buf, size_t len, struct group** result) {
+              return getgrgid_r((gid_t)gid, gr, buf, len, result);
+            },
+            &group::gr_name);
+      }));
+  return *shared;
+}
+
+std::shared_ptr<NameCache> NameCache::Create(const char* label, Lookup lookup,
+                                             uint64_t positive_ttl_nanos,
+                                             uint64_t negative_ttl_nanos,
+                                             uint64_t slow_lookup_nanos, size_t capacity) {
+  return std::make_shared<NameCache>(label, std::move(lookup), positive_ttl_nanos,
+                                     negative_ttl_nanos, slow_lookup_nanos, capacity);
+}
+
+NameCache::NameCache(const char* label, Lookup lookup, uint64_t positive_ttl_nanos,
+                     uint64_t negative_ttl_nanos, uint64_t slow_lookup_nanos, size_t capacity)
+    : lookup_(std::move(lookup)),
+      positive_ttl_nanos_(positive_ttl_nanos),
+      negative_ttl_nanos_(negative_ttl_nanos),
+      slow_lookup_nanos_(slow_lookup_nanos),
+      capacity_(capacity),
+      refresh_queue_(dispatch_queue_create(
+          label, dispatch_queue_attr_make_with_qos_class(
+                     DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL, QOS_CLASS_UTILITY, 0))) {}
+
+NameCache::Value NameCache::Get(uint32_t id, bool allow_lookup) {
+  bool found = false;
+  bool refresh = false;
+  Value value;
+  {
+    absl::MutexLock lock(mtx_);
+    auto it = entries_.find(id);
+    if (it != entries_.end()) {
+      found = true;
+      value = it->second.value;
+      if (Now() < it->second.expires_at) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        stale_hits_.fetch_add(1, std::memory_order_relaxed);
+        // Only a single refresh is ever in flight for an entry
+        refresh = !it->second.refreshing;
+        it->second.refreshing = true;
+      }
+    }
+  }
+
+  if (refresh) {
+    std::shared_ptr<NameCache> self = shared_from_this();
+    dispatch_async(refresh_queue_, ^{
+      self->LookupAndStore(id);
+    });
+  }
+
+  if (found || !allow_lookup) {
+    return value;
+  }
+
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return LookupAndStore(id);
+}
+
+NameCache::Value NameCache::LookupAndStore(uint32_t id) {
+  uint64_t start = Now();
+  Value value = lookup_(id);
+  uint64_t now = Now();
+  if (now - start > slow_lookup_nanos_) {
+    slow_lookups_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  absl::MutexLock lock(mtx_);
+  StoreLocked(id, value, now);
+  return value;
+}
+
+void NameCache::StoreLocked(uint32_t id, Value value, uint64_t now) {
+  if (entries_.size() >= capacity_ && !entries_.contains(id)) {
+    absl::erase_if(entries_, [now](const auto& kv) {
+      return !kv.second.refreshing && now >= kv.second.expires_at;
+    });
+    if (entries_.size() >= capacity_) {
+      entries_.clear();
+    }
+  }
+
+  uint64_t ttl = value.has_value() ? positive_ttl_nanos_ : negative_ttl_nanos_;
+  entries_.insert_or_assign(id, Entry{
+                                    .value = std::move(value),
+                                    .expires_at = now + ttl,
+                                    .refreshing = false,
+                                });
+}
+
+NameCache::Stats NameCache::GetStats(bool reset) {
+  auto read = [reset](std::atomic<uint64_t>& counter) {
+    return reset ? counter.exchange(0, std::memory_order_relaxed)
+                 : counter.load(std::memory_order_relaxed);
+  };
+  return Stats{
+      .hits = read(hits_),
+      .stale_hits = read(stale_hits_),
+      .misses = read(misses_),
+      .slow_lookups = read(slow_lookups_),
+  };
+}
+
+size_t NameCache::ApproximateBytes() {
+  absl::MutexLock lock(mtx_);
+  // Swiss tables use one control byte per slot
+  size_t bytes = entries_.capacity() * (sizeof(decltype(entries_)::value_type) + 1);
+  for (const auto& [id, entry] : entries_) {
+    if (entry.value.has_value() && *entry.value) {
+      bytes += sizeof(std::string) + (*entry.value)->capacity();
+    }
+  }
+  return bytes;
+}
+
+void NameCache::Clear() {
+  absl::MutexLock lock(mtx_);
+  entries_.clear();
+}
+
+}  // namespace santa
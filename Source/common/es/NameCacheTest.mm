@@ -0,0 +1,157 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/es/NameCache.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+using santa::NameCache;
+
+@interface NameCacheTest : XCTestCase
+@end
+
+@implementation NameCacheTest
+
+- (void)testPositiveAndNegativeResultsAreCached {
+  auto lookups = std::make_shared<std::atomic<int>>(0);
+  auto sut = NameCache::Create("test", [lookups](uint32_t id) -> NameCache::Value {
+    (*lookups)++;
+    if (id == 0) {
+      return std::make_shared<std::string>("root");
+    }
+    return std::nullopt;
+  });
+
+  for (int i = 0; i < 3; i++) {
+    NameCache::Value found = sut->Get(0);
+    XCTAssertTrue(found.has_value());
+    XCTAssertTrue(**found == "root");
+    XCTAssertFalse(sut->Get(12345).has_value());
+  }
+
+  XCTAssertEqual(lookups->load(), 2);
+
+  NameCache::Stats stats = sut->GetStats(true);
+  XCTAssertEqual(stats.misses, 2);
+  XCTAssertEqual(stats.hits, 4);
+  XCTAssertEqual(stats.stale_hits, 0);
+
+  stats = sut->GetStats(false);
+  XCTAssertEqual(stats.misses, 0);
+  XCTAssertEqual(stats.hits, 0);
+}
+
+- (void)testNoLookupWhenDisallowed {
+  auto lookups = std::make_shared<std::atomic<int>>(0);
+  auto sut = NameCache::Create("test", [lookups](uint32_t id) -> NameCache::Value {
+    (*lookups)++;
+    return std::make_shared<std::string>("user");
+  });
+
+  XCTAssertFalse(sut->Get(501, false).has_value());
+  XCTAssertEqual(lookups->load(), 0);
+
+  // Once cached, the value is returned even when lookups are disallowed
+  XCTAssertTrue(sut->Get(501).has_value());
+  XCTAssertTrue(sut->Get(501, false).has_value());
+  XCTAssertEqual(lookups->load(), 1);
+}
+
+- (void)testExpiredEntriesRefreshInBackground {
+  dispatch_semaphore_t refreshed = dispatch_semaphore_create(0);
+  auto lookups = std::make_shared<std::atomic<int>>(0);
+  auto sut = NameCache::Create(
+      "test",
+      [lookups, refreshed](uint32_t id) -> NameCache::Value {
+        int n = ++(*lookups);
+        if (n > 1) {
+          dispatch_semaphore_signal(refreshed);
+        }
+        return std::make_shared<std::string>("name" + std::to_string(n));
+      },
+      1 * NSEC_PER_MSEC, 1 * NSEC_PER_MSEC);
+
+  XCTAssertTrue(**sut->Get(1) == "name1");
+  usleep(5 * 1000);
+
+  // The stale value is returned immediately while a refresh is started
+  XCTAssertTrue(**sut->Get(1) == "name1");
+  XCTAssertEqual(0, dispatch_semaphore_wait(refreshed,
+                                            dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+
+  // Wait for the refreshed value to be stored
+  for (int i = 0; i < 500 && **sut->Get(1) != "name2"; i++) {
+    usleep(1000);
+  }
+  XCTAssertGreaterThanOrEqual(lookups->load(), 2);
+  XCTAssertGreaterThanOrEqual(sut->GetStats(false).stale_hits, 1);
+}
+
+- (void)testSlowLookupsAreCounted {
+  auto sut = NameCache::Create(
+      "test",
+      [](uint32_t id) -> NameCache::Value {
+        usleep(20 * 1000);
+        return std::nullopt;
+      },
+      NameCache::kDefaultPositiveTTLNanos, NameCache::kDefaultNegativeTTLNanos,
+      5 * NSEC_PER_MSEC);
+
+  XCTAssertFalse(sut->Get(1).has_value());
+  XCTAssertFalse(sut->Get(1).has_value());
+  XCTAssertEqual(sut->GetStats(false).slow_lookups, 1);
+}
+
+- (void)testCapacity {
+  auto sut = NameCache::Create(
+      "test",
+      [](uint32_t id) -> NameCache::Value { return std::make_shared<std::string>("x"); },
+      NameCache::kDefaultPositiveTTLNanos, NameCache::kDefaultNegativeTTLNanos,
+      NameCache::kDefaultSlowLookupNanos, 4);
+
+  for (uint32_t i = 0; i < 10; i++) {
+    XCTAssertTrue(sut->Get(i).has_value());
+  }
+
+  // Entries evicted when the cache filled up are looked up again
+  sut->GetStats(true);
+  for (uint32_t i = 0; i < 10; i++) {
+    sut->Get(i);
+  }
+  XCTAssertGreaterThan(sut->GetStats(false).misses, 0);
+}
+
+- (void)testClear {
+  auto sut = NameCache::Create("test", [](uint32_t id) -> NameCache::Value {
+    return std::make_shared<std::string>("name");
+  });
+
+  XCTAssertEqual(sut->ApproximateBytes(), 0);
+  XCTAssertTrue(sut->Get(1).has_value());
+  XCTAssertGreaterThan(sut->ApproximateBytes(), 0);
+
+  // Cleared entries are looked up again
+  sut->Clear();
+  XCTAssertFalse(sut->Get(1, false).has_value());
+  XCTAssertTrue(sut->Get(1).has_value());
+}
+
+@end
@@ -18,4 +18,14 @@
 /// This should be treated as an Abstract Base Class and not directly instantiated
 @interface SNTEndpointSecurityClient : NSObject <SNTEndpointSecurityClientBase>
 - (instancetype)init NS_UNAVAILABLE;
+
+/// Subclasses may override this to return true for AUTH messages that can be answered without
+/// significant work, such as decision cache hits. When deadline-aware scheduling is enabled,
+/// these messages are processed ahead of other pending messages. Defaults to false.
+- (bool)isFastPathMessage:(const santa::Message&)msg;
+
+/// Subclasses may override this to return YES if they can share the multiplexed ES client when
+/// it is enabled. Such clients must not invert muting and must be the only client subscribing to
+/// their AUTH events. Defaults to NO.
+- (BOOL)supportsMultiplexedClient;
 @end
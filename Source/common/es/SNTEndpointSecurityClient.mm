@@ -20,34 +20,89 @@
 #include <dispatch/dispatch.h>
 #include <mach/mach_time.h>
 #include <stdlib.h>
+#include <os/lock.h>
 #include <sys/qos.h>
 
 #include <algorithm>
+#include <queue>
 #include <set>
 #include <string>
 #include <string_view>
+#include <variant>
 
 #include "Source/common/AuditUtilities.h"
 #include "Source/common/BranchPrediction.h"
+#include "Source/common/LatencyHistogram.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
+#import "Source/common/SantaVnode.h"
+#include "Source/common/SelfProfiler.h"
+#include "Source/common/Signposts.h"
 #include "Source/common/SystemResources.h"
 #include "Source/common/es/Client.h"
 #include "Source/common/es/ESMetricsObserver.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
+#import "Source/common/es/SNTEndpointSecurityMultiplexer.h"
+#include "Source/common/es/ShardedQueue.h"
+#include "Source/common/es/Trace.h"
 #include "Source/common/faa/WatchItemPolicy.h"
+#include "absl/hash/hash.h"
 
 using santa::Client;
 using santa::EndpointSecurityAPI;
+using santa::EnrichedEventType;
 using santa::EnrichedMessage;
 using santa::ESMetricsObserver;
 using santa::EventDisposition;
 using santa::Message;
 using santa::Processor;
+using santa::SelfProfiler;
+using santa::ShardedQueue;
+using santa::TraceWriter;
+
+namespace {
+
+struct PendingAuthMessage {
+  bool fast_path;
+  uint64_t deadline;
+  uint64_t seq;
+  void (^block)(void);
+};
+
+// Fast path messages are ordered first, then earliest deadline, then arrival
+struct PendingAuthMessageCompare {
+  bool operator()(const PendingAuthMessage& lhs, const PendingAuthMessage& rhs) const {
+    if (lhs.fast_path != rhs.fast_path) {
+      return !lhs.fast_path;
+    }
+    if (lhs.deadline != rhs.deadline) {
+      return lhs.deadline > rhs.deadline;
+    }
+    return lhs.seq > rhs.seq;
+  }
+};
+
+// All clients share one trace so that it holds the messages of every client
+std::shared_ptr<TraceWriter> SharedTraceWriter(std::shared_ptr<EndpointSecurityAPI> esApi,
+                                               NSString* path) {
+  static std::shared_ptr<TraceWriter> writer;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    writer = TraceWriter::Create(esApi, path.UTF8String);
+    if (writer) {
+      LOGW(@"Recording EndpointSecurity messages to %@", path);
+    } else {
+      LOGE(@"Unable to create EndpointSecurity trace file: %@", path);
+    }
+  });
+  return writer;
+}
+
+}  // namespace
 
-@interface SNTEndpointSecurityClient ()
+@interface SNTEndpointSecurityClient () <SNTEndpointSecurityMultiplexedClient>
 @property(nonatomic) double defaultBudget;
 @property(nonatomic) int64_t minAllowedHeadroom;
 @property(nonatomic) int64_t maxAllowedHeadroom;
@@ -58,9 +113,24 @@ using santa::Processor;
   std::shared_ptr<EndpointSecurityAPI> _esApi;
   std::shared_ptr<ESMetricsObserver> _metrics;
   Client _esClient;
+  // When set, messages come from the shared client it owns and _esClient is unused
+  SNTEndpointSecurityMultiplexer* _multiplexer;
   dispatch_queue_t _authQueue;
   dispatch_queue_t _notifyQueue;
+  // When set, NOTIFY messages are handled on these serial queues instead of _notifyQueue
+  std::shared_ptr<ShardedQueue> _notifyShards;
+  // When set, AUTH messages are handled on these serial queues instead of _authQueue
+  std::shared_ptr<ShardedQueue> _authShards;
+  // When enabled, AUTH messages wait here and each block dispatched to
+  // _authQueue runs whichever message is most urgent at the time.
+  BOOL _deadlineAwareScheduling;
+  os_unfair_lock _pendingAuthLock;
+  uint64_t _pendingAuthSeq;
+  std::priority_queue<PendingAuthMessage, std::vector<PendingAuthMessage>,
+                      PendingAuthMessageCompare>
+      _pendingAuth;
   Processor _processor;
+  std::shared_ptr<TraceWriter> _traceWriter;
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
@@ -73,6 +143,11 @@ using santa::Processor;
     _configurator = [SNTConfigurator configurator];
     _processor = processor;
 
+    NSString* tracePath = _configurator.eventTracePath;
+    if (tracePath.length > 0) {
+      _traceWriter = SharedTraceWriter(_esApi, tracePath);
+    }
+
     // Default event processing budget is 80% of the deadline time
     _defaultBudget = 0.8;
 
@@ -87,10 +162,35 @@ using santa::Processor;
         dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT_WITH_AUTORELEASE_POOL,
                                                 QOS_CLASS_USER_INTERACTIVE, 0));
 
+    uint32_t shardCount = _configurator.authQueueShardCount;
+    if (shardCount > 0) {
+      _authShards = ShardedQueue::Create("com.northpolesec.santa.daemon.auth_queue.shard",
+                                         shardCount, QOS_CLASS_USER_INTERACTIVE);
+    } else {
+      _deadlineAwareScheduling = _configurator.enableDeadlineAwareAuthScheduling;
+    }
+    _pendingAuthLock = OS_UNFAIR_LOCK_INIT;
+
     _notifyQueue = dispatch_queue_create(
         "com.northpolesec.santa.daemon.notify_queue",
         dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT_WITH_AUTORELEASE_POOL,
                                                 QOS_CLASS_UTILITY, 0));
+
+    uint32_t notifyShardCount = _configurator.notifyQueueShardCount;
+    if (notifyShardCount > 0) {
+      _notifyShards = ShardedQueue::Create("com.northpolesec.santa.daemon.notify_queue.shard",
+                                           notifyShardCount, QOS_CLASS_UTILITY);
+    }
+
+    SelfProfiler& profiler = SelfProfiler::Shared();
+    profiler.RegisterQueue(_authQueue, "auth");
+    profiler.RegisterQueue(_notifyQueue, "notify");
+    for (uint32_t i = 0; _authShards && i < _authShards->NumShards(); i++) {
+      profiler.RegisterQueue(_authShards->Queue(i), "auth");
+    }
+    for (uint32_t i = 0; _notifyShards && i < _notifyShards->NumShards(); i++) {
+      profiler.RegisterQueue(_notifyShards->Queue(i), "notify");
+    }
   }
   return self;
 }
@@ -130,41 +230,78 @@ using santa::Processor;
   return false;
 }
 
+- (BOOL)supportsMultiplexedClient {
+  return NO;
+}
+
+- (const Client&)esClient {
+  return _multiplexer ? [_multiplexer client] : _esClient;
+}
+
+- (void)handleMultiplexedMessage:(Message)esMsg {
+  // The multiplexer already updated event stats for the shared client
+  [self dispatchMessage:std::move(esMsg) updateEventStats:false];
+}
+
+- (void)dispatchMessage:(Message)esMsg updateEventStats:(bool)updateEventStats {
+  int64_t processingStart = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  santa::SignpostPhase signpostPhase = esMsg->action_type == ES_ACTION_TYPE_AUTH
+                                           ? santa::SignpostPhase::kAuthEvent
+                                           : santa::SignpostPhase::kNotifyEvent;
+  os_signpost_id_t signpost = santa::BeginSignpost(signpostPhase, esMsg->global_seq_num);
+
+  // Update event stats BEFORE calling into the processor class to ensure
+  // sequence numbers are processed in order.
+  if (updateEventStats) {
+    self->_metrics->UpdateEventStats(self->_processor, esMsg->event_type, esMsg->seq_num,
+                                     esMsg->global_seq_num);
+  }
+
+  if (unlikely(self->_traceWriter)) {
+    self->_traceWriter->Record(self->_processor, esMsg);
+  }
+
+  if ([self handleContextMessage:esMsg]) {
+    int64_t processingEnd = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    self->_metrics->SetEventMetrics(self->_processor, EventDisposition::kProcessed,
+                                    processingEnd - processingStart, esMsg->event_type);
+    santa::EndSignpost(signpostPhase, signpost);
+    return;
+  }
+
+  es_event_type_t event_type = esMsg->event_type;
+  if ([self shouldHandleMessage:esMsg]) {
+    [self handleMessage:std::move(esMsg)
+        recordEventMetrics:^(EventDisposition disposition) {
+          int64_t processingEnd = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+          self->_metrics->SetEventMetrics(self->_processor, disposition,
+                                          processingEnd - processingStart, event_type);
+          santa::EndSignpost(signpostPhase, signpost);
+        }];
+  } else {
+    int64_t processingEnd = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    self->_metrics->SetEventMetrics(self->_processor, EventDisposition::kDropped,
+                                    processingEnd - processingStart, event_type);
+    santa::EndSignpost(signpostPhase, signpost);
+  }
+}
+
 - (void)establishClientOrDie {
-  if (self->_esClient.IsConnected()) {
+  if (self->_multiplexer || self->_esClient.IsConnected()) {
     // This is a programming error
     LOGE(@"Client already established. Aborting.");
     [NSException raise:@"Client already established" format:@"IsConnected already true"];
   }
 
-  self->_esClient = self->_esApi->NewClient(^(es_client_t* c, Message esMsg) {
-    int64_t processingStart = clock_gettime_nsec_np(CLOCK_MONOTONIC);
-
-    // Update event stats BEFORE calling into the processor class to ensure
-    // sequence numbers are processed in order.
-    self->_metrics->UpdateEventStats(self->_processor, esMsg->event_type, esMsg->seq_num,
-                                     esMsg->global_seq_num);
-
-    if ([self handleContextMessage:esMsg]) {
-      int64_t processingEnd = clock_gettime_nsec_np(CLOCK_MONOTONIC);
-      self->_metrics->SetEventMetrics(self->_processor, EventDisposition::kProcessed,
-                                      processingEnd - processingStart, esMsg->event_type);
-      return;
-    }
+  if (self.configurator.enableMultiplexedESClient && [self supportsMultiplexedClient]) {
+    self->_multiplexer = [SNTEndpointSecurityMultiplexer sharedMultiplexerWithESAPI:self->_esApi
+                                                                            metrics:self->_metrics];
+    LOGI(@"Connected to EndpointSecurity (%@, multiplexed)", self);
+    return;
+  }
 
-    es_event_type_t event_type = esMsg->event_type;
-    if ([self shouldHandleMessage:esMsg]) {
-      [self handleMessage:std::move(esMsg)
-          recordEventMetrics:^(EventDisposition disposition) {
-            int64_t processingEnd = clock_gettime_nsec_np(CLOCK_MONOTONIC);
-            self->_metrics->SetEventMetrics(self->_processor, disposition,
-                                            processingEnd - processingStart, event_type);
-          }];
-    } else {
-      int64_t processingEnd = clock_gettime_nsec_np(CLOCK_MONOTONIC);
-      self->_metrics->SetEventMetrics(self->_processor, EventDisposition::kDropped,
-                                      processingEnd - processingStart, event_type);
-    }
+  self->_esClient = self->_esApi->NewClient(^(es_client_t* c, Message esMsg) {
+    [self dispatchMessage:std::move(esMsg) updateEventStats:true];
   });
 
   if (!self->_esClient.IsConnected()) {
@@ -187,7 +324,7 @@ using santa::Processor;
     return false;
   }
 
-  if (!self->_esApi->MuteProcess(self->_esClient, &*tok)) {
+  if (!self->_esApi->MuteProcess([self esClient], &*tok)) {
     LOGE(@"Failed to mute this client's process.");
     return false;
   }
@@ -196,10 +333,14 @@ using santa::Processor;
 }
 
 - (bool)clearCache {
-  return _esApi->ClearCache(self->_esClient);
+  return _esApi->ClearCache([self esClient]);
 }
 
 - (bool)subscribe:(const std::set<es_event_type_t>&)events {
+  santa::ScopedSignpost signpost(santa::SignpostPhase::kESSubscribe);
+  if (_multiplexer) {
+    return [_multiplexer subscribe:events forClient:self];
+  }
   return _esApi->Subscribe(_esClient, events);
 }
 
@@ -207,50 +348,77 @@ using santa::Processor;
   return [self subscribe:events] && [self clearCache];
 }
 
+- (bool)unsubscribe:(const std::set<es_event_type_t>&)events {
+  if (_multiplexer) {
+    return [_multiplexer unsubscribe:events forClient:self];
+  }
+  return _esApi->Unsubscribe(_esClient, events);
+}
+
 - (bool)unsubscribeAll {
+  if (_multiplexer) {
+    return [_multiplexer unsubscribeAllForClient:self];
+  }
   return _esApi->UnsubscribeAll(_esClient);
 }
+
+// Mute state is client-wide, so operations that would clobber another
+// client's mutes aren't allowed on a shared client.
+- (bool)rejectForSharedClient:(SEL)sel {
+  if (_multiplexer) {
+    LOGE(@"%@ is not supported by multiplexed client %@", NSStringFromSelector(sel), self);
+    return true;
+  }
+  return false;
+}
+
 - (bool)unmuteAllPaths {
+  if ([self rejectForSharedClient:_cmd]) return false;
   return _esApi->UnmuteAllPaths(_esClient);
 }
 
 - (bool)unmuteAllTargetPaths {
+  if ([self rejectForSharedClient:_cmd]) return false;
   return _esApi->UnmuteAllTargetPaths(_esClient);
 }
 
 - (bool)unmuteProcess:(const audit_token_t*)tok {
-  return _esApi->UnmuteProcess(_esClient, tok);
+  return _esApi->UnmuteProcess([self esClient], tok);
 }
 
 - (bool)enableTargetPathWatching {
+  if ([self rejectForSharedClient:_cmd]) return false;
   [self unmuteAllTargetPaths];
   return _esApi->InvertTargetPathMuting(_esClient);
 }
 
 - (bool)enableProcessWatching {
+  if ([self rejectForSharedClient:_cmd]) return false;
   [self unmuteAllPaths];
   [self unmuteAllTargetPaths];
   return _esApi->InvertProcessMuting(_esClient);
 }
 
 - (bool)muteProcess:(const audit_token_t*)tok {
-  return _esApi->MuteProcess(_esClient, tok);
+  return _esApi->MuteProcess([self esClient], tok);
 }
 
 - (bool)muteTargetPaths:(const santa::SetPairPathAndType&)paths {
+  const Client& client = [self esClient];
   bool result = true;
   for (const auto& PairPathAndType : paths) {
     result =
-        _esApi->MuteTargetPath(_esClient, PairPathAndType.first, PairPathAndType.second) && result;
+        _esApi->MuteTargetPath(client, PairPathAndType.first, PairPathAndType.second) && result;
   }
   return result;
 }
 
 - (bool)muteTargetPaths:(const santa::SetPairPathAndType&)paths
               forEvents:(const std::set<es_event_type_t>&)events {
+  const Client& client = [self esClient];
   bool result = true;
   for (const auto& PairPathAndType : paths) {
-    result = _esApi->MuteTargetPathEvents(_esClient, PairPathAndType.first, PairPathAndType.second,
+    result = _esApi->MuteTargetPathEvents(client, PairPathAndType.first, PairPathAndType.second,
                                           events) &&
              result;
   }
@@ -258,9 +426,10 @@ using santa::Processor;
 }
 
 - (bool)unmuteTargetPaths:(const santa::SetPairPathAndType&)paths {
+  const Client& client = [self esClient];
   bool result = true;
   for (const auto& PairPathAndType : paths) {
-    result = _esApi->UnmuteTargetPath(_esClient, PairPathAndType.first, PairPathAndType.second) &&
+    result = _esApi->UnmuteTargetPath(client, PairPathAndType.first, PairPathAndType.second) &&
              result;
   }
   return result;
@@ -269,16 +438,29 @@ using santa::Processor;
 - (bool)respondToMessage:(const Message&)msg
           withAuthResult:(es_auth_result_t)result
                cacheable:(bool)cacheable {
+  santa::ScopedStageLatency latency(santa::LatencyStage::kRespond, msg->event_type);
+
+  bool res;
   if (msg->event_type == ES_EVENT_TYPE_AUTH_OPEN) {
-    return _esApi->RespondFlagsResult(
+    res = _esApi->RespondFlagsResult(
         // For now, Santa is only concerned about allowing all access or no
         // access, hence the flags being translated here to all or nothing based
         // on the auth result. In the future it might be beneficial to expand the
         // scope of Santa to enforce things like read-only access.
-        _esClient, msg, (result == ES_AUTH_RESULT_ALLOW) ? 0xffffffff : 0x0, cacheable);
+        [self esClient], msg, (result == ES_AUTH_RESULT_ALLOW) ? 0xffffffff : 0x0, cacheable);
   } else {
-    return _esApi->RespondAuthResult(_esClient, msg, result, cacheable);
+    res = _esApi->RespondAuthResult([self esClient], msg, result, cacheable);
   }
+
+  if (_metrics) {
+    uint64_t now = mach_absolute_time();
+    int64_t remainingNanos = (now < msg->deadline)
+                                 ? (int64_t)MachTimeToNanos(msg->deadline - now)
+                                 : -(int64_t)MachTimeToNanos(now - msg->deadline);
+    _metrics->SetAuthResponseBudget(_processor, msg->event_type, remainingNanos);
+  }
+
+  return res;
 }
 
 - (void)processEnrichedMessage:(std::unique_ptr<EnrichedMessage>)msg
@@ -287,18 +469,39 @@ using santa::Processor;
   // re-wrapped on the worker thread. The obvious `__block std::unique_ptr<>`
   // pattern is avoided because it shares the captured object across threads
   // and TSAN flags the byref destructor racing with the move-out on the
-  // worker. The release() and the dispatch_async must remain paired: any
-  // path that releases but does not reach the dispatch_async leaks.
+  // worker. The release() and the dispatch must remain paired: any path that
+  // releases but does not reach the dispatch leaks.
+  uint64_t shardKey = std::visit(
+      [](const EnrichedEventType& event) {
+        return absl::Hash<pid_t>{}(audit_token_to_pid(event->process->audit_token));
+      },
+      msg->GetEnrichedMessage());
   EnrichedMessage* rawMsg = msg.release();
-  dispatch_async(_notifyQueue, ^{
-    messageHandler(std::unique_ptr<EnrichedMessage>(rawMsg));
-  });
+  [self dispatchNotifyForShardKey:shardKey
+                            block:^{
+                              messageHandler(std::unique_ptr<EnrichedMessage>(rawMsg));
+                            }];
 }
 
 - (void)asynchronouslyProcess:(Message)msg handler:(void (^)(Message&&))messageHandler {
+  uint64_t shardKey = absl::Hash<pid_t>{}(audit_token_to_pid(msg->process->audit_token));
   __block Message msgTmp = std::move(msg);
-  dispatch_async(_notifyQueue, ^{
-    messageHandler(std::move(msgTmp));
+  [self dispatchNotifyForShardKey:shardKey
+                            block:^{
+                              messageHandler(std::move(msgTmp));
+                            }];
+}
+
+// Messages from the same instigating process share a shard key so that they
+// are handled in the order ES delivered them.
+- (void)dispatchNotifyForShardKey:(uint64_t)shardKey block:(void (^)(void))block {
+  if (!_notifyShards) {
+    dispatch_async(_notifyQueue, block);
+    return;
+  }
+
+  _notifyShards->Dispatch(shardKey, ^(ShardedQueue::DispatchInfo info) {
+    block();
   });
 }
 
@@ -363,15 +566,77 @@ using santa::Processor;
     dispatch_semaphore_signal(deadlineExpiredSema);
   });
 
+  // Compute scheduling inputs before the message is moved into the handler block
+  uint64_t shardKey = self->_authShards ? [self authShardKeyForMessage:msg] : 0;
+  bool fastPath = self->_deadlineAwareScheduling && [self isFastPathMessage:msg];
+  uint64_t deadline = msg->deadline;
+
   // Move the original msg into the client handler block
   __block Message tmpMsg = std::move(msg);
-  dispatch_async(self->_authQueue, ^{
+  void (^processBlock)(void) = ^{
     messageHandler(std::move(tmpMsg));
     if (dispatch_semaphore_wait(processingSema, DISPATCH_TIME_NOW) != 0) {
       // Deadline expired, wait for deadline block to finish.
       dispatch_semaphore_wait(deadlineExpiredSema, DISPATCH_TIME_FOREVER);
     }
+  };
+
+  if (self->_deadlineAwareScheduling) {
+    [self scheduleAuthBlock:processBlock fastPath:fastPath deadline:deadline];
+    return;
+  }
+
+  if (!self->_authShards) {
+    dispatch_async(self->_authQueue, processBlock);
+    return;
+  }
+
+  // NB: The deadline block above still targets the concurrent _authQueue so
+  // that a slow message never delays the deadline response of another.
+  self->_authShards->Dispatch(shardKey, ^(ShardedQueue::DispatchInfo info) {
+    if (self->_metrics) {
+      self->_metrics->SetAuthQueueMetrics(self->_processor, info.shard, info.depth,
+                                          info.wait_nanos);
+    }
+    processBlock();
   });
 }
 
+- (bool)isFastPathMessage:(const Message&)msg {
+  return false;
+}
+
+- (void)scheduleAuthBlock:(void (^)(void))block
+                 fastPath:(bool)fastPath
+                 deadline:(uint64_t)deadline {
+  os_unfair_lock_lock(&_pendingAuthLock);
+  _pendingAuth.push(PendingAuthMessage{
+      .fast_path = fastPath,
+      .deadline = deadline,
+      .seq = _pendingAuthSeq++,
+      .block = block,
+  });
+  os_unfair_lock_unlock(&_pendingAuthLock);
+
+  // Each dispatched block runs exactly one pending message, but not
+  // necessarily the one that was just added.
+  dispatch_async(_authQueue, ^{
+    os_unfair_lock_lock(&self->_pendingAuthLock);
+    void (^next)(void) = self->_pendingAuth.top().block;
+    self->_pendingAuth.pop();
+    os_unfair_lock_unlock(&self->_pendingAuthLock);
+
+    next();
+  });
+}
+
+- (uint64_t)authShardKeyForMessage:(const Message&)msg {
+  // Executions of the same binary are kept in order on a single shard. All
+  // other AUTH events are keyed by the instigating process.
+  if (msg->event_type == ES_EVENT_TYPE_AUTH_EXEC) {
+    return absl::Hash<SantaVnode>{}(SantaVnode::VnodeForFile(msg->event.exec.target->executable));
+  }
+  return absl::Hash<pid_t>{}(audit_token_to_pid(msg->process->audit_token));
+}
+
 @end
@@ -47,6 +47,7 @@
 /// subscribing mitigates this posibility.
 - (bool)subscribeAndClearCache:(const std::set<es_event_type_t>&)events;
 
+- (bool)unsubscribe:(const std::set<es_event_type_t>&)events;
 - (bool)unsubscribeAll;
 - (bool)unmuteAllTargetPaths;
 - (bool)enableTargetPathWatching;
@@ -53,6 +53,9 @@ using santa::WatchItemPathType;
     recordEventMetrics:(void (^)(santa::EventDisposition disposition))recordEventMetrics;
 - (BOOL)shouldHandleMessage:(const Message&)esMsg;
 - (int64_t)computeBudgetForDeadline:(uint64_t)deadline currentTime:(uint64_t)currentTime;
+- (void)scheduleAuthBlock:(void (^)(void))block
+                 fastPath:(bool)fastPath
+                 deadline:(uint64_t)deadline;
 
 @property(nonatomic) double defaultBudget;
 @property(nonatomic) int64_t minAllowedHeadroom;
@@ -456,6 +459,57 @@ using santa::WatchItemPathType;
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testNotifyQueueShardingKeepsProcessOrder {
+  es_file_t file = MakeESFile("foo");
+  es_process_t proc1 = MakeESProcess(&file, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_process_t proc2 = MakeESProcess(&file, MakeAuditToken(90, 12), MakeAuditToken(56, 78));
+  es_message_t esMsg1 = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc1);
+  es_message_t esMsg2 = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc2);
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  id mockConfigurator = OCMClassMock([SNTConfigurator class]);
+  OCMStub([mockConfigurator configurator]).andReturn(mockConfigurator);
+  OCMStub([mockConfigurator notifyQueueShardCount]).andReturn(4);
+
+  SNTEndpointSecurityClient* client =
+      [[SNTEndpointSecurityClient alloc] initWithESAPI:mockESApi
+                                               metrics:nullptr
+                                             processor:Processor::kUnknown];
+
+  const int kNumMessages = 200;
+  dispatch_group_t group = dispatch_group_create();
+  NSMutableArray<NSNumber*>* seen1 = [NSMutableArray array];
+  NSMutableArray<NSNumber*>* seen2 = [NSMutableArray array];
+
+  for (int i = 0; i < kNumMessages; i++) {
+    bool first = (i % 2 == 0);
+    NSMutableArray<NSNumber*>* seen = first ? seen1 : seen2;
+    dispatch_group_enter(group);
+    [client asynchronouslyProcess:Message(mockESApi, first ? &esMsg1 : &esMsg2)
+                          handler:^(Message&& msg) {
+                            // Messages for each process run on one serial queue at a time
+                            [seen addObject:@(i)];
+                            dispatch_group_leave(group);
+                          }];
+  }
+
+  XCTAssertEqual(
+      0, dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)),
+      "Handler blocks not called within expected time window");
+
+  for (NSArray<NSNumber*>* seen in @[ seen1, seen2 ]) {
+    XCTAssertEqual(seen.count, kNumMessages / 2);
+    for (NSUInteger i = 1; i < seen.count; i++) {
+      XCTAssertLessThan(seen[i - 1].intValue, seen[i].intValue);
+    }
+  }
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+  [mockConfigurator stopMocking];
+}
+
 - (void)testProcessMessageHandlerBadEventType {
   es_file_t proc_file = MakeESFile("foo");
   es_process_t proc = MakeESProcess(&proc_file);
@@ -552,6 +606,51 @@ using santa::WatchItemPathType;
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testScheduleAuthBlockOrdering {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+
+  SNTEndpointSecurityClient* client =
+      [[SNTEndpointSecurityClient alloc] initWithESAPI:mockESApi
+                                               metrics:nullptr
+                                             processor:Processor::kUnknown];
+
+  // Swap in a suspended serial queue so that all blocks are pending before
+  // the first one runs and the order they run in is deterministic.
+  dispatch_queue_t q = dispatch_queue_create(NULL, DISPATCH_QUEUE_SERIAL);
+  dispatch_suspend(q);
+  [client setValue:q forKey:@"_authQueue"];
+
+  NSMutableArray<NSNumber*>* order = [NSMutableArray array];
+  dispatch_group_t group = dispatch_group_create();
+  uint64_t now = mach_absolute_time();
+
+  void (^schedule)(int, bool, uint64_t) = ^(int ident, bool fastPath, uint64_t deadlineMS) {
+    dispatch_group_enter(group);
+    [client
+        scheduleAuthBlock:^{
+          [order addObject:@(ident)];
+          dispatch_group_leave(group);
+        }
+                 fastPath:fastPath
+                 deadline:AddNanosecondsToMachTime(deadlineMS * NSEC_PER_MSEC, now)];
+  };
+
+  schedule(1, false, 30000);
+  schedule(2, false, 10000);
+  schedule(3, true, 60000);
+  schedule(4, false, 10000);
+  schedule(5, false, 20000);
+  schedule(6, true, 5000);
+
+  dispatch_resume(q);
+
+  XCTAssertEqual(0, dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+
+  // Fast path first by deadline, then earliest deadline, then arrival order
+  NSArray* want = @[ @6, @3, @2, @4, @5, @1 ];
+  XCTAssertEqualObjects(order, want);
+}
+
 - (void)checkDeadlineExpiredFailClosed:(BOOL)shouldFailClosed {
   // Set a es_message_t deadline of 750ms
   // Set a deadline leeway in the `SNTEndpointSecurityClient` of 500ms
@@ -0,0 +1,71 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include <EndpointSecurity/EndpointSecurity.h>
+
+#include <memory>
+#include <set>
+
+#import <Foundation/Foundation.h>
+
+#include "Source/common/es/Client.h"
+#include "Source/common/es/ESMetricsObserver.h"
+#include "Source/common/es/EndpointSecurityAPI.h"
+#include "Source/common/es/Message.h"
+
+/// Implemented by clients that can receive their messages from a multiplexer.
+@protocol SNTEndpointSecurityMultiplexedClient <NSObject>
+
+/// Called on the shared client's handler, in delivery order, for each message of an event type
+/// the client subscribed to. Every interested client gets its own reference to the same message.
+- (void)handleMultiplexedMessage:(santa::Message)esMsg;
+
+@end
+
+/// Owns one ES client that several subsystems share. It subscribes to the union of the events
+/// its clients want and routes each message to the clients interested in its event type.
+///
+/// Mute state belongs to the shared ES client, so clients that invert muting must not share
+/// one. Each AUTH event type can have only one client, since a message can only be responded
+/// to once.
+@interface SNTEndpointSecurityMultiplexer : NSObject
+
+/// Returns the multiplexer shared by every client in this process, establishing its ES client
+/// the first time it is called and raising an exception if that fails.
++ (instancetype)sharedMultiplexerWithESAPI:(std::shared_ptr<santa::EndpointSecurityAPI>)esApi
+                                   metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics;
+
+- (instancetype)initWithESAPI:(std::shared_ptr<santa::EndpointSecurityAPI>)esApi
+                      metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// @note Raises an exception if the ES client can't be created or muted from its own process.
+- (void)establishClientOrDie;
+
+- (const santa::Client&)client;
+
+/// Routes `events` to `client`, subscribing the shared ES client to any not already in use.
+/// Fails without changing anything if another client already has one of the AUTH events.
+- (bool)subscribe:(const std::set<es_event_type_t>&)events
+        forClient:(id<SNTEndpointSecurityMultiplexedClient>)client;
+
+/// Stops routing `events` to `client`. The shared ES client is unsubscribed from events that no
+/// client wants anymore.
+- (bool)unsubscribe:(const std::set<es_event_type_t>&)events
+          forClient:(id<SNTEndpointSecurityMultiplexedClient>)client;
+
+- (bool)unsubscribeAllForClient:(id<SNTEndpointSecurityMultiplexedClient>)client;
+
+@end
@@ -0,0 +1,240 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/common/es/SNTEndpointSecurityMultiplexer.h"
+
+#include <bsm/libbsm.h>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include "Source/common/AuditUtilities.h"
+#import "Source/common/SNTLogging.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+using santa::Client;
+using santa::EndpointSecurityAPI;
+using santa::ESMetricsObserver;
+using santa::Message;
+
+namespace {
+
+bool IsAuthEventType(es_event_type_t event_type) {
+  switch (event_type) {
+    case ES_EVENT_TYPE_AUTH_EXEC:
+    case ES_EVENT_TYPE_AUTH_OPEN:
+    case ES_EVENT_TYPE_AUTH_KEXTLOAD:
+    case ES_EVENT_TYPE_AUTH_MMAP:
+    case ES_EVENT_TYPE_AUTH_MPROTECT:
+    case ES_EVENT_TYPE_AUTH_MOUNT:
+    case ES_EVENT_TYPE_AUTH_RENAME:
+    case ES_EVENT_TYPE_AUTH_SIGNAL:
+    case ES_EVENT_TYPE_AUTH_UNLINK:
+    case ES_EVENT_TYPE_AUTH_FILE_PROVIDER_MATERIALIZE:
+    case ES_EVENT_TYPE_AUTH_FILE_PROVIDER_UPDATE:
+    case ES_EVENT_TYPE_AUTH_READLINK:
+    case ES_EVENT_TYPE_AUTH_TRUNCATE:
+    case ES_EVENT_TYPE_AUTH_LINK:
+    case ES_EVENT_TYPE_AUTH_CREATE:
+    case ES_EVENT_TYPE_AUTH_SETATTRLIST:
+    case ES_EVENT_TYPE_AUTH_SETEXTATTR:
+    case ES_EVENT_TYPE_AUTH_SETFLAGS:
+    case ES_EVENT_TYPE_AUTH_SETMODE:
+    case ES_EVENT_TYPE_AUTH_SETOWNER:
+    case ES_EVENT_TYPE_AUTH_CHDIR:
+    case ES_EVENT_TYPE_AUTH_GETATTRLIST:
+    case ES_EVENT_TYPE_AUTH_GETEXTATTR:
+    case ES_EVENT_TYPE_AUTH_LISTEXTATTR:
+    case ES_EVENT_TYPE_AUTH_READDIR:
+    case ES_EVENT_TYPE_AUTH_DELETEEXTATTR:
+    case ES_EVENT_TYPE_AUTH_CHROOT:
+    case ES_EVENT_TYPE_AUTH_UTIMES:
+    case ES_EVENT_TYPE_AUTH_CLONE:
+    case ES_EVENT_TYPE_AUTH_FSGETPATH:
+    case ES_EVENT_TYPE_AUTH_REMOUNT:
+    case ES_EVENT_TYPE_AUTH_GET_TASK:
+    case ES_EVENT_TYPE_AUTH_SETTIME:
+    case ES_EVENT_TYPE_AUTH_UIPC_BIND:
+    case ES_EVENT_TYPE_AUTH_UIPC_CONNECT:
+    case ES_EVENT_TYPE_AUTH_EXCHANGEDATA:
+    case ES_EVENT_TYPE_AUTH_SETACL:
+    case ES_EVENT_TYPE_AUTH_PROC_CHECK:
+    case ES_EVENT_TYPE_AUTH_GET_TASK_READ:
+    case ES_EVENT_TYPE_AUTH_SEARCHFS:
+    case ES_EVENT_TYPE_AUTH_FCNTL:
+    case ES_EVENT_TYPE_AUTH_IOKIT_OPEN:
+    case ES_EVENT_TYPE_AUTH_PROC_SUSPEND_RESUME:
+    case ES_EVENT_TYPE_AUTH_COPYFILE: return true;
+    default: return false;
+  }
+}
+
+}  // namespace
+
+@implementation SNTEndpointSecurityMultiplexer {
+  std::shared_ptr<EndpointSecurityAPI> _esApi;
+  std::shared_ptr<ESMetricsObserver> _metrics;
+  Client _esClient;
+  absl::Mutex _clientsMutex;
+  // Clients interested in each event type, in the order they subscribed
+  absl::flat_hash_map<es_event_type_t, std::vector<id<SNTEndpointSecurityMultiplexedClient>>>
+      _clients ABSL_GUARDED_BY(_clientsMutex);
+}
+
++ (instancetype)sharedMultiplexerWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
+                                   metrics:(std::shared_ptr<ESMetricsObserver>)metrics {
+  static SNTEndpointSecurityMultiplexer* multiplexer;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    multiplexer = [[SNTEndpointSecurityMultiplexer alloc] initWithESAPI:esApi metrics:metrics];
+    [multiplexer establishClientOrDie];
+  });
+  return multiplexer;
+}
+
+- (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
+                      metrics:(std::shared_ptr<ESMetricsObserver>)metrics {
+  self = [super init];
+  if (self) {
+    _esApi = std::move(esApi);
+    _metrics = std::move(metrics);
+  }
+  return self;
+}
+
+- (const Client&)client {
+  return _esClient;
+}
+
+- (void)establishClientOrDie {
+  if (_esClient.IsConnected()) {
+    // This is a programming error
+    LOGE(@"Multiplexed client already established. Aborting.");
+    [NSException raise:@"Client already established" format:@"IsConnected already true"];
+  }
+
+  _esClient = _esApi->NewClient(^(es_client_t* c, Message esMsg) {
+    // Sequence numbers belong to the shared client, so drops are counted here rather than by
+    // each client, which only sees some of the messages.
+    if (self->_metrics) {
+      self->_metrics->UpdateEventStats(santa::Processor::kMultiplexer, esMsg->event_type,
+                                       esMsg->seq_num, esMsg->global_seq_num);
+    }
+
+    std::vector<id<SNTEndpointSecurityMultiplexedClient>> clients;
+    {
+      absl::ReaderMutexLock lock(&self->_clientsMutex);
+      auto it = self->_clients.find(esMsg->event_type);
+      if (it != self->_clients.end()) {
+        clients = it->second;
+      }
+    }
+
+    if (clients.empty()) {
+      // Messages already queued when the last client unsubscribed can still arrive
+      if (esMsg->action_type == ES_ACTION_TYPE_AUTH) {
+        if (esMsg->event_type == ES_EVENT_TYPE_AUTH_OPEN) {
+          self->_esApi->RespondFlagsResult(self->_esClient, esMsg, 0xffffffff, false);
+        } else {
+          self->_esApi->RespondAuthResult(self->_esClient, esMsg, ES_AUTH_RESULT_ALLOW, false);
+        }
+      }
+      return;
+    }
+
+    for (id<SNTEndpointSecurityMultiplexedClient> client : clients) {
+      [client handleMultiplexedMessage:esMsg];
+    }
+  });
+
+  if (!_esClient.IsConnected()) {
+    LOGE(@"Unable to create multiplexed EndpointSecurity client: %d", _esClient.NewClientResult());
+    [NSException raise:@"Failed to create ES client"
+                format:@"es_new_client result: %d", _esClient.NewClientResult()];
+  }
+  LOGI(@"Connected to EndpointSecurity (multiplexed)");
+
+  std::optional<audit_token_t> tok = santa::GetMyAuditToken();
+  if (!tok.has_value() || !_esApi->MuteProcess(_esClient, &*tok)) {
+    [NSException raise:@"ES Mute Failure" format:@"Failed to mute self"];
+  }
+}
+
+- (bool)subscribe:(const std::set<es_event_type_t>&)events
+        forClient:(id<SNTEndpointSecurityMultiplexedClient>)client {
+  absl::MutexLock lock(&_clientsMutex);
+
+  std::set<es_event_type_t> added;
+  for (es_event_type_t event : events) {
+    auto it = _clients.find(event);
+    if (it == _clients.end() || it->second.empty()) {
+      added.insert(event);
+    } else if (IsAuthEventType(event) &&
+               std::find(it->second.begin(), it->second.end(), client) == it->second.end()) {
+      LOGE(@"Unable to share AUTH event %d with %@, it is already handled by %@", event, client,
+           it->second.front());
+      return false;
+    }
+  }
+
+  if (!added.empty() && !_esApi->Subscribe(_esClient, added)) {
+    return false;
+  }
+
+  for (es_event_type_t event : events) {
+    std::vector<id<SNTEndpointSecurityMultiplexedClient>>& clients = _clients[event];
+    if (std::find(clients.begin(), clients.end(), client) == clients.end()) {
+      clients.push_back(client);
+    }
+  }
+  return true;
+}
+
+- (bool)unsubscribe:(const std::set<es_event_type_t>&)events
+          forClient:(id<SNTEndpointSecurityMultiplexedClient>)client {
+  absl::MutexLock lock(&_clientsMutex);
+
+  std::set<es_event_type_t> removed;
+  for (es_event_type_t event : events) {
+    auto it = _clients.find(event);
+    if (it == _clients.end()) continue;
+
+    std::erase(it->second, client);
+    if (it->second.empty()) {
+      _clients.erase(it);
+      removed.insert(event);
+    }
+  }
+
+  return removed.empty() || _esApi->Unsubscribe(_esClient, removed);
+}
+
+- (bool)unsubscribeAllForClient:(id<SNTEndpointSecurityMultiplexedClient>)client {
+  std::set<es_event_type_t> events;
+  {
+    absl::ReaderMutexLock lock(&_clientsMutex);
+    for (const auto& [event, clients] : _clients) {
+      if (std::find(clients.begin(), clients.end(), client) != clients.end()) {
+        events.insert(event);
+      }
+    }
+  }
+  return [self unsubscribe:events forClient:client];
+}
+
+@end
@@ -0,0 +1,162 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#import <XCTest/XCTest.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <set>
+
+#include "Source/common/TestUtils.h"
+#include "Source/common/es/Client.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/es/MockEndpointSecurityAPI.h"
+#import "Source/common/es/SNTEndpointSecurityMultiplexer.h"
+
+using santa::Client;
+using santa::Message;
+
+@interface MultiplexedTestClient : NSObject <SNTEndpointSecurityMultiplexedClient>
+@property int handled;
+@end
+
+@implementation MultiplexedTestClient
+- (void)handleMultiplexedMessage:(Message)esMsg {
+  self.handled++;
+}
+@end
+
+@interface SNTEndpointSecurityMultiplexerTest : XCTestCase
+@property std::shared_ptr<MockEndpointSecurityAPI> mockESApi;
+@property SNTEndpointSecurityMultiplexer* sut;
+@property(copy) void (^handler)(es_client_t*, Message);
+@end
+
+@implementation SNTEndpointSecurityMultiplexerTest
+
+- (void)setUp {
+  self.mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  self.mockESApi->SetExpectationsRetainReleaseMessage();
+
+  EXPECT_CALL(*self.mockESApi, NewClient)
+      .WillOnce([self](void (^handler)(es_client_t*, Message)) {
+        self.handler = handler;
+        return Client(nullptr, ES_NEW_CLIENT_RESULT_SUCCESS);
+      });
+  EXPECT_CALL(*self.mockESApi, MuteProcess).WillOnce(testing::Return(true));
+
+  self.sut = [[SNTEndpointSecurityMultiplexer alloc] initWithESAPI:self.mockESApi metrics:nullptr];
+  [self.sut establishClientOrDie];
+}
+
+- (void)tearDown {
+  XCTBubbleMockVerifyAndClearExpectations(self.mockESApi.get());
+}
+
+- (void)deliver:(es_event_type_t)eventType {
+  es_file_t file = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&file);
+  es_message_t esMsg = MakeESMessage(eventType, &proc);
+  self.handler(nullptr, Message(self.mockESApi, &esMsg));
+}
+
+- (void)testRoutesToInterestedClients {
+  MultiplexedTestClient* a = [[MultiplexedTestClient alloc] init];
+  MultiplexedTestClient* b = [[MultiplexedTestClient alloc] init];
+
+  EXPECT_CALL(*self.mockESApi, Subscribe(testing::_, std::set<es_event_type_t>{
+                                                         ES_EVENT_TYPE_NOTIFY_EXIT,
+                                                         ES_EVENT_TYPE_NOTIFY_FORK,
+                                                     }))
+      .WillOnce(testing::Return(true));
+  EXPECT_CALL(*self.mockESApi,
+              Subscribe(testing::_, std::set<es_event_type_t>{ES_EVENT_TYPE_NOTIFY_CLOSE}))
+      .WillOnce(testing::Return(true));
+
+  XCTAssertTrue(([self.sut subscribe:{ES_EVENT_TYPE_NOTIFY_FORK, ES_EVENT_TYPE_NOTIFY_EXIT}
+                           forClient:a]));
+  // Only the event not already in use is added to the shared client
+  XCTAssertTrue(([self.sut subscribe:{ES_EVENT_TYPE_NOTIFY_FORK, ES_EVENT_TYPE_NOTIFY_CLOSE}
+                           forClient:b]));
+
+  [self deliver:ES_EVENT_TYPE_NOTIFY_FORK];
+  XCTAssertEqual(a.handled, 1);
+  XCTAssertEqual(b.handled, 1);
+
+  [self deliver:ES_EVENT_TYPE_NOTIFY_EXIT];
+  XCTAssertEqual(a.handled, 2);
+  XCTAssertEqual(b.handled, 1);
+
+  [self deliver:ES_EVENT_TYPE_NOTIFY_CLOSE];
+  XCTAssertEqual(a.handled, 2);
+  XCTAssertEqual(b.handled, 2);
+}
+
+- (void)testAuthEventsHaveOneOwner {
+  MultiplexedTestClient* a = [[MultiplexedTestClient alloc] init];
+  MultiplexedTestClient* b = [[MultiplexedTestClient alloc] init];
+
+  EXPECT_CALL(*self.mockESApi, Subscribe).WillOnce(testing::Return(true));
+
+  XCTAssertTrue([self.sut subscribe:{ES_EVENT_TYPE_AUTH_EXEC} forClient:a]);
+  XCTAssertFalse(([self.sut subscribe:{ES_EVENT_TYPE_NOTIFY_FORK, ES_EVENT_TYPE_AUTH_EXEC}
+                            forClient:b]));
+
+  // The failed subscription didn't route anything to the second client
+  [self deliver:ES_EVENT_TYPE_AUTH_EXEC];
+  XCTAssertEqual(a.handled, 1);
+  XCTAssertEqual(b.handled, 0);
+
+  // Resubscribing the owner is fine
+  XCTAssertTrue([self.sut subscribe:{ES_EVENT_TYPE_AUTH_EXEC} forClient:a]);
+  [self deliver:ES_EVENT_TYPE_AUTH_EXEC];
+  XCTAssertEqual(a.handled, 2);
+}
+
+- (void)testUnsubscribeOnlyWhenUnused {
+  MultiplexedTestClient* a = [[MultiplexedTestClient alloc] init];
+  MultiplexedTestClient* b = [[MultiplexedTestClient alloc] init];
+
+  EXPECT_CALL(*self.mockESApi, Subscribe).WillOnce(testing::Return(true));
+  XCTAssertTrue([self.sut subscribe:{ES_EVENT_TYPE_NOTIFY_FORK} forClient:a]);
+  XCTAssertTrue([self.sut subscribe:{ES_EVENT_TYPE_NOTIFY_FORK} forClient:b]);
+
+  // Another client still wants the event
+  EXPECT_CALL(*self.mockESApi, Unsubscribe).Times(0);
+  XCTAssertTrue([self.sut unsubscribeAllForClient:a]);
+  XCTBubbleMockVerifyAndClearExpectations(self.mockESApi.get());
+
+  [self deliver:ES_EVENT_TYPE_NOTIFY_FORK];
+  XCTAssertEqual(a.handled, 0);
+  XCTAssertEqual(b.handled, 1);
+
+  EXPECT_CALL(*self.mockESApi, Unsubscribe(testing::_, std::set<es_event_type_t>{
+                                                           ES_EVENT_TYPE_NOTIFY_FORK,
+                                                       }))
+      .WillOnce(testing::Return(true));
+  XCTAssertTrue([self.sut unsubscribe:{ES_EVENT_TYPE_NOTIFY_FORK} forClient:b]);
+}
+
+- (void)testUnclaimedAuthMessagesAreAllowed {
+  EXPECT_CALL(*self.mockESApi,
+              RespondAuthResult(testing::_, testing::_, ES_AUTH_RESULT_ALLOW, false))
+      .WillOnce(testing::Return(true));
+
+  [self deliver:ES_EVENT_TYPE_AUTH_EXEC];
+}
+
+@end
@@ -0,0 +1,97 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_ES_SHARDEDQUEUE_H
+#define SANTA_COMMON_ES_SHARDEDQUEUE_H
+
+#include <dispatch/dispatch.h>
+#include <os/lock.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace santa {
+
+// Spreads work across a fixed set of serial dispatch queues.
+//
+// Blocks dispatched with the same key always run in the order they were
+// dispatched. A key sticks to one shard for as long as it has outstanding
+// work, after which it may be placed on a different shard. New keys go to
+// their home shard unless that shard is currently stuck on a block that has
+// been running for longer than the stall threshold, in which case the least
+// loaded shard that is not stalled is used instead.
+class ShardedQueue : public std::enable_shared_from_this<ShardedQueue> {
+ public:
+  // Scheduling details passed to each dispatched block
+  struct DispatchInfo {
+    uint32_t shard;
+    // Number of blocks on the shard, including the running one
+    int64_t depth;
+    // Time between the block being dispatched and it starting to run
+    int64_t wait_nanos;
+  };
+
+  static constexpr uint64_t kDefaultStallThresholdNanos = 50 * NSEC_PER_MSEC;
+
+  static std::shared_ptr<ShardedQueue> Create(
+      const char* label, uint32_t num_shards, dispatch_qos_class_t qos,
+      uint64_t stall_threshold_nanos = kDefaultStallThresholdNanos);
+
+  ShardedQueue(const char* label, uint32_t num_shards,
+               dispatch_qos_class_t qos, uint64_t stall_threshold_nanos);
+
+  ShardedQueue(ShardedQueue&& other) = delete;
+  ShardedQueue& operator=(ShardedQueue&& rhs) = delete;
+  ShardedQueue(const ShardedQueue& other) = delete;
+  ShardedQueue& operator=(const ShardedQueue& other) = delete;
+
+  void Dispatch(uint64_t key, void (^block)(DispatchInfo info));
+
+  uint32_t NumShards() const { return (uint32_t)shards_.size(); }
+
+  dispatch_queue_t Queue(uint32_t shard) const { return shards_[shard].queue; }
+
+  // Current number of blocks queued or running on the given shard
+  int64_t Depth(uint32_t shard);
+
+ private:
+  struct Shard {
+    dispatch_queue_t queue;
+    int64_t depth = 0;
+    // Mach time the running block started, or 0 when idle
+    uint64_t running_since = 0;
+  };
+
+  struct KeyState {
+    uint32_t shard;
+    uint64_t pending;
+  };
+
+  uint32_t SelectShardLocked(uint64_t key, uint64_t now);
+  bool IsStalledLocked(const Shard& shard, uint64_t now) const;
+  void Started(uint32_t shard, uint64_t now, int64_t* depth);
+  void Finished(uint64_t key, uint32_t shard);
+
+  os_unfair_lock lock_ = OS_UNFAIR_LOCK_INIT;
+  std::vector<Shard> shards_;
+  absl::flat_hash_map<uint64_t, KeyState> keys_;
+  uint64_t stall_threshold_mach_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_ES_SHARDEDQUEUE_H
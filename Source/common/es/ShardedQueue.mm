@@ -0,0 +1,125 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/es/ShardedQueue.h"
+
+#include <mach/mach_time.h>
+
+#include <algorithm>
+#include <string>
+
+#include "Source/common/SystemResources.h"
+#include "absl/hash/hash.h"
+
+namespace santa {
+
+std::shared_ptr<ShardedQueue> ShardedQueue::Create(const char* label, uint32_t num_shards,
+                                                   dispatch_qos_class_t qos,
+                                                   uint64_t stall_threshold_nanos) {
+  return std::make_shared<ShardedQueue>(label, num_shards, qos, stall_threshold_nanos);
+}
+
+ShardedQueue::ShardedQueue(const char* label, uint32_t num_shards, dispatch_qos_class_t qos,
+                           uint64_t stall_threshold_nanos)
+    : stall_threshold_mach_(NanosToMachTime(stall_threshold_nanos)) {
+  num_shards = std::max(num_shards, 1u);
+  shards_.resize(num_shards);
+  for (uint32_t i = 0; i < num_shards; i++) {
+    std::string shard_label = std::string(label) + "." + std::to_string(i);
+    shards_[i].queue = dispatch_queue_create(
+        shard_label.c_str(),
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL, qos,
+                                                0));
+  }
+}
+
+bool ShardedQueue::IsStalledLocked(const Shard& shard, uint64_t now) const {
+  return shard.running_since != 0 && now - shard.running_since > stall_threshold_mach_;
+}
+
+uint32_t ShardedQueue::SelectShardLocked(uint64_t key, uint64_t now) {
+  auto it = keys_.find(key);
+  if (it != keys_.end()) {
+    // Outstanding work for this key must finish first to preserve ordering
+    it->second.pending++;
+    return it->second.shard;
+  }
+
+  uint32_t shard = (uint32_t)(absl::Hash<uint64_t>{}(key) % shards_.size());
+  if (IsStalledLocked(shards_[shard], now)) {
+    int64_t best_depth = INT64_MAX;
+    for (uint32_t i = 0; i < shards_.size(); i++) {
+      if (!IsStalledLocked(shards_[i], now) && shards_[i].depth < best_depth) {
+        best_depth = shards_[i].depth;
+        shard = i;
+      }
+    }
+  }
+
+  keys_.emplace(key, KeyState{.shard = shard, .pending = 1});
+  return shard;
+}
+
+void ShardedQueue::Dispatch(uint64_t key, void (^block)(DispatchInfo info)) {
+  uint64_t enqueue_time = mach_absolute_time();
+
+  os_unfair_lock_lock(&lock_);
+  uint32_t shard = SelectShardLocked(key, enqueue_time);
+  shards_[shard].depth++;
+  dispatch_queue_t queue = shards_[shard].queue;
+  os_unfair_lock_unlock(&lock_);
+
+  // Keep the shards alive until every dispatched block has run
+  std::shared_ptr<ShardedQueue> self = shared_from_this();
+  dispatch_async(queue, ^{
+    uint64_t start_time = mach_absolute_time();
+    int64_t depth;
+    self->Started(shard, start_time, &depth);
+
+    block(DispatchInfo{
+        .shard = shard,
+        .depth = depth,
+        .wait_nanos = (int64_t)MachTimeToNanos(start_time - enqueue_time),
+    });
+
+    self->Finished(key, shard);
+  });
+}
+
+void ShardedQueue::Started(uint32_t shard, uint64_t now, int64_t* depth) {
+  os_unfair_lock_lock(&lock_);
+  shards_[shard].running_since = now;
+  *depth = shards_[shard].depth;
+  os_unfair_lock_unlock(&lock_);
+}
+
+void ShardedQueue::Finished(uint64_t key, uint32_t shard) {
+  os_unfair_lock_lock(&lock_);
+  shards_[shard].depth--;
+  shards_[shard].running_since = 0;
+  auto it = keys_.find(key);
+  if (it != keys_.end() && --it->second.pending == 0) {
+    keys_.erase(it);
+  }
+  os_unfair_lock_unlock(&lock_);
+}
+
+int64_t ShardedQueue::Depth(uint32_t shard) {
+  os_unfair_lock_lock(&lock_);
+  int64_t depth = shard < shards_.size() ? shards_[shard].depth : 0;
+  os_unfair_lock_unlock(&lock_);
+  return depth;
+}
+
+}  // namespace santa
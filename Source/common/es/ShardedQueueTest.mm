@@ -0,0 +1,152 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/es/ShardedQueue.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+using santa::ShardedQueue;
+
+@interface ShardedQueueTest : XCTestCase
+@end
+
+@implementation ShardedQueueTest
+
+- (void)testShardCountIsAtLeastOne {
+  auto sut = ShardedQueue::Create("test", 0, QOS_CLASS_DEFAULT);
+  XCTAssertEqual(sut->NumShards(), 1);
+}
+
+- (void)testBlocksWithSameKeyRunInOrder {
+  auto sut = ShardedQueue::Create("test", 4, QOS_CLASS_DEFAULT);
+  const int kKeys = 8;
+  const int kPerKey = 200;
+
+  auto seen = std::make_shared<std::vector<std::vector<int>>>(kKeys);
+  dispatch_group_t group = dispatch_group_create();
+
+  for (int i = 0; i < kPerKey; i++) {
+    for (int key = 0; key < kKeys; key++) {
+      dispatch_group_enter(group);
+      sut->Dispatch(key, ^(ShardedQueue::DispatchInfo info) {
+        // Each key is only ever touched from a single serial queue at a time
+        (*seen)[key].push_back(i);
+        dispatch_group_leave(group);
+      });
+    }
+  }
+
+  XCTAssertEqual(0, dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)),
+                 @"Timed out");
+
+  for (int key = 0; key < kKeys; key++) {
+    XCTAssertEqual((*seen)[key].size(), kPerKey);
+    for (int i = 0; i < kPerKey; i++) {
+      XCTAssertEqual((*seen)[key][i], i);
+    }
+  }
+
+  for (uint32_t i = 0; i < sut->NumShards(); i++) {
+    XCTAssertEqual(sut->Depth(i), 0);
+  }
+}
+
+- (void)testStalledShardIsAvoided {
+  auto sut = ShardedQueue::Create("test", 2, QOS_CLASS_DEFAULT, 10 * NSEC_PER_MSEC);
+
+  dispatch_semaphore_t started = dispatch_semaphore_create(0);
+  dispatch_semaphore_t release = dispatch_semaphore_create(0);
+  __block uint32_t stalledShard;
+
+  sut->Dispatch(1, ^(ShardedQueue::DispatchInfo info) {
+    stalledShard = info.shard;
+    dispatch_semaphore_signal(started);
+    dispatch_semaphore_wait(release, DISPATCH_TIME_FOREVER);
+  });
+
+  XCTAssertEqual(0, dispatch_semaphore_wait(started,
+                                            dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+
+  // Give the running block time to exceed the stall threshold
+  usleep(50 * 1000);
+
+  // New keys must all complete while the first shard is still blocked
+  const int kNewKeys = 16;
+  dispatch_group_t group = dispatch_group_create();
+  __block int onStalledShard = 0;
+  for (int key = 2; key < 2 + kNewKeys; key++) {
+    dispatch_group_enter(group);
+    sut->Dispatch(key, ^(ShardedQueue::DispatchInfo info) {
+      if (info.shard == stalledShard) {
+        onStalledShard++;
+      }
+      dispatch_group_leave(group);
+    });
+  }
+
+  XCTAssertEqual(0, dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+  XCTAssertEqual(onStalledShard, 0);
+  XCTAssertEqual(sut->Depth(stalledShard), 1);
+
+  // Additional work for the stalled key stays behind it
+  dispatch_semaphore_t done = dispatch_semaphore_create(0);
+  __block uint32_t followupShard = UINT32_MAX;
+  sut->Dispatch(1, ^(ShardedQueue::DispatchInfo info) {
+    followupShard = info.shard;
+    dispatch_semaphore_signal(done);
+  });
+
+  XCTAssertNotEqual(0, dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW,
+                                                                   50 * NSEC_PER_MSEC)));
+  dispatch_semaphore_signal(release);
+  XCTAssertEqual(0,
+                 dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+  XCTAssertEqual(followupShard, stalledShard);
+}
+
+- (void)testDispatchInfoReportsDepthAndWait {
+  auto sut = ShardedQueue::Create("test", 1, QOS_CLASS_DEFAULT);
+
+  dispatch_semaphore_t release = dispatch_semaphore_create(0);
+  dispatch_group_t group = dispatch_group_create();
+  __block ShardedQueue::DispatchInfo lastInfo;
+
+  dispatch_group_enter(group);
+  sut->Dispatch(1, ^(ShardedQueue::DispatchInfo info) {
+    dispatch_semaphore_wait(release, DISPATCH_TIME_FOREVER);
+    dispatch_group_leave(group);
+  });
+
+  dispatch_group_enter(group);
+  sut->Dispatch(2, ^(ShardedQueue::DispatchInfo info) {
+    lastInfo = info;
+    dispatch_group_leave(group);
+  });
+
+  usleep(20 * 1000);
+  XCTAssertEqual(sut->Depth(0), 2);
+  dispatch_semaphore_signal(release);
+
+  XCTAssertEqual(0, dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+  XCTAssertEqual(lastInfo.shard, 0);
+  XCTAssertEqual(lastInfo.depth, 1);
+  XCTAssertGreaterThanOrEqual(lastInfo.wait_nanos, 20 * NSEC_PER_MSEC);
+}
+
+@end
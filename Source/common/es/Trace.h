@@ -0,0 +1,145 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_ES_TRACE_H
+#define SANTA_COMMON_ES_TRACE_H
+
+#include <EndpointSecurity/EndpointSecurity.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Source/common/es/ESMetricsObserver.h"
+#include "Source/common/es/EndpointSecurityAPI.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/es/es_trace.pb.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+namespace santa {
+
+// Records ES messages to a trace file so that a workload seen on a live
+// system can be replayed against santad's clients elsewhere. Only exec, fork,
+// exit, open, close and rename messages are traced. Records are buffered and
+// written once enough have accumulated or a second has passed since the last
+// write, so the tail of a trace can be lost if the process is killed.
+class TraceWriter {
+ public:
+  // Returns nullptr if the trace file can't be created
+  static std::unique_ptr<TraceWriter> Create(
+      std::shared_ptr<EndpointSecurityAPI> esapi, const char* path);
+
+  TraceWriter(std::shared_ptr<EndpointSecurityAPI> esapi, int fd);
+  ~TraceWriter();
+
+  TraceWriter(TraceWriter&& other) = delete;
+  TraceWriter& operator=(TraceWriter&& rhs) = delete;
+  TraceWriter(const TraceWriter& other) = delete;
+  TraceWriter& operator=(const TraceWriter& other) = delete;
+
+  static bool IsTraceable(es_event_type_t event_type);
+
+  // Append `msg` as received by the client for `processor`. Messages that
+  // aren't traceable are ignored.
+  void Record(Processor processor, const Message& msg);
+
+  void Flush();
+
+ private:
+  void FlushLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_);
+
+  std::shared_ptr<EndpointSecurityAPI> esapi_;
+  absl::Mutex mtx_;
+  int fd_ ABSL_GUARDED_BY(mtx_);
+  std::string buffer_ ABSL_GUARDED_BY(mtx_);
+  uint64_t first_mach_time_ ABSL_GUARDED_BY(mtx_) = 0;
+  uint64_t last_flush_nanos_ ABSL_GUARDED_BY(mtx_) = 0;
+};
+
+// Reads back the events written by a TraceWriter, in order.
+class TraceReader {
+ public:
+  // Returns nullptr if the trace file can't be opened
+  static std::unique_ptr<TraceReader> Create(const char* path);
+
+  // Takes ownership of `fd`
+  explicit TraceReader(int fd);
+
+  TraceReader(TraceReader&& other) = delete;
+  TraceReader& operator=(TraceReader&& rhs) = delete;
+  TraceReader(const TraceReader& other) = delete;
+  TraceReader& operator=(const TraceReader& other) = delete;
+
+  // Returns false at the end of the trace, or if it is malformed, in which
+  // case HadError returns true.
+  bool Next(pb::v1::es_trace::Event* event);
+
+  bool HadError() const { return had_error_; }
+
+ private:
+  std::unique_ptr<google::protobuf::io::FileInputStream> input_;
+  bool had_error_ = false;
+};
+
+// An es_message_t rebuilt from a traced event. Every pointer in the message
+// refers to storage owned by this object, so it must outlive any Message
+// wrapping it. Exec arguments aren't reachable through es_exec_arg, and are
+// instead exposed by ExecArgs.
+class TracedMessage {
+ public:
+  // Returns nullptr if the event doesn't carry a supported message
+  static std::unique_ptr<TracedMessage> Create(
+      const pb::v1::es_trace::Event& event);
+
+  TracedMessage(TracedMessage&& other) = delete;
+  TracedMessage& operator=(TracedMessage&& rhs) = delete;
+  TracedMessage(const TracedMessage& other) = delete;
+  TracedMessage& operator=(const TracedMessage& other) = delete;
+
+  // Stamp the message as delivered at `mach_time`. AUTH deadlines keep the
+  // budget they had when traced.
+  void SetDeliveryTime(uint64_t mach_time);
+
+  const es_message_t* get() const { return &msg_; }
+  Processor processor() const { return processor_; }
+  uint64_t offset_nanos() const { return offset_nanos_; }
+  const std::vector<std::string>& ExecArgs() const { return exec_args_; }
+
+ private:
+  TracedMessage() = default;
+
+  es_string_token_t MakeToken(const std::string& str);
+  es_file_t* MakeFile(const pb::v1::es_trace::File& file);
+  es_process_t* MakeProcess(const pb::v1::es_trace::Process& proc);
+
+  es_message_t msg_ = {};
+  es_thread_t thread_ = {};
+  Processor processor_ = Processor::kUnknown;
+  uint64_t offset_nanos_ = 0;
+  uint64_t deadline_nanos_ = 0;
+  // Deques so that the addresses handed out stay stable as they grow
+  std::deque<std::string> strings_;
+  std::deque<es_file_t> files_;
+  std::deque<es_process_t> processes_;
+  std::vector<std::string> exec_args_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_ES_TRACE_H
@@ -0,0 +1,400 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/es/Trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <mach/mach_time.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "Source/common/String.h"
+#include "Source/common/SystemResources.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::FileInputStream;
+using google::protobuf::io::StringOutputStream;
+
+namespace pbes = ::santa::pb::v1::es_trace;
+
+namespace santa {
+
+namespace {
+
+constexpr size_t kFlushBytes = 64 * 1024;
+constexpr uint32_t kMaxEventSize = 1024 * 1024;
+
+void EncodeFile(const es_file_t* file, pbes::File* pb) {
+  pb->set_path(StringTokenToString(file->path));
+  pb->set_path_truncated(file->path_truncated);
+
+  pbes::Stat* stat = pb->mutable_stat();
+  stat->set_dev(file->stat.st_dev);
+  stat->set_ino(file->stat.st_ino);
+  stat->set_mode(file->stat.st_mode);
+  stat->set_nlink(file->stat.st_nlink);
+  stat->set_uid(file->stat.st_uid);
+  stat->set_gid(file->stat.st_gid);
+  stat->set_size(file->stat.st_size);
+}
+
+void EncodeProcess(const es_process_t* proc, uint32_t version, pbes::Process* pb) {
+  pb->set_audit_token(&proc->audit_token, sizeof(audit_token_t));
+  pb->set_ppid(proc->ppid);
+  pb->set_original_ppid(proc->original_ppid);
+  pb->set_group_id(proc->group_id);
+  pb->set_session_id(proc->session_id);
+  pb->set_codesigning_flags(proc->codesigning_flags);
+  pb->set_is_platform_binary(proc->is_platform_binary);
+  pb->set_is_es_client(proc->is_es_client);
+  pb->set_cdhash(proc->cdhash, sizeof(proc->cdhash));
+  pb->set_signing_id(StringTokenToString(proc->signing_id));
+  pb->set_team_id(StringTokenToString(proc->team_id));
+  EncodeFile(proc->executable, pb->mutable_executable());
+
+  if (version >= 2 && proc->tty) {
+    EncodeFile(proc->tty, pb->mutable_tty());
+  }
+  if (version >= 3) {
+    pb->set_start_time_micros((int64_t)proc->start_time.tv_sec * USEC_PER_SEC +
+                              proc->start_time.tv_usec);
+  }
+  if (version >= 4) {
+    pb->set_responsible_audit_token(&proc->responsible_audit_token, sizeof(audit_token_t));
+    pb->set_parent_audit_token(&proc->parent_audit_token, sizeof(audit_token_t));
+  }
+}
+
+void DecodeToken(const std::string& bytes, audit_token_t* tok) {
+  *tok = {};
+  memcpy(tok, bytes.data(), std::min(bytes.size(), sizeof(audit_token_t)));
+}
+
+}  // namespace
+
+bool TraceWriter::IsTraceable(es_event_type_t event_type) {
+  switch (event_type) {
+    case ES_EVENT_TYPE_AUTH_EXEC:
+    case ES_EVENT_TYPE_NOTIFY_EXEC:
+    case ES_EVENT_TYPE_NOTIFY_FORK:
+    case ES_EVENT_TYPE_NOTIFY_EXIT:
+    case ES_EVENT_TYPE_AUTH_OPEN:
+    case ES_EVENT_TYPE_NOTIFY_OPEN:
+    case ES_EVENT_TYPE_NOTIFY_CLOSE:
+    case ES_EVENT_TYPE_AUTH_RENAME:
+    case ES_EVENT_TYPE_NOTIFY_RENAME: return true;
+    default: return false;
+  }
+}
+
+std::unique_ptr<TraceWriter> TraceWriter::Create(std::shared_ptr<EndpointSecurityAPI> esapi,
+                                                 const char* path) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return nullptr;
+  }
+  return std::make_unique<TraceWriter>(std::move(esapi), fd);
+}
+
+TraceWriter::TraceWriter(std::shared_ptr<EndpointSecurityAPI> esapi, int fd)
+    : esapi_(std::move(esapi)), fd_(fd) {}
+
+TraceWriter::~TraceWriter() {
+  absl::MutexLock lock(&mtx_);
+  FlushLocked();
+  close(fd_);
+}
+
+void TraceWriter::Record(Processor processor, const Message& msg) {
+  if (!IsTraceable(msg->event_type)) {
+    return;
+  }
+
+  pbes::Event event;
+  event.set_processor(static_cast<int32_t>(processor));
+  event.set_version(msg->version);
+  event.set_event_type(msg->event_type);
+  event.set_action_type(msg->action_type);
+  event.set_seq_num(msg->seq_num);
+  event.set_global_seq_num(msg->global_seq_num);
+  EncodeProcess(msg->process, msg->version, event.mutable_process());
+  if (msg->version >= 4 && msg->thread) {
+    event.set_thread_id(msg->thread->thread_id);
+  }
+
+  switch (msg->event_type) {
+    case ES_EVENT_TYPE_AUTH_EXEC:
+    case ES_EVENT_TYPE_NOTIFY_EXEC: {
+      pbes::Exec* exec = event.mutable_exec();
+      EncodeProcess(msg->event.exec.target, msg->version, exec->mutable_target());
+      for (std::string& arg : esapi_->ExecArgs(&msg->event.exec)) {
+        exec->add_args(std::move(arg));
+      }
+      if (msg->version >= 2 && msg->event.exec.script) {
+        EncodeFile(msg->event.exec.script, exec->mutable_script());
+      }
+      if (msg->version >= 3 && msg->event.exec.cwd) {
+        EncodeFile(msg->event.exec.cwd, exec->mutable_cwd());
+      }
+      break;
+    }
+    case ES_EVENT_TYPE_NOTIFY_FORK:
+      EncodeProcess(msg->event.fork.child, msg->version, event.mutable_fork()->mutable_child());
+      break;
+    case ES_EVENT_TYPE_NOTIFY_EXIT: event.mutable_exit()->set_stat(msg->event.exit.stat); break;
+    case ES_EVENT_TYPE_AUTH_OPEN:
+    case ES_EVENT_TYPE_NOTIFY_OPEN:
+      EncodeFile(msg->event.open.file, event.mutable_open()->mutable_file());
+      event.mutable_open()->set_fflag(msg->event.open.fflag);
+      break;
+    case ES_EVENT_TYPE_NOTIFY_CLOSE:
+      EncodeFile(msg->event.close.target, event.mutable_close()->mutable_target());
+      event.mutable_close()->set_modified(msg->event.close.modified);
+      break;
+    case ES_EVENT_TYPE_AUTH_RENAME:
+    case ES_EVENT_TYPE_NOTIFY_RENAME: {
+      pbes::Rename* rename = event.mutable_rename();
+      EncodeFile(msg->event.rename.source, rename->mutable_source());
+      if (msg->event.rename.destination_type == ES_DESTINATION_TYPE_EXISTING_FILE) {
+        EncodeFile(msg->event.rename.destination.existing_file, rename->mutable_existing_file());
+      } else {
+        EncodeFile(msg->event.rename.destination.new_path.dir, rename->mutable_new_dir());
+        rename->set_new_filename(
+            StringTokenToString(msg->event.rename.destination.new_path.filename));
+      }
+      break;
+    }
+    default: return;
+  }
+
+  absl::MutexLock lock(&mtx_);
+  if (first_mach_time_ == 0) {
+    first_mach_time_ = msg->mach_time;
+  }
+  if (msg->mach_time > first_mach_time_) {
+    event.set_offset_nanos(MachTimeToNanos(msg->mach_time - first_mach_time_));
+  }
+  if (msg->action_type == ES_ACTION_TYPE_AUTH && msg->deadline > msg->mach_time) {
+    event.set_deadline_nanos(MachTimeToNanos(msg->deadline - msg->mach_time));
+  }
+
+  {
+    StringOutputStream output(&buffer_);
+    CodedOutputStream coded(&output);
+    coded.WriteVarint32((uint32_t)event.ByteSizeLong());
+    event.SerializeWithCachedSizes(&coded);
+  }
+
+  uint64_t now = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  if (buffer_.size() >= kFlushBytes || now - last_flush_nanos_ >= NSEC_PER_SEC) {
+    FlushLocked();
+    last_flush_nanos_ = now;
+  }
+}
+
+void TraceWriter::Flush() {
+  absl::MutexLock lock(&mtx_);
+  FlushLocked();
+}
+
+void TraceWriter::FlushLocked() {
+  size_t written = 0;
+  while (written < buffer_.size()) {
+    ssize_t n = write(fd_, buffer_.data() + written, buffer_.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      // The trace is best effort, drop what couldn't be written
+      break;
+    }
+    written += n;
+  }
+  buffer_.clear();
+}
+
+std::unique_ptr<TraceReader> TraceReader::Create(const char* path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  return std::make_unique<TraceReader>(fd);
+}
+
+TraceReader::TraceReader(int fd) : input_(std::make_unique<FileInputStream>(fd)) {
+  input_->SetCloseOnDelete(true);
+}
+
+bool TraceReader::Next(pbes::Event* event) {
+  if (had_error_) {
+    return false;
+  }
+
+  // A fresh CodedInputStream per event returns any read ahead to the
+  // underlying stream when destroyed
+  CodedInputStream coded(input_.get());
+  uint32_t size;
+  int start = coded.CurrentPosition();
+  if (!coded.ReadVarint32(&size)) {
+    had_error_ = coded.CurrentPosition() != start || input_->GetErrno() != 0;
+    return false;
+  }
+
+  if (size > kMaxEventSize) {
+    had_error_ = true;
+    return false;
+  }
+
+  CodedInputStream::Limit limit = coded.PushLimit(size);
+  if (!event->ParseFromCodedStream(&coded) || !coded.ConsumedEntireMessage() ||
+      coded.BytesUntilLimit() != 0) {
+    had_error_ = true;
+    return false;
+  }
+  coded.PopLimit(limit);
+  return true;
+}
+
+std::unique_ptr<TracedMessage> TracedMessage::Create(const pbes::Event& event) {
+  // The constructor is private so make_unique can't be used
+  std::unique_ptr<TracedMessage> traced(new TracedMessage());
+  es_message_t& msg = traced->msg_;
+
+  traced->processor_ = static_cast<Processor>(event.processor());
+  traced->offset_nanos_ = event.offset_nanos();
+  traced->deadline_nanos_ = event.deadline_nanos();
+
+  msg.version = event.version();
+  msg.event_type = static_cast<es_event_type_t>(event.event_type());
+  msg.action_type = static_cast<es_action_type_t>(event.action_type());
+  msg.seq_num = event.seq_num();
+  msg.global_seq_num = event.global_seq_num();
+  msg.process = traced->MakeProcess(event.process());
+  if (msg.action_type == ES_ACTION_TYPE_NOTIFY) {
+    msg.action.notify.result_type = ES_RESULT_TYPE_AUTH;
+    msg.action.notify.result.auth = ES_AUTH_RESULT_ALLOW;
+  }
+  if (msg.version >= 4) {
+    traced->thread_.thread_id = event.thread_id();
+    msg.thread = &traced->thread_;
+  }
+
+  switch (event.event_case()) {
+    case pbes::Event::kExec: {
+      es_event_exec_t& exec = msg.event.exec;
+      exec.target = traced->MakeProcess(event.exec().target());
+      traced->exec_args_.assign(event.exec().args().begin(), event.exec().args().end());
+      if (event.exec().has_script()) {
+        exec.script = traced->MakeFile(event.exec().script());
+      }
+      if (event.exec().has_cwd()) {
+        exec.cwd = traced->MakeFile(event.exec().cwd());
+      }
+      break;
+    }
+    case pbes::Event::kFork:
+      msg.event.fork.child = traced->MakeProcess(event.fork().child());
+      break;
+    case pbes::Event::kExit: msg.event.exit.stat = event.exit().stat(); break;
+    case pbes::Event::kOpen:
+      msg.event.open.file = traced->MakeFile(event.open().file());
+      msg.event.open.fflag = event.open().fflag();
+      break;
+    case pbes::Event::kClose:
+      msg.event.close.target = traced->MakeFile(event.close().target());
+      msg.event.close.modified = event.close().modified();
+      break;
+    case pbes::Event::kRename: {
+      es_event_rename_t& rename = msg.event.rename;
+      rename.source = traced->MakeFile(event.rename().source());
+      if (event.rename().has_existing_file()) {
+        rename.destination_type = ES_DESTINATION_TYPE_EXISTING_FILE;
+        rename.destination.existing_file = traced->MakeFile(event.rename().existing_file());
+      } else {
+        rename.destination_type = ES_DESTINATION_TYPE_NEW_PATH;
+        rename.destination.new_path.dir = traced->MakeFile(event.rename().new_dir());
+        rename.destination.new_path.filename = traced->MakeToken(event.rename().new_filename());
+      }
+      break;
+    }
+    default: return nullptr;
+  }
+
+  return traced;
+}
+
+void TracedMessage::SetDeliveryTime(uint64_t mach_time) {
+  msg_.mach_time = mach_time;
+  if (msg_.action_type == ES_ACTION_TYPE_AUTH) {
+    msg_.deadline = AddNanosecondsToMachTime(deadline_nanos_, mach_time);
+  }
+
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  msg_.time.tv_sec = tv.tv_sec;
+  msg_.time.tv_nsec = tv.tv_usec * NSEC_PER_USEC;
+}
+
+es_string_token_t TracedMessage::MakeToken(const std::string& str) {
+  const std::string& owned = strings_.emplace_back(str);
+  return es_string_token_t{.length = owned.size(), .data = owned.c_str()};
+}
+
+es_file_t* TracedMessage::MakeFile(const pbes::File& file) {
+  es_file_t& es_file = files_.emplace_back();
+  es_file.path = MakeToken(file.path());
+  es_file.path_truncated = file.path_truncated();
+  es_file.stat.st_dev = file.stat().dev();
+  es_file.stat.st_ino = file.stat().ino();
+  es_file.stat.st_mode = (mode_t)file.stat().mode();
+  es_file.stat.st_nlink = (nlink_t)file.stat().nlink();
+  es_file.stat.st_uid = file.stat().uid();
+  es_file.stat.st_gid = file.stat().gid();
+  es_file.stat.st_size = file.stat().size();
+  return &es_file;
+}
+
+es_process_t* TracedMessage::MakeProcess(const pbes::Process& proc) {
+  es_process_t& es_proc = processes_.emplace_back();
+  DecodeToken(proc.audit_token(), &es_proc.audit_token);
+  DecodeToken(proc.parent_audit_token(), &es_proc.parent_audit_token);
+  DecodeToken(proc.responsible_audit_token(), &es_proc.responsible_audit_token);
+  es_proc.ppid = proc.ppid();
+  es_proc.original_ppid = proc.original_ppid();
+  es_proc.group_id = proc.group_id();
+  es_proc.session_id = proc.session_id();
+  es_proc.codesigning_flags = proc.codesigning_flags();
+  es_proc.is_platform_binary = proc.is_platform_binary();
+  es_proc.is_es_client = proc.is_es_client();
+  memcpy(es_proc.cdhash, proc.cdhash().data(),
+         std::min(proc.cdhash().size(), sizeof(es_proc.cdhash)));
+  es_proc.signing_id = MakeToken(proc.signing_id());
+  es_proc.team_id = MakeToken(proc.team_id());
+  es_proc.executable = MakeFile(proc.executable());
+  if (proc.has_tty()) {
+    es_proc.tty = MakeFile(proc.tty());
+  }
+  es_proc.start_time.tv_sec = proc.start_time_micros() / USEC_PER_SEC;
+  es_proc.start_time.tv_usec = (suseconds_t)(proc.start_time_micros() % USEC_PER_SEC);
+  return &es_proc;
+}
+
+}  // namespace santa
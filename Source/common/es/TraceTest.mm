@@ -0,0 +1,191 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/es/Trace.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <fcntl.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Source/common/String.h"
+#include "Source/common/SystemResources.h"
+#include "Source/common/TestUtils.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/es/MockEndpointSecurityAPI.h"
+#include "Source/common/es/es_trace.pb.h"
+
+using santa::Message;
+using santa::Processor;
+using santa::StringTokenToString;
+using santa::TracedMessage;
+using santa::TraceReader;
+using santa::TraceWriter;
+
+namespace pbes = ::santa::pb::v1::es_trace;
+
+@interface TraceTest : XCTestCase
+@property NSString* tracePath;
+@end
+
+@implementation TraceTest
+
+- (void)setUp {
+  self.tracePath = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"trace_%@", [NSUUID UUID]]];
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.tracePath error:nil];
+}
+
+- (std::vector<std::unique_ptr<TracedMessage>>)readTrace {
+  std::vector<std::unique_ptr<TracedMessage>> traced;
+  std::unique_ptr<TraceReader> reader = TraceReader::Create(self.tracePath.UTF8String);
+  XCTAssertTrue(reader);
+  pbes::Event event;
+  while (reader->Next(&event)) {
+    traced.push_back(TracedMessage::Create(event));
+  }
+  XCTAssertFalse(reader->HadError());
+  return traced;
+}
+
+- (void)testRoundTrip {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  es_file_t procFile = MakeESFile("proc");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  proc.team_id = MakeESStringToken("TEAMID");
+  es_file_t targetFile = MakeESFile("target", MakeStat(100));
+  es_process_t targetProc = MakeESProcess(&targetFile, MakeAuditToken(12, 35));
+  es_file_t cwdFile = MakeESFile("cwd");
+
+  es_message_t execMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_EXEC, &proc, ActionType::Auth);
+  execMsg.mach_time = 1000;
+  execMsg.deadline = execMsg.mach_time + santa::NanosToMachTime(5 * NSEC_PER_SEC);
+  execMsg.seq_num = 7;
+  execMsg.event.exec.target = &targetProc;
+  if (execMsg.version >= 3) {
+    execMsg.event.exec.cwd = &cwdFile;
+  }
+
+  EXPECT_CALL(*mockESApi, ExecArgCount).WillRepeatedly(testing::Return(2));
+  EXPECT_CALL(*mockESApi, ExecArg)
+      .WillRepeatedly([](const es_event_exec_t*, uint32_t index) {
+        return MakeESStringToken(index == 0 ? "ls" : "-l");
+      });
+
+  es_file_t dirFile = MakeESFile("dir");
+  es_message_t renameMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_RENAME, &proc);
+  renameMsg.mach_time = execMsg.mach_time + santa::NanosToMachTime(NSEC_PER_MSEC);
+  renameMsg.event.rename.source = &targetFile;
+  renameMsg.event.rename.destination_type = ES_DESTINATION_TYPE_NEW_PATH;
+  renameMsg.event.rename.destination.new_path.dir = &dirFile;
+  renameMsg.event.rename.destination.new_path.filename = MakeESStringToken("new");
+
+  // Not traceable, so it must not appear in the trace
+  es_message_t unlinkMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_UNLINK, &proc);
+
+  es_message_t exitMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXIT, &proc);
+  exitMsg.mach_time = renameMsg.mach_time;
+  exitMsg.event.exit.stat = 9;
+
+  {
+    std::unique_ptr<TraceWriter> writer =
+        TraceWriter::Create(mockESApi, self.tracePath.UTF8String);
+    XCTAssertTrue(writer);
+    writer->Record(Processor::kAuthorizer, Message(mockESApi, &execMsg));
+    writer->Record(Processor::kRecorder, Message(mockESApi, &renameMsg));
+    writer->Record(Processor::kRecorder, Message(mockESApi, &unlinkMsg));
+    writer->Record(Processor::kDataFileAccessAuthorizer, Message(mockESApi, &exitMsg));
+  }
+
+  std::vector<std::unique_ptr<TracedMessage>> traced = [self readTrace];
+  XCTAssertEqual(traced.size(), 3);
+
+  const es_message_t* exec = traced[0]->get();
+  XCTAssertEqual(traced[0]->processor(), Processor::kAuthorizer);
+  XCTAssertEqual(traced[0]->offset_nanos(), 0);
+  XCTAssertEqual(exec->version, execMsg.version);
+  XCTAssertEqual(exec->event_type, ES_EVENT_TYPE_AUTH_EXEC);
+  XCTAssertEqual(exec->action_type, ES_ACTION_TYPE_AUTH);
+  XCTAssertEqual(exec->seq_num, 7);
+  XCTAssertEqual(memcmp(&exec->process->audit_token, &proc.audit_token, sizeof(audit_token_t)),
+                 0);
+  XCTAssertEqual(StringTokenToString(exec->process->executable->path), "proc");
+  XCTAssertEqual(StringTokenToString(exec->process->team_id), "TEAMID");
+  XCTAssertEqual(exec->process->executable->stat.st_ino, procFile.stat.st_ino);
+  XCTAssertEqual(StringTokenToString(exec->event.exec.target->executable->path), "target");
+  XCTAssertEqual(exec->event.exec.target->executable->stat.st_dev, targetFile.stat.st_dev);
+  XCTAssertTrue(traced[0]->ExecArgs() == std::vector<std::string>({"ls", "-l"}));
+  if (execMsg.version >= 3) {
+    XCTAssertEqual(StringTokenToString(exec->event.exec.cwd->path), "cwd");
+  }
+
+  // The deadline keeps its budget relative to the new delivery time
+  traced[0]->SetDeliveryTime(500);
+  XCTAssertEqual(exec->mach_time, 500);
+  XCTAssertEqual(santa::MachTimeToNanos(exec->deadline - exec->mach_time) / NSEC_PER_MSEC, 5000);
+
+  const es_message_t* rename = traced[1]->get();
+  XCTAssertEqual(traced[1]->processor(), Processor::kRecorder);
+  XCTAssertEqual(traced[1]->offset_nanos() / NSEC_PER_USEC, NSEC_PER_MSEC / NSEC_PER_USEC);
+  XCTAssertEqual(rename->event.rename.destination_type, ES_DESTINATION_TYPE_NEW_PATH);
+  XCTAssertEqual(StringTokenToString(rename->event.rename.source->path), "target");
+  XCTAssertEqual(StringTokenToString(rename->event.rename.destination.new_path.dir->path), "dir");
+  XCTAssertEqual(StringTokenToString(rename->event.rename.destination.new_path.filename), "new");
+
+  const es_message_t* exit = traced[2]->get();
+  XCTAssertEqual(traced[2]->processor(), Processor::kDataFileAccessAuthorizer);
+  XCTAssertEqual(exit->event_type, ES_EVENT_TYPE_NOTIFY_EXIT);
+  XCTAssertEqual(exit->event.exit.stat, 9);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
+- (void)testMalformedTrace {
+  int fd = open(self.tracePath.UTF8String, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  XCTAssertGreaterThanOrEqual(fd, 0);
+  // A length prefix promising more bytes than follow it
+  const char truncated[] = {0x10, 0x01, 0x02};
+  XCTAssertEqual(write(fd, truncated, sizeof(truncated)), sizeof(truncated));
+  close(fd);
+
+  std::unique_ptr<TraceReader> reader = TraceReader::Create(self.tracePath.UTF8String);
+  XCTAssertTrue(reader);
+  pbes::Event event;
+  XCTAssertFalse(reader->Next(&event));
+  XCTAssertTrue(reader->HadError());
+}
+
+- (void)testMissingTrace {
+  XCTAssertTrue(TraceReader::Create(self.tracePath.UTF8String) == nullptr);
+}
+
+- (void)testUnsupportedEvent {
+  pbes::Event event;
+  event.set_event_type(ES_EVENT_TYPE_NOTIFY_UNLINK);
+  XCTAssertTrue(TracedMessage::Create(event) == nullptr);
+}
+
+@end
@@ -31,6 +31,7 @@
 #import "Source/common/String.h"
 #import "Source/common/Unit.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 
 namespace santa {
 
@@ -39,6 +40,7 @@ enum class WatchItemPathType;
 enum class WatchItemRuleType;
 struct DataWatchItemPolicy;
 struct ProcessWatchItemPolicy;
+struct WatchItemPolicyBase;
 struct WatchItemProcess;
 
 template <typename T>
@@ -57,6 +59,10 @@ using SetSharedProcessWatchItemPolicy =
     absl::flat_hash_set<std::shared_ptr<ProcessWatchItemPolicy>,
                         SharedPtrValueHash<ProcessWatchItemPolicy>,
                         SharedPtrValueEqual<ProcessWatchItemPolicy>>;
+// The index of a message's path target and the policy that applies to it
+using TargetPolicyPair = std::pair<size_t, std::optional<std::shared_ptr<WatchItemPolicyBase>>>;
+// Messages have at most two path targets
+using TargetPolicyPairs = absl::InlinedVector<TargetPolicyPair, 2>;
 
 enum class WatchItemPathType {
   kPrefix,
@@ -278,6 +284,8 @@ struct DataWatchItemPolicy : public WatchItemPolicyBase {
 };
 
 struct ProcessWatchItemPolicy : public WatchItemPolicyBase {
+  using PathTree = santa::PrefixTree<santa::Unit, santa::PrefixTreeLayout::kRadix>;
+
   ProcessWatchItemPolicy(std::string_view n, std::string_view v, SetPairPathAndType pt,
                          bool ara = kWatchItemPolicyDefaultAllowReadAccess,
                          bool ao = kWatchItemPolicyDefaultAuditOnly,
@@ -288,12 +296,17 @@ struct ProcessWatchItemPolicy : public WatchItemPolicyBase {
                          SetWatchItemProcess procs = {}, int64_t rid = 0)
       : WatchItemPolicyBase(n, v, ara, ao, rt, esm, estm, cm, edu, edt, std::move(procs), rid),
         path_type_pairs(std::move(pt)),
-        tree(std::make_unique<santa::PrefixTree<santa::Unit>>()) {
-    // Build tree
+        tree(std::make_unique<PathTree>()) {
+    // Build tree, expanding all of the paths together
+    std::vector<std::string> paths;
     for (const auto& pt_pair : path_type_pairs) {
-      std::vector<std::string> matches = FindMatches(@(pt_pair.first.c_str()));
+      paths.push_back(pt_pair.first);
+    }
+    std::vector<std::vector<std::string>> expanded = FindMatches(paths);
 
-      for (const auto& match : matches) {
+    size_t i = 0;
+    for (const auto& pt_pair : path_type_pairs) {
+      for (const auto& match : expanded[i++]) {
         if (pt_pair.second == WatchItemPathType::kPrefix) {
           tree->InsertPrefix(match.c_str(), santa::Unit{});
         } else {
@@ -317,7 +330,7 @@ struct ProcessWatchItemPolicy : public WatchItemPolicyBase {
   bool operator!=(const WatchItemPolicyBase& other) const override { return !(*this == other); }
 
   SetPairPathAndType path_type_pairs;
-  std::unique_ptr<santa::PrefixTree<Unit>> tree;
+  std::unique_ptr<PathTree> tree;
 };
 
 // Hash and equality call operators for values of shared_ptr types
@@ -28,11 +28,16 @@
 #include <utility>
 #include <vector>
 
+#include "Source/common/BackgroundScheduler.h"
+#include "Source/common/GlobWatcher.h"
 #include "Source/common/PassKey.h"
 #include "Source/common/PrefixTree.h"
+#include "Source/common/Published.h"
 #include "Source/common/Timer.h"
 #include "Source/common/faa/WatchItemPolicy.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 
 extern NSString* const kWatchItemConfigKeyVersion;
 extern NSString* const kWatchItemConfigKeyWatchItems;
@@ -79,6 +84,25 @@ struct WatchItemsState;
 using CheckPolicyBlock = bool (^)(std::shared_ptr<ProcessWatchItemPolicy>);
 using IterateProcessPoliciesBlock = void (^)(CheckPolicyBlock);
 
+// Attributes of a running process used to find the process policies that
+// might apply to it. Empty views mean the process doesn't have the attribute.
+// The certificate hash is expensive to compute so it is only requested if a
+// policy process is indexed by it.
+struct ProcessPolicyKeys {
+  std::string_view binary_path;
+  std::string_view signing_id;
+  std::string_view team_id;
+  std::string_view cdhash;
+  std::string (^certificate_sha256)(void);
+};
+
+// Called with each policy process that might match, along with the policy it
+// belongs to. Candidates still need to be fully matched against the process.
+// Return `true` to stop, or `false` to continue to the next candidate.
+using CheckProcessCandidateBlock =
+    bool (^)(const WatchItemProcess&, const std::shared_ptr<ProcessWatchItemPolicy>&);
+using FindProcessPoliciesBlock = void (^)(const ProcessPolicyKeys&, CheckProcessCandidateBlock);
+
 // The nesting is required so as to not tightly couple WatchItems with how
 // external callers might structure their data. In the past,
 // FAAPolicyProcessor types were used directly to make the code easier to read
@@ -88,12 +112,21 @@ using IterateProcessPoliciesBlock = void (^)(CheckPolicyBlock);
 using LookupPolicyBlock =
     std::optional<std::shared_ptr<WatchItemPolicyBase>> (^)(const std::string&);
 using IterateTargetsBlock = void (^)(LookupPolicyBlock);
-using FindPoliciesForTargetsBlock = void (^)(IterateTargetsBlock);
+
+// Null terminated paths of a message's targets, in target order. Looking all
+// of them up at once walks the policy tree a single time and lets targets
+// that share a leading path share the walk.
+using TargetPaths = absl::InlinedVector<const char*, 2>;
+using FindPoliciesForTargetsBlock = TargetPolicyPairs (^)(const TargetPaths&);
 
 class DataWatchItems {
  public:
-  DataWatchItems()
-      : tree_(std::make_unique<santa::PrefixTree<std::shared_ptr<DataWatchItemPolicy>>>()) {}
+  using PolicyTree =
+      santa::PrefixTree<std::shared_ptr<DataWatchItemPolicy>, santa::PrefixTreeLayout::kRadix>;
+  // The paths each configured path expanded to, keyed by the configured path
+  using GlobExpansions = absl::flat_hash_map<std::string, std::vector<std::string>>;
+
+  DataWatchItems() : tree_(std::make_shared<PolicyTree>()) {}
 
   DataWatchItems(DataWatchItems&& other) = default;
   DataWatchItems& operator=(DataWatchItems&& rhs) = default;
@@ -109,16 +142,30 @@ class DataWatchItems {
   friend void swap(DataWatchItems& first, DataWatchItems& second) {
     std::swap(first.tree_, second.tree_);
     std::swap(first.paths_, second.paths_);
+    std::swap(first.expansions_, second.expansions_);
+    std::swap(first.directories_read_, second.directories_read_);
   }
 
-  bool Build(SetSharedDataWatchItemPolicy data_policies);
+  /// Configured paths found in `reuse` use those expansions instead of being
+  /// expanded again.
+  bool Build(SetSharedDataWatchItemPolicy data_policies, const GlobExpansions* reuse = nullptr);
   size_t Count() const { return paths_.size(); }
+  const GlobExpansions& Expansions() const { return expansions_; }
+  /// Directories read while expanding globs during the last Build.
+  uint64_t DirectoriesRead() const { return directories_read_; }
 
+  /// The tree is not modified after Build, so lookups don't lock it.
   void FindPolicies(IterateTargetsBlock iterateTargetsBlock) const;
+  TargetPolicyPairs FindPolicies(const TargetPaths& paths) const;
+
+  /// Approximate bytes used by the policy tree. Policies are not included.
+  size_t ApproximateBytes() const { return tree_ ? tree_->ApproximateBytes() : 0; }
 
  private:
-  std::unique_ptr<santa::PrefixTree<std::shared_ptr<DataWatchItemPolicy>>> tree_;
+  std::shared_ptr<PolicyTree> tree_;
   SetPairPathAndType paths_;
+  GlobExpansions expansions_;
+  uint64_t directories_read_ = 0;
 };
 
 class ProcessWatchItems {
@@ -138,10 +185,46 @@ class ProcessWatchItems {
   bool Build(SetSharedProcessWatchItemPolicy proc_policies);
 
   size_t Count() const { return policies_.size(); }
-  void IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock);
+  void IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock) const;
+
+  /// Calls `checkCandidateBlock` for the policy processes indexed under any of
+  /// the given keys. Each policy process is indexed once, under its most
+  /// selective attribute, so this is a constant number of hash probes no
+  /// matter how many policies exist.
+  void FindProcessPolicies(const ProcessPolicyKeys& keys,
+                           CheckProcessCandidateBlock checkCandidateBlock) const;
 
  private:
+  struct Candidate {
+    // Points into `policy`, which keeps it alive
+    const WatchItemProcess* process;
+    std::shared_ptr<ProcessWatchItemPolicy> policy;
+  };
+  using CandidateIndex = absl::flat_hash_map<std::string, std::vector<Candidate>>;
+
+  void BuildIndex();
+
   SetSharedProcessWatchItemPolicy policies_;
+  CandidateIndex by_cdhash_;
+  CandidateIndex by_signing_id_;
+  CandidateIndex by_team_id_;
+  CandidateIndex by_binary_path_;
+  CandidateIndex by_certificate_sha256_;
+  // Policy processes with no indexable attribute, e.g. only PlatformBinary
+  std::vector<Candidate> unindexed_;
+};
+
+// The parts of the current policy that FAA decisions read. A snapshot is
+// never modified once it has been published, so reading one requires no
+// synchronization.
+struct WatchItemsSnapshot {
+  // Incremented each time a changed policy is published
+  uint64_t generation = 0;
+  DataWatchItems data_watch_items;
+  ProcessWatchItems proc_watch_items;
+  std::string policy_version;
+  NSString* policy_event_detail_url;
+  NSString* policy_event_detail_text;
 };
 
 class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
@@ -176,16 +259,30 @@ class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
   void RegisterDataWatchItemsUpdatedCallback(DataWatchItemsUpdatedBlock callback);
   void RegisterProcWatchItemsUpdatedCallback(ProcWatchItemsUpdatedBlock callback);
 
+  /// Hold periodic config reapplication in `scheduler` while the machine is
+  /// on battery or otherwise busy. Must be set before the timer is started.
+  void SetBackgroundScheduler(BackgroundScheduler* scheduler);
+
   void SetDBRules(NSDictionary* rules);
   void SetConfigPath(NSString* config_path);
   void SetConfig(NSDictionary* config);
 
   void FindPoliciesForTargets(IterateTargetsBlock iterateTargetsBlock);
+  TargetPolicyPairs FindPoliciesForTargets(const TargetPaths& paths);
 
   void IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock);
+  void FindProcessPolicies(const ProcessPolicyKeys& keys,
+                           CheckProcessCandidateBlock checkCandidateBlock);
 
   std::optional<WatchItemsState> State();
 
+  /// Changes whenever the published policy changes. Results derived from the
+  /// policy can be tagged with it and ignored once it no longer matches.
+  uint64_t PolicyGeneration();
+
+  /// Approximate bytes used by the published data watch item tree.
+  size_t ApproximateBytes();
+
   std::pair<NSString*, NSString*> EventDetailLinkInfo(
       const std::shared_ptr<WatchItemPolicyBase>& watch_item);
 
@@ -198,13 +295,24 @@ class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
   friend class santa::WatchItemsPeer;
 
  private:
+  using SnapshotReadGuard = Published<const WatchItemsSnapshot>::ReadGuard;
+
   static std::shared_ptr<WatchItems> CreateInternal(DataSource data_source, NSString* config_path,
                                                     NSDictionary* config,
                                                     uint32_t reapply_config_frequency_secs);
 
   NSDictionary* ReadConfig();
   NSDictionary* ReadConfigLocked() ABSL_SHARED_LOCKS_REQUIRED(lock_);
-  void ReloadConfig(NSDictionary* new_config);
+
+  /// Globs that aren't in `stale_globs` reuse their current expansion while
+  /// the glob watcher is running, except for a periodic full expansion in
+  /// case it missed something. Passing nullopt expands every glob.
+  void ReloadConfig(NSDictionary* new_config,
+                    std::optional<absl::flat_hash_set<std::string>> stale_globs = std::nullopt);
+  void ReloadConfigLocked(NSDictionary* new_config,
+                          std::optional<absl::flat_hash_set<std::string>> stale_globs)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(reload_lock_);
+  void ReexpandGlobs(const absl::flat_hash_set<std::string>& globs);
   void UpdateCurrentState(DataWatchItems new_data_watch_items,
                           ProcessWatchItems new_proc_watch_items, NSDictionary* new_config,
                           uint64_t rules_loaded);
@@ -214,23 +322,32 @@ class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
   NSDictionary* embedded_config_;
   dispatch_queue_t q_;
   void (^periodic_task_complete_f_)(void);
+  BackgroundScheduler* background_scheduler_ = nullptr;
+
+  // Serializes reloads so that expansions reused from the current snapshot
+  // are never older than the snapshot being replaced
+  absl::Mutex reload_lock_ ABSL_ACQUIRED_BEFORE(lock_);
+  std::unique_ptr<GlobWatcher> glob_watcher_ ABSL_GUARDED_BY(reload_lock_);
+  bool glob_watcher_running_ ABSL_GUARDED_BY(reload_lock_) = false;
+  NSTimeInterval last_full_expansion_time_ ABSL_GUARDED_BY(reload_lock_) = 0;
 
   absl::Mutex lock_;
 
-  DataWatchItems data_watch_items_ ABSL_GUARDED_BY(lock_);
-  ProcessWatchItems proc_watch_items_ ABSL_GUARDED_BY(lock_);
+  // The current policy. New policies are compared against snapshot_, and
+  // published_snapshot_ holds the same snapshot for lookups on the AUTH path,
+  // which don't take lock_.
+  std::shared_ptr<const WatchItemsSnapshot> snapshot_ ABSL_GUARDED_BY(lock_);
+  Published<const WatchItemsSnapshot> published_snapshot_;
   NSDictionary* current_config_ ABSL_GUARDED_BY(lock_);
   NSTimeInterval last_update_time_ ABSL_GUARDED_BY(lock_);
-  std::string policy_version_ ABSL_GUARDED_BY(lock_);
   DataWatchItemsUpdatedBlock data_watch_items_updated_callback_ ABSL_GUARDED_BY(lock_);
   ProcWatchItemsUpdatedBlock proc_watch_items_updated_callback_ ABSL_GUARDED_BY(lock_);
   bool periodic_task_started_ = false;
-  NSString* policy_event_detail_url_ ABSL_GUARDED_BY(lock_);
-  NSString* policy_event_detail_text_ ABSL_GUARDED_BY(lock_);
   uint64_t rules_loaded_ ABSL_GUARDED_BY(lock_);
 };
 
 struct WatchItemsState {
+  uint64_t generation;
   uint64_t rule_count;
   NSString* policy_version;
   WatchItems::DataSource data_source;
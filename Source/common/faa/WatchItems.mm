@@ -33,9 +33,12 @@
 #include <vector>
 
 #import "Source/common/Glob.h"
+#include "Source/common/GlobWatcher.h"
+#include "Source/common/SelfProfiler.h"
 #import "Source/common/PrefixTree.h"
 #import "Source/common/SNTError.h"
 #import "Source/common/SNTLogging.h"
+#include "Source/common/Signposts.h"
 #import "Source/common/String.h"
 #import "Source/common/Unit.h"
 #include "Source/common/faa/WatchItemPolicy.h"
@@ -88,6 +91,12 @@ static NSString* const kValidRuleNamePattern = @"^[A-Za-z_][A-Za-z0-9_]*$";
 // also ensuring configuration isn't overly out of sync with the filesystem.
 static constexpr uint32_t kMinReapplyConfigFrequencySecs = 15;
 static constexpr uint32_t kMaxReapplyConfigFrequencySecs = 3600;
+// Reapplications held by the background scheduler run after this long
+static constexpr uint64_t kMaxReapplyConfigDelayNanos = 15 * 60 * NSEC_PER_SEC;
+
+// While the glob watcher is running, globs are still fully re-expanded this
+// often in case it missed a change
+static constexpr NSTimeInterval kFullGlobExpansionIntervalSecs = 6 * 60 * 60;
 
 // Semi-arbitrary max custom message length. The goal is to protect against
 // potential unbounded lengths, but no real reason this cannot be higher.
@@ -715,11 +724,34 @@ SetPairPathAndType DataWatchItems::operator-(const DataWatchItems& other) const
   return diff;
 }
 
-bool DataWatchItems::Build(SetSharedDataWatchItemPolicy data_policies) {
+bool DataWatchItems::Build(SetSharedDataWatchItemPolicy data_policies,
+                           const GlobExpansions* reuse) {
+  // Policies can share a path, so only expand each distinct path once. All
+  // paths are expanded together so shared parent directories are read once.
+  std::vector<std::string> to_expand;
   for (const std::shared_ptr<DataWatchItemPolicy>& item : data_policies) {
-    std::vector<std::string> matches = FindMatches(@(item->path.c_str()));
+    if (expansions_.contains(item->path)) {
+      continue;
+    }
+    if (reuse) {
+      if (auto found = reuse->find(item->path); found != reuse->end()) {
+        expansions_.emplace(item->path, found->second);
+        continue;
+      }
+    }
+    expansions_.emplace(item->path, std::vector<std::string>());
+    to_expand.push_back(item->path);
+  }
+
+  GlobStats stats;
+  std::vector<std::vector<std::string>> expanded = FindMatches(to_expand, &stats);
+  for (size_t i = 0; i < to_expand.size(); i++) {
+    expansions_[to_expand[i]] = std::move(expanded[i]);
+  }
+  directories_read_ = stats.directories_read;
 
-    for (const auto& match : matches) {
+  for (const std::shared_ptr<DataWatchItemPolicy>& item : data_policies) {
+    for (const auto& match : expansions_.at(item->path)) {
       if (item->path_type == WatchItemPathType::kPrefix) {
         tree_->InsertPrefix(match.c_str(), item);
       } else {
@@ -736,18 +768,101 @@ bool DataWatchItems::Build(SetSharedDataWatchItemPolicy data_policies) {
 void DataWatchItems::FindPolicies(IterateTargetsBlock iterateTargetsBlock) const {
   iterateTargetsBlock(
       ^std::optional<std::shared_ptr<WatchItemPolicyBase>>(const std::string& path) {
-        return tree_->LookupLongestMatchingPrefix(path);
+        return tree_->LookupLongestMatchingPrefixUnlocked(path);
       });
 }
 
+// Pairs each target index with its lookup result
+template <typename LookupF>
+static TargetPolicyPairs LookupTargetPaths(const TargetPaths& paths, LookupF lookup) {
+  absl::InlinedVector<std::optional<std::shared_ptr<DataWatchItemPolicy>>, 2> policies(
+      paths.size());
+  lookup(paths.data(), paths.size(), policies.data());
+
+  TargetPolicyPairs target_policy_pairs;
+  for (size_t i = 0; i < paths.size(); i++) {
+    target_policy_pairs.emplace_back(i, std::move(policies[i]));
+  }
+  return target_policy_pairs;
+}
+
+TargetPolicyPairs DataWatchItems::FindPolicies(const TargetPaths& paths) const {
+  return LookupTargetPaths(paths, [this](const char* const* inputs, size_t count,
+                                         std::optional<std::shared_ptr<DataWatchItemPolicy>>* out) {
+    tree_->LookupLongestMatchingPrefixesUnlocked(inputs, count, out);
+  });
+}
+
 #pragma mark ProcessWatchItems
 
 bool ProcessWatchItems::Build(SetSharedProcessWatchItemPolicy proc_policies) {
   policies_ = std::move(proc_policies);
+  BuildIndex();
   return true;
 }
 
-void ProcessWatchItems::IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock) {
+void ProcessWatchItems::BuildIndex() {
+  for (const std::shared_ptr<ProcessWatchItemPolicy>& policy : policies_) {
+    for (const WatchItemProcess& process : policy->processes) {
+      Candidate candidate{&process, policy};
+
+      // Every attribute set on a policy process must match, so indexing by
+      // only the most selective one never misses a match. Binary paths are
+      // preferred over certificate hashes since those are costly to compute.
+      if (process.cdhash.size() == CS_CDHASH_LEN) {
+        by_cdhash_[std::string(process.cdhash.begin(), process.cdhash.end())].push_back(
+            std::move(candidate));
+      } else if (!process.signing_id.empty() &&
+                 process.signing_id_wildcard_pos == std::string::npos) {
+        by_signing_id_[process.signing_id].push_back(std::move(candidate));
+      } else if (!process.team_id.empty()) {
+        by_team_id_[process.team_id].push_back(std::move(candidate));
+      } else if (!process.binary_path.empty()) {
+        by_binary_path_[process.binary_path].push_back(std::move(candidate));
+      } else if (!process.certificate_sha256.empty()) {
+        by_certificate_sha256_[process.certificate_sha256].push_back(std::move(candidate));
+      } else {
+        unindexed_.push_back(std::move(candidate));
+      }
+    }
+  }
+}
+
+void ProcessWatchItems::FindProcessPolicies(const ProcessPolicyKeys& keys,
+                                            CheckProcessCandidateBlock checkCandidateBlock) const {
+  // Returns true if iteration should stop
+  auto check = [&checkCandidateBlock](const std::vector<Candidate>& candidates) {
+    for (const Candidate& candidate : candidates) {
+      if (checkCandidateBlock(*candidate.process, candidate.policy)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  auto probe = [&check](const CandidateIndex& index, std::string_view key) {
+    if (key.empty() || index.empty()) {
+      return false;
+    }
+    auto it = index.find(key);
+    return it != index.end() && check(it->second);
+  };
+
+  if (probe(by_cdhash_, keys.cdhash) || probe(by_signing_id_, keys.signing_id) ||
+      probe(by_team_id_, keys.team_id) || probe(by_binary_path_, keys.binary_path)) {
+    return;
+  }
+
+  if (!by_certificate_sha256_.empty() && keys.certificate_sha256) {
+    if (probe(by_certificate_sha256_, keys.certificate_sha256())) {
+      return;
+    }
+  }
+
+  check(unindexed_);
+}
+
+void ProcessWatchItems::IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock) const {
   for (const auto& p : policies_) {
     bool stop = checkPolicyBlock(p);
     if (stop) {
@@ -791,6 +906,9 @@ std::shared_ptr<WatchItems> WatchItems::CreateInternal(DataSource data_source,
   auto watch_items = std::make_shared<WatchItems>(PassKey(), data_source, config_path, config, q);
   watch_items->SetTimerInterval(reapply_config_frequency_secs);
 
+  SelfProfiler::Shared().RegisterQueue(q, "watch_items");
+  SelfProfiler::Shared().RegisterQueue(watch_items->TimerQueue(), "watch_items");
+
   return watch_items;
 }
 
@@ -802,7 +920,9 @@ WatchItems::WatchItems(PassKey, DataSource data_source, NSString* config_path, N
       config_path_(config_path),
       embedded_config_(config),
       q_(q),
-      periodic_task_complete_f_(periodic_task_complete_f) {}
+      periodic_task_complete_f_(periodic_task_complete_f),
+      snapshot_(std::make_shared<const WatchItemsSnapshot>()),
+      published_snapshot_(snapshot_) {}
 
 bool WatchItems::IsValidRule(NSString* name, NSDictionary* rule, NSError** error,
                              NSString* policyVersion) {
@@ -857,6 +977,7 @@ void WatchItems::UpdateCurrentState(DataWatchItems new_data_watch_items,
                                     ProcessWatchItems new_proc_watch_items,
                                     NSDictionary* new_config, uint64_t rules_loaded) {
   absl::MutexLock lock(lock_);
+  const DataWatchItems& data_watch_items = snapshot_->data_watch_items;
 
   // The following conditions require updating the current config:
   // 1. The current config doesn't exist but the new one does
@@ -869,34 +990,36 @@ void WatchItems::UpdateCurrentState(DataWatchItems new_data_watch_items,
   // the config as that is the only way the set of ProcessWatchItems could change.
   if ((current_config_ != nil && new_config == nil) ||
       (current_config_ == nil && new_config != nil) ||
-      (data_watch_items_ != new_data_watch_items) ||
+      (data_watch_items != new_data_watch_items) ||
       (new_config && ![current_config_ isEqualToDictionary:new_config])) {
     // New paths to watch are those that are in the new set, but not current
-    SetPairPathAndType paths_to_watch = new_data_watch_items - data_watch_items_;
+    SetPairPathAndType paths_to_watch = new_data_watch_items - data_watch_items;
     // Paths to stop watching are in the current set, but not new
-    SetPairPathAndType paths_to_stop_watching = data_watch_items_ - new_data_watch_items;
+    SetPairPathAndType paths_to_stop_watching = data_watch_items - new_data_watch_items;
 
-    std::swap(data_watch_items_, new_data_watch_items);
-    std::swap(proc_watch_items_, new_proc_watch_items);
+    auto snapshot = std::make_shared<WatchItemsSnapshot>();
+    snapshot->generation = snapshot_->generation + 1;
+    snapshot->data_watch_items = std::move(new_data_watch_items);
+    snapshot->proc_watch_items = std::move(new_proc_watch_items);
     current_config_ = new_config;
     if (new_config) {
-      policy_version_ = NSStringToUTF8String(new_config[kWatchItemConfigKeyVersion]);
+      snapshot->policy_version = NSStringToUTF8String(new_config[kWatchItemConfigKeyVersion]);
       // Non-existent kWatchItemConfigKeyEventDetailURL key or zero length value
       // will both result in a nil global policy event detail URL.
       if (((NSString*)new_config[kWatchItemConfigKeyEventDetailURL]).length) {
-        policy_event_detail_url_ = new_config[kWatchItemConfigKeyEventDetailURL];
-      } else {
-        policy_event_detail_url_ = nil;
+        snapshot->policy_event_detail_url = new_config[kWatchItemConfigKeyEventDetailURL];
       }
-      policy_event_detail_text_ = new_config[kWatchItemConfigKeyEventDetailText];
+      snapshot->policy_event_detail_text = new_config[kWatchItemConfigKeyEventDetailText];
       rules_loaded_ = rules_loaded;
     } else {
-      policy_version_ = "";
-      policy_event_detail_url_ = nil;
-      policy_event_detail_text_ = nil;
       rules_loaded_ = 0;
     }
 
+    size_t data_count = snapshot->data_watch_items.Count();
+    size_t proc_count = snapshot->proc_watch_items.Count();
+    snapshot_ = snapshot;
+    published_snapshot_.Publish(std::move(snapshot));
+
     last_update_time_ = [[NSDate date] timeIntervalSince1970];
 
     LOGD(@"Changes to file access rules detected, notifying registered clients.");
@@ -907,14 +1030,13 @@ void WatchItems::UpdateCurrentState(DataWatchItems new_data_watch_items,
       // trigger AUTH ES events that would attempt to re-enter this object and
       // potentially deadlock.
       dispatch_async(q_, ^{
-        data_watch_items_updated_callback_(data_watch_items_.Count(), paths_to_watch,
-                                           paths_to_stop_watching);
+        data_watch_items_updated_callback_(data_count, paths_to_watch, paths_to_stop_watching);
       });
     }
 
     if (proc_watch_items_updated_callback_) {
       dispatch_async(q_, ^{
-        proc_watch_items_updated_callback_(proc_watch_items_.Count());
+        proc_watch_items_updated_callback_(proc_count);
       });
     }
   } else {
@@ -922,7 +1044,15 @@ void WatchItems::UpdateCurrentState(DataWatchItems new_data_watch_items,
   }
 }
 
-void WatchItems::ReloadConfig(NSDictionary* new_config) {
+void WatchItems::ReloadConfig(NSDictionary* new_config,
+                              std::optional<absl::flat_hash_set<std::string>> stale_globs) {
+  absl::MutexLock lock(reload_lock_);
+  ReloadConfigLocked(new_config, std::move(stale_globs));
+}
+
+void WatchItems::ReloadConfigLocked(NSDictionary* new_config,
+                                    std::optional<absl::flat_hash_set<std::string>> stale_globs) {
+  ScopedSignpost signpost(SignpostPhase::kWatchItemsReload);
   DataWatchItems new_data_watch_items;
   ProcessWatchItems new_proc_watch_items;
   uint64_t rules_loaded = 0;
@@ -937,8 +1067,34 @@ void WatchItems::ReloadConfig(NSDictionary* new_config) {
       return;
     }
 
-    new_data_watch_items.Build(std::move(new_data_policies));
+    if (glob_watcher_) {
+      // Start watching before expanding so that no change is missed
+      absl::flat_hash_set<std::string> globs;
+      for (const std::shared_ptr<DataWatchItemPolicy>& item : new_data_policies) {
+        globs.insert(item->path);
+      }
+      glob_watcher_running_ = glob_watcher_->Watch(std::move(globs));
+    }
+
+    NSTimeInterval now = [[NSDate date] timeIntervalSince1970];
+    DataWatchItems::GlobExpansions reuse;
+    if (stale_globs && glob_watcher_running_ &&
+        now - last_full_expansion_time_ < kFullGlobExpansionIntervalSecs) {
+      {
+        absl::ReaderMutexLock state_lock(lock_);
+        reuse = snapshot_->data_watch_items.Expansions();
+      }
+      for (const std::string& glob : *stale_globs) {
+        reuse.erase(glob);
+      }
+      new_data_watch_items.Build(std::move(new_data_policies), &reuse);
+    } else {
+      last_full_expansion_time_ = now;
+      new_data_watch_items.Build(std::move(new_data_policies));
+    }
     new_proc_watch_items.Build(std::move(new_proc_policies));
+    LOGD(@"Expanded file access rule globs, read %llu directories",
+         new_data_watch_items.DirectoriesRead());
   }
 
   UpdateCurrentState(std::move(new_data_watch_items), std::move(new_proc_watch_items), new_config,
@@ -958,24 +1114,79 @@ NSDictionary* WatchItems::ReadConfigLocked() {
   }
 }
 
+void WatchItems::ReexpandGlobs(const absl::flat_hash_set<std::string>& globs) {
+  absl::MutexLock lock(reload_lock_);
+  NSDictionary* config;
+  {
+    absl::ReaderMutexLock state_lock(lock_);
+    config = current_config_;
+  }
+
+  if (config) {
+    LOGD(@"Re-expanding %zu watch item globs after filesystem changes", globs.size());
+    ReloadConfigLocked(config, globs);
+  }
+}
+
 bool WatchItems::OnTimer() {
-  ReloadConfig(embedded_config_ ?: ReadConfig());
+  {
+    absl::MutexLock lock(reload_lock_);
+    if (!glob_watcher_ && q_) {
+      std::weak_ptr<WatchItems> weak_self = weak_from_base<WatchItems>();
+      glob_watcher_ = GlobWatcher::Create(q_, ^(const absl::flat_hash_set<std::string>& globs) {
+        if (auto strong_self = weak_self.lock()) {
+          strong_self->ReexpandGlobs(globs);
+        }
+      });
+    }
+  }
+
+  // With the glob watcher running, only the config is reapplied here. Globs
+  // are re-expanded as the filesystem changes.
+  std::weak_ptr<WatchItems> weak_self = weak_from_base<WatchItems>();
+  void (^reapply)(void) = ^{
+    if (auto strong_self = weak_self.lock()) {
+      strong_self->ReloadConfig(strong_self->embedded_config_ ?: strong_self->ReadConfig(),
+                                absl::flat_hash_set<std::string>());
+      if (strong_self->periodic_task_complete_f_) {
+        strong_self->periodic_task_complete_f_();
+      }
+    }
+  };
 
-  if (periodic_task_complete_f_) {
-    periodic_task_complete_f_();
+  if (background_scheduler_) {
+    background_scheduler_->Submit("watch_items_reapply", kMaxReapplyConfigDelayNanos,
+                                  TimerQueue(), reapply);
+  } else {
+    reapply();
   }
 
   return true;
 }
 
+void WatchItems::SetBackgroundScheduler(BackgroundScheduler* scheduler) {
+  background_scheduler_ = scheduler;
+}
+
 void WatchItems::FindPoliciesForTargets(IterateTargetsBlock iterateTargetsBlock) {
-  absl::ReaderMutexLock lock(lock_);
-  data_watch_items_.FindPolicies(iterateTargetsBlock);
+  SnapshotReadGuard snapshot(published_snapshot_);
+  snapshot->data_watch_items.FindPolicies(iterateTargetsBlock);
+}
+
+TargetPolicyPairs WatchItems::FindPoliciesForTargets(const TargetPaths& paths) {
+  SnapshotReadGuard snapshot(published_snapshot_);
+  return snapshot->data_watch_items.FindPolicies(paths);
 }
 
 void WatchItems::IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock) {
-  absl::ReaderMutexLock lock(lock_);
-  proc_watch_items_.IterateProcessPolicies(checkPolicyBlock);
+  SnapshotReadGuard snapshot(published_snapshot_);
+  snapshot->proc_watch_items.IterateProcessPolicies(checkPolicyBlock);
+}
+
+void WatchItems::FindProcessPolicies(const ProcessPolicyKeys& keys,
+                                     CheckProcessCandidateBlock checkCandidateBlock) {
+  SnapshotReadGuard snapshot(published_snapshot_);
+  snapshot->proc_watch_items.FindProcessPolicies(keys, checkCandidateBlock);
 }
 
 void WatchItems::SetDBRules(NSDictionary* rules) {
@@ -1020,8 +1231,9 @@ std::optional<WatchItemsState> WatchItems::State() {
   }
 
   WatchItemsState state = {
+      .generation = snapshot_->generation,
       .rule_count = rules_loaded_,
-      .policy_version = [NSString stringWithUTF8String:policy_version_.c_str()],
+      .policy_version = [NSString stringWithUTF8String:snapshot_->policy_version.c_str()],
       .data_source = data_source_,
       .config_path = [config_path_ copy],
       .last_config_load_epoch = last_update_time_,
@@ -1030,18 +1242,29 @@ std::optional<WatchItemsState> WatchItems::State() {
   return state;
 }
 
+uint64_t WatchItems::PolicyGeneration() {
+  SnapshotReadGuard snapshot(published_snapshot_);
+  return snapshot->generation;
+}
+
+size_t WatchItems::ApproximateBytes() {
+  SnapshotReadGuard snapshot(published_snapshot_);
+  return snapshot->data_watch_items.ApproximateBytes();
+}
+
 std::pair<NSString*, NSString*> WatchItems::EventDetailLinkInfo(
     const std::shared_ptr<WatchItemPolicyBase>& watch_item) {
-  absl::ReaderMutexLock lock(lock_);
+  SnapshotReadGuard snapshot(published_snapshot_);
   if (!watch_item) {
-    return {policy_event_detail_url_, policy_event_detail_text_};
+    return {snapshot->policy_event_detail_url, snapshot->policy_event_detail_text};
   }
 
   NSString* url = watch_item->event_detail_url.has_value() ? watch_item->event_detail_url.value()
-                                                           : policy_event_detail_url_;
+                                                           : snapshot->policy_event_detail_url;
 
-  NSString* text = watch_item->event_detail_text.has_value() ? watch_item->event_detail_text.value()
-                                                             : policy_event_detail_text_;
+  NSString* text = watch_item->event_detail_text.has_value()
+                       ? watch_item->event_detail_text.value()
+                       : snapshot->policy_event_detail_text;
 
   // Ensure empty strings are repplaced with nil
   if (!url.length) {
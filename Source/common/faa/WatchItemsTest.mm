@@ -22,10 +22,12 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <optional>
+#include <set>
 #include <string_view>
 #include <variant>
 #include <vector>
@@ -45,11 +47,15 @@ using santa::kWatchItemPolicyDefaultPathType;
 using santa::kWatchItemPolicyDefaultRuleType;
 using santa::LookupPolicyBlock;
 using santa::PairPathAndType;
+using santa::ProcessPolicyKeys;
 using santa::ProcessWatchItemPolicy;
+using santa::ProcessWatchItems;
 using santa::SetPairPathAndType;
 using santa::SetSharedDataWatchItemPolicy;
 using santa::SetSharedProcessWatchItemPolicy;
 using santa::SetWatchItemProcess;
+using santa::TargetPaths;
+using santa::TargetPolicyPairs;
 using santa::Unit;
 using santa::WatchItemPathType;
 using santa::WatchItemProcess;
@@ -72,6 +78,8 @@ std::variant<Unit, SetWatchItemProcess> VerifyConfigWatchItemProcesses(NSDiction
                                                                        NSError** err);
 extern std::optional<WatchItemRuleType> GetRuleType(NSString* rule_type);
 extern std::vector<std::string> FindMatches(NSString* path);
+extern std::vector<std::vector<std::string>> FindMatches(const std::vector<std::string>& paths,
+                                                         GlobStats* stats);
 
 class WatchItemsPeer : public WatchItems {
  public:
@@ -1452,6 +1460,50 @@ BlockGenResult CreatePolicyBlockGen() {
   XCTAssertCppStringEndsWith(matches[0], "/tmp");
 }
 
+- (void)testFindMatchesBatched {
+  [self createTestDirStructure:@[ @{
+          @"tmp" : @[
+            @{
+              @"nested" : @[ @{
+                @"app" : @[
+                  @{@"v1" : @[ @{@"plugins" : @[ @"hi.txt" ]} ]},
+                  @{@"v2" : @[ @{@"plugins" : @[ @"hi.txt" ]} ]},
+                  @{@"v3" : @[]},
+                ]
+              } ],
+            },
+            @{@"My.app" : @[ @{@"Contents" : @[ @"Info.plist" ]} ]},
+          ]
+        } ]];
+
+  std::vector<std::string> paths;
+  for (NSString* path in @[
+         @"/tmp/*/app/*/plugins/hi.txt", @"/tmp/*/app/*/*/", @"/tmp/*/apps/foo",
+         @"/tmp/My.app/Contents/Info.plist", @"/tmp/*/app/*/plugins/hi.txt"
+       ]) {
+    paths.push_back([NSString stringWithFormat:@"%@%@", self.testDir, path].UTF8String);
+  }
+
+  santa::GlobStats stats;
+  std::vector<std::vector<std::string>> matches = FindMatches(paths, &stats);
+  XCTAssertEqual(matches.size(), paths.size());
+
+  // Each path expands the same as it does on its own
+  for (size_t i = 0; i < paths.size(); i++) {
+    XCTAssertEqual(matches[i], FindMatches(@(paths[i].c_str())));
+  }
+  XCTAssertEqual(matches[0].size(), 3);
+  XCTAssertEqual(matches[1].size(), 2);
+  XCTAssertEqual(matches[2].size(), 2);
+  XCTAssertEqual(matches[3].size(), 1);
+
+  // The shared `tmp` and `app` directories are only read once, along with
+  // each of the three versions
+  XCTAssertEqual(stats.directories_read, 5);
+
+  XCTAssertEqual(FindMatches(std::vector<std::string>{}, &stats).size(), 0);
+}
+
 - (void)testDataWatchItemsBuild {
   [self createTestDirStructure:@[
     @{
@@ -1528,6 +1580,59 @@ BlockGenResult CreatePolicyBlockGen() {
   XCTAssertCStringEqual(targetPolicies[0].value_or(MakeBadPolicy())->name.c_str(), "n3");
 }
 
+- (void)testDataWatchItemsFindPoliciesBatched {
+  SetSharedDataWatchItemPolicy policies{
+      std::make_shared<DataWatchItemPolicy>("n1", "v1", "/batch/a", WatchItemPathType::kPrefix),
+      std::make_shared<DataWatchItemPolicy>("n2", "v1", "/batch/a/b", WatchItemPathType::kPrefix),
+      std::make_shared<DataWatchItemPolicy>("n3", "v1", "/batch/c", WatchItemPathType::kLiteral),
+  };
+
+  DataWatchItems watchItems;
+  watchItems.Build(policies);
+
+  // Targets sharing a leading path, identical targets, a literal that is only
+  // a prefix of the next target, and a target without a policy
+  TargetPaths paths{"/batch/a/b/f1", "/batch/a/f2", "/batch/a/f2",
+                    "/batch/c",      "/batch/c/x",  "/other"};
+  TargetPolicyPairs pairs = watchItems.FindPolicies(paths);
+
+  std::vector<const char*> want{"n2", "n1", "n1", "n3", nullptr, nullptr};
+  XCTAssertEqual(pairs.size(), want.size());
+  for (size_t i = 0; i < pairs.size(); i++) {
+    XCTAssertEqual(pairs[i].first, i);
+    if (want[i]) {
+      XCTAssertCStringEqual(pairs[i].second.value_or(MakeBadPolicy())->name.c_str(), want[i]);
+    } else {
+      XCTAssertFalse(pairs[i].second.has_value());
+    }
+  }
+
+  XCTAssertEqual(watchItems.FindPolicies(TargetPaths{}).size(), 0);
+}
+
+- (void)testDataWatchItemsBuildReusesExpansions {
+  SetSharedDataWatchItemPolicy policies{
+      std::make_shared<DataWatchItemPolicy>("n1", "v1", "/reuse/*", WatchItemPathType::kPrefix),
+  };
+
+  // The glob matches nothing on disk, so lookups only succeed if the reused
+  // expansion was used
+  DataWatchItems::GlobExpansions reuse{{"/reuse/*", {"/reuse/a"}}};
+  DataWatchItems watchItems;
+  watchItems.Build(policies, &reuse);
+
+  TargetPolicyPairs pairs = watchItems.FindPolicies(TargetPaths{"/reuse/a/f1", "/reuse/b/f1"});
+  XCTAssertCStringEqual(pairs[0].second.value_or(MakeBadPolicy())->name.c_str(), "n1");
+  XCTAssertFalse(pairs[1].second.has_value());
+  XCTAssertEqual(watchItems.Expansions(), reuse);
+
+  DataWatchItems expanded;
+  expanded.Build(policies);
+  XCTAssertEqual(expanded.Count(), 0);
+  XCTAssertEqual(expanded.Expansions().at("/reuse/*").size(), 0);
+  XCTAssertEqual(expanded.DirectoriesRead(), 0);
+}
+
 - (void)testDataWatchItemsSubtraction {
   SetSharedDataWatchItemPolicy policies1{
       std::make_shared<DataWatchItemPolicy>("n1", "v1", "a", WatchItemPathType::kPrefix),
@@ -1569,4 +1674,101 @@ BlockGenResult CreatePolicyBlockGen() {
   XCTAssertEqual(pathTypePairs2_1.count({"/z", WatchItemPathType::kPrefix}), 1);
 }
 
+- (void)testProcessWatchItemsFindProcessPolicies {
+  std::vector<uint8_t> cdhash(CS_CDHASH_LEN, 0xAB);
+  auto makePolicy = [](std::string name, WatchItemProcess proc) {
+    return std::make_shared<ProcessWatchItemPolicy>(
+        name, "v1", SetPairPathAndType{{"/data", WatchItemPathType::kPrefix}}, false, false,
+        santa::WatchItemRuleType::kProcessesWithAllowedPaths, false, false, "", nil, nil,
+        SetWatchItemProcess{proc});
+  };
+
+  ProcessWatchItems procWatchItems;
+  procWatchItems.Build({
+      makePolicy("cdhash", WatchItemProcess("/bin/a", "", "", cdhash, "", false)),
+      makePolicy("sid", WatchItemProcess("", "com.example.sid", "ABCDEFGHIJ", {}, "", false)),
+      makePolicy("tid", WatchItemProcess("", "com.example.*", "KLMNOPQRST", {}, "", false)),
+      makePolicy("path", WatchItemProcess("/bin/path", "", "", {}, "", false)),
+      makePolicy("cert", WatchItemProcess("", "", "", {}, "certhash", false)),
+      makePolicy("platform", WatchItemProcess("", "", "", {}, "", true)),
+  });
+
+  __block int certificateHashCalls = 0;
+  std::set<std::string> (^find)(ProcessPolicyKeys) = ^(ProcessPolicyKeys keys) {
+    __block std::set<std::string> names;
+    keys.certificate_sha256 = ^std::string {
+      certificateHashCalls++;
+      return "certhash";
+    };
+    procWatchItems.FindProcessPolicies(
+        keys, ^bool(const WatchItemProcess& proc,
+                    const std::shared_ptr<ProcessWatchItemPolicy>& policy) {
+          XCTAssertTrue(policy->processes.contains(proc));
+          names.insert(policy->name);
+          return false;
+        });
+    return names;
+  };
+
+  // Unindexed policy processes are always candidates, and the certificate hash
+  // is requested once since a policy process is indexed by it
+  XCTAssertEqual(find({}), (std::set<std::string>{"cert", "platform"}));
+  XCTAssertEqual(certificateHashCalls, 1);
+
+  // Each policy process is a candidate only under its most selective key
+  XCTAssertEqual(find({.binary_path = "/bin/a"}), (std::set<std::string>{"cert", "platform"}));
+  XCTAssertEqual(
+      find({.cdhash = std::string_view((const char*)cdhash.data(), cdhash.size())}),
+      (std::set<std::string>{"cdhash", "cert", "platform"}));
+  XCTAssertEqual(find({.signing_id = "com.example.sid", .team_id = "KLMNOPQRST"}),
+                 (std::set<std::string>{"sid", "tid", "cert", "platform"}));
+  XCTAssertEqual(find({.binary_path = "/bin/path"}),
+                 (std::set<std::string>{"path", "cert", "platform"}));
+
+  // Iteration stops once the block returns true
+  __block int calls = 0;
+  procWatchItems.FindProcessPolicies(
+      {.binary_path = "/bin/path"},
+      ^bool(const WatchItemProcess&, const std::shared_ptr<ProcessWatchItemPolicy>&) {
+        calls++;
+        return true;
+      });
+  XCTAssertEqual(calls, 1);
+}
+
+
+- (void)testLookupsDuringReload {
+  // Lookups racing a reload see either the old or the new policy, never a
+  // partially built one.
+  NSDictionary* configA = WrapWatchItemsConfig(@{
+    @"foo_a" : @{kWatchItemConfigKeyPaths : @[ @{kWatchItemConfigKeyPathsPath : @"/foo"} ]}
+  });
+  NSDictionary* configB = WrapWatchItemsConfig(@{
+    @"foo_b" : @{kWatchItemConfigKeyPaths : @[ @{kWatchItemConfigKeyPathsPath : @"/foo"} ]}
+  });
+
+  auto watchItems = std::make_shared<WatchItemsPeer>((NSString*)nil, nullptr);
+  watchItems->ReloadConfig(configA);
+
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    for (int i = 0; i < 200; i++) {
+      watchItems->ReloadConfig(i % 2 ? configA : configB);
+    }
+  });
+
+  auto bad = std::make_shared<std::atomic<int>>(0);
+  dispatch_apply(4, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t) {
+    for (int i = 0; i < 2000; i++) {
+      TargetPolicyPairs pairs = watchItems->FindPoliciesForTargets(TargetPaths{"/foo"});
+      if (pairs.size() != 1 || !pairs[0].second.has_value() ||
+          ((*pairs[0].second)->name != "foo_a" && (*pairs[0].second)->name != "foo_b")) {
+        (*bad)++;
+      }
+    }
+  });
+
+  XCTAssertEqual(dispatch_group_wait(group, DISPATCH_TIME_FOREVER), 0);
+  XCTAssertEqual(bad->load(), 0);
+}
 @end
@@ -0,0 +1,148 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_NE_NETWORKFLOWMATCHER_H
+#define SANTA_COMMON_NE_NETWORKFLOWMATCHER_H
+
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Matches network flows against a compiled set of network flow rules.
+//
+// Remote addresses are looked up in a binary trie per address family, so the
+// most specific CIDR is found in one walk of at most 32 or 128 nodes no matter
+// how many rules exist. Hostnames are looked up in a trie of their labels in
+// reverse order, e.g. "com" -> "example" -> "www". A rule only matches when
+// the remote port also falls in one of its port ranges.
+//
+// Hostname matches are preferred over address matches, and within each the
+// most specific match wins: an exact hostname, then the wildcard with the
+// most labels, then the longest address prefix. Rules that tie are checked
+// in the order they were given. The matcher is immutable once built and safe
+// to use from any thread.
+class NetworkFlowMatcher {
+ public:
+  struct PortRange {
+    uint16_t first;
+    uint16_t last;
+  };
+
+  struct Rule {
+    int64_t rule_id;
+    // Remote addresses in CIDR notation, e.g. "10.0.0.0/8" or "2001:db8::/32".
+    // An address without a prefix length matches only itself.
+    std::vector<std::string> cidrs;
+    // Remote hostnames, compared case insensitively. "*.example.com" matches
+    // any subdomain of example.com but not example.com itself.
+    std::vector<std::string> hostnames;
+    // Remote ports, inclusive. Empty matches any port.
+    std::vector<PortRange> ports;
+  };
+
+  // Returns nullptr if any rule has a CIDR or hostname that can't be parsed.
+  static std::unique_ptr<NetworkFlowMatcher> Create(
+      const std::vector<Rule>& rules);
+
+  NetworkFlowMatcher(NetworkFlowMatcher&& other) = default;
+  NetworkFlowMatcher& operator=(NetworkFlowMatcher&& rhs) = default;
+  NetworkFlowMatcher(const NetworkFlowMatcher& other) = delete;
+  NetworkFlowMatcher& operator=(const NetworkFlowMatcher& other) = delete;
+
+  // Returns the id of the most specific rule matching the remote endpoint.
+  // `hostname` may be empty if the flow has no hostname.
+  std::optional<int64_t> Match(const struct sockaddr* remote,
+                               std::string_view hostname) const;
+  std::optional<int64_t> Match(std::string_view address, uint16_t port,
+                               std::string_view hostname) const;
+
+  size_t RuleCount() const { return rules_.size(); }
+
+ private:
+  // Rules are referenced by their index in rules_
+  struct CompiledRule {
+    int64_t rule_id;
+    // Sorted and merged
+    std::vector<PortRange> ports;
+
+    bool MatchesPort(uint16_t port) const;
+  };
+
+  struct IPNode {
+    int32_t children[2] = {-1, -1};
+    std::vector<uint32_t> rules;
+  };
+
+  struct HostNode {
+    absl::flat_hash_map<std::string, int32_t> children;
+    std::vector<uint32_t> exact_rules;
+    std::vector<uint32_t> wildcard_rules;
+  };
+
+  NetworkFlowMatcher();
+
+  bool AddCIDR(std::string_view cidr, uint32_t rule);
+  bool AddHostname(std::string_view hostname, uint32_t rule);
+  void InsertAddress(std::vector<IPNode>& trie, const uint8_t* addr,
+                     int prefix_len, uint32_t rule);
+
+  std::optional<int64_t> MatchAddress(const std::vector<IPNode>& trie,
+                                      const uint8_t* addr, int bits,
+                                      uint16_t port) const;
+  std::optional<int64_t> MatchHostname(std::string_view hostname,
+                                       uint16_t port) const;
+  std::optional<int64_t> FirstMatching(const std::vector<uint32_t>& rules,
+                                       uint16_t port) const;
+
+  std::vector<CompiledRule> rules_;
+  std::vector<IPNode> v4_trie_;
+  std::vector<IPNode> v6_trie_;
+  std::vector<HostNode> host_trie_;
+};
+
+// Holds the matcher for the current network flow rule snapshot so that it is
+// only rebuilt when the snapshot hash changes.
+class NetworkFlowMatcherCache {
+ public:
+  NetworkFlowMatcherCache() = default;
+
+  // Returns the matcher for `snapshot_hash`, building it from the rules
+  // returned by `get_rules` if the hash differs from the last call. Returns
+  // nullptr if the rules can't be compiled.
+  std::shared_ptr<const NetworkFlowMatcher> Get(
+      std::string_view snapshot_hash,
+      const std::function<std::vector<NetworkFlowMatcher::Rule>()>& get_rules);
+
+ private:
+  absl::Mutex lock_;
+  std::optional<std::string> hash_ ABSL_GUARDED_BY(lock_);
+  std::shared_ptr<const NetworkFlowMatcher> matcher_ ABSL_GUARDED_BY(lock_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_NE_NETWORKFLOWMATCHER_H
@@ -0,0 +1,335 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ne/NetworkFlowMatcher.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace santa {
+
+namespace {
+
+// Lowercases the hostname and drops a trailing dot
+std::string NormalizeHostname(std::string_view hostname) {
+  if (!hostname.empty() && hostname.back() == '.') {
+    hostname.remove_suffix(1);
+  }
+
+  std::string normalized(hostname);
+  std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return normalized;
+}
+
+// Splits the hostname into its labels. Returns false if any label is empty.
+bool SplitLabels(std::string_view hostname, std::vector<std::string_view>& labels) {
+  labels.clear();
+  if (hostname.empty()) {
+    return false;
+  }
+
+  size_t start = 0;
+  while (true) {
+    size_t dot = hostname.find('.', start);
+    std::string_view label = hostname.substr(start, dot - start);
+    if (label.empty()) {
+      return false;
+    }
+    labels.push_back(label);
+    if (dot == std::string_view::npos) {
+      return true;
+    }
+    start = dot + 1;
+  }
+}
+
+std::vector<NetworkFlowMatcher::PortRange> MergePortRanges(
+    std::vector<NetworkFlowMatcher::PortRange> ports) {
+  std::sort(ports.begin(), ports.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  std::vector<NetworkFlowMatcher::PortRange> merged;
+  for (const auto& range : ports) {
+    if (!merged.empty() && range.first <= merged.back().last + 1) {
+      merged.back().last = std::max(merged.back().last, range.last);
+    } else {
+      merged.push_back(range);
+    }
+  }
+  return merged;
+}
+
+// Returns true if the address is an IPv4 address mapped into IPv6 (::ffff:a.b.c.d)
+bool IsV4Mapped(const uint8_t* addr) {
+  static constexpr uint8_t kPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+  return std::equal(kPrefix, kPrefix + sizeof(kPrefix), addr);
+}
+
+}  // namespace
+
+bool NetworkFlowMatcher::CompiledRule::MatchesPort(uint16_t port) const {
+  if (ports.empty()) {
+    return true;
+  }
+
+  // Find the last range starting at or before the port
+  auto it = std::upper_bound(ports.begin(), ports.end(), port,
+                             [](uint16_t p, const PortRange& range) { return p < range.first; });
+  return it != ports.begin() && port <= std::prev(it)->last;
+}
+
+NetworkFlowMatcher::NetworkFlowMatcher() : v4_trie_(1), v6_trie_(1), host_trie_(1) {}
+
+std::unique_ptr<NetworkFlowMatcher> NetworkFlowMatcher::Create(const std::vector<Rule>& rules) {
+  std::unique_ptr<NetworkFlowMatcher> matcher(new NetworkFlowMatcher());
+
+  for (const Rule& rule : rules) {
+    for (const PortRange& range : rule.ports) {
+      if (range.first > range.last) {
+        return nullptr;
+      }
+    }
+
+    uint32_t idx = static_cast<uint32_t>(matcher->rules_.size());
+    matcher->rules_.push_back({.rule_id = rule.rule_id, .ports = MergePortRanges(rule.ports)});
+
+    for (const std::string& cidr : rule.cidrs) {
+      if (!matcher->AddCIDR(cidr, idx)) {
+        return nullptr;
+      }
+    }
+    for (const std::string& hostname : rule.hostnames) {
+      if (!matcher->AddHostname(hostname, idx)) {
+        return nullptr;
+      }
+    }
+  }
+
+  return matcher;
+}
+
+bool NetworkFlowMatcher::AddCIDR(std::string_view cidr, uint32_t rule) {
+  std::string address(cidr.substr(0, cidr.find('/')));
+  uint8_t addr[16];
+  int bits;
+  std::vector<IPNode>* trie;
+  if (inet_pton(AF_INET, address.c_str(), addr) == 1) {
+    bits = 32;
+    trie = &v4_trie_;
+  } else if (inet_pton(AF_INET6, address.c_str(), addr) == 1) {
+    bits = 128;
+    trie = &v6_trie_;
+  } else {
+    return false;
+  }
+
+  int prefix_len = bits;
+  if (size_t slash = cidr.find('/'); slash != std::string_view::npos) {
+    std::string_view len = cidr.substr(slash + 1);
+    auto [ptr, ec] = std::from_chars(len.data(), len.data() + len.size(), prefix_len);
+    if (ec != std::errc() || ptr != len.data() + len.size() || len.empty() || prefix_len < 0 ||
+        prefix_len > bits) {
+      return false;
+    }
+  }
+
+  InsertAddress(*trie, addr, prefix_len, rule);
+  return true;
+}
+
+void NetworkFlowMatcher::InsertAddress(std::vector<IPNode>& trie, const uint8_t* addr,
+                                       int prefix_len, uint32_t rule) {
+  int32_t node = 0;
+  for (int i = 0; i < prefix_len; i++) {
+    int bit = (addr[i / 8] >> (7 - i % 8)) & 1;
+    if (trie[node].children[bit] < 0) {
+      trie[node].children[bit] = static_cast<int32_t>(trie.size());
+      // Don't hold a reference across the push_back, it may reallocate
+      trie.emplace_back();
+    }
+    node = trie[node].children[bit];
+  }
+  trie[node].rules.push_back(rule);
+}
+
+bool NetworkFlowMatcher::AddHostname(std::string_view hostname, uint32_t rule) {
+  std::string normalized = NormalizeHostname(hostname);
+  std::string_view name = normalized;
+
+  bool wildcard = name.starts_with("*.");
+  if (wildcard) {
+    name.remove_prefix(2);
+  }
+
+  std::vector<std::string_view> labels;
+  if (!SplitLabels(name, labels) || name.find('*') != std::string_view::npos) {
+    return false;
+  }
+
+  int32_t node = 0;
+  for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+    auto child = host_trie_[node].children.find(*it);
+    if (child != host_trie_[node].children.end()) {
+      node = child->second;
+    } else {
+      int32_t next = static_cast<int32_t>(host_trie_.size());
+      host_trie_[node].children.emplace(std::string(*it), next);
+      host_trie_.emplace_back();
+      node = next;
+    }
+  }
+
+  if (wildcard) {
+    host_trie_[node].wildcard_rules.push_back(rule);
+  } else {
+    host_trie_[node].exact_rules.push_back(rule);
+  }
+  return true;
+}
+
+std::optional<int64_t> NetworkFlowMatcher::FirstMatching(const std::vector<uint32_t>& rules,
+                                                         uint16_t port) const {
+  for (uint32_t idx : rules) {
+    if (rules_[idx].MatchesPort(port)) {
+      return rules_[idx].rule_id;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<int64_t> NetworkFlowMatcher::MatchAddress(const std::vector<IPNode>& trie,
+                                                        const uint8_t* addr, int bits,
+                                                        uint16_t port) const {
+  // Nodes along the path that have rules, from the shortest prefix to the longest
+  int32_t with_rules[129];
+  int count = 0;
+
+  int32_t node = 0;
+  for (int i = 0; node >= 0; i++) {
+    if (!trie[node].rules.empty()) {
+      with_rules[count++] = node;
+    }
+    if (i == bits) {
+      break;
+    }
+    node = trie[node].children[(addr[i / 8] >> (7 - i % 8)) & 1];
+  }
+
+  while (count-- > 0) {
+    if (auto id = FirstMatching(trie[with_rules[count]].rules, port)) {
+      return id;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<int64_t> NetworkFlowMatcher::MatchHostname(std::string_view hostname,
+                                                         uint16_t port) const {
+  std::string normalized = NormalizeHostname(hostname);
+  std::vector<std::string_view> labels;
+  if (!SplitLabels(normalized, labels)) {
+    return std::nullopt;
+  }
+
+  // path[i] is the node reached after matching the last i + 1 labels
+  std::vector<int32_t> path;
+  path.reserve(labels.size());
+  int32_t node = 0;
+  for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+    auto child = host_trie_[node].children.find(*it);
+    if (child == host_trie_[node].children.end()) {
+      break;
+    }
+    node = child->second;
+    path.push_back(node);
+  }
+
+  if (path.size() == labels.size()) {
+    if (auto id = FirstMatching(host_trie_[path.back()].exact_rules, port)) {
+      return id;
+    }
+  }
+
+  // Wildcards only match names with at least one more label than the pattern
+  for (size_t i = std::min(path.size(), labels.size() - 1); i-- > 0;) {
+    if (auto id = FirstMatching(host_trie_[path[i]].wildcard_rules, port)) {
+      return id;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<int64_t> NetworkFlowMatcher::Match(const struct sockaddr* remote,
+                                                 std::string_view hostname) const {
+  uint16_t port = 0;
+  if (remote->sa_family == AF_INET) {
+    port = ntohs(reinterpret_cast<const struct sockaddr_in*>(remote)->sin_port);
+  } else if (remote->sa_family == AF_INET6) {
+    port = ntohs(reinterpret_cast<const struct sockaddr_in6*>(remote)->sin6_port);
+  }
+
+  if (!hostname.empty()) {
+    if (auto id = MatchHostname(hostname, port)) {
+      return id;
+    }
+  }
+
+  if (remote->sa_family == AF_INET) {
+    const auto* sin = reinterpret_cast<const struct sockaddr_in*>(remote);
+    return MatchAddress(v4_trie_, reinterpret_cast<const uint8_t*>(&sin->sin_addr), 32, port);
+  } else if (remote->sa_family == AF_INET6) {
+    const uint8_t* addr =
+        reinterpret_cast<const struct sockaddr_in6*>(remote)->sin6_addr.s6_addr;
+    if (IsV4Mapped(addr)) {
+      return MatchAddress(v4_trie_, addr + 12, 32, port);
+    }
+    return MatchAddress(v6_trie_, addr, 128, port);
+  }
+  return std::nullopt;
+}
+
+std::optional<int64_t> NetworkFlowMatcher::Match(std::string_view address, uint16_t port,
+                                                 std::string_view hostname) const {
+  std::string addr_str(address);
+  struct sockaddr_in sin = {.sin_len = sizeof(sin), .sin_family = AF_INET};
+  struct sockaddr_in6 sin6 = {.sin6_len = sizeof(sin6), .sin6_family = AF_INET6};
+  if (inet_pton(AF_INET, addr_str.c_str(), &sin.sin_addr) == 1) {
+    sin.sin_port = htons(port);
+    return Match(reinterpret_cast<const struct sockaddr*>(&sin), hostname);
+  } else if (inet_pton(AF_INET6, addr_str.c_str(), &sin6.sin6_addr) == 1) {
+    sin6.sin6_port = htons(port);
+    return Match(reinterpret_cast<const struct sockaddr*>(&sin6), hostname);
+  }
+
+  return hostname.empty() ? std::nullopt : MatchHostname(hostname, port);
+}
+
+std::shared_ptr<const NetworkFlowMatcher> NetworkFlowMatcherCache::Get(
+    std::string_view snapshot_hash,
+    const std::function<std::vector<NetworkFlowMatcher::Rule>()>& get_rules) {
+  absl::MutexLock lock(&lock_);
+  if (hash_ != snapshot_hash) {
+    matcher_ = NetworkFlowMatcher::Create(get_rules());
+    hash_ = std::string(snapshot_hash);
+  }
+  return matcher_;
+}
+
+}  // namespace santa
@@ -0,0 +1,139 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/ne/NetworkFlowMatcher.h"
+
+#import <XCTest/XCTest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <memory>
+
+using santa::NetworkFlowMatcher;
+using santa::NetworkFlowMatcherCache;
+
+@interface NetworkFlowMatcherTest : XCTestCase
+@end
+
+@implementation NetworkFlowMatcherTest
+
+- (void)testLongestPrefixMatch {
+  auto sut = NetworkFlowMatcher::Create({
+      {.rule_id = 1, .cidrs = {"10.0.0.0/8"}},
+      {.rule_id = 2, .cidrs = {"10.1.0.0/16"}},
+      {.rule_id = 3, .cidrs = {"10.1.2.3"}},
+      {.rule_id = 4, .cidrs = {"0.0.0.0/0"}},
+      {.rule_id = 5, .cidrs = {"2001:db8::/32"}},
+      {.rule_id = 6, .cidrs = {"2001:db8:1::/48"}},
+  });
+  XCTAssert(sut);
+  XCTAssertEqual(sut->RuleCount(), 6);
+
+  XCTAssertEqual(sut->Match("10.2.3.4", 443, "").value_or(0), 1);
+  XCTAssertEqual(sut->Match("10.1.3.4", 443, "").value_or(0), 2);
+  XCTAssertEqual(sut->Match("10.1.2.3", 443, "").value_or(0), 3);
+  XCTAssertEqual(sut->Match("192.168.1.1", 443, "").value_or(0), 4);
+  XCTAssertEqual(sut->Match("2001:db8:2::1", 443, "").value_or(0), 5);
+  XCTAssertEqual(sut->Match("2001:db8:1::1", 443, "").value_or(0), 6);
+  XCTAssertFalse(sut->Match("2001:db9::1", 443, "").has_value());
+
+  // IPv4 mapped addresses match IPv4 rules
+  XCTAssertEqual(sut->Match("::ffff:10.1.2.3", 443, "").value_or(0), 3);
+}
+
+- (void)testHostnames {
+  auto sut = NetworkFlowMatcher::Create({
+      {.rule_id = 1, .hostnames = {"*.example.com"}},
+      {.rule_id = 2, .hostnames = {"www.example.com"}},
+      {.rule_id = 3, .hostnames = {"*.corp.example.com"}},
+      {.rule_id = 4, .cidrs = {"10.0.0.0/8"}},
+  });
+  XCTAssert(sut);
+
+  XCTAssertEqual(sut->Match("", 443, "www.example.com").value_or(0), 2);
+  XCTAssertEqual(sut->Match("", 443, "WWW.Example.COM.").value_or(0), 2);
+  XCTAssertEqual(sut->Match("", 443, "mail.example.com").value_or(0), 1);
+  XCTAssertEqual(sut->Match("", 443, "a.b.example.com").value_or(0), 1);
+  XCTAssertEqual(sut->Match("", 443, "a.corp.example.com").value_or(0), 3);
+  XCTAssertFalse(sut->Match("", 443, "example.com").has_value());
+  XCTAssertFalse(sut->Match("", 443, "corp.example.org").has_value());
+
+  // Hostname matches are preferred over address matches
+  XCTAssertEqual(sut->Match("10.1.1.1", 443, "www.example.com").value_or(0), 2);
+  XCTAssertEqual(sut->Match("10.1.1.1", 443, "www.example.org").value_or(0), 4);
+}
+
+- (void)testPorts {
+  auto sut = NetworkFlowMatcher::Create({
+      {.rule_id = 1, .cidrs = {"10.1.0.0/16"}, .ports = {{443, 443}, {8000, 8080}, {80, 80}}},
+      {.rule_id = 2, .cidrs = {"10.0.0.0/8"}},
+  });
+  XCTAssert(sut);
+
+  XCTAssertEqual(sut->Match("10.1.0.1", 80, "").value_or(0), 1);
+  XCTAssertEqual(sut->Match("10.1.0.1", 443, "").value_or(0), 1);
+  XCTAssertEqual(sut->Match("10.1.0.1", 8000, "").value_or(0), 1);
+  XCTAssertEqual(sut->Match("10.1.0.1", 8080, "").value_or(0), 1);
+
+  // A more specific rule that doesn't cover the port falls through to the next
+  XCTAssertEqual(sut->Match("10.1.0.1", 22, "").value_or(0), 2);
+  XCTAssertEqual(sut->Match("10.1.0.1", 8081, "").value_or(0), 2);
+}
+
+- (void)testSockaddr {
+  auto sut = NetworkFlowMatcher::Create({
+      {.rule_id = 1, .cidrs = {"192.0.2.0/24"}, .ports = {{53, 53}}},
+  });
+
+  struct sockaddr_in sin = {.sin_len = sizeof(sin), .sin_family = AF_INET};
+  inet_pton(AF_INET, "192.0.2.10", &sin.sin_addr);
+  sin.sin_port = htons(53);
+  XCTAssertEqual(sut->Match(reinterpret_cast<struct sockaddr*>(&sin), "").value_or(0), 1);
+
+  sin.sin_port = htons(54);
+  XCTAssertFalse(sut->Match(reinterpret_cast<struct sockaddr*>(&sin), "").has_value());
+}
+
+- (void)testInvalidRules {
+  XCTAssertFalse(NetworkFlowMatcher::Create({{.rule_id = 1, .cidrs = {"10.0.0.0/33"}}}));
+  XCTAssertFalse(NetworkFlowMatcher::Create({{.rule_id = 1, .cidrs = {"10.0.0.0/"}}}));
+  XCTAssertFalse(NetworkFlowMatcher::Create({{.rule_id = 1, .cidrs = {"not an address"}}}));
+  XCTAssertFalse(NetworkFlowMatcher::Create({{.rule_id = 1, .hostnames = {"a..com"}}}));
+  XCTAssertFalse(NetworkFlowMatcher::Create({{.rule_id = 1, .hostnames = {"*"}}}));
+  XCTAssertFalse(NetworkFlowMatcher::Create({{.rule_id = 1, .hostnames = {"a.*.com"}}}));
+  XCTAssertFalse(NetworkFlowMatcher::Create({{.rule_id = 1, .ports = {{10, 9}}}}));
+  XCTAssert(NetworkFlowMatcher::Create({}));
+}
+
+- (void)testCacheRebuildsOnlyWhenHashChanges {
+  NetworkFlowMatcherCache cache;
+  __block int builds = 0;
+  auto getRules = ^{
+    builds++;
+    return std::vector<NetworkFlowMatcher::Rule>{{.rule_id = builds, .cidrs = {"10.0.0.0/8"}}};
+  };
+
+  auto first = cache.Get("hash1", getRules);
+  XCTAssertEqual(first->Match("10.0.0.1", 0, "").value_or(0), 1);
+  XCTAssertEqual(cache.Get("hash1", getRules).get(), first.get());
+  XCTAssertEqual(builds, 1);
+
+  auto second = cache.Get("hash2", getRules);
+  XCTAssertNotEqual(second.get(), first.get());
+  XCTAssertEqual(second->Match("10.0.0.1", 0, "").value_or(0), 2);
+  XCTAssertEqual(builds, 2);
+}
+
+@end
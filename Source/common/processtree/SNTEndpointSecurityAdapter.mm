@@ -33,6 +33,12 @@ using santa::Message;
 namespace santa::santad::process_tree {
 
 void InformFromESEvent(ProcessTree& tree, const Message& msg) {
+  // Every TreeAware client informs the tree of the same lifecycle events, so
+  // drop the copies after the first before copying exec args or taking locks
+  if (tree.AlreadySeen(msg->mach_time)) {
+    return;
+  }
+
   struct Pid event_pid = PidFromAuditToken(msg->process->audit_token);
   auto proc = tree.Get(event_pid);
 
@@ -16,6 +16,9 @@
 #ifndef SANTA_COMMON_PROCESSTREE_ANNOTATIONS_ANNOTATOR_H
 #define SANTA_COMMON_PROCESSTREE_ANNOTATIONS_ANNOTATOR_H
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
 #include <optional>
 
 #include "Source/common/processtree/process_tree.pb.h"
@@ -29,14 +32,50 @@ class Annotator {
  public:
   virtual ~Annotator() = default;
 
+  // Called by the tree after it handles each fork and exec. Lazy annotators
+  // are not called.
   virtual void AnnotateFork(ProcessTree& tree, const Process& parent,
-                            const Process& child) = 0;
+                            const Process& child) {}
   virtual void AnnotateExec(ProcessTree& tree, const Process& orig_process,
-                            const Process& new_process) = 0;
+                            const Process& new_process) {}
+
+  // Annotators whose annotation on a process follows only from the annotation
+  // on its predecessor (the process it was forked from, or the image it
+  // replaced on exec) and from the process itself can be lazy. Instead of
+  // annotating every fork and exec, the tree calls Derive the first time any
+  // lazy annotation on a process is read, and keeps the result.
+  // Lazy annotators return the AnnotatorSlot their annotations are stored in.
+  virtual std::optional<size_t> LazySlot() const { return std::nullopt; }
+
+  // Compute the annotation for `process`, given the annotation on its
+  // predecessor (nullptr if it had none). Returns nullptr to leave the process
+  // unannotated.
+  virtual std::shared_ptr<const Annotator> Derive(
+      std::shared_ptr<const Annotator> predecessor,
+      const Process& process) const {
+    return nullptr;
+  }
   virtual std::optional<::santa::pb::v1::process_tree::Annotations> Proto()
       const = 0;
 };
 
+// Maximum number of distinct Annotator types whose annotations can be stored
+// on a Process.
+inline constexpr size_t kMaxAnnotators = 4;
+
+namespace internal {
+inline std::atomic<size_t> next_annotator_slot{0};
+}  // namespace internal
+
+// Index of the given Annotator type in a Process's annotation slots. Slots are
+// assigned on first use and are stable for the lifetime of the process.
+template <typename T>
+size_t AnnotatorSlot() {
+  static const size_t slot =
+      internal::next_annotator_slot.fetch_add(1, std::memory_order_relaxed);
+  return slot;
+}
+
 }  // namespace santa::santad::process_tree
 
 #endif  // SANTA_COMMON_PROCESSTREE_ANNOTATIONS_ANNOTATOR_H
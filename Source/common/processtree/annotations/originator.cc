@@ -29,17 +29,13 @@ namespace ptpb = ::santa::pb::v1::process_tree;
 
 namespace santa::santad::process_tree {
 
-void OriginatorAnnotator::AnnotateFork(ProcessTree& tree, const Process& parent,
-                                       const Process& child) {
-  // "Base case". Propagate existing annotations down to descendants.
-  if (auto annotation = tree.GetAnnotation<OriginatorAnnotator>(parent)) {
-    tree.AnnotateProcess(child, std::move(*annotation));
-  }
+std::optional<size_t> OriginatorAnnotator::LazySlot() const {
+  return AnnotatorSlot<OriginatorAnnotator>();
 }
 
-void OriginatorAnnotator::AnnotateExec(ProcessTree& tree,
-                                       const Process& orig_process,
-                                       const Process& new_process) {
+std::shared_ptr<const Annotator> OriginatorAnnotator::Derive(
+    std::shared_ptr<const Annotator> predecessor,
+    const Process& process) const {
   static const absl::flat_hash_map<std::string, ptpb::Annotations::Originator>
       originator_programs = {
           {"/usr/bin/login",
@@ -48,16 +44,16 @@ void OriginatorAnnotator::AnnotateExec(ProcessTree& tree,
            ptpb::Annotations::Originator::Annotations_Originator_CRON},
       };
 
-  if (auto annotation = tree.GetAnnotation<OriginatorAnnotator>(orig_process)) {
-    tree.AnnotateProcess(new_process, std::move(*annotation));
-    return;
+  // "Base case". Propagate existing annotations down to descendants.
+  if (predecessor) {
+    return predecessor;
   }
 
-  if (auto it = originator_programs.find(new_process.program_->executable);
+  if (auto it = originator_programs.find(process.program_->executable);
       it != originator_programs.end()) {
-    tree.AnnotateProcess(new_process,
-                         std::make_shared<OriginatorAnnotator>(it->second));
+    return std::make_shared<OriginatorAnnotator>(it->second);
   }
+  return nullptr;
 }
 
 std::optional<ptpb::Annotations> OriginatorAnnotator::Proto() const {
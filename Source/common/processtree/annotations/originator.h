@@ -16,6 +16,8 @@
 #ifndef SANTA_COMMON_PROCESSTREE_ANNOTATIONS_ORIGINATOR_H
 #define SANTA_COMMON_PROCESSTREE_ANNOTATIONS_ORIGINATOR_H
 
+#include <cstddef>
+#include <memory>
 #include <optional>
 
 #include "Source/common/processtree/annotations/annotator.h"
@@ -36,10 +38,12 @@ class OriginatorAnnotator : public Annotator {
       : originator_(originator) {};
   // clang-format on
 
-  void AnnotateFork(ProcessTree& tree, const Process& parent,
-                    const Process& child) override;
-  void AnnotateExec(ProcessTree& tree, const Process& orig_process,
-                    const Process& new_process) override;
+  // Originators are inherited from the predecessor, or set when a process
+  // execs one of the originating programs, so they are derived lazily.
+  std::optional<size_t> LazySlot() const override;
+  std::shared_ptr<const Annotator> Derive(
+      std::shared_ptr<const Annotator> predecessor,
+      const Process& process) const override;
 
   std::optional<::santa::pb::v1::process_tree::Annotations> Proto()
       const override;
@@ -77,4 +77,54 @@ namespace ptpb = ::santa::pb::v1::process_tree;
   XCTAssertEqual(*descendant_annotation_opt, *annotation_opt);
 }
 
+- (void)testDerivedOnFirstRead {
+  uint64_t event_id = 1;
+  const struct Cred cred = {.uid = 0, .gid = 0};
+
+  // Build init -> cron -> sh without reading any annotations in between
+  const struct Pid cron_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, cron_pid);
+  const struct Pid cron_exec_pid = {.pid = 2, .pidversion = 3};
+  const struct Program cron_prog = {.executable = "/usr/sbin/cron", .arguments = {}};
+  self.tree->HandleExec(event_id++, **self.tree->Get(cron_pid), cron_exec_pid, cron_prog, cred);
+
+  const struct Pid sh_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(event_id++, **self.tree->Get(cron_exec_pid), sh_pid);
+  const struct Pid sh_exec_pid = {.pid = 3, .pidversion = 4};
+  const struct Program sh_prog = {.executable = "/bin/sh", .arguments = {}};
+  self.tree->HandleExec(event_id++, **self.tree->Get(sh_pid), sh_exec_pid, sh_prog, cred);
+
+  // Reading the leaf derives the whole chain
+  auto sh = *self.tree->Get(sh_exec_pid);
+  auto annotation_opt = self.tree->GetAnnotation<OriginatorAnnotator>(*sh);
+  XCTAssertTrue(annotation_opt.has_value());
+  XCTAssertEqual((*annotation_opt)->Proto()->originator(),
+                 ptpb::Annotations::Originator::Annotations_Originator_CRON);
+
+  // The derived annotation is kept and shared with the ancestors
+  XCTAssertEqual(*self.tree->GetAnnotation<OriginatorAnnotator>(*sh), *annotation_opt);
+  auto cron = *self.tree->Get(cron_exec_pid);
+  XCTAssertEqual(*self.tree->GetAnnotation<OriginatorAnnotator>(*cron), *annotation_opt);
+
+  // Processes before the originating exec remain unannotated
+  XCTAssertFalse(self.tree->GetAnnotation<OriginatorAnnotator>(**self.tree->Get(cron_pid)));
+  XCTAssertFalse(self.tree->GetAnnotation<OriginatorAnnotator>(*self.initProc));
+  XCTAssertFalse(self.tree->ExportAnnotations(cron_pid).has_value());
+  XCTAssertTrue(self.tree->ExportAnnotations(sh_exec_pid).has_value());
+}
+
+- (void)testExplicitAnnotationTakesPrecedence {
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(1, *self.initProc, child_pid);
+  auto child = *self.tree->Get(child_pid);
+
+  auto explicit_annotation = std::make_shared<const OriginatorAnnotator>(
+      ptpb::Annotations::Originator::Annotations_Originator_LOGIN);
+  self.tree->AnnotateProcess(*child, explicit_annotation);
+
+  auto annotation_opt = self.tree->GetAnnotation<OriginatorAnnotator>(*child);
+  XCTAssertTrue(annotation_opt.has_value());
+  XCTAssertEqual(*annotation_opt, explicit_annotation);
+}
+
 @end
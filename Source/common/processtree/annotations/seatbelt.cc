@@ -0,0 +1,57 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/processtree/annotations/seatbelt.h"
+
+#include <memory>
+#include <optional>
+
+#include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_tree.h"
+#include "Source/common/processtree/process_tree.pb.h"
+
+namespace ptpb = ::santa::pb::v1::process_tree;
+
+namespace santa::santad::process_tree {
+
+void SeatbeltAnnotator::MarkSandboxed(ProcessTree& tree,
+                                      const Process& process) {
+  // Every mark is identical, so a single instance is shared by all processes.
+  static const std::shared_ptr<const SeatbeltAnnotator> mark =
+      std::make_shared<const SeatbeltAnnotator>();
+  tree.AnnotateProcess(process, mark);
+}
+
+bool SeatbeltAnnotator::IsSandboxed(const ProcessTree& tree,
+                                    const Process& process) {
+  return tree.GetAnnotation<SeatbeltAnnotator>(process).has_value();
+}
+
+std::optional<size_t> SeatbeltAnnotator::LazySlot() const {
+  return AnnotatorSlot<SeatbeltAnnotator>();
+}
+
+std::shared_ptr<const Annotator> SeatbeltAnnotator::Derive(
+    std::shared_ptr<const Annotator> predecessor,
+    const Process& process) const {
+  // Only ever set explicitly, so propagate an existing mark to descendants.
+  return predecessor;
+}
+
+std::optional<ptpb::Annotations> SeatbeltAnnotator::Proto() const {
+  return std::nullopt;
+}
+
+}  // namespace santa::santad::process_tree
@@ -0,0 +1,56 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_PROCESSTREE_ANNOTATIONS_SEATBELT_H
+#define SANTA_COMMON_PROCESSTREE_ANNOTATIONS_SEATBELT_H
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include "Source/common/processtree/annotations/annotator.h"
+#include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_tree.h"
+#include "Source/common/processtree/process_tree.pb.h"
+
+namespace santa::santad::process_tree {
+
+// Marks processes running under a sandbox Santa authorized for a seatbelt
+// required binary. The OS sandbox is irreversible and inherited across both
+// fork and exec, so once a process is marked the mark is derived lazily by
+// all of its descendants.
+class SeatbeltAnnotator : public Annotator {
+ public:
+  SeatbeltAnnotator() = default;
+
+  // Record that the given process now runs under an authorized sandbox.
+  static void MarkSandboxed(ProcessTree& tree, const Process& process);
+
+  // Whether the given process, or any process it descends from, was marked.
+  static bool IsSandboxed(const ProcessTree& tree, const Process& process);
+
+  std::optional<size_t> LazySlot() const override;
+  std::shared_ptr<const Annotator> Derive(
+      std::shared_ptr<const Annotator> predecessor,
+      const Process& process) const override;
+
+  // The mark is only used for enforcement and is not logged.
+  std::optional<::santa::pb::v1::process_tree::Annotations> Proto()
+      const override;
+};
+
+}  // namespace santa::santad::process_tree
+
+#endif  // SANTA_COMMON_PROCESSTREE_ANNOTATIONS_SEATBELT_H
@@ -0,0 +1,87 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include "Source/common/processtree/annotations/originator.h"
+#include "Source/common/processtree/annotations/seatbelt.h"
+#include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_tree_test_helpers.h"
+
+using namespace santa::santad::process_tree;
+
+@interface SeatbeltAnnotatorTest : XCTestCase
+@property std::shared_ptr<ProcessTreeTestPeer> tree;
+@property std::shared_ptr<const Process> initProc;
+@end
+
+@implementation SeatbeltAnnotatorTest
+
+- (void)setUp {
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  annotators.emplace_back(std::make_unique<OriginatorAnnotator>());
+  annotators.emplace_back(std::make_unique<SeatbeltAnnotator>());
+  self.tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  self.initProc = self.tree->InsertInit();
+}
+
+- (void)testMarkPropagatesAcrossForkAndExec {
+  uint64_t event_id = 1;
+  const struct Cred cred = {.uid = 501, .gid = 20};
+  const struct Program prog = {.executable = "/usr/local/bin/tool", .arguments = {}};
+
+  // PID 1.1: fork() -> PID 2.2: exec() -> PID 2.3, which is sandboxed
+  const struct Pid tool_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, tool_pid);
+  const struct Pid tool_exec_pid = {.pid = 2, .pidversion = 3};
+  self.tree->HandleExec(event_id++, **self.tree->Get(tool_pid), tool_exec_pid, prog, cred);
+  auto tool = *self.tree->Get(tool_exec_pid);
+  SeatbeltAnnotator::MarkSandboxed(*self.tree, *tool);
+
+  // Double fork daemonization: PID 2.3 -> PID 3.3 -> PID 4.4
+  const struct Pid child_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(event_id++, *tool, child_pid);
+  const struct Pid daemon_pid = {.pid = 4, .pidversion = 4};
+  self.tree->HandleFork(event_id++, **self.tree->Get(child_pid), daemon_pid);
+
+  // PID 4.4: exec() -> PID 4.5
+  const struct Pid daemon_exec_pid = {.pid = 4, .pidversion = 5};
+  self.tree->HandleExec(event_id++, **self.tree->Get(daemon_pid), daemon_exec_pid, prog, cred);
+
+  XCTAssertTrue(SeatbeltAnnotator::IsSandboxed(*self.tree, *tool));
+  XCTAssertTrue(SeatbeltAnnotator::IsSandboxed(*self.tree, **self.tree->Get(daemon_pid)));
+  XCTAssertTrue(SeatbeltAnnotator::IsSandboxed(*self.tree, **self.tree->Get(daemon_exec_pid)));
+
+  // The image before the sandboxed exec and unrelated processes are unmarked
+  XCTAssertFalse(SeatbeltAnnotator::IsSandboxed(*self.tree, **self.tree->Get(tool_pid)));
+  XCTAssertFalse(SeatbeltAnnotator::IsSandboxed(*self.tree, *self.initProc));
+
+  // The mark is not exported
+  XCTAssertFalse(self.tree->ExportAnnotations(daemon_exec_pid).has_value());
+}
+
+- (void)testMarkAfterRead {
+  const struct Pid pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(1, *self.initProc, pid);
+  auto proc = *self.tree->Get(pid);
+
+  // Reading first derives an empty annotation, which the mark still overrides
+  XCTAssertFalse(SeatbeltAnnotator::IsSandboxed(*self.tree, *proc));
+  SeatbeltAnnotator::MarkSandboxed(*self.tree, *proc);
+  XCTAssertTrue(SeatbeltAnnotator::IsSandboxed(*self.tree, *proc));
+}
+
+@end
@@ -18,16 +18,16 @@
 
 #include <sys/types.h>
 
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
-#include <typeindex>
 #include <vector>
 
 #include "Source/common/processtree/annotations/annotator.h"
-#include "absl/container/flat_hash_map.h"
+#include "absl/base/call_once.h"
 
 namespace santa::santad::process_tree {
 
@@ -95,6 +95,10 @@ struct BackfilledProcess {
 
 // Fwd decls
 class ProcessTree;
+class Process;
+
+// The ancestors of a process, starting with its parent and ending at a root.
+using Ancestry = std::vector<std::shared_ptr<const Process>>;
 
 class Process {
  public:
@@ -124,9 +128,20 @@ class Process {
   // annotation storage and the parent relation in memory on the process right
   // now.
   friend class ProcessTree;
-  absl::flat_hash_map<std::type_index, std::shared_ptr<const Annotator>>
-      annotations_;
+  // Indexed by AnnotatorSlot<T>() of the annotating type.
+  std::array<std::shared_ptr<const Annotator>, kMaxAnnotators> annotations_;
   std::shared_ptr<const Process> parent_;
+  // Lazily computed by ProcessTree::Ancestors. A Process's parent never
+  // changes (exec creates a new Process), so once built it stays valid.
+  mutable absl::once_flag ancestry_once_;
+  mutable std::shared_ptr<const Ancestry> ancestry_;
+  // Lazy annotations are derived together by ProcessTree on first read. Until
+  // then an exec'd Process keeps the image it replaced alive as its
+  // predecessor; otherwise the predecessor is the parent.
+  mutable absl::once_flag lazy_annotations_once_;
+  mutable std::array<std::shared_ptr<const Annotator>, kMaxAnnotators>
+      lazy_annotations_;
+  mutable std::shared_ptr<const Process> predecessor_;
   std::atomic<int> refcnt_;
   // If the process is tombstoned, the event removing it from the tree has been
   // processed, but refcnt>0 keeps it alive.
@@ -0,0 +1,80 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/processtree/process_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+#include "absl/synchronization/mutex.h"
+
+namespace santa::santad::process_tree {
+
+namespace {
+
+// Every block must be able to hold a free list link and keep the block after
+// it suitably aligned.
+size_t RoundUpBlockSize(size_t block_size, size_t min_size) {
+  block_size = std::max(block_size, min_size);
+  return (block_size + ProcessPool::kBlockAlign - 1) /
+         ProcessPool::kBlockAlign * ProcessPool::kBlockAlign;
+}
+
+}  // namespace
+
+ProcessPool::ProcessPool(size_t block_size)
+    : block_size_(RoundUpBlockSize(block_size, sizeof(FreeBlock))) {}
+
+void* ProcessPool::Allocate() {
+  absl::MutexLock lock(mtx_);
+  if (!free_list_) {
+    auto slab = std::make_unique<std::byte[]>(block_size_ * kBlocksPerSlab);
+    // Thread the new blocks onto the free list back to front so they are
+    // handed out in address order.
+    for (size_t i = kBlocksPerSlab; i > 0; i--) {
+      auto* block =
+          reinterpret_cast<FreeBlock*>(slab.get() + (i - 1) * block_size_);
+      block->next = free_list_;
+      free_list_ = block;
+    }
+    slabs_.push_back(std::move(slab));
+  }
+
+  FreeBlock* block = free_list_;
+  free_list_ = block->next;
+  blocks_in_use_++;
+  return block;
+}
+
+void ProcessPool::Deallocate(void* block) {
+  absl::MutexLock lock(mtx_);
+  assert(blocks_in_use_ > 0);
+  auto* free_block = static_cast<FreeBlock*>(block);
+  free_block->next = free_list_;
+  free_list_ = free_block;
+  blocks_in_use_--;
+}
+
+ProcessPool::Stats ProcessPool::GetStats() const {
+  absl::ReaderMutexLock lock(mtx_);
+  return Stats{
+      .slabs = slabs_.size(),
+      .blocks_in_use = blocks_in_use_,
+  };
+}
+
+}  // namespace santa::santad::process_tree
@@ -0,0 +1,125 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_PROCESSTREE_PROCESSPOOL_H
+#define SANTA_COMMON_PROCESSTREE_PROCESSPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace santa::santad::process_tree {
+
+// Fixed-size block allocator for Process nodes.
+//
+// Blocks are carved out of slabs of kBlocksPerSlab and recycled through a free
+// list, so steady fork/exit churn does not go back to the system allocator.
+// Slabs are only released when the pool is destroyed, which happens once every
+// block allocated from it has been returned (see ProcessPoolAllocator).
+class ProcessPool {
+ public:
+  static constexpr size_t kBlocksPerSlab = 256;
+  static constexpr size_t kBlockAlign = alignof(std::max_align_t);
+
+  struct Stats {
+    size_t slabs;
+    size_t blocks_in_use;
+  };
+
+  explicit ProcessPool(size_t block_size);
+  ProcessPool(const ProcessPool&) = delete;
+  ProcessPool& operator=(const ProcessPool&) = delete;
+  ProcessPool(ProcessPool&&) = delete;
+  ProcessPool& operator=(ProcessPool&&) = delete;
+
+  void* Allocate();
+  void Deallocate(void* block);
+
+  size_t BlockSize() const { return block_size_; }
+  Stats GetStats() const;
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  const size_t block_size_;
+
+  mutable absl::Mutex mtx_;
+  std::vector<std::unique_ptr<std::byte[]>> slabs_ ABSL_GUARDED_BY(mtx_);
+  FreeBlock* free_list_ ABSL_GUARDED_BY(mtx_) = nullptr;
+  size_t blocks_in_use_ ABSL_GUARDED_BY(mtx_) = 0;
+};
+
+// Allocator for std::allocate_shared that places the object and its control
+// block in a single ProcessPool block. Requests that do not fit a block fall
+// back to the global allocator. Every allocation keeps the pool alive, so
+// Processes may safely outlive the tree that created them.
+template <typename T>
+class ProcessPoolAllocator {
+ public:
+  using value_type = T;
+
+  explicit ProcessPoolAllocator(std::shared_ptr<ProcessPool> pool)
+      : pool_(std::move(pool)) {}
+
+  template <typename U>
+  ProcessPoolAllocator(const ProcessPoolAllocator<U>& other)
+      : pool_(other.pool_) {}
+
+  T* allocate(size_t n) {
+    if (UsesPool(n)) {
+      return static_cast<T*>(pool_->Allocate());
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (UsesPool(n)) {
+      pool_->Deallocate(p);
+    } else {
+      ::operator delete(p);
+    }
+  }
+
+  template <typename U>
+  friend bool operator==(const ProcessPoolAllocator& lhs,
+                         const ProcessPoolAllocator<U>& rhs) {
+    return lhs.pool_ == rhs.pool_;
+  }
+  template <typename U>
+  friend bool operator!=(const ProcessPoolAllocator& lhs,
+                         const ProcessPoolAllocator<U>& rhs) {
+    return !(lhs == rhs);
+  }
+
+ private:
+  template <typename U>
+  friend class ProcessPoolAllocator;
+
+  bool UsesPool(size_t n) const {
+    return n == 1 && sizeof(T) <= pool_->BlockSize() &&
+           alignof(T) <= ProcessPool::kBlockAlign;
+  }
+
+  std::shared_ptr<ProcessPool> pool_;
+};
+
+}  // namespace santa::santad::process_tree
+
+#endif  // SANTA_COMMON_PROCESSTREE_PROCESSPOOL_H
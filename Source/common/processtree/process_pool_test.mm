@@ -0,0 +1,104 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/processtree/process_pool.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <set>
+#include <vector>
+
+using santa::santad::process_tree::ProcessPool;
+using santa::santad::process_tree::ProcessPoolAllocator;
+
+namespace {
+
+struct Node {
+  int value;
+  char padding[100];
+};
+
+}  // namespace
+
+@interface ProcessPoolTest : XCTestCase
+@end
+
+@implementation ProcessPoolTest
+
+- (void)testBlockSizeIsRoundedUp {
+  XCTAssertEqual(ProcessPool(1).BlockSize(), ProcessPool::kBlockAlign);
+  XCTAssertEqual(ProcessPool(ProcessPool::kBlockAlign + 1).BlockSize(),
+                 2 * ProcessPool::kBlockAlign);
+}
+
+- (void)testBlocksAreRecycled {
+  ProcessPool pool(64);
+
+  void* first = pool.Allocate();
+  XCTAssertEqual(pool.GetStats().slabs, 1);
+  XCTAssertEqual(pool.GetStats().blocks_in_use, 1);
+
+  pool.Deallocate(first);
+  XCTAssertEqual(pool.GetStats().blocks_in_use, 0);
+  XCTAssertEqual(pool.Allocate(), first);
+  pool.Deallocate(first);
+}
+
+- (void)testSlabsGrowOnDemand {
+  ProcessPool pool(64);
+
+  std::set<void*> blocks;
+  for (size_t i = 0; i < ProcessPool::kBlocksPerSlab + 1; i++) {
+    blocks.insert(pool.Allocate());
+  }
+  XCTAssertEqual(blocks.size(), ProcessPool::kBlocksPerSlab + 1);
+  XCTAssertEqual(pool.GetStats().slabs, 2);
+  XCTAssertEqual(pool.GetStats().blocks_in_use, ProcessPool::kBlocksPerSlab + 1);
+
+  for (void* block : blocks) {
+    pool.Deallocate(block);
+  }
+  XCTAssertEqual(pool.GetStats().slabs, 2);
+  XCTAssertEqual(pool.GetStats().blocks_in_use, 0);
+}
+
+- (void)testAllocateShared {
+  auto pool = std::make_shared<ProcessPool>(sizeof(Node) + 64);
+
+  std::shared_ptr<Node> node =
+      std::allocate_shared<Node>(ProcessPoolAllocator<Node>(pool), Node{.value = 42});
+  XCTAssertEqual(node->value, 42);
+  XCTAssertEqual(pool->GetStats().blocks_in_use, 1);
+
+  // Allocations keep the pool alive after the last external reference is gone
+  std::weak_ptr<ProcessPool> weak_pool = pool;
+  pool.reset();
+  XCTAssertFalse(weak_pool.expired());
+
+  node.reset();
+  XCTAssertTrue(weak_pool.expired());
+}
+
+- (void)testOversizedRequestsFallBack {
+  auto pool = std::make_shared<ProcessPool>(16);
+  ProcessPoolAllocator<Node> alloc(pool);
+
+  Node* node = alloc.allocate(1);
+  XCTAssertEqual(pool->GetStats().blocks_in_use, 0);
+  alloc.deallocate(node, 1);
+}
+
+@end
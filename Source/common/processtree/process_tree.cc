@@ -32,6 +32,7 @@
 #include "Source/common/processtree/process_tree.pb.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
@@ -40,46 +41,100 @@ namespace santa::santad::process_tree {
 
 void ProcessTree::BackfillInsertChildren(
     absl::flat_hash_map<pid_t, std::vector<BackfilledProcess>>& parent_map,
-    std::shared_ptr<Process> parent, const BackfilledProcess& backfilled_proc) {
-  auto proc = std::make_shared<Process>(
+    std::shared_ptr<Process> parent, const BackfilledProcess& backfilled_proc,
+    std::array<ShardMap, kNumShards>& staged,
+    std::vector<std::shared_ptr<Process>>& order) {
+  auto proc = MakeProcess(
       backfilled_proc.pid, backfilled_proc.cred,
       // Re-use shared pointers from parent if value equivalent
       (parent && *(backfilled_proc.program) == *(parent->program_))
           ? parent->program_
           : backfilled_proc.program,
       parent);
-  {
-    absl::MutexLock lock(mtx_);
-    map_.emplace(backfilled_proc.pid, proc);
+  staged[ShardIndex(backfilled_proc.pid)].emplace(backfilled_proc.pid, proc);
+  order.push_back(proc);
+
+  for (const BackfilledProcess& child : parent_map[backfilled_proc.pid.pid]) {
+    BackfillInsertChildren(parent_map, proc, child, staged, order);
+  }
+}
+
+void ProcessTree::PublishBackfill(std::array<ShardMap, kNumShards>& staged)
+    ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  // Shard locks are always acquired in index order.
+  for (Shard& shard : shards_) {
+    shard.mtx.Lock();
   }
+  for (size_t i = 0; i < kNumShards; i++) {
+    ShardMap& map = shards_[i].map;
+    map.reserve(map.size() + staged[i].size());
+    for (auto& [pid, proc] : staged[i]) {
+      if (auto [it, inserted] = map.emplace(pid, std::move(proc)); inserted) {
+        IndexCodeSigning(*it->second);
+      }
+    }
+  }
+  for (auto it = shards_.rbegin(); it != shards_.rend(); it++) {
+    it->mtx.Unlock();
+  }
+}
 
-  // The only case where we should not have a parent is the root processes
-  // (e.g. init, kthreadd).
-  if (parent) {
-    for (auto& annotator : annotators_) {
+void ProcessTree::AnnotateBackfill(
+    const std::vector<std::shared_ptr<Process>>& order) {
+  for (const std::shared_ptr<Process>& proc : order) {
+    // The only case where we should not have a parent is the root processes
+    // (e.g. init, kthreadd).
+    if (!proc->parent_) {
+      continue;
+    }
+    for (Annotator* annotator : eager_annotators_) {
       annotator->AnnotateFork(*this, *(proc->parent_), *proc);
       if (proc->program_ != proc->parent_->program_) {
         annotator->AnnotateExec(*this, *(proc->parent_), *proc);
       }
     }
   }
+}
 
-  for (const BackfilledProcess& child : parent_map[backfilled_proc.pid.pid]) {
-    BackfillInsertChildren(parent_map, proc, child);
+ProcessTree::BackfillStats ProcessTree::LastBackfillStats() const {
+  return BackfillStats{
+      .duration_nanos = last_backfill_nanos_.load(std::memory_order_relaxed),
+      .processes = last_backfill_processes_.load(std::memory_order_relaxed),
+  };
+}
+
+size_t ProcessTree::ApproximateBytes() const {
+  size_t bytes = sizeof(*this);
+  for (const Shard& shard : shards_) {
+    ProcessPool::Stats pool = shard.pool->GetStats();
+    bytes += pool.slabs * ProcessPool::kBlocksPerSlab * shard.pool->BlockSize();
+
+    absl::ReaderMutexLock lock(shard.mtx);
+    // Swiss tables use one control byte per slot
+    bytes += shard.map.capacity() * (sizeof(ShardMap::value_type) + 1);
   }
+  return bytes;
 }
 
 void ProcessTree::HandleFork(uint64_t timestamp, const Process& parent,
                              const Pid new_pid) {
   if (Step(timestamp)) {
-    std::shared_ptr<Process> child;
+    std::shared_ptr<Process> parent_proc;
     {
-      absl::MutexLock lock(mtx_);
-      child = std::make_shared<Process>(new_pid, parent.effective_cred_,
-                                        parent.program_, map_[parent.pid_]);
-      map_.emplace(new_pid, child);
+      const Shard& shard = ShardFor(parent.pid_);
+      absl::ReaderMutexLock lock(shard.mtx);
+      parent_proc = shard.GetLocked(parent.pid_).value_or(nullptr);
     }
-    for (const auto& annotator : annotators_) {
+    auto child = MakeProcess(new_pid, parent.effective_cred_, parent.program_,
+                             parent_proc);
+    {
+      Shard& shard = ShardFor(new_pid);
+      absl::MutexLock lock(shard.mtx);
+      if (shard.map.emplace(new_pid, child).second) {
+        IndexCodeSigning(*child);
+      }
+    }
+    for (Annotator* annotator : eager_annotators_) {
       annotator->AnnotateFork(*this, parent, *child);
     }
   }
@@ -93,14 +148,24 @@ void ProcessTree::HandleExec(uint64_t timestamp, const Process& p,
     // passed?
     assert(new_pid.pid == p.pid_.pid);
 
-    auto new_proc = std::make_shared<Process>(
+    auto new_proc = MakeProcess(
         new_pid, c, std::make_shared<const Program>(prog), p.parent_);
     {
-      absl::MutexLock lock(mtx_);
-      remove_at_.push_back({timestamp, p.pid_});
-      map_.emplace(new_proc->pid_, new_proc);
+      absl::MutexLock lock(step_mtx_);
+      remove_at_.push({.timestamp = timestamp, .pid = p.pid_});
+    }
+    {
+      Shard& shard = ShardFor(new_proc->pid_);
+      absl::MutexLock lock(shard.mtx);
+      if (!lazy_annotators_.empty()) {
+        // The old image shares the pid, and so the shard, of the new one.
+        new_proc->predecessor_ = shard.GetLocked(p.pid_).value_or(nullptr);
+      }
+      if (shard.map.emplace(new_proc->pid_, new_proc).second) {
+        IndexCodeSigning(*new_proc);
+      }
     }
-    for (const auto& annotator : annotators_) {
+    for (Annotator* annotator : eager_annotators_) {
       annotator->AnnotateExec(*this, p, *new_proc);
     }
   }
@@ -108,13 +173,53 @@ void ProcessTree::HandleExec(uint64_t timestamp, const Process& p,
 
 void ProcessTree::HandleExit(uint64_t timestamp, const Process& p) {
   if (Step(timestamp)) {
-    absl::MutexLock lock(mtx_);
-    remove_at_.push_back({timestamp, p.pid_});
+    absl::MutexLock lock(step_mtx_);
+    remove_at_.push({.timestamp = timestamp, .pid = p.pid_});
   }
 }
 
+bool ProcessTree::AlreadySeen(uint64_t timestamp) const {
+  // Slots start out zeroed, so a zero timestamp can't be told apart
+  return timestamp != 0 &&
+         recent_timestamps_[timestamp % kRecentTimestampSlots].load(
+             std::memory_order_relaxed) == timestamp;
+}
+
 bool ProcessTree::Step(uint64_t timestamp) {
-  absl::MutexLock lock(mtx_);
+  if (AlreadySeen(timestamp)) {
+    return false;
+  }
+
+  std::vector<struct Pid> expired;
+  {
+    absl::MutexLock lock(step_mtx_);
+    if (!StepLocked(timestamp, expired)) {
+      return false;
+    }
+  }
+
+  // Shard locks are taken after dropping step_mtx_ so that removals only
+  // block lookups of the shard they touch.
+  for (const struct Pid& pid : expired) {
+    Shard& shard = ShardFor(pid);
+    absl::MutexLock lock(shard.mtx);
+    auto target = shard.GetLocked(pid);
+    if (!target) {
+      continue;
+    }
+    if ((*target)->refcnt_.load(std::memory_order_relaxed) > 0) {
+      (*target)->tombstoned_ = true;
+    } else {
+      UnindexCodeSigning(**target);
+      shard.map.erase(pid);
+    }
+  }
+
+  return true;
+}
+
+bool ProcessTree::StepLocked(uint64_t timestamp,
+                             std::vector<struct Pid>& expired) {
   uint64_t new_cutoff = seen_timestamps_.front();
   if (timestamp < new_cutoff) {
     // Event timestamp is before the rolling list of seen events.
@@ -141,19 +246,12 @@ bool ProcessTree::Step(uint64_t timestamp) {
   std::move(seen_timestamps_.begin() + 1, insert_point.base(),
             seen_timestamps_.begin());
   *insert_point = timestamp;
+  recent_timestamps_[timestamp % kRecentTimestampSlots].store(
+      timestamp, std::memory_order_relaxed);
 
-  for (auto it = remove_at_.begin(); it != remove_at_.end();) {
-    if (it->first < new_cutoff) {
-      if (auto target = GetLocked(it->second);
-          target && (*target)->refcnt_.load(std::memory_order_relaxed) > 0) {
-        (*target)->tombstoned_ = true;
-      } else {
-        map_.erase(it->second);
-      }
-      it = remove_at_.erase(it);
-    } else {
-      it++;
-    }
+  while (!remove_at_.empty() && remove_at_.top().timestamp < new_cutoff) {
+    expired.push_back(remove_at_.top().pid);
+    remove_at_.pop();
   }
 
   return true;
@@ -163,9 +261,10 @@ void ProcessTree::RetainProcess(const PidList& pids) {
   // Reader lock suffices: we only need the map to be stable for lookup.
   // relaxed is safe because the increment has no dependent memory operations —
   // we are only bumping a counter.
-  absl::ReaderMutexLock lock(mtx_);
   for (const struct Pid& p : pids) {
-    auto proc = GetLocked(p);
+    const Shard& shard = ShardFor(p);
+    absl::ReaderMutexLock lock(shard.mtx);
+    auto proc = shard.GetLocked(p);
     if (proc) {
       (*proc)->refcnt_.fetch_add(1, std::memory_order_relaxed);
     }
@@ -173,15 +272,17 @@ void ProcessTree::RetainProcess(const PidList& pids) {
 }
 
 void ProcessTree::ReleaseProcess(const PidList& pids) {
-  absl::MutexLock lock(mtx_);
   for (const struct Pid& p : pids) {
-    auto proc = GetLocked(p);
+    Shard& shard = ShardFor(p);
+    absl::MutexLock lock(shard.mtx);
+    auto proc = shard.GetLocked(p);
     if (proc) {
-      // relaxed is safe: the exclusive lock provides ordering for
-      // tombstoned_ and map_.erase().
+      // relaxed is safe: the exclusive shard lock provides ordering for
+      // tombstoned_ and map.erase().
       if ((*proc)->refcnt_.fetch_sub(1, std::memory_order_relaxed) == 1 &&
           (*proc)->tombstoned_) {
-        map_.erase(p);
+        UnindexCodeSigning(**proc);
+        shard.map.erase(p);
       }
     }
   }
@@ -193,22 +294,69 @@ Annotation get/set
 ---
 */
 
-void ProcessTree::AnnotateProcess(const Process& p,
-                                  std::shared_ptr<const Annotator> a) {
-  absl::MutexLock lock(mtx_);
-  const Annotator& x = *a;
-  map_[p.pid_]->annotations_.emplace(std::type_index(typeid(x)), std::move(a));
+void ProcessTree::AnnotateProcessSlot(const Process& p, size_t slot,
+                                      std::shared_ptr<const Annotator> a) {
+  assert(slot < kMaxAnnotators);
+  if (slot >= kMaxAnnotators) {
+    return;
+  }
+  Shard& shard = ShardFor(p.pid_);
+  absl::MutexLock lock(shard.mtx);
+  if (auto proc = shard.GetLocked(p.pid_); proc) {
+    // Existing annotations are kept, matching the previous map emplace.
+    std::shared_ptr<const Annotator>& annotation = (*proc)->annotations_[slot];
+    if (!annotation) {
+      annotation = std::move(a);
+    }
+  }
+}
+
+std::shared_ptr<const Annotator> ProcessTree::AnnotationInSlot(
+    const Process& p, size_t slot) const {
+  // Explicitly set annotations take precedence over derived ones.
+  if (p.annotations_[slot] || !lazy_slots_[slot]) {
+    return p.annotations_[slot];
+  }
+  DeriveLazyAnnotations(p);
+  return p.lazy_annotations_[slot];
+}
+
+void ProcessTree::DeriveLazyAnnotations(const Process& p) const {
+  absl::call_once(p.lazy_annotations_once_, [&] {
+    std::shared_ptr<const Process> predecessor =
+        p.predecessor_ ? p.predecessor_ : p.parent_;
+    for (const auto& [slot, annotator] : lazy_annotators_) {
+      p.lazy_annotations_[slot] = annotator->Derive(
+          predecessor ? AnnotationInSlot(*predecessor, slot) : nullptr, p);
+    }
+    // Nothing else needs the old image once its annotations are carried over.
+    p.predecessor_.reset();
+  });
 }
 
 std::optional<::santa::pb::v1::process_tree::Annotations>
 ProcessTree::ExportAnnotations(const Pid p) {
   auto proc = Get(p);
-  if (!proc || (*proc)->annotations_.empty()) {
+  if (!proc) {
     return std::nullopt;
   }
-  ::santa::pb::v1::process_tree::Annotations a;
-  for (const auto& [_, annotation] : (*proc)->annotations_) {
-    if (auto x = annotation->Proto(); x) a.MergeFrom(*x);
+  std::optional<::santa::pb::v1::process_tree::Annotations> a;
+  for (size_t slot = 0; slot < kMaxAnnotators; slot++) {
+    std::shared_ptr<const Annotator> annotation =
+        AnnotationInSlot(**proc, slot);
+    if (!annotation) {
+      continue;
+    }
+    // Annotations without a proto form, e.g. enforcement-only marks, are not
+    // exported.
+    auto x = annotation->Proto();
+    if (!x) {
+      continue;
+    }
+    if (!a) {
+      a.emplace();
+    }
+    a->MergeFrom(*x);
   }
   return a;
 }
@@ -222,20 +370,38 @@ Tree inspection methods
 std::vector<std::shared_ptr<const Process>> ProcessTree::RootSlice(
     std::shared_ptr<const Process> p) const {
   std::vector<std::shared_ptr<const Process>> slice;
-  while (p) {
-    slice.push_back(p);
-    p = p->parent_;
+  if (!p) {
+    return slice;
   }
+  std::shared_ptr<const Ancestry> ancestors = Ancestors(*p);
+  slice.reserve(1 + ancestors->size());
+  slice.push_back(std::move(p));
+  slice.insert(slice.end(), ancestors->begin(), ancestors->end());
   return slice;
 }
 
+std::shared_ptr<const Ancestry> ProcessTree::Ancestors(const Process& p) const {
+  absl::call_once(p.ancestry_once_, [this, &p] {
+    auto ancestry = std::make_shared<Ancestry>();
+    if (p.parent_) {
+      std::shared_ptr<const Ancestry> parent_ancestry = Ancestors(*p.parent_);
+      ancestry->reserve(1 + parent_ancestry->size());
+      ancestry->push_back(p.parent_);
+      ancestry->insert(ancestry->end(), parent_ancestry->begin(),
+                       parent_ancestry->end());
+    }
+    p.ancestry_ = std::move(ancestry);
+  });
+  return p.ancestry_;
+}
+
 void ProcessTree::Iterate(
     std::function<void(std::shared_ptr<const Process> p)> f) const {
   std::vector<std::shared_ptr<const Process>> procs;
-  {
-    absl::ReaderMutexLock lock(mtx_);
-    procs.reserve(map_.size());
-    for (auto& [_, proc] : map_) {
+  for (const Shard& shard : shards_) {
+    absl::ReaderMutexLock lock(shard.mtx);
+    procs.reserve(procs.size() + shard.map.size());
+    for (auto& [_, proc] : shard.map) {
       procs.push_back(proc);
     }
   }
@@ -247,39 +413,122 @@ void ProcessTree::Iterate(
 
 std::optional<std::shared_ptr<const Process>> ProcessTree::Get(
     const Pid target) const {
-  absl::ReaderMutexLock lock(mtx_);
-  return GetLocked(target);
+  const Shard& shard = ShardFor(target);
+  absl::ReaderMutexLock lock(shard.mtx);
+  return shard.GetLocked(target);
 }
 
-std::optional<std::shared_ptr<Process>> ProcessTree::GetLocked(
+std::optional<std::shared_ptr<Process>> ProcessTree::Shard::GetLocked(
     const Pid target) const {
-  auto it = map_.find(target);
-  if (it == map_.end()) {
+  auto it = map.find(target);
+  if (it == map.end()) {
     return std::nullopt;
   }
   return it->second;
 }
 
+size_t ProcessTree::ShardIndex(const Pid p) {
+  return absl::Hash<pid_t>{}(p.pid) % kNumShards;
+}
+
+ProcessTree::Shard& ProcessTree::ShardFor(const Pid p) const {
+  return shards_[ShardIndex(p)];
+}
+
+std::shared_ptr<Process> ProcessTree::MakeProcess(
+    const Pid pid, const Cred cred, std::shared_ptr<const Program> program,
+    std::shared_ptr<const Process> parent) {
+  return std::allocate_shared<Process>(
+      ProcessPoolAllocator<Process>(ShardFor(pid).pool), pid, cred,
+      std::move(program), std::move(parent));
+}
+
 std::shared_ptr<const Process> ProcessTree::GetParent(const Process& p) const {
   return p.parent_;
 }
 
+/*
+---
+Code signing index
+---
+*/
+
+namespace {
+
+// Returns the value of each CodeSigningField for the program, in field order.
+// Missing values are left empty and are not indexed.
+std::array<std::string_view, 3> CodeSigningValues(const Program* prog) {
+  if (!prog || !prog->code_signing) {
+    return {};
+  }
+  const CodeSigningInfo& cs = *prog->code_signing;
+  return {cs.cdhash, cs.team_id, cs.signing_id};
+}
+
+}  // namespace
+
+void ProcessTree::IndexCodeSigning(const Process& p) {
+  auto values = CodeSigningValues(p.program_.get());
+  absl::MutexLock lock(cs_index_mtx_);
+  for (size_t i = 0; i < kNumCodeSigningFields; i++) {
+    if (!values[i].empty()) {
+      cs_index_[i][values[i]].insert(p.pid_);
+    }
+  }
+}
+
+void ProcessTree::UnindexCodeSigning(const Process& p) {
+  auto values = CodeSigningValues(p.program_.get());
+  absl::MutexLock lock(cs_index_mtx_);
+  for (size_t i = 0; i < kNumCodeSigningFields; i++) {
+    if (values[i].empty()) {
+      continue;
+    }
+    auto it = cs_index_[i].find(values[i]);
+    if (it == cs_index_[i].end()) {
+      continue;
+    }
+    it->second.erase(p.pid_);
+    if (it->second.empty()) {
+      cs_index_[i].erase(it);
+    }
+  }
+}
+
+std::vector<struct Pid> ProcessTree::FindByCodeSigning(
+    CodeSigningField field, std::string_view value) const {
+  size_t idx = static_cast<size_t>(field);
+  if (idx >= kNumCodeSigningFields || value.empty()) {
+    return {};
+  }
+
+  absl::ReaderMutexLock lock(cs_index_mtx_);
+  auto it = cs_index_[idx].find(value);
+  if (it == cs_index_[idx].end()) {
+    return {};
+  }
+  return std::vector<struct Pid>(it->second.begin(), it->second.end());
+}
+
 #if SANTA_PROCESS_TREE_DEBUG
 void ProcessTree::DebugDump(std::ostream& stream) const {
-  absl::ReaderMutexLock lock(mtx_);
-  stream << map_.size() << " processes" << std::endl;
-  DebugDumpLocked(stream, 0, 0);
+  std::vector<std::shared_ptr<const Process>> procs;
+  Iterate([&procs](std::shared_ptr<const Process> p) {
+    procs.push_back(std::move(p));
+  });
+  stream << procs.size() << " processes" << std::endl;
+  DebugDumpChildren(stream, 0, 0, procs);
 }
 
-void ProcessTree::DebugDumpLocked(std::ostream& stream, int depth,
-                                  pid_t ppid) const
-    ABSL_SHARED_LOCKS_REQUIRED(mtx_) {
-  for (auto& [_, process] : map_) {
+void ProcessTree::DebugDumpChildren(
+    std::ostream& stream, int depth, pid_t ppid,
+    const std::vector<std::shared_ptr<const Process>>& procs) const {
+  for (const auto& process : procs) {
     if ((ppid == 0 && !process->parent_) ||
         (process->parent_ && process->parent_->pid_.pid == ppid)) {
       stream << std::string(2 * depth, ' ') << process->pid_.pid
              << process->program_->executable << std::endl;
-      DebugDumpLocked(stream, depth + 1, process->pid_.pid);
+      DebugDumpChildren(stream, depth + 1, process->pid_.pid, procs);
     }
   }
 }
@@ -16,12 +16,22 @@
 #ifndef SANTA_COMMON_PROCESSTREE_PROCESSTREE_H
 #define SANTA_COMMON_PROCESSTREE_PROCESSTREE_H
 
+#include <array>
+#include <atomic>
 #include <memory>
-#include <typeinfo>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "Source/common/processtree/annotations/annotator.h"
 #include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_pool.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -38,18 +48,49 @@ using PidList = absl::InlinedVector<struct Pid, 2>;
 // Fwd decl for test peer.
 class ProcessTreeTestPeer;
 
+// Code signing attributes of a Program that processes can be looked up by.
+enum class CodeSigningField {
+  kCDHash = 0,
+  kTeamID,
+  kSigningID,
+};
+
 class ProcessTree {
  public:
+  struct BackfillStats {
+    uint64_t duration_nanos;
+    uint64_t processes;
+  };
+
   explicit ProcessTree(std::vector<std::unique_ptr<Annotator>>&& annotators)
-      : annotators_(std::move(annotators)), seen_timestamps_({}) {}
+      : annotators_(std::move(annotators)), seen_timestamps_({}) {
+    for (const auto& annotator : annotators_) {
+      if (std::optional<size_t> slot = annotator->LazySlot();
+          slot && *slot < kMaxAnnotators) {
+        lazy_annotators_.emplace_back(*slot, annotator.get());
+        lazy_slots_[*slot] = true;
+      } else {
+        eager_annotators_.push_back(annotator.get());
+      }
+    }
+  }
   ProcessTree(const ProcessTree&) = delete;
   ProcessTree& operator=(const ProcessTree&) = delete;
   ProcessTree(ProcessTree&&) = delete;
   ProcessTree& operator=(ProcessTree&&) = delete;
 
   // Initialize the tree with the processes currently running on the system.
+  // Processes are loaded in parallel, and the tree is only published once
+  // every loaded process has been linked to its parent.
   absl::Status Backfill();
 
+  // Timing and size of the most recent successful Backfill.
+  BackfillStats LastBackfillStats() const;
+
+  // Approximate bytes used by the process pools and pid maps. Programs,
+  // creds and annotations shared between processes are not included.
+  size_t ApproximateBytes() const;
+
   // Inform the tree of a fork event, in which the parent process spawns a child
   // with the only difference between the two being the pid.
   void HandleFork(uint64_t timestamp, const Process& parent,
@@ -69,6 +110,13 @@ class ProcessTree {
   // Inform the tree of a process exit.
   void HandleExit(uint64_t timestamp, const Process& p);
 
+  // Lock-free check for whether the event with the given timestamp was
+  // already applied to the tree, e.g. by another client receiving the same
+  // event. Lets duplicate events be dropped before doing any work or taking
+  // the step lock. A false result is not authoritative: Step still makes the
+  // final decision.
+  bool AlreadySeen(uint64_t timestamp) const;
+
   // Mark the given pids as needing to be retained in the tree's map for future
   // access. Normally, Processes are removed once all clients process past the
   // event which would remove the Process (e.g. exit), however in cases where
@@ -80,11 +128,15 @@ class ProcessTree {
   // processing the event that retained them.
   void ReleaseProcess(const PidList& pids);
 
-  // Annotate the given process with an Annotator (state).
-  void AnnotateProcess(const Process& p, std::shared_ptr<const Annotator> a);
+  // Annotate the given process with an Annotator (state). Annotations are
+  // stored by the static type T, which is the type to pass to GetAnnotation.
+  template <typename T>
+  void AnnotateProcess(const Process& p, std::shared_ptr<T> a);
 
   // Get the given annotation on the given process if it exists, or nullopt if
-  // the annotation is not set.
+  // the annotation is not set. Reading an annotation of a lazy annotator
+  // derives all lazy annotations on the process (and on any predecessors that
+  // haven't derived theirs yet).
   template <typename T>
   std::optional<std::shared_ptr<const T>> GetAnnotation(const Process& p) const;
 
@@ -99,8 +151,14 @@ class ProcessTree {
   std::vector<std::shared_ptr<const Process>> RootSlice(
       std::shared_ptr<const Process> p) const;
 
+  // Get the ancestors of the given process, i.e. RootSlice without the process
+  // itself. The chain is built once per Process from its parent's chain and is
+  // shared by all callers, so repeated lookups neither walk nor allocate.
+  std::shared_ptr<const Ancestry> Ancestors(const Process& p) const;
+
   // Call f for all processes in the tree. The list of processes is captured
-  // before invoking f, so it is safe to mutate the tree in f.
+  // before invoking f, so it is safe to mutate the tree in f. Shards are
+  // captured one at a time, so the list is not an atomic snapshot of the tree.
   void Iterate(std::function<void(std::shared_ptr<const Process>)> f) const;
 
   // Get the Process for the given pid in the tree if it exists.
@@ -109,6 +167,13 @@ class ProcessTree {
   // Traverse the tree from the given Process to its parent.
   std::shared_ptr<const Process> GetParent(const Process& p) const;
 
+  // Get the pids of processes in the tree whose program has the given code
+  // signing value, without walking the tree. Processes that exited but are
+  // still retained are included, so callers acting on the result must verify
+  // the process is still the one they expect.
+  std::vector<struct Pid> FindByCodeSigning(CodeSigningField field,
+                                            std::string_view value) const;
+
 #if SANTA_PROCESS_TREE_DEBUG
   // Dump the tree in a human readable form to the given ostream.
   void DebugDump(std::ostream& stream) const;
@@ -116,45 +181,158 @@ class ProcessTree {
 
  private:
   friend class ProcessTreeTestPeer;
+  using ShardMap =
+      absl::flat_hash_map<const struct Pid, std::shared_ptr<Process>>;
+
+  static constexpr size_t kNumShards = 16;
+
+  // Build the Process for backfilled_proc and all of its descendants into
+  // `staged`, without making them visible in the tree. `order` receives the
+  // new Processes with every parent ahead of its children.
   void BackfillInsertChildren(
       absl::flat_hash_map<pid_t, std::vector<BackfilledProcess>>& parent_map,
       std::shared_ptr<Process> parent,
-      const BackfilledProcess& backfilled_proc);
+      const BackfilledProcess& backfilled_proc,
+      std::array<ShardMap, kNumShards>& staged,
+      std::vector<std::shared_ptr<Process>>& order);
+
+  // Move staged Processes into the shards while holding every shard lock, so
+  // readers either see none or all of them. Existing entries are kept.
+  void PublishBackfill(std::array<ShardMap, kNumShards>& staged);
+
+  // Run annotators over newly published Processes in parent-first order.
+  void AnnotateBackfill(const std::vector<std::shared_ptr<Process>>& order);
 
   // Mark that an event with the given timestamp is being processed.
   // Returns whether the given timestamp is "novel", and the tree should be
   // updated with the results of the event.
   bool Step(uint64_t timestamp);
+  // Record the timestamp in seen_timestamps_ and move pids whose removal
+  // timestamp has been synced past by all clients into `expired`.
+  bool StepLocked(uint64_t timestamp, std::vector<struct Pid>& expired)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(step_mtx_);
+
+  // The pid map is split into shards keyed by the hash of the pid (ignoring
+  // the pid version, so every version of a pid lives in the same shard).
+  // Lookups only take the owning shard's lock in shared mode, which keeps
+  // enrichment and annotators from convoying behind fork/exec/exit handling of
+  // unrelated processes.
+
+  // Room for a Process plus the shared_ptr control block and allocator that
+  // std::allocate_shared places in front of it.
+  static constexpr size_t kProcessBlockSize = sizeof(Process) + 64;
+
+  struct alignas(64) Shard {
+    mutable absl::Mutex mtx;
+    // Each shard allocates its own processes so that pool locking is spread
+    // the same way as map locking.
+    const std::shared_ptr<ProcessPool> pool =
+        std::make_shared<ProcessPool>(kProcessBlockSize);
+    ShardMap map ABSL_GUARDED_BY(mtx);
+
+    std::optional<std::shared_ptr<Process>> GetLocked(struct Pid target) const
+        ABSL_SHARED_LOCKS_REQUIRED(mtx);
+  };
 
-  std::optional<std::shared_ptr<Process>> GetLocked(struct Pid target) const
-      ABSL_SHARED_LOCKS_REQUIRED(mtx_);
+  static size_t ShardIndex(struct Pid p);
+  Shard& ShardFor(struct Pid p) const;
 
-  void DebugDumpLocked(std::ostream& stream, int depth, pid_t ppid) const;
+  // Allocate a Process from the pool of the shard that will own it.
+  std::shared_ptr<Process> MakeProcess(struct Pid pid, struct Cred cred,
+                                       std::shared_ptr<const Program> program,
+                                       std::shared_ptr<const Process> parent);
 
-  std::vector<std::unique_ptr<Annotator>> annotators_;
+  void AnnotateProcessSlot(const Process& p, size_t slot,
+                           std::shared_ptr<const Annotator> a);
+
+  // The annotation in the given slot, deriving lazy annotations if needed.
+  std::shared_ptr<const Annotator> AnnotationInSlot(const Process& p,
+                                                    size_t slot) const;
+  void DeriveLazyAnnotations(const Process& p) const;
+
+  // Add or remove a Process from the code signing index. Called whenever the
+  // Process is added to or removed from its shard's map.
+  void IndexCodeSigning(const Process& p);
+  void UnindexCodeSigning(const Process& p);
 
-  mutable absl::Mutex mtx_;
-  absl::flat_hash_map<const struct Pid, std::shared_ptr<Process>> map_
-      ABSL_GUARDED_BY(mtx_);
-  // List of pids which should be removed from map_, and at the timestamp at
+#if SANTA_PROCESS_TREE_DEBUG
+  void DebugDumpChildren(
+      std::ostream& stream, int depth, pid_t ppid,
+      const std::vector<std::shared_ptr<const Process>>& procs) const;
+#endif
+
+  std::vector<std::unique_ptr<Annotator>> annotators_;
+  // Views into annotators_, split by whether the annotator is lazy.
+  std::vector<Annotator*> eager_annotators_;
+  std::vector<std::pair<size_t, const Annotator*>> lazy_annotators_;
+  std::array<bool, kMaxAnnotators> lazy_slots_{};
+
+  mutable std::array<Shard, kNumShards> shards_;
+
+  // Pids of processes in the tree, keyed by each code signing value of their
+  // program and indexed by CodeSigningField. May be acquired while holding
+  // shard locks, but never the other way around.
+  static constexpr size_t kNumCodeSigningFields = 3;
+  using CodeSigningIndex =
+      absl::flat_hash_map<std::string, absl::flat_hash_set<struct Pid>>;
+  mutable absl::Mutex cs_index_mtx_;
+  std::array<CodeSigningIndex, kNumCodeSigningFields> cs_index_
+      ABSL_GUARDED_BY(cs_index_mtx_);
+
+  std::atomic<uint64_t> last_backfill_nanos_{0};
+  std::atomic<uint64_t> last_backfill_processes_{0};
+
+  // Guards the event bookkeeping below. Never held while acquiring a shard
+  // lock.
+  absl::Mutex step_mtx_;
+  // List of pids which should be removed from the map, and at the timestamp at
   // which they should be.
   // Elements are removed when the timestamp falls out of the seen_timestamps_
   // list below, signifying that all clients have synced past the timestamp.
-  std::vector<std::pair<uint64_t, struct Pid>> remove_at_ ABSL_GUARDED_BY(mtx_);
+  // Kept as a min-heap on the timestamp so each Step only touches the entries
+  // that are due.
+  struct RemoveAt {
+    uint64_t timestamp;
+    struct Pid pid;
+  };
+  struct RemoveAtLater {
+    bool operator()(const RemoveAt& lhs, const RemoveAt& rhs) const {
+      return lhs.timestamp > rhs.timestamp;
+    }
+  };
+  std::priority_queue<RemoveAt, std::vector<RemoveAt>, RemoveAtLater> remove_at_
+      ABSL_GUARDED_BY(step_mtx_);
   // Rolling list of event timestamps processed by the tree.
   // This is used to ensure an event only gets processed once, even if events
   // come out of order.
-  std::array<uint64_t, 32> seen_timestamps_ ABSL_GUARDED_BY(mtx_);
+  std::array<uint64_t, 32> seen_timestamps_ ABSL_GUARDED_BY(step_mtx_);
+  // Timestamps accepted by StepLocked, each stored in the slot selected by
+  // the timestamp. A slot only ever holds an accepted timestamp, so a match
+  // in AlreadySeen is always a duplicate.
+  static constexpr size_t kRecentTimestampSlots = 64;
+  std::array<std::atomic<uint64_t>, kRecentTimestampSlots> recent_timestamps_{};
 };
 
+template <typename T>
+void ProcessTree::AnnotateProcess(const Process& p, std::shared_ptr<T> a) {
+  AnnotateProcessSlot(p, AnnotatorSlot<std::remove_const_t<T>>(),
+                      std::move(a));
+}
+
 template <typename T>
 std::optional<std::shared_ptr<const T>> ProcessTree::GetAnnotation(
     const Process& p) const {
-  auto it = p.annotations_.find(std::type_index(typeid(T)));
-  if (it == p.annotations_.end()) {
+  size_t slot = AnnotatorSlot<std::remove_const_t<T>>();
+  if (slot >= kMaxAnnotators) {
+    return std::nullopt;
+  }
+  std::shared_ptr<const Annotator> annotation = AnnotationInSlot(p, slot);
+  if (!annotation) {
     return std::nullopt;
   }
-  return std::dynamic_pointer_cast<const T>(it->second);
+  // The slot is only ever populated by AnnotateProcess<T> or by the lazy
+  // annotator of type T.
+  return std::static_pointer_cast<const T>(std::move(annotation));
 }
 
 // Create a new tree, ensuring the provided annotations are valid and that
@@ -17,16 +17,20 @@
 
 #import <Foundation/Foundation.h>
 #include <bsm/libbsm.h>
+#include <dispatch/dispatch.h>
 #include <libproc.h>
 #include <mach/message.h>
 #include <string.h>
 #include <sys/sysctl.h>
+#include <time.h>
 
+#include <array>
 #include <memory>
 #include <optional>
 #include <vector>
 
 #include "Source/common/CSOpsHelper.h"
+#include "Source/common/Signposts.h"
 #include "Source/common/SystemResources.h"
 #include "Source/common/processtree/process.h"
 #include "absl/container/flat_hash_map.h"
@@ -177,36 +181,79 @@ absl::StatusOr<BackfilledProcess> LoadPID(pid_t pid) {
   };
 }
 
+namespace {
+
+// A process loaded during backfill along with its parent pid.
+struct LoadedProcess {
+  pid_t ppid;
+  BackfilledProcess proc;
+};
+
+std::optional<LoadedProcess> LoadBackfillPID(pid_t pid) {
+  auto proc_status = LoadPID(pid);
+  if (!proc_status.ok()) {
+    return std::nullopt;
+  }
+
+  // Determine ppid
+  // Alternatively, there's a sysctl interface:
+  //  https://chromium.googlesource.com/chromium/chromium/+/master/base/process_util_openbsd.cc#32
+  struct proc_bsdinfo bsdinfo;
+  if (proc_pidinfo(pid, PROC_PIDTBSDINFO, 0, &bsdinfo, sizeof(bsdinfo)) != PROC_PIDTBSDINFO_SIZE) {
+    return std::nullopt;
+  }
+
+  return LoadedProcess{
+      .ppid = (pid_t)bsdinfo.pbi_ppid,
+      .proc = std::move(proc_status).value(),
+  };
+}
+
+}  // namespace
+
 absl::Status ProcessTree::Backfill() {
+  santa::ScopedSignpost signpost(santa::SignpostPhase::kProcessTreeBackfill);
+  uint64_t start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+
   std::optional<std::vector<pid_t>> pid_list = GetPidList();
   if (!pid_list.has_value()) {
     return absl::InternalError("GetPidList() failed");
   }
 
+  // Loading a pid is a handful of syscalls that are independent of every other
+  // pid, so spread them across the global concurrent queue. Each iteration only
+  // writes its own slot.
+  const std::vector<pid_t>& pids = *pid_list;
+  std::vector<std::optional<LoadedProcess>> loaded(pids.size());
+  const pid_t* pids_data = pids.data();
+  std::optional<LoadedProcess>* loaded_data = loaded.data();
+  dispatch_apply(pids.size(), dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
+    loaded_data[i] = LoadBackfillPID(pids_data[i]);
+  });
+
   absl::flat_hash_map<pid_t, std::vector<BackfilledProcess>> parent_map;
-  for (pid_t pid : pid_list.value()) {
-    auto proc_status = LoadPID(pid);
-    if (proc_status.ok()) {
-      auto backfilled_proc = std::move(proc_status).value();
-
-      // Determine ppid
-      // Alternatively, there's a sysctl interface:
-      //  https://chromium.googlesource.com/chromium/chromium/+/master/base/process_util_openbsd.cc#32
-      struct proc_bsdinfo bsdinfo;
-      if (proc_pidinfo(pid, PROC_PIDTBSDINFO, 0, &bsdinfo, sizeof(bsdinfo)) !=
-          PROC_PIDTBSDINFO_SIZE) {
-        continue;
-      };
-
-      parent_map[bsdinfo.pbi_ppid].push_back(std::move(backfilled_proc));
+  parent_map.reserve(loaded.size());
+  for (std::optional<LoadedProcess>& p : loaded) {
+    if (p.has_value()) {
+      parent_map[p->ppid].push_back(std::move(p->proc));
     }
   }
 
+  std::array<ShardMap, kNumShards> staged;
+  std::vector<std::shared_ptr<Process>> order;
+  order.reserve(loaded.size());
   auto& roots = parent_map[0];
   for (const BackfilledProcess& p : roots) {
-    BackfillInsertChildren(parent_map, std::shared_ptr<Process>(), p);
+    BackfillInsertChildren(parent_map, std::shared_ptr<Process>(), p, staged, order);
   }
 
+  PublishBackfill(staged);
+  AnnotateBackfill(order);
+
+  last_backfill_nanos_.store(clock_gettime_nsec_np(CLOCK_MONOTONIC) - start,
+                             std::memory_order_relaxed);
+  last_backfill_processes_.store(order.size(), std::memory_order_relaxed);
+
   return absl::OkStatus();
 }
 
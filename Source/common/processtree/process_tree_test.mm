@@ -17,9 +17,13 @@
 #import <XCTest/XCTest.h>
 
 #include <bsm/libbsm.h>
+#include <dispatch/dispatch.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Source/common/processtree/annotations/annotator.h"
 #include "Source/common/processtree/process.h"
@@ -109,6 +113,39 @@ using namespace santa::santad::process_tree;
   XCTAssertEqual(child->effective_cred_, self.initProc->effective_cred_);
 }
 
+- (void)testAncestors {
+  uint64_t event_id = 1;
+  // PID 1.1: fork() -> PID 2.2, exec() -> PID 2.3, fork() -> PID 3.3
+  const struct Pid shell_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, shell_pid);
+  auto shell = *self.tree->Get(shell_pid);
+
+  const struct Pid shell_exec_pid = {.pid = 2, .pidversion = 3};
+  self.tree->HandleExec(event_id++, *shell, shell_exec_pid,
+                        {.executable = "/bin/zsh", .arguments = {}}, shell->effective_cred_);
+  auto shell_exec = *self.tree->Get(shell_exec_pid);
+
+  const struct Pid child_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(event_id++, *shell_exec, child_pid);
+  auto child = *self.tree->Get(child_pid);
+
+  XCTAssertTrue(self.tree->Ancestors(*self.initProc)->empty());
+
+  auto ancestors = self.tree->Ancestors(*child);
+  XCTAssertEqual(ancestors->size(), 2);
+  XCTAssertEqual((*ancestors)[0], shell_exec);
+  XCTAssertEqual((*ancestors)[1], self.initProc);
+
+  // The chain is memoized and shared between callers
+  XCTAssertEqual(self.tree->Ancestors(*child).get(), ancestors.get());
+
+  auto slice = self.tree->RootSlice(child);
+  XCTAssertEqual(slice.size(), 3);
+  XCTAssertEqual(slice[0], child);
+  XCTAssertEqual(slice[1], shell_exec);
+  XCTAssertEqual(slice[2], self.initProc);
+}
+
 // We can't test the full backfill process, as retrieving information on
 // processes (with task_name_for_pid) requires privileges.
 // Test what we can by LoadPID'ing ourselves.
@@ -136,6 +173,17 @@ using namespace santa::santad::process_tree;
       }];
 }
 
+- (void)testBackfillRecordsStats {
+  std::vector<std::unique_ptr<Annotator>> annotators{};
+  auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  XCTAssertEqual(tree->LastBackfillStats().duration_nanos, 0);
+
+  // Without privileges most pids (including launchd) cannot be loaded, so only
+  // check that the backfill completes and is timed.
+  XCTAssertTrue(tree->Backfill().ok());
+  XCTAssertGreaterThan(tree->LastBackfillStats().duration_nanos, 0);
+}
+
 - (void)testAnnotation {
   std::vector<std::unique_ptr<Annotator>> annotators{};
   annotators.emplace_back(std::make_unique<TestAnnotator>());
@@ -176,6 +224,80 @@ using namespace santa::santad::process_tree;
   XCTAssertTrue(annotation.has_value());
 }
 
+- (void)testFindByCodeSigning {
+  uint64_t event_id = 1;
+  const struct Program signed_prog = {
+      .executable = "/Applications/Foo.app/Contents/MacOS/Foo",
+      .arguments = {"Foo"},
+      .code_signing = (CodeSigningInfo){.signing_id = "com.example.foo",
+                                        .team_id = "EQHXZ8M8AV",
+                                        .cdhash = "0102030405060708090a0b0c0d0e0f1011121314"},
+  };
+
+  // PID 2.2: fork() -> exec(Foo) -> PID 2.3
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, child_pid);
+  const struct Pid child_exec_pid = {.pid = 2, .pidversion = 3};
+  self.tree->HandleExec(event_id++, **self.tree->Get(child_pid), child_exec_pid, signed_prog,
+                        self.initProc->effective_cred_);
+
+  // PID 2.3: fork() -> PID 3.3, running the same program
+  const struct Pid grandchild_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(event_id++, **self.tree->Get(child_exec_pid), grandchild_pid);
+
+  auto sorted = [](std::vector<struct Pid> pids) {
+    std::sort(pids.begin(), pids.end(),
+              [](const struct Pid& lhs, const struct Pid& rhs) { return lhs.pid < rhs.pid; });
+    return pids;
+  };
+  std::vector<struct Pid> want = {child_exec_pid, grandchild_pid};
+
+  XCTAssertEqual(sorted(self.tree->FindByCodeSigning(CodeSigningField::kCDHash,
+                                                     "0102030405060708090a0b0c0d0e0f1011121314")),
+                 want);
+  XCTAssertEqual(sorted(self.tree->FindByCodeSigning(CodeSigningField::kTeamID, "EQHXZ8M8AV")),
+                 want);
+  XCTAssertEqual(
+      sorted(self.tree->FindByCodeSigning(CodeSigningField::kSigningID, "com.example.foo")), want);
+  XCTAssertTrue(self.tree->FindByCodeSigning(CodeSigningField::kSigningID, "EQHXZ8M8AV").empty());
+  XCTAssertTrue(self.tree->FindByCodeSigning(CodeSigningField::kTeamID, "").empty());
+
+  // Processes leave the index once they are removed from the tree
+  self.tree->HandleExit(event_id++, **self.tree->Get(grandchild_pid));
+  struct Pid churn_pid = {.pid = 100, .pidversion = 100};
+  for (int i = 0; i < 33; i++) {
+    self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+    churn_pid.pid++;
+  }
+  XCTAssertFalse(self.tree->Get(grandchild_pid).has_value());
+
+  want = {child_exec_pid};
+  XCTAssertEqual(self.tree->FindByCodeSigning(CodeSigningField::kTeamID, "EQHXZ8M8AV"), want);
+}
+
+- (void)testDuplicateEventsIgnored {
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  XCTAssertFalse(self.tree->AlreadySeen(5));
+  self.tree->HandleFork(5, *self.initProc, child_pid);
+  XCTAssertTrue(self.tree->AlreadySeen(5));
+  XCTAssertFalse(self.tree->AlreadySeen(6));
+
+  // Another client delivering the same event doesn't change the tree
+  const struct Pid dup_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(5, *self.initProc, dup_pid);
+  XCTAssertTrue(self.tree->Get(child_pid).has_value());
+  XCTAssertFalse(self.tree->Get(dup_pid).has_value());
+
+  // Events older than the rolling window are still rejected once their slot
+  // has been reused
+  for (uint64_t ts = 6; ts < 6 + 64; ts++) {
+    self.tree->HandleFork(ts, *self.initProc, {.pid = (pid_t)(100 + ts), .pidversion = 1});
+  }
+  XCTAssertFalse(self.tree->AlreadySeen(5));
+  self.tree->HandleFork(5, *self.initProc, dup_pid);
+  XCTAssertFalse(self.tree->Get(dup_pid).has_value());
+}
+
 - (void)testCleanup {
   uint64_t event_id = 1;
   const struct Pid child_pid = {.pid = 2, .pidversion = 2};
@@ -206,6 +328,34 @@ using namespace santa::santad::process_tree;
   }
 }
 
+- (void)testBatchedCleanup {
+  uint64_t event_id = 1;
+  const int kChildren = 100;
+  for (int i = 0; i < kChildren; i++) {
+    const struct Pid child_pid = {.pid = 1000 + i, .pidversion = 1};
+    self.tree->HandleFork(event_id++, *self.initProc, child_pid);
+  }
+  // Exit in reverse order so removals are not queued in pid order.
+  for (int i = kChildren - 1; i >= 0; i--) {
+    auto child = *self.tree->Get({.pid = 1000 + i, .pidversion = 1});
+    self.tree->HandleExit(event_id++, *child);
+  }
+
+  // Each step only reaps the exits that have fallen out of the window.
+  struct Pid churn_pid = {.pid = 3, .pidversion = 3};
+  for (int i = 0; i < 32; i++) {
+    self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+    churn_pid.pid++;
+  }
+  XCTAssertFalse(self.tree->Get({.pid = 1000 + kChildren - 1, .pidversion = 1}).has_value());
+  XCTAssertTrue(self.tree->Get({.pid = 1000, .pidversion = 1}).has_value());
+
+  self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+  for (int i = 0; i < kChildren; i++) {
+    XCTAssertFalse(self.tree->Get({.pid = 1000 + i, .pidversion = 1}).has_value());
+  }
+}
+
 - (void)testRefcountCleanup {
   uint64_t event_id = 1;
   const struct Pid child_pid = {.pid = 2, .pidversion = 2};
@@ -246,4 +396,92 @@ using namespace santa::santad::process_tree;
   }
 }
 
+- (void)testProcessesArePoolAllocated {
+  XCTAssertEqual(self.tree->PooledProcessCount(), 1);
+
+  uint64_t event_id = 1;
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, child_pid);
+  XCTAssertEqual(self.tree->PooledProcessCount(), 2);
+
+  // Blocks are returned once both the tree and all clients drop the process.
+  std::shared_ptr<const Process> child = *self.tree->Get(child_pid);
+  self.tree->HandleExit(event_id++, *child);
+  struct Pid churn_pid = {.pid = 3, .pidversion = 3};
+  for (int i = 0; i < 33; i++) {
+    self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+    churn_pid.pid++;
+  }
+  XCTAssertFalse(self.tree->Get(child_pid).has_value());
+  XCTAssertEqual(self.tree->PooledProcessCount(), 2 + 33);
+
+  child.reset();
+  XCTAssertEqual(self.tree->PooledProcessCount(), 1 + 33);
+}
+
+- (void)testAnnotationSlots {
+  // Annotations are stored per annotator type, and a second annotation of the
+  // same type does not replace the first.
+  auto first = std::make_shared<TestAnnotator>();
+  self.tree->AnnotateProcess(*self.initProc, first);
+  self.tree->AnnotateProcess(*self.initProc, std::make_shared<TestAnnotator>());
+
+  auto annotation = self.tree->GetAnnotation<TestAnnotator>(*self.initProc);
+  XCTAssertTrue(annotation.has_value());
+  XCTAssertEqual(annotation->get(), first.get());
+
+  // TestAnnotator has no proto form, but the process is still annotated.
+  auto exported = self.tree->ExportAnnotations(self.initProc->pid_);
+  XCTAssertTrue(exported.has_value());
+  XCTAssertFalse(self.tree->ExportAnnotations({.pid = 99, .pidversion = 99}).has_value());
+}
+
+// Benchmark of concurrent lookups against a steady stream of fork/exit
+// events for unrelated processes, as seen on hosts running parallel builds.
+- (void)testContendedLookupsAndUpdates {
+  const int kWorkers = 16;
+  const int kOpsPerWorker = 20000;
+  const int kPidsPerWorker = 64;
+
+  [self measureBlock:^{
+    std::vector<std::unique_ptr<Annotator>> annotators{};
+    auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+    std::shared_ptr<const Process> init = tree->InsertInit();
+    auto next_event = std::make_shared<std::atomic<uint64_t>>(1);
+    auto bad_slices = std::make_shared<std::atomic<int>>(0);
+
+    dispatch_apply(kWorkers, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t w) {
+      // Every fourth worker forks and exits processes, the rest look up the
+      // processes of their nearest writer.
+      bool writer = (w % 4 == 0);
+      size_t range = w - w % 4;
+      for (int i = 0; i < kOpsPerWorker; i++) {
+        const struct Pid pid = {
+            .pid = (pid_t)(2 + range * kPidsPerWorker + i % kPidsPerWorker),
+            .pidversion = (uint64_t)i,
+        };
+        if (writer) {
+          tree->HandleFork(next_event->fetch_add(1), *init, pid);
+          if (auto proc = tree->Get(pid)) {
+            tree->HandleExit(next_event->fetch_add(1), **proc);
+          }
+          continue;
+        }
+
+        // Readers walk whichever processes currently exist, which always
+        // ends at init.
+        auto proc = tree->Get(pid);
+        auto slice = tree->RootSlice(proc ? *proc : init);
+        if (slice.back() != init) {
+          bad_slices->fetch_add(1);
+        }
+        (void)tree->Get(init->pid_);
+      }
+    });
+
+    XCTAssertEqual(bad_slices->load(), 0);
+    XCTAssertTrue(tree->Get(init->pid_).has_value());
+  }];
+}
+
 @end
@@ -28,6 +28,8 @@ class ProcessTreeTestPeer : public ProcessTree {
       std::vector<std::unique_ptr<Annotator>>&& annotators)
       : ProcessTree(std::move(annotators)) {}
   std::shared_ptr<const Process> InsertInit();
+  // Number of live Processes allocated from the shard pools.
+  size_t PooledProcessCount() const;
 };
 
 }  // namespace santa::santad::process_tree
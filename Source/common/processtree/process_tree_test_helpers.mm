@@ -26,19 +26,29 @@ namespace santa::santad::process_tree {
 class ProcessTreeTestPeer : public ProcessTree {
  public:
   std::shared_ptr<const Process> InsertInit();
+  size_t PooledProcessCount() const;
 };
 
 std::shared_ptr<const Process> ProcessTreeTestPeer::InsertInit() {
-  absl::MutexLock lock(mtx_);
   struct Pid initpid = {
       .pid = 1,
       .pidversion = 1,
   };
-  auto proc = std::make_shared<Process>(
+  Shard& shard = ShardFor(initpid);
+  absl::MutexLock lock(shard.mtx);
+  auto proc = MakeProcess(
       initpid, (Cred){.uid = 0, .gid = 0},
       std::make_shared<Program>((Program){.executable = "/init", .arguments = {"/init"}}), nullptr);
-  map_.emplace(initpid, proc);
+  shard.map.emplace(initpid, proc);
   return proc;
 }
 
+size_t ProcessTreeTestPeer::PooledProcessCount() const {
+  size_t count = 0;
+  for (const Shard& shard : shards_) {
+    count += shard.pool->GetStats().blocks_in_use;
+  }
+  return count;
+}
+
 }  // namespace santa::santad::process_tree
@@ -0,0 +1,99 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/processtree/snapshot.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/strings/escaping.h"
+
+namespace ptpb = ::santa::pb::v1::process_tree;
+
+namespace santa::santad::process_tree {
+
+namespace {
+
+void EncodePid(ptpb::Snapshot::Pid* pb_pid, const struct Pid& pid) {
+  pb_pid->set_pid(pid.pid);
+  pb_pid->set_pidversion(static_cast<int32_t>(pid.pidversion));
+}
+
+}  // namespace
+
+ptpb::Snapshot SnapshotEncoder::Next(ProcessTree& tree) {
+  sequence_++;
+  bool full = full_interval_ == 0
+                  ? sequence_ == 1
+                  : (sequence_ - 1) % full_interval_ == 0;
+
+  ptpb::Snapshot snapshot;
+  snapshot.set_sequence(sequence_);
+  if (!full) {
+    snapshot.set_base_sequence(sequence_ - 1);
+  }
+
+  absl::flat_hash_map<struct Pid, std::string> current;
+  current.reserve(previous_.size());
+
+  tree.Iterate([&](std::shared_ptr<const Process> p) {
+    std::optional<ptpb::Annotations> annotations =
+        tree.ExportAnnotations(p->pid_);
+    std::string encoded_annotations =
+        annotations ? annotations->SerializeAsString() : std::string();
+
+    auto [it, inserted] = current.emplace(p->pid_, encoded_annotations);
+    if (!inserted) {
+      return;
+    }
+
+    if (!full) {
+      auto prev = previous_.find(p->pid_);
+      if (prev != previous_.end() && prev->second == encoded_annotations) {
+        return;
+      }
+    }
+
+    ptpb::Snapshot::Process* pb_proc = snapshot.add_processes();
+    EncodePid(pb_proc->mutable_id(), p->pid_);
+    if (std::shared_ptr<const Process> parent = tree.GetParent(*p)) {
+      EncodePid(pb_proc->mutable_parent_id(), parent->pid_);
+    }
+    if (p->program_->code_signing) {
+      std::string cdhash;
+      if (absl::HexStringToBytes(p->program_->code_signing->cdhash, &cdhash)) {
+        pb_proc->set_cdhash(std::move(cdhash));
+      }
+    }
+    if (annotations) {
+      *pb_proc->mutable_annotations() = std::move(*annotations);
+    }
+  });
+
+  if (!full) {
+    for (const auto& [pid, unused] : previous_) {
+      if (!current.contains(pid)) {
+        EncodePid(snapshot.add_removed(), pid);
+      }
+    }
+  }
+
+  previous_ = std::move(current);
+  return snapshot;
+}
+
+}  // namespace santa::santad::process_tree
@@ -0,0 +1,53 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_PROCESSTREE_SNAPSHOT_H
+#define SANTA_COMMON_PROCESSTREE_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+
+#include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_tree.h"
+#include "Source/common/processtree/process_tree.pb.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace santa::santad::process_tree {
+
+// Encodes a series of snapshots of a tree, each one relative to the previous
+// snapshot produced by the same encoder. Not thread safe.
+class SnapshotEncoder {
+ public:
+  // Every `full_interval` snapshots, starting with the first, list the whole
+  // tree so that consumers that missed earlier snapshots can resync. Zero
+  // only makes the first snapshot full.
+  explicit SnapshotEncoder(uint32_t full_interval = kDefaultFullInterval)
+      : full_interval_(full_interval) {}
+
+  static constexpr uint32_t kDefaultFullInterval = 12;
+
+  ::santa::pb::v1::process_tree::Snapshot Next(ProcessTree& tree);
+
+ private:
+  uint32_t full_interval_;
+  uint64_t sequence_ = 0;
+  // Serialized annotations of each process in the previous snapshot. The
+  // other fields of a Process never change.
+  absl::flat_hash_map<struct Pid, std::string> previous_;
+};
+
+}  // namespace santa::santad::process_tree
+
+#endif  // SANTA_COMMON_PROCESSTREE_SNAPSHOT_H
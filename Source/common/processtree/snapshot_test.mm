@@ -0,0 +1,164 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/processtree/snapshot.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Source/common/processtree/annotations/originator.h"
+#include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_tree.pb.h"
+#include "Source/common/processtree/process_tree_test_helpers.h"
+
+using namespace santa::santad::process_tree;
+namespace ptpb = ::santa::pb::v1::process_tree;
+
+namespace {
+
+using PidPair = std::pair<int32_t, int32_t>;
+
+std::vector<PidPair> SortedPids(
+    const google::protobuf::RepeatedPtrField<ptpb::Snapshot::Pid>& pids) {
+  std::vector<PidPair> out;
+  for (const auto& pid : pids) {
+    out.emplace_back(pid.pid(), pid.pidversion());
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+std::vector<PidPair> SortedPids(
+    const google::protobuf::RepeatedPtrField<ptpb::Snapshot::Process>& procs) {
+  std::vector<PidPair> out;
+  for (const auto& proc : procs) {
+    out.emplace_back(proc.id().pid(), proc.id().pidversion());
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+}  // namespace
+
+@interface SnapshotTest : XCTestCase
+@property std::shared_ptr<ProcessTreeTestPeer> tree;
+@property std::shared_ptr<const Process> initProc;
+@end
+
+@implementation SnapshotTest
+
+- (void)setUp {
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  annotators.emplace_back(std::make_unique<OriginatorAnnotator>());
+  self.tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  self.initProc = self.tree->InsertInit();
+}
+
+- (void)testDeltas {
+  SnapshotEncoder encoder(0);
+  uint64_t event_id = 1;
+
+  ptpb::Snapshot snapshot = encoder.Next(*self.tree);
+  XCTAssertEqual(snapshot.sequence(), 1);
+  XCTAssertEqual(snapshot.base_sequence(), 0);
+  XCTAssertTrue(SortedPids(snapshot.processes()) == std::vector<PidPair>({{1, 1}}));
+  XCTAssertFalse(snapshot.processes(0).has_parent_id());
+
+  // PID 2.2: fork() -> exec(Foo) -> PID 2.3
+  const struct Program signed_prog = {
+      .executable = "/Applications/Foo.app/Contents/MacOS/Foo",
+      .arguments = {"Foo"},
+      .code_signing = (CodeSigningInfo){.signing_id = "com.example.foo",
+                                        .team_id = "EQHXZ8M8AV",
+                                        .cdhash = "0102030405060708090a0b0c0d0e0f1011121314"},
+  };
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, child_pid);
+  const struct Pid child_exec_pid = {.pid = 2, .pidversion = 3};
+  self.tree->HandleExec(event_id++, **self.tree->Get(child_pid), child_exec_pid, signed_prog,
+                        self.initProc->effective_cred_);
+
+  snapshot = encoder.Next(*self.tree);
+  XCTAssertEqual(snapshot.sequence(), 2);
+  XCTAssertEqual(snapshot.base_sequence(), 1);
+  XCTAssertTrue(SortedPids(snapshot.processes()) == std::vector<PidPair>({{2, 2}, {2, 3}}));
+  XCTAssertEqual(snapshot.removed_size(), 0);
+  for (const ptpb::Snapshot::Process& proc : snapshot.processes()) {
+    XCTAssertEqual(proc.parent_id().pid(), 1);
+    XCTAssertEqual(proc.parent_id().pidversion(), 1);
+    if (proc.id().pidversion() == 3) {
+      XCTAssertEqual(proc.cdhash(), std::string("\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b"
+                                                "\x0c\x0d\x0e\x0f\x10\x11\x12\x13\x14",
+                                                20));
+    } else {
+      XCTAssertTrue(proc.cdhash().empty());
+    }
+  }
+
+  // Nothing changed
+  snapshot = encoder.Next(*self.tree);
+  XCTAssertEqual(snapshot.sequence(), 3);
+  XCTAssertEqual(snapshot.base_sequence(), 2);
+  XCTAssertEqual(snapshot.processes_size(), 0);
+  XCTAssertEqual(snapshot.removed_size(), 0);
+
+  // Processes are reported again when their annotations change
+  self.tree->AnnotateProcess(**self.tree->Get(child_exec_pid),
+                             std::make_shared<const OriginatorAnnotator>(
+                                 ptpb::Annotations::Originator::Annotations_Originator_CRON));
+  snapshot = encoder.Next(*self.tree);
+  XCTAssertTrue(SortedPids(snapshot.processes()) == std::vector<PidPair>({{2, 3}}));
+  XCTAssertEqual(snapshot.processes(0).annotations().originator(),
+                 ptpb::Annotations::Originator::Annotations_Originator_CRON);
+
+  // Step far enough past the exec and exit for both images of PID 2 to leave the tree
+  self.tree->HandleExit(event_id++, **self.tree->Get(child_exec_pid));
+  struct Pid churn_pid = {.pid = 100, .pidversion = 100};
+  for (int i = 0; i < 33; i++) {
+    self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+    churn_pid.pid++;
+  }
+  XCTAssertFalse(self.tree->Get(child_pid).has_value());
+  XCTAssertFalse(self.tree->Get(child_exec_pid).has_value());
+
+  snapshot = encoder.Next(*self.tree);
+  XCTAssertTrue(SortedPids(snapshot.removed()) == std::vector<PidPair>({{2, 2}, {2, 3}}));
+  XCTAssertEqual(snapshot.processes_size(), 33);
+}
+
+- (void)testFullInterval {
+  SnapshotEncoder encoder(2);
+
+  ptpb::Snapshot snapshot = encoder.Next(*self.tree);
+  XCTAssertEqual(snapshot.base_sequence(), 0);
+  XCTAssertEqual(snapshot.processes_size(), 1);
+
+  snapshot = encoder.Next(*self.tree);
+  XCTAssertEqual(snapshot.base_sequence(), 1);
+  XCTAssertEqual(snapshot.processes_size(), 0);
+
+  // Full snapshots list unchanged processes too
+  snapshot = encoder.Next(*self.tree);
+  XCTAssertEqual(snapshot.sequence(), 3);
+  XCTAssertEqual(snapshot.base_sequence(), 0);
+  XCTAssertTrue(SortedPids(snapshot.processes()) == std::vector<PidPair>({{1, 1}}));
+}
+
+@end
@@ -18,6 +18,7 @@
 #include <sys/types.h>
 
 #include <cstddef>
+#include <cstdint>
 
 namespace santa {
 
@@ -26,10 +27,9 @@ namespace santa {
 // only I/O surface the verifier sees, so callers (notably SNTFileInfo)
 // can share an fd without us trampling its read cursor.
 //
-// Readahead policy is the caller's responsibility — VerifyingHasherCore issues
-// roughly sequential preads but does not configure the fd. Production
-// callers (Santa) should set fcntl(F_RDAHEAD, 1) on their fd before
-// constructing FdFileReader for warm sequential reads.
+// VerifyingHasherCore issues roughly sequential preads but never configures
+// the fd itself. Readahead and caching policy belong to the reader; see
+// FdFileReader::IoStrategy.
 class FileReader {
  public:
   virtual ~FileReader() = default;
@@ -43,13 +43,54 @@ class FileReader {
 // ownership; caller is responsible for fd lifetime.
 class FdFileReader : public FileReader {
  public:
+  // I/O hints. The defaults issue plain preads and leave the fd untouched.
+  struct IoStrategy {
+    // Adaptive read-ahead: after each read, F_RDADVISE the window that
+    // follows it so the next read is already in flight. The window starts
+    // at readahead_min_bytes, doubles for every read that continues where
+    // the previous one ended, and is capped at readahead_max_bytes. A read
+    // at any other offset resets it. 0 disables read-ahead.
+    size_t readahead_min_bytes = 0;
+    size_t readahead_max_bytes = 0;
+    // Set F_NOCACHE on the fd for the lifetime of the reader, so a huge
+    // one-shot read doesn't evict the rest of the page cache. The flag is
+    // cleared again on destruction. Note that F_NOCACHE applies to the open
+    // file description, so other users of the same fd see it too.
+    bool nocache = false;
+  };
+
+  // Counters for tests and benchmarks.
+  struct IoStats {
+    uint64_t preads = 0;
+    uint64_t bytes_read = 0;
+    uint64_t advises = 0;
+    uint64_t bytes_advised = 0;
+  };
+
   explicit FdFileReader(int fd, off_t size);
+  FdFileReader(int fd, off_t size, IoStrategy strategy);
+  ~FdFileReader() override;
+
+  FdFileReader(const FdFileReader&) = delete;
+  FdFileReader& operator=(const FdFileReader&) = delete;
+
   ssize_t Pread(void* buf, size_t len, off_t off) override;
   off_t Size() const override { return size_; }
+  const IoStats& Stats() const { return stats_; }
 
  private:
+  void Advise(off_t read_off, off_t read_end);
+
   int fd_;
   off_t size_;
+  IoStrategy strategy_;
+  IoStats stats_;
+  bool nocache_set_ = false;
+  // Read-ahead state: where the last read ended, how far has been advised
+  // and the current window size.
+  off_t last_end_ = -1;
+  off_t advised_end_ = 0;
+  size_t window_ = 0;
 };
 
 }  // namespace santa
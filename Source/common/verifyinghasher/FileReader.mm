@@ -14,13 +14,31 @@
 
 #include "Source/common/verifyinghasher/FileReader.h"
 
+#include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 
 namespace santa {
 
-FdFileReader::FdFileReader(int fd, off_t size) : fd_(fd), size_(size) {}
+FdFileReader::FdFileReader(int fd, off_t size) : FdFileReader(fd, size, IoStrategy{}) {}
+
+FdFileReader::FdFileReader(int fd, off_t size, IoStrategy strategy)
+    : fd_(fd), size_(size), strategy_(strategy) {
+  strategy_.readahead_max_bytes =
+      std::max(strategy_.readahead_max_bytes, strategy_.readahead_min_bytes);
+  if (strategy_.nocache) {
+    nocache_set_ = fcntl(fd_, F_NOCACHE, 1) == 0;
+  }
+}
+
+FdFileReader::~FdFileReader() {
+  if (nocache_set_) {
+    fcntl(fd_, F_NOCACHE, 0);
+  }
+}
 
 ssize_t FdFileReader::Pread(void* buf, size_t len, off_t off) {
   auto* p = static_cast<unsigned char*>(buf);
@@ -28,6 +46,7 @@ ssize_t FdFileReader::Pread(void* buf, size_t len, off_t off) {
   ssize_t total = 0;
   while (remaining > 0) {
     ssize_t r = pread(fd_, p, remaining, off);
+    ++stats_.preads;
     if (r < 0) {
       if (errno == EINTR) continue;
       return -1;
@@ -38,7 +57,38 @@ ssize_t FdFileReader::Pread(void* buf, size_t len, off_t off) {
     total += r;
     remaining -= static_cast<size_t>(r);
   }
+  stats_.bytes_read += static_cast<uint64_t>(total);
+  if (strategy_.readahead_min_bytes > 0 && total > 0) {
+    Advise(off - total, off);
+  }
   return total;
 }
 
+void FdFileReader::Advise(off_t read_off, off_t read_end) {
+  if (read_off == last_end_) {
+    window_ = std::min(window_ * 2, strategy_.readahead_max_bytes);
+  } else {
+    // Random access: start over with the smallest window and forget what
+    // was advised for the previous run.
+    window_ = strategy_.readahead_min_bytes;
+    advised_end_ = read_end;
+  }
+  last_end_ = read_end;
+
+  off_t start = std::max(read_end, advised_end_);
+  off_t end = std::min<off_t>(size_, read_end + static_cast<off_t>(window_));
+  if (end <= start) return;
+
+  struct radvisory ra = {
+      .ra_offset = start,
+      .ra_count = static_cast<int>(std::min<off_t>(end - start, INT_MAX)),
+  };
+  // Purely advisory; a failure only costs the prefetch.
+  if (fcntl(fd_, F_RDADVISE, &ra) == 0) {
+    ++stats_.advises;
+    stats_.bytes_advised += static_cast<uint64_t>(ra.ra_count);
+  }
+  advised_end_ = start + ra.ra_count;
+}
+
 }  // namespace santa
@@ -21,6 +21,7 @@
 #include <unistd.h>
 
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 #include "Source/common/ScopedFile.h"
@@ -60,6 +61,65 @@ using santa::MemoryFileReader;
   XCTAssertTrue(buf[0] >= 0x20 || buf[0] == '\n' || buf[0] == '#');
 }
 
+- (void)testFdReaderDefaultStrategyDoesNotAdvise {
+  santa::ScopedFile sf(::open("/etc/hosts", O_RDONLY | O_CLOEXEC));
+  XCTAssertGreaterThanOrEqual(sf.UnsafeFD(), 0);
+  struct stat st{};
+  XCTAssertEqual(::fstat(sf.UnsafeFD(), &st), 0);
+  FdFileReader r(sf.UnsafeFD(), st.st_size);
+  uint8_t buf[16] = {};
+  XCTAssertGreaterThan(r.Pread(buf, sizeof(buf), 0), 0);
+  XCTAssertEqual(r.Stats().preads, 1u);
+  XCTAssertEqual(r.Stats().advises, 0u);
+}
+
+- (void)testFdReaderAdaptiveReadahead {
+  constexpr size_t kFileSize = 4 << 20;
+  constexpr size_t kRead = 64 << 10;
+  auto file = santa::ScopedFile::CreateTemporary();
+  XCTAssertTrue(file.ok());
+  std::vector<uint8_t> data(kFileSize);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 7);
+  XCTAssertEqual(::pwrite(file->UnsafeFD(), data.data(), data.size(), 0),
+                 static_cast<ssize_t>(data.size()));
+
+  FdFileReader r(file->UnsafeFD(), kFileSize,
+                 FdFileReader::IoStrategy{
+                     .readahead_min_bytes = kRead,
+                     .readahead_max_bytes = 4 * kRead,
+                     .nocache = true,
+                 });
+  std::vector<uint8_t> buf(kRead);
+
+  // First read advises one window past it.
+  XCTAssertEqual(r.Pread(buf.data(), kRead, 0), static_cast<ssize_t>(kRead));
+  XCTAssertEqual(r.Stats().advises, 1u);
+  XCTAssertEqual(r.Stats().bytes_advised, kRead);
+
+  // Sequential reads grow the window up to the maximum and never advise
+  // the same bytes twice.
+  for (size_t off = kRead; off < 8 * kRead; off += kRead) {
+    XCTAssertEqual(r.Pread(buf.data(), kRead, static_cast<off_t>(off)),
+                   static_cast<ssize_t>(kRead));
+    XCTAssertEqual(0, std::memcmp(buf.data(), data.data() + off, kRead));
+  }
+  XCTAssertEqual(r.Stats().advises, 8u);
+  // Everything up to the last read's end plus a full window was advised.
+  XCTAssertEqual(r.Stats().bytes_advised, 8 * kRead + 4 * kRead - kRead);
+
+  // A read that ends at EOF has nothing left to advise.
+  uint64_t advises = r.Stats().advises;
+  XCTAssertEqual(r.Pread(buf.data(), kRead, static_cast<off_t>(kFileSize - kRead)),
+                 static_cast<ssize_t>(kRead));
+  XCTAssertEqual(r.Stats().advises, advises);
+  XCTAssertEqual(0, std::memcmp(buf.data(), data.data() + kFileSize - kRead, kRead));
+
+  // A seek back resets the window to the minimum.
+  XCTAssertEqual(r.Pread(buf.data(), kRead, 0), static_cast<ssize_t>(kRead));
+  XCTAssertEqual(r.Stats().advises, advises + 1);
+  XCTAssertEqual(r.Stats().bytes_read, 10 * kRead);
+}
+
 - (void)testFdReaderHandlesShortRead {
   santa::ScopedFile sf(::open("/etc/hosts", O_RDONLY | O_CLOEXEC));
   XCTAssertGreaterThanOrEqual(sf.UnsafeFD(), 0);
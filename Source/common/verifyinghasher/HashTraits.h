@@ -25,6 +25,8 @@ __END_DECLS
 #include <cstddef>
 #include <cstdint>
 
+#include "Source/common/verifyinghasher/Sha256Backend.h"
+
 namespace santa {
 
 // Per-CS-hashType traits. Each struct fully describes how to verify pages
@@ -63,15 +65,16 @@ namespace detail {
     return 1;                                                            \
   } while (0)
 
+// SHA-256 is by far the most common page hash and also computes the
+// full-file digest, so it goes through the runtime-selected backend in
+// Sha256Backend.h rather than straight to CommonCrypto.
 struct Sha256Algo {
-  using Ctx = CC_SHA256_CTX;
-  static constexpr int Init(Ctx* c) { return CC_SHA256_Init(c); }
-  static constexpr int Update(Ctx* c, const void* d, size_t n) {
-    VERIFYINGHASHER_CC_UPDATE_LOOP(CC_SHA256_Update, c, d, n);
-  }
-  static constexpr int Final(unsigned char* m, Ctx* c) {
-    return CC_SHA256_Final(m, c);
+  using Ctx = Sha256Ctx;
+  static int Init(Ctx* c) { return Sha256Init(c); }
+  static int Update(Ctx* c, const void* d, size_t n) {
+    return Sha256Update(c, d, n);
   }
+  static int Final(unsigned char* m, Ctx* c) { return Sha256Final(m, c); }
   static constexpr size_t kDigestSize = CC_SHA256_DIGEST_LENGTH;  // 32
 };
 
@@ -16,6 +16,7 @@
 #define SANTA_COMMON_VERIFYINGHASHER_HEADERPARSER_H
 
 #include <libkern/OSByteOrder.h>
+#include <mach-o/loader.h>
 #include <mach/machine.h>
 
 #include <cstddef>
@@ -25,6 +26,8 @@
 #include <string_view>
 #include <vector>
 
+#include "Source/common/verifyinghasher/FileReader.h"
+
 namespace santa {
 
 struct ArchSelector {
@@ -126,6 +129,36 @@ class HeaderParser {
   Status ProcessLoadCommands();
 };
 
+// The header of one slice of a Mach-O file. `header` is in host byte order,
+// with its magic normalized to MH_MAGIC or MH_MAGIC_64; the remaining
+// fields of a mach_header_64 are not needed by any caller.
+struct MachOSliceHeader {
+  // From the fat arch table, or the header itself for a thin file
+  cpu_type_t cputype = 0;
+  cpu_subtype_t cpusubtype = 0;
+  uint64_t slice_offset = 0;
+  uint64_t slice_size = 0;
+  struct mach_header header = {};
+  // Whether the first load command is a __PAGEZERO segment: mapped at
+  // address 0, non-empty and with no access. nullopt if the slice has no
+  // load commands or they couldn't be read.
+  std::optional<bool> first_segment_is_page_zero;
+};
+
+struct MachOHeaders {
+  bool is_fat = false;
+  // In fat arch table order. Slices whose range or header is invalid are
+  // left out.
+  std::vector<MachOSliceHeader> slices;
+};
+
+// Reads the header of every slice in one pass: a single read of the first
+// kMachOHeadersReadSize bytes, plus one small read for each fat slice whose
+// header lies beyond them. Applies the same magic and fat table rules as
+// HeaderParser. Returns nullopt if the file is not a Mach-O or can't be read.
+inline constexpr size_t kMachOHeadersReadSize = 32 * 1024;
+std::optional<MachOHeaders> ReadMachOHeaders(FileReader& reader);
+
 }  // namespace santa
 
 #endif  // SANTA_COMMON_VERIFYINGHASHER_HEADERPARSER_H
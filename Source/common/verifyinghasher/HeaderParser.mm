@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <span>
 
 namespace santa {
 
@@ -58,6 +59,15 @@ constexpr uint32_t kMaxCsBlobSize = 64u * 1024 * 1024;
 // size, so a tight cap costs nothing in false-positives.
 constexpr uint32_t kMaxSizeOfCmds = 1u << 20;  // 1 MiB
 
+// Cap on fat_header.nfat_arch. Real universal binaries have two or three
+// slices.
+constexpr uint32_t kMaxFatArchs = 64;
+
+// Bytes ReadMachOHeaders needs at the start of a slice: the header and the
+// first load command, if it is a segment.
+constexpr size_t kSliceHeaderBytes =
+    sizeof(struct mach_header_64) + sizeof(struct segment_command_64);
+
 constexpr cpu_subtype_t MaskSubtype(cpu_subtype_t s) {
   return static_cast<cpu_subtype_t>(s & ~CPU_SUBTYPE_MASK);
 }
@@ -70,6 +80,95 @@ const char* ArchName(cpu_type_t t) {
   }
 }
 
+bool IsThinMagic(uint32_t magic) {
+  return magic == MH_MAGIC || magic == MH_CIGAM || magic == MH_MAGIC_64 || magic == MH_CIGAM_64;
+}
+
+struct FatArchEntry {
+  cpu_type_t cputype;
+  cpu_subtype_t cpusubtype;
+  uint64_t offset;
+  uint64_t size;
+};
+
+// Decodes entry `i` of a big-endian fat arch table. The caller has checked
+// that the table holds at least `i + 1` entries.
+FatArchEntry DecodeFatArch(const uint8_t* table, bool fat64, uint32_t i) {
+  if (fat64) {
+    struct fat_arch_64 a;
+    std::memcpy(&a, table + i * sizeof(a), sizeof(a));
+    return FatArchEntry{
+        .cputype = static_cast<cpu_type_t>(OSSwapBigToHostInt32(a.cputype)),
+        .cpusubtype = static_cast<cpu_subtype_t>(OSSwapBigToHostInt32(a.cpusubtype)),
+        .offset = OSSwapBigToHostInt64(a.offset),
+        .size = OSSwapBigToHostInt64(a.size),
+    };
+  }
+  struct fat_arch a;
+  std::memcpy(&a, table + i * sizeof(a), sizeof(a));
+  return FatArchEntry{
+      .cputype = static_cast<cpu_type_t>(OSSwapBigToHostInt32(a.cputype)),
+      .cpusubtype = static_cast<cpu_subtype_t>(OSSwapBigToHostInt32(a.cpusubtype)),
+      .offset = OSSwapBigToHostInt32(a.offset),
+      .size = OSSwapBigToHostInt32(a.size),
+  };
+}
+
+// Reads exactly `len` bytes at `off`. Returns false on error or early EOF.
+bool ReadFully(FileReader& reader, uint8_t* buf, size_t len, uint64_t off) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = reader.Pread(buf + done, len - done, static_cast<off_t>(off + done));
+    if (n <= 0) return false;
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Decodes the mach_header at the start of `bytes`, and checks whether the
+// first load command is __PAGEZERO when enough bytes are available.
+bool DecodeSliceHeader(std::span<const uint8_t> bytes, MachOSliceHeader& out) {
+  if (bytes.size() < sizeof(struct mach_header)) return false;
+  struct mach_header mh;
+  std::memcpy(&mh, bytes.data(), sizeof(mh));
+
+  const bool swap = mh.magic == MH_CIGAM || mh.magic == MH_CIGAM_64;
+  auto swap32 = [swap](auto v) {
+    return swap ? static_cast<decltype(v)>(OSSwapInt32(static_cast<uint32_t>(v))) : v;
+  };
+  mh.magic = swap32(mh.magic);
+  mh.cputype = swap32(mh.cputype);
+  mh.cpusubtype = swap32(mh.cpusubtype);
+  mh.filetype = swap32(mh.filetype);
+  mh.ncmds = swap32(mh.ncmds);
+  mh.sizeofcmds = swap32(mh.sizeofcmds);
+  mh.flags = swap32(mh.flags);
+  if (mh.magic != MH_MAGIC && mh.magic != MH_MAGIC_64) return false;
+  out.header = mh;
+
+  out.first_segment_is_page_zero.reset();
+  if (mh.ncmds == 0) return true;
+  const bool is64 = mh.magic == MH_MAGIC_64;
+  const size_t hdr_sz = is64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+  if (is64 && bytes.size() >= hdr_sz + sizeof(struct segment_command_64)) {
+    struct segment_command_64 seg;
+    std::memcpy(&seg, bytes.data() + hdr_sz, sizeof(seg));
+    uint64_t vmaddr = swap ? OSSwapInt64(seg.vmaddr) : seg.vmaddr;
+    uint64_t vmsize = swap ? OSSwapInt64(seg.vmsize) : seg.vmsize;
+    out.first_segment_is_page_zero = swap32(seg.cmd) == LC_SEGMENT_64 && vmaddr == 0 &&
+                                     vmsize != 0 && seg.initprot == 0 && seg.maxprot == 0 &&
+                                     strncmp(seg.segname, SEG_PAGEZERO, sizeof(seg.segname)) == 0;
+  } else if (!is64 && bytes.size() >= hdr_sz + sizeof(struct segment_command)) {
+    struct segment_command seg;
+    std::memcpy(&seg, bytes.data() + hdr_sz, sizeof(seg));
+    out.first_segment_is_page_zero =
+        swap32(seg.cmd) == LC_SEGMENT && seg.vmaddr == 0 && seg.vmsize != 0 &&
+        seg.initprot == 0 && seg.maxprot == 0 &&
+        strncmp(seg.segname, SEG_PAGEZERO, sizeof(seg.segname)) == 0;
+  }
+  return true;
+}
+
 }  // namespace
 
 HeaderParser::HeaderParser(ArchSelector want, uint64_t total_file_size) : want_(want) {
@@ -162,7 +261,7 @@ HeaderParser::Status HeaderParser::ProcessMagic() {
   if (slice_.total_file_size < 4) return SetError("file too small for magic");
   uint32_t magic = 0;
   std::memcpy(&magic, scratch_.data(), 4);
-  if (magic == MH_MAGIC || magic == MH_CIGAM || magic == MH_MAGIC_64 || magic == MH_CIGAM_64) {
+  if (IsThinMagic(magic)) {
     // Thin Mach-O. Magic is the first 4 bytes of mach_header; keep it
     // and read the rest of the header from offset 4.
     slice_.slice_offset = 0;
@@ -211,48 +310,26 @@ HeaderParser::Status HeaderParser::ProcessFatHeader() {
   struct fat_header fh{};
   std::memcpy(&fh, scratch_.data(), sizeof(fh));
   nfat_ = OSSwapBigToHostInt32(fh.nfat_arch);
-  if (nfat_ > 64) return SetError("corrupt fat header (implausible arch count)");
+  if (nfat_ > kMaxFatArchs) return SetError("corrupt fat header (implausible arch count)");
   const size_t entry_sz = fat64_ ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
   AdvanceToPhase(Phase::kNeedFatArchTable, sizeof(fh), nfat_ * entry_sz);
   return Status::kNeedMore;
 }
 
 HeaderParser::Status HeaderParser::ProcessFatArchTable() {
-  if (fat64_) {
-    const auto* archs = reinterpret_cast<const struct fat_arch_64*>(scratch_.data());
-    for (uint32_t i = 0; i < nfat_; ++i) {
-      cpu_type_t ct = static_cast<cpu_type_t>(OSSwapBigToHostInt32(archs[i].cputype));
-      cpu_subtype_t st = static_cast<cpu_subtype_t>(OSSwapBigToHostInt32(archs[i].cpusubtype));
-      uint64_t off = OSSwapBigToHostInt64(archs[i].offset);
-      uint64_t sz = OSSwapBigToHostInt64(archs[i].size);
-      if (ct == want_.cputype && MaskSubtype(st) == MaskSubtype(want_.cpusubtype)) {
-        if (off > slice_.total_file_size || sz > slice_.total_file_size - off) {
-          return SetError("corrupt fat header (slice out of range)");
-        }
-        slice_.slice_offset = off;
-        slice_.slice_size = sz;
-        slice_.arch_name = ArchName(ct);
-        AdvanceToPhase(Phase::kNeedSliceMachHeader, off, sizeof(struct mach_header));
-        return Status::kNeedMore;
-      }
-    }
-  } else {
-    const auto* archs = reinterpret_cast<const struct fat_arch*>(scratch_.data());
-    for (uint32_t i = 0; i < nfat_; ++i) {
-      cpu_type_t ct = static_cast<cpu_type_t>(OSSwapBigToHostInt32(archs[i].cputype));
-      cpu_subtype_t st = static_cast<cpu_subtype_t>(OSSwapBigToHostInt32(archs[i].cpusubtype));
-      uint64_t off = OSSwapBigToHostInt32(archs[i].offset);
-      uint64_t sz = OSSwapBigToHostInt32(archs[i].size);
-      if (ct == want_.cputype && MaskSubtype(st) == MaskSubtype(want_.cpusubtype)) {
-        if (off > slice_.total_file_size || sz > slice_.total_file_size - off) {
-          return SetError("corrupt fat header (slice out of range)");
-        }
-        slice_.slice_offset = off;
-        slice_.slice_size = sz;
-        slice_.arch_name = ArchName(ct);
-        AdvanceToPhase(Phase::kNeedSliceMachHeader, off, sizeof(struct mach_header));
-        return Status::kNeedMore;
+  for (uint32_t i = 0; i < nfat_; ++i) {
+    FatArchEntry arch = DecodeFatArch(scratch_.data(), fat64_, i);
+    if (arch.cputype == want_.cputype &&
+        MaskSubtype(arch.cpusubtype) == MaskSubtype(want_.cpusubtype)) {
+      if (arch.offset > slice_.total_file_size ||
+          arch.size > slice_.total_file_size - arch.offset) {
+        return SetError("corrupt fat header (slice out of range)");
       }
+      slice_.slice_offset = arch.offset;
+      slice_.slice_size = arch.size;
+      slice_.arch_name = ArchName(arch.cputype);
+      AdvanceToPhase(Phase::kNeedSliceMachHeader, arch.offset, sizeof(struct mach_header));
+      return Status::kNeedMore;
     }
   }
   return SetError("no matching slice in fat binary");
@@ -399,4 +476,62 @@ HeaderParser::Status HeaderParser::ProcessLoadCommands() {
   return Status::kReady;
 }
 
+std::optional<MachOHeaders> ReadMachOHeaders(FileReader& reader) {
+  const uint64_t file_size = reader.Size() > 0 ? static_cast<uint64_t>(reader.Size()) : 0;
+  std::vector<uint8_t> head(std::min<uint64_t>(file_size, kMachOHeadersReadSize));
+  if (head.size() < 4 || !ReadFully(reader, head.data(), head.size(), 0)) return std::nullopt;
+
+  uint32_t magic = 0;
+  std::memcpy(&magic, head.data(), 4);
+
+  MachOHeaders headers;
+  if (IsThinMagic(magic)) {
+    MachOSliceHeader slice;
+    if (!DecodeSliceHeader(head, slice)) return std::nullopt;
+    slice.cputype = slice.header.cputype;
+    slice.cpusubtype = slice.header.cpusubtype;
+    slice.slice_size = file_size;
+    headers.slices.push_back(slice);
+    return headers;
+  }
+
+  // Same accepted forms as HeaderParser::ProcessMagic: big-endian-on-disk
+  // fat32 and fat64 only.
+  if (magic != FAT_CIGAM && magic != FAT_CIGAM_64) return std::nullopt;
+  const bool fat64 = magic == FAT_CIGAM_64;
+  if (head.size() < sizeof(struct fat_header)) return std::nullopt;
+  struct fat_header fh;
+  std::memcpy(&fh, head.data(), sizeof(fh));
+  const uint32_t nfat = OSSwapBigToHostInt32(fh.nfat_arch);
+  const size_t entry_sz = fat64 ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
+  // The largest table is far smaller than kMachOHeadersReadSize
+  if (nfat > kMaxFatArchs || sizeof(fh) + nfat * entry_sz > head.size()) return std::nullopt;
+
+  headers.is_fat = true;
+  std::vector<uint8_t> slice_buf;
+  for (uint32_t i = 0; i < nfat; ++i) {
+    FatArchEntry arch = DecodeFatArch(head.data() + sizeof(fh), fat64, i);
+    if (arch.offset > file_size || arch.size > file_size - arch.offset) continue;
+
+    const size_t want = static_cast<size_t>(std::min<uint64_t>(arch.size, kSliceHeaderBytes));
+    std::span<const uint8_t> bytes;
+    if (arch.offset + want <= head.size()) {
+      bytes = std::span<const uint8_t>(head.data() + arch.offset, want);
+    } else {
+      slice_buf.resize(want);
+      if (!ReadFully(reader, slice_buf.data(), want, arch.offset)) continue;
+      bytes = slice_buf;
+    }
+
+    MachOSliceHeader slice;
+    if (!DecodeSliceHeader(bytes, slice)) continue;
+    slice.cputype = arch.cputype;
+    slice.cpusubtype = arch.cpusubtype;
+    slice.slice_offset = arch.offset;
+    slice.slice_size = arch.size;
+    headers.slices.push_back(slice);
+  }
+  return headers;
+}
+
 }  // namespace santa
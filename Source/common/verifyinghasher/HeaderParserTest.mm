@@ -28,6 +28,7 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Source/common/ScopedFile.h"
@@ -126,6 +127,29 @@ std::vector<uint8_t> MakeThin64WithCsBlob(uint32_t cs_dataoff, uint32_t cs_datas
   return data;
 }
 
+// Build a 32-bit thin Mach-O executable whose only load command is a
+// __PAGEZERO segment of `pagezero_size` bytes.
+std::vector<uint8_t> MakeThin32WithPageZero(uint32_t pagezero_size) {
+  struct mach_header mh{};
+  mh.magic = MH_MAGIC;
+  mh.cputype = CPU_TYPE_X86;
+  mh.cpusubtype = CPU_SUBTYPE_X86_ALL;
+  mh.filetype = MH_EXECUTE;
+  mh.ncmds = 1;
+  mh.sizeofcmds = sizeof(struct segment_command);
+
+  struct segment_command seg{};
+  seg.cmd = LC_SEGMENT;
+  seg.cmdsize = sizeof(seg);
+  std::strncpy(seg.segname, SEG_PAGEZERO, sizeof(seg.segname));
+  seg.vmsize = pagezero_size;
+
+  std::vector<uint8_t> data(4096, 0);
+  std::memcpy(data.data(), &mh, sizeof(mh));
+  std::memcpy(data.data() + sizeof(mh), &seg, sizeof(seg));
+  return data;
+}
+
 }  // namespace
 
 @interface HeaderParserTest : XCTestCase
@@ -514,6 +538,83 @@ std::vector<uint8_t> MakeThin64WithCsBlob(uint32_t cs_dataoff, uint32_t cs_datas
   XCTAssertEqual(info.arch_name, "x86_64");
 }
 
+- (void)testReadMachOHeadersFat {
+  MemoryFileReader reader(Slurp([self hwUniversalFixturePath].UTF8String));
+  auto headers = santa::ReadMachOHeaders(reader);
+  XCTAssertTrue(headers.has_value());
+  XCTAssertTrue(headers->is_fat);
+  XCTAssertEqual(headers->slices.size(), 2);
+
+  for (const santa::MachOSliceHeader& slice : headers->slices) {
+    XCTAssertTrue(slice.cputype == CPU_TYPE_ARM64 || slice.cputype == CPU_TYPE_X86_64);
+    XCTAssertEqual(slice.header.cputype, slice.cputype);
+    XCTAssertEqual(slice.header.magic, MH_MAGIC_64);
+    XCTAssertEqual(slice.header.filetype, MH_EXECUTE);
+    XCTAssertGreaterThan(slice.slice_offset, 0);
+    XCTAssertLessThanOrEqual(slice.slice_offset + slice.slice_size, reader.Size());
+    XCTAssertTrue(slice.first_segment_is_page_zero.value_or(false));
+  }
+  XCTAssertNotEqual(headers->slices[0].cputype, headers->slices[1].cputype);
+}
+
+- (void)testReadMachOHeadersThin {
+  MemoryFileReader reader(MakeThin32WithPageZero(0x1000));
+  auto headers = santa::ReadMachOHeaders(reader);
+  XCTAssertTrue(headers.has_value());
+  XCTAssertFalse(headers->is_fat);
+  XCTAssertEqual(headers->slices.size(), 1);
+  XCTAssertEqual(headers->slices[0].cputype, CPU_TYPE_X86);
+  XCTAssertEqual(headers->slices[0].slice_offset, 0);
+  XCTAssertEqual(headers->slices[0].slice_size, 4096);
+  XCTAssertTrue(headers->slices[0].first_segment_is_page_zero.value_or(false));
+
+  // An empty __PAGEZERO doesn't count.
+  MemoryFileReader empty(MakeThin32WithPageZero(0));
+  headers = santa::ReadMachOHeaders(empty);
+  XCTAssertTrue(headers.has_value());
+  XCTAssertFalse(headers->slices[0].first_segment_is_page_zero.value_or(true));
+}
+
+- (void)testReadMachOHeadersSliceBeyondInitialRead {
+  // Fat file with one slice past the initial read and one out of range.
+  constexpr uint32_t kSliceOff = 2 * santa::kMachOHeadersReadSize;
+  std::vector<uint8_t> thin = MakeThin32WithPageZero(0x1000);
+
+  struct fat_header fh{};
+  fh.magic = OSSwapHostToBigInt32(FAT_MAGIC);
+  fh.nfat_arch = OSSwapHostToBigInt32(2);
+  struct fat_arch archs[2]{};
+  archs[0].cputype = OSSwapHostToBigInt32(CPU_TYPE_X86);
+  archs[0].cpusubtype = OSSwapHostToBigInt32(CPU_SUBTYPE_X86_ALL);
+  archs[0].offset = OSSwapHostToBigInt32(kSliceOff);
+  archs[0].size = OSSwapHostToBigInt32(static_cast<uint32_t>(thin.size()));
+  archs[1] = archs[0];
+  archs[1].cputype = OSSwapHostToBigInt32(CPU_TYPE_X86_64);
+  archs[1].offset = OSSwapHostToBigInt32(kSliceOff * 2);
+
+  std::vector<uint8_t> data(kSliceOff, 0);
+  std::memcpy(data.data(), &fh, sizeof(fh));
+  std::memcpy(data.data() + sizeof(fh), archs, sizeof(archs));
+  data.insert(data.end(), thin.begin(), thin.end());
+
+  MemoryFileReader reader(std::move(data));
+  auto headers = santa::ReadMachOHeaders(reader);
+  XCTAssertTrue(headers.has_value());
+  XCTAssertTrue(headers->is_fat);
+  XCTAssertEqual(headers->slices.size(), 1);
+  XCTAssertEqual(headers->slices[0].cputype, CPU_TYPE_X86);
+  XCTAssertEqual(headers->slices[0].slice_offset, kSliceOff);
+  XCTAssertTrue(headers->slices[0].first_segment_is_page_zero.value_or(false));
+}
+
+- (void)testReadMachOHeadersRejectsNonMachO {
+  MemoryFileReader hosts(Slurp("/etc/hosts"));
+  XCTAssertFalse(santa::ReadMachOHeaders(hosts).has_value());
+
+  MemoryFileReader tiny(std::vector<uint8_t>{0xcf, 0xfa});
+  XCTAssertFalse(santa::ReadMachOHeaders(tiny).has_value());
+}
+
 // LE-on-disk fat headers — magic bytes serialized in little-endian
 // order such that an LE host reads them back as FAT_MAGIC /
 // FAT_MAGIC_64 — must be rejected at the magic dispatch. Apple's
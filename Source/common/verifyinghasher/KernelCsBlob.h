@@ -68,6 +68,9 @@ class KernelCsBlob {
     std::optional<CFAbsoluteTime> secure_signing_time;
     std::optional<std::vector<uint8_t>> entitlement_der;
     std::optional<std::vector<uint8_t>> entitlement_xml;
+    // DER of the CMS signer's leaf certificate. Only populated by
+    // FetchLeafCertificate/ParseLeafCertificate.
+    std::optional<std::vector<uint8_t>> leaf_certificate_der;
     std::string last_error;
   };
 
@@ -83,6 +86,24 @@ class KernelCsBlob {
   // Test entry point. Parses kernel-style cs_blob bytes directly.
   static Result ParseBytes(std::span<const uint8_t> kernel_cs_blob,
                            std::span<const uint8_t> cd_bytes);
+
+  // Reads only the leaf certificate of the CMS signature, skipping the
+  // signing time and TSA evaluation that Fetch performs. Same trust
+  // contract as Fetch: callers must gate on CS_VALID, since the kernel
+  // validated the signature at load and this does not. An ad-hoc signed
+  // process yields kNoCmsSignature.
+  static Result FetchLeafCertificate(const audit_token_t& token, size_t cs_blob_size_hint);
+
+  // Test entry point for FetchLeafCertificate. Uses the blob's own
+  // CodeDirectory slot as the CMS detached content.
+  static Result ParseLeafCertificate(std::span<const uint8_t> kernel_cs_blob);
+
+  // Copies the raw kernel cs_blob into `blob` without parsing it, for
+  // callers that parse the CodeDirectory themselves. Returns kOk or
+  // kBlobFetchFailed; only `status` and `last_error` are populated. Same
+  // trust contract as Fetch: callers must gate on CS_VALID.
+  static Result FetchBlob(const audit_token_t& token, size_t cs_blob_size_hint,
+                          std::vector<uint8_t>& blob);
 };
 
 }  // namespace santa
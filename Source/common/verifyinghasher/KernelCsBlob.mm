@@ -15,6 +15,7 @@
 #include "Source/common/verifyinghasher/KernelCsBlob.h"
 
 #include <Security/CMSDecoder.h>
+#include <Security/SecCertificate.h>
 #include <Security/SecPolicy.h>
 #include <bsm/libbsm.h>  // audit_token_to_pid
 #include <errno.h>
@@ -34,6 +35,7 @@ __END_DECLS
 
 #include <cstring>
 #include <string>
+#include <utility>
 
 #include "Source/common/ScopedCFTypeRef.h"
 
@@ -124,70 +126,59 @@ std::span<const uint8_t> FindSlotPayload(std::span<const uint8_t> cs_blob, uint3
   return {};
 }
 
-}  // namespace
-
-KernelCsBlob::Result KernelCsBlob::ParseBytes(std::span<const uint8_t> kernel_cs_blob,
-                                              std::span<const uint8_t> cd_bytes) {
-  Result r;
-
-  // Defense-in-depth for the public/fuzz entry point. Fetch() already
+// Rejects blobs that are oversized or aren't an embedded signature
+// SuperBlob. Shared by every parse entry point.
+bool CheckSuperBlob(std::span<const uint8_t> kernel_cs_blob, KernelCsBlob::Result& r) {
+  // Defense-in-depth for the public/fuzz entry points. Fetch() already
   // caps cs_blob_size_hint and the probe-reported blob length, but
   // ParseBytes accepts arbitrary spans — without a cap here, a hostile
   // input could drive FindSlotPayload's BlobIndex walk for an arbitrary
   // amount of work, and slot payloads (CMS / entitlements) could be
   // arbitrarily large. Reject up-front.
   if (kernel_cs_blob.size() > kMaxCsBlobSize) {
-    r.status = Status::kCmsParseFailed;
+    r.status = KernelCsBlob::Status::kCmsParseFailed;
     r.last_error = "kernel cs_blob exceeds size cap";
-    return r;
+    return false;
   }
   if (kernel_cs_blob.size() < sizeof(CS_SuperBlob)) {
-    r.status = Status::kCmsParseFailed;
+    r.status = KernelCsBlob::Status::kCmsParseFailed;
     r.last_error = "kernel cs_blob too small for SuperBlob";
-    return r;
+    return false;
   }
   const CS_SuperBlob* sb = reinterpret_cast<const CS_SuperBlob*>(kernel_cs_blob.data());
   if (OSSwapBigToHostInt32(sb->magic) != CSMAGIC_EMBEDDED_SIGNATURE) {
-    r.status = Status::kCmsParseFailed;
+    r.status = KernelCsBlob::Status::kCmsParseFailed;
     r.last_error = "kernel cs_blob has wrong SuperBlob magic";
-    return r;
+    return false;
   }
+  return true;
+}
 
-  // Extract entitlement slot payloads (CSSLOT_ENTITLEMENTS = 5,
-  // CSSLOT_DER_ENTITLEMENTS = 7). Independent of CMS state — present
-  // even on ad-hoc binaries if the original codesign included them.
-  // Per-slot expected magics match xnu (bsd/kern/ubc_subr.c:3291-3299).
-  if (auto xml =
-          FindSlotPayload(kernel_cs_blob, CSSLOT_ENTITLEMENTS, CSMAGIC_EMBEDDED_ENTITLEMENTS);
-      !xml.empty()) {
-    r.entitlement_xml = std::vector<uint8_t>(xml.begin(), xml.end());
-  }
-  if (auto der = FindSlotPayload(kernel_cs_blob, CSSLOT_DER_ENTITLEMENTS,
-                                 CSMAGIC_EMBEDDED_DER_ENTITLEMENTS);
-      !der.empty()) {
-    r.entitlement_der = std::vector<uint8_t>(der.begin(), der.end());
-  }
+// Runs the CMS signature slot through a CMSDecoder up to and including
+// CMSDecoderFinalizeMessage. On failure `r` carries the status and error.
+bool DecodeCms(std::span<const uint8_t> kernel_cs_blob, std::span<const uint8_t> cd_bytes,
+               ScopedCFTypeRef<CMSDecoderRef>& cms_decoder, KernelCsBlob::Result& r) {
+  using Status = KernelCsBlob::Status;
 
   // Locate the CMS signature slot.
   auto cms = FindSlotPayload(kernel_cs_blob, CSSLOT_SIGNATURESLOT, CSMAGIC_BLOBWRAPPER);
   if (cms.empty()) {
     r.status = Status::kNoCmsSignature;
-    return r;
+    return false;
   }
 
   // CMSDecoder pipeline. FindSlotPayload already skipped the 8-byte
   // BlobCore header, so `cms` is the raw CMS message bytes.
-  ScopedCFTypeRef<CMSDecoderRef> cms_decoder;
   if (CMSDecoderCreate(cms_decoder.InitializeInto()) != errSecSuccess) {
     r.status = Status::kCmsParseFailed;
     r.last_error = "CMSDecoderCreate failed";
-    return r;
+    return false;
   }
 
   if (CMSDecoderUpdateMessage(cms_decoder.Unsafe(), cms.data(), cms.size()) != errSecSuccess) {
     r.status = Status::kCmsParseFailed;
     r.last_error = "CMSDecoderUpdateMessage failed";
-    return r;
+    return false;
   }
 
   // SetDetachedContent gets the CD bytes whose hash matches the
@@ -198,18 +189,143 @@ KernelCsBlob::Result KernelCsBlob::ParseBytes(std::span<const uint8_t> kernel_cs
   if (!cd_data) {
     r.status = Status::kCmsParseFailed;
     r.last_error = "CFDataCreateWithBytesNoCopy(cd_bytes) failed";
-    return r;
+    return false;
   }
 
   if (CMSDecoderSetDetachedContent(cms_decoder.Unsafe(), cd_data.Unsafe()) != errSecSuccess) {
     r.status = Status::kCmsParseFailed;
     r.last_error = "CMSDecoderSetDetachedContent failed";
-    return r;
+    return false;
   }
 
   if (CMSDecoderFinalizeMessage(cms_decoder.Unsafe()) != errSecSuccess) {
     r.status = Status::kCmsParseFailed;
     r.last_error = "CMSDecoderFinalizeMessage failed";
+    return false;
+  }
+
+  return true;
+}
+
+// Codesign embeds the signer's chain in the CMS message but in no
+// guaranteed order. The leaf is the one certificate that did not issue
+// any other certificate in the message. Returns nullptr if there isn't
+// exactly one such certificate.
+SecCertificateRef FindLeafCertificate(CFArrayRef certs) {
+  const CFIndex count = CFArrayGetCount(certs);
+  SecCertificateRef leaf = nullptr;
+  for (CFIndex i = 0; i < count; ++i) {
+    SecCertificateRef cert = (SecCertificateRef)CFArrayGetValueAtIndex(certs, i);
+    auto subject = ScopedCFTypeRef<CFDataRef>::Assume(
+        SecCertificateCopyNormalizedSubjectSequence(cert));
+    if (!subject) return nullptr;
+
+    bool issued_other = false;
+    for (CFIndex j = 0; j < count && !issued_other; ++j) {
+      if (j == i) continue;
+      auto issuer = ScopedCFTypeRef<CFDataRef>::Assume(SecCertificateCopyNormalizedIssuerSequence(
+          (SecCertificateRef)CFArrayGetValueAtIndex(certs, j)));
+      issued_other = issuer && CFEqual(subject.Unsafe(), issuer.Unsafe());
+    }
+
+    if (!issued_other) {
+      if (leaf) return nullptr;
+      leaf = cert;
+    }
+  }
+  return leaf;
+}
+
+// Copies the process's cs_blob into `buf` via csops_audittoken(CS_OPS_BLOB).
+// Returns an empty string on success, otherwise a description of the
+// failure.
+std::string FetchBlobBytes(const audit_token_t& token, size_t cs_blob_size_hint,
+                           std::vector<uint8_t>& buf) {
+  audit_token_t mutable_token = token;
+  pid_t pid = audit_token_to_pid(mutable_token);
+
+  // Try the one-syscall path: allocate cs_blob_size_hint bytes and ask
+  // the kernel. If the hint is right (common case), one syscall serves.
+  // If the hint is 0, too large, or too small, fall back to the
+  // header-probe pattern. Capping at kMaxCsBlobSize keeps a bogus hint
+  // from forcing a huge allocation here — the probe path independently
+  // re-applies the same cap to the kernel-reported length.
+  if (cs_blob_size_hint > 0 && cs_blob_size_hint <= kMaxCsBlobSize) {
+    buf.resize(cs_blob_size_hint);
+    int rc = csops_audittoken(pid, kCsopBlob, buf.data(), buf.size(), &mutable_token);
+    if (rc == 0) {
+      // Success. Read BlobCore (8 bytes: magic + length, both big-endian)
+      // at offset 0 to learn actual blob length.
+      if (buf.size() < 8) {
+        return "csops returned undersized buffer";
+      }
+      uint32_t actual_len_be;
+      std::memcpy(&actual_len_be, buf.data() + 4, sizeof(actual_len_be));
+      uint32_t actual_len = OSSwapBigToHostInt32(actual_len_be);
+      if (actual_len > buf.size()) actual_len = static_cast<uint32_t>(buf.size());
+      buf.resize(actual_len);
+      return "";
+    }
+    if (errno != ERANGE) {
+      return std::string("csops_audittoken errno=") + std::to_string(errno);
+    }
+    // fall through to header-probe path
+  }
+
+  // Header-probe path: ask for just the BlobCore (8 bytes); on ERANGE,
+  // the kernel writes the header (which carries length) anyway.
+  uint8_t header[8];
+  int rc = csops_audittoken(pid, kCsopBlob, header, sizeof(header), &mutable_token);
+  if (rc == 0) {
+    return "csops_audittoken unexpectedly returned success on small buf";
+  }
+  if (errno != ERANGE) {
+    return std::string("csops_audittoken header errno=") + std::to_string(errno);
+  }
+
+  uint32_t blob_len_be;
+  std::memcpy(&blob_len_be, header + 4, sizeof(blob_len_be));
+  uint32_t blob_len = OSSwapBigToHostInt32(blob_len_be);
+  if (blob_len < 8 || blob_len > kMaxCsBlobSize) {
+    return "csops_audittoken reported implausible blob length";
+  }
+
+  buf.assign(blob_len, 0);
+  rc = csops_audittoken(pid, kCsopBlob, buf.data(), buf.size(), &mutable_token);
+  if (rc != 0) {
+    return std::string("csops_audittoken full-fetch errno=") + std::to_string(errno);
+  }
+
+  return "";
+}
+
+}  // namespace
+
+KernelCsBlob::Result KernelCsBlob::ParseBytes(std::span<const uint8_t> kernel_cs_blob,
+                                              std::span<const uint8_t> cd_bytes) {
+  Result r;
+
+  if (!CheckSuperBlob(kernel_cs_blob, r)) {
+    return r;
+  }
+
+  // Extract entitlement slot payloads (CSSLOT_ENTITLEMENTS = 5,
+  // CSSLOT_DER_ENTITLEMENTS = 7). Independent of CMS state — present
+  // even on ad-hoc binaries if the original codesign included them.
+  // Per-slot expected magics match xnu (bsd/kern/ubc_subr.c:3291-3299).
+  if (auto xml =
+          FindSlotPayload(kernel_cs_blob, CSSLOT_ENTITLEMENTS, CSMAGIC_EMBEDDED_ENTITLEMENTS);
+      !xml.empty()) {
+    r.entitlement_xml = std::vector<uint8_t>(xml.begin(), xml.end());
+  }
+  if (auto der = FindSlotPayload(kernel_cs_blob, CSSLOT_DER_ENTITLEMENTS,
+                                 CSMAGIC_EMBEDDED_DER_ENTITLEMENTS);
+      !der.empty()) {
+    r.entitlement_der = std::vector<uint8_t>(der.begin(), der.end());
+  }
+
+  ScopedCFTypeRef<CMSDecoderRef> cms_decoder;
+  if (!DecodeCms(kernel_cs_blob, cd_bytes, cms_decoder, r)) {
     return r;
   }
 
@@ -282,76 +398,92 @@ KernelCsBlob::Result KernelCsBlob::ParseBytes(std::span<const uint8_t> kernel_cs
 
 KernelCsBlob::Result KernelCsBlob::Fetch(const audit_token_t& token, size_t cs_blob_size_hint,
                                          std::span<const uint8_t> cd_bytes) {
-  Result r;
-  audit_token_t mutable_token = token;
-  pid_t pid = audit_token_to_pid(mutable_token);
-
-  // Try the one-syscall path: allocate cs_blob_size_hint bytes and ask
-  // the kernel. If the hint is right (common case), one syscall serves.
-  // If the hint is 0, too large, or too small, fall back to the
-  // header-probe pattern. Capping at kMaxCsBlobSize keeps a bogus hint
-  // from forcing a huge allocation here — the probe path independently
-  // re-applies the same cap to the kernel-reported length.
   std::vector<uint8_t> buf;
-  if (cs_blob_size_hint > 0 && cs_blob_size_hint <= kMaxCsBlobSize) {
-    buf.resize(cs_blob_size_hint);
-    int rc = csops_audittoken(pid, kCsopBlob, buf.data(), buf.size(), &mutable_token);
-    if (rc == 0) {
-      // Success. Read BlobCore (8 bytes: magic + length, both big-endian)
-      // at offset 0 to learn actual blob length.
-      if (buf.size() < 8) {
-        r.status = Status::kBlobFetchFailed;
-        r.last_error = "csops returned undersized buffer";
-        return r;
-      }
-      uint32_t actual_len_be;
-      std::memcpy(&actual_len_be, buf.data() + 4, sizeof(actual_len_be));
-      uint32_t actual_len = OSSwapBigToHostInt32(actual_len_be);
-      if (actual_len > buf.size()) actual_len = static_cast<uint32_t>(buf.size());
-      buf.resize(actual_len);
-      return ParseBytes(buf, cd_bytes);
-    }
-    if (errno != ERANGE) {
-      r.status = Status::kBlobFetchFailed;
-      r.last_error = std::string("csops_audittoken errno=") + std::to_string(errno);
-      return r;
-    }
-    // fall through to header-probe path
+  if (std::string error = FetchBlobBytes(token, cs_blob_size_hint, buf); !error.empty()) {
+    Result r;
+    r.status = Status::kBlobFetchFailed;
+    r.last_error = std::move(error);
+    return r;
   }
 
-  // Header-probe path: ask for just the BlobCore (8 bytes); on ERANGE,
-  // the kernel writes the header (which carries length) anyway.
-  uint8_t header[8];
-  int rc = csops_audittoken(pid, kCsopBlob, header, sizeof(header), &mutable_token);
-  if (rc == 0) {
+  return ParseBytes(buf, cd_bytes);
+}
+
+KernelCsBlob::Result KernelCsBlob::FetchLeafCertificate(const audit_token_t& token,
+                                                        size_t cs_blob_size_hint) {
+  std::vector<uint8_t> buf;
+  if (std::string error = FetchBlobBytes(token, cs_blob_size_hint, buf); !error.empty()) {
+    Result r;
     r.status = Status::kBlobFetchFailed;
-    r.last_error = "csops_audittoken unexpectedly returned success on small buf";
+    r.last_error = std::move(error);
     return r;
   }
-  if (errno != ERANGE) {
+
+  return ParseLeafCertificate(buf);
+}
+
+KernelCsBlob::Result KernelCsBlob::FetchBlob(const audit_token_t& token,
+                                             size_t cs_blob_size_hint,
+                                             std::vector<uint8_t>& blob) {
+  Result r;
+  if (std::string error = FetchBlobBytes(token, cs_blob_size_hint, blob); !error.empty()) {
     r.status = Status::kBlobFetchFailed;
-    r.last_error = std::string("csops_audittoken header errno=") + std::to_string(errno);
+    r.last_error = std::move(error);
+    blob.clear();
     return r;
   }
 
-  uint32_t blob_len_be;
-  std::memcpy(&blob_len_be, header + 4, sizeof(blob_len_be));
-  uint32_t blob_len = OSSwapBigToHostInt32(blob_len_be);
-  if (blob_len < 8 || blob_len > kMaxCsBlobSize) {
-    r.status = Status::kBlobFetchFailed;
-    r.last_error = "csops_audittoken reported implausible blob length";
+  r.status = Status::kOk;
+  return r;
+}
+
+KernelCsBlob::Result KernelCsBlob::ParseLeafCertificate(std::span<const uint8_t> kernel_cs_blob) {
+  Result r;
+
+  if (!CheckSuperBlob(kernel_cs_blob, r)) {
     return r;
   }
 
-  buf.assign(blob_len, 0);
-  rc = csops_audittoken(pid, kCsopBlob, buf.data(), buf.size(), &mutable_token);
-  if (rc != 0) {
-    r.status = Status::kBlobFetchFailed;
-    r.last_error = std::string("csops_audittoken full-fetch errno=") + std::to_string(errno);
+  // Only the certificates are wanted here, but the decoder still needs
+  // detached content to finalize. The blob's own CodeDirectory is the
+  // content the signature covers.
+  std::span<const uint8_t> cd_bytes;
+  if (auto cd = FindSlotPayload(kernel_cs_blob, CSSLOT_CODEDIRECTORY, CSMAGIC_CODEDIRECTORY);
+      !cd.empty()) {
+    cd_bytes = std::span<const uint8_t>(cd.data() - 8, cd.size() + 8);
+  }
+
+  ScopedCFTypeRef<CMSDecoderRef> cms_decoder;
+  if (!DecodeCms(kernel_cs_blob, cd_bytes, cms_decoder, r)) {
     return r;
   }
 
-  return ParseBytes(buf, cd_bytes);
+  ScopedCFTypeRef<CFArrayRef> certs;
+  if (CMSDecoderCopyAllCerts(cms_decoder.Unsafe(), certs.InitializeInto()) != errSecSuccess ||
+      !certs) {
+    r.status = Status::kCmsParseFailed;
+    r.last_error = "CMSDecoderCopyAllCerts failed";
+    return r;
+  }
+
+  SecCertificateRef leaf = FindLeafCertificate(certs.Unsafe());
+  if (!leaf) {
+    r.status = Status::kCmsParseFailed;
+    r.last_error = "CMS message has no unique leaf certificate";
+    return r;
+  }
+
+  auto der = ScopedCFTypeRef<CFDataRef>::Assume(SecCertificateCopyData(leaf));
+  if (!der) {
+    r.status = Status::kCmsParseFailed;
+    r.last_error = "SecCertificateCopyData failed";
+    return r;
+  }
+
+  const uint8_t* bytes = CFDataGetBytePtr(der.Unsafe());
+  r.leaf_certificate_der = std::vector<uint8_t>(bytes, bytes + CFDataGetLength(der.Unsafe()));
+  r.status = Status::kOk;
+  return r;
 }
 
 }  // namespace santa
@@ -20,6 +20,7 @@ __BEGIN_DECLS
 #include <Kernel/kern/cs_blobs.h>
 __END_DECLS
 
+#include <Security/Security.h>
 #import <XCTest/XCTest.h>
 
 #include <fcntl.h>
@@ -398,6 +399,39 @@ std::vector<uint8_t> ExtractCdBytes(std::span<const uint8_t> cs_blob) {
   XCTAssertGreaterThan(*r.secure_signing_time, 0.0);
 }
 
+- (void)testParseLeafCertificateFromNotarizedBinary {
+  auto cs_blob = Slurp([self fixturePath:@"santactl_2026.4.csblob"].UTF8String);
+  XCTAssertFalse(cs_blob.empty());
+
+  auto r = santa::KernelCsBlob::ParseLeafCertificate(cs_blob);
+
+  XCTAssertEqual(r.status, santa::KernelCsBlob::Status::kOk);
+  XCTAssertTrue(r.leaf_certificate_der.has_value());
+  // The leaf-only path skips the signing time lookups.
+  XCTAssertFalse(r.signing_time.has_value());
+  XCTAssertFalse(r.secure_signing_time.has_value());
+
+  NSData* der = [NSData dataWithBytes:r.leaf_certificate_der->data()
+                               length:r.leaf_certificate_der->size()];
+  SecCertificateRef cert = SecCertificateCreateWithData(NULL, (__bridge CFDataRef)der);
+  XCTAssertNotEqual(cert, nullptr);
+  NSString* summary = CFBridgingRelease(SecCertificateCopySubjectSummary(cert));
+  XCTAssertTrue([summary hasPrefix:@"Developer ID Application"], @"unexpected leaf: %@", summary);
+  CFRelease(cert);
+}
+
+- (void)testParseLeafCertificateAdHocReturnsNoCmsSignature {
+  auto bytes = Slurp([self fixturePath:@"hw_universal"].UTF8String);
+  XCTAssertFalse(bytes.empty());
+  auto cs_blob = ExtractCsBlobBytes(bytes, CPU_TYPE_ARM64);
+  XCTAssertFalse(cs_blob.empty());
+
+  auto r = santa::KernelCsBlob::ParseLeafCertificate(cs_blob);
+
+  XCTAssertEqual(r.status, santa::KernelCsBlob::Status::kNoCmsSignature);
+  XCTAssertFalse(r.leaf_certificate_der.has_value());
+}
+
 - (void)testParseBytesGarbageCmsReturnsCmsParseFailed {
   // Synthetic SuperBlob with a CMS slot whose payload is non-DER bytes.
   // FindSlotPayload locates the slot (non-empty), so we reach the
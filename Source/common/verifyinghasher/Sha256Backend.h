@@ -0,0 +1,70 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_COMMON_VERIFYINGHASHER_SHA256BACKEND_H
+#define SANTA_COMMON_VERIFYINGHASHER_SHA256BACKEND_H
+
+#include <CommonCrypto/CommonDigest.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace santa {
+
+// Implementations of SHA-256 that HashTraits can dispatch to. Every backend
+// produces identical digests; they differ only in speed.
+enum class Sha256Backend {
+  kCommonCrypto,
+  // Direct use of the ARMv8 SHA-2 instructions, without CommonCrypto's
+  // per-call overhead. Only available on arm64 hardware with FEAT_SHA256.
+  kArmv8,
+};
+
+const char* Sha256BackendName(Sha256Backend backend);
+
+// True if `backend` was compiled in and the CPU supports it.
+bool Sha256BackendAvailable(Sha256Backend backend);
+
+// The backend new contexts use. Chosen once from the CPU features at first
+// use: kArmv8 where available, otherwise kCommonCrypto.
+Sha256Backend ActiveSha256Backend();
+
+// Overrides the active backend, for benchmarks and tests. Contexts that are
+// already initialized keep the backend they were started with. Returns
+// false, leaving the active backend unchanged, if `backend` is unavailable.
+bool SetActiveSha256Backend(Sha256Backend backend);
+
+struct Sha256Ctx {
+  Sha256Backend backend;
+  union {
+    CC_SHA256_CTX cc;
+    struct {
+      uint32_t state[8];
+      uint64_t total_len;
+      uint8_t block[64];
+      size_t block_len;
+    } armv8;
+  };
+};
+
+// Same conventions as CC_SHA256_*: return 1 on success. Update accepts
+// inputs of any length.
+int Sha256Init(Sha256Ctx* ctx);
+int Sha256Update(Sha256Ctx* ctx, const void* data, size_t len);
+int Sha256Final(unsigned char* md, Sha256Ctx* ctx);
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_VERIFYINGHASHER_SHA256BACKEND_H
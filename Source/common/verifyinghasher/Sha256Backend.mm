@@ -0,0 +1,242 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/verifyinghasher/Sha256Backend.h"
+
+#include <sys/sysctl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_SHA2)
+#include <arm_neon.h>
+#define VERIFYINGHASHER_HAVE_ARMV8_SHA256 1
+#endif
+
+namespace santa {
+
+namespace {
+
+#if VERIFYINGHASHER_HAVE_ARMV8_SHA256
+
+alignas(16) constexpr uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr uint32_t kInitialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+// Process `blocks` consecutive 64-byte blocks. The state is kept as the
+// {a,b,c,d} and {e,f,g,h} halves expected by the SHA256H/SHA256H2
+// instructions, which is also the order of the standard state words.
+void Armv8Blocks(uint32_t state[8], const uint8_t* data, size_t blocks) {
+  uint32x4_t abcd = vld1q_u32(&state[0]);
+  uint32x4_t efgh = vld1q_u32(&state[4]);
+
+  for (; blocks > 0; blocks--, data += 64) {
+    const uint32x4_t abcd_saved = abcd;
+    const uint32x4_t efgh_saved = efgh;
+
+    uint32x4_t msg[4] = {
+        vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data))),
+        vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16))),
+        vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32))),
+        vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48))),
+    };
+
+    // Each iteration is four rounds. The first 12 also extend the message
+    // schedule by the four words needed 16 rounds later.
+    for (int i = 0; i < 16; i++) {
+      const uint32x4_t wk = vaddq_u32(msg[i & 3], vld1q_u32(&kRoundConstants[4 * i]));
+      const uint32x4_t abcd_prev = abcd;
+      abcd = vsha256hq_u32(abcd, efgh, wk);
+      efgh = vsha256h2q_u32(efgh, abcd_prev, wk);
+      if (i < 12) {
+        msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]),
+                                     msg[(i + 2) & 3], msg[(i + 3) & 3]);
+      }
+    }
+
+    abcd = vaddq_u32(abcd, abcd_saved);
+    efgh = vaddq_u32(efgh, efgh_saved);
+  }
+
+  vst1q_u32(&state[0], abcd);
+  vst1q_u32(&state[4], efgh);
+}
+
+bool CpuHasSha256() {
+  int value = 0;
+  size_t size = sizeof(value);
+  return sysctlbyname("hw.optional.arm.FEAT_SHA256", &value, &size, nullptr, 0) == 0 &&
+         value == 1;
+}
+
+#endif  // VERIFYINGHASHER_HAVE_ARMV8_SHA256
+
+Sha256Backend DetectBackend() {
+  return Sha256BackendAvailable(Sha256Backend::kArmv8) ? Sha256Backend::kArmv8
+                                                        : Sha256Backend::kCommonCrypto;
+}
+
+std::atomic<Sha256Backend>& ActiveBackendStorage() {
+  static std::atomic<Sha256Backend> backend{DetectBackend()};
+  return backend;
+}
+
+}  // namespace
+
+const char* Sha256BackendName(Sha256Backend backend) {
+  switch (backend) {
+    case Sha256Backend::kCommonCrypto: return "commoncrypto";
+    case Sha256Backend::kArmv8: return "armv8";
+  }
+  return "unknown";
+}
+
+bool Sha256BackendAvailable(Sha256Backend backend) {
+  switch (backend) {
+    case Sha256Backend::kCommonCrypto: return true;
+    case Sha256Backend::kArmv8: {
+#if VERIFYINGHASHER_HAVE_ARMV8_SHA256
+      static const bool available = CpuHasSha256();
+      return available;
+#else
+      return false;
+#endif
+    }
+  }
+  return false;
+}
+
+Sha256Backend ActiveSha256Backend() {
+  return ActiveBackendStorage().load(std::memory_order_relaxed);
+}
+
+bool SetActiveSha256Backend(Sha256Backend backend) {
+  if (!Sha256BackendAvailable(backend)) return false;
+  ActiveBackendStorage().store(backend, std::memory_order_relaxed);
+  return true;
+}
+
+int Sha256Init(Sha256Ctx* ctx) {
+  ctx->backend = ActiveSha256Backend();
+  switch (ctx->backend) {
+    case Sha256Backend::kCommonCrypto: return CC_SHA256_Init(&ctx->cc);
+    case Sha256Backend::kArmv8:
+#if VERIFYINGHASHER_HAVE_ARMV8_SHA256
+      std::memcpy(ctx->armv8.state, kInitialState, sizeof(kInitialState));
+      ctx->armv8.total_len = 0;
+      ctx->armv8.block_len = 0;
+      return 1;
+#else
+      return 0;
+#endif
+  }
+  return 0;
+}
+
+int Sha256Update(Sha256Ctx* ctx, const void* data, size_t len) {
+  const auto* p = static_cast<const uint8_t*>(data);
+
+  switch (ctx->backend) {
+    case Sha256Backend::kCommonCrypto:
+      // CC_SHA256_Update takes a CC_LONG (uint32_t) length
+      while (len > 0) {
+        const CC_LONG step = static_cast<CC_LONG>(std::min<size_t>(len, UINT32_MAX));
+        if (CC_SHA256_Update(&ctx->cc, p, step) != 1) return 0;
+        p += step;
+        len -= step;
+      }
+      return 1;
+    case Sha256Backend::kArmv8: {
+#if VERIFYINGHASHER_HAVE_ARMV8_SHA256
+      auto& s = ctx->armv8;
+      s.total_len += len;
+      if (s.block_len > 0) {
+        const size_t take = std::min(len, sizeof(s.block) - s.block_len);
+        std::memcpy(s.block + s.block_len, p, take);
+        s.block_len += take;
+        p += take;
+        len -= take;
+        if (s.block_len < sizeof(s.block)) return 1;
+        Armv8Blocks(s.state, s.block, 1);
+        s.block_len = 0;
+      }
+
+      const size_t blocks = len / 64;
+      if (blocks > 0) {
+        Armv8Blocks(s.state, p, blocks);
+        p += blocks * 64;
+        len -= blocks * 64;
+      }
+
+      std::memcpy(s.block, p, len);
+      s.block_len = len;
+      return 1;
+#else
+      return 0;
+#endif
+    }
+  }
+  return 0;
+}
+
+int Sha256Final(unsigned char* md, Sha256Ctx* ctx) {
+  switch (ctx->backend) {
+    case Sha256Backend::kCommonCrypto: return CC_SHA256_Final(md, &ctx->cc);
+    case Sha256Backend::kArmv8: {
+#if VERIFYINGHASHER_HAVE_ARMV8_SHA256
+      auto& s = ctx->armv8;
+      const uint64_t bit_len = s.total_len * 8;
+
+      s.block[s.block_len++] = 0x80;
+      if (s.block_len > 56) {
+        std::memset(s.block + s.block_len, 0, sizeof(s.block) - s.block_len);
+        Armv8Blocks(s.state, s.block, 1);
+        s.block_len = 0;
+      }
+      std::memset(s.block + s.block_len, 0, 56 - s.block_len);
+      for (int i = 0; i < 8; i++) {
+        s.block[56 + i] = static_cast<uint8_t>(bit_len >> (56 - 8 * i));
+      }
+      Armv8Blocks(s.state, s.block, 1);
+
+      for (int i = 0; i < 8; i++) {
+        md[4 * i] = static_cast<uint8_t>(s.state[i] >> 24);
+        md[4 * i + 1] = static_cast<uint8_t>(s.state[i] >> 16);
+        md[4 * i + 2] = static_cast<uint8_t>(s.state[i] >> 8);
+        md[4 * i + 3] = static_cast<uint8_t>(s.state[i]);
+      }
+      std::memset(&s, 0, sizeof(s));
+      return 1;
+#else
+      return 0;
+#endif
+    }
+  }
+  return 0;
+}
+
+}  // namespace santa
@@ -0,0 +1,126 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/common/verifyinghasher/Sha256Backend.h"
+
+#include <CommonCrypto/CommonDigest.h>
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using santa::ActiveSha256Backend;
+using santa::SetActiveSha256Backend;
+using santa::Sha256Backend;
+using santa::Sha256BackendAvailable;
+using santa::Sha256Ctx;
+
+namespace {
+
+std::vector<uint8_t> TestData(size_t n) {
+  std::vector<uint8_t> data(n);
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+  }
+  return data;
+}
+
+// Hashes `data` with the given backend, feeding it `chunk` bytes at a time
+std::vector<uint8_t> Digest(Sha256Backend backend, const std::vector<uint8_t>& data,
+                            size_t chunk) {
+  Sha256Backend previous = ActiveSha256Backend();
+  SetActiveSha256Backend(backend);
+
+  Sha256Ctx ctx;
+  santa::Sha256Init(&ctx);
+  SetActiveSha256Backend(previous);
+
+  for (size_t off = 0; off < data.size(); off += chunk) {
+    santa::Sha256Update(&ctx, data.data() + off, std::min(chunk, data.size() - off));
+  }
+  std::vector<uint8_t> out(CC_SHA256_DIGEST_LENGTH);
+  santa::Sha256Final(out.data(), &ctx);
+  return out;
+}
+
+std::vector<uint8_t> Reference(const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> out(CC_SHA256_DIGEST_LENGTH);
+  CC_SHA256(data.data(), static_cast<CC_LONG>(data.size()), out.data());
+  return out;
+}
+
+}  // namespace
+
+@interface Sha256BackendTest : XCTestCase
+@end
+
+@implementation Sha256BackendTest
+
+- (void)testActiveBackendIsAvailable {
+  XCTAssertTrue(Sha256BackendAvailable(Sha256Backend::kCommonCrypto));
+  XCTAssertTrue(Sha256BackendAvailable(ActiveSha256Backend()));
+#if defined(__aarch64__)
+  // Every Apple Silicon CPU implements FEAT_SHA256
+  XCTAssertEqual(ActiveSha256Backend(), Sha256Backend::kArmv8);
+#endif
+}
+
+- (void)testBackendsMatchReference {
+  for (Sha256Backend backend : {Sha256Backend::kCommonCrypto, Sha256Backend::kArmv8}) {
+    if (!Sha256BackendAvailable(backend)) continue;
+
+    // Lengths around the padding boundaries exercise both Final() paths
+    for (size_t len : {0ul, 1ul, 3ul, 55ul, 56ul, 57ul, 63ul, 64ul, 65ul, 119ul, 120ul, 128ul,
+                       4096ul, 16384ul, 100003ul}) {
+      std::vector<uint8_t> data = TestData(len);
+      std::vector<uint8_t> want = Reference(data);
+      for (size_t chunk : {1ul, 7ul, 64ul, 1031ul, 16384ul}) {
+        XCTAssertTrue(Digest(backend, data, chunk) == want, @"backend=%s len=%zu chunk=%zu",
+                      santa::Sha256BackendName(backend), len, chunk);
+      }
+    }
+  }
+}
+
+- (void)testContextKeepsItsBackend {
+  Sha256Backend previous = ActiveSha256Backend();
+  std::vector<uint8_t> data = TestData(1000);
+
+  Sha256Ctx ctx;
+  santa::Sha256Init(&ctx);
+  santa::Sha256Update(&ctx, data.data(), 500);
+
+  // Switching the active backend mid-stream must not affect this context
+  for (Sha256Backend backend : {Sha256Backend::kCommonCrypto, Sha256Backend::kArmv8}) {
+    if (backend != previous && SetActiveSha256Backend(backend)) break;
+  }
+  santa::Sha256Update(&ctx, data.data() + 500, 500);
+  std::vector<uint8_t> out(CC_SHA256_DIGEST_LENGTH);
+  santa::Sha256Final(out.data(), &ctx);
+  SetActiveSha256Backend(previous);
+
+  XCTAssertTrue(out == Reference(data));
+}
+
+- (void)testUnavailableBackendIsRejected {
+  if (Sha256BackendAvailable(Sha256Backend::kArmv8)) return;
+
+  Sha256Backend previous = ActiveSha256Backend();
+  XCTAssertFalse(SetActiveSha256Backend(Sha256Backend::kArmv8));
+  XCTAssertEqual(ActiveSha256Backend(), previous);
+}
+
+@end
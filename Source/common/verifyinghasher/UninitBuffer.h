@@ -18,17 +18,19 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
-#include <memory>
 #include <span>
 
+#include "Source/common/ReadBufferPool.h"
+
 namespace santa {
 
 // Owning byte buffer with no value-init on allocation. Avoids the
 // std::vector<uint8_t>::resize() zero-fill on buffers that get fully
 // overwritten by pread/memcpy before being read. Used by VerifyingHasherCore
-// for chunk_buf_ and cs_blob_buf_.
+// for chunk_buf_ and cs_blob_buf_. Storage is leased from ReadBufferPool, so
+// back to back runs on a thread reuse the same page-aligned buffers.
 //
-// Move-only (std::unique_ptr<uint8_t[]>). Allocate() is "once per buffer"
+// Move-only (ReadBufferPool::Buffer). Allocate() is "once per buffer"
 // — calling it on a populated buffer is a usage bug and the assert traps
 // it in dev builds. If a callsite legitimately needs to resize, it should
 // either default-construct a fresh UninitBuffer or call a future Reset().
@@ -37,21 +39,21 @@ class UninitBuffer {
   UninitBuffer() = default;
 
   // Allocate `n` bytes, leaving them uninitialized. Must only be called on
-  // an empty buffer. Strong exception guarantee: if make_unique_for_overwrite
+  // an empty buffer. Strong exception guarantee: if ReadBufferPool::Acquire
   // throws bad_alloc, the buffer is left in its prior (empty) state.
   void Allocate(size_t n) {
     assert(size_ == 0 && "UninitBuffer::Allocate called on a non-empty buffer");
-    data_ = std::make_unique_for_overwrite<uint8_t[]>(n);
+    data_ = ReadBufferPool::Acquire(n);
     size_ = n;
   }
-  uint8_t* data() { return data_.get(); }
-  const uint8_t* data() const { return data_.get(); }
+  uint8_t* data() { return data_.data(); }
+  const uint8_t* data() const { return data_.data(); }
   size_t size() const { return size_; }
   bool empty() const { return size_ == 0; }
-  std::span<const uint8_t> view() const { return {data_.get(), size_}; }
+  std::span<const uint8_t> view() const { return {data_.data(), size_}; }
 
  private:
-  std::unique_ptr<uint8_t[]> data_;
+  ReadBufferPool::Buffer data_;
   size_t size_ = 0;
 };
 
@@ -16,6 +16,7 @@
 #define SANTA_COMMON_VERIFYINGHASHER_VERIFYINGHASHER_H
 
 #include <CommonCrypto/CommonDigest.h>
+#include <bsm/libbsm.h>  // audit_token_t
 #include <mach/machine.h>
 #include <sys/cdefs.h>
 #include <sys/types.h>
@@ -34,6 +35,8 @@ __END_DECLS
 #include <string_view>
 #include <vector>
 
+#include "Source/common/verifyinghasher/FileReader.h"
+
 namespace santa {
 
 // Public facade for FD-based code-signature verification with full-file
@@ -42,6 +45,10 @@ namespace santa {
 //
 // Single-observation invariant: every byte of the file is read at most
 // once across a successful Run() call.
+//
+// RunFromKernel() is the fast path for processes that are already running.
+// It verifies identity against the code signature the kernel holds for the
+// process and never reads the Mach-O from disk.
 class VerifyingHasher {
  public:
   enum class Status {
@@ -126,6 +133,10 @@ class VerifyingHasher {
     // see Core's documentation for the full contract. No-op on the Unsigned
     // path — an unsigned slice has no page hashes to skip.
     bool skip_page_hash = false;
+    // Overrides the I/O hints Run() would otherwise pick from the file size.
+    std::optional<FdFileReader::IoStrategy> io_strategy;
+    // Test hook: when non-null, receives the reader's I/O counters.
+    FdFileReader::IoStats* io_stats = nullptr;
   };
 
   static Result Run(int fd, cpu_type_t cputype, cpu_subtype_t cpusubtype,
@@ -139,6 +150,26 @@ class VerifyingHasher {
                     const Expected& expected) {
     return Run(fd, cputype, cpusubtype, expected, RunOptions{});
   }
+
+  // Verifies `expected` against the cs_blob the kernel validated the
+  // running process against, fetched with csops_audittoken(CS_OPS_BLOB).
+  // No file I/O is performed, so Result::sha256 is always nullopt; callers
+  // that need the full-file SHA-256 must use Run() on an fd instead.
+  //
+  // The kernel only serves the blob for CS_VALID processes and enforces
+  // the page hashes of the CodeDirectory itself as pages are faulted in,
+  // so the statuses carry the same meaning as a page-verified Run().
+  // Callers must still gate on CS_VALID, as for KernelCsBlob::Fetch.
+  // kMatchUnsigned is unreachable: an unsigned process has no kernel blob
+  // and yields kError. `cs_blob_size_hint` is passed to KernelCsBlob; 0 is
+  // always valid.
+  static Result RunFromKernel(const audit_token_t& token, const Expected::Signed& expected,
+                              size_t cs_blob_size_hint);
+
+  // Test entry point for RunFromKernel. Verifies kernel-style cs_blob
+  // bytes directly.
+  static Result VerifyKernelBlob(std::span<const uint8_t> kernel_cs_blob,
+                                 const Expected::Signed& expected);
 };
 
 }  // namespace santa
@@ -19,15 +19,33 @@
 
 #include <algorithm>
 #include <cstring>
+#include <limits>
 
 #include "Source/common/verifyinghasher/CodeSignatureParser.h"
 #include "Source/common/verifyinghasher/FileReader.h"
+#include "Source/common/verifyinghasher/KernelCsBlob.h"
 #include "Source/common/verifyinghasher/VerifyingHasherCore.h"
 
 namespace santa {
 
 namespace {
 
+// Files at least this large are streamed in the pipelined mode, so reading,
+// the full-file digest and page-hash verification overlap. Below this the
+// cost of handing chunks between threads isn't recovered.
+constexpr off_t kPipelineMinFileSize = 32ll << 20;
+constexpr size_t kPipelineDepth = 4;
+
+// Cold binaries on network or encrypted volumes are latency bound, so the
+// window after each read is advised to the kernel. The window starts at one
+// Core read and grows while the reads stay sequential.
+constexpr size_t kReadaheadMinBytes = 1u << 20;
+constexpr size_t kReadaheadMaxBytes = 8u << 20;
+
+// Files this large are read without populating the page cache; hashing them
+// would otherwise push out much of what the rest of the system has cached.
+constexpr off_t kNoCacheMinFileSize = 1ll << 30;
+
 // True iff a == b byte-for-byte. Empty-vs-empty returns false (we never
 // claim a "match" against an absent expected cdhash).
 bool BytesEqual(std::span<const uint8_t> a, std::span<const uint8_t> b) {
@@ -41,6 +59,43 @@ bool StatMatches(const struct stat& st, const VerifyingHasher::StatTuple& exp) {
          st.st_mtimespec.tv_sec == exp.mtime.tv_sec && st.st_mtimespec.tv_nsec == exp.mtime.tv_nsec;
 }
 
+// Compares a parsed CodeDirectory against the caller's expectation and, on
+// a match, surfaces its fields in `r`. Shared by the file and kernel paths.
+void ClassifySigned(std::span<const uint8_t> computed_cdhash, const ParsedCodeDirectory& parsed,
+                    size_t cs_blob_size, const VerifyingHasher::Expected::Signed& sig,
+                    VerifyingHasher::Result& r) {
+  using Status = VerifyingHasher::Status;
+
+  if (BytesEqual(computed_cdhash, sig.cdhash)) {
+    r.status = Status::kMatchCDHash;
+  } else if (!sig.signing_id.empty() && !sig.team_id.empty() &&
+             parsed.identifier == sig.signing_id && parsed.team_id == sig.team_id) {
+    // Drift detection requires a non-empty signed_check->team_id; ad-hoc
+    // binaries (empty team_id) carry weaker identity than the team-signed
+    // model the drift fallback assumes and fall through to kNoMatch on
+    // any cdhash mismatch.
+    r.status = Status::kMatchSidTidDrift;
+  } else {
+    r.status = Status::kNoMatch;
+  }
+
+  // Surface VH-side fields for downstream BinaryAttestation consumption.
+  // Populated only when we actually accepted a CD as a verified match.
+  if (r.status == Status::kMatchCDHash || r.status == Status::kMatchSidTidDrift) {
+    if (computed_cdhash.size() == CS_CDHASH_LEN) {
+      std::array<uint8_t, CS_CDHASH_LEN> arr;
+      std::copy(computed_cdhash.begin(), computed_cdhash.end(), arr.begin());
+      r.cdhash = arr;
+    }
+    if (!parsed.identifier.empty()) r.signing_id = parsed.identifier;
+    if (!parsed.team_id.empty()) r.team_id = parsed.team_id;
+    if (!parsed.cd_bytes.empty()) {
+      r.cd_bytes = std::vector<uint8_t>(parsed.cd_bytes.begin(), parsed.cd_bytes.end());
+    }
+    r.cs_blob_size = cs_blob_size;
+  }
+}
+
 }  // namespace
 
 VerifyingHasher::Result VerifyingHasher::Run(int fd, cpu_type_t cputype, cpu_subtype_t cpusubtype,
@@ -59,13 +114,20 @@ VerifyingHasher::Result VerifyingHasher::Run(int fd, cpu_type_t cputype, cpu_sub
     }
   }
 
-  FdFileReader reader(fd, exp.stat.size);
+  FdFileReader reader(fd, exp.stat.size,
+                      opts.io_strategy.value_or(FdFileReader::IoStrategy{
+                          .readahead_min_bytes = kReadaheadMinBytes,
+                          .readahead_max_bytes = kReadaheadMaxBytes,
+                          .nocache = exp.stat.size >= kNoCacheMinFileSize,
+                      }));
   ArchSelector want{cputype, cpusubtype};
   VerifyingHasherCore::Options core_opts;
   core_opts.skip_page_hash = opts.skip_page_hash;
+  if (exp.stat.size >= kPipelineMinFileSize) core_opts.pipeline_depth = kPipelineDepth;
   VerifyingHasherCore core(reader, want, core_opts);
 
   auto core_status = core.Run();
+  if (opts.io_stats) *opts.io_stats = reader.Stats();
 
   if (auto d = core.FullFileDigest(); d.size() == CC_SHA256_DIGEST_LENGTH) {
     std::array<uint8_t, CC_SHA256_DIGEST_LENGTH> buf;
@@ -96,37 +158,37 @@ VerifyingHasher::Result VerifyingHasher::Run(int fd, cpu_type_t cputype, cpu_sub
     return r;
   }
 
-  auto computed_cdhash = core.CDHash();
-  const auto& parsed = core.ParsedCD();
+  ClassifySigned(core.CDHash(), core.ParsedCD(), static_cast<size_t>(core.Slice().cs_blob_size),
+                 sig, r);
+  return r;
+}
 
-  if (BytesEqual(computed_cdhash, sig.cdhash)) {
-    r.status = Status::kMatchCDHash;
-  } else if (!sig.signing_id.empty() && !sig.team_id.empty() &&
-             parsed.identifier == sig.signing_id && parsed.team_id == sig.team_id) {
-    // Drift detection requires a non-empty signed_check->team_id; ad-hoc
-    // binaries (empty team_id) carry weaker identity than the team-signed
-    // model the drift fallback assumes and fall through to kNoMatch on
-    // any cdhash mismatch.
-    r.status = Status::kMatchSidTidDrift;
-  } else {
-    r.status = Status::kNoMatch;
+VerifyingHasher::Result VerifyingHasher::RunFromKernel(const audit_token_t& token,
+                                                       const Expected::Signed& expected,
+                                                       size_t cs_blob_size_hint) {
+  std::vector<uint8_t> blob;
+  if (KernelCsBlob::FetchBlob(token, cs_blob_size_hint, blob).status !=
+      KernelCsBlob::Status::kOk) {
+    return Result{.status = Status::kError};
   }
+  return VerifyKernelBlob(blob, expected);
+}
 
-  // Surface VH-side fields for downstream BinaryAttestation consumption.
-  // Populated only when we actually accepted a CD as a verified match.
-  if (r.status == Status::kMatchCDHash || r.status == Status::kMatchSidTidDrift) {
-    if (computed_cdhash.size() == CS_CDHASH_LEN) {
-      std::array<uint8_t, CS_CDHASH_LEN> arr;
-      std::copy(computed_cdhash.begin(), computed_cdhash.end(), arr.begin());
-      r.cdhash = arr;
-    }
-    if (!parsed.identifier.empty()) r.signing_id = parsed.identifier;
-    if (!parsed.team_id.empty()) r.team_id = parsed.team_id;
-    if (!parsed.cd_bytes.empty()) {
-      r.cd_bytes = std::vector<uint8_t>(parsed.cd_bytes.begin(), parsed.cd_bytes.end());
-    }
-    r.cs_blob_size = static_cast<size_t>(core.Slice().cs_blob_size);
+VerifyingHasher::Result VerifyingHasher::VerifyKernelBlob(std::span<const uint8_t> kernel_cs_blob,
+                                                          const Expected::Signed& expected) {
+  Result r{};
+
+  // There is no slice to bound codeLimit by, the kernel already checked it
+  // against the mapped image when it accepted the blob.
+  ParsedCodeDirectory parsed;
+  std::string err;
+  if (!ParseCodeSignature(kernel_cs_blob, std::numeric_limits<uint64_t>::max(), parsed, err)) {
+    r.status = Status::kError;
+    return r;
   }
+
+  ClassifySigned(std::span<const uint8_t>(parsed.cdhash, CS_CDHASH_LEN), parsed,
+                 kernel_cs_blob.size(), expected, r);
   return r;
 }
 
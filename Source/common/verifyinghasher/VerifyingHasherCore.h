@@ -27,6 +27,7 @@
 
 #include "Source/common/verifyinghasher/CodeSignatureParser.h"
 #include "Source/common/verifyinghasher/FileReader.h"
+#include "Source/common/verifyinghasher/HashTraits.h"
 #include "Source/common/verifyinghasher/HeaderParser.h"
 #include "Source/common/verifyinghasher/UninitBuffer.h"
 
@@ -53,6 +54,13 @@ class VerifyingHasherCore {
     // Status::kPagesMismatched is structurally unreachable. See
     // HashTraits.h::NoopHashTraits and PageHashSkipped() below.
     bool skip_page_hash = false;
+    // If at least 2, the bulk of the file is streamed through a ring of
+    // this many buf_size buffers: the calling thread keeps reading while
+    // the full-file SHA-256 and page-hash verification each consume the
+    // buffers in order on their own serial queue. Every byte is still read
+    // exactly once and both consumers see the same bytes. 0 (or 1) streams
+    // on the calling thread only.
+    size_t pipeline_depth = 0;
   };
 
   VerifyingHasherCore(FileReader& reader, ArchSelector want);
@@ -92,6 +100,14 @@ class VerifyingHasherCore {
   template <typename HashTraits>
   Status RunStreamingPhases();
 
+  // Reads [cursor_, end), feeding every chunk to full_ctx_ and, if
+  // non-null, `pv`. `phase` names the phase in error messages.
+  template <typename PageSink>
+  Status StreamTo(uint64_t end, PageSink* pv, const char* phase);
+  template <typename PageSink>
+  Status StreamToPipelined(uint64_t end, PageSink* pv, const char* phase);
+  Status CheckStreamRead(ssize_t n, size_t want, const char* phase);
+
   Status RunHeaderPhase();
   Status RunCsBlobPhase();
   void FinalizeDigestDrainingToEof();
@@ -102,6 +118,8 @@ class VerifyingHasherCore {
 
   UninitBuffer chunk_buf_;
   UninitBuffer cs_blob_buf_;
+  // Ring used by the pipelined streaming mode, allocated on first use.
+  std::vector<UninitBuffer> pipeline_bufs_;
   // Phase-1 chunks' bytes that lie inside the chosen slice — i.e., file
   // offsets >= slice_offset, accumulated until HeaderParser reaches kReady.
   // Bounded by slice_header_size + sizeofcmds (sizeofcmds is capped at
@@ -115,7 +133,7 @@ class VerifyingHasherCore {
   //      avoiding a second pread of the same region.
   std::vector<uint8_t> header_phase_buf_;
 
-  CC_SHA256_CTX full_ctx_;
+  Sha256Traits::Ctx full_ctx_;
   uint8_t full_digest_[CC_SHA256_DIGEST_LENGTH] = {};
   bool digest_finalized_ = false;
   bool cdhash_populated_ = false;
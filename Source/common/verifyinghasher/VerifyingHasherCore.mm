@@ -14,6 +14,7 @@
 
 #include "Source/common/verifyinghasher/VerifyingHasherCore.h"
 
+#include <dispatch/dispatch.h>
 #include <os/overflow.h>
 #include <sys/cdefs.h>
 
@@ -22,8 +23,10 @@ __BEGIN_DECLS
 __END_DECLS
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstring>
+#include <memory>
 
 #include "Source/common/verifyinghasher/HashTraits.h"
 #include "Source/common/verifyinghasher/PageVerifier.h"
@@ -185,6 +188,106 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunCsBlobPhase() {
   return Status::kOk;
 }
 
+VerifyingHasherCore::Status VerifyingHasherCore::CheckStreamRead(ssize_t n, size_t want,
+                                                                 const char* phase) {
+  if (n < 0) {
+    last_error_ = std::string("pread failed in ") + phase + " phase";
+    return Status::kIoError;
+  }
+  // n == 0 before `end` means the underlying source returned EOF before we
+  // hit the size fstat reported at Run() entry (e.g., the file was truncated
+  // mid-verification). Treat as kIoError so the partial digest doesn't get
+  // finalized and returned as if it covered the full file.
+  if (n == 0) {
+    last_error_ = std::string("unexpected EOF in ") + phase + " phase";
+    return Status::kIoError;
+  }
+  if (static_cast<size_t>(n) > want) {
+    // Reader violated its len contract — pread(2) caps at len, so this
+    // can only happen with a misbehaving custom FileReader. Defense-
+    // in-depth against silently feeding bytes past `end` into pv.
+    last_error_ = std::string("reader served past requested length in ") + phase + " phase";
+    return Status::kIoError;
+  }
+  return Status::kOk;
+}
+
+template <typename PageSink>
+VerifyingHasherCore::Status VerifyingHasherCore::StreamTo(uint64_t end, PageSink* pv,
+                                                          const char* phase) {
+  // Not worth handing off work that fits in a single read
+  if (opts_.pipeline_depth >= 2 && end > cursor_ && end - cursor_ > chunk_buf_.size()) {
+    return StreamToPipelined(end, pv, phase);
+  }
+
+  while (cursor_ < end) {
+    size_t want = std::min<size_t>(chunk_buf_.size(), end - cursor_);
+    ssize_t n = reader_.Pread(chunk_buf_.data(), want, static_cast<off_t>(cursor_));
+    if (Status s = CheckStreamRead(n, want, phase); s != Status::kOk) return s;
+    Sha256Traits::Update(&full_ctx_, chunk_buf_.data(), static_cast<size_t>(n));
+    if (pv) pv->Update(chunk_buf_.data(), static_cast<size_t>(n), cursor_);
+    cursor_ += static_cast<uint64_t>(n);
+  }
+  return Status::kOk;
+}
+
+template <typename PageSink>
+VerifyingHasherCore::Status VerifyingHasherCore::StreamToPipelined(uint64_t end, PageSink* pv,
+                                                                   const char* phase) {
+  const size_t depth = opts_.pipeline_depth;
+  while (pipeline_bufs_.size() < depth) {
+    pipeline_bufs_.emplace_back().Allocate(opts_.buf_size);
+  }
+
+  // A slot is reused once every consumer has released it. The consumer
+  // queues are serial so each sees the chunks in file order, and neither
+  // touches full_ctx_ / pv once the group has been waited on below.
+  auto refs = std::make_unique<std::atomic<int>[]>(depth);
+  std::atomic<int>* slot_refs = refs.get();
+  const int consumers = pv ? 2 : 1;
+  dispatch_semaphore_t free_slots = dispatch_semaphore_create(static_cast<long>(depth));
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_queue_t digest_queue =
+      dispatch_queue_create("com.northpolesec.santa.verifyinghasher.digest", DISPATCH_QUEUE_SERIAL);
+  dispatch_queue_t verify_queue =
+      dispatch_queue_create("com.northpolesec.santa.verifyinghasher.pages", DISPATCH_QUEUE_SERIAL);
+  Sha256Traits::Ctx* full_ctx = &full_ctx_;
+
+  Status status = Status::kOk;
+  for (size_t slot = 0; cursor_ < end; slot = (slot + 1) % depth) {
+    dispatch_semaphore_wait(free_slots, DISPATCH_TIME_FOREVER);
+
+    uint8_t* buf = pipeline_bufs_[slot].data();
+    size_t want = std::min<size_t>(pipeline_bufs_[slot].size(), end - cursor_);
+    ssize_t n = reader_.Pread(buf, want, static_cast<off_t>(cursor_));
+    if (status = CheckStreamRead(n, want, phase); status != Status::kOk) break;
+
+    const size_t len = static_cast<size_t>(n);
+    const uint64_t off = cursor_;
+    slot_refs[slot].store(consumers, std::memory_order_relaxed);
+    void (^release)(void) = ^{
+      if (slot_refs[slot].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        dispatch_semaphore_signal(free_slots);
+      }
+    };
+
+    dispatch_group_async(group, digest_queue, ^{
+      Sha256Traits::Update(full_ctx, buf, len);
+      release();
+    });
+    if (pv) {
+      dispatch_group_async(group, verify_queue, ^{
+        pv->Update(buf, len, off);
+        release();
+      });
+    }
+    cursor_ += static_cast<uint64_t>(n);
+  }
+
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+  return status;
+}
+
 template <typename HashTraits>
 VerifyingHasherCore::Status VerifyingHasherCore::RunStreamingPhases() {
   const uint64_t signed_lo = slice_.slice_offset;
@@ -208,28 +311,7 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunStreamingPhases() {
 
   // Phase 3: stream from cursor_ up to cs_blob_offset (no-op if
   // phase 1 already overshot).
-  while (cursor_ < cs_lo) {
-    size_t want = std::min<size_t>(chunk_buf_.size(), cs_lo - cursor_);
-    ssize_t n = reader_.Pread(chunk_buf_.data(), want, static_cast<off_t>(cursor_));
-    if (n < 0) {
-      last_error_ = "pread failed in streaming phase";
-      return Status::kIoError;
-    }
-    if (n == 0) {
-      last_error_ = "unexpected EOF in streaming phase";
-      return Status::kIoError;
-    }
-    if (static_cast<size_t>(n) > want) {
-      // Reader violated its len contract — pread(2) caps at len, so this
-      // can only happen with a misbehaving custom FileReader. Defense-
-      // in-depth against silently feeding bytes past cs_lo into pv.
-      last_error_ = "reader served past requested length in streaming phase";
-      return Status::kIoError;
-    }
-    Sha256Traits::Update(&full_ctx_, chunk_buf_.data(), static_cast<size_t>(n));
-    pv.Update(chunk_buf_.data(), static_cast<size_t>(n), cursor_);
-    cursor_ += static_cast<uint64_t>(n);
-  }
+  if (Status s = StreamTo(cs_lo, &pv, "streaming"); s != Status::kOk) return s;
 
   // Phase 4: feed CS blob bytes to fullCtx — but only the portion
   // phase 1 didn't already cover.
@@ -244,31 +326,10 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunStreamingPhases() {
 
   // Phase 5: tail to EOF (no-op if phase 1 already reached EOF).
   const uint64_t total = static_cast<uint64_t>(reader_.Size());
-  while (cursor_ < total) {
-    size_t want = std::min<size_t>(chunk_buf_.size(), total - cursor_);
-    ssize_t n = reader_.Pread(chunk_buf_.data(), want, static_cast<off_t>(cursor_));
-    if (n < 0) {
-      last_error_ = "pread failed in tail phase";
-      return Status::kIoError;
-    }
-    // n == 0 with cursor_ < total means the underlying source returned
-    // EOF before we hit the size fstat reported at Run() entry (e.g.,
-    // the file was truncated mid-verification). Treat as kIoError —
-    // same as phase 3 — so the partial digest doesn't get finalized
-    // and returned as if it covered the full file.
-    if (n == 0) {
-      last_error_ = "unexpected EOF in tail phase";
-      return Status::kIoError;
-    }
-    if (static_cast<size_t>(n) > want) {
-      // Defense-in-depth against a misbehaving custom FileReader serving
-      // past its declared len. For fd-backed readers pread(2) caps at
-      // len so this is unreachable in production.
-      last_error_ = "reader served past requested length in tail phase";
-      return Status::kIoError;
-    }
-    Sha256Traits::Update(&full_ctx_, chunk_buf_.data(), static_cast<size_t>(n));
-    cursor_ += static_cast<uint64_t>(n);
+  // The tail is part of the full-file digest only, there are no pages to verify.
+  if (Status s = StreamTo(total, static_cast<decltype(pv)*>(nullptr), "tail");
+      s != Status::kOk) {
+    return s;
   }
 
   Sha256Traits::Final(full_digest_, &full_ctx_);
@@ -469,6 +469,47 @@ class OverservingMemoryFileReader : public santa::FileReader {
   XCTAssertLessThanOrEqual(mx, 1u, @"small-buffer SP invariant violated: max reads = %u", mx);
 }
 
+// Pipelined streaming must produce exactly the sequential results and keep
+// the single-pass invariant. A small buf_size gives phases 3 and 5 many
+// chunks so the ring wraps several times.
+- (void)testPipelinedMatchesSequential {
+  auto bytes = Slurp("/usr/bin/file");
+  XCTAssertFalse(bytes.empty());
+
+  VerifyingHasherCore::Options seq_opts;
+  seq_opts.buf_size = 4096;
+  MemoryFileReader seq_reader(bytes);
+  VerifyingHasherCore seq(seq_reader, kHostArch, seq_opts);
+  auto seq_status = seq.Run();
+  XCTAssertEqual(seq_status, VerifyingHasherCore::Status::kOk, @"Run: %s",
+                 std::string(seq.LastError()).c_str());
+
+  VerifyingHasherCore::Options opts = seq_opts;
+  opts.pipeline_depth = 3;
+  CountingMemoryFileReader r(bytes);
+  VerifyingHasherCore v(r, kHostArch, opts);
+  XCTAssertEqual(v.Run(), seq_status, @"Run: %s", std::string(v.LastError()).c_str());
+  XCTAssertEqual(HexLower(v.FullFileDigest()), HexLower(seq.FullFileDigest()));
+  XCTAssertEqual(HexLower(v.CDHash()), HexLower(seq.CDHash()));
+  XCTAssertEqual(*v.Mismatches(), 0u);
+  const uint32_t mx = r.MaxReadsAnyByte();
+  XCTAssertLessThanOrEqual(mx, 1u, @"pipelined SP invariant violated: max reads = %u", mx);
+}
+
+- (void)testPipelinedDetectsTamper {
+  auto bytes = Slurp("/usr/bin/yes");
+  XCTAssertFalse(bytes.empty());
+  bytes[3 * bytes.size() / 4] ^= 0xFF;
+
+  VerifyingHasherCore::Options opts;
+  opts.buf_size = 4096;
+  opts.pipeline_depth = 4;
+  MemoryFileReader r(bytes);
+  VerifyingHasherCore v(r, kHostArch, opts);
+  XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kPagesMismatched);
+  XCTAssertGreaterThanOrEqual(*v.Mismatches(), 1u);
+}
+
 // Specifically exercises C1: malformed CS blob with a small buffer
 // (so phase 1 doesn't reach cs_lo, RunCsBlobPhase takes the no-overlap
 // branch and preads [cs_lo, cs_hi), then ParseCodeSignature fails and
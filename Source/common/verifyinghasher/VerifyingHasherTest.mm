@@ -558,6 +558,43 @@ std::vector<uint8_t> Slurp(const char* path) {
   XCTAssertEqual(0, std::memcmp(r.sha256->data(), reference_sha.data(), 32));
 }
 
+- (void)testFacadeIoStrategy {
+  // The facade's default strategy advises read-ahead; an explicit empty
+  // strategy issues plain preads. Both read every byte exactly once and
+  // produce the same result.
+  auto cdhash = [self hwUniversalArm64CdHash];
+  auto run = ^(const VerifyingHasher::RunOptions& opts) {
+    santa::ScopedFile sf([self openHwUniversalFd]);
+    VerifyingHasher::Expected exp{
+        .stat = [self actualStatForFd:sf.UnsafeFD()],
+        .signed_check =
+            VerifyingHasher::Expected::Signed{
+                .cdhash = std::span<const uint8_t>(cdhash.data(), cdhash.size()),
+                .signing_id = kHwUniversalSigningID,
+                .team_id = kHwUniversalTeamID,
+            },
+    };
+    auto r = VerifyingHasher::Run(sf.UnsafeFD(), CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL, exp, opts);
+    XCTAssertEqual(r.status, VerifyingHasher::Status::kMatchCDHash);
+    XCTAssertTrue(r.sha256.has_value());
+    XCTAssertEqual(opts.io_stats->bytes_read, static_cast<uint64_t>(exp.stat.size));
+    return *r.sha256;
+  };
+
+  santa::FdFileReader::IoStats hinted;
+  auto hinted_sha = run(VerifyingHasher::RunOptions{.io_stats = &hinted});
+
+  santa::FdFileReader::IoStats plain;
+  auto plain_sha = run(VerifyingHasher::RunOptions{
+      .io_strategy = santa::FdFileReader::IoStrategy{},
+      .io_stats = &plain,
+  });
+
+  XCTAssertEqual(hinted_sha, plain_sha);
+  XCTAssertEqual(plain.advises, 0u);
+  XCTAssertEqual(hinted.preads, plain.preads);
+}
+
 - (void)testFacadeSkipPageHashBypassesTampered {
   // Write a tampered hw_universal into a temp file (mkstemp-backed,
   // unlinked at creation), open it, and exercise the facade with skip
@@ -917,4 +954,105 @@ std::vector<uint8_t> Slurp(const char* path) {
   }
 }
 
+// ---- Kernel blob mode ---------------------------------------------------
+
+// The embedded signature in the fixture is the same SuperBlob the kernel
+// serves through CS_OPS_BLOB, so it stands in for the kernel copy.
+- (std::vector<uint8_t>)arm64CsBlobAtPath:(NSString*)path {
+  auto bytes = Slurp(path.UTF8String);
+  XCTAssertFalse(bytes.empty(), @"Failed to slurp %@", path);
+  auto cs_blob = ExtractCsBlobBytes(bytes, CPU_TYPE_ARM64);
+  XCTAssertFalse(cs_blob.empty(), @"Failed to extract CS blob for arm64");
+  return cs_blob;
+}
+
+- (void)testKernelBlobMatchCDHash {
+  auto cdhash = [self hwUniversalArm64CdHash];
+  auto cs_blob = [self arm64CsBlobAtPath:[self fixturePath]];
+
+  VerifyingHasher::Expected::Signed exp{
+      .cdhash = std::span<const uint8_t>(cdhash.data(), cdhash.size()),
+      .signing_id = kHwUniversalSigningID,
+      .team_id = kHwUniversalTeamID,
+  };
+  auto r = VerifyingHasher::VerifyKernelBlob(cs_blob, exp);
+
+  XCTAssertEqual(r.status, VerifyingHasher::Status::kMatchCDHash);
+  // Nothing was read from disk, so there is no full-file digest
+  XCTAssertFalse(r.sha256.has_value());
+  XCTAssertTrue(r.cdhash.has_value());
+  XCTAssertEqual(std::vector<uint8_t>(r.cdhash->begin(), r.cdhash->end()), cdhash);
+  XCTAssertEqual(r.signing_id.value_or(""), kHwUniversalSigningID);
+  XCTAssertTrue(r.cd_bytes.has_value());
+  XCTAssertEqual(r.cs_blob_size.value_or(0), cs_blob.size());
+}
+
+- (void)testKernelBlobMatchesFileBasedRun {
+  auto cdhash = [self hwTeamSignedArm64CdHash];
+  auto cs_blob = [self arm64CsBlobAtPath:[self teamSignedFixturePath]];
+  santa::ScopedFile sf([self openHwTeamSignedFd]);
+
+  VerifyingHasher::Expected::Signed sig{
+      .cdhash = std::span<const uint8_t>(cdhash.data(), cdhash.size()),
+      .signing_id = kHwTeamSignedSigningID,
+      .team_id = kHwTeamSignedTeamID,
+  };
+  auto kernel = VerifyingHasher::VerifyKernelBlob(cs_blob, sig);
+  auto file = VerifyingHasher::Run(sf.UnsafeFD(), CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL,
+                                   VerifyingHasher::Expected{
+                                       .stat = [self actualStatForFd:sf.UnsafeFD()],
+                                       .signed_check = sig,
+                                   });
+
+  XCTAssertEqual(kernel.status, VerifyingHasher::Status::kMatchCDHash);
+  XCTAssertEqual(kernel.status, file.status);
+  XCTAssertTrue(kernel.cdhash == file.cdhash);
+  XCTAssertTrue(kernel.signing_id == file.signing_id);
+  XCTAssertTrue(kernel.team_id == file.team_id);
+  XCTAssertTrue(kernel.cd_bytes == file.cd_bytes);
+}
+
+- (void)testKernelBlobSidTidDriftAndNoMatch {
+  std::vector<uint8_t> wrong_cdhash(CS_CDHASH_LEN, 0xFF);
+  auto cs_blob = [self arm64CsBlobAtPath:[self teamSignedFixturePath]];
+
+  auto r = VerifyingHasher::VerifyKernelBlob(
+      cs_blob, VerifyingHasher::Expected::Signed{
+                   .cdhash = std::span<const uint8_t>(wrong_cdhash.data(), wrong_cdhash.size()),
+                   .signing_id = kHwTeamSignedSigningID,
+                   .team_id = kHwTeamSignedTeamID,
+               });
+  XCTAssertEqual(r.status, VerifyingHasher::Status::kMatchSidTidDrift);
+
+  r = VerifyingHasher::VerifyKernelBlob(
+      cs_blob, VerifyingHasher::Expected::Signed{
+                   .cdhash = std::span<const uint8_t>(wrong_cdhash.data(), wrong_cdhash.size()),
+                   .signing_id = "com.wrong.id",
+                   .team_id = kHwTeamSignedTeamID,
+               });
+  XCTAssertEqual(r.status, VerifyingHasher::Status::kNoMatch);
+  XCTAssertFalse(r.cdhash.has_value());
+  XCTAssertFalse(r.cd_bytes.has_value());
+}
+
+- (void)testKernelBlobMalformedIsError {
+  auto cdhash = [self hwUniversalArm64CdHash];
+  auto cs_blob = [self arm64CsBlobAtPath:[self fixturePath]];
+  VerifyingHasher::Expected::Signed exp{
+      .cdhash = std::span<const uint8_t>(cdhash.data(), cdhash.size()),
+  };
+
+  XCTAssertEqual(VerifyingHasher::VerifyKernelBlob({}, exp).status,
+                 VerifyingHasher::Status::kError);
+
+  std::vector<uint8_t> truncated(cs_blob.begin(), cs_blob.begin() + cs_blob.size() / 4);
+  XCTAssertEqual(VerifyingHasher::VerifyKernelBlob(truncated, exp).status,
+                 VerifyingHasher::Status::kError);
+
+  std::vector<uint8_t> bad_magic = cs_blob;
+  bad_magic[0] ^= 0xFF;
+  XCTAssertEqual(VerifyingHasher::VerifyKernelBlob(bad_magic, exp).status,
+                 VerifyingHasher::Status::kError);
+}
+
 @end
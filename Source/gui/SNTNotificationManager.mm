@@ -22,6 +22,7 @@
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/SNTBlockMessage.h"
+#import "Source/common/SNTBlockNotification.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigState.h"
 #import "Source/common/SNTConfigurator.h"
@@ -426,6 +427,23 @@ static NSString* const silencedNotificationsKey = @"SilencedNotifications";
   [self queueMessage:pendingMsg enableSilences:configState.enableNotificationSilences];
 }
 
+- (void)postBlockNotifications:(NSArray<SNTBlockNotification*>*)notifications {
+  for (SNTBlockNotification* notification in notifications) {
+    if (notification.repeatCount > 1) {
+      LOGI(@"Blocked %@ %lu times", notification.event.filePath,
+           (unsigned long)notification.repeatCount);
+    }
+
+    // Batched notifications don't have a reply but the window controller requires one.
+    [self postBlockNotification:notification.event
+              withCustomMessage:notification.customMessage
+                      customURL:notification.customURL
+                    configState:notification.configState
+                       andReply:^(BOOL _) {
+                       }];
+  }
+}
+
 - (void)postUSBBlockNotification:(SNTDeviceEvent*)event
                     configBundle:(SNTConfigBundle*)configBundle {
   if (!event) {
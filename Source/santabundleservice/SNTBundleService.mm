@@ -31,6 +31,9 @@
 #import "Source/common/SNTXPCNotifierInterface.h"
 #import "Source/common/SigningIDHelpers.h"
 
+// Minimum time between progress updates sent to the client while hashing
+static const uint64_t kProgressUpdateIntervalNanos = 100 * NSEC_PER_MSEC;
+
 @interface SNTBundleService ()
 @property(nonatomic) dispatch_queue_t queue;
 @end
@@ -273,7 +276,13 @@
                              clientListener:(MOLXPCConnection*)clientListener {
   if (progress.isCancelled) return nil;
 
-  NSMutableDictionary* relatedEvents = [NSMutableDictionary dictionaryWithCapacity:fis.count];
+  // Each file has its own result slot so that hashing doesn't serialize on a
+  // shared dictionary. The slots are merged once all files are hashed.
+  __block auto events = std::make_shared<std::vector<SNTStoredExecutionEvent*>>(fis.count);
+
+  __block auto hashedCount = std::make_shared<std::atomic<int64_t>>(0);
+  __block auto reusedCount = std::make_shared<std::atomic<int64_t>>(0);
+  __block auto lastUpdateNanos = std::make_shared<std::atomic<uint64_t>>(0);
 
   // Account for 15% of the work
   NSProgress* p;
@@ -288,6 +297,10 @@
 
       SNTFileInfo* fi = fis[i];
 
+      // Binaries that haven't changed since they were last hashed, by this
+      // service or for an earlier version of the bundle, aren't read again
+      if ([fi hasKnownSHA256]) reusedCount->fetch_add(1);
+
       SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] initWithFileInfo:fi];
       se.decision = SNTEventStateBundleBinary;
       se.fileBundlePath = event.fileBundlePath;
@@ -297,19 +310,47 @@
       se.fileBundleVersion = event.fileBundleVersion;
       se.fileBundleVersionString = event.fileBundleVersionString;
 
-      dispatch_sync(dispatch_get_main_queue(), ^{
-        relatedEvents[se.fileSHA256] = se;
-        p.completedUnitCount++;
-        if (progress) {
-          [[clientListener remoteObjectProxy] updateCountsForEvent:event
-                                                       binaryCount:fis.count
-                                                         fileCount:0
-                                                       hashedCount:i];
+      events->at(i) = se;
+      int64_t hashed = hashedCount->fetch_add(1) + 1;
+
+      // Only the worker that claims the next update slot reports progress
+      if (progress) {
+        uint64_t now = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+        uint64_t last = lastUpdateNanos->load(std::memory_order_relaxed);
+        if (now - last >= kProgressUpdateIntervalNanos &&
+            lastUpdateNanos->compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+          dispatch_async(dispatch_get_main_queue(), ^{
+            p.completedUnitCount = MAX(p.completedUnitCount, hashed);
+            [[clientListener remoteObjectProxy] updateCountsForEvent:event
+                                                         binaryCount:fis.count
+                                                           fileCount:0
+                                                         hashedCount:hashed];
+          });
         }
-      });
+      }
     }
   });
 
+  NSMutableDictionary* relatedEvents = [NSMutableDictionary dictionaryWithCapacity:fis.count];
+  for (SNTStoredExecutionEvent* se : *events) {
+    if (se) relatedEvents[se.fileSHA256] = se;
+  }
+
+  int64_t hashed = hashedCount->load();
+  int64_t reused = reusedCount->load();
+  LOGI(@"Hashed %lld binaries in bundle %@: %lld rehashed, %lld reused from cache", hashed,
+       event.fileBundlePath, hashed - reused, reused);
+
+  if (progress) {
+    dispatch_sync(dispatch_get_main_queue(), ^{
+      p.completedUnitCount = MAX(p.completedUnitCount, hashed);
+      [[clientListener remoteObjectProxy] updateCountsForEvent:event
+                                                   binaryCount:fis.count
+                                                     fileCount:0
+                                                   hashedCount:hashed];
+    });
+  }
+
   [progress resignCurrent];
 
   return relatedEvents;
@@ -102,6 +102,182 @@ static BOOL ReportClientCertificate(MOLCertificate* cert) {
   }
 }
 
+typedef NS_ENUM(NSInteger, SNTDoctorPerfSeverity) {
+  SNTDoctorPerfSeverityInfo,
+  SNTDoctorPerfSeverityWarning,
+  SNTDoctorPerfSeverityProblem,
+};
+
+// Sums, or takes the largest of, the data of every value of a metric whose fields match all
+// entries in `match`.
+static double AggregateMetric(NSDictionary* metrics, NSString* name,
+                              NSDictionary<NSString*, NSString*>* match, BOOL max) {
+  double result = 0;
+  NSDictionary* fieldSets = metrics[@"metrics"][name][@"fields"];
+  for (NSString* fieldNames in fieldSets) {
+    NSArray<NSString*>* names = [fieldNames componentsSeparatedByString:@","];
+    for (NSDictionary* value in fieldSets[fieldNames]) {
+      if (![value[@"data"] isKindOfClass:[NSNumber class]]) continue;
+      NSArray<NSString*>* values = [value[@"value"] componentsSeparatedByString:@","];
+
+      __block BOOL matches = YES;
+      [match enumerateKeysAndObjectsUsingBlock:^(NSString* field, NSString* want, BOOL* stop) {
+        NSUInteger idx = [names indexOfObject:field];
+        if (idx == NSNotFound || idx >= values.count || ![values[idx] isEqualToString:want]) {
+          matches = NO;
+          *stop = YES;
+        }
+      }];
+      if (!matches) continue;
+
+      double data = [value[@"data"] doubleValue];
+      result = max ? MAX(result, data) : result + data;
+    }
+  }
+  return result;
+}
+
+static NSDictionary* Finding(SNTDoctorPerfSeverity severity, double score, NSString* message) {
+  return @{@"severity" : @(severity), @"score" : @(score), @"message" : message};
+}
+
+// Turns the reply of performanceDiagnostics: into findings, most severe and most impactful first.
+// Each finding has a severity (SNTDoctorPerfSeverity), score and message. Exposed (non-static) so
+// it can be unit tested.
+NSArray<NSDictionary*>* SNTDoctorPerformanceFindings(NSDictionary* diagnostics) {
+  NSMutableArray<NSDictionary*>* findings = [NSMutableArray array];
+  NSDictionary* metrics = diagnostics[@"metrics"];
+  double uptime = [diagnostics[@"uptime_seconds"] doubleValue];
+
+  for (NSString* cache in @[ @"Root", @"NonRoot" ]) {
+    double evictions =
+        AggregateMetric(metrics, @"/santa/auth_result_cache/evictions", @{@"Cache" : cache}, NO);
+    if (uptime > 0 && evictions > 0 && uptime / evictions < 60) {
+      double interval = uptime / evictions;
+      [findings addObject:Finding(SNTDoctorPerfSeverityWarning, 60 / interval,
+                                  [NSString stringWithFormat:
+                                                @"AuthResultCache (%@) is evicting every %.1fs, "
+                                                @"its working set doesn't fit; raise its size",
+                                                cache, interval])];
+    }
+
+    double hits = AggregateMetric(metrics, @"/santa/auth_result_cache/lookups",
+                                  @{@"Cache" : cache, @"Result" : @"Hit"}, NO);
+    double misses = AggregateMetric(metrics, @"/santa/auth_result_cache/lookups",
+                                    @{@"Cache" : cache, @"Result" : @"Miss"}, NO);
+    if (hits + misses >= 1000 && hits / (hits + misses) < 0.5) {
+      [findings addObject:Finding(SNTDoctorPerfSeverityWarning, misses / (hits + misses),
+                                  [NSString stringWithFormat:
+                                                @"AuthResultCache (%@) hit ratio is only %.0f%% "
+                                                @"over %.0f lookups",
+                                                cache, 100 * hits / (hits + misses),
+                                                hits + misses])];
+    }
+  }
+
+  NSString* const budgetMetric = @"/santa/auth_response_remaining_budget";
+  double responses = AggregateMetric(metrics, budgetMetric, @{}, NO);
+  double expired = AggregateMetric(metrics, budgetMetric, @{@"Budget" : @"Expired"}, NO);
+  double close = AggregateMetric(metrics, budgetMetric, @{@"Budget" : @"<10ms"}, NO);
+  if (expired > 0) {
+    [findings addObject:Finding(SNTDoctorPerfSeverityProblem, expired,
+                                [NSString stringWithFormat:
+                                              @"%.0f AUTH responses (%.2f%%) missed their "
+                                              @"deadline and were decided by the kernel",
+                                              expired, 100 * expired / responses])];
+  }
+  if (close > 0) {
+    [findings addObject:Finding(SNTDoctorPerfSeverityWarning, close,
+                                [NSString stringWithFormat:
+                                              @"%.0f AUTH responses were sent with less than "
+                                              @"10ms left before their deadline",
+                                              close])];
+  }
+
+  double drops = AggregateMetric(metrics, @"/santa/event_drop_count", @{}, NO);
+  if (drops > 0) {
+    [findings addObject:Finding(SNTDoctorPerfSeverityWarning, drops,
+                                [NSString stringWithFormat:@"%.0f ES events were dropped before "
+                                                           @"santad could process them",
+                                                           drops])];
+  }
+
+  double authDepth = AggregateMetric(metrics, @"/santa/auth_queue/max_depth", @{}, YES);
+  if (authDepth > 64) {
+    [findings addObject:Finding(SNTDoctorPerfSeverityWarning, authDepth,
+                                [NSString stringWithFormat:@"AUTH queue reached a depth of %.0f; "
+                                                           @"consider setting AuthQueueShardCount",
+                                                           authDepth])];
+  }
+
+  double logDepth = AggregateMetric(metrics, @"/santa/logger/serialization_queue_depth", @{}, YES);
+  if (logDepth > 1000) {
+    [findings addObject:Finding(SNTDoctorPerfSeverityWarning, logDepth,
+                                [NSString stringWithFormat:
+                                              @"Telemetry serialization queue is %.0f events "
+                                              @"deep; logging can't keep up",
+                                              logDepth])];
+  }
+
+  double backlogAge =
+      AggregateMetric(metrics, @"/santa/logger/telemetry_export_backlog_age_seconds", @{}, YES);
+  if (backlogAge > 3600) {
+    [findings addObject:Finding(SNTDoctorPerfSeverityWarning, backlogAge / 3600,
+                                [NSString stringWithFormat:
+                                              @"Oldest unexported telemetry is %.1f hours old; "
+                                              @"check the export destination",
+                                              backlogAge / 3600])];
+  }
+
+  for (NSDictionary* latency in diagnostics[@"stage_latencies"]) {
+    double p99 = [latency[@"p99"] doubleValue] / NSEC_PER_MSEC;
+    if ([latency[@"count"] unsignedLongLongValue] >= 10 && p99 > 100) {
+      [findings addObject:Finding(SNTDoctorPerfSeverityWarning, p99,
+                                  [NSString stringWithFormat:
+                                                @"%@ %@ stage p99 latency is %.0fms (max %.0fms)",
+                                                latency[@"event"], latency[@"stage"], p99,
+                                                [latency[@"max"] doubleValue] / NSEC_PER_MSEC])];
+    }
+  }
+
+  NSDictionary* databases = diagnostics[@"databases"];
+  for (NSString* name in databases) {
+    double sizeMB = [databases[name][@"size"] doubleValue] / (1024 * 1024);
+    double freeRatio = [databases[name][@"free_page_ratio"] doubleValue];
+    if (sizeMB > 16 && freeRatio > 0.25) {
+      [findings addObject:Finding(SNTDoctorPerfSeverityWarning, sizeMB * freeRatio,
+                                  [NSString stringWithFormat:
+                                                @"%@ database is %.0fMB and %.0f%% free pages; "
+                                                @"it is fragmented and will be vacuumed when idle",
+                                                name, sizeMB, 100 * freeRatio])];
+    } else if (sizeMB > 512) {
+      [findings addObject:Finding(SNTDoctorPerfSeverityWarning, sizeMB / 512,
+                                  [NSString stringWithFormat:@"%@ database is large (%.0fMB)", name,
+                                                             sizeMB])];
+    }
+  }
+
+  NSUInteger slowReported = 0;
+  for (NSDictionary* eval in diagnostics[@"slowest_evaluations"]) {
+    double maxMS = [eval[@"max"] doubleValue] / NSEC_PER_MSEC;
+    double count = [eval[@"count"] doubleValue];
+    if (maxMS < 50 || count == 0 || slowReported++ >= 5) continue;
+    [findings addObject:Finding(SNTDoctorPerfSeverityInfo, maxMS,
+                                [NSString stringWithFormat:
+                                              @"Slow to evaluate: %@ (max %.0fms, avg %.0fms "
+                                              @"over %.0f evaluations)",
+                                              eval[@"path"], maxMS,
+                                              [eval[@"total"] doubleValue] / NSEC_PER_MSEC / count,
+                                              count])];
+  }
+
+  [findings sortUsingComparator:^NSComparisonResult(NSDictionary* a, NSDictionary* b) {
+    NSComparisonResult bySeverity = [b[@"severity"] compare:a[@"severity"]];
+    return bySeverity != NSOrderedSame ? bySeverity : [b[@"score"] compare:a[@"score"]];
+  }];
+  return findings;
+}
+
 // Returns YES if a user is logged in at the GUI console, NO otherwise.
 // When at the login screen (no user logged in), console user will be "loginwindow" with uid 0.
 BOOL IsConsoleUserLoggedIn() {
@@ -134,11 +310,18 @@ REGISTER_COMMAND_NAME(@"doctor")
          @"\n"
          @"Will exit with a non-zero exit code if any problems are found.\n"
          @"\n"
+         @"  Use --perf to instead collect performance diagnostics from the daemon and print\n"
+         @"  ranked findings, such as undersized caches and missed deadlines.\n"
+         @"\n"
          @"Note that this is intended to help debug support personnel issues which Santa is unable "
          @"to resolve itself.";
 }
 
 - (void)runWithArguments:(NSArray*)arguments {
+  if ([arguments containsObject:@"--perf"]) {
+    exit([self validatePerformance]);
+  }
+
   BOOL err = NO;
   err |= [self validateProcesses];
   err |= [self validateConfiguration];
@@ -239,6 +422,49 @@ REGISTER_COMMAND_NAME(@"doctor")
   [conn invalidate];
 }
 
+- (BOOL)validatePerformance {
+  print(@"=> Collecting performance diagnostics...");
+
+  MOLXPCConnection* conn = [SNTXPCControlInterface configuredConnection];
+  [conn resume];
+
+  __block NSDictionary* diagnostics;
+  [[conn synchronousRemoteObjectProxy] performanceDiagnostics:^(NSDictionary* reply) {
+    diagnostics = reply;
+  }];
+  [conn invalidate];
+
+  if (!diagnostics) {
+    print(@"[-] Failed to retrieve performance diagnostics from the daemon");
+    print(@"");
+    return YES;
+  }
+
+  BOOL err = NO;
+  NSArray<NSDictionary*>* findings = SNTDoctorPerformanceFindings(diagnostics);
+  for (NSDictionary* finding in findings) {
+    NSString* message = finding[@"message"];
+    switch ((SNTDoctorPerfSeverity)[finding[@"severity"] integerValue]) {
+      case SNTDoctorPerfSeverityProblem:
+        print(@"[-] %s", message.UTF8String);
+        err = YES;
+        break;
+      case SNTDoctorPerfSeverityWarning:
+        print(@"[?] %s", message.UTF8String);
+        err = YES;
+        break;
+      case SNTDoctorPerfSeverityInfo: print(@"[*] %s", message.UTF8String); break;
+    }
+  }
+
+  if (!err) {
+    print(@"[+] No performance problems detected");
+  }
+
+  print(@"");
+  return err;
+}
+
 - (void)didReceiveLog:(NSString*)log withType:(os_log_type_t)logType {
   print(@"    %s", log.UTF8String);
 }
@@ -25,6 +25,22 @@ typedef NS_ENUM(NSInteger, SNTDoctorClientCertValidity) {
 extern SNTDoctorClientCertValidity SNTDoctorClassifyClientCertificate(MOLCertificate* cert,
                                                                       NSDate* now);
 
+typedef NS_ENUM(NSInteger, SNTDoctorPerfSeverity) {
+  SNTDoctorPerfSeverityInfo,
+  SNTDoctorPerfSeverityWarning,
+  SNTDoctorPerfSeverityProblem,
+};
+extern NSArray<NSDictionary*>* SNTDoctorPerformanceFindings(NSDictionary* diagnostics);
+
+// Builds a metric in the shape exported by SNTMetricSet
+static NSDictionary* Metric(NSString* fieldNames, NSDictionary<NSString*, NSNumber*>* values) {
+  NSMutableArray* fields = [NSMutableArray array];
+  [values enumerateKeysAndObjectsUsingBlock:^(NSString* value, NSNumber* data, BOOL* stop) {
+    [fields addObject:@{@"value" : value, @"data" : data}];
+  }];
+  return @{@"fields" : @{fieldNames : fields}};
+}
+
 @interface SNTCommandDoctorTest : XCTestCase
 @end
 
@@ -71,4 +87,51 @@ extern SNTDoctorClientCertValidity SNTDoctorClassifyClientCertificate(MOLCertifi
                  SNTDoctorClientCertValidityValid);
 }
 
+- (void)testHealthyDaemonHasNoFindings {
+  NSDictionary* diagnostics = @{
+    @"uptime_seconds" : @(3600),
+    @"metrics" : @{
+      @"metrics" : @{
+        @"/santa/auth_result_cache/evictions" : Metric(@"Cache", @{@"Root" : @(10)}),
+        @"/santa/auth_result_cache/lookups" :
+            Metric(@"Cache,Result", @{@"Root,Hit" : @(9000), @"Root,Miss" : @(1000)}),
+      },
+    },
+    @"databases" : @{@"Rules" : @{@"size" : @(1024 * 1024), @"free_page_ratio" : @(0.5)}},
+  };
+  XCTAssertEqual(SNTDoctorPerformanceFindings(diagnostics).count, 0);
+}
+
+- (void)testFindingsAreRanked {
+  NSDictionary* diagnostics = @{
+    @"uptime_seconds" : @(400),
+    @"metrics" : @{
+      @"metrics" : @{
+        @"/santa/auth_result_cache/evictions" : Metric(@"Cache", @{@"Root" : @(10)}),
+        @"/santa/auth_response_remaining_budget" : Metric(
+            @"Processor,Event,Budget",
+            @{@"Authorizer,AuthExec,Expired" : @(2), @"Authorizer,AuthExec,<1s" : @(998)}),
+      },
+    },
+    @"slowest_evaluations" : @[
+      @{@"path" : @"/usr/bin/slow", @"count" : @(2), @"max" : @(300 * NSEC_PER_MSEC),
+        @"total" : @(400 * NSEC_PER_MSEC)},
+      @{@"path" : @"/usr/bin/fast", @"count" : @(1), @"max" : @(NSEC_PER_MSEC),
+        @"total" : @(NSEC_PER_MSEC)},
+    ],
+  };
+
+  NSArray<NSDictionary*>* findings = SNTDoctorPerformanceFindings(diagnostics);
+  XCTAssertEqual(findings.count, 3);
+
+  XCTAssertEqual([findings[0][@"severity"] integerValue], SNTDoctorPerfSeverityProblem);
+  XCTAssertTrue([findings[0][@"message"] containsString:@"2 AUTH responses (0.20%)"]);
+
+  XCTAssertEqual([findings[1][@"severity"] integerValue], SNTDoctorPerfSeverityWarning);
+  XCTAssertTrue([findings[1][@"message"] containsString:@"evicting every 40.0s"]);
+
+  XCTAssertEqual([findings[2][@"severity"] integerValue], SNTDoctorPerfSeverityInfo);
+  XCTAssertTrue([findings[2][@"message"] containsString:@"/usr/bin/slow"]);
+}
+
 @end
@@ -20,6 +20,7 @@
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/MOLXPCConnection.h"
+#include "Source/common/ParallelFileWalker.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTFileInfo.h"
@@ -93,6 +94,7 @@ NSString* formattedStringForKeyArray(NSArray<NSString*>* array) {
 // Properties set from commandline flags
 @property(nonatomic) BOOL recursive;
 @property(nonatomic) BOOL jsonOutput;
+@property(nonatomic) BOOL ndjsonOutput;
 @property(nonatomic) BOOL bundleInfo;
 @property(nonatomic) BOOL enableEntitlements;
 @property(nonatomic) BOOL filterInclusive;
@@ -188,8 +190,10 @@ REGISTER_COMMAND_NAME(@"fileinfo")
           @"\n"
           @"Usage: santactl fileinfo [options] [file-paths]\n"
           @"    --recursive (-r): Search directories recursively.\n"
+          @"                      Only Mach-O files are shown.\n"
           @"                      Incompatible with --bundleinfo.\n"
           @"    --json: Output in JSON format.\n"
+          @"    --ndjson: Output one JSON object per line as each file is processed.\n"
           @"    --key: Search and return this one piece of information.\n"
           @"           You may specify multiple keys by repeating this flag.\n"
           @"           Valid Keys:\n"
@@ -714,7 +718,7 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   // For consistency, JSON output is always returned as an array of file info objects, regardless of
   // how many file info objects are being outputted.  So both empty and singleton result sets are
   // still enclosed in brackets.
-  if (self.jsonOutput) printf("[\n");
+  if (self.jsonOutput && !self.ndjsonOutput) printf("[\n");
 
   NSFileManager* fm = [NSFileManager defaultManager];
   NSString* cwd = [fm currentDirectoryPath];
@@ -734,7 +738,8 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   // Wait for all tasks in print queue to complete.
   dispatch_group_wait(self.printGroup, DISPATCH_TIME_FOREVER);
 
-  if (self.jsonOutput) printf("\n]\n");  // print closing bracket of JSON output array
+  // print closing bracket of JSON output array
+  if (self.jsonOutput && !self.ndjsonOutput) printf("\n]\n");
 
   exit(0);
 }
@@ -790,20 +795,18 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   operationQueue.maxConcurrentOperationCount = 2;
 
   if (isDir && self.recursive) {
-    NSDirectoryEnumerator* dirEnum = [fm enumeratorAtPath:path];
-    NSString* file = [dirEnum nextObject];
-    while (file) {
+    // The walker reads directories and skips non-Mach-O files on its own workers, and each worker
+    // prints the files it finds. Its thread count also caps in-flight requests to the daemon, so
+    // it is kept at the same limit as the operation queue.
+    santa::ParallelFileWalker::Options options;
+    options.max_threads = operationQueue.maxConcurrentOperationCount;
+    options.max_open_files = options.max_threads;
+    options.macho_only = true;
+    santa::ParallelFileWalker::Walk({path.UTF8String}, options, ^(const std::string& filepath) {
       @autoreleasepool {
-        NSString* filepath = [path stringByAppendingPathComponent:file];
-        BOOL exists = [fm fileExistsAtPath:filepath isDirectory:&isDir];
-        if (!(exists && isDir)) {  // don't display anything for a directory path
-          [operationQueue addOperationWithBlock:^{
-            [self printInfoForFile:filepath];
-          }];
-        }
-        file = [dirEnum nextObject];
+        [self printInfoForFile:@(filepath.c_str())];
       }
-    }
+    });
   } else if (isDir && !isBundle) {
     dispatch_group_async(self.printGroup, self.printQueue, ^{
       TEE_LOGE(@"%@ is a directory.  Use the -r flag to search recursively.", path);
@@ -968,7 +971,9 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   BOOL singleKey =
       (self.outputKeyList.count == 1 && ![self.outputKeyList.firstObject isEqual:kSigningChain]);
   NSMutableString* output = [NSMutableString string];
-  if (self.jsonOutput) {
+  if (self.ndjsonOutput) {
+    [output appendString:[self jsonLineForDictionary:outputDict]];
+  } else if (self.jsonOutput) {
     [output appendString:[self jsonStringForDictionary:outputDict]];
   } else {
     for (NSString* key in self.outputKeyList) {
@@ -998,6 +1003,16 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
     if (!singleKey) [output appendString:@"\n"];
   }
 
+  if (self.ndjsonOutput) {
+    // Each record is written and flushed before the worker moves on to the next file so that
+    // output appears incrementally and finished records don't pile up waiting to be printed.
+    dispatch_sync(self.printQueue, ^{
+      printf("%s", output.UTF8String);
+      fflush(stdout);
+    });
+    return;
+  }
+
   dispatch_group_async(self.printGroup, self.printQueue, ^{
     if (self.jsonOutput) {  // print commas between JSON entries
       if (self.jsonPreviousEntry) printf(",\n");
@@ -1010,6 +1025,7 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
 // Parses the arguments in order to set the property variables:
 //   self.recursive from --recursive or -r
 //   self.json from --json
+//   self.ndjson from --ndjson
 //   self.certIndex from --cert-index argument
 //   self.outputKeyList from multiple possible --key arguments
 //   self.outputFilters from multiple possible --filter arguments
@@ -1023,6 +1039,9 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
     NSString* arg = [arguments objectAtIndex:i];
     if ([arg caseInsensitiveCompare:@"--json"] == NSOrderedSame) {
       self.jsonOutput = YES;
+    } else if ([arg caseInsensitiveCompare:@"--ndjson"] == NSOrderedSame) {
+      self.jsonOutput = YES;
+      self.ndjsonOutput = YES;
     } else if ([arg caseInsensitiveCompare:@"--cert-index"] == NSOrderedSame) {
       if (self.bundleInfo) {
         [self printErrorUsageAndExit:@"\n--cert-index is incompatible with --bundleinfo"];
@@ -1158,6 +1177,13 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   return [[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding];
 }
 
+- (NSString*)jsonLineForDictionary:(NSDictionary*)dict {
+  NSData* jsonData = [NSJSONSerialization dataWithJSONObject:dict options:0 error:NULL];
+  if (!jsonData) return @"";
+  return [[[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding]
+      stringByAppendingString:@"\n"];
+}
+
 - (NSString*)stringForSigningChain:(NSArray*)signingChain key:(NSString*)key {
   if (!signingChain) return @"";
   NSMutableString* result = [NSMutableString string];
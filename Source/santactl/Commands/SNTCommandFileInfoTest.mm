@@ -25,6 +25,7 @@
 typedef id (^SNTAttributeBlock)(SNTCommandFileInfo*, SNTFileInfo*);
 @property(nonatomic) BOOL recursive;
 @property(nonatomic) BOOL jsonOutput;
+@property(nonatomic) BOOL ndjsonOutput;
 @property(nonatomic) BOOL filterInclusive;
 @property(nonatomic) NSNumber* certIndex;
 @property(nonatomic, copy) NSArray<NSString*>* outputKeyList;
@@ -95,6 +96,13 @@ typedef id (^SNTAttributeBlock)(SNTCommandFileInfo*, SNTFileInfo*);
   XCTAssertTrue([filePaths containsObject:@"/usr/bin/yes"]);
 }
 
+- (void)testParseArgumentsNDJSON {
+  NSArray* filePaths = [self.cfi parseArguments:@[ @"--ndjson", @"/usr/bin/yes" ]];
+  XCTAssertTrue(self.cfi.jsonOutput);
+  XCTAssertTrue(self.cfi.ndjsonOutput);
+  XCTAssertTrue([filePaths containsObject:@"/usr/bin/yes"]);
+}
+
 - (void)testParseArgumentsFilePaths {
   NSArray* args = @[
     @"/usr/bin/yes", @"/bin/mv", @"--key", @"SHA-256", @"/bin/ls", @"--json", @"/bin/rm",
@@ -14,8 +14,10 @@
 /// limitations under the License.
 
 #import <Foundation/Foundation.h>
+#include <time.h>
 
 #import "Source/common/MOLXPCConnection.h"
+#include "Source/common/MetricSnapshot.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
@@ -45,7 +47,37 @@ REGISTER_COMMAND_NAME(@"metrics")
   return (@"Provides metrics about Santa's operation while it's running.\n"
           @"Pass prefixes to filter list of metrics, if desired.\n"
           @"  Use --json to output in JSON format\n"
-          @"  Use --export to trigger an immediate metric export");
+          @"  Use --export to trigger an immediate metric export\n"
+          @"  Use --live to ask santad even when MetricSnapshotIntervalSec is set");
+}
+
+// Returns the metrics santad last published to shared memory, or nil if snapshots are disabled
+// or the latest one is stale, e.g. because santad isn't running
+- (NSDictionary*)metricsFromSnapshot {
+  std::unique_ptr<santa::MetricSnapshotReader> reader =
+      santa::MetricSnapshotReader::Open(santa::kMetricSnapshotName, 0);
+  if (!reader) {
+    return nil;
+  }
+
+  std::optional<santa::MetricSnapshot> snapshot = reader->Read();
+  if (!snapshot) {
+    return nil;
+  }
+
+  int64_t age = (int64_t)clock_gettime_nsec_np(CLOCK_REALTIME) - snapshot->published_at_ns;
+  if (age > (int64_t)(2 * snapshot->interval_ns + NSEC_PER_SEC)) {
+    return nil;
+  }
+
+  NSData* data = [NSData dataWithBytesNoCopy:snapshot->payload.data()
+                                      length:snapshot->payload.size()
+                                freeWhenDone:NO];
+  id metrics = [NSPropertyListSerialization propertyListWithData:data
+                                                         options:NSPropertyListImmutable
+                                                          format:nil
+                                                           error:nil];
+  return [metrics isKindOfClass:[NSDictionary class]] ? metrics : nil;
 }
 
 - (void)prettyPrintRootLabels:(NSDictionary*)rootLabels {
@@ -57,6 +89,28 @@ REGISTER_COMMAND_NAME(@"metrics")
   }
 }
 
+// Summarize a histogram value as its count and mean followed by the count in each bucket,
+// e.g. "count=4 mean=2.5 [<1: 1, <5: 2, >=5: 1]".
+- (NSString*)describeDistribution:(NSDictionary*)distribution {
+  NSArray<NSNumber*>* bounds = distribution[@"bucket_bounds"];
+  NSArray<NSNumber*>* counts = distribution[@"bucket_counts"];
+
+  NSMutableArray<NSString*>* buckets = [NSMutableArray arrayWithCapacity:counts.count];
+  for (NSUInteger i = 0; i < counts.count; i++) {
+    if (i < bounds.count) {
+      [buckets addObject:[NSString stringWithFormat:@"<%@: %@", bounds[i], counts[i]]];
+    } else if (bounds.count) {
+      [buckets addObject:[NSString stringWithFormat:@">=%@: %@", bounds.lastObject, counts[i]]];
+    } else {
+      [buckets addObject:[NSString stringWithFormat:@"%@", counts[i]]];
+    }
+  }
+
+  return [NSString stringWithFormat:@"count=%@ mean=%@ [%@]", distribution[@"count"],
+                                    distribution[@"mean"],
+                                    [buckets componentsJoinedByString:@", "]];
+}
+
 - (void)prettyPrintMetricValues:(NSDictionary*)metrics {
   for (NSString* metricName in metrics) {
     NSDictionary* metric = metrics[metricName];
@@ -65,6 +119,7 @@ REGISTER_COMMAND_NAME(@"metrics")
     NSString* metricType = SNTMetricMakeStringFromMetricType(
         static_cast<SNTMetricType>([metric[@"type"] integerValue]));
     const char* metricTypeStr = [metricType UTF8String];
+    BOOL isHistogram = [metric[@"type"] integerValue] == SNTMetricTypeHistogram;
 
     printf("  %-25s | %s\n", "Metric Name", metricNameStr);
     printf("  %-25s | %s\n", "Description", description);
@@ -74,7 +129,9 @@ REGISTER_COMMAND_NAME(@"metrics")
       for (NSDictionary* field in metric[@"fields"][fieldName]) {
         const char* createdStr = [field[@"created"] UTF8String];
         const char* lastUpdatedStr = [field[@"last_updated"] UTF8String];
-        const char* data = [[NSString stringWithFormat:@"%@", field[@"data"]] UTF8String];
+        NSString* dataString = isHistogram ? [self describeDistribution:field[@"data"]]
+                                           : [NSString stringWithFormat:@"%@", field[@"data"]];
+        const char* data = [dataString UTF8String];
 
         NSArray<NSString*>* fields = [fieldName componentsSeparatedByString:@","];
         NSArray<NSString*>* fieldValues = [field[@"value"] componentsSeparatedByString:@","];
@@ -182,10 +239,15 @@ REGISTER_COMMAND_NAME(@"metrics")
   }
 
   __block NSDictionary* metrics;
+  if (![arguments containsObject:@"--live"]) {
+    metrics = [self metricsFromSnapshot];
+  }
 
-  [[self.daemonConn synchronousRemoteObjectProxy] metrics:^(NSDictionary* exportedMetrics) {
-    metrics = exportedMetrics;
-  }];
+  if (!metrics) {
+    [[self.daemonConn synchronousRemoteObjectProxy] metrics:^(NSDictionary* exportedMetrics) {
+      metrics = exportedMetrics;
+    }];
+  }
 
   metrics = [self filterMetrics:metrics withArguments:arguments];
 
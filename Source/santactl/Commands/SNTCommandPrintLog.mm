@@ -14,45 +14,231 @@
 /// limitations under the License.
 
 #import <Foundation/Foundation.h>
+#include <fcntl.h>
+#include <fnmatch.h>
 #include <google/protobuf/json/json.h>
+#include <libkern/OSByteOrder.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
-#import "Source/common/NSData+Zlib.h"
+#import "Source/common/SNTConfigurator.h"
 #include "Source/common/SNTLogging.h"
 #import "Source/common/SNTXxhash.h"
-#include "Source/common/ScopedFile.h"
 #include "Source/common/santa.pb.h"
 #import "Source/santactl/SNTCommand.h"
 #import "Source/santactl/SNTCommandController.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/BatchIndex.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdInputStream.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto.pb.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/time/time.h"
 #include "google/protobuf/any.pb.h"
 #include "google/protobuf/io/coded_stream.h"
-#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/io/gzip_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd.h"
 
 using JsonPrintOptions = google::protobuf::json::PrintOptions;
 using google::protobuf::json::MessageToJsonString;
-using santa::ScopedFile;
+using santa::fsspool::binaryproto::ColumnarBatch;
 using santa::fsspool::binaryproto::LogBatch;
 namespace pbv1 = ::santa::pb::v1;
 
-// Semi-arbitrary max compressed file size that will be operated upon.
-// The current implementation decompresses in memory. This variable
-// is used to keep memory requirements semi-reasonable.
-static constexpr size_t kMaxCompressedSize = 1024 * 1024 * 250;
+// Read-only mapping of an entire log file. Pages are only read from disk as
+// decoding reaches them and can be dropped again by the kernel afterwards,
+// so large files don't need to fit in memory.
+class MappedFile {
+ public:
+  static absl::StatusOr<std::unique_ptr<MappedFile>> Open(NSString* path) {
+    int fd = open(path.UTF8String, O_RDONLY);
+    if (fd < 0) {
+      return absl::InvalidArgumentError("Failed to open file");
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) {
+      close(fd);
+      return absl::ErrnoToStatus(errno, "Unable to stat file");
+    }
+
+    // Empty files cannot be mapped
+    if (sb.st_size == 0) {
+      close(fd);
+      return std::make_unique<MappedFile>(nullptr, 0);
+    }
+
+    void* data = mmap(nullptr, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      return absl::ErrnoToStatus(errno, "Failed to map file");
+    }
+
+    madvise(data, (size_t)sb.st_size, MADV_SEQUENTIAL);
+    return std::make_unique<MappedFile>((const uint8_t*)data, (size_t)sb.st_size);
+  }
+
+  MappedFile(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  ~MappedFile() {
+    if (data_) {
+      munmap((void*)data_, size_);
+    }
+  }
+
+  // Not copyable
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+};
+
+// Selects which records are printed. The event type and time are checked
+// against the serialized record, so records filtered by them are skipped
+// without being parsed. The pid and path filters need the parsed message.
+class MessageFilter {
+ public:
+  // Event field numbers to keep, empty to keep all
+  absl::flat_hash_set<uint32_t> event_types;
+  std::optional<int64_t> since_ns;
+  std::optional<int32_t> pid;
+  std::optional<std::string> path_glob;
+
+  bool MatchesSerialized(const uint8_t* data, size_t size) const {
+    if (event_types.empty() && !since_ns.has_value()) {
+      return true;
+    }
+
+    uint32_t event_type;
+    int64_t event_time_ns;
+    if (!::fsspool::ReadIndexFields(data, size, &event_type, &event_time_ns)) {
+      // Malformed records are left to fail parsing so that the error is reported
+      return true;
+    }
+
+    return MatchesFields(event_type, event_time_ns);
+  }
+
+  bool MatchesFields(uint32_t event_type, int64_t event_time_ns) const {
+    if (!event_types.empty() && !event_types.contains(event_type)) {
+      return false;
+    }
+
+    return !since_ns.has_value() || event_time_ns >= *since_ns;
+  }
+
+  bool NeedsMessage() const { return pid.has_value() || path_glob.has_value(); }
+
+  bool MatchesMessage(const pbv1::SantaMessage& msg) const {
+    const google::protobuf::Reflection* reflection = msg.GetReflection();
+    const google::protobuf::FieldDescriptor* event_field = reflection->GetOneofFieldDescriptor(
+        msg, pbv1::SantaMessage::descriptor()->FindOneofByName("event"));
+    if (!event_field) {
+      return false;
+    }
+
+    const google::protobuf::Message& event = reflection->GetMessage(msg, event_field);
+    if (pid.has_value() && !EventHasPid(event)) {
+      return false;
+    }
+
+    return !path_glob.has_value() || HasMatchingPath(event, 0);
+  }
+
+ private:
+  // Deep enough for paths nested within an event's process and file info
+  static constexpr int kMaxPathSearchDepth = 6;
+
+  // Checks processes directly described by the event, e.g. the instigator
+  // and an exec target or fork child
+  bool EventHasPid(const google::protobuf::Message& event) const {
+    const google::protobuf::Reflection* reflection = event.GetReflection();
+    std::vector<const google::protobuf::FieldDescriptor*> fields;
+    reflection->ListFields(event, &fields);
+
+    for (const google::protobuf::FieldDescriptor* field : fields) {
+      if (field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE ||
+          field->is_repeated()) {
+        continue;
+      }
+
+      const google::protobuf::Message& process = reflection->GetMessage(event, field);
+      const google::protobuf::FieldDescriptor* id_field =
+          process.GetDescriptor()->FindFieldByName("id");
+      if (!id_field || id_field->message_type() != pbv1::ProcessID::descriptor() ||
+          !process.GetReflection()->HasField(process, id_field)) {
+        continue;
+      }
+
+      const google::protobuf::Message& id = process.GetReflection()->GetMessage(process, id_field);
+      const google::protobuf::FieldDescriptor* pid_field =
+          pbv1::ProcessID::descriptor()->FindFieldByName("pid");
+      if (id.GetReflection()->GetInt32(id, pid_field) == *pid) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool HasMatchingPath(const google::protobuf::Message& msg, int depth) const {
+    const google::protobuf::Descriptor* descriptor = msg.GetDescriptor();
+    const google::protobuf::Reflection* reflection = msg.GetReflection();
+
+    if (descriptor == pbv1::FileInfo::descriptor() ||
+        descriptor == pbv1::FileInfoLight::descriptor()) {
+      std::string path = reflection->GetString(msg, descriptor->FindFieldByName("path"));
+      return fnmatch(path_glob->c_str(), path.c_str(), 0) == 0;
+    }
+
+    if (depth >= kMaxPathSearchDepth) {
+      return false;
+    }
+
+    std::vector<const google::protobuf::FieldDescriptor*> fields;
+    reflection->ListFields(msg, &fields);
+    for (const google::protobuf::FieldDescriptor* field : fields) {
+      if (field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+        continue;
+      }
+
+      if (field->is_repeated()) {
+        for (int i = 0; i < reflection->FieldSize(msg, field); i++) {
+          if (HasMatchingPath(reflection->GetRepeatedMessage(msg, field, i), depth + 1)) {
+            return true;
+          }
+        }
+      } else if (HasMatchingPath(reflection->GetMessage(msg, field), depth + 1)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+};
 
 class MessageSource {
  public:
@@ -66,41 +252,55 @@ class MessageSource {
   MessageSource(const MessageSource&) = delete;
   MessageSource& operator=(const MessageSource&) = delete;
 
-  virtual absl::StatusOr<::pbv1::SantaMessage> Next() = 0;
+  // Returns the next record matching `filter`
+  virtual absl::StatusOr<::pbv1::SantaMessage> Next(const MessageFilter& filter) = 0;
 
  protected:
-  MessageSource(ScopedFile scoped_file) : scoped_file_(std::move(scoped_file)) {}
+  MessageSource(std::unique_ptr<MappedFile> mapped_file) : mapped_file_(std::move(mapped_file)) {}
+
+  const MappedFile& mapped_file() const { return *mapped_file_; }
 
  private:
-  ScopedFile scoped_file_;
+  std::unique_ptr<MappedFile> mapped_file_;
 };
 
 class AnyMessageSource : public MessageSource {
  public:
-  static std::unique_ptr<AnyMessageSource> Create(ScopedFile scoped_file) {
+  static std::unique_ptr<AnyMessageSource> Create(std::unique_ptr<MappedFile> mapped_file) {
     LogBatch batch;
-    if (!batch.ParseFromFileDescriptor(scoped_file.UnsafeFD())) {
+    if (!batch.ParseFromArray(mapped_file->data(), (int)mapped_file->size())) {
       return nullptr;
     }
 
-    return std::make_unique<AnyMessageSource>(std::move(scoped_file), std::move(batch));
+    return std::make_unique<AnyMessageSource>(std::move(mapped_file), std::move(batch));
   }
 
-  AnyMessageSource(ScopedFile scoped_file, LogBatch batch)
-      : MessageSource(std::move(scoped_file)), batch_(std::move(batch)), current_index_(0) {}
+  AnyMessageSource(std::unique_ptr<MappedFile> mapped_file, LogBatch batch)
+      : MessageSource(std::move(mapped_file)), batch_(std::move(batch)), current_index_(0) {}
 
-  absl::StatusOr<::pbv1::SantaMessage> Next() override {
-    // Check if we've reached the end of the batch
-    if (current_index_ >= static_cast<size_t>(batch_.records_size())) {
-      return absl::OutOfRangeError("No more data");
-    }
+  absl::StatusOr<::pbv1::SantaMessage> Next(const MessageFilter& filter) override {
+    while (true) {
+      // Check if we've reached the end of the batch
+      if (current_index_ >= static_cast<size_t>(batch_.records_size())) {
+        return absl::OutOfRangeError("No more data");
+      }
 
-    ::pbv1::SantaMessage santa_msg;
-    if (!santa_msg.ParseFromString(batch_.records(current_index_++).value())) {
-      return absl::InternalError("Failed to parse Any proto");
-    }
+      const std::string& value = batch_.records(current_index_++).value();
+      if (!filter.MatchesSerialized((const uint8_t*)value.data(), value.size())) {
+        continue;
+      }
 
-    return santa_msg;
+      ::pbv1::SantaMessage santa_msg;
+      if (!santa_msg.ParseFromString(value)) {
+        return absl::InternalError("Failed to parse Any proto");
+      }
+
+      if (filter.NeedsMessage() && !filter.MatchesMessage(santa_msg)) {
+        continue;
+      }
+
+      return santa_msg;
+    }
   }
 
  private:
@@ -108,208 +308,365 @@ class AnyMessageSource : public MessageSource {
   int current_index_;
 };
 
-class StreamMessageSource : public MessageSource {
+class ColumnarMessageSource : public MessageSource {
  public:
-  static std::unique_ptr<StreamMessageSource> Create(ScopedFile scoped_file) {
-    auto file_input =
-        std::make_unique<google::protobuf::io::FileInputStream>(scoped_file.UnsafeFD());
-    auto coded_input = std::make_unique<google::protobuf::io::CodedInputStream>(file_input.get());
+  static std::unique_ptr<ColumnarMessageSource> Create(std::unique_ptr<MappedFile> mapped_file) {
+    auto batch = std::make_unique<ColumnarBatch>();
+    if (!batch->ParseFromArray(mapped_file->data(), (int)mapped_file->size())) {
+      return nullptr;
+    }
 
-    return std::unique_ptr<StreamMessageSource>(new StreamMessageSource(
-        std::move(scoped_file), std::move(file_input), std::move(coded_input)));
+    return std::make_unique<ColumnarMessageSource>(std::move(mapped_file), std::move(batch));
   }
 
-  StreamMessageSource(ScopedFile scoped_file,
-                      std::unique_ptr<google::protobuf::io::FileInputStream> file_input,
-                      std::unique_ptr<google::protobuf::io::CodedInputStream> coded_input)
-      : MessageSource(std::move(scoped_file)),
-        file_input_(std::move(file_input)),
-        coded_input_(std::move(coded_input)) {}
+  ColumnarMessageSource(std::unique_ptr<MappedFile> mapped_file,
+                        std::unique_ptr<ColumnarBatch> batch)
+      : MessageSource(std::move(mapped_file)), batch_(std::move(batch)), reader_(*batch_) {}
 
-  absl::StatusOr<::pbv1::SantaMessage> Next() override {
-    // Check the magic value
-    // Failing to read the first value indicates we're at the end of a file.
-    uint32_t magic;
-    if (!coded_input_->ReadLittleEndian32(&magic)) {
-      return absl::OutOfRangeError("No more data");
-    }
-    if (magic != ::fsspool::kStreamBatcherMagic) {
-      return absl::InternalError("Invalid magic value");
-    }
+  absl::StatusOr<::pbv1::SantaMessage> Next(const MessageFilter& filter) override {
+    while (true) {
+      absl::StatusOr<::pbv1::SantaMessage> santa_msg = reader_.Next();
+      if (!santa_msg.ok()) {
+        return santa_msg;
+      }
 
-    // Check the hash
-    uint64_t expected_hash;
-    if (!coded_input_->ReadRaw(&expected_hash, sizeof(expected_hash))) {
-      return absl::InternalError("Failed to parse hash data");
-    }
+      int64_t event_time_ns = santa_msg->event_time().seconds() * NSEC_PER_SEC +
+                              santa_msg->event_time().nanos();
+      if (!filter.MatchesFields(santa_msg->event_case(), event_time_ns) ||
+          (filter.NeedsMessage() && !filter.MatchesMessage(*santa_msg))) {
+        continue;
+      }
 
-    // Read the length
-    uint32_t message_length;
-    if (!coded_input_->ReadVarint32(&message_length)) {
-      return absl::InternalError("Failed to parse message length");
+      return santa_msg;
     }
+  }
 
-    // Read the raw message data
-    std::vector<uint8_t> msg_buf(message_length);
-    if (!coded_input_->ReadRaw(msg_buf.data(), message_length)) {
-      return absl::InternalError("Failed to read message into buffer");
+ private:
+  std::unique_ptr<ColumnarBatch> batch_;
+  ::fsspool::ColumnarBatchReader reader_;
+};
+
+class StreamMessageSource : public MessageSource {
+ public:
+  // Returns the state of the decompressor once the end of the input is reached
+  using InputStatus = std::function<absl::Status()>;
+
+  // Reads records from the mapped file, decompressed by the stream returned
+  // by `decompress`, if given.
+  static absl::StatusOr<std::unique_ptr<StreamMessageSource>> Create(
+      std::unique_ptr<MappedFile> mapped_file,
+      std::function<std::unique_ptr<google::protobuf::io::ZeroCopyInputStream>(
+          google::protobuf::io::ZeroCopyInputStream*, InputStatus*)>
+          decompress = nullptr) {
+    auto raw_input = std::make_unique<google::protobuf::io::ArrayInputStream>(
+        mapped_file->data(), (int)mapped_file->size());
+
+    std::unique_ptr<google::protobuf::io::ZeroCopyInputStream> decompressed_input;
+    InputStatus input_status = [] {
+      return absl::OkStatus();
+    };
+    if (decompress) {
+      decompressed_input = decompress(raw_input.get(), &input_status);
+      if (!decompressed_input) {
+        return absl::InternalError("Failed to create decompression stream");
+      }
     }
 
-    if (expected_hash != 0) {
-      santa::Xxhash64 xxhash;
-      xxhash.Update(msg_buf.data(), msg_buf.size());
-      __block uint64_t got_hash;
-      xxhash.Digest(^(const uint8_t* buf, size_t size) {
-        got_hash = *(uint64_t*)buf;
-      });
+    return std::unique_ptr<StreamMessageSource>(
+        new StreamMessageSource(std::move(mapped_file), std::move(raw_input),
+                                std::move(decompressed_input), std::move(input_status)));
+  }
 
-      if (got_hash != expected_hash) {
-        return absl::InternalError("Message corruption detected");
+  absl::StatusOr<::pbv1::SantaMessage> Next(const MessageFilter& filter) override {
+    while (true) {
+      uint64_t expected_hash;
+      if (absl::Status status = ReadRecordHeader(&expected_hash); !status.ok()) {
+        return status;
       }
-    }
 
-    ::pbv1::SantaMessage santa_msg;
-    if (!santa_msg.ParseFromArray(msg_buf.data(), (int)msg_buf.size())) {
-      return absl::InternalError("Failed to parse message data");
-    }
+      // Read the length
+      uint32_t message_length;
+      if (!coded_input_->ReadVarint32(&message_length)) {
+        return absl::InternalError("Failed to parse message length");
+      }
 
-    return santa_msg;
-  }
+      // Read the raw message data
+      msg_buf_.resize(message_length);
+      if (!coded_input_->ReadRaw(msg_buf_.data(), message_length)) {
+        return absl::InternalError("Failed to read message into buffer");
+      }
 
- private:
-  std::unique_ptr<google::protobuf::io::FileInputStream> file_input_;
-  std::unique_ptr<google::protobuf::io::CodedInputStream> coded_input_;
-};
+      if (!filter.MatchesSerialized(msg_buf_.data(), msg_buf_.size())) {
+        continue;
+      }
 
-absl::Status CanProcessFile(const ScopedFile& scoped_file) {
-  struct stat sb;
-  if (fstat(scoped_file.UnsafeFD(), &sb) != 0) {
-    return absl::ErrnoToStatus(errno, "Unable to stat file");
-  }
+      if (expected_hash != 0) {
+        santa::Xxhash64 xxhash;
+        xxhash.Update(msg_buf_.data(), msg_buf_.size());
+        __block uint64_t got_hash;
+        xxhash.Digest(^(const uint8_t* buf, size_t size) {
+          got_hash = *(uint64_t*)buf;
+        });
 
-  if (sb.st_size > kMaxCompressedSize) {
-    return absl::OutOfRangeError(absl::StrFormat(
-        "Compressed file too large. Please decompress first. (Max allowed compressed size: %zu",
-        kMaxCompressedSize));
-  }
+        if (got_hash != expected_hash) {
+          return absl::InternalError("Message corruption detected");
+        }
+      }
 
-  return absl::OkStatus();
-}
+      ::pbv1::SantaMessage santa_msg;
+      if (!santa_msg.ParseFromArray(msg_buf_.data(), (int)msg_buf_.size())) {
+        return absl::InternalError("Failed to parse message data");
+      }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> CreateStreamSource(NSData* buffer) {
-  auto temp_file = santa::ScopedFile::CreateTemporary();
-  if (!temp_file.ok()) {
-    return temp_file.status();
-  }
+      if (filter.NeedsMessage() && !filter.MatchesMessage(santa_msg)) {
+        continue;
+      }
 
-  NSFileHandle* temp_handle = temp_file->Writer();
-  NSError* err;
-  if (![temp_handle writeData:buffer error:&err]) {
-    return absl::InternalError(absl::StrFormat("Failed to write decompressed data to temp file: %s",
-                                               err.localizedDescription.UTF8String));
+      return santa_msg;
+    }
   }
 
-  // Reset back to the beginning for reading
-  [temp_handle seekToFileOffset:0];
+ private:
+  StreamMessageSource(
+      std::unique_ptr<MappedFile> mapped_file,
+      std::unique_ptr<google::protobuf::io::ZeroCopyInputStream> raw_input,
+      std::unique_ptr<google::protobuf::io::ZeroCopyInputStream> decompressed_input,
+      InputStatus input_status)
+      : MessageSource(std::move(mapped_file)),
+        raw_input_(std::move(raw_input)),
+        decompressed_input_(std::move(decompressed_input)),
+        input_status_(std::move(input_status)),
+        coded_input_(std::make_unique<google::protobuf::io::CodedInputStream>(
+            decompressed_input_ ? decompressed_input_.get() : raw_input_.get())) {}
+
+  // Read the framing in front of a record's length. Records in batches that rely on the checksums
+  // of the compressed stream have no hash, and `expected_hash` is set to 0 for them.
+  absl::Status ReadRecordHeader(uint64_t* expected_hash) {
+    *expected_hash = 0;
+
+    // Failing to read the first value indicates we're at the end of a file.
+    uint8_t first_byte;
+    if (!coded_input_->ReadRaw(&first_byte, sizeof(first_byte))) {
+      return EndOfInput();
+    }
+    if (frame_checksums_ && first_byte == ::fsspool::kStreamBatcherRecordDelimiter) {
+      return absl::OkStatus();
+    }
 
-  return StreamMessageSource::Create(std::move(*temp_file));
-}
+    // Check the magic value
+    uint8_t magic_bytes[sizeof(uint32_t)] = {first_byte};
+    if (!coded_input_->ReadRaw(magic_bytes + 1, sizeof(magic_bytes) - 1)) {
+      return EndOfInput();
+    }
+    uint32_t magic = OSReadLittleInt32(magic_bytes, 0);
+    bool at_start = !read_header_;
+    read_header_ = true;
 
-absl::StatusOr<std::unique_ptr<MessageSource>> HandleGzipFileSource(ScopedFile scoped_file) {
-  if (absl::Status status = CanProcessFile(scoped_file); !status.ok()) {
-    return status;
-  }
+    // Indexed batches end with the index, which follows the last record
+    if (magic == ::fsspool::kStreamBatcherIndexMagic) {
+      return absl::OutOfRangeError("No more data");
+    }
+    if (at_start && magic == ::fsspool::kStreamBatcherFrameChecksumMagic) {
+      frame_checksums_ = true;
+      return ReadRecordHeader(expected_hash);
+    }
+    if (frame_checksums_ || magic != ::fsspool::kStreamBatcherMagic) {
+      return absl::InternalError("Invalid magic value");
+    }
 
-  NSFileHandle* handle = scoped_file.Reader();
-  NSError* err;
-  NSData* compressed = [handle readDataToEndOfFileAndReturnError:&err];
-  if (err) {
-    return absl::InternalError(
-        absl::StrFormat("Failed to read compressed file: %s", err.localizedDescription.UTF8String));
+    // Read the hash
+    if (!coded_input_->ReadRaw(expected_hash, sizeof(*expected_hash))) {
+      return absl::InternalError("Failed to parse hash data");
+    }
+    return absl::OkStatus();
   }
 
-  NSData* decompressed = [compressed gzipDecompressed];
-  if (!decompressed) {
-    return absl::InternalError("Failed to decompress file");
+  absl::Status EndOfInput() {
+    if (absl::Status status = input_status_(); !status.ok()) {
+      return status;
+    }
+    return absl::OutOfRangeError("No more data");
   }
 
-  return CreateStreamSource(decompressed);
+  // Streams are declared in the order they wrap one another so that they
+  // are destroyed in reverse
+  std::unique_ptr<google::protobuf::io::ZeroCopyInputStream> raw_input_;
+  std::unique_ptr<google::protobuf::io::ZeroCopyInputStream> decompressed_input_;
+  InputStatus input_status_;
+  std::unique_ptr<google::protobuf::io::CodedInputStream> coded_input_;
+  // Reused across records to avoid an allocation per record
+  std::vector<uint8_t> msg_buf_;
+  // Whether the first magic value has been read, and whether it marked a batch of
+  // StreamRecordFormat::kFrameChecksum records
+  bool read_header_ = false;
+  bool frame_checksums_ = false;
+};
+
+absl::StatusOr<std::unique_ptr<MessageSource>> HandleGzipFileSource(
+    std::unique_ptr<MappedFile> mapped_file) {
+  return StreamMessageSource::Create(
+      std::move(mapped_file),
+      [](google::protobuf::io::ZeroCopyInputStream* raw_input,
+         StreamMessageSource::InputStatus* input_status)
+          -> std::unique_ptr<google::protobuf::io::ZeroCopyInputStream> {
+        auto gzip_input = std::make_unique<google::protobuf::io::GzipInputStream>(
+            raw_input, google::protobuf::io::GzipInputStream::GZIP);
+        google::protobuf::io::GzipInputStream* gzip = gzip_input.get();
+        *input_status = [gzip] {
+          const char* error = gzip->ZlibErrorMessage();
+          if (error) {
+            return absl::InternalError(absl::StrFormat("Failed to decompress file: %s", error));
+          }
+          return absl::OkStatus();
+        };
+        return gzip_input;
+      });
 }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> HandleZstdFileSource(ScopedFile scoped_file) {
-  if (absl::Status status = CanProcessFile(scoped_file); !status.ok()) {
-    return status;
+// Load the configured zstd dictionary and ensure it is the one identified by `dict_id`
+absl::StatusOr<NSData*> LoadZstdDictionary(unsigned dict_id) {
+  NSString* path = [[SNTConfigurator configurator] eventLogZstdDictionaryPath];
+  if (!path.length) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "File was compressed with zstd dictionary %u but EventLogZstdDictionaryPath is not set",
+        dict_id));
   }
 
-  NSFileHandle* handle = scoped_file.Reader();
   NSError* err;
-  NSData* compressed = [handle readDataToEndOfFileAndReturnError:&err];
-  if (err) {
-    return absl::InternalError(
-        absl::StrFormat("Failed to read compressed file: %s", err.localizedDescription.UTF8String));
+  NSData* dictionary = [NSData dataWithContentsOfFile:path options:0 error:&err];
+  if (!dictionary) {
+    return absl::InternalError(absl::StrFormat("Failed to read zstd dictionary %s: %s",
+                                               path.UTF8String,
+                                               err.localizedDescription.UTF8String));
   }
 
-  uint64_t max_size = ZSTD_decompressBound(compressed.bytes, compressed.length);
-  if (max_size == ZSTD_CONTENTSIZE_ERROR) {
-    return absl::OutOfRangeError("Failed to calculate decompressed size");
+  unsigned have_id = ZSTD_getDictID_fromDict(dictionary.bytes, dictionary.length);
+  if (have_id != dict_id) {
+    return absl::FailedPreconditionError(
+        absl::StrFormat("File requires zstd dictionary %u but %s has ID %u", dict_id,
+                        path.UTF8String, have_id));
   }
 
-  NSMutableData* decompressed = [[NSMutableData alloc] initWithCapacity:max_size];
-  decompressed.length = max_size;
+  return dictionary;
+}
 
-  size_t bytes_decompressed =
-      ZSTD_decompress(decompressed.mutableBytes, max_size, compressed.bytes, compressed.length);
-  if (ZSTD_isError(bytes_decompressed)) {
-    return absl::InternalError(absl::StrFormat("Failed to decompress zstd file: %d: %s",
-                                               ZSTD_getErrorCode(bytes_decompressed),
-                                               ZSTD_getErrorName(bytes_decompressed)));
+absl::StatusOr<std::unique_ptr<MessageSource>> HandleZstdFileSource(
+    std::unique_ptr<MappedFile> mapped_file) {
+  // Batches compressed with a dictionary record its ID in the frame header
+  unsigned dict_id = ZSTD_getDictID_fromFrame(mapped_file->data(), mapped_file->size());
+  NSData* dictionary;
+  if (dict_id != 0) {
+    absl::StatusOr<NSData*> loaded = LoadZstdDictionary(dict_id);
+    if (!loaded.ok()) {
+      return loaded.status();
+    }
+    dictionary = *loaded;
   }
 
-  // Clamp the length now that we know the true size
-  decompressed.length = bytes_decompressed;
-
-  return CreateStreamSource(decompressed);
+  return StreamMessageSource::Create(
+      std::move(mapped_file),
+      [dictionary](google::protobuf::io::ZeroCopyInputStream* raw_input,
+                   StreamMessageSource::InputStatus* input_status)
+          -> std::unique_ptr<google::protobuf::io::ZeroCopyInputStream> {
+        std::unique_ptr<::fsspool::ZstdInputStream> zstd_input = ::fsspool::ZstdInputStream::Create(
+            raw_input, std::string_view((const char*)dictionary.bytes, dictionary.length));
+        if (!zstd_input) {
+          return nullptr;
+        }
+        ::fsspool::ZstdInputStream* zstd = zstd_input.get();
+        *input_status = [zstd] {
+          return zstd->status();
+        };
+        return zstd_input;
+      });
 }
 
 absl::StatusOr<std::unique_ptr<MessageSource>> MessageSource::Create(NSString* path) {
-  // Open the file
-  int fd = open(path.UTF8String, O_RDONLY);
-  if (fd < 0) {
-    return absl::InvalidArgumentError("Failed to open file");
+  absl::StatusOr<std::unique_ptr<MappedFile>> mapped_file = MappedFile::Open(path);
+  if (!mapped_file.ok()) {
+    return mapped_file.status();
   }
 
-  // Ensure the file gets closed appropriately
-  ScopedFile scoped_file(fd);
-
   // Read the first 4 bytes to check for the stream protobuf magic number
-  uint32_t magic_number = 0;
-  errno = 0;
-  ssize_t bytes_read = read(fd, &magic_number, sizeof(magic_number));
-
   // Note: Allow "parsing" of empty files so it isn't treated as an error
-  if (bytes_read != 0 && bytes_read != sizeof(magic_number)) {
+  uint32_t magic_number = 0;
+  size_t size = (*mapped_file)->size();
+  if (size != 0 && size < sizeof(magic_number)) {
     return absl::InvalidArgumentError("Failed to determine file type");
   }
-
-  // Reset file position back to the beginning
-  if (lseek(fd, 0, SEEK_SET) != 0) {
-    return absl::InternalError("Failed to reset file position for reading");
+  if (size != 0) {
+    memcpy(&magic_number, (*mapped_file)->data(), sizeof(magic_number));
   }
 
   // Determine which derived class to instantiate based on magic number
   if (magic_number == ::fsspool::kStreamBatcherMagic) {
-    return StreamMessageSource::Create(std::move(scoped_file));
+    return StreamMessageSource::Create(std::move(*mapped_file));
   } else if (magic_number == 0xfd2fb528) {
-    return HandleZstdFileSource(std::move(scoped_file));
+    return HandleZstdFileSource(std::move(*mapped_file));
   } else if ((magic_number & 0xffff) == 0x8b1f) {
-    return HandleGzipFileSource(std::move(scoped_file));
+    return HandleGzipFileSource(std::move(*mapped_file));
   } else if ((magic_number & 0xff) == 0x0a) {
-    return AnyMessageSource::Create(std::move(scoped_file));
+    if (auto source = AnyMessageSource::Create(std::move(*mapped_file))) {
+      return source;
+    }
+    return absl::InvalidArgumentError("Failed to parse LogBatch");
+  } else if ((magic_number & 0xff) == 0x08) {
+    // ColumnarBatch always begins with its row count
+    if (auto source = ColumnarMessageSource::Create(std::move(*mapped_file))) {
+      return source;
+    }
+    return absl::InvalidArgumentError("Failed to parse ColumnarBatch");
   } else {
     return absl::InvalidArgumentError("Unsupported file type");
   }
 }
 
+// The JSON for the records of one file, along with any errors encountered
+// while decoding it
+struct DecodedFile {
+  absl::Status open_status;
+  std::string json;
+  std::vector<std::string> errors;
+};
+
+DecodedFile DecodeFile(NSString* path, const MessageFilter& filter,
+                       const JsonPrintOptions& options) {
+  DecodedFile decoded;
+  auto source = MessageSource::Create(path);
+  if (!source.ok()) {
+    decoded.open_status = source.status();
+    return decoded;
+  }
+
+  bool first_message = true;
+  while (true) {
+    auto message = (*source)->Next(filter);
+    if (!message.ok()) {
+      // Check if we've reached the end of the source, or some other error
+      if (!absl::IsOutOfRange(message.status())) {
+        decoded.errors.push_back(
+            absl::StrFormat("Error reading message: %s", message.status().ToString()));
+      }
+      break;
+    }
+
+    // Print the comma between records
+    if (first_message) {
+      first_message = false;
+    } else {
+      decoded.json += ",\n";
+    }
+
+    std::string json;
+    if (!MessageToJsonString(*message, &json, options).ok()) {
+      decoded.errors.push_back("Unable to convert message to JSON");
+    }
+    decoded.json += json;
+  }
+
+  return decoded;
+}
+
 @interface SNTCommandPrintLog : SNTCommand <SNTCommandProtocol>
 @end
 
@@ -340,7 +697,45 @@ REGISTER_COMMAND_NAME(@"printlog")
          @"    [\n"
          @"      ... file N contents ...\n"
          @"    ]\n"
-         @"  ]";
+         @"  ]\n"
+         @"\n"
+         @"Files are decoded in parallel and printed in the order given.\n"
+         @"\n"
+         @"Options:\n"
+         @"  --event-type {type}: Only print events of this type, e.g. execution or close.\n"
+         @"                       May be repeated or given as a comma separated list.\n"
+         @"  --since {time}:      Only print events at or after this time. Either an RFC 3339\n"
+         @"                       time, e.g. 2026-01-02T15:04:05Z, or a duration before now,\n"
+         @"                       e.g. 90m or 2h.\n"
+         @"  --pid {pid}:         Only print events about this process ID.\n"
+         @"  --path {glob}:       Only print events with a file path matching this glob.\n"
+         @"\n"
+         @"Files compressed with a zstd dictionary are decompressed using the\n"
+         @"dictionary set by the EventLogZstdDictionaryPath config key.";
+}
+
+- (void)addEventTypes:(NSString*)arg toFilter:(MessageFilter*)filter {
+  const google::protobuf::OneofDescriptor* events =
+      pbv1::SantaMessage::descriptor()->FindOneofByName("event");
+
+  for (NSString* name in [arg componentsSeparatedByString:@","]) {
+    const google::protobuf::FieldDescriptor* field =
+        pbv1::SantaMessage::descriptor()->FindFieldByName(
+            [name stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]]
+                .lowercaseString.UTF8String);
+    if (!field || field->containing_oneof() != events) {
+      NSMutableArray* valid = [NSMutableArray array];
+      for (int i = 0; i < events->field_count(); i++) {
+        [valid addObject:@(std::string(events->field(i)->name()).c_str())];
+      }
+      [self printErrorUsageAndExit:[NSString stringWithFormat:@"Unknown event type '%@'. Valid "
+                                                              @"types are: %@",
+                                                              name,
+                                                              [valid componentsJoinedByString:
+                                                                         @", "]]];
+    }
+    filter->event_types.insert((uint32_t)field->number());
+  }
 }
 
 - (void)runWithArguments:(NSArray*)arguments {
@@ -350,52 +745,92 @@ REGISTER_COMMAND_NAME(@"printlog")
   options.preserve_proto_field_names = true;
   options.add_whitespace = true;
 
-  bool printed_opening_brace = false;
+  MessageFilter filter;
+  NSMutableArray<NSString*>* paths = [NSMutableArray array];
 
-  for (NSString* path in arguments) {
-    auto source = MessageSource::Create(path);
-    if (!source.ok()) {
-      TEE_LOGE(@"%@: %s", path, source.status().ToString().c_str());
-      continue;
-    }
+  // Parse arguments
+  for (NSUInteger i = 0; i < arguments.count; ++i) {
+    NSString* arg = arguments[i];
+
+    if ([arg caseInsensitiveCompare:@"--event-type"] == NSOrderedSame) {
+      if (++i > arguments.count - 1) {
+        [self printErrorUsageAndExit:@"--event-type requires an argument"];
+      }
+      [self addEventTypes:arguments[i] toFilter:&filter];
+    } else if ([arg caseInsensitiveCompare:@"--since"] == NSOrderedSame) {
+      if (++i > arguments.count - 1) {
+        [self printErrorUsageAndExit:@"--since requires an argument"];
+      }
 
-    if (printed_opening_brace) {
-      std::cout << ",";
+      std::string since = [arguments[i] UTF8String];
+      absl::Time time;
+      absl::Duration duration;
+      std::string err;
+      if (absl::ParseTime(absl::RFC3339_full, since, &time, &err)) {
+        filter.since_ns = absl::ToUnixNanos(time);
+      } else if (absl::ParseDuration(since, &duration) && duration >= absl::ZeroDuration()) {
+        filter.since_ns = absl::ToUnixNanos(absl::Now() - duration);
+      } else {
+        [self printErrorUsageAndExit:@"--since requires an RFC 3339 time or a duration"];
+      }
+    } else if ([arg caseInsensitiveCompare:@"--pid"] == NSOrderedSame) {
+      if (++i > arguments.count - 1) {
+        [self printErrorUsageAndExit:@"--pid requires an argument"];
+      }
+
+      NSScanner* scanner = [NSScanner scannerWithString:arguments[i]];
+      int pid;
+      if (![scanner scanInt:&pid] || !scanner.isAtEnd || pid < 0) {
+        [self printErrorUsageAndExit:@"--pid requires a process ID"];
+      }
+      filter.pid = pid;
+    } else if ([arg caseInsensitiveCompare:@"--path"] == NSOrderedSame) {
+      if (++i > arguments.count - 1) {
+        [self printErrorUsageAndExit:@"--path requires an argument"];
+      }
+      filter.path_glob = [arguments[i] UTF8String];
     } else {
-      // Print the opening outer JSON array
-      std::cout << "[";
-      printed_opening_brace = true;
+      [paths addObject:arg];
     }
+  }
 
-    // Print the opening inner JSON array
-    std::cout << "\n[\n";
+  bool printed_opening_brace = false;
 
-    bool first_message = true;
-    while (true) {
-      auto message = (*source)->Next();
-      if (!message.ok()) {
-        // Check if we've reached the end of the source, or some other error
-        if (!absl::IsOutOfRange(message.status())) {
-          TEE_LOGE(@"%@: Error reading message: %s", path, message.status().ToString().c_str());
-        }
-        break;
+  // Files are decoded in windows of up to one file per core. Each window is
+  // printed in order before the next begins so that memory use is bounded by
+  // the decoded output of one window.
+  NSUInteger window_size = MAX(1, [[NSProcessInfo processInfo] activeProcessorCount]);
+  for (NSUInteger window_start = 0; window_start < paths.count; window_start += window_size) {
+    NSUInteger count = MIN(window_size, paths.count - window_start);
+    std::vector<DecodedFile> decoded(count);
+    DecodedFile* decoded_files = decoded.data();
+
+    dispatch_apply(count, DISPATCH_APPLY_AUTO, ^(size_t i) {
+      decoded_files[i] = DecodeFile(paths[window_start + i], filter, options);
+    });
+
+    for (NSUInteger i = 0; i < count; i++) {
+      NSString* path = paths[window_start + i];
+      if (!decoded[i].open_status.ok()) {
+        TEE_LOGE(@"%@: %s", path, decoded[i].open_status.ToString().c_str());
+        continue;
       }
 
-      // Print the comma between records
-      if (first_message) {
-        first_message = false;
+      if (printed_opening_brace) {
+        std::cout << ",";
       } else {
-        std::cout << ",\n";
+        // Print the opening outer JSON array
+        std::cout << "[";
+        printed_opening_brace = true;
       }
 
-      std::string json;
-      if (!MessageToJsonString(*message, &json, options).ok()) {
-        TEE_LOGE(@"Unable to convert message to JSON in file: '%@'\n", path);
+      // Print the inner JSON array
+      std::cout << "\n[\n" << decoded[i].json << "]" << std::flush;
+
+      for (const std::string& error : decoded[i].errors) {
+        TEE_LOGE(@"%@: %s", path, error.c_str());
       }
-      std::cout << json;
     }
-
-    std::cout << "]" << std::flush;
   }
 
   if (printed_opening_brace) {
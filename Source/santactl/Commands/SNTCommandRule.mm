@@ -82,6 +82,8 @@ REGISTER_COMMAND_NAME(@"rule")
           @"    --certificate: add or check a certificate sha256 rule instead of binary\n"
           @"    --cdhash: add or check a cdhash rule instead of binary\n"
           @"    --file-access: Check a path for associated File Access rules. Requires --path.\n"
+          @"    --ndjson: with --check, read identifiers from stdin, one per line, and print\n"
+          @"              one JSON object per identifier as lookups complete.\n"
 #ifdef DEBUG
           @"    --force: allow manual changes even when SyncBaseUrl is set\n"
 #endif
@@ -149,6 +151,7 @@ REGISTER_COMMAND_NAME(@"rule")
   BOOL exportRules = NO;
   BOOL exportFileAccessRules = NO;
   BOOL faaLookup = NO;
+  BOOL ndjson = NO;
 
   // Parse arguments
   for (NSUInteger i = 0; i < arguments.count; ++i) {
@@ -175,6 +178,8 @@ REGISTER_COMMAND_NAME(@"rule")
       state = SNTRuleStateRemove;
     } else if ([arg caseInsensitiveCompare:@"--check"] == NSOrderedSame) {
       check = YES;
+    } else if ([arg caseInsensitiveCompare:@"--ndjson"] == NSOrderedSame) {
+      ndjson = YES;
     } else if ([arg caseInsensitiveCompare:@"--certificate"] == NSOrderedSame) {
       type = SNTRuleTypeCertificate;
     } else if ([arg caseInsensitiveCompare:@"--teamid"] == NSOrderedSame) {
@@ -266,6 +271,18 @@ REGISTER_COMMAND_NAME(@"rule")
       [self printErrorUsageAndExit:@"--check and --clean/--clean-all are mutually exclusive"];
   }
 
+  if (ndjson) {
+    if (!check) [self printErrorUsageAndExit:@"--ndjson can only be used with --check"];
+    if (faaLookup) {
+      [self printErrorUsageAndExit:@"--ndjson and --file-access are mutually exclusive"];
+    }
+    if (identifier || path) {
+      [self printErrorUsageAndExit:@"--ndjson reads identifiers from stdin and cannot be used with "
+                                   @"--identifier or --path"];
+    }
+    return [self printStateOfRulesFromStdinWithType:type daemonConnection:self.daemonConn];
+  }
+
   if (faaLookup) {
     if (!check) [self printErrorUsageAndExit:@"--file-access can only be used with --check"];
     if (!path) [self printErrorUsageAndExit:@"--file-access requires --path"];
@@ -450,19 +467,24 @@ REGISTER_COMMAND_NAME(@"rule")
                               }];
 }
 
+- (SNTRuleIdentifiers*)ruleIdentifiersForIdentifier:(NSString*)identifier
+                                               type:(SNTRuleType)type {
+  struct RuleIdentifiers identifiers = {
+      .cdhash = (type == SNTRuleTypeCDHash) ? identifier : nil,
+      .binarySHA256 = (type == SNTRuleTypeBinary) ? identifier : nil,
+      .signingID = (type == SNTRuleTypeSigningID) ? identifier : nil,
+      .certificateSHA256 = (type == SNTRuleTypeCertificate) ? identifier : nil,
+      .teamID = (type == SNTRuleTypeTeamID) ? identifier : nil,
+  };
+  return [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:identifiers];
+}
+
 - (void)printStateOfRule:(SNTRule*)rule daemonConnection:(MOLXPCConnection*)daemonConn {
   id<SNTDaemonControlXPC> rop = [daemonConn synchronousRemoteObjectProxy];
   __block NSString* output = @"No matching rule exists";
 
-  struct RuleIdentifiers identifiers = {
-      .cdhash = (rule.type == SNTRuleTypeCDHash) ? rule.identifier : nil,
-      .binarySHA256 = (rule.type == SNTRuleTypeBinary) ? rule.identifier : nil,
-      .signingID = (rule.type == SNTRuleTypeSigningID) ? rule.identifier : nil,
-      .certificateSHA256 = (rule.type == SNTRuleTypeCertificate) ? rule.identifier : nil,
-      .teamID = (rule.type == SNTRuleTypeTeamID) ? rule.identifier : nil,
-  };
-
-  [rop databaseRuleForIdentifiers:[[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:identifiers]
+  [rop databaseRuleForIdentifiers:[self ruleIdentifiersForIdentifier:rule.identifier
+                                                                type:rule.type]
                             reply:^(SNTRule* r) {
                               if (r) output = [r stringifyWithColor:(isatty(STDOUT_FILENO) == 1)];
                             }];
@@ -471,6 +493,66 @@ REGISTER_COMMAND_NAME(@"rule")
   exit(0);
 }
 
+// Looks up identifiers read from stdin, one per line, and prints each result as a single line of
+// JSON. Identifiers are sent to the daemon in batches so that large inputs need few round trips
+// while memory use stays bounded by the batch size.
+- (void)printStateOfRulesFromStdinWithType:(SNTRuleType)type
+                          daemonConnection:(MOLXPCConnection*)daemonConn {
+  static const NSUInteger kBatchSize = 512;
+  id<SNTDaemonControlXPC> rop = [daemonConn synchronousRemoteObjectProxy];
+  NSCharacterSet* whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+
+  NSMutableArray<NSString*>* batch = [NSMutableArray arrayWithCapacity:kBatchSize];
+  void (^flushBatch)(void) = ^{
+    NSMutableArray<SNTRuleIdentifiers*>* lookups = [NSMutableArray arrayWithCapacity:batch.count];
+    for (NSString* identifier in batch) {
+      [lookups addObject:[self ruleIdentifiersForIdentifier:identifier type:type]];
+    }
+
+    __block NSArray* rules;
+    [rop databaseRulesForIdentifiers:lookups
+                               reply:^(NSArray* r) {
+                                 rules = r;
+                               }];
+    if (rules.count != batch.count) {
+      TEE_LOGE(@"Failed to look up rules");
+      exit(EXIT_FAILURE);
+    }
+
+    [batch enumerateObjectsUsingBlock:^(NSString* identifier, NSUInteger idx, BOOL* stop) {
+      id rule = rules[idx];
+      NSDictionary* record = @{
+        @"identifier" : identifier,
+        @"rule" : [rule isKindOfClass:[SNTRule class]] ? [rule dictionaryRepresentation]
+                                                       : [NSNull null],
+      };
+
+      NSData* jsonData = [NSJSONSerialization dataWithJSONObject:record options:0 error:NULL];
+      if (!jsonData) return;
+      fwrite(jsonData.bytes, 1, jsonData.length, stdout);
+      fputc('\n', stdout);
+    }];
+    fflush(stdout);
+    [batch removeAllObjects];
+  };
+
+  char* line = NULL;
+  size_t cap = 0;
+  while (getline(&line, &cap, stdin) > 0) {
+    @autoreleasepool {
+      NSString* identifier = [@(line) stringByTrimmingCharactersInSet:whitespace] ?: @"";
+      if (!identifier.length) continue;
+
+      [batch addObject:identifier];
+      if (batch.count >= kBatchSize) flushBatch();
+    }
+  }
+  free(line);
+
+  if (batch.count) flushBatch();
+  exit(0);
+}
+
 - (void)importJSONFile:(NSString*)jsonFilePath with:(SNTRuleCleanup)cleanupType {
   // If the file exists parse it and then add the rules one at a time.
   NSError* error;
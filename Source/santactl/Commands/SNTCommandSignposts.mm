@@ -0,0 +1,78 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+#import "Source/common/MOLXPCConnection.h"
+#import "Source/common/SNTLogging.h"
+#import "Source/common/SNTXPCControlInterface.h"
+#import "Source/santactl/SNTCommand.h"
+#import "Source/santactl/SNTCommandController.h"
+
+@interface SNTCommandSignposts : SNTCommand <SNTCommandProtocol>
+@end
+
+@implementation SNTCommandSignposts
+
+REGISTER_COMMAND_NAME(@"signposts")
+
++ (BOOL)requiresRoot {
+  return YES;
+}
+
++ (BOOL)requiresDaemonConn {
+  return YES;
+}
+
++ (NSString*)shortHelpText {
+  return @"Enable or disable santad signposts";
+}
+
++ (NSString*)longHelpText {
+  return @"Usage: santactl signposts [enable|disable]\n"
+         @"\n"
+         @"Enables or disables os_signpost intervals for santad's startup phases and event\n"
+         @"processing. The setting persists across santad restarts so that startup can be\n"
+         @"traced as well. Signposts are recorded with the os_signpost instrument in\n"
+         @"Instruments, under the com.northpolesec.santa subsystem and Timeline category.\n"
+         @"\n"
+         @"IMPORTANT: This command is intended for development purposes only.\n";
+}
+
++ (BOOL)isHidden {
+  return YES;
+}
+
+- (void)runWithArguments:(NSArray*)arguments {
+  NSString* action = arguments.firstObject;
+  BOOL enable;
+  if ([action isEqualToString:@"enable"]) {
+    enable = YES;
+  } else if ([action isEqualToString:@"disable"]) {
+    enable = NO;
+  } else {
+    [self printErrorUsageAndExit:@"Expected 'enable' or 'disable'"];
+    return;
+  }
+
+  [[self.daemonConn remoteObjectProxy] setSignpostsEnabled:enable
+                                                     reply:^{
+                                                       TEE_LOGI(@"Signposts %@",
+                                                                enable ? @"enabled" : @"disabled");
+                                                       exit(0);
+                                                     }];
+}
+
+@end
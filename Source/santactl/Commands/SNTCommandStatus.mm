@@ -79,7 +79,9 @@ REGISTER_COMMAND_NAME(@"status")
 
 + (NSString*)longHelpText {
   return (@"Provides details about Santa while it's running.\n"
-          @"  Use --json to output in JSON format");
+          @"  Use --json to output in JSON format\n"
+          @"  Use --verbose to also show the CPU time and approximate memory used by each\n"
+          @"  part of the daemon, and the binaries that cost the most time to evaluate");
 }
 
 - (void)runWithArguments:(NSArray*)arguments {
@@ -114,6 +116,35 @@ REGISTER_COMMAND_NAME(@"status")
     ramPeak = wd_ramPeak;
   }];
 
+  // Self profile, only fetched when asked for
+  BOOL verbose = [arguments containsObject:@"--verbose"];
+  __block NSDictionary<NSString*, NSNumber*>* cpuSecondsBySubsystem;
+  __block uint64_t interruptWakeups = 0, idleWakeups = 0;
+  if (verbose) {
+    [rop selfProfile:^(NSDictionary<NSString*, NSNumber*>* cpuSeconds, uint64_t interrupt,
+                       uint64_t idle) {
+      cpuSecondsBySubsystem = cpuSeconds;
+      interruptWakeups = interrupt;
+      idleWakeups = idle;
+    }];
+  }
+  __block NSDictionary<NSString*, NSNumber*>* memoryBytesByStructure;
+  if (verbose) {
+    [rop memoryUsage:^(NSDictionary<NSString*, NSNumber*>* bytesByStructure) {
+      memoryBytesByStructure = bytesByStructure;
+    }];
+  }
+  __block NSArray<NSDictionary*>* hotBinaries;
+  if (verbose) {
+    [rop hotBinaries:^(NSArray<NSDictionary*>* binaries) {
+      hotBinaries = binaries;
+    }];
+  }
+  NSArray<NSString*>* subsystems = [cpuSecondsBySubsystem
+      keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber* a, NSNumber* b) {
+        return [b compare:a];
+      }];
+
   BOOL fileLogging = ([[SNTConfigurator configurator] fileChangesRegex] != nil);
   NSString* eventLogType = [[[SNTConfigurator configurator] eventLogTypeRaw] lowercaseString];
 
@@ -452,6 +483,18 @@ REGISTER_COMMAND_NAME(@"status")
       };
     }
 
+    if (verbose) {
+      stats[@"self_profile"] = @{
+        @"cpu_seconds" : cpuSecondsBySubsystem ?: @{},
+        @"interrupt_wakeups" : @(interruptWakeups),
+        @"idle_wakeups" : @(idleWakeups),
+      };
+      stats[@"memory"] = @{
+        @"approximate_bytes" : memoryBytesByStructure ?: @{},
+      };
+      stats[@"hot_binaries"] = hotBinaries ?: @[];
+    }
+
     NSData* statsData = [NSJSONSerialization dataWithJSONObject:stats
                                                         options:NSJSONWritingPrettyPrinted
                                                           error:nil];
@@ -575,6 +618,33 @@ REGISTER_COMMAND_NAME(@"status")
       printf("  %-40s | %s\n", "Metrics Server", [[metricsURLStr absoluteString] UTF8String]);
       printf("  %-40s | %lu\n", "Export Interval (seconds)", metricExportInterval);
     }
+
+    if (verbose) {
+      printf(">>> Self Profile\n");
+      for (NSString* subsystem in subsystems) {
+        printf("  %-40s | %.3f\n",
+               [[NSString stringWithFormat:@"CPU Seconds (%@)", subsystem] UTF8String],
+               [cpuSecondsBySubsystem[subsystem] doubleValue]);
+      }
+      printf("  %-40s | %llu\n", "Interrupt Wakeups", interruptWakeups);
+      printf("  %-40s | %llu\n", "Idle Wakeups", idleWakeups);
+
+      printf(">>> Memory Info\n");
+      for (NSString* structure in
+           [memoryBytesByStructure.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        printf("  %-40s | %llu\n",
+               [[NSString stringWithFormat:@"Approximate Bytes (%@)", structure] UTF8String],
+               [memoryBytesByStructure[structure] unsignedLongLongValue]);
+      }
+
+      printf(">>> Hot Binaries\n");
+      for (NSDictionary* binary in hotBinaries) {
+        printf("  %-40s | %.1fms total, %llu evaluations, %.1fms max\n",
+               [binary[@"path"] UTF8String], [binary[@"total"] doubleValue] / NSEC_PER_MSEC,
+               [binary[@"count"] unsignedLongLongValue],
+               [binary[@"max"] doubleValue] / NSEC_PER_MSEC);
+      }
+    }
   }
 
   exit(0);
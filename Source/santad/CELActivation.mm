@@ -52,10 +52,14 @@ std::vector<santa::cel::CELProtoTraits<true>::AncestorT> Ancestors<true>(
     return {};
   }
 
+  std::shared_ptr<const santa::santad::process_tree::Ancestry> chain =
+      processTree->Ancestors(**proc);
+
   std::vector<santa::cel::CELProtoTraits<true>::AncestorT> ancestors;
-  for (const auto& p : processTree->RootSlice(*proc)) {
+  ancestors.reserve(1 + chain->size());
+  auto addAncestor = [&ancestors](const santa::santad::process_tree::Process* p) {
     if (!p->program_) {
-      continue;
+      return;
     }
 
     AncestorT ancestor;
@@ -76,6 +80,12 @@ std::vector<santa::cel::CELProtoTraits<true>::AncestorT> Ancestors<true>(
     }
 
     ancestors.push_back(std::move(ancestor));
+  };
+
+  // The parent of the process in the message is the first ancestor
+  addAncestor(proc->get());
+  for (const auto& p : *chain) {
+    addAncestor(p.get());
   }
   return ancestors;
 }
@@ -125,51 +135,57 @@ ActivationCallbackBlock CreateCELActivationBlock(
       using AncestorT = typename Traits::AncestorT;
       using FileDescriptorT = typename Traits::FileDescriptorT;
 
-      auto f = std::make_unique<ExecutableFileT>();
+      // Building the target's message serializes every entitlement, so wait
+      // until an expression reads it.
+      return std::make_unique<santa::cel::Activation<IsV2>>(
+          ^std::unique_ptr<ExecutableFileT>() {
+            auto f = std::make_unique<ExecutableFileT>();
 
-      if (formattedSigningID) {
-        f->set_signing_id(santa::NSStringToUTF8String(formattedSigningID));
-      }
+            if (formattedSigningID) {
+              f->set_signing_id(santa::NSStringToUTF8String(formattedSigningID));
+            }
 
-      if (signingTime) {
-        f->mutable_signing_time()->set_seconds(signingTime.timeIntervalSince1970);
-      }
-      if (secureSigningTime) {
-        f->mutable_secure_signing_time()->set_seconds(secureSigningTime.timeIntervalSince1970);
-      }
+            if (signingTime) {
+              f->mutable_signing_time()->set_seconds(signingTime.timeIntervalSince1970);
+            }
+            if (secureSigningTime) {
+              f->mutable_secure_signing_time()->set_seconds(
+                  secureSigningTime.timeIntervalSince1970);
+            }
 
-      f->set_is_platform_binary(isPlatformBinary);
-      if (teamID) {
-        f->set_team_id(santa::NSStringToUTF8String(teamID));
-      }
+            f->set_is_platform_binary(isPlatformBinary);
+            if (teamID) {
+              f->set_team_id(santa::NSStringToUTF8String(teamID));
+            }
 
-      if constexpr (IsV2) {
-        if (entitlementsDict) {
-          auto* entitlements = f->mutable_entitlements();
-          [entitlementsDict
-              enumerateKeysAndObjectsUsingBlock:^(NSString* key, id value, BOOL* stop) {
-                NSError* err;
-                NSData* jsonData;
-                @try {
-                  jsonData = [NSJSONSerialization dataWithJSONObject:value
-                                                             options:NSJSONWritingFragmentsAllowed
-                                                               error:&err];
-                } @catch (NSException*) {
-                }
-                if (!jsonData) {
-                  // Skip entitlements that can't be serialized to JSON.
-                  return;
-                }
-                NSString* jsonStr = [[NSString alloc] initWithData:jsonData
-                                                          encoding:NSUTF8StringEncoding];
-                (*entitlements)[santa::NSStringToUTF8String(key)] =
-                    santa::NSStringToUTF8String(jsonStr);
-              }];
-        }
-      }
+            if constexpr (IsV2) {
+              if (entitlementsDict) {
+                auto* entitlements = f->mutable_entitlements();
+                [entitlementsDict
+                    enumerateKeysAndObjectsUsingBlock:^(NSString* key, id value, BOOL* stop) {
+                      NSError* err;
+                      NSData* jsonData;
+                      @try {
+                        jsonData = [NSJSONSerialization
+                            dataWithJSONObject:value
+                                       options:NSJSONWritingFragmentsAllowed
+                                         error:&err];
+                      } @catch (NSException*) {
+                      }
+                      if (!jsonData) {
+                        // Skip entitlements that can't be serialized to JSON.
+                        return;
+                      }
+                      NSString* jsonStr = [[NSString alloc] initWithData:jsonData
+                                                                encoding:NSUTF8StringEncoding];
+                      (*entitlements)[santa::NSStringToUTF8String(key)] =
+                          santa::NSStringToUTF8String(jsonStr);
+                    }];
+              }
+            }
 
-      return std::make_unique<santa::cel::Activation<IsV2>>(
-          std::move(f),
+            return f;
+          },
           ^std::vector<std::string>() {
             return esApi->ExecArgs(&esMsg->event.exec);
           },
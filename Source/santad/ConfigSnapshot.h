@@ -0,0 +1,68 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_CONFIGSNAPSHOT_H
+#define SANTA_SANTAD_CONFIGSNAPSHOT_H
+
+#import <Foundation/Foundation.h>
+
+#include <memory>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTConfigState.h"
+#import "Source/common/SNTConfigurator.h"
+
+namespace santa {
+
+// An immutable copy of the configuration values read while processing events.
+//
+// The current snapshot is republished whenever one of the keys it copies
+// changes, so event processing doesn't go through SNTConfigurator's merged
+// dictionaries for each value it reads. Readers should fetch the snapshot once
+// per event and hold on to it rather than calling Current() repeatedly.
+struct ConfigSnapshot {
+  SNTClientMode client_mode;
+  bool fail_closed;
+  bool enable_bad_signature_protection;
+  bool enable_page_zero_protection;
+  bool enable_transitive_rules;
+  bool enable_deferred_exec_hashing;
+  bool enable_identity_only_exec_decisions;
+  bool enable_speculative_exec_prefetch;
+  bool enable_all_event_upload;
+  bool disable_unknown_event_upload;
+  bool enable_bundles;
+  bool has_sync_base_url;
+  SNTOverrideFileAccessAction override_file_access_action;
+  NSRegularExpression* allowed_path_regex;
+  NSRegularExpression* blocked_path_regex;
+  NSRegularExpression* file_changes_regex;
+  NSString* event_detail_url;
+  SNTConfigState* config_state;
+
+  static std::shared_ptr<const ConfigSnapshot> FromConfigurator(SNTConfigurator* config);
+
+  // Returns the current snapshot. Until StartObserving has been called this
+  // reads a new snapshot from [SNTConfigurator configurator] on every call.
+  static std::shared_ptr<const ConfigSnapshot> Current();
+
+  // Publishes a snapshot of `config` and republishes it each time one of the
+  // keys it copies changes. Only the first call has any effect.
+  static void StartObserving(SNTConfigurator* config);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_CONFIGSNAPSHOT_H
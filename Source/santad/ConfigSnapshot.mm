@@ -0,0 +1,117 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/ConfigSnapshot.h"
+
+#include <atomic>
+
+#import "Source/common/SNTKVOManager.h"
+
+namespace santa {
+
+namespace {
+
+// Only accessed with std::atomic_load/std::atomic_store. Never destroyed so
+// that it outlives any event processing still running at exit.
+std::shared_ptr<const ConfigSnapshot>& PublishedSnapshot() {
+  static auto* snapshot = new std::shared_ptr<const ConfigSnapshot>();
+  return *snapshot;
+}
+
+// Every key copied into the snapshot
+NSArray<NSString*>* ObservedKeys() {
+  return @[
+    NSStringFromSelector(@selector(clientMode)),
+    NSStringFromSelector(@selector(failClosed)),
+    NSStringFromSelector(@selector(enableBadSignatureProtection)),
+    NSStringFromSelector(@selector(enablePageZeroProtection)),
+    NSStringFromSelector(@selector(enableTransitiveRules)),
+    NSStringFromSelector(@selector(enableDeferredExecHashing)),
+    NSStringFromSelector(@selector(enableIdentityOnlyExecDecisions)),
+    NSStringFromSelector(@selector(enableSpeculativeExecPrefetch)),
+    NSStringFromSelector(@selector(enableAllEventUpload)),
+    NSStringFromSelector(@selector(disableUnknownEventUpload)),
+    NSStringFromSelector(@selector(enableBundles)),
+    NSStringFromSelector(@selector(syncBaseURL)),
+    NSStringFromSelector(@selector(overrideFileAccessAction)),
+    NSStringFromSelector(@selector(allowedPathRegex)),
+    NSStringFromSelector(@selector(blockedPathRegex)),
+    NSStringFromSelector(@selector(fileChangesRegex)),
+    NSStringFromSelector(@selector(eventDetailURL)),
+    // Copied into the SNTConfigState
+    NSStringFromSelector(@selector(enableNotificationSilences)),
+    NSStringFromSelector(@selector(eventDetailText)),
+    NSStringFromSelector(@selector(fileAccessEventDetailURL)),
+    NSStringFromSelector(@selector(fileAccessEventDetailText)),
+  ];
+}
+
+}  // namespace
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::FromConfigurator(SNTConfigurator* config) {
+  auto snapshot = std::make_shared<ConfigSnapshot>();
+  snapshot->client_mode = config.clientMode;
+  snapshot->fail_closed = config.failClosed;
+  snapshot->enable_bad_signature_protection = config.enableBadSignatureProtection;
+  snapshot->enable_page_zero_protection = config.enablePageZeroProtection;
+  snapshot->enable_transitive_rules = config.enableTransitiveRules;
+  snapshot->enable_deferred_exec_hashing = config.enableDeferredExecHashing;
+  snapshot->enable_identity_only_exec_decisions = config.enableIdentityOnlyExecDecisions;
+  snapshot->enable_speculative_exec_prefetch = config.enableSpeculativeExecPrefetch;
+  snapshot->enable_all_event_upload = config.enableAllEventUpload;
+  snapshot->disable_unknown_event_upload = config.disableUnknownEventUpload;
+  snapshot->enable_bundles = config.enableBundles;
+  snapshot->has_sync_base_url = config.syncBaseURL != nil;
+  snapshot->override_file_access_action = config.overrideFileAccessAction;
+  snapshot->allowed_path_regex = config.allowedPathRegex;
+  snapshot->blocked_path_regex = config.blockedPathRegex;
+  snapshot->file_changes_regex = config.fileChangesRegex;
+  snapshot->event_detail_url = config.eventDetailURL;
+  snapshot->config_state = [[SNTConfigState alloc] initWithConfig:config];
+  return snapshot;
+}
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::Current() {
+  std::shared_ptr<const ConfigSnapshot> snapshot =
+      std::atomic_load_explicit(&PublishedSnapshot(), std::memory_order_acquire);
+  return snapshot ? snapshot : FromConfigurator([SNTConfigurator configurator]);
+}
+
+void ConfigSnapshot::StartObserving(SNTConfigurator* config) {
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    void (^publish)(void) = ^{
+      std::atomic_store_explicit(&PublishedSnapshot(), FromConfigurator(config),
+                                 std::memory_order_release);
+    };
+
+    static NSMutableArray<SNTKVOManager*>* observers = [NSMutableArray array];
+    for (NSString* key in ObservedKeys()) {
+      SNTKVOManager* observer = [[SNTKVOManager alloc] initWithObject:config
+                                                             selector:NSSelectorFromString(key)
+                                                                 type:[NSObject class]
+                                                             callback:^(id, id) {
+                                                               publish();
+                                                             }];
+      if (observer) {
+        [observers addObject:observer];
+      }
+    }
+
+    publish();
+  });
+}
+
+}  // namespace santa
@@ -0,0 +1,82 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/ConfigSnapshot.h"
+
+#import <OCMock/OCMock.h>
+#import <XCTest/XCTest.h>
+
+#import "Source/common/SNTConfigState.h"
+#import "Source/common/SNTConfigurator.h"
+
+using santa::ConfigSnapshot;
+
+@interface ConfigSnapshotTest : XCTestCase
+@property id mockConfigurator;
+@end
+
+@implementation ConfigSnapshotTest
+
+- (void)setUp {
+  self.mockConfigurator = OCMClassMock([SNTConfigurator class]);
+  OCMStub([self.mockConfigurator configurator]).andReturn(self.mockConfigurator);
+}
+
+- (void)tearDown {
+  [self.mockConfigurator stopMocking];
+}
+
+- (void)testFromConfigurator {
+  NSRegularExpression* re = [NSRegularExpression regularExpressionWithPattern:@"^/tmp"
+                                                                      options:0
+                                                                        error:NULL];
+  OCMStub([self.mockConfigurator clientMode]).andReturn(SNTClientModeLockdown);
+  OCMStub([self.mockConfigurator failClosed]).andReturn(YES);
+  OCMStub([self.mockConfigurator enableTransitiveRules]).andReturn(YES);
+  OCMStub([self.mockConfigurator overrideFileAccessAction])
+      .andReturn(SNTOverrideFileAccessActionDisable);
+  OCMStub([self.mockConfigurator allowedPathRegex]).andReturn(re);
+  OCMStub([self.mockConfigurator syncBaseURL]).andReturn([NSURL URLWithString:@"https://sync"]);
+  OCMStub([self.mockConfigurator eventDetailURL]).andReturn(@"https://detail");
+
+  std::shared_ptr<const ConfigSnapshot> snapshot =
+      ConfigSnapshot::FromConfigurator(self.mockConfigurator);
+
+  XCTAssertEqual(snapshot->client_mode, SNTClientModeLockdown);
+  XCTAssertTrue(snapshot->fail_closed);
+  XCTAssertTrue(snapshot->enable_transitive_rules);
+  XCTAssertFalse(snapshot->enable_bad_signature_protection);
+  XCTAssertEqual(snapshot->override_file_access_action, SNTOverrideFileAccessActionDisable);
+  XCTAssertEqual(snapshot->allowed_path_regex, re);
+  XCTAssertNil(snapshot->blocked_path_regex);
+  XCTAssertTrue(snapshot->has_sync_base_url);
+  XCTAssertEqualObjects(snapshot->event_detail_url, @"https://detail");
+  XCTAssertEqual(snapshot->config_state.clientMode, SNTClientModeLockdown);
+}
+
+- (void)testCurrentFallsBackToConfigurator {
+  // Without StartObserving, each call reflects the configurator's current values
+  __block BOOL failClosed = NO;
+  OCMStub([self.mockConfigurator failClosed]).andDo(^(NSInvocation* inv) {
+    [inv setReturnValue:&failClosed];
+  });
+
+  XCTAssertFalse(ConfigSnapshot::Current()->fail_closed);
+
+  failClosed = YES;
+  XCTAssertTrue(ConfigSnapshot::Current()->fail_closed);
+}
+
+@end
@@ -41,9 +41,49 @@
 - (void)inDatabase:(void (^)(FMDatabase* db))block;
 - (void)inTransaction:(void (^)(FMDatabase* db, BOOL* rollback))block;
 
-///  Vacuum the database
+///
+///  Switch the database to WAL mode and open a pool of up to `maxConnections` read-only
+///  connections used by `inReadOnlyDatabase:`. Has no effect on in-memory databases.
+///  Returns YES if the pool was created.
+///
+- (BOOL)enableReadPoolWithMaximumConnections:(NSUInteger)maxConnections;
+
+///
+///  Run a block that only reads from the database. When a read pool is enabled the block runs on
+///  a read-only connection concurrently with other readers and the writer, and only sees
+///  committed data. Otherwise this is the same as `inDatabase:`.
+///
+///  Blocks that read or update state which must stay in sync with database writes, such as
+///  cached digests, must use `inDatabase:` so that they are serialized with the writer.
+///
+- (void)inReadOnlyDatabase:(void (^)(FMDatabase* db))block;
+
+///  Vacuum the database. This rewrites the whole file and blocks all other access while it runs,
+///  free pages are normally reclaimed by incremental vacuums instead.
 - (void)vacuum;
 
+///
+///  Every `intervalSeconds`, reclaim free pages with small incremental vacuums if enough of the
+///  file is free and the machine is idle and on AC power. A full vacuum is only run if the file
+///  is badly fragmented.
+///
+- (void)scheduleIncrementalVacuumWithInterval:(uint64_t)intervalSeconds;
+
+///
+///  Reclaim up to `pages` free pages. Returns the number of pages reclaimed.
+///
+- (int64_t)incrementalVacuumPages:(int64_t)pages;
+
+///
+///  The fraction of the database file made up of free pages.
+///
+- (double)freePageRatio;
+
+///
+///  The size of the database file in bytes, excluding any write-ahead log.
+///
+- (int64_t)sizeInBytes;
+
 ///
 ///  Current supported version of the table schema. This should be overriden in
 ///  subclasses.
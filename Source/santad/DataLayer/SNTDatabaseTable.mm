@@ -18,10 +18,38 @@
 #include <sqlite3.h>
 #include <stdint.h>
 
+#include "Source/common/BackgroundScheduler.h"
+#include "Source/common/PowerMonitor.h"
 #import "Source/common/SNTLogging.h"
+#import "Source/common/SNTStrengthify.h"
+#include "Source/common/Signposts.h"
+
+// Free pages are reclaimed with incremental vacuums of this many pages, pausing between slices so
+// other database users aren't kept waiting.
+static const int64_t kIncrementalVacuumSlicePages = 256;
+static const int64_t kIncrementalVacuumPauseNanos = 100 * NSEC_PER_MSEC;
+// Incremental vacuums only start once at least this many pages, and this fraction of the file,
+// are free.
+static const int64_t kIncrementalVacuumMinFreePages = 1024;
+static const double kIncrementalVacuumMinFreeRatio = 0.1;
+// A full VACUUM, which rewrites the whole file, is only run when at least this fraction of the
+// file is free.
+static const double kFullVacuumMinFreeRatio = 0.5;
+// Vacuums run only once there has been no user input for this long.
+static const uint64_t kVacuumMinIdleSeconds = 300;
+
+// SQLite value for PRAGMA auto_vacuum = INCREMENTAL
+static const long kAutoVacuumIncremental = 2;
 
 @interface SNTDatabaseTable ()
 @property FMDatabaseQueue* dbQ;
+@property(atomic) FMDatabasePool* readPool;
+// Bounds the number of concurrent readers. FMDatabasePool hands out nil connections once
+// its own limit is reached, so the limit is enforced here instead.
+@property dispatch_semaphore_t readPoolSema;
+@property dispatch_queue_t vacuumQueue;
+@property dispatch_source_t vacuumTimer;
+@property BOOL vacuumInProgress;
 @end
 
 @implementation SNTDatabaseTable
@@ -58,6 +86,8 @@
           LOGW(@"Repairs successful. (%@)", [db databasePath]);
         }
       }
+
+      [self enableIncrementalAutoVacuum:db];
     }];
 
     if (bail) return nil;
@@ -88,6 +118,18 @@
   return corrupted;
 }
 
+// Free pages can only be reclaimed by incremental vacuums once auto_vacuum is set to
+// INCREMENTAL. For databases created before this was the default, that takes one full VACUUM.
+- (void)enableIncrementalAutoVacuum:(FMDatabase*)db {
+  if ([db longForQuery:@"PRAGMA auto_vacuum"] == kAutoVacuumIncremental) return;
+
+  [[db executeQuery:@"PRAGMA auto_vacuum = INCREMENTAL"] close];
+  [db executeUpdate:@"VACUUM"];
+  if ([db longForQuery:@"PRAGMA auto_vacuum"] != kAutoVacuumIncremental) {
+    LOGW(@"Unable to enable incremental vacuum for %@", [db databasePath]);
+  }
+}
+
 - (void)closeDeleteReopenDatabase:(FMDatabase*)db {
   [db close];
   [[NSFileManager defaultManager] removeItemAtPath:[db databasePath] error:NULL];
@@ -118,7 +160,10 @@
 - (void)updateTableSchema {
   [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
     uint32_t currentVersion = [db userVersion];
+    os_signpost_id_t signpost = santa::BeginSignpost(santa::SignpostPhase::kDatabaseMigration,
+                                                     currentVersion);
     uint32_t newVersion = [self initializeDatabase:db fromVersion:currentVersion];
+    santa::EndSignpost(santa::SignpostPhase::kDatabaseMigration, signpost);
     // For debug builds, assert that the returned new version matches what is expected.
     // Version 0 is allowed since that means no upgrade was necessary.
     assert(newVersion == 0 || newVersion == [self currentSupportedVersion]);
@@ -129,14 +174,63 @@
     [db setUserVersion:newVersion];
   }];
 
-  // Vacuum the database to cleanup after version upgrades.
-  [self vacuum];
+  // Free pages are normally reclaimed by incremental vacuums, only rewrite the whole file if it's
+  // badly fragmented.
+  if ([self freePageRatio] >= kFullVacuumMinFreeRatio) {
+    [self vacuum];
+  }
 }
 
 - (void)inDatabase:(void (^)(FMDatabase* db))block {
   [self.dbQ inDatabase:block];
 }
 
+- (BOOL)enableReadPoolWithMaximumConnections:(NSUInteger)maxConnections {
+  NSString* path = self.dbQ.path;
+  if (!path.length || maxConnections == 0) return NO;
+
+  __block NSString* journalMode;
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    FMResultSet* rs = [db executeQuery:@"PRAGMA journal_mode=WAL"];
+    if ([rs next]) {
+      journalMode = [rs stringForColumnIndex:0];
+    }
+    [rs close];
+  }];
+
+  if ([journalMode caseInsensitiveCompare:@"wal"] != NSOrderedSame) {
+    LOGW(@"Unable to enable WAL mode for %@ (journal mode: %@)", path, journalMode);
+    return NO;
+  }
+
+  self.readPoolSema = dispatch_semaphore_create((long)maxConnections);
+  self.readPool = [FMDatabasePool databasePoolWithPath:path flags:SQLITE_OPEN_READONLY];
+  return YES;
+}
+
+- (void)inReadOnlyDatabase:(void (^)(FMDatabase* db))block {
+  FMDatabasePool* pool = self.readPool;
+  if (!pool) {
+    [self inDatabase:block];
+    return;
+  }
+
+  __block BOOL ran = NO;
+  dispatch_semaphore_wait(self.readPoolSema, DISPATCH_TIME_FOREVER);
+  [pool inDatabase:^(FMDatabase* db) {
+    if (db) {
+      ran = YES;
+      block(db);
+    }
+  }];
+  dispatch_semaphore_signal(self.readPoolSema);
+
+  // Fall back to the writer connection if a read-only connection couldn't be opened
+  if (!ran) {
+    [self inDatabase:block];
+  }
+}
+
 - (void)inTransaction:(void (^)(FMDatabase* db, BOOL* rollback))block {
   [self.dbQ inTransaction:block];
 }
@@ -147,4 +241,102 @@
   }];
 }
 
+- (double)freePageRatio {
+  __block double ratio = 0;
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    long pageCount = [db longForQuery:@"PRAGMA page_count"];
+    if (pageCount > 0) {
+      ratio = (double)[db longForQuery:@"PRAGMA freelist_count"] / pageCount;
+    }
+  }];
+  return ratio;
+}
+
+- (int64_t)sizeInBytes {
+  __block int64_t size = 0;
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    size = (int64_t)[db longForQuery:@"PRAGMA page_count"] * [db longForQuery:@"PRAGMA page_size"];
+  }];
+  return size;
+}
+
+- (int64_t)incrementalVacuumPages:(int64_t)pages {
+  __block int64_t freed = 0;
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    long before = [db longForQuery:@"PRAGMA freelist_count"];
+    [[db executeQuery:[NSString stringWithFormat:@"PRAGMA incremental_vacuum(%lld)", pages]]
+        close];
+    freed = before - [db longForQuery:@"PRAGMA freelist_count"];
+  }];
+  return freed;
+}
+
+- (void)scheduleIncrementalVacuumWithInterval:(uint64_t)intervalSeconds {
+  if (self.vacuumTimer || intervalSeconds == 0) return;
+
+  self.vacuumQueue = dispatch_queue_create(
+      "com.northpolesec.santa.database.vacuum",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_BACKGROUND, 0));
+  self.vacuumTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.vacuumQueue);
+
+  // Timer fires while the machine is on battery or busy coalesce into one check once it isn't
+  std::string jobName = std::string("vacuum_") + [self className].UTF8String;
+  uint64_t maxDelayNanos = intervalSeconds * NSEC_PER_SEC;
+  WEAKIFY(self);
+  dispatch_source_set_event_handler(self.vacuumTimer, ^{
+    STRONGIFY(self);
+    santa::BackgroundScheduler::Shared().Submit(jobName, maxDelayNanos, self.vacuumQueue, ^{
+      STRONGIFY(self);
+      [self vacuumIfIdleSerialized];
+    });
+  });
+  dispatch_source_set_timer(self.vacuumTimer,
+                            dispatch_time(DISPATCH_TIME_NOW, intervalSeconds * NSEC_PER_SEC),
+                            intervalSeconds * NSEC_PER_SEC, 10 * NSEC_PER_SEC);
+  dispatch_resume(self.vacuumTimer);
+}
+
+- (BOOL)shouldVacuumNow {
+  return !santa::BackgroundScheduler::CurrentConditions().ShouldDefer() &&
+         santa::PowerMonitor::SecondsSinceLastUserInput() >= kVacuumMinIdleSeconds;
+}
+
+- (void)vacuumIfIdleSerialized {
+  if (self.vacuumInProgress || ![self shouldVacuumNow]) return;
+
+  __block long freePages = 0;
+  __block long pageCount = 0;
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    freePages = [db longForQuery:@"PRAGMA freelist_count"];
+    pageCount = [db longForQuery:@"PRAGMA page_count"];
+  }];
+  if (pageCount == 0) return;
+
+  double ratio = (double)freePages / pageCount;
+  if (ratio >= kFullVacuumMinFreeRatio) {
+    LOGI(@"Vacuuming %@, %ld of %ld pages are free", [self className], freePages, pageCount);
+    [self vacuum];
+  } else if (freePages >= kIncrementalVacuumMinFreePages &&
+             ratio >= kIncrementalVacuumMinFreeRatio) {
+    self.vacuumInProgress = YES;
+    [self incrementalVacuumSliceSerialized];
+  }
+}
+
+- (void)incrementalVacuumSliceSerialized {
+  // Stop as soon as the machine is in use or on battery, the next timer fire picks up the rest.
+  if (![self shouldVacuumNow] ||
+      [self incrementalVacuumPages:kIncrementalVacuumSlicePages] < kIncrementalVacuumSlicePages) {
+    self.vacuumInProgress = NO;
+    return;
+  }
+
+  WEAKIFY(self);
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kIncrementalVacuumPauseNanos), self.vacuumQueue,
+                 ^{
+                   STRONGIFY(self);
+                   [self incrementalVacuumSliceSerialized];
+                 });
+}
+
 @end
@@ -40,6 +40,24 @@
 ///
 - (BOOL)addStoredEvents:(NSArray<SNTStoredEvent*>*)events;
 
+///
+///  Stage an event to be added to the database. Staged events are written together in a single
+///  transaction once enough events have been staged or shortly after the first one was staged,
+///  whichever comes first. Events with the same unique ID as an event that is already staged
+///  are dropped, as they would be when added to the database.
+///
+///  Staged events are always written before the table is read or modified by any other method.
+///
+///  @param event the event to store.
+///  @return YES if the event was staged.
+///
+- (BOOL)stageStoredEvent:(SNTStoredEvent*)event;
+
+///
+///  Write any staged events to the database.
+///
+- (void)flushStagedEvents;
+
 ///
 ///  Retrieves all events in the database
 ///
@@ -47,6 +65,19 @@
 ///
 - (NSArray*)pendingEvents;
 
+///
+///  Retrieves a page of events in the database, ordered by event ID.
+///
+///  To walk every event, start with a nil `idx` and then pass the ID of the last event on the
+///  previous page until a page with fewer than `limit` events is returned. Only one page of
+///  events is held in memory at a time.
+///
+///  @param idx only events with an ID greater than this are returned, or nil for the first page.
+///  @param limit the maximum number of events to return.
+///  @return NSArray of SNTStoredEvent's
+///
+- (NSArray<SNTStoredEvent*>*)pendingEventsAfterIndex:(NSNumber*)idx limit:(NSUInteger)limit;
+
 ///
 ///  Retrieves number of events in database without fetching every event.
 ///
@@ -15,7 +15,10 @@
 
 #import "Source/santad/DataLayer/SNTEventTable.h"
 
+#include <os/lock.h>
+
 #include <memory>
+#include <vector>
 
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/SNTLogging.h"
@@ -25,10 +28,35 @@
 #import "Source/common/SNTStoredTemporaryMonitorModeAuditEvent.h"
 #include "Source/common/SantaCache.h"
 #include "Source/common/String.h"
+#import "Source/santad/DataLayer/SNTStoredEventCodec.h"
 
-static const uint32_t kEventTableCurrentVersion = 5;
+static const uint32_t kEventTableCurrentVersion = 7;
 // 4 hour cache
 static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
+// Staged events are written once this many are waiting...
+static const size_t kMaxStagedEvents = 64;
+// ...or this long after the first one was staged.
+static const int64_t kStagedEventsFlushDelayMS = 250;
+
+// Inserts an event, or merges its occurrences into the pending event with the same unique ID
+static NSString* const kInsertEventStatement =
+    @"INSERT INTO 'events' (idx, uniqueid, eventdata, occurrences, lastseen) "
+    @"VALUES (?, ?, ?, ?, ?) "
+    @"ON CONFLICT(uniqueid) DO UPDATE SET "
+    @"occurrences = occurrences + excluded.occurrences, "
+    @"lastseen = MAX(IFNULL(lastseen, 0), excluded.lastseen)";
+
+namespace {
+
+struct StagedEvent {
+  NSNumber* idx;
+  NSString* uniqueID;
+  NSData* eventData;
+  uint64_t occurrences;
+  NSDate* lastOccurrenceDate;
+};
+
+}  // namespace
 
 @interface SNTEventTable ()
 // This property is only set once, safe to be nonatomic
@@ -37,6 +65,25 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
 
 @implementation SNTEventTable {
   std::unique_ptr<SantaCache<std::string, NSDate*>> _storeBackoff;
+
+  // Events waiting to be written, guarded by _stagedEventsLock
+  os_unfair_lock _stagedEventsLock;
+  std::vector<StagedEvent> _stagedEvents;
+  // Maps the unique ID of each staged event to its position in _stagedEvents
+  NSMutableDictionary<NSString*, NSNumber*>* _stagedEventPositions;
+  dispatch_queue_t _stagedEventsQueue;
+}
+
+- (instancetype)initWithDatabaseQueue:(FMDatabaseQueue*)db {
+  self = [super initWithDatabaseQueue:db];
+  if (self) {
+    _stagedEventsLock = OS_UNFAIR_LOCK_INIT;
+    _stagedEventPositions = [NSMutableDictionary dictionary];
+    _stagedEventsQueue = dispatch_queue_create(
+        "com.northpolesec.santa.eventtable.staging",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+  }
+  return self;
 }
 
 - (uint32_t)currentSupportedVersion {
@@ -99,6 +146,37 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
     newVersion = 5;
   }
 
+  if (version < 6) {
+    // Re-encode existing events with the compact encoding. Events that can't be represented
+    // there are left as keyed archives, both formats remain readable.
+    NSMutableDictionary<NSNumber*, NSData*>* reencoded = [NSMutableDictionary dictionary];
+    FMResultSet* rs = [db executeQuery:@"SELECT idx, eventdata FROM events"];
+    while ([rs next]) {
+      NSData* eventData = [rs dataForColumn:@"eventdata"];
+      if (!eventData || [SNTStoredEventCodec isCompactEncoding:eventData]) continue;
+
+      SNTStoredEvent* event = [self eventFromData:eventData];
+      NSData* compact = event ? [SNTStoredEventCodec encodeEvent:event] : nil;
+      if (compact) {
+        reencoded[[rs objectForColumn:@"idx"]] = compact;
+      }
+    }
+    [rs close];
+
+    [reencoded enumerateKeysAndObjectsUsingBlock:^(NSNumber* idx, NSData* data, BOOL* stop) {
+      [db executeUpdate:@"UPDATE events SET eventdata=? WHERE idx=?", data, idx];
+    }];
+    newVersion = 6;
+  }
+
+  if (version < 7) {
+    // Count the occurrences merged into each event by the unique index, along with the time of
+    // the most recent one.
+    [db executeUpdate:@"ALTER TABLE events ADD COLUMN occurrences INTEGER NOT NULL DEFAULT 1"];
+    [db executeUpdate:@"ALTER TABLE events ADD COLUMN lastseen REAL"];
+    newVersion = 7;
+  }
+
   return newVersion;
 }
 
@@ -126,6 +204,9 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
 }
 
 - (BOOL)addStoredEvents:(NSArray<SNTStoredEvent*>*)events {
+  // Staged events were recorded first, so they must also be written first
+  [self flushStagedEvents];
+
   NSMutableDictionary* eventsData = [NSMutableDictionary dictionaryWithCapacity:events.count];
   for (SNTStoredEvent* event in events) {
     if (![self isValidStoredEvent:event]) {
@@ -136,9 +217,7 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
       continue;
     }
 
-    NSData* eventData = [NSKeyedArchiver archivedDataWithRootObject:event
-                                              requiringSecureCoding:YES
-                                                              error:nil];
+    NSData* eventData = [self dataForEvent:event];
     if (eventData) {
       eventsData[eventData] = event;
     }
@@ -148,10 +227,9 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
   [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
     [eventsData
         enumerateKeysAndObjectsUsingBlock:^(NSData* eventData, SNTStoredEvent* event, BOOL* stop) {
-          success = [db executeUpdate:@"INSERT INTO 'events' (idx, uniqueid, eventdata) "
-                                      @"VALUES (?, ?, ?) "
-                                      @"ON CONFLICT(uniqueid) DO NOTHING",
-                                      event.idx, [event uniqueID], eventData];
+          success = [db executeUpdate:kInsertEventStatement, event.idx, [event uniqueID],
+                                      eventData, @(1),
+                                      @(event.occurrenceDate.timeIntervalSince1970)];
           if (!success) *stop = YES;
         }];
   }];
@@ -159,6 +237,89 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
   return success;
 }
 
+- (BOOL)stageStoredEvent:(SNTStoredEvent*)event {
+  if (![self isValidStoredEvent:event]) {
+    return NO;
+  }
+
+  if ([event unactionableEvent] && [self backoffForPrimaryHash:[event uniqueID]]) {
+    return NO;
+  }
+
+  // Encode now, the caller is free to modify the event once it has been staged
+  NSData* eventData = [self dataForEvent:event];
+  if (!eventData) {
+    return NO;
+  }
+
+  NSString* uniqueID = [event uniqueID];
+  size_t stagedCount = 0;
+
+  os_unfair_lock_lock(&_stagedEventsLock);
+  NSNumber* position = _stagedEventPositions[uniqueID];
+  if (position) {
+    StagedEvent& staged = _stagedEvents[position.unsignedLongValue];
+    staged.occurrences++;
+    staged.lastOccurrenceDate = event.occurrenceDate;
+  } else {
+    _stagedEventPositions[uniqueID] = @(_stagedEvents.size());
+    _stagedEvents.push_back({.idx = event.idx,
+                             .uniqueID = uniqueID,
+                             .eventData = eventData,
+                             .occurrences = 1,
+                             .lastOccurrenceDate = event.occurrenceDate});
+    stagedCount = _stagedEvents.size();
+  }
+  os_unfair_lock_unlock(&_stagedEventsLock);
+
+  __weak SNTEventTable* weakSelf = self;
+  if (stagedCount == kMaxStagedEvents) {
+    dispatch_async(_stagedEventsQueue, ^{
+      [weakSelf flushStagedEvents];
+    });
+  } else if (stagedCount == 1) {
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kStagedEventsFlushDelayMS * NSEC_PER_MSEC),
+                   _stagedEventsQueue, ^{
+                     [weakSelf flushStagedEvents];
+                   });
+  }
+
+  return YES;
+}
+
+- (NSData*)dataForEvent:(SNTStoredEvent*)event {
+  NSData* eventData = [SNTStoredEventCodec encodeEvent:event];
+  if (eventData) return eventData;
+
+  return [NSKeyedArchiver archivedDataWithRootObject:event requiringSecureCoding:YES error:nil];
+}
+
+- (void)flushStagedEvents {
+  os_unfair_lock_lock(&_stagedEventsLock);
+  BOOL haveStagedEvents = !_stagedEvents.empty();
+  os_unfair_lock_unlock(&_stagedEventsLock);
+
+  if (!haveStagedEvents) return;
+
+  [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
+    // Take the staged events from inside the transaction. Any DB block that runs after another
+    // caller found staged events is then guaranteed to see them in the table.
+    std::vector<StagedEvent> events;
+    os_unfair_lock_lock(&self->_stagedEventsLock);
+    events.swap(self->_stagedEvents);
+    [self->_stagedEventPositions removeAllObjects];
+    os_unfair_lock_unlock(&self->_stagedEventsLock);
+
+    for (const StagedEvent& event : events) {
+      if (![db executeUpdate:kInsertEventStatement, event.idx, event.uniqueID, event.eventData,
+                             @(event.occurrences),
+                             @(event.lastOccurrenceDate.timeIntervalSince1970)]) {
+        LOGW(@"Unable to store staged event %@: %@", event.uniqueID, [db lastErrorMessage]);
+      }
+    }
+  }];
+}
+
 - (BOOL)backoffForPrimaryHash:(NSString*)hash {
   NSDate* backoff = _storeBackoff->get(santa::NSStringToUTF8String(hash));
   NSDate* now = [NSDate date];
@@ -174,6 +335,7 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
 #pragma mark Querying/Retreiving
 
 - (NSUInteger)pendingEventsCount {
+  [self flushStagedEvents];
   __block NSUInteger eventsPending = 0;
   [self inDatabase:^(FMDatabase* db) {
     eventsPending = [db intForQuery:@"SELECT COUNT(*) FROM events"];
@@ -182,14 +344,16 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
 }
 
 - (NSArray*)pendingEvents {
+  [self flushStagedEvents];
   NSMutableArray* pendingEvents = [[NSMutableArray alloc] init];
 
   [self inDatabase:^(FMDatabase* db) {
     FMResultSet* rs = [db executeQuery:@"SELECT * FROM events"];
 
     while ([rs next]) {
-      id obj = [self eventFromResultSet:rs];
+      SNTStoredEvent* obj = [self eventFromResultSet:rs];
       if (obj) {
+        [self applyOccurrencesFromResultSet:rs toEvent:obj];
         [pendingEvents addObject:obj];
       } else {
         [db executeUpdate:@"DELETE FROM events WHERE idx=?", [rs objectForColumn:@"idx"]];
@@ -202,10 +366,69 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
   return pendingEvents;
 }
 
+- (NSArray<SNTStoredEvent*>*)pendingEventsAfterIndex:(NSNumber*)idx limit:(NSUInteger)limit {
+  [self flushStagedEvents];
+  NSMutableArray* pendingEvents = [NSMutableArray arrayWithCapacity:limit];
+
+  [self inDatabase:^(FMDatabase* db) {
+    // Rows that fail to decode are deleted. Keep going until the page is full so a run of
+    // corrupt rows isn't mistaken for the end of the table.
+    NSNumber* cursor = idx ?: @(INT64_MIN);
+    while (pendingEvents.count < limit) {
+      NSUInteger remaining = limit - pendingEvents.count;
+      NSMutableArray* corruptIDs = [NSMutableArray array];
+      NSUInteger rows = 0;
+
+      FMResultSet* rs = [db executeQuery:@"SELECT * FROM events WHERE idx > ? ORDER BY idx LIMIT ?",
+                                         cursor, @(remaining)];
+      while ([rs next]) {
+        rows++;
+        cursor = [rs objectForColumn:@"idx"];
+        SNTStoredEvent* obj = [self eventFromResultSet:rs];
+        if (obj) {
+          [self applyOccurrencesFromResultSet:rs toEvent:obj];
+          [pendingEvents addObject:obj];
+        } else {
+          [corruptIDs addObject:cursor];
+        }
+      }
+      [rs close];
+
+      for (NSNumber* corruptID in corruptIDs) {
+        [db executeUpdate:@"DELETE FROM events WHERE idx=?", corruptID];
+      }
+
+      if (rows < remaining) break;
+    }
+  }];
+
+  return pendingEvents;
+}
+
 - (SNTStoredEvent*)eventFromResultSet:(FMResultSet*)rs {
   NSData* eventData = [rs dataNoCopyForColumn:@"eventdata"];
   if (!eventData) return nil;
 
+  SNTStoredEvent* event = [self eventFromData:eventData];
+  return [self isValidStoredEvent:event] ? event : nil;
+}
+
+- (void)applyOccurrencesFromResultSet:(FMResultSet*)rs toEvent:(SNTStoredEvent*)event {
+  unsigned long long occurrences = [rs unsignedLongLongIntForColumn:@"occurrences"];
+  event.occurrenceCount = occurrences > 0 ? (NSUInteger)occurrences : 1;
+  if (event.occurrenceCount > 1 && ![rs columnIsNull:@"lastseen"]) {
+    event.lastOccurrenceDate =
+        [NSDate dateWithTimeIntervalSince1970:[rs doubleForColumn:@"lastseen"]];
+  }
+}
+
+- (SNTStoredEvent*)eventFromData:(NSData*)eventData {
+  if ([SNTStoredEventCodec isCompactEncoding:eventData]) {
+    SNTStoredEvent* event = [SNTStoredEventCodec decodeEventData:eventData];
+    if (!event) LOGW(@"Unable to decode stored event");
+    return event;
+  }
+
   static NSSet* allowedClasses =
       [NSSet setWithObjects:[SNTStoredExecutionEvent class], [SNTStoredFileAccessEvent class],
                             [SNTStoredTemporaryMonitorModeAuditEvent class],
@@ -215,24 +438,24 @@ static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
   SNTStoredEvent* event = [NSKeyedUnarchiver unarchivedObjectOfClasses:allowedClasses
                                                               fromData:eventData
                                                                  error:&err];
-
-  if (event && !err && [self isValidStoredEvent:event]) {
-    return event;
-  } else {
+  if (!event || err) {
     LOGW(@"Unable to unarchive stored event: %@", err);
     return nil;
   }
+  return event;
 }
 
 #pragma mark Deleting
 
 - (void)deleteEventWithId:(NSNumber*)index {
+  [self flushStagedEvents];
   [self inDatabase:^(FMDatabase* db) {
     [db executeUpdate:@"DELETE FROM events WHERE idx=?", index];
   }];
 }
 
 - (void)deleteEventsWithIds:(NSArray*)indexes {
+  [self flushStagedEvents];
   [self inDatabase:^(FMDatabase* db) {
     for (NSNumber* index in indexes) {
       [db executeUpdate:@"DELETE FROM events WHERE idx=?", index];
@@ -26,6 +26,7 @@
 #import "Source/common/SNTStoredFileAccessEvent.h"
 #import "Source/common/SNTStoredTemporaryMonitorModeAuditEvent.h"
 #include "Source/common/TestUtils.h"
+#import "Source/santad/DataLayer/SNTStoredEventCodec.h"
 
 NSString* GenerateRandomHexStringWithSHA256Length() {
   // Create an array to hold random bytes
@@ -262,6 +263,117 @@ NSString* GenerateRandomHexStringWithSHA256Length() {
   XCTAssertEqual(self.sut.pendingEventsCount, 1);
 }
 
+// Count the events in the table without flushing staged events
+- (int)storedEventCount {
+  __block int count = 0;
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    count = [db intForQuery:@"SELECT COUNT(*) FROM events"];
+  }];
+  return count;
+}
+
+- (void)testStageEvent {
+  SNTStoredExecutionEvent* event = [self createTestEvent];
+  NSString* sha256 = event.fileSHA256;
+  XCTAssertTrue([self.sut stageStoredEvent:event]);
+
+  // Events with the same unique ID are merged while staged
+  SNTStoredExecutionEvent* duplicate = [self createTestEvent];
+  duplicate.fileSHA256 = sha256;
+  XCTAssertTrue([self.sut stageStoredEvent:duplicate]);
+
+  // Staged events are archived immediately so later changes are not stored
+  event.fileSHA256 = GenerateRandomHexStringWithSHA256Length();
+
+  XCTAssertTrue([self.sut stageStoredEvent:[self createTestFileAccessEvent]]);
+  XCTAssertFalse([self.sut stageStoredEvent:[[SNTStoredExecutionEvent alloc] init]]);
+
+  // Reading the table writes staged events first
+  NSArray* events = [self.sut pendingEvents];
+  XCTAssertEqual(events.count, 2);
+  for (SNTStoredEvent* e in events) {
+    if ([e isKindOfClass:[SNTStoredExecutionEvent class]]) {
+      XCTAssertEqualObjects(((SNTStoredExecutionEvent*)e).fileSHA256, sha256);
+      XCTAssertEqual(e.occurrenceCount, 2);
+      XCTAssertEqualWithAccuracy(e.lastOccurrenceDate.timeIntervalSince1970,
+                                 duplicate.occurrenceDate.timeIntervalSince1970, 0.001);
+    } else {
+      XCTAssertEqual(e.occurrenceCount, 1);
+      XCTAssertNil(e.lastOccurrenceDate);
+    }
+  }
+}
+
+- (void)testOccurrencesAreCounted {
+  SNTStoredExecutionEvent* event = [self createTestEvent];
+  XCTAssertTrue([self.sut addStoredEvent:event]);
+
+  // Repeats are merged into the pending event, whether added directly or staged
+  SNTStoredExecutionEvent* repeat = [self createTestEvent];
+  repeat.fileSHA256 = event.fileSHA256;
+  repeat.occurrenceDate = [event.occurrenceDate dateByAddingTimeInterval:60];
+  XCTAssertTrue([self.sut addStoredEvent:repeat]);
+
+  SNTStoredExecutionEvent* stagedRepeat = [self createTestEvent];
+  stagedRepeat.fileSHA256 = event.fileSHA256;
+  stagedRepeat.occurrenceDate = [event.occurrenceDate dateByAddingTimeInterval:120];
+  XCTAssertTrue([self.sut stageStoredEvent:stagedRepeat]);
+
+  NSArray<SNTStoredEvent*>* events = [self.sut pendingEvents];
+  XCTAssertEqual(events.count, 1);
+  SNTStoredEvent* stored = events.firstObject;
+  XCTAssertEqualObjects(stored.idx, event.idx);
+  XCTAssertEqual(stored.occurrenceCount, 3);
+  XCTAssertEqualWithAccuracy([stored.occurrenceDate timeIntervalSinceDate:event.occurrenceDate], 0,
+                             0.001);
+  XCTAssertEqualWithAccuracy(
+      [stored.lastOccurrenceDate timeIntervalSinceDate:stagedRepeat.occurrenceDate], 0, 0.001);
+
+  // Counts survive the trip to santasyncservice
+  NSData* archived = [NSKeyedArchiver archivedDataWithRootObject:stored
+                                           requiringSecureCoding:YES
+                                                           error:nil];
+  SNTStoredEvent* unarchived =
+      [NSKeyedUnarchiver unarchivedObjectOfClass:[SNTStoredExecutionEvent class]
+                                        fromData:archived
+                                           error:nil];
+  XCTAssertEqual(unarchived.occurrenceCount, 3);
+  XCTAssertEqualObjects(unarchived.lastOccurrenceDate, stored.lastOccurrenceDate);
+}
+
+- (void)testStagedEventsBackoff {
+  SNTStoredExecutionEvent* event = [self createTestEvent];
+  // Make this an "unactionable" event
+  event.decision = SNTEventStateAllowBinary;
+  XCTAssertTrue([self.sut stageStoredEvent:event]);
+  XCTAssertEqual(self.sut.pendingEventsCount, 1);
+
+  [self.sut deleteEventWithId:event.idx];
+  event.idx = @(arc4random());
+  XCTAssertFalse([self.sut stageStoredEvent:event]);
+  XCTAssertFalse([self.sut addStoredEvent:event]);
+  XCTAssertEqual(self.sut.pendingEventsCount, 0);
+}
+
+- (void)testStagedEventsAreFlushed {
+  // A single staged event is written after a short delay
+  XCTAssertTrue([self.sut stageStoredEvent:[self createTestEvent]]);
+  XCTAssertEqual([self storedEventCount], 0);
+  SleepMS(1000);
+  XCTAssertEqual([self storedEventCount], 1);
+
+  // A full batch is written without waiting for the delay
+  NSMutableArray* events = [NSMutableArray array];
+  for (int i = 0; i < 64; i++) {
+    [events addObject:[self createTestEvent]];
+  }
+  for (SNTStoredEvent* event in events) {
+    XCTAssertTrue([self.sut stageStoredEvent:event]);
+  }
+  SleepMS(100);
+  XCTAssertEqual([self storedEventCount], 65);
+}
+
 - (void)testRetrieveExecutionEvent {
   SNTStoredExecutionEvent* event = [self createTestEvent];
   [self.sut addStoredEvent:event];
@@ -387,6 +499,95 @@ NSString* GenerateRandomHexStringWithSHA256Length() {
   }];
 }
 
+- (NSArray<NSData*>*)storedEventData {
+  NSMutableArray<NSData*>* data = [NSMutableArray array];
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    FMResultSet* rs = [db executeQuery:@"SELECT eventdata FROM events ORDER BY idx"];
+    while ([rs next]) {
+      [data addObject:[rs dataForColumn:@"eventdata"]];
+    }
+    [rs close];
+  }];
+  return data;
+}
+
+- (void)testEventsUseCompactEncoding {
+  [self.sut addStoredEvents:@[
+    [self createTestEvent], [self createTestFileAccessEvent],
+    [self createTestTemporaryMonitorModeEnterAuditEvent]
+  ]];
+  XCTAssert([self.sut stageStoredEvent:[self createTestEvent]]);
+  [self.sut flushStagedEvents];
+
+  NSArray<NSData*>* data = [self storedEventData];
+  XCTAssertEqual(data.count, 4);
+  for (NSData* eventData in data) {
+    XCTAssertTrue([SNTStoredEventCodec isCompactEncoding:eventData]);
+  }
+  XCTAssertEqual([self.sut pendingEvents].count, 4);
+}
+
+- (void)testMigrationReencodesArchivedEvents {
+  SNTStoredExecutionEvent* event = [self createTestEvent];
+  NSData* archived = [NSKeyedArchiver archivedDataWithRootObject:event
+                                           requiringSecureCoding:YES
+                                                           error:nil];
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    [db executeUpdate:@"INSERT INTO events (idx, uniqueid, eventdata) VALUES (?, ?, ?)",
+                      event.idx, [event uniqueID], archived];
+    [db setUserVersion:5];
+  }];
+
+  // Re-opening the table runs the migration from v5
+  XCTAssertFalse([SNTStoredEventCodec isCompactEncoding:[self storedEventData].firstObject]);
+
+  self.sut = [[SNTEventTable alloc] initWithDatabaseQueue:self.dbq];
+  XCTAssertEqual([self.sut currentVersion], 7);
+  XCTAssertTrue([SNTStoredEventCodec isCompactEncoding:[self storedEventData].firstObject]);
+
+  SNTStoredExecutionEvent* storedEvent = [self.sut pendingEvents].firstObject;
+  XCTAssertEqualObjects(storedEvent.idx, event.idx);
+  XCTAssertEqualObjects(storedEvent.fileSHA256, event.fileSHA256);
+  XCTAssertEqualObjects(storedEvent.signingChain, event.signingChain);
+  XCTAssertEqualObjects(storedEvent.currentSessions, event.currentSessions);
+}
+
+- (void)testPendingEventsPagination {
+  NSMutableSet* added = [NSMutableSet set];
+  for (int i = 0; i < 7; i++) {
+    SNTStoredExecutionEvent* event = [self createTestEvent];
+    XCTAssertTrue([self.sut addStoredEvent:event]);
+    [added addObject:event.idx];
+  }
+
+  // Corrupt rows are removed without cutting a page short
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    [db executeUpdate:@"INSERT INTO events (idx, uniqueid, eventdata) VALUES (?, 'a', x'00')",
+                      @(INT32_MIN)];
+    [db executeUpdate:@"INSERT INTO events (idx, uniqueid, eventdata) VALUES (?, 'b', x'00')",
+                      @(INT32_MIN + 1)];
+  }];
+
+  NSMutableSet* seen = [NSMutableSet set];
+  NSNumber* cursor;
+  NSArray<SNTStoredEvent*>* page;
+  int pages = 0;
+  do {
+    page = [self.sut pendingEventsAfterIndex:cursor limit:3];
+    pages++;
+    for (SNTStoredEvent* event in page) {
+      XCTAssertFalse([seen containsObject:event.idx]);
+      XCTAssertGreaterThan([event.idx compare:cursor ?: @(INT64_MIN)], NSOrderedSame);
+      [seen addObject:event.idx];
+    }
+    cursor = page.lastObject.idx;
+  } while (page.count == 3);
+
+  XCTAssertEqualObjects(seen, added);
+  XCTAssertEqual(pages, 3);
+  XCTAssertEqual(self.sut.pendingEventsCount, 7);
+}
+
 - (NSData*)dataFromFixture:(NSString*)file {
   NSString* path = [[NSBundle bundleForClass:[self class]] pathForResource:file ofType:nil];
   XCTAssertNotNil(path, @"failed to load testdata: %@", file);
@@ -416,4 +617,25 @@ NSString* GenerateRandomHexStringWithSHA256Length() {
   XCTAssertNotNil([self.sut eventFromResultSet:mockResultSet]);
 }
 
+- (void)testIncrementalVacuum {
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    XCTAssertEqual([db longForQuery:@"PRAGMA auto_vacuum"], 2);
+
+    XCTAssertTrue([db executeUpdate:@"CREATE TABLE filler (data BLOB)"]);
+    NSData* data = [NSMutableData dataWithLength:4096];
+    for (int i = 0; i < 500; i++) {
+      XCTAssertTrue([db executeUpdate:@"INSERT INTO filler (data) VALUES (?)", data]);
+    }
+    XCTAssertTrue([db executeUpdate:@"DELETE FROM filler"]);
+  }];
+
+  // Deleted rows are left as free pages until they're reclaimed
+  XCTAssertGreaterThan([self.sut freePageRatio], 0.5);
+
+  XCTAssertEqual([self.sut incrementalVacuumPages:100], 100);
+  while ([self.sut incrementalVacuumPages:100] > 0) {
+  }
+  XCTAssertEqual([self.sut freePageRatio], 0);
+}
+
 @end
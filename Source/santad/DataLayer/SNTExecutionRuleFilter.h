@@ -0,0 +1,39 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTRuleIdentifiers.h"
+
+/// Immutable Bloom filters over the identifiers of each execution rule type. An identifier the
+/// filter reports absent definitely has no rule of that type; one reported present may or may
+/// not. Lookups only read the filters, so a filter can be shared freely between threads.
+@interface SNTExecutionRuleFilter : NSObject
+
+/// Build a filter over the given identifiers, keyed by rule type. Unsupported types are ignored.
++ (instancetype)filterWithIdentifiersByType:
+    (NSDictionary<NSNumber*, NSArray<NSString*>*>*)identifiersByType;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns NO if there is definitely no rule of the given type for the identifier.
+- (BOOL)mayContainIdentifier:(NSString*)identifier ruleType:(SNTRuleType)type;
+
+/// Clears each identifier that definitely has no rule of its type. Returns NO if none are left,
+/// in which case no rule can match.
+- (BOOL)filterIdentifiers:(struct RuleIdentifiers*)identifiers;
+
+@end
@@ -0,0 +1,129 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santad/DataLayer/SNTExecutionRuleFilter.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Source/common/SNTXxhash.h"
+
+namespace {
+
+// About 1% false positives at 10 bits per identifier with 7 probes
+constexpr uint64_t kBitsPerIdentifier = 10;
+constexpr int kProbes = 7;
+
+class BloomFilter {
+ public:
+  explicit BloomFilter(NSArray<NSString*>* identifiers) {
+    if (identifiers.count == 0) return;
+
+    // Round up to a power of two so probes can be masked rather than divided
+    uint64_t bits = 64;
+    while (bits < identifiers.count * kBitsPerIdentifier) {
+      bits <<= 1;
+    }
+    mask_ = bits - 1;
+    words_.resize(bits / 64);
+
+    for (NSString* identifier in identifiers) {
+      ForEachProbe(identifier, [this](uint64_t bit) { words_[bit / 64] |= 1ull << (bit % 64); });
+    }
+  }
+
+  bool MayContain(NSString* identifier) const {
+    if (words_.empty() || !identifier) return false;
+
+    bool present = true;
+    ForEachProbe(identifier, [this, &present](uint64_t bit) {
+      present = present && (words_[bit / 64] & (1ull << (bit % 64)));
+    });
+    return present;
+  }
+
+ private:
+  // Probes are derived from one 128-bit hash by double hashing
+  template <typename F>
+  void ForEachProbe(NSString* identifier, F f) const {
+    const char* str = identifier.UTF8String;
+    XXH128_hash_t hash = XXH3_128bits(str, strlen(str));
+    uint64_t h2 = hash.high64 | 1;
+    for (int i = 0; i < kProbes; i++) {
+      f((hash.low64 + i * h2) & mask_);
+    }
+  }
+
+  uint64_t mask_ = 0;
+  std::vector<uint64_t> words_;
+};
+
+// Filters are stored in rule precedence order
+constexpr std::array<SNTRuleType, 5> kRuleTypes = {SNTRuleTypeCDHash, SNTRuleTypeBinary,
+                                                    SNTRuleTypeSigningID, SNTRuleTypeCertificate,
+                                                    SNTRuleTypeTeamID};
+
+}  // namespace
+
+@implementation SNTExecutionRuleFilter {
+  std::vector<BloomFilter> _filters;
+}
+
++ (instancetype)filterWithIdentifiersByType:
+    (NSDictionary<NSNumber*, NSArray<NSString*>*>*)identifiersByType {
+  return [[self alloc] initWithIdentifiersByType:identifiersByType];
+}
+
+- (instancetype)initWithIdentifiersByType:
+    (NSDictionary<NSNumber*, NSArray<NSString*>*>*)identifiersByType {
+  self = [super init];
+  if (self) {
+    _filters.reserve(kRuleTypes.size());
+    for (SNTRuleType type : kRuleTypes) {
+      _filters.emplace_back(identifiersByType[@(type)]);
+    }
+  }
+  return self;
+}
+
+- (BOOL)mayContainIdentifier:(NSString*)identifier ruleType:(SNTRuleType)type {
+  for (size_t i = 0; i < kRuleTypes.size(); i++) {
+    if (kRuleTypes[i] == type) {
+      return _filters[i].MayContain(identifier);
+    }
+  }
+  return NO;
+}
+
+- (BOOL)filterIdentifiers:(struct RuleIdentifiers*)identifiers {
+  NSString* __strong* fields[] = {&identifiers->cdhash, &identifiers->binarySHA256,
+                                  &identifiers->signingID, &identifiers->certificateSHA256,
+                                  &identifiers->teamID};
+  static_assert(sizeof(fields) / sizeof(fields[0]) == kRuleTypes.size());
+
+  BOOL remaining = NO;
+  for (size_t i = 0; i < kRuleTypes.size(); i++) {
+    if (!_filters[i].MayContain(*fields[i])) {
+      *fields[i] = nil;
+    } else {
+      remaining = YES;
+    }
+  }
+  return remaining;
+}
+
+@end
@@ -0,0 +1,76 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santad/DataLayer/SNTExecutionRuleFilter.h"
+
+#import <XCTest/XCTest.h>
+
+@interface SNTExecutionRuleFilterTest : XCTestCase
+@end
+
+@implementation SNTExecutionRuleFilterTest
+
+- (NSArray<NSString*>*)identifiersWithPrefix:(NSString*)prefix count:(int)count {
+  NSMutableArray* identifiers = [NSMutableArray arrayWithCapacity:count];
+  for (int i = 0; i < count; i++) {
+    [identifiers addObject:[NSString stringWithFormat:@"%@%064d", prefix, i]];
+  }
+  return identifiers;
+}
+
+- (void)testNoFalseNegatives {
+  NSArray* present = [self identifiersWithPrefix:@"binary" count:10000];
+  SNTExecutionRuleFilter* sut =
+      [SNTExecutionRuleFilter filterWithIdentifiersByType:@{@(SNTRuleTypeBinary) : present}];
+
+  int falsePositives = 0;
+  for (NSString* identifier in present) {
+    XCTAssertTrue([sut mayContainIdentifier:identifier ruleType:SNTRuleTypeBinary]);
+    // Nothing was added for other types
+    XCTAssertFalse([sut mayContainIdentifier:identifier ruleType:SNTRuleTypeTeamID]);
+  }
+  for (NSString* identifier in [self identifiersWithPrefix:@"absent" count:10000]) {
+    if ([sut mayContainIdentifier:identifier ruleType:SNTRuleTypeBinary]) falsePositives++;
+  }
+  // About 1% are expected
+  XCTAssertLessThan(falsePositives, 300);
+}
+
+- (void)testFilterIdentifiers {
+  SNTExecutionRuleFilter* sut = [SNTExecutionRuleFilter filterWithIdentifiersByType:@{
+    @(SNTRuleTypeSigningID) : @[ @"ABCDEFGHIJ:com.example" ],
+    @(SNTRuleTypeTeamID) : @[ @"ABCDEFGHIJ" ],
+  }];
+
+  struct RuleIdentifiers ids = {
+      .cdhash = @"cdhash",
+      .binarySHA256 = @"sha256",
+      .signingID = @"ABCDEFGHIJ:com.example",
+      .certificateSHA256 = @"cert",
+      .teamID = @"KLMNOPQRST",
+  };
+  XCTAssertTrue([sut filterIdentifiers:&ids]);
+  XCTAssertNil(ids.cdhash);
+  XCTAssertNil(ids.binarySHA256);
+  XCTAssertEqualObjects(ids.signingID, @"ABCDEFGHIJ:com.example");
+  XCTAssertNil(ids.certificateSHA256);
+  XCTAssertNil(ids.teamID);
+
+  ids.signingID = @"ABCDEFGHIJ:com.example.other";
+  XCTAssertFalse([sut filterIdentifiers:&ids]);
+  XCTAssertNil(ids.signingID);
+}
+
+@end
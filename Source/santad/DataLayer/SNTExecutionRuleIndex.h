@@ -0,0 +1,40 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+#import "Source/common/SNTRule.h"
+#import "Source/common/SNTRuleIdentifiers.h"
+
+/// Immutable in-memory index of execution rules, keyed by identifier for each rule type.
+/// Lookups only probe dictionaries, so an index can be shared freely between threads.
+@interface SNTExecutionRuleIndex : NSObject
+
+/// Build an index from the given rules. Rules with unsupported types are ignored.
++ (instancetype)indexWithRules:(NSArray<SNTRule*>*)rules;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns the highest precedence rule matching the identifiers, using the same order
+/// as the rules database: CDHash > Binary > Signing ID > Certificate > Team ID.
+- (SNTRule*)ruleForIdentifiers:(struct RuleIdentifiers)identifiers;
+
+/// Number of rules of the given type in the index
+- (NSUInteger)countForRuleType:(SNTRuleType)type;
+
+/// Total number of rules in the index
+@property(readonly) NSUInteger count;
+
+@end
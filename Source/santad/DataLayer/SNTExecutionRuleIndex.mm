@@ -0,0 +1,102 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santad/DataLayer/SNTExecutionRuleIndex.h"
+
+#import "Source/common/SNTCommonEnums.h"
+
+@interface SNTExecutionRuleIndex ()
+@property(readonly, nonatomic) NSDictionary<NSString*, SNTRule*>* cdhashRules;
+@property(readonly, nonatomic) NSDictionary<NSString*, SNTRule*>* binaryRules;
+@property(readonly, nonatomic) NSDictionary<NSString*, SNTRule*>* signingIDRules;
+@property(readonly, nonatomic) NSDictionary<NSString*, SNTRule*>* certificateRules;
+@property(readonly, nonatomic) NSDictionary<NSString*, SNTRule*>* teamIDRules;
+@end
+
+@implementation SNTExecutionRuleIndex
+
++ (instancetype)indexWithRules:(NSArray<SNTRule*>*)rules {
+  return [[self alloc] initWithRules:rules];
+}
+
+- (instancetype)initWithRules:(NSArray<SNTRule*>*)rules {
+  self = [super init];
+  if (self) {
+    NSMutableDictionary* cdhashRules = [NSMutableDictionary dictionary];
+    NSMutableDictionary* binaryRules = [NSMutableDictionary dictionary];
+    NSMutableDictionary* signingIDRules = [NSMutableDictionary dictionary];
+    NSMutableDictionary* certificateRules = [NSMutableDictionary dictionary];
+    NSMutableDictionary* teamIDRules = [NSMutableDictionary dictionary];
+
+    for (SNTRule* rule in rules) {
+      if (!rule.identifier) continue;
+
+      switch (rule.type) {
+        case SNTRuleTypeCDHash: cdhashRules[rule.identifier] = rule; break;
+        case SNTRuleTypeBinary: binaryRules[rule.identifier] = rule; break;
+        case SNTRuleTypeSigningID: signingIDRules[rule.identifier] = rule; break;
+        case SNTRuleTypeCertificate: certificateRules[rule.identifier] = rule; break;
+        case SNTRuleTypeTeamID: teamIDRules[rule.identifier] = rule; break;
+        default: continue;
+      }
+    }
+
+    _cdhashRules = [cdhashRules copy];
+    _binaryRules = [binaryRules copy];
+    _signingIDRules = [signingIDRules copy];
+    _certificateRules = [certificateRules copy];
+    _teamIDRules = [teamIDRules copy];
+    _count = cdhashRules.count + binaryRules.count + signingIDRules.count +
+             certificateRules.count + teamIDRules.count;
+  }
+  return self;
+}
+
+- (SNTRule*)ruleForIdentifiers:(struct RuleIdentifiers)identifiers {
+  SNTRule* rule;
+
+  // IMPORTANT: Keep this order in sync with the query in SNTRuleTable.
+  if (identifiers.cdhash && (rule = self.cdhashRules[identifiers.cdhash])) {
+    return rule;
+  }
+  if (identifiers.binarySHA256 && (rule = self.binaryRules[identifiers.binarySHA256])) {
+    return rule;
+  }
+  if (identifiers.signingID && (rule = self.signingIDRules[identifiers.signingID])) {
+    return rule;
+  }
+  if (identifiers.certificateSHA256 &&
+      (rule = self.certificateRules[identifiers.certificateSHA256])) {
+    return rule;
+  }
+  if (identifiers.teamID && (rule = self.teamIDRules[identifiers.teamID])) {
+    return rule;
+  }
+
+  return nil;
+}
+
+- (NSUInteger)countForRuleType:(SNTRuleType)type {
+  switch (type) {
+    case SNTRuleTypeCDHash: return self.cdhashRules.count;
+    case SNTRuleTypeBinary: return self.binaryRules.count;
+    case SNTRuleTypeSigningID: return self.signingIDRules.count;
+    case SNTRuleTypeCertificate: return self.certificateRules.count;
+    case SNTRuleTypeTeamID: return self.teamIDRules.count;
+    default: return 0;
+  }
+}
+
+@end
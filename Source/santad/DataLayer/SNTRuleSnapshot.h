@@ -0,0 +1,54 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+#import "Source/common/SNTRule.h"
+#import "Source/common/SNTRuleIdentifiers.h"
+
+/// Read-only, memory-mapped snapshot of the execution rules table.
+///
+/// The file holds one sorted array per rule type. Binary, certificate and CDHash rules are keyed
+/// by their raw hash bytes in fixed-width entries, signing ID and team ID rules by references
+/// into a shared string table. Lookups binary search the arrays directly in the mapping.
+///
+/// Each snapshot records the execution rules hash and a hash of transitive rules at the time it
+/// was written, callers must compare these with the database before trusting its contents.
+@interface SNTRuleSnapshot : NSObject
+
+/// Write the given rules to a new snapshot at path, replacing any existing file atomically.
++ (BOOL)writeRules:(NSArray<SNTRule*>*)rules
+    executionRulesHash:(NSString*)executionRulesHash
+    transitiveRulesHash:(NSString*)transitiveRulesHash
+                 toPath:(NSString*)path
+                  error:(NSError**)error;
+
+/// Map an existing snapshot. Returns nil if the file is missing, truncated or was written by
+/// an incompatible version of santad.
++ (instancetype)snapshotWithPath:(NSString*)path error:(NSError**)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns the highest precedence rule matching the identifiers, using the same order
+/// as the rules database: CDHash > Binary > Signing ID > Certificate > Team ID.
+- (SNTRule*)ruleForIdentifiers:(struct RuleIdentifiers)identifiers;
+
+@property(readonly) NSString* executionRulesHash;
+@property(readonly) NSString* transitiveRulesHash;
+
+/// Total number of rules in the snapshot
+@property(readonly) NSUInteger count;
+
+@end
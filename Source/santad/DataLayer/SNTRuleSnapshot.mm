@@ -0,0 +1,535 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santad/DataLayer/SNTRuleSnapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTError.h"
+#include "Source/common/String.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'N', 'T', 'R', 'U', 'L', 'E', 'S'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint32_t kNilString = UINT32_MAX;
+constexpr size_t kRulesHashSize = 64;
+
+constexpr size_t kCDHashSize = 20;
+constexpr size_t kSHA256Size = 32;
+
+struct StringRef {
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct Record {
+  int64_t rule_id;
+  int32_t state;
+  int32_t type;
+  uint32_t timestamp;
+  uint32_t reserved;
+  StringRef identifier;
+  StringRef custom_msg;
+  StringRef custom_url;
+  StringRef comment;
+  StringRef cel_expr;
+  StringRef seatbelt_policy;
+};
+
+template <size_t N>
+struct HashEntry {
+  uint8_t key[N];
+  uint32_t record;
+};
+
+struct StringEntry {
+  StringRef key;
+  uint32_t record;
+};
+
+struct Section {
+  uint64_t offset;
+  uint64_t count;
+};
+
+// Sections are stored in rule precedence order
+enum SectionIndex {
+  kSectionCDHash = 0,
+  kSectionBinary,
+  kSectionSigningID,
+  kSectionCertificate,
+  kSectionTeamID,
+  kNumSections,
+};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t file_size;
+  char execution_rules_hash[kRulesHashSize];
+  char transitive_rules_hash[kRulesHashSize];
+  Section records;
+  Section strings;
+  Section rules[kNumSections];
+};
+
+std::optional<SectionIndex> SectionForRuleType(SNTRuleType type) {
+  switch (type) {
+    case SNTRuleTypeCDHash: return kSectionCDHash;
+    case SNTRuleTypeBinary: return kSectionBinary;
+    case SNTRuleTypeSigningID: return kSectionSigningID;
+    case SNTRuleTypeCertificate: return kSectionCertificate;
+    case SNTRuleTypeTeamID: return kSectionTeamID;
+    default: return std::nullopt;
+  }
+}
+
+size_t KeySizeForSection(int section) {
+  switch (section) {
+    case kSectionCDHash: return kCDHashSize;
+    case kSectionBinary: [[fallthrough]];
+    case kSectionCertificate: return kSHA256Size;
+    default: return 0;
+  }
+}
+
+size_t EntrySizeForSection(int section) {
+  switch (KeySizeForSection(section)) {
+    case kCDHashSize: return sizeof(HashEntry<kCDHashSize>);
+    case kSHA256Size: return sizeof(HashEntry<kSHA256Size>);
+    default: return sizeof(StringEntry);
+  }
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Decode a hex string of exactly 2 * N characters
+template <size_t N>
+bool DecodeHex(std::string_view hex, uint8_t (&out)[N]) {
+  if (hex.size() != N * 2) return false;
+  for (size_t i = 0; i < N; i++) {
+    int hi = HexValue(hex[i * 2]);
+    int lo = HexValue(hex[i * 2 + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i] = (uint8_t)((hi << 4) | lo);
+  }
+  return true;
+}
+
+void CopyRulesHash(NSString* hash, char (&out)[kRulesHashSize]) {
+  memset(out, 0, kRulesHashSize);
+  std::string_view sv = santa::NSStringToUTF8StringView(hash);
+  memcpy(out, sv.data(), std::min(sv.size(), kRulesHashSize - 1));
+}
+
+NSString* ReadRulesHash(const char (&hash)[kRulesHashSize]) {
+  return [[NSString alloc] initWithBytes:hash
+                                  length:strnlen(hash, kRulesHashSize)
+                                encoding:NSUTF8StringEncoding];
+}
+
+size_t AlignUp(size_t value) {
+  return (value + 7) & ~(size_t)7;
+}
+
+std::string_view StringForRef(const uint8_t* base, const Section& strings, StringRef ref) {
+  if (ref.offset == kNilString || ref.offset > strings.count ||
+      ref.length > strings.count - ref.offset) {
+    return {};
+  }
+  return std::string_view(reinterpret_cast<const char*>(base + strings.offset) + ref.offset,
+                          ref.length);
+}
+
+template <size_t N>
+std::optional<uint32_t> FindHash(const uint8_t* base, const Section& section,
+                                 NSString* identifier) {
+  uint8_t key[N];
+  if (!identifier || !DecodeHex(santa::NSStringToUTF8StringView(identifier), key)) {
+    return std::nullopt;
+  }
+
+  std::span<const HashEntry<N>> entries(
+      reinterpret_cast<const HashEntry<N>*>(base + section.offset), section.count);
+  auto it = std::lower_bound(
+      entries.begin(), entries.end(), key,
+      [](const HashEntry<N>& entry, const uint8_t* k) { return memcmp(entry.key, k, N) < 0; });
+  if (it == entries.end() || memcmp(it->key, key, N) != 0) {
+    return std::nullopt;
+  }
+  return it->record;
+}
+
+std::optional<uint32_t> FindString(const uint8_t* base, const Section& strings,
+                                   const Section& section, NSString* identifier) {
+  if (!identifier) return std::nullopt;
+
+  std::string_view key = santa::NSStringToUTF8StringView(identifier);
+  std::span<const StringEntry> entries(
+      reinterpret_cast<const StringEntry*>(base + section.offset), section.count);
+  auto it = std::lower_bound(entries.begin(), entries.end(), key,
+                             [&](const StringEntry& entry, std::string_view k) {
+                               return StringForRef(base, strings, entry.key) < k;
+                             });
+  if (it == entries.end() || StringForRef(base, strings, it->key) != key) {
+    return std::nullopt;
+  }
+  return it->record;
+}
+
+class SnapshotBuilder {
+ public:
+  StringRef AddString(NSString* str) {
+    if (!str) return {.offset = kNilString, .length = 0};
+    std::string_view sv = santa::NSStringToUTF8StringView(str);
+    StringRef ref = {.offset = (uint32_t)strings_.size(), .length = (uint32_t)sv.size()};
+    strings_.append(sv);
+    return ref;
+  }
+
+  std::string_view StringForRef(StringRef ref) const {
+    return std::string_view(strings_).substr(ref.offset, ref.length);
+  }
+
+  bool AddRule(SNTRule* rule) {
+    std::optional<SectionIndex> section = SectionForRuleType(rule.type);
+    if (!section || !rule.identifier) return true;
+
+    uint32_t record_idx = (uint32_t)records_.size();
+    Record record = {
+        .rule_id = rule.ruleId,
+        .state = (int32_t)rule.state,
+        .type = (int32_t)rule.type,
+        .timestamp = (uint32_t)rule.timestamp,
+        .reserved = 0,
+        .identifier = AddString(rule.identifier),
+        .custom_msg = AddString(rule.customMsg),
+        .custom_url = AddString(rule.customURL),
+        .comment = AddString(rule.comment),
+        .cel_expr = AddString(rule.celExpr),
+        .seatbelt_policy = AddString(rule.seatbeltPolicy),
+    };
+    records_.push_back(record);
+
+    std::string_view identifier = StringForRef(record.identifier);
+    switch (*section) {
+      case kSectionCDHash: return AddHash(cdhashes_, identifier, record_idx);
+      case kSectionBinary: return AddHash(binaries_, identifier, record_idx);
+      case kSectionCertificate: return AddHash(certificates_, identifier, record_idx);
+      case kSectionSigningID:
+        signing_ids_.push_back({.key = record.identifier, .record = record_idx});
+        return true;
+      case kSectionTeamID:
+        team_ids_.push_back({.key = record.identifier, .record = record_idx});
+        return true;
+      default: return true;
+    }
+  }
+
+  bool TooLarge() const {
+    return strings_.size() >= kNilString || records_.size() >= UINT32_MAX;
+  }
+
+  std::string Build(NSString* execution_rules_hash, NSString* transitive_rules_hash) {
+    SortHashes(cdhashes_);
+    SortHashes(binaries_);
+    SortHashes(certificates_);
+    SortStrings(signing_ids_);
+    SortStrings(team_ids_);
+
+    Header header = {};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    CopyRulesHash(execution_rules_hash, header.execution_rules_hash);
+    CopyRulesHash(transitive_rules_hash, header.transitive_rules_hash);
+
+    std::string out(AlignUp(sizeof(Header)), '\0');
+    header.records = Append(out, records_);
+    header.rules[kSectionCDHash] = Append(out, cdhashes_);
+    header.rules[kSectionBinary] = Append(out, binaries_);
+    header.rules[kSectionSigningID] = Append(out, signing_ids_);
+    header.rules[kSectionCertificate] = Append(out, certificates_);
+    header.rules[kSectionTeamID] = Append(out, team_ids_);
+    header.strings = {.offset = out.size(), .count = strings_.size()};
+    out.append(strings_);
+    header.file_size = out.size();
+
+    memcpy(out.data(), &header, sizeof(header));
+    return out;
+  }
+
+ private:
+  template <size_t N>
+  static bool AddHash(std::vector<HashEntry<N>>& entries, std::string_view identifier,
+                      uint32_t record) {
+    HashEntry<N> entry = {.record = record};
+    if (!DecodeHex(identifier, entry.key)) return false;
+    entries.push_back(entry);
+    return true;
+  }
+
+  template <size_t N>
+  static void SortHashes(std::vector<HashEntry<N>>& entries) {
+    std::sort(entries.begin(), entries.end(), [](const HashEntry<N>& a, const HashEntry<N>& b) {
+      return memcmp(a.key, b.key, N) < 0;
+    });
+  }
+
+  void SortStrings(std::vector<StringEntry>& entries) const {
+    std::sort(entries.begin(), entries.end(), [this](const StringEntry& a, const StringEntry& b) {
+      return StringForRef(a.key) < StringForRef(b.key);
+    });
+  }
+
+  template <typename T>
+  static Section Append(std::string& out, const std::vector<T>& entries) {
+    out.resize(AlignUp(out.size()), '\0');
+    Section section = {.offset = out.size(), .count = entries.size()};
+    out.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(T));
+    return section;
+  }
+
+  std::vector<Record> records_;
+  std::vector<HashEntry<kCDHashSize>> cdhashes_;
+  std::vector<HashEntry<kSHA256Size>> binaries_;
+  std::vector<HashEntry<kSHA256Size>> certificates_;
+  std::vector<StringEntry> signing_ids_;
+  std::vector<StringEntry> team_ids_;
+  std::string strings_;
+};
+
+}  // namespace
+
+@interface SNTRuleSnapshot ()
+@property(readwrite) NSString* executionRulesHash;
+@property(readwrite) NSString* transitiveRulesHash;
+@property(readwrite) NSUInteger count;
+@end
+
+@implementation SNTRuleSnapshot {
+  const uint8_t* _base;
+  size_t _size;
+}
+
++ (BOOL)writeRules:(NSArray<SNTRule*>*)rules
+    executionRulesHash:(NSString*)executionRulesHash
+    transitiveRulesHash:(NSString*)transitiveRulesHash
+                 toPath:(NSString*)path
+                  error:(NSError**)error {
+  SnapshotBuilder builder;
+  for (SNTRule* rule in rules) {
+    if (!builder.AddRule(rule)) {
+      [SNTError populateError:error
+                     withCode:SNTErrorCodeRuleInvalidIdentifier
+                       format:@"Invalid identifier for rule: %@", rule.identifier];
+      return NO;
+    }
+  }
+
+  if (builder.TooLarge()) {
+    [SNTError populateError:error withFormat:@"Too many rules for snapshot"];
+    return NO;
+  }
+
+  std::string data = builder.Build(executionRulesHash, transitiveRulesHash);
+
+  // Write to a temporary file next to the destination so the rename below is atomic and
+  // readers only ever see complete snapshots.
+  NSString* tmpPath = [path stringByAppendingString:@".tmp"];
+  int fd = open(tmpPath.UTF8String, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    [SNTError populateError:error
+                   withCode:SNTErrorCodeFailedToOpen
+                     format:@"Unable to open %@: %s", tmpPath, strerror(errno)];
+    return NO;
+  }
+
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t ret = write(fd, data.data() + written, data.size() - written);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    written += ret;
+  }
+
+  int saved_errno = errno;
+  if (written != data.size() || fsync(fd) != 0) {
+    saved_errno = errno;
+    close(fd);
+    unlink(tmpPath.UTF8String);
+    [SNTError populateError:error
+                 withFormat:@"Unable to write %@: %s", tmpPath, strerror(saved_errno)];
+    return NO;
+  }
+  close(fd);
+
+  if (rename(tmpPath.UTF8String, path.UTF8String) != 0) {
+    saved_errno = errno;
+    unlink(tmpPath.UTF8String);
+    [SNTError populateError:error
+                 withFormat:@"Unable to move snapshot into place: %s", strerror(saved_errno)];
+    return NO;
+  }
+
+  return YES;
+}
+
++ (instancetype)snapshotWithPath:(NSString*)path error:(NSError**)error {
+  int fd = open(path.UTF8String, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0) {
+    [SNTError populateError:error
+                   withCode:SNTErrorCodeFailedToOpen
+                     format:@"Unable to open %@: %s", path, strerror(errno)];
+    return nil;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode) || sb.st_size < (off_t)sizeof(Header)) {
+    close(fd);
+    [SNTError populateError:error
+                   withCode:SNTErrorCodeNonRegularFile
+                     format:@"Invalid snapshot file: %@", path];
+    return nil;
+  }
+
+  void* base = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    [SNTError populateError:error
+                   withCode:SNTErrorCodeFailedToOpen
+                     format:@"Unable to map %@: %s", path, strerror(errno)];
+    return nil;
+  }
+
+  SNTRuleSnapshot* snapshot = [[self alloc] initWithBase:(const uint8_t*)base
+                                                    size:(size_t)sb.st_size];
+  if (!snapshot) {
+    [SNTError populateError:error withFormat:@"Malformed or incompatible snapshot: %@", path];
+  }
+  return snapshot;
+}
+
+- (instancetype)initWithBase:(const uint8_t*)base size:(size_t)size {
+  self = [super init];
+  if (self) {
+    // Take ownership of the mapping first so that it's released if validation fails
+    _base = base;
+    _size = size;
+
+    const Header* header = [self header];
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->version != kFormatVersion || header->file_size != size ||
+        ![self isValidSection:header->records entrySize:sizeof(Record)] ||
+        ![self isValidSection:header->strings entrySize:1]) {
+      return nil;
+    }
+
+    NSUInteger count = 0;
+    for (int i = 0; i < kNumSections; i++) {
+      if (![self isValidSection:header->rules[i] entrySize:EntrySizeForSection(i)]) {
+        return nil;
+      }
+      count += header->rules[i].count;
+    }
+
+    _executionRulesHash = ReadRulesHash(header->execution_rules_hash);
+    _transitiveRulesHash = ReadRulesHash(header->transitive_rules_hash);
+    _count = count;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (_base) {
+    munmap((void*)_base, _size);
+  }
+}
+
+- (const Header*)header {
+  return reinterpret_cast<const Header*>(_base);
+}
+
+- (BOOL)isValidSection:(Section)section entrySize:(size_t)entrySize {
+  return section.offset % 8 == 0 && section.offset <= _size &&
+         section.count <= (_size - section.offset) / entrySize;
+}
+
+- (NSString*)objectForRef:(StringRef)ref {
+  if (ref.offset == kNilString) return nil;
+  std::string_view sv = StringForRef(_base, [self header]->strings, ref);
+  return [[NSString alloc] initWithBytes:sv.data() length:sv.size() encoding:NSUTF8StringEncoding];
+}
+
+- (SNTRule*)ruleForRecord:(uint32_t)recordIdx {
+  const Section& records = [self header]->records;
+  if (recordIdx >= records.count) return nil;
+
+  const Record& record = reinterpret_cast<const Record*>(_base + records.offset)[recordIdx];
+  return [[SNTRule alloc] initWithIdentifier:[self objectForRef:record.identifier]
+                                       state:static_cast<SNTRuleState>(record.state)
+                                        type:static_cast<SNTRuleType>(record.type)
+                                   customMsg:[self objectForRef:record.custom_msg]
+                                   customURL:[self objectForRef:record.custom_url]
+                                   timestamp:record.timestamp
+                                     comment:[self objectForRef:record.comment]
+                                     celExpr:[self objectForRef:record.cel_expr]
+                              seatbeltPolicy:[self objectForRef:record.seatbelt_policy]
+                                      ruleId:record.rule_id
+                                       error:nil];
+}
+
+- (SNTRule*)ruleForIdentifiers:(struct RuleIdentifiers)identifiers {
+  const Header* header = [self header];
+  std::optional<uint32_t> record;
+
+  // IMPORTANT: Keep this order in sync with the query in SNTRuleTable.
+  if ((record = FindHash<kCDHashSize>(_base, header->rules[kSectionCDHash], identifiers.cdhash)) ||
+      (record = FindHash<kSHA256Size>(_base, header->rules[kSectionBinary],
+                                      identifiers.binarySHA256)) ||
+      (record = FindString(_base, header->strings, header->rules[kSectionSigningID],
+                           identifiers.signingID)) ||
+      (record = FindHash<kSHA256Size>(_base, header->rules[kSectionCertificate],
+                                      identifiers.certificateSHA256)) ||
+      (record = FindString(_base, header->strings, header->rules[kSectionTeamID],
+                           identifiers.teamID))) {
+    return [self ruleForRecord:*record];
+  }
+
+  return nil;
+}
+
+@end
@@ -0,0 +1,191 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santad/DataLayer/SNTRuleSnapshot.h"
+
+#import <XCTest/XCTest.h>
+
+#import "Source/common/SNTCommonEnums.h"
+
+static NSString* const kCDHash = @"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670a";
+static NSString* const kBinarySHA256 =
+    @"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670";
+static NSString* const kSigningID = @"ABCDEFGHIJ:signingID";
+static NSString* const kCertSHA256 =
+    @"7ae80b9ab38af0c63a9a81765f434d9a7cd8f720eb6037ef303de39d779bc258";
+static NSString* const kTeamID = @"ABCDEFGHIJ";
+
+@interface SNTRule ()
+@property(readwrite) NSString* identifier;
+@end
+
+@interface SNTRuleSnapshotTest : XCTestCase
+@property NSString* path;
+@end
+
+@implementation SNTRuleSnapshotTest
+
+- (void)setUp {
+  self.path = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.snapshot", [NSUUID UUID]]];
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+}
+
+- (SNTRule*)ruleWithIdentifier:(NSString*)identifier type:(SNTRuleType)type {
+  return [[SNTRule alloc] initWithIdentifier:identifier
+                                       state:SNTRuleStateBlock
+                                        type:type
+                                   customMsg:[NSString stringWithFormat:@"msg %@", identifier]
+                                   customURL:nil
+                                   timestamp:123
+                                     comment:nil
+                                     celExpr:nil
+                              seatbeltPolicy:nil
+                                      ruleId:(int64_t)type
+                                       error:nil];
+}
+
+- (NSArray<SNTRule*>*)exampleRules {
+  return @[
+    [self ruleWithIdentifier:kTeamID type:SNTRuleTypeTeamID],
+    [self ruleWithIdentifier:kCertSHA256 type:SNTRuleTypeCertificate],
+    [self ruleWithIdentifier:kSigningID type:SNTRuleTypeSigningID],
+    [self ruleWithIdentifier:kBinarySHA256 type:SNTRuleTypeBinary],
+    [self ruleWithIdentifier:kCDHash type:SNTRuleTypeCDHash],
+  ];
+}
+
+- (void)testRoundTrip {
+  NSError* error;
+  XCTAssertTrue([SNTRuleSnapshot writeRules:[self exampleRules]
+                         executionRulesHash:@"abc"
+                        transitiveRulesHash:@"def"
+                                     toPath:self.path
+                                      error:&error]);
+  XCTAssertNil(error);
+
+  SNTRuleSnapshot* sut = [SNTRuleSnapshot snapshotWithPath:self.path error:&error];
+  XCTAssertNotNil(sut);
+  XCTAssertEqualObjects(sut.executionRulesHash, @"abc");
+  XCTAssertEqualObjects(sut.transitiveRulesHash, @"def");
+  XCTAssertEqual(sut.count, 5);
+
+  SNTRule* rule = [sut ruleForIdentifiers:(struct RuleIdentifiers){.binarySHA256 = kBinarySHA256}];
+  XCTAssertEqualObjects(rule, [self ruleWithIdentifier:kBinarySHA256 type:SNTRuleTypeBinary]);
+  XCTAssertEqual(rule.state, SNTRuleStateBlock);
+  XCTAssertEqualObjects(rule.customMsg, ([NSString stringWithFormat:@"msg %@", kBinarySHA256]));
+  XCTAssertNil(rule.customURL);
+  XCTAssertEqual(rule.timestamp, 123);
+  XCTAssertEqual(rule.ruleId, SNTRuleTypeBinary);
+
+  XCTAssertNil([sut ruleForIdentifiers:(struct RuleIdentifiers){.binarySHA256 = kCertSHA256}]);
+  XCTAssertNil([sut ruleForIdentifiers:(struct RuleIdentifiers){.cdhash = @"not hex"}]);
+  XCTAssertNil([sut ruleForIdentifiers:(struct RuleIdentifiers){}]);
+}
+
+- (void)testPrecedence {
+  XCTAssertTrue([SNTRuleSnapshot writeRules:[self exampleRules]
+                         executionRulesHash:@""
+                        transitiveRulesHash:@""
+                                     toPath:self.path
+                                      error:nil]);
+  SNTRuleSnapshot* sut = [SNTRuleSnapshot snapshotWithPath:self.path error:nil];
+  XCTAssertNotNil(sut);
+
+  struct RuleIdentifiers ids = {
+      .cdhash = kCDHash,
+      .binarySHA256 = kBinarySHA256,
+      .signingID = kSigningID,
+      .certificateSHA256 = kCertSHA256,
+      .teamID = kTeamID,
+  };
+
+  XCTAssertEqual([sut ruleForIdentifiers:ids].type, SNTRuleTypeCDHash);
+  ids.cdhash = nil;
+  XCTAssertEqual([sut ruleForIdentifiers:ids].type, SNTRuleTypeBinary);
+  ids.binarySHA256 = nil;
+  XCTAssertEqual([sut ruleForIdentifiers:ids].type, SNTRuleTypeSigningID);
+  ids.signingID = nil;
+  XCTAssertEqual([sut ruleForIdentifiers:ids].type, SNTRuleTypeCertificate);
+  ids.certificateSHA256 = nil;
+  XCTAssertEqual([sut ruleForIdentifiers:ids].type, SNTRuleTypeTeamID);
+  ids.teamID = @"ZZZZZZZZZZ";
+  XCTAssertNil([sut ruleForIdentifiers:ids]);
+}
+
+- (void)testManyRules {
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  for (int i = 0; i < 1000; i++) {
+    [rules addObject:[self ruleWithIdentifier:[NSString stringWithFormat:@"%064x", i * 7919]
+                                         type:SNTRuleTypeBinary]];
+    [rules addObject:[self ruleWithIdentifier:[NSString stringWithFormat:@"EQHXZ8M8AV:app%d", i]
+                                         type:SNTRuleTypeSigningID]];
+  }
+
+  XCTAssertTrue([SNTRuleSnapshot writeRules:rules
+                         executionRulesHash:@""
+                        transitiveRulesHash:@""
+                                     toPath:self.path
+                                      error:nil]);
+  SNTRuleSnapshot* sut = [SNTRuleSnapshot snapshotWithPath:self.path error:nil];
+  XCTAssertEqual(sut.count, 2000);
+
+  for (SNTRule* rule in rules) {
+    struct RuleIdentifiers ids = {};
+    if (rule.type == SNTRuleTypeBinary) {
+      ids.binarySHA256 = rule.identifier;
+    } else {
+      ids.signingID = rule.identifier;
+    }
+    XCTAssertEqualObjects([sut ruleForIdentifiers:ids].identifier, rule.identifier);
+  }
+}
+
+- (void)testInvalidFilesAreRejected {
+  NSError* error;
+  XCTAssertNil([SNTRuleSnapshot snapshotWithPath:self.path error:&error]);
+  XCTAssertNotNil(error);
+
+  [[NSData dataWithBytes:"garbage" length:7] writeToFile:self.path atomically:YES];
+  XCTAssertNil([SNTRuleSnapshot snapshotWithPath:self.path error:nil]);
+
+  // Truncated snapshots are rejected
+  XCTAssertTrue([SNTRuleSnapshot writeRules:[self exampleRules]
+                         executionRulesHash:@""
+                        transitiveRulesHash:@""
+                                     toPath:self.path
+                                      error:nil]);
+  NSData* data = [NSData dataWithContentsOfFile:self.path];
+  [[data subdataWithRange:NSMakeRange(0, data.length - 1)] writeToFile:self.path atomically:YES];
+  XCTAssertNil([SNTRuleSnapshot snapshotWithPath:self.path error:nil]);
+}
+
+- (void)testMalformedHashIdentifierFailsWrite {
+  NSError* error;
+  SNTRule* rule = [self ruleWithIdentifier:kBinarySHA256 type:SNTRuleTypeBinary];
+  rule.identifier = @"xyz";
+  XCTAssertFalse([SNTRuleSnapshot writeRules:@[ rule ]
+                          executionRulesHash:@""
+                         transitiveRulesHash:@""
+                                      toPath:self.path
+                                       error:&error]);
+  XCTAssertNotNil(error);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.path]);
+}
+
+@end
@@ -42,6 +42,11 @@
          networkFlowRulesHash:(NSString*)networkFlowRulesHash;
 @end
 
+typedef struct {
+  uint64_t reaped;
+  uint64_t backlog;
+} SNTTransitiveRuleReapStats;
+
 ///
 ///  Responsible for managing the rule tables.
 ///
@@ -104,6 +109,27 @@
 ///
 - (SNTRule*)executionRuleForIdentifiers:(struct RuleIdentifiers)identifiers;
 
+///
+///  Batch form of executionRuleForIdentifiers:. All lookups are resolved against the same view of
+///  the rules, and at most one database transaction is used.
+///
+///  @return An array with one entry per identifier, in order. Each entry is the matching rule or
+///          NSNull if there is none.
+///
+- (NSArray*)executionRulesForIdentifiers:(NSArray<SNTRuleIdentifiers*>*)identifiers;
+
+///
+///  Like executionRuleForIdentifiers: but only considers the CDHash, Signing ID and Team ID
+///  identifiers, which are known without reading the file. The binary and certificate SHA-256
+///  identifiers are ignored.
+///
+///  @return The matching rule, only if no Binary or Certificate rule could take precedence over
+///          it. That is, the same rule executionRuleForIdentifiers: would return once the file's
+///          hashes are known. Returns nil if there is no such rule or if the in-memory rule index
+///          is not available.
+///
+- (SNTRule*)executionRuleForIdentityIdentifiers:(struct RuleIdentifiers)identifiers;
+
 ///
 ///  Add an array of execution rules, file access rules, and network flow rules to the database.
 ///  All rules across all three types are applied within a single transaction; the transaction
@@ -122,6 +148,51 @@
               ruleCleanup:(SNTRuleCleanup)cleanupType
                    errors:(NSArray<NSError*>**)errors;
 
+///
+///  Append execution rules to the set staged for a later call to
+///  `addStagedExecutionRules:fileAccessRules:networkFlowRules:ruleCleanup:errors:`. Staged rules
+///  are kept in the database rather than in memory and are not visible to lookups. Rules are
+///  only validated when the staged set is committed.
+///
+///  @param executionRules Array of SNTRule objects to stage.
+///  @param errors When returning NO, will be filled with an array of errors.
+///  @return YES if the rules were staged.
+///
+- (BOOL)stageExecutionRules:(NSArray<SNTRule*>*)executionRules errors:(NSArray<NSError*>**)errors;
+
+///
+///  Discard any staged execution rules.
+///
+- (void)discardStagedExecutionRules;
+
+///
+///  Like `addExecutionRules:fileAccessRules:networkFlowRules:ruleCleanup:errors:`, but the
+///  execution rules are the ones previously staged with `stageExecutionRules:errors:`, applied
+///  in bounded chunks within the same single transaction. The staged rules are discarded once
+///  they have been applied.
+///
+///  @param expectedCount The number of execution rules the caller staged. The commit fails if
+///                       this doesn't match, e.g. because santad restarted in the meantime.
+///
+- (BOOL)addStagedExecutionRules:(NSUInteger)expectedCount
+                fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+               networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                    ruleCleanup:(SNTRuleCleanup)cleanupType
+                         errors:(NSArray<NSError*>**)errors;
+
+///
+///  Replace the non-transitive execution rules whose row hashes fall in the given buckets of
+///  `executionRulesBucketDigests` with `executionRules`, in a single transaction. Used to repair
+///  drift from a server's rule set one bucket at a time rather than with a clean sync.
+///
+///  @param buckets Indexes of the buckets that differ from the server.
+///  @param executionRules The server's rules in those buckets. May be empty.
+///  @return YES if the rules were replaced.
+///
+- (BOOL)replaceExecutionRulesInBuckets:(NSIndexSet*)buckets
+                             withRules:(NSArray<SNTRule*>*)executionRules
+                                errors:(NSArray<NSError*>**)errors;
+
 ///
 /// Wrapper for `addExecutionRules:fileAccessRules:networkFlowRules:ruleCleanup:errors:` when
 /// there are no file access or network flow rules to add. Used by legacy code paths that only
@@ -147,10 +218,24 @@
 - (void)resetTimestampForExecutionRule:(SNTRule*)rule;
 
 ///
-///  Remove transitive rules that haven't been used in a long time.
+///  Remove transitive rules that haven't been used in a long time. Rules are removed a chunk at
+///  a time on a background queue, and only while the machine is on AC power.
 ///
 - (void)removeOutdatedTransitiveRules;
 
+///
+///  Statistics for the background removal of outdated transitive rules. Reaped rules are counted
+///  since the last reset. The backlog is the number of outdated rules still waiting to be removed.
+///
+- (SNTTransitiveRuleReapStats)transitiveRuleReapStats:(BOOL)reset;
+
+///
+///  Answer execution rule lookups from a memory-mapped snapshot of the rules stored at path.
+///  The snapshot is reused across restarts as long as it matches the database, and is rewritten
+///  in the background whenever execution rules change.
+///
+- (void)enableRuleSnapshotAtPath:(NSString*)path;
+
 ///
 ///  Retrieve all execution rules from the database for export.
 ///
@@ -189,8 +274,24 @@
 ///
 ///  Retrieve a hash of all the non-transitive rules in the database.
 ///
+///  The execution and file access rule hashes are order-independent digests that are updated as
+///  rules are written, so after the first call this does not need to read the rules.
+///
 - (SNTRuleTableRulesHash*)hashOfHashes;
 
+///
+///  The execution rules hash split into 256 buckets by the top byte of each rule's row hash.
+///  Each bucket is 16 big-endian bytes and the buckets sum, modulo 2^128, to
+///  `hashOfHashes.executionRulesHash`. Comparing buckets against the server's shows which
+///  rules have drifted.
+///
+- (NSData*)executionRulesBucketDigests;
+
+///
+///  Like `executionRulesBucketDigests`, for `hashOfHashes.fileAccessRulesHash`.
+///
+- (NSData*)fileAccessRulesBucketDigests;
+
 ///
 ///  A map of a file hashes to cached decisions. This is used to pre-validate and allowlist
 ///  certain critical system binaries that are integral to Santa's functionality.
@@ -16,7 +16,15 @@
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 
 #import <EndpointSecurity/EndpointSecurity.h>
+#import <Security/Security.h>
+#include <sys/stat.h>
 
+#include <array>
+#include <atomic>
+#include <optional>
+#include <vector>
+
+#include "Source/common/BackgroundScheduler.h"
 #import "Source/common/CertificateHelpers.h"
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLCodesignChecker.h"
@@ -29,17 +37,198 @@
 #import "Source/common/SNTFileInfo.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTRule.h"
+#import "Source/common/SNTSystemInfo.h"
 #import "Source/common/SNTXxhash.h"
 #import "Source/common/SigningIDHelpers.h"
 #include "Source/common/String.h"
 #include "Source/common/cel/Evaluator.h"
+#import "Source/santad/DataLayer/SNTExecutionRuleFilter.h"
+#import "Source/santad/DataLayer/SNTExecutionRuleIndex.h"
+#import "Source/santad/DataLayer/SNTRuleSnapshot.h"
 
-static const uint32_t kRuleTableCurrentVersion = 13;
+static const uint32_t kRuleTableCurrentVersion = 15;
 
 // How many rules must be in database before we start trying to remove transitive rules.
 static const int64_t kTransitiveRuleCullingThreshold = 500000;
 // Consider transitive rules out of date if they haven't been used in six months.
 static const NSUInteger kTransitiveRuleExpirationSeconds = 6 * 30 * 24 * 3600;
+// Outdated transitive rules are deleted in chunks of this many rules, pausing between chunks so
+// that rule lookups aren't kept waiting on the database.
+static const NSUInteger kTransitiveRuleReapChunkSize = 1000;
+static const int64_t kTransitiveRuleReapPauseNanos = 50 * NSEC_PER_MSEC;
+// Chunks held by the background scheduler are deleted after this long
+static const uint64_t kTransitiveRuleReapMaxDelayNanos = 6 * 3600 * NSEC_PER_SEC;
+// Batches of execution rules at least this large are written using the bulk load path.
+static const NSUInteger kBulkLoadRuleThreshold = 1000;
+// Staged execution rules are read back and applied in chunks of this many rules.
+static const NSUInteger kStagedRuleChunkSize = 10000;
+
+namespace {
+
+// Order-independent digest of the rows in a table. Each row is hashed on its own and the row
+// hashes are combined with wrapping addition, so the digest can be kept up to date as single
+// rows are added or removed rather than rehashing the whole table.
+//
+// Rows are also summed into buckets keyed by the top byte of their hash. The buckets add up to
+// the overall digest, and comparing them against another copy of the table shows which rows
+// differ without comparing every row.
+class RowSetDigest {
+ public:
+  using RowHash = unsigned __int128;
+
+  static constexpr int kBuckets = 256;
+
+  static int BucketForRow(RowHash row) { return (int)(row >> 120); }
+
+  static RowHash HashRow(santa::Xxhash128& hash) {
+    RowHash value = 0;
+    hash.Digest([&value](const uint8_t* buf, size_t size) {
+      for (size_t i = 0; i < size; i++) {
+        value = (value << 8) | buf[i];
+      }
+    });
+    return value;
+  }
+
+  void Add(RowHash row) {
+    sum_ += row;
+    buckets_[BucketForRow(row)] += row;
+  }
+
+  void Remove(RowHash row) {
+    sum_ -= row;
+    buckets_[BucketForRow(row)] -= row;
+  }
+
+  // Each bucket's sum as 16 big-endian bytes, in bucket order.
+  NSData* BucketDigests() const {
+    NSMutableData* data = [NSMutableData dataWithLength:kBuckets * sizeof(RowHash)];
+    uint8_t* buf = static_cast<uint8_t*>(data.mutableBytes);
+    for (RowHash bucket : buckets_) {
+      for (int i = sizeof(RowHash) - 1; i >= 0; i--) {
+        buf[i] = (uint8_t)bucket;
+        bucket >>= 8;
+      }
+      buf += sizeof(RowHash);
+    }
+    return data;
+  }
+
+  NSString* HexDigest() const {
+    return [NSString stringWithFormat:@"%016llx%016llx", (unsigned long long)(sum_ >> 64),
+                                      (unsigned long long)sum_];
+  }
+
+ private:
+  RowHash sum_ = 0;
+  std::array<RowHash, kBuckets> buckets_{};
+};
+
+RowSetDigest::RowHash ExecutionRuleRowHash(NSString* identifier, int state, int type,
+                                           NSString* celExpr, NSString* seatbeltPolicy) {
+  santa::Xxhash128 hash;
+  hash.Update(identifier.UTF8String, [identifier lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+  hash.Update(celExpr.UTF8String, [celExpr lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+  hash.Update(seatbeltPolicy.UTF8String,
+              [seatbeltPolicy lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+  hash.Update(static_cast<void*>(&state), sizeof(state));
+  hash.Update(static_cast<void*>(&type), sizeof(type));
+  return RowSetDigest::HashRow(hash);
+}
+
+RowSetDigest::RowHash FileAccessRuleRowHash(NSString* name, NSData* ruleData) {
+  santa::Xxhash128 hash;
+  hash.Update(name.UTF8String, [name lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+  hash.Update(ruleData.bytes, ruleData.length);
+  return RowSetDigest::HashRow(hash);
+}
+
+// Reads the cdhash from a binary's CodeDirectory without validating the signature or hashing
+// the file. Only used to check that a critical binary decision from an earlier launch still
+// describes the file on disk.
+NSString* UnvalidatedCDHashForPath(NSString* path) {
+  SecStaticCodeRef codeRef = NULL;
+  if (SecStaticCodeCreateWithPath((__bridge CFURLRef)[NSURL fileURLWithPath:path],
+                                  kSecCSDefaultFlags, &codeRef) != errSecSuccess) {
+    return nil;
+  }
+
+  CFDictionaryRef info = NULL;
+  OSStatus status = SecCodeCopySigningInformation(codeRef, kSecCSDefaultFlags, &info);
+  CFRelease(codeRef);
+  if (status != errSecSuccess) {
+    return nil;
+  }
+
+  NSDictionary* signingInfo = CFBridgingRelease(info);
+  NSData* cdhash = signingInfo[(__bridge id)kSecCodeInfoUnique];
+  return cdhash ? santa::StringToNSString(santa::BufToHexString(cdhash)) : nil;
+}
+
+// Critical binary decisions are stored as a property list in the critical_binaries table.
+NSData* CriticalBinaryDecisionData(SNTCachedDecision* cd) {
+  NSMutableArray<NSData*>* certChain = [NSMutableArray arrayWithCapacity:cd.certChain.count];
+  for (MOLCertificate* cert in cd.certChain) {
+    [certChain addObject:cert.certData];
+  }
+
+  NSMutableDictionary* dict = [@{
+    @"decision_extra" : cd.decisionExtra ?: @"",
+    @"sha256" : cd.sha256,
+    @"signing_id" : cd.signingID,
+    @"cdhash" : cd.cdhash ?: @"",
+    @"signing_status" : @(cd.signingStatus),
+    @"cert_chain" : certChain,
+    @"cert_sha256" : cd.certSHA256 ?: @"",
+    @"cert_common_name" : cd.certCommonName ?: @"",
+  } mutableCopy];
+  if (cd.signingTime) dict[@"signing_time"] = cd.signingTime;
+  if (cd.secureSigningTime) dict[@"secure_signing_time"] = cd.secureSigningTime;
+
+  return [NSPropertyListSerialization dataWithPropertyList:dict
+                                                    format:NSPropertyListBinaryFormat_v1_0
+                                                   options:0
+                                                     error:NULL];
+}
+
+SNTCachedDecision* CriticalBinaryDecisionFromData(NSData* data) {
+  if (!data) return nil;
+  NSDictionary* dict = [NSPropertyListSerialization propertyListWithData:data
+                                                                 options:NSPropertyListImmutable
+                                                                  format:NULL
+                                                                   error:NULL];
+  if (![dict isKindOfClass:[NSDictionary class]]) return nil;
+
+  NSString* sha256 = dict[@"sha256"];
+  NSString* signingID = dict[@"signing_id"];
+  if (![sha256 isKindOfClass:[NSString class]] || ![signingID isKindOfClass:[NSString class]]) {
+    return nil;
+  }
+
+  NSMutableArray<MOLCertificate*>* certChain = [NSMutableArray array];
+  for (NSData* certData in dict[@"cert_chain"]) {
+    MOLCertificate* cert = [[MOLCertificate alloc] initWithCertificateDataDER:certData];
+    if (!cert) return nil;
+    [certChain addObject:cert];
+  }
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.decision = SNTEventStateAllowSigningID;
+  cd.decisionExtra = dict[@"decision_extra"];
+  cd.sha256 = sha256;
+  cd.signingID = signingID;
+  cd.cdhash = dict[@"cdhash"];
+  cd.secureSigningTime = dict[@"secure_signing_time"];
+  cd.signingTime = dict[@"signing_time"];
+  cd.signingStatus = (SNTSigningStatus)[dict[@"signing_status"] integerValue];
+  cd.teamID = [signingID componentsSeparatedByString:@":"].firstObject;
+  cd.certChain = certChain;
+  cd.certSHA256 = dict[@"cert_sha256"];
+  cd.certCommonName = dict[@"cert_common_name"];
+  return cd;
+}
+
+}  // namespace
 
 static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   // Create a temporary ES client in order to grab the default set of muted paths.
@@ -75,6 +264,17 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 @interface SNTRuleTable () {
   std::unique_ptr<santa::cel::Evaluator<false>> _celEvaluator;
   std::unique_ptr<santa::cel::Evaluator<true>> _celV2Evaluator;
+  std::atomic<bool> _executionRuleIndexRebuildPending;
+  // Running digests of the execution_rules (excluding transitive rules) and file_access_rules
+  // tables. These are computed with a full scan the first time they are needed and are then
+  // updated row by row by every write, inside the same transaction as the write. Like the
+  // cached digest below, they must only be accessed from inside a database block.
+  std::optional<RowSetDigest> _executionRulesDigest;
+  std::optional<RowSetDigest> _fileAccessRulesDigest;
+  // Transitive rule reaper state. The backlog is only written on the reaper queue.
+  std::atomic<bool> _transitiveRuleReapInProgress;
+  std::atomic<uint64_t> _transitiveRulesReaped;
+  std::atomic<uint64_t> _transitiveRuleReapBacklog;
 }
 @property MOLCodesignChecker* santadCSInfo;
 @property MOLCodesignChecker* launchdCSInfo;
@@ -82,14 +282,25 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 @property NSDictionary* criticalSystemBinaries;
 @property(readonly) NSArray* criticalSystemBinaryPaths;
 @property(readwrite) NSDictionary<NSString*, SNTRule*>* cachedStaticRules;
-// Cached digest of each rule sub-table. Read/write ONLY inside an inDatabase:/inTransaction:
-// block — FMDB's serial queue is what keeps the cache consistent with the DB. Clears must be
-// colocated with the rule write that invalidated them; recomputes must be colocated with the
-// DB read used to produce them. A non-nil cache at the start of a block therefore corresponds
-// to the current DB state by construction.
-@property(atomic) NSString* cachedExecutionRulesHash;
-@property(atomic) NSString* cachedFileAccessRulesHash;
+// Cached digest of the network_flow_rules table. Read/write ONLY inside an
+// inDatabase:/inTransaction: block — FMDB's serial queue is what keeps the cache consistent with
+// the DB. Clears must be colocated with the rule write that invalidated them; recomputes must be
+// colocated with the DB read used to produce them. A non-nil cache at the start of a block
+// therefore corresponds to the current DB state by construction.
 @property(atomic) NSString* cachedNetworkFlowRulesHash;
+// In-memory copy of the execution_rules table, used to answer lookups without touching the DB.
+// Follows the same rules as the cached digests above: it is cleared inside the DB block that
+// modifies execution_rules and only installed from inside the DB block that read it.
+@property(atomic) SNTExecutionRuleIndex* executionRuleIndex;
+@property(atomic) BOOL executionRuleIndexEnabled;
+// Bloom filters over execution_rules identifiers, used to skip lookups that can't match when
+// the index is disabled. Kept consistent in the same way as the index.
+@property(atomic) SNTExecutionRuleFilter* executionRuleFilter;
+// Memory-mapped snapshot of execution_rules, kept consistent in the same way as the index.
+@property(atomic) SNTRuleSnapshot* ruleSnapshot;
+@property(atomic) NSString* ruleSnapshotPath;
+@property(readonly) dispatch_queue_t executionRuleIndexQueue;
+@property(readonly) dispatch_queue_t transitiveRuleReapQueue;
 @end
 
 @implementation SNTRuleTableRulesHash
@@ -174,52 +385,48 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   return criticalPaths;
 }
 
-- (void)setupSystemCriticalBinaries {
+// Decisions are stored keyed by the binary's path, vnode, OS build and cdhash. While these are
+// unchanged the decision from an earlier launch is reused, which avoids hashing each binary and
+// validating its signature on every launch.
+- (void)setupSystemCriticalBinariesInDatabase:(FMDatabase*)db {
+  NSString* osBuild = [SNTSystemInfo osBuild] ?: @"";
+  [db executeUpdate:@"DELETE FROM critical_binaries WHERE os_build != ?", osBuild];
+
   NSMutableDictionary* bins = [NSMutableDictionary dictionary];
   for (NSString* path in [SNTRuleTable criticalSystemBinaryPaths]) {
-    SNTFileInfo* binInfo = [[SNTFileInfo alloc] initWithPath:path];
-    if (!binInfo.SHA256) {
-      // If there isn't a hash, no need to compute the other info here.
-      // Just continue on to the next binary.
-      LOGD(@"Unable to compute hash for critical system binary %@.", path);
-      continue;
-    }
-    MOLCodesignChecker* csInfo = [binInfo codesignCheckerWithError:NULL];
-
-    // Make sure the critical system binary is signed by the same chain as launchd/self
-    BOOL systemBin = NO;
-    if ([csInfo signingInformationMatches:self.launchdCSInfo]) {
-      systemBin = YES;
-    } else if (![csInfo.teamID isEqualToString:self.santadCSInfo.teamID]) {
-      LOGW(@"Unable to validate critical system binary %@. "
-           @"Not signed by same cert as pid 1: %@ vs %@, and does not match santad TeamID: %@ vs "
-           @"%@.",
-           path, self.launchdCSInfo.leafCertificate, csInfo.leafCertificate,
-           self.santadCSInfo.teamID, csInfo.teamID);
+    struct stat sb;
+    if (stat(path.fileSystemRepresentation, &sb) != 0) {
+      LOGD(@"Unable to stat critical system binary %@.", path);
       continue;
     }
 
-    SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
-
-    cd.decision = SNTEventStateAllowSigningID;
-    cd.decisionExtra = systemBin ? @"critical system binary" : @"santa binary";
-    cd.sha256 = binInfo.SHA256;
-    cd.signingID = FormatSigningID(csInfo);
-    cd.cdhash = csInfo.cdhash;
-    cd.secureSigningTime = csInfo.secureSigningTime;
-    cd.signingTime = csInfo.signingTime;
-    cd.signingStatus = IsProductionSigningCert(csInfo.leafCertificate)
-                           ? SNTSigningStatusProduction
-                           : SNTSigningStatusDevelopment;
-
-    // Normalized by the FormatSigningID function so this will always have a
-    // prefix.
-    cd.teamID = [cd.signingID componentsSeparatedByString:@":"].firstObject;
+    SNTCachedDecision* cd = nil;
+    NSString* cdhash = UnvalidatedCDHashForPath(path);
+    if (cdhash) {
+      FMResultSet* rs =
+          [db executeQuery:@"SELECT decision FROM critical_binaries WHERE path=? AND fsid=? AND "
+                           @"fileid=? AND os_build=? AND cdhash=?",
+                           path, @(sb.st_dev), @(sb.st_ino), osBuild, cdhash];
+      if ([rs next]) {
+        cd = CriticalBinaryDecisionFromData([rs dataForColumn:@"decision"]);
+      }
+      [rs close];
+    }
 
-    // Not needed, but nice for logging and events.
-    cd.certChain = csInfo.certificates;
-    cd.certSHA256 = csInfo.leafCertificate.SHA256;
-    cd.certCommonName = csInfo.leafCertificate.commonName;
+    if (!cd) {
+      cd = [self criticalSystemBinaryDecisionForPath:path];
+      if (!cd) continue;
+
+      // Stored against the vnode stat'd before the decision was computed, so a file replaced in
+      // between is recomputed at the next launch rather than matching this decision.
+      NSData* data = CriticalBinaryDecisionData(cd);
+      if (data && cd.cdhash.length) {
+        [db executeUpdate:@"INSERT OR REPLACE INTO critical_binaries "
+                          @"(path, fsid, fileid, os_build, cdhash, decision) "
+                          @"VALUES (?, ?, ?, ?, ?, ?)",
+                          path, @(sb.st_dev), @(sb.st_ino), osBuild, cd.cdhash, data];
+      }
+    }
 
     bins[cd.signingID] = cd;
   }
@@ -227,6 +434,54 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   self.criticalSystemBinaries = bins;
 }
 
+- (SNTCachedDecision*)criticalSystemBinaryDecisionForPath:(NSString*)path {
+  SNTFileInfo* binInfo = [[SNTFileInfo alloc] initWithPath:path];
+  if (!binInfo.SHA256) {
+    // If there isn't a hash, no need to compute the other info here.
+    // Just continue on to the next binary.
+    LOGD(@"Unable to compute hash for critical system binary %@.", path);
+    return nil;
+  }
+  MOLCodesignChecker* csInfo = [binInfo codesignCheckerWithError:NULL];
+
+  // Make sure the critical system binary is signed by the same chain as launchd/self
+  BOOL systemBin = NO;
+  if ([csInfo signingInformationMatches:self.launchdCSInfo]) {
+    systemBin = YES;
+  } else if (![csInfo.teamID isEqualToString:self.santadCSInfo.teamID]) {
+    LOGW(@"Unable to validate critical system binary %@. "
+         @"Not signed by same cert as pid 1: %@ vs %@, and does not match santad TeamID: %@ vs "
+         @"%@.",
+         path, self.launchdCSInfo.leafCertificate, csInfo.leafCertificate,
+         self.santadCSInfo.teamID, csInfo.teamID);
+    return nil;
+  }
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+
+  cd.decision = SNTEventStateAllowSigningID;
+  cd.decisionExtra = systemBin ? @"critical system binary" : @"santa binary";
+  cd.sha256 = binInfo.SHA256;
+  cd.signingID = FormatSigningID(csInfo);
+  cd.cdhash = csInfo.cdhash;
+  cd.secureSigningTime = csInfo.secureSigningTime;
+  cd.signingTime = csInfo.signingTime;
+  cd.signingStatus = IsProductionSigningCert(csInfo.leafCertificate)
+                         ? SNTSigningStatusProduction
+                         : SNTSigningStatusDevelopment;
+
+  // Normalized by the FormatSigningID function so this will always have a
+  // prefix.
+  cd.teamID = [cd.signingID componentsSeparatedByString:@":"].firstObject;
+
+  // Not needed, but nice for logging and events.
+  cd.certChain = csInfo.certificates;
+  cd.certSHA256 = csInfo.leafCertificate.SHA256;
+  cd.certCommonName = csInfo.leafCertificate.commonName;
+
+  return cd;
+}
+
 - (uint32_t)currentSupportedVersion {
   return kRuleTableCurrentVersion;
 }
@@ -346,6 +601,25 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     newVersion = 13;
   }
 
+  if (version < 14) {
+    // Lets outdated transitive rules be found without scanning the whole table.
+    [db executeUpdate:@"CREATE INDEX IF NOT EXISTS execution_rules_state_timestamp ON "
+                      @"execution_rules (state, timestamp)"];
+    newVersion = 14;
+  }
+
+  if (version < 15) {
+    [db executeUpdate:@"CREATE TABLE 'critical_binaries' ("
+                      @"'path' TEXT PRIMARY KEY, "
+                      @"'fsid' INTEGER NOT NULL, "
+                      @"'fileid' INTEGER NOT NULL, "
+                      @"'os_build' TEXT NOT NULL, "
+                      @"'cdhash' TEXT NOT NULL, "
+                      @"'decision' BLOB NOT NULL"
+                      @")"];
+    newVersion = 15;
+  }
+
   // Save signing info for launchd and santad. Used to ensure they are always allowed.
   self.santadCSInfo = [[MOLCodesignChecker alloc] initWithSelf];
   self.launchdCSInfo = [[MOLCodesignChecker alloc] initWithPID:1];
@@ -365,11 +639,21 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   }
 
   // Setup critical system binaries
-  [self setupSystemCriticalBinaries];
+  [self setupSystemCriticalBinariesInDatabase:db];
 
   // Prime the cached static rules.
   [self updateStaticRules:[[SNTConfigurator configurator] staticRules]];
 
+  // Build the in-memory rule index in the background, lookups use the DB until it's ready.
+  _executionRuleIndexQueue = dispatch_queue_create(
+      "com.northpolesec.santa.ruletable.index",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+  self.executionRuleIndexEnabled = [[SNTConfigurator configurator] enableInMemoryRuleIndex];
+  _transitiveRuleReapQueue = dispatch_queue_create(
+      "com.northpolesec.santa.ruletable.reaper",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_BACKGROUND, 0));
+  [self scheduleExecutionRuleIndexRebuild];
+
   return newVersion;
 }
 
@@ -377,7 +661,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (int64_t)executionRuleCount {
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules"];
   }];
   return count;
@@ -385,7 +669,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (int64_t)ruleCountForRuleType:(SNTRuleType)ruleType {
   __block int64_t count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE type=?", @(ruleType)];
   }];
   return count;
@@ -401,7 +685,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (int64_t)compilerRuleCount {
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE state=?",
                              @(SNTRuleStateAllowCompiler)];
   }];
@@ -410,7 +694,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (int64_t)transitiveRuleCount {
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE state=?",
                              @(SNTRuleStateAllowTransitive)];
   }];
@@ -435,7 +719,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (int64_t)fileAccessRuleCount {
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [self fileAccessRuleCountSerialized:db];
   }];
   return count;
@@ -443,7 +727,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (int64_t)networkFlowRuleCount {
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [db longForQuery:@"SELECT COUNT(*) FROM network_flow_rules"];
   }];
   return count;
@@ -485,11 +769,9 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
                                        error:nil];
 }
 
-- (SNTRule*)executionRuleForIdentifiers:(struct RuleIdentifiers)identifiers {
-  __block SNTRule* rule;
-
-  // Look for a static rule that matches.
-  NSDictionary* staticRules = self.cachedStaticRules;
+- (SNTRule*)staticRuleForIdentifiers:(struct RuleIdentifiers)identifiers
+                         staticRules:(NSDictionary*)staticRules {
+  SNTRule* rule;
   if (staticRules.count) {
     // IMPORTANT: The order static rules are checked here should be the same
     // order as given by the SQL query for the rules database.
@@ -518,9 +800,11 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
       return rule;
     }
   }
+  return nil;
+}
 
-  // Now query the database.
-  //
+- (SNTRule*)executionRuleForIdentifiers:(struct RuleIdentifiers)identifiers
+                             inDatabase:(FMDatabase*)db {
   // The intended order of precedence is CDHash > Binaries > Signing IDs > Certificates > Team IDs.
   // The UNION ALL structure lets SQLite evaluate each sub-select independently (potentially
   // short-circuiting via LIMIT 1), while ORDER BY type ASC guarantees the highest-priority
@@ -528,28 +812,141 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   //
   // There is a test for this in SNTRuleTableTests in case SQLite behavior changes in the future.
   //
-  [self inDatabase:^(FMDatabase* db) {
-    FMResultSet* rs =
-        [db executeQuery:@"SELECT * FROM ("
-                         @"  SELECT * FROM execution_rules WHERE identifier=? AND type=500 "
-                         @"  UNION ALL "
-                         @"  SELECT * FROM execution_rules WHERE identifier=? AND type=1000 "
-                         @"  UNION ALL "
-                         @"  SELECT * FROM execution_rules WHERE identifier=? AND type=2000 "
-                         @"  UNION ALL "
-                         @"  SELECT * FROM execution_rules WHERE identifier=? AND type=3000 "
-                         @"  UNION ALL "
-                         @"  SELECT * FROM execution_rules WHERE identifier=? AND type=4000"
-                         @") ORDER BY type ASC LIMIT 1",
-                         identifiers.cdhash, identifiers.binarySHA256, identifiers.signingID,
-                         identifiers.certificateSHA256, identifiers.teamID];
-    if ([rs next]) {
-      rule = [self executionRuleFromResultSet:rs];
+  SNTRule* rule;
+  FMResultSet* rs =
+      [db executeQuery:@"SELECT * FROM ("
+                       @"  SELECT * FROM execution_rules WHERE identifier=? AND type=500 "
+                       @"  UNION ALL "
+                       @"  SELECT * FROM execution_rules WHERE identifier=? AND type=1000 "
+                       @"  UNION ALL "
+                       @"  SELECT * FROM execution_rules WHERE identifier=? AND type=2000 "
+                       @"  UNION ALL "
+                       @"  SELECT * FROM execution_rules WHERE identifier=? AND type=3000 "
+                       @"  UNION ALL "
+                       @"  SELECT * FROM execution_rules WHERE identifier=? AND type=4000"
+                       @") ORDER BY type ASC LIMIT 1",
+                       identifiers.cdhash, identifiers.binarySHA256, identifiers.signingID,
+                       identifiers.certificateSHA256, identifiers.teamID];
+  if ([rs next]) {
+    rule = [self executionRuleFromResultSet:rs];
+  }
+  [rs close];
+  return rule;
+}
+
+- (SNTRule*)executionRuleForIdentifiers:(struct RuleIdentifiers)identifiers {
+  // Look for a static rule that matches.
+  SNTRule* rule = [self staticRuleForIdentifiers:identifiers staticRules:self.cachedStaticRules];
+  if (rule) {
+    return rule;
+  }
+
+  // Use the in-memory index if it's available, it always matches the database contents.
+  SNTExecutionRuleIndex* index = self.executionRuleIndex;
+  if (index) {
+    return [index ruleForIdentifiers:identifiers];
+  }
+
+  // Skip identifiers that have no rule of their type, most execs match no rule at all.
+  SNTExecutionRuleFilter* filter = self.executionRuleFilter;
+  if (filter && ![filter filterIdentifiers:&identifiers]) {
+    return nil;
+  }
+
+  SNTRuleSnapshot* snapshot = self.ruleSnapshot;
+  if (snapshot) {
+    return [snapshot ruleForIdentifiers:identifiers];
+  }
+
+  // Now query the database.
+  __block SNTRule* dbRule;
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
+    dbRule = [self executionRuleForIdentifiers:identifiers inDatabase:db];
+  }];
+
+  return dbRule;
+}
+
+- (NSArray*)executionRulesForIdentifiers:(NSArray<SNTRuleIdentifiers*>*)identifiers {
+  NSMutableArray* rules = [NSMutableArray arrayWithCapacity:identifiers.count];
+
+  // Grab everything once so that the whole batch sees the same rules.
+  NSDictionary* staticRules = self.cachedStaticRules;
+  SNTExecutionRuleIndex* index = self.executionRuleIndex;
+  SNTExecutionRuleFilter* filter = index ? nil : self.executionRuleFilter;
+  SNTRuleSnapshot* snapshot = index ? nil : self.ruleSnapshot;
+
+  NSMutableIndexSet* unresolved = [NSMutableIndexSet indexSet];
+  __block std::vector<struct RuleIdentifiers> filtered(identifiers.count);
+  [identifiers enumerateObjectsUsingBlock:^(SNTRuleIdentifiers* ids, NSUInteger idx, BOOL* stop) {
+    struct RuleIdentifiers ruleIdentifiers = [ids toStruct];
+    SNTRule* rule = [self staticRuleForIdentifiers:ruleIdentifiers staticRules:staticRules];
+    if (!rule && index) {
+      rule = [index ruleForIdentifiers:ruleIdentifiers];
+    } else if (!rule && filter && ![filter filterIdentifiers:&ruleIdentifiers]) {
+      // Nothing left that could match
+    } else if (!rule && snapshot) {
+      rule = [snapshot ruleForIdentifiers:ruleIdentifiers];
+    } else if (!rule) {
+      filtered[idx] = ruleIdentifiers;
+      [unresolved addIndex:idx];
     }
-    [rs close];
+    [rules addObject:rule ?: [NSNull null]];
   }];
 
-  return rule;
+  if (unresolved.count) {
+    [self inReadOnlyDatabase:^(FMDatabase* db) {
+      [unresolved enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL* stop) {
+        SNTRule* rule = [self executionRuleForIdentifiers:filtered[idx] inDatabase:db];
+        if (rule) rules[idx] = rule;
+      }];
+    }];
+  }
+
+  return rules;
+}
+
+- (SNTRule*)executionRuleForIdentityIdentifiers:(struct RuleIdentifiers)identifiers {
+  // Without the index there is no cheap way to know which rule types exist.
+  SNTExecutionRuleIndex* index = self.executionRuleIndex;
+  if (!index) return nil;
+
+  identifiers.binarySHA256 = nil;
+  identifiers.certificateSHA256 = nil;
+
+  // Static rules are checked before the index, so a static Binary or Certificate rule could
+  // override anything found here except a static CDHash rule.
+  NSDictionary<NSString*, SNTRule*>* staticRules = self.cachedStaticRules;
+  SNTRule* rule = staticRules[identifiers.cdhash];
+  if (rule.type == SNTRuleTypeCDHash) {
+    return rule;
+  }
+  for (SNTRule* staticRule in staticRules.objectEnumerator) {
+    if (staticRule.type == SNTRuleTypeBinary || staticRule.type == SNTRuleTypeCertificate) {
+      return nil;
+    }
+  }
+  rule = staticRules[identifiers.signingID];
+  if (rule.type == SNTRuleTypeSigningID) {
+    return rule;
+  }
+  rule = staticRules[identifiers.teamID];
+  if (rule.type == SNTRuleTypeTeamID) {
+    return rule;
+  }
+
+  rule = [index ruleForIdentifiers:identifiers];
+  switch (rule.type) {
+    case SNTRuleTypeCDHash: return rule;
+    case SNTRuleTypeSigningID:
+      return [index countForRuleType:SNTRuleTypeBinary] == 0 ? rule : nil;
+    case SNTRuleTypeTeamID:
+      return ([index countForRuleType:SNTRuleTypeBinary] == 0 &&
+              [index countForRuleType:SNTRuleTypeCertificate] == 0)
+                 ? rule
+                 : nil;
+    default: return nil;
+  }
 }
 
 #pragma mark Adding
@@ -572,6 +969,8 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
       return NO;
     }
 
+    [self removeFileAccessRuleNamed:rule.name fromDigestInDB:db];
+
     if (rule.state == SNTFileAccessRuleStateRemove) {
       if (![db executeUpdate:@"DELETE FROM file_access_rules WHERE name=?", rule.name]) {
         [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeRemoveRuleFailed
@@ -590,12 +989,26 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
                                                  detail:[db lastErrorMessage]]];
         return NO;
       }
+      if (_fileAccessRulesDigest) {
+        _fileAccessRulesDigest->Add(FileAccessRuleRowHash(rule.name, rule.details));
+      }
     }
   }
 
   return YES;
 }
 
+// Remove the stored row for the named file access rule, if there is one, from the running digest.
+- (void)removeFileAccessRuleNamed:(NSString*)name fromDigestInDB:(FMDatabase*)db {
+  if (!_fileAccessRulesDigest) return;
+
+  FMResultSet* rs = [db executeQuery:@"SELECT rule_data FROM file_access_rules WHERE name=?", name];
+  if ([rs next]) {
+    _fileAccessRulesDigest->Remove(FileAccessRuleRowHash(name, [rs dataNoCopyForColumnIndex:0]));
+  }
+  [rs close];
+}
+
 - (BOOL)addNetworkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
                        toDB:(FMDatabase*)db
                      errors:(NSMutableArray<NSError*>*)errors {
@@ -641,6 +1054,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 - (BOOL)addExecutionRules:(NSArray<SNTRule*>*)executionRules
                      toDB:(FMDatabase*)db
                    errors:(NSMutableArray<NSError*>*)errors {
+  NSMutableArray<SNTRule*>* validRules = [NSMutableArray arrayWithCapacity:executionRules.count];
   for (SNTRule* rule in executionRules) {
     if (![rule isKindOfClass:[SNTRule class]] || rule.identifier.length == 0 ||
         rule.state == SNTRuleStateUnknown || rule.type == SNTRuleTypeUnknown) {
@@ -670,6 +1084,43 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
       }
     }
 
+    [validRules addObject:rule];
+  }
+
+  if (validRules.count < kBulkLoadRuleThreshold) {
+    return [self writeExecutionRules:validRules toDB:db errors:errors];
+  }
+
+  // Writing rows in index order keeps updates to the unique index local. The sort is stable so
+  // that multiple changes to the same rule are still applied in the order given.
+  NSComparator indexOrder = ^NSComparisonResult(SNTRule* a, SNTRule* b) {
+    NSComparisonResult res = [a.identifier compare:b.identifier options:NSLiteralSearch];
+    if (res != NSOrderedSame) return res;
+    return a.type < b.type ? NSOrderedAscending
+                           : (a.type > b.type ? NSOrderedDescending : NSOrderedSame);
+  };
+  NSArray<SNTRule*>* sortedRules = [validRules sortedArrayWithOptions:NSSortStable
+                                                      usingComparator:indexOrder];
+
+  if ([db boolForQuery:@"SELECT EXISTS(SELECT 1 FROM execution_rules)"]) {
+    return [self writeExecutionRules:sortedRules toDB:db errors:errors];
+  } else {
+    return [self bulkLoadExecutionRules:sortedRules toDB:db errors:errors];
+  }
+}
+
+// Apply rule additions and removals one at a time.
+- (BOOL)writeExecutionRules:(NSArray<SNTRule*>*)executionRules
+                       toDB:(FMDatabase*)db
+                     errors:(NSMutableArray<NSError*>*)errors {
+  // Reuse the prepared statements across every row in the batch
+  BOOL shouldCacheStatements = db.shouldCacheStatements;
+  db.shouldCacheStatements = YES;
+
+  BOOL success = YES;
+  for (SNTRule* rule in executionRules) {
+    [self removeExecutionRule:rule fromDigestInDB:db];
+
     if (rule.state == SNTRuleStateRemove) {
       if (![db executeUpdate:@"DELETE FROM execution_rules WHERE identifier=? AND type=?",
                              rule.identifier, @(rule.type)]) {
@@ -677,25 +1128,118 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
                               createErrorWithCode:SNTErrorCodeRemoveRuleFailed
                                           message:@"A database error occurred while deleting a rule"
                                            detail:[db lastErrorMessage]]];
-        return NO;
-      }
-    } else {
-      if (![db executeUpdate:@"INSERT OR REPLACE INTO execution_rules "
-                             @"(identifier, state, type, custommsg, customurl, timestamp, "
-                             @"comment, cel_expr, seatbelt_policy, rule_id) "
-                             @"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);",
-                             rule.identifier, @(rule.state), @(rule.type), rule.customMsg,
-                             rule.customURL, @(rule.timestamp), rule.comment, rule.celExpr,
-                             rule.seatbeltPolicy, @(rule.ruleId)]) {
-        [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
-                                                message:@"A database error occurred while "
-                                                        @"inserting/replacing a rule"
-                                                 detail:[db lastErrorMessage]]];
-        return NO;
+        success = NO;
+        break;
       }
+    } else if (![self insertExecutionRule:rule orReplace:YES toDB:db errors:errors]) {
+      success = NO;
+      break;
     }
   }
 
+  db.shouldCacheStatements = shouldCacheStatements;
+  return success;
+}
+
+// Remove the stored row with the same identifier and type as `rule`, if there is one, from the
+// running digest.
+- (void)removeExecutionRule:(SNTRule*)rule fromDigestInDB:(FMDatabase*)db {
+  if (!_executionRulesDigest) return;
+
+  FMResultSet* rs =
+      [db executeQuery:@"SELECT state, cel_expr, seatbelt_policy FROM execution_rules "
+                       @"WHERE identifier=? AND type=? AND state != ?",
+                       rule.identifier, @(rule.type), @(SNTRuleStateAllowTransitive)];
+  if ([rs next]) {
+    _executionRulesDigest->Remove(ExecutionRuleRowHash(rule.identifier, [rs intForColumnIndex:0],
+                                                       (int)rule.type, [rs stringForColumnIndex:1],
+                                                       [rs stringForColumnIndex:2]));
+  }
+  [rs close];
+}
+
+// Load a large batch of rules into an empty table. Rather than updating the unique index for
+// every row, the batch is collapsed in memory the same way INSERT OR REPLACE and DELETE would
+// have applied it, and the index is rebuilt once at the end. Must be called inside a
+// transaction so a failure restores the index.
+- (BOOL)bulkLoadExecutionRules:(NSArray<SNTRule*>*)executionRules
+                          toDB:(FMDatabase*)db
+                        errors:(NSMutableArray<NSError*>*)errors {
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray arrayWithCapacity:executionRules.count];
+  for (SNTRule* rule in executionRules) {
+    // Rules are sorted, so any earlier change to the same rule is the previous entry
+    SNTRule* last = rules.lastObject;
+    if (last && last.type == rule.type && [last.identifier isEqualToString:rule.identifier]) {
+      [rules removeLastObject];
+    }
+    if (rule.state != SNTRuleStateRemove) {
+      [rules addObject:rule];
+    }
+  }
+
+  if (![db executeUpdate:@"DROP INDEX IF EXISTS execution_rules_unique"]) {
+    [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                            message:@"A database error occurred while "
+                                                    @"preparing to load rules"
+                                             detail:[db lastErrorMessage]]];
+    return NO;
+  }
+
+  BOOL shouldCacheStatements = db.shouldCacheStatements;
+  db.shouldCacheStatements = YES;
+
+  // The table is empty, so the digest only covers the rules loaded here
+  _executionRulesDigest.emplace();
+
+  BOOL success = YES;
+  for (SNTRule* rule in rules) {
+    if (![self insertExecutionRule:rule orReplace:NO toDB:db errors:errors]) {
+      success = NO;
+      break;
+    }
+  }
+
+  db.shouldCacheStatements = shouldCacheStatements;
+
+  if (success && ![db executeUpdate:@"CREATE UNIQUE INDEX execution_rules_unique ON "
+                                    @"execution_rules ('identifier', type)"]) {
+    [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                            message:@"A database error occurred while "
+                                                    @"indexing loaded rules"
+                                             detail:[db lastErrorMessage]]];
+    success = NO;
+  }
+
+  return success;
+}
+
+- (BOOL)insertExecutionRule:(SNTRule*)rule
+                  orReplace:(BOOL)orReplace
+                       toDB:(FMDatabase*)db
+                     errors:(NSMutableArray<NSError*>*)errors {
+  // The statements are kept as literals so that each can be cached by FMDB.
+  NSString* sql = orReplace ? @"INSERT OR REPLACE INTO execution_rules "
+                              @"(identifier, state, type, custommsg, customurl, timestamp, "
+                              @"comment, cel_expr, seatbelt_policy, rule_id) "
+                              @"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);"
+                            : @"INSERT INTO execution_rules "
+                              @"(identifier, state, type, custommsg, customurl, timestamp, "
+                              @"comment, cel_expr, seatbelt_policy, rule_id) "
+                              @"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+  if (![db executeUpdate:sql, rule.identifier, @(rule.state), @(rule.type), rule.customMsg,
+                         rule.customURL, @(rule.timestamp), rule.comment, rule.celExpr,
+                         rule.seatbeltPolicy, @(rule.ruleId)]) {
+    [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                            message:@"A database error occurred while "
+                                                    @"inserting/replacing a rule"
+                                             detail:[db lastErrorMessage]]];
+    return NO;
+  }
+  if (_executionRulesDigest && rule.state != SNTRuleStateAllowTransitive) {
+    _executionRulesDigest->Add(ExecutionRuleRowHash(rule.identifier, (int)rule.state,
+                                                    (int)rule.type, rule.celExpr,
+                                                    rule.seatbeltPolicy));
+  }
   return YES;
 }
 
@@ -725,6 +1269,76 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     return NO;
   }
 
+  return [self applyExecutionRules:^BOOL(FMDatabase* db, NSMutableArray<NSError*>* blockErrors) {
+    return [self addExecutionRules:executionRules toDB:db errors:blockErrors];
+  }
+                   fileAccessRules:fileAccessRules
+                  networkFlowRules:networkFlowRules
+                       ruleCleanup:cleanupType
+                            errors:errors];
+}
+
+- (BOOL)replaceExecutionRulesInBuckets:(NSIndexSet*)buckets
+                             withRules:(NSArray<SNTRule*>*)executionRules
+                                errors:(NSArray<NSError*>**)errors {
+  return [self applyExecutionRules:^BOOL(FMDatabase* db, NSMutableArray<NSError*>* blockErrors) {
+    // The digest must exist before rows are removed so that it reflects the removals
+    [self executionRulesHashSerialized:db];
+
+    struct StaleRule {
+      NSString* identifier;
+      int type;
+      RowSetDigest::RowHash row;
+    };
+    std::vector<StaleRule> staleRules;
+
+    // Columns: 0=identifier, 1=state, 2=type, 3=cel_expr, 4=seatbelt_policy.
+    FMResultSet* rs =
+        [db executeQuery:@"SELECT identifier, state, type, cel_expr, seatbelt_policy "
+                         @"FROM execution_rules WHERE state != ?",
+                         @(SNTRuleStateAllowTransitive)];
+    while ([rs next]) {
+      NSString* identifier = [rs stringForColumnIndex:0];
+      int type = [rs intForColumnIndex:2];
+      RowSetDigest::RowHash row =
+          ExecutionRuleRowHash(identifier, [rs intForColumnIndex:1], type,
+                               [rs stringForColumnIndex:3], [rs stringForColumnIndex:4]);
+      if ([buckets containsIndex:RowSetDigest::BucketForRow(row)]) {
+        staleRules.push_back({identifier, type, row});
+      }
+    }
+    [rs close];
+
+    for (const StaleRule& stale : staleRules) {
+      if (![db executeUpdate:@"DELETE FROM execution_rules WHERE identifier=? AND type=?",
+                             stale.identifier, @(stale.type)]) {
+        [blockErrors addObject:[SNTError createErrorWithCode:SNTErrorCodeRemoveRuleFailed
+                                                     message:@"A database error occurred while "
+                                                             @"removing a rule"
+                                                      detail:[db lastErrorMessage]]];
+        return NO;
+      }
+      self->_executionRulesDigest->Remove(stale.row);
+    }
+
+    return executionRules.count == 0 || [self addExecutionRules:executionRules
+                                                           toDB:db
+                                                         errors:blockErrors];
+  }
+                   fileAccessRules:nil
+                  networkFlowRules:nil
+                       ruleCleanup:SNTRuleCleanupNone
+                            errors:errors];
+}
+
+// Performs the rule cleanup, then calls `applyExecutionRules` and adds the file access and
+// network flow rules, all within a single transaction.
+- (BOOL)applyExecutionRules:(BOOL (^)(FMDatabase* db,
+                                      NSMutableArray<NSError*>* errors))applyExecutionRules
+            fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+           networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                ruleCleanup:(SNTRuleCleanup)cleanupType
+                     errors:(NSArray<NSError*>**)errors {
   __block BOOL failed = NO;
   __block NSMutableArray<NSError*>* blockErrors = [NSMutableArray array];
   __block NSString* faaRulesHashBefore;
@@ -733,24 +1347,42 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
   [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
     faaRulesHashBefore = [self fileAccessRulesHashSerialized:db];
+
+    // The running digests are updated as rows are written, so they must be put back if the
+    // transaction is rolled back.
+    std::optional<RowSetDigest> executionRulesDigestBefore = self->_executionRulesDigest;
+    std::optional<RowSetDigest> fileAccessRulesDigestBefore = self->_fileAccessRulesDigest;
+    void (^rollbackDigests)(void) = ^{
+      self->_executionRulesDigest = executionRulesDigestBefore;
+      self->_fileAccessRulesDigest = fileAccessRulesDigestBefore;
+    };
+
+    // Transitive rules are not part of the execution rules digest, so every cleanup type leaves
+    // the digests of the tables it touches empty.
     switch (cleanupType) {
       case SNTRuleCleanupAll:
         [db executeUpdate:@"DELETE FROM execution_rules"];
         [db executeUpdate:@"DELETE FROM file_access_rules"];
         [db executeUpdate:@"DELETE FROM network_flow_rules"];
+        self->_executionRulesDigest.emplace();
+        self->_fileAccessRulesDigest.emplace();
         break;
       case SNTRuleCleanupNonTransitive:
         [db executeUpdate:@"DELETE FROM execution_rules WHERE state != ?",
                           @(SNTRuleStateAllowTransitive)];
         [db executeUpdate:@"DELETE FROM file_access_rules"];
         [db executeUpdate:@"DELETE FROM network_flow_rules"];
+        self->_executionRulesDigest.emplace();
+        self->_fileAccessRulesDigest.emplace();
         break;
       case SNTRuleCleanupExecutionRules:
         [db executeUpdate:@"DELETE FROM execution_rules WHERE state != ?",
                           @(SNTRuleStateAllowTransitive)];
+        self->_executionRulesDigest.emplace();
         break;
       case SNTRuleCleanupFileAccessRules:
         [db executeUpdate:@"DELETE FROM file_access_rules"];
+        self->_fileAccessRulesDigest.emplace();
         break;
       case SNTRuleCleanupNone: [[fallthrough]];
       case SNTRuleCleanupStandalone:
@@ -758,25 +1390,29 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
         break;
     }
 
-    if (![self addExecutionRules:executionRules toDB:db errors:blockErrors]) {
+    if (!applyExecutionRules(db, blockErrors)) {
+      rollbackDigests();
       *rollback = failed = YES;
       return;
     }
 
     if (![self addFileAccessRules:fileAccessRules toDB:db errors:blockErrors]) {
+      rollbackDigests();
       *rollback = failed = YES;
       return;
     }
 
     if (![self addNetworkFlowRules:networkFlowRules toDB:db errors:blockErrors]) {
+      rollbackDigests();
       *rollback = failed = YES;
       return;
     }
 
-    // Clear the rules hashes
-    self.cachedExecutionRulesHash = nil;
-    self.cachedFileAccessRulesHash = nil;
+    // Clear the cached rules hash and lookup caches
     self.cachedNetworkFlowRulesHash = nil;
+    self.executionRuleIndex = nil;
+    self.executionRuleFilter = nil;
+    self.ruleSnapshot = nil;
 
     faaRulesHashAfter = [self fileAccessRulesHashSerialized:db];
     faaRuleCount = [self fileAccessRuleCountSerialized:db];
@@ -792,9 +1428,144 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     self.fileAccessRulesChangedCallback(faaRuleCount);
   }
 
+  if (!failed) {
+    [self scheduleExecutionRuleIndexRebuild];
+  }
+
   return !failed;
 }
 
+#pragma mark Staging
+
+- (BOOL)createStagedExecutionRulesTableInDB:(FMDatabase*)db {
+  // Columns match execution_rules so that rows can be read back with executionRuleFromResultSet:.
+  // Nothing is validated until the staged rules are applied.
+  return [db executeUpdate:@"CREATE TEMP TABLE IF NOT EXISTS staged_execution_rules ("
+                           @"'seq' INTEGER PRIMARY KEY, "
+                           @"'identifier' TEXT, "
+                           @"'state' INTEGER, "
+                           @"'type' INTEGER, "
+                           @"'custommsg' TEXT, "
+                           @"'customurl' TEXT, "
+                           @"'timestamp' INTEGER, "
+                           @"'comment' TEXT, "
+                           @"'cel_expr' TEXT, "
+                           @"'seatbelt_policy' TEXT, "
+                           @"'rule_id' INTEGER)"] &&
+         [db executeUpdate:@"CREATE INDEX IF NOT EXISTS temp.staged_execution_rules_order ON "
+                           @"staged_execution_rules (identifier, type, seq)"];
+}
+
+- (BOOL)stageExecutionRules:(NSArray<SNTRule*>*)executionRules errors:(NSArray<NSError*>**)errors {
+  __block NSError* error;
+
+  [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
+    if (![self createStagedExecutionRulesTableInDB:db]) {
+      error = [SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                    message:@"A database error occurred while staging rules"
+                                     detail:[db lastErrorMessage]];
+      *rollback = YES;
+      return;
+    }
+
+    BOOL shouldCacheStatements = db.shouldCacheStatements;
+    db.shouldCacheStatements = YES;
+    for (SNTRule* rule in executionRules) {
+      if (![rule isKindOfClass:[SNTRule class]]) {
+        error = [SNTError createErrorWithCode:SNTErrorCodeRuleInvalid
+                                      message:@"Execution rule array contained invalid entry"
+                                       detail:rule.description];
+        *rollback = YES;
+        break;
+      }
+
+      if (![db executeUpdate:@"INSERT INTO temp.staged_execution_rules "
+                             @"(identifier, state, type, custommsg, customurl, timestamp, "
+                             @"comment, cel_expr, seatbelt_policy, rule_id) "
+                             @"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+                             rule.identifier, @(rule.state), @(rule.type), rule.customMsg,
+                             rule.customURL, @(rule.timestamp), rule.comment, rule.celExpr,
+                             rule.seatbeltPolicy, @(rule.ruleId)]) {
+        error = [SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                      message:@"A database error occurred while staging a rule"
+                                       detail:[db lastErrorMessage]];
+        *rollback = YES;
+        break;
+      }
+    }
+    db.shouldCacheStatements = shouldCacheStatements;
+  }];
+
+  if (error && errors) *errors = @[ error ];
+  return error == nil;
+}
+
+- (void)discardStagedExecutionRules {
+  [self inDatabase:^(FMDatabase* db) {
+    [db executeUpdate:@"DROP TABLE IF EXISTS temp.staged_execution_rules"];
+  }];
+}
+
+- (BOOL)addStagedExecutionRules:(NSUInteger)expectedCount
+                fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+               networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                    ruleCleanup:(SNTRuleCleanup)cleanupType
+                         errors:(NSArray<NSError*>**)errors {
+  return [self applyExecutionRules:^BOOL(FMDatabase* db, NSMutableArray<NSError*>* blockErrors) {
+    if (![self createStagedExecutionRulesTableInDB:db] ||
+        (NSUInteger)[db longForQuery:@"SELECT COUNT(*) FROM temp.staged_execution_rules"] !=
+            expectedCount) {
+      [blockErrors addObject:[SNTError createErrorWithCode:SNTErrorCodeRuleInvalid
+                                                   message:@"Staged rules are incomplete"
+                                                    detail:[db lastErrorMessage]]];
+      return NO;
+    }
+
+    // Chunks are read in index order, so changes to the same rule stay in the order they were
+    // staged and every chunk after the first is written in index order too.
+    SNTRule* last;
+    int64_t lastSeq = 0;
+    while (YES) {
+      FMResultSet* rs =
+          last ? [db executeQuery:@"SELECT * FROM temp.staged_execution_rules "
+                                  @"WHERE (identifier, type, seq) > (?, ?, ?) "
+                                  @"ORDER BY identifier, type, seq LIMIT ?",
+                                  last.identifier, @(last.type), @(lastSeq),
+                                  @(kStagedRuleChunkSize)]
+               : [db executeQuery:@"SELECT * FROM temp.staged_execution_rules "
+                                  @"ORDER BY identifier, type, seq LIMIT ?",
+                                  @(kStagedRuleChunkSize)];
+      NSMutableArray<SNTRule*>* chunk = [NSMutableArray arrayWithCapacity:kStagedRuleChunkSize];
+      while ([rs next]) {
+        SNTRule* rule = [self executionRuleFromResultSet:rs];
+        if (!rule) {
+          [blockErrors
+              addObject:[SNTError createErrorWithCode:SNTErrorCodeRuleInvalid
+                                              message:@"Staged execution rules contained invalid "
+                                                      @"entry"
+                                               detail:[rs stringForColumn:@"identifier"]]];
+          [rs close];
+          return NO;
+        }
+        [chunk addObject:rule];
+        lastSeq = [rs longLongIntForColumn:@"seq"];
+      }
+      [rs close];
+
+      if (chunk.count == 0) break;
+      if (![self addExecutionRules:chunk toDB:db errors:blockErrors]) return NO;
+      if (chunk.count < kStagedRuleChunkSize) break;
+      last = chunk.lastObject;
+    }
+
+    return [db executeUpdate:@"DROP TABLE IF EXISTS temp.staged_execution_rules"];
+  }
+                   fileAccessRules:fileAccessRules
+                  networkFlowRules:networkFlowRules
+                       ruleCleanup:cleanupType
+                            errors:errors];
+}
+
 - (BOOL)addedRulesShouldFlushDecisionCache:(NSArray*)rules {
   uint64_t nonAllowRuleCount = 0;
 
@@ -820,40 +1591,64 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   // If all rules in the array are allowlist rules,  look for allowlist rules
   // where there is a previously existing allowlist compiler rule for the same
   // identifier.  If so we find such a rule, then cache should be flushed.
+  //
+  // Both checks are done with a single query against a temporary table holding the new rules,
+  // rather than a query per rule.
   __block BOOL flushDecisionCache = NO;
 
   [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
+    if (![db executeUpdate:@"CREATE TEMP TABLE IF NOT EXISTS pending_execution_rules ("
+                           @"'identifier' TEXT NOT NULL, "
+                           @"'state' INTEGER NOT NULL, "
+                           @"'type' INTEGER NOT NULL, "
+                           @"'cel_expr' TEXT)"] ||
+        ![db executeUpdate:@"DELETE FROM temp.pending_execution_rules"]) {
+      // Be conservative if the rules can't be compared
+      flushDecisionCache = YES;
+      return;
+    }
+
+    BOOL shouldCacheStatements = db.shouldCacheStatements;
+    db.shouldCacheStatements = YES;
     for (SNTRule* rule in rules) {
-      if (rule.state != SNTRuleStateAllow) {
-        // If the rule is a CEL rule, block rule, silent block rule, or a compiler rule check if it
-        // already exists in the database. If it is a CEL rule also check the expression is the
-        // same.
-        //
-        // If it does not then flush the cache. To ensure that the new rule is honored.
-        if ([db longForQuery:
-                    @"SELECT COUNT(*) FROM execution_rules WHERE identifier=? AND type=? AND "
-                    @"state=? AND (cel_expr IS NULL OR cel_expr=?) LIMIT 1",
-                    rule.identifier, @(rule.type), @(rule.state), rule.celExpr] == 0) {
-          flushDecisionCache = YES;
-          return;
-        }
-      } else {
-        // At this point we know the rule is an allowlist rule. Check if it's
-        // overriding a compiler rule.
-
-        // Skip certificate and TeamID rules as they cannot be compiler rules.
-        if (rule.type == SNTRuleTypeCertificate || rule.type == SNTRuleTypeTeamID) continue;
-
-        if ([db longForQuery:
-                    @"SELECT COUNT(*) FROM execution_rules WHERE identifier=? AND type IN (?, ?, ?)"
-                    @" AND state=? LIMIT 1",
-                    rule.identifier, @(SNTRuleTypeCDHash), @(SNTRuleTypeBinary),
-                    @(SNTRuleTypeSigningID), @(SNTRuleStateAllowCompiler)] > 0) {
-          flushDecisionCache = YES;
-          return;
-        }
+      // Skip allowlist certificate and TeamID rules as they cannot override compiler rules.
+      if (rule.state == SNTRuleStateAllow &&
+          (rule.type == SNTRuleTypeCertificate || rule.type == SNTRuleTypeTeamID)) {
+        continue;
       }
+
+      if (![db executeUpdate:@"INSERT INTO temp.pending_execution_rules "
+                             @"(identifier, state, type, cel_expr) VALUES (?, ?, ?, ?)",
+                             rule.identifier, @(rule.state), @(rule.type), rule.celExpr]) {
+        flushDecisionCache = YES;
+        break;
+      }
+    }
+    db.shouldCacheStatements = shouldCacheStatements;
+
+    if (!flushDecisionCache) {
+      // A CEL rule, block rule, silent block rule, or compiler rule flushes the cache unless an
+      // identical rule (including the CEL expression) already exists. An allowlist rule flushes
+      // the cache if it overrides an existing allowlist compiler rule.
+      flushDecisionCache = [db
+          boolForQuery:@"SELECT EXISTS ("
+                       @"  SELECT 1 FROM temp.pending_execution_rules p "
+                       @"  WHERE p.state != ? AND NOT EXISTS ("
+                       @"    SELECT 1 FROM execution_rules e "
+                       @"    WHERE e.identifier = p.identifier AND e.type = p.type AND "
+                       @"    e.state = p.state AND (e.cel_expr IS NULL OR e.cel_expr = p.cel_expr)"
+                       @"  )"
+                       @") OR EXISTS ("
+                       @"  SELECT 1 FROM temp.pending_execution_rules p "
+                       @"  JOIN execution_rules e ON e.identifier = p.identifier "
+                       @"  WHERE p.state = ? AND e.type IN (?, ?, ?) AND e.state = ?"
+                       @")",
+                       @(SNTRuleStateAllow), @(SNTRuleStateAllow), @(SNTRuleTypeCDHash),
+                       @(SNTRuleTypeBinary), @(SNTRuleTypeSigningID),
+                       @(SNTRuleStateAllowCompiler)];
     }
+
+    [db executeUpdate:@"DELETE FROM temp.pending_execution_rules"];
   }];
 
   return flushDecisionCache;
@@ -884,34 +1679,203 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   NSUInteger outdatedTimestamp =
       [[NSDate date] timeIntervalSinceReferenceDate] - kTransitiveRuleExpirationSeconds;
 
+  self.lastTransitiveRuleCulling = [NSDate date];
+
+  // Deleting every outdated rule in one statement can hold the database long enough to stall
+  // rule lookups, so they are deleted a chunk at a time in the background.
+  if (_transitiveRuleReapInProgress.exchange(true)) return;
+
+  santa::BackgroundScheduler::Shared().Submit(
+      "transitive_rule_reap", kTransitiveRuleReapMaxDelayNanos, self.transitiveRuleReapQueue, ^{
+        [self inDatabase:^(FMDatabase* db) {
+          self->_transitiveRuleReapBacklog = [db
+              longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE state=? AND timestamp < ?",
+                           @(SNTRuleStateAllowTransitive), @(outdatedTimestamp)];
+        }];
+        [self reapTransitiveRulesBefore:outdatedTimestamp];
+      });
+}
+
+- (void)reapTransitiveRulesBefore:(NSUInteger)timestamp {
+  NSUInteger deleted = [self deleteTransitiveRulesBefore:timestamp
+                                                   limit:kTransitiveRuleReapChunkSize];
+  _transitiveRulesReaped += deleted;
+  uint64_t backlog = _transitiveRuleReapBacklog.load();
+  _transitiveRuleReapBacklog = backlog > deleted ? backlog - deleted : 0;
+
+  if (deleted < kTransitiveRuleReapChunkSize) {
+    _transitiveRuleReapBacklog = 0;
+    [self finishReapingTransitiveRules];
+    return;
+  }
+
+  // Each chunk is scheduled separately so that reaping pauses as soon as the machine goes on
+  // battery or gets busy, and resumes once it is idle again.
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kTransitiveRuleReapPauseNanos),
+                 self.transitiveRuleReapQueue, ^{
+                   santa::BackgroundScheduler::Shared().Submit(
+                       "transitive_rule_reap", kTransitiveRuleReapMaxDelayNanos,
+                       self.transitiveRuleReapQueue, ^{
+                         [self reapTransitiveRulesBefore:timestamp];
+                       });
+                 });
+}
+
+- (void)finishReapingTransitiveRules {
+  _transitiveRuleReapInProgress = false;
+  [self scheduleExecutionRuleIndexRebuild];
+}
+
+- (NSUInteger)deleteTransitiveRulesBefore:(NSUInteger)timestamp limit:(NSUInteger)limit {
+  __block NSUInteger deleted = 0;
   [self inDatabase:^(FMDatabase* db) {
-    if (![db executeUpdate:@"DELETE FROM execution_rules WHERE state=? AND timestamp < ?",
-                           @(SNTRuleStateAllowTransitive), @(outdatedTimestamp)]) {
+    if (![db executeUpdate:@"DELETE FROM execution_rules WHERE rowid IN (SELECT rowid FROM "
+                           @"execution_rules WHERE state=? AND timestamp < ? LIMIT ?)",
+                           @(SNTRuleStateAllowTransitive), @(timestamp), @(limit)]) {
       LOGE(@"Could not remove outdated transitive rules");
+    } else if ([db changes] > 0) {
+      deleted = [db changes];
+      self.executionRuleIndex = nil;
+      self.executionRuleFilter = nil;
+      self.ruleSnapshot = nil;
     }
   }];
+  return deleted;
+}
 
-  self.lastTransitiveRuleCulling = [NSDate date];
+- (SNTTransitiveRuleReapStats)transitiveRuleReapStats:(BOOL)reset {
+  return {
+      .reaped = reset ? _transitiveRulesReaped.exchange(0) : _transitiveRulesReaped.load(),
+      .backlog = _transitiveRuleReapBacklog.load(),
+  };
+}
+
+#pragma mark In-Memory Index
+
+- (void)enableRuleSnapshotAtPath:(NSString*)path {
+  self.ruleSnapshotPath = path;
+  [self scheduleExecutionRuleIndexRebuild];
+}
+
+// Rebuild the in-memory index, rule filter and rule snapshot if they are enabled and not already
+// current. The filter is only needed when the index is disabled.
+// Requests made while a rebuild is waiting to run are coalesced, while requests made once it
+// has started queue another rebuild so that changes committed during the read are never missed.
+- (void)scheduleExecutionRuleIndexRebuild {
+  if (_executionRuleIndexRebuildPending.exchange(true)) {
+    return;
+  }
+
+  dispatch_async(self.executionRuleIndexQueue, ^{
+    self->_executionRuleIndexRebuildPending = false;
+    [self rebuildExecutionRuleIndex];
+  });
+}
+
+- (void)rebuildExecutionRuleIndex {
+  [self inDatabase:^(FMDatabase* db) {
+    BOOL needsIndex = self.executionRuleIndexEnabled && !self.executionRuleIndex;
+    BOOL needsFilter = !self.executionRuleIndexEnabled && !self.executionRuleFilter;
+    NSString* snapshotPath = self.ruleSnapshotPath;
+    BOOL needsSnapshot = snapshotPath && !self.ruleSnapshot;
+    if (!needsIndex && !needsFilter && !needsSnapshot) return;
+
+    NSArray<SNTRule*>* rules;
+    if (needsIndex) {
+      rules = [self executionRulesSerialized:db];
+      SNTExecutionRuleIndex* index = [SNTExecutionRuleIndex indexWithRules:rules];
+      self.executionRuleIndex = index;
+      LOGD(@"Rebuilt in-memory execution rule index with %lu rules", index.count);
+    }
+
+    if (needsFilter) {
+      self.executionRuleFilter = [self executionRuleFilterSerialized:db];
+    }
+
+    if (needsSnapshot) {
+      self.ruleSnapshot = [self ruleSnapshotSerialized:db path:snapshotPath rules:rules];
+    }
+  }];
+}
+
+// Map the snapshot at path, rewriting it first if it doesn't match the current rules.
+// Must be called inside an inDatabase:/inTransaction: block.
+- (SNTRuleSnapshot*)ruleSnapshotSerialized:(FMDatabase*)db
+                                      path:(NSString*)path
+                                     rules:(NSArray<SNTRule*>*)rules {
+  NSString* executionRulesHash = [self executionRulesHashSerialized:db];
+  NSString* transitiveRulesHash = [self transitiveRulesHashSerialized:db];
+
+  SNTRuleSnapshot* snapshot = [SNTRuleSnapshot snapshotWithPath:path error:nil];
+  if ([snapshot.executionRulesHash isEqualToString:executionRulesHash] &&
+      [snapshot.transitiveRulesHash isEqualToString:transitiveRulesHash]) {
+    return snapshot;
+  }
+
+  NSError* error;
+  if (![SNTRuleSnapshot writeRules:rules ?: [self executionRulesSerialized:db]
+                executionRulesHash:executionRulesHash
+               transitiveRulesHash:transitiveRulesHash
+                            toPath:path
+                             error:&error]) {
+    LOGE(@"Failed to write rule snapshot: %@", error.localizedDescription);
+    return nil;
+  }
+
+  snapshot = [SNTRuleSnapshot snapshotWithPath:path error:&error];
+  if (!snapshot) {
+    LOGE(@"Failed to map rule snapshot: %@", error.localizedDescription);
+    return nil;
+  }
+
+  LOGD(@"Wrote rule snapshot with %lu rules", snapshot.count);
+  return snapshot;
+}
+
+// Must be called inside an inDatabase:/inTransaction: block.
+- (SNTExecutionRuleFilter*)executionRuleFilterSerialized:(FMDatabase*)db {
+  NSMutableDictionary<NSNumber*, NSMutableArray<NSString*>*>* identifiersByType =
+      [NSMutableDictionary dictionary];
+  FMResultSet* rs = [db executeQuery:@"SELECT identifier, type FROM execution_rules"];
+  while ([rs next]) {
+    NSString* identifier = [rs stringForColumnIndex:0];
+    if (!identifier) continue;
+    NSNumber* type = @([rs intForColumnIndex:1]);
+    NSMutableArray<NSString*>* identifiers = identifiersByType[type];
+    if (!identifiers) {
+      identifiers = identifiersByType[type] = [NSMutableArray array];
+    }
+    [identifiers addObject:identifier];
+  }
+  [rs close];
+  return [SNTExecutionRuleFilter filterWithIdentifiersByType:identifiersByType];
 }
 
 #pragma mark Querying
 
+// Must be called inside an inDatabase:/inTransaction: block.
+- (NSArray<SNTRule*>*)executionRulesSerialized:(FMDatabase*)db {
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  FMResultSet* rs = [db executeQuery:@"SELECT * FROM execution_rules"];
+  while ([rs next]) {
+    [rules addObject:[self executionRuleFromResultSet:rs]];
+  }
+  [rs close];
+  return rules;
+}
+
 // Retrieve all rules from the Database
 - (NSArray<SNTRule*>*)retrieveAllExecutionRules {
-  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
-  [self inDatabase:^(FMDatabase* db) {
-    FMResultSet* rs = [db executeQuery:@"SELECT * FROM execution_rules"];
-    while ([rs next]) {
-      [rules addObject:[self executionRuleFromResultSet:rs]];
-    }
-    [rs close];
+  __block NSArray<SNTRule*>* rules;
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
+    rules = [self executionRulesSerialized:db];
   }];
   return rules;
 }
 
 - (NSDictionary<NSString*, NSDictionary*>*)retrieveAllFileAccessRules {
   NSMutableDictionary<NSString*, NSDictionary*>* faaRules = [NSMutableDictionary dictionary];
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     FMResultSet* rs = [db executeQuery:@"SELECT * FROM file_access_rules"];
     while ([rs next]) {
       NSDictionary* rule = [self fileAccessRuleFromResultSet:rs];
@@ -1023,67 +1987,87 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 }
 
 - (NSString*)executionRulesHashSerialized:(FMDatabase*)db {
-  // If santad has previously computed the hash and stored it in memory, return it.
-  // When a rule is added or removed the hash will be cleared so that the next
-  // request for the hash will recompute it.
-  if (self.cachedExecutionRulesHash.length) {
-    return self.cachedExecutionRulesHash;
+  // Once computed, the digest is kept up to date by every write to the table so only the first
+  // request needs to scan it.
+  if (!_executionRulesDigest) {
+    RowSetDigest digest;
+
+    // Indexed-column access keeps this loop cheap; column order matches the SELECT below.
+    // Columns: 0=identifier, 1=state, 2=type, 3=cel_expr, 4=seatbelt_policy.
+    FMResultSet* rs =
+        [db executeQuery:@"SELECT identifier, state, type, cel_expr, seatbelt_policy "
+                         @"FROM execution_rules WHERE state != ?",
+                         @(SNTRuleStateAllowTransitive)];
+    while ([rs next]) {
+      digest.Add(ExecutionRuleRowHash([rs stringForColumnIndex:0], [rs intForColumnIndex:1],
+                                      [rs intForColumnIndex:2], [rs stringForColumnIndex:3],
+                                      [rs stringForColumnIndex:4]));
+    }
+    [rs close];
+
+    _executionRulesDigest = digest;
   }
 
+  return _executionRulesDigest->HexDigest();
+}
+
+- (NSData*)executionRulesBucketDigests {
+  __block NSData* digests;
+  [self inDatabase:^(FMDatabase* db) {
+    [self executionRulesHashSerialized:db];
+    digests = self->_executionRulesDigest->BucketDigests();
+  }];
+  return digests;
+}
+
+// Transitive rules are excluded from the execution rules hash since they are local to this host,
+// but rule snapshots must still be invalidated when they change.
+- (NSString*)transitiveRulesHashSerialized:(FMDatabase*)db {
   santa::Xxhash128 hash;
 
-  // Indexed-column access keeps this loop cheap; column order matches the SELECT below.
-  // Columns: 0=identifier, 1=state, 2=type, 3=cel_expr, 4=seatbelt_policy.
-  FMResultSet* rs = [db executeQuery:@"SELECT identifier, state, type, cel_expr, seatbelt_policy "
-                                     @"FROM execution_rules WHERE state != ?",
-                                     @(SNTRuleStateAllowTransitive)];
+  FMResultSet* rs =
+      [db executeQuery:@"SELECT identifier, type FROM execution_rules WHERE state = ?",
+                       @(SNTRuleStateAllowTransitive)];
   while ([rs next]) {
     NSString* identifier = [rs stringForColumnIndex:0];
-    int state = [rs intForColumnIndex:1];
-    int type = [rs intForColumnIndex:2];
-    NSString* cel = [rs stringForColumnIndex:3];
-    NSString* seatbeltPolicy = [rs stringForColumnIndex:4];
+    int type = [rs intForColumnIndex:1];
 
     hash.Update(identifier.UTF8String,
                 [identifier lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
-    hash.Update(cel.UTF8String, [cel lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
-    hash.Update(seatbeltPolicy.UTF8String,
-                [seatbeltPolicy lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
-    hash.Update(static_cast<void*>(&state), sizeof(state));
     hash.Update(static_cast<void*>(&type), sizeof(type));
   }
   [rs close];
 
-  NSString* digest = santa::StringToNSString(hash.HexDigest());
-  self.cachedExecutionRulesHash = digest;
-  return digest;
+  return santa::StringToNSString(hash.HexDigest());
 }
 
 - (NSString*)fileAccessRulesHashSerialized:(FMDatabase*)db {
-  // If santad has previously computed the hash and stored it in memory, return it.
-  // When a rule is added or removed the hash will be cleared so that the next
-  // request for the hash will recompute it.
-  if (self.cachedFileAccessRulesHash.length) {
-    return self.cachedFileAccessRulesHash;
-  }
+  // Once computed, the digest is kept up to date by every write to the table so only the first
+  // request needs to scan it.
+  if (!_fileAccessRulesDigest) {
+    RowSetDigest digest;
 
-  santa::Xxhash128 hash;
-
-  // Indexed-column access keeps this loop cheap; column order matches the SELECT below.
-  // Columns: 0=name, 1=rule_data.
-  FMResultSet* rs = [db executeQuery:@"SELECT name, rule_data FROM file_access_rules"];
-  while ([rs next]) {
-    NSString* name = [rs stringForColumnIndex:0];
-    NSData* blob = [rs dataNoCopyForColumnIndex:1];
+    // Columns: 0=name, 1=rule_data.
+    FMResultSet* rs = [db executeQuery:@"SELECT name, rule_data FROM file_access_rules"];
+    while ([rs next]) {
+      digest.Add(FileAccessRuleRowHash([rs stringForColumnIndex:0],
+                                       [rs dataNoCopyForColumnIndex:1]));
+    }
+    [rs close];
 
-    hash.Update(name.UTF8String, [name lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
-    hash.Update(blob.bytes, blob.length);
+    _fileAccessRulesDigest = digest;
   }
-  [rs close];
 
-  NSString* digest = santa::StringToNSString(hash.HexDigest());
-  self.cachedFileAccessRulesHash = digest;
-  return digest;
+  return _fileAccessRulesDigest->HexDigest();
+}
+
+- (NSData*)fileAccessRulesBucketDigests {
+  __block NSData* digests;
+  [self inDatabase:^(FMDatabase* db) {
+    [self fileAccessRulesHashSerialized:db];
+    digests = self->_fileAccessRulesDigest->BucketDigests();
+  }];
+  return digests;
 }
 
 - (NSString*)networkFlowRulesHashSerialized:(FMDatabase*)db {
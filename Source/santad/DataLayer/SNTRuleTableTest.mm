@@ -31,6 +31,9 @@
 #import "Source/common/SNTRuleIdentifiers.h"
 #import "Source/common/SigningIDHelpers.h"
 #import "Source/common/TestUtils.h"
+#import "Source/santad/DataLayer/SNTExecutionRuleFilter.h"
+#import "Source/santad/DataLayer/SNTExecutionRuleIndex.h"
+#import "Source/santad/DataLayer/SNTRuleSnapshot.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 
 /// This test case actually tests SNTRuleTable and SNTRule
@@ -49,6 +52,16 @@
 @property(readwrite) NSString* celExpr;
 @end
 
+@interface SNTRuleTable (Testing)
+@property(atomic) SNTExecutionRuleIndex* executionRuleIndex;
+@property(atomic) BOOL executionRuleIndexEnabled;
+@property(atomic) SNTExecutionRuleFilter* executionRuleFilter;
+@property(readonly) dispatch_queue_t executionRuleIndexQueue;
+@property(atomic) SNTRuleSnapshot* ruleSnapshot;
+- (void)scheduleExecutionRuleIndexRebuild;
+- (NSUInteger)deleteTransitiveRulesBefore:(NSUInteger)timestamp limit:(NSUInteger)limit;
+@end
+
 @implementation SNTRuleTableTest
 
 - (void)setUp {
@@ -182,6 +195,180 @@
   XCTAssertNil(errors);
 }
 
+- (void)testBulkLoadRules {
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  for (int i = 0; i < 2000; i++) {
+    SNTRule* r = [self _exampleBinaryRule];
+    r.identifier = [NSString stringWithFormat:@"%064x", i];
+    [rules addObject:r];
+  }
+
+  // Later changes to the same rule in the batch win, including removals
+  SNTRule* replaced = [self _exampleBinaryRule];
+  replaced.identifier = rules[10].identifier;
+  replaced.state = SNTRuleStateAllow;
+  [rules addObject:replaced];
+
+  SNTRule* removed = [self _exampleBinaryRule];
+  removed.identifier = rules[20].identifier;
+  removed.state = SNTRuleStateRemove;
+  [rules addObject:removed];
+
+  SNTRule* readded = [self _exampleBinaryRule];
+  readded.identifier = rules[30].identifier;
+  removed = [self _exampleBinaryRule];
+  removed.identifier = rules[30].identifier;
+  removed.state = SNTRuleStateRemove;
+  [rules addObject:removed];
+  [rules addObject:readded];
+
+  [rules addObject:[self _exampleCertRule]];
+
+  NSArray<NSError*>* errors;
+  XCTAssertTrue([self.sut addExecutionRules:rules ruleCleanup:SNTRuleCleanupAll errors:&errors]);
+  XCTAssertNil(errors);
+  XCTAssertEqual(self.sut.binaryRuleCount, 1999);
+  XCTAssertEqual(self.sut.certificateRuleCount, 1);
+
+  SNTRule* r = [self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                                         .binarySHA256 = rules[10].identifier,
+                                                     }];
+  XCTAssertEqual(r.state, SNTRuleStateAllow);
+  XCTAssertNil([self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                                         .binarySHA256 = rules[20].identifier,
+                                                     }]);
+  XCTAssertNotNil([self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                                            .binarySHA256 = rules[30].identifier,
+                                                        }]);
+
+  // The unique index is restored, so later additions still replace existing rules
+  __block BOOL hasIndex;
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    hasIndex = [db boolForQuery:@"SELECT EXISTS(SELECT 1 FROM sqlite_master WHERE type='index' "
+                                @"AND name='execution_rules_unique')"];
+  }];
+  XCTAssertTrue(hasIndex);
+
+  XCTAssertTrue([self.sut addExecutionRules:@[ [self _exampleCertRule] ]
+                                ruleCleanup:SNTRuleCleanupNone
+                                     errors:nil]);
+  XCTAssertEqual(self.sut.certificateRuleCount, 1);
+}
+
+- (void)testFailedBulkLoadRestoresRules {
+  [self.sut addExecutionRules:@[ [self _exampleCertRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  for (int i = 0; i < 2000; i++) {
+    SNTRule* r = [self _exampleBinaryRule];
+    r.identifier = [NSString stringWithFormat:@"%064x", i];
+    [rules addObject:r];
+  }
+  SNTRule* invalid = [self _exampleBinaryRule];
+  invalid.state = SNTRuleStateUnknown;
+  [rules addObject:invalid];
+
+  XCTAssertFalse([self.sut addExecutionRules:rules ruleCleanup:SNTRuleCleanupAll errors:nil]);
+  XCTAssertEqual(self.sut.executionRuleCount, 1);
+  XCTAssertEqual(self.sut.certificateRuleCount, 1);
+}
+
+- (void)testAddStagedExecutionRules {
+  XCTAssertTrue([self.sut addExecutionRules:@[ [self _exampleCertRule] ]
+                                ruleCleanup:SNTRuleCleanupNone
+                                     errors:nil]);
+
+  // Stage more rules than are applied in one chunk, over several batches
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  for (int i = 0; i < 12000; i++) {
+    SNTRule* r = [self _exampleBinaryRule];
+    r.identifier = [NSString stringWithFormat:@"%064x", i];
+    [rules addObject:r];
+  }
+  XCTAssertTrue([self.sut stageExecutionRules:[rules subarrayWithRange:NSMakeRange(0, 5000)]
+                                       errors:nil]);
+  XCTAssertTrue([self.sut stageExecutionRules:[rules subarrayWithRange:NSMakeRange(5000, 7000)]
+                                       errors:nil]);
+
+  // Later changes to the same rule win, even when staged in a later batch
+  SNTRule* replaced = [self _exampleBinaryRule];
+  replaced.identifier = rules[10].identifier;
+  replaced.state = SNTRuleStateAllow;
+  SNTRule* removed = [self _exampleBinaryRule];
+  removed.identifier = rules[20].identifier;
+  removed.state = SNTRuleStateRemove;
+  XCTAssertTrue([self.sut stageExecutionRules:@[ replaced, removed ] errors:nil]);
+
+  // Staged rules aren't visible until they're added
+  XCTAssertEqual(self.sut.binaryRuleCount, 0);
+
+  // The count must match what was staged
+  NSArray<NSError*>* errors;
+  XCTAssertFalse([self.sut addStagedExecutionRules:12001
+                                   fileAccessRules:nil
+                                  networkFlowRules:nil
+                                       ruleCleanup:SNTRuleCleanupAll
+                                            errors:&errors]);
+  XCTAssertEqual(errors.count, 1);
+  XCTAssertEqual(self.sut.certificateRuleCount, 1);
+
+  errors = nil;
+  XCTAssertTrue([self.sut addStagedExecutionRules:12002
+                                  fileAccessRules:nil
+                                 networkFlowRules:nil
+                                      ruleCleanup:SNTRuleCleanupAll
+                                           errors:&errors]);
+  XCTAssertNil(errors);
+  XCTAssertEqual(self.sut.binaryRuleCount, 11999);
+  XCTAssertEqual(self.sut.certificateRuleCount, 0);
+
+  SNTRule* r = [self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                                         .binarySHA256 = rules[10].identifier,
+                                                     }];
+  XCTAssertEqual(r.state, SNTRuleStateAllow);
+  XCTAssertNil([self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                                         .binarySHA256 = rules[20].identifier,
+                                                     }]);
+
+  // The staged rules are gone once they've been added
+  XCTAssertFalse([self.sut addStagedExecutionRules:12002
+                                   fileAccessRules:nil
+                                  networkFlowRules:nil
+                                       ruleCleanup:SNTRuleCleanupAll
+                                            errors:nil]);
+  XCTAssertEqual(self.sut.binaryRuleCount, 11999);
+}
+
+- (void)testFailedStagedExecutionRulesRestoresRules {
+  XCTAssertTrue([self.sut addExecutionRules:@[ [self _exampleCertRule] ]
+                                ruleCleanup:SNTRuleCleanupNone
+                                     errors:nil]);
+
+  SNTRule* invalid = [self _exampleBinaryRule];
+  invalid.state = SNTRuleStateUnknown;
+  XCTAssertTrue([self.sut stageExecutionRules:@[ [self _exampleBinaryRule], invalid ] errors:nil]);
+
+  XCTAssertFalse([self.sut addStagedExecutionRules:2
+                                   fileAccessRules:nil
+                                  networkFlowRules:nil
+                                       ruleCleanup:SNTRuleCleanupAll
+                                            errors:nil]);
+  XCTAssertEqual(self.sut.executionRuleCount, 1);
+  XCTAssertEqual(self.sut.certificateRuleCount, 1);
+
+  // Discarding starts a new staged set
+  [self.sut discardStagedExecutionRules];
+  XCTAssertTrue([self.sut stageExecutionRules:@[ [self _exampleBinaryRule] ] errors:nil]);
+  XCTAssertTrue([self.sut addStagedExecutionRules:1
+                                  fileAccessRules:nil
+                                 networkFlowRules:nil
+                                      ruleCleanup:SNTRuleCleanupNone
+                                           errors:nil]);
+  XCTAssertEqual(self.sut.binaryRuleCount, 1);
+}
+
 - (void)testAddMultipleRules {
   NSUInteger executionRuleCount = self.sut.executionRuleCount;
 
@@ -385,6 +572,33 @@
   XCTAssertNil(r);
 }
 
+- (void)testFetchRulesForIdentifiersBatch {
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule], [self _exampleTeamIDRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+
+  NSArray* rules = [self.sut executionRulesForIdentifiers:@[
+    [[SNTRuleIdentifiers alloc]
+        initWithRuleIdentifiers:(struct RuleIdentifiers){
+                                    .binarySHA256 = @"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa"
+                                                    @"5c56eb0bb54bc422a8f8b670",
+                                }],
+    [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:(struct RuleIdentifiers){
+                                                            .teamID = @"NOTATEAMID",
+                                                        }],
+    [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:(struct RuleIdentifiers){
+                                                            .teamID = @"ABCDEFGHIJ",
+                                                        }],
+  ]];
+
+  XCTAssertEqual(rules.count, 3);
+  XCTAssertEqual(((SNTRule*)rules[0]).type, SNTRuleTypeBinary);
+  XCTAssertEqualObjects(rules[1], [NSNull null]);
+  XCTAssertEqual(((SNTRule*)rules[2]).type, SNTRuleTypeTeamID);
+
+  XCTAssertEqualObjects([self.sut executionRulesForIdentifiers:@[]], @[]);
+}
+
 - (void)testFetchCertificateRule {
   [self.sut addExecutionRules:@[ [self _exampleBinaryRule], [self _exampleCertRule] ]
                   ruleCleanup:SNTRuleCleanupNone
@@ -584,6 +798,274 @@
   XCTAssertEqual(r.type, SNTRuleTypeTeamID, @"Implicit rule ordering failed (TeamID)");
 }
 
+- (void)waitForExecutionRuleIndex {
+  dispatch_sync(self.sut.executionRuleIndexQueue, ^{
+                });
+}
+
+- (void)testInMemoryRuleIndex {
+  [self.sut addExecutionRules:@[
+    [self _exampleCertRule],
+    [self _exampleBinaryRule],
+    [self _exampleTeamIDRule],
+    [self _exampleSigningIDRuleIsPlatform:NO],
+    [self _exampleCDHashRule],
+  ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  [self.sut updateStaticRules:nil];
+
+  XCTAssertNil(self.sut.executionRuleIndex);
+  self.sut.executionRuleIndexEnabled = YES;
+  [self.sut scheduleExecutionRuleIndexRebuild];
+  [self waitForExecutionRuleIndex];
+  XCTAssertEqual(self.sut.executionRuleIndex.count, 5);
+
+  struct RuleIdentifiers ids = {
+      .cdhash = @"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670a",
+      .binarySHA256 = @"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670",
+      .signingID = @"ABCDEFGHIJ:signingID",
+      .certificateSHA256 = @"7ae80b9ab38af0c63a9a81765f434d9a7cd8f720eb6037ef303de39d779bc258",
+      .teamID = @"ABCDEFGHIJ",
+  };
+
+  // The index follows the same precedence as the database query
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeCDHash);
+  ids.cdhash = @"unknown";
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeBinary);
+  ids.binarySHA256 = nil;
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeSigningID);
+  ids.signingID = @"unknown";
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeCertificate);
+  ids.certificateSHA256 = nil;
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeTeamID);
+  ids.teamID = @"unknown";
+  XCTAssertNil([self.sut executionRuleForIdentifiers:ids]);
+
+  // Changing rules drops the index immediately so lookups see the new rules right away, then
+  // the index is rebuilt in the background.
+  SNTRule* removeTeamID = [self _exampleTeamIDRule];
+  removeTeamID.state = SNTRuleStateRemove;
+  ids.teamID = @"ABCDEFGHIJ";
+
+  dispatch_suspend(self.sut.executionRuleIndexQueue);
+  XCTAssertTrue([self.sut addExecutionRules:@[ removeTeamID, [self _exampleTransitiveRule] ]
+                                ruleCleanup:SNTRuleCleanupNone
+                                     errors:nil]);
+  XCTAssertNil(self.sut.executionRuleIndex);
+  XCTAssertNil([self.sut executionRuleForIdentifiers:ids]);
+  dispatch_resume(self.sut.executionRuleIndexQueue);
+
+  [self waitForExecutionRuleIndex];
+  XCTAssertEqual(self.sut.executionRuleIndex.count, 5);
+  XCTAssertNil([self.sut executionRuleForIdentifiers:ids]);
+  SNTRule* r = [self.sut
+      executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                      .binarySHA256 = [self _exampleTransitiveRule].identifier,
+                                  }];
+  XCTAssertEqual(r.state, SNTRuleStateAllowTransitive);
+
+  // Failed updates leave the index in place
+  SNTRule* invalid = [self _exampleBinaryRule];
+  invalid.state = SNTRuleStateUnknown;
+  XCTAssertFalse([self.sut addExecutionRules:@[ invalid ]
+                                 ruleCleanup:SNTRuleCleanupAll
+                                      errors:nil]);
+  XCTAssertEqual(self.sut.executionRuleIndex.count, 5);
+}
+
+- (void)testExecutionRuleFilter {
+  self.sut.executionRuleIndexEnabled = NO;
+  [self.sut updateStaticRules:nil];
+  NSArray* initial = @[ [self _exampleBinaryRule], [self _exampleTeamIDRule] ];
+  XCTAssertTrue([self.sut addExecutionRules:initial ruleCleanup:SNTRuleCleanupNone errors:nil]);
+  [self waitForExecutionRuleIndex];
+  XCTAssertNotNil(self.sut.executionRuleFilter);
+
+  struct RuleIdentifiers ids = {
+      .cdhash = @"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670a",
+      .binarySHA256 = @"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670",
+      .signingID = @"ABCDEFGHIJ:signingID",
+      .teamID = @"ABCDEFGHIJ",
+  };
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeBinary);
+  ids.binarySHA256 = @"unknown";
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeTeamID);
+  ids.teamID = @"unknown";
+  XCTAssertNil([self.sut executionRuleForIdentifiers:ids]);
+
+  NSArray* rules = [self.sut executionRulesForIdentifiers:@[
+    [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:ids],
+    [[SNTRuleIdentifiers alloc]
+        initWithRuleIdentifiers:(struct RuleIdentifiers){.teamID = @"ABCDEFGHIJ"}],
+  ]];
+  XCTAssertEqualObjects(rules[0], [NSNull null]);
+  XCTAssertEqual([rules[1] type], SNTRuleTypeTeamID);
+
+  // Changing rules drops the filter so lookups can see the new rules right away
+  dispatch_suspend(self.sut.executionRuleIndexQueue);
+  XCTAssertTrue([self.sut addExecutionRules:@[ [self _exampleCDHashRule] ]
+                                ruleCleanup:SNTRuleCleanupNone
+                                     errors:nil]);
+  XCTAssertNil(self.sut.executionRuleFilter);
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeCDHash);
+  dispatch_resume(self.sut.executionRuleIndexQueue);
+
+  [self waitForExecutionRuleIndex];
+  XCTAssertNotNil(self.sut.executionRuleFilter);
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeCDHash);
+}
+
+- (void)testIdentityRuleLookup {
+  [self.sut addExecutionRules:@[
+    [self _exampleTeamIDRule],
+    [self _exampleSigningIDRuleIsPlatform:NO],
+    [self _exampleCDHashRule],
+  ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  [self.sut updateStaticRules:nil];
+
+  struct RuleIdentifiers ids = {
+      .cdhash = @"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670a",
+      .binarySHA256 = @"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670",
+      .signingID = @"ABCDEFGHIJ:signingID",
+      .teamID = @"ABCDEFGHIJ",
+  };
+
+  // Nothing is known about which rule types exist until the index is built
+  XCTAssertNil([self.sut executionRuleForIdentityIdentifiers:ids]);
+  self.sut.executionRuleIndexEnabled = YES;
+  [self.sut scheduleExecutionRuleIndexRebuild];
+  [self waitForExecutionRuleIndex];
+
+  XCTAssertEqual([self.sut executionRuleForIdentityIdentifiers:ids].type, SNTRuleTypeCDHash);
+  ids.cdhash = @"unknown";
+  XCTAssertEqual([self.sut executionRuleForIdentityIdentifiers:ids].type, SNTRuleTypeSigningID);
+  ids.signingID = @"unknown";
+  XCTAssertEqual([self.sut executionRuleForIdentityIdentifiers:ids].type, SNTRuleTypeTeamID);
+
+  // Once a certificate rule exists a Team ID match is no longer final, but a Signing ID one is
+  [self.sut addExecutionRules:@[ [self _exampleCertRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  [self waitForExecutionRuleIndex];
+  XCTAssertNil([self.sut executionRuleForIdentityIdentifiers:ids]);
+  ids.signingID = @"ABCDEFGHIJ:signingID";
+  XCTAssertEqual([self.sut executionRuleForIdentityIdentifiers:ids].type, SNTRuleTypeSigningID);
+
+  // A binary rule could override anything but a CDHash rule
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  [self waitForExecutionRuleIndex];
+  XCTAssertNil([self.sut executionRuleForIdentityIdentifiers:ids]);
+  ids.cdhash = @"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670a";
+  XCTAssertEqual([self.sut executionRuleForIdentityIdentifiers:ids].type, SNTRuleTypeCDHash);
+}
+
+- (void)testRuleSnapshot {
+  NSString* path = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.snapshot", [NSUUID UUID]]];
+
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule], [self _exampleTeamIDRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  [self.sut updateStaticRules:nil];
+
+  [self.sut enableRuleSnapshotAtPath:path];
+  [self waitForExecutionRuleIndex];
+  XCTAssertNotNil(self.sut.ruleSnapshot);
+  XCTAssertEqual(self.sut.ruleSnapshot.count, 2);
+  XCTAssertEqualObjects(self.sut.ruleSnapshot.executionRulesHash,
+                        self.sut.hashOfHashes.executionRulesHash);
+
+  struct RuleIdentifiers ids = {
+      .binarySHA256 = [self _exampleBinaryRule].identifier,
+      .teamID = [self _exampleTeamIDRule].identifier,
+  };
+  XCTAssertEqual([self.sut executionRuleForIdentifiers:ids].type, SNTRuleTypeBinary);
+
+  // Adding a transitive rule doesn't change the execution rules hash but must still update the
+  // snapshot
+  dispatch_suspend(self.sut.executionRuleIndexQueue);
+  [self.sut addExecutionRules:@[ [self _exampleTransitiveRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  XCTAssertNil(self.sut.ruleSnapshot);
+  dispatch_resume(self.sut.executionRuleIndexQueue);
+  [self waitForExecutionRuleIndex];
+
+  XCTAssertEqual(self.sut.ruleSnapshot.count, 3);
+  SNTRule* r = [self.sut
+      executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                      .binarySHA256 = [self _exampleTransitiveRule].identifier,
+                                  }];
+  XCTAssertEqual(r.state, SNTRuleStateAllowTransitive);
+
+  // An up to date snapshot on disk is reused rather than rewritten
+  NSDate* modified =
+      [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil].fileModificationDate;
+  self.sut.ruleSnapshot = nil;
+  [self.sut enableRuleSnapshotAtPath:path];
+  [self waitForExecutionRuleIndex];
+  XCTAssertEqual(self.sut.ruleSnapshot.count, 3);
+  XCTAssertEqualObjects(
+      [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil].fileModificationDate,
+      modified);
+
+  [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+- (void)testReadPoolDoesNotWaitForWriter {
+  NSString* dbPath = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.db", [NSUUID UUID]]];
+  FMDatabaseQueue* dbq = [[FMDatabaseQueue alloc] initWithPath:dbPath];
+  SNTRuleTable* sut = [[SNTRuleTable alloc] initWithDatabaseQueue:dbq];
+  [sut updateStaticRules:nil];
+
+  XCTAssertTrue([sut enableReadPoolWithMaximumConnections:2]);
+  [sut addExecutionRules:@[ [self _exampleBinaryRule] ] ruleCleanup:SNTRuleCleanupNone errors:nil];
+
+  // Hold the writer connection and make sure reads still complete
+  dispatch_semaphore_t writerHeld = dispatch_semaphore_create(0);
+  dispatch_semaphore_t releaseWriter = dispatch_semaphore_create(0);
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    [dbq inDatabase:^(FMDatabase* db) {
+      dispatch_semaphore_signal(writerHeld);
+      dispatch_semaphore_wait(releaseWriter, DISPATCH_TIME_FOREVER);
+    }];
+  });
+  XCTAssertEqual(0, dispatch_semaphore_wait(writerHeld,
+                                            dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+
+  dispatch_semaphore_t readDone = dispatch_semaphore_create(0);
+  NSString* identifier = [self _exampleBinaryRule].identifier;
+  __block SNTRule* rule;
+  __block int64_t count;
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    rule = [sut executionRuleForIdentifiers:(struct RuleIdentifiers){.binarySHA256 = identifier}];
+    count = sut.executionRuleCount;
+    dispatch_semaphore_signal(readDone);
+  });
+  XCTAssertEqual(0, dispatch_semaphore_wait(readDone,
+                                            dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+  dispatch_semaphore_signal(releaseWriter);
+
+  XCTAssertEqualObjects(rule, [self _exampleBinaryRule]);
+  XCTAssertEqual(count, 1);
+
+  [dbq close];
+  for (NSString* suffix in @[ @"", @"-wal", @"-shm" ]) {
+    [[NSFileManager defaultManager] removeItemAtPath:[dbPath stringByAppendingString:suffix]
+                                               error:NULL];
+  }
+}
+
+- (void)testReadPoolRequiresFileDatabase {
+  XCTAssertFalse([self.sut enableReadPoolWithMaximumConnections:2]);
+}
+
 - (void)testBadDatabase {
   NSString* dbPath = [NSTemporaryDirectory() stringByAppendingString:@"sntruletabletest_baddb.db"];
   [@"some text" writeToFile:dbPath atomically:YES encoding:NSUTF8StringEncoding error:NULL];
@@ -751,6 +1233,80 @@
   XCTAssertEqualObjects(teamID, cd.teamID, @"team IDs should match");
 }
 
+- (void)testCriticalBinariesAreReusedAcrossLaunches {
+  SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:@"/usr/libexec/trustd"];
+  NSString* signingID = FormatSigningID([fi codesignCheckerWithError:nil]);
+  SNTCachedDecision* original = self.sut.criticalSystemBinaries[signingID];
+  XCTAssertNotNil(original);
+
+  // Alter the stored decision so a reused one can be told apart from a recomputed one
+  __block NSData* stored;
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    stored = [db dataForQuery:@"SELECT decision FROM critical_binaries WHERE path=?",
+                              @"/usr/libexec/trustd"];
+  }];
+  NSMutableDictionary* dict =
+      [NSPropertyListSerialization propertyListWithData:stored
+                                                options:NSPropertyListMutableContainers
+                                                 format:NULL
+                                                  error:NULL];
+  XCTAssertNotNil(dict);
+  dict[@"decision_extra"] = @"stored";
+  NSData* altered =
+      [NSPropertyListSerialization dataWithPropertyList:dict
+                                                 format:NSPropertyListBinaryFormat_v1_0
+                                                options:0
+                                                  error:NULL];
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    [db executeUpdate:@"UPDATE critical_binaries SET decision=? WHERE path=?", altered,
+                      @"/usr/libexec/trustd"];
+  }];
+
+  SNTCachedDecision* reused =
+      [[SNTRuleTable alloc] initWithDatabaseQueue:self.dbq].criticalSystemBinaries[signingID];
+  XCTAssertEqualObjects(reused.decisionExtra, @"stored");
+  XCTAssertEqualObjects(reused.sha256, original.sha256);
+  XCTAssertEqualObjects(reused.cdhash, original.cdhash);
+  XCTAssertEqualObjects(reused.certChain, original.certChain);
+  XCTAssertEqualObjects(reused.teamID, original.teamID);
+  XCTAssertEqual(reused.signingStatus, original.signingStatus);
+
+  // A decision stored under a different OS build is recomputed
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    [db executeUpdate:@"UPDATE critical_binaries SET os_build='0A000'"];
+  }];
+  SNTCachedDecision* recomputed =
+      [[SNTRuleTable alloc] initWithDatabaseQueue:self.dbq].criticalSystemBinaries[signingID];
+  XCTAssertEqualObjects(recomputed.decisionExtra, original.decisionExtra);
+  XCTAssertEqualObjects(recomputed.sha256, original.sha256);
+}
+
+- (void)testDeleteTransitiveRulesInChunks {
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  for (int i = 0; i < 5; i++) {
+    SNTRule* r = [self _exampleTransitiveRule];
+    r.identifier = [NSString stringWithFormat:@"%064x", i];
+    [rules addObject:r];
+  }
+  [rules addObject:[self _exampleBinaryRule]];
+  XCTAssertTrue([self.sut addExecutionRules:rules ruleCleanup:SNTRuleCleanupNone errors:nil]);
+
+  // Age every rule, only the transitive ones should be removed
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    XCTAssertTrue([db executeUpdate:@"UPDATE execution_rules SET timestamp = 1"]);
+    XCTAssertTrue([db longForQuery:@"SELECT COUNT(*) FROM sqlite_master WHERE type='index' AND "
+                                   @"name='execution_rules_state_timestamp'"]);
+  }];
+
+  XCTAssertEqual([self.sut deleteTransitiveRulesBefore:2 limit:2], 2);
+  XCTAssertEqual([self.sut deleteTransitiveRulesBefore:2 limit:2], 2);
+  XCTAssertEqual([self.sut deleteTransitiveRulesBefore:2 limit:2], 1);
+  XCTAssertEqual([self.sut deleteTransitiveRulesBefore:2 limit:2], 0);
+
+  XCTAssertEqual([self.sut executionRuleCount], 1);
+  XCTAssertEqual([self.sut transitiveRuleReapStats:NO].backlog, 0);
+}
+
 // This test ensures that we bump the constant on updates to the rule table
 // schema.
 - (void)testConstantVersionIsUpdated {
@@ -758,6 +1314,11 @@
                  @"initialized database should update to the maximum supported version");
 }
 
+// Returns the hashes as computed from a full scan of the database backing `self.sut`
+- (SNTRuleTableRulesHash*)fullScanHashOfHashes {
+  return [[[SNTRuleTable alloc] initWithDatabaseQueue:self.dbq] hashOfHashes];
+}
+
 - (void)testHashOfHashes {
   NSArray<SNTRule*>* rules = @[
     [self _exampleCertRule],
@@ -774,23 +1335,31 @@
     [self _exampleNetworkFlowAddRuleWithId:2 blob:@"net-rule-2"],
   ];
 
+  SNTRuleTableRulesHash* emptyHash = [self.sut hashOfHashes];
+
   [self.sut addExecutionRules:rules
               fileAccessRules:faaRules
              networkFlowRules:nfRules
                   ruleCleanup:SNTRuleCleanupAll
                        errors:nil];
   SNTRuleTableRulesHash* rulesHash = [self.sut hashOfHashes];
-  XCTAssertEqualObjects(rulesHash.executionRulesHash, @"a6cb5171bbb8895820d61e395592b293");
-  XCTAssertEqualObjects(rulesHash.fileAccessRulesHash, @"010a7393bae8f2e97c296063dd2f39cf");
+  NSString* execHashWithRules = rulesHash.executionRulesHash;
+  NSString* faaHashWithRules = rulesHash.fileAccessRulesHash;
   NSString* nfHashWithRules = rulesHash.networkFlowRulesHash;
+  XCTAssertEqual(execHashWithRules.length, 32u);
+  XCTAssertEqual(faaHashWithRules.length, 32u);
   XCTAssertEqual(nfHashWithRules.length, 32u);
+  XCTAssertNotEqualObjects(execHashWithRules, emptyHash.executionRulesHash);
+  XCTAssertNotEqualObjects(faaHashWithRules, emptyHash.fileAccessRulesHash);
+  XCTAssertEqualObjects(execHashWithRules, [self fullScanHashOfHashes].executionRulesHash);
+  XCTAssertEqualObjects(faaHashWithRules, [self fullScanHashOfHashes].fileAccessRulesHash);
 
   // Add a transitive rule. The hashes should not change.
   SNTRule* transitiveRule = [self _exampleTransitiveRule];
   [self.sut addExecutionRules:@[ transitiveRule ] ruleCleanup:SNTRuleCleanupNone errors:nil];
   rulesHash = [self.sut hashOfHashes];
-  XCTAssertEqualObjects(rulesHash.executionRulesHash, @"a6cb5171bbb8895820d61e395592b293");
-  XCTAssertEqualObjects(rulesHash.fileAccessRulesHash, @"010a7393bae8f2e97c296063dd2f39cf");
+  XCTAssertEqualObjects(rulesHash.executionRulesHash, execHashWithRules);
+  XCTAssertEqualObjects(rulesHash.fileAccessRulesHash, faaHashWithRules);
   XCTAssertEqualObjects(rulesHash.networkFlowRulesHash, nfHashWithRules);
 
   // Add remove rules. The hashes should change.
@@ -805,13 +1374,196 @@
                   ruleCleanup:SNTRuleCleanupNone
                        errors:nil];
   rulesHash = [self.sut hashOfHashes];
-  XCTAssertEqualObjects(rulesHash.executionRulesHash, @"d4dd223bafbdda2c36bb0513dfabb38b");
-  XCTAssertEqualObjects(rulesHash.fileAccessRulesHash, @"146f85d95d0d21d5c04d048b2b69f908");
+  XCTAssertNotEqualObjects(rulesHash.executionRulesHash, execHashWithRules);
+  XCTAssertNotEqualObjects(rulesHash.fileAccessRulesHash, faaHashWithRules);
   XCTAssertNotEqualObjects(rulesHash.networkFlowRulesHash, nfHashWithRules);
+  XCTAssertEqualObjects(rulesHash.executionRulesHash,
+                        [self fullScanHashOfHashes].executionRulesHash);
+  XCTAssertEqualObjects(rulesHash.fileAccessRulesHash,
+                        [self fullScanHashOfHashes].fileAccessRulesHash);
+
+  // Adding the removed rules back restores the original hashes
+  [self.sut addExecutionRules:@[ self._exampleBinaryRule ]
+              fileAccessRules:@[ [self _exampleFileAccessAddRuleWithName:@"AnotherRule"] ]
+             networkFlowRules:nil
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  rulesHash = [self.sut hashOfHashes];
+  XCTAssertEqualObjects(rulesHash.executionRulesHash, execHashWithRules);
+  XCTAssertEqualObjects(rulesHash.fileAccessRulesHash, faaHashWithRules);
+
+  // Removing everything returns to the empty hashes
+  [self.sut addExecutionRules:nil
+              fileAccessRules:nil
+             networkFlowRules:nil
+                  ruleCleanup:SNTRuleCleanupNonTransitive
+                       errors:nil];
+  rulesHash = [self.sut hashOfHashes];
+  XCTAssertEqualObjects(rulesHash.executionRulesHash, emptyHash.executionRulesHash);
+  XCTAssertEqualObjects(rulesHash.fileAccessRulesHash, emptyHash.fileAccessRulesHash);
+}
+
+- (void)testHashOfHashesIsIncremental {
+  // Compute the hashes up front so that every following write updates them in place
+  SNTRuleTableRulesHash* emptyHash = [self.sut hashOfHashes];
+
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  for (int i = 0; i < 50; i++) {
+    SNTRule* r = [self _exampleBinaryRule];
+    r.identifier = [NSString stringWithFormat:@"%064x", i];
+    r.state = (i % 3 == 0) ? SNTRuleStateAllowTransitive : SNTRuleStateBlock;
+    [rules addObject:r];
+  }
+  XCTAssertTrue([self.sut addExecutionRules:rules ruleCleanup:SNTRuleCleanupNone errors:nil]);
+
+  // Replace some rules, including transitive rules with non-transitive ones, and remove others
+  NSMutableArray<SNTRule*>* changes = [NSMutableArray array];
+  for (int i = 0; i < 50; i += 2) {
+    SNTRule* r = [self _exampleBinaryRule];
+    r.identifier = [NSString stringWithFormat:@"%064x", i];
+    r.state = (i % 4 == 0) ? SNTRuleStateRemove : SNTRuleStateAllow;
+    [changes addObject:r];
+  }
+  XCTAssertTrue([self.sut addExecutionRules:changes ruleCleanup:SNTRuleCleanupNone errors:nil]);
+
+  SNTRuleTableRulesHash* rulesHash = [self.sut hashOfHashes];
+  XCTAssertNotEqualObjects(rulesHash.executionRulesHash, emptyHash.executionRulesHash);
+  XCTAssertEqualObjects(rulesHash.executionRulesHash,
+                        [self fullScanHashOfHashes].executionRulesHash);
+
+  // A failed write is rolled back and must leave the hash untouched
+  SNTRule* invalid = [self _exampleBinaryRule];
+  invalid.state = SNTRuleStateUnknown;
+  XCTAssertFalse([self.sut addExecutionRules:@[ [self _exampleCertRule], invalid ]
+                                 ruleCleanup:SNTRuleCleanupAll
+                                      errors:nil]);
+  XCTAssertEqualObjects([self.sut hashOfHashes].executionRulesHash, rulesHash.executionRulesHash);
+
+  // The hash only depends on the final set of rules, not the order they were written in
+  NSArray<SNTRule*>* finalRules = [self.sut retrieveAllExecutionRules];
+  SNTRuleTable* other = [[SNTRuleTable alloc] initWithDatabaseQueue:[[FMDatabaseQueue alloc] init]];
+  XCTAssertTrue([other addExecutionRules:finalRules.reverseObjectEnumerator.allObjects
+                             ruleCleanup:SNTRuleCleanupAll
+                                  errors:nil]);
+  XCTAssertEqualObjects([other hashOfHashes].executionRulesHash, rulesHash.executionRulesHash);
 }
 
 #pragma mark Network Flow Rules
 
+// Sum bucket digests the same way the rule table combines row hashes
+- (NSString*)hexSumOfBucketDigests:(NSData*)digests {
+  unsigned __int128 sum = 0;
+  const uint8_t* buf = static_cast<const uint8_t*>(digests.bytes);
+  for (NSUInteger i = 0; i < digests.length; i += sizeof(sum)) {
+    unsigned __int128 bucket = 0;
+    for (size_t j = 0; j < sizeof(sum); j++) {
+      bucket = (bucket << 8) | buf[i + j];
+    }
+    sum += bucket;
+  }
+  return [NSString stringWithFormat:@"%016llx%016llx", (unsigned long long)(sum >> 64),
+                                    (unsigned long long)sum];
+}
+
+- (NSIndexSet*)bucketsDifferingBetween:(NSData*)a and:(NSData*)b {
+  NSMutableIndexSet* buckets = [NSMutableIndexSet indexSet];
+  for (NSUInteger i = 0; i < a.length / 16; i++) {
+    NSRange range = NSMakeRange(i * 16, 16);
+    if (![[a subdataWithRange:range] isEqualToData:[b subdataWithRange:range]]) {
+      [buckets addIndex:i];
+    }
+  }
+  return buckets;
+}
+
+- (void)testBucketDigestsSumToHash {
+  NSData* emptyDigests = [self.sut executionRulesBucketDigests];
+  XCTAssertEqual(emptyDigests.length, 256 * 16u);
+  XCTAssertEqual([self.sut fileAccessRulesBucketDigests].length, 256 * 16u);
+
+  [self.sut addExecutionRules:@[ [self _exampleCertRule], [self _exampleTeamIDRule] ]
+              fileAccessRules:@[ [self _exampleFileAccessAddRuleWithName:@"MyFirstRule"] ]
+             networkFlowRules:nil
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+
+  SNTRuleTableRulesHash* rulesHash = [self.sut hashOfHashes];
+  NSData* digests = [self.sut executionRulesBucketDigests];
+  XCTAssertEqualObjects([self hexSumOfBucketDigests:digests], rulesHash.executionRulesHash);
+  XCTAssertEqualObjects([self hexSumOfBucketDigests:[self.sut fileAccessRulesBucketDigests]],
+                        rulesHash.fileAccessRulesHash);
+
+  // Adding one rule only changes one bucket
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  NSData* newDigests = [self.sut executionRulesBucketDigests];
+  XCTAssertEqual([self bucketsDifferingBetween:digests and:newDigests].count, 1u);
+
+  // Incrementally maintained buckets match those from a full scan
+  SNTRuleTable* fullScan = [[SNTRuleTable alloc] initWithDatabaseQueue:self.dbq];
+  XCTAssertEqualObjects([fullScan executionRulesBucketDigests], newDigests);
+
+  [self.sut addExecutionRules:nil ruleCleanup:SNTRuleCleanupNonTransitive errors:nil];
+  XCTAssertEqualObjects([self.sut executionRulesBucketDigests], emptyDigests);
+}
+
+- (void)testReplaceExecutionRulesInBuckets {
+  NSMutableArray<SNTRule*>* serverRules = [NSMutableArray array];
+  for (int i = 0; i < 100; i++) {
+    SNTRule* r = [self _exampleBinaryRule];
+    r.identifier = [NSString stringWithFormat:@"%064x", i];
+    [serverRules addObject:r];
+  }
+  SNTRuleTable* server =
+      [[SNTRuleTable alloc] initWithDatabaseQueue:[[FMDatabaseQueue alloc] init]];
+  XCTAssertTrue([server addExecutionRules:serverRules ruleCleanup:SNTRuleCleanupAll errors:nil]);
+
+  // The client is missing a rule, has a rule with the wrong state, has an extra rule and has a
+  // local transitive rule that must survive the repair.
+  NSMutableArray<SNTRule*>* clientRules =
+      [[serverRules subarrayWithRange:NSMakeRange(1, 99)] mutableCopy];
+  SNTRule* drifted = [self _exampleBinaryRule];
+  drifted.identifier = serverRules[50].identifier;
+  drifted.state = SNTRuleStateAllow;
+  clientRules[49] = drifted;
+  SNTRule* extra = [self _exampleBinaryRule];
+  extra.identifier = [NSString stringWithFormat:@"%064x", 1000];
+  [clientRules addObject:extra];
+  [clientRules addObject:[self _exampleTransitiveRule]];
+  XCTAssertTrue([self.sut addExecutionRules:clientRules ruleCleanup:SNTRuleCleanupAll errors:nil]);
+
+  NSIndexSet* buckets = [self bucketsDifferingBetween:[server executionRulesBucketDigests]
+                                                  and:[self.sut executionRulesBucketDigests]];
+  XCTAssertGreaterThan(buckets.count, 0u);
+  XCTAssertLessThanOrEqual(buckets.count, 3u);
+
+  // Find the server rules in each differing bucket by checking which bucket each rule lands in
+  // on its own.
+  NSMutableArray<SNTRule*>* repairRules = [NSMutableArray array];
+  SNTRuleTable* scratch =
+      [[SNTRuleTable alloc] initWithDatabaseQueue:[[FMDatabaseQueue alloc] init]];
+  NSData* emptyDigests = [scratch executionRulesBucketDigests];
+  for (SNTRule* rule in serverRules) {
+    [scratch addExecutionRules:@[ rule ] ruleCleanup:SNTRuleCleanupAll errors:nil];
+    NSIndexSet* bucket = [self bucketsDifferingBetween:emptyDigests
+                                                   and:[scratch executionRulesBucketDigests]];
+    if ([buckets containsIndexes:bucket]) {
+      [repairRules addObject:rule];
+    }
+  }
+  XCTAssertLessThan(repairRules.count, serverRules.count);
+
+  XCTAssertTrue([self.sut replaceExecutionRulesInBuckets:buckets
+                                               withRules:repairRules
+                                                  errors:nil]);
+  XCTAssertEqualObjects([self.sut hashOfHashes].executionRulesHash,
+                        [server hashOfHashes].executionRulesHash);
+  XCTAssertEqualObjects([self.sut hashOfHashes].executionRulesHash,
+                        [self fullScanHashOfHashes].executionRulesHash);
+  XCTAssertEqual([self.sut transitiveRuleCount], 1);
+}
+
 - (void)testNetworkFlowRulesTableCreated {
   __block BOOL tableExists = NO;
   [self.sut inDatabase:^(FMDatabase* db) {
@@ -0,0 +1,38 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+#import "Source/common/SNTStoredEvent.h"
+
+/// Compact encoding for events held in the events database.
+///
+/// Encoded events are a short versioned header followed by a StoredEvent protobuf, which is far
+/// cheaper to decode than the keyed archives previously stored in the database. Execution, file
+/// access and temporary Monitor Mode audit events are supported.
+@interface SNTStoredEventCodec : NSObject
+
+/// Returns the encoded event, or nil if the event can't be represented in the compact encoding.
++ (NSData*)encodeEvent:(SNTStoredEvent*)event;
+
+/// Returns the decoded event, or nil if the data is not a valid compact encoding.
++ (SNTStoredEvent*)decodeEventData:(NSData*)data;
+
+/// Returns YES if the data starts with the compact encoding header.
++ (BOOL)isCompactEncoding:(NSData*)data;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
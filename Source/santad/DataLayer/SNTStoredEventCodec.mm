@@ -0,0 +1,384 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santad/DataLayer/SNTStoredEventCodec.h"
+
+#include <string>
+
+#import "Source/common/MOLCertificate.h"
+#import "Source/common/SNTStoredExecutionEvent.h"
+#import "Source/common/SNTStoredFileAccessEvent.h"
+#import "Source/common/SNTStoredTemporaryMonitorModeAuditEvent.h"
+#include "Source/common/String.h"
+#include "Source/santad/DataLayer/stored_event.pb.h"
+
+namespace pbse = ::santa::pb::v1::stored_event;
+
+using santa::NSStringToUTF8String;
+using santa::StringToNSString;
+
+namespace {
+
+constexpr uint8_t kHeader[] = {'S', 'N', 'T', 'E'};
+constexpr uint8_t kVersion = 1;
+constexpr size_t kHeaderSize = sizeof(kHeader) + sizeof(kVersion);
+
+NSString* StringOrNil(bool has, const std::string& value) {
+  return has ? StringToNSString(value) : nil;
+}
+
+NSDate* DateOrNil(bool has, double value) {
+  return has ? [NSDate dateWithTimeIntervalSinceReferenceDate:value] : nil;
+}
+
+void EncodeSigningChain(NSArray<MOLCertificate*>* chain,
+                        google::protobuf::RepeatedPtrField<std::string>* pb) {
+  for (MOLCertificate* cert in chain) {
+    NSData* der = cert.certData;
+    if (der.length) {
+      pb->Add(std::string((const char*)der.bytes, der.length));
+    }
+  }
+}
+
+NSArray<MOLCertificate*>* DecodeSigningChain(
+    const google::protobuf::RepeatedPtrField<std::string>& pb) {
+  if (pb.empty()) return nil;
+
+  NSMutableArray<MOLCertificate*>* chain = [NSMutableArray arrayWithCapacity:pb.size()];
+  for (const std::string& der : pb) {
+    MOLCertificate* cert = [[MOLCertificate alloc]
+        initWithCertificateDataDER:[NSData dataWithBytes:der.data() length:der.size()]];
+    if (cert) [chain addObject:cert];
+  }
+  return chain;
+}
+
+void EncodeStringArray(NSArray* values, bool* has,
+                       google::protobuf::RepeatedPtrField<std::string>* pb) {
+  *has = values != nil;
+  for (id value in values) {
+    if ([value isKindOfClass:[NSString class]]) {
+      pb->Add(NSStringToUTF8String(value));
+    }
+  }
+}
+
+NSArray<NSString*>* DecodeStringArray(bool has,
+                                      const google::protobuf::RepeatedPtrField<std::string>& pb) {
+  if (!has) return nil;
+
+  NSMutableArray<NSString*>* values = [NSMutableArray arrayWithCapacity:pb.size()];
+  for (const std::string& value : pb) {
+    [values addObject:StringToNSString(value)];
+  }
+  return values;
+}
+
+bool EncodeExecutionEvent(SNTStoredExecutionEvent* e, pbse::ExecutionEvent* pb) {
+  if (e.fileSHA256) pb->set_file_sha256(NSStringToUTF8String(e.fileSHA256));
+  if (e.filePath) pb->set_file_path(NSStringToUTF8String(e.filePath));
+
+  pb->set_needs_bundle_hash(e.needsBundleHash);
+  if (e.fileBundleHash) pb->set_file_bundle_hash(NSStringToUTF8String(e.fileBundleHash));
+  if (e.fileBundleHashMilliseconds) {
+    pb->set_file_bundle_hash_milliseconds(e.fileBundleHashMilliseconds.doubleValue);
+  }
+  if (e.fileBundleBinaryCount) {
+    pb->set_file_bundle_binary_count(e.fileBundleBinaryCount.unsignedLongLongValue);
+  }
+  if (e.fileBundleName) pb->set_file_bundle_name(NSStringToUTF8String(e.fileBundleName));
+  if (e.fileBundlePath) pb->set_file_bundle_path(NSStringToUTF8String(e.fileBundlePath));
+  if (e.fileBundleExecutableRelPath) {
+    pb->set_file_bundle_executable_rel_path(NSStringToUTF8String(e.fileBundleExecutableRelPath));
+  }
+  if (e.fileBundleID) pb->set_file_bundle_id(NSStringToUTF8String(e.fileBundleID));
+  if (e.fileBundleVersion) pb->set_file_bundle_version(NSStringToUTF8String(e.fileBundleVersion));
+  if (e.fileBundleVersionString) {
+    pb->set_file_bundle_version_string(NSStringToUTF8String(e.fileBundleVersionString));
+  }
+
+  EncodeSigningChain(e.signingChain, pb->mutable_signing_chain());
+  if (e.teamID) pb->set_team_id(NSStringToUTF8String(e.teamID));
+  if (e.signingID) pb->set_signing_id(NSStringToUTF8String(e.signingID));
+  if (e.cdhash) pb->set_cdhash(NSStringToUTF8String(e.cdhash));
+  pb->set_codesigning_flags(e.codesigningFlags);
+  pb->set_signing_status(e.signingStatus);
+  if (e.entitlements) {
+    // Entitlements are arbitrary property lists, anything that can't be serialized as one must
+    // fall back to the keyed archive.
+    NSData* entitlements =
+        [NSPropertyListSerialization dataWithPropertyList:e.entitlements
+                                                   format:NSPropertyListBinaryFormat_v1_0
+                                                  options:0
+                                                    error:nil];
+    if (!entitlements) return false;
+    pb->set_entitlements(entitlements.bytes, entitlements.length);
+  }
+  pb->set_entitlements_filtered(e.entitlementsFiltered);
+  if (e.secureSigningTime) {
+    pb->set_secure_signing_time(e.secureSigningTime.timeIntervalSinceReferenceDate);
+  }
+  if (e.signingTime) pb->set_signing_time(e.signingTime.timeIntervalSinceReferenceDate);
+
+  if (e.executingUser) pb->set_executing_user(NSStringToUTF8String(e.executingUser));
+  pb->set_decision(e.decision);
+  pb->set_audit_return(e.auditReturn);
+  pb->set_hold_and_ask(e.holdAndAsk);
+  pb->set_silent_touch_id(e.silentTouchID);
+  pb->set_seatbelt_required(e.seatbeltRequired);
+  pb->set_static_rule(e.staticRule);
+  pb->set_rule_id(e.ruleId);
+  if (e.pid) pb->set_pid(e.pid.intValue);
+  if (e.ppid) pb->set_ppid(e.ppid.intValue);
+  if (e.parentName) pb->set_parent_name(NSStringToUTF8String(e.parentName));
+
+  bool has;
+  EncodeStringArray(e.loggedInUsers, &has, pb->mutable_logged_in_users());
+  pb->set_has_logged_in_users(has);
+  EncodeStringArray(e.currentSessions, &has, pb->mutable_current_sessions());
+  pb->set_has_current_sessions(has);
+
+  if (e.quarantineDataURL) pb->set_quarantine_data_url(NSStringToUTF8String(e.quarantineDataURL));
+  if (e.quarantineRefererURL) {
+    pb->set_quarantine_referer_url(NSStringToUTF8String(e.quarantineRefererURL));
+  }
+  if (e.quarantineTimestamp) {
+    pb->set_quarantine_timestamp(e.quarantineTimestamp.timeIntervalSinceReferenceDate);
+  }
+  if (e.quarantineAgentBundleID) {
+    pb->set_quarantine_agent_bundle_id(NSStringToUTF8String(e.quarantineAgentBundleID));
+  }
+
+  return true;
+}
+
+SNTStoredExecutionEvent* DecodeExecutionEvent(const pbse::ExecutionEvent& pb) {
+  SNTStoredExecutionEvent* e = [[SNTStoredExecutionEvent alloc] init];
+  e.fileSHA256 = StringOrNil(pb.has_file_sha256(), pb.file_sha256());
+  e.filePath = StringOrNil(pb.has_file_path(), pb.file_path());
+
+  e.needsBundleHash = pb.needs_bundle_hash();
+  e.fileBundleHash = StringOrNil(pb.has_file_bundle_hash(), pb.file_bundle_hash());
+  if (pb.has_file_bundle_hash_milliseconds()) {
+    e.fileBundleHashMilliseconds = @(pb.file_bundle_hash_milliseconds());
+  }
+  if (pb.has_file_bundle_binary_count()) {
+    e.fileBundleBinaryCount = @(pb.file_bundle_binary_count());
+  }
+  e.fileBundleName = StringOrNil(pb.has_file_bundle_name(), pb.file_bundle_name());
+  e.fileBundlePath = StringOrNil(pb.has_file_bundle_path(), pb.file_bundle_path());
+  e.fileBundleExecutableRelPath =
+      StringOrNil(pb.has_file_bundle_executable_rel_path(), pb.file_bundle_executable_rel_path());
+  e.fileBundleID = StringOrNil(pb.has_file_bundle_id(), pb.file_bundle_id());
+  e.fileBundleVersion = StringOrNil(pb.has_file_bundle_version(), pb.file_bundle_version());
+  e.fileBundleVersionString =
+      StringOrNil(pb.has_file_bundle_version_string(), pb.file_bundle_version_string());
+
+  e.signingChain = DecodeSigningChain(pb.signing_chain());
+  e.teamID = StringOrNil(pb.has_team_id(), pb.team_id());
+  e.signingID = StringOrNil(pb.has_signing_id(), pb.signing_id());
+  e.cdhash = StringOrNil(pb.has_cdhash(), pb.cdhash());
+  e.codesigningFlags = pb.codesigning_flags();
+  e.signingStatus = static_cast<SNTSigningStatus>(pb.signing_status());
+  if (pb.has_entitlements()) {
+    NSData* data = [NSData dataWithBytesNoCopy:(void*)pb.entitlements().data()
+                                        length:pb.entitlements().size()
+                                  freeWhenDone:NO];
+    id entitlements = [NSPropertyListSerialization propertyListWithData:data
+                                                                options:NSPropertyListImmutable
+                                                                 format:nil
+                                                                  error:nil];
+    if (![entitlements isKindOfClass:[NSDictionary class]]) return nil;
+    e.entitlements = entitlements;
+  }
+  e.entitlementsFiltered = pb.entitlements_filtered();
+  e.secureSigningTime = DateOrNil(pb.has_secure_signing_time(), pb.secure_signing_time());
+  e.signingTime = DateOrNil(pb.has_signing_time(), pb.signing_time());
+
+  e.executingUser = StringOrNil(pb.has_executing_user(), pb.executing_user());
+  e.decision = static_cast<SNTEventState>(pb.decision());
+  e.auditReturn = pb.audit_return();
+  e.holdAndAsk = pb.hold_and_ask();
+  e.silentTouchID = pb.silent_touch_id();
+  e.seatbeltRequired = pb.seatbelt_required();
+  e.staticRule = pb.static_rule();
+  e.ruleId = pb.rule_id();
+  if (pb.has_pid()) e.pid = @(pb.pid());
+  if (pb.has_ppid()) e.ppid = @(pb.ppid());
+  e.parentName = StringOrNil(pb.has_parent_name(), pb.parent_name());
+
+  e.loggedInUsers = DecodeStringArray(pb.has_logged_in_users(), pb.logged_in_users());
+  e.currentSessions = DecodeStringArray(pb.has_current_sessions(), pb.current_sessions());
+
+  e.quarantineDataURL = StringOrNil(pb.has_quarantine_data_url(), pb.quarantine_data_url());
+  e.quarantineRefererURL =
+      StringOrNil(pb.has_quarantine_referer_url(), pb.quarantine_referer_url());
+  e.quarantineTimestamp = DateOrNil(pb.has_quarantine_timestamp(), pb.quarantine_timestamp());
+  e.quarantineAgentBundleID =
+      StringOrNil(pb.has_quarantine_agent_bundle_id(), pb.quarantine_agent_bundle_id());
+
+  return e;
+}
+
+void EncodeFileAccessProcess(SNTStoredFileAccessProcess* p, pbse::FileAccessProcess* pb) {
+  if (p.filePath) pb->set_file_path(NSStringToUTF8String(p.filePath));
+  if (p.cdhash) pb->set_cdhash(NSStringToUTF8String(p.cdhash));
+  if (p.fileSHA256) pb->set_file_sha256(NSStringToUTF8String(p.fileSHA256));
+  if (p.signingID) pb->set_signing_id(NSStringToUTF8String(p.signingID));
+  EncodeSigningChain(p.signingChain, pb->mutable_signing_chain());
+  if (p.teamID) pb->set_team_id(NSStringToUTF8String(p.teamID));
+  if (p.pid) pb->set_pid(p.pid.intValue);
+  if (p.executingUser) pb->set_executing_user(NSStringToUTF8String(p.executingUser));
+  if (p.parent) EncodeFileAccessProcess(p.parent, pb->mutable_parent());
+}
+
+SNTStoredFileAccessProcess* DecodeFileAccessProcess(const pbse::FileAccessProcess& pb) {
+  SNTStoredFileAccessProcess* p = [[SNTStoredFileAccessProcess alloc] init];
+  p.filePath = StringOrNil(pb.has_file_path(), pb.file_path());
+  p.cdhash = StringOrNil(pb.has_cdhash(), pb.cdhash());
+  p.fileSHA256 = StringOrNil(pb.has_file_sha256(), pb.file_sha256());
+  p.signingID = StringOrNil(pb.has_signing_id(), pb.signing_id());
+  p.signingChain = DecodeSigningChain(pb.signing_chain());
+  p.teamID = StringOrNil(pb.has_team_id(), pb.team_id());
+  if (pb.has_pid()) p.pid = @(pb.pid());
+  p.executingUser = StringOrNil(pb.has_executing_user(), pb.executing_user());
+  if (pb.has_parent()) p.parent = DecodeFileAccessProcess(pb.parent());
+  return p;
+}
+
+void EncodeFileAccessEvent(SNTStoredFileAccessEvent* e, pbse::FileAccessEvent* pb) {
+  if (e.ruleVersion) pb->set_rule_version(NSStringToUTF8String(e.ruleVersion));
+  if (e.ruleName) pb->set_rule_name(NSStringToUTF8String(e.ruleName));
+  if (e.accessedPath) pb->set_accessed_path(NSStringToUTF8String(e.accessedPath));
+  if (e.process) EncodeFileAccessProcess(e.process, pb->mutable_process());
+  pb->set_decision(static_cast<int32_t>(e.decision));
+  pb->set_rule_id(e.ruleId);
+}
+
+SNTStoredFileAccessEvent* DecodeFileAccessEvent(const pbse::FileAccessEvent& pb) {
+  SNTStoredFileAccessEvent* e = [[SNTStoredFileAccessEvent alloc] init];
+  e.ruleVersion = StringOrNil(pb.has_rule_version(), pb.rule_version());
+  e.ruleName = StringOrNil(pb.has_rule_name(), pb.rule_name());
+  e.accessedPath = StringOrNil(pb.has_accessed_path(), pb.accessed_path());
+  e.process = pb.has_process() ? DecodeFileAccessProcess(pb.process()) : nil;
+  e.decision = static_cast<FileAccessPolicyDecision>(pb.decision());
+  e.ruleId = pb.rule_id();
+  return e;
+}
+
+bool EncodeTemporaryMonitorModeAuditEvent(SNTStoredTemporaryMonitorModeAuditEvent* e,
+                                          pbse::TemporaryMonitorModeAuditEvent* pb) {
+  if (e.uuid) pb->set_uuid(NSStringToUTF8String(e.uuid));
+  if ([e isKindOfClass:[SNTStoredTemporaryMonitorModeEnterAuditEvent class]]) {
+    SNTStoredTemporaryMonitorModeEnterAuditEvent* enter =
+        (SNTStoredTemporaryMonitorModeEnterAuditEvent*)e;
+    pb->mutable_enter()->set_seconds(enter.seconds);
+    pb->mutable_enter()->set_reason(enter.reason);
+  } else if ([e isKindOfClass:[SNTStoredTemporaryMonitorModeLeaveAuditEvent class]]) {
+    pb->mutable_leave()->set_reason(((SNTStoredTemporaryMonitorModeLeaveAuditEvent*)e).reason);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// The unique ID of these events is random and only used to keep them from being deduplicated
+// when they are stored, so decoded events are given a new one.
+SNTStoredTemporaryMonitorModeAuditEvent* DecodeTemporaryMonitorModeAuditEvent(
+    const pbse::TemporaryMonitorModeAuditEvent& pb) {
+  NSString* uuid = StringOrNil(pb.has_uuid(), pb.uuid());
+  switch (pb.event_case()) {
+    case pbse::TemporaryMonitorModeAuditEvent::kEnter:
+      return [[SNTStoredTemporaryMonitorModeEnterAuditEvent alloc]
+          initWithUUID:uuid
+               seconds:pb.enter().seconds()
+                reason:static_cast<SNTTemporaryMonitorModeEnterReason>(pb.enter().reason())];
+    case pbse::TemporaryMonitorModeAuditEvent::kLeave:
+      return [[SNTStoredTemporaryMonitorModeLeaveAuditEvent alloc]
+          initWithUUID:uuid
+                reason:static_cast<SNTTemporaryMonitorModeLeaveReason>(pb.leave().reason())];
+    default: return nil;
+  }
+}
+
+}  // namespace
+
+@implementation SNTStoredEventCodec
+
++ (NSData*)encodeEvent:(SNTStoredEvent*)event {
+  if (!event.idx || !event.occurrenceDate) return nil;
+
+  pbse::StoredEvent pb;
+  pb.set_idx(event.idx.longLongValue);
+  pb.set_occurrence_date(event.occurrenceDate.timeIntervalSinceReferenceDate);
+
+  if ([event isKindOfClass:[SNTStoredExecutionEvent class]]) {
+    if (!EncodeExecutionEvent((SNTStoredExecutionEvent*)event, pb.mutable_execution())) {
+      return nil;
+    }
+  } else if ([event isKindOfClass:[SNTStoredFileAccessEvent class]]) {
+    EncodeFileAccessEvent((SNTStoredFileAccessEvent*)event, pb.mutable_file_access());
+  } else if ([event isKindOfClass:[SNTStoredTemporaryMonitorModeAuditEvent class]]) {
+    if (!EncodeTemporaryMonitorModeAuditEvent((SNTStoredTemporaryMonitorModeAuditEvent*)event,
+                                              pb.mutable_temporary_monitor_mode())) {
+      return nil;
+    }
+  } else {
+    return nil;
+  }
+
+  size_t size = pb.ByteSizeLong();
+  NSMutableData* data = [NSMutableData dataWithLength:kHeaderSize + size];
+  uint8_t* bytes = (uint8_t*)data.mutableBytes;
+  memcpy(bytes, kHeader, sizeof(kHeader));
+  bytes[sizeof(kHeader)] = kVersion;
+  if (!pb.SerializeToArray(bytes + kHeaderSize, (int)size)) {
+    return nil;
+  }
+  return data;
+}
+
++ (SNTStoredEvent*)decodeEventData:(NSData*)data {
+  if (![self isCompactEncoding:data] || ((const uint8_t*)data.bytes)[sizeof(kHeader)] != kVersion) {
+    return nil;
+  }
+
+  pbse::StoredEvent pb;
+  if (!pb.ParseFromArray((const uint8_t*)data.bytes + kHeaderSize,
+                         (int)(data.length - kHeaderSize))) {
+    return nil;
+  }
+
+  SNTStoredEvent* event;
+  switch (pb.event_case()) {
+    case pbse::StoredEvent::kExecution: event = DecodeExecutionEvent(pb.execution()); break;
+    case pbse::StoredEvent::kFileAccess: event = DecodeFileAccessEvent(pb.file_access()); break;
+    case pbse::StoredEvent::kTemporaryMonitorMode:
+      event = DecodeTemporaryMonitorModeAuditEvent(pb.temporary_monitor_mode());
+      break;
+    default: return nil;
+  }
+
+  event.idx = @(pb.idx());
+  event.occurrenceDate = [NSDate dateWithTimeIntervalSinceReferenceDate:pb.occurrence_date()];
+  return event;
+}
+
++ (BOOL)isCompactEncoding:(NSData*)data {
+  return data.length >= kHeaderSize && memcmp(data.bytes, kHeader, sizeof(kHeader)) == 0;
+}
+
+@end
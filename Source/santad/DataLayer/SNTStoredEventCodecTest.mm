@@ -0,0 +1,218 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santad/DataLayer/SNTStoredEventCodec.h"
+
+#import <XCTest/XCTest.h>
+
+#import "Source/common/MOLCertificate.h"
+#import "Source/common/MOLCodesignChecker.h"
+#import "Source/common/SNTStoredExecutionEvent.h"
+#import "Source/common/SNTStoredFileAccessEvent.h"
+#import "Source/common/SNTStoredTemporaryMonitorModeAuditEvent.h"
+
+@interface SNTStoredEventCodecTest : XCTestCase
+@end
+
+@implementation SNTStoredEventCodecTest
+
+- (SNTStoredEvent*)roundTrip:(SNTStoredEvent*)event {
+  NSData* data = [SNTStoredEventCodec encodeEvent:event];
+  XCTAssertNotNil(data);
+  XCTAssertTrue([SNTStoredEventCodec isCompactEncoding:data]);
+
+  SNTStoredEvent* decoded = [SNTStoredEventCodec decodeEventData:data];
+  XCTAssertNotNil(decoded);
+  XCTAssertEqualObjects(decoded.idx, event.idx);
+  XCTAssertEqualObjects(decoded.occurrenceDate, event.occurrenceDate);
+  return decoded;
+}
+
+- (void)testExecutionEventRoundTrip {
+  MOLCodesignChecker* csc = [[MOLCodesignChecker alloc] initWithBinaryPath:@"/usr/bin/false"];
+
+  SNTStoredExecutionEvent* event = [[SNTStoredExecutionEvent alloc] init];
+  event.fileSHA256 = @"c2f6f1e32a3b49ed3b1e9c5e9a8c3b9e0e1f1a7c8d9e0f1a2b3c4d5e6f708192";
+  event.filePath = @"/usr/bin/false";
+  event.needsBundleHash = YES;
+  event.fileBundleHash = @"bundlehash";
+  event.fileBundleHashMilliseconds = @(12.5);
+  event.fileBundleBinaryCount = @(3);
+  event.fileBundleName = @"False";
+  event.fileBundleID = @"com.example.false";
+  event.signingChain = csc.certificates;
+  event.teamID = @"ABCDEF1234";
+  event.signingID = @"ABCDEF1234:com.example.false";
+  event.cdhash = @"0123456789abcdef0123456789abcdef01234567";
+  event.codesigningFlags = 0x2000;
+  event.signingStatus = SNTSigningStatusProduction;
+  event.entitlements = @{@"com.apple.security.get-task-allow" : @YES, @"groups" : @[ @"a" ]};
+  event.entitlementsFiltered = YES;
+  event.signingTime = [NSDate dateWithTimeIntervalSinceReferenceDate:12345.678];
+  event.executingUser = @"nobody";
+  event.decision = SNTEventStateBlockBinary;
+  event.holdAndAsk = YES;
+  event.ruleId = 42;
+  event.pid = @(123);
+  event.ppid = @(1);
+  event.parentName = @"launchd";
+  event.loggedInUsers = @[ @"nobody" ];
+  event.currentSessions = @[];
+  event.quarantineDataURL = @"https://example.com/false";
+  event.quarantineTimestamp = [NSDate date];
+
+  SNTStoredExecutionEvent* decoded = (SNTStoredExecutionEvent*)[self roundTrip:event];
+  XCTAssertTrue([decoded isKindOfClass:[SNTStoredExecutionEvent class]]);
+  XCTAssertEqualObjects(decoded.fileSHA256, event.fileSHA256);
+  XCTAssertEqualObjects(decoded.filePath, event.filePath);
+  XCTAssertEqual(decoded.needsBundleHash, YES);
+  XCTAssertEqualObjects(decoded.fileBundleHash, event.fileBundleHash);
+  XCTAssertEqualObjects(decoded.fileBundleHashMilliseconds, event.fileBundleHashMilliseconds);
+  XCTAssertEqualObjects(decoded.fileBundleBinaryCount, event.fileBundleBinaryCount);
+  XCTAssertEqualObjects(decoded.fileBundleName, event.fileBundleName);
+  XCTAssertEqualObjects(decoded.fileBundleID, event.fileBundleID);
+  XCTAssertNil(decoded.fileBundlePath);
+  XCTAssertEqualObjects(decoded.signingChain, event.signingChain);
+  XCTAssertEqualObjects(decoded.teamID, event.teamID);
+  XCTAssertEqualObjects(decoded.signingID, event.signingID);
+  XCTAssertEqualObjects(decoded.cdhash, event.cdhash);
+  XCTAssertEqual(decoded.codesigningFlags, event.codesigningFlags);
+  XCTAssertEqual(decoded.signingStatus, event.signingStatus);
+  XCTAssertEqualObjects(decoded.entitlements, event.entitlements);
+  XCTAssertEqual(decoded.entitlementsFiltered, YES);
+  XCTAssertEqualObjects(decoded.signingTime, event.signingTime);
+  XCTAssertNil(decoded.secureSigningTime);
+  XCTAssertEqualObjects(decoded.executingUser, event.executingUser);
+  XCTAssertEqual(decoded.decision, event.decision);
+  XCTAssertEqual(decoded.holdAndAsk, YES);
+  XCTAssertEqual(decoded.silentTouchID, NO);
+  XCTAssertEqual(decoded.ruleId, 42);
+  XCTAssertEqualObjects(decoded.pid, event.pid);
+  XCTAssertEqualObjects(decoded.ppid, event.ppid);
+  XCTAssertEqualObjects(decoded.parentName, event.parentName);
+  XCTAssertEqualObjects(decoded.loggedInUsers, event.loggedInUsers);
+  XCTAssertEqualObjects(decoded.quarantineDataURL, event.quarantineDataURL);
+  XCTAssertEqualObjects(decoded.quarantineTimestamp, event.quarantineTimestamp);
+  XCTAssertNil(decoded.quarantineRefererURL);
+  XCTAssertEqualObjects(decoded.uniqueID, event.uniqueID);
+
+  // Empty lists must not come back as nil
+  XCTAssertNotNil(decoded.currentSessions);
+  XCTAssertEqual(decoded.currentSessions.count, 0);
+}
+
+- (void)testExecutionEventUnsetFieldsStayNil {
+  SNTStoredExecutionEvent* event = [[SNTStoredExecutionEvent alloc] init];
+  event.filePath = @"/usr/bin/false";
+  event.decision = SNTEventStateAllowBinary;
+
+  SNTStoredExecutionEvent* decoded = (SNTStoredExecutionEvent*)[self roundTrip:event];
+  XCTAssertNil(decoded.fileSHA256);
+  XCTAssertNil(decoded.fileBundleHashMilliseconds);
+  XCTAssertNil(decoded.signingChain);
+  XCTAssertNil(decoded.entitlements);
+  XCTAssertNil(decoded.pid);
+  XCTAssertNil(decoded.loggedInUsers);
+  XCTAssertNil(decoded.currentSessions);
+}
+
+- (void)testUnrepresentableEntitlements {
+  SNTStoredExecutionEvent* event = [[SNTStoredExecutionEvent alloc] init];
+  event.filePath = @"/usr/bin/false";
+  event.entitlements = @{@"key" : [NSNull null]};
+
+  // Callers fall back to keyed archives for these events
+  XCTAssertNil([SNTStoredEventCodec encodeEvent:event]);
+}
+
+- (void)testFileAccessEventRoundTrip {
+  SNTStoredFileAccessEvent* event = [[SNTStoredFileAccessEvent alloc] init];
+  event.ruleName = @"MyTestRule";
+  event.ruleVersion = @"MyTestVersion";
+  event.accessedPath = @"/this/path/was/accessed";
+  event.decision = FileAccessPolicyDecision::kDenied;
+  event.ruleId = 7;
+  event.process.filePath = @"/usr/bin/false";
+  event.process.fileSHA256 = @"abc";
+  event.process.pid = @(1234);
+  event.process.parent = [[SNTStoredFileAccessProcess alloc] init];
+  event.process.parent.pid = @(4567);
+  event.process.parent.parent = [[SNTStoredFileAccessProcess alloc] init];
+  event.process.parent.parent.filePath = @"/sbin/launchd";
+
+  SNTStoredFileAccessEvent* decoded = (SNTStoredFileAccessEvent*)[self roundTrip:event];
+  XCTAssertTrue([decoded isKindOfClass:[SNTStoredFileAccessEvent class]]);
+  XCTAssertEqualObjects(decoded.ruleName, event.ruleName);
+  XCTAssertEqualObjects(decoded.ruleVersion, event.ruleVersion);
+  XCTAssertEqualObjects(decoded.accessedPath, event.accessedPath);
+  XCTAssertEqual(decoded.decision, FileAccessPolicyDecision::kDenied);
+  XCTAssertEqual(decoded.ruleId, 7);
+  XCTAssertEqualObjects(decoded.process.filePath, event.process.filePath);
+  XCTAssertEqualObjects(decoded.process.fileSHA256, event.process.fileSHA256);
+  XCTAssertEqualObjects(decoded.process.pid, event.process.pid);
+  XCTAssertNil(decoded.process.signingChain);
+  XCTAssertEqualObjects(decoded.process.parent.pid, event.process.parent.pid);
+  XCTAssertNil(decoded.process.parent.filePath);
+  XCTAssertEqualObjects(decoded.process.parent.parent.filePath, @"/sbin/launchd");
+  XCTAssertNil(decoded.process.parent.parent.parent);
+  XCTAssertEqualObjects(decoded.uniqueID, event.uniqueID);
+}
+
+- (void)testTemporaryMonitorModeEventsRoundTrip {
+  SNTStoredTemporaryMonitorModeEnterAuditEvent* enter =
+      [[SNTStoredTemporaryMonitorModeEnterAuditEvent alloc]
+          initWithUUID:@"enter_uuid"
+               seconds:123
+                reason:SNTTemporaryMonitorModeEnterReasonRestart];
+  SNTStoredTemporaryMonitorModeEnterAuditEvent* decodedEnter =
+      (SNTStoredTemporaryMonitorModeEnterAuditEvent*)[self roundTrip:enter];
+  XCTAssertTrue([decodedEnter isKindOfClass:[SNTStoredTemporaryMonitorModeEnterAuditEvent class]]);
+  XCTAssertEqualObjects(decodedEnter.uuid, @"enter_uuid");
+  XCTAssertEqual(decodedEnter.seconds, 123);
+  XCTAssertEqual(decodedEnter.reason, SNTTemporaryMonitorModeEnterReasonRestart);
+
+  SNTStoredTemporaryMonitorModeLeaveAuditEvent* leave =
+      [[SNTStoredTemporaryMonitorModeLeaveAuditEvent alloc]
+          initWithUUID:@"leave_uuid"
+                reason:SNTTemporaryMonitorModeLeaveReasonRevoked];
+  SNTStoredTemporaryMonitorModeLeaveAuditEvent* decodedLeave =
+      (SNTStoredTemporaryMonitorModeLeaveAuditEvent*)[self roundTrip:leave];
+  XCTAssertTrue([decodedLeave isKindOfClass:[SNTStoredTemporaryMonitorModeLeaveAuditEvent class]]);
+  XCTAssertEqualObjects(decodedLeave.uuid, @"leave_uuid");
+  XCTAssertEqual(decodedLeave.reason, SNTTemporaryMonitorModeLeaveReasonRevoked);
+}
+
+- (void)testDecodeInvalidData {
+  XCTAssertNil([SNTStoredEventCodec decodeEventData:[NSData data]]);
+
+  NSData* archived = [NSKeyedArchiver archivedDataWithRootObject:@"hello"
+                                           requiringSecureCoding:YES
+                                                           error:nil];
+  XCTAssertFalse([SNTStoredEventCodec isCompactEncoding:archived]);
+  XCTAssertNil([SNTStoredEventCodec decodeEventData:archived]);
+
+  // A valid header followed by garbage
+  const char bad[] = {'S', 'N', 'T', 'E', 1, (char)0xff, (char)0xff, (char)0xff};
+  NSData* garbage = [NSData dataWithBytes:bad length:sizeof(bad)];
+  XCTAssertTrue([SNTStoredEventCodec isCompactEncoding:garbage]);
+  XCTAssertNil([SNTStoredEventCodec decodeEventData:garbage]);
+
+  // Unknown versions are rejected
+  const char future[] = {'S', 'N', 'T', 'E', 2};
+  XCTAssertNil([SNTStoredEventCodec decodeEventData:[NSData dataWithBytes:future
+                                                                   length:sizeof(future)]]);
+}
+
+@end
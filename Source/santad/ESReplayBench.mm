@@ -0,0 +1,600 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+/*
+
+Replay an EndpointSecurity trace through santad's Authorizer, Recorder and
+data file access clients, backed by MockEndpointSecurityAPI, and report
+throughput, response latency, per stage latency and memory use. Traces are
+recorded by santad when the EventTracePath configuration key is set:
+
+  sudo defaults write /var/db/santa/config.plist EventTracePath /tmp/santa.trace
+  # ... restart santad, run the workload, remove the key and restart again ...
+  bazel run //Source/santad:es_replay_bench -- -t /tmp/santa.trace
+
+Messages are delivered to the client that originally received them, through
+the same handler ES would call. Execs are evaluated by the real execution
+controller, so decisions depend on the binaries present on this machine and
+traces are most representative when replayed where they were recorded.
+Responses go nowhere and no processes are suspended or killed.
+
+Options:
+  -t  Trace file (required)
+  -s  Replay speed relative to the recording, e.g. 2 replays twice as fast.
+      0 delivers every message as fast as possible (default 0)
+  -l  Log type: "null", "file", "json" or "protobuf" (default protobuf)
+  -f  File access policy plist. Without one no paths are watched.
+  -d  Rules database that execs are evaluated against. The database is
+      migrated when opened, so pass a copy. Without one no rules exist.
+
+*/
+
+#import <Foundation/Foundation.h>
+#import <fmdb/FMDB.h>
+#include <dispatch/dispatch.h>
+#include <getopt.h>
+#include <gmock/gmock.h>
+#include <mach/mach_time.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Source/common/LatencyHistogram.h"
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTConfigurator.h"
+#import "Source/common/SNTStoredFileAccessEvent.h"
+#include "Source/common/PrefixTree.h"
+#include "Source/common/SystemResources.h"
+#include "Source/common/TelemetryEventMap.h"
+#include "Source/common/Unit.h"
+#include "Source/common/es/Client.h"
+#include "Source/common/es/ESMetricsObserver.h"
+#include "Source/common/es/Enricher.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/es/MockEndpointSecurityAPI.h"
+#include "Source/common/es/Trace.h"
+#include "Source/common/faa/WatchItems.h"
+#include "Source/common/processtree/process_tree.h"
+#import "Source/santad/DataLayer/SNTEventTable.h"
+#import "Source/santad/DataLayer/SNTRuleTable.h"
+#include "Source/santad/EntitlementsFilter.h"
+#include "Source/santad/EventProviders/AuthResultCache.h"
+#include "Source/santad/EventProviders/FAAPolicyProcessor.h"
+#import "Source/santad/EventProviders/SNTEndpointSecurityAuthorizer.h"
+#import "Source/santad/EventProviders/SNTEndpointSecurityDataFileAccessAuthorizer.h"
+#import "Source/santad/EventProviders/SNTEndpointSecurityRecorder.h"
+#include "Source/santad/Logs/EndpointSecurity/Logger.h"
+#include "Source/santad/Metrics.h"
+#include "Source/santad/SNTDecisionCache.h"
+#import "Source/santad/SNTExecutionController.h"
+#import "Source/santad/SNTPolicyProcessor.h"
+#include "Source/santad/SandboxExpectations.h"
+#include "Source/santad/SleighLauncher.h"
+#include "Source/santad/TTYWriter.h"
+#include "absl/container/flat_hash_map.h"
+
+using santa::AuthResultCache;
+using santa::Client;
+using santa::Enricher;
+using santa::EventDisposition;
+using santa::LatencyHistogram;
+using santa::LatencyStage;
+using santa::Logger;
+using santa::Message;
+using santa::Processor;
+using santa::PublishedPrefixTree;
+using santa::StageLatencies;
+using santa::TracedMessage;
+using santa::TraceReader;
+using santa::Unit;
+using santa::WatchItems;
+
+using MessageHandler = void (^)(es_client_t*, Message);
+
+// AUTH messages waiting this long for a response are reported as stuck
+static const uint64_t kDrainTimeoutSecs = 60;
+
+namespace {
+
+struct Config {
+  std::string trace;
+  double speed = 0;
+  SNTEventLogType logType = SNTEventLogTypeProtobuf;
+  NSString* faaPolicy;
+  NSString* rulesDB;
+};
+
+// Counts dispositions reported by the clients
+class ReplayMetricsObserver : public santa::ESMetricsObserver {
+ public:
+  void UpdateEventStats(Processor processor, es_event_type_t event_type, uint64_t seq_num,
+                        uint64_t global_seq_num) override {}
+
+  void SetEventMetrics(Processor processor, EventDisposition disposition, int64_t nanos,
+                       es_event_type_t event_type) override {
+    if (disposition == EventDisposition::kProcessed) {
+      processed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void SetAuthResponseBudget(Processor processor, es_event_type_t event_type,
+                             int64_t remaining_nanos) override {
+    if (remaining_nanos < 0) {
+      missed_deadlines.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<uint64_t> processed{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> missed_deadlines{0};
+};
+
+// The messages of a trace along with what's needed to answer the mock ES API
+// for them. Only the counters are modified once the replay starts.
+struct Replay {
+  std::vector<std::unique_ptr<TracedMessage>> messages;
+  absl::flat_hash_map<const es_message_t*, size_t> index;
+  absl::flat_hash_map<const es_event_exec_t*, const TracedMessage*> execs;
+  std::vector<uint64_t> delivered_nanos;
+  // Time from delivery until responding, keyed by AUTH event type
+  absl::flat_hash_map<es_event_type_t, std::unique_ptr<LatencyHistogram>> responses;
+
+  std::atomic<int64_t> retained{0};
+  std::atomic<bool> delivered_all{false};
+  dispatch_semaphore_t drained = dispatch_semaphore_create(0);
+};
+
+const char* StageName(LatencyStage stage) {
+  switch (stage) {
+    case LatencyStage::kEnrich: return "enrich";
+    case LatencyStage::kCacheCheck: return "cache_check";
+    case LatencyStage::kRuleLookup: return "rule_lookup";
+    case LatencyStage::kCELEvaluation: return "cel_evaluation";
+    case LatencyStage::kHashing: return "hashing";
+    case LatencyStage::kRespond: return "respond";
+  }
+  return "unknown";
+}
+
+std::string EventName(es_event_type_t event_type) {
+  return std::string(santa::EventTypeToString(event_type).UTF8String);
+}
+
+std::string FormatSnapshot(const LatencyHistogram::Snapshot& snapshot) {
+  return "count=" + std::to_string(snapshot.count) +
+         " p50_ns=" + std::to_string(snapshot.Percentile(50)) +
+         " p90_ns=" + std::to_string(snapshot.Percentile(90)) +
+         " p99_ns=" + std::to_string(snapshot.Percentile(99)) +
+         " max_ns=" + std::to_string(snapshot.max);
+}
+
+uint64_t ResidentBytes() {
+  std::optional<SantaTaskInfo> info = GetTaskInfo();
+  return info ? info->resident_size : 0;
+}
+
+void PrintUsage() {
+  std::cerr << "Usage: es_replay_bench -t <trace> [-s speed] [-l null|file|json|protobuf]\n"
+            << "                       [-f file_access_policy.plist] [-d rules.db]" << std::endl;
+}
+
+bool ParseLogType(const char* str, SNTEventLogType* logType) {
+  static const std::map<std::string, SNTEventLogType> kLogTypes = {
+      {"null", SNTEventLogTypeNull},
+      {"file", SNTEventLogTypeFilelog},
+      {"json", SNTEventLogTypeJSON},
+      {"protobuf", SNTEventLogTypeProtobuf},
+  };
+  auto it = kLogTypes.find(str);
+  if (it == kLogTypes.end()) {
+    return false;
+  }
+  *logType = it->second;
+  return true;
+}
+
+bool LoadTrace(const std::string& path, Replay* replay) {
+  std::unique_ptr<TraceReader> reader = TraceReader::Create(path.c_str());
+  if (!reader) {
+    std::cerr << "Error: Unable to open trace: " << path << std::endl;
+    return false;
+  }
+
+  santa::pb::v1::es_trace::Event event;
+  uint64_t unsupported = 0;
+  while (reader->Next(&event)) {
+    if (std::unique_ptr<TracedMessage> traced = TracedMessage::Create(event)) {
+      replay->messages.push_back(std::move(traced));
+    } else {
+      unsupported++;
+    }
+  }
+  if (reader->HadError()) {
+    std::cerr << "Error: Trace is malformed after " << replay->messages.size() << " events"
+              << std::endl;
+    return false;
+  }
+  if (unsupported > 0) {
+    std::cerr << "Skipping " << unsupported << " unsupported events" << std::endl;
+  }
+
+  // Clients record into the trace from their own threads, restore arrival order
+  std::stable_sort(replay->messages.begin(), replay->messages.end(),
+                   [](const auto& lhs, const auto& rhs) {
+                     return lhs->offset_nanos() < rhs->offset_nanos();
+                   });
+
+  replay->delivered_nanos.resize(replay->messages.size());
+  for (size_t i = 0; i < replay->messages.size(); i++) {
+    const es_message_t* msg = replay->messages[i]->get();
+    replay->index[msg] = i;
+    if (msg->event_type == ES_EVENT_TYPE_AUTH_EXEC ||
+        msg->event_type == ES_EVENT_TYPE_NOTIFY_EXEC) {
+      replay->execs[&msg->event.exec] = replay->messages[i].get();
+    }
+    if (msg->action_type == ES_ACTION_TYPE_AUTH && !replay->responses.contains(msg->event_type)) {
+      replay->responses[msg->event_type] = std::make_unique<LatencyHistogram>();
+    }
+  }
+  return true;
+}
+
+void RecordResponse(Replay* replay, const Message& msg) {
+  auto it = replay->index.find(msg.operator->());
+  if (it == replay->index.end()) {
+    return;
+  }
+  uint64_t latency = clock_gettime_nsec_np(CLOCK_MONOTONIC) - replay->delivered_nanos[it->second];
+  replay->responses.at(msg->event_type)->Record(latency);
+}
+
+// Answer the calls clients make while starting up and responding, and hand
+// out the arguments of traced execs. Everything else uses the mock defaults.
+void SetupMockESAPI(testing::NiceMock<MockEndpointSecurityAPI>* esapi, Replay* replay,
+                    __strong MessageHandler* lastHandler) {
+  using testing::Return;
+
+  ON_CALL(*esapi, NewClient).WillByDefault([lastHandler](MessageHandler handler) {
+    *lastHandler = handler;
+    return Client(nullptr, ES_NEW_CLIENT_RESULT_SUCCESS);
+  });
+  ON_CALL(*esapi, MuteProcess).WillByDefault(Return(true));
+  ON_CALL(*esapi, Subscribe).WillByDefault(Return(true));
+  ON_CALL(*esapi, Unsubscribe).WillByDefault(Return(true));
+  ON_CALL(*esapi, ClearCache).WillByDefault(Return(true));
+  ON_CALL(*esapi, InvertTargetPathMuting).WillByDefault(Return(true));
+  ON_CALL(*esapi, UnmuteAllTargetPaths).WillByDefault(Return(true));
+  ON_CALL(*esapi, MuteTargetPath).WillByDefault(Return(true));
+  ON_CALL(*esapi, UnmuteTargetPath).WillByDefault(Return(true));
+
+  ON_CALL(*esapi, RetainMessage).WillByDefault([replay](const es_message_t*) {
+    replay->retained.fetch_add(1, std::memory_order_relaxed);
+  });
+  ON_CALL(*esapi, ReleaseMessage).WillByDefault([replay](const es_message_t*) {
+    if (replay->retained.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+        replay->delivered_all.load(std::memory_order_acquire)) {
+      dispatch_semaphore_signal(replay->drained);
+    }
+  });
+
+  ON_CALL(*esapi, RespondAuthResult)
+      .WillByDefault([replay](const Client&, const Message& msg, es_auth_result_t, bool) {
+        RecordResponse(replay, msg);
+        return true;
+      });
+  ON_CALL(*esapi, RespondFlagsResult)
+      .WillByDefault([replay](const Client&, const Message& msg, uint32_t, bool) {
+        RecordResponse(replay, msg);
+        return true;
+      });
+
+  ON_CALL(*esapi, ExecArgCount).WillByDefault([replay](const es_event_exec_t* exec) {
+    auto it = replay->execs.find(exec);
+    return it == replay->execs.end() ? 0 : (uint32_t)it->second->ExecArgs().size();
+  });
+  ON_CALL(*esapi, ExecArg).WillByDefault([replay](const es_event_exec_t* exec, uint32_t index) {
+    auto it = replay->execs.find(exec);
+    if (it == replay->execs.end() || index >= it->second->ExecArgs().size()) {
+      return es_string_token_t{};
+    }
+    const std::string& arg = it->second->ExecArgs()[index];
+    return es_string_token_t{.length = arg.size(), .data = arg.c_str()};
+  });
+}
+
+int Run(const Config& config) {
+  Replay replay;
+  if (!LoadTrace(config.trace, &replay)) {
+    return 1;
+  }
+  if (replay.messages.empty()) {
+    std::cerr << "Error: Trace has no events" << std::endl;
+    return 1;
+  }
+
+  NSString* workDir = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"es_replay_bench_%d", getpid()]];
+  [[NSFileManager defaultManager] createDirectoryAtPath:workDir
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+
+  auto esapi = std::make_shared<testing::NiceMock<MockEndpointSecurityAPI>>();
+  MessageHandler lastHandler = nil;
+  SetupMockESAPI(esapi.get(), &replay, &lastHandler);
+
+  SNTConfigurator* configurator = [SNTConfigurator configurator];
+  if (configurator.eventTracePath.length > 0) {
+    // The clients would otherwise record the replay over the existing trace
+    std::cerr << "Error: Remove the EventTracePath configuration key before replaying"
+              << std::endl;
+    return 1;
+  }
+  auto metrics = std::make_shared<ReplayMetricsObserver>();
+
+  auto treeStatus = santa::santad::process_tree::CreateTree({});
+  if (!treeStatus.ok()) {
+    std::cerr << "Error: Failed to create process tree: " << treeStatus.status().ToString()
+              << std::endl;
+    return 1;
+  }
+  std::shared_ptr<santa::santad::process_tree::ProcessTree> processTree = *treeStatus;
+  auto enricher = std::make_shared<Enricher>(processTree);
+
+  std::shared_ptr<Logger> logger = Logger::Create(
+      esapi, santa::SleighLauncher::Create(std::string(santa::SleighLauncher::kDefaultSleighPath)),
+      ^SNTExportConfiguration*() {
+        return nil;
+      },
+      santa::TelemetryEvent::kEverything, config.logType, [SNTDecisionCache sharedCache],
+      [workDir stringByAppendingPathComponent:@"santa.log"],
+      [workDir stringByAppendingPathComponent:@"spool"], 100 * 1024 * 1024, 100 * 1024, 1000,
+      UINT32_MAX, UINT32_MAX, 0, 0);
+  if (!logger) {
+    std::cerr << "Error: Failed to create logger" << std::endl;
+    return 1;
+  }
+
+  FMDatabaseQueue* rulesQueue = config.rulesDB
+                                    ? [[FMDatabaseQueue alloc] initWithPath:config.rulesDB]
+                                    : [[FMDatabaseQueue alloc] init];
+  SNTRuleTable* ruleTable = [[SNTRuleTable alloc] initWithDatabaseQueue:rulesQueue];
+  SNTEventTable* eventTable =
+      [[SNTEventTable alloc] initWithDatabaseQueue:[[FMDatabaseQueue alloc] init]];
+  if (!ruleTable || !eventTable) {
+    std::cerr << "Error: Failed to open databases" << std::endl;
+    return 1;
+  }
+
+  std::shared_ptr<santa::EntitlementsFilter> entitlementsFilter = santa::EntitlementsFilter::Create(
+      configurator.entitlementsTeamIDFilter, configurator.entitlementsPrefixFilter);
+  SNTPolicyProcessor* policyProcessor =
+      [[SNTPolicyProcessor alloc] initWithRuleTable:ruleTable
+                                 entitlementsFilter:entitlementsFilter];
+  std::shared_ptr<santa::TTYWriter> ttyWriter = santa::TTYWriter::Create(true);
+
+  SNTExecutionController* execController = [[SNTExecutionController alloc]
+        initWithRuleTable:ruleTable
+               eventTable:eventTable
+            notifierQueue:nil
+               syncdQueue:nil
+                   logger:^(Message esMsg) {
+                     logger->Log(enricher->Enrich(std::move(esMsg)));
+                   }
+                ttyWriter:ttyWriter
+          policyProcessor:policyProcessor
+      processControlBlock:^bool(pid_t, santa::ProcessControl) {
+        return true;
+      }
+              processTree:processTree
+      sandboxExpectations:std::make_shared<santa::SandboxExpectations>()];
+
+  std::shared_ptr<AuthResultCache> authResultCache = AuthResultCache::Create(esapi, nil);
+
+  std::shared_ptr<WatchItems> watchItems;
+  if (config.faaPolicy) {
+    watchItems = WatchItems::CreateFromPath(config.faaPolicy, UINT32_MAX);
+    if (!watchItems) {
+      std::cerr << "Error: Failed to load file access policy" << std::endl;
+      return 1;
+    }
+    // Load the policy now rather than waiting for the timer
+    watchItems->OnTimer();
+  }
+
+  auto faaPolicyProcessor = std::make_shared<santa::FAAPolicyProcessor>(
+      [SNTDecisionCache sharedCache], enricher, logger, ttyWriter, nullptr,
+      configurator.fileAccessGlobalLogsPerSec, configurator.fileAccessGlobalWindowSizeSec,
+      ^santa::FAAPolicyProcessor::URLTextPair(
+          const std::shared_ptr<santa::WatchItemPolicyBase>& policy) {
+        return watchItems ? watchItems->EventDetailLinkInfo(policy)
+                          : santa::FAAPolicyProcessor::URLTextPair{};
+      },
+      ^(SNTStoredFileAccessEvent*, bool) {
+      });
+
+  std::map<Processor, MessageHandler> handlers;
+  auto prefixTree = std::make_shared<PublishedPrefixTree<Unit>>();
+
+  SNTEndpointSecurityAuthorizer* authorizer =
+      [[SNTEndpointSecurityAuthorizer alloc] initWithESAPI:esapi
+                                                   metrics:metrics
+                                            execController:execController
+                                        compilerController:nil
+                                           authResultCache:authResultCache
+                                                 ttyWriter:ttyWriter
+                                               processTree:processTree];
+  handlers[Processor::kAuthorizer] = lastHandler;
+
+  SNTEndpointSecurityRecorder* recorder =
+      [[SNTEndpointSecurityRecorder alloc] initWithESAPI:esapi
+                                                 metrics:metrics
+                                                  logger:logger
+                                                enricher:enricher
+                                      compilerController:nil
+                                         authResultCache:authResultCache
+                                              prefixTree:prefixTree
+                                             processTree:processTree];
+  handlers[Processor::kRecorder] = lastHandler;
+
+  SNTEndpointSecurityDataFileAccessAuthorizer* dataFAA =
+      [[SNTEndpointSecurityDataFileAccessAuthorizer alloc]
+                        initWithESAPI:esapi
+                              metrics:metrics
+                               logger:logger
+                             enricher:enricher
+                   faaPolicyProcessor:std::make_shared<santa::DataFAAPolicyProcessorProxy>(
+                                          faaPolicyProcessor)
+                            ttyWriter:ttyWriter
+          findPoliciesForTargetsBlock:^(const santa::TargetPaths& paths) {
+            return watchItems ? watchItems->FindPoliciesForTargets(paths)
+                              : santa::TargetPolicyPairs{};
+          }];
+  handlers[Processor::kDataFileAccessAuthorizer] = lastHandler;
+  [authorizer registerAuthExecProbe:dataFAA];
+
+  [authorizer enable];
+  [recorder enable];
+  [dataFAA enable];
+
+  // Only this run's stage latencies should be reported
+  StageLatencies::Shared().ForEach(true, [](LatencyStage, es_event_type_t,
+                                            const LatencyHistogram::Snapshot&) {});
+
+  uint64_t startResident = ResidentBytes();
+  auto peakResident = std::make_shared<std::atomic<uint64_t>>(startResident);
+  dispatch_source_t sampler = dispatch_source_create(
+      DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+  dispatch_source_set_timer(sampler, DISPATCH_TIME_NOW, 50 * NSEC_PER_MSEC, 10 * NSEC_PER_MSEC);
+  dispatch_source_set_event_handler(sampler, ^{
+    uint64_t resident = ResidentBytes();
+    uint64_t prev = peakResident->load(std::memory_order_relaxed);
+    while (resident > prev && !peakResident->compare_exchange_weak(prev, resident)) {
+    }
+  });
+  dispatch_resume(sampler);
+
+  uint64_t skipped = 0;
+  uint64_t startMach = mach_absolute_time();
+  uint64_t startNanos = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  for (size_t i = 0; i < replay.messages.size(); i++) {
+    TracedMessage* traced = replay.messages[i].get();
+    auto it = handlers.find(traced->processor());
+    if (it == handlers.end()) {
+      skipped++;
+      continue;
+    }
+
+    if (config.speed > 0) {
+      mach_wait_until(startMach +
+                      santa::NanosToMachTime((uint64_t)(traced->offset_nanos() / config.speed)));
+    }
+
+    traced->SetDeliveryTime(mach_absolute_time());
+    replay.delivered_nanos[i] = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    it->second(nullptr, Message(esapi, traced->get()));
+  }
+  uint64_t deliveredNanos = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+
+  replay.delivered_all.store(true, std::memory_order_release);
+  bool drained =
+      replay.retained.load(std::memory_order_acquire) == 0 ||
+      dispatch_semaphore_wait(replay.drained,
+                              dispatch_time(DISPATCH_TIME_NOW, kDrainTimeoutSecs * NSEC_PER_SEC)) ==
+          0;
+  logger->Flush();
+  uint64_t endNanos = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  dispatch_source_cancel(sampler);
+
+  uint64_t events = replay.messages.size() - skipped;
+  double seconds = (double)(endNanos - startNanos) / NSEC_PER_SEC;
+  std::cout << "events=" << events << " skipped=" << skipped
+            << " deliver_ms=" << (deliveredNanos - startNanos) / NSEC_PER_MSEC
+            << " total_ms=" << (endNanos - startNanos) / NSEC_PER_MSEC
+            << " throughput_eps=" << (uint64_t)(events / seconds) << std::endl;
+  std::cout << "processed=" << metrics->processed.load() << " dropped=" << metrics->dropped.load()
+            << " missed_deadlines=" << metrics->missed_deadlines.load() << std::endl;
+  if (!drained) {
+    std::cout << "stuck_messages=" << replay.retained.load() << std::endl;
+  }
+
+  for (const auto& [eventType, histogram] : replay.responses) {
+    std::cout << "response event=" << EventName(eventType) << " "
+              << FormatSnapshot(histogram->TakeSnapshot(false)) << std::endl;
+  }
+
+  StageLatencies::Shared().ForEach(
+      false, [](LatencyStage stage, es_event_type_t eventType,
+                const LatencyHistogram::Snapshot& snapshot) {
+        std::cout << "stage event=" << EventName(eventType) << " stage=" << StageName(stage)
+                  << " " << FormatSnapshot(snapshot) << std::endl;
+      });
+
+  std::cout << "memory rss_start_bytes=" << startResident
+            << " rss_peak_bytes=" << peakResident->load() << " rss_end_bytes=" << ResidentBytes()
+            << std::endl;
+
+  [[NSFileManager defaultManager] removeItemAtPath:workDir error:nil];
+  return drained ? 0 : 2;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  @autoreleasepool {
+    Config config;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:s:l:f:d:h")) != -1) {
+      switch (opt) {
+        case 't': config.trace = optarg; break;
+        case 's': {
+          char* end;
+          config.speed = strtod(optarg, &end);
+          if (*end != '\0' || config.speed < 0) {
+            std::cerr << "Error: Invalid speed: " << optarg << std::endl;
+            return 1;
+          }
+          break;
+        }
+        case 'l':
+          if (!ParseLogType(optarg, &config.logType)) {
+            std::cerr << "Error: Invalid log type: " << optarg << std::endl;
+            return 1;
+          }
+          break;
+        case 'f': config.faaPolicy = @(optarg); break;
+        case 'd': config.rulesDB = @(optarg); break;
+        case 'h': PrintUsage(); return 0;
+        default: PrintUsage(); return 1;
+      }
+    }
+
+    if (config.trace.empty()) {
+      PrintUsage();
+      return 1;
+    }
+
+    return Run(config);
+  }
+}
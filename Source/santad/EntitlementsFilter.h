@@ -20,8 +20,10 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 
 #include "Source/common/PrefixTree.h"
+#include "Source/common/SantaCache.h"
 #include "Source/common/Unit.h"
 #include "absl/synchronization/mutex.h"
 
@@ -42,9 +44,17 @@ class EntitlementsFilter {
   EntitlementsFilter(EntitlementsFilter&& other) = delete;
   EntitlementsFilter& operator=(EntitlementsFilter&& rhs) = delete;
 
+  static constexpr uint64_t kFilteredCacheSize = 1024;
+
   // Filter out given information based on current state of the filter configuration.
   NSDictionary* Filter(const char* teamID, NSDictionary* entitlements);
 
+  // Like Filter above, but the result is memoized by `cdhash` until the
+  // filter configuration next changes. Entitlements are covered by the code
+  // signature, so they can't differ between binaries with the same cdhash.
+  // The returned dictionary may be shared with other callers.
+  NSDictionary* Filter(const char* teamID, NSString* cdhash, NSDictionary* entitlements);
+
   // Update TeamID/Prefix filters based on configuration changes.
   void UpdateTeamIDFilter(NSArray<NSString*>* filter);
   void UpdatePrefixFilter(NSArray<NSString*>* filter);
@@ -52,9 +62,17 @@ class EntitlementsFilter {
  private:
   void UpdateTeamIDFilterLocked(NSArray<NSString*>* filter) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
   void UpdatePrefixFilterLocked(NSArray<NSString*>* filter) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  bool IsTeamIDFilteredLocked(const char* teamID) ABSL_SHARED_LOCKS_REQUIRED(lock_);
+  NSDictionary* FilterEntitlementsLocked(NSDictionary* entitlements)
+      ABSL_SHARED_LOCKS_REQUIRED(lock_);
 
   std::set<std::string> teamid_filter_ ABSL_GUARDED_BY(lock_);
-  santa::PrefixTree<santa::Unit> prefix_filter_ ABSL_GUARDED_BY(lock_);
+  santa::PrefixTree<santa::Unit, santa::PrefixTreeLayout::kRadix> prefix_filter_
+      ABSL_GUARDED_BY(lock_);
+  // Bumped whenever either filter changes so that results filtered under a
+  // previous configuration are never returned.
+  uint64_t generation_ ABSL_GUARDED_BY(lock_) = 0;
+  SantaCache<std::pair<std::string, uint64_t>, NSDictionary*> filtered_cache_;
   absl::Mutex lock_;
 };
 
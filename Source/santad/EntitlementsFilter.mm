@@ -26,7 +26,8 @@ std::unique_ptr<EntitlementsFilter> EntitlementsFilter::Create(NSArray<NSString*
 }
 
 EntitlementsFilter::EntitlementsFilter(NSArray<NSString*>* teamid_filter,
-                                       NSArray<NSString*>* prefix_filter) {
+                                       NSArray<NSString*>* prefix_filter)
+    : filtered_cache_(kFilteredCacheSize, 5, SantaCacheEvictionPolicy::kClock) {
   UpdateTeamIDFilterLocked(teamid_filter);
   UpdatePrefixFilterLocked(prefix_filter);
 }
@@ -38,11 +39,50 @@ NSDictionary* EntitlementsFilter::Filter(const char* teamID, NSDictionary* entit
 
   absl::ReaderMutexLock lock(lock_);
 
-  if (teamID && teamid_filter_.count(std::string(teamID)) > 0) {
+  if (IsTeamIDFilteredLocked(teamID)) {
     // Dropping entitlement logging for configured TeamID
     return nil;
   }
 
+  return FilterEntitlementsLocked(entitlements);
+}
+
+NSDictionary* EntitlementsFilter::Filter(const char* teamID, NSString* cdhash,
+                                         NSDictionary* entitlements) {
+  if (!entitlements) {
+    return nil;
+  }
+
+  absl::ReaderMutexLock lock(lock_);
+
+  if (IsTeamIDFilteredLocked(teamID)) {
+    return nil;
+  }
+
+  if (!cdhash.length) {
+    return FilterEntitlementsLocked(entitlements);
+  }
+
+  std::pair<std::string, uint64_t> key{NSStringToUTF8String(cdhash), generation_};
+  NSDictionary* filtered = filtered_cache_.get(key);
+  if (filtered) {
+    return filtered;
+  }
+
+  // Results that filter down to nothing aren't cached, SantaCache can't tell
+  // them apart from a miss.
+  filtered = FilterEntitlementsLocked(entitlements);
+  if (filtered) {
+    filtered_cache_.set(key, filtered);
+  }
+  return filtered;
+}
+
+bool EntitlementsFilter::IsTeamIDFilteredLocked(const char* teamID) {
+  return teamID && teamid_filter_.count(std::string(teamID)) > 0;
+}
+
+NSDictionary* EntitlementsFilter::FilterEntitlementsLocked(NSDictionary* entitlements) {
   if (prefix_filter_.NodeCount() == 0) {
     // No prefix filter exists, copying full entitlements
     return [entitlements sntDeepCopy];
@@ -70,6 +110,8 @@ void EntitlementsFilter::UpdateTeamIDFilter(NSArray<NSString*>* filter) {
 }
 
 void EntitlementsFilter::UpdateTeamIDFilterLocked(NSArray<NSString*>* filter) {
+  generation_++;
+  filtered_cache_.clear();
   teamid_filter_.clear();
 
   for (NSString* prefix in filter) {
@@ -83,6 +125,8 @@ void EntitlementsFilter::UpdatePrefixFilter(NSArray<NSString*>* filter) {
 }
 
 void EntitlementsFilter::UpdatePrefixFilterLocked(NSArray<NSString*>* filter) {
+  generation_++;
+  filtered_cache_.clear();
   prefix_filter_.Reset();
 
   for (NSString* item in filter) {
@@ -230,6 +230,51 @@ using santa::EntitlementsFilter;
   XCTAssertNotNil(result[@"com.example.custom"]);
 }
 
+#pragma mark - Memoization Tests
+
+- (void)testFilterByCDHashIsMemoized {
+  std::unique_ptr<EntitlementsFilter> filter = EntitlementsFilter::Create(@[], @[ @"com.apple." ]);
+
+  NSDictionary* entitlements = @{
+    @"com.apple.security.app-sandbox" : @YES,
+    @"com.example.custom" : @YES,
+  };
+
+  NSDictionary* first = filter->Filter("TEAMID123", @"cdhash1", entitlements);
+  XCTAssertEqual(first.count, 1);
+  XCTAssertNotNil(first[@"com.example.custom"]);
+
+  // Later lookups for the same cdhash return the same filtered object
+  XCTAssertEqual(filter->Filter("TEAMID123", @"cdhash1", entitlements), first);
+  XCTAssertNotEqual(filter->Filter("TEAMID123", @"cdhash2", entitlements), first);
+
+  // Without a cdhash nothing is memoized
+  XCTAssertNotEqual(filter->Filter("TEAMID123", nil, entitlements), first);
+  XCTAssertEqualObjects(filter->Filter("TEAMID123", nil, entitlements), first);
+}
+
+- (void)testFilterByCDHashInvalidatedByUpdates {
+  std::unique_ptr<EntitlementsFilter> filter = EntitlementsFilter::Create(@[], @[ @"com.apple." ]);
+
+  NSDictionary* entitlements = @{
+    @"com.apple.security.app-sandbox" : @YES,
+    @"com.example.custom" : @YES,
+  };
+
+  NSDictionary* result = filter->Filter("TEAMID123", @"cdhash1", entitlements);
+  XCTAssertNotNil(result[@"com.example.custom"]);
+
+  filter->UpdatePrefixFilter(@[ @"com.example." ]);
+  result = filter->Filter("TEAMID123", @"cdhash1", entitlements);
+  XCTAssertEqual(result.count, 1);
+  XCTAssertNotNil(result[@"com.apple.security.app-sandbox"]);
+
+  // TeamID filtering applies even when a result is memoized
+  filter->UpdateTeamIDFilter(@[ @"TEAMID123" ]);
+  XCTAssertNil(filter->Filter("TEAMID123", @"cdhash1", entitlements));
+  XCTAssertNotNil(filter->Filter("TEAMID456", @"cdhash1", entitlements));
+}
+
 #pragma mark - Thread Safety Tests
 
 - (void)testConcurrentUpdateAndFilter {
@@ -20,11 +20,16 @@
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
 #include <sys/stat.h>
+
+#include <array>
+#include <atomic>
 #include <memory>
 
+#include "Source/common/CompactCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTMetricSet.h"
 #include "Source/common/SantaCache.h"
+#include "Source/common/SantaConcurrentCache.h"
 #import "Source/common/SantaVnode.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
 #import "Source/common/es/SNTEndpointSecurityClientBase.h"
@@ -36,7 +41,10 @@ namespace santa {
 struct CachedAuthResult {
   SNTAction action = SNTActionUnset;
   uint64_t timestamp = 0;
-  SNTCachedDecision* cached_decision = nil;
+  std::shared_ptr<const CompactCachedDecision> cached_decision;
+  // Uptime in nanoseconds after which the entry is no longer used, or 0 if
+  // the entry never expires.
+  uint64_t expiry = 0;
 
   // For equality purposes, only the SNTAction and timestamp are considered.
   bool operator==(const CachedAuthResult& rhs) const {
@@ -44,6 +52,18 @@ struct CachedAuthResult {
   }
 };
 
+// Trivially copyable subset of CachedAuthResult used by the lock-free cache.
+struct CachedAuthAction {
+  SNTAction action = SNTActionUnset;
+  uint64_t timestamp = 0;
+  uint64_t expiry = 0;
+
+  bool operator==(const CachedAuthAction& rhs) const {
+    return action == rhs.action && timestamp == rhs.timestamp;
+  }
+  bool operator!=(const CachedAuthAction& rhs) const { return !(*this == rhs); }
+};
+
 enum class FlushCacheMode {
   kNonRootOnly,
   kAllCaches,
@@ -59,21 +79,42 @@ enum class FlushCacheReason {
   kEntitlementsPrefixFilterChanged,
   kEntitlementsTeamIDFilterChanged,
   kCELFallbackRulesChanged,
+  kMemoryPressure,
 };
 
-class AuthResultCache {
- public:
+// Lifetimes, in milliseconds, of cached decisions by the kind of decision
+// that produced them. A lifetime of 0 means entries never expire.
+struct AuthResultCacheTTLs {
   // Santa currently only flushes caches when new DENY rules are added, not
-  // ALLOW rules. This means cache_deny_time_ms should be low enough so that if a
+  // ALLOW rules. This means deny_ms should be low enough so that if a
   // previously denied binary is allowed, it can be re-executed by the user in a
   // timely manner. But the value should be high enough to allow the cache to be
   // effective in the event the binary is executed in rapid succession.
+  uint64_t deny_ms = 1500;
+  // Each consecutive deny of the same file without a cache flush in between
+  // doubles its deny lifetime, up to this value. Values not above deny_ms
+  // disable the extension.
+  uint64_t max_deny_ms = 0;
+  // Allows by binary or CDHash rules, which are bound to the file contents.
+  uint64_t allow_binary_ms = 0;
+  // Allows by team ID, signing ID, certificate or any other rule.
+  uint64_t allow_team_id_ms = 0;
+  // SNTActionRespondAllowNoCache entries, e.g. CEL decisions only cacheable
+  // for the same EUID.
+  uint64_t allow_no_cache_ms = 0;
+};
+
+class AuthResultCache {
+ public:
+  // When lock_free_reads is true, cache lookups are served from a seqlock
+  // protected table and never wait on other readers.
   static std::unique_ptr<AuthResultCache> Create(std::shared_ptr<santa::EndpointSecurityAPI> esapi,
                                                  SNTMetricSet* metric_set,
-                                                 uint64_t cache_deny_time_ms = 1500);
+                                                 const AuthResultCacheTTLs& ttls = {},
+                                                 bool lock_free_reads = false);
 
   AuthResultCache(std::shared_ptr<santa::EndpointSecurityAPI> esapi, SNTMetricCounter* flush_count,
-                  uint64_t cache_deny_time_ms = 1500);
+                  const AuthResultCacheTTLs& ttls = {}, bool lock_free_reads = false);
   virtual ~AuthResultCache();
 
   AuthResultCache(AuthResultCache&& other) = delete;
@@ -87,24 +128,109 @@ class AuthResultCache {
   virtual CachedAuthResult CheckCache(const es_file_t* es_file);
   virtual CachedAuthResult CheckCache(SantaVnode vnode_id);
 
+  // Clear the local caches. When all caches are flushed the ES cache is
+  // cleared too. ES cache clears requested within a short window of each
+  // other are coalesced into a single trailing clear.
   virtual void FlushCache(FlushCacheMode mode, FlushCacheReason reason);
 
+  // Remove only the entries for which `should_remove` returns true, then
+  // clear the ES cache. The block is called without cache locks held.
+  virtual void InvalidateEntries(FlushCacheReason reason, BOOL (^should_remove)(SantaVnode));
+
   virtual NSArray<NSNumber*>* CacheCounts();
 
+  // Number of entries that expired, by decision: deny, allow and allow no cache.
+  std::array<uint64_t, 3> ExpirationCounts() const;
+
+  // Approximate bytes used by the root and non-root caches, in the same order
+  // as CacheCounts. Decisions attached to entries are not included.
+  virtual NSArray<NSNumber*>* CacheBytes();
+
   virtual void SetESClient(id<SNTEndpointSecurityClientBase> client);
 
+  // Persist cached SNTActionRespondAllow entries to `path` along with the
+  // current file stat of each entry. The `policy_generation` string should
+  // change whenever previously cached decisions could change (e.g. the rules
+  // hash or client mode) so that stale snapshots are discarded.
+  virtual bool SaveSnapshot(NSString* path, NSString* policy_generation);
+
+  // Re-populate the cache from a snapshot written by SaveSnapshot. Entries
+  // are only restored if the snapshot policy generation matches and the
+  // file still has the same stat as when the snapshot was taken. Existing
+  // cache entries are never overwritten.
+  //
+  // Returns the number of restored entries.
+  virtual size_t RestoreSnapshot(NSString* path, NSString* policy_generation);
+
  private:
-  virtual SantaCache<SantaVnode, CachedAuthResult>* CacheForVnodeID(SantaVnode vnode_id);
+  using LockedCache = SantaCache<SantaVnode, CachedAuthResult, absl::Hash<SantaVnode>,
+                                 SantaCacheLayout::kOpenAddressed>;
+  using LockFreeCache = SantaConcurrentCache<SantaVnode, CachedAuthAction>;
+
+  virtual bool IsRootVnode(SantaVnode vnode_id);
+
+  // Export hit, miss and eviction statistics for both caches.
+  void RegisterCacheMetrics(SNTMetricSet* metric_set);
+
+  // Accessors that dispatch to either the locked or lock-free caches
+  CachedAuthResult Get(SantaVnode vnode_id);
+  bool Set(SantaVnode vnode_id, const CachedAuthResult& value,
+           const CachedAuthResult& previous_value);
+  void Remove(SantaVnode vnode_id);
 
-  SantaCache<SantaVnode, CachedAuthResult>* root_cache_;
-  SantaCache<SantaVnode, CachedAuthResult>* nonroot_cache_;
+  // Visit every cached vnode and action in both caches
+  void ForEachEntry(void (^block)(SantaVnode vnode_id, SNTAction action));
+
+  // Request an asynchronous ES cache clear, coalescing with other requests
+  void ClearESCache(FlushCacheReason reason);
+
+  // Lifetime of a new entry, in nanoseconds, for the given decision
+  uint64_t TTLForDecision(SantaVnode vnode_id, SNTAction action, SNTCachedDecision* cd);
+
+  // Lifetime of a new deny entry, extended if the file keeps being denied
+  uint64_t DenyTTL(SantaVnode vnode_id);
+
+  // Forget how often files were denied, e.g. because rules may have changed
+  void ResetDenyStreaks();
+
+  std::shared_ptr<LockedCache> root_cache_;
+  std::shared_ptr<LockedCache> nonroot_cache_;
+
+  // Only populated when lock-free reads are enabled. Decisions attached to
+  // SNTActionRespondAllowNoCache entries aren't trivially copyable so they are
+  // kept in a separate locked cache.
+  std::shared_ptr<LockFreeCache> root_lock_free_cache_;
+  std::shared_ptr<LockFreeCache> nonroot_lock_free_cache_;
+  std::unique_ptr<SantaCache<SantaVnode, std::shared_ptr<const CompactCachedDecision>>>
+      lock_free_decisions_;
 
   std::shared_ptr<santa::EndpointSecurityAPI> esapi_;
   SNTMetricCounter* flush_count_;
+  SNTMetricCounter* coalesced_flush_count_;
   uint64_t root_devno_;
-  uint64_t cache_deny_time_ns_;
+  uint64_t deny_ttl_ns_;
+  uint64_t max_deny_ttl_ns_;
+  uint64_t allow_binary_ttl_ns_;
+  uint64_t allow_team_id_ttl_ns_;
+  uint64_t allow_no_cache_ttl_ns_;
+
+  // Number of consecutive denies of each file since the last flush. Only
+  // populated when adaptive deny lifetimes are enabled.
+  std::unique_ptr<SantaCache<SantaVnode, uint32_t>> deny_streaks_;
+
+  // Shared with the metrics callback, which may outlive the cache
+  using ExpirationCounters = std::array<std::atomic<uint64_t>, 3>;
+  std::shared_ptr<ExpirationCounters> expirations_ = std::make_shared<ExpirationCounters>();
   dispatch_queue_t q_;
   __weak id<SNTEndpointSecurityClientBase> es_client_;
+
+  // ES cache clear coalescing state. Only accessed on q_. Shared with the
+  // blocks enqueued on q_ so that they may safely outlive the cache.
+  struct ESClearState {
+    uint64_t last_clear_time = 0;
+    bool pending = false;
+  };
+  std::shared_ptr<ESClearState> es_clear_state_ = std::make_shared<ESClearState>();
 };
 
 }  // namespace santa
@@ -16,6 +16,12 @@
 #include "Source/santad/EventProviders/AuthResultCache.h"
 
 #include <mach/clock_types.h>
+#include <sys/fsgetpath.h>
+#include <sys/param.h>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
 
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTLogging.h"
@@ -36,6 +42,83 @@ static NSString* const kFlushCacheReasonEntitlementsPrefixFilterChanged =
 static NSString* const kFlushCacheReasonEntitlementsTeamIDFilterChanged =
     @"EntitlementsTeamIDFilterChanged";
 static NSString* const kFlushCacheReasonCELFallbackRulesChanged = @"CELFallbackRulesChanged";
+static NSString* const kFlushCacheReasonMemoryPressure = @"MemoryPressure";
+
+// ES cache clears requested within this window of the previous clear are
+// merged into a single clear at the end of the window. A large sync can add
+// rules in many small batches, and each full ES cache clear forces every
+// subsequent exec back through santad.
+static constexpr uint64_t kESCacheClearCoalesceWindowNs = 100 * NSEC_PER_MSEC;
+
+// Number of distinct files whose consecutive denies are tracked
+static constexpr size_t kMaxDenyStreaks = 1000;
+
+// Indices into the expiration counters
+static constexpr size_t kExpiredDeny = 0;
+static constexpr size_t kExpiredAllow = 1;
+static constexpr size_t kExpiredAllowNoCache = 2;
+
+// Snapshot file layout, all fields are host byte order:
+//   SnapshotHeader
+//   char[header.generation_len] policy generation (UTF-8, not terminated)
+//   SnapshotEntry[header.entry_count]
+static constexpr uint32_t kSnapshotMagic = 0x53414348;  // 'SACH'
+static constexpr uint32_t kSnapshotVersion = 1;
+
+// Upper bound on the size of a snapshot file that will be parsed
+static constexpr NSUInteger kSnapshotMaxSize = 4 * 1024 * 1024;
+
+struct SnapshotHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t generation_len;
+  uint32_t entry_count;
+};
+
+struct SnapshotFileStamp {
+  int64_t ctime_sec;
+  int64_t ctime_nsec;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  int64_t size;
+
+  bool operator==(const SnapshotFileStamp& rhs) const {
+    return ctime_sec == rhs.ctime_sec && ctime_nsec == rhs.ctime_nsec &&
+           mtime_sec == rhs.mtime_sec && mtime_nsec == rhs.mtime_nsec && size == rhs.size;
+  }
+};
+
+struct SnapshotEntry {
+  uint64_t fsid;
+  uint64_t fileid;
+  uint32_t action;
+  uint32_t reserved;
+  SnapshotFileStamp stamp;
+};
+
+// Resolve the vnode to its current path and return the stat fields that
+// change whenever the file content or metadata is modified.
+static std::optional<SnapshotFileStamp> FileStampForVnode(SantaVnode vnode_id) {
+  fsid_t fsid = {.val = {(int32_t)vnode_id.fsid, 0}};
+  char path[MAXPATHLEN];
+  if (fsgetpath(path, sizeof(path), &fsid, vnode_id.fileid) < 0) {
+    return std::nullopt;
+  }
+
+  struct stat sb;
+  if (lstat(path, &sb) != 0 || !S_ISREG(sb.st_mode) || sb.st_dev != vnode_id.fsid ||
+      sb.st_ino != vnode_id.fileid) {
+    return std::nullopt;
+  }
+
+  return SnapshotFileStamp{
+      .ctime_sec = sb.st_ctimespec.tv_sec,
+      .ctime_nsec = sb.st_ctimespec.tv_nsec,
+      .mtime_sec = sb.st_mtimespec.tv_sec,
+      .mtime_nsec = sb.st_mtimespec.tv_nsec,
+      .size = sb.st_size,
+  };
+}
 
 namespace santa {
 
@@ -53,6 +136,7 @@ NSString* const FlushCacheReasonToString(FlushCacheReason reason) {
       return kFlushCacheReasonEntitlementsTeamIDFilterChanged;
     case FlushCacheReason::kCELFallbackRulesChanged:
       return kFlushCacheReasonCELFallbackRulesChanged;
+    case FlushCacheReason::kMemoryPressure: return kFlushCacheReasonMemoryPressure;
     default:
       [NSException raise:@"Invalid reason"
                   format:@"Unknown reason value: %d", static_cast<int>(reason)];
@@ -62,22 +146,43 @@ NSString* const FlushCacheReasonToString(FlushCacheReason reason) {
 
 std::unique_ptr<AuthResultCache> AuthResultCache::Create(std::shared_ptr<EndpointSecurityAPI> esapi,
                                                          SNTMetricSet* metric_set,
-                                                         uint64_t cache_deny_time_ms) {
+                                                         const AuthResultCacheTTLs& ttls,
+                                                         bool lock_free_reads) {
   SNTMetricCounter* flush_count =
       [metric_set counterWithName:@"/santa/flush_count"
                        fieldNames:@[ @"Reason" ]
                          helpText:@"Count of times the auth result cache is flushed by reason"];
 
-  return std::make_unique<AuthResultCache>(esapi, flush_count, cache_deny_time_ms);
+  auto cache = std::make_unique<AuthResultCache>(esapi, flush_count, ttls, lock_free_reads);
+  cache->RegisterCacheMetrics(metric_set);
+  return cache;
 }
 
 AuthResultCache::AuthResultCache(std::shared_ptr<EndpointSecurityAPI> esapi,
-                                 SNTMetricCounter* flush_count, uint64_t cache_deny_time_ms)
+                                 SNTMetricCounter* flush_count, const AuthResultCacheTTLs& ttls,
+                                 bool lock_free_reads)
     : esapi_(esapi),
       flush_count_(flush_count),
-      cache_deny_time_ns_(cache_deny_time_ms * NSEC_PER_MSEC) {
-  root_cache_ = new SantaCache<SantaVnode, CachedAuthResult>();
-  nonroot_cache_ = new SantaCache<SantaVnode, CachedAuthResult>();
+      deny_ttl_ns_(ttls.deny_ms * NSEC_PER_MSEC),
+      max_deny_ttl_ns_(std::max(ttls.max_deny_ms, ttls.deny_ms) * NSEC_PER_MSEC),
+      allow_binary_ttl_ns_(ttls.allow_binary_ms * NSEC_PER_MSEC),
+      allow_team_id_ttl_ns_(ttls.allow_team_id_ms * NSEC_PER_MSEC),
+      allow_no_cache_ttl_ns_(ttls.allow_no_cache_ms * NSEC_PER_MSEC) {
+  // Evict individual cold entries when full rather than purging the entire
+  // cache, which would cause a burst of uncached exec evaluations.
+  root_cache_ = std::make_shared<LockedCache>(10000, 5, SantaCacheEvictionPolicy::kClock);
+  nonroot_cache_ = std::make_shared<LockedCache>(10000, 5, SantaCacheEvictionPolicy::kClock);
+
+  if (lock_free_reads) {
+    root_lock_free_cache_ = std::make_shared<LockFreeCache>();
+    nonroot_lock_free_cache_ = std::make_shared<LockFreeCache>();
+    lock_free_decisions_ = std::make_unique<
+        SantaCache<SantaVnode, std::shared_ptr<const CompactCachedDecision>>>(1000);
+  }
+
+  if (max_deny_ttl_ns_ > deny_ttl_ns_ && deny_ttl_ns_ > 0) {
+    deny_streaks_ = std::make_unique<SantaCache<SantaVnode, uint32_t>>(kMaxDenyStreaks);
+  }
 
   struct stat sb;
   if (stat("/", &sb) == 0) {
@@ -90,40 +195,107 @@ AuthResultCache::AuthResultCache(std::shared_ptr<EndpointSecurityAPI> esapi,
                                               QOS_CLASS_USER_INTERACTIVE, 0));
 }
 
-AuthResultCache::~AuthResultCache() {
-  delete root_cache_;
-  delete nonroot_cache_;
+AuthResultCache::~AuthResultCache() {}
+
+void AuthResultCache::RegisterCacheMetrics(SNTMetricSet* metric_set) {
+  if (!metric_set) {
+    return;
+  }
+
+  SNTMetricInt64Gauge* lookups =
+      [metric_set int64GaugeWithName:@"/santa/auth_result_cache/lookups"
+                          fieldNames:@[ @"Cache", @"Result" ]
+                            helpText:@"Cumulative count of auth result cache lookups"];
+  SNTMetricInt64Gauge* evictions =
+      [metric_set int64GaugeWithName:@"/santa/auth_result_cache/evictions"
+                          fieldNames:@[ @"Cache" ]
+                            helpText:@"Cumulative count of auth result cache evictions"];
+  coalesced_flush_count_ =
+      [metric_set counterWithName:@"/santa/auth_result_cache/coalesced_flush_count"
+                       fieldNames:@[ @"Reason" ]
+                         helpText:@"Count of ES cache clears merged into a pending clear"];
+  SNTMetricInt64Gauge* expirations =
+      [metric_set int64GaugeWithName:@"/santa/auth_result_cache/expirations"
+                          fieldNames:@[ @"Decision" ]
+                            helpText:@"Cumulative count of auth result cache entries that expired"];
+  std::weak_ptr<ExpirationCounters> weak_expirations = expirations_;
+
+  std::weak_ptr<LockedCache> weak_root_cache = root_cache_;
+  std::weak_ptr<LockedCache> weak_nonroot_cache = nonroot_cache_;
+  std::weak_ptr<LockFreeCache> weak_root_lock_free_cache = root_lock_free_cache_;
+  std::weak_ptr<LockFreeCache> weak_nonroot_lock_free_cache = nonroot_lock_free_cache_;
+  bool lock_free = (root_lock_free_cache_ != nullptr);
+
+  [metric_set registerCallback:^{
+    auto export_locked = [&](std::shared_ptr<LockedCache> cache, NSString* name) {
+      if (!cache) return;
+      LockedCache::Stats stats = cache->stats();
+      [lookups set:stats.hits forFieldValues:@[ name, @"Hit" ]];
+      [lookups set:stats.misses forFieldValues:@[ name, @"Miss" ]];
+      [evictions set:stats.evictions forFieldValues:@[ name ]];
+    };
+
+    // Lock-free lookups are not counted to avoid shared writes on the read path
+    auto export_lock_free = [&](std::shared_ptr<LockFreeCache> cache, NSString* name) {
+      if (!cache) return;
+      [evictions set:cache->evictions() forFieldValues:@[ name ]];
+    };
+
+    if (lock_free) {
+      export_lock_free(weak_root_lock_free_cache.lock(), @"Root");
+      export_lock_free(weak_nonroot_lock_free_cache.lock(), @"NonRoot");
+    } else {
+      export_locked(weak_root_cache.lock(), @"Root");
+      export_locked(weak_nonroot_cache.lock(), @"NonRoot");
+    }
+
+    if (std::shared_ptr<ExpirationCounters> counters = weak_expirations.lock()) {
+      [expirations set:(*counters)[kExpiredDeny].load(std::memory_order_relaxed)
+          forFieldValues:@[ @"Deny" ]];
+      [expirations set:(*counters)[kExpiredAllow].load(std::memory_order_relaxed)
+          forFieldValues:@[ @"Allow" ]];
+      [expirations set:(*counters)[kExpiredAllowNoCache].load(std::memory_order_relaxed)
+          forFieldValues:@[ @"AllowNoCache" ]];
+    }
+  }];
 }
 
 bool AuthResultCache::AddToCache(const es_file_t* es_file, SNTAction decision,
                                  SNTCachedDecision* cd) {
   SantaVnode vnode_id = SantaVnode::VnodeForFile(es_file);
-  SantaCache<SantaVnode, CachedAuthResult>* cache = CacheForVnodeID(vnode_id);
-  CachedAuthResult requestBinary = {SNTActionRequestBinary, 0, nil};
+  CachedAuthResult requestBinary = {SNTActionRequestBinary, 0, nullptr};
 
   switch (decision) {
     // SNTActionRequestBinary and SNTActionRespondHold are not terminal states and should not
     // contain a timestamp to allow for proper transitions out of the state.
-    case SNTActionRequestBinary: return cache->set(vnode_id, requestBinary, CachedAuthResult{});
+    case SNTActionRequestBinary: return Set(vnode_id, requestBinary, CachedAuthResult{});
     case SNTActionRespondHold:
-      return cache->set(vnode_id, CachedAuthResult{SNTActionRespondHold, 0, nil}, requestBinary);
+      return Set(vnode_id, CachedAuthResult{SNTActionRespondHold, 0, nullptr}, requestBinary);
 
     case SNTActionRespondAllow: OS_FALLTHROUGH;
     case SNTActionRespondAllowCompiler: OS_FALLTHROUGH;
-    case SNTActionRespondDeny:
-      return cache->set(vnode_id, CachedAuthResult{decision, GetCurrentUptime(), nil},
-                        requestBinary);
+    case SNTActionRespondDeny: {
+      uint64_t now = GetCurrentUptime();
+      uint64_t ttl = TTLForDecision(vnode_id, decision, cd);
+      return Set(vnode_id, CachedAuthResult{decision, now, nullptr, ttl ? now + ttl : 0},
+                 requestBinary);
+    }
 
     case SNTActionRespondAllowNoCache: {
-      CachedAuthResult entry = {SNTActionRespondAllowNoCache, GetCurrentUptime(), [cd copy]};
-      return cache->set(vnode_id, entry, requestBinary);
+      uint64_t now = GetCurrentUptime();
+      uint64_t ttl = TTLForDecision(vnode_id, decision, cd);
+      // Copying first drops any pending background hash
+      CachedAuthResult entry = {SNTActionRespondAllowNoCache, now,
+                                CompactCachedDecision::FromDecision([cd copy]),
+                                ttl ? now + ttl : 0};
+      return Set(vnode_id, entry, requestBinary);
     }
 
     // SNTActionHoldAllowed and SNTActionHoldDenied are used for transitions, however the
     // cached action is translated to SNTActionRespondAllow or SNTActionRespondDeny respectively.
     // We do not want to cache this result and later execs need to go through this path again.
     case SNTActionHoldAllowed: OS_FALLTHROUGH;
-    case SNTActionHoldDenied: cache->remove(vnode_id); return YES;
+    case SNTActionHoldDenied: Remove(vnode_id); return YES;
 
     default:
       // This is a programming error. Bail.
@@ -132,9 +304,72 @@ bool AuthResultCache::AddToCache(const es_file_t* es_file, SNTAction decision,
   }
 }
 
+uint64_t AuthResultCache::TTLForDecision(SantaVnode vnode_id, SNTAction action,
+                                         SNTCachedDecision* cd) {
+  if (action == SNTActionRespondDeny) {
+    return DenyTTL(vnode_id);
+  }
+
+  // The file is being allowed, so any earlier denies no longer repeat
+  if (deny_streaks_) {
+    deny_streaks_->remove(vnode_id);
+  }
+
+  if (action == SNTActionRespondAllowNoCache) {
+    return allow_no_cache_ttl_ns_;
+  }
+
+  switch (cd.decision) {
+    case SNTEventStateAllowBinary: OS_FALLTHROUGH;
+    case SNTEventStateAllowLocalBinary: OS_FALLTHROUGH;
+    case SNTEventStateAllowCompilerBinary: OS_FALLTHROUGH;
+    case SNTEventStateAllowCDHash: OS_FALLTHROUGH;
+    case SNTEventStateAllowCompilerCDHash: return allow_binary_ttl_ns_;
+    default: return allow_team_id_ttl_ns_;
+  }
+}
+
+uint64_t AuthResultCache::DenyTTL(SantaVnode vnode_id) {
+  if (!deny_streaks_) {
+    return deny_ttl_ns_;
+  }
+
+  __block uint32_t streak = 0;
+  deny_streaks_->update(vnode_id, ^(uint32_t& value) {
+    value = std::min<uint32_t>(value + 1, 32);
+    streak = value;
+  });
+
+  // Double the lifetime for each repeated deny, stopping before the shift
+  // could overflow
+  uint64_t ttl = deny_ttl_ns_;
+  for (uint32_t i = 1; i < streak && ttl < max_deny_ttl_ns_; i++) {
+    ttl *= 2;
+  }
+  return std::min(ttl, max_deny_ttl_ns_);
+}
+
+void AuthResultCache::ResetDenyStreaks() {
+  if (deny_streaks_) {
+    deny_streaks_->clear();
+  }
+}
+
+std::array<uint64_t, 3> AuthResultCache::ExpirationCounts() const {
+  return {
+      (*expirations_)[kExpiredDeny].load(std::memory_order_relaxed),
+      (*expirations_)[kExpiredAllow].load(std::memory_order_relaxed),
+      (*expirations_)[kExpiredAllowNoCache].load(std::memory_order_relaxed),
+  };
+}
+
 void AuthResultCache::RemoveFromCache(const es_file_t* es_file) {
   SantaVnode vnode_id = SantaVnode::VnodeForFile(es_file);
-  CacheForVnodeID(vnode_id)->remove(vnode_id);
+  // The file changed, so it is no longer the one that was denied before
+  if (deny_streaks_) {
+    deny_streaks_->remove(vnode_id);
+  }
+  Remove(vnode_id);
 }
 
 CachedAuthResult AuthResultCache::CheckCache(const es_file_t* es_file) {
@@ -142,56 +377,320 @@ CachedAuthResult AuthResultCache::CheckCache(const es_file_t* es_file) {
 }
 
 CachedAuthResult AuthResultCache::CheckCache(SantaVnode vnode_id) {
-  SantaCache<SantaVnode, CachedAuthResult>* cache = CacheForVnodeID(vnode_id);
-
-  CachedAuthResult entry = cache->get(vnode_id);
+  CachedAuthResult entry = Get(vnode_id);
   if (entry == CachedAuthResult{}) {
     return {};
   }
 
-  if (entry.action == SNTActionRespondDeny) {
-    uint64_t expiry_time = entry.timestamp + cache_deny_time_ns_;
-    if (expiry_time < GetCurrentUptime()) {
-      cache->remove(vnode_id);
-      return {};
+  if (entry.expiry != 0 && entry.expiry < GetCurrentUptime()) {
+    Remove(vnode_id);
+    size_t counter = kExpiredAllow;
+    if (entry.action == SNTActionRespondDeny) {
+      counter = kExpiredDeny;
+    } else if (entry.action == SNTActionRespondAllowNoCache) {
+      counter = kExpiredAllowNoCache;
     }
+    (*expirations_)[counter].fetch_add(1, std::memory_order_relaxed);
+    return {};
   }
 
   return entry;
 }
 
-SantaCache<SantaVnode, CachedAuthResult>* AuthResultCache::CacheForVnodeID(SantaVnode vnode_id) {
-  return (vnode_id.fsid == root_devno_ || root_devno_ == 0) ? root_cache_ : nonroot_cache_;
+bool AuthResultCache::IsRootVnode(SantaVnode vnode_id) {
+  return vnode_id.fsid == root_devno_ || root_devno_ == 0;
+}
+
+CachedAuthResult AuthResultCache::Get(SantaVnode vnode_id) {
+  bool is_root = IsRootVnode(vnode_id);
+  if (!root_lock_free_cache_) {
+    return (is_root ? root_cache_ : nonroot_cache_)->get(vnode_id);
+  }
+
+  LockFreeCache* cache = is_root ? root_lock_free_cache_.get() : nonroot_lock_free_cache_.get();
+  CachedAuthAction action = cache->get(vnode_id);
+  CachedAuthResult result = {action.action, action.timestamp, nullptr, action.expiry};
+  if (action.action == SNTActionRespondAllowNoCache) {
+    // The decision is only an optimization for re-evaluation. If it was
+    // concurrently removed, callers will recompute it.
+    result.cached_decision = lock_free_decisions_->get(vnode_id);
+  }
+  return result;
+}
+
+bool AuthResultCache::Set(SantaVnode vnode_id, const CachedAuthResult& value,
+                          const CachedAuthResult& previous_value) {
+  bool is_root = IsRootVnode(vnode_id);
+  if (!root_lock_free_cache_) {
+    return (is_root ? root_cache_ : nonroot_cache_)->set(vnode_id, value, previous_value);
+  }
+
+  LockFreeCache* cache = is_root ? root_lock_free_cache_.get() : nonroot_lock_free_cache_.get();
+  if (value.cached_decision) {
+    lock_free_decisions_->set(vnode_id, value.cached_decision);
+  }
+
+  bool was_set = cache->set(
+      vnode_id, CachedAuthAction{value.action, value.timestamp, value.expiry},
+      CachedAuthAction{previous_value.action, previous_value.timestamp, previous_value.expiry});
+  if (!was_set && value.cached_decision) {
+    lock_free_decisions_->remove(vnode_id);
+  }
+  return was_set;
+}
+
+void AuthResultCache::Remove(SantaVnode vnode_id) {
+  bool is_root = IsRootVnode(vnode_id);
+  if (!root_lock_free_cache_) {
+    (is_root ? root_cache_ : nonroot_cache_)->remove(vnode_id);
+    return;
+  }
+
+  (is_root ? root_lock_free_cache_ : nonroot_lock_free_cache_)->remove(vnode_id);
+  lock_free_decisions_->remove(vnode_id);
 }
 
 void AuthResultCache::FlushCache(FlushCacheMode mode, FlushCacheReason reason) {
+  ResetDenyStreaks();
   nonroot_cache_->clear();
+  if (nonroot_lock_free_cache_) {
+    nonroot_lock_free_cache_->clear();
+    // The decision cache is shared by root and non-root entries. Dropping
+    // decisions for root entries is safe, they will be recomputed on demand.
+    lock_free_decisions_->clear();
+  }
+
   if (mode == FlushCacheMode::kAllCaches) {
     root_cache_->clear();
+    if (root_lock_free_cache_) {
+      root_lock_free_cache_->clear();
+    }
 
     // Clear the ES cache when all local caches are flushed. Assume the ES cache
     // doesn't need to be cleared when only flushing the non-root cache.
-    //
-    // Calling into ES should be done asynchronously since it could otherwise
-    // potentially deadlock.
-    auto shared_esapi = esapi_->shared_from_this();
-    id<SNTEndpointSecurityClientBase> client = es_client_;
-    if (client) {
-      dispatch_async(q_, ^{
-        [client clearCache];
-      });
+    ClearESCache(reason);
+  }
+
+  [flush_count_ incrementForFieldValues:@[ FlushCacheReasonToString(reason) ]];
+}
+
+void AuthResultCache::InvalidateEntries(FlushCacheReason reason,
+                                        BOOL (^should_remove)(SantaVnode)) {
+  ResetDenyStreaks();
+
+  __block std::vector<SantaVnode> vnodes;
+  ForEachEntry(^(SantaVnode vnode_id, SNTAction action) {
+    vnodes.push_back(vnode_id);
+  });
+
+  for (const SantaVnode& vnode_id : vnodes) {
+    if (should_remove(vnode_id)) {
+      Remove(vnode_id);
     }
   }
 
+  // ES has no way to invalidate individual entries
+  ClearESCache(reason);
+
   [flush_count_ incrementForFieldValues:@[ FlushCacheReasonToString(reason) ]];
 }
 
+void AuthResultCache::ClearESCache(FlushCacheReason reason) {
+  id<SNTEndpointSecurityClientBase> client = es_client_;
+  if (!client) {
+    return;
+  }
+
+  std::shared_ptr<ESClearState> state = es_clear_state_;
+  SNTMetricCounter* coalesced_flush_count = coalesced_flush_count_;
+  dispatch_queue_t q = q_;
+
+  // Calling into ES should be done asynchronously since it could otherwise
+  // potentially deadlock.
+  dispatch_async(q, ^{
+    if (state->pending) {
+      [coalesced_flush_count incrementForFieldValues:@[ FlushCacheReasonToString(reason) ]];
+      return;
+    }
+
+    uint64_t now = GetCurrentUptime();
+    uint64_t next_allowed = state->last_clear_time + kESCacheClearCoalesceWindowNs;
+    if (state->last_clear_time == 0 || now >= next_allowed) {
+      state->last_clear_time = now;
+      [client clearCache];
+      return;
+    }
+
+    // A clear happened recently. Schedule a single trailing clear at the end
+    // of the window that covers this and any further requests.
+    state->pending = true;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(next_allowed - now)), q, ^{
+      state->pending = false;
+      state->last_clear_time = GetCurrentUptime();
+      [client clearCache];
+    });
+  });
+}
+
 NSArray<NSNumber*>* AuthResultCache::CacheCounts() {
+  if (root_lock_free_cache_) {
+    return @[ @(root_lock_free_cache_->count()), @(nonroot_lock_free_cache_->count()) ];
+  }
   return @[ @(root_cache_->count()), @(nonroot_cache_->count()) ];
 }
 
+NSArray<NSNumber*>* AuthResultCache::CacheBytes() {
+  uint64_t root = root_cache_->approximate_bytes();
+  uint64_t nonroot = nonroot_cache_->approximate_bytes();
+  if (root_lock_free_cache_) {
+    root += root_lock_free_cache_->approximate_bytes();
+    // The decision cache is shared, but it is flushed with the non-root cache
+    nonroot += nonroot_lock_free_cache_->approximate_bytes() +
+               lock_free_decisions_->approximate_bytes();
+  }
+  return @[ @(root), @(nonroot) ];
+}
+
 void AuthResultCache::SetESClient(id<SNTEndpointSecurityClientBase> client) {
   es_client_ = client;
 }
 
+void AuthResultCache::ForEachEntry(void (^block)(SantaVnode vnode_id, SNTAction action)) {
+  if (root_lock_free_cache_) {
+    auto visit = [block](const SantaVnode& vnode_id, const CachedAuthAction& value) {
+      block(vnode_id, value.action);
+    };
+    root_lock_free_cache_->foreach(visit);
+    nonroot_lock_free_cache_->foreach(visit);
+  } else {
+    auto visit = [block](SantaVnode& vnode_id, CachedAuthResult& value) {
+      block(vnode_id, value.action);
+    };
+    root_cache_->foreach(visit);
+    nonroot_cache_->foreach(visit);
+  }
+}
+
+bool AuthResultCache::SaveSnapshot(NSString* path, NSString* policy_generation) {
+  // Collect candidates first, the cache locks are held while iterating
+  __block std::vector<SantaVnode> vnodes;
+  ForEachEntry(^(SantaVnode vnode_id, SNTAction action) {
+    // Only plain allow decisions are safe to carry across restarts. Compiler
+    // and no-cache decisions depend on state that isn't persisted.
+    if (action == SNTActionRespondAllow) {
+      vnodes.push_back(vnode_id);
+    }
+  });
+
+  std::vector<SnapshotEntry> entries;
+  entries.reserve(vnodes.size());
+  for (const SantaVnode& vnode_id : vnodes) {
+    std::optional<SnapshotFileStamp> stamp = FileStampForVnode(vnode_id);
+    if (!stamp.has_value()) {
+      continue;
+    }
+
+    entries.push_back(SnapshotEntry{
+        .fsid = (uint64_t)vnode_id.fsid,
+        .fileid = (uint64_t)vnode_id.fileid,
+        .action = (uint32_t)SNTActionRespondAllow,
+        .reserved = 0,
+        .stamp = *stamp,
+    });
+  }
+
+  NSData* generation = [policy_generation dataUsingEncoding:NSUTF8StringEncoding] ?: [NSData data];
+  SnapshotHeader header = {
+      .magic = kSnapshotMagic,
+      .version = kSnapshotVersion,
+      .generation_len = (uint32_t)generation.length,
+      .entry_count = (uint32_t)entries.size(),
+  };
+
+  NSMutableData* data = [NSMutableData
+      dataWithCapacity:sizeof(header) + generation.length + entries.size() * sizeof(SnapshotEntry)];
+  [data appendBytes:&header length:sizeof(header)];
+  [data appendData:generation];
+  [data appendBytes:entries.data() length:entries.size() * sizeof(SnapshotEntry)];
+
+  NSError* error;
+  if (![data writeToFile:path options:NSDataWritingAtomic error:&error]) {
+    LOGW(@"Unable to write auth result cache snapshot: %@", error.localizedDescription);
+    return false;
+  }
+
+  return true;
+}
+
+size_t AuthResultCache::RestoreSnapshot(NSString* path, NSString* policy_generation) {
+  NSData* data = [NSData dataWithContentsOfFile:path options:NSDataReadingUncached error:nil];
+  if (data.length < sizeof(SnapshotHeader) || data.length > kSnapshotMaxSize) {
+    return 0;
+  }
+
+  SnapshotHeader header;
+  memcpy(&header, data.bytes, sizeof(header));
+  if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion) {
+    LOGI(@"Ignoring auth result cache snapshot with unsupported version");
+    return 0;
+  }
+
+  NSUInteger expected_length = sizeof(header) + (NSUInteger)header.generation_len +
+                               (NSUInteger)header.entry_count * sizeof(SnapshotEntry);
+  if (data.length != expected_length) {
+    LOGW(@"Ignoring malformed auth result cache snapshot");
+    return 0;
+  }
+
+  NSString* generation = [[NSString alloc]
+      initWithData:[data subdataWithRange:NSMakeRange(sizeof(header), header.generation_len)]
+          encoding:NSUTF8StringEncoding];
+  if (![generation isEqualToString:policy_generation]) {
+    LOGI(@"Discarding auth result cache snapshot due to policy change");
+    return 0;
+  }
+
+  const uint8_t* entry_bytes = (const uint8_t*)data.bytes + sizeof(header) + header.generation_len;
+  uint64_t restored_ttl_ns = allow_binary_ttl_ns_;
+  if (allow_team_id_ttl_ns_ && (!restored_ttl_ns || allow_team_id_ttl_ns_ < restored_ttl_ns)) {
+    restored_ttl_ns = allow_team_id_ttl_ns_;
+  }
+
+  size_t restored = 0;
+  for (uint32_t i = 0; i < header.entry_count; ++i) {
+    SnapshotEntry entry;
+    memcpy(&entry, entry_bytes + (i * sizeof(SnapshotEntry)), sizeof(entry));
+    if (entry.action != SNTActionRespondAllow) {
+      continue;
+    }
+
+    SantaVnode vnode_id = {.fsid = (dev_t)entry.fsid, .fileid = (ino_t)entry.fileid};
+    std::optional<SnapshotFileStamp> stamp = FileStampForVnode(vnode_id);
+    if (!stamp.has_value() || !(*stamp == entry.stamp)) {
+      continue;
+    }
+
+    // Never replace a decision made since startup. The rule behind a restored
+    // allow isn't known, so the shorter allow lifetime applies.
+    uint64_t now = GetCurrentUptime();
+    CachedAuthResult value = {SNTActionRespondAllow, now, nullptr,
+                              restored_ttl_ns ? now + restored_ttl_ns : 0};
+    if (!Set(vnode_id, value, CachedAuthResult{})) {
+      continue;
+    }
+
+    // Re-check after inserting. A write that raced with the first check is
+    // either visible here or will remove the entry when the file is closed.
+    stamp = FileStampForVnode(vnode_id);
+    if (!stamp.has_value() || !(*stamp == entry.stamp)) {
+      Set(vnode_id, CachedAuthResult{}, value);
+      continue;
+    }
+
+    ++restored;
+  }
+
+  return restored;
+}
+
 }  // namespace santa
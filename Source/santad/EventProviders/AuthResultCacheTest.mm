@@ -169,6 +169,90 @@ static inline void AssertCacheCounts(std::shared_ptr<AuthResultCache> cache, uin
   AssertCacheCounts(cache, 0, 0);
 }
 
+- (void)testESCacheClearsAreCoalesced {
+  id<SNTEndpointSecurityClientBase> client =
+      OCMProtocolMock(@protocol(SNTEndpointSecurityClientBase));
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(mockESApi, nil);
+  cache->SetESClient(client);
+
+  __block int clears = 0;
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  OCMStub([client clearCache])
+      .andDo(^(NSInvocation* invocation) {
+        clears++;
+        dispatch_semaphore_signal(sema);
+      })
+      .andReturn(true);
+
+  es_file_t rootFile = MakeCacheableFile(RootDevno(), 111);
+
+  // Local caches are always flushed immediately, but only the first ES cache
+  // clear runs immediately. The rest are merged into one trailing clear.
+  for (int i = 0; i < 10; ++i) {
+    cache->AddToCache(&rootFile, SNTActionRequestBinary);
+    cache->FlushCache(FlushCacheMode::kAllCaches, FlushCacheReason::kRulesChanged);
+    AssertCacheCounts(cache, 0, 0);
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    XCTAssertEqual(
+        0, dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+        "ClearCache wasn't called within expected time window");
+  }
+
+  // Allow any remaining trailing clear to run. Normally all requests land in
+  // the first window, but leave headroom for a slow test host.
+  while (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 500 * NSEC_PER_MSEC)) ==
+         0) {
+  }
+  XCTAssertGreaterThanOrEqual(clears, 2);
+  XCTAssertLessThan(clears, 10);
+}
+
+- (void)testInvalidateEntries {
+  id<SNTEndpointSecurityClientBase> client =
+      OCMProtocolMock(@protocol(SNTEndpointSecurityClientBase));
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(mockESApi, nil);
+  cache->SetESClient(client);
+
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  OCMStub([client clearCache])
+      .andDo(^(NSInvocation* invocation) {
+        dispatch_semaphore_signal(sema);
+      })
+      .andReturn(true);
+
+  es_file_t rootFile1 = MakeCacheableFile(RootDevno(), 111);
+  es_file_t rootFile2 = MakeCacheableFile(RootDevno(), 222);
+  es_file_t nonrootFile = MakeCacheableFile(RootDevno() + 123, 333);
+
+  cache->AddToCache(&rootFile1, SNTActionRequestBinary);
+  cache->AddToCache(&rootFile2, SNTActionRequestBinary);
+  cache->AddToCache(&nonrootFile, SNTActionRequestBinary);
+  cache->AddToCache(&rootFile1, SNTActionRespondAllow);
+  cache->AddToCache(&rootFile2, SNTActionRespondAllow);
+  cache->AddToCache(&nonrootFile, SNTActionRespondAllow);
+  AssertCacheCounts(cache, 2, 1);
+
+  cache->InvalidateEntries(FlushCacheReason::kRulesChanged, ^BOOL(SantaVnode vnode) {
+    return vnode.fileid == 222 || vnode.fileid == 333;
+  });
+
+  AssertCacheCounts(cache, 1, 0);
+  XCTAssertEqual(cache->CheckCache(&rootFile1).action, SNTActionRespondAllow);
+  XCTAssertEqual(cache->CheckCache(&rootFile2).action, SNTActionUnset);
+  XCTAssertEqual(cache->CheckCache(&nonrootFile).action, SNTActionUnset);
+
+  // The ES cache cannot be partially invalidated and must still be cleared
+  XCTAssertEqual(0,
+                 dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+                 "ClearCache wasn't called within expected time window");
+}
+
 - (void)testCacheStateMachine {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(mockESApi, nil);
@@ -273,30 +357,141 @@ static inline void AssertCacheCounts(std::shared_ptr<AuthResultCache> cache, uin
   // CheckCache returns AllowNoCache with the cached decision
   santa::CachedAuthResult entry = cache->CheckCache(&rootFile);
   XCTAssertEqual(entry.action, SNTActionRespondAllowNoCache);
-  XCTAssertNotNil(entry.cached_decision);
-  XCTAssertEqualObjects(entry.cached_decision.sha256, @"abc123");
-  XCTAssertEqualObjects(entry.cached_decision.certSHA256, @"cert456");
+  XCTAssertTrue(entry.cached_decision != nullptr);
+  XCTAssertEqualObjects(entry.cached_decision->SHA256(), @"abc123");
+  XCTAssertEqualObjects(entry.cached_decision->CertSHA256(), @"cert456");
 
   // RemoveFromCache clears the decision
   cache->RemoveFromCache(&rootFile);
   entry = cache->CheckCache(&rootFile);
   XCTAssertEqual(entry.action, SNTActionUnset);
-  XCTAssertNil(entry.cached_decision);
+  XCTAssertTrue(entry.cached_decision == nullptr);
 
   // FlushCache also clears decisions
   XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRequestBinary));
   XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRespondAllowNoCache, cd));
-  XCTAssertNotNil(cache->CheckCache(&rootFile).cached_decision);
+  XCTAssertTrue(cache->CheckCache(&rootFile).cached_decision != nullptr);
 
   cache->FlushCache(FlushCacheMode::kAllCaches, FlushCacheReason::kRulesChanged);
-  XCTAssertNil(cache->CheckCache(&rootFile).cached_decision);
+  XCTAssertTrue(cache->CheckCache(&rootFile).cached_decision == nullptr);
+}
+
+- (void)testLockFreeReads {
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache =
+      AuthResultCache::Create(esapi, nil, AuthResultCacheTTLs{}, /*lock_free_reads=*/true);
+
+  es_file_t rootFile = MakeCacheableFile(RootDevno(), 111);
+  es_file_t nonrootFile = MakeCacheableFile(RootDevno() + 123, 222);
+
+  // State transitions behave the same as the locked caches
+  XCTAssertFalse(cache->AddToCache(&rootFile, SNTActionRespondAllow));
+  XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRequestBinary));
+  XCTAssertFalse(cache->AddToCache(&rootFile, SNTActionRequestBinary));
+  XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRespondAllow));
+  XCTAssertTrue(cache->AddToCache(&nonrootFile, SNTActionRequestBinary));
+
+  AssertCacheCounts(cache, 1, 1);
+  XCTAssertEqual(cache->CheckCache(&rootFile).action, SNTActionRespondAllow);
+  XCTAssertEqual(cache->CheckCache(&nonrootFile).action, SNTActionRequestBinary);
+
+  // Decisions attached to AllowNoCache entries are retained
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.sha256 = @"abc123";
+  XCTAssertTrue(cache->AddToCache(&nonrootFile, SNTActionRespondAllowNoCache, cd));
+  santa::CachedAuthResult entry = cache->CheckCache(&nonrootFile);
+  XCTAssertEqual(entry.action, SNTActionRespondAllowNoCache);
+  XCTAssertEqualObjects(entry.cached_decision->SHA256(), @"abc123");
+
+  cache->RemoveFromCache(&nonrootFile);
+  entry = cache->CheckCache(&nonrootFile);
+  XCTAssertEqual(entry.action, SNTActionUnset);
+  XCTAssertTrue(entry.cached_decision == nullptr);
+
+  XCTAssertTrue(cache->AddToCache(&nonrootFile, SNTActionRequestBinary));
+  cache->FlushCache(FlushCacheMode::kNonRootOnly, FlushCacheReason::kClientModeChanged);
+  AssertCacheCounts(cache, 1, 0);
+
+  cache->FlushCache(FlushCacheMode::kAllCaches, FlushCacheReason::kClientModeChanged);
+  AssertCacheCounts(cache, 0, 0);
+  XCTAssertEqual(cache->CheckCache(&rootFile).action, SNTActionUnset);
+}
+
+- (void)testSnapshotSaveAndRestore {
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+
+  NSString* dir = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+  XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:dir
+                                          withIntermediateDirectories:YES
+                                                           attributes:nil
+                                                                error:nil]);
+  NSString* snapshotPath = [dir stringByAppendingPathComponent:@"snapshot"];
+
+  std::vector<es_file_t> files;
+  for (NSString* name in @[ @"allowed", @"modified", @"denied" ]) {
+    NSString* path = [dir stringByAppendingPathComponent:name];
+    XCTAssertTrue([[name dataUsingEncoding:NSUTF8StringEncoding] writeToFile:path atomically:NO]);
+    struct stat sb;
+    XCTAssertEqual(stat(path.UTF8String, &sb), 0);
+    files.push_back(MakeCacheableFile(sb.st_dev, sb.st_ino));
+  }
+
+  for (es_file_t& file : files) {
+    XCTAssertTrue(cache->AddToCache(&file, SNTActionRequestBinary));
+  }
+  XCTAssertTrue(cache->AddToCache(&files[0], SNTActionRespondAllow));
+  XCTAssertTrue(cache->AddToCache(&files[1], SNTActionRespondAllow));
+  XCTAssertTrue(cache->AddToCache(&files[2], SNTActionRespondDeny));
+
+  XCTAssertTrue(cache->SaveSnapshot(snapshotPath, @"gen1"));
+
+  // A mismatched policy generation discards the snapshot
+  std::shared_ptr<AuthResultCache> restored = AuthResultCache::Create(esapi, nil);
+  XCTAssertEqual(restored->RestoreSnapshot(snapshotPath, @"gen2"), 0);
+  XCTAssertEqual(restored->CheckCache(&files[0]).action, SNTActionUnset);
+
+  // Only allowed entries are restored
+  restored = AuthResultCache::Create(esapi, nil);
+  XCTAssertEqual(restored->RestoreSnapshot(snapshotPath, @"gen1"), 2);
+  XCTAssertEqual(restored->CheckCache(&files[0]).action, SNTActionRespondAllow);
+  XCTAssertEqual(restored->CheckCache(&files[1]).action, SNTActionRespondAllow);
+  XCTAssertEqual(restored->CheckCache(&files[2]).action, SNTActionUnset);
+
+  // Files modified since the snapshot was taken are skipped
+  NSFileHandle* fh =
+      [NSFileHandle fileHandleForWritingAtPath:[dir stringByAppendingPathComponent:@"modified"]];
+  [fh seekToEndOfFile];
+  [fh writeData:[@"more" dataUsingEncoding:NSUTF8StringEncoding]];
+  [fh closeFile];
+
+  restored = AuthResultCache::Create(esapi, nil);
+  XCTAssertEqual(restored->RestoreSnapshot(snapshotPath, @"gen1"), 1);
+  XCTAssertEqual(restored->CheckCache(&files[0]).action, SNTActionRespondAllow);
+  XCTAssertEqual(restored->CheckCache(&files[1]).action, SNTActionUnset);
+
+  // Existing entries are not replaced
+  restored = AuthResultCache::Create(esapi, nil);
+  XCTAssertTrue(restored->AddToCache(&files[0], SNTActionRequestBinary));
+  XCTAssertEqual(restored->RestoreSnapshot(snapshotPath, @"gen1"), 0);
+  XCTAssertEqual(restored->CheckCache(&files[0]).action, SNTActionRequestBinary);
+
+  // Malformed snapshots are ignored
+  XCTAssertTrue([[@"garbage" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:snapshotPath
+                                                                       atomically:NO]);
+  restored = AuthResultCache::Create(esapi, nil);
+  XCTAssertEqual(restored->RestoreSnapshot(snapshotPath, @"gen1"), 0);
+
+  [[NSFileManager defaultManager] removeItemAtPath:dir error:nil];
 }
 
 - (void)testCacheExpiry {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   // Create a cache with a lowered cache expiry value
   uint64_t expiryMS = 250;
-  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(mockESApi, nil, expiryMS);
+  std::shared_ptr<AuthResultCache> cache =
+      AuthResultCache::Create(mockESApi, nil, AuthResultCacheTTLs{.deny_ms = expiryMS});
 
   es_file_t rootFile = MakeCacheableFile(RootDevno(), 111);
 
@@ -316,6 +511,68 @@ static inline void AssertCacheCounts(std::shared_ptr<AuthResultCache> cache, uin
   // Now check the cache, which will remove the item
   XCTAssertEqual(cache->CheckCache(&rootFile).action, SNTActionUnset);
   AssertCacheCounts(cache, 0, 0);
+  XCTAssertEqual(cache->ExpirationCounts()[0], 1);
+}
+
+- (void)testAllowExpiryByRuleType {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  uint64_t expiryMS = 250;
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(
+      mockESApi, nil, AuthResultCacheTTLs{.allow_team_id_ms = expiryMS});
+
+  es_file_t binaryFile = MakeCacheableFile(RootDevno(), 111);
+  es_file_t teamIDFile = MakeCacheableFile(RootDevno(), 222);
+
+  SNTCachedDecision* binaryDecision = [[SNTCachedDecision alloc] init];
+  binaryDecision.decision = SNTEventStateAllowBinary;
+  SNTCachedDecision* teamIDDecision = [[SNTCachedDecision alloc] init];
+  teamIDDecision.decision = SNTEventStateAllowTeamID;
+
+  XCTAssertTrue(cache->AddToCache(&binaryFile, SNTActionRequestBinary));
+  XCTAssertTrue(cache->AddToCache(&binaryFile, SNTActionRespondAllow, binaryDecision));
+  XCTAssertTrue(cache->AddToCache(&teamIDFile, SNTActionRequestBinary));
+  XCTAssertTrue(cache->AddToCache(&teamIDFile, SNTActionRespondAllow, teamIDDecision));
+
+  SleepMS(expiryMS);
+
+  // Only the team ID allow expires, binary allows keep the default of never
+  XCTAssertEqual(cache->CheckCache(&binaryFile).action, SNTActionRespondAllow);
+  XCTAssertEqual(cache->CheckCache(&teamIDFile).action, SNTActionUnset);
+  XCTAssertEqual(cache->ExpirationCounts()[1], 1);
+  AssertCacheCounts(cache, 1, 0);
+}
+
+- (void)testAdaptiveDenyExpiry {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  uint64_t expiryMS = 100;
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(
+      mockESApi, nil, AuthResultCacheTTLs{.deny_ms = expiryMS, .max_deny_ms = expiryMS * 4});
+
+  es_file_t rootFile = MakeCacheableFile(RootDevno(), 111);
+
+  auto deny = ^{
+    XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRequestBinary));
+    XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRespondDeny));
+  };
+
+  // The first deny uses the base lifetime
+  deny();
+  SleepMS(expiryMS);
+  XCTAssertEqual(cache->CheckCache(&rootFile).action, SNTActionUnset);
+
+  // A repeat deny lives twice as long
+  deny();
+  SleepMS(expiryMS);
+  XCTAssertEqual(cache->CheckCache(&rootFile).action, SNTActionRespondDeny);
+  SleepMS(expiryMS);
+  XCTAssertEqual(cache->CheckCache(&rootFile).action, SNTActionUnset);
+
+  // Any flush forgets earlier denies
+  cache->FlushCache(FlushCacheMode::kNonRootOnly, FlushCacheReason::kClientModeChanged);
+  deny();
+  SleepMS(expiryMS);
+  XCTAssertEqual(cache->CheckCache(&rootFile).action, SNTActionUnset);
+  XCTAssertEqual(cache->ExpirationCounts()[0], 3);
 }
 
 - (void)testFlushCacheReasonToString {
@@ -329,6 +586,7 @@ static inline void AssertCacheCounts(std::shared_ptr<AuthResultCache> cache, uin
       {FlushCacheReason::kEntitlementsPrefixFilterChanged, @"EntitlementsPrefixFilterChanged"},
       {FlushCacheReason::kEntitlementsTeamIDFilterChanged, @"EntitlementsTeamIDFilterChanged"},
       {FlushCacheReason::kCELFallbackRulesChanged, @"CELFallbackRulesChanged"},
+      {FlushCacheReason::kMemoryPressure, @"MemoryPressure"},
   };
 
   for (const auto& kv : reasonToString) {
@@ -336,7 +594,7 @@ static inline void AssertCacheCounts(std::shared_ptr<AuthResultCache> cache, uin
   }
 
   XCTAssertThrows(FlushCacheReasonToString(
-      (FlushCacheReason)(static_cast<int>(FlushCacheReason::kCELFallbackRulesChanged) + 1)));
+      (FlushCacheReason)(static_cast<int>(FlushCacheReason::kMemoryPressure) + 1)));
 }
 
 @end
@@ -19,6 +19,8 @@
 #include <dispatch/dispatch.h>
 #include <sys/stat.h>
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <tuple>
@@ -65,7 +67,8 @@ class FAAPolicyProcessor {
     bool cacheable;
   };
 
-  using TargetPolicyPair = std::pair<size_t, std::optional<std::shared_ptr<WatchItemPolicyBase>>>;
+  using TargetPolicyPair = santa::TargetPolicyPair;
+  using TargetPolicyPairs = santa::TargetPolicyPairs;
 
   /// When this block is called, the policy enforcement client must determine
   /// whether or not the given policy applies to the given ES message.
@@ -75,9 +78,14 @@ class FAAPolicyProcessor {
   /// A block that generates custom URL and Text pairs from a given policy.
   using GenerateEventDetailLinkBlock =
       URLTextPair (^)(const std::shared_ptr<WatchItemPolicyBase>& watch_item);
+  /// A block that returns the link info for a denied access, generating it on first use.
+  using LazyLinkInfoBlock = URLTextPair (^)(void);
 
   using ReadsCacheKey = std::tuple<pid_t, int, FAAClientType>;
+  // The file's dev/ino and the policy generation that allowed reading it
+  using ReadsCacheValue = std::tuple<dev_t, ino_t, uint64_t>;
   using StoreAccessEventBlock = void (^)(SNTStoredFileAccessEvent*, bool);
+  using CDHash = std::array<uint8_t, CS_CDHASH_LEN>;
 
   // Friend classes that can call private methods requiring FAAClientType parameters
   friend class DataFAAPolicyProcessorProxy;
@@ -102,6 +110,26 @@ class FAAPolicyProcessor {
 
   virtual void ModifyRateLimiterSettings(uint32_t logs_per_sec, uint32_t window_size_sec);
 
+  /// Called when the policy changes. Cached read decisions made under an
+  /// earlier generation are no longer used and are dropped as room is needed.
+  void SetPolicyGeneration(uint64_t generation);
+
+  // Telemetry that doesn't affect a decision is done off of the AUTH path.
+  // Once this many items are pending, new ones are dropped.
+  static constexpr int64_t kMaxPendingTelemetry = 4096;
+
+  // Number of background telemetry items pending and the number dropped
+  // since the last reset because the pipeline was full.
+  struct TelemetryStats {
+    int64_t depth;
+    uint64_t dropped;
+  };
+
+  TelemetryStats GetTelemetryStats(bool reset);
+
+  /// Wait for all pending background telemetry. Returns false on timeout.
+  bool DrainTelemetry(uint64_t timeout_nanos);
+
  private:
   SNTDecisionCache* decision_cache_;
   std::shared_ptr<Enricher> enricher_;
@@ -110,16 +138,30 @@ class FAAPolicyProcessor {
   std::shared_ptr<Metrics> metrics_;
   GenerateEventDetailLinkBlock generate_event_detail_link_block_;
   StoreAccessEventBlock store_access_event_block_;
-  santa::SantaSetCache<ReadsCacheKey, std::pair<dev_t, ino_t>> reads_cache_;
+  santa::SantaSetCache<ReadsCacheKey, ReadsCacheValue> reads_cache_;
+  std::atomic<uint64_t> policy_generation_{0};
+  std::atomic<uint64_t> reads_cache_lookups_{0};
+  std::atomic<uint64_t> reads_cache_hits_{0};
   santa::SantaSetCache<std::pair<pid_t, int>, std::pair<std::string, std::string>>
       tty_message_cache_;
-  SantaCache<SantaVnode, NSString*> cert_hash_cache_;
-  SNTConfigurator* configurator_;
+  SantaCache<SantaVnode, NSString*, absl::Hash<SantaVnode>, SantaCacheLayout::kOpenAddressed>
+      cert_hash_cache_;
+  SantaCache<CDHash, NSString*, absl::Hash<CDHash>, SantaCacheLayout::kOpenAddressed>
+      cdhash_cert_hash_cache_;
   dispatch_queue_t queue_;
+  dispatch_group_t telemetry_group_;
+  std::atomic<int64_t> telemetry_depth_{0};
+  std::atomic<uint64_t> telemetry_dropped_{0};
   RateLimiter rate_limiter_;
 
   virtual NSString* __strong GetCertificateHash(const es_file_t* es_file);
 
+  /// Returns the leaf certificate hash of a running process. For CS_VALID
+  /// processes this is read from the kernel's copy of the code signature and
+  /// cached by CDHash, otherwise it falls back to GetCertificateHash for the
+  /// executable.
+  NSString* __strong GetProcessCertificateHash(const es_process_t* es_proc);
+
   /// General flow of processing an ES message for FAA violations:
   /// 1. Client presents a vector of pairs of target paths being accessed and associated policies
   /// 2. Iterate each pair and compute a FileAccessPolicyDecision (ProcessTargetAndPolicy())
@@ -137,7 +179,7 @@ class FAAPolicyProcessor {
   /// 3. Combine results of each target into an ES decision
   /// 4. Return the final ES decision
   FAAPolicyProcessor::ESResult ProcessMessage(
-      const Message& msg, std::vector<TargetPolicyPair> target_policy_pairs,
+      const Message& msg, TargetPolicyPairs target_policy_pairs,
       CheckIfPolicyMatchesBlock check_if_policy_matches_block,
       SNTFileAccessDeniedBlock file_access_denied_block, SNTOverrideFileAccessAction overrideAction,
       FAAClientType client_type);
@@ -149,6 +191,11 @@ class FAAPolicyProcessor {
   /// Used by callers to inform when a process has exited and will no longer process events.
   void NotifyExit(const audit_token_t& tok, FAAClientType client_type);
 
+  /// Grow the per-process reads cache capacity when processes read enough
+  /// distinct files to overflow it while hits are common, and shrink it when
+  /// hits are rare.
+  void ResizeReadsCache();
+
   FileAccessPolicyDecision ProcessTargetAndPolicy(
       const Message& msg, const TargetPolicyPair& target_policy_pair,
       CheckIfPolicyMatchesBlock checkIfPolicyMatchesBlock,
@@ -169,7 +216,16 @@ class FAAPolicyProcessor {
 
   void LogTelemetry(const WatchItemPolicyBase& policy, const Message& msg, size_t target_index,
                     FileAccessPolicyDecision decision);
-  void LogTTY(SNTStoredFileAccessEvent* event, URLTextPair link_info, const Message& msg,
+
+  /// Run `block` on the background telemetry queue unless too many items are
+  /// already pending. Returns false if the block was dropped.
+  bool DispatchTelemetry(void (^block)(void));
+
+  SNTStoredFileAccessEvent* MakeStoredAccessEvent(const Message& msg,
+                                                  const Message::PathTarget& target,
+                                                  const WatchItemPolicyBase& policy,
+                                                  FileAccessPolicyDecision decision);
+  void LogTTY(SNTStoredFileAccessEvent* event, LazyLinkInfoBlock link_info, const Message& msg,
               const WatchItemPolicyBase& policy);
 };
 
@@ -192,7 +248,7 @@ class ProcessFAAPolicyProcessorProxy : public FAAPolicyProcessorProxy {
   ProcessFAAPolicyProcessorProxy(std::shared_ptr<FAAPolicyProcessor> policy_processor)
       : FAAPolicyProcessorProxy(std::move(policy_processor)) {}
   FAAPolicyProcessor::ESResult ProcessMessage(
-      const Message& msg, std::vector<FAAPolicyProcessor::TargetPolicyPair> target_policy_pairs,
+      const Message& msg, FAAPolicyProcessor::TargetPolicyPairs target_policy_pairs,
       FAAPolicyProcessor::CheckIfPolicyMatchesBlock check_if_policy_matches_block,
       SNTFileAccessDeniedBlock file_access_denied_block,
       SNTOverrideFileAccessAction overrideAction) {
@@ -205,6 +261,11 @@ class ProcessFAAPolicyProcessorProxy : public FAAPolicyProcessorProxy {
     return policy_processor_->ImmediateResponse(msg, FAAClientType::kProcess);
   }
 
+  /// Used to look up policies for processes indexed by certificate hash.
+  NSString* CertificateHash(const es_process_t* es_proc) {
+    return policy_processor_->GetProcessCertificateHash(es_proc);
+  }
+
   void NotifyExit(const audit_token_t& tok) {
     return policy_processor_->NotifyExit(tok, FAAClientType::kProcess);
   }
@@ -216,7 +277,7 @@ class DataFAAPolicyProcessorProxy : public FAAPolicyProcessorProxy {
       : FAAPolicyProcessorProxy(std::move(policy_processor)) {}
 
   FAAPolicyProcessor::ESResult ProcessMessage(
-      const Message& msg, std::vector<FAAPolicyProcessor::TargetPolicyPair> target_policy_pairs,
+      const Message& msg, FAAPolicyProcessor::TargetPolicyPairs target_policy_pairs,
       FAAPolicyProcessor::CheckIfPolicyMatchesBlock check_if_policy_matches_block,
       SNTFileAccessDeniedBlock file_access_denied_block,
       SNTOverrideFileAccessAction overrideAction) {
@@ -14,9 +14,14 @@
 
 #include "Source/santad/EventProviders/FAAPolicyProcessor.h"
 
+#include <CommonCrypto/CommonDigest.h>
 #include <bsm/libbsm.h>
 #include <pwd.h>
 
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
 #include "Source/common/AuditUtilities.h"
 #include "Source/common/BranchPrediction.h"
 #import "Source/common/MOLCertificate.h"
@@ -26,6 +31,9 @@
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTStoredFileAccessEvent.h"
 #include "Source/common/String.h"
+#include "Source/common/verifyinghasher/KernelCsBlob.h"
+#include "Source/santad/ConfigSnapshot.h"
+#include "absl/hash/hash.h"
 #include "Source/common/es/EnrichedTypes.h"
 
 // Terminal value that will never match a valid cert hash.
@@ -41,6 +49,18 @@ namespace santa {
 static constexpr size_t kNumProcesses = 2048;
 static constexpr size_t kPerProcessSetCapacity = 128;
 
+// Bound on the total number of values held across all processes in each
+// cache, independent of how far the adaptive per-process capacity grows
+static constexpr size_t kMaxCachedValues = 65536;
+
+// Bounds and cadence for resizing the per-process reads_cache_ capacity based
+// on its observed hit rate
+static constexpr size_t kMinPerProcessReadsCapacity = 32;
+static constexpr size_t kMaxPerProcessReadsCapacity = 1024;
+static constexpr uint64_t kReadsCacheResizeWindow = 8192;
+static constexpr double kReadsCacheGrowHitRate = 0.5;
+static constexpr double kReadsCacheShrinkHitRate = 0.1;
+
 // Files larger than this threshold are not hashed on the AUTH path; the
 // rehydrate is dispatched async so future events pick up the populated
 // decision cache entry. SHA-256 throughput on Apple silicon is roughly
@@ -141,12 +161,39 @@ FAAPolicyProcessor::FAAPolicyProcessor(
       metrics_(std::move(metrics)),
       generate_event_detail_link_block_(generate_event_detail_link_block),
       store_access_event_block_(store_access_event_block),
-      reads_cache_(kNumProcesses, kPerProcessSetCapacity),
-      tty_message_cache_(kNumProcesses, kPerProcessSetCapacity),
+      reads_cache_(kNumProcesses, kPerProcessSetCapacity, kMaxCachedValues),
+      tty_message_cache_(kNumProcesses, kPerProcessSetCapacity, kMaxCachedValues),
       rate_limiter_(
           RateLimiter::Create(metrics_, rate_limit_logs_per_sec, rate_limit_window_size_sec)) {
-  configurator_ = [SNTConfigurator configurator];
   queue_ = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+  telemetry_group_ = dispatch_group_create();
+}
+
+bool FAAPolicyProcessor::DispatchTelemetry(void (^block)(void)) {
+  if (telemetry_depth_.fetch_add(1, std::memory_order_relaxed) >= kMaxPendingTelemetry) {
+    telemetry_depth_.fetch_sub(1, std::memory_order_relaxed);
+    telemetry_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  dispatch_group_async(telemetry_group_, queue_, ^{
+    block();
+    telemetry_depth_.fetch_sub(1, std::memory_order_relaxed);
+  });
+  return true;
+}
+
+FAAPolicyProcessor::TelemetryStats FAAPolicyProcessor::GetTelemetryStats(bool reset) {
+  return TelemetryStats{
+      .depth = telemetry_depth_.load(std::memory_order_relaxed),
+      .dropped = reset ? telemetry_dropped_.exchange(0, std::memory_order_relaxed)
+                       : telemetry_dropped_.load(std::memory_order_relaxed),
+  };
+}
+
+bool FAAPolicyProcessor::DrainTelemetry(uint64_t timeout_nanos) {
+  return dispatch_group_wait(telemetry_group_, dispatch_time(DISPATCH_TIME_NOW, timeout_nanos)) ==
+         0;
 }
 
 void FAAPolicyProcessor::ModifyRateLimiterSettings(uint32_t logs_per_sec,
@@ -154,6 +201,10 @@ void FAAPolicyProcessor::ModifyRateLimiterSettings(uint32_t logs_per_sec,
   rate_limiter_.ModifySettings(logs_per_sec, window_size_sec);
 }
 
+void FAAPolicyProcessor::SetPolicyGeneration(uint64_t generation) {
+  policy_generation_.store(generation, std::memory_order_release);
+}
+
 NSString* FAAPolicyProcessor::GetCertificateHash(const es_file_t* es_file) {
   SantaVnode vnodeID = SantaVnode::VnodeForFile(es_file);
 
@@ -216,6 +267,42 @@ NSString* FAAPolicyProcessor::GetCertificateHash(const es_file_t* es_file) {
   return result;
 }
 
+NSString* FAAPolicyProcessor::GetProcessCertificateHash(const es_process_t* es_proc) {
+  // The kernel only keeps a validated code signature for CS_VALID processes.
+  // Anything else takes the file based path in GetCertificateHash.
+  if ((es_proc->codesigning_flags & (CS_SIGNED | CS_VALID)) != (CS_SIGNED | CS_VALID)) {
+    return GetCertificateHash(es_proc->executable);
+  }
+
+  CDHash cdhash;
+  std::memcpy(cdhash.data(), es_proc->cdhash, cdhash.size());
+  NSString* cached = cdhash_cert_hash_cache_.get(cdhash);
+  if (cached) return cached;
+
+  // The leaf certificate is in the CMS blob the kernel validated at exec
+  // time, so reading it is one csops call instead of a fresh code signing
+  // check of the file on disk.
+  KernelCsBlob::Result r = KernelCsBlob::FetchLeafCertificate(es_proc->audit_token, 0);
+  NSString* result;
+  if (r.status == KernelCsBlob::Status::kOk) {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(r.leaf_certificate_der->data(), (CC_LONG)r.leaf_certificate_der->size(), digest);
+    result = @(BufToHexString(digest, sizeof(digest)).c_str());
+  } else if (r.status == KernelCsBlob::Status::kNoCmsSignature) {
+    // Ad-hoc signed, there is no certificate
+    result = kBadCertHash;
+  } else {
+    // Don't cache failures to read the blob (e.g. the process already
+    // exited), the file based path can still answer.
+    LOGD(@"FAA GetProcessCertificateHash: falling back for %s: %s",
+         es_proc->executable->path.data, r.last_error.c_str());
+    return GetCertificateHash(es_proc->executable);
+  }
+
+  cdhash_cert_hash_cache_.set(cdhash, result);
+  return result;
+}
+
 /// An `es_process_t` must match all criteria within the given
 /// WatchItemProcess to be considered a match.
 bool FAAPolicyProcessor::PolicyMatchesProcess(const WatchItemProcess& policy_proc,
@@ -282,7 +369,7 @@ bool FAAPolicyProcessor::PolicyMatchesProcess(const WatchItemProcess& policy_pro
 
     // Check if the instigating process has an allowed certificate hash
     if (!policy_proc.certificate_sha256.empty()) {
-      NSString* result = GetCertificateHash(es_proc->executable);
+      NSString* result = GetProcessCertificateHash(es_proc);
       if (!result || policy_proc.certificate_sha256 != [result UTF8String]) {
         return false;
       }
@@ -359,7 +446,7 @@ FileAccessPolicyDecision FAAPolicyProcessor::ApplyPolicy(
 
   // If the process is signed but has an invalid signature, it is denied
   if (((msg->process->codesigning_flags & (CS_SIGNED | CS_VALID)) == CS_SIGNED) &&
-      [configurator_ enableBadSignatureProtection]) {
+      ConfigSnapshot::Current()->enable_bad_signature_protection) {
     // TODO(mlw): Think about how to make stronger guarantees here to handle
     // programs becoming invalid after first being granted access. Maybe we
     // should only allow things that have hardened runtime flags set?
@@ -405,7 +492,12 @@ FileAccessPolicyDecision FAAPolicyProcessor::ApplyPolicy(
 
 void FAAPolicyProcessor::LogTelemetry(const WatchItemPolicyBase& policy, const Message& msg,
                                       size_t target_index, FileAccessPolicyDecision decision) {
-  RateLimiter::Decision rate_limit_decision = rate_limiter_.Decide(msg->mach_time);
+  // Each policy and event type gets its own share of the log budget so that
+  // one noisy watch item can't starve the rest
+  uint64_t rate_limit_key = absl::Hash<std::pair<std::string_view, es_event_type_t>>{}(
+      {policy.name, msg->event_type});
+  RateLimiter::Decision rate_limit_decision =
+      rate_limiter_.Decide(msg->mach_time, rate_limit_key);
   if (likely(metrics_)) {
     metrics_->SetFileAccessEventMetrics(policy.version, policy.name,
                                         (rate_limit_decision == RateLimiter::Decision::kAllowed)
@@ -431,7 +523,7 @@ void FAAPolicyProcessor::LogTelemetry(const WatchItemPolicyBase& policy, const M
   int64_t rule_id = policy.rule_id;
   __block Message msg_copy(msg);
 
-  dispatch_async(queue_, ^{
+  DispatchTelemetry(^{
     Message moved_in_msg = std::move(msg_copy);
     const Message::PathTarget& target = moved_in_msg.PathTargetAtIndex(target_index);
     EnrichedProcess enriched_proc =
@@ -450,15 +542,10 @@ bool FAAPolicyProcessor::HaveMessagedTTYForPolicy(const WatchItemPolicyBase& pol
                                  {policy.version, policy.name});
 }
 
-void FAAPolicyProcessor::LogTTY(SNTStoredFileAccessEvent* event, URLTextPair link_info,
-                                const Message& msg, const WatchItemPolicyBase& policy) {
-  if (HaveMessagedTTYForPolicy(policy, msg)) {
-    return;
-  }
-
-  NSAttributedString* attrStr = [SNTBlockMessage
-      attributedBlockMessageForFileAccessEvent:event
-                                 customMessage:OptionalStringToNSString(policy.custom_message)];
+static NSString* TTYMessageForAccess(SNTStoredFileAccessEvent* event, NSString* custom_message,
+                                     NSString* custom_url, const Message& msg) {
+  NSAttributedString* attrStr =
+      [SNTBlockMessage attributedBlockMessageForFileAccessEvent:event customMessage:custom_message];
 
   NSMutableString* blockMsg = [NSMutableString stringWithCapacity:1024];
   // Escape sequences `\033[1m` and `\033[0m` begin/end bold lettering
@@ -475,12 +562,73 @@ void FAAPolicyProcessor::LogTTY(SNTStoredFileAccessEvent* event, URLTextPair lin
                          StringToNSString(msg.ParentProcessName())];
 
   NSURL* detailURL = [SNTBlockMessage eventDetailURLForFileAccessEvent:event
-                                                             customURL:link_info.first];
+                                                             customURL:custom_url];
   if (detailURL) {
     [blockMsg appendFormat:@"More info:\n%@\n", detailURL.absoluteString];
   }
 
-  tty_writer_->WriteWithoutSignal(msg->process, blockMsg);
+  return blockMsg;
+}
+
+void FAAPolicyProcessor::LogTTY(SNTStoredFileAccessEvent* event, LazyLinkInfoBlock link_info,
+                                const Message& msg, const WatchItemPolicyBase& policy) {
+  if (HaveMessagedTTYForPolicy(policy, msg)) {
+    return;
+  }
+
+  // The message is only built if the writer isn't in silent mode. The block
+  // runs before WriteWithoutSignal returns, so referencing msg is safe.
+  const Message* msg_ptr = &msg;
+  NSString* custom_message = OptionalStringToNSString(policy.custom_message);
+  tty_writer_->WriteWithoutSignal(msg->process, ^NSString* {
+    return TTYMessageForAccess(event, custom_message, link_info().first, *msg_ptr);
+  });
+}
+
+SNTStoredFileAccessEvent* FAAPolicyProcessor::MakeStoredAccessEvent(
+    const Message& msg, const Message::PathTarget& target, const WatchItemPolicyBase& policy,
+    FileAccessPolicyDecision decision) {
+  SNTCachedDecision* cd = GetCachedDecision(msg->process->executable->stat);
+  if (unlikely(!cd.sha256)) {
+    NSError* err;
+    SNTFileInfo* fi = [[SNTFileInfo alloc] initWithEndpointSecurityFile:msg->process->executable
+                                                                  error:&err];
+    if (fi) {
+      if (fi.fileSize <= kMaxSyncRehydrateBytes) {
+        SNTCachedDecision* rehydrated = [decision_cache_ rehydrateAndCacheDecisionForFileInfo:fi];
+        if (rehydrated) cd = rehydrated;
+      } else {
+        [decision_cache_ asyncRehydrateAndCacheDecisionForFileInfo:fi];
+      }
+    } else {
+      LOGD(@"FAA rehydrate: SNTFileInfo init failed for %s: %@",
+           msg->process->executable->path.data, err.localizedDescription);
+    }
+  }
+
+  SNTStoredFileAccessEvent* event = [[SNTStoredFileAccessEvent alloc] init];
+  event.accessedPath = StringToNSString(target.Path());
+  event.ruleVersion = StringToNSString(policy.version);
+  event.ruleName = StringToNSString(policy.name);
+  event.ruleId = policy.rule_id;
+  event.decision = decision;
+  event.process.fileSHA256 = cd.sha256 ?: @"<unknown sha>";
+  event.process.filePath = StringToNSString(msg->process->executable->path.data);
+  event.process.teamID = StringTokenToNSString(msg->process->team_id);
+  event.process.signingID = StringTokenToNSString(msg->process->signing_id);
+  event.process.cdhash =
+      (msg->process->codesigning_flags & CS_SIGNED)
+          ? StringToNSString(BufToHexString(msg->process->cdhash, sizeof(msg->process->cdhash)))
+          : nil;
+  event.process.pid = @(audit_token_to_pid(msg->process->audit_token));
+  event.process.signingChain = cd.certChain;
+  struct passwd* user = getpwuid(audit_token_to_ruid(msg->process->audit_token));
+  if (user) event.process.executingUser = @(user->pw_name);
+  event.process.parent = [[SNTStoredFileAccessProcess alloc] init];
+  event.process.parent.pid = @(audit_token_to_pid(msg->process->parent_audit_token));
+  event.process.parent.filePath = StringToNSString(msg.ParentProcessPath());
+
+  return event;
 }
 
 FileAccessPolicyDecision FAAPolicyProcessor::ProcessTargetAndPolicy(
@@ -508,64 +656,47 @@ FileAccessPolicyDecision FAAPolicyProcessor::ProcessTargetAndPolicy(
 
     LogTelemetry(*policy, msg, target_policy_pair.first, decision);
 
-    SNTCachedDecision* cd = GetCachedDecision(msg->process->executable->stat);
-    if (unlikely(!cd.sha256)) {
-      NSError* err;
-      SNTFileInfo* fi = [[SNTFileInfo alloc] initWithEndpointSecurityFile:msg->process->executable
-                                                                    error:&err];
-      if (fi) {
-        if (fi.fileSize <= kMaxSyncRehydrateBytes) {
-          SNTCachedDecision* rehydrated = [decision_cache_ rehydrateAndCacheDecisionForFileInfo:fi];
-          if (rehydrated) cd = rehydrated;
-        } else {
-          [decision_cache_ asyncRehydrateAndCacheDecisionForFileInfo:fi];
+    if (!IsBlockDecision(decision)) {
+      // Nothing left to do affects the response, so build and store the
+      // event in the background rather than delaying the file operation.
+      __block Message msg_copy(msg);
+      size_t target_index = target_policy_pair.first;
+      DispatchTelemetry(^{
+        Message moved_in_msg = std::move(msg_copy);
+        SNTStoredFileAccessEvent* event = MakeStoredAccessEvent(
+            moved_in_msg, moved_in_msg.PathTargetAtIndex(target_index), *policy, decision);
+        if (store_access_event_block_) {
+          store_access_event_block_(event, false);
         }
-      } else {
-        LOGD(@"FAA rehydrate: SNTFileInfo init failed for %s: %@",
-             msg->process->executable->path.data, err.localizedDescription);
-      }
-    }
-    SNTStoredFileAccessEvent* event = [[SNTStoredFileAccessEvent alloc] init];
-
-    event.accessedPath = StringToNSString(target.Path());
-    event.ruleVersion = StringToNSString(policy->version);
-    event.ruleName = StringToNSString(policy->name);
-    event.ruleId = policy->rule_id;
-    event.decision = decision;
-    event.process.fileSHA256 = cd.sha256 ?: @"<unknown sha>";
-    event.process.filePath = StringToNSString(msg->process->executable->path.data);
-    event.process.teamID = StringTokenToNSString(msg->process->team_id);
-    event.process.signingID = StringTokenToNSString(msg->process->signing_id);
-    event.process.cdhash =
-        (msg->process->codesigning_flags & CS_SIGNED)
-            ? StringToNSString(BufToHexString(msg->process->cdhash, sizeof(msg->process->cdhash)))
-            : nil;
-    event.process.pid = @(audit_token_to_pid(msg->process->audit_token));
-    event.process.signingChain = cd.certChain;
-    struct passwd* user = getpwuid(audit_token_to_ruid(msg->process->audit_token));
-    if (user) event.process.executingUser = @(user->pw_name);
-    event.process.parent = [[SNTStoredFileAccessProcess alloc] init];
-    event.process.parent.pid = @(audit_token_to_pid(msg->process->parent_audit_token));
-    event.process.parent.filePath = StringToNSString(msg.ParentProcessPath());
-
-    URLTextPair link_info;
-    if (generate_event_detail_link_block_) {
-      link_info = generate_event_detail_link_block_(policy);
+      });
+      return decision;
     }
 
+    SNTStoredFileAccessEvent* event = MakeStoredAccessEvent(msg, target, *policy, decision);
+
+    // Generating link info requires a policy lookup, so defer it until the
+    // GUI or TTY actually needs it and share the result between them.
+    __block std::optional<URLTextPair> cached_link_info;
+    GenerateEventDetailLinkBlock generate_link_info = generate_event_detail_link_block_;
+    LazyLinkInfoBlock link_info = ^URLTextPair {
+      if (!cached_link_info.has_value()) {
+        cached_link_info = generate_link_info ? generate_link_info(policy) : URLTextPair{};
+      }
+      return *cached_link_info;
+    };
+
     if (store_access_event_block_) {
-      store_access_event_block_(event, IsBlockDecision(decision));
+      store_access_event_block_(event, true);
     }
 
-    if (IsBlockDecision(decision)) {
-      if (ShouldShowUIForPolicy(policy)) {
-        file_access_denied_block(event, OptionalStringToNSString(policy->custom_message),
-                                 link_info.first, link_info.second);
-      }
+    if (ShouldShowUIForPolicy(policy)) {
+      URLTextPair ui_link_info = link_info();
+      file_access_denied_block(event, OptionalStringToNSString(policy->custom_message),
+                               ui_link_info.first, ui_link_info.second);
+    }
 
-      if (ShouldMessageTTYForPolicy(policy, msg)) {
-        LogTTY(event, link_info, msg, *policy);
-      }
+    if (ShouldMessageTTYForPolicy(policy, msg)) {
+      LogTTY(event, link_info, msg, *policy);
     }
   }
 
@@ -578,12 +709,13 @@ static inline FAAPolicyProcessor::ReadsCacheKey MakeReadsCacheKey(const audit_to
 }
 
 FAAPolicyProcessor::ESResult FAAPolicyProcessor::ProcessMessage(
-    const Message& msg, std::vector<TargetPolicyPair> target_policy_pairs,
+    const Message& msg, TargetPolicyPairs target_policy_pairs,
     CheckIfPolicyMatchesBlock check_if_policy_matches_block,
     SNTFileAccessDeniedBlock file_access_denied_block, SNTOverrideFileAccessAction overrideAction,
     FAAClientType client_type) {
   es_auth_result_t policy_result = ES_AUTH_RESULT_ALLOW;
   bool cacheable = true;
+  uint64_t generation = policy_generation_.load(std::memory_order_acquire);
 
   for (const TargetPolicyPair& target_policy_pair : target_policy_pairs) {
     const Message::PathTarget& path_target = msg.PathTargetAtIndex(target_policy_pair.first);
@@ -595,15 +727,20 @@ FAAPolicyProcessor::ESResult FAAPolicyProcessor::ProcessMessage(
     //   2. The process wasn't invalid
     //   3. A devno/ino pair existed for the target
     //   4. The policy allowed read access
+    //   5. The policy didn't change while the message was processed
     // Note: As long as a policy allows read access, the caller's read cache can be updated
     // regardless of the RuleType of the policy.
     if (decision != FileAccessPolicyDecision::kNoPolicy &&
         decision != FileAccessPolicyDecision::kDeniedInvalidSignature && !path_target.truncated &&
         path_target.is_readable && path_target.unsafe_file &&
-        target_policy_pair.second.has_value() && (*target_policy_pair.second)->allow_read_access) {
+        target_policy_pair.second.has_value() && (*target_policy_pair.second)->allow_read_access &&
+        generation == policy_generation_.load(std::memory_order_acquire)) {
       reads_cache_.Set(MakeReadsCacheKey(msg->process->audit_token, client_type),
-                       std::pair<dev_t, ino_t>({path_target.unsafe_file->stat.st_dev,
-                                                path_target.unsafe_file->stat.st_ino}));
+                       ReadsCacheValue{path_target.unsafe_file->stat.st_dev,
+                                       path_target.unsafe_file->stat.st_ino, generation},
+                       [generation](const ReadsCacheValue& value) {
+                         return std::get<2>(value) != generation;
+                       });
     }
 
     policy_result =
@@ -631,17 +768,53 @@ std::optional<FAAPolicyProcessor::ESResult> FAAPolicyProcessor::ImmediateRespons
   // branch in ProcessTargetAndPolicy and fail closed per the configured
   // override action. This mirrors the !path_target.truncated guard on the
   // cache update in ProcessMessage.
-  if (msg->event_type == ES_EVENT_TYPE_AUTH_OPEN &&
-      !(msg->event.open.fflag & kOpenFlagsIndicatingWrite) &&
-      !msg->event.open.file->path_truncated &&
-      reads_cache_.Contains(MakeReadsCacheKey(msg->process->audit_token, client_type),
-                            std::pair<dev_t, ino_t>{msg->event.open.file->stat.st_dev,
-                                                    msg->event.open.file->stat.st_ino})) {
+  if (msg->event_type != ES_EVENT_TYPE_AUTH_OPEN ||
+      (msg->event.open.fflag & kOpenFlagsIndicatingWrite) ||
+      msg->event.open.file->path_truncated) {
+    return std::nullopt;
+  }
+
+  // Entries from an earlier policy generation don't match
+  bool hit = reads_cache_.Contains(
+      MakeReadsCacheKey(msg->process->audit_token, client_type),
+      ReadsCacheValue{msg->event.open.file->stat.st_dev, msg->event.open.file->stat.st_ino,
+                      policy_generation_.load(std::memory_order_acquire)});
+
+  if (hit) {
+    reads_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+  }
+  if ((reads_cache_lookups_.fetch_add(1, std::memory_order_relaxed) + 1) %
+          kReadsCacheResizeWindow ==
+      0) {
+    ResizeReadsCache();
+  }
+
+  if (hit) {
     return std::make_optional<FAAPolicyProcessor::ESResult>({ES_AUTH_RESULT_ALLOW, false});
   }
   return std::nullopt;
 }
 
+void FAAPolicyProcessor::ResizeReadsCache() {
+  double hit_rate =
+      (double)reads_cache_hits_.exchange(0, std::memory_order_relaxed) / kReadsCacheResizeWindow;
+  uint64_t overflows = reads_cache_.OverflowCount(true);
+  size_t capacity = reads_cache_.PerEntryCapacity();
+
+  size_t new_capacity = capacity;
+  if (hit_rate >= kReadsCacheGrowHitRate && overflows > 0) {
+    new_capacity = std::min(capacity * 2, kMaxPerProcessReadsCapacity);
+  } else if (hit_rate < kReadsCacheShrinkHitRate) {
+    new_capacity = std::max(capacity / 2, kMinPerProcessReadsCapacity);
+  }
+
+  if (new_capacity != capacity) {
+    LOGD(@"Resizing FAA reads cache per-process capacity %zu -> %zu (hit rate: %.2f)", capacity,
+         new_capacity, hit_rate);
+    reads_cache_.SetPerEntryCapacity(new_capacity);
+  }
+}
+
 void FAAPolicyProcessor::NotifyExit(const audit_token_t& tok, FAAClientType client_type) {
   reads_cache_.Remove(MakeReadsCacheKey(tok, client_type));
   tty_message_cache_.Remove(PidPidversion(tok));
@@ -548,6 +548,45 @@ static void ClearWatchItemPolicyProcess(WatchItemProcess& proc) {
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testReadsCacheIgnoresEarlierGenerations {
+  es_file_t esFile = MakeESFile("/proc/instigator");
+  es_process_t esProc = MakeESProcess(&esFile);
+  es_file_t targetFile = MakeESFile("/foo/bar", MakeStat(100));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_OPEN, &esProc);
+  esMsg.event.open.file = &targetFile;
+  esMsg.event.open.fflag = FREAD;
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+  Message msg(mockESApi, &esMsg);
+
+  MockFAAPolicyProcessor faaPolicyProcessor(self.dcMock, nullptr, nullptr, nullptr, nullptr, 0, 0,
+                                            nil, nil);
+  EXPECT_CALL(faaPolicyProcessor, ApplyPolicy)
+      .WillRepeatedly(testing::Return(FileAccessPolicyDecision::kAllowedReadAccess));
+
+  auto policy = std::make_shared<santa::DataWatchItemPolicy>(
+      "foo_rule", "v1", "/foo", santa::WatchItemPathType::kPrefix, true);
+  auto matcher = ^bool(const WatchItemPolicyBase&, const Message::PathTarget&, const Message&) {
+    return false;
+  };
+
+  // Nothing is cached until an allowed read is processed
+  XCTAssertFalse(faaPolicyProcessor.ImmediateResponseWrapper(msg).has_value());
+  faaPolicyProcessor.ProcessMessageWrapper(msg, {{0, policy}}, matcher, nil,
+                                           SNTOverrideFileAccessActionNone);
+  XCTAssertTrue(faaPolicyProcessor.ImmediateResponseWrapper(msg).has_value());
+
+  // Reads cached under an earlier policy are not reused
+  faaPolicyProcessor.SetPolicyGeneration(1);
+  XCTAssertFalse(faaPolicyProcessor.ImmediateResponseWrapper(msg).has_value());
+  faaPolicyProcessor.ProcessMessageWrapper(msg, {{0, policy}}, matcher, nil,
+                                           SNTOverrideFileAccessActionNone);
+  XCTAssertTrue(faaPolicyProcessor.ImmediateResponseWrapper(msg).has_value());
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
 - (void)testGetCertificateHash {
   // Note: MakeStat() produces a non-regular-file mode, so SNTFileInfo init
   // fails for these fixtures and step 3 (sync/async rehydrate) is bypassed.
@@ -914,6 +953,8 @@ static void ClearWatchItemPolicyProcess(WatchItemProcess& proc) {
   faaPolicyProcessor.ProcessTargetAndPolicyWrapper(msg, pair, matcher, deniedBlock,
                                                    SNTOverrideFileAccessActionNone);
 
+  // Audit-only events are stored off of the AUTH path
+  XCTAssertTrue(faaPolicyProcessor.DrainTelemetry(5 * NSEC_PER_SEC));
   XCTAssertNotNil(observedEvent);
   XCTAssertEqualObjects(observedEvent.process.fileSHA256, @"abc123");
   XCTAssertTrue(OCMVerifyAll(self.dcMock));
@@ -983,6 +1024,8 @@ static void ClearWatchItemPolicyProcess(WatchItemProcess& proc) {
   faaPolicyProcessor.ProcessTargetAndPolicyWrapper(msg, pair, matcher, deniedBlock,
                                                    SNTOverrideFileAccessActionNone);
 
+  // Audit-only events are stored off of the AUTH path
+  XCTAssertTrue(faaPolicyProcessor.DrainTelemetry(5 * NSEC_PER_SEC));
   XCTAssertNotNil(observedEvent);
   XCTAssertEqualObjects(observedEvent.process.fileSHA256, @"existing-sha256");
   XCTAssertTrue(OCMVerifyAll(self.dcMock));
@@ -1064,6 +1107,8 @@ static void ClearWatchItemPolicyProcess(WatchItemProcess& proc) {
   faaPolicyProcessor.ProcessTargetAndPolicyWrapper(msg, pair, matcher, deniedBlock,
                                                    SNTOverrideFileAccessActionNone);
 
+  // Audit-only events are stored off of the AUTH path
+  XCTAssertTrue(faaPolicyProcessor.DrainTelemetry(5 * NSEC_PER_SEC));
   // Event still emits the placeholder for this event; the async rehydrate
   // only warms the cache for future events.
   XCTAssertNotNil(observedEvent);
@@ -86,6 +86,19 @@ class MockFAAPolicyProcessor : public FAAPolicyProcessor {
     return FAAPolicyProcessor::ProcessTargetAndPolicy(
         msg, target_policy_pair, checkIfPolicyMatchesBlock, fileAccessDeniedBlock, overrideAction);
   }
+
+  FAAPolicyProcessor::ESResult ProcessMessageWrapper(
+      const Message& msg, FAAPolicyProcessor::TargetPolicyPairs target_policy_pairs,
+      FAAPolicyProcessor::CheckIfPolicyMatchesBlock checkIfPolicyMatchesBlock,
+      SNTFileAccessDeniedBlock fileAccessDeniedBlock, SNTOverrideFileAccessAction overrideAction) {
+    return FAAPolicyProcessor::ProcessMessage(msg, std::move(target_policy_pairs),
+                                              checkIfPolicyMatchesBlock, fileAccessDeniedBlock,
+                                              overrideAction, FAAClientType::kData);
+  }
+
+  std::optional<FAAPolicyProcessor::ESResult> ImmediateResponseWrapper(const Message& msg) {
+    return FAAPolicyProcessor::ImmediateResponse(msg, FAAClientType::kData);
+  }
 };
 
 }  // namespace santa
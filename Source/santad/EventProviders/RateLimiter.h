@@ -18,6 +18,9 @@
 
 #import <Foundation/Foundation.h>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 
 #include "Source/santad/Metrics.h"
@@ -29,14 +32,24 @@ class RateLimiterPeer;
 
 namespace santa {
 
-// Very basic rate limiting infrastructure.
-// Currently only handles X events per duration.
+// Lock-free token bucket rate limiting.
 //
-// TODO(mlw): Support changing QPS via config
-// TODO(mlw): Support per-rule QPS
-// TODO(mlw): Consider adding sliding window support
+// The bucket holds up to `logs_per_sec * window_size_sec` tokens and refills
+// continuously at `logs_per_sec`, so bursts are allowed up to the window's
+// worth of events and the budget recovers smoothly instead of all at once
+// when a fixed window ends. The bucket is tracked as a single "theoretical
+// arrival time" that is advanced with a CAS, so deciding never takes a lock
+// or hops queues.
+//
+// Keyed decisions additionally charge one of kNumKeyedBuckets smaller
+// buckets, chosen by hashing the caller's key, each refilling at
+// 1/kKeyedBudgetDivisor of the overall rate. This keeps one noisy key from
+// consuming the whole budget. Keys that collide share a bucket.
 class RateLimiter {
  public:
+  static constexpr size_t kNumKeyedBuckets = 256;
+  static constexpr uint32_t kKeyedBudgetDivisor = 4;
+
   // Factory
   static RateLimiter Create(std::shared_ptr<santa::Metrics> metrics,
                             uint32_t logs_per_sec, uint32_t window_size_sec);
@@ -45,6 +58,9 @@ class RateLimiter {
   RateLimiter(std::shared_ptr<santa::Metrics> metrics, uint32_t logs_per_sec,
               uint32_t window_size_sec, uint32_t max_window_size = 3600);
 
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
   enum class Decision {
     kRateLimited = 0,
     kAllowed,
@@ -52,24 +68,34 @@ class RateLimiter {
 
   Decision Decide(uint64_t cur_mach_time);
 
+  // Charge both the bucket for `key` and the overall bucket. The event is
+  // allowed only if both have a token.
+  Decision Decide(uint64_t cur_mach_time, uint64_t key);
+
   void ModifySettings(uint32_t logs_per_sec, uint32_t window_size_sec);
 
   friend class santa::RateLimiterPeer;
 
  private:
-  void ModifySettingsSerialized(uint32_t logs_per_sec,
-                                uint32_t window_size_sec);
-  bool ShouldRateLimitSerialized();
-  size_t EventsRateLimitedSerialized();
-  void TryResetSerialized(uint64_t cur_mach_time);
+  // Settings are packed so they can be swapped atomically: the low 32 bits
+  // hold the nanoseconds between tokens and the high 32 bits hold the
+  // window size in seconds. Zero means rate limiting is disabled.
+  static uint64_t PackSettings(uint32_t logs_per_sec, uint32_t window_size_sec);
+
+  // Take a token from the bucket tracked by `tat_ns`, one token per
+  // `interval_ns`, holding at most `burst_ns` worth of tokens.
+  static bool TryAcquire(std::atomic<uint64_t>& tat_ns, uint64_t now_ns, uint64_t interval_ns,
+                         uint64_t burst_ns);
+
+  Decision Finish(bool allowed);
 
   std::shared_ptr<santa::Metrics> metrics_;
   const uint32_t max_window_size_;
-  size_t log_count_total_ = 0;
-  size_t max_log_count_total_;
-  uint64_t reset_mach_time_;
-  uint64_t reset_duration_ns_;
-  dispatch_queue_t q_;
+  std::atomic<uint64_t> settings_;
+  std::atomic<uint64_t> tat_ns_{0};
+  std::array<std::atomic<uint64_t>, kNumKeyedBuckets> keyed_tat_ns_{};
+  // Events rate limited since they were last reported to metrics_
+  std::atomic<uint64_t> rate_limited_{0};
 };
 
 }  // namespace santa
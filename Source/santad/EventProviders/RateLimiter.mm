@@ -15,7 +15,7 @@
 
 #include "Source/santad/EventProviders/RateLimiter.h"
 
-#include <limits>
+#include <algorithm>
 
 #include "Source/common/BranchPrediction.h"
 #include "Source/common/SNTLogging.h"
@@ -31,77 +31,96 @@ RateLimiter RateLimiter::Create(std::shared_ptr<santa::Metrics> metrics, uint32_
 RateLimiter::RateLimiter(std::shared_ptr<santa::Metrics> metrics, uint32_t logs_per_sec,
                          uint32_t window_size_sec, uint32_t max_window_size)
     : metrics_(std::move(metrics)), max_window_size_(max_window_size) {
-  q_ = dispatch_queue_create(
-      "com.northpolesec.santa.daemon.rate_limiter",
-      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL,
-                                              QOS_CLASS_USER_INTERACTIVE, 0));
-  ModifySettingsSerialized(logs_per_sec, window_size_sec);
+  ModifySettings(logs_per_sec, window_size_sec);
 }
 
-void RateLimiter::ModifySettingsSerialized(uint32_t logs_per_sec, uint32_t window_size_sec) {
+uint64_t RateLimiter::PackSettings(uint32_t logs_per_sec, uint32_t window_size_sec) {
+  if (logs_per_sec == 0 || window_size_sec == 0) {
+    // If either setting is 0, rate limiting is disabled.
+    return 0;
+  }
+
+  // Rates above 1 event per nanosecond are indistinguishable from no limit
+  uint64_t interval_ns = std::max<uint64_t>(1, NSEC_PER_SEC / logs_per_sec);
+  return ((uint64_t)window_size_sec << 32) | interval_ns;
+}
+
+void RateLimiter::ModifySettings(uint32_t logs_per_sec, uint32_t window_size_sec) {
   if (window_size_sec > max_window_size_) {
     window_size_sec = max_window_size_;
     LOGW(@"Window size must be between 0 and %u. Clamped to: %u", max_window_size_,
          window_size_sec);
   }
 
-  if (logs_per_sec == 0 || window_size_sec == 0) {
-    // If either setting is 0, rate limiting is disabled.
-    // Max out these values to ensure never to return RateLimiter::Decision::kRateLimited;
-    max_log_count_total_ = std::numeric_limits<decltype(max_log_count_total_)>::max();
-    reset_mach_time_ = std::numeric_limits<decltype(reset_mach_time_)>::max();
-  } else {
-    max_log_count_total_ = logs_per_sec * window_size_sec;
-    reset_duration_ns_ = window_size_sec * NSEC_PER_SEC;
-    reset_mach_time_ = 0;
-  }
-}
+  settings_.store(PackSettings(logs_per_sec, window_size_sec), std::memory_order_relaxed);
 
-void RateLimiter::ModifySettings(uint32_t logs_per_sec, uint32_t window_size_sec) {
-  dispatch_sync(q_, ^{
-    ModifySettingsSerialized(logs_per_sec, window_size_sec);
-  });
+  // Start over with full buckets under the new settings
+  tat_ns_.store(0, std::memory_order_relaxed);
+  for (std::atomic<uint64_t>& tat : keyed_tat_ns_) {
+    tat.store(0, std::memory_order_relaxed);
+  }
 }
 
-bool RateLimiter::ShouldRateLimitSerialized() {
-  return log_count_total_ > max_log_count_total_;
+bool RateLimiter::TryAcquire(std::atomic<uint64_t>& tat_ns, uint64_t now_ns, uint64_t interval_ns,
+                             uint64_t burst_ns) {
+  uint64_t tat = tat_ns.load(std::memory_order_relaxed);
+  while (true) {
+    // An idle bucket refills up to full, it doesn't bank time
+    uint64_t new_tat = std::max(tat, now_ns) + interval_ns;
+    if (new_tat - now_ns > burst_ns) {
+      return false;
+    }
+    if (tat_ns.compare_exchange_weak(tat, new_tat, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
 }
 
-size_t RateLimiter::EventsRateLimitedSerialized() {
-  if (unlikely(ShouldRateLimitSerialized())) {
-    return log_count_total_ - max_log_count_total_;
-  } else {
-    return 0;
+RateLimiter::Decision RateLimiter::Finish(bool allowed) {
+  if (unlikely(!allowed)) {
+    rate_limited_.fetch_add(1, std::memory_order_relaxed);
+    return Decision::kRateLimited;
   }
-}
 
-void RateLimiter::TryResetSerialized(uint64_t cur_mach_time) {
-  if (cur_mach_time > reset_mach_time_) {
-    if (metrics_) {
-      metrics_->AddRateLimitingMetrics(EventsRateLimitedSerialized());
+  // Report events dropped since the last allowed event. The load keeps the
+  // common case free of a read-modify-write.
+  if (unlikely(rate_limited_.load(std::memory_order_relaxed) > 0)) {
+    uint64_t dropped = rate_limited_.exchange(0, std::memory_order_relaxed);
+    if (metrics_ && dropped > 0) {
+      metrics_->AddRateLimitingMetrics((int64_t)dropped);
     }
-
-    log_count_total_ = 0;
-    reset_mach_time_ = AddNanosecondsToMachTime(reset_duration_ns_, cur_mach_time);
   }
+
+  return Decision::kAllowed;
 }
 
 RateLimiter::Decision RateLimiter::Decide(uint64_t cur_mach_time) {
-  __block RateLimiter::Decision decision;
+  uint64_t settings = settings_.load(std::memory_order_relaxed);
+  if (settings == 0) {
+    return Decision::kAllowed;
+  }
 
-  dispatch_sync(q_, ^{
-    TryResetSerialized(cur_mach_time);
+  uint64_t interval_ns = settings & UINT32_MAX;
+  uint64_t burst_ns = (settings >> 32) * NSEC_PER_SEC;
+  return Finish(TryAcquire(tat_ns_, MachTimeToNanos(cur_mach_time), interval_ns, burst_ns));
+}
 
-    ++log_count_total_;
+RateLimiter::Decision RateLimiter::Decide(uint64_t cur_mach_time, uint64_t key) {
+  uint64_t settings = settings_.load(std::memory_order_relaxed);
+  if (settings == 0) {
+    return Decision::kAllowed;
+  }
 
-    if (unlikely(ShouldRateLimitSerialized())) {
-      decision = Decision::kRateLimited;
-    } else {
-      decision = RateLimiter::Decision::kAllowed;
-    }
-  });
+  uint64_t interval_ns = settings & UINT32_MAX;
+  uint64_t burst_ns = (settings >> 32) * NSEC_PER_SEC;
+  uint64_t now_ns = MachTimeToNanos(cur_mach_time);
 
-  return decision;
+  // A token taken from the key's bucket isn't returned if the overall bucket
+  // is empty. That only errs toward logging less while over budget.
+  std::atomic<uint64_t>& keyed_tat_ns = keyed_tat_ns_[key % kNumKeyedBuckets];
+  return Finish(
+      TryAcquire(keyed_tat_ns, now_ns, interval_ns * kKeyedBudgetDivisor, burst_ns) &&
+      TryAcquire(tat_ns_, now_ns, interval_ns, burst_ns));
 }
 
 }  // namespace santa
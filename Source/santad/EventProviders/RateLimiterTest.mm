@@ -17,6 +17,10 @@
 
 #import <Foundation/Foundation.h>
 #import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <memory>
 
 #include "Source/common/SystemResources.h"
 #include "Source/santad/Metrics.h"
@@ -29,173 +33,128 @@ class RateLimiterPeer : public RateLimiter {
  public:
   using RateLimiter::RateLimiter;
 
-  using RateLimiter::EventsRateLimitedSerialized;
-  using RateLimiter::ShouldRateLimitSerialized;
-  using RateLimiter::TryResetSerialized;
-
-  using RateLimiter::log_count_total_;
-  using RateLimiter::max_log_count_total_;
-  using RateLimiter::reset_duration_ns_;
-  using RateLimiter::reset_mach_time_;
+  using RateLimiter::settings_;
+  using RateLimiter::tat_ns_;
 };
 
 }  // namespace santa
 
 using santa::RateLimiterPeer;
 
+static uint64_t SecsToMachTime(uint64_t secs) {
+  return NanosToMachTime(secs * NSEC_PER_SEC);
+}
+
 @interface RateLimiterTest : XCTestCase
 @end
 
 @implementation RateLimiterTest
 
-- (void)testTryResetSerialized {
-  // Create an object supporting 1 QPS, and a reset duration of 2s
-  uint16_t maxQps = 1;
-  NSTimeInterval resetDuration = 2;
-  RateLimiterPeer rlp(nullptr, maxQps, resetDuration);
-
-  // Check the current reset_mach_time_ is 0 so that it gets
-  // set when the first decision is made
-  XCTAssertEqual(rlp.reset_mach_time_, 0);
-
-  // Define our current mach time and create the expected new reset duration floor
-  uint64_t curMachTime = 1;
-  uint64_t expectedMachTime = AddNanosecondsToMachTime(resetDuration, curMachTime);
-
-  // Set a higher log count to ensure it is reset
-  rlp.log_count_total_ = 123;
-
-  rlp.TryResetSerialized(curMachTime);
-
-  // Ensure values are reset appropriately
-  XCTAssertEqual(rlp.log_count_total_, 0);
-  XCTAssertGreaterThanOrEqual(rlp.reset_mach_time_, expectedMachTime);
-
-  // Setup values so that calling TryResetSerialized shouldn't reset anything
-  size_t expectedLogCount = 123;
-  expectedMachTime = 456;
-  rlp.log_count_total_ = expectedLogCount;
-  rlp.reset_mach_time_ = expectedMachTime;
-  curMachTime = rlp.reset_mach_time_;
-
-  rlp.TryResetSerialized(curMachTime);
-
-  // Ensure the values were not changed
-  XCTAssertEqual(rlp.log_count_total_, expectedLogCount);
-  XCTAssertGreaterThanOrEqual(rlp.reset_mach_time_, expectedMachTime);
-}
-
 - (void)testDecide {
-  // Create an object supporting 2 QPS, and a reset duration of 4s
+  // Create an object supporting 2 QPS, and a window of 4s
   uint16_t maxQps = 2;
-  NSTimeInterval resetDuration = 4;
-  uint64_t allowedLogsPerDuration = maxQps * resetDuration;
-  RateLimiterPeer rlp(nullptr, maxQps, resetDuration);
+  uint32_t windowSize = 4;
+  uint64_t allowedLogsPerWindow = maxQps * windowSize;
+  RateLimiterPeer rlp(nullptr, maxQps, windowSize);
 
-  // Check the current log count is initially 0
-  XCTAssertEqual(rlp.log_count_total_, 0);
+  // A full window's worth of logs is allowed as a burst
+  for (uint64_t i = 0; i < allowedLogsPerWindow; i++) {
+    XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kAllowed);
+  }
 
-  // Make the first decision
-  RateLimiter::Decision gotDecision;
+  // Then logs are rate limited
+  XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kRateLimited);
 
-  for (uint64_t i = 0; i < (allowedLogsPerDuration); i++) {
-    gotDecision = rlp.Decide(0);
-    XCTAssertEqual(gotDecision, RateLimiter::Decision::kAllowed);
+  // The bucket refills continuously. After 1s, QPS more logs are allowed.
+  uint64_t oneSec = SecsToMachTime(1);
+  for (uint64_t i = 0; i < maxQps; i++) {
+    XCTAssertEqual(rlp.Decide(oneSec), RateLimiter::Decision::kAllowed);
   }
+  XCTAssertEqual(rlp.Decide(oneSec), RateLimiter::Decision::kRateLimited);
 
-  // Ensure the log count is the expected amount
-  XCTAssertEqual(rlp.log_count_total_, allowedLogsPerDuration);
-
-  // Make another decision and ensure the log count still increases and
-  // the decision is rate limited
-  gotDecision = rlp.Decide(0);
-  XCTAssertEqual(gotDecision, RateLimiter::Decision::kRateLimited);
-  XCTAssertEqual(rlp.log_count_total_, allowedLogsPerDuration + 1);
-
-  // Make another decision, though now with the cur mach time greater than
-  // the reset mach time. Then ensure values were appropriately reset.
-  uint64_t oldResetMachTime = rlp.reset_mach_time_;
-  gotDecision = rlp.Decide(rlp.reset_mach_time_ + 1);
-  XCTAssertEqual(gotDecision, RateLimiter::Decision::kAllowed);
-  XCTAssertEqual(rlp.log_count_total_, 1);
-  XCTAssertGreaterThan(rlp.reset_mach_time_, oldResetMachTime);
+  // Idle time refills the bucket, but only up to a single window
+  uint64_t muchLater = SecsToMachTime(1000);
+  for (uint64_t i = 0; i < allowedLogsPerWindow; i++) {
+    XCTAssertEqual(rlp.Decide(muchLater), RateLimiter::Decision::kAllowed);
+  }
+  XCTAssertEqual(rlp.Decide(muchLater), RateLimiter::Decision::kRateLimited);
 }
 
-- (void)testShouldRateLimitAndCounts {
-  // Create an object supporting 2 QPS, and a reset duration of 4s
-  uint16_t maxQps = 2;
-  NSTimeInterval resetDuration = 4;
-  uint64_t allowedLogsPerDuration = maxQps * resetDuration;
-  uint64_t logsOverQPS = 5;
-  RateLimiterPeer rlp(nullptr, maxQps, resetDuration);
+- (void)testDecideKeyed {
+  // 8 QPS and a window of 2s gives each key a burst of 16 / 4 = 4 logs
+  RateLimiterPeer rlp(nullptr, 8, 2);
+  uint64_t keyedBurst = 8 * 2 / RateLimiter::kKeyedBudgetDivisor;
+
+  for (uint64_t i = 0; i < keyedBurst; i++) {
+    XCTAssertEqual(rlp.Decide(0, 1), RateLimiter::Decision::kAllowed);
+  }
+
+  // The noisy key is limited, but other keys still have budget
+  XCTAssertEqual(rlp.Decide(0, 1), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.Decide(0, 2), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kAllowed);
 
-  // Initially no rate limiting should apply
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
+  // Keys that map to the same bucket share it
+  XCTAssertEqual(rlp.Decide(0, 1 + RateLimiter::kNumKeyedBuckets),
+                 RateLimiter::Decision::kRateLimited);
 
-  // Simulate a smmaller volume of logs received than QPS
-  rlp.log_count_total_ = allowedLogsPerDuration - 1;
+  // Use up the rest of the overall budget, then every key is limited
+  while (rlp.Decide(0) == RateLimiter::Decision::kAllowed) {
+  }
+  XCTAssertEqual(rlp.Decide(0, 3), RateLimiter::Decision::kRateLimited);
+}
 
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
+- (void)testConcurrentDecide {
+  // 10 QPS and a 10s window allows exactly 100 logs at a fixed time
+  auto rlp = std::make_shared<RateLimiterPeer>(nullptr, 10, 10);
+  auto allowed = std::make_shared<std::atomic<int>>(0);
 
-  // Simulate a larger volume of logs received than QPS
-  rlp.log_count_total_ = allowedLogsPerDuration + logsOverQPS;
+  dispatch_apply(8, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t) {
+    for (int i = 0; i < 1000; i++) {
+      if (rlp->Decide(0) == RateLimiter::Decision::kAllowed) {
+        allowed->fetch_add(1);
+      }
+    }
+  });
 
-  XCTAssertTrue(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), logsOverQPS);
+  XCTAssertEqual(allowed->load(), 100);
 }
 
 - (void)testModifySettings {
   RateLimiterPeer rlp(nullptr, 3, 10);
 
-  // Simulate a smmaller volume of logs received than QPS
-  auto oldMax = rlp.max_log_count_total_;
-  rlp.log_count_total_ = rlp.max_log_count_total_ - 1;
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
+  // Use up the budget
+  while (rlp.Decide(0) == RateLimiter::Decision::kAllowed) {
+  }
 
-  // Modifying settings resets mach time
+  // Modifying settings refills the bucket under the new settings
   rlp.ModifySettings(5, 20);
-
-  // Ensure the new max is smaller than the old max
-  XCTAssertGreaterThan(rlp.max_log_count_total_, oldMax);
-  XCTAssertEqual(rlp.reset_duration_ns_, 20 * NSEC_PER_SEC);
-
-  // Simulate larger than the old max, nothing should be rate limited
-  rlp.log_count_total_ = oldMax + 1;
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
-
-  // Go over the new max
-  rlp.log_count_total_ = rlp.max_log_count_total_ + 20;
-  XCTAssertTrue(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 20);
+  XCTAssertEqual(rlp.tat_ns_.load(), 0);
+  for (int i = 0; i < 5 * 20; i++) {
+    XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kAllowed);
+  }
+  XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kRateLimited);
 
   // Test disabling rate limiting by setting logs per sec
   rlp.ModifySettings(0, 123);
-  XCTAssertEqual(rlp.max_log_count_total_,
-                 std::numeric_limits<decltype(rlp.max_log_count_total_)>::max());
-  XCTAssertEqual(rlp.reset_mach_time_, std::numeric_limits<decltype(rlp.reset_mach_time_)>::max());
-
-  rlp.log_count_total_ = std::numeric_limits<decltype(rlp.log_count_total_)>::max();
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
+  XCTAssertEqual(rlp.settings_.load(), 0);
+  for (int i = 0; i < 10000; i++) {
+    XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kAllowed);
+  }
 
   // Modify back to something more sensible, but trigger window size clamping
-  rlp.ModifySettings(123, 4000);
-  XCTAssertEqual(rlp.max_log_count_total_, 123 * 3600);
-  XCTAssertEqual(rlp.reset_duration_ns_, 3600 * NSEC_PER_SEC);
-
-  rlp.log_count_total_ = rlp.max_log_count_total_ + 50;
-  XCTAssertTrue(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 50);
+  rlp.ModifySettings(1, 4000);
+  XCTAssertEqual(rlp.settings_.load() >> 32, 3600);
+  for (int i = 0; i < 3600; i++) {
+    XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kAllowed);
+  }
+  XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kRateLimited);
 
   // Test disabling by zeroing the window size
   rlp.ModifySettings(123, 0);
-  XCTAssertEqual(rlp.max_log_count_total_,
-                 std::numeric_limits<decltype(rlp.max_log_count_total_)>::max());
-  XCTAssertEqual(rlp.reset_mach_time_, std::numeric_limits<decltype(rlp.reset_mach_time_)>::max());
+  XCTAssertEqual(rlp.settings_.load(), 0);
+  XCTAssertEqual(rlp.Decide(0), RateLimiter::Decision::kAllowed);
 }
 
 @end
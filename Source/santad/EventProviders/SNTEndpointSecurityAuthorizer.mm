@@ -16,16 +16,21 @@
 #import "Source/santad/EventProviders/SNTEndpointSecurityAuthorizer.h"
 
 #include <EndpointSecurity/ESTypes.h>
+#include <bsm/libbsm.h>
 #include <os/base.h>
 #include <stdlib.h>
 
 #import "Source/common/BranchPrediction.h"
+#include "Source/common/CompactCachedDecision.h"
+#include "Source/common/LatencyHistogram.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTLogging.h"
+#include "Source/common/String.h"
 #include "Source/common/es/ESMetricsObserver.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
+#import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/EventProviders/AuthResultCache.h"
 
 using santa::AuthResultCache;
@@ -74,19 +79,6 @@ using santa::Message;
   return @"Authorizer";
 }
 
-- (bool)handleContextMessage:(Message&)esMsg {
-  bool addedOnly = [super handleContextMessage:esMsg];
-  // The tree-aware superclass vends process lifecycle events to keep the process
-  // tree consistent. Now that this client observes exits, evict the exiting
-  // process from the exec controller's sandboxed-seatbelt cache so it stays
-  // bounded by the set of live sandboxed processes (entries are otherwise
-  // harmless but never reclaimed until the cache fills).
-  if (esMsg->event_type == ES_EVENT_TYPE_NOTIFY_EXIT) {
-    [self.execController forgetSandboxedSeatbeltProc:esMsg->process->audit_token];
-  }
-  return addedOnly;
-}
-
 - (bool)respondToMessage:(const santa::Message&)msg
           withAuthResult:(es_auth_result_t)result
        forcePreventCache:(BOOL)forcePreventCache {
@@ -127,7 +119,11 @@ using santa::Message;
   SNTCachedDecision* cd = nil;
 
   while (true) {
-    santa::CachedAuthResult cacheEntry = self->_authResultCache->CheckCache(targetProc->executable);
+    santa::CachedAuthResult cacheEntry;
+    {
+      santa::ScopedStageLatency latency(santa::LatencyStage::kCacheCheck, msg->event_type);
+      cacheEntry = self->_authResultCache->CheckCache(targetProc->executable);
+    }
     SNTAction returnAction = cacheEntry.action;
     if (RESPONSE_VALID(returnAction)) {
       es_auth_result_t authResult = ES_AUTH_RESULT_DENY;
@@ -147,8 +143,18 @@ using santa::Message;
 
       return;
     } else if (returnAction == SNTActionRespondAllowNoCache) {
+      // The decision can be reused without re-evaluating policy if it only depended on the
+      // identity of the file and the EUID. ES must still not cache it for other users.
+      const std::shared_ptr<const santa::CompactCachedDecision>& cached =
+          cacheEntry.cached_decision;
+      if (cached && cached->cacheable_for_euid() && (SNTEventStateAllow & cached->decision()) &&
+          cached->cache_euid() == audit_token_to_euid(targetProc->audit_token)) {
+        [self respondToMessage:msg withAuthResult:ES_AUTH_RESULT_ALLOW forcePreventCache:YES];
+        return;
+      }
+
       // Cache hit — we have pre-computed identity data but need to re-evaluate policy.
-      cd = cacheEntry.cached_decision;
+      cd = cached ? cached->ToDecision() : nil;
       // Remove the entry so we can transition through RequestBinary for re-evaluation.
       self->_authResultCache->RemoveFromCache(targetProc->executable);
       break;
@@ -187,6 +193,31 @@ using santa::Message;
                               }];
 }
 
+- (BOOL)supportsMultiplexedClient {
+  return YES;
+}
+
+- (bool)isFastPathMessage:(const Message&)msg {
+  if (msg->event_type != ES_EVENT_TYPE_AUTH_EXEC) {
+    return false;
+  }
+
+  // Previously decided binaries, including compilers, are answered from the cache
+  const es_process_t* targetProc = msg->event.exec.target;
+  if (RESPONSE_VALID(self->_authResultCache->CheckCache(targetProc->executable).action)) {
+    return true;
+  }
+
+  // Critical system binaries are allowed without evaluating their signature
+  if (targetProc->is_platform_binary && targetProc->signing_id.length > 0) {
+    NSString* signingID = [NSString
+        stringWithFormat:@"platform:%@", santa::StringTokenToNSString(targetProc->signing_id)];
+    return self.execController.ruleTable.criticalSystemBinaries[signingID] != nil;
+  }
+
+  return false;
+}
+
 - (void)handleMessage:(Message&&)esMsg
     recordEventMetrics:(void (^)(EventDisposition))recordEventMetrics {
   switch (esMsg->event_type) {
@@ -14,6 +14,7 @@
 /// limitations under the License.
 
 #include <EndpointSecurity/ESTypes.h>
+#include <bsm/libbsm.h>
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 #include <gmock/gmock.h>
@@ -136,40 +137,6 @@ class MockAuthResultCache : public AuthResultCache {
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
-// As a tree-aware client the authorizer observes NOTIFY_EXIT. It should evict the
-// exiting process from the exec controller's sandboxed-seatbelt cache.
-- (void)testHandleContextMessageEvictsSandboxedSeatbeltProcOnExit {
-  es_file_t file = MakeESFile("foo");
-  es_process_t proc = MakeESProcess(&file);
-  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXIT, &proc);
-
-  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
-  mockESApi->SetExpectationsESNewClient();
-  mockESApi->SetExpectationsRetainReleaseMessage();
-
-  // processTree:nullptr keeps the tree-aware superclass a no-op so only the
-  // eviction side effect is exercised.
-  SNTEndpointSecurityAuthorizer* authClient =
-      [[SNTEndpointSecurityAuthorizer alloc] initWithESAPI:mockESApi
-                                                   metrics:nullptr
-                                            execController:self.mockExecController
-                                        compilerController:nil
-                                           authResultCache:nullptr
-                                                 ttyWriter:nullptr
-                                               processTree:nullptr];
-
-  OCMExpect([self.mockExecController forgetSandboxedSeatbeltProc:proc.audit_token])
-      .ignoringNonObjectArgs();
-
-  {
-    Message msg(mockESApi, &esMsg);
-    [authClient handleContextMessage:msg];
-  }
-
-  XCTAssertTrue(OCMVerifyAll(self.mockExecController));
-  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
-}
-
 - (void)testHandleMessage {
 #ifdef THREAD_SANITIZER
   // TSAN and this test do not get along in multiple ways.
@@ -401,6 +368,56 @@ class MockAuthResultCache : public AuthResultCache {
   [mockAuthClient stopMocking];
 }
 
+- (void)testProcessMessageReusesEUIDScopedDecision {
+  es_file_t file = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&file);
+  es_file_t execFile = MakeESFile("bar");
+  es_process_t execProc = MakeESProcess(&execFile, MakeAuditToken(12, 23), MakeAuditToken(34, 45));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_EXEC, &proc, ActionType::Auth);
+  esMsg.event.exec.target = &execProc;
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.decision = SNTEventStateAllowBinary;
+  cd.cacheable = NO;
+  cd.cacheableForEUID = YES;
+  cd.cacheEUID = audit_token_to_euid(execProc.audit_token);
+
+  auto mockAuthCache = std::make_shared<MockAuthResultCache>(nullptr, nil);
+  EXPECT_CALL(*mockAuthCache, CheckCache)
+      .WillOnce(testing::Return(santa::CachedAuthResult{SNTActionRespondAllowNoCache, 1, cd}));
+  EXPECT_CALL(*mockAuthCache, AddToCache).Times(0);
+
+  SNTEndpointSecurityAuthorizer* authClient =
+      [[SNTEndpointSecurityAuthorizer alloc] initWithESAPI:mockESApi
+                                                   metrics:nullptr
+                                            execController:self.mockExecController
+                                        compilerController:nil
+                                           authResultCache:mockAuthCache
+                                                 ttyWriter:santa::TTYWriter::Create(true)
+                                               processTree:nullptr];
+  id mockAuthClient = OCMPartialMock(authClient);
+
+  // The exec is allowed from the cached decision without being re-evaluated, and ES is told not
+  // to cache it since other users may get a different result
+  OCMExpect([mockAuthClient respondToMessage:Message(mockESApi, &esMsg)
+                              withAuthResult:ES_AUTH_RESULT_ALLOW
+                                   cacheable:false])
+      .ignoringNonObjectArgs();
+
+  [mockAuthClient processMessage:Message(mockESApi, &esMsg)];
+
+  XCTAssertTrue(OCMVerifyAll(mockAuthClient));
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockAuthCache.get());
+
+  [mockAuthClient stopMocking];
+}
+
 - (void)testPostAction {
   es_file_t file = MakeESFile("foo");
   es_process_t proc = MakeESProcess(&file);
@@ -33,21 +33,24 @@
 #include <variant>
 
 #include "Source/common/AuditUtilities.h"
-#import "Source/common/SNTConfigurator.h"
+#import "Source/common/SNTLogging.h"
 #import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTStrengthify.h"
 #include "Source/common/es/Message.h"
 #include "Source/common/faa/WatchItemPolicy.h"
+#include "Source/santad/ConfigSnapshot.h"
 #include "Source/santad/EventProviders/FAAPolicyProcessor.h"
 
 using santa::EndpointSecurityAPI;
+using santa::ConfigSnapshot;
 using santa::FAAPolicyProcessor;
 using santa::FindPoliciesForTargetsBlock;
 using santa::Message;
 
 @interface SNTEndpointSecurityDataFileAccessAuthorizer ()
-@property SNTConfigurator* configurator;
 @property bool isSubscribed;
+// When set, only events for target paths muted on the client are delivered
+@property bool isTargetPathWatching;
 @property(copy) FindPoliciesForTargetsBlock findPoliciesForTargetsBlock;
 @end
 
@@ -70,7 +73,6 @@ using santa::Message;
     _faaPolicyProcessorProxy = std::move(faaPolicyProcessorProxy);
     _findPoliciesForTargetsBlock = findPoliciesForTargetsBlock;
 
-    _configurator = [SNTConfigurator configurator];
 
     SNTMetricBooleanGauge* famEnabled = [[SNTMetricSet sharedInstance]
         booleanGaugeWithName:@"/santa/fam_enabled"
@@ -85,7 +87,10 @@ using santa::Message;
 
     [self establishClientOrDie];
 
-    [super enableTargetPathWatching];
+    self.isTargetPathWatching = [super enableTargetPathWatching];
+    if (!self.isTargetPathWatching) {
+      LOGW(@"Unable to invert target path muting, all file operations will be evaluated");
+    }
   }
   return self;
 }
@@ -99,19 +104,13 @@ using santa::Message;
     return;
   }
 
-  __block std::vector<FAAPolicyProcessor::TargetPolicyPair> targetPolicyPairs;
-  __block auto pathTargets = msg.PathTargets();
-
-  self.findPoliciesForTargetsBlock(^(santa::LookupPolicyBlock lookupPolicyBlock) {
-    size_t idx = 0;
-    for (const auto& target : pathTargets) {
-      targetPolicyPairs.emplace_back(idx, lookupPolicyBlock(target.Path().data()));
-      idx++;
-    }
-  });
+  santa::TargetPaths targetPaths;
+  for (const Message::PathTarget& target : msg.PathTargets()) {
+    targetPaths.push_back(target.Path().data());
+  }
 
   FAAPolicyProcessor::ESResult result = _faaPolicyProcessorProxy->ProcessMessage(
-      msg, targetPolicyPairs,
+      msg, self.findPoliciesForTargetsBlock(targetPaths),
       ^bool(const santa::WatchItemPolicyBase& base_policy, const Message::PathTarget& target,
             const Message& msg) {
         for (const santa::WatchItemProcess& process : base_policy.processes) {
@@ -129,7 +128,8 @@ using santa::Message;
 
 - (void)handleMessage:(santa::Message&&)esMsg
     recordEventMetrics:(void (^)(santa::EventDisposition))recordEventMetrics {
-  SNTOverrideFileAccessAction overrideAction = [self.configurator overrideFileAccessAction];
+  SNTOverrideFileAccessAction overrideAction =
+      ConfigSnapshot::Current()->override_file_access_action;
 
   // TODO: Hook up KVO watcher to unsubscribe the ES client when FAA is disabled via override
   // action. If the override action is set to Disable, return immediately.
@@ -211,11 +211,16 @@ using santa::Message;
   if (count == 0) {
     [self disable];
   } else {
-    // Stop watching removed paths
-    [super unmuteTargetPaths:removedPaths];
-
-    // Begin watching the added paths
-    [super muteTargetPaths:newPaths];
+    // With target path muting inverted, ES only delivers events for muted target paths, so the
+    // mutes follow the watched paths. Otherwise muting them would hide exactly the events that
+    // matter and every event is evaluated instead.
+    if (self.isTargetPathWatching) {
+      // Stop watching removed paths
+      [super unmuteTargetPaths:removedPaths];
+
+      // Begin watching the added paths
+      [super muteTargetPaths:newPaths];
+    }
 
     // begin receiving events (if not already)
     [self enable];
@@ -43,6 +43,9 @@ void SetExpectationsForDataFileAccessAuthorizerInit(
 
 @interface SNTEndpointSecurityDataFileAccessAuthorizer (Testing)
 - (void)disable;
+- (void)watchItemsCount:(size_t)count
+               newPaths:(const santa::SetPairPathAndType&)newPaths
+           removedPaths:(const santa::SetPairPathAndType&)removedPaths;
 
 @property bool isSubscribed;
 @end
@@ -115,4 +118,61 @@ void SetExpectationsForDataFileAccessAuthorizerInit(
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testWatchItemsCountUpdatesTargetPathMutes {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+  SetExpectationsForDataFileAccessAuthorizerInit(mockESApi);
+
+  SNTEndpointSecurityDataFileAccessAuthorizer* accessClient =
+      [[SNTEndpointSecurityDataFileAccessAuthorizer alloc] initWithESAPI:mockESApi
+                                                                 metrics:nullptr
+                                                                  logger:nullptr
+                                                                enricher:nullptr
+                                                      faaPolicyProcessor:nil
+                                                               ttyWriter:nullptr
+                                             findPoliciesForTargetsBlock:nil];
+
+  santa::SetPairPathAndType newPaths = {{"/foo", santa::WatchItemPathType::kPrefix}};
+  santa::SetPairPathAndType removedPaths = {{"/bar", santa::WatchItemPathType::kLiteral}};
+
+  EXPECT_CALL(*mockESApi, UnmuteTargetPath(testing::_, std::string_view("/bar"),
+                                           santa::WatchItemPathType::kLiteral))
+      .WillOnce(testing::Return(true));
+  EXPECT_CALL(*mockESApi, MuteTargetPath(testing::_, std::string_view("/foo"),
+                                         santa::WatchItemPathType::kPrefix))
+      .WillOnce(testing::Return(true));
+
+  [accessClient watchItemsCount:1 newPaths:newPaths removedPaths:removedPaths];
+  XCTAssertTrue(accessClient.isSubscribed);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
+- (void)testWatchItemsCountWithoutTargetPathInversion {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+  EXPECT_CALL(*mockESApi, UnmuteAllTargetPaths).WillOnce(testing::Return(true));
+  EXPECT_CALL(*mockESApi, InvertTargetPathMuting).WillOnce(testing::Return(false));
+
+  SNTEndpointSecurityDataFileAccessAuthorizer* accessClient =
+      [[SNTEndpointSecurityDataFileAccessAuthorizer alloc] initWithESAPI:mockESApi
+                                                                 metrics:nullptr
+                                                                  logger:nullptr
+                                                                enricher:nullptr
+                                                      faaPolicyProcessor:nil
+                                                               ttyWriter:nullptr
+                                             findPoliciesForTargetsBlock:nil];
+
+  // Muting watched paths on a client that isn't inverted would hide their events
+  EXPECT_CALL(*mockESApi, MuteTargetPath).Times(0);
+  EXPECT_CALL(*mockESApi, UnmuteTargetPath).Times(0);
+
+  [accessClient watchItemsCount:1
+                       newPaths:{{"/foo", santa::WatchItemPathType::kPrefix}}
+                   removedPaths:{}];
+  XCTAssertTrue(accessClient.isSubscribed);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
 @end
@@ -25,10 +25,13 @@
 #include <bsm/libbsm.h>
 #include <errno.h>
 #include <libproc.h>
+#include <paths.h>
 #include <sys/mount.h>
 #include <sys/param.h>
 #include <sys/ucred.h>
 
+#include "absl/synchronization/mutex.h"
+
 #include "Source/common/AuditUtilities.h"
 #include "Source/common/Platform.h"
 #import "Source/common/SNTCachedDecision.h"
@@ -72,6 +75,7 @@ static NSString* const kMetricStartupDiskOperationSuccess = @"Success";
 - (DADissenterRef __nullable)handleEncryptedMountApproval:(DADiskRef)disk;
 - (void)handleEncryptedRemountCompletion:(DADiskRef)disk
                                dissenter:(DADissenterRef __nullable)dissenter;
+- (void)updateCachedPropertiesForDisk:(DADiskRef)disk properties:(NSDictionary* __nullable)props;
 
 @property SNTMetricCounter* startupDiskMetrics;
 @property DASessionRef diskArbSession;
@@ -107,6 +111,7 @@ void DiskAppearedCallback(DADiskRef disk, void* context) {
   if (![props[@"DAVolumeMountable"] boolValue]) return;
   SNTEndpointSecurityDeviceManager* dm = (__bridge SNTEndpointSecurityDeviceManager*)context;
 
+  [dm updateCachedPropertiesForDisk:disk properties:props];
   [dm logDiskAppeared:props allowed:true];
 }
 
@@ -114,19 +119,21 @@ void DiskDescriptionChangedCallback(DADiskRef disk, CFArrayRef keys, void* conte
   NSDictionary* props = CFBridgingRelease(DADiskCopyDescription(disk));
   if (![props[@"DAVolumeMountable"] boolValue]) return;
 
-  if (props[@"DAVolumePath"]) {
-    SNTEndpointSecurityDeviceManager* dm = (__bridge SNTEndpointSecurityDeviceManager*)context;
+  SNTEndpointSecurityDeviceManager* dm = (__bridge SNTEndpointSecurityDeviceManager*)context;
+  [dm updateCachedPropertiesForDisk:disk properties:props];
 
+  if (props[@"DAVolumePath"]) {
     [dm logDiskAppeared:props allowed:true];
   }
 }
 
 void DiskDisappearedCallback(DADiskRef disk, void* context) {
+  SNTEndpointSecurityDeviceManager* dm = (__bridge SNTEndpointSecurityDeviceManager*)context;
+  [dm updateCachedPropertiesForDisk:disk properties:nil];
+
   NSDictionary* props = CFBridgingRelease(DADiskCopyDescription(disk));
   if (![props[@"DAVolumeMountable"] boolValue]) return;
 
-  SNTEndpointSecurityDeviceManager* dm = (__bridge SNTEndpointSecurityDeviceManager*)context;
-
   const char* bsdNameStr = DADiskGetBSDName(disk);
   if (bsdNameStr) {
     [dm.remountingDisks removeObject:@(bsdNameStr)];
@@ -200,12 +207,28 @@ uint32_t mountArgsToMask(NSArray<NSString*>* args) {
   return flags;
 }
 
+// Key used for a disk in the property cache. DiskArbitration reports BSD
+// names without the "/dev/" prefix that mount's f_mntfromname carries.
+static NSString* DiskPropertiesKey(const char* bsdName) {
+  if (!bsdName) return nil;
+  if (strncmp(bsdName, _PATH_DEV, sizeof(_PATH_DEV) - 1) == 0) {
+    bsdName += sizeof(_PATH_DEV) - 1;
+  }
+  return @(bsdName);
+}
+
 NS_ASSUME_NONNULL_BEGIN
 
 @implementation SNTEndpointSecurityDeviceManager {
   std::shared_ptr<AuthResultCache> _authResultCache;
   std::shared_ptr<santa::Enricher> _enricher;
   std::shared_ptr<Logger> _logger;
+
+  // Descriptions of mountable disks, kept current by the DiskArbitration
+  // callbacks so that mount authorization doesn't wait on diskarbitrationd.
+  absl::Mutex _diskPropertiesMutex;
+  NSMutableDictionary<NSString*, NSDictionary*>* _diskProperties
+      ABSL_GUARDED_BY(_diskPropertiesMutex);
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
@@ -232,6 +255,7 @@ NS_ASSUME_NONNULL_BEGIN
     _encryptedRemovableMediaRemountFlags = encryptedRemovableMediaRemountFlags;
     _configurator = [SNTConfigurator configurator];
     _remountingDisks = [NSMutableSet set];
+    _diskProperties = [NSMutableDictionary dictionary];
 
     _diskQueue =
         dispatch_queue_create("com.northpolesec.santa.daemon.disk_queue", DISPATCH_QUEUE_SERIAL);
@@ -272,6 +296,40 @@ NS_ASSUME_NONNULL_BEGIN
   return mask;
 }
 
+- (void)updateCachedPropertiesForDisk:(DADiskRef)disk properties:(nullable NSDictionary*)props {
+  NSString* key = DiskPropertiesKey(DADiskGetBSDName(disk));
+  if (!key) return;
+
+  absl::MutexLock lock(_diskPropertiesMutex);
+  if (props) {
+    _diskProperties[key] = props;
+  } else {
+    [_diskProperties removeObjectForKey:key];
+  }
+}
+
+// Return the DiskArbitration description of the device a mount comes from.
+// Disks seen by the DA callbacks are served from the property cache, others
+// fall back to asking DiskArbitration directly. Sources outside of /dev, such
+// as network shares, have no DA disk and return nil without a lookup.
+- (nullable NSDictionary*)diskPropertiesForMountFromName:(const char*)mntFromName {
+  if (strncmp(mntFromName, _PATH_DEV, sizeof(_PATH_DEV) - 1) != 0) {
+    return nil;
+  }
+
+  {
+    absl::ReaderMutexLock lock(_diskPropertiesMutex);
+    NSDictionary* props = _diskProperties[DiskPropertiesKey(mntFromName)];
+    if (props) return props;
+  }
+
+  DADiskRef disk = DADiskCreateFromBSDName(NULL, self.diskArbSession, mntFromName);
+  if (!disk) return nil;
+
+  CFAutorelease(disk);
+  return CFBridgingRelease(DADiskCopyDescription(disk));
+}
+
 - (BOOL)shouldOperateOnDiskWithProperties:(NSDictionary*)diskInfo {
   // Handle cases like time machine mounts where a disk info is not present.
   if (!diskInfo) {
@@ -466,6 +524,10 @@ NS_ASSUME_NONNULL_BEGIN
   self->_logger->LogDiskDisappeared(props);
 }
 
+- (BOOL)supportsMultiplexedClient {
+  return YES;
+}
+
 - (NSString*)description {
   return @"Device Manager";
 }
@@ -562,10 +624,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (es_auth_result_t)handleAuthDeviceMount:(const Message&)m
                               eventStatFS:(const struct statfs*)eventStatFS {
-  DADiskRef disk = DADiskCreateFromBSDName(NULL, self.diskArbSession, eventStatFS->f_mntfromname);
-  CFAutorelease(disk);
-
-  NSDictionary* diskInfo = CFBridgingRelease(DADiskCopyDescription(disk));
+  NSDictionary* diskInfo = [self diskPropertiesForMountFromName:eventStatFS->f_mntfromname];
   if (![self shouldOperateOnDiskWithProperties:diskInfo]) {
     return ES_AUTH_RESULT_ALLOW;
   }
@@ -618,7 +677,15 @@ NS_ASSUME_NONNULL_BEGIN
     uint32_t newMode = [self updatedMountFlags:eventStatFS remountArgs:actionRemountArgs];
     LOGI(@"SNTEndpointSecurityDeviceManager: remounting device '%s'->'%s', flags (%u) -> (%u)",
          eventStatFS->f_mntfromname, eventStatFS->f_mntonname, eventStatFS->f_flags, newMode);
-    [self remount:disk mountMode:newMode callback:DiskMountedCallback context:nil];
+    DADiskRef disk =
+        DADiskCreateFromBSDName(NULL, self.diskArbSession, eventStatFS->f_mntfromname);
+    if (disk) {
+      CFAutorelease(disk);
+      [self remount:disk mountMode:newMode callback:DiskMountedCallback context:nil];
+    } else {
+      LOGW(@"Unable to create disk reference to remount device: '%s'",
+           eventStatFS->f_mntfromname);
+    }
     storedUSBMountEvent = [[SNTStoredUSBMountEvent alloc]
         initWithDeviceModel:model
                deviceVendor:vendor
@@ -629,7 +696,7 @@ NS_ASSUME_NONNULL_BEGIN
                 isEncrypted:isEncrypted];
   } else {
     // Block — log the mount denial.
-    NSMutableDictionary* props = [CFBridgingRelease(DADiskCopyDescription(disk)) mutableCopy];
+    NSMutableDictionary* props = [diskInfo mutableCopy];
     props[santa::kMountFromNameKey] = event.mntfromname;
     [self logDiskAppeared:[props copy] allowed:false];
     storedUSBMountEvent =
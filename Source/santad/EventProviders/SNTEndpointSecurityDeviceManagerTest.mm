@@ -70,6 +70,8 @@ class MockAuthResultCache : public AuthResultCache {
 - (DADissenterRef __nullable)handleEncryptedMountApproval:(DADiskRef)disk;
 - (void)handleEncryptedRemountCompletion:(DADiskRef)disk
                                dissenter:(DADissenterRef __nullable)dissenter;
+- (void)updateCachedPropertiesForDisk:(DADiskRef)disk properties:(nullable NSDictionary*)props;
+- (nullable NSDictionary*)diskPropertiesForMountFromName:(const char*)mntFromName;
 @property(nonatomic, readonly) dispatch_queue_t diskQueue;
 @property(nonatomic) NSMutableSet<NSString*>* remountingDisks;
 @end
@@ -569,6 +571,54 @@ class MockAuthResultCache : public AuthResultCache {
                  (sfs.f_flags | MNT_RDONLY | MNT_NOEXEC) & ~MNT_JOURNALED);
 }
 
+- (void)testDiskPropertiesCache {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+
+  SNTEndpointSecurityDeviceManager* deviceManager = [[SNTEndpointSecurityDeviceManager alloc]
+                            initWithESAPI:mockESApi
+                                  metrics:nullptr
+                                   logger:nullptr
+                                 enricher:nullptr
+                          authResultCache:nullptr
+                     removableMediaAction:SNTRemovableMediaActionAllow
+               removableMediaRemountFlags:nil
+            encryptedRemovableMediaAction:SNTRemovableMediaActionAllow
+      encryptedRemovableMediaRemountFlags:nil
+                       startupPreferences:SNTDeviceManagerStartupPreferencesNone];
+
+  MockDADisk* disk = [[MockDADisk alloc] init];
+  disk.diskDescription = @{
+    @"DAMediaBSDName" : @"/dev/disk2s1",
+    @"DAVolumeMountable" : @YES,
+    @"DADeviceModel" : @"From DiskArbitration",
+  };
+  [self.mockDA insert:disk];
+
+  // Disks not yet seen by the DA callbacks are looked up directly
+  XCTAssertEqualObjects([deviceManager diskPropertiesForMountFromName:"/dev/disk2s1"],
+                        disk.diskDescription);
+
+  // Once cached, the cached description is used without consulting DA
+  NSDictionary* cachedProps = @{
+    @"DAMediaBSDName" : @"/dev/disk2s1",
+    @"DADeviceModel" : @"From cache",
+  };
+  [deviceManager updateCachedPropertiesForDisk:(__bridge DADiskRef)disk properties:cachedProps];
+  XCTAssertEqualObjects([deviceManager diskPropertiesForMountFromName:"/dev/disk2s1"],
+                        cachedProps);
+
+  // Removal from the cache falls back to DA again
+  [deviceManager updateCachedPropertiesForDisk:(__bridge DADiskRef)disk properties:nil];
+  XCTAssertEqualObjects([deviceManager diskPropertiesForMountFromName:"/dev/disk2s1"],
+                        disk.diskDescription);
+
+  // Sources outside of /dev never have a DA disk
+  XCTAssertNil([deviceManager diskPropertiesForMountFromName:"//user@server/share"]);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
 - (void)testEnable {
   // Ensure the client subscribes to expected event types
   std::set<es_event_type_t> expectedEventSubs{
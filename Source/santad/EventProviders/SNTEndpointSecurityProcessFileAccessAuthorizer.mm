@@ -14,6 +14,7 @@
 
 #import "Source/santad/EventProviders/SNTEndpointSecurityProcessFileAccessAuthorizer.h"
 #include <EndpointSecurity/ESTypes.h>
+#include "Source/santad/ConfigSnapshot.h"
 #include "Source/santad/EventProviders/FAAPolicyProcessor.h"
 
 #include <bsm/libbsm.h>
@@ -24,22 +25,25 @@
 #import "Source/common/SNTLogging.h"
 #include "Source/common/SantaCache.h"
 #include "Source/common/SantaSetCache.h"
+#include "Source/common/String.h"
 #import "Source/common/es/SNTEndpointSecurityEventHandler.h"
 #include "Source/common/faa/WatchItemPolicy.h"
 
+using santa::ConfigSnapshot;
 using santa::FAAPolicyProcessor;
-using santa::IterateProcessPoliciesBlock;
+using santa::FindProcessPoliciesBlock;
 using santa::Message;
 using santa::PidPidversion;
+using santa::ProcessPolicyKeys;
 using santa::ProcessWatchItemPolicy;
+using santa::StringTokenToStringView;
 
 using PidPidverPair = std::pair<pid_t, int>;
 using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchItemPolicy>>;
 
 @interface SNTEndpointSecurityProcessFileAccessAuthorizer ()
 @property bool isSubscribed;
-@property(copy) IterateProcessPoliciesBlock iterateProcessPoliciesBlock;
-@property SNTConfigurator* configurator;
+@property(copy) FindProcessPoliciesBlock findProcessPoliciesBlock;
 @end
 
 @implementation SNTEndpointSecurityProcessFileAccessAuthorizer {
@@ -48,19 +52,18 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<santa::EndpointSecurityAPI>)esApi
-                        metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
-             faaPolicyProcessor:
-                 (std::shared_ptr<santa::ProcessFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
-    iterateProcessPoliciesBlock:(IterateProcessPoliciesBlock)iterateProcessPoliciesBlock {
+                     metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
+          faaPolicyProcessor:
+              (std::shared_ptr<santa::ProcessFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
+    findProcessPoliciesBlock:(FindProcessPoliciesBlock)findProcessPoliciesBlock {
   self = [super initWithESAPI:std::move(esApi)
                       metrics:std::move(metrics)
                     processor:santa::Processor::kProcessFileAccessAuthorizer];
   if (self) {
     _faaPolicyProcessorProxy = std::move(faaPolicyProcessorProxy);
-    _iterateProcessPoliciesBlock = iterateProcessPoliciesBlock;
+    _findProcessPoliciesBlock = findProcessPoliciesBlock;
 
     _procRuleCache = std::make_unique<ProcessRuleCache>(2000);
-    _configurator = [SNTConfigurator configurator];
 
     [self establishClientOrDie];
     [self enableProcessWatching];
@@ -79,7 +82,7 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
     return;
   }
 
-  std::vector<FAAPolicyProcessor::TargetPolicyPair> targetPolicyPairs;
+  FAAPolicyProcessor::TargetPolicyPairs targetPolicyPairs;
   size_t numTargets = msg.PathTargets().size();
   for (size_t i = 0; i < numTargets; ++i) {
     targetPolicyPairs.emplace_back(i, procPolicy);
@@ -109,7 +112,8 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
 
 - (void)handleMessage:(Message&&)esMsg
     recordEventMetrics:(void (^)(santa::EventDisposition))recordEventMetrics {
-  SNTOverrideFileAccessAction overrideAction = [self.configurator overrideFileAccessAction];
+  SNTOverrideFileAccessAction overrideAction =
+      ConfigSnapshot::Current()->override_file_access_action;
 
   // TODO: Hook up KVO watcher to unsubscribe the ES client when FAA is disabled via override
   // action. If the override action is set to Disable, return immediately.
@@ -126,9 +130,11 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
       // image and the pidversion is incremented. The old pid+pidversion pair
       // must be cleaned up since there will be no EXIT event for it.
       // There will be a corresponding EXIT for the newly executed process
-      // regardless of whether or not it was allowed or denied.
-      _procRuleCache->remove(PidPidversion(esMsg->process->audit_token));
-      _faaPolicyProcessorProxy->NotifyExit(esMsg->process->audit_token);
+      // regardless of whether or not it was allowed or denied. If the new image
+      // matches a policy, the exec probe already started watching it.
+      auto pidPidver = PidPidversion(esMsg->process->audit_token);
+      _procRuleCache->remove(pidPidver);
+      [self stopWatching:pidPidver];
       return;
     }
 
@@ -142,8 +148,10 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
     }
 
     case ES_EVENT_TYPE_NOTIFY_EXIT: {
-      _procRuleCache->remove(PidPidversion(esMsg->process->audit_token));
-      _faaPolicyProcessorProxy->NotifyExit(esMsg->process->audit_token);
+      // Release the mute entry so the set of watched processes only holds live ones
+      auto pidPidver = PidPidversion(esMsg->process->audit_token);
+      _procRuleCache->remove(pidPidver);
+      [self stopWatching:pidPidver];
       return;
     };
 
@@ -187,21 +195,35 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
 }
 
 - (std::shared_ptr<ProcessWatchItemPolicy>)findPolicyForProcess:(const es_process_t*)esProc {
+  std::shared_ptr<santa::ProcessFAAPolicyProcessorProxy> proxy = _faaPolicyProcessorProxy;
+  ProcessPolicyKeys keys{
+      .binary_path = StringTokenToStringView(esProc->executable->path),
+      .signing_id = esProc->signing_id.data ? StringTokenToStringView(esProc->signing_id)
+                                            : std::string_view(),
+      .team_id =
+          esProc->team_id.data ? StringTokenToStringView(esProc->team_id) : std::string_view(),
+      .cdhash = std::string_view((const char*)esProc->cdhash, sizeof(esProc->cdhash)),
+      .certificate_sha256 =
+          ^std::string {
+            return santa::NSStringToUTF8String(proxy->CertificateHash(esProc));
+          },
+  };
+
   __block std::shared_ptr<ProcessWatchItemPolicy> foundPolicy;
-  self.iterateProcessPoliciesBlock(^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
-    for (const santa::WatchItemProcess& policyProcess : policy->processes) {
-      if ((*_faaPolicyProcessorProxy)->PolicyMatchesProcess(policyProcess, esProc)) {
-        // Map the new process to the matched policy and begin
-        // watching the new process
-        foundPolicy = policy;
-
-        // Stop iteration, no need to continue once a match is found
-        return true;
-      }
-    }
+  self.findProcessPoliciesBlock(
+      keys, ^bool(const santa::WatchItemProcess& policyProcess,
+                  const std::shared_ptr<ProcessWatchItemPolicy>& policy) {
+        if ((*proxy)->PolicyMatchesProcess(policyProcess, esProc)) {
+          // Map the new process to the matched policy and begin
+          // watching the new process
+          foundPolicy = policy;
+
+          // Stop iteration, no need to continue once a match is found
+          return true;
+        }
 
-    return false;
-  });
+        return false;
+      });
 
   return foundPolicy;
 }
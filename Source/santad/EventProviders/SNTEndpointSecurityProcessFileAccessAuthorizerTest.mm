@@ -19,6 +19,7 @@
 #include <EndpointSecurity/EndpointSecurity.h>
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
+#include <bsm/libbsm.h>
 
 #include <memory>
 #include <set>
@@ -29,10 +30,11 @@
 #include "Source/common/faa/WatchItemPolicy.h"
 #include "Source/santad/EventProviders/MockFAAPolicyProcessor.h"
 
-using santa::CheckPolicyBlock;
-using santa::IterateProcessPoliciesBlock;
+using santa::CheckProcessCandidateBlock;
+using santa::FindProcessPoliciesBlock;
 using santa::MockFAAPolicyProcessor;
 using santa::PairPathAndType;
+using santa::ProcessPolicyKeys;
 using santa::ProcessWatchItemPolicy;
 using santa::SetPairPathAndType;
 using santa::WatchItemPathType;
@@ -46,6 +48,9 @@ void SetExpectationsForProcessFileAccessAuthorizerInit(
 }
 
 @interface SNTEndpointSecurityProcessFileAccessAuthorizer (Testing)
+- (void)handleMessage:(santa::Message&&)esMsg
+    recordEventMetrics:(void (^)(santa::EventDisposition))recordEventMetrics;
+
 @property bool isSubscribed;
 @end
 
@@ -80,7 +85,7 @@ void SetExpectationsForProcessFileAccessAuthorizerInit(
       [[SNTEndpointSecurityProcessFileAccessAuthorizer alloc] initWithESAPI:mockESApi
                                                                     metrics:nullptr
                                                          faaPolicyProcessor:mockFAAProxy
-                                                iterateProcessPoliciesBlock:nil];
+                                                   findProcessPoliciesBlock:nil];
 
   [procFAAClient enable];
 
@@ -112,24 +117,28 @@ void SetExpectationsForProcessFileAccessAuthorizerInit(
       .WillOnce(testing::Return(true));
   auto mockFAAProxy = std::make_shared<santa::ProcessFAAPolicyProcessorProxy>(mockFAA);
 
-  // Test object to provide to the CheckPolicyBlock
+  // Test object to provide to the CheckProcessCandidateBlock
   WatchItemProcess proc("proc_path_1", "com.example.proc", "PROCTEAMID", {}, "", false);
   auto pwip = std::make_shared<ProcessWatchItemPolicy>(
       "name", "ver", SetPairPathAndType{PairPathAndType{"path1", WatchItemPathType::kLiteral}},
       true, true, santa::WatchItemRuleType::kProcessesWithAllowedPaths, false, false, "", nil, nil,
       santa::SetWatchItemProcess{proc});
 
-  // Test iter block will call the given CheckPolicyBlock and capture the return
+  // Test find block will call the given CheckProcessCandidateBlock and
+  // capture the return. The keys come from the exec target.
   __block bool checkPolicyBlockResult;
-  IterateProcessPoliciesBlock iterPoliciesBlock = ^(CheckPolicyBlock block) {
-    checkPolicyBlockResult = block(pwip);
-  };
+  FindProcessPoliciesBlock findPoliciesBlock =
+      ^(const ProcessPolicyKeys& keys, CheckProcessCandidateBlock block) {
+        XCTAssertEqual(keys.binary_path, "bar");
+        XCTAssertEqual(keys.cdhash.size(), CS_CDHASH_LEN);
+        checkPolicyBlockResult = block(*pwip->processes.begin(), pwip);
+      };
 
   SNTEndpointSecurityProcessFileAccessAuthorizer* procFAAClient =
       [[SNTEndpointSecurityProcessFileAccessAuthorizer alloc] initWithESAPI:mockESApi
                                                                     metrics:nullptr
                                                          faaPolicyProcessor:mockFAAProxy
-                                                iterateProcessPoliciesBlock:iterPoliciesBlock];
+                                                   findProcessPoliciesBlock:findPoliciesBlock];
 
   // Fake being conected so the probe runs
   procFAAClient.isSubscribed = true;
@@ -138,12 +147,12 @@ void SetExpectationsForProcessFileAccessAuthorizerInit(
     santa::Message msg(mockESApi, &esMsg);
 
     // First test a non-matching policy. The probe should return uninterested
-    // and the CheckPolicyBlock should not return true;
+    // and the CheckProcessCandidateBlock should not return true;
     XCTAssertEqual([procFAAClient probeInterest:msg], santa::ProbeInterest::kUninterested);
     XCTAssertFalse(checkPolicyBlockResult);
 
     // Next check a mtching policy. The probe should return interested, the
-    // process should be muted, and CheckPolicyBlock should return true.
+    // process should be muted, and CheckProcessCandidateBlock should return true.
     EXPECT_CALL(*mockESApi, MuteProcess).WillOnce(testing::Return(true));
 
     XCTAssertEqual([procFAAClient probeInterest:msg], santa::ProbeInterest::kInterested);
@@ -151,4 +160,39 @@ void SetExpectationsForProcessFileAccessAuthorizerInit(
   }
 }
 
+- (void)testExitAndExecReleaseProcessMutes {
+  es_file_t esFile = MakeESFile("foo");
+  es_process_t esProc = MakeESProcess(&esFile, MakeAuditToken(12, 23), MakeAuditToken(34, 45));
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+  SetExpectationsForProcessFileAccessAuthorizerInit(mockESApi);
+
+  auto mockFAA = std::make_shared<MockFAAPolicyProcessor>(nil, nullptr, nullptr, nullptr, nullptr,
+                                                          0, 0, nil, nil);
+  auto mockFAAProxy = std::make_shared<santa::ProcessFAAPolicyProcessorProxy>(mockFAA);
+
+  SNTEndpointSecurityProcessFileAccessAuthorizer* procFAAClient =
+      [[SNTEndpointSecurityProcessFileAccessAuthorizer alloc] initWithESAPI:mockESApi
+                                                                    metrics:nullptr
+                                                         faaPolicyProcessor:mockFAAProxy
+                                                   findProcessPoliciesBlock:nil];
+
+  // Process muting is inverted, so unmuting stops watching the exited or replaced image
+  for (es_event_type_t eventType : {ES_EVENT_TYPE_NOTIFY_EXIT, ES_EVENT_TYPE_NOTIFY_EXEC}) {
+    es_message_t esMsg = MakeESMessage(eventType, &esProc);
+
+    EXPECT_CALL(*mockESApi, UnmuteProcess(testing::_, testing::Truly([](const audit_token_t* tok) {
+                                            return audit_token_to_pid(*tok) == 12 &&
+                                                   audit_token_to_pidversion(*tok) == 23;
+                                          })))
+        .WillOnce(testing::Return(true));
+
+    [procFAAClient handleMessage:santa::Message(mockESApi, &esMsg) recordEventMetrics:nil];
+
+    XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+  }
+}
+
 @end
@@ -36,8 +36,18 @@
                      enricher:(std::shared_ptr<santa::Enricher>)enricher
            compilerController:(SNTCompilerController*)compilerController
               authResultCache:(std::shared_ptr<santa::AuthResultCache>)authResultCache
-                   prefixTree:(std::shared_ptr<santa::PrefixTree<santa::Unit>>)prefixTree
+                   prefixTree:(std::shared_ptr<santa::PublishedPrefixTree<santa::Unit>>)prefixTree
                   processTree:
                       (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree;
 
+/// Subscribe to the events enabled by the logger's telemetry mask and
+/// unsubscribe from the rest, aside from those needed for purposes other than
+/// logging. Called by the logger whenever the telemetry mask changes.
+- (void)updateSubscriptions;
+
+/// Replace the path prefixes of file events that are not logged. Prefixes
+/// are also muted in ES for single target events so that those events are
+/// never delivered.
+- (void)updatePrefixFilters:(NSArray<NSString*>*)prefixFilters;
+
 @end
@@ -18,8 +18,13 @@
 
 #include <EndpointSecurity/EndpointSecurity.h>
 
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <string>
+
+#include "Source/common/FileHashCache.h"
 #include "Source/common/Platform.h"
-#import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
 #include "Source/common/String.h"
 #include "Source/common/TelemetryEventMap.h"
@@ -27,10 +32,13 @@
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
 #include "Source/common/processtree/process_tree.h"
+#include "Source/santad/ConfigSnapshot.h"
 #include "Source/santad/EventProviders/AuthResultCache.h"
 #import "Source/santad/SNTDecisionCache.h"
+#include "absl/synchronization/mutex.h"
 
 using santa::AuthResultCache;
+using santa::ConfigSnapshot;
 using santa::EndpointSecurityAPI;
 using santa::EnrichedMessage;
 using santa::Enricher;
@@ -38,8 +46,32 @@ using santa::EventDisposition;
 using santa::Logger;
 using santa::Message;
 using santa::PrefixTree;
+using santa::PublishedPrefixTree;
+using santa::SetPairPathAndType;
 using santa::Unit;
 using santa::santad::process_tree::ProcessTree;
+using santa::WatchItemPathType;
+
+// Prefixes of file event targets that are never logged, in addition to those
+// from the FileChangesPrefixFilters config key
+static NSArray<NSString*>* const kDefaultPrefixFilters = @[ @"/.", @"/dev/" ];
+
+// Events needed by the compiler controller and to invalidate caches. These
+// are received regardless of the telemetry config.
+static const std::set<es_event_type_t> kRequiredEvents = {
+    ES_EVENT_TYPE_NOTIFY_CLONE,
+    ES_EVENT_TYPE_NOTIFY_CLOSE,
+    ES_EVENT_TYPE_NOTIFY_EXIT,
+    ES_EVENT_TYPE_NOTIFY_RENAME,
+};
+
+// File events that are dropped based on the prefix filters and can be muted
+// by target path. Events with more than one target path, or that are needed
+// for more than logging, are filtered in user space instead so that a match
+// on a secondary target doesn't hide them.
+static const std::set<es_event_type_t> kPrefixMutableEvents = {
+    ES_EVENT_TYPE_NOTIFY_UNLINK,
+};
 
 es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
   switch (msg->event_type) {
@@ -56,14 +88,16 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
 
 @interface SNTEndpointSecurityRecorder ()
 @property SNTCompilerController* compilerController;
-@property SNTConfigurator* configurator;
 @end
 
 @implementation SNTEndpointSecurityRecorder {
   std::shared_ptr<AuthResultCache> _authResultCache;
   std::shared_ptr<Enricher> _enricher;
   std::shared_ptr<Logger> _logger;
-  std::shared_ptr<PrefixTree<Unit>> _prefixTree;
+  std::shared_ptr<PublishedPrefixTree<Unit>> _prefixTree;
+  absl::Mutex _subscriptionMutex;
+  std::set<es_event_type_t> _subscribedEvents ABSL_GUARDED_BY(_subscriptionMutex);
+  std::set<std::string> _mutedPrefixes ABSL_GUARDED_BY(_subscriptionMutex);
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
@@ -72,7 +106,7 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
                      enricher:(std::shared_ptr<Enricher>)enricher
            compilerController:(SNTCompilerController*)compilerController
               authResultCache:(std::shared_ptr<AuthResultCache>)authResultCache
-                   prefixTree:(std::shared_ptr<PrefixTree<Unit>>)prefixTree
+                   prefixTree:(std::shared_ptr<PublishedPrefixTree<Unit>>)prefixTree
                   processTree:(std::shared_ptr<ProcessTree>)processTree {
   self = [super initWithESAPI:std::move(esApi)
                       metrics:std::move(metrics)
@@ -84,13 +118,16 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
     _compilerController = compilerController;
     _authResultCache = authResultCache;
     _prefixTree = prefixTree;
-    _configurator = [SNTConfigurator configurator];
 
     [self establishClientOrDie];
   }
   return self;
 }
 
+- (BOOL)supportsMultiplexedClient {
+  return YES;
+}
+
 - (NSString*)description {
   return @"Recorder";
 }
@@ -113,6 +150,14 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
       }
 
       self->_authResultCache->RemoveFromCache(esMsg->event.close.target);
+      santa::FileHashCache::Shared().Invalidate(
+          SantaVnode::VnodeForFile(esMsg->event.close.target));
+
+      // Get the work for a first exec out of the way while the file is likely still in the
+      // buffer cache
+      if (ConfigSnapshot::Current()->enable_speculative_exec_prefetch) {
+        [[SNTDecisionCache sharedCache] prefetchDecisionForFile:esMsg->event.close.target];
+      }
 
       break;
     }
@@ -155,7 +200,7 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
 
       // Only log file changes that match the given regex
       NSString* targetPath = santa::StringToNSString(targetFile->path.data);
-      if (![[self.configurator fileChangesRegex]
+      if (![ConfigSnapshot::Current()->file_changes_regex
               numberOfMatchesInString:targetPath
                               options:0
                                 range:NSMakeRange(0, targetPath.length)]) {
@@ -171,6 +216,16 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
         return;
       }
 
+      if (self->_logger->IsFiltered(esMsg)) {
+        recordEventMetrics(EventDisposition::kDropped);
+        return;
+      }
+
+      if (self->_logger->IsDuplicate(esMsg)) {
+        recordEventMetrics(EventDisposition::kDropped);
+        return;
+      }
+
       break;
     }
 
@@ -194,7 +249,7 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
                        }];
 }
 
-- (void)enable {
+- (std::set<es_event_type_t>)allEvents {
   // clang-format off
   std::set<es_event_type_t> events{
     ES_EVENT_TYPE_NOTIFY_CLONE,
@@ -239,7 +294,82 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
 #endif  // HAVE_MACOS_15_4
   // clang-format on
 
-  [super subscribe:events];
+  return events;
+}
+
+- (void)enable {
+  [self updateSubscriptions];
+}
+
+- (void)updateSubscriptions {
+  std::set<es_event_type_t> events = [self allEvents];
+  if (_logger) {
+    events = santa::ESEventsForTelemetryMask(events, _logger->GetTelemetryMask());
+    events.insert(kRequiredEvents.begin(), kRequiredEvents.end());
+  }
+
+  absl::MutexLock lock(&_subscriptionMutex);
+
+  std::set<es_event_type_t> added;
+  std::set_difference(events.begin(), events.end(), _subscribedEvents.begin(),
+                      _subscribedEvents.end(), std::inserter(added, added.end()));
+  std::set<es_event_type_t> removed;
+  std::set_difference(_subscribedEvents.begin(), _subscribedEvents.end(), events.begin(),
+                      events.end(), std::inserter(removed, removed.end()));
+
+  if (!added.empty() && ![super subscribe:events]) {
+    LOGE(@"Failed to subscribe the Recorder to %zu new events", added.size());
+    return;
+  }
+
+  if (!removed.empty() && ![super unsubscribe:removed]) {
+    // Events that are still received are dropped by handleMessage
+    LOGW(@"Failed to unsubscribe the Recorder from %zu events", removed.size());
+  }
+
+  _subscribedEvents = std::move(events);
+}
+
+- (void)updatePrefixFilters:(NSArray<NSString*>*)prefixFilters {
+  std::set<std::string> prefixes;
+  NSArray<NSString*>* filters =
+      [kDefaultPrefixFilters arrayByAddingObjectsFromArray:prefixFilters ?: @[]];
+  for (NSString* filter in filters) {
+    prefixes.insert(filter.fileSystemRepresentation);
+  }
+
+  // Build the new filter off to the side so that event handling never waits
+  // on the rebuild
+  auto tree = std::make_shared<PrefixTree<Unit>>();
+  for (const std::string& prefix : prefixes) {
+    tree->InsertPrefix(prefix.c_str(), Unit{});
+  }
+
+  absl::MutexLock lock(&_subscriptionMutex);
+
+  _prefixTree->Publish(std::move(tree));
+
+  SetPairPathAndType mute;
+  for (const std::string& prefix : prefixes) {
+    if (_mutedPrefixes.count(prefix) == 0) {
+      mute.insert({prefix, WatchItemPathType::kPrefix});
+    }
+  }
+  SetPairPathAndType unmute;
+  for (const std::string& prefix : _mutedPrefixes) {
+    if (prefixes.count(prefix) == 0) {
+      unmute.insert({prefix, WatchItemPathType::kPrefix});
+    }
+  }
+
+  if (!mute.empty() && ![super muteTargetPaths:mute forEvents:kPrefixMutableEvents]) {
+    LOGW(@"Failed to mute some file change prefix filters, they will be filtered in user space");
+  }
+  if (!unmute.empty() && ![super unmuteTargetPaths:unmute]) {
+    LOGW(@"Failed to unmute some removed file change prefix filters");
+  }
+
+  _mutedPrefixes = std::move(prefixes);
 }
 
 @end
@@ -49,6 +49,7 @@ using santa::EventDisposition;
 using santa::Message;
 using santa::PrefixTree;
 using santa::Processor;
+using santa::PublishedPrefixTree;
 using santa::TelemetryEvent;
 using santa::Unit;
 
@@ -59,6 +60,14 @@ class MockAuthResultCache : public AuthResultCache {
   MOCK_METHOD(void, RemoveFromCache, (const es_file_t*));
 };
 
+// Replace the published filter with one containing only `prefix`
+static void PublishPrefix(const std::shared_ptr<PublishedPrefixTree<Unit>>& published,
+                          const char* prefix) {
+  auto tree = std::make_shared<PrefixTree<Unit>>();
+  tree->InsertPrefix(prefix, Unit{});
+  published->Publish(std::move(tree));
+}
+
 @interface SNTEndpointSecurityRecorderTest : XCTestCase
 @property id mockConfigurator;
 @end
@@ -140,6 +149,105 @@ class MockAuthResultCache : public AuthResultCache {
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testUpdateSubscriptions {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+
+  auto mockLogger = std::make_shared<MockLogger>();
+  mockLogger->SetTelemetryMask(TelemetryEvent::kExecution);
+
+  SNTEndpointSecurityRecorder* recorderClient =
+      [[SNTEndpointSecurityRecorder alloc] initWithESAPI:mockESApi
+                                                 metrics:nullptr
+                                                  logger:mockLogger
+                                                enricher:nullptr
+                                      compilerController:nil
+                                         authResultCache:nullptr
+                                              prefixTree:nullptr
+                                             processTree:nullptr];
+
+  // Only events enabled by the telemetry mask are subscribed, along with those
+  // needed by the compiler controller and for cache invalidation. FORK is
+  // added for the process tree.
+  std::set<es_event_type_t> execOnly{
+      ES_EVENT_TYPE_NOTIFY_CLONE, ES_EVENT_TYPE_NOTIFY_CLOSE, ES_EVENT_TYPE_NOTIFY_EXEC,
+      ES_EVENT_TYPE_NOTIFY_EXIT,  ES_EVENT_TYPE_NOTIFY_FORK,  ES_EVENT_TYPE_NOTIFY_RENAME,
+  };
+  EXPECT_CALL(*mockESApi, Subscribe(testing::_, execOnly)).WillOnce(testing::Return(true));
+  [recorderClient enable];
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+
+  // Newly enabled events are subscribed
+  mockLogger->SetTelemetryMask(TelemetryEvent::kExecution | TelemetryEvent::kUnlink);
+  std::set<es_event_type_t> execAndUnlink = execOnly;
+  execAndUnlink.insert(ES_EVENT_TYPE_NOTIFY_UNLINK);
+  EXPECT_CALL(*mockESApi, Subscribe(testing::_, execAndUnlink)).WillOnce(testing::Return(true));
+  EXPECT_CALL(*mockESApi, Unsubscribe).Times(0);
+  [recorderClient updateSubscriptions];
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+
+  // Disabled events are unsubscribed. EXEC is still needed by the process tree.
+  mockLogger->SetTelemetryMask(TelemetryEvent::kUnlink);
+  EXPECT_CALL(*mockESApi, Subscribe).Times(0);
+  EXPECT_CALL(*mockESApi, Unsubscribe).Times(0);
+  [recorderClient updateSubscriptions];
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+
+  mockLogger->SetTelemetryMask(TelemetryEvent::kNone);
+  EXPECT_CALL(*mockESApi, Subscribe).Times(0);
+  EXPECT_CALL(*mockESApi,
+              Unsubscribe(testing::_, std::set<es_event_type_t>{ES_EVENT_TYPE_NOTIFY_UNLINK}))
+      .WillOnce(testing::Return(true));
+  [recorderClient updateSubscriptions];
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
+- (void)testUpdatePrefixFilters {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+
+  auto prefixTree = std::make_shared<PublishedPrefixTree<Unit>>();
+
+  SNTEndpointSecurityRecorder* recorderClient =
+      [[SNTEndpointSecurityRecorder alloc] initWithESAPI:mockESApi
+                                                 metrics:nullptr
+                                                  logger:nullptr
+                                                enricher:nullptr
+                                      compilerController:nil
+                                         authResultCache:nullptr
+                                              prefixTree:prefixTree
+                                             processTree:nullptr];
+
+  std::set<es_event_type_t> unlink{ES_EVENT_TYPE_NOTIFY_UNLINK};
+  EXPECT_CALL(*mockESApi, MuteTargetPathEvents(testing::_, "/.", santa::WatchItemPathType::kPrefix,
+                                               unlink))
+      .WillOnce(testing::Return(true));
+  EXPECT_CALL(*mockESApi, MuteTargetPathEvents(testing::_, "/dev/",
+                                               santa::WatchItemPathType::kPrefix, unlink))
+      .WillOnce(testing::Return(true));
+  EXPECT_CALL(*mockESApi, MuteTargetPathEvents(testing::_, "/foo/",
+                                               santa::WatchItemPathType::kPrefix, unlink))
+      .WillOnce(testing::Return(true));
+  [recorderClient updatePrefixFilters:@[ @"/foo/" ]];
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+
+  XCTAssertTrue(prefixTree->HasPrefix("/foo/bar"));
+  XCTAssertTrue(prefixTree->HasPrefix("/dev/null"));
+
+  // Only changes to the set of prefixes are applied
+  EXPECT_CALL(*mockESApi, MuteTargetPathEvents(testing::_, "/bar/",
+                                               santa::WatchItemPathType::kPrefix, unlink))
+      .WillOnce(testing::Return(true));
+  EXPECT_CALL(*mockESApi, UnmuteTargetPath(testing::_, "/foo/", santa::WatchItemPathType::kPrefix))
+      .WillOnce(testing::Return(true));
+  [recorderClient updatePrefixFilters:@[ @"/bar/" ]];
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+
+  XCTAssertFalse(prefixTree->HasPrefix("/foo/bar"));
+  XCTAssertTrue(prefixTree->HasPrefix("/bar/baz"));
+  XCTAssertTrue(prefixTree->HasPrefix("/dev/null"));
+}
+
 - (void)testTelemetryMappings {
   std::set<es_event_type_t> expectedEventSubs = [self expectedSubscriptions];
   // Make sure a TelemetryEvent exists for each subscription
@@ -153,7 +261,7 @@ class MockAuthResultCache : public AuthResultCache {
 typedef void (^TestHelperBlock)(es_message_t* message,
                                 std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
                                 SNTEndpointSecurityRecorder* recorderClient,
-                                std::shared_ptr<PrefixTree<Unit>> prefixTree,
+                                std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
                                 dispatch_semaphore_t* sema, dispatch_semaphore_t* semaMetrics);
 
 es_file_t targetFileMatchesRegex = MakeESFile("/foo/matches");
@@ -207,7 +315,7 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
     EXPECT_CALL(*mockLogger, Log).Times(0);
   }
 
-  auto prefixTree = std::make_shared<PrefixTree<Unit>>();
+  auto prefixTree = std::make_shared<PublishedPrefixTree<Unit>>();
 
   id mockCC = OCMStrictClassMock([SNTCompilerController class]);
 
@@ -252,7 +360,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // and matches fileChangesRegex
   TestHelperBlock testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_CLOSE;
@@ -280,7 +389,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // fileChangesRegex
   TestHelperBlock testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_CLOSE;
@@ -304,7 +414,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // CLOSE not modified, bail early
   TestHelperBlock testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_CLOSE;
@@ -322,7 +433,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // CLOSE modified, remove from cache, and matches fileChangesRegex
   testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_CLOSE;
@@ -347,7 +459,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // CLOSE modified, remove from cache, but doesn't match fileChangesRegex
   testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_CLOSE;
@@ -366,14 +479,15 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // CLONE Prefix match, bail early
   testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_CLONE;
         esMsg->event.clone.source = &targetFileMatchesRegex;
         esMsg->event.clone.target_dir = &targetFileMissesRegex;
         esMsg->event.clone.target_name = MakeESStringToken("foo");
-        prefixTree->InsertPrefix(esMsg->event.clone.source->path.data, Unit{});
+        PublishPrefix(prefixTree, esMsg->event.clone.source->path.data);
         Message msg(mockESApi, esMsg);
         OCMExpect([mockCC handleEvent:msg withLogger:nullptr]).ignoringNonObjectArgs();
         XCTAssertNoThrow([recorderClient handleMessage:Message(mockESApi, esMsg)
@@ -389,7 +503,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // COPYFILE Matches regex, not prefix, handle message
   testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_COPYFILE;
@@ -411,7 +526,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // UNLINK, remove from cache, but doesn't match fileChangesRegex
   testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_UNLINK;
@@ -429,12 +545,13 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // EXCHANGEDATA, Prefix match, bail early
   testBlock =
       ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        SNTEndpointSecurityRecorder* recorderClient,
+        std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
         __autoreleasing dispatch_semaphore_t* sema,
         __autoreleasing dispatch_semaphore_t* semaMetrics) {
         esMsg->event_type = ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA;
         esMsg->event.exchangedata.file1 = &targetFileMatchesRegex;
-        prefixTree->InsertPrefix(esMsg->event.exchangedata.file1->path.data, Unit{});
+        PublishPrefix(prefixTree, esMsg->event.exchangedata.file1->path.data);
         Message msg(mockESApi, esMsg);
         OCMExpect([mockCC handleEvent:msg withLogger:nullptr]).ignoringNonObjectArgs();
         XCTAssertNoThrow([recorderClient handleMessage:Message(mockESApi, esMsg)
@@ -451,13 +568,14 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // LINK, Prefix match, bail early
   testBlock = ^(
       es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-      SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+      SNTEndpointSecurityRecorder* recorderClient,
+      std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
       __autoreleasing dispatch_semaphore_t* sema, __autoreleasing dispatch_semaphore_t* semaMetrics)
 
   {
     esMsg->event_type = ES_EVENT_TYPE_NOTIFY_LINK;
     esMsg->event.link.source = &targetFileMatchesRegex;
-    prefixTree->InsertPrefix(esMsg->event.link.source->path.data, Unit{});
+    PublishPrefix(prefixTree, esMsg->event.link.source->path.data);
     Message msg(mockESApi, esMsg);
 
     OCMExpect([mockCC handleEvent:msg withLogger:nullptr]).ignoringNonObjectArgs();
@@ -476,7 +594,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // EXIT, message handled
   testBlock = ^(
       es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-      SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+      SNTEndpointSecurityRecorder* recorderClient,
+      std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
       __autoreleasing dispatch_semaphore_t* sema, __autoreleasing dispatch_semaphore_t* semaMetrics)
 
   {
@@ -503,7 +622,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // FORK, message handled
   testBlock = ^(
       es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
-      SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+      SNTEndpointSecurityRecorder* recorderClient,
+      std::shared_ptr<PublishedPrefixTree<Unit>> prefixTree,
       __autoreleasing dispatch_semaphore_t* sema, __autoreleasing dispatch_semaphore_t* semaMetrics)
 
   {
@@ -596,7 +716,7 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   auto mockAuthCache = std::make_shared<MockAuthResultCache>(nullptr, nil);
   auto mockLogger = std::make_shared<MockLogger>();
   mockLogger->SetTelemetryMask(TelemetryEvent::kEverything);
-  auto prefixTree = std::make_shared<PrefixTree<Unit>>();
+  auto prefixTree = std::make_shared<PublishedPrefixTree<Unit>>();
 
   // Enricher and Logger should NOT be called when holdAndAsk is set
   EXPECT_CALL(*mockEnricher, Enrich).Times(0);
@@ -665,7 +785,7 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   auto mockAuthCache = std::make_shared<MockAuthResultCache>(nullptr, nil);
   auto mockLogger = std::make_shared<MockLogger>();
   mockLogger->SetTelemetryMask(TelemetryEvent::kEverything);
-  auto prefixTree = std::make_shared<PrefixTree<Unit>>();
+  auto prefixTree = std::make_shared<PublishedPrefixTree<Unit>>();
 
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
 
@@ -739,7 +859,7 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   auto mockAuthCache = std::make_shared<MockAuthResultCache>(nullptr, nil);
   auto mockLogger = std::make_shared<MockLogger>();
   mockLogger->SetTelemetryMask(TelemetryEvent::kEverything);
-  auto prefixTree = std::make_shared<PrefixTree<Unit>>();
+  auto prefixTree = std::make_shared<PublishedPrefixTree<Unit>>();
 
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
 
@@ -24,6 +24,7 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <string_view>
 #include <tuple>
 #include <unordered_set>
 
@@ -31,10 +32,12 @@
 #include "absl/synchronization/mutex.h"
 
 #import "Source/common/Platform.h"
+#include "Source/common/PrefixTree.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SigningIDHelpers.h"
 #import "Source/common/String.h"
+#include "Source/common/Unit.h"
 #include "Source/common/es/ESMetricsObserver.h"
 #include "Source/common/es/Message.h"
 #include "Source/common/faa/WatchItemPolicy.h"
@@ -69,6 +72,9 @@ struct TamperAuthResult {
 // modify these file paths.
 constexpr std::pair<std::string_view, WatchItemPathType> kProtectedFiles[] = {
     {"/private/var/db/santa/rules.db", WatchItemPathType::kLiteral},
+    {"/private/var/db/santa/rules.db-wal", WatchItemPathType::kLiteral},
+    {"/private/var/db/santa/rules.db-shm", WatchItemPathType::kLiteral},
+    {"/private/var/db/santa/rules.snapshot", WatchItemPathType::kPrefix},
     {"/private/var/db/santa/events.db", WatchItemPathType::kLiteral},
     {"/private/var/db/santa/sync-state.plist", WatchItemPathType::kLiteral},
     {"/private/var/db/santa/state.plist", WatchItemPathType::kLiteral},
@@ -78,6 +84,41 @@ constexpr std::pair<std::string_view, WatchItemPathType> kProtectedFiles[] = {
     {"/private/var/db/santa/staging", WatchItemPathType::kPrefix},
 };
 
+namespace {
+// Lookup structures for kProtectedFiles, built once. Literal paths are a hash
+// probe and prefixes share a single tree walk instead of each entry being
+// compared in turn.
+class ProtectedPathMatcher {
+ public:
+  static ProtectedPathMatcher& Shared() {
+    static ProtectedPathMatcher* matcher = new ProtectedPathMatcher();
+    return *matcher;
+  }
+
+  bool IsLiteral(std::string_view path) const { return literals_.contains(path); }
+
+  // `path` must be null terminated, as are paths from Message::PathTargets.
+  bool IsProtected(std::string_view path) {
+    return IsLiteral(path) || prefixes_.HasPrefix(path.data());
+  }
+
+ private:
+  ProtectedPathMatcher() {
+    for (const auto& [path, type] : kProtectedFiles) {
+      switch (type) {
+        case WatchItemPathType::kLiteral: literals_.insert(path); break;
+        case WatchItemPathType::kPrefix:
+          prefixes_.InsertPrefix(std::string(path).c_str(), santa::Unit{});
+          break;
+      }
+    }
+  }
+
+  absl::flat_hash_set<std::string_view> literals_;
+  santa::PrefixTree<santa::Unit, santa::PrefixTreeLayout::kRadix> prefixes_;
+};
+}  // namespace
+
 #if HAVE_MACOS_15_5
 // Platform-binary signing-IDs that Santa trusts to ask launchd to deliver
 // a signal to santad. Extended at runtime via the `AllowDelegatedSignals`
@@ -136,7 +177,7 @@ static NSString* TamperEventName(es_event_type_t type) {
 /// argument inspection drives the outcome.
 TamperAuthResult ValidateLaunchctlExec(const Message& esMsg) {
   es_string_token_t exec_path = esMsg->event.exec.target->executable->path;
-  if (strncmp(exec_path.data, "/bin/launchctl", exec_path.length) != 0) {
+  if (std::string_view(exec_path.data, exec_path.length) != "/bin/launchctl") {
     return TamperAuthResult::AllowCacheable();
   }
 
@@ -430,31 +471,11 @@ TamperAuthResult ValidateLaunchctlExec(const Message& esMsg) {
   return protectedPathsCopy;
 }
 
+// `path` must be null terminated.
 + (bool)isProtectedPath:(const std::string_view)path {
   // TODO(mlw): These values should come from `SNTDatabaseController`. But right
-  // now they live as NSStrings. We should make them `std::string_view` types
-  // in order to use them here efficiently, but will need to make the
-  // `SNTDatabaseController` an ObjC++ file.
-  for (size_t i = 0; i < sizeof(kProtectedFiles) / sizeof(kProtectedFiles[0]); ++i) {
-    auto pf = kProtectedFiles[i];
-    switch (pf.second) {
-      case WatchItemPathType::kLiteral:
-        if (path == pf.first) return true;
-        break;
-      case WatchItemPathType::kPrefix:
-        if (path.rfind(pf.first, 0) == 0) return true;
-        break;
-    }
-  }
-  return false;
-}
-
-+ (bool)isLiteralProtectedPath:(const std::string_view)path {
-  for (size_t i = 0; i < sizeof(kProtectedFiles) / sizeof(kProtectedFiles[0]); ++i) {
-    auto pf = kProtectedFiles[i];
-    if (pf.second == WatchItemPathType::kLiteral && path == pf.first) return true;
-  }
-  return false;
+  // now they live as NSStrings and would need to be kept in sync here.
+  return ProtectedPathMatcher::Shared().IsProtected(path);
 }
 
 // Returns true when `path` in the context of `esMsg` should be denied as a tamper attempt.
@@ -462,14 +483,11 @@ TamperAuthResult ValidateLaunchctlExec(const Message& esMsg) {
 // prefix-protected path, and separately denies any open of a literal-protected path
 // regardless of flags (the .db / .plist files should not be readable to outside processes).
 + (bool)isTamperedPath:(std::string_view)path forMessage:(const santa::Message&)esMsg {
-  if (esMsg->event_type == ES_EVENT_TYPE_AUTH_OPEN) {
-    if ((esMsg->event.open.fflag & FWRITE) &&
-        [SNTEndpointSecurityTamperResistance isProtectedPath:path]) {
-      return true;
-    }
-    return [SNTEndpointSecurityTamperResistance isLiteralProtectedPath:path];
+  ProtectedPathMatcher& matcher = ProtectedPathMatcher::Shared();
+  if (esMsg->event_type == ES_EVENT_TYPE_AUTH_OPEN && !(esMsg->event.open.fflag & FWRITE)) {
+    return matcher.IsLiteral(path);
   }
-  return [SNTEndpointSecurityTamperResistance isProtectedPath:path];
+  return matcher.IsProtected(path);
 }
 
 @end
@@ -856,12 +856,27 @@ static constexpr std::string_view kBenignPath = "/some/other/path";
       [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/rules.db"]);
   XCTAssertTrue(
       [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/events.db"]);
+  XCTAssertTrue(
+      [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/rules.db-wal"]);
+  XCTAssertTrue(
+      [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/rules.db-shm"]);
+  XCTAssertTrue([SNTEndpointSecurityTamperResistance
+      isProtectedPath:"/private/var/db/santa/rules.snapshot"]);
+  XCTAssertTrue([SNTEndpointSecurityTamperResistance
+      isProtectedPath:"/private/var/db/santa/rules.snapshot.tmp"]);
   XCTAssertTrue([SNTEndpointSecurityTamperResistance isProtectedPath:"/Applications/Santa.app"]);
   XCTAssertTrue([SNTEndpointSecurityTamperResistance
       isProtectedPath:"/Library/LaunchAgents/com.northpolesec.santa.plist"]);
   XCTAssertTrue([SNTEndpointSecurityTamperResistance
       isProtectedPath:"/Library/LaunchDaemons/com.northpolesec.santa.syncservice.plist"]);
   XCTAssertFalse([SNTEndpointSecurityTamperResistance isProtectedPath:"/not/a/db/path"]);
+
+  // Literal entries only match exactly
+  XCTAssertFalse(
+      [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/rules.d"]);
+  XCTAssertFalse(
+      [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/rules.db.bak"]);
+  XCTAssertFalse([SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa"]);
 }
 
 - (void)testStagingDirectoryIsProtected {
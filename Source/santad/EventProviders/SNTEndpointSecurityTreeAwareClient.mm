@@ -57,23 +57,44 @@ using santa::Processor;
 // purpose of updating the tree from being processed downstream, where they would be unexpected.
 - (bool)subscribe:(const std::set<es_event_type_t>&)events {
   std::set<es_event_type_t> eventsWithLifecycle = events;
-  if (events.find(ES_EVENT_TYPE_NOTIFY_FORK) == events.end()) {
+
+  // Subscriptions may change over the life of the client, so events added for
+  // the tree are recomputed on each call
+  _addedEvents[ES_EVENT_TYPE_NOTIFY_FORK] = events.find(ES_EVENT_TYPE_NOTIFY_FORK) == events.end();
+  if (_addedEvents[ES_EVENT_TYPE_NOTIFY_FORK]) {
     eventsWithLifecycle.insert(ES_EVENT_TYPE_NOTIFY_FORK);
-    _addedEvents[ES_EVENT_TYPE_NOTIFY_FORK] = true;
   }
-  if (events.find(ES_EVENT_TYPE_NOTIFY_EXEC) == events.end() &&
-      events.find(ES_EVENT_TYPE_AUTH_EXEC) == events.end()) {
+  _addedEvents[ES_EVENT_TYPE_NOTIFY_EXEC] =
+      events.find(ES_EVENT_TYPE_NOTIFY_EXEC) == events.end() &&
+      events.find(ES_EVENT_TYPE_AUTH_EXEC) == events.end();
+  if (_addedEvents[ES_EVENT_TYPE_NOTIFY_EXEC]) {
     eventsWithLifecycle.insert(ES_EVENT_TYPE_NOTIFY_EXEC);
-    _addedEvents[ES_EVENT_TYPE_NOTIFY_EXEC] = true;
   }
-  if (events.find(ES_EVENT_TYPE_NOTIFY_EXIT) == events.end()) {
+  _addedEvents[ES_EVENT_TYPE_NOTIFY_EXIT] = events.find(ES_EVENT_TYPE_NOTIFY_EXIT) == events.end();
+  if (_addedEvents[ES_EVENT_TYPE_NOTIFY_EXIT]) {
     eventsWithLifecycle.insert(ES_EVENT_TYPE_NOTIFY_EXIT);
-    _addedEvents[ES_EVENT_TYPE_NOTIFY_EXIT] = true;
   }
 
   return [super subscribe:eventsWithLifecycle];
 }
 
+// Lifecycle events are still needed by the tree, so rather than being
+// unsubscribed they are only kept from being processed downstream
+- (bool)unsubscribe:(const std::set<es_event_type_t>&)events {
+  std::set<es_event_type_t> eventsWithoutLifecycle = events;
+  for (es_event_type_t event :
+       {ES_EVENT_TYPE_NOTIFY_FORK, ES_EVENT_TYPE_NOTIFY_EXEC, ES_EVENT_TYPE_NOTIFY_EXIT}) {
+    if (eventsWithoutLifecycle.erase(event)) {
+      _addedEvents[event] = true;
+    }
+  }
+
+  if (eventsWithoutLifecycle.empty()) {
+    return true;
+  }
+  return [super unsubscribe:eventsWithoutLifecycle];
+}
+
 - (bool)eventWasAdded:(es_event_type_t)eventType {
   return _addedEvents[eventType];
 }
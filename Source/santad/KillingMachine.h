@@ -17,11 +17,20 @@
 
 #import <Foundation/Foundation.h>
 
+#include <memory>
+
 #import "Source/common/SNTKillCommand.h"
+#include "Source/common/processtree/process_tree.h"
 
 namespace santa {
 
-SNTKillResponse* KillingMachine(SNTKillRequest* request);
+// Kill the processes described by `request`. When `process_tree` is set,
+// candidates for code signing based requests are looked up in the tree
+// instead of checking every running pid. Candidates are always re-verified
+// against the live process before being killed.
+SNTKillResponse* KillingMachine(
+    SNTKillRequest* request,
+    std::shared_ptr<santad::process_tree::ProcessTree> process_tree = nullptr);
 
 }  // namespace santa
 
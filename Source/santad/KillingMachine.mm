@@ -218,7 +218,10 @@ bool TestStatusFlagsMatcher(pid_t pid, uint32_t mask, CSOpsFunc csops_func) {
 }
 #endif
 
-SNTKillResponse* KillingMachine(SNTKillRequest* request) {
+SNTKillResponse* KillingMachine(SNTKillRequest* request,
+                                std::shared_ptr<santad::process_tree::ProcessTree> process_tree) {
+  using santad::process_tree::CodeSigningField;
+
   NSMutableArray<SNTKilledProcess*>* killedProcs = [NSMutableArray array];
 
   if ([request isKindOfClass:[SNTKillRequestRunningProcess class]]) {
@@ -227,16 +230,16 @@ SNTKillResponse* KillingMachine(SNTKillRequest* request) {
       [killedProcs addObject:killed];
     }
   } else {
-    std::optional<std::vector<pid_t>> pids = GetPidList();
-    if (!pids) {
-      LOGE(@"Unable to get list of running processes");
-      return [[SNTKillResponse alloc] initWithError:SNTKillResponseErrorListPids];
-    }
-
     std::vector<std::unique_ptr<ProcessMatcher>> matchers;
+    // The most selective identifier of the request, used to look up
+    // candidates in the process tree
+    CodeSigningField index_field;
+    NSString* index_value;
 
     // Populate the appropriate matchers for the request
     if ([request isKindOfClass:[SNTKillRequestCDHash class]]) {
+      index_field = CodeSigningField::kCDHash;
+      index_value = ((SNTKillRequestCDHash*)request).cdhash;
       matchers.push_back(MakeCDHashMatcher(((SNTKillRequestCDHash*)request).cdhash));
     } else if ([request isKindOfClass:[SNTKillRequestSigningID class]]) {
       SNTKillRequestSigningID* signingIDRequest = (SNTKillRequestSigningID*)request;
@@ -245,6 +248,8 @@ SNTKillResponse* KillingMachine(SNTKillRequest* request) {
       } else {
         matchers.push_back(MakeTeamIDMatcher(signingIDRequest.teamID));
       }
+      index_field = CodeSigningField::kSigningID;
+      index_value = signingIDRequest.signingID;
       matchers.push_back(MakeSigningIDMatcher(signingIDRequest.signingID));
     } else if ([request isKindOfClass:[SNTKillRequestTeamID class]]) {
       // Don't allow `platform` here as killing all platform binaries is a bad
@@ -253,12 +258,31 @@ SNTKillResponse* KillingMachine(SNTKillRequest* request) {
       if ([teamIDRequest.teamID isEqualToString:kPlatformTeamID]) {
         return [[SNTKillResponse alloc] initWithError:SNTKillResponseErrorInvalidRequest];
       }
+      index_field = CodeSigningField::kTeamID;
+      index_value = teamIDRequest.teamID;
       matchers.push_back(MakeTeamIDMatcher(((SNTKillRequestTeamID*)request).teamID));
     } else {
       LOGE(@"Unexpected request type: %@", [request class]);
       return [[SNTKillResponse alloc] initWithError:SNTKillResponseErrorInvalidRequest];
     }
 
+    std::optional<std::vector<pid_t>> pids;
+    if (process_tree) {
+      // The tree records the code signing info of every exec, so only the few
+      // matching processes need to be checked with csops
+      pids.emplace();
+      for (const auto& pid :
+           process_tree->FindByCodeSigning(index_field, NSStringToUTF8StringView(index_value))) {
+        pids->push_back(pid.pid);
+      }
+    } else {
+      pids = GetPidList();
+      if (!pids) {
+        LOGE(@"Unable to get list of running processes");
+        return [[SNTKillResponse alloc] initWithError:SNTKillResponseErrorListPids];
+      }
+    }
+
     for (pid_t pid : *pids) {
       if (pid == 0) {
         continue;
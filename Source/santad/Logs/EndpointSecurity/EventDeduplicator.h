@@ -0,0 +1,66 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_EVENTDEDUPLICATOR_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_EVENTDEDUPLICATOR_H
+
+#include <EndpointSecurity/EndpointSecurity.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "Source/common/SantaCache.h"
+
+namespace santa {
+
+// Suppresses bursts of identical file change telemetry.
+//
+// The first NOTIFY_CLOSE of a modified file by a given process is logged
+// and starts a window. Further closes of the same file by the same process
+// until the window ends are suppressed, and the next one after it is logged
+// and starts a new window. Windows are tracked in a fixed size cache keyed
+// by a hash of the event type, process and path, so under pressure an entry
+// may be evicted early and the next event logged.
+class EventDeduplicator {
+ public:
+  static constexpr uint64_t kDefaultCapacity = 8192;
+
+  static std::shared_ptr<EventDeduplicator> Create(
+      uint64_t window_nanos, uint64_t capacity = kDefaultCapacity);
+
+  EventDeduplicator(uint64_t window_nanos, uint64_t capacity);
+
+  EventDeduplicator(EventDeduplicator&& other) = delete;
+  EventDeduplicator& operator=(EventDeduplicator&& rhs) = delete;
+  EventDeduplicator(const EventDeduplicator& other) = delete;
+  EventDeduplicator& operator=(const EventDeduplicator& other) = delete;
+
+  // Returns true if the message repeats one logged earlier in its window
+  bool IsDuplicate(const es_message_t* msg);
+
+  // Number of messages suppressed
+  uint64_t SuppressedCount(bool reset);
+
+ private:
+  uint64_t window_mach_;
+  // Maps event key hashes to the mach time their current window started
+  SantaCache<uint64_t, uint64_t> windows_;
+  std::atomic<uint64_t> suppressed_{0};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_EVENTDEDUPLICATOR_H
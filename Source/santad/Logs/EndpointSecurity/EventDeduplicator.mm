@@ -0,0 +1,70 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/EventDeduplicator.h"
+
+#include <bsm/libbsm.h>
+
+#include <string_view>
+#include <tuple>
+
+#include "Source/common/SystemResources.h"
+#include "absl/hash/hash.h"
+
+namespace santa {
+
+std::shared_ptr<EventDeduplicator> EventDeduplicator::Create(uint64_t window_nanos,
+                                                             uint64_t capacity) {
+  return std::make_shared<EventDeduplicator>(window_nanos, capacity);
+}
+
+EventDeduplicator::EventDeduplicator(uint64_t window_nanos, uint64_t capacity)
+    : window_mach_(NanosToMachTime(window_nanos)),
+      windows_(capacity, 5, SantaCacheEvictionPolicy::kClock) {}
+
+bool EventDeduplicator::IsDuplicate(const es_message_t* msg) {
+  if (msg->event_type != ES_EVENT_TYPE_NOTIFY_CLOSE || !msg->event.close.modified) {
+    return false;
+  }
+
+  const es_file_t* target = msg->event.close.target;
+  uint64_t key = absl::Hash<std::tuple<es_event_type_t, pid_t, int, std::string_view>>{}(
+      std::make_tuple(msg->event_type, audit_token_to_pid(msg->process->audit_token),
+                      audit_token_to_pidversion(msg->process->audit_token),
+                      std::string_view(target->path.data, target->path.length)));
+
+  // A zero value means the key was not yet in the cache
+  uint64_t now = msg->mach_time;
+  bool duplicate = false;
+  windows_.update(key, [&](uint64_t& window_start) {
+    if (window_start != 0 && now >= window_start && now - window_start < window_mach_) {
+      duplicate = true;
+    } else {
+      window_start = now ?: 1;
+    }
+  });
+
+  if (duplicate) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return duplicate;
+}
+
+uint64_t EventDeduplicator::SuppressedCount(bool reset) {
+  return reset ? suppressed_.exchange(0, std::memory_order_relaxed)
+               : suppressed_.load(std::memory_order_relaxed);
+}
+
+}  // namespace santa
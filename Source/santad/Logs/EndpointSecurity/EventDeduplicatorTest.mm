@@ -0,0 +1,97 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/EventDeduplicator.h"
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#import <XCTest/XCTest.h>
+
+#include "Source/common/SystemResources.h"
+#include "Source/common/TestUtils.h"
+
+using santa::EventDeduplicator;
+
+@interface EventDeduplicatorTest : XCTestCase
+@end
+
+@implementation EventDeduplicatorTest
+
+- (void)testRepeatedClosesWithinWindow {
+  auto sut = EventDeduplicator::Create(100 * NSEC_PER_MSEC);
+
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34));
+  es_file_t file = MakeESFile("/tmp/out.o");
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  esMsg.event.close.target = &file;
+  esMsg.event.close.modified = true;
+
+  uint64_t start = NanosToMachTime(NSEC_PER_SEC);
+  esMsg.mach_time = start;
+  XCTAssertFalse(sut->IsDuplicate(&esMsg));
+
+  for (int i = 1; i < 10; i++) {
+    esMsg.mach_time = start + NanosToMachTime(i * 10 * NSEC_PER_MSEC - 1);
+    XCTAssertTrue(sut->IsDuplicate(&esMsg));
+  }
+
+  // The first event after the window is logged and starts a new one
+  esMsg.mach_time = start + NanosToMachTime(100 * NSEC_PER_MSEC);
+  XCTAssertFalse(sut->IsDuplicate(&esMsg));
+  esMsg.mach_time += 1;
+  XCTAssertTrue(sut->IsDuplicate(&esMsg));
+
+  XCTAssertEqual(sut->SuppressedCount(true), 10);
+  XCTAssertEqual(sut->SuppressedCount(false), 0);
+}
+
+- (void)testDistinctEventsAreNotSuppressed {
+  auto sut = EventDeduplicator::Create(NSEC_PER_SEC);
+
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34));
+  es_process_t otherProc = MakeESProcess(&procFile, MakeAuditToken(56, 78));
+  es_file_t file = MakeESFile("/tmp/a");
+  es_file_t otherFile = MakeESFile("/tmp/b");
+
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  esMsg.event.close.target = &file;
+  esMsg.event.close.modified = true;
+  esMsg.mach_time = 1000;
+  XCTAssertFalse(sut->IsDuplicate(&esMsg));
+
+  // Different path
+  esMsg.event.close.target = &otherFile;
+  XCTAssertFalse(sut->IsDuplicate(&esMsg));
+
+  // Different process
+  esMsg.event.close.target = &file;
+  esMsg.process = &otherProc;
+  XCTAssertFalse(sut->IsDuplicate(&esMsg));
+
+  // Unmodified closes and other event types are never suppressed
+  esMsg.process = &proc;
+  esMsg.event.close.modified = false;
+  XCTAssertFalse(sut->IsDuplicate(&esMsg));
+
+  es_message_t unlinkMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_UNLINK, &proc);
+  unlinkMsg.event.unlink.target = &file;
+  XCTAssertFalse(sut->IsDuplicate(&unlinkMsg));
+  XCTAssertFalse(sut->IsDuplicate(&unlinkMsg));
+
+  XCTAssertEqual(sut->SuppressedCount(false), 0);
+}
+
+@end
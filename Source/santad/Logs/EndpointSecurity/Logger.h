@@ -20,16 +20,24 @@
 
 #include <atomic>
 #include <memory>
+#include <optional>
 #include <string_view>
 
+#include "Source/common/BackgroundScheduler.h"
 #import "Source/common/SNTCommonEnums.h"
+#include "Source/common/SelfProfiler.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/Timer.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
+#include "Source/common/processtree/process_tree.h"
+#include "Source/common/processtree/process_tree.pb.h"
+#include "Source/santad/Logs/EndpointSecurity/EventDeduplicator.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
+#include "Source/santad/Logs/EndpointSecurity/TelemetryFilter.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/ZstdLevelController.h"
 #import "Source/santad/SNTDecisionCache.h"
 #include "Source/santad/SleighLauncher.h"
 
@@ -87,19 +95,92 @@ class Logger : public Timer<Logger> {
   void LogDiskAppeared(NSDictionary* props, bool allowed);
   void LogDiskDisappeared(NSDictionary* props);
 
+  void LogProcessTreeSnapshot(const ::santa::pb::v1::process_tree::Snapshot& snapshot);
+
+  /// Log a snapshot of `tree` every `interval_secs`, so that consumers can
+  /// rebuild process lineage without replaying every fork and exec. Only the
+  /// protobuf formats carry snapshots. The logger must be owned by a
+  /// shared_ptr.
+  void EnableProcessTreeSnapshots(std::shared_ptr<santa::santad::process_tree::ProcessTree> tree,
+                                  uint32_t interval_secs);
+
   void LogNetworkFlows(SNDProcessFlows* processFlows, struct timespec window_start,
                        struct timespec window_end);
 
+  /// Log the flows of all processes reported for a window, in as few records
+  /// as the log format allows. Busy windows are split so that no record holds
+  /// more than a bounded number of flows.
+  void LogNetworkFlows(NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+                       struct timespec window_end);
+
   virtual void LogFileAccess(const std::string& policy_version, const std::string& policy_name,
                              const santa::Message& msg,
                              const santa::EnrichedProcess& enriched_process, size_t target_index,
                              std::optional<santa::EnrichedFile> enriched_event_target,
                              FileAccessPolicyDecision decision, int64_t rule_id);
 
+  // Serialization statistics for the parallel stage. Depth counts messages
+  // waiting for or undergoing serialization. Drops are counted since the last
+  // reset.
+  struct SerializationStats {
+    int64_t depth;
+    uint64_t dropped;
+  };
+
+  /// Move serialization of messages passed to Log off of the calling thread
+  /// and onto `num_workers` serial queues. Messages about the same process are
+  /// still serialized and written in order. Once `max_depth` messages are
+  /// pending, new messages are dropped. Must be called before the first
+  /// message is logged.
+  static constexpr int64_t kDefaultMaxSerializationDepth = 16384;
+  void EnableParallelSerialization(uint32_t num_workers,
+                                   int64_t max_depth = kDefaultMaxSerializationDepth);
+
+  SerializationStats GetSerializationStats(bool reset);
+
+  /// Install filters used by IsFiltered. Must be called before the first
+  /// message is logged.
+  void SetTelemetryFilter(std::shared_ptr<santa::TelemetryFilter> filter);
+
+  /// Returns true if the message matched a telemetry filter. Callers should
+  /// check this before enriching so that filtered events cost as little as
+  /// possible.
+  inline bool IsFiltered(const santa::Message& msg) {
+    return telemetry_filter_ && telemetry_filter_->ShouldDrop(msg.operator->());
+  }
+
+  /// Install the deduplicator used by IsDuplicate. Must be called before the
+  /// first message is logged.
+  void SetEventDeduplicator(std::shared_ptr<santa::EventDeduplicator> deduplicator);
+
+  /// Returns true if the message repeats a recently logged one and should not
+  /// be logged. Like IsFiltered, callers should check this before enriching.
+  inline bool IsDuplicate(const santa::Message& msg) {
+    return event_deduplicator_ && event_deduplicator_->IsDuplicate(msg.operator->());
+  }
+
+  /// Stats for the adaptive zstd compression level, or nullopt if the logger
+  /// isn't using it.
+  std::optional<santa::ZstdLevelController::Stats> GetCompressionStats(bool reset);
+
   void Flush();
 
+  /// Approximate bytes held in memory by the writer for events that have
+  /// been serialized, including buffers pooled for reuse.
+  size_t BufferedBytes();
+
+  /// Free buffers the writer has pooled for reuse.
+  void TrimBuffers();
+
   void SetTelemetryMask(TelemetryEvent mask);
 
+  /// Call `observer` with the new mask each time SetTelemetryMask is called,
+  /// e.g. so that clients can update their ES subscriptions. Must be set
+  /// before the mask is first changed.
+  void SetTelemetryMaskObserver(void (^observer)(TelemetryEvent));
+
+  inline TelemetryEvent GetTelemetryMask() const { return telemetry_mask_; }
+
   inline bool ShouldLog(TelemetryEvent event) { return ((event & telemetry_mask_) == event); }
 
   void UpdateMachineIDLogging() const;
@@ -109,6 +190,29 @@ class Logger : public Timer<Logger> {
   /// Export existing telemetry files.
   void ExportTelemetry();
 
+  /// Hold periodic exports in `scheduler` while the machine is on battery or
+  /// otherwise busy. Exports requested directly are not affected. Must be set
+  /// before the export timer is started.
+  void SetBackgroundScheduler(santa::BackgroundScheduler* scheduler);
+
+  /// Export telemetry shortly after the writer finalizes each new file rather
+  /// than only on the export timer. Files finalized close together are
+  /// exported by one Sleigh launch. Nothing is exported while
+  /// `export_enabled_f` returns false. The logger must be owned by a
+  /// shared_ptr.
+  void EnableStreamingExport(bool (^export_enabled_f)(void));
+
+  // Export statistics. Bytes and files are counted since the last reset.
+  // Backlog age is how long the oldest file still waiting to be exported has
+  // been waiting, or zero if nothing is waiting.
+  struct ExportStats {
+    uint64_t bytes_exported;
+    uint64_t files_exported;
+    double backlog_age_seconds;
+  };
+
+  ExportStats GetExportStats(bool reset);
+
   void SetBatchThresholdSizeMB(uint32_t val);
   void SetMaxFilesPerBatch(uint32_t val);
   void SetTelmetryExportTimeoutSecs(uint32_t val);
@@ -116,11 +220,14 @@ class Logger : public Timer<Logger> {
   friend class santa::LoggerPeer;
 
  private:
+  class SerializationStage;
+
   class ExportTracker {
    public:
     static ExportTracker Create() {
       dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.export_tracker",
                                                  DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+      SelfProfiler::Shared().RegisterQueue(q, "export");
       return ExportTracker(q);
     }
 
@@ -167,13 +274,23 @@ class Logger : public Timer<Logger> {
   std::unique_ptr<santa::SleighLauncher> sleigh_launcher_;
   GetExportConfigBlock get_export_config_block_;
   TelemetryEvent telemetry_mask_;
+  void (^telemetry_mask_observer_)(TelemetryEvent);
   std::shared_ptr<santa::Serializer> serializer_;
   std::shared_ptr<santa::Writer> writer_;
   ExportTracker tracker_;
   std::unique_ptr<std::atomic_uint64_t> export_batch_threshold_size_bytes_;
   std::unique_ptr<std::atomic_uint32_t> export_max_files_per_batch_;
   std::unique_ptr<std::atomic_uint32_t> export_timeout_secs_;
+  std::unique_ptr<std::atomic_bool> streaming_export_pending_;
+  std::unique_ptr<std::atomic_uint64_t> bytes_exported_;
+  std::unique_ptr<std::atomic_uint64_t> files_exported_;
   dispatch_queue_t export_queue_;
+  std::shared_ptr<SerializationStage> serialization_stage_;
+  std::shared_ptr<santa::TelemetryFilter> telemetry_filter_;
+  std::shared_ptr<santa::EventDeduplicator> event_deduplicator_;
+  std::shared_ptr<santa::ZstdLevelController> zstd_level_controller_;
+  dispatch_source_t process_tree_snapshot_timer_;
+  santa::BackgroundScheduler* background_scheduler_ = nullptr;
 };
 
 }  // namespace santa
@@ -22,19 +22,24 @@
 #include <atomic>
 #include <memory>
 #include <utility>
+#include <variant>
 
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTExportConfiguration.h"
+#include "Source/common/AuditUtilities.h"
 #include "Source/common/SNTLogging.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTSystemInfo.h"
 #include "Source/common/TelemetryEventMap.h"
+#include "Source/common/es/ShardedQueue.h"
+#include "Source/common/processtree/snapshot.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/BasicString.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Empty.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
@@ -44,6 +49,7 @@
 #import "Source/santad/SNTDecisionCache.h"
 #include "Source/santad/SleighLauncher.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
 
 namespace santa {
 
@@ -57,6 +63,17 @@ static constexpr size_t kMaxExpectedWriteSizeBytes = 4096;
 // Semi-arbitrary. Goal is to protect against too much strain on the export path.
 static constexpr uint32_t kMinTelemetryExportIntervalSecs = 60;
 static constexpr uint32_t kMaxTelemetryExportIntervalSecs = 3600;
+// Periodic exports held by the background scheduler run after this long
+static constexpr uint64_t kMaxTelemetryExportDelayNanos = 3600 * NSEC_PER_SEC;
+// Streaming exports wait this long after a file is finalized so that files
+// finalized close together are exported by a single Sleigh launch
+static constexpr uint64_t kStreamingExportDelayNanos = 1 * NSEC_PER_SEC;
+// Longest a batched syslog line waits for the rest of its batch
+static constexpr uint64_t kSyslogBatchTimeoutMS = 1000;
+// Network flow windows are split into records of at most this many flows
+static constexpr size_t kMaxNetworkFlowsPerRecord = 1000;
+// Maximum time Flush waits for the parallel serialization stage to drain
+static constexpr uint64_t kSerializationDrainTimeoutNanos = 5 * NSEC_PER_SEC;
 
 // Translate configured log type to appropriate Serializer/Writer pairs
 std::unique_ptr<Logger> Logger::Create(
@@ -70,6 +87,12 @@ std::unique_ptr<Logger> Logger::Create(
     uint32_t telemetry_export_max_files_per_batch) {
   std::shared_ptr<santa::Serializer> serializer;
   std::shared_ptr<santa::Writer> writer;
+  std::shared_ptr<ZstdLevelController> zstd_level_controller;
+  BOOL write_batch_index = [[SNTConfigurator configurator] enableEventLogBatchIndex];
+  ::fsspool::StreamRecordFormat record_format =
+      [[SNTConfigurator configurator] enableEventLogFrameChecksums]
+          ? ::fsspool::StreamRecordFormat::kFrameChecksum
+          : ::fsspool::StreamRecordFormat::kRecordChecksum;
 
   switch (log_type) {
     case SNTEventLogTypeFilelog:
@@ -79,7 +102,9 @@ std::unique_ptr<Logger> Logger::Create(
       break;
     case SNTEventLogTypeSyslog:
       serializer = BasicString::Create(esapi, std::move(decision_cache), false);
-      writer = Syslog::Create();
+      writer = [[SNTConfigurator configurator] enableSyslogBatching]
+                   ? Syslog::CreateBatched(kSyslogBatchTimeoutMS)
+                   : Syslog::Create();
       break;
     case SNTEventLogTypeNull:
       serializer = Empty::Create();
@@ -91,30 +116,68 @@ std::unique_ptr<Logger> Logger::Create(
           ::fsspool::AnyBatcher(), [spool_log_path UTF8String], spool_dir_size_threshold,
           spool_file_size_threshold, spool_flush_timeout_ms);
       break;
+    case SNTEventLogTypeProtobufColumnar:
+      serializer = Protobuf::Create(esapi, std::move(decision_cache));
+      writer = Spool<::fsspool::ColumnarBatcher>::Create(
+          ::fsspool::ColumnarBatcher(
+              [[SNTConfigurator configurator] enableColumnarProcessDictionary]),
+          [spool_log_path UTF8String], spool_dir_size_threshold, spool_file_size_threshold,
+          spool_flush_timeout_ms);
+      break;
     case SNTEventLogTypeProtobufStream:
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
       writer = Spool<::fsspool::UncompressedStreamBatcher>::Create(
-          ::fsspool::UncompressedStreamBatcher(), [spool_log_path UTF8String],
+          ::fsspool::UncompressedStreamBatcher(write_batch_index), [spool_log_path UTF8String],
           spool_dir_size_threshold, spool_file_size_threshold, spool_flush_timeout_ms);
       break;
     case SNTEventLogTypeProtobufStreamGzip:
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
       writer = Spool<::fsspool::GzipStreamBatcher>::Create(
-          ::fsspool::GzipStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
-            return std::make_shared<google::protobuf::io::GzipOutputStream>(raw_stream);
-          }),
+          ::fsspool::GzipStreamBatcher(
+              ^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
+                return std::make_shared<google::protobuf::io::GzipOutputStream>(raw_stream);
+              },
+              write_batch_index, record_format),
           [spool_log_path UTF8String], spool_dir_size_threshold, spool_file_size_threshold,
           spool_flush_timeout_ms);
       break;
-    case SNTEventLogTypeProtobufStreamZstd:
+    case SNTEventLogTypeProtobufStreamZstd: {
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
-      writer = Spool<::fsspool::ZstdStreamBatcher>::Create(
-          ::fsspool::ZstdStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
-            return ::fsspool::ZstdOutputStream::Create(raw_stream);
-          }),
+      ::fsspool::ZstdOutputStream::Dictionary dictionary;
+      NSString* dictionary_path = [[SNTConfigurator configurator] eventLogZstdDictionaryPath];
+      if (dictionary_path.length) {
+        dictionary = ::fsspool::ZstdOutputStream::LoadDictionary(dictionary_path.UTF8String);
+        if (!dictionary) {
+          LOGW(@"Unable to load zstd dictionary from %@, compressing without one",
+               dictionary_path);
+        }
+      }
+      if ([[SNTConfigurator configurator] enableAdaptiveEventLogCompression]) {
+        zstd_level_controller = ZstdLevelController::Create();
+      }
+      std::shared_ptr<ZstdLevelController> controller = zstd_level_controller;
+      auto spool = Spool<::fsspool::ZstdStreamBatcher>::Create(
+          ::fsspool::ZstdStreamBatcher(
+              ^std::shared_ptr<::fsspool::ZstdOutputStream>(
+                  google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
+                if (controller) {
+                  return controller->CreateStream(raw_stream, dictionary);
+                }
+                return ::fsspool::ZstdOutputStream::Create(
+                    raw_stream, ZSTD_CLEVEL_DEFAULT,
+                    ::fsspool::ZstdOutputStream::kDefaultBufferSize, dictionary);
+              },
+              write_batch_index, record_format),
           [spool_log_path UTF8String], spool_dir_size_threshold, spool_file_size_threshold,
           spool_flush_timeout_ms);
+      if (controller) {
+        spool->SetSpoolUsageObserver(^(double usage) {
+          controller->Update(usage);
+        });
+      }
+      writer = std::move(spool);
       break;
+    }
     case SNTEventLogTypeJSON:
       serializer = Protobuf::Create(esapi, std::move(decision_cache), true);
       writer = File::Create(event_log_path, kFlushBufferTimeoutMS, kBufferBatchSizeBytes,
@@ -128,6 +191,7 @@ std::unique_ptr<Logger> Logger::Create(
       telemetry_export_timeout_seconds, telemetry_export_batch_threshold_size_mb,
       telemetry_export_max_files_per_batch, std::move(serializer), std::move(writer));
 
+  logger->zstd_level_controller_ = std::move(zstd_level_controller);
   logger->SetTimerInterval(telemetry_export_seconds);
 
   return logger;
@@ -150,7 +214,10 @@ Logger::Logger(std::unique_ptr<santa::SleighLauncher> sleigh_launcher,
       tracker_(ExportTracker::Create()),
       export_batch_threshold_size_bytes_(std::make_unique<std::atomic_uint64_t>()),
       export_max_files_per_batch_(std::make_unique<std::atomic_uint32_t>()),
-      export_timeout_secs_(std::make_unique<std::atomic_uint32_t>()) {
+      export_timeout_secs_(std::make_unique<std::atomic_uint32_t>()),
+      streaming_export_pending_(std::make_unique<std::atomic_bool>(false)),
+      bytes_exported_(std::make_unique<std::atomic_uint64_t>(0)),
+      files_exported_(std::make_unique<std::atomic_uint64_t>(0)) {
   // Provide a default block instead of leaving nil
   if (get_export_config_block_ == nil) {
     get_export_config_block_ = ^SNTExportConfiguration*() {
@@ -158,8 +225,14 @@ Logger::Logger(std::unique_ptr<santa::SleighLauncher> sleigh_launcher,
     };
   }
 
+  if (serializer_ && writer_) {
+    serializer_->SetBufferPool(writer_->GetBufferPool());
+  }
+
   export_queue_ = dispatch_queue_create("com.northpolesec.santa.daemon.export",
                                         DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+  SelfProfiler::Shared().RegisterQueue(export_queue_, "export");
+  SelfProfiler::Shared().RegisterQueue(TimerQueue(), "export");
 
   SetBatchThresholdSizeMB(telemetry_export_batch_threshold_size_mb);
   SetMaxFilesPerBatch(telemetry_export_max_files_per_batch);
@@ -213,19 +286,80 @@ void Logger::SetTelmetryExportTimeoutSecs(uint32_t val) {
 
 void Logger::SetTelemetryMask(TelemetryEvent mask) {
   telemetry_mask_ = mask;
+  if (telemetry_mask_observer_) {
+    telemetry_mask_observer_(mask);
+  }
+}
+
+void Logger::SetTelemetryMaskObserver(void (^observer)(TelemetryEvent)) {
+  telemetry_mask_observer_ = observer;
 }
 
 bool Logger::OnTimer() {
-  ExportTelemetry();
+  if (!background_scheduler_) {
+    ExportTelemetry();
+    return true;
+  }
+
+  std::weak_ptr<Logger> weak_logger = weak_from_base<Logger>();
+  background_scheduler_->Submit("telemetry_export", kMaxTelemetryExportDelayNanos, export_queue_,
+                                ^{
+                                  if (std::shared_ptr<Logger> logger = weak_logger.lock()) {
+                                    logger->ExportTelemetrySerialized();
+                                  }
+                                });
   return true;
 }
 
+void Logger::SetBackgroundScheduler(BackgroundScheduler* scheduler) {
+  background_scheduler_ = scheduler;
+}
+
 void Logger::ExportTelemetry() {
   dispatch_sync(export_queue_, ^{
     ExportTelemetrySerialized();
   });
 }
 
+void Logger::EnableStreamingExport(bool (^export_enabled_f)(void)) {
+  std::weak_ptr<Logger> weak_logger = weak_from_base<Logger>();
+  writer_->SetFileFinalizedObserver(^{
+    std::shared_ptr<Logger> logger = weak_logger.lock();
+    if (!logger || logger->streaming_export_pending_->exchange(true)) {
+      // An export is already scheduled and will pick up this file
+      return;
+    }
+
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kStreamingExportDelayNanos),
+                   logger->export_queue_, ^{
+                     std::shared_ptr<Logger> pending_logger = weak_logger.lock();
+                     if (!pending_logger) {
+                       return;
+                     }
+
+                     pending_logger->streaming_export_pending_->store(false);
+                     if (export_enabled_f()) {
+                       pending_logger->ExportTelemetrySerialized();
+                     }
+                   });
+  });
+}
+
+Logger::ExportStats Logger::GetExportStats(bool reset) {
+  double backlog_age_seconds = 0;
+  if (std::optional<absl::Time> oldest = writer_->OldestFileToExportTime()) {
+    backlog_age_seconds = std::max(0.0, absl::ToDoubleSeconds(absl::Now() - *oldest));
+  }
+
+  return ExportStats{
+      .bytes_exported = reset ? bytes_exported_->exchange(0, std::memory_order_relaxed)
+                              : bytes_exported_->load(std::memory_order_relaxed),
+      .files_exported = reset ? files_exported_->exchange(0, std::memory_order_relaxed)
+                              : files_exported_->load(std::memory_order_relaxed),
+      .backlog_age_seconds = backlog_age_seconds,
+  };
+}
+
 void Logger::ExportTelemetrySerialized() {
   // Check if sleigh launcher is available
   if (!sleigh_launcher_) {
@@ -294,6 +428,8 @@ void Logger::ExportTelemetrySerialized() {
 
     if (result.ok()) {
       LOGD(@"Successfully exported %zu telemetry files via sleigh", files_to_export.size());
+      bytes_exported_->fetch_add(total_bytes, std::memory_order_relaxed);
+      files_exported_->fetch_add(files_to_export.size(), std::memory_order_relaxed);
       for (const auto& file : files_to_export) {
         tracker_.AckCompleted(file);
       }
@@ -307,8 +443,111 @@ void Logger::ExportTelemetrySerialized() {
   }
 }
 
+// Messages about the same process are serialized in order. Forks are keyed on
+// the child so that they are written ahead of the child's own events.
+static uint64_t SerializationKey(EnrichedMessage& msg) {
+  return std::visit(
+      [](const EnrichedEventType& event) -> uint64_t {
+        if (event->event_type == ES_EVENT_TYPE_NOTIFY_FORK) {
+          return Pid(event->event.fork.child->audit_token);
+        }
+        return Pid(event->process->audit_token);
+      },
+      msg.GetEnrichedMessage());
+}
+
+class Logger::SerializationStage : public std::enable_shared_from_this<SerializationStage> {
+ public:
+  SerializationStage(uint32_t num_workers, int64_t max_depth)
+      : shards_(ShardedQueue::Create("com.northpolesec.santa.daemon.serialize", num_workers,
+                                     QOS_CLASS_UTILITY)),
+        max_depth_(max_depth),
+        group_(dispatch_group_create()) {
+    for (uint32_t i = 0; i < shards_->NumShards(); i++) {
+      SelfProfiler::Shared().RegisterQueue(shards_->Queue(i), "serialize");
+    }
+  }
+
+  void Submit(std::unique_ptr<EnrichedMessage> msg, std::shared_ptr<Serializer> serializer,
+              std::shared_ptr<Writer> writer) {
+    if (depth_.fetch_add(1, std::memory_order_relaxed) >= max_depth_) {
+      depth_.fetch_sub(1, std::memory_order_relaxed);
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    uint64_t key = SerializationKey(*msg);
+
+    // Blocks cannot capture move-only types, ownership is retaken in the block
+    EnrichedMessage* raw_msg = msg.release();
+    std::shared_ptr<SerializationStage> self = shared_from_this();
+    dispatch_group_enter(group_);
+    shards_->Dispatch(key, ^(ShardedQueue::DispatchInfo info) {
+      writer->Write(serializer->SerializeMessage(std::unique_ptr<EnrichedMessage>(raw_msg)));
+      self->depth_.fetch_sub(1, std::memory_order_relaxed);
+      dispatch_group_leave(self->group_);
+    });
+  }
+
+  // Wait for all submitted messages to be written. Returns false on timeout.
+  bool Drain(uint64_t timeout_nanos) {
+    return dispatch_group_wait(group_, dispatch_time(DISPATCH_TIME_NOW, timeout_nanos)) == 0;
+  }
+
+  SerializationStats GetStats(bool reset) {
+    return SerializationStats{
+        .depth = depth_.load(std::memory_order_relaxed),
+        .dropped = reset ? dropped_.exchange(0, std::memory_order_relaxed)
+                         : dropped_.load(std::memory_order_relaxed),
+    };
+  }
+
+ private:
+  std::shared_ptr<ShardedQueue> shards_;
+  const int64_t max_depth_;
+  std::atomic<int64_t> depth_{0};
+  std::atomic<uint64_t> dropped_{0};
+  dispatch_group_t group_;
+};
+
+void Logger::EnableParallelSerialization(uint32_t num_workers, int64_t max_depth) {
+  if (num_workers == 0) {
+    serialization_stage_.reset();
+    return;
+  }
+  serialization_stage_ = std::make_shared<SerializationStage>(num_workers, max_depth);
+}
+
+Logger::SerializationStats Logger::GetSerializationStats(bool reset) {
+  if (!serialization_stage_) {
+    return SerializationStats{};
+  }
+  return serialization_stage_->GetStats(reset);
+}
+
+std::optional<ZstdLevelController::Stats> Logger::GetCompressionStats(bool reset) {
+  if (!zstd_level_controller_) {
+    return std::nullopt;
+  }
+  return zstd_level_controller_->GetStats(reset);
+}
+
+void Logger::SetTelemetryFilter(std::shared_ptr<TelemetryFilter> filter) {
+  telemetry_filter_ = std::move(filter);
+}
+
+void Logger::SetEventDeduplicator(std::shared_ptr<EventDeduplicator> deduplicator) {
+  event_deduplicator_ = std::move(deduplicator);
+}
+
 void Logger::Log(std::unique_ptr<EnrichedMessage> msg) {
-  if (ShouldLog(msg->GetTelemetryEvent())) {
+  if (!ShouldLog(msg->GetTelemetryEvent())) {
+    return;
+  }
+
+  if (serialization_stage_) {
+    serialization_stage_->Submit(std::move(msg), serializer_, writer_);
+  } else {
     writer_->Write(serializer_->SerializeMessage(std::move(msg)));
   }
 }
@@ -340,9 +579,50 @@ void Logger::LogDiskDisappeared(NSDictionary* props) {
   }
 }
 
+void Logger::LogProcessTreeSnapshot(const ::santa::pb::v1::process_tree::Snapshot& snapshot) {
+  std::vector<uint8_t> bytes = serializer_->SerializeProcessTreeSnapshot(snapshot);
+  if (!bytes.empty()) {
+    writer_->Write(std::move(bytes));
+  }
+}
+
+void Logger::EnableProcessTreeSnapshots(
+    std::shared_ptr<santa::santad::process_tree::ProcessTree> tree, uint32_t interval_secs) {
+  if (process_tree_snapshot_timer_ || !tree || interval_secs == 0) {
+    return;
+  }
+
+  // Timer handlers never run concurrently, so the encoder needs no locking
+  auto encoder = std::make_shared<santa::santad::process_tree::SnapshotEncoder>();
+  std::weak_ptr<Logger> weak_logger = weak_from_base<Logger>();
+
+  process_tree_snapshot_timer_ = dispatch_source_create(
+      DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+  dispatch_source_set_event_handler(process_tree_snapshot_timer_, ^{
+    std::shared_ptr<Logger> logger = weak_logger.lock();
+    if (!logger) {
+      return;
+    }
+    logger->LogProcessTreeSnapshot(encoder->Next(*tree));
+  });
+
+  uint64_t interval_nanos = interval_secs * NSEC_PER_SEC;
+  dispatch_source_set_timer(process_tree_snapshot_timer_,
+                            dispatch_time(DISPATCH_TIME_NOW, interval_nanos), interval_nanos,
+                            interval_nanos / 10);
+  dispatch_resume(process_tree_snapshot_timer_);
+}
+
 void Logger::LogNetworkFlows(SNDProcessFlows* processFlows, struct timespec window_start,
                              struct timespec window_end) {
-  writer_->Write(serializer_->SerializeNetworkFlows(processFlows, window_start, window_end));
+  LogNetworkFlows(@[ processFlows ], window_start, window_end);
+}
+
+void Logger::LogNetworkFlows(NSArray<SNDProcessFlows*>* processFlows,
+                             struct timespec window_start, struct timespec window_end) {
+  serializer_->SerializeNetworkFlowsChunked(
+      processFlows, window_start, window_end, kMaxNetworkFlowsPerRecord,
+      [this](std::vector<uint8_t>&& bytes) { writer_->Write(std::move(bytes)); });
 }
 
 void Logger::LogFileAccess(const std::string& policy_version, const std::string& policy_name,
@@ -358,9 +638,22 @@ void Logger::LogFileAccess(const std::string& policy_version, const std::string&
 }
 
 void Logger::Flush() {
+  if (serialization_stage_ && !serialization_stage_->Drain(kSerializationDrainTimeoutNanos)) {
+    LOGW(@"Timed out waiting for pending messages to be serialized before flushing");
+  }
   writer_->Flush();
 }
 
+size_t Logger::BufferedBytes() {
+  return writer_->BufferedBytes();
+}
+
+void Logger::TrimBuffers() {
+  if (std::shared_ptr<BufferPool> pool = writer_->GetBufferPool()) {
+    pool->Trim();
+  }
+}
+
 void Logger::UpdateMachineIDLogging() const {
   serializer_->UpdateMachineID();
 }
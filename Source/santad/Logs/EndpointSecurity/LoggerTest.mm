@@ -16,10 +16,13 @@
 #import <Foundation/Foundation.h>
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
+#include <bsm/libbsm.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string_view>
 #include <utility>
@@ -38,6 +41,7 @@
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Null.h"
@@ -102,6 +106,8 @@ class MockSerializer : public Empty {
   MOCK_METHOD(std::vector<uint8_t>, SerializeBundleHashingEvent, (SNTStoredExecutionEvent*));
   MOCK_METHOD(std::vector<uint8_t>, SerializeDiskAppeared, (NSDictionary*, bool));
   MOCK_METHOD(std::vector<uint8_t>, SerializeDiskDisappeared, (NSDictionary*));
+  MOCK_METHOD(std::vector<uint8_t>, SerializeProcessTreeSnapshot,
+              (const ::santa::pb::v1::process_tree::Snapshot&));
 
   MOCK_METHOD(std::vector<uint8_t>, SerializeFileAccess,
               (const std::string& policy_version, const std::string& policy_name,
@@ -125,6 +131,8 @@ class MockWriter : public santa::Writer {
   MOCK_METHOD(std::optional<std::string>, NextFileToExport, (), (override));
   MOCK_METHOD(void, FilesExported, ((absl::flat_hash_map<std::string, bool> files_exported)),
               (override));
+  MOCK_METHOD(void, SetFileFinalizedObserver, (void (^file_finalized_f)(void)), (override));
+  MOCK_METHOD(std::optional<absl::Time>, OldestFileToExportTime, (), (override));
 };
 
 class MockSleighLauncher : public santa::SleighLauncher {
@@ -246,6 +254,13 @@ class MockSleighLauncher : public santa::SleighLauncher {
   XCTAssertNotEqual(nullptr,
                     std::dynamic_pointer_cast<Spool<::fsspool::ZstdStreamBatcher>>(logger.writer_));
 
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, TelemetryEvent::kEverything,
+                                     SNTEventLogTypeProtobufColumnar, nil, @"/tmp/temppy",
+                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1));
+  XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
+  XCTAssertNotEqual(nullptr,
+                    std::dynamic_pointer_cast<Spool<::fsspool::ColumnarBatcher>>(logger.writer_));
+
   logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeJSON, nil, @"/tmp/temppy", @"/tmp/spool", 1, 1,
                                      1, 1, 1, 1, 1));
@@ -282,6 +297,123 @@ class MockSleighLauncher : public santa::SleighLauncher {
   XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
 }
 
+static std::unique_ptr<EnrichedMessage> MakeEnrichedClose(
+    std::shared_ptr<MockEndpointSecurityAPI> esapi, es_message_t* esMsg) {
+  return std::make_unique<EnrichedMessage>(EnrichedClose(
+      Message(esapi, esMsg),
+      EnrichedProcess(std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+                      EnrichedFile(std::nullopt, std::nullopt, std::nullopt), std::nullopt),
+      EnrichedFile(std::nullopt, std::nullopt, std::nullopt)));
+}
+
+- (void)testLogParallelSerialization {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  auto mockSerializer = std::make_shared<MockSerializer>();
+  auto mockWriter = std::make_shared<MockWriter>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  const int kMessagesPerProc = 100;
+  es_file_t file = MakeESFile("foo");
+  es_process_t procs[] = {
+      MakeESProcess(&file, MakeAuditToken(1, 1)),
+      MakeESProcess(&file, MakeAuditToken(2, 1)),
+  };
+
+  std::vector<es_message_t> esMsgs;
+  for (int i = 0; i < kMessagesPerProc; i++) {
+    for (es_process_t& proc : procs) {
+      es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+      esMsg.seq_num = i;
+      esMsgs.push_back(esMsg);
+    }
+  }
+
+  // The serialized bytes record the pid and sequence number of each message
+  EXPECT_CALL(*mockSerializer, SerializeMessage(testing::A<const EnrichedClose&>()))
+      .WillRepeatedly([](const EnrichedClose& msg) {
+        return std::vector<uint8_t>{(uint8_t)audit_token_to_pid(msg->process->audit_token),
+                                    (uint8_t)msg->seq_num};
+      });
+
+  std::mutex mtx;
+  std::map<uint8_t, std::vector<uint8_t>> written;
+  EXPECT_CALL(*mockWriter, Write)
+      .Times((int)esMsgs.size())
+      .WillRepeatedly([&](std::vector<uint8_t>&& bytes) {
+        std::lock_guard<std::mutex> lock(mtx);
+        written[bytes[0]].push_back(bytes[1]);
+      });
+  EXPECT_CALL(*mockWriter, Flush).Times(1);
+
+  Logger logger(nil, nil, TelemetryEvent::kEverything, 1, 1, 1, mockSerializer, mockWriter);
+  logger.EnableParallelSerialization(4);
+
+  for (es_message_t& esMsg : esMsgs) {
+    logger.Log(MakeEnrichedClose(mockESApi, &esMsg));
+  }
+  logger.Flush();
+
+  // Messages from the same process are written in the order they were logged
+  XCTAssertEqual(written.size(), 2);
+  for (const auto& [pid, seqs] : written) {
+    XCTAssertEqual(seqs.size(), kMessagesPerProc);
+    for (int i = 0; i < kMessagesPerProc; i++) {
+      XCTAssertEqual(seqs[i], i);
+    }
+  }
+
+  Logger::SerializationStats stats = logger.GetSerializationStats(false);
+  XCTAssertEqual(stats.depth, 0);
+  XCTAssertEqual(stats.dropped, 0);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
+- (void)testLogParallelSerializationDropsWhenFull {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  auto mockSerializer = std::make_shared<MockSerializer>();
+  auto mockWriter = std::make_shared<MockWriter>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  es_file_t file = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&file, MakeAuditToken(1, 1));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+
+  // Hold the only slot until the remaining messages have been dropped
+  dispatch_semaphore_t release = dispatch_semaphore_create(0);
+  EXPECT_CALL(*mockSerializer, SerializeMessage(testing::A<const EnrichedClose&>()))
+      .WillOnce([&](const EnrichedClose&) {
+        dispatch_semaphore_wait(release, DISPATCH_TIME_FOREVER);
+        return std::vector<uint8_t>{};
+      });
+  EXPECT_CALL(*mockWriter, Write).Times(1);
+  EXPECT_CALL(*mockWriter, Flush).Times(1);
+
+  Logger logger(nil, nil, TelemetryEvent::kEverything, 1, 1, 1, mockSerializer, mockWriter);
+  logger.EnableParallelSerialization(2, 1);
+
+  for (int i = 0; i < 3; i++) {
+    logger.Log(MakeEnrichedClose(mockESApi, &esMsg));
+  }
+
+  Logger::SerializationStats stats = logger.GetSerializationStats(true);
+  XCTAssertEqual(stats.depth, 1);
+  XCTAssertEqual(stats.dropped, 2);
+
+  dispatch_semaphore_signal(release);
+  logger.Flush();
+
+  stats = logger.GetSerializationStats(true);
+  XCTAssertEqual(stats.depth, 0);
+  XCTAssertEqual(stats.dropped, 0);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
 - (void)testLogAllowList {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   auto mockSerializer = std::make_shared<MockSerializer>();
@@ -345,6 +477,24 @@ class MockSleighLauncher : public santa::SleighLauncher {
   XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
 }
 
+- (void)testLogProcessTreeSnapshot {
+  auto mockSerializer = std::make_shared<MockSerializer>();
+  auto mockWriter = std::make_shared<MockWriter>();
+
+  EXPECT_CALL(*mockSerializer, SerializeProcessTreeSnapshot)
+      .WillOnce(testing::Return(std::vector<uint8_t>{1, 2, 3}))
+      .WillOnce(testing::Return(std::vector<uint8_t>{}));
+  // Formats that don't carry snapshots aren't written
+  EXPECT_CALL(*mockWriter, Write).Times(1);
+
+  Logger logger(nil, nil, TelemetryEvent::kEverything, 1, 1, 1, mockSerializer, mockWriter);
+  logger.LogProcessTreeSnapshot({});
+  logger.LogProcessTreeSnapshot({});
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
 - (void)testLogFileAccess {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   auto mockSerializer = std::make_shared<MockSerializer>();
@@ -368,6 +518,27 @@ class MockSleighLauncher : public santa::SleighLauncher {
   XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
 }
 
+- (void)testTelemetryMaskObserver {
+  Logger logger(nil, nil, TelemetryEvent::kEverything, 1, 1, 1, nullptr, nullptr);
+
+  // Changing the mask without an observer is fine
+  logger.SetTelemetryMask(TelemetryEvent::kExecution);
+  XCTAssertEqual(logger.GetTelemetryMask(), TelemetryEvent::kExecution);
+
+  __block int calls = 0;
+  __block TelemetryEvent gotMask = TelemetryEvent::kNone;
+  logger.SetTelemetryMaskObserver(^(TelemetryEvent mask) {
+    calls++;
+    gotMask = mask;
+  });
+
+  logger.SetTelemetryMask(TelemetryEvent::kFork | TelemetryEvent::kExit);
+  XCTAssertEqual(calls, 1);
+  XCTAssertEqual(gotMask, TelemetryEvent::kFork | TelemetryEvent::kExit);
+  XCTAssertTrue(logger.ShouldLog(TelemetryEvent::kFork));
+  XCTAssertFalse(logger.ShouldLog(TelemetryEvent::kExecution));
+}
+
 - (void)testExportTracker {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   LoggerPeer logger(Logger::Create(mockESApi, nil, nil, TelemetryEvent::kEverything,
@@ -557,6 +728,96 @@ class MockSleighLauncher : public santa::SleighLauncher {
   XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
 }
 
+- (void)testStreamingExport {
+  auto mockWriter = std::make_shared<MockWriter>();
+  auto mockSleigh = std::make_unique<MockSleighLauncher>();
+  MockSleighLauncher* mockSleighPtr = mockSleigh.get();
+
+  NSString* f1 = [self createTestFile:@"f1" contentSize:5 type:ExportLogType::kZstdStream];
+  NSString* f2 = [self createTestFile:@"f2" contentSize:10 type:ExportLogType::kZstdStream];
+
+  __block void (^fileFinalized)(void);
+  EXPECT_CALL(*mockWriter, SetFileFinalizedObserver)
+      .WillOnce([&fileFinalized](void (^f)(void)) {
+        fileFinalized = f;
+      });
+
+  auto l = std::make_shared<LoggerPeer>(std::move(mockSleigh), self.exportConfigBlock,
+                                        TelemetryEvent::kEverything, 5, 1, 10, nullptr, mockWriter);
+  l->EnableStreamingExport(^bool {
+    return true;
+  });
+  XCTAssertNotNil(fileFinalized);
+
+  // Both files are exported by a single Sleigh launch
+  EXPECT_CALL(*mockSleighPtr, LaunchTelemetryExport).WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(*mockWriter, NextFileToExport)
+      .WillOnce(Return(f1.UTF8String))
+      .WillOnce(Return(f2.UTF8String))
+      .WillOnce(Return(std::nullopt));
+
+  XCTestExpectation* exported = [self expectationWithDescription:@"Files exported"];
+  EXPECT_CALL(*mockWriter, FilesExported(UnorderedElementsAre(Pair(f1.UTF8String, true),
+                                                              Pair(f2.UTF8String, true))))
+      .WillOnce([exported](absl::flat_hash_map<std::string, bool>) {
+        [exported fulfill];
+      });
+
+  // Files finalized close together are coalesced into one export
+  fileFinalized();
+  fileFinalized();
+
+  [self waitForExpectations:@[ exported ] timeout:5.0];
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSleighPtr);
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
+- (void)testExportStats {
+  auto mockWriter = std::make_shared<MockWriter>();
+  auto mockSleigh = std::make_unique<MockSleighLauncher>();
+  MockSleighLauncher* mockSleighPtr = mockSleigh.get();
+
+  NSString* f1 = [self createTestFile:@"f1" contentSize:5 type:ExportLogType::kZstdStream];
+  NSString* f2 = [self createTestFile:@"f2" contentSize:10 type:ExportLogType::kZstdStream];
+
+  LoggerPeer l(std::move(mockSleigh), self.exportConfigBlock, TelemetryEvent::kEverything, 5, 1, 10,
+               nullptr, mockWriter);
+
+  EXPECT_CALL(*mockWriter, OldestFileToExportTime)
+      .WillOnce(Return(std::nullopt))
+      .WillOnce(Return(absl::Now() - absl::Minutes(2)))
+      .WillOnce(Return(std::nullopt));
+
+  // Nothing exported and nothing waiting
+  LoggerPeer::ExportStats stats = l.GetExportStats(false);
+  XCTAssertEqual(stats.bytes_exported, 0);
+  XCTAssertEqual(stats.files_exported, 0);
+  XCTAssertEqual(stats.backlog_age_seconds, 0);
+
+  [self setExportExpectationSuccess:YES mock:mockSleighPtr];
+  EXPECT_CALL(*mockWriter, NextFileToExport)
+      .WillOnce(Return(f1.UTF8String))
+      .WillOnce(Return(f2.UTF8String))
+      .WillOnce(Return(std::nullopt));
+  EXPECT_CALL(*mockWriter, FilesExported);
+
+  l.ExportTelemetrySerialized();
+
+  stats = l.GetExportStats(true);
+  XCTAssertEqual(stats.bytes_exported, 15);
+  XCTAssertEqual(stats.files_exported, 2);
+  XCTAssertGreaterThanOrEqual(stats.backlog_age_seconds, 120);
+
+  // Counts are reset
+  stats = l.GetExportStats(false);
+  XCTAssertEqual(stats.bytes_exported, 0);
+  XCTAssertEqual(stats.files_exported, 0);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSleighPtr);
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
 - (void)testExportMaxBatchSize {
   auto mockWriter = std::make_shared<MockWriter>();
   auto mockSleigh = std::make_unique<MockSleighLauncher>();
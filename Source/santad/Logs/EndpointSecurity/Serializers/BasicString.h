@@ -20,7 +20,6 @@
 #include "Source/common/es/EnrichedTypes.h"
 
 #include <memory>
-#include <sstream>
 #include <vector>
 
 #include "Source/common/Platform.h"
@@ -31,7 +30,7 @@
 
 namespace santa {
 
-class BasicString : public Serializer {
+class BasicString final : public Serializer {
  public:
   static std::shared_ptr<BasicString> Create(std::shared_ptr<santa::EndpointSecurityAPI> esapi,
                                              SNTDecisionCache* decision_cache,
@@ -40,6 +39,9 @@ class BasicString : public Serializer {
   BasicString(std::shared_ptr<santa::EndpointSecurityAPI> esapi, SNTDecisionCache* decision_cache,
               bool prefix_time_name);
 
+  std::vector<uint8_t> SerializeMessage(std::unique_ptr<santa::EnrichedMessage> msg) override {
+    return VisitMessage(this, *msg);
+  }
   std::vector<uint8_t> SerializeMessage(const santa::EnrichedClose&) override;
   std::vector<uint8_t> SerializeMessage(const santa::EnrichedExchange&) override;
   std::vector<uint8_t> SerializeMessage(const santa::EnrichedExec&, SNTCachedDecision*) override;
@@ -93,8 +95,18 @@ class BasicString : public Serializer {
   std::vector<uint8_t> SerializeDiskAppeared(NSDictionary*, bool) override;
   std::vector<uint8_t> SerializeDiskDisappeared(NSDictionary*) override;
 
+  std::vector<uint8_t> SerializeProcessTreeSnapshot(
+      const ::santa::pb::v1::process_tree::Snapshot&) override;
+
  private:
-  std::string CreateDefaultString();
+  // Initial capacity hints for a log line. Exec lines carry the full argument
+  // list and are typically several times larger than other events.
+  static constexpr size_t kDefaultStringSize = 512;
+  static constexpr size_t kExecStringSize = 4096;
+  // Lines larger than this do not keep their buffer around for reuse
+  static constexpr size_t kMaxRetainedStringSize = 64 * 1024;
+
+  std::string CreateDefaultString(size_t size_hint = kDefaultStringSize);
   std::vector<uint8_t> FinalizeString(std::string& str);
 
   std::vector<uint8_t> SerializeMessageLaunchItemAdd(const santa::EnrichedLaunchItem&);
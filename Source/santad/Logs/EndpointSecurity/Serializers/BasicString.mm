@@ -29,10 +29,12 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <charconv>
 #include <format>
 #include <iterator>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include "Source/common/AuditUtilities.h"
 #import "Source/common/SNTCachedDecision.h"
@@ -47,6 +49,19 @@
 
 namespace santa {
 
+// Per-thread scratch buffer handed out by CreateDefaultString and taken back
+// by FinalizeString
+static thread_local std::string tls_string_buffer;
+
+// Appends the decimal representation of `val` without the temporary string
+// that std::to_string would allocate
+template <typename T>
+static inline void AppendNumber(std::string& str, T val) {
+  char buf[24];
+  char* end = std::to_chars(buf, buf + sizeof(buf), val).ptr;
+  str.append(buf, end - buf);
+}
+
 static inline SanitizableString FilePath(const es_file_t* file) {
   return SanitizableString(file);
 }
@@ -156,61 +171,61 @@ std::string GetFileAccessPolicyDecisionString(FileAccessPolicyDecision decision)
 }
 
 static inline void AppendProcess(std::string& str, const es_process_t* es_proc,
-                                 const std::string prefix = "") {
+                                 std::string_view prefix = "") {
   char bname[MAXPATHLEN];
-  str.append("|" + prefix + "pid=");
-  str.append(std::to_string(Pid(es_proc->audit_token)));
-  str.append("|" + prefix + "ppid=");
-  str.append(std::to_string(es_proc->original_ppid));
-  str.append("|" + prefix + "process=");
+  str.append("|").append(prefix).append("pid=");
+  AppendNumber(str, Pid(es_proc->audit_token));
+  str.append("|").append(prefix).append("ppid=");
+  AppendNumber(str, es_proc->original_ppid);
+  str.append("|").append(prefix).append("process=");
   str.append(basename_r(FilePath(es_proc->executable).Sanitized().data(), bname) ?: "");
-  str.append("|" + prefix + "processpath=");
+  str.append("|").append(prefix).append("processpath=");
   str.append(FilePath(es_proc->executable).Sanitized());
 }
 
 static inline void AppendUserGroup(std::string& str, const audit_token_t& tok,
                                    const std::optional<std::shared_ptr<std::string>>& user,
                                    const std::optional<std::shared_ptr<std::string>>& group,
-                                   const std::string prefix = "") {
-  str.append("|" + prefix + "uid=");
-  str.append(std::to_string((int)RealUser(tok)));
-  str.append("|" + prefix + "user=");
+                                   std::string_view prefix = "") {
+  str.append("|").append(prefix).append("uid=");
+  AppendNumber(str, (int)RealUser(tok));
+  str.append("|").append(prefix).append("user=");
   str.append(user.has_value() ? user->get()->c_str() : "(null)");
-  str.append("|" + prefix + "gid=");
-  str.append(std::to_string((int)RealGroup(tok)));
-  str.append("|" + prefix + "group=");
+  str.append("|").append(prefix).append("gid=");
+  AppendNumber(str, (int)RealGroup(tok));
+  str.append("|").append(prefix).append("group=");
   str.append(group.has_value() ? group->get()->c_str() : "(null)");
 }
 
 static inline void AppendEventUser(std::string& str, const es_string_token_t& user,
-                                   std::optional<uid_t> uid, const std::string prefix = "event_") {
+                                   std::optional<uid_t> uid, std::string_view prefix = "event_") {
   if (user.length > 0) {
-    str.append("|" + prefix + "user=");
+    str.append("|").append(prefix).append("user=");
     str.append(user.data);
   }
 
   if (uid.has_value()) {
-    str.append("|" + prefix + "uid=");
-    str.append(std::to_string((int)uid.value()));
+    str.append("|").append(prefix).append("uid=");
+    AppendNumber(str, (int)uid.value());
   }
 }
 
 static inline void AppendInstigator(std::string& str, const es_process_t* es_proc,
                                     const EnrichedProcess& enriched_proc,
-                                    const std::string prefix = "") {
+                                    std::string_view prefix = "") {
   AppendProcess(str, es_proc, prefix);
   AppendUserGroup(str, es_proc->audit_token, enriched_proc.real_user(), enriched_proc.real_group(),
                   prefix);
 }
 
 static inline void AppendInstigator(std::string& str, const EnrichedEventType& event,
-                                    const std::string prefix = "") {
+                                    std::string_view prefix = "") {
   AppendInstigator(str, event->process, event.instigator(), prefix);
 }
 
 static inline void AppendEventUser(std::string& str,
                                    const std::optional<std::shared_ptr<std::string>>& user,
-                                   uid_t uid, const std::string prefix = "event_") {
+                                   uid_t uid, std::string_view prefix = "event_") {
   es_string_token_t user_token = {.length = user.has_value() ? user.value()->length() : 0,
                                   .data = user.has_value() ? user.value()->c_str() : NULL};
 
@@ -219,7 +234,7 @@ static inline void AppendEventUser(std::string& str,
 
 static inline void AppendGraphicalSession(std::string& str, es_graphical_session_id_t session_id) {
   str.append("|graphical_session_id=");
-  str.append(std::to_string(session_id));
+  AppendNumber(str, session_id);
 }
 
 static inline void AppendSocketAddress(std::string& str, es_address_type_t type,
@@ -256,17 +271,29 @@ static inline std::string GetOpenSSHLoginResult(std::string& str,
   }
 }
 
-static char* FormattedDateString(char* buf, size_t len) {
-  struct timeval tv;
-  struct tm tm;
+// Appends the current UTC time as YYYY-MM-DDTHH:MM:SS.mmmZ. The formatted
+// date and time only change once per second and are cached per thread.
+static void AppendFormattedDate(std::string& str) {
+  thread_local time_t cached_sec = -1;
+  thread_local char cached_buf[32];
+  thread_local size_t cached_len = 0;
 
+  struct timeval tv;
   gettimeofday(&tv, NULL);
-  gmtime_r(&tv.tv_sec, &tm);
 
-  strftime(buf, len, "%Y-%m-%dT%H:%M:%S", &tm);
-  snprintf(buf, len, "%s.%03dZ", buf, tv.tv_usec / 1000);
+  if (tv.tv_sec != cached_sec) {
+    struct tm tm;
+    gmtime_r(&tv.tv_sec, &tm);
+    cached_len = strftime(cached_buf, sizeof(cached_buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    cached_sec = tv.tv_sec;
+  }
+
+  int millis = tv.tv_usec / 1000;
+  char frac[5] = {'.', (char)('0' + millis / 100), (char)('0' + millis / 10 % 10),
+                  (char)('0' + millis % 10), 'Z'};
 
-  return buf;
+  str.append(cached_buf, cached_len);
+  str.append(frac, sizeof(frac));
 }
 
 std::shared_ptr<BasicString> BasicString::Create(std::shared_ptr<EndpointSecurityAPI> esapi,
@@ -279,15 +306,16 @@ BasicString::BasicString(std::shared_ptr<EndpointSecurityAPI> esapi,
                          SNTDecisionCache* decision_cache, bool prefix_time_name)
     : Serializer(std::move(decision_cache)), esapi_(esapi), prefix_time_name_(prefix_time_name) {}
 
-std::string BasicString::CreateDefaultString() {
-  std::string str;
-  str.reserve(1024);
+std::string BasicString::CreateDefaultString(size_t size_hint) {
+  // Reuse this thread's buffer from the previous event to avoid regrowing a
+  // fresh string for every line. A nested call simply gets an empty string.
+  std::string str = std::move(tls_string_buffer);
+  str.clear();
+  str.reserve(size_hint);
 
   if (prefix_time_name_) {
-    char buf[32];
-
     str.append("[");
-    str.append(FormattedDateString(buf, sizeof(buf)));
+    AppendFormattedDate(str);
     str.append("] I santad: ");
   }
 
@@ -301,8 +329,14 @@ std::vector<uint8_t> BasicString::FinalizeString(std::string& str) {
   }
   str.append("\n");
 
-  std::vector<uint8_t> vec(str.length());
+  std::vector<uint8_t> vec = LeaseBuffer(str.length());
   std::copy(str.begin(), str.end(), vec.begin());
+
+  // Keep the buffer for the next event unless an unusually large line grew it
+  if (str.capacity() <= kMaxRetainedStringSize) {
+    tls_string_buffer = std::move(str);
+  }
+
   return vec;
 }
 
@@ -331,7 +365,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExchange& msg)
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExec& msg, SNTCachedDecision* cd) {
-  std::string str = CreateDefaultString();
+  std::string str = CreateDefaultString(kExecStringSize);
 
   str.append("action=EXEC|decision=");
   str.append(GetDecisionString(cd.decision));
@@ -370,11 +404,11 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExec& msg, SNTC
   }
 
   str.append("|pid=");
-  str.append(std::to_string(Pid(msg->event.exec.target->audit_token)));
+  AppendNumber(str, Pid(msg->event.exec.target->audit_token));
   str.append("|pidversion=");
-  str.append(std::to_string(Pidversion(msg->event.exec.target->audit_token)));
+  AppendNumber(str, Pidversion(msg->event.exec.target->audit_token));
   str.append("|ppid=");
-  str.append(std::to_string(msg->event.exec.target->original_ppid));
+  AppendNumber(str, msg->event.exec.target->original_ppid);
 
   AppendUserGroup(str, msg->event.exec.target->audit_token, msg.instigator().real_user(),
                   msg.instigator().real_group());
@@ -393,12 +427,19 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExec& msg, SNTC
   uint32_t argCount = esapi_->ExecArgCount(&msg->event.exec);
   if (argCount > 0) {
     str.append("|args=");
-    for (uint32_t i = 0; i < argCount; i++) {
-      if (i != 0) {
-        str.append(" ");
-      }
-
-      str.append(SanitizableString(esapi_->ExecArg(&msg->event.exec, i)).Sanitized());
+    bool first = true;
+    bool truncated = VisitBoundedExecStrings(
+        argCount, exec_args_max_bytes_,
+        [this, &msg](uint32_t i) { return esapi_->ExecArg(&msg->event.exec, i); },
+        [&str, &first](es_string_token_t tok) {
+          if (!first) {
+            str.append(" ");
+          }
+          first = false;
+          str.append(SanitizableString(tok).Sanitized());
+        });
+    if (truncated) {
+      str.append("|args_truncated=true");
     }
   }
 
@@ -409,15 +450,15 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExit& msg) {
   std::string str = CreateDefaultString();
 
   str.append("action=EXIT|pid=");
-  str.append(std::to_string(Pid(msg->process->audit_token)));
+  AppendNumber(str, Pid(msg->process->audit_token));
   str.append("|pidversion=");
-  str.append(std::to_string(Pidversion(msg->process->audit_token)));
+  AppendNumber(str, Pidversion(msg->process->audit_token));
   str.append("|ppid=");
-  str.append(std::to_string(msg->process->original_ppid));
+  AppendNumber(str, msg->process->original_ppid);
   str.append("|uid=");
-  str.append(std::to_string((int)RealUser(msg->process->audit_token)));
+  AppendNumber(str, (int)RealUser(msg->process->audit_token));
   str.append("|gid=");
-  str.append(std::to_string((int)RealGroup(msg->process->audit_token)));
+  AppendNumber(str, (int)RealGroup(msg->process->audit_token));
 
   return FinalizeString(str);
 }
@@ -426,15 +467,15 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedFork& msg) {
   std::string str = CreateDefaultString();
 
   str.append("action=FORK|pid=");
-  str.append(std::to_string(Pid(msg->event.fork.child->audit_token)));
+  AppendNumber(str, Pid(msg->event.fork.child->audit_token));
   str.append("|pidversion=");
-  str.append(std::to_string(Pidversion(msg->event.fork.child->audit_token)));
+  AppendNumber(str, Pidversion(msg->event.fork.child->audit_token));
   str.append("|ppid=");
-  str.append(std::to_string(msg->event.fork.child->original_ppid));
+  AppendNumber(str, msg->event.fork.child->original_ppid);
   str.append("|uid=");
-  str.append(std::to_string((int)RealUser(msg->event.fork.child->audit_token)));
+  AppendNumber(str, (int)RealUser(msg->event.fork.child->audit_token));
   str.append("|gid=");
-  str.append(std::to_string((int)RealGroup(msg->event.fork.child->audit_token)));
+  AppendNumber(str, (int)RealGroup(msg->event.fork.child->audit_token));
 
   return FinalizeString(str);
 }
@@ -541,7 +582,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedProcSuspendResu
 
   if (msg->event.proc_suspend_resume.target) {
     str.append("|targetpid=");
-    str.append(std::to_string(Pid(msg->event.proc_suspend_resume.target->audit_token)));
+    AppendNumber(str, Pid(msg->event.proc_suspend_resume.target->audit_token));
     str.append("|targetpath=");
     str.append(FilePath(msg->event.proc_suspend_resume.target->executable).Sanitized());
   }
@@ -719,17 +760,17 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginLogout& ms
 
 static void AppendEventInstigatorOrFallback(std::string& str,
                                             const EnrichedEventWithInstigator& event,
-                                            std::string prefix = "auth_") {
+                                            std::string_view prefix = "auth_") {
   if (event.EventInstigator() && event.EnrichedEventInstigator().has_value()) {
     AppendInstigator(str, event.EventInstigator(), event.EnrichedEventInstigator().value(), prefix);
   } else if (event->version >= 8) {
     if (event.EventInstigatorToken().has_value()) {
-      str.append("|" + prefix + "pid=");
-      str.append(std::to_string(Pid(event.EventInstigatorToken().value())));
+      str.append("|").append(prefix).append("pid=");
+      AppendNumber(str, Pid(event.EventInstigatorToken().value()));
     }
     if (event.EventInstigatorToken().has_value()) {
-      str.append("|" + prefix + "pidver=");
-      str.append(std::to_string(Pidversion(event.EventInstigatorToken().value())));
+      str.append("|").append(prefix).append("pidver=");
+      AppendNumber(str, Pidversion(event.EventInstigatorToken().value()));
     }
   }
 }
@@ -971,7 +1012,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedXProtectRemedia
   AppendStringToken(str, "|remediated_path=", xp->remediated_path);
   if (xp->remediated_process_audit_token) {
     str.append("|remediated_pid=");
-    str.append(std::to_string(Pid(*xp->remediated_process_audit_token)));
+    AppendNumber(str, Pid(*xp->remediated_process_audit_token));
   }
 
   return FinalizeString(str);
@@ -1150,9 +1191,9 @@ std::vector<uint8_t> BasicString::SerializeAllowlist(const Message& msg,
   std::string str = CreateDefaultString();
 
   str.append("action=ALLOWLIST|pid=");
-  str.append(std::to_string(Pid(msg->process->audit_token)));
+  AppendNumber(str, Pid(msg->process->audit_token));
   str.append("|pidversion=");
-  str.append(std::to_string(Pidversion(msg->process->audit_token)));
+  AppendNumber(str, Pidversion(msg->process->audit_token));
   str.append("|path=");
   str.append(SanitizableString(target_path.data(), target_path.size()).Sanitized());
   str.append("|sha256=");
@@ -1251,4 +1292,11 @@ std::vector<uint8_t> BasicString::SerializeDiskDisappeared(NSDictionary* props)
   return FinalizeString(str);
 }
 
+std::vector<uint8_t> BasicString::SerializeProcessTreeSnapshot(
+    const ::santa::pb::v1::process_tree::Snapshot&) {
+  // Snapshots are meant for tools rebuilding the tree, which read the
+  // structured formats
+  return {};
+}
+
 }  // namespace santa
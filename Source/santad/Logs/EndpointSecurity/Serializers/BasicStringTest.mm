@@ -129,6 +129,55 @@ std::string BasicStringSerializeMessage(es_message_t* esMsg) {
   XCTAssertCppStringEqual(got, want);
 }
 
+- (void)testSerializeMessageAfterLargeMessage {
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+
+  // A long line followed by a short one must not leak content between events
+  std::string longPath(8192, 'A');
+  es_file_t longFile = MakeESFile(longPath.c_str());
+  es_message_t longMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  longMsg.event.close.target = &longFile;
+  std::string got = BasicStringSerializeMessage(&longMsg);
+  XCTAssertTrue(got.find(longPath) != std::string::npos);
+
+  es_file_t file = MakeESFile("close_file");
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  esMsg.event.close.target = &file;
+
+  got = BasicStringSerializeMessage(&esMsg);
+  std::string want = "action=WRITE|path=close_file"
+                     "|pid=12|ppid=56|process=foo|processpath=foo"
+                     "|uid=-2|user=nobody|gid=-1|group=nogroup|machineid=my_id\n";
+
+  XCTAssertCppStringEqual(got, want);
+}
+
+- (void)testTimestampPrefix {
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_file_t file = MakeESFile("close_file");
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  esMsg.event.close.target = &file;
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  std::vector<uint8_t> ret = BasicString::Create(mockESApi, nil, true)
+                                 ->SerializeMessage(Enricher().Enrich(Message(mockESApi, &esMsg)));
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+
+  NSString* got = [[NSString alloc] initWithBytes:ret.data()
+                                           length:ret.size()
+                                         encoding:NSUTF8StringEncoding];
+  NSRegularExpression* re = [NSRegularExpression
+      regularExpressionWithPattern:
+          @"^\\[\\d{4}-\\d{2}-\\d{2}T\\d{2}:\\d{2}:\\d{2}\\.\\d{3}Z\\] I santad: action=WRITE\\|"
+                           options:0
+                             error:nil];
+  XCTAssertEqual([re numberOfMatchesInString:got options:0 range:NSMakeRange(0, got.length)], 1);
+}
+
 - (void)testSerializeMessageExchange {
   es_file_t procFile = MakeESFile("foo");
   es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
@@ -179,6 +228,35 @@ std::string BasicStringSerializeMessage(es_message_t* esMsg) {
   XCTAssertCppStringEqual(got, want);
 }
 
+- (void)testSerializeMessageExecArgsBudget {
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+
+  es_file_t execFile = MakeESFile("execpath");
+  es_process_t procExec = MakeESProcess(&execFile, MakeAuditToken(12, 89), MakeAuditToken(56, 78));
+
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXEC, &proc);
+  esMsg.event.exec.target = &procExec;
+
+  OCMStub([self.mockConfigurator telemetryExecArgsMaxBytes]).andReturn(12);
+
+  // The budget runs out partway through the second argument and the third is never read
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  EXPECT_CALL(*mockESApi, ExecArgCount).WillOnce(testing::Return(3));
+  EXPECT_CALL(*mockESApi, ExecArg)
+      .WillOnce(testing::Return(es_string_token_t{9, "exec|path"}))
+      .WillOnce(testing::Return(es_string_token_t{5, "-l\n-t"}));
+
+  std::string got = BasicStringSerializeMessage(mockESApi, &esMsg, self.mockDecisionCache);
+  std::string want =
+      "action=EXEC|decision=ALLOW|reason=BINARY|explain=extra!|sha256=1234_hash|"
+      "cert_sha256=5678_hash|cert_cn=|quarantine_url=google.com|pid=12|pidversion="
+      "89|ppid=56|uid=-2|user=nobody|gid=-1|group=nogroup|mode=L|path=execpath|"
+      "args=exec<pipe>path -l\\n|args_truncated=true|machineid=my_id\n";
+
+  XCTAssertCppStringEqual(got, want);
+}
+
 - (void)testSerializeMessageExit {
   es_file_t procFile = MakeESFile("foo");
   es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
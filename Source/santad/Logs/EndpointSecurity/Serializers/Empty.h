@@ -84,6 +84,9 @@ class Empty : public Serializer {
 
   std::vector<uint8_t> SerializeDiskAppeared(NSDictionary*, bool) override;
   std::vector<uint8_t> SerializeDiskDisappeared(NSDictionary*) override;
+
+  std::vector<uint8_t> SerializeProcessTreeSnapshot(
+      const ::santa::pb::v1::process_tree::Snapshot&) override;
 };
 
 }  // namespace santa
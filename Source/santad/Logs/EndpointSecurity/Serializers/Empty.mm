@@ -185,4 +185,9 @@ std::vector<uint8_t> Empty::SerializeDiskDisappeared(NSDictionary* props) {
   return {};
 }
 
+std::vector<uint8_t> Empty::SerializeProcessTreeSnapshot(
+    const ::santa::pb::v1::process_tree::Snapshot&) {
+  return {};
+}
+
 }  // namespace santa
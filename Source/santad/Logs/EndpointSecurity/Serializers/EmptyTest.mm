@@ -48,6 +48,7 @@ using santa::Empty;
   XCTAssertEqual(e->SerializeBundleHashingEvent(nil).size(), 0);
   XCTAssertEqual(e->SerializeDiskAppeared(nil, true).size(), 0);
   XCTAssertEqual(e->SerializeDiskDisappeared(nil).size(), 0);
+  XCTAssertEqual(e->SerializeProcessTreeSnapshot({}).size(), 0);
 }
 
 @end
@@ -0,0 +1,68 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_POOLEDARENA_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_POOLEDARENA_H
+
+#include <google/protobuf/arena.h>
+
+#include <cstddef>
+#include <optional>
+
+namespace santa {
+
+// Lends out the calling thread's protobuf arena for the lifetime of the
+// object. Each thread keeps one arena backed by a preallocated initial block
+// that is reset, not freed, between events, so serializing a typical event
+// does not touch malloc for arena storage at all.
+//
+// The largest amount of arena space used is tracked and every
+// kResizeInterval events the initial block is resized to fit it, growing as
+// soon as events no longer fit and only shrinking once they use well under
+// a quarter of it.
+//
+// Nested uses on one thread get a standalone arena.
+class PooledArena {
+ public:
+  static constexpr size_t kMinBlockSize = 4 * 1024;
+  static constexpr size_t kMaxBlockSize = 256 * 1024;
+  static constexpr int kResizeInterval = 256;
+
+  PooledArena();
+  ~PooledArena();
+
+  PooledArena(PooledArena&& other) = delete;
+  PooledArena& operator=(PooledArena&& rhs) = delete;
+  PooledArena(const PooledArena& other) = delete;
+  PooledArena& operator=(const PooledArena& other) = delete;
+
+  google::protobuf::Arena* get() const { return arena_; }
+
+  // Size of the calling thread's current initial block
+  static size_t CurrentThreadBlockSize();
+
+ private:
+  class ThreadArena;
+  static ThreadArena& CurrentThreadArena();
+
+  // Null when this is a nested use and `fallback_` is used instead
+  ThreadArena* owner_;
+  std::optional<google::protobuf::Arena> fallback_;
+  google::protobuf::Arena* arena_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_POOLEDARENA_H
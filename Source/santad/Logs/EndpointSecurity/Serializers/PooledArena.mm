@@ -0,0 +1,109 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Serializers/PooledArena.h"
+
+#include <algorithm>
+#include <bit>
+#include <memory>
+
+using google::protobuf::Arena;
+using google::protobuf::ArenaOptions;
+
+namespace santa {
+
+class PooledArena::ThreadArena {
+ public:
+  ThreadArena() { Rebuild(kMinBlockSize); }
+
+  // Returns nullptr if the arena is already lent out
+  Arena* Acquire() {
+    if (in_use_) {
+      return nullptr;
+    }
+    in_use_ = true;
+    return arena_.get();
+  }
+
+  void Release() {
+    high_water_ = std::max(high_water_, (size_t)arena_->SpaceUsed());
+    arena_->Reset();
+    in_use_ = false;
+
+    if (++events_ >= kResizeInterval) {
+      MaybeResize();
+    }
+  }
+
+  size_t BlockSize() const { return block_size_; }
+
+ private:
+  void MaybeResize() {
+    // Leave headroom for the arena's own block and allocation bookkeeping
+    size_t target = std::clamp(std::bit_ceil(high_water_ + high_water_ / 4), kMinBlockSize,
+                               kMaxBlockSize);
+    if (target > block_size_ || target <= block_size_ / 4) {
+      Rebuild(target);
+    }
+
+    high_water_ = 0;
+    events_ = 0;
+  }
+
+  void Rebuild(size_t block_size) {
+    // The arena must be destroyed before the block it was given
+    arena_.reset();
+    block_ = std::make_unique<char[]>(block_size);
+    block_size_ = block_size;
+
+    ArenaOptions options;
+    options.initial_block = block_.get();
+    options.initial_block_size = block_size;
+    options.start_block_size = block_size;
+    options.max_block_size = kMaxBlockSize;
+    arena_ = std::make_unique<Arena>(options);
+  }
+
+  std::unique_ptr<char[]> block_;
+  size_t block_size_ = 0;
+  std::unique_ptr<Arena> arena_;
+  size_t high_water_ = 0;
+  int events_ = 0;
+  bool in_use_ = false;
+};
+
+PooledArena::ThreadArena& PooledArena::CurrentThreadArena() {
+  thread_local PooledArena::ThreadArena thread_arena;
+  return thread_arena;
+}
+
+PooledArena::PooledArena() : owner_(&CurrentThreadArena()), arena_(owner_->Acquire()) {
+  if (!arena_) {
+    owner_ = nullptr;
+    arena_ = &fallback_.emplace();
+  }
+}
+
+PooledArena::~PooledArena() {
+  if (owner_) {
+    owner_->Release();
+  }
+}
+
+size_t PooledArena::CurrentThreadBlockSize() {
+  return CurrentThreadArena().BlockSize();
+}
+
+}  // namespace santa
@@ -0,0 +1,81 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Serializers/PooledArena.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+using google::protobuf::Arena;
+using santa::PooledArena;
+
+@interface PooledArenaTest : XCTestCase
+@end
+
+@implementation PooledArenaTest
+
+- (void)testArenaIsReusedOnThread {
+  Arena* first;
+  {
+    PooledArena arena;
+    first = arena.get();
+    XCTAssertNotEqual(first, nullptr);
+
+    // A nested use must not share the outer arena
+    PooledArena nested;
+    XCTAssertNotEqual(nested.get(), nullptr);
+    XCTAssertNotEqual(nested.get(), first);
+  }
+
+  PooledArena arena;
+  XCTAssertEqual(arena.get(), first);
+  XCTAssertEqual(arena.get()->SpaceUsed(), 0);
+}
+
+- (void)testThreadsGetTheirOwnArena {
+  __block Arena* other;
+  dispatch_sync(dispatch_queue_create("test", DISPATCH_QUEUE_SERIAL), ^{
+    PooledArena arena;
+    other = arena.get();
+  });
+
+  PooledArena arena;
+  XCTAssertNotEqual(arena.get(), other);
+}
+
+- (void)testBlockSizeAdapts {
+  // Run on a fresh thread so the starting state is known
+  dispatch_sync(dispatch_queue_create("test", DISPATCH_QUEUE_SERIAL), ^{
+    {
+      PooledArena arena;
+    }
+    XCTAssertEqual(PooledArena::CurrentThreadBlockSize(), PooledArena::kMinBlockSize);
+
+    for (int i = 0; i < 2 * PooledArena::kResizeInterval; i++) {
+      PooledArena arena;
+      arena.get()->AllocateAligned(20000);
+    }
+    XCTAssertGreaterThanOrEqual(PooledArena::CurrentThreadBlockSize(), 20000);
+    XCTAssertLessThanOrEqual(PooledArena::CurrentThreadBlockSize(), PooledArena::kMaxBlockSize);
+
+    for (int i = 0; i < 2 * PooledArena::kResizeInterval; i++) {
+      PooledArena arena;
+      arena.get()->AllocateAligned(100);
+    }
+    XCTAssertEqual(PooledArena::CurrentThreadBlockSize(), PooledArena::kMinBlockSize);
+  });
+}
+
+@end
@@ -36,7 +36,7 @@ typedef uint8_t es_cdhash_t[20];
 
 namespace santa {
 
-class Protobuf : public Serializer {
+class Protobuf final : public Serializer {
  public:
   static std::shared_ptr<Protobuf> Create(std::shared_ptr<santa::EndpointSecurityAPI> esapi,
                                           SNTDecisionCache* decision_cache, bool json = false);
@@ -44,6 +44,9 @@ class Protobuf : public Serializer {
   Protobuf(std::shared_ptr<santa::EndpointSecurityAPI> esapi, SNTDecisionCache* decision_cache,
            bool json = false);
 
+  std::vector<uint8_t> SerializeMessage(std::unique_ptr<santa::EnrichedMessage> msg) override {
+    return VisitMessage(this, *msg);
+  }
   std::vector<uint8_t> SerializeMessage(const santa::EnrichedClose&) override;
   std::vector<uint8_t> SerializeMessage(const santa::EnrichedExchange&) override;
   std::vector<uint8_t> SerializeMessage(const santa::EnrichedExec&, SNTCachedDecision*) override;
@@ -82,6 +85,13 @@ class Protobuf : public Serializer {
 
   std::vector<uint8_t> SerializeNetworkFlows(SNDProcessFlows*, struct timespec, struct timespec,
                                              SNTCachedDecision*) override;
+  std::vector<uint8_t> SerializeNetworkFlowsBatch(
+      NSArray<SNDProcessFlows*>*, struct timespec, struct timespec,
+      const std::vector<SNTCachedDecision*>&) override;
+  void SerializeNetworkFlowsChunked(
+      NSArray<SNDProcessFlows*>*, struct timespec, struct timespec,
+      const std::vector<SNTCachedDecision*>&, size_t max_flows_per_record,
+      const std::function<void(std::vector<uint8_t>&&)>& emit) override;
 
   std::vector<uint8_t> SerializeFileAccess(
       const std::string& policy_version, const std::string& policy_name, const santa::Message& msg,
@@ -97,6 +107,9 @@ class Protobuf : public Serializer {
   std::vector<uint8_t> SerializeDiskAppeared(NSDictionary*, bool) override;
   std::vector<uint8_t> SerializeDiskDisappeared(NSDictionary*) override;
 
+  std::vector<uint8_t> SerializeProcessTreeSnapshot(
+      const ::santa::pb::v1::process_tree::Snapshot&) override;
+
  private:
   ::santa::pb::v1::SantaMessage* CreateDefaultProto(google::protobuf::Arena* arena);
   ::santa::pb::v1::SantaMessage* CreateDefaultProto(google::protobuf::Arena* arena,
@@ -26,7 +26,10 @@
 #include <sys/wait.h>
 #include <time.h>
 
+#include <algorithm>
+#include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
 
 #include "Source/common/AuditUtilities.h"
@@ -36,8 +39,10 @@
 #include "Source/common/SNTLogging.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTSystemInfo.h"
+#include "Source/common/SantaCache.h"
 #import "Source/common/String.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/PooledArena.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Utilities.h"
 #import "Source/santad/SNTDecisionCache.h"
 #include "absl/status/status.h"
@@ -469,20 +474,21 @@ std::vector<uint8_t> Protobuf::FinalizeProto(::pbv1::SantaMessage* santa_msg) {
       LOGE(@"Failed to convert protobuf to JSON: %s", status.ToString().c_str());
     }
 
-    std::vector<uint8_t> vec(json.begin(), json.end());
+    std::vector<uint8_t> vec = LeaseBuffer(json.size() + 1);
+    std::copy(json.begin(), json.end(), vec.begin());
     // Add a newline to the end of the JSON row.
-    vec.push_back('\n');
+    vec.back() = '\n';
     return vec;
   }
 
-  std::vector<uint8_t> vec(santa_msg->ByteSizeLong());
+  std::vector<uint8_t> vec = LeaseBuffer(santa_msg->ByteSizeLong());
   santa_msg->SerializeWithCachedSizesToArray(vec.data());
   return vec;
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedClose& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Close* pb_close = santa_msg->mutable_close();
 
@@ -494,8 +500,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedClose& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExchange& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Exchangedata* pb_exchangedata = santa_msg->mutable_exchangedata();
 
@@ -506,9 +512,39 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExchange& msg) {
   return FinalizeProto(santa_msg);
 }
 
+// Encoded entitlements, memoized by cdhash. An entry is only used for a
+// decision holding the same filtered dictionary it was built from, which
+// EntitlementsFilter shares for a cdhash until its configuration changes.
+struct EncodedEntitlements {
+  NSDictionary* source;
+  bool filtered;
+  ::pbv1::EntitlementInfo info;
+};
+
+static constexpr uint64_t kEncodedEntitlementsCacheSize = 1024;
+
+static SantaCache<std::string, std::shared_ptr<const EncodedEntitlements>>&
+EncodedEntitlementsCache() {
+  static auto* cache = new SantaCache<std::string, std::shared_ptr<const EncodedEntitlements>>(
+      kEncodedEntitlementsCacheSize, 5, SantaCacheEvictionPolicy::kClock);
+  return *cache;
+}
+
 void EncodeEntitlements(::pbv1::Execution* pb_exec, SNTCachedDecision* cd) {
   ::pbv1::EntitlementInfo* pb_entitlement_info = pb_exec->mutable_entitlement_info();
 
+  std::string cdhash;
+  if (cd.entitlements && cd.cdhash.length) {
+    cdhash = NSStringToUTF8String(cd.cdhash);
+
+    std::shared_ptr<const EncodedEntitlements> cached = EncodedEntitlementsCache().get(cdhash);
+    if (cached && cached->source == cd.entitlements &&
+        cached->filtered == (bool)cd.entitlementsFiltered) {
+      pb_entitlement_info->CopyFrom(cached->info);
+      return;
+    }
+  }
+
   EncodeEntitlementsCommon(
       cd.entitlements, cd.entitlementsFiltered,
       ^(NSUInteger count, bool is_filtered) {
@@ -520,11 +556,19 @@ void EncodeEntitlements(::pbv1::Execution* pb_exec, SNTCachedDecision* cd) {
         EncodeString([pb_entitlement] { return pb_entitlement->mutable_key(); }, entitlement);
         EncodeString([pb_entitlement] { return pb_entitlement->mutable_value(); }, value);
       });
+
+  if (!cdhash.empty()) {
+    auto encoded = std::make_shared<EncodedEntitlements>();
+    encoded->source = cd.entitlements;
+    encoded->filtered = cd.entitlementsFiltered;
+    encoded->info.CopyFrom(*pb_entitlement_info);
+    EncodedEntitlementsCache().set(cdhash, std::move(encoded));
+  }
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExec& msg, SNTCachedDecision* cd) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Execution* pb_exec = santa_msg->mutable_execution();
 
@@ -544,18 +588,24 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExec& msg, SNTCach
   uint32_t arg_count = esapi_->ExecArgCount(&msg->event.exec);
   if (arg_count > 0) {
     pb_exec->mutable_args()->Reserve(arg_count);
-    for (uint32_t i = 0; i < arg_count; i++) {
-      es_string_token_t tok = esapi_->ExecArg(&msg->event.exec, i);
-      pb_exec->add_args(tok.data, tok.length);
+    bool truncated = VisitBoundedExecStrings(
+        arg_count, exec_args_max_bytes_,
+        [this, &msg](uint32_t i) { return esapi_->ExecArg(&msg->event.exec, i); },
+        [pb_exec](es_string_token_t tok) { pb_exec->add_args(tok.data, tok.length); });
+    if (truncated) {
+      pb_exec->set_args_truncated(true);
     }
   }
 
   uint32_t env_count = esapi_->ExecEnvCount(&msg->event.exec);
   if (env_count > 0) {
     pb_exec->mutable_envs()->Reserve(env_count);
-    for (uint32_t i = 0; i < env_count; i++) {
-      es_string_token_t tok = esapi_->ExecEnv(&msg->event.exec, i);
-      pb_exec->add_envs(tok.data, tok.length);
+    bool truncated = VisitBoundedExecStrings(
+        env_count, exec_envs_max_bytes_,
+        [this, &msg](uint32_t i) { return esapi_->ExecEnv(&msg->event.exec, i); },
+        [pb_exec](es_string_token_t tok) { pb_exec->add_envs(tok.data, tok.length); });
+    if (truncated) {
+      pb_exec->set_envs_truncated(true);
     }
   }
 
@@ -613,8 +663,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExec& msg, SNTCach
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExit& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Exit* pb_exit = santa_msg->mutable_exit();
 
@@ -625,8 +675,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExit& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedFork& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Fork* pb_fork = santa_msg->mutable_fork();
 
@@ -637,8 +687,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedFork& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLink& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Link* pb_link = santa_msg->mutable_link();
   EncodeProcessInfoLight(pb_link->mutable_instigator(), msg);
@@ -650,8 +700,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLink& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedRename& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Rename* pb_rename = santa_msg->mutable_rename();
   EncodeProcessInfoLight(pb_rename->mutable_instigator(), msg);
@@ -669,8 +719,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedRename& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedUnlink& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Unlink* pb_unlink = santa_msg->mutable_unlink();
   EncodeProcessInfoLight(pb_unlink->mutable_instigator(), msg);
@@ -680,8 +730,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedUnlink& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedCSInvalidated& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::CodesigningInvalidated* pb_cs_invalidated = santa_msg->mutable_codesigning_invalidated();
   EncodeProcessInfoLight(pb_cs_invalidated->mutable_instigator(), msg);
@@ -701,8 +751,8 @@ static ::pbv1::ProcSuspendResume::Type GetProcSuspendResumeType(
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedProcSuspendResume& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::ProcSuspendResume* pb_psr = santa_msg->mutable_proc_suspend_resume();
   EncodeProcessInfoLight(pb_psr->mutable_instigator(), msg);
@@ -716,8 +766,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedProcSuspendResume&
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedClone& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Clone* pb_clone = santa_msg->mutable_clone();
   EncodeProcessInfoLight(pb_clone->mutable_instigator(), msg);
@@ -728,8 +778,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedClone& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedCopyfile& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Copyfile* pb_copyfile = santa_msg->mutable_copyfile();
   EncodeProcessInfoLight(pb_copyfile->mutable_instigator(), msg);
@@ -784,8 +834,8 @@ static inline void EncodeUserInfo(F&& lazy_f, const es_string_token_t& name) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSessionLogin& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::LoginWindowSessionLogin* pb_lw_login =
       santa_msg->mutable_login_window_session()->mutable_login();
 
@@ -800,8 +850,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSession
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSessionLogout& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::LoginWindowSessionLogout* pb_lw_logout =
       santa_msg->mutable_login_window_session()->mutable_logout();
 
@@ -816,8 +866,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSession
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSessionLock& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::LoginWindowSessionLock* pb_lw_lock =
       santa_msg->mutable_login_window_session()->mutable_lock();
 
@@ -831,8 +881,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSession
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSessionUnlock& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::LoginWindowSessionUnlock* pb_lw_unlock =
       santa_msg->mutable_login_window_session()->mutable_unlock();
 
@@ -847,8 +897,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSession
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedScreenSharingAttach& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::ScreenSharingAttach* pb_attach = santa_msg->mutable_screen_sharing()->mutable_attach();
 
   EncodeProcessInfoLight(pb_attach->mutable_instigator(), msg);
@@ -875,8 +925,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedScreenSharingAttac
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedScreenSharingDetach& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::ScreenSharingDetach* pb_detach = santa_msg->mutable_screen_sharing()->mutable_detach();
 
   EncodeProcessInfoLight(pb_detach->mutable_instigator(), msg);
@@ -893,8 +943,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedScreenSharingDetac
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedOpenSSHLogin& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::OpenSSHLogin* pb_ssh_login = santa_msg->mutable_open_ssh()->mutable_login();
 
   EncodeProcessInfoLight(pb_ssh_login->mutable_instigator(), msg);
@@ -914,8 +964,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedOpenSSHLogin& msg)
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedOpenSSHLogout& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::OpenSSHLogout* pb_ssh_logout = santa_msg->mutable_open_ssh()->mutable_logout();
 
   EncodeProcessInfoLight(pb_ssh_logout->mutable_instigator(), msg);
@@ -930,8 +980,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedOpenSSHLogout& msg
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginLogin& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::Login* pb_login = santa_msg->mutable_login_logout()->mutable_login();
 
   EncodeProcessInfoLight(pb_login->mutable_instigator(), msg);
@@ -949,8 +999,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginLogin& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginLogout& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::Logout* pb_logout = santa_msg->mutable_login_logout()->mutable_logout();
 
   EncodeProcessInfoLight(pb_logout->mutable_instigator(), msg);
@@ -984,8 +1034,8 @@ static inline void EncodeEventInstigatorOrFallback(const EnrichedEventWithInstig
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationOD& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Authentication* pb_auth = santa_msg->mutable_authentication();
   pb_auth->set_success(msg->event.authentication->success);
@@ -1015,8 +1065,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationOD&
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationTouchID& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Authentication* pb_auth = santa_msg->mutable_authentication();
   pb_auth->set_success(msg->event.authentication->success);
@@ -1038,8 +1088,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationTouc
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationToken& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Authentication* pb_auth = santa_msg->mutable_authentication();
   pb_auth->set_success(msg->event.authentication->success);
@@ -1071,8 +1121,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationToke
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationAutoUnlock& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Authentication* pb_auth = santa_msg->mutable_authentication();
   pb_auth->set_success(msg->event.authentication->success);
@@ -1104,8 +1154,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationAuto
 
 std::vector<uint8_t> Protobuf::SerializeMessageLaunchItemAdd(const EnrichedLaunchItem& msg) {
   assert(msg->event_type == ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_ADD);
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   const es_event_btm_launch_item_add_t* btm = msg->event.btm_launch_item_add;
 
@@ -1142,8 +1192,8 @@ std::vector<uint8_t> Protobuf::SerializeMessageLaunchItemAdd(const EnrichedLaunc
 
 std::vector<uint8_t> Protobuf::SerializeMessageLaunchItemRemove(const EnrichedLaunchItem& msg) {
   assert(msg->event_type == ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_REMOVE);
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   const es_event_btm_launch_item_remove_t* btm = msg->event.btm_launch_item_remove;
 
@@ -1190,8 +1240,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLaunchItem& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedXProtectDetected& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::XProtect* pb_xp = santa_msg->mutable_xprotect();
   ::pbv1::XProtectDetected* pb_xp_detected = pb_xp->mutable_detected();
@@ -1212,8 +1262,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedXProtectDetected&
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedXProtectRemediated& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::XProtect* pb_xp = santa_msg->mutable_xprotect();
   ::pbv1::XProtectRemediated* pb_xp_remediated = pb_xp->mutable_remediated();
@@ -1265,8 +1315,8 @@ static inline void EncodeFileInfo(::pbv1::FileInfo* pb_file, es_string_token_t p
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedGatekeeperOverride& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::GatekeeperOverride* pb_gk = santa_msg->mutable_gatekeeper_override();
   es_event_gatekeeper_user_override_t* gk = msg->event.gatekeeper_user_override;
 
@@ -1376,8 +1426,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedGatekeeperOverride
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedTCCModification& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   const es_event_tcc_modify_t* tcc = msg->event.tcc_modify;
 
@@ -1409,21 +1459,88 @@ std::vector<uint8_t> Protobuf::SerializeNetworkFlows(SNDProcessFlows* processFlo
                                                      struct timespec window_start,
                                                      struct timespec window_end,
                                                      SNTCachedDecision* cd) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, window_start, window_end);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), window_start, window_end);
   auto* na = santa_msg->mutable_network_activity();
   auto* process = na->add_processes();
-  santanetd::PopulateNetworkActivityProcess(&arena, process, processFlows, cd);
+  santanetd::PopulateNetworkActivityProcess(arena.get(), process, processFlows, cd);
+  return FinalizeProto(santa_msg);
+}
+
+std::vector<uint8_t> Protobuf::SerializeNetworkFlowsBatch(
+    NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+    struct timespec window_end, const std::vector<SNTCachedDecision*>& cds) {
+  // All processes share a window so they are reported in a single message
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), window_start, window_end);
+  auto* na = santa_msg->mutable_network_activity();
+  for (NSUInteger i = 0; i < processFlows.count; i++) {
+    santanetd::PopulateNetworkActivityProcess(arena.get(), na->add_processes(), processFlows[i],
+                                              cds[i]);
+  }
   return FinalizeProto(santa_msg);
 }
 
+void Protobuf::SerializeNetworkFlowsChunked(
+    NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+    struct timespec window_end, const std::vector<SNTCachedDecision*>& cds,
+    size_t max_flows_per_record, const std::function<void(std::vector<uint8_t>&&)>& emit) {
+  if (!processFlows.count) {
+    return;
+  }
+
+  size_t limit = max_flows_per_record ? max_flows_per_record : SIZE_MAX;
+
+  // Each record gets its own arena so that memory is released as records are
+  // emitted, rather than growing with the size of the window
+  std::optional<PooledArena> record_arena;
+  ::pbv1::SantaMessage* santa_msg = nullptr;
+  size_t record_flows = 0;
+  auto start_record = [&] {
+    record_arena.emplace();
+    santa_msg = CreateDefaultProto(record_arena->get(), window_start, window_end);
+    record_flows = 0;
+  };
+
+  start_record();
+  for (NSUInteger i = 0; i < processFlows.count; i++) {
+    // Flows are populated all at once for a process, so they are built in a
+    // scratch arena freed before the next process and copied out in chunks
+    Arena process_arena;
+    auto* process = Arena::Create<::pbv1::NetworkActivity::Process>(&process_arena);
+    santanetd::PopulateNetworkActivityProcess(&process_arena, process, processFlows[i], cds[i]);
+
+    size_t total = process->flows_size();
+    size_t next = 0;
+    do {
+      if (record_flows >= limit) {
+        emit(FinalizeProto(santa_msg));
+        start_record();
+      }
+
+      size_t count = std::min(limit - record_flows, total - next);
+      auto* out = santa_msg->mutable_network_activity()->add_processes();
+      if (process->has_process()) {
+        *out->mutable_process() = process->process();
+      }
+      for (size_t j = next; j < next + count; j++) {
+        *out->add_flows() = process->flows(static_cast<int>(j));
+      }
+      next += count;
+      record_flows += count;
+    } while (next < total);
+  }
+
+  emit(FinalizeProto(santa_msg));
+}
+
 std::vector<uint8_t> Protobuf::SerializeFileAccess(
     const std::string& policy_version, const std::string& policy_name, const Message& msg,
     const EnrichedProcess& enriched_process, size_t target_index,
     std::optional<santa::EnrichedFile> enriched_event_target, FileAccessPolicyDecision decision,
     std::string_view operation_id, int64_t rule_id) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::FileAccess* file_access = santa_msg->mutable_file_access();
 
@@ -1455,8 +1572,8 @@ std::vector<uint8_t> Protobuf::SerializeFileAccess(
 
 std::vector<uint8_t> Protobuf::SerializeAllowlist(const Message& msg, const std::string_view hash,
                                                   const std::string_view target_path) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
 
   const es_file_t* es_file = santa::GetAllowListTargetFile(msg);
 
@@ -1482,8 +1599,8 @@ std::vector<uint8_t> Protobuf::SerializeAllowlist(const Message& msg, const std:
 }
 
 std::vector<uint8_t> Protobuf::SerializeBundleHashingEvent(SNTStoredExecutionEvent* event) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
 
   ::pbv1::Bundle* pb_bundle = santa_msg->mutable_bundle();
 
@@ -1550,8 +1667,8 @@ static void EncodeDisk(::pbv1::Disk* pb_disk, ::pbv1::Disk_Action action, NSDict
 }
 
 std::vector<uint8_t> Protobuf::SerializeDiskAppeared(NSDictionary* props, bool allowed) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
 
   EncodeDisk(santa_msg->mutable_disk(),
              allowed ? ::pbv1::Disk::ACTION_APPEARED : ::pbv1::Disk::ACTION_BLOCKED, props,
@@ -1561,12 +1678,22 @@ std::vector<uint8_t> Protobuf::SerializeDiskAppeared(NSDictionary* props, bool a
 }
 
 std::vector<uint8_t> Protobuf::SerializeDiskDisappeared(NSDictionary* props) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena);
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
 
   EncodeDisk(santa_msg->mutable_disk(), ::pbv1::Disk::ACTION_DISAPPEARED, props, true);
 
   return FinalizeProto(santa_msg);
 }
 
+std::vector<uint8_t> Protobuf::SerializeProcessTreeSnapshot(
+    const ::santa::pb::v1::process_tree::Snapshot& snapshot) {
+  PooledArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
+
+  *santa_msg->mutable_process_tree_snapshot() = snapshot;
+
+  return FinalizeProto(santa_msg);
+}
+
 }  // namespace santa
@@ -46,6 +46,7 @@
 #include "absl/status/status.h"
 #include "google/protobuf/any.pb.h"
 #include "google/protobuf/timestamp.pb.h"
+#import "src/santanetd/SNDProcessFlows.h"
 
 using google::protobuf::Timestamp;
 using JsonPrintOptions = google::protobuf::json::PrintOptions;
@@ -216,6 +217,7 @@ const google::protobuf::Message& SantaMessageEvent(const ::pbv1::SantaMessage& s
     case ::pbv1::SantaMessage::kTccModification: return santaMsg.tcc_modification();
     case ::pbv1::SantaMessage::kXprotect: return santaMsg.xprotect();
     case ::pbv1::SantaMessage::kProcSuspendResume: return santaMsg.proc_suspend_resume();
+    case ::pbv1::SantaMessage::kProcessTreeSnapshot: return santaMsg.process_tree_snapshot();
     case ::pbv1::SantaMessage::EVENT_NOT_SET:
       XCTFail(@"Protobuf message SantaMessage did not set an 'event' field");
       OS_FALLTHROUGH;
@@ -785,6 +787,31 @@ void SerializeAndCheckNonESEvents(
     XCTAssertTrue(pbExec.entitlement_info().has_entitlements_filtered());
     XCTAssertTrue(pbExec.entitlement_info().entitlements_filtered());
   }
+
+  // Encodings are reused for the same cdhash only while the entitlements
+  // object and filtered state are unchanged
+  {
+    SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+    cd.cdhash = @"memoized_cdhash";
+    cd.entitlements = @{@"com.northpolesec.test" : @(YES)};
+
+    ::pbv1::Execution first;
+    EncodeEntitlements(&first, cd);
+    ::pbv1::Execution second;
+    EncodeEntitlements(&second, cd);
+    XCTAssertEqual(first.entitlement_info().SerializeAsString(),
+                   second.entitlement_info().SerializeAsString());
+
+    cd.entitlementsFiltered = YES;
+    ::pbv1::Execution filtered;
+    EncodeEntitlements(&filtered, cd);
+    XCTAssertTrue(filtered.entitlement_info().entitlements_filtered());
+
+    cd.entitlements = @{@"com.northpolesec.test" : @(YES), @"com.northpolesec.test2" : @(NO)};
+    ::pbv1::Execution updated;
+    EncodeEntitlements(&updated, cd);
+    XCTAssertEqual(2, updated.entitlement_info().entitlements_size());
+  }
 }
 
 - (void)testEncodeCodeSignature {
@@ -1944,6 +1971,51 @@ void SerializeAndCheckNonESEvents(
   XCTAssertEqualObjects(@(pbBundle.path().c_str()), se.filePath);
 }
 
+- (void)testSerializeNetworkFlowsBatch {
+  std::shared_ptr<Serializer> bs = Protobuf::Create(nullptr, nil);
+  NSArray<SNDProcessFlows*>* flows =
+      @[ [[SNDProcessFlows alloc] init], [[SNDProcessFlows alloc] init] ];
+
+  std::vector<uint8_t> vec = bs->SerializeNetworkFlowsBatch(flows, {.tv_sec = 100, .tv_nsec = 0},
+                                                            {.tv_sec = 160, .tv_nsec = 0});
+  std::string protoStr(vec.begin(), vec.end());
+
+  // All processes for the window are reported in a single message
+  ::pbv1::SantaMessage santaMsg;
+  XCTAssertTrue(santaMsg.ParseFromString(protoStr));
+  XCTAssertTrue(santaMsg.has_network_activity());
+  XCTAssertEqual(santaMsg.network_activity().processes_size(), 2);
+}
+
+- (void)testSerializeNetworkFlowsChunked {
+  std::shared_ptr<Serializer> bs = Protobuf::Create(nullptr, nil);
+  NSArray<SNDProcessFlows*>* flows =
+      @[ [[SNDProcessFlows alloc] init], [[SNDProcessFlows alloc] init] ];
+
+  std::vector<std::string> records;
+  bs->SerializeNetworkFlowsChunked(flows, {.tv_sec = 100, .tv_nsec = 0},
+                                   {.tv_sec = 160, .tv_nsec = 0}, 1,
+                                   [&records](std::vector<uint8_t>&& vec) {
+                                     records.emplace_back(vec.begin(), vec.end());
+                                   });
+
+  // Processes without flows don't count towards the limit and share a record
+  XCTAssertEqual(records.size(), 1);
+  ::pbv1::SantaMessage santaMsg;
+  XCTAssertTrue(santaMsg.ParseFromString(records[0]));
+  XCTAssertEqual(santaMsg.network_activity().processes_size(), 2);
+  XCTAssertEqual(santaMsg.event_time().seconds(), 100);
+
+  // Nothing is emitted for an empty window
+  records.clear();
+  bs->SerializeNetworkFlowsChunked(@[], {.tv_sec = 100, .tv_nsec = 0},
+                                   {.tv_sec = 160, .tv_nsec = 0}, 1,
+                                   [&records](std::vector<uint8_t>&& vec) {
+                                     records.emplace_back(vec.begin(), vec.end());
+                                   });
+  XCTAssertEqual(records.size(), 0);
+}
+
 - (void)testSerializeDiskAppearedAllowed {
   NSDictionary* props = @{
     @"DADevicePath" : @"",
@@ -2049,6 +2121,31 @@ void SerializeAndCheckNonESEvents(
   XCTAssertGreaterThan(pbDisk.appearance().seconds(), 1);
 }
 
+- (void)testSerializeProcessTreeSnapshot {
+  ::santa::pb::v1::process_tree::Snapshot snapshot;
+  snapshot.set_sequence(2);
+  snapshot.set_base_sequence(1);
+  auto* proc = snapshot.add_processes();
+  proc->mutable_id()->set_pid(12);
+  proc->mutable_id()->set_pidversion(34);
+  proc->mutable_parent_id()->set_pid(1);
+  proc->mutable_parent_id()->set_pidversion(1);
+  proc->set_cdhash(std::string(20, '\xab'));
+  auto* removed = snapshot.add_removed();
+  removed->set_pid(56);
+  removed->set_pidversion(78);
+
+  std::vector<uint8_t> vec = Protobuf::Create(nullptr, nil)->SerializeProcessTreeSnapshot(snapshot);
+  std::string protoStr(vec.begin(), vec.end());
+
+  ::pbv1::SantaMessage santaMsg;
+  XCTAssertTrue(santaMsg.ParseFromString(protoStr));
+  XCTAssertTrue(santaMsg.has_process_tree_snapshot());
+  XCTAssertTrue(santaMsg.has_event_time());
+  XCTAssertEqual(santaMsg.process_tree_snapshot().SerializeAsString(),
+                 snapshot.SerializeAsString());
+}
+
 - (void)testSerializeExecRuleId {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
 
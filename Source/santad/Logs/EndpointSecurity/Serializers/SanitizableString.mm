@@ -14,12 +14,72 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Serializers/SanitizableString.h"
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "Source/common/String.h"
 
 using santa::NSStringToUTF8StringView;
 
 namespace santa {
 
+namespace {
+
+inline bool IsSpecialCharacter(char c) {
+  return c == '|' || c == '\n' || c == '\r' || c == '\0';
+}
+
+// Returns the offset of the first byte in `str` that must be sanitized or
+// terminates the string, or `length` if there is none. Most strings never
+// need sanitizing, so the scan checks 16 bytes at a time where possible.
+size_t FindSpecialCharacter(const char* str, size_t length) {
+  size_t i = 0;
+
+#if defined(__aarch64__)
+  const uint8x16_t pipe = vdupq_n_u8('|');
+  const uint8x16_t newline = vdupq_n_u8('\n');
+  const uint8x16_t carriage_return = vdupq_n_u8('\r');
+  for (; i + 16 <= length; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t*)str + i);
+    uint8x16_t matches = vorrq_u8(vorrq_u8(vceqq_u8(v, pipe), vceqq_u8(v, newline)),
+                                  vorrq_u8(vceqq_u8(v, carriage_return), vceqzq_u8(v)));
+    if (vmaxvq_u8(matches) != 0) {
+      // Narrow each byte of the mask to a nibble to locate the first match
+      uint64_t bits = vget_lane_u64(
+          vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+      return i + (__builtin_ctzll(bits) >> 2);
+    }
+  }
+#elif defined(__SSE2__)
+  const __m128i pipe = _mm_set1_epi8('|');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(str + i));
+    __m128i matches =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, pipe), _mm_cmpeq_epi8(v, newline)),
+                     _mm_or_si128(_mm_cmpeq_epi8(v, carriage_return), _mm_cmpeq_epi8(v, zero)));
+    int mask = _mm_movemask_epi8(matches);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#endif
+
+  for (; i < length; i++) {
+    if (IsSpecialCharacter(str[i])) {
+      return i;
+    }
+  }
+  return length;
+}
+
+}  // namespace
+
 SanitizableString::SanitizableString(const es_file_t* file)
     : data_(file->path.data, file->path.length) {}
 
@@ -57,7 +117,6 @@ std::optional<std::string> SanitizableString::SanitizeString(const char* str) {
 
 std::optional<std::string> SanitizableString::SanitizeString(const char* str, size_t length) {
   size_t strOffset = 0;
-  char c = 0;
   std::string buf;
   bool reservedStringSpace = false;
 
@@ -69,31 +128,35 @@ std::optional<std::string> SanitizableString::SanitizeString(const char* str, si
     return std::nullopt;
   }
 
-  // Loop through the string one character at a time, looking for the characters
-  // we want to remove.
-  for (const char* p = str; (c = *p) != 0; ++p) {
-    if (c == '|' || c == '\n' || c == '\r') {
-      if (!reservedStringSpace) {
-        // Assume the common case won't grow the string length by more than a
-        // factor of 2. String will grow more if it needs to.
-        buf.reserve(length * 2);
-        reservedStringSpace = true;
-      }
-
-      // Copy from the last offset up to the character we just found into the buffer
-      ptrdiff_t diff = p - str;
-      buf.append(str + strOffset, diff - strOffset);
-
-      // Update the buffer and string offsets
-      strOffset = diff + 1;
-
-      // Replace the found character and advance the buffer offset
-      switch (c) {
-        case '|': buf.append("<pipe>"); break;
-        case '\n': buf.append("\\n"); break;
-        case '\r': buf.append("\\r"); break;
-      }
+  // Skip ahead to each character we want to remove, stopping at the end of
+  // the string or an embedded NUL.
+  for (size_t pos = 0; pos < length;) {
+    size_t found = pos + FindSpecialCharacter(str + pos, length - pos);
+    if (found == length || str[found] == '\0') {
+      break;
+    }
+
+    if (!reservedStringSpace) {
+      // Assume the common case won't grow the string length by more than a
+      // factor of 2. String will grow more if it needs to.
+      buf.reserve(length * 2);
+      reservedStringSpace = true;
     }
+
+    // Copy from the last offset up to the character we just found into the buffer
+    buf.append(str + strOffset, found - strOffset);
+
+    // Update the buffer and string offsets
+    strOffset = found + 1;
+
+    // Replace the found character and advance the buffer offset
+    switch (str[found]) {
+      case '|': buf.append("<pipe>"); break;
+      case '\n': buf.append("\\n"); break;
+      case '\r': buf.append("\\r"); break;
+    }
+
+    pos = found + 1;
   }
 
   if (strOffset > 0 && strOffset < length) {
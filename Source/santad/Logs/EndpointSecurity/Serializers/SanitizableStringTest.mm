@@ -18,7 +18,9 @@
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 #include <sstream>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include "Source/common/TestUtils.h"
 
@@ -87,4 +89,57 @@ using santa::SanitizableString;
   XCTAssertCStringEqual(ss.str().c_str(), sanitized);
 }
 
+- (void)testSanitizeAtEveryOffset {
+  // Exercise matches on both sides of every vector boundary
+  for (size_t len = 1; len <= 70; len++) {
+    for (size_t pos = 0; pos < len; pos++) {
+      for (char c : {'|', '\n', '\r'}) {
+        std::string str(len, 'a');
+        str[pos] = c;
+
+        std::string want = str.substr(0, pos);
+        want.append(c == '|' ? "<pipe>" : (c == '\n' ? "\\n" : "\\r"));
+        want.append(str.substr(pos + 1));
+
+        std::optional<std::string> got = SanitizableString::SanitizeString(str.c_str(), len);
+        XCTAssertTrue(got.has_value());
+        XCTAssertCppStringEqual(*got, want);
+      }
+    }
+
+    std::string clean(len, 'b');
+    XCTAssertFalse(SanitizableString::SanitizeString(clean.c_str(), len).has_value());
+  }
+
+  // Scanning stops at an embedded NUL
+  const char embedded[] = "abcdefghijklmnopqrstuvwxyz\0|";
+  XCTAssertFalse(SanitizableString::SanitizeString(embedded, sizeof(embedded) - 1).has_value());
+}
+
+- (void)testSanitizePerformance {
+  std::vector<std::string> corpus = {
+      "/usr/bin/true",
+      "/Applications/Google Chrome.app/Contents/Frameworks/Google Chrome Framework.framework/"
+      "Versions/126.0.6478.127/Helpers/Google Chrome Helper (Renderer).app/Contents/MacOS/"
+      "Google Chrome Helper (Renderer)",
+      "/Users/someone/Library/Application Support/Code/User/workspaceStorage/state.vscdb-journal",
+      "/private/var/folders/zz/zyxvpxvq6csfxvn_n0000000000000/T/com.apple.mdworker/tmp.XXXXXX",
+      "--type=renderer",
+      "--enable-features=PartitionedCookies,ThirdPartyStoragePartitioning",
+      "-c",
+      "git log --pretty=format:%h|%an|%s -n 20",
+      "/System/Library/PrivateFrameworks/SkyLight.framework/Versions/A/Resources/WindowServer",
+  };
+
+  [self measureBlock:^{
+    size_t sanitized = 0;
+    for (int i = 0; i < 20000; i++) {
+      for (const std::string& str : corpus) {
+        sanitized += SanitizableString::SanitizeString(str.c_str(), str.length()).has_value();
+      }
+    }
+    XCTAssertEqual(sanitized, 20000);
+  }];
+}
+
 @end
@@ -22,13 +22,18 @@
 #include <functional>
 #include <memory>
 #include <string_view>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
+#include "Source/common/Memoizer.h"
 #include "Source/common/Platform.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTXxhash.h"
 #include "Source/common/es/EnrichedTypes.h"
+#include "Source/common/processtree/process_tree.pb.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/BufferPool.h"
 #import "Source/santad/SNTDecisionCache.h"
 
 @class SNDProcessFlows;
@@ -41,15 +46,20 @@ class Serializer {
   Serializer(SNTDecisionCache* decision_cache);
   virtual ~Serializer() = default;
 
-  std::vector<uint8_t> SerializeMessage(std::unique_ptr<santa::EnrichedMessage> msg) {
-    return std::visit([this](const auto& arg) { return this->SerializeMessageTemplate(arg); },
-                      msg->GetEnrichedMessage());
+  // Final serializers override this with `VisitMessage(this, *msg)` so that the per-event
+  // overloads are called directly instead of through the vtable.
+  virtual std::vector<uint8_t> SerializeMessage(std::unique_ptr<santa::EnrichedMessage> msg) {
+    return VisitMessage(this, *msg);
   }
 
   bool EnableMachineIDDecoration() const;
   std::shared_ptr<std::string> MachineID() const;
   void UpdateMachineID();
 
+  // When set, serialized output is written into buffers leased from `pool`.
+  // Must be set before any messages are serialized.
+  void SetBufferPool(std::shared_ptr<BufferPool> pool) { buffer_pool_ = std::move(pool); }
+
   virtual std::vector<uint8_t> SerializeMessage(const santa::EnrichedClose&) = 0;
   virtual std::vector<uint8_t> SerializeMessage(const santa::EnrichedExchange&) = 0;
   virtual std::vector<uint8_t> SerializeMessage(const santa::EnrichedExec&,
@@ -112,27 +122,92 @@ class Serializer {
                                              struct timespec window_start,
                                              struct timespec window_end);
 
+  // Serializes the flows of many processes reported for the same window in one
+  // call. `cds` holds the cached decision, or nil, for each process. By default
+  // each process is serialized separately and the results are concatenated.
+  virtual std::vector<uint8_t> SerializeNetworkFlowsBatch(
+      NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+      struct timespec window_end, const std::vector<SNTCachedDecision*>& cds);
+  std::vector<uint8_t> SerializeNetworkFlowsBatch(NSArray<SNDProcessFlows*>* processFlows,
+                                                  struct timespec window_start,
+                                                  struct timespec window_end);
+
+  // Like SerializeNetworkFlowsBatch, but calls `emit` with records of at most
+  // `max_flows_per_record` flows, 0 meaning no limit, so that large windows
+  // are never held in memory as one record. Every record repeats the process
+  // info of the flows it holds. By default the whole batch is emitted as a
+  // single record.
+  virtual void SerializeNetworkFlowsChunked(
+      NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+      struct timespec window_end, const std::vector<SNTCachedDecision*>& cds,
+      size_t max_flows_per_record, const std::function<void(std::vector<uint8_t>&&)>& emit);
+  void SerializeNetworkFlowsChunked(NSArray<SNDProcessFlows*>* processFlows,
+                                    struct timespec window_start, struct timespec window_end,
+                                    size_t max_flows_per_record,
+                                    const std::function<void(std::vector<uint8_t>&&)>& emit);
+
   virtual std::vector<uint8_t> SerializeDiskAppeared(NSDictionary*, bool) = 0;
   virtual std::vector<uint8_t> SerializeDiskDisappeared(NSDictionary*) = 0;
 
- private:
-  // Template pattern methods used to ensure a place to implement any desired
-  // functionality that shouldn't be overridden by derived classes.
-  // The default implementation acts as a pass-through.
-  // Define type-specific specializations when requried.
-  std::vector<uint8_t> SerializeMessageTemplate(const santa::EnrichedExec&);
+  // Formats that can't carry a process tree snapshot return no bytes.
+  virtual std::vector<uint8_t> SerializeProcessTreeSnapshot(
+      const ::santa::pb::v1::process_tree::Snapshot&) = 0;
 
+ protected:
+  // Calls the `serializer` overload for the type of event in `msg`. When `T` is a final class
+  // the calls are resolved at compile time and the event serialization can be inlined.
   template <typename T>
-  std::vector<uint8_t> SerializeMessageTemplate(const T& msg) {
-    return SerializeMessage(msg);
+  std::vector<uint8_t> VisitMessage(T* serializer, santa::EnrichedMessage& msg) {
+    return std::visit(
+        [this, serializer](const auto& arg) {
+          if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, santa::EnrichedExec>) {
+            return serializer->SerializeMessage(arg, CachedDecisionForExec(arg));
+          } else {
+            return serializer->SerializeMessage(arg);
+          }
+        },
+        msg.GetEnrichedMessage());
+  }
+
+  // Returns a buffer of `size` bytes for serialized output
+  std::vector<uint8_t> LeaseBuffer(size_t size) const {
+    return buffer_pool_ ? buffer_pool_->Lease(size) : std::vector<uint8_t>(size);
   }
 
+  // Calls `visit` with the exec argument or environment strings returned by `get` for each index
+  // below `count` until `max_bytes` of string data have been visited, 0 meaning no limit. The
+  // string that crosses the budget is cut short. Returns true if anything was left out.
+  template <typename Get, typename Visit>
+  static bool VisitBoundedExecStrings(uint32_t count, size_t max_bytes, Get get, Visit visit) {
+    size_t remaining = max_bytes ? max_bytes : SIZE_MAX;
+    for (uint32_t i = 0; i < count; i++) {
+      es_string_token_t tok = get(i);
+      if (tok.length > remaining) {
+        if (remaining > 0) {
+          visit(es_string_token_t{.length = remaining, .data = tok.data});
+        }
+        return true;
+      }
+      visit(tok);
+      remaining -= tok.length;
+    }
+    return false;
+  }
+
+  // Per exec budgets for logged arguments and environment variables
+  const size_t exec_args_max_bytes_;
+  const size_t exec_envs_max_bytes_;
+
+ private:
+  // Looks up the cached decision logged with an exec, refreshing it for allowed execs.
+  // This shouldn't be overridden by derived classes.
+  SNTCachedDecision* CachedDecisionForExec(const santa::EnrichedExec&);
+
   SNTDecisionCache* decision_cache_;
   std::atomic<bool> enabled_machine_id_{false};
-  std::shared_ptr<std::string> machine_id_;
-  // Used to ensure a reference sticks around while no vended copies exists
-  std::shared_ptr<std::string> saved_machine_id_;
+  ConcurrentMemoizer<std::shared_ptr<std::string>> machine_id_;
   Xxhash128 common_hash_state_;
+  std::shared_ptr<BufferPool> buffer_pool_;
 };
 
 }  // namespace santa
@@ -28,10 +28,20 @@
 
 namespace santa {
 
-Serializer::Serializer(SNTDecisionCache* decision_cache) : decision_cache_(decision_cache) {
-  machine_id_ = std::make_shared<std::string>("");
-  saved_machine_id_ = machine_id_;
-
+// The machine ID may be read from a plist whose contents can change without a configuration
+// change, so it is periodically re-read.
+static constexpr absl::Duration kMachineIDTTL = absl::Minutes(5);
+
+Serializer::Serializer(SNTDecisionCache* decision_cache)
+    : exec_args_max_bytes_([[SNTConfigurator configurator] telemetryExecArgsMaxBytes]),
+      exec_envs_max_bytes_([[SNTConfigurator configurator] telemetryExecEnvsMaxBytes]),
+      decision_cache_(decision_cache),
+      machine_id_(
+          [] {
+            NSString* configured_machine_id = [[SNTConfigurator configurator] machineID] ?: @"";
+            return std::make_shared<std::string>([configured_machine_id UTF8String]);
+          },
+          kMachineIDTTL) {
   UpdateMachineID();
 
   // Prime the xxHash state with invariant data
@@ -40,24 +50,10 @@ Serializer::Serializer(SNTDecisionCache* decision_cache) : decision_cache_(decis
 }
 
 void Serializer::UpdateMachineID() {
-  bool should_enable = [[SNTConfigurator configurator] enableMachineIDDecoration];
-
-  if (should_enable) {
-    NSString* configured_machine_id = [[SNTConfigurator configurator] machineID] ?: @"";
-    auto new_machine_id = std::make_shared<std::string>([configured_machine_id UTF8String]);
-
-    // Atomically update the shared_ptr - relaxed ordering is sufficient
-    // because we separately synchronize with the enabled_machine_id_ flag
-    std::atomic_store_explicit(&machine_id_, new_machine_id, std::memory_order_relaxed);
-
-    // Keep a reference to avoid deallocation
-    saved_machine_id_ = new_machine_id;
-
-    // Use release ordering to establish happens-before relationship with readers
-    enabled_machine_id_.store(true, std::memory_order_release);
-  } else {
-    enabled_machine_id_.store(false, std::memory_order_release);
-  }
+  // The next read picks up the new value, even if the cached one hasn't expired
+  machine_id_.Invalidate();
+  enabled_machine_id_.store([[SNTConfigurator configurator] enableMachineIDDecoration],
+                            std::memory_order_release);
 }
 
 bool Serializer::EnableMachineIDDecoration() const {
@@ -65,10 +61,10 @@ bool Serializer::EnableMachineIDDecoration() const {
 }
 
 std::shared_ptr<std::string> Serializer::MachineID() const {
-  return std::atomic_load_explicit(&machine_id_, std::memory_order_relaxed);
+  return machine_id_();
 }
 
-std::vector<uint8_t> Serializer::SerializeMessageTemplate(const santa::EnrichedExec& msg) {
+SNTCachedDecision* Serializer::CachedDecisionForExec(const santa::EnrichedExec& msg) {
   SNTCachedDecision* cd;
   if (msg->action_type == ES_ACTION_TYPE_NOTIFY &&
       msg->action.notify.result.auth == ES_AUTH_RESULT_ALLOW) {
@@ -78,7 +74,10 @@ std::vector<uint8_t> Serializer::SerializeMessageTemplate(const santa::EnrichedE
     cd = [decision_cache_ cachedDecisionForFile:msg->event.exec.target->executable->stat];
   }
 
-  return SerializeMessage(msg, cd);
+  // Execs allowed before their file was hashed get the hash attached in the background
+  [decision_cache_ waitForPendingSHA256OfDecision:cd];
+
+  return cd;
 }
 
 std::vector<uint8_t> Serializer::SerializeFileAccess(
@@ -121,4 +120,47 @@ std::vector<uint8_t> Serializer::SerializeNetworkFlows(SNDProcessFlows* processF
       [decision_cache_ cachedDecisionForVnode:[processFlows.processInfo vnode]]);
 }
 
+std::vector<uint8_t> Serializer::SerializeNetworkFlowsBatch(
+    NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+    struct timespec window_end, const std::vector<SNTCachedDecision*>& cds) {
+  std::vector<uint8_t> out;
+  for (NSUInteger i = 0; i < processFlows.count; i++) {
+    std::vector<uint8_t> ser =
+        SerializeNetworkFlows(processFlows[i], window_start, window_end, cds[i]);
+    out.insert(out.end(), ser.begin(), ser.end());
+  }
+  return out;
+}
+
+std::vector<uint8_t> Serializer::SerializeNetworkFlowsBatch(
+    NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+    struct timespec window_end) {
+  std::vector<SNTCachedDecision*> cds;
+  cds.reserve(processFlows.count);
+  for (SNDProcessFlows* pf in processFlows) {
+    cds.push_back([decision_cache_ cachedDecisionForVnode:[pf.processInfo vnode]]);
+  }
+  return SerializeNetworkFlowsBatch(processFlows, window_start, window_end, cds);
+}
+
+void Serializer::SerializeNetworkFlowsChunked(
+    NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+    struct timespec window_end, const std::vector<SNTCachedDecision*>& cds, size_t,
+    const std::function<void(std::vector<uint8_t>&&)>& emit) {
+  emit(SerializeNetworkFlowsBatch(processFlows, window_start, window_end, cds));
+}
+
+void Serializer::SerializeNetworkFlowsChunked(
+    NSArray<SNDProcessFlows*>* processFlows, struct timespec window_start,
+    struct timespec window_end, size_t max_flows_per_record,
+    const std::function<void(std::vector<uint8_t>&&)>& emit) {
+  std::vector<SNTCachedDecision*> cds;
+  cds.reserve(processFlows.count);
+  for (SNDProcessFlows* pf in processFlows) {
+    cds.push_back([decision_cache_ cachedDecisionForVnode:[pf.processInfo vnode]]);
+  }
+  SerializeNetworkFlowsChunked(processFlows, window_start, window_end, cds, max_flows_per_record,
+                               emit);
+}
+
 };  // namespace santa
@@ -0,0 +1,83 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_TELEMETRYFILTER_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_TELEMETRYFILTER_H
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#import <Foundation/Foundation.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Source/common/PrefixTree.h"
+#include "Source/common/Unit.h"
+#include "absl/container/flat_hash_set.h"
+
+namespace santa {
+
+// Drops file change telemetry before it is enriched and serialized.
+//
+// Each filter matches events whose target path is under one of its path
+// prefixes, whose instigating process has one of its signing IDs, or both
+// when both lists are given. Signing IDs use the same "TEAMID:signing_id" and
+// "platform:signing_id" forms as rules. Hits are counted against the first
+// matching filter.
+class TelemetryFilter {
+ public:
+  struct Filter {
+    std::string name;
+    std::vector<std::string> path_prefixes;
+    std::vector<std::string> signing_ids;
+  };
+
+  // Builds filters from the FileChangesTelemetryFilters configuration.
+  // Invalid entries are skipped. Returns nullptr if no filters remain.
+  static std::unique_ptr<TelemetryFilter> Create(NSArray<NSDictionary*>* config);
+
+  explicit TelemetryFilter(const std::vector<Filter>& filters);
+
+  TelemetryFilter(TelemetryFilter&& other) = delete;
+  TelemetryFilter& operator=(TelemetryFilter&& rhs) = delete;
+  TelemetryFilter(const TelemetryFilter& other) = delete;
+  TelemetryFilter& operator=(const TelemetryFilter& other) = delete;
+
+  // Returns true if the message matched a filter and should not be logged
+  bool ShouldDrop(const es_message_t* msg);
+
+  // Visit the number of hits for every filter
+  void ForEachHitCount(
+      bool reset,
+      const std::function<void(const std::string& name, uint64_t hits)>& callback);
+
+ private:
+  struct CompiledFilter {
+    std::string name;
+    // Null when the filter does not constrain the path
+    std::unique_ptr<PrefixTree<Unit>> path_prefixes;
+    absl::flat_hash_set<std::string> signing_ids;
+    std::atomic<uint64_t> hits{0};
+  };
+
+  std::vector<std::unique_ptr<CompiledFilter>> filters_;
+  bool needs_signing_id_ = false;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_TELEMETRYFILTER_H
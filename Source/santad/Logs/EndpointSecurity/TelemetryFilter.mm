@@ -0,0 +1,159 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/TelemetryFilter.h"
+
+#include <string_view>
+
+#import "Source/common/SNTLogging.h"
+#import "Source/common/String.h"
+
+namespace santa {
+
+static constexpr std::string_view kPlatformSigningIDPrefix = "platform:";
+
+static const es_file_t* TargetFileForFiltering(const es_message_t* msg) {
+  switch (msg->event_type) {
+    case ES_EVENT_TYPE_NOTIFY_CLONE: return msg->event.clone.source;
+    case ES_EVENT_TYPE_NOTIFY_CLOSE: return msg->event.close.target;
+    case ES_EVENT_TYPE_NOTIFY_COPYFILE: return msg->event.copyfile.source;
+    case ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA: return msg->event.exchangedata.file1;
+    case ES_EVENT_TYPE_NOTIFY_LINK: return msg->event.link.source;
+    case ES_EVENT_TYPE_NOTIFY_RENAME: return msg->event.rename.source;
+    case ES_EVENT_TYPE_NOTIFY_UNLINK: return msg->event.unlink.target;
+    default: return NULL;
+  }
+}
+
+// Formats the signing ID of the given process the way rules refer to it
+static bool SigningIDForProcess(const es_process_t* proc, std::string& out) {
+  if (proc->signing_id.length == 0) {
+    return false;
+  }
+
+  out.clear();
+  if (proc->is_platform_binary) {
+    out.append(kPlatformSigningIDPrefix);
+  } else if (proc->team_id.length > 0) {
+    out.append(StringTokenToStringView(proc->team_id));
+    out.append(":");
+  } else {
+    return false;
+  }
+  out.append(StringTokenToStringView(proc->signing_id));
+  return true;
+}
+
+static std::vector<std::string> StringsForKey(NSDictionary* dict, NSString* key) {
+  std::vector<std::string> strings;
+  id value = dict[key];
+  if (![value isKindOfClass:[NSArray class]]) {
+    return strings;
+  }
+
+  for (id item in value) {
+    if ([item isKindOfClass:[NSString class]] && [item length] > 0) {
+      strings.push_back(NSStringToUTF8String(item));
+    }
+  }
+  return strings;
+}
+
+std::unique_ptr<TelemetryFilter> TelemetryFilter::Create(NSArray<NSDictionary*>* config) {
+  std::vector<Filter> filters;
+  for (NSDictionary* entry in config) {
+    if (![entry isKindOfClass:[NSDictionary class]]) {
+      continue;
+    }
+
+    NSString* name = entry[@"Name"];
+    Filter filter{
+        .name = [name isKindOfClass:[NSString class]] ? NSStringToUTF8String(name)
+                                                      : "filter_" + std::to_string(filters.size()),
+        .path_prefixes = StringsForKey(entry, @"PathPrefixes"),
+        .signing_ids = StringsForKey(entry, @"SigningIDs"),
+    };
+
+    if (filter.path_prefixes.empty() && filter.signing_ids.empty()) {
+      LOGW(@"Ignoring telemetry filter \"%s\" without path prefixes or signing IDs",
+           filter.name.c_str());
+      continue;
+    }
+
+    filters.push_back(std::move(filter));
+  }
+
+  if (filters.empty()) {
+    return nullptr;
+  }
+
+  return std::make_unique<TelemetryFilter>(filters);
+}
+
+TelemetryFilter::TelemetryFilter(const std::vector<Filter>& filters) {
+  for (const Filter& filter : filters) {
+    auto compiled = std::make_unique<CompiledFilter>();
+    compiled->name = filter.name;
+
+    if (!filter.path_prefixes.empty()) {
+      compiled->path_prefixes = std::make_unique<PrefixTree<Unit>>();
+      for (const std::string& prefix : filter.path_prefixes) {
+        compiled->path_prefixes->InsertPrefix(prefix.c_str(), Unit{});
+      }
+    }
+
+    compiled->signing_ids.insert(filter.signing_ids.begin(), filter.signing_ids.end());
+    needs_signing_id_ |= !compiled->signing_ids.empty();
+
+    filters_.push_back(std::move(compiled));
+  }
+}
+
+bool TelemetryFilter::ShouldDrop(const es_message_t* msg) {
+  const es_file_t* target = TargetFileForFiltering(msg);
+  if (!target) {
+    return false;
+  }
+
+  thread_local std::string signing_id;
+  bool has_signing_id = needs_signing_id_ && SigningIDForProcess(msg->process, signing_id);
+
+  for (const auto& filter : filters_) {
+    if (filter->path_prefixes && !filter->path_prefixes->HasPrefix(target->path.data)) {
+      continue;
+    }
+
+    if (!filter->signing_ids.empty() &&
+        (!has_signing_id || !filter->signing_ids.contains(signing_id))) {
+      continue;
+    }
+
+    filter->hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  return false;
+}
+
+void TelemetryFilter::ForEachHitCount(
+    bool reset, const std::function<void(const std::string& name, uint64_t hits)>& callback) {
+  for (const auto& filter : filters_) {
+    uint64_t hits = reset ? filter->hits.exchange(0, std::memory_order_relaxed)
+                          : filter->hits.load(std::memory_order_relaxed);
+    callback(filter->name, hits);
+  }
+}
+
+}  // namespace santa
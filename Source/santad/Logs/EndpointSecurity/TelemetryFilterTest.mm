@@ -0,0 +1,111 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/TelemetryFilter.h"
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <map>
+#include <string>
+
+#include "Source/common/TestUtils.h"
+
+using santa::TelemetryFilter;
+
+static std::map<std::string, uint64_t> HitCounts(TelemetryFilter& filter, bool reset) {
+  std::map<std::string, uint64_t> counts;
+  filter.ForEachHitCount(reset, [&counts](const std::string& name, uint64_t hits) {
+    counts[name] = hits;
+  });
+  return counts;
+}
+
+@interface TelemetryFilterTest : XCTestCase
+@end
+
+@implementation TelemetryFilterTest
+
+- (void)testCreate {
+  XCTAssertTrue(TelemetryFilter::Create(nil) == nullptr);
+  XCTAssertTrue(TelemetryFilter::Create(@[]) == nullptr);
+
+  // Entries that cannot match anything are skipped
+  XCTAssertTrue(TelemetryFilter::Create(@[
+                  @{@"Name" : @"empty"},
+                  @{@"Name" : @"bad", @"PathPrefixes" : @"/tmp"},
+                  (NSDictionary*)@"not_a_dict",
+                ]) == nullptr);
+
+  auto sut = TelemetryFilter::Create(@[
+    @{@"Name" : @"build", @"PathPrefixes" : @[ @"/build/" ]},
+    @{@"SigningIDs" : @[ @"platform:com.apple.mds" ]},
+  ]);
+  XCTAssertTrue(sut != nullptr);
+
+  std::map<std::string, uint64_t> counts = HitCounts(*sut, false);
+  XCTAssertEqual(counts.size(), 2);
+  XCTAssertEqual(counts.count("build"), 1);
+  XCTAssertEqual(counts.count("filter_1"), 1);
+}
+
+- (void)testShouldDrop {
+  TelemetryFilter sut({
+      {.name = "build", .path_prefixes = {"/build/"}},
+      {.name = "mds", .signing_ids = {"platform:com.apple.mds"}},
+      {.name = "team_tmp", .path_prefixes = {"/tmp/"}, .signing_ids = {"ABCDE12345:com.foo"}},
+  });
+
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile);
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+
+  auto check = [&](const char* path, bool platform, const char* team_id, const char* signing_id) {
+    es_file_t file = MakeESFile(path);
+    esMsg.event.close.target = &file;
+    proc.is_platform_binary = platform;
+    proc.team_id = MakeESStringToken(team_id);
+    proc.signing_id = MakeESStringToken(signing_id);
+    return sut.ShouldDrop(&esMsg);
+  };
+
+  // Path prefix only
+  XCTAssertTrue(check("/build/out/a.o", false, "", ""));
+  XCTAssertFalse(check("/src/a.c", false, "", ""));
+
+  // Signing ID only
+  XCTAssertTrue(check("/src/a.c", true, "", "com.apple.mds"));
+  XCTAssertFalse(check("/src/a.c", false, "", "com.apple.mds"));
+
+  // Both must match
+  XCTAssertTrue(check("/tmp/x", false, "ABCDE12345", "com.foo"));
+  XCTAssertFalse(check("/tmp/x", false, "ABCDE12345", "com.bar"));
+  XCTAssertFalse(check("/var/x", false, "ABCDE12345", "com.foo"));
+
+  std::map<std::string, uint64_t> counts = HitCounts(sut, true);
+  XCTAssertEqual(counts["build"], 1);
+  XCTAssertEqual(counts["mds"], 1);
+  XCTAssertEqual(counts["team_tmp"], 1);
+
+  counts = HitCounts(sut, false);
+  XCTAssertEqual(counts["build"], 0);
+
+  // Only file change events are considered
+  es_message_t execMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXEC, &proc);
+  XCTAssertFalse(sut.ShouldDrop(&execMsg));
+}
+
+@end
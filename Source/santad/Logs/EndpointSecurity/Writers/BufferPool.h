@@ -0,0 +1,72 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_BUFFERPOOL_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_BUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Recycles the buffers serialized events are written into. A writer that
+// is done with a buffer returns it to the pool and serializers lease it back
+// for the next event, so steady state logging does not allocate a new
+// buffer per event.
+//
+// At most `max_buffers` buffers are retained, and buffers that grew larger
+// than `max_buffer_capacity` are freed rather than retained.
+class BufferPool {
+ public:
+  static constexpr size_t kDefaultMaxBuffers = 256;
+  static constexpr size_t kDefaultMaxBufferCapacity = 64 * 1024;
+
+  explicit BufferPool(size_t max_buffers = kDefaultMaxBuffers,
+                      size_t max_buffer_capacity = kDefaultMaxBufferCapacity)
+      : max_buffers_(max_buffers), max_buffer_capacity_(max_buffer_capacity) {}
+
+  BufferPool(BufferPool&& other) = delete;
+  BufferPool& operator=(BufferPool&& rhs) = delete;
+  BufferPool(const BufferPool& other) = delete;
+  BufferPool& operator=(const BufferPool& other) = delete;
+
+  // Returns a buffer of `size` bytes, reusing a returned buffer if available
+  std::vector<uint8_t> Lease(size_t size);
+
+  void Return(std::vector<uint8_t>&& buffer);
+
+  // Number of buffers currently available to be leased
+  size_t Available();
+
+  // Total capacity of the buffers currently available to be leased
+  size_t PooledBytes();
+
+  // Free every buffer currently available to be leased
+  void Trim();
+
+ private:
+  const size_t max_buffers_;
+  const size_t max_buffer_capacity_;
+  absl::Mutex mtx_;
+  std::vector<std::vector<uint8_t>> free_ ABSL_GUARDED_BY(mtx_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_BUFFERPOOL_H
@@ -0,0 +1,70 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/BufferPool.h"
+
+#include <utility>
+
+namespace santa {
+
+std::vector<uint8_t> BufferPool::Lease(size_t size) {
+  std::vector<uint8_t> buffer;
+  {
+    absl::MutexLock lock(mtx_);
+    if (!free_.empty()) {
+      buffer = std::move(free_.back());
+      free_.pop_back();
+    }
+  }
+
+  buffer.resize(size);
+  return buffer;
+}
+
+void BufferPool::Return(std::vector<uint8_t>&& buffer) {
+  if (buffer.capacity() == 0 || buffer.capacity() > max_buffer_capacity_) {
+    return;
+  }
+
+  buffer.clear();
+  absl::MutexLock lock(mtx_);
+  if (free_.size() < max_buffers_) {
+    free_.push_back(std::move(buffer));
+  }
+}
+
+size_t BufferPool::Available() {
+  absl::MutexLock lock(mtx_);
+  return free_.size();
+}
+
+size_t BufferPool::PooledBytes() {
+  absl::MutexLock lock(mtx_);
+  size_t bytes = 0;
+  for (const std::vector<uint8_t>& buffer : free_) {
+    bytes += buffer.capacity();
+  }
+  return bytes;
+}
+
+void BufferPool::Trim() {
+  std::vector<std::vector<uint8_t>> trimmed;
+  {
+    absl::MutexLock lock(mtx_);
+    std::swap(trimmed, free_);
+  }
+}
+
+}  // namespace santa
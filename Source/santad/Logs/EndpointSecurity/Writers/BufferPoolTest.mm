@@ -0,0 +1,78 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/BufferPool.h"
+
+#import <XCTest/XCTest.h>
+
+#include <vector>
+
+using santa::BufferPool;
+
+@interface BufferPoolTest : XCTestCase
+@end
+
+@implementation BufferPoolTest
+
+- (void)testReturnedBuffersAreReused {
+  BufferPool pool;
+
+  std::vector<uint8_t> buffer = pool.Lease(100);
+  XCTAssertEqual(buffer.size(), 100);
+  const uint8_t* storage = buffer.data();
+
+  pool.Return(std::move(buffer));
+  XCTAssertEqual(pool.Available(), 1);
+
+  std::vector<uint8_t> reused = pool.Lease(50);
+  XCTAssertEqual(reused.size(), 50);
+  XCTAssertEqual(reused.data(), storage);
+  XCTAssertEqual(pool.Available(), 0);
+}
+
+- (void)testLimits {
+  BufferPool pool(2, 1024);
+
+  // Oversized buffers are not retained
+  pool.Return(std::vector<uint8_t>(2048));
+  XCTAssertEqual(pool.Available(), 0);
+
+  // Neither are empty ones
+  pool.Return(std::vector<uint8_t>());
+  XCTAssertEqual(pool.Available(), 0);
+
+  for (int i = 0; i < 4; i++) {
+    pool.Return(std::vector<uint8_t>(16));
+  }
+  XCTAssertEqual(pool.Available(), 2);
+}
+
+- (void)testPooledBytesAndTrim {
+  BufferPool pool;
+  XCTAssertEqual(pool.PooledBytes(), 0);
+
+  std::vector<uint8_t> a(100);
+  std::vector<uint8_t> b(200);
+  size_t expected = a.capacity() + b.capacity();
+  pool.Return(std::move(a));
+  pool.Return(std::move(b));
+  XCTAssertEqual(pool.PooledBytes(), expected);
+
+  pool.Trim();
+  XCTAssertEqual(pool.Available(), 0);
+  XCTAssertEqual(pool.PooledBytes(), 0);
+}
+
+@end
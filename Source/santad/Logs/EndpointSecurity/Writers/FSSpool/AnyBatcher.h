@@ -30,7 +30,7 @@ class AnyBatcher {
   inline bool ShouldInitializeBeforeWrite() { return false; }
   absl::Status InitializeBatch(int fd);
   bool NeedToOpenFile();
-  absl::Status Write(std::vector<uint8_t> bytes);
+  absl::Status Write(const std::vector<uint8_t>& bytes);
   absl::StatusOr<size_t> CompleteBatch(int fd);
 
   std::string TypeURL() { return type_url_; }
@@ -0,0 +1,70 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_BATCHINDEX_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_BATCHINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto.pb.h"
+#include "absl/status/statusor.h"
+#include "google/protobuf/io/coded_stream.h"
+
+namespace fsspool {
+
+// Marks the index record and the trailer that follows it. Indexed batches
+// end with the index record:
+//
+//   magic | varint length | BatchIndex
+//
+// followed by a fixed size trailer so that readers can locate the index by
+// looking at the end of the uncompressed stream:
+//
+//   little endian 64-bit offset of the index record | magic
+static constexpr uint32_t kStreamBatcherIndexMagic = 0x58444E53;
+static constexpr size_t kBatchIndexTrailerSize =
+    sizeof(uint64_t) + sizeof(uint32_t);
+
+// Accumulates the index of a stream batch as records are written
+class BatchIndexBuilder {
+ public:
+  // Add a record starting at `offset` in the uncompressed stream. The event
+  // type and time are read from the serialized SantaMessage in `bytes`.
+  void Add(uint64_t offset, const std::vector<uint8_t>& bytes);
+
+  // Write the index record and trailer and reset the builder
+  void Write(google::protobuf::io::CodedOutputStream* output);
+
+  void Clear() { index_.Clear(); }
+
+ private:
+  santa::fsspool::binaryproto::BatchIndex index_;
+};
+
+// Read the SantaMessage event field number and event time from serialized
+// bytes without parsing the entire message. Returns false if the bytes are
+// malformed.
+bool ReadIndexFields(const uint8_t* data, size_t size, uint32_t* event_type,
+                     int64_t* event_time_ns);
+
+// Return the offset of the index record given the last
+// kBatchIndexTrailerSize bytes of an uncompressed stream
+absl::StatusOr<uint64_t> ReadBatchIndexTrailer(const uint8_t* trailer);
+
+}  // namespace fsspool
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_BATCHINDEX_H
@@ -0,0 +1,142 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/BatchIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "google/protobuf/wire_format_lite.h"
+
+using google::protobuf::internal::WireFormatLite;
+
+namespace fsspool {
+
+namespace {
+
+// Field numbers from santa.proto
+constexpr int kSantaMessageEventTimeField = 2;
+constexpr int kSantaMessageFirstEventField = 10;
+constexpr int kTimestampSecondsField = 1;
+constexpr int kTimestampNanosField = 2;
+
+bool ReadTimestamp(google::protobuf::io::CodedInputStream* input, int64_t* nanos_since_epoch) {
+  uint32_t length;
+  if (!input->ReadVarint32(&length)) {
+    return false;
+  }
+
+  google::protobuf::io::CodedInputStream::Limit limit = input->PushLimit(length);
+  uint64_t seconds = 0;
+  uint64_t nanos = 0;
+  while (uint32_t tag = input->ReadTag()) {
+    int field = WireFormatLite::GetTagFieldNumber(tag);
+    if (field == kTimestampSecondsField &&
+        WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_VARINT) {
+      if (!input->ReadVarint64(&seconds)) {
+        return false;
+      }
+    } else if (field == kTimestampNanosField &&
+               WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_VARINT) {
+      if (!input->ReadVarint64(&nanos)) {
+        return false;
+      }
+    } else if (!WireFormatLite::SkipField(input, tag)) {
+      return false;
+    }
+  }
+  input->PopLimit(limit);
+
+  *nanos_since_epoch = static_cast<int64_t>(seconds) * 1000000000 + static_cast<int64_t>(nanos);
+  return true;
+}
+
+}  // namespace
+
+bool ReadIndexFields(const uint8_t* data, size_t size, uint32_t* event_type,
+                     int64_t* event_time_ns) {
+  google::protobuf::io::CodedInputStream input(data, static_cast<int>(size));
+  *event_type = 0;
+  *event_time_ns = 0;
+
+  while (uint32_t tag = input.ReadTag()) {
+    int field = WireFormatLite::GetTagFieldNumber(tag);
+    if (field == kSantaMessageEventTimeField &&
+        WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      if (!ReadTimestamp(&input, event_time_ns)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (field >= kSantaMessageFirstEventField) {
+      *event_type = static_cast<uint32_t>(field);
+    }
+
+    // Event bodies are skipped without being parsed
+    if (!WireFormatLite::SkipField(&input, tag)) {
+      return false;
+    }
+  }
+
+  return input.ConsumedEntireMessage();
+}
+
+void BatchIndexBuilder::Add(uint64_t offset, const std::vector<uint8_t>& bytes) {
+  uint32_t event_type;
+  int64_t event_time_ns;
+  if (!ReadIndexFields(bytes.data(), bytes.size(), &event_type, &event_time_ns)) {
+    event_type = 0;
+    event_time_ns = 0;
+  }
+
+  if (event_time_ns != 0) {
+    if (index_.min_event_time_ns() == 0 || event_time_ns < index_.min_event_time_ns()) {
+      index_.set_min_event_time_ns(event_time_ns);
+    }
+    index_.set_max_event_time_ns(std::max(index_.max_event_time_ns(), event_time_ns));
+  }
+
+  index_.add_offsets(offset);
+  index_.add_event_types(event_type);
+  index_.add_event_times_ns(event_time_ns);
+}
+
+void BatchIndexBuilder::Write(google::protobuf::io::CodedOutputStream* output) {
+  uint64_t index_offset = static_cast<uint64_t>(output->ByteCount());
+
+  output->WriteLittleEndian32(kStreamBatcherIndexMagic);
+  output->WriteVarint32(static_cast<uint32_t>(index_.ByteSizeLong()));
+  index_.SerializeWithCachedSizes(output);
+
+  output->WriteLittleEndian64(index_offset);
+  output->WriteLittleEndian32(kStreamBatcherIndexMagic);
+
+  index_.Clear();
+}
+
+absl::StatusOr<uint64_t> ReadBatchIndexTrailer(const uint8_t* trailer) {
+  google::protobuf::io::CodedInputStream input(trailer, kBatchIndexTrailerSize);
+  uint64_t offset;
+  uint32_t magic;
+  if (!input.ReadLittleEndian64(&offset) || !input.ReadLittleEndian32(&magic) ||
+      magic != kStreamBatcherIndexMagic) {
+    return absl::NotFoundError("No batch index trailer found");
+  }
+  return offset;
+}
+
+}  // namespace fsspool
@@ -0,0 +1,249 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/BatchIndex.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Source/common/santa.pb.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "zstd.h"
+
+using santa::fsspool::binaryproto::BatchIndex;
+namespace pbv1 = ::santa::pb::v1;
+
+static constexpr int kNumRecords = 3000;
+static constexpr int64_t kBaseEventTimeSecs = 1700000000;
+
+static std::vector<uint8_t> MakeRecord(int i) {
+  pbv1::SantaMessage msg;
+  msg.set_machine_id(std::string(1024, 'a' + (i % 26)));
+  msg.mutable_event_time()->set_seconds(kBaseEventTimeSecs + i);
+  msg.mutable_event_time()->set_nanos(i);
+  if (i % 2 == 0) {
+    msg.mutable_execution()->mutable_instigator()->set_pid(i);
+  } else {
+    msg.mutable_fork()->mutable_instigator()->set_pid(i);
+  }
+
+  std::vector<uint8_t> bytes(msg.ByteSizeLong());
+  msg.SerializeToArray(bytes.data(), (int)bytes.size());
+  return bytes;
+}
+
+// Parse the index given the end of a stream, where `data` begins at
+// `base_offset` within the stream
+static BatchIndex ParseIndex(const uint8_t* data, size_t size, uint64_t base_offset = 0) {
+  BatchIndex index;
+  absl::StatusOr<uint64_t> offset =
+      fsspool::ReadBatchIndexTrailer(data + size - fsspool::kBatchIndexTrailerSize);
+  if (!offset.ok() || *offset < base_offset) {
+    return index;
+  }
+
+  uint64_t relative = *offset - base_offset;
+  google::protobuf::io::CodedInputStream input(data + relative, (int)(size - relative));
+  uint32_t magic;
+  uint32_t length;
+  if (input.ReadLittleEndian32(&magic) && magic == fsspool::kStreamBatcherIndexMagic &&
+      input.ReadVarint32(&length)) {
+    google::protobuf::io::CodedInputStream::Limit limit = input.PushLimit(length);
+    index.ParseFromCodedStream(&input);
+    input.PopLimit(limit);
+  }
+  return index;
+}
+
+template <typename T>
+static NSData* WriteBatch(T& batcher, NSString* path) {
+  int fd = open(path.UTF8String, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+  if (fd < 0 || !batcher.InitializeBatch(fd).ok()) {
+    return nil;
+  }
+
+  for (int i = 0; i < kNumRecords; i++) {
+    if (!batcher.Write(MakeRecord(i)).ok()) {
+      close(fd);
+      return nil;
+    }
+  }
+
+  bool completed = batcher.CompleteBatch(fd).ok();
+  close(fd);
+  return completed ? [NSData dataWithContentsOfFile:path] : nil;
+}
+
+@interface BatchIndexTest : XCTestCase
+@property NSString* testDir;
+@end
+
+@implementation BatchIndexTest
+
+- (void)setUp {
+  self.testDir = [NSString
+      stringWithFormat:@"%@santa-batch-index-test-%d", NSTemporaryDirectory(), getpid()];
+  XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:self.testDir
+                                          withIntermediateDirectories:YES
+                                                           attributes:nil
+                                                                error:nil]);
+}
+
+- (void)tearDown {
+  XCTAssertTrue([[NSFileManager defaultManager] removeItemAtPath:self.testDir error:nil]);
+}
+
+- (void)verifyIndex:(const BatchIndex&)index {
+  XCTAssertEqual(index.offsets_size(), kNumRecords);
+  XCTAssertEqual(index.event_types_size(), kNumRecords);
+  XCTAssertEqual(index.event_times_ns_size(), kNumRecords);
+  XCTAssertEqual(index.min_event_time_ns(), kBaseEventTimeSecs * 1000000000);
+  XCTAssertEqual(index.max_event_time_ns(),
+                 (kBaseEventTimeSecs + kNumRecords - 1) * 1000000000 + kNumRecords - 1);
+  XCTAssertEqual(index.offsets(0), 0);
+  XCTAssertEqual(index.event_types(0), pbv1::SantaMessage::kExecution);
+  XCTAssertEqual(index.event_types(1), pbv1::SantaMessage::kFork);
+  XCTAssertEqual(index.event_times_ns(10), (kBaseEventTimeSecs + 10) * 1000000000 + 10);
+}
+
+- (void)testReadIndexFields {
+  std::vector<uint8_t> bytes = MakeRecord(7);
+  uint32_t eventType;
+  int64_t eventTimeNs;
+  XCTAssertTrue(fsspool::ReadIndexFields(bytes.data(), bytes.size(), &eventType, &eventTimeNs));
+  XCTAssertEqual(eventType, pbv1::SantaMessage::kFork);
+  XCTAssertEqual(eventTimeNs, (kBaseEventTimeSecs + 7) * 1000000000 + 7);
+
+  // Truncated messages are rejected
+  XCTAssertFalse(
+      fsspool::ReadIndexFields(bytes.data(), bytes.size() - 1, &eventType, &eventTimeNs));
+}
+
+- (void)testUncompressedBatch {
+  fsspool::UncompressedStreamBatcher batcher(true);
+  NSData* data = WriteBatch(batcher, [self.testDir stringByAppendingPathComponent:@"raw"]);
+  XCTAssertNotNil(data);
+
+  BatchIndex index = ParseIndex((const uint8_t*)data.bytes, data.length);
+  [self verifyIndex:index];
+
+  // Records can be read directly from their indexed offset
+  const uint8_t* record = (const uint8_t*)data.bytes + index.offsets(42);
+  uint32_t magic;
+  memcpy(&magic, record, sizeof(magic));
+  XCTAssertEqual(magic, fsspool::kStreamBatcherMagic);
+}
+
+- (void)testZstdBatchRandomAccess {
+  fsspool::ZstdStreamBatcher batcher(
+      ^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
+        return fsspool::ZstdOutputStream::Create(raw_stream);
+      },
+      true);
+  NSData* data = WriteBatch(batcher, [self.testDir stringByAppendingPathComponent:@"zstd"]);
+  XCTAssertNotNil(data);
+  const uint8_t* bytes = (const uint8_t*)data.bytes;
+
+  absl::StatusOr<std::vector<fsspool::ZstdOutputStream::SeekTableEntry>> seekTable =
+      fsspool::ZstdOutputStream::ReadSeekTable(bytes, data.length);
+  XCTAssertTrue(seekTable.ok());
+  XCTAssertGreaterThan(seekTable->size(), 1);
+
+  std::vector<uint64_t> compressedOffsets;
+  std::vector<uint64_t> decompressedOffsets;
+  uint64_t compressedOffset = 0;
+  uint64_t decompressedOffset = 0;
+  for (const auto& entry : *seekTable) {
+    compressedOffsets.push_back(compressedOffset);
+    decompressedOffsets.push_back(decompressedOffset);
+    compressedOffset += entry.compressed_size;
+    decompressedOffset += entry.decompressed_size;
+  }
+
+  // Decompress from the given frame to the end of the stream
+  auto decompressFrom = [&](size_t frame) {
+    std::vector<uint8_t> out;
+    for (size_t i = frame; i < seekTable->size(); i++) {
+      const auto& entry = (*seekTable)[i];
+      size_t start = out.size();
+      out.resize(start + entry.decompressed_size);
+      size_t result = ZSTD_decompress(out.data() + start, entry.decompressed_size,
+                                      bytes + compressedOffsets[i], entry.compressed_size);
+      XCTAssertEqual(result, entry.decompressed_size);
+    }
+    return out;
+  };
+
+  auto frameForOffset = [&](uint64_t offset) {
+    size_t frame = 0;
+    while (frame + 1 < decompressedOffsets.size() && decompressedOffsets[frame + 1] <= offset) {
+      frame++;
+    }
+    return frame;
+  };
+
+  // The trailer is found by decompressing only the last frame
+  std::vector<uint8_t> lastFrame = decompressFrom(seekTable->size() - 1);
+  XCTAssertGreaterThanOrEqual(lastFrame.size(), fsspool::kBatchIndexTrailerSize);
+  absl::StatusOr<uint64_t> indexOffset = fsspool::ReadBatchIndexTrailer(
+      lastFrame.data() + lastFrame.size() - fsspool::kBatchIndexTrailerSize);
+  XCTAssertTrue(indexOffset.ok());
+
+  size_t indexFrame = frameForOffset(*indexOffset);
+  std::vector<uint8_t> tail = decompressFrom(indexFrame);
+  BatchIndex index = ParseIndex(tail.data(), tail.size(), decompressedOffsets[indexFrame]);
+  [self verifyIndex:index];
+
+  // Read a single record near the end without decompressing the earlier frames
+  int target = kNumRecords - 10;
+  size_t recordFrame = frameForOffset(index.offsets(target));
+  XCTAssertGreaterThan(recordFrame, 0);
+  std::vector<uint8_t> fromRecord = decompressFrom(recordFrame);
+  uint64_t relative = index.offsets(target) - decompressedOffsets[recordFrame];
+
+  google::protobuf::io::CodedInputStream input(fromRecord.data() + relative,
+                                               (int)(fromRecord.size() - relative));
+  uint32_t magic;
+  uint64_t hash;
+  uint32_t length;
+  XCTAssertTrue(input.ReadLittleEndian32(&magic));
+  XCTAssertEqual(magic, fsspool::kStreamBatcherMagic);
+  XCTAssertTrue(input.ReadLittleEndian64(&hash));
+  XCTAssertTrue(input.ReadVarint32(&length));
+  std::string payload;
+  XCTAssertTrue(input.ReadString(&payload, length));
+
+  pbv1::SantaMessage msg;
+  XCTAssertTrue(msg.ParseFromString(payload));
+  XCTAssertEqual(msg.event_time().seconds(), kBaseEventTimeSecs + target);
+
+  // The whole file is still a valid zstd stream
+  unsigned long long totalSize = ZSTD_decompressBound(bytes, data.length);
+  XCTAssertNotEqual(totalSize, ZSTD_CONTENTSIZE_ERROR);
+  std::vector<uint8_t> all(totalSize);
+  size_t result = ZSTD_decompress(all.data(), all.size(), bytes, data.length);
+  XCTAssertFalse(ZSTD_isError(result));
+  XCTAssertEqual(result, decompressedOffset);
+}
+
+@end
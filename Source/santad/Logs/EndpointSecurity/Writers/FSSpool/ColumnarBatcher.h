@@ -0,0 +1,98 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNARBATCHER_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNARBATCHER_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Source/common/santa.pb.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace fsspool {
+
+// ColumnarBatch schema_version of batches with a process dictionary
+constexpr uint32_t kColumnarSchemaVersionProcessDictionary = 2;
+
+// Buffers records in memory, like the AnyBatcher, and writes each batch as a
+// ColumnarBatch. Records are split into columns on the wire format, so event
+// bodies are copied without being parsed.
+//
+// With `process_dictionary` set, the top level ProcessInfo and
+// ProcessInfoLight fields of each event are also moved into a per batch
+// dictionary so that a process shared by many events is only stored once.
+class ColumnarBatcher {
+ public:
+  explicit ColumnarBatcher(bool process_dictionary = false)
+      : process_dictionary_(process_dictionary) {}
+
+  inline bool ShouldInitializeBeforeWrite() { return false; }
+  absl::Status InitializeBatch(int fd) { return absl::OkStatus(); }
+  bool NeedToOpenFile() { return batch_.num_rows() > 0; }
+  absl::Status Write(const std::vector<uint8_t>& bytes);
+  absl::StatusOr<size_t> CompleteBatch(int fd);
+
+ private:
+  class StringColumnBuilder {
+   public:
+    // Append a row to `column`. Rows without a value are unset.
+    void Add(std::optional<std::string_view> value,
+             santa::fsspool::binaryproto::StringColumn* column);
+    void Clear() { indexes_.clear(); }
+
+   private:
+    absl::flat_hash_map<std::string, uint32_t> indexes_;
+  };
+
+  // Returns the 1-based index of `process` in the process dictionary
+  uint32_t InternProcess(std::string_view process);
+
+  bool process_dictionary_;
+  santa::fsspool::binaryproto::ColumnarBatch batch_;
+  // Index into batch_.events of the column for each event field number
+  absl::flat_hash_map<uint32_t, int> event_columns_;
+  // 1-based index into batch_.processes of each serialized process
+  absl::flat_hash_map<std::string, uint32_t> process_indexes_;
+  StringColumnBuilder machine_ids_;
+  StringColumnBuilder boot_session_uuids_;
+};
+
+// Reassembles the SantaMessage records of a ColumnarBatch in row order
+class ColumnarBatchReader {
+ public:
+  explicit ColumnarBatchReader(
+      const santa::fsspool::binaryproto::ColumnarBatch& batch);
+
+  // Returns OutOfRangeError once all rows have been read
+  absl::StatusOr<::santa::pb::v1::SantaMessage> Next();
+
+ private:
+  const santa::fsspool::binaryproto::ColumnarBatch& batch_;
+  uint64_t row_ = 0;
+  int extra_index_ = 0;
+  // Next value to read from each event column, keyed by field number
+  absl::flat_hash_map<uint32_t, std::pair<int, int>> event_cursors_;
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNARBATCHER_H
@@ -0,0 +1,405 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
+
+#include <limits.h>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool_platform_specific.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/timestamp.pb.h"
+#include "google/protobuf/wire_format_lite.h"
+
+using google::protobuf::internal::WireFormatLite;
+using santa::fsspool::binaryproto::ColumnarBatch;
+using santa::fsspool::binaryproto::EventColumn;
+using santa::fsspool::binaryproto::ProcessRefs;
+using santa::fsspool::binaryproto::StringColumn;
+
+namespace fsspool {
+
+namespace {
+
+// Field numbers from santa.proto
+constexpr int kSantaMessageMachineIdField = 1;
+constexpr int kSantaMessageEventTimeField = 2;
+constexpr int kSantaMessageProcessedTimeField = 3;
+constexpr int kSantaMessageBootSessionUuidField = 4;
+
+constexpr int64_t kNanosPerSecond = 1000000000;
+
+bool IsEventField(int field_number) {
+  static const google::protobuf::OneofDescriptor* events =
+      ::santa::pb::v1::SantaMessage::descriptor()->FindOneofByName("event");
+  const google::protobuf::FieldDescriptor* field =
+      ::santa::pb::v1::SantaMessage::descriptor()->FindFieldByNumber(field_number);
+  return field && field->containing_oneof() == events;
+}
+
+bool IsProcessField(const google::protobuf::Descriptor* event, int field_number) {
+  const google::protobuf::FieldDescriptor* field = event->FindFieldByNumber(field_number);
+  if (!field || field->is_repeated() ||
+      field->type() != google::protobuf::FieldDescriptor::TYPE_MESSAGE) {
+    return false;
+  }
+  return field->message_type() == ::santa::pb::v1::ProcessInfo::descriptor() ||
+         field->message_type() == ::santa::pb::v1::ProcessInfoLight::descriptor();
+}
+
+// Splits the top level process fields out of a serialized event. The other
+// fields are copied to `remainder` unchanged.
+absl::Status SplitProcesses(uint32_t event_type, std::string_view event, std::string* remainder,
+                            std::vector<std::pair<uint32_t, std::string_view>>* processes) {
+  const google::protobuf::Descriptor* descriptor =
+      ::santa::pb::v1::SantaMessage::descriptor()->FindFieldByNumber(event_type)->message_type();
+  if (!descriptor) {
+    remainder->assign(event);
+    return absl::OkStatus();
+  }
+
+  remainder->reserve(event.size());
+  google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t*>(event.data()),
+                                               static_cast<int>(event.size()));
+  while (true) {
+    int field_start = input.CurrentPosition();
+    uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      break;
+    }
+
+    int field = WireFormatLite::GetTagFieldNumber(tag);
+    if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+        !IsProcessField(descriptor, field)) {
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        return absl::InvalidArgumentError("Malformed telemetry event");
+      }
+      remainder->append(event.data() + field_start, input.CurrentPosition() - field_start);
+      continue;
+    }
+
+    uint32_t length;
+    if (!input.ReadVarint32(&length) || length > event.size() - input.CurrentPosition()) {
+      return absl::InvalidArgumentError("Malformed telemetry event");
+    }
+    processes->emplace_back(field, event.substr(input.CurrentPosition(), length));
+    input.Skip(static_cast<int>(length));
+  }
+
+  if (!input.ConsumedEntireMessage()) {
+    return absl::InvalidArgumentError("Malformed telemetry event");
+  }
+  return absl::OkStatus();
+}
+
+bool ReadTimestamp(std::string_view bytes, int64_t* nanos_since_epoch) {
+  google::protobuf::Timestamp timestamp;
+  if (!timestamp.ParseFromArray(bytes.data(), static_cast<int>(bytes.size()))) {
+    return false;
+  }
+  *nanos_since_epoch = timestamp.seconds() * kNanosPerSecond + timestamp.nanos();
+  return true;
+}
+
+google::protobuf::Timestamp TimestampFromNanos(int64_t nanos_since_epoch) {
+  google::protobuf::Timestamp timestamp;
+  int64_t seconds = nanos_since_epoch / kNanosPerSecond;
+  int64_t nanos = nanos_since_epoch % kNanosPerSecond;
+  if (nanos < 0) {
+    seconds--;
+    nanos += kNanosPerSecond;
+  }
+  timestamp.set_seconds(seconds);
+  timestamp.set_nanos(static_cast<int32_t>(nanos));
+  return timestamp;
+}
+
+// Returns the value of `row`, or nullptr if the row is unset
+absl::StatusOr<const std::string*> ReadString(const StringColumn& column, uint64_t row) {
+  if (row >= static_cast<uint64_t>(column.indexes_size())) {
+    return absl::DataLossError("String column is missing rows");
+  }
+  uint32_t index = column.indexes(static_cast<int>(row));
+  if (index == 0) {
+    return nullptr;
+  }
+  if (index > static_cast<uint32_t>(column.dictionary_size())) {
+    return absl::DataLossError("String column index out of range");
+  }
+  return &column.dictionary(static_cast<int>(index - 1));
+}
+
+}  // namespace
+
+void ColumnarBatcher::StringColumnBuilder::Add(std::optional<std::string_view> value,
+                                               StringColumn* column) {
+  if (!value.has_value()) {
+    column->add_indexes(0);
+    return;
+  }
+
+  auto it = indexes_.find(*value);
+  if (it == indexes_.end()) {
+    column->add_dictionary(std::string(*value));
+    it = indexes_.emplace(std::string(*value), column->dictionary_size()).first;
+  }
+  column->add_indexes(it->second);
+}
+
+uint32_t ColumnarBatcher::InternProcess(std::string_view process) {
+  auto it = process_indexes_.find(process);
+  if (it == process_indexes_.end()) {
+    batch_.add_processes(std::string(process));
+    it = process_indexes_.emplace(std::string(process), batch_.processes_size()).first;
+  }
+  return it->second;
+}
+
+absl::Status ColumnarBatcher::Write(const std::vector<uint8_t>& bytes) {
+  if (bytes.size() > INT_MAX) {
+    return absl::InternalError("Telemetry event size too large");
+  }
+
+  const char* data = reinterpret_cast<const char*>(bytes.data());
+  google::protobuf::io::CodedInputStream input(bytes.data(), static_cast<int>(bytes.size()));
+
+  std::optional<std::string_view> machine_id;
+  std::optional<std::string_view> boot_session_uuid;
+  int64_t event_time_ns = 0;
+  int64_t processed_time_ns = 0;
+  uint32_t event_type = 0;
+  std::string_view event;
+  std::string extra_fields;
+
+  // Split the record into its top level fields without parsing the event
+  while (true) {
+    int field_start = input.CurrentPosition();
+    uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      break;
+    }
+
+    int field = WireFormatLite::GetTagFieldNumber(tag);
+    bool is_column =
+        WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED &&
+        (field <= kSantaMessageBootSessionUuidField || IsEventField(field));
+    if (!is_column) {
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        return absl::InvalidArgumentError("Malformed telemetry event");
+      }
+      extra_fields.append(data + field_start, input.CurrentPosition() - field_start);
+      continue;
+    }
+
+    uint32_t length;
+    if (!input.ReadVarint32(&length) || length > bytes.size() - input.CurrentPosition()) {
+      return absl::InvalidArgumentError("Malformed telemetry event");
+    }
+    std::string_view value(data + input.CurrentPosition(), length);
+    input.Skip(static_cast<int>(length));
+
+    switch (field) {
+      case kSantaMessageMachineIdField: machine_id = value; break;
+      case kSantaMessageBootSessionUuidField: boot_session_uuid = value; break;
+      case kSantaMessageEventTimeField:
+        if (!ReadTimestamp(value, &event_time_ns)) {
+          return absl::InvalidArgumentError("Malformed telemetry event time");
+        }
+        break;
+      case kSantaMessageProcessedTimeField:
+        if (!ReadTimestamp(value, &processed_time_ns)) {
+          return absl::InvalidArgumentError("Malformed telemetry processed time");
+        }
+        break;
+      default:
+        event_type = static_cast<uint32_t>(field);
+        event = value;
+        break;
+    }
+  }
+
+  if (!input.ConsumedEntireMessage()) {
+    return absl::InvalidArgumentError("Malformed telemetry event");
+  }
+
+  std::string event_remainder;
+  std::vector<std::pair<uint32_t, std::string_view>> processes;
+  if (process_dictionary_ && event_type != 0) {
+    if (absl::Status status = SplitProcesses(event_type, event, &event_remainder, &processes);
+        !status.ok()) {
+      return status;
+    }
+  }
+
+  // The record is only added once it is known to be well formed so that the
+  // columns stay the same length
+  batch_.add_event_times_ns(event_time_ns);
+  batch_.add_processed_times_ns(processed_time_ns);
+  machine_ids_.Add(machine_id, batch_.mutable_machine_ids());
+  boot_session_uuids_.Add(boot_session_uuid, batch_.mutable_boot_session_uuids());
+  batch_.add_event_types(event_type);
+
+  if (event_type != 0) {
+    auto [it, inserted] = event_columns_.try_emplace(event_type, batch_.events_size());
+    if (inserted) {
+      batch_.add_events()->set_field_number(event_type);
+    }
+    EventColumn* column = batch_.mutable_events(it->second);
+    if (process_dictionary_) {
+      column->add_values(std::move(event_remainder));
+      ProcessRefs* refs = column->add_process_refs();
+      for (const auto& [field_number, process] : processes) {
+        refs->add_field_numbers(field_number);
+        refs->add_indexes(InternProcess(process));
+      }
+    } else {
+      column->add_values(std::string(event));
+    }
+  }
+
+  if (!extra_fields.empty()) {
+    batch_.add_extra_field_rows(batch_.num_rows());
+    batch_.add_extra_fields(std::move(extra_fields));
+  }
+
+  batch_.set_num_rows(batch_.num_rows() + 1);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<size_t> ColumnarBatcher::CompleteBatch(int fd) {
+  if (process_dictionary_) {
+    batch_.set_schema_version(kColumnarSchemaVersionProcessDictionary);
+  }
+
+  std::string msg;
+  if (!batch_.SerializeToString(&msg)) {
+    return absl::InternalError("Failed to serialize internal ColumnarBatch cache.");
+  }
+
+  absl::Status status = WriteBuffer(fd, msg);
+
+  batch_.Clear();
+  event_columns_.clear();
+  process_indexes_.clear();
+  machine_ids_.Clear();
+  boot_session_uuids_.Clear();
+
+  if (!status.ok()) {
+    return status;
+  }
+  return msg.size();
+}
+
+ColumnarBatchReader::ColumnarBatchReader(const ColumnarBatch& batch) : batch_(batch) {
+  for (int i = 0; i < batch_.events_size(); i++) {
+    event_cursors_.try_emplace(batch_.events(i).field_number(), i, 0);
+  }
+}
+
+absl::StatusOr<::santa::pb::v1::SantaMessage> ColumnarBatchReader::Next() {
+  if (batch_.schema_version() > kColumnarSchemaVersionProcessDictionary) {
+    return absl::UnimplementedError("Unsupported columnar batch schema version");
+  }
+  if (row_ >= batch_.num_rows()) {
+    return absl::OutOfRangeError("No more data");
+  }
+
+  int row = static_cast<int>(row_);
+  if (row >= batch_.event_times_ns_size() || row >= batch_.processed_times_ns_size() ||
+      row >= batch_.event_types_size()) {
+    return absl::DataLossError("Columnar batch is missing rows");
+  }
+
+  ::santa::pb::v1::SantaMessage msg;
+  if (batch_.event_times_ns(row) != 0) {
+    *msg.mutable_event_time() = TimestampFromNanos(batch_.event_times_ns(row));
+  }
+  if (batch_.processed_times_ns(row) != 0) {
+    *msg.mutable_processed_time() = TimestampFromNanos(batch_.processed_times_ns(row));
+  }
+
+  absl::StatusOr<const std::string*> machine_id = ReadString(batch_.machine_ids(), row_);
+  if (!machine_id.ok()) {
+    return machine_id.status();
+  }
+  if (*machine_id) {
+    msg.set_machine_id(**machine_id);
+  }
+
+  absl::StatusOr<const std::string*> boot_session_uuid =
+      ReadString(batch_.boot_session_uuids(), row_);
+  if (!boot_session_uuid.ok()) {
+    return boot_session_uuid.status();
+  }
+  if (*boot_session_uuid) {
+    msg.set_boot_session_uuid(**boot_session_uuid);
+  }
+
+  if (uint32_t event_type = batch_.event_types(row); event_type != 0) {
+    auto it = event_cursors_.find(event_type);
+    const google::protobuf::FieldDescriptor* field =
+        ::santa::pb::v1::SantaMessage::descriptor()->FindFieldByNumber(event_type);
+    if (it == event_cursors_.end() || !field || !IsEventField(event_type)) {
+      return absl::DataLossError("Unknown event column");
+    }
+
+    auto& [column, value] = it->second;
+    const EventColumn& events = batch_.events(column);
+    if (value >= events.values_size()) {
+      return absl::DataLossError("Event column is missing rows");
+    }
+    google::protobuf::Message* event = msg.GetReflection()->MutableMessage(&msg, field);
+    if (!event->ParseFromString(events.values(value))) {
+      return absl::DataLossError("Failed to parse event");
+    }
+
+    // Put back the processes that were moved into the process dictionary
+    if (events.process_refs_size() > 0) {
+      if (value >= events.process_refs_size()) {
+        return absl::DataLossError("Event column is missing process references");
+      }
+      const ProcessRefs& refs = events.process_refs(value);
+      if (refs.field_numbers_size() != refs.indexes_size()) {
+        return absl::DataLossError("Malformed process references");
+      }
+      for (int i = 0; i < refs.indexes_size(); i++) {
+        const google::protobuf::FieldDescriptor* process_field =
+            event->GetDescriptor()->FindFieldByNumber(refs.field_numbers(i));
+        uint32_t index = refs.indexes(i);
+        if (!IsProcessField(event->GetDescriptor(), refs.field_numbers(i)) || index == 0 ||
+            index > static_cast<uint32_t>(batch_.processes_size())) {
+          return absl::DataLossError("Process reference out of range");
+        }
+        if (!event->GetReflection()
+                 ->MutableMessage(event, process_field)
+                 ->MergeFromString(batch_.processes(static_cast<int>(index - 1)))) {
+          return absl::DataLossError("Failed to parse process");
+        }
+      }
+    }
+    value++;
+  }
+
+  if (extra_index_ < batch_.extra_field_rows_size() &&
+      batch_.extra_field_rows(extra_index_) == row_) {
+    if (!msg.MergeFromString(batch_.extra_fields(extra_index_++))) {
+      return absl::DataLossError("Failed to parse extra fields");
+    }
+  }
+
+  row_++;
+  return msg;
+}
+
+}  // namespace fsspool
@@ -0,0 +1,216 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "Source/common/santa.pb.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto.pb.h"
+#include "absl/status/statusor.h"
+
+using santa::fsspool::binaryproto::ColumnarBatch;
+namespace pbv1 = ::santa::pb::v1;
+
+static std::vector<uint8_t> Serialize(const pbv1::SantaMessage& msg) {
+  std::string bytes = msg.SerializeAsString();
+  return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+static pbv1::SantaMessage MakeMessage(int64_t seconds, int32_t pid, bool exec) {
+  pbv1::SantaMessage msg;
+  msg.set_machine_id("my_machine");
+  msg.set_boot_session_uuid("my_boot");
+  msg.mutable_event_time()->set_seconds(seconds);
+  msg.mutable_event_time()->set_nanos(123);
+  msg.mutable_processed_time()->set_seconds(seconds + 1);
+  if (exec) {
+    msg.mutable_execution()->mutable_instigator()->mutable_id()->set_pid(pid);
+  } else {
+    msg.mutable_fork()->mutable_instigator()->mutable_id()->set_pid(pid);
+  }
+  return msg;
+}
+
+@interface ColumnarBatcherTest : XCTestCase
+@property NSString* testFile;
+@end
+
+@implementation ColumnarBatcherTest
+
+- (void)setUp {
+  self.testFile = [NSString
+      stringWithFormat:@"%@santa-columnar-batcher-test-%d", NSTemporaryDirectory(), getpid()];
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.testFile error:nil];
+}
+
+- (ColumnarBatch)completeBatch:(::fsspool::ColumnarBatcher&)batcher {
+  XCTAssertTrue([[NSFileManager defaultManager] createFileAtPath:self.testFile
+                                                        contents:nil
+                                                      attributes:nil]);
+  NSFileHandle* handle = [NSFileHandle fileHandleForWritingAtPath:self.testFile];
+  absl::StatusOr<size_t> size = batcher.CompleteBatch(handle.fileDescriptor);
+  [handle closeFile];
+  XCTAssertTrue(size.ok());
+
+  NSData* data = [NSData dataWithContentsOfFile:self.testFile];
+  XCTAssertEqual(data.length, *size);
+
+  ColumnarBatch batch;
+  XCTAssertTrue(batch.ParseFromArray(data.bytes, (int)data.length));
+  return batch;
+}
+
+- (void)testColumns {
+  ::fsspool::ColumnarBatcher batcher;
+  XCTAssertFalse(batcher.NeedToOpenFile());
+
+  std::vector<pbv1::SantaMessage> messages = {
+      MakeMessage(100, 1, true),
+      MakeMessage(200, 2, false),
+      MakeMessage(300, 3, true),
+  };
+  messages[2].set_machine_id("other_machine");
+
+  for (const auto& msg : messages) {
+    XCTAssertTrue(batcher.Write(Serialize(msg)).ok());
+  }
+  XCTAssertTrue(batcher.NeedToOpenFile());
+
+  ColumnarBatch batch = [self completeBatch:batcher];
+  XCTAssertFalse(batcher.NeedToOpenFile());
+
+  XCTAssertEqual(batch.num_rows(), 3);
+  XCTAssertEqual(batch.event_times_ns_size(), 3);
+  XCTAssertEqual(batch.event_times_ns(1), 200 * 1000000000LL + 123);
+  XCTAssertEqual(batch.processed_times_ns(2), 301 * 1000000000LL);
+
+  // Repeated strings are only stored once
+  XCTAssertEqual(batch.machine_ids().dictionary_size(), 2);
+  XCTAssertEqual(batch.machine_ids().indexes(0), batch.machine_ids().indexes(1));
+  XCTAssertNotEqual(batch.machine_ids().indexes(0), batch.machine_ids().indexes(2));
+  XCTAssertEqual(batch.boot_session_uuids().dictionary_size(), 1);
+
+  XCTAssertEqual(batch.event_types(0), pbv1::SantaMessage::kExecution);
+  XCTAssertEqual(batch.event_types(1), pbv1::SantaMessage::kFork);
+  XCTAssertEqual(batch.events_size(), 2);
+  XCTAssertEqual(batch.events(0).field_number(), pbv1::SantaMessage::kExecution);
+  XCTAssertEqual(batch.events(0).values_size(), 2);
+  XCTAssertEqual(batch.events(1).values_size(), 1);
+  XCTAssertEqual(batch.extra_fields_size(), 0);
+}
+
+- (void)testRoundTrip {
+  ::fsspool::ColumnarBatcher batcher;
+
+  std::vector<pbv1::SantaMessage> messages = {
+      MakeMessage(100, 1, true),
+      MakeMessage(200, 2, false),
+      pbv1::SantaMessage(),
+  };
+
+  // Fields unknown to the batcher are carried through unchanged
+  std::vector<uint8_t> withUnknownField = Serialize(MakeMessage(400, 4, false));
+  withUnknownField.insert(withUnknownField.end(), {0xa0, 0x06, 0x2a});  // Field 100, varint 42
+
+  for (const auto& msg : messages) {
+    XCTAssertTrue(batcher.Write(Serialize(msg)).ok());
+  }
+  XCTAssertTrue(batcher.Write(withUnknownField).ok());
+
+  ColumnarBatch batch = [self completeBatch:batcher];
+  XCTAssertEqual(batch.extra_field_rows_size(), 1);
+  XCTAssertEqual(batch.extra_field_rows(0), 3);
+
+  ::fsspool::ColumnarBatchReader reader(batch);
+  for (const auto& want : messages) {
+    absl::StatusOr<pbv1::SantaMessage> got = reader.Next();
+    XCTAssertTrue(got.ok());
+    XCTAssertEqual(got->SerializeAsString(), want.SerializeAsString());
+  }
+
+  absl::StatusOr<pbv1::SantaMessage> got = reader.Next();
+  XCTAssertTrue(got.ok());
+  XCTAssertEqual(got->SerializeAsString(),
+                 std::string(withUnknownField.begin(), withUnknownField.end()));
+
+  XCTAssertTrue(absl::IsOutOfRange(reader.Next().status()));
+}
+
+- (void)testProcessDictionary {
+  ::fsspool::ColumnarBatcher batcher(true);
+
+  std::vector<pbv1::SantaMessage> messages = {
+      MakeMessage(100, 1, true),
+      MakeMessage(200, 1, false),
+      MakeMessage(300, 2, true),
+      pbv1::SantaMessage(),
+  };
+  messages[0].mutable_execution()->mutable_target()->mutable_id()->set_pid(10);
+  messages[2].mutable_execution()->mutable_target()->mutable_id()->set_pid(10);
+  messages[2].mutable_execution()->set_decision(pbv1::Execution::DECISION_ALLOW);
+
+  for (const auto& msg : messages) {
+    XCTAssertTrue(batcher.Write(Serialize(msg)).ok());
+  }
+
+  ColumnarBatch batch = [self completeBatch:batcher];
+  XCTAssertEqual(batch.schema_version(), ::fsspool::kColumnarSchemaVersionProcessDictionary);
+
+  // Each unique process is only stored once
+  XCTAssertEqual(batch.processes_size(), 3);
+  XCTAssertEqual(batch.events(0).process_refs_size(), batch.events(0).values_size());
+  XCTAssertEqual(batch.events(0).process_refs(0).indexes_size(), 2);
+  XCTAssertEqual(batch.events(0).process_refs(0).indexes(1),
+                 batch.events(0).process_refs(1).indexes(1));
+  XCTAssertEqual(batch.events(1).process_refs(0).indexes(0),
+                 batch.events(0).process_refs(0).indexes(0));
+
+  ::fsspool::ColumnarBatchReader reader(batch);
+  for (const auto& want : messages) {
+    absl::StatusOr<pbv1::SantaMessage> got = reader.Next();
+    XCTAssertTrue(got.ok());
+    XCTAssertEqual(got->SerializeAsString(), want.SerializeAsString());
+  }
+  XCTAssertTrue(absl::IsOutOfRange(reader.Next().status()));
+
+  // Batches from newer writers are rejected rather than misread
+  batch.set_schema_version(::fsspool::kColumnarSchemaVersionProcessDictionary + 1);
+  ::fsspool::ColumnarBatchReader newerReader(batch);
+  XCTAssertTrue(absl::IsUnimplemented(newerReader.Next().status()));
+}
+
+- (void)testMalformedRecord {
+  ::fsspool::ColumnarBatcher batcher;
+
+  // Truncated length delimited field
+  XCTAssertFalse(batcher.Write({0x0a, 0x10, 'a'}).ok());
+  XCTAssertFalse(batcher.NeedToOpenFile());
+
+  XCTAssertTrue(batcher.Write(Serialize(MakeMessage(100, 1, true))).ok());
+  ColumnarBatch batch = [self completeBatch:batcher];
+  XCTAssertEqual(batch.num_rows(), 1);
+  XCTAssertEqual(batch.machine_ids().indexes_size(), 1);
+}
+
+@end
@@ -19,6 +19,7 @@
 
 #include "Source/common/SNTXxhash.h"
 #include "Source/common/Unit.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/BatchIndex.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -30,40 +31,105 @@ namespace fsspool {
 
 static constexpr uint32_t kStreamBatcherMagic = 0x21544E53;
 
+// Starts batches written with StreamRecordFormat::kFrameChecksum
+static constexpr uint32_t kStreamBatcherFrameChecksumMagic = 0x32544E53;
+
+// Precedes each record in batches written with
+// StreamRecordFormat::kFrameChecksum. Differs from the first byte of
+// kStreamBatcherIndexMagic so readers can tell records from the index.
+static constexpr uint8_t kStreamBatcherRecordDelimiter = 0x1E;
+
+// Framing of the records in a stream batch
+enum class StreamRecordFormat {
+  // Each record is:
+  //
+  //   kStreamBatcherMagic | xxhash64 | varint length | bytes
+  kRecordChecksum,
+  // The batch starts with kStreamBatcherFrameChecksumMagic and each record
+  // is:
+  //
+  //   kStreamBatcherRecordDelimiter | varint length | bytes
+  //
+  // Integrity is left to the checksums of the compressed stream: the gzip
+  // trailer's CRC-32, or the content checksum of every zstd frame. Only
+  // compressed batchers support this format.
+  kFrameChecksum,
+};
+
+// Approximate uncompressed size of independently decompressible frames in
+// indexed batches, for compressed streams that support it
+static constexpr size_t kIndexedFrameSize = 1024 * 1024;
+
+// Size of the buffer in front of batch files. Larger than the protobuf
+// default so that a burst of records costs few write syscalls.
+static constexpr int kRawOutputBlockSize = 64 * 1024;
+
 template <typename T>
 class StreamBatcher {
  public:
+  // When `write_index` is true each batch ends with a BatchIndex of its
+  // records. See BatchIndex.h for the format.
   template <typename F>
-  StreamBatcher(F&& factory) : factory_(std::forward<F>(factory)) {}
+  StreamBatcher(F&& factory, bool write_index = false,
+                StreamRecordFormat record_format =
+                    StreamRecordFormat::kRecordChecksum)
+      : factory_(std::forward<F>(factory)),
+        write_index_(write_index),
+        record_format_(record_format) {}
 
   inline bool ShouldInitializeBeforeWrite() { return true; }
 
   absl::Status InitializeBatch(int fd) {
-    raw_output_ = std::make_shared<google::protobuf::io::FileOutputStream>(fd);
+    raw_output_ = std::make_shared<google::protobuf::io::FileOutputStream>(
+        fd, kRawOutputBlockSize);
     compressed_output_ = factory_(raw_output_.get());
     if (!compressed_output_) {
       return absl::InternalError("Creating compressed stream batcher failed");
     }
+    if constexpr (requires(T& t) { t.EnableSeekTable(kIndexedFrameSize); }) {
+      if (write_index_) {
+        compressed_output_->EnableSeekTable(kIndexedFrameSize);
+      }
+    }
+    if constexpr (requires(T& t) { t.EnableChecksums(); }) {
+      if (record_format_ == StreamRecordFormat::kFrameChecksum &&
+          !compressed_output_->EnableChecksums()) {
+        return absl::InternalError(
+            "Enabling compressed stream checksums failed");
+      }
+    }
     coded_output_ = std::make_shared<google::protobuf::io::CodedOutputStream>(
         compressed_output_.get());
+    if (record_format_ == StreamRecordFormat::kFrameChecksum) {
+      coded_output_->WriteLittleEndian32(kStreamBatcherFrameChecksumMagic);
+    }
     return absl::OkStatus();
   }
 
   inline bool NeedToOpenFile() { return true; }
 
-  absl::Status Write(std::vector<uint8_t> bytes) {
+  absl::Status Write(const std::vector<uint8_t>& bytes) {
     if (bytes.size() > INT_MAX) {
       return absl::InternalError("Telemetry event size too large");
     }
 
-    coded_output_->WriteLittleEndian32(kStreamBatcherMagic);
+    if (write_index_) {
+      index_.Add(coded_output_->ByteCount(), bytes);
+    }
 
-    santa::Xxhash64 hash;
-    hash.Update(bytes.data(), bytes.size());
-    hash.Digest([&](const uint8_t* buf, size_t length) {
-      assert(length == sizeof(uint64_t));
-      coded_output_->WriteRaw(buf, (int)length);
-    });
+    if (record_format_ == StreamRecordFormat::kFrameChecksum) {
+      coded_output_->WriteRaw(&kStreamBatcherRecordDelimiter,
+                              sizeof(kStreamBatcherRecordDelimiter));
+    } else {
+      coded_output_->WriteLittleEndian32(kStreamBatcherMagic);
+
+      santa::Xxhash64 hash;
+      hash.Update(bytes.data(), bytes.size());
+      hash.Digest([&](const uint8_t* buf, size_t length) {
+        assert(length == sizeof(uint64_t));
+        coded_output_->WriteRaw(buf, (int)length);
+      });
+    }
 
     // Note: Protobuf library is inconsistent on size parameters. Casts are
     // intentionally for different types.
@@ -73,6 +139,9 @@ class StreamBatcher {
   }
 
   absl::StatusOr<size_t> CompleteBatch(int fd) {
+    if (write_index_) {
+      index_.Write(coded_output_.get());
+    }
     int bytes_written = coded_output_->ByteCount();
     coded_output_.reset();
     compressed_output_.reset();
@@ -86,6 +155,9 @@ class StreamBatcher {
   std::shared_ptr<google::protobuf::io::ZeroCopyOutputStream> raw_output_;
   std::shared_ptr<T> compressed_output_;
   std::shared_ptr<google::protobuf::io::CodedOutputStream> coded_output_;
+  bool write_index_;
+  StreamRecordFormat record_format_;
+  BatchIndexBuilder index_;
 };
 
 // Note: This is a specialization of the StreamBatcher class template when no
@@ -93,16 +165,19 @@ class StreamBatcher {
 // template, aside from InitializeBatch and CompleteBatch. This could have been
 // written instead with a generic base class to dedupe the logic in the `Write`
 // method, but would come at a cost of a vtable lookup at runtime within this
-// hot path.
+// hot path. Uncompressed batches have no stream checksums to rely on, so they
+// always use StreamRecordFormat::kRecordChecksum.
 template <>
 class StreamBatcher<::santa::Unit> {
  public:
-  StreamBatcher() = default;
+  explicit StreamBatcher(bool write_index = false)
+      : write_index_(write_index) {}
 
   inline bool ShouldInitializeBeforeWrite() { return true; }
 
   absl::Status InitializeBatch(int fd) {
-    raw_output_ = std::make_shared<google::protobuf::io::FileOutputStream>(fd);
+    raw_output_ = std::make_shared<google::protobuf::io::FileOutputStream>(
+        fd, kRawOutputBlockSize);
     coded_output_ = std::make_shared<google::protobuf::io::CodedOutputStream>(
         raw_output_.get());
     return absl::OkStatus();
@@ -110,11 +185,15 @@ class StreamBatcher<::santa::Unit> {
 
   inline bool NeedToOpenFile() { return true; }
 
-  absl::Status Write(std::vector<uint8_t> bytes) {
+  absl::Status Write(const std::vector<uint8_t>& bytes) {
     if (bytes.size() > INT_MAX) {
       return absl::InternalError("Telemetry event size too large");
     }
 
+    if (write_index_) {
+      index_.Add(coded_output_->ByteCount(), bytes);
+    }
+
     coded_output_->WriteLittleEndian32(kStreamBatcherMagic);
 
     santa::Xxhash64 hash;
@@ -130,6 +209,9 @@ class StreamBatcher<::santa::Unit> {
   }
 
   absl::StatusOr<size_t> CompleteBatch(int fd) {
+    if (write_index_) {
+      index_.Write(coded_output_.get());
+    }
     int bytes_written = coded_output_->ByteCount();
     coded_output_.reset();
     raw_output_.reset();
@@ -139,6 +221,8 @@ class StreamBatcher<::santa::Unit> {
  private:
   std::shared_ptr<google::protobuf::io::ZeroCopyOutputStream> raw_output_;
   std::shared_ptr<google::protobuf::io::CodedOutputStream> coded_output_;
+  bool write_index_;
+  BatchIndexBuilder index_;
 };
 
 // Convenience type aliases
@@ -17,13 +17,18 @@
 
 #include <cstring>
 #include <random>
+#include <string>
+#include <vector>
 
 #include <sys/stat.h>
 
 #import "Source/common/NSData+Zlib.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 #include "absl/status/statusor.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "zdict.h"
 #include "zstd.h"
 
 @interface StreamBatcherTest : XCTestCase
@@ -176,4 +181,149 @@
   }
 }
 
+- (void)testFrameChecksumFormat {
+  // Small records, where the per-record framing is most noticeable
+  std::vector<std::vector<uint8_t>> records;
+  for (int i = 0; i < 500; i++) {
+    std::string record = "record " + std::to_string(i);
+    records.emplace_back(record.begin(), record.end());
+  }
+
+  auto writeBatch = ^NSData*(::fsspool::StreamRecordFormat format, size_t* bytesWritten) {
+    ::fsspool::ZstdStreamBatcher sut(
+        ^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
+          return ::fsspool::ZstdOutputStream::Create(raw_stream);
+        },
+        false, format);
+
+    NSString* file = [NSString stringWithFormat:@"%@/zstd-%d.bin", self.testDir, (int)format];
+    XCTAssertTrue([self.fileMgr createFileAtPath:file contents:nil attributes:nil]);
+    NSFileHandle* handle = [NSFileHandle fileHandleForWritingAtPath:file];
+    XCTAssertTrue(sut.InitializeBatch(handle.fileDescriptor).ok());
+    for (const auto& record : records) {
+      XCTAssertTrue(sut.Write(record).ok());
+    }
+    absl::StatusOr<size_t> size = sut.CompleteBatch(handle.fileDescriptor);
+    XCTAssertTrue(size.ok());
+    *bytesWritten = *size;
+    [handle closeFile];
+    return [NSData dataWithContentsOfFile:file];
+  };
+
+  size_t recordChecksumBytes;
+  size_t frameChecksumBytes;
+  writeBatch(::fsspool::StreamRecordFormat::kRecordChecksum, &recordChecksumBytes);
+  NSData* compressed = writeBatch(::fsspool::StreamRecordFormat::kFrameChecksum,
+                                  &frameChecksumBytes);
+
+  // The per-record magic and hash are gone
+  XCTAssertEqual(recordChecksumBytes - frameChecksumBytes,
+                 records.size() * (sizeof(uint32_t) + sizeof(uint64_t) -
+                                   sizeof(::fsspool::kStreamBatcherRecordDelimiter)) -
+                     sizeof(::fsspool::kStreamBatcherFrameChecksumMagic));
+
+  // The frame carries a content checksum: bit 2 of the frame header descriptor, which follows
+  // the 4 byte frame magic
+  XCTAssertGreaterThan(compressed.length, 4);
+  XCTAssertTrue(((const uint8_t*)compressed.bytes)[4] & 0x4);
+
+  std::vector<uint8_t> decompressed(frameChecksumBytes);
+  size_t result = ZSTD_decompress(decompressed.data(), decompressed.size(), compressed.bytes,
+                                  compressed.length);
+  XCTAssertFalse(ZSTD_isError(result), "Decompression error: %s", ZSTD_getErrorName(result));
+  XCTAssertEqual(result, frameChecksumBytes);
+
+  google::protobuf::io::CodedInputStream input(decompressed.data(), (int)decompressed.size());
+  uint32_t magic;
+  XCTAssertTrue(input.ReadLittleEndian32(&magic));
+  XCTAssertEqual(magic, ::fsspool::kStreamBatcherFrameChecksumMagic);
+  for (const auto& record : records) {
+    uint8_t delimiter;
+    uint32_t length;
+    XCTAssertTrue(input.ReadRaw(&delimiter, sizeof(delimiter)));
+    XCTAssertEqual(delimiter, ::fsspool::kStreamBatcherRecordDelimiter);
+    XCTAssertTrue(input.ReadVarint32(&length));
+    std::vector<uint8_t> got(length);
+    XCTAssertTrue(input.ReadRaw(got.data(), length));
+    XCTAssertEqual(got, record);
+  }
+  XCTAssertEqual(input.CurrentPosition(), (int)decompressed.size());
+
+  // Corrupting the stored checksum is detected on decompression
+  NSMutableData* corrupted = [compressed mutableCopy];
+  ((uint8_t*)corrupted.mutableBytes)[corrupted.length - 1] ^= 0xff;
+  result = ZSTD_decompress(decompressed.data(), decompressed.size(), corrupted.bytes,
+                           corrupted.length);
+  XCTAssertTrue(ZSTD_isError(result));
+}
+
+- (void)testZstdDictionary {
+  // Train a small dictionary from samples that resemble each other
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  for (int i = 0; i < 2000; i++) {
+    std::string sample = "{\"execution\":{\"pid\":" + std::to_string(i) +
+                         ",\"path\":\"/usr/bin/tool" + std::to_string(i % 37) +
+                         "\",\"decision\":\"DECISION_ALLOW\",\"reason\":\"REASON_BINARY\"}}";
+    samples += sample;
+    sample_sizes.push_back(sample.size());
+  }
+
+  std::vector<char> dict(4096);
+  size_t dict_size = ZDICT_trainFromBuffer(dict.data(), dict.size(), samples.data(),
+                                           sample_sizes.data(), (unsigned)sample_sizes.size());
+  XCTAssertFalse(ZDICT_isError(dict_size), "Training error: %s", ZDICT_getErrorName(dict_size));
+  unsigned dict_id = ZSTD_getDictID_fromDict(dict.data(), dict_size);
+  XCTAssertNotEqual(dict_id, 0);
+
+  NSString* dictFile = [NSString stringWithFormat:@"%@/%@", self.testDir, @"dict.bin"];
+  XCTAssertTrue([[NSData dataWithBytes:dict.data() length:dict_size] writeToFile:dictFile
+                                                                      atomically:YES]);
+
+  // Missing files and raw content without a dictionary ID are rejected
+  NSString* rawFile = [NSString stringWithFormat:@"%@/%@", self.testDir, @"raw.bin"];
+  XCTAssertTrue([[NSData dataWithBytes:samples.data() length:1024] writeToFile:rawFile
+                                                                    atomically:YES]);
+  XCTAssertEqual(::fsspool::ZstdOutputStream::LoadDictionary(rawFile.UTF8String), nullptr);
+  XCTAssertEqual(::fsspool::ZstdOutputStream::LoadDictionary(
+                     [self.testDir stringByAppendingPathComponent:@"missing"].UTF8String),
+                 nullptr);
+
+  ::fsspool::ZstdOutputStream::Dictionary dictionary =
+      ::fsspool::ZstdOutputStream::LoadDictionary(dictFile.UTF8String);
+  XCTAssertNotEqual(dictionary, nullptr);
+
+  std::string compressed;
+  {
+    google::protobuf::io::StringOutputStream raw_stream(&compressed);
+    auto sut = ::fsspool::ZstdOutputStream::Create(
+        &raw_stream, ZSTD_CLEVEL_DEFAULT, ::fsspool::ZstdOutputStream::kDefaultBufferSize,
+        dictionary);
+    XCTAssertNotEqual(sut, nullptr);
+
+    void* buf;
+    int size;
+    XCTAssertTrue(sut->Next(&buf, &size));
+    XCTAssertGreaterThanOrEqual(size, (int)sample_sizes[0]);
+    memcpy(buf, samples.data(), sample_sizes[0]);
+    sut->BackUp(size - (int)sample_sizes[0]);
+  }
+
+  // The frame records the dictionary ID and requires it to decompress
+  XCTAssertEqual(ZSTD_getDictID_fromFrame(compressed.data(), compressed.size()), dict_id);
+
+  std::vector<char> decompressed(sample_sizes[0] * 2);
+  size_t result = ZSTD_decompress(decompressed.data(), decompressed.size(), compressed.data(),
+                                  compressed.size());
+  XCTAssertTrue(ZSTD_isError(result));
+
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  result = ZSTD_decompress_usingDict(dctx, decompressed.data(), decompressed.size(),
+                                     compressed.data(), compressed.size(), dict.data(), dict_size);
+  ZSTD_freeDCtx(dctx);
+  XCTAssertFalse(ZSTD_isError(result), "Decompression error: %s", ZSTD_getErrorName(result));
+  XCTAssertEqual(result, sample_sizes[0]);
+  XCTAssertEqual(0, memcmp(decompressed.data(), samples.data(), sample_sizes[0]));
+}
+
 @end
@@ -0,0 +1,83 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDINPUTSTREAM_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDINPUTSTREAM_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "zstd.h"
+
+namespace fsspool {
+
+// Decompresses a stream of zstd frames, such as those written by
+// ZstdOutputStream, without holding the whole decompressed stream in memory.
+// Skippable frames, including zstd seekable format seek tables, are ignored.
+class ZstdInputStream : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  // Matches the ZstdOutputStream default buffer size
+  static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+  // `dictionary` holds the content of the dictionary the frames were
+  // compressed with, if any. It is copied and need not outlive the stream.
+  static std::unique_ptr<ZstdInputStream> Create(
+      google::protobuf::io::ZeroCopyInputStream* input,
+      std::string_view dictionary = {},
+      size_t buffer_size = kDefaultBufferSize);
+
+  ZstdInputStream(google::protobuf::io::ZeroCopyInputStream* input,
+                  ZSTD_DStream* dstream,
+                  size_t buffer_size = kDefaultBufferSize);
+
+  ~ZstdInputStream();
+
+  // Reason Next last returned false, or OK if the end of a complete stream
+  // was reached
+  absl::Status status() const { return status_; }
+
+  // ZeroCopyInputStream interface
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  google::protobuf::io::ZeroCopyInputStream* input_;
+  ZSTD_DStream* dstream_;
+  absl::Status status_;
+
+  ZSTD_inBuffer input_buffer_ = {nullptr, 0, 0};
+
+  // Output buffer for decompressed data
+  std::vector<uint8_t> output_buffer_;
+  size_t output_size_ = 0;
+  size_t backed_up_ = 0;
+
+  // True if the last decompression filled the output buffer, in which case
+  // zstd may hold more output without needing more input
+  bool output_pending_ = false;
+  // True when the last decompression ended on a frame boundary
+  bool frame_complete_ = true;
+
+  int64_t byte_count_ = 0;
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDINPUTSTREAM_H
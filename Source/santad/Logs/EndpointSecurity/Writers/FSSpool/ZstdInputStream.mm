@@ -0,0 +1,124 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdInputStream.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_format.h"
+
+namespace fsspool {
+
+std::unique_ptr<ZstdInputStream> ZstdInputStream::Create(
+    google::protobuf::io::ZeroCopyInputStream* input, std::string_view dictionary,
+    size_t buffer_size) {
+  ZSTD_DStream* dstream = ZSTD_createDStream();
+  if (!dstream) {
+    return nullptr;
+  }
+
+  size_t result = ZSTD_initDStream(dstream);
+  if (!ZSTD_isError(result) && !dictionary.empty()) {
+    result = ZSTD_DCtx_loadDictionary(dstream, dictionary.data(), dictionary.size());
+  }
+
+  if (ZSTD_isError(result)) {
+    ZSTD_freeDStream(dstream);
+    return nullptr;
+  }
+
+  return std::make_unique<ZstdInputStream>(input, dstream, buffer_size);
+}
+
+ZstdInputStream::ZstdInputStream(google::protobuf::io::ZeroCopyInputStream* input,
+                                 ZSTD_DStream* dstream, size_t buffer_size)
+    : input_(input), dstream_(dstream), output_buffer_(buffer_size) {}
+
+ZstdInputStream::~ZstdInputStream() {
+  ZSTD_freeDStream(dstream_);
+}
+
+bool ZstdInputStream::Next(const void** data, int* size) {
+  if (backed_up_ > 0) {
+    *data = output_buffer_.data() + output_size_ - backed_up_;
+    *size = static_cast<int>(backed_up_);
+    byte_count_ += backed_up_;
+    backed_up_ = 0;
+    return true;
+  }
+
+  while (status_.ok()) {
+    if (input_buffer_.pos == input_buffer_.size && !output_pending_) {
+      const void* in_data;
+      int in_size;
+      if (!input_->Next(&in_data, &in_size)) {
+        if (!frame_complete_) {
+          status_ = absl::DataLossError("Truncated zstd stream");
+        }
+        return false;
+      }
+      input_buffer_ = {in_data, static_cast<size_t>(in_size), 0};
+    }
+
+    ZSTD_outBuffer out = {output_buffer_.data(), output_buffer_.size(), 0};
+    size_t result = ZSTD_decompressStream(dstream_, &out, &input_buffer_);
+    if (ZSTD_isError(result)) {
+      status_ = absl::InternalError(absl::StrFormat("Failed to decompress zstd stream: %d: %s",
+                                                    ZSTD_getErrorCode(result),
+                                                    ZSTD_getErrorName(result)));
+      return false;
+    }
+
+    frame_complete_ = (result == 0);
+    output_pending_ = (out.pos == out.size);
+
+    if (out.pos > 0) {
+      output_size_ = out.pos;
+      *data = output_buffer_.data();
+      *size = static_cast<int>(out.pos);
+      byte_count_ += out.pos;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ZstdInputStream::BackUp(int count) {
+  backed_up_ = static_cast<size_t>(count);
+  byte_count_ -= count;
+}
+
+bool ZstdInputStream::Skip(int count) {
+  const void* data;
+  int size;
+  while (count > 0) {
+    if (!Next(&data, &size)) {
+      return false;
+    }
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  return true;
+}
+
+int64_t ZstdInputStream::ByteCount() const {
+  return byte_count_;
+}
+
+}  // namespace fsspool
@@ -0,0 +1,188 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdInputStream.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "zdict.h"
+#include "zstd.h"
+
+static std::string MakeContent(size_t size) {
+  std::string content;
+  content.reserve(size);
+  for (size_t i = 0; content.size() < size; i++) {
+    content += "record " + std::to_string(i) + " /usr/bin/tool" + std::to_string(i % 37) + "\n";
+  }
+  content.resize(size);
+  return content;
+}
+
+static std::string Compress(const std::string& content, size_t max_frame_size = 0,
+                            ::fsspool::ZstdOutputStream::Dictionary dictionary = nullptr) {
+  std::string compressed;
+  google::protobuf::io::StringOutputStream raw_stream(&compressed);
+  auto stream = ::fsspool::ZstdOutputStream::Create(
+      &raw_stream, ZSTD_CLEVEL_DEFAULT, ::fsspool::ZstdOutputStream::kDefaultBufferSize,
+      std::move(dictionary));
+  if (max_frame_size > 0) {
+    stream->EnableSeekTable(max_frame_size);
+  }
+
+  size_t written = 0;
+  while (written < content.size()) {
+    void* buf;
+    int size;
+    if (!stream->Next(&buf, &size)) {
+      return "";
+    }
+    size_t n = std::min((size_t)size, content.size() - written);
+    memcpy(buf, content.data() + written, n);
+    stream->BackUp(size - (int)n);
+    written += n;
+  }
+
+  // The stream finishes the frame when destroyed
+  stream.reset();
+  return compressed;
+}
+
+static std::string ReadAll(::fsspool::ZstdInputStream* stream) {
+  std::string out;
+  const void* data;
+  int size;
+  while (stream->Next(&data, &size)) {
+    out.append((const char*)data, size);
+  }
+  return out;
+}
+
+@interface ZstdInputStreamTest : XCTestCase
+@end
+
+@implementation ZstdInputStreamTest
+
+- (void)testRoundTrip {
+  std::string content = MakeContent(1024 * 1024);
+  std::string compressed = Compress(content);
+
+  // Feed the compressed data in small blocks to exercise input refills
+  google::protobuf::io::ArrayInputStream raw_stream(compressed.data(), (int)compressed.size(), 97);
+  auto sut = ::fsspool::ZstdInputStream::Create(&raw_stream, {}, 4096);
+  XCTAssertNotEqual(sut, nullptr);
+
+  XCTAssertTrue(ReadAll(sut.get()) == content);
+  XCTAssertTrue(sut->status().ok());
+  XCTAssertEqual(sut->ByteCount(), content.size());
+}
+
+- (void)testMultipleFramesAndSeekTable {
+  // Seek tables are written as skippable frames, which are ignored
+  std::string content = MakeContent(300 * 1024);
+  std::string compressed = Compress(content, 64 * 1024);
+  XCTAssertTrue(
+      ::fsspool::ZstdOutputStream::ReadSeekTable((const uint8_t*)compressed.data(),
+                                                 compressed.size())
+          .ok());
+
+  google::protobuf::io::ArrayInputStream raw_stream(compressed.data(), (int)compressed.size());
+  auto sut = ::fsspool::ZstdInputStream::Create(&raw_stream);
+  XCTAssertTrue(ReadAll(sut.get()) == content);
+  XCTAssertTrue(sut->status().ok());
+}
+
+- (void)testBackUpAndSkip {
+  std::string content = MakeContent(200 * 1024);
+  std::string compressed = Compress(content);
+
+  google::protobuf::io::ArrayInputStream raw_stream(compressed.data(), (int)compressed.size());
+  auto sut = ::fsspool::ZstdInputStream::Create(&raw_stream, {}, 1024);
+
+  const void* data;
+  int size;
+  XCTAssertTrue(sut->Next(&data, &size));
+  XCTAssertEqual(size, 1024);
+  sut->BackUp(24);
+  XCTAssertEqual(sut->ByteCount(), 1000);
+
+  // Backed up bytes are returned again by the next call
+  XCTAssertTrue(sut->Next(&data, &size));
+  XCTAssertEqual(size, 24);
+  XCTAssertTrue(std::string_view((const char*)data, size) == content.substr(1000, 24));
+
+  // Skip across several output buffers
+  XCTAssertTrue(sut->Skip(5000));
+  XCTAssertEqual(sut->ByteCount(), 6024);
+  XCTAssertTrue(ReadAll(sut.get()) == content.substr(6024));
+
+  // Skipping past the end fails
+  XCTAssertFalse(sut->Skip(1));
+}
+
+- (void)testDictionary {
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  for (int i = 0; i < 2000; i++) {
+    std::string sample = "record " + std::to_string(i) + " /usr/bin/tool" + std::to_string(i % 37);
+    samples += sample;
+    sample_sizes.push_back(sample.size());
+  }
+
+  std::vector<char> dict(4096);
+  size_t dict_size = ZDICT_trainFromBuffer(dict.data(), dict.size(), samples.data(),
+                                           sample_sizes.data(), (unsigned)sample_sizes.size());
+  XCTAssertFalse(ZDICT_isError(dict_size), "Training error: %s", ZDICT_getErrorName(dict_size));
+
+  ::fsspool::ZstdOutputStream::Dictionary dictionary(
+      ZSTD_createCDict(dict.data(), dict_size, ZSTD_CLEVEL_DEFAULT), ZSTD_freeCDict);
+  std::string content = MakeContent(64 * 1024);
+  std::string compressed = Compress(content, 0, dictionary);
+
+  // Decompressing without the dictionary fails
+  {
+    google::protobuf::io::ArrayInputStream raw_stream(compressed.data(), (int)compressed.size());
+    auto sut = ::fsspool::ZstdInputStream::Create(&raw_stream);
+    ReadAll(sut.get());
+    XCTAssertFalse(sut->status().ok());
+  }
+
+  google::protobuf::io::ArrayInputStream raw_stream(compressed.data(), (int)compressed.size());
+  auto sut =
+      ::fsspool::ZstdInputStream::Create(&raw_stream, std::string_view(dict.data(), dict_size));
+  XCTAssertTrue(ReadAll(sut.get()) == content);
+  XCTAssertTrue(sut->status().ok());
+}
+
+- (void)testTruncatedStream {
+  std::string content = MakeContent(64 * 1024);
+  std::string compressed = Compress(content);
+  compressed.resize(compressed.size() / 2);
+
+  google::protobuf::io::ArrayInputStream raw_stream(compressed.data(), (int)compressed.size());
+  auto sut = ::fsspool::ZstdInputStream::Create(&raw_stream);
+  std::string got = ReadAll(sut.get());
+  XCTAssertLessThan(got.size(), content.size());
+  XCTAssertTrue(absl::IsDataLoss(sut->status()));
+}
+
+@end
@@ -15,6 +15,11 @@
 #ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDOUTPUTSTREAM_H
 #define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDOUTPUTSTREAM_H
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/stubs/common.h"
 #include "zstd.h"
@@ -26,17 +31,53 @@ class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
   // Matches the Gzip default buffer size
   static constexpr size_t kDefaultBufferSize = 64 * 1024;
 
+  // A digested compression dictionary that can be shared by many streams
+  using Dictionary = std::shared_ptr<ZSTD_CDict>;
+
+  // Upper bound on the size of dictionary files that will be loaded
+  static constexpr size_t kMaxDictionarySize = 4 * 1024 * 1024;
+
+  // Load a dictionary trained with `zstd --train`. Returns nullptr if the
+  // file cannot be read or does not contain a dictionary with an ID.
+  static Dictionary LoadDictionary(const std::string& path,
+                                   int compression_level = ZSTD_CLEVEL_DEFAULT);
+
+  // When a dictionary is given it is used for every frame and its ID is
+  // recorded in each frame header, and the dictionary's own compression level
+  // takes precedence over `compression_level`.
   static std::unique_ptr<ZstdOutputStream> Create(
       google::protobuf::io::ZeroCopyOutputStream* output,
       int compression_level = ZSTD_CLEVEL_DEFAULT,
-      size_t buffer_size = kDefaultBufferSize);
+      size_t buffer_size = kDefaultBufferSize, Dictionary dictionary = nullptr);
 
   ZstdOutputStream(google::protobuf::io::ZeroCopyOutputStream* output,
                    ZSTD_CStream* cstream,
-                   size_t buffer_size = kDefaultBufferSize);
+                   size_t buffer_size = kDefaultBufferSize,
+                   Dictionary dictionary = nullptr);
 
   ~ZstdOutputStream();
 
+  // Describes one frame of a stream written with a seek table
+  struct SeekTableEntry {
+    uint32_t compressed_size;
+    uint32_t decompressed_size;
+  };
+
+  // Split the output into independently decompressible frames of roughly
+  // `max_frame_size` uncompressed bytes and, when the stream is destroyed,
+  // append a seek table in the zstd seekable format. Must be called before
+  // the first call to Next.
+  void EnableSeekTable(size_t max_frame_size);
+
+  // Record a content checksum at the end of every frame, which decompressors
+  // verify. Must be called before the first call to Next. Returns false if
+  // the parameter could not be set.
+  bool EnableChecksums();
+
+  // Parse the seek table at the end of data written with EnableSeekTable
+  static absl::StatusOr<std::vector<SeekTableEntry>> ReadSeekTable(
+      const uint8_t* data, size_t size);
+
   // ZeroCopyOutputStream interface
   bool Next(void** data, int* size) override;
   void BackUp(int count) override;
@@ -45,9 +86,14 @@ class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
  private:
   bool CompressAndFlush(ZSTD_EndDirective end_directive);
   bool FlushOutput(size_t bytes_to_write);
+  bool WriteOutput(const uint8_t* data, size_t size);
+  bool EndFrame();
+  bool WriteSeekTable();
 
   google::protobuf::io::ZeroCopyOutputStream* output_;
   ZSTD_CStream* cstream_;
+  // Referenced by cstream_ and must outlive it
+  Dictionary dictionary_;
 
   // Input buffer for uncompressed data
   std::vector<uint8_t> input_buffer_;
@@ -58,6 +104,12 @@ class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
   std::vector<uint8_t> output_buffer_;
 
   int64_t byte_count_;
+
+  // Seek table state, only used when max_frame_size_ is non-zero
+  size_t max_frame_size_ = 0;
+  uint64_t frame_compressed_size_ = 0;
+  uint64_t frame_decompressed_size_ = 0;
+  std::vector<SeekTableEntry> seek_table_;
 };
 
 }  // namespace fsspool
@@ -14,32 +14,78 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
 
 namespace fsspool {
 
+ZstdOutputStream::Dictionary ZstdOutputStream::LoadDictionary(const std::string& path,
+                                                              int compression_level) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return nullptr;
+  }
+
+  std::streamoff size = file.tellg();
+  if (size <= 0 || static_cast<size_t>(size) > kMaxDictionarySize) {
+    return nullptr;
+  }
+
+  std::vector<char> buffer(static_cast<size_t>(size));
+  file.seekg(0);
+  if (!file.read(buffer.data(), size)) {
+    return nullptr;
+  }
+
+  // Raw content dictionaries have no ID and could not be matched up with the
+  // frames that used them when decompressing
+  if (ZSTD_getDictID_fromDict(buffer.data(), buffer.size()) == 0) {
+    return nullptr;
+  }
+
+  ZSTD_CDict* cdict = ZSTD_createCDict(buffer.data(), buffer.size(), compression_level);
+  if (!cdict) {
+    return nullptr;
+  }
+
+  return Dictionary(cdict, ZSTD_freeCDict);
+}
+
 std::unique_ptr<ZstdOutputStream> ZstdOutputStream::Create(
-    google::protobuf::io::ZeroCopyOutputStream* output, int compression_level, size_t buffer_size) {
+    google::protobuf::io::ZeroCopyOutputStream* output, int compression_level, size_t buffer_size,
+    Dictionary dictionary) {
   ZSTD_CStream* cstream = ZSTD_createCStream();
   if (!cstream) {
     return nullptr;
   }
 
-  size_t result = ZSTD_initCStream(cstream, compression_level);
+  size_t result;
+  if (dictionary) {
+    result = ZSTD_CCtx_setParameter(cstream, ZSTD_c_dictIDFlag, 1);
+    if (!ZSTD_isError(result)) {
+      result = ZSTD_CCtx_refCDict(cstream, dictionary.get());
+    }
+  } else {
+    result = ZSTD_initCStream(cstream, compression_level);
+  }
+
   if (ZSTD_isError(result)) {
     ZSTD_freeCStream(cstream);
     return nullptr;
   }
 
-  return std::make_unique<ZstdOutputStream>(output, cstream, buffer_size);
+  return std::make_unique<ZstdOutputStream>(output, cstream, buffer_size, std::move(dictionary));
 }
 
 ZstdOutputStream::ZstdOutputStream(google::protobuf::io::ZeroCopyOutputStream* output,
-                                   ZSTD_CStream* cstream, size_t buffer_size)
+                                   ZSTD_CStream* cstream, size_t buffer_size,
+                                   Dictionary dictionary)
     : output_(output),
       cstream_(cstream),
+      dictionary_(std::move(dictionary)),
       input_buffer_(buffer_size),
       input_position_(0),
       input_available_(0),
@@ -47,10 +93,27 @@ ZstdOutputStream::ZstdOutputStream(google::protobuf::io::ZeroCopyOutputStream* o
       byte_count_(0) {}
 
 ZstdOutputStream::~ZstdOutputStream() {
-  CompressAndFlush(ZSTD_e_end);
+  if (max_frame_size_ > 0) {
+    // Avoid a trailing empty frame when the last frame was just completed
+    if (frame_decompressed_size_ > 0 || input_available_ > 0 || seek_table_.empty()) {
+      EndFrame();
+    }
+    WriteSeekTable();
+  } else {
+    CompressAndFlush(ZSTD_e_end);
+  }
   ZSTD_freeCStream(cstream_);
 }
 
+void ZstdOutputStream::EnableSeekTable(size_t max_frame_size) {
+  // The seek table stores 32-bit sizes
+  max_frame_size_ = std::min<size_t>(max_frame_size, UINT32_MAX / 2);
+}
+
+bool ZstdOutputStream::EnableChecksums() {
+  return !ZSTD_isError(ZSTD_CCtx_setParameter(cstream_, ZSTD_c_checksumFlag, 1));
+}
+
 bool ZstdOutputStream::Next(void** data, int* size) {
   // If we have pending compressed data, flush it first
   if (input_available_ > 0) {
@@ -59,6 +122,12 @@ bool ZstdOutputStream::Next(void** data, int* size) {
     }
   }
 
+  if (max_frame_size_ > 0 && frame_decompressed_size_ >= max_frame_size_) {
+    if (!EndFrame()) {
+      return false;
+    }
+  }
+
   // Provide the entire input buffer to the caller
   *data = input_buffer_.data();
   *size = static_cast<int>(input_buffer_.size());
@@ -84,6 +153,8 @@ int64_t ZstdOutputStream::ByteCount() const {
 }
 
 bool ZstdOutputStream::CompressAndFlush(ZSTD_EndDirective end_directive) {
+  frame_decompressed_size_ += input_available_;
+
   ZSTD_inBuffer input = {
       .src = input_buffer_.data(),
       .size = input_available_,
@@ -108,6 +179,7 @@ bool ZstdOutputStream::CompressAndFlush(ZSTD_EndDirective end_directive) {
       if (!FlushOutput(output.pos)) {
         return false;
       }
+      frame_compressed_size_ += output.pos;
     }
   } while ((end_directive == ZSTD_e_end) ? (remaining != 0) : (input.pos < input.size));
 
@@ -123,22 +195,25 @@ bool ZstdOutputStream::FlushOutput(size_t bytes_to_write) {
     bytes_to_write = output_buffer_.size();
   }
 
-  size_t remaining = bytes_to_write;
-  const uint8_t* data = output_buffer_.data();
+  return WriteOutput(output_buffer_.data(), bytes_to_write);
+}
+
+bool ZstdOutputStream::WriteOutput(const uint8_t* data, size_t size) {
+  size_t remaining = size;
 
   while (remaining > 0) {
     void* buffer;
-    int size;
+    int buffer_size;
 
-    if (!output_->Next(&buffer, &size)) {
+    if (!output_->Next(&buffer, &buffer_size)) {
       return false;
     }
 
-    size_t to_write = std::min(remaining, static_cast<size_t>(size));
+    size_t to_write = std::min(remaining, static_cast<size_t>(buffer_size));
     std::memcpy(buffer, data, to_write);
 
-    if (to_write < static_cast<size_t>(size)) {
-      output_->BackUp(static_cast<int>(size - to_write));
+    if (to_write < static_cast<size_t>(buffer_size)) {
+      output_->BackUp(static_cast<int>(buffer_size - to_write));
     }
 
     data += to_write;
@@ -148,4 +223,103 @@ bool ZstdOutputStream::FlushOutput(size_t bytes_to_write) {
   return true;
 }
 
+bool ZstdOutputStream::EndFrame() {
+  if (!CompressAndFlush(ZSTD_e_end)) {
+    return false;
+  }
+
+  seek_table_.push_back({
+      .compressed_size = static_cast<uint32_t>(frame_compressed_size_),
+      .decompressed_size = static_cast<uint32_t>(frame_decompressed_size_),
+  });
+  frame_compressed_size_ = 0;
+  frame_decompressed_size_ = 0;
+  return true;
+}
+
+namespace {
+
+// Constants from the zstd seekable format specification
+constexpr uint32_t kSkippableFrameMagic = 0x184D2A5E;
+constexpr uint32_t kSeekableMagic = 0x8F92EAB1;
+constexpr size_t kSkippableHeaderSize = 8;
+constexpr size_t kSeekTableFooterSize = 9;
+constexpr size_t kSeekTableEntrySize = 8;
+constexpr size_t kSeekTableChecksumEntrySize = 12;
+constexpr uint8_t kSeekTableChecksumFlag = 0x80;
+constexpr uint8_t kSeekTableReservedMask = 0x7C;
+
+void AppendLE32(std::vector<uint8_t>& buf, uint32_t val) {
+  for (int i = 0; i < 4; i++) {
+    buf.push_back(static_cast<uint8_t>(val >> (8 * i)));
+  }
+}
+
+uint32_t ReadLE32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+         (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+}  // namespace
+
+bool ZstdOutputStream::WriteSeekTable() {
+  size_t table_size = seek_table_.size() * kSeekTableEntrySize + kSeekTableFooterSize;
+
+  std::vector<uint8_t> buf;
+  buf.reserve(kSkippableHeaderSize + table_size);
+  AppendLE32(buf, kSkippableFrameMagic);
+  AppendLE32(buf, static_cast<uint32_t>(table_size));
+  for (const SeekTableEntry& entry : seek_table_) {
+    AppendLE32(buf, entry.compressed_size);
+    AppendLE32(buf, entry.decompressed_size);
+  }
+  AppendLE32(buf, static_cast<uint32_t>(seek_table_.size()));
+  buf.push_back(0);  // Descriptor: no checksums
+  AppendLE32(buf, kSeekableMagic);
+
+  return WriteOutput(buf.data(), buf.size());
+}
+
+absl::StatusOr<std::vector<ZstdOutputStream::SeekTableEntry>> ZstdOutputStream::ReadSeekTable(
+    const uint8_t* data, size_t size) {
+  if (size < kSkippableHeaderSize + kSeekTableFooterSize) {
+    return absl::InvalidArgumentError("Data too small to contain a seek table");
+  }
+
+  const uint8_t* footer = data + size - kSeekTableFooterSize;
+  if (ReadLE32(footer + 5) != kSeekableMagic) {
+    return absl::NotFoundError("No seek table found");
+  }
+
+  uint8_t descriptor = footer[4];
+  if (descriptor & kSeekTableReservedMask) {
+    return absl::InvalidArgumentError("Invalid seek table descriptor");
+  }
+
+  size_t entry_size = (descriptor & kSeekTableChecksumFlag) ? kSeekTableChecksumEntrySize
+                                                            : kSeekTableEntrySize;
+  uint64_t num_frames = ReadLE32(footer);
+  uint64_t table_size = num_frames * entry_size + kSeekTableFooterSize;
+  if (table_size + kSkippableHeaderSize > size) {
+    return absl::InvalidArgumentError("Seek table larger than data");
+  }
+
+  const uint8_t* header = data + size - table_size - kSkippableHeaderSize;
+  if (ReadLE32(header) != kSkippableFrameMagic || ReadLE32(header + 4) != table_size) {
+    return absl::InvalidArgumentError("Invalid seek table frame header");
+  }
+
+  std::vector<SeekTableEntry> entries;
+  entries.reserve(num_frames);
+  const uint8_t* entry = header + kSkippableHeaderSize;
+  for (uint64_t i = 0; i < num_frames; i++, entry += entry_size) {
+    entries.push_back({
+        .compressed_size = ReadLE32(entry),
+        .decompressed_size = ReadLE32(entry + 4),
+    });
+  }
+
+  return entries;
+}
+
 }  // namespace fsspool
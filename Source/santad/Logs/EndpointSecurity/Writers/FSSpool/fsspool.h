@@ -22,7 +22,11 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
@@ -63,23 +67,30 @@ concept BatcherInterface =
 template <BatcherInterface T>
 class FsSpoolWriter {
  public:
+  // How often the incrementally tracked spool size is reconciled against a
+  // full scan of the spool directory.
+  static constexpr absl::Duration kDefaultReconcileInterval = absl::Minutes(5);
+
   // The base, spool, and temporary directory will be created as needed on the
   // first call to Write() - however the base directory can be created into an
   // existing path (i.e. this class will not do an `mkdir -p`).
-  FsSpoolWriter(T batcher, absl::string_view base_dir, size_t max_spool_size)
+  FsSpoolWriter(T batcher, absl::string_view base_dir, size_t max_spool_size,
+                absl::Duration reconcile_interval = kDefaultReconcileInterval)
       : batcher_(std::move(batcher)),
         base_dir_(base_dir),
         spool_dir_(SpoolNewDirectory(base_dir)),
         tmp_dir_(SpoolTempDirectory(base_dir)),
         space_check_failure_since_last_flush_(false),
         max_spool_size_(max_spool_size),
+        reconcile_interval_(reconcile_interval),
         id_(absl::StrFormat(
             "%016x",
             absl::Uniform<uint64_t>(absl::BitGen(), 0,
                                     std::numeric_limits<uint64_t>::max()))),
-        // Guess that the spool is full during construction, so we will
-        // recompute the actual spool size on the first write.
-        spool_size_estimate_(max_spool_size + 1) {
+        // The size is unknown until the first reconciliation, which happens
+        // on the first write.
+        spool_size_estimate_(0),
+        last_reconcile_(absl::InfinitePast()) {
     (void)IterateDirectory(
         tmp_dir_, [this](const std::string& file_name, bool* stop) {
           if (file_name == std::string(".") || file_name == std::string("..")) {
@@ -98,23 +109,34 @@ class FsSpoolWriter {
   ~FsSpoolWriter() { (void)Flush(); };
 
   absl::Status SpaceAvailable() {
+    if (absl::Status status = ReconcileSpoolSizeIfNeeded(); !status.ok()) {
+      return status;  // failed to recompute spool size
+    }
+
     if (spool_size_estimate_ > max_spool_size_) {
-      absl::StatusOr<size_t> estimate = EstimateSpoolDirSize();
-      if (!estimate.ok()) {
-        return estimate.status();  // failed to recompute spool size
-      }
+      return absl::ResourceExhaustedError(
+          "Spool size estimate greater than max allowed");
+    }
+    return absl::OkStatus();
+  }
 
-      spool_size_estimate_ = *estimate;
-      if (spool_size_estimate_ > max_spool_size_) {
-        // Still over the limit: avoid writing.
-        return absl::ResourceExhaustedError(
-            "Spool size estimate greater than max allowed");
-      } else {
-        return absl::OkStatus();
-      }
-    } else {
-      return absl::OkStatus();
+  // Returns the fraction of the maximum spool size currently in use, based
+  // on the incrementally tracked size.
+  absl::StatusOr<double> SpoolUsage() {
+    if (absl::Status status = ReconcileSpoolSizeIfNeeded(); !status.ok()) {
+      return status;
     }
+
+    if (max_spool_size_ == 0) {
+      return 1.0;
+    }
+    return static_cast<double>(spool_size_estimate_) / max_spool_size_;
+  }
+
+  // Accounts for spool files of the given estimated disk occupation being
+  // deleted, e.g. after they were exported.
+  void SpoolFilesRemoved(size_t bytes) {
+    spool_size_estimate_ -= std::min(bytes, spool_size_estimate_);
   }
 
   absl::Status InitializeCurrentSpoolStateIfNeeded() {
@@ -166,7 +188,7 @@ class FsSpoolWriter {
       return size_estimate.status();
     }
 
-    spool_size_estimate_ += *size_estimate;
+    spool_size_estimate_ += EstimateDiskOccupation(*size_estimate);
 
     if (absl::Status status = RenameFile(current_spool_state_.tmp_file,
                                          current_spool_state_.spool_file);
@@ -183,7 +205,7 @@ class FsSpoolWriter {
   // Returns DataLossError if writes weren't attempted due to a previous
   // space check failure
   // Otherwise returns OK or an appropriate failure status
-  absl::Status Write(std::vector<uint8_t> bytes) {
+  absl::Status Write(const std::vector<uint8_t>& bytes) {
     // Initializer the batcher before write if required
     if (batcher_.ShouldInitializeBeforeWrite()) {
       // Don't attempt initialization if a previous initialization check
@@ -201,7 +223,7 @@ class FsSpoolWriter {
       }
     }
 
-    return batcher_.Write(std::move(bytes));
+    return batcher_.Write(bytes);
   }
 
   absl::Status Flush() {
@@ -254,26 +276,28 @@ class FsSpoolWriter {
     return result;
   }
 
-  // Estimate the size of the spool directory. However, only recompute a new
-  // estimate if the spool directory has had a change to its modification time.
+  // Estimate the size of the spool directory by scanning every file in it.
   absl::StatusOr<size_t> EstimateSpoolDirSize() {
-    struct stat stats;
-    if (stat(spool_dir_.c_str(), &stats) < 0) {
-      return absl::ErrnoToStatus(errno, "failed to stat spool directory");
+    return EstimateDirSize(spool_dir_);
+  }
+
+  // Replace the incrementally tracked spool size with a full scan of the
+  // spool directory if none has happened in the last reconcile_interval_.
+  // This picks up files removed or added outside of this writer.
+  absl::Status ReconcileSpoolSizeIfNeeded() {
+    absl::Time now = absl::Now();
+    if (now - last_reconcile_ < reconcile_interval_) {
+      return absl::OkStatus();
     }
 
-    if (stats.st_mtimespec.tv_sec == spool_dir_last_mtime_.tv_sec &&
-        stats.st_mtimespec.tv_nsec == spool_dir_last_mtime_.tv_nsec) {
-      // If the spool's last modification time hasn't changed then
-      // re-use the current estimate.
-      return spool_size_estimate_;
-    } else {
-      // Store the updated mtime
-      spool_dir_last_mtime_ = stats.st_mtimespec;
-
-      // Recompute the current estimated size
-      return EstimateDirSize(spool_dir_);
+    absl::StatusOr<size_t> estimate = EstimateSpoolDirSize();
+    if (!estimate.ok()) {
+      return estimate.status();
     }
+
+    spool_size_estimate_ = *estimate;
+    last_reconcile_ = now;
+    return absl::OkStatus();
   }
 
   struct CurrentSpoolState {
@@ -290,7 +314,6 @@ class FsSpoolWriter {
   const std::string base_dir_;
   const std::string spool_dir_;
   const std::string tmp_dir_;
-  struct timespec spool_dir_last_mtime_;
   CurrentSpoolState current_spool_state_;
 
   // This acts as an optimization when initializing a CurrentSpoolState to help
@@ -309,6 +332,9 @@ class FsSpoolWriter {
   // final estimate is likely to still include the size of that file).
   const size_t max_spool_size_;
 
+  // Minimum time between full scans of the spool directory.
+  const absl::Duration reconcile_interval_;
+
   // 64bit hex ID for this writer. Used in combination with the sequence
   // number to generate unique names for files. This is generated through
   // util::random::NewGlobalID(), hence has only 52 bits of randomness.
@@ -319,13 +345,15 @@ class FsSpoolWriter {
   // spooled files have different names.
   uint64_t sequence_number_ = 0;
 
-  // Last estimate for the spool size. The estimate will grow every time we
-  // write messages (basically, we compute it as if there was no reader
-  // consuming messages). It will get updated with the actual value whenever we
-  // think we've passed the size limit. The new estimate will be the sum of the
-  // approximate disk space occupied by each message written (in multiples of
-  // 4KiB, i.e. a typical disk cluster size).
+  // Running estimate for the spool size, as the approximate disk space
+  // occupied by each spool file (in multiples of 4KiB, i.e. a typical disk
+  // cluster size). It grows as batches are committed and shrinks as exported
+  // files are reported through SpoolFilesRemoved(). It is replaced with the
+  // result of a full directory scan at most once per reconcile_interval_.
   size_t spool_size_estimate_;
+
+  // Time of the last full scan of the spool directory.
+  absl::Time last_reconcile_;
 };
 
 // This class is thread-unsafe.
@@ -336,17 +364,27 @@ class FsSpoolReader {
         spool_dir_(SpoolNewDirectory(base_directory)) {}
   absl::Status AckMessage(const std::string& message_path, bool delete_file) {
     if (delete_file) {
+      struct stat stats;
+      bool have_size =
+          stat(message_path.c_str(), &stats) == 0 && StatIsReg(stats.st_mode);
       int remove_status = remove(message_path.c_str());
       if ((remove_status != 0) && (errno != ENOENT)) {
         return absl::ErrnoToStatus(
             errno,
             absl::Substitute("Failed to remove $0: $1", message_path, errno));
       }
+      if (remove_status == 0 && have_size) {
+        removed_bytes_ += EstimateDiskOccupation(stats.st_size);
+      }
     }
     unacked_messages_.erase(message_path);
     return absl::OkStatus();
   }
 
+  // Returns the estimated disk occupation of the files deleted by
+  // AckMessage() since the last call, for FsSpoolWriter::SpoolFilesRemoved().
+  size_t TakeRemovedBytes() { return std::exchange(removed_bytes_, 0); }
+
   // Returns absl::NotFoundError in case the FsSpool is empty.
   absl::StatusOr<std::string> NextMessagePath() {
     absl::StatusOr<std::string> file_path = OldestSpooledFile();
@@ -387,12 +425,79 @@ class FsSpoolReader {
     return batch;
   }
 
+  // Like BatchMessagePaths, but returns up to `count` paths ordered from the
+  // oldest to the newest spooled file.
+  absl::StatusOr<std::vector<std::string>> OldestMessagePaths(size_t count) {
+    std::vector<std::pair<absl::Time, std::string>> candidates;
+    absl::Status status = IterateDirectory(
+        spool_dir_,
+        [this, &candidates](const std::string& file_name, bool* stop) {
+          std::string file_path =
+              absl::StrCat(spool_dir_, PathSeparator(), file_name);
+          if (unacked_messages_.contains(file_path)) {
+            return;
+          }
+          struct stat stats;
+          if (stat(file_path.c_str(), &stats) < 0 ||
+              !StatIsReg(stats.st_mode)) {
+            return;
+          }
+          candidates.emplace_back(absl::FromTimeT(stats.st_mtime),
+                                  std::move(file_path));
+        });
+    if (!status.ok()) {
+      return status;
+    }
+
+    count = std::min(count, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count,
+                      candidates.end());
+
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      unacked_messages_.insert(candidates[i].second);
+      paths.push_back(std::move(candidates[i].second));
+    }
+    return paths;
+  }
+
+  // Returns the modification time of the oldest spooled file, including
+  // files that are unacked. Returns absl::NotFoundError in case the FsSpool
+  // is empty.
+  absl::StatusOr<absl::Time> OldestMessageTime() {
+    std::optional<absl::Time> oldest;
+    absl::Status status = IterateDirectory(
+        spool_dir_,
+        [this, &oldest](const std::string& file_name, bool* stop) {
+          std::string file_path =
+              absl::StrCat(spool_dir_, PathSeparator(), file_name);
+          struct stat stats;
+          if (stat(file_path.c_str(), &stats) < 0 ||
+              !StatIsReg(stats.st_mode)) {
+            return;
+          }
+          absl::Time file_mtime = absl::FromTimeT(stats.st_mtime);
+          if (!oldest.has_value() || file_mtime < *oldest) {
+            oldest = file_mtime;
+          }
+        });
+    if (!status.ok()) {
+      return status;
+    }
+    if (!oldest.has_value()) {
+      return absl::NotFoundError("Empty FsSpool directory.");
+    }
+    return *oldest;
+  }
+
   size_t NumberOfUnackedMessages() const { return unacked_messages_.size(); }
 
  private:
   const std::string base_dir_;
   const std::string spool_dir_;
   absl::flat_hash_set<std::string> unacked_messages_;
+  size_t removed_bytes_ = 0;
 
   absl::StatusOr<std::string> OldestSpooledFile() {
     if (!IsDirectory(spool_dir_)) {
@@ -54,6 +54,8 @@ absl::Status IterateDirectory(
     const std::string& dir,
     std::function<void(const std::string&, bool*)> callback);
 
+// Rounds a file size up to the disk space it is expected to occupy.
+size_t EstimateDiskOccupation(size_t fileSize);
 absl::StatusOr<size_t> EstimateDirSize(const std::string& dir);
 
 }  // namespace fsspool
@@ -17,8 +17,11 @@
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "Source/common/TestUtils.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
@@ -146,7 +149,6 @@ google::protobuf::Any TestAnyTimestamp(int64_t s, int32_t n) {
   XCTAssertStatusOk(status);
   XCTAssertEqual(*status, 0);
 
-  // Force the current estimate to be 0 since we're not recomputing on first write.
   writer->spool_size_estimate_ = *status;
 
   XCTAssertTrue([testData writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil]);
@@ -170,21 +172,19 @@ google::protobuf::Any TestAnyTimestamp(int64_t s, int32_t n) {
   // Ensure only one file still exists
   XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 1);
 
-  // Ensure that the returned estimate is the same as the old since mtime didn't change
+  // A full scan sees the larger file even though the spool directory mtime didn't change
   status = writer->EstimateSpoolDirSize();
   XCTAssertStatusOk(status);
-  // Check that the current estimate is the same as the old estimate
-  XCTAssertEqual(*status, writer->spool_size_estimate_);
+  XCTAssertGreaterThanOrEqual(*status, testData.length + largeTestData.length);
 
-  // Create a second file in the spool dir to bump mtime
+  // Empty files still count towards the estimate
+  size_t previous = *status;
   XCTAssertTrue([@"" writeToFile:emptyPath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
   XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 2);
 
   status = writer->EstimateSpoolDirSize();
   XCTAssertStatusOk(status);
-
-  // Ensure the newly returned size is appropriate
-  XCTAssertGreaterThanOrEqual(*status, testData.length + largeTestData.length);
+  XCTAssertGreaterThan(*status, previous);
 }
 
 - (void)testEstimateSpoolDirSizeStreamBatcher {
@@ -204,7 +204,6 @@ google::protobuf::Any TestAnyTimestamp(int64_t s, int32_t n) {
   XCTAssertStatusOk(status);
   XCTAssertEqual(*status, 0);
 
-  // Force the current estimate to be 0 since we're not recomputing on first write.
   writer->spool_size_estimate_ = *status;
 
   XCTAssertTrue([testData writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil]);
@@ -228,21 +227,75 @@ google::protobuf::Any TestAnyTimestamp(int64_t s, int32_t n) {
   // Ensure only one file still exists
   XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 1);
 
-  // Ensure that the returned estimate is the same as the old since mtime didn't change
+  // A full scan sees the larger file even though the spool directory mtime didn't change
   status = writer->EstimateSpoolDirSize();
   XCTAssertStatusOk(status);
-  // Check that the current estimate is the same as the old estimate
-  XCTAssertEqual(*status, writer->spool_size_estimate_);
+  XCTAssertGreaterThanOrEqual(*status, testData.length + largeTestData.length);
 
-  // Create a second file in the spool dir to bump mtime
+  // Empty files still count towards the estimate
+  size_t previous = *status;
   XCTAssertTrue([@"" writeToFile:emptyPath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
   XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 2);
 
   status = writer->EstimateSpoolDirSize();
   XCTAssertStatusOk(status);
+  XCTAssertGreaterThan(*status, previous);
+}
 
-  // Ensure the newly returned size is appropriate
-  XCTAssertGreaterThanOrEqual(*status, testData.length + largeTestData.length);
+- (void)testSpoolUsageTrackedIncrementally {
+  auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::UncompressedStreamBatcher>>(
+      fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], kSpoolSize,
+      absl::InfiniteDuration());
+  fsspool::FsSpoolReader reader([self.baseDir UTF8String]);
+
+  // The first write reconciles against the (empty) spool directory
+  XCTAssertStatusOk(writer->Write({1, 2, 3}));
+  XCTAssertStatusOk(writer->Flush());
+  XCTAssertEqual(writer->spool_size_estimate_, fsspool::EstimateDiskOccupation(3));
+
+  // Files added by someone else aren't seen until the next reconciliation
+  NSString* otherPath = [NSString stringWithFormat:@"%@/%@", self.spoolDir, @"other.log"];
+  XCTAssertTrue([@"foo" writeToFile:otherPath
+                         atomically:YES
+                           encoding:NSUTF8StringEncoding
+                              error:nil]);
+  XCTAssertStatusOk(writer->Write({4, 5, 6}));
+  XCTAssertStatusOk(writer->Flush());
+  XCTAssertEqual(writer->spool_size_estimate_, 2 * fsspool::EstimateDiskOccupation(3));
+
+  // Exported files are subtracted without a rescan, never going below zero
+  absl::StatusOr<std::vector<std::string>> paths = reader.OldestMessagePaths(3);
+  XCTAssertStatusOk(paths);
+  XCTAssertEqual(paths->size(), 3);
+  for (const std::string& path : *paths) {
+    XCTAssertStatusOk(reader.AckMessage(path, true));
+  }
+  writer->SpoolFilesRemoved(reader.TakeRemovedBytes());
+  XCTAssertEqual(reader.TakeRemovedBytes(), 0);
+  XCTAssertEqual(writer->spool_size_estimate_, 0);
+
+  absl::StatusOr<double> usage = writer->SpoolUsage();
+  XCTAssertStatusOk(usage);
+  XCTAssertEqual(*usage, 0.0);
+}
+
+- (void)testSpoolUsageReconciles {
+  auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::UncompressedStreamBatcher>>(
+      fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], kSpoolSize,
+      absl::ZeroDuration());
+
+  XCTAssertStatusOk(writer->Write({1, 2, 3}));
+  XCTAssertStatusOk(writer->Flush());
+
+  // Without a reconcile interval, every check rescans the spool directory
+  NSString* otherPath = [NSString stringWithFormat:@"%@/%@", self.spoolDir, @"other.log"];
+  XCTAssertTrue([@"foo" writeToFile:otherPath
+                         atomically:YES
+                           encoding:NSUTF8StringEncoding
+                              error:nil]);
+  absl::StatusOr<double> usage = writer->SpoolUsage();
+  XCTAssertStatusOk(usage);
+  XCTAssertEqual(writer->spool_size_estimate_, 2 * fsspool::EstimateDiskOccupation(3));
 }
 
 - (void)testSimpleWriteAnyBatcher {
@@ -480,4 +533,52 @@ google::protobuf::Any TestAnyTimestamp(int64_t s, int32_t n) {
   XCTAssertNil(err);
 }
 
+- (void)testOldestMessagePaths {
+  XCTAssertTrue([self.fileMgr createDirectoryAtPath:self.spoolDir
+                        withIntermediateDirectories:YES
+                                         attributes:nil
+                                              error:nil]);
+
+  // Create files whose modification times don't match their name order
+  std::vector<std::pair<std::string, time_t>> files = {
+      {"b", 3000}, {"d", 1000}, {"a", 4000}, {"c", 2000}};
+  for (const auto& [name, mtime] : files) {
+    std::string path = std::string(self.spoolDir.UTF8String) + "/" + name;
+    XCTAssertTrue([self.fileMgr createFileAtPath:@(path.c_str()) contents:nil attributes:nil]);
+    struct timeval times[2] = {{.tv_sec = mtime}, {.tv_sec = mtime}};
+    XCTAssertEqual(utimes(path.c_str(), times), 0);
+  }
+
+  auto path = [self](const char* name) {
+    return std::string(self.spoolDir.UTF8String) + "/" + name;
+  };
+
+  fsspool::FsSpoolReader reader([self.baseDir UTF8String]);
+
+  absl::StatusOr<absl::Time> oldest = reader.OldestMessageTime();
+  XCTAssertStatusOk(oldest);
+  XCTAssertEqual(*oldest, absl::FromTimeT(1000));
+
+  absl::StatusOr<std::vector<std::string>> paths = reader.OldestMessagePaths(3);
+  XCTAssertStatusOk(paths);
+  XCTAssertTrue(*paths == std::vector<std::string>({path("d"), path("c"), path("b")}));
+
+  // Unacked files are not returned again, but still count towards the oldest
+  // message time
+  paths = reader.OldestMessagePaths(3);
+  XCTAssertStatusOk(paths);
+  XCTAssertTrue(*paths == std::vector<std::string>({path("a")}));
+  XCTAssertEqual(*reader.OldestMessageTime(), absl::FromTimeT(1000));
+
+  // Once acked and deleted, files no longer count towards the oldest time
+  XCTAssertStatusOk(reader.AckMessage(path("d"), true));
+  XCTAssertEqual(*reader.OldestMessageTime(), absl::FromTimeT(2000));
+
+  // Files acked without deletion can be returned again
+  XCTAssertStatusOk(reader.AckMessage(path("c"), false));
+  paths = reader.OldestMessagePaths(3);
+  XCTAssertStatusOk(paths);
+  XCTAssertTrue(*paths == std::vector<std::string>({path("c")}));
+}
+
 @end
@@ -24,6 +24,8 @@
 #include <memory>
 #include <vector>
 
+#include "Source/santad/Logs/EndpointSecurity/Writers/BufferPool.h"
+
 // Forward declarations
 namespace santa {
 class FilePeer;
@@ -43,8 +45,12 @@ class File : public Writer, public std::enable_shared_from_this<File> {
   ~File();
 
   void Write(std::vector<uint8_t>&& bytes) override;
+
+  // Blocks until all previously written data has been written to the file
   void Flush() override;
 
+  std::shared_ptr<BufferPool> GetBufferPool() override { return buffer_pool_; }
+
   friend class santa::FilePeer;
 
  private:
@@ -53,22 +59,20 @@ class File : public Writer, public std::enable_shared_from_this<File> {
   void FlushSerialized();
   bool ShouldFlush();
 
-  void EnsureCapacitySerialized(size_t additional_bytes);
-  void CopyDataSerialized(const std::vector<uint8_t>& bytes);
+  void AppendSerialized(std::vector<uint8_t>&& bytes);
 
-  std::vector<uint8_t> buffer_;
+  // Writes are held as they arrive rather than copied into one contiguous
+  // buffer. A flush hands all of them to a single `writev` call and the
+  // buffers are then returned to the pool for serializers to reuse.
+  std::vector<std::vector<uint8_t>> pending_;
+  size_t pending_bytes_ = 0;
+  std::shared_ptr<BufferPool> buffer_pool_;
   size_t batch_size_bytes_;
   dispatch_queue_t q_;
   dispatch_source_t timer_source_;
   dispatch_source_t watch_source_;
   NSString* path_;
   NSFileHandle* file_handle_;
-
-  // Used to manually track the size of valid data in the `buffer_`.
-  // Benchmarking showed a large amount of time clearing the buffer after
-  // flushes, but that isn't very necessary. Instead we can manually track the
-  // `end` of the buffer and skip clearing the data.
-  size_t buffer_offset_ = 0;
 };
 
 }  // namespace santa
@@ -15,12 +15,52 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
 
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+#include <algorithm>
 #include <memory>
 
 #include "Source/common/BranchPrediction.h"
+#import "Source/common/SNTLogging.h"
 
 namespace santa {
 
+namespace {
+
+// Write all of `iov`, retrying after interrupts and short writes. Entries in
+// `iov` are advanced past data already written. Returns false with errno set
+// if the write failed.
+bool WriteAll(int fd, std::vector<struct iovec>& iov) {
+  size_t idx = 0;
+  while (idx < iov.size()) {
+    int count = (int)std::min<size_t>(iov.size() - idx, IOV_MAX);
+    ssize_t written = writev(fd, &iov[idx], count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+
+    // Skip past fully written entries, then trim a partially written one
+    size_t remaining = (size_t)written;
+    while (idx < iov.size() && remaining >= iov[idx].iov_len) {
+      remaining -= iov[idx].iov_len;
+      idx++;
+    }
+    if (remaining > 0) {
+      iov[idx].iov_base = (uint8_t*)iov[idx].iov_base + remaining;
+      iov[idx].iov_len -= remaining;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
 std::shared_ptr<File> File::Create(NSString* path, uint64_t flush_timeout_ms,
                                    size_t batch_size_bytes, size_t max_expected_write_size_bytes) {
   dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.file_event_log",
@@ -50,7 +90,9 @@ std::shared_ptr<File> File::Create(NSString* path, uint64_t flush_timeout_ms,
 
 File::File(NSString* path, size_t batch_size_bytes, size_t max_expected_write_size_bytes,
            dispatch_queue_t q, dispatch_source_t timer_source)
-    : buffer_(batch_size_bytes + max_expected_write_size_bytes),
+    : buffer_pool_(std::make_shared<BufferPool>(
+          BufferPool::kDefaultMaxBuffers,
+          std::max(BufferPool::kDefaultMaxBufferCapacity, max_expected_write_size_bytes))),
       batch_size_bytes_(batch_size_bytes),
       q_(q),
       timer_source_(timer_source),
@@ -102,7 +144,7 @@ void File::Write(std::vector<uint8_t>&& bytes) {
   dispatch_async(q_, ^{
     std::vector<uint8_t> moved_bytes = std::move(temp_bytes);
 
-    shared_this->CopyDataSerialized(moved_bytes);
+    shared_this->AppendSerialized(std::move(moved_bytes));
 
     if (shared_this->ShouldFlush()) {
       shared_this->FlushSerialized();
@@ -111,7 +153,7 @@ void File::Write(std::vector<uint8_t>&& bytes) {
 }
 
 bool File::ShouldFlush() {
-  return buffer_offset_ >= batch_size_bytes_;
+  return pending_bytes_ >= batch_size_bytes_;
 }
 
 void File::Flush() {
@@ -121,27 +163,38 @@ void File::Flush() {
 }
 
 // IMPORTANT: Not thread safe.
-void File::EnsureCapacitySerialized(size_t additional_bytes) {
-  if ((buffer_offset_ + additional_bytes) > buffer_.capacity()) {
-    buffer_.resize(buffer_.capacity() * 2);
+void File::AppendSerialized(std::vector<uint8_t>&& bytes) {
+  if (bytes.empty()) {
+    return;
   }
-}
-
-// IMPORTANT: Not thread safe.
-void File::CopyDataSerialized(const std::vector<uint8_t>& bytes) {
-  EnsureCapacitySerialized(bytes.size());
-  std::copy(bytes.begin(), bytes.end(), buffer_.begin() + buffer_offset_);
-  buffer_offset_ += bytes.size();
+  pending_bytes_ += bytes.size();
+  pending_.push_back(std::move(bytes));
 }
 
 // IMPORTANT: Not thread safe.
 void File::FlushSerialized() {
-  if (likely(buffer_offset_ > 0)) {
-    write(file_handle_.fileDescriptor, buffer_.data(), buffer_offset_);
+  if (unlikely(pending_.empty())) {
+    return;
+  }
+
+  std::vector<struct iovec> iov;
+  iov.reserve(pending_.size());
+  for (std::vector<uint8_t>& bytes : pending_) {
+    iov.push_back({.iov_base = bytes.data(), .iov_len = bytes.size()});
+  }
+
+  if (!WriteAll(file_handle_.fileDescriptor, iov)) {
+    // Pending data is dropped so that a persistently failing file doesn't
+    // grow memory without bound.
+    LOGE(@"Failed to write %zu bytes to event log %@: %s", pending_bytes_, path_,
+         strerror(errno));
+  }
 
-    // After flushing, reset the offset back to 0
-    buffer_offset_ = 0;
+  for (std::vector<uint8_t>& bytes : pending_) {
+    buffer_pool_->Return(std::move(bytes));
   }
+  pending_.clear();
+  pending_bytes_ = 0;
 }
 
 }  // namespace santa
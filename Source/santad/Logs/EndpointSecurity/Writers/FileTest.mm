@@ -16,8 +16,11 @@
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
 #include <gtest/gtest.h>
+#include <limits.h>
 #include <sys/stat.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "Source/common/TestUtils.h"
@@ -30,8 +33,8 @@ class FilePeer : public File {
   // Make constructors visible
   using File::File;
 
-  using File::CopyDataSerialized;
-  using File::EnsureCapacitySerialized;
+  using File::AppendSerialized;
+  using File::FlushSerialized;
   using File::ShouldFlush;
   using File::WatchLogFile;
 
@@ -47,14 +50,15 @@ class FilePeer : public File {
   size_t InternalBufferSize() {
     __block size_t s = 0;
     dispatch_sync(q_, ^{
-      s = buffer_offset_;
+      s = pending_bytes_;
     });
     return s;
   }
-  size_t InternalBufferCapacity() {
+
+  size_t PendingWrites() {
     __block size_t s = 0;
     dispatch_sync(q_, ^{
-      s = buffer_.capacity();
+      s = pending_.size();
     });
     return s;
   }
@@ -200,62 +204,73 @@ bool WaitForBufferSize(std::shared_ptr<FilePeer> file, size_t expectedSize) {
   XCTAssertEqual(0, file->InternalBufferSize());
 }
 
-- (void)testEnsureCapacity {
+- (void)testAppend {
   const size_t batchSize = 100;
+  std::vector<uint8_t> bytes(batchSize + 2, 'A');
   auto file =
       std::make_shared<FilePeer>(self.logPath, batchSize, batchSize * 2, self.q, self.timer);
 
-  // Initial capacity == (batch_size + max_expected_write_size)
-  const size_t initialCapacity = batchSize + (batchSize * 2);
-
-  // Buffer size should initially be 0 and capacity match initial expectations
   XCTAssertEqual(file->InternalBufferSize(), 0);
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity);
+  XCTAssertEqual(file->PendingWrites(), 0);
 
-  file->EnsureCapacitySerialized(batchSize);
+  file->AppendSerialized(std::vector<uint8_t>(bytes));
 
-  // No data was written, so size is still 0
-  XCTAssertEqual(file->InternalBufferSize(), 0);
+  // After an append, buffer size should match appended data size
+  XCTAssertEqual(file->InternalBufferSize(), bytes.size());
+  XCTAssertEqual(file->PendingWrites(), 1);
+
+  // Each append is held separately until the next flush
+  file->AppendSerialized(std::vector<uint8_t>(bytes));
+  file->AppendSerialized(std::vector<uint8_t>(bytes));
+  XCTAssertEqual(file->InternalBufferSize(), bytes.size() * 3);
+  XCTAssertEqual(file->PendingWrites(), 3);
 
-  // Capacity should be unchanged because the amount ensured didn't exceed
-  // the initial amount
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity);
+  // Empty writes are ignored
+  file->AppendSerialized(std::vector<uint8_t>());
+  XCTAssertEqual(file->PendingWrites(), 3);
+}
 
-  file->EnsureCapacitySerialized(initialCapacity + 100);
+- (void)testFlushWritesAllPendingDataInOrder {
+  // Use more writes than fit in a single writev call
+  const size_t numWrites = IOV_MAX * 2 + 7;
+  auto file = std::make_shared<FilePeer>(self.logPath, numWrites * 4, 100, self.q, self.timer);
+  std::shared_ptr<santa::BufferPool> pool = file->GetBufferPool();
+  XCTAssertEqual(pool->Available(), 0);
+
+  std::string want;
+  for (size_t i = 0; i < numWrites; i++) {
+    std::string line = std::to_string(i) + "\n";
+    want += line;
+    file->AppendSerialized(std::vector<uint8_t>(line.begin(), line.end()));
+  }
 
-  // No data was written, so size is still 0
+  file->FlushSerialized();
   XCTAssertEqual(file->InternalBufferSize(), 0);
+  XCTAssertEqual(file->PendingWrites(), 0);
 
-  // Capacity should be doubled since the amount ensured was greater than
-  // the previous capacity
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity * 2);
-}
-
-- (void)testCopyData {
-  const size_t batchSize = 100;
-  // Use a buffer to copy that's slightly larger than the batch size
-  std::vector<uint8_t> bytes(batchSize + 2, 'A');
-  auto file =
-      std::make_shared<FilePeer>(self.logPath, batchSize, batchSize * 2, self.q, self.timer);
+  NSData* got = [NSData dataWithContentsOfFile:self.logPath];
+  XCTAssertEqual(got.length, want.size());
+  XCTAssertEqual(std::string((const char*)got.bytes, got.length), want);
 
-  // Initial capacity == (batch_size + max_expected_write_size)
-  const size_t initialCapacity = batchSize + (batchSize * 2);
+  // Flushed buffers are returned to the pool, up to its retention limit
+  XCTAssertEqual(pool->Available(), santa::BufferPool::kDefaultMaxBuffers);
+}
 
-  // Buffer size should initially be 0 and capacity match initial expectations
-  XCTAssertEqual(file->InternalBufferSize(), 0);
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity);
+- (void)testFlushBarrier {
+  // Large batch size so that only an explicit flush writes data
+  auto file = std::make_shared<FilePeer>(self.logPath, 1024 * 1024, 100, self.q, self.timer);
 
-  file->CopyDataSerialized(bytes);
+  for (int i = 0; i < 10; i++) {
+    file->Write(std::vector<uint8_t>(10, 'A'));
+  }
 
-  // After a copy, buffer size should match copied data size
-  XCTAssertEqual(file->InternalBufferSize(), bytes.size());
+  // Flush blocks until all previous writes are on disk
+  file->Flush();
 
-  // Do a couple more copies that should require the buffer to grow and then
-  // confirm the size/capacity still matches expectations
-  file->CopyDataSerialized(bytes);
-  file->CopyDataSerialized(bytes);
-  XCTAssertEqual(file->InternalBufferSize(), bytes.size() * 3);
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity * 2);
+  struct stat gotSB;
+  XCTAssertEqual(fstat(file->FileHandle().fileDescriptor, &gotSB), 0);
+  XCTAssertEqual(100, gotSB.st_size);
+  XCTAssertEqual(0, file->InternalBufferSize());
 }
 
 - (void)testShouldFlush {
@@ -268,8 +283,8 @@ bool WaitForBufferSize(std::shared_ptr<FilePeer> file, size_t expectedSize) {
   // Should never want to flush with no data in the buffer
   XCTAssertFalse(file->ShouldFlush());
 
-  // Copy some data into the buffer
-  file->CopyDataSerialized(bytes);
+  // Append some data to the buffer
+  file->AppendSerialized(std::vector<uint8_t>(bytes));
 
   // Buffer size should be updated
   XCTAssertEqual(file->InternalBufferSize(), bytes.size());
@@ -278,8 +293,8 @@ bool WaitForBufferSize(std::shared_ptr<FilePeer> file, size_t expectedSize) {
   XCTAssertFalse(file->ShouldFlush());
 
   // Exceed the batch size
-  file->CopyDataSerialized(bytes);
-  file->CopyDataSerialized(bytes);
+  file->AppendSerialized(std::vector<uint8_t>(bytes));
+  file->AppendSerialized(std::vector<uint8_t>(bytes));
 
   // Should want to flush now that the batch size is exceeded
   XCTAssertTrue(file->ShouldFlush());
@@ -19,20 +19,26 @@
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
 
+#include <deque>
+#include <iterator>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "Source/common/MPSCQueue.h"
 #import "Source/common/SNTLogging.h"
+#include "Source/common/SelfProfiler.h"
 #include "Source/common/santa.pb.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 // Forward declarations
 namespace santa {
@@ -51,6 +57,7 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
                                           uint64_t flush_timeout_ms) {
     dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.file_base_q",
                                                DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+    SelfProfiler::Shared().RegisterQueue(q, "spool_writer");
     dispatch_source_t timer_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
     dispatch_source_set_timer(timer_source, dispatch_time(DISPATCH_TIME_NOW, 0),
                               NSEC_PER_MSEC * flush_timeout_ms, 0);
@@ -89,45 +96,30 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   }
 
   void Write(std::vector<uint8_t>&& bytes) override {
-    auto shared_this = this->shared_from_this();
-
-    // Workaround to move `bytes` into the block without a copy
-    __block std::vector<uint8_t> temp_bytes = std::move(bytes);
-
-    dispatch_async(q_, ^{
-      std::vector<uint8_t> moved_bytes = std::move(temp_bytes);
+    // Group commit: only the write that finds the queue empty schedules a
+    // drain, and every write queued before the drain runs is handled by it.
+    if (pending_writes_.Push(std::move(bytes))) {
+      auto shared_this = this->shared_from_this();
+      dispatch_async(q_, ^{
+        shared_this->DrainPendingWrites();
+      });
+    }
+  }
 
-      if (shared_this->accumulated_bytes_ >= shared_this->spool_file_size_threshold_) {
-        shared_this->FlushSerialized();
-      }
+  std::shared_ptr<BufferPool> GetBufferPool() override { return buffer_pool_; }
 
-      // Only write the new message if we have room left.
-      // This will account for Flush failing above.
-      // Use the more lenient threshold here in case the Flush failures are transitory.
-      if (shared_this->accumulated_bytes_ < shared_this->spool_file_size_threshold_leniency_) {
-        size_t bytes_written = moved_bytes.size();
-        auto status = shared_this->spool_writer_.Write(std::move(moved_bytes));
-        if (!status.ok()) {
-          if (absl::IsDataLoss(status)) {
-            // Nop for now. We haven't historically logged on drops as that would
-            // spam the console when the spool is filled and that isn't very useful.
-            // There will be periodic messages that the spool is full.
-          } else {
-            LOGE(@"Failed to log event: %s", status.ToString().c_str());
-          }
-        } else {
-          shared_this->accumulated_bytes_ += bytes_written;
-        }
-      }
-
-      if (shared_this->write_complete_f_) {
-        shared_this->write_complete_f_();
-      }
+  // Pooled buffers plus the batch accumulated since the last flush
+  size_t BufferedBytes() override {
+    __block size_t accumulated = 0;
+    dispatch_sync(q_, ^{
+      accumulated = accumulated_bytes_;
     });
+    return buffer_pool_->PooledBytes() + accumulated;
   }
 
   void Flush() override {
     dispatch_sync(q_, ^{
+      DrainPendingWrites();
       FlushSerialized();
     });
   }
@@ -141,13 +133,35 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
     return paths.ok() ? std::make_optional(std::move(*paths)) : std::nullopt;
   }
 
+  // Files are returned oldest first so that a backlog is drained in the
+  // order it was written.
   std::optional<std::string> NextFileToExport() override {
-    std::optional<absl::flat_hash_set<std::string>> paths = GetFilesToExport(1);
-    if (paths.has_value() && paths->size() == 1) {
-      return *paths->begin();
-    } else {
-      return std::nullopt;
-    }
+    __block std::optional<std::string> path;
+    dispatch_sync(q_, ^{
+      if (export_candidates_.empty()) {
+        absl::StatusOr<std::vector<std::string>> paths =
+            spool_reader_.OldestMessagePaths(kExportCandidateBatchSize);
+        if (paths.ok()) {
+          export_candidates_.insert(export_candidates_.end(),
+                                    std::make_move_iterator(paths->begin()),
+                                    std::make_move_iterator(paths->end()));
+        }
+      }
+
+      if (!export_candidates_.empty()) {
+        path = std::move(export_candidates_.front());
+        export_candidates_.pop_front();
+      }
+    });
+    return path;
+  }
+
+  std::optional<absl::Time> OldestFileToExportTime() override {
+    __block absl::StatusOr<absl::Time> oldest;
+    dispatch_sync(q_, ^{
+      oldest = spool_reader_.OldestMessageTime();
+    });
+    return oldest.ok() ? std::make_optional(*oldest) : std::nullopt;
   }
 
   void FilesExported(absl::flat_hash_map<std::string, bool> files_exported) override {
@@ -157,6 +171,22 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
           LOGW(@"Unable to delete exported file.");
         }
       }
+      spool_writer_.SpoolFilesRemoved(spool_reader_.TakeRemovedBytes());
+    });
+  }
+
+  // Called on the spool queue with the current spool usage, as a fraction of
+  // the maximum spool size, after each successful flush.
+  void SetSpoolUsageObserver(void (^spool_usage_f)(double)) {
+    dispatch_sync(q_, ^{
+      spool_usage_f_ = spool_usage_f;
+    });
+  }
+
+  // Called on the spool queue after each flush that produced a new batch.
+  void SetFileFinalizedObserver(void (^file_finalized_f)(void)) override {
+    dispatch_sync(q_, ^{
+      file_finalized_f_ = file_finalized_f;
     });
   }
 
@@ -189,15 +219,67 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   friend class santa::SpoolPeer<T>;
 
  private:
+  // Must be called on q_
+  void DrainPendingWrites() {
+    pending_writes_.Drain([this](std::vector<uint8_t>&& bytes) {
+      WriteSerialized(std::move(bytes));
+    });
+  }
+
+  // Must be called on q_
+  void WriteSerialized(std::vector<uint8_t>&& bytes) {
+    if (accumulated_bytes_ >= spool_file_size_threshold_) {
+      FlushSerialized();
+    }
+
+    // Only write the new message if we have room left.
+    // This will account for Flush failing above.
+    // Use the more lenient threshold here in case the Flush failures are transitory.
+    if (accumulated_bytes_ < spool_file_size_threshold_leniency_) {
+      size_t bytes_written = bytes.size();
+      auto status = spool_writer_.Write(bytes);
+      if (!status.ok()) {
+        if (absl::IsDataLoss(status)) {
+          // Nop for now. We haven't historically logged on drops as that would
+          // spam the console when the spool is filled and that isn't very useful.
+          // There will be periodic messages that the spool is full.
+        } else {
+          LOGE(@"Failed to log event: %s", status.ToString().c_str());
+        }
+      } else {
+        accumulated_bytes_ += bytes_written;
+      }
+    }
+
+    buffer_pool_->Return(std::move(bytes));
+
+    if (write_complete_f_) {
+      write_complete_f_();
+    }
+  }
+
   bool FlushSerialized() {
+    bool had_data = accumulated_bytes_ > 0;
     if (spool_writer_.Flush().ok()) {
       accumulated_bytes_ = 0;
+      if (had_data && file_finalized_f_) {
+        file_finalized_f_();
+      }
+      if (spool_usage_f_) {
+        absl::StatusOr<double> usage = spool_writer_.SpoolUsage();
+        if (usage.ok()) {
+          spool_usage_f_(*usage);
+        }
+      }
       return true;
     } else {
       return false;
     }
   }
 
+  // Number of files to order per spool directory scan when exporting
+  static constexpr size_t kExportCandidateBatchSize = 128;
+
   dispatch_queue_t q_ = NULL;
   dispatch_source_t timer_source_ = NULL;
   ::fsspool::FsSpoolReader spool_reader_;
@@ -210,8 +292,16 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   bool flush_task_started_ = false;
   void (^write_complete_f_)(void);
   void (^flush_task_complete_f_)(void);
+  void (^spool_usage_f_)(double) = nil;
+  void (^file_finalized_f_)(void) = nil;
 
   size_t accumulated_bytes_ = 0;
+  // Files ordered oldest first that have not been handed out for export yet
+  std::deque<std::string> export_candidates_;
+  // Writes waiting to be handed to the batcher on q_
+  MPSCQueue<std::vector<uint8_t>> pending_writes_;
+  // Buffers are returned once their contents have been handed to the batcher
+  std::shared_ptr<BufferPool> buffer_pool_ = std::make_shared<BufferPool>();
 };
 
 }  // namespace santa
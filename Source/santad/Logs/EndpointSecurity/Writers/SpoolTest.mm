@@ -18,6 +18,7 @@
 #include <dispatch/dispatch.h>
 #include <unistd.h>
 #include <memory>
+#include <vector>
 
 #include "Source/common/TestUtils.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
@@ -208,4 +209,95 @@ using santa::SpoolPeer;
   XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:&err] count], 2);
 }
 
+- (void)testWrittenBuffersAreReturnedToPool {
+  dispatch_semaphore_t semaWrite = dispatch_semaphore_create(0);
+
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024, ^{
+        dispatch_semaphore_signal(semaWrite);
+      });
+
+  std::shared_ptr<santa::BufferPool> pool = spool->GetBufferPool();
+  XCTAssertNotEqual(pool, nullptr);
+
+  std::vector<uint8_t> bytes = pool->Lease(50);
+  const uint8_t* storage = bytes.data();
+  spool->Write(std::move(bytes));
+
+  XCTAssertSemaTrue(semaWrite, 5, "Write didn't complete within expected window");
+  XCTAssertEqual(pool->Available(), 1);
+  XCTAssertEqual(pool->Lease(10).data(), storage);
+}
+
+- (void)testConcurrentWritesAreAllWritten {
+  constexpr int kWriters = 8;
+  constexpr int kWritesPerWriter = 500;
+  // Written only on the spool queue
+  __block int writesCompleted = 0;
+
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String],
+      10 * 1024 * 1024, 1024 * 1024, ^{
+        writesCompleted++;
+      });
+
+  dispatch_apply(kWriters, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t) {
+    for (int i = 0; i < kWritesPerWriter; i++) {
+      spool->Write(std::vector<uint8_t>(64, 'A'));
+    }
+  });
+
+  // Flush drains any writes still waiting to be handed to the batcher
+  spool->Flush();
+  XCTAssertEqual(writesCompleted, kWriters * kWritesPerWriter);
+  XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 1);
+}
+
+- (void)testFileFinalizedObserver {
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024);
+
+  // Written only on the spool queue
+  __block int filesFinalized = 0;
+  spool->SetFileFinalizedObserver(^{
+    filesFinalized++;
+  });
+
+  // Flushing with nothing written doesn't finalize a batch
+  spool->Flush();
+  XCTAssertEqual(filesFinalized, 0);
+
+  spool->Write(std::vector<uint8_t>(50, 'A'));
+  spool->Flush();
+  XCTAssertEqual(filesFinalized, 1);
+  XCTAssertTrue(spool->NextFileToExport().has_value());
+
+  // The batch was already finalized so this flush has nothing new to report
+  spool->Flush();
+  XCTAssertEqual(filesFinalized, 1);
+}
+
+- (void)testWriteThroughput {
+  constexpr int kWriters = 4;
+  constexpr int kWritesPerWriter = 10000;
+  NSString* baseDir = self.baseDir;
+
+  [self measureBlock:^{
+    dispatch_queue_t q = dispatch_queue_create(NULL, DISPATCH_QUEUE_SERIAL);
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
+    auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+        q, timer, ::fsspool::UncompressedStreamBatcher(), [baseDir UTF8String],
+        1024 * 1024 * 1024, 4 * 1024 * 1024);
+
+    dispatch_apply(kWriters, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t) {
+      for (int i = 0; i < kWritesPerWriter; i++) {
+        spool->Write(std::vector<uint8_t>(256, 'A'));
+      }
+    });
+    spool->Flush();
+  }];
+}
+
 @end
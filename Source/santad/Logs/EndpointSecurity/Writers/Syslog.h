@@ -15,18 +15,63 @@
 #ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_SYSLOG_H
 #define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_SYSLOG_H
 
+#include <dispatch/dispatch.h>
+
+#include <memory>
 #include <vector>
 
+#include "Source/santad/Logs/EndpointSecurity/Writers/BufferPool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+// Forward declarations
+namespace santa {
+class SyslogPeer;
+}
 
 namespace santa {
 
 class Syslog : public Writer {
  public:
+  // Lines combined into a single log message when batching
+  static constexpr size_t kMaxLinesPerBatch = 4;
+
+  // Each line is emitted as its own log message
   static std::shared_ptr<Syslog> Create();
 
+  // Lines are combined into messages of up to kMaxLinesPerBatch, so logd
+  // sees a fraction of the message rate. Partial batches are emitted after at
+  // most `flush_timeout_ms`.
+  static std::shared_ptr<Syslog> CreateBatched(uint64_t flush_timeout_ms);
+
+  // `timer_source` is nullptr when not batching
+  explicit Syslog(dispatch_source_t timer_source);
+  virtual ~Syslog();
+
   void Write(std::vector<uint8_t>&& bytes) override;
+
+  // Blocks until all previously written lines have been handed to os_log
   void Flush() override;
+
+  std::shared_ptr<BufferPool> GetBufferPool() override { return buffer_pool_; }
+
+  friend class santa::SyslogPeer;
+
+ protected:
+  // Emits `count` lines, at most kMaxLinesPerBatch, as one log message
+  virtual void Emit(const std::vector<uint8_t>* lines, size_t count);
+
+ private:
+  void FlushLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  std::shared_ptr<BufferPool> buffer_pool_;
+  dispatch_source_t timer_source_;
+
+  // Lines are emitted while holding the lock so they keep the order in which
+  // they were written
+  absl::Mutex mu_;
+  std::vector<std::vector<uint8_t>> pending_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace santa
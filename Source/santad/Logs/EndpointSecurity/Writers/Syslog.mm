@@ -17,6 +17,9 @@
 
 #include <os/log.h>
 
+#include <algorithm>
+#include <utility>
+
 namespace santa {
 
 // Max length of data that should be displayed in a single line.
@@ -25,15 +28,100 @@ static constexpr std::vector<uint8_t>::size_type kMaxLineLength = 1024;
 static_assert(kMaxLineLength <= INT_MAX);
 
 std::shared_ptr<Syslog> Syslog::Create() {
-  return std::make_shared<Syslog>();
+  return std::make_shared<Syslog>(nullptr);
+}
+
+std::shared_ptr<Syslog> Syslog::CreateBatched(uint64_t flush_timeout_ms) {
+  dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.syslog_event_log",
+                                             DISPATCH_QUEUE_SERIAL);
+  dispatch_source_t timer_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
+  dispatch_source_set_timer(timer_source, dispatch_time(DISPATCH_TIME_NOW, 0),
+                            NSEC_PER_MSEC * flush_timeout_ms, 0);
+
+  auto writer = std::make_shared<Syslog>(timer_source);
+
+  std::weak_ptr<Syslog> weak_writer(writer);
+  dispatch_source_set_event_handler(timer_source, ^{
+    std::shared_ptr<Syslog> shared_writer = weak_writer.lock();
+    if (!shared_writer) {
+      return;
+    }
+    shared_writer->Flush();
+  });
+
+  dispatch_resume(timer_source);
+
+  return writer;
+}
+
+Syslog::Syslog(dispatch_source_t timer_source)
+    : buffer_pool_(std::make_shared<BufferPool>()), timer_source_(timer_source) {
+  if (timer_source_) {
+    pending_.reserve(kMaxLinesPerBatch);
+  }
+}
+
+Syslog::~Syslog() {
+  if (timer_source_) {
+    dispatch_source_cancel(timer_source_);
+  }
 }
 
 void Syslog::Write(std::vector<uint8_t>&& bytes) {
-  os_log(OS_LOG_DEFAULT, "%{public}.*s", (int)std::min(kMaxLineLength, bytes.size()), bytes.data());
+  if (!timer_source_) {
+    Emit(&bytes, 1);
+    buffer_pool_->Return(std::move(bytes));
+    return;
+  }
+
+  absl::MutexLock lock(&mu_);
+  pending_.push_back(std::move(bytes));
+  if (pending_.size() >= kMaxLinesPerBatch) {
+    FlushLocked();
+  }
 }
 
 void Syslog::Flush() {
-  // Nothing to do here
+  absl::MutexLock lock(&mu_);
+  FlushLocked();
+}
+
+void Syslog::FlushLocked() {
+  if (pending_.empty()) {
+    return;
+  }
+
+  Emit(pending_.data(), pending_.size());
+
+  for (std::vector<uint8_t>& bytes : pending_) {
+    buffer_pool_->Return(std::move(bytes));
+  }
+  pending_.clear();
+}
+
+void Syslog::Emit(const std::vector<uint8_t>* lines, size_t count) {
+  auto len = [lines](size_t i) { return (int)std::min(kMaxLineLength, lines[i].size()); };
+
+  // The format must be a string literal, so there is one per batch size.
+  // Each line keeps its trailing newline, which separates lines in a batch.
+  static_assert(kMaxLinesPerBatch == 4);
+  switch (count) {
+    case 0: break;
+    case 1: os_log(OS_LOG_DEFAULT, "%{public}.*s", len(0), lines[0].data()); break;
+    case 2:
+      os_log(OS_LOG_DEFAULT, "%{public}.*s%{public}.*s", len(0), lines[0].data(), len(1),
+             lines[1].data());
+      break;
+    case 3:
+      os_log(OS_LOG_DEFAULT, "%{public}.*s%{public}.*s%{public}.*s", len(0), lines[0].data(),
+             len(1), lines[1].data(), len(2), lines[2].data());
+      break;
+    default:
+      os_log(OS_LOG_DEFAULT, "%{public}.*s%{public}.*s%{public}.*s%{public}.*s", len(0),
+             lines[0].data(), len(1), lines[1].data(), len(2), lines[2].data(), len(3),
+             lines[3].data());
+      break;
+  }
 }
 
 }  // namespace santa
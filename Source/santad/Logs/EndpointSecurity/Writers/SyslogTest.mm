@@ -0,0 +1,128 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#import "Source/santad/Logs/EndpointSecurity/Writers/Syslog.h"
+
+namespace santa {
+
+// Records each message instead of sending it to os_log
+class SyslogPeer : public Syslog {
+ public:
+  using Syslog::Syslog;
+
+  size_t PendingLines() {
+    absl::MutexLock lock(&mu_);
+    return pending_.size();
+  }
+
+  std::vector<std::vector<std::string>> messages;
+
+ protected:
+  void Emit(const std::vector<uint8_t>* lines, size_t count) override {
+    std::vector<std::string> message;
+    for (size_t i = 0; i < count; i++) {
+      message.emplace_back(lines[i].begin(), lines[i].end());
+    }
+    messages.push_back(std::move(message));
+  }
+};
+
+}  // namespace santa
+
+using santa::Syslog;
+using santa::SyslogPeer;
+
+static std::vector<uint8_t> Line(const std::string& str) {
+  return std::vector<uint8_t>(str.begin(), str.end());
+}
+
+@interface SyslogTest : XCTestCase
+@property dispatch_queue_t q;
+@property dispatch_source_t timer;
+@end
+
+@implementation SyslogTest
+
+- (void)setUp {
+  self.q = dispatch_queue_create(NULL, DISPATCH_QUEUE_SERIAL);
+  // Never fires, batches are only emitted when full or flushed
+  self.timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.q);
+  dispatch_resume(self.timer);
+}
+
+- (void)testUnbatchedEmitsEachLine {
+  auto sut = std::make_shared<SyslogPeer>(nullptr);
+
+  sut->Write(Line("a\n"));
+  sut->Write(Line("b\n"));
+
+  XCTAssertEqual(sut->messages.size(), 2);
+  XCTAssertEqual(sut->messages[0], std::vector<std::string>{"a\n"});
+  XCTAssertEqual(sut->messages[1], std::vector<std::string>{"b\n"});
+  XCTAssertEqual(sut->PendingLines(), 0);
+}
+
+- (void)testBatchesLinesInOrder {
+  auto sut = std::make_shared<SyslogPeer>(self.timer);
+
+  for (size_t i = 0; i < Syslog::kMaxLinesPerBatch + 1; i++) {
+    sut->Write(Line(std::to_string(i) + "\n"));
+  }
+
+  // One full batch was emitted and the last line is waiting
+  XCTAssertEqual(sut->messages.size(), 1);
+  XCTAssertEqual(sut->messages[0], (std::vector<std::string>{"0\n", "1\n", "2\n", "3\n"}));
+  XCTAssertEqual(sut->PendingLines(), 1);
+
+  sut->Flush();
+  XCTAssertEqual(sut->messages.size(), 2);
+  XCTAssertEqual(sut->messages[1], std::vector<std::string>{"4\n"});
+  XCTAssertEqual(sut->PendingLines(), 0);
+
+  // Nothing to flush emits nothing
+  sut->Flush();
+  XCTAssertEqual(sut->messages.size(), 2);
+}
+
+- (void)testBuffersAreReturnedToPool {
+  auto sut = std::make_shared<SyslogPeer>(self.timer);
+  XCTAssertNotEqual(sut->GetBufferPool(), nullptr);
+
+  sut->Write(sut->GetBufferPool()->Lease(10));
+  XCTAssertEqual(sut->GetBufferPool()->Available(), 0);
+
+  sut->Flush();
+  XCTAssertEqual(sut->GetBufferPool()->Available(), 1);
+}
+
+- (void)testRealWriterDoesNotCrash {
+  auto sut = Syslog::CreateBatched(10);
+  sut->Write(Line("santa syslog batching test line 1\n"));
+  sut->Write(Line("santa syslog batching test line 2\n"));
+  sut->Flush();
+
+  sut = Syslog::Create();
+  sut->Write(Line("santa syslog test line\n"));
+  sut->Flush();
+}
+
+@end
@@ -16,12 +16,15 @@
 #ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_WRITER_H
 #define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_WRITER_H
 
+#include <memory>
 #include <optional>
 #include <utility>
 #include <vector>
 
+#include "Source/santad/Logs/EndpointSecurity/Writers/BufferPool.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/time/time.h"
 
 namespace santa {
 
@@ -32,6 +35,17 @@ class Writer {
   virtual void Write(std::vector<uint8_t>&& bytes) = 0;
   virtual void Flush() = 0;
 
+  // Writers that recycle the buffers passed to `Write` vend the pool that
+  // serializers should lease their output buffers from.
+  virtual std::shared_ptr<BufferPool> GetBufferPool() { return nullptr; }
+
+  // Approximate bytes held in memory by the writer, including pooled
+  // buffers.
+  virtual size_t BufferedBytes() {
+    std::shared_ptr<BufferPool> pool = GetBufferPool();
+    return pool ? pool->PooledBytes() : 0;
+  }
+
   virtual std::optional<absl::flat_hash_set<std::string>> GetFilesToExport(
       size_t max_count) {
     return std::nullopt;
@@ -39,10 +53,22 @@ class Writer {
 
   virtual std::optional<std::string> NextFileToExport() { return std::nullopt; }
 
+  // Time the oldest file still waiting to be exported was written, or nullopt
+  // if nothing is waiting.
+  virtual std::optional<absl::Time> OldestFileToExportTime() {
+    return std::nullopt;
+  }
+
   virtual void FilesExported(
       absl::flat_hash_map<std::string, bool> files_exported) {
     // no-op
   }
+
+  // Writers that produce files for export call `file_finalized_f` each time
+  // a new file becomes available from `NextFileToExport`.
+  virtual void SetFileFinalizedObserver(void (^file_finalized_f)(void)) {
+    // no-op
+  }
 };
 
 }  // namespace santa
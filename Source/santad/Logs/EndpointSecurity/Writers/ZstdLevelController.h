@@ -0,0 +1,94 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_ZSTDLEVELCONTROLLER_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_ZSTDLEVELCONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+
+namespace santa {
+
+// Chooses the zstd compression level for each new spool batch.
+//
+// Compression is cheaper while running on battery power and stronger when the
+// spool is close to its size limit, so that fewer events are dropped. Spool
+// pressure takes precedence over battery state. Pressure is entered once usage
+// reaches kPressureEnterUsage and only left once usage falls below
+// kPressureExitUsage to avoid flapping between levels.
+class ZstdLevelController
+    : public std::enable_shared_from_this<ZstdLevelController> {
+ public:
+  static constexpr int kBatteryLevel = 1;
+  static constexpr int kDefaultLevel = ZSTD_CLEVEL_DEFAULT;
+  static constexpr int kPressureLevel = 9;
+  static constexpr double kPressureEnterUsage = 0.8;
+  static constexpr double kPressureExitUsage = 0.6;
+
+  struct Stats {
+    int level;
+    // Uncompressed bytes divided by compressed bytes for batches completed
+    // since the last reset, or 0 if none were completed.
+    double compression_ratio;
+  };
+
+  // Battery state is read from PowerMonitor
+  static std::shared_ptr<ZstdLevelController> Create();
+
+  explicit ZstdLevelController(std::function<bool()> on_battery_power_f);
+
+  ZstdLevelController(ZstdLevelController&& other) = delete;
+  ZstdLevelController& operator=(ZstdLevelController&& rhs) = delete;
+  ZstdLevelController(const ZstdLevelController& other) = delete;
+  ZstdLevelController& operator=(const ZstdLevelController& other) = delete;
+
+  // Re-evaluate the level. `spool_usage` is the fraction of the maximum spool
+  // size currently in use.
+  void Update(double spool_usage);
+
+  int Level() const { return level_.load(std::memory_order_relaxed); }
+
+  // Create a stream for a new batch using the current level. The achieved
+  // compression ratio is recorded when the stream is destroyed. Dictionaries
+  // carry their own compression level, so the chosen level is not applied to
+  // streams created with one.
+  std::shared_ptr<fsspool::ZstdOutputStream> CreateStream(
+      google::protobuf::io::ZeroCopyOutputStream* raw_stream,
+      fsspool::ZstdOutputStream::Dictionary dictionary = nullptr);
+
+  Stats GetStats(bool reset);
+
+ private:
+  void RecordBatch(int64_t uncompressed_bytes, int64_t compressed_bytes);
+
+  std::function<bool()> on_battery_power_f_;
+  std::atomic<int> level_{kDefaultLevel};
+
+  absl::Mutex mtx_;
+  bool under_pressure_ ABSL_GUARDED_BY(mtx_) = false;
+  uint64_t uncompressed_bytes_ ABSL_GUARDED_BY(mtx_) = 0;
+  uint64_t compressed_bytes_ ABSL_GUARDED_BY(mtx_) = 0;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_ZSTDLEVELCONTROLLER_H
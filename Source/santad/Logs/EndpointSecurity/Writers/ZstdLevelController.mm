@@ -0,0 +1,100 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/ZstdLevelController.h"
+
+#include <utility>
+
+#include "Source/common/PowerMonitor.h"
+
+namespace santa {
+
+std::shared_ptr<ZstdLevelController> ZstdLevelController::Create() {
+  auto controller = std::make_shared<ZstdLevelController>(&PowerMonitor::IsOnBatteryPower);
+  // Pick up the current battery state before the first batch is created
+  controller->Update(0);
+  return controller;
+}
+
+ZstdLevelController::ZstdLevelController(std::function<bool()> on_battery_power_f)
+    : on_battery_power_f_(std::move(on_battery_power_f)) {}
+
+void ZstdLevelController::Update(double spool_usage) {
+  bool on_battery = on_battery_power_f_ && on_battery_power_f_();
+
+  absl::MutexLock lock(&mtx_);
+  if (spool_usage >= kPressureEnterUsage) {
+    under_pressure_ = true;
+  } else if (spool_usage < kPressureExitUsage) {
+    under_pressure_ = false;
+  }
+
+  int level = kDefaultLevel;
+  if (under_pressure_) {
+    level = kPressureLevel;
+  } else if (on_battery) {
+    level = kBatteryLevel;
+  }
+  level_.store(level, std::memory_order_relaxed);
+}
+
+std::shared_ptr<fsspool::ZstdOutputStream> ZstdLevelController::CreateStream(
+    google::protobuf::io::ZeroCopyOutputStream* raw_stream,
+    fsspool::ZstdOutputStream::Dictionary dictionary) {
+  std::unique_ptr<fsspool::ZstdOutputStream> stream = fsspool::ZstdOutputStream::Create(
+      raw_stream, Level(), fsspool::ZstdOutputStream::kDefaultBufferSize, std::move(dictionary));
+  if (!stream) {
+    return nullptr;
+  }
+
+  // The final frame is only written when the stream is destroyed, after which
+  // the raw stream's byte count is the compressed size of the batch. The raw
+  // stream is owned by the batcher and outlives the compressed stream.
+  std::weak_ptr<ZstdLevelController> weak_this = weak_from_this();
+  return std::shared_ptr<fsspool::ZstdOutputStream>(
+      stream.release(), [weak_this, raw_stream](fsspool::ZstdOutputStream* s) {
+        int64_t uncompressed_bytes = s->ByteCount();
+        delete s;
+        if (auto controller = weak_this.lock()) {
+          controller->RecordBatch(uncompressed_bytes, raw_stream->ByteCount());
+        }
+      });
+}
+
+void ZstdLevelController::RecordBatch(int64_t uncompressed_bytes, int64_t compressed_bytes) {
+  if (uncompressed_bytes <= 0 || compressed_bytes <= 0) {
+    return;
+  }
+
+  absl::MutexLock lock(&mtx_);
+  uncompressed_bytes_ += uncompressed_bytes;
+  compressed_bytes_ += compressed_bytes;
+}
+
+ZstdLevelController::Stats ZstdLevelController::GetStats(bool reset) {
+  absl::MutexLock lock(&mtx_);
+  Stats stats{
+      .level = Level(),
+      .compression_ratio =
+          compressed_bytes_ ? (double)uncompressed_bytes_ / (double)compressed_bytes_ : 0,
+  };
+  if (reset) {
+    uncompressed_bytes_ = 0;
+    compressed_bytes_ = 0;
+  }
+  return stats;
+}
+
+}  // namespace santa
@@ -0,0 +1,103 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/ZstdLevelController.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "zstd.h"
+
+using santa::ZstdLevelController;
+
+@interface ZstdLevelControllerTest : XCTestCase
+@end
+
+@implementation ZstdLevelControllerTest
+
+- (void)testLevelSelection {
+  bool onBattery = false;
+  auto sut = std::make_shared<ZstdLevelController>([&onBattery] {
+    return onBattery;
+  });
+
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kDefaultLevel);
+
+  onBattery = true;
+  sut->Update(0.1);
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kBatteryLevel);
+
+  // Spool pressure takes precedence over battery state
+  sut->Update(ZstdLevelController::kPressureEnterUsage);
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kPressureLevel);
+
+  onBattery = false;
+  sut->Update(0.1);
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kDefaultLevel);
+}
+
+- (void)testPressureHysteresis {
+  auto sut = std::make_shared<ZstdLevelController>(nullptr);
+
+  sut->Update(ZstdLevelController::kPressureExitUsage);
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kDefaultLevel);
+
+  sut->Update(ZstdLevelController::kPressureEnterUsage);
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kPressureLevel);
+
+  // Usage between the two thresholds keeps the current level
+  sut->Update(ZstdLevelController::kPressureExitUsage);
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kPressureLevel);
+
+  sut->Update(ZstdLevelController::kPressureExitUsage - 0.01);
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kDefaultLevel);
+
+  sut->Update(ZstdLevelController::kPressureEnterUsage - 0.01);
+  XCTAssertEqual(sut->Level(), ZstdLevelController::kDefaultLevel);
+}
+
+- (void)testCompressionRatio {
+  auto sut = std::make_shared<ZstdLevelController>(nullptr);
+
+  ZstdLevelController::Stats stats = sut->GetStats(false);
+  XCTAssertEqual(stats.level, ZstdLevelController::kDefaultLevel);
+  XCTAssertEqual(stats.compression_ratio, 0);
+
+  std::string compressed;
+  {
+    google::protobuf::io::StringOutputStream raw_stream(&compressed);
+    std::shared_ptr<fsspool::ZstdOutputStream> stream = sut->CreateStream(&raw_stream);
+    XCTAssertNotEqual(stream, nullptr);
+
+    void* buf;
+    int size;
+    XCTAssertTrue(stream->Next(&buf, &size));
+    memset(buf, 'A', size);
+    stream.reset();
+
+    // The batch is a valid frame and highly compressible
+    size_t frameSize = ZSTD_findFrameCompressedSize(compressed.data(), compressed.size());
+    XCTAssertFalse(ZSTD_isError(frameSize));
+    stats = sut->GetStats(true);
+    XCTAssertGreaterThan(stats.compression_ratio, 100);
+  }
+
+  XCTAssertEqual(sut->GetStats(false).compression_ratio, 0);
+}
+
+@end
@@ -24,7 +24,9 @@
 #include <memory>
 #include <string>
 
+#include "Source/common/LatencyHistogram.h"
 #import "Source/common/MOLXPCConnection.h"
+#include "Source/common/MetricSnapshot.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTMetricSet.h"
 #include "Source/common/es/ESMetricsObserver.h"
@@ -43,6 +45,8 @@ enum class FileAccessMetricStatus {
 using EventCountTuple = std::tuple<Processor, es_event_type_t, EventDisposition>;
 using EventTimesTuple = std::tuple<Processor, es_event_type_t>;
 using EventStatsTuple = std::tuple<Processor, es_event_type_t>;
+using AuthQueueTuple = std::tuple<Processor, uint32_t>;
+using AuthBudgetTuple = std::tuple<Processor, es_event_type_t, size_t>;
 using FileAccessMetricsPolicyVersion = std::string;
 using FileAccessMetricsPolicyName = std::string;
 using FileAccessEventCountTuple =
@@ -50,6 +54,7 @@ using FileAccessEventCountTuple =
                es_event_type_t, FileAccessPolicyDecision>;
 
 NSString* const EventTypeToString(es_event_type_t eventType);
+NSString* const LatencyStageToString(LatencyStage stage);
 
 class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Metrics> {
  public:
@@ -68,6 +73,10 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
   void StopPoll();
   void SetInterval(uint64_t interval);
 
+  // Publish the metric set to the shared memory snapshot region every
+  // `interval` seconds so that readers don't need an XPC round trip
+  void StartSnapshots(uint64_t interval);
+
   // Force an immediate flush and export of metrics
   void Export();
   void Export(void (^reply)(BOOL));
@@ -79,6 +88,14 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
   void SetEventMetrics(Processor processor, EventDisposition disposition, int64_t nanos,
                        es_event_type_t event_type) override;
 
+  // Tracks the maximum depth and wait time of each AUTH queue shard between exports
+  void SetAuthQueueMetrics(Processor processor, uint32_t shard, int64_t depth,
+                           int64_t wait_nanos) override;
+
+  // Buckets the time remaining before the deadline when AUTH messages are responded to
+  void SetAuthResponseBudget(Processor processor, es_event_type_t event_type,
+                             int64_t remaining_nanos) override;
+
   void AddRateLimitingMetrics(int64_t events_rate_limited_count);
 
   void SetFileAccessEventMetrics(std::string policy_version, std::string rule_name,
@@ -93,9 +110,21 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
     int64_t drops = 0;
   };
 
+  struct AuthQueueStats {
+    int64_t max_depth = 0;
+    int64_t max_wait_nanos = 0;
+  };
+
   void FlushMetrics();
+  void FlushStageLatencies();
+  void FlushPathInternPool();
+  void FlushNameCaches();
+  void FlushMessageStats();
+  void FlushCELProgramStats();
+  void FlushHotBinaries();
   void ExportSerialized(SNTMetricSet* metric_set);
   void ExportSerialized(SNTMetricSet* metric_set, void (^reply)(BOOL));
+  void PublishSnapshot();
 
   MOLXPCConnection* metrics_connection_;
   dispatch_queue_t q_;
@@ -106,7 +135,25 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
   SNTMetricCounter* rate_limit_counts_;
   SNTMetricCounter* faa_event_counts_;
   SNTMetricCounter* drop_counts_;
+  SNTMetricInt64Gauge* auth_queue_depth_;
+  SNTMetricInt64Gauge* auth_queue_wait_times_;
+  SNTMetricCounter* auth_response_budgets_;
+  SNTMetricInt64Gauge* stage_latencies_;
+  SNTMetricCounter* stage_latency_counts_;
+  SNTMetricInt64Gauge* path_intern_pool_size_;
+  SNTMetricCounter* path_intern_pool_lookups_;
+  SNTMetricCounter* name_cache_lookups_;
+  SNTMetricCounter* name_cache_slow_lookups_;
+  SNTMetricCounter* es_message_handles_;
+  SNTMetricCounter* es_message_state_pool_;
+  SNTMetricCounter* cel_program_cache_;
+  SNTMetricCounter* cel_times_;
+  SNTMetricInt64Gauge* hot_binary_times_;
+  SNTMetricInt64Gauge* hot_binary_evaluations_;
+  SNTMetricStringGauge* hot_binary_identities_;
   SNTMetricSet* metric_set_;
+  std::unique_ptr<MetricSnapshotWriter> snapshot_writer_;
+  dispatch_source_t snapshot_timer_source_ = nullptr;
   // Tracks whether or not the timer_source should be running.
   // This helps manage dispatch source state to ensure the source is not
   // suspended, resumed, or cancelled while in an improper state.
@@ -123,6 +170,8 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
   std::atomic<int64_t> rate_limit_counts_cache_;
   absl::flat_hash_map<FileAccessEventCountTuple, int64_t> faa_event_counts_cache_;
   absl::flat_hash_map<EventStatsTuple, SequenceStats> drop_cache_;
+  absl::flat_hash_map<AuthQueueTuple, AuthQueueStats> auth_queue_cache_;
+  absl::flat_hash_map<AuthBudgetTuple, int64_t> auth_response_budget_cache_;
 };
 
 }  // namespace santa
@@ -17,11 +17,20 @@
 
 #include <EndpointSecurity/ESTypes.h>
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
+#include "Source/common/HotBinaries.h"
+#include "Source/common/LatencyHistogram.h"
+#include "Source/common/MetricSnapshot.h"
+#include "Source/common/PathInternPool.h"
 #include "Source/common/Platform.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTXPCMetricServiceInterface.h"
+#include "Source/common/cel/ProgramCache.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/es/NameCache.h"
 #import "Source/santad/SNTApplicationCoreMetrics.h"
 
 static NSString* const kProcessorAuthorizer = @"Authorizer";
@@ -30,6 +39,7 @@ static NSString* const kProcessorRecorder = @"Recorder";
 static NSString* const kProcessorTamperResistance = @"TamperResistance";
 static NSString* const kProcessorDataFileAccessAuthorizer = @"DataFileAccessAuthorizer";
 static NSString* const kProcessorProcessFileAccessAuthorizer = @"ProcessFileAccessAuthorizer";
+static NSString* const kProcessorMultiplexer = @"Multiplexer";
 
 static NSString* const kEventTypeAuthClone = @"AuthClone";
 static NSString* const kEventTypeAuthCopyfile = @"AuthCopyfile";
@@ -103,6 +113,23 @@ static NSString* const kFileAccessPolicyDecisionAllowedAuditOnly = @"AllowedAudi
 
 static NSString* const kFileAccessMetricsAccessType = @"access";
 
+// Latency stages
+static NSString* const kLatencyStageEnrich = @"Enrich";
+static NSString* const kLatencyStageCacheCheck = @"CacheCheck";
+static NSString* const kLatencyStageRuleLookup = @"RuleLookup";
+static NSString* const kLatencyStageCELEvaluation = @"CELEvaluation";
+static NSString* const kLatencyStageHashing = @"Hashing";
+static NSString* const kLatencyStageRespond = @"Respond";
+
+// Remaining budget buckets for AUTH responses, indexed by AuthResponseBudgetBucket
+static NSString* const kAuthResponseBudgetBuckets[] = {
+    @"Expired", @"<10ms", @"<100ms", @"<1s", @"<5s", @"<30s", @">=30s",
+};
+
+// Size of the shared memory metric snapshot payload. Pages are only backed
+// once written, and a typical export is well under 1MB.
+static constexpr size_t kMetricSnapshotCapacity = 4 * 1024 * 1024;
+
 namespace santa {
 
 NSString* const ProcessorToString(Processor processor) {
@@ -113,6 +140,7 @@ NSString* const ProcessorToString(Processor processor) {
     case Processor::kTamperResistance: return kProcessorTamperResistance;
     case Processor::kDataFileAccessAuthorizer: return kProcessorDataFileAccessAuthorizer;
     case Processor::kProcessFileAccessAuthorizer: return kProcessorProcessFileAccessAuthorizer;
+    case Processor::kMultiplexer: return kProcessorMultiplexer;
     default:
       [NSException raise:@"Invalid processor"
                   format:@"Unknown processor value: %d", static_cast<int>(processor)];
@@ -189,6 +217,35 @@ NSString* const EventDispositionToString(EventDisposition d) {
   }
 }
 
+NSString* const LatencyStageToString(LatencyStage stage) {
+  switch (stage) {
+    case LatencyStage::kEnrich: return kLatencyStageEnrich;
+    case LatencyStage::kCacheCheck: return kLatencyStageCacheCheck;
+    case LatencyStage::kRuleLookup: return kLatencyStageRuleLookup;
+    case LatencyStage::kCELEvaluation: return kLatencyStageCELEvaluation;
+    case LatencyStage::kHashing: return kLatencyStageHashing;
+    case LatencyStage::kRespond: return kLatencyStageRespond;
+    default:
+      [NSException raise:@"Invalid latency stage"
+                  format:@"Unknown latency stage value: %d", static_cast<int>(stage)];
+      return nil;
+  }
+}
+
+size_t AuthResponseBudgetBucket(int64_t remaining_nanos) {
+  if (remaining_nanos <= 0) return 0;
+  if (remaining_nanos < 10 * NSEC_PER_MSEC) return 1;
+  if (remaining_nanos < 100 * NSEC_PER_MSEC) return 2;
+  if (remaining_nanos < 1 * NSEC_PER_SEC) return 3;
+  if (remaining_nanos < 5 * NSEC_PER_SEC) return 4;
+  if (remaining_nanos < 30 * NSEC_PER_SEC) return 5;
+  return 6;
+}
+
+NSString* const AuthResponseBudgetToString(int64_t remaining_nanos) {
+  return kAuthResponseBudgetBuckets[AuthResponseBudgetBucket(remaining_nanos)];
+}
+
 NSString* const FileAccessMetricStatusToString(FileAccessMetricStatus status) {
   switch (status) {
     case FileAccessMetricStatus::kOK: return kFileAccessMetricStatusOK;
@@ -286,11 +343,101 @@ Metrics::Metrics(dispatch_queue_t q, dispatch_source_t timer_source, uint64_t in
       rate_limit_counts_cache_(0) {
   SetInterval(interval_);
 
+  auth_queue_depth_ =
+      [metric_set_ int64GaugeWithName:@"/santa/auth_queue/max_depth"
+                           fieldNames:@[ @"Processor", @"Shard" ]
+                             helpText:@"Maximum number of queued AUTH messages on each shard"];
+
+  auth_queue_wait_times_ = [metric_set_
+      int64GaugeWithName:@"/santa/auth_queue/max_wait_time"
+              fieldNames:@[ @"Processor", @"Shard" ]
+                helpText:@"Maximum time in nanoseconds an AUTH message waited on each shard"];
+
+  auth_response_budgets_ = [metric_set_
+      counterWithName:@"/santa/auth_response_remaining_budget"
+           fieldNames:@[ @"Processor", @"Event", @"Budget" ]
+             helpText:@"Time remaining before the deadline when AUTH events were responded to"];
+
+  stage_latencies_ = [metric_set_
+      int64GaugeWithName:@"/santa/stage_latency"
+              fieldNames:@[ @"Event", @"Stage", @"Percentile" ]
+                helpText:@"Latency in nanoseconds of each event processing stage since the last "
+                         @"export"];
+
+  stage_latency_counts_ =
+      [metric_set_ counterWithName:@"/santa/stage_latency/count"
+                        fieldNames:@[ @"Event", @"Stage" ]
+                          helpText:@"Number of times each event processing stage was timed"];
+
+  path_intern_pool_size_ = [metric_set_
+      int64GaugeWithName:@"/santa/path_intern_pool/size"
+              fieldNames:@[]
+                helpText:@"Number of distinct paths currently held by the intern pool"];
+
+  path_intern_pool_lookups_ =
+      [metric_set_ counterWithName:@"/santa/path_intern_pool/lookups"
+                        fieldNames:@[ @"Result" ]
+                          helpText:@"Number of path intern pool lookups that hit or missed"];
+
+  name_cache_lookups_ =
+      [metric_set_ counterWithName:@"/santa/name_cache/lookups"
+                        fieldNames:@[ @"Cache", @"Result" ]
+                          helpText:@"Number of user and group name cache lookups by result"];
+
+  name_cache_slow_lookups_ = [metric_set_
+      counterWithName:@"/santa/name_cache/slow_lookups"
+           fieldNames:@[ @"Cache" ]
+             helpText:@"Number of user and group name lookups that blocked for over 10ms"];
+
+  es_message_handles_ = [metric_set_
+      counterWithName:@"/santa/es_message/handles"
+           fieldNames:@[ @"Type" ]
+             helpText:@"Number of ES message handles created, and copies that shared an existing "
+                      @"retain"];
+
+  es_message_state_pool_ =
+      [metric_set_ counterWithName:@"/santa/es_message/state_pool"
+                        fieldNames:@[ @"Result" ]
+                          helpText:@"Number of ES message states reused from or allocated "
+                                   @"outside of the free list"];
+
+  cel_program_cache_ =
+      [metric_set_ counterWithName:@"/santa/cel/program_cache"
+                        fieldNames:@[ @"Result" ]
+                          helpText:@"Number of CEL rule expressions found in or compiled into the "
+                                   @"program cache"];
+
+  cel_times_ = [metric_set_ counterWithName:@"/santa/cel/time"
+                                 fieldNames:@[ @"Stage" ]
+                                   helpText:@"Nanoseconds spent compiling and evaluating CEL rule "
+                                            @"expressions"];
+
+  hot_binary_times_ = [metric_set_
+      int64GaugeWithName:@"/santa/hot_binaries/evaluation_time"
+              fieldNames:@[ @"Rank", @"Stat" ]
+                helpText:@"Total and maximum nanoseconds spent evaluating the binaries with the "
+                         @"highest total evaluation cost since santad started"];
+
+  hot_binary_evaluations_ =
+      [metric_set_ int64GaugeWithName:@"/santa/hot_binaries/evaluations"
+                           fieldNames:@[ @"Rank" ]
+                             helpText:@"Number of evaluations of each ranked hot binary"];
+
+  hot_binary_identities_ = [metric_set_
+      stringGaugeWithName:@"/santa/hot_binaries/binary"
+               fieldNames:@[ @"Rank", @"Attribute" ]
+                 helpText:@"Cdhash (or path, when unsigned) and most recent path of each ranked "
+                          @"hot binary"];
+
   events_q_ = dispatch_queue_create("com.northpolesec.santa.santametricsservice.events_q",
                                     DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
 }
 
 Metrics::~Metrics() {
+  if (snapshot_timer_source_) {
+    dispatch_source_cancel(snapshot_timer_source_);
+  }
+
   // Drain pending async metric updates before destroying member state
   dispatch_sync(events_q_, ^{
                 });
@@ -338,7 +485,94 @@ void Metrics::ExportSerialized(SNTMetricSet* metric_set, void (^reply)(BOOL)) {
   [[metrics_connection_ remoteObjectProxy] exportForMonitoring:[metric_set export] reply:reply];
 }
 
+void Metrics::FlushStageLatencies() {
+  static const std::pair<double, NSString*> kPercentiles[] = {
+      {50, @"p50"}, {90, @"p90"}, {99, @"p99"}, {99.9, @"p99.9"},
+  };
+
+  StageLatencies::Shared().ForEach(
+      true, [this](LatencyStage stage, es_event_type_t event_type,
+                   const LatencyHistogram::Snapshot& snapshot) {
+        NSString* eventName = EventTypeToString(event_type);
+        NSString* stageName = LatencyStageToString(stage);
+
+        for (const auto& [percentile, percentileName] : kPercentiles) {
+          [stage_latencies_ set:snapshot.Percentile(percentile)
+                 forFieldValues:@[ eventName, stageName, percentileName ]];
+        }
+        [stage_latencies_ set:snapshot.max forFieldValues:@[ eventName, stageName, @"max" ]];
+        [stage_latency_counts_ incrementBy:snapshot.count forFieldValues:@[ eventName, stageName ]];
+      });
+}
+
+void Metrics::FlushPathInternPool() {
+  PathInternPool::Stats stats = PathInternPool::Shared().GetStats(true);
+  [path_intern_pool_size_ set:(long long)stats.size forFieldValues:@[]];
+  [path_intern_pool_lookups_ incrementBy:(long long)stats.hits forFieldValues:@[ @"Hit" ]];
+  [path_intern_pool_lookups_ incrementBy:(long long)stats.misses forFieldValues:@[ @"Miss" ]];
+}
+
+void Metrics::FlushNameCaches() {
+  auto flush = [this](NSString* cacheName, NameCache::Stats stats) {
+    [name_cache_lookups_ incrementBy:(long long)stats.hits
+                      forFieldValues:@[ cacheName, @"Hit" ]];
+    [name_cache_lookups_ incrementBy:(long long)stats.stale_hits
+                      forFieldValues:@[ cacheName, @"StaleHit" ]];
+    [name_cache_lookups_ incrementBy:(long long)stats.misses
+                      forFieldValues:@[ cacheName, @"Miss" ]];
+    [name_cache_slow_lookups_ incrementBy:(long long)stats.slow_lookups
+                           forFieldValues:@[ cacheName ]];
+  };
+  flush(@"User", NameCache::Usernames()->GetStats(true));
+  flush(@"Group", NameCache::Groupnames()->GetStats(true));
+}
+
+void Metrics::FlushMessageStats() {
+  Message::Stats stats = Message::GetStats(true);
+  [es_message_handles_ incrementBy:(long long)stats.messages forFieldValues:@[ @"Created" ]];
+  [es_message_handles_ incrementBy:(long long)stats.handle_copies forFieldValues:@[ @"Copied" ]];
+  [es_message_state_pool_ incrementBy:(long long)stats.pool_hits forFieldValues:@[ @"Hit" ]];
+  [es_message_state_pool_ incrementBy:(long long)stats.pool_misses forFieldValues:@[ @"Miss" ]];
+}
+
+void Metrics::FlushCELProgramStats() {
+  santa::cel::ProgramCache::Stats stats = santa::cel::ProgramCache::GetStats(true);
+  [cel_program_cache_ incrementBy:(long long)stats.hits forFieldValues:@[ @"Hit" ]];
+  [cel_program_cache_ incrementBy:(long long)stats.misses forFieldValues:@[ @"Miss" ]];
+  [cel_times_ incrementBy:(long long)stats.compile_nanos forFieldValues:@[ @"Compile" ]];
+  [cel_times_ incrementBy:(long long)stats.eval_nanos forFieldValues:@[ @"Evaluate" ]];
+}
+
+void Metrics::FlushHotBinaries() {
+  // Binaries are reported by rank rather than by identity to keep the number of exported
+  // field values fixed. Ranks that are not filled yet are cleared.
+  static constexpr size_t kHotBinaryRanks = 10;
+
+  std::vector<HotBinaries::Entry> top = HotBinaries::Shared().Top(kHotBinaryRanks);
+  for (size_t i = 0; i < kHotBinaryRanks; i++) {
+    NSString* rank = [NSString stringWithFormat:@"%zu", i + 1];
+    const HotBinaries::Entry* entry = i < top.size() ? &top[i] : nullptr;
+
+    [hot_binary_times_ set:entry ? (long long)entry->total_nanos : 0
+            forFieldValues:@[ rank, @"Total" ]];
+    [hot_binary_times_ set:entry ? (long long)entry->max_nanos : 0
+            forFieldValues:@[ rank, @"Max" ]];
+    [hot_binary_evaluations_ set:entry ? (long long)entry->count : 0 forFieldValues:@[ rank ]];
+    NSString* key = entry ? @(entry->key.c_str()) : nil;
+    NSString* path = entry ? @(entry->path.c_str()) : nil;
+    [hot_binary_identities_ set:key ?: @"" forFieldValues:@[ rank, @"Key" ]];
+    [hot_binary_identities_ set:path ?: @"" forFieldValues:@[ rank, @"Path" ]];
+  }
+}
+
 void Metrics::FlushMetrics() {
+  FlushStageLatencies();
+  FlushPathInternPool();
+  FlushNameCaches();
+  FlushMessageStats();
+  FlushCELProgramStats();
+  FlushHotBinaries();
+
   dispatch_sync(events_q_, ^{
     for (const auto& kv : event_counts_cache_) {
       NSString* processorName = ProcessorToString(std::get<Processor>(kv.first));
@@ -389,12 +623,33 @@ void Metrics::FlushMetrics() {
       }
     }
 
+    for (const auto& [key, stats] : auth_queue_cache_) {
+      NSArray* fieldValues = @[
+        ProcessorToString(std::get<Processor>(key)),
+        [NSString stringWithFormat:@"%u", std::get<uint32_t>(key)]
+      ];
+
+      [auth_queue_depth_ set:stats.max_depth forFieldValues:fieldValues];
+      [auth_queue_wait_times_ set:stats.max_wait_nanos forFieldValues:fieldValues];
+    }
+
+    for (const auto& [key, count] : auth_response_budget_cache_) {
+      [auth_response_budgets_ incrementBy:count
+                           forFieldValues:@[
+                             ProcessorToString(std::get<Processor>(key)),
+                             EventTypeToString(std::get<es_event_type_t>(key)),
+                             kAuthResponseBudgetBuckets[std::get<size_t>(key)]
+                           ]];
+    }
+
     // Reset the maps so the next cycle begins with a clean state
     // IMPORTANT: Do not reset drop_cache_, the sequence numbers must persist
     // for accurate accounting
     event_counts_cache_ = {};
     event_times_cache_ = {};
     faa_event_counts_cache_ = {};
+    auth_queue_cache_ = {};
+    auth_response_budget_cache_ = {};
   });
 }
 
@@ -424,6 +679,55 @@ void Metrics::StartPoll() {
   });
 }
 
+void Metrics::StartSnapshots(uint64_t interval) {
+  dispatch_sync(q_, ^{
+    if (snapshot_writer_) {
+      LOGW(@"Attempted to start metric snapshots while already started");
+      return;
+    }
+
+    snapshot_writer_ =
+        MetricSnapshotWriter::Create(kMetricSnapshotName, kMetricSnapshotCapacity,
+                                     interval * NSEC_PER_SEC);
+    if (!snapshot_writer_) {
+      LOGE(@"Failed to create the shared memory metric snapshot region: %s", strerror(errno));
+      return;
+    }
+
+    LOGI(@"Publishing metric snapshots every %llu seconds", interval);
+    snapshot_timer_source_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q_);
+    std::weak_ptr<Metrics> weak_metrics = weak_from_this();
+    dispatch_source_set_event_handler(snapshot_timer_source_, ^{
+      if (std::shared_ptr<Metrics> shared_metrics = weak_metrics.lock()) {
+        shared_metrics->PublishSnapshot();
+      }
+    });
+    dispatch_source_set_timer(snapshot_timer_source_, dispatch_time(DISPATCH_TIME_NOW, 0),
+                              interval * NSEC_PER_SEC, 100 * NSEC_PER_MSEC);
+    dispatch_resume(snapshot_timer_source_);
+  });
+}
+
+void Metrics::PublishSnapshot() {
+  // Unlike an export, publishing doesn't flush so that values reported "since
+  // the last export" keep their meaning
+  NSError* error;
+  NSData* data = [NSPropertyListSerialization dataWithPropertyList:[metric_set_ export]
+                                                            format:NSPropertyListBinaryFormat_v1_0
+                                                           options:0
+                                                             error:&error];
+  if (!data) {
+    LOGW(@"Failed to serialize metric snapshot: %@", error.localizedDescription);
+    return;
+  }
+
+  if (!snapshot_writer_->Publish(data.bytes, data.length,
+                                 (int64_t)clock_gettime_nsec_np(CLOCK_REALTIME))) {
+    LOGW(@"Metric snapshot of %lu bytes does not fit the shared memory region",
+         (unsigned long)data.length);
+  }
+}
+
 void Metrics::StopPoll() {
   dispatch_sync(q_, ^{
     if (running_) {
@@ -444,6 +748,23 @@ void Metrics::SetEventMetrics(Processor processor, EventDisposition disposition,
   });
 }
 
+void Metrics::SetAuthQueueMetrics(Processor processor, uint32_t shard, int64_t depth,
+                                  int64_t wait_nanos) {
+  dispatch_async(events_q_, ^{
+    AuthQueueStats& stats = auth_queue_cache_[AuthQueueTuple{processor, shard}];
+    stats.max_depth = std::max(stats.max_depth, depth);
+    stats.max_wait_nanos = std::max(stats.max_wait_nanos, wait_nanos);
+  });
+}
+
+void Metrics::SetAuthResponseBudget(Processor processor, es_event_type_t event_type,
+                                    int64_t remaining_nanos) {
+  dispatch_async(events_q_, ^{
+    auth_response_budget_cache_[AuthBudgetTuple{processor, event_type,
+                                                AuthResponseBudgetBucket(remaining_nanos)}]++;
+  });
+}
+
 void Metrics::UpdateEventStats(Processor processor, es_event_type_t event_type, uint64_t seq_num,
                                uint64_t global_seq_num) {
   dispatch_async(events_q_, ^{
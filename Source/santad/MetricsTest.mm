@@ -30,6 +30,8 @@
 #import "Source/common/SNTMetricSet.h"
 #include "Source/common/TestUtils.h"
 
+using santa::AuthBudgetTuple;
+using santa::AuthQueueTuple;
 using santa::EventCountTuple;
 using santa::EventDisposition;
 using santa::EventStatsTuple;
@@ -43,6 +45,8 @@ extern NSString* const ProcessorToString(Processor processor);
 extern NSString* const EventTypeToString(es_event_type_t eventType);
 extern NSString* const EventDispositionToString(EventDisposition d);
 extern NSString* const FileAccessMetricStatusToString(FileAccessMetricStatus status);
+extern size_t AuthResponseBudgetBucket(int64_t remaining_nanos);
+extern NSString* const AuthResponseBudgetToString(int64_t remaining_nanos);
 extern NSString* const FileAccessPolicyDecisionToString(FileAccessPolicyDecision decision);
 
 class MetricsPeer : public Metrics {
@@ -54,6 +58,8 @@ class MetricsPeer : public Metrics {
   using Metrics::FlushMetrics;
 
   // Private member variables
+  using Metrics::auth_queue_cache_;
+  using Metrics::auth_response_budget_cache_;
   using Metrics::drop_cache_;
   using Metrics::event_counts_cache_;
   using Metrics::event_times_cache_;
@@ -74,6 +80,8 @@ class MetricsPeer : public Metrics {
 
 }  // namespace santa
 
+using santa::AuthResponseBudgetBucket;
+using santa::AuthResponseBudgetToString;
 using santa::EventDispositionToString;
 using santa::EventTypeToString;
 using santa::FileAccessMetricStatus;
@@ -153,6 +161,7 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
       {Processor::kTamperResistance, @"TamperResistance"},
       {Processor::kDataFileAccessAuthorizer, @"DataFileAccessAuthorizer"},
       {Processor::kProcessFileAccessAuthorizer, @"ProcessFileAccessAuthorizer"},
+      {Processor::kMultiplexer, @"Multiplexer"},
   };
 
   for (const auto& kv : processorToString) {
@@ -332,6 +341,61 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
   XCTAssertEqual(metrics->rate_limit_counts_cache_.load(), 423);
 }
 
+- (void)testSetAuthQueueMetrics {
+  std::shared_ptr<MetricsPeer> metrics = CreateBasicMetricsPeer(self.q, ^(Metrics*){
+                                                                });
+
+  XCTAssertEqual(metrics->auth_queue_cache_.size(), 0);
+
+  metrics->SetAuthQueueMetrics(Processor::kAuthorizer, 0, 3, 1000);
+  metrics->SetAuthQueueMetrics(Processor::kAuthorizer, 0, 1, 5000);
+  metrics->SetAuthQueueMetrics(Processor::kAuthorizer, 1, 2, 10);
+  metrics->DrainEventQueue();
+
+  // Only the maximum values seen for each shard are kept
+  XCTAssertEqual(metrics->auth_queue_cache_.size(), 2);
+  XCTAssertEqual((metrics->auth_queue_cache_[AuthQueueTuple{Processor::kAuthorizer, 0}].max_depth),
+                 3);
+  XCTAssertEqual(
+      (metrics->auth_queue_cache_[AuthQueueTuple{Processor::kAuthorizer, 0}].max_wait_nanos), 5000);
+  XCTAssertEqual((metrics->auth_queue_cache_[AuthQueueTuple{Processor::kAuthorizer, 1}].max_depth),
+                 2);
+
+  // Flushing resets the cache
+  metrics->FlushMetrics();
+  XCTAssertEqual(metrics->auth_queue_cache_.size(), 0);
+}
+
+- (void)testSetAuthResponseBudget {
+  std::shared_ptr<MetricsPeer> metrics = CreateBasicMetricsPeer(self.q, ^(Metrics*){
+                                                                });
+
+  XCTAssertEqualObjects(AuthResponseBudgetToString(-5), @"Expired");
+  XCTAssertEqualObjects(AuthResponseBudgetToString(0), @"Expired");
+  XCTAssertEqualObjects(AuthResponseBudgetToString(5 * NSEC_PER_MSEC), @"<10ms");
+  XCTAssertEqualObjects(AuthResponseBudgetToString(50 * NSEC_PER_MSEC), @"<100ms");
+  XCTAssertEqualObjects(AuthResponseBudgetToString(500 * NSEC_PER_MSEC), @"<1s");
+  XCTAssertEqualObjects(AuthResponseBudgetToString(2 * NSEC_PER_SEC), @"<5s");
+  XCTAssertEqualObjects(AuthResponseBudgetToString(20 * NSEC_PER_SEC), @"<30s");
+  XCTAssertEqualObjects(AuthResponseBudgetToString(60 * NSEC_PER_SEC), @">=30s");
+
+  metrics->SetAuthResponseBudget(Processor::kAuthorizer, ES_EVENT_TYPE_AUTH_EXEC,
+                                 20 * NSEC_PER_SEC);
+  metrics->SetAuthResponseBudget(Processor::kAuthorizer, ES_EVENT_TYPE_AUTH_EXEC,
+                                 25 * NSEC_PER_SEC);
+  metrics->SetAuthResponseBudget(Processor::kAuthorizer, ES_EVENT_TYPE_AUTH_EXEC, -1);
+  metrics->DrainEventQueue();
+
+  XCTAssertEqual(metrics->auth_response_budget_cache_.size(), 2);
+  XCTAssertEqual((metrics->auth_response_budget_cache_[AuthBudgetTuple{
+                     Processor::kAuthorizer, ES_EVENT_TYPE_AUTH_EXEC,
+                     AuthResponseBudgetBucket(20 * NSEC_PER_SEC)}]),
+                 2);
+
+  metrics->FlushMetrics();
+  XCTAssertEqual(metrics->auth_response_budget_cache_.size(), 0);
+}
+
 - (void)testSetFileAccessEventMetrics {
   std::shared_ptr<MetricsPeer> metrics = CreateBasicMetricsPeer(self.q, ^(Metrics*){
                                                                 });
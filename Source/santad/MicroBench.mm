@@ -0,0 +1,439 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+/*
+
+Microbenchmarks for the data structures and stages on santad's hot paths,
+built on google-benchmark. Results can be written as JSON to compare commits:
+
+  bazel run -c opt //Source/santad:micro_bench -- \
+      --benchmark_out=/tmp/bench.json --benchmark_out_format=json
+
+  # Only run some of the benchmarks, repeating each to gauge the noise
+  bazel run -c opt //Source/santad:micro_bench -- \
+      --benchmark_filter='SantaCache|PrefixTree' --benchmark_repetitions=5
+
+Run with --help for the full list of google-benchmark flags. Inputs are built
+once per benchmark so that only the operation under test is timed.
+
+*/
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "Source/common/PrefixTree.h"
+#include "Source/common/RingBuffer.h"
+#include "Source/common/SantaCache.h"
+#include "Source/common/SantaSetCache.h"
+#include "Source/common/SantaVnode.h"
+#include "Source/common/TestUtils.h"
+#include "Source/common/cel/Activation.h"
+#include "Source/common/cel/CELProtoTraits.h"
+#include "Source/common/cel/Evaluator.h"
+#include "Source/common/es/EnrichedTypes.h"
+#include "Source/common/es/Enricher.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/es/MockEndpointSecurityAPI.h"
+#include "Source/common/processtree/process_tree_test_helpers.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/BasicString.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/SanitizableString.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
+#include "benchmark/benchmark.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/gzip_stream.h"
+
+using santa::Enricher;
+using santa::Message;
+using santa::RingBuffer;
+using santa::SanitizableString;
+using santa::SantaSetCache;
+using santa::cel::Activation;
+using santa::cel::CELProtoTraits;
+using santa::cel::Evaluator;
+using santa::santad::process_tree::Annotator;
+using santa::santad::process_tree::Cred;
+using santa::santad::process_tree::Pid;
+using santa::santad::process_tree::Process;
+using santa::santad::process_tree::ProcessTreeTestPeer;
+using santa::santad::process_tree::Program;
+
+static const uint32_t kSeed = 0xBEEFCAFE;
+
+// Number of distinct keys, below the default cache size like AuthResultCache
+static const uint64_t kCacheKeys = 8000;
+
+static std::vector<SantaVnode> MakeVnodes(uint64_t count) {
+  std::vector<SantaVnode> vnodes;
+  vnodes.reserve(count);
+  for (uint64_t i = 0; i < count; i++) {
+    vnodes.push_back(SantaVnode{.fsid = (dev_t)(16777220 + (i % 3)), .fileid = 1000 + i * 7});
+  }
+  return vnodes;
+}
+
+//
+// SantaCache
+//
+
+template <SantaCacheLayout Layout>
+using VnodeCache = SantaCache<SantaVnode, uint64_t, absl::Hash<SantaVnode>, Layout>;
+
+// Shared by all threads of a multithreaded run, so the caches must be
+// created before the benchmark starts
+template <SantaCacheLayout Layout>
+static VnodeCache<Layout>* SharedCache() {
+  static VnodeCache<Layout>* cache = [] {
+    auto* c = new VnodeCache<Layout>(10000);
+    uint64_t i = 0;
+    for (const SantaVnode& vnode : MakeVnodes(kCacheKeys)) {
+      c->set(vnode, ++i);
+    }
+    return c;
+  }();
+  return cache;
+}
+
+template <SantaCacheLayout Layout>
+static void BM_SantaCacheGet(benchmark::State& state) {
+  VnodeCache<Layout>* cache = SharedCache<Layout>();
+  std::vector<SantaVnode> keys = MakeVnodes(kCacheKeys);
+  std::mt19937_64 gen(kSeed + state.thread_index());
+  std::uniform_int_distribution<size_t> dist(0, keys.size() - 1);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cache->get(keys[dist(gen)]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SantaCacheGet<SantaCacheLayout::kChained>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_SantaCacheGet<SantaCacheLayout::kOpenAddressed>)->ThreadRange(1, 8)->UseRealTime();
+
+template <SantaCacheLayout Layout>
+static void BM_SantaCacheSet(benchmark::State& state) {
+  VnodeCache<Layout>* cache = SharedCache<Layout>();
+  std::vector<SantaVnode> keys = MakeVnodes(kCacheKeys);
+  std::mt19937_64 gen(kSeed + state.thread_index());
+  std::uniform_int_distribution<size_t> dist(0, keys.size() - 1);
+
+  uint64_t val = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cache->set(keys[dist(gen)], ++val));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SantaCacheSet<SantaCacheLayout::kChained>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_SantaCacheSet<SantaCacheLayout::kOpenAddressed>)->ThreadRange(1, 8)->UseRealTime();
+
+//
+// SantaSetCache
+//
+
+// Mirrors the per-process sets of watched paths that have already been
+// reported by file access authorization
+static void BM_SantaSetCache(benchmark::State& state) {
+  auto cache = SantaSetCache<uint64_t, std::string>::Create(1024, 256);
+  std::vector<std::string> paths;
+  for (int i = 0; i < 200; i++) {
+    paths.push_back("/Users/user/Library/Application Support/App/file-" + std::to_string(i));
+  }
+  std::mt19937_64 gen(kSeed);
+  std::uniform_int_distribution<uint64_t> keyDist(0, 511);
+  std::uniform_int_distribution<size_t> pathDist(0, paths.size() - 1);
+
+  for (auto _ : state) {
+    uint64_t key = keyDist(gen);
+    const std::string& path = paths[pathDist(gen)];
+    if (!cache->Contains(key, path)) {
+      cache->Set(key, path);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SantaSetCache);
+
+//
+// PrefixTree
+//
+
+template <santa::PrefixTreeLayout Layout>
+static void BM_PrefixTreeLookup(benchmark::State& state) {
+  santa::PrefixTree<uint32_t, Layout> tree;
+  std::vector<std::string> inputs;
+  for (uint32_t i = 0; i < 1000; i++) {
+    std::string prefix = "/Users/user" + std::to_string(i % 50) + "/Library/Watched" +
+                         std::to_string(i);
+    tree.InsertPrefix(prefix.c_str(), i);
+    inputs.push_back(prefix + "/Sub/Dir/file.txt");
+    inputs.push_back("/Users/user" + std::to_string(i % 50) + "/Documents/file" +
+                     std::to_string(i));
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tree.LookupLongestMatchingPrefix(inputs[i++ % inputs.size()]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PrefixTreeLookup<santa::PrefixTreeLayout::kByteTrie>);
+BENCHMARK(BM_PrefixTreeLookup<santa::PrefixTreeLayout::kRadix>);
+
+//
+// RingBuffer
+//
+
+static void BM_RingBufferEnqueue(benchmark::State& state) {
+  RingBuffer<std::string> ring((size_t)state.range(0));
+  std::string val(64, 'x');
+
+  // Once full, every enqueue also dequeues the oldest value
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ring.Enqueue(val));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingBufferEnqueue)->Arg(64)->Arg(4096);
+
+//
+// SanitizableString
+//
+
+static void BM_SanitizableString(benchmark::State& state) {
+  std::string path = "/Applications/Some App.app/Contents/MacOS/Some App";
+  if (state.range(0)) {
+    path += "|with\na newline";
+  }
+
+  for (auto _ : state) {
+    SanitizableString str(path.data(), path.size());
+    benchmark::DoNotOptimize(str.Sanitized());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * path.size());
+}
+BENCHMARK(BM_SanitizableString)->ArgName("dirty")->Arg(0)->Arg(1);
+
+//
+// Serializers
+//
+
+template <typename S>
+static void BM_SerializeClose(benchmark::State& state) {
+  es_file_t procFile = MakeESFile("/Applications/Some App.app/Contents/MacOS/Some App");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_file_t file = MakeESFile("/Users/user/Library/Application Support/App/state.db");
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  esMsg.event.close.modified = true;
+  esMsg.event.close.target = &file;
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+  std::shared_ptr<santa::Serializer> serializer = S::Create(mockESApi, nil);
+  std::unique_ptr<santa::EnrichedMessage> msg = Enricher().Enrich(Message(mockESApi, &esMsg));
+  const auto& close = std::get<santa::EnrichedClose>(msg->GetEnrichedMessage());
+
+  size_t bytes = 0;
+  for (auto _ : state) {
+    std::vector<uint8_t> out = serializer->SerializeMessage(close);
+    bytes += out.size();
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_SerializeClose<santa::BasicString>);
+BENCHMARK(BM_SerializeClose<santa::Protobuf>);
+
+//
+// StreamBatcher
+//
+
+template <typename B>
+static void RunStreamBatcher(benchmark::State& state, B& batcher) {
+  static constexpr int kRecordsPerBatch = 1000;
+
+  // Semi random printable bytes so that compressors have some work to do
+  std::mt19937 gen(kSeed);
+  std::uniform_int_distribution<int> byteDist(32, 126);
+  std::vector<std::vector<uint8_t>> records(64);
+  for (auto& record : records) {
+    record.resize(600);
+    for (auto& b : record) {
+      b = (uint8_t)byteDist(gen);
+    }
+  }
+
+  int fd = open("/dev/null", O_WRONLY);
+  if (fd < 0 || !batcher.InitializeBatch(fd).ok()) {
+    state.SkipWithError("Failed to initialize batch");
+    return;
+  }
+
+  int64_t written = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(batcher.Write(records[written % records.size()]));
+    if (++written % kRecordsPerBatch == 0) {
+      (void)batcher.CompleteBatch(fd);
+      (void)batcher.InitializeBatch(fd);
+    }
+  }
+  (void)batcher.CompleteBatch(fd);
+  close(fd);
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * records[0].size());
+}
+
+static void BM_StreamBatcherUncompressed(benchmark::State& state) {
+  ::fsspool::UncompressedStreamBatcher batcher;
+  RunStreamBatcher(state, batcher);
+}
+BENCHMARK(BM_StreamBatcherUncompressed);
+
+static void BM_StreamBatcherGzip(benchmark::State& state) {
+  ::fsspool::GzipStreamBatcher batcher(^(google::protobuf::io::ZeroCopyOutputStream* raw) {
+    return std::make_shared<google::protobuf::io::GzipOutputStream>(raw);
+  });
+  RunStreamBatcher(state, batcher);
+}
+BENCHMARK(BM_StreamBatcherGzip);
+
+static void BM_StreamBatcherZstd(benchmark::State& state) {
+  ::fsspool::ZstdStreamBatcher batcher(^(google::protobuf::io::ZeroCopyOutputStream* raw) {
+    return ::fsspool::ZstdOutputStream::Create(raw);
+  });
+  RunStreamBatcher(state, batcher);
+}
+BENCHMARK(BM_StreamBatcherZstd);
+
+//
+// CEL
+//
+
+static void BM_CELEvaluate(benchmark::State& state) {
+  using Traits = CELProtoTraits<true>;
+  auto evaluator = Evaluator<true>::Create();
+  if (!evaluator.ok()) {
+    state.SkipWithError("Failed to create evaluator");
+    return;
+  }
+
+  google::protobuf::Arena planArena;
+  auto plan = (*evaluator)->Compile(
+      "target.team_id == 'EQHXZ8M8AV' && "
+      "args.exists(a, a == '--inspect' || a.startsWith('--inspect='))",
+      &planArena);
+  if (!plan.ok()) {
+    state.SkipWithError("Failed to compile expression");
+    return;
+  }
+
+  std::vector<std::string> args = {"/usr/local/bin/node", "--max-old-space-size=4096",
+                                   "server.js", "--port", "8080"};
+  Activation<true> activation(
+      ^std::unique_ptr<Traits::ExecutableFileT>() {
+        auto f = std::make_unique<Traits::ExecutableFileT>();
+        f->set_signing_id("EQHXZ8M8AV:com.google.Chrome");
+        f->set_team_id("EQHXZ8M8AV");
+        return f;
+      },
+      ^std::vector<std::string>() {
+        return args;
+      },
+      ^std::map<std::string, std::string>() {
+        return {{"HOME", "/Users/user"}};
+      },
+      ^uid_t() {
+        return 501;
+      },
+      ^std::string() {
+        return "/Users/user/src/app";
+      },
+      ^std::string() {
+        return "/usr/local/bin/node";
+      },
+      ^std::vector<Traits::AncestorT>() {
+        return {};
+      },
+      ^std::vector<Traits::FileDescriptorT>() {
+        return {};
+      });
+
+  for (auto _ : state) {
+    google::protobuf::Arena arena;
+    benchmark::DoNotOptimize((*evaluator)->Evaluate(plan->get(), activation, &arena));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CELEvaluate);
+
+//
+// ProcessTree
+//
+
+// Each iteration is one short-lived process: fork, exec and exit
+static void BM_ProcessTreeForkExecExit(benchmark::State& state) {
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  std::shared_ptr<const Process> init = tree->InsertInit();
+  const Program prog = {.executable = "/usr/bin/clang", .arguments = {"clang", "-c", "foo.c"}};
+  const Cred cred = {.uid = 501, .gid = 20};
+
+  uint64_t timestamp = 1;
+  pid_t pid = 100;
+  for (auto _ : state) {
+    const struct Pid childPid = {.pid = pid, .pidversion = timestamp};
+    tree->HandleFork(timestamp++, *init, childPid);
+    std::shared_ptr<const Process> child = *tree->Get(childPid);
+
+    const struct Pid execPid = {.pid = pid, .pidversion = timestamp};
+    tree->HandleExec(timestamp++, *child, execPid, prog, cred);
+    tree->HandleExit(timestamp++, **tree->Get(execPid));
+
+    pid = pid < 99999 ? pid + 1 : 100;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProcessTreeForkExecExit);
+
+static void BM_ProcessTreeAncestors(benchmark::State& state) {
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  std::shared_ptr<const Process> proc = tree->InsertInit();
+
+  // A chain like launchd -> Terminal -> login -> zsh -> make -> sh -> clang
+  uint64_t timestamp = 1;
+  for (pid_t pid = 2; pid <= (pid_t)state.range(0); pid++) {
+    const struct Pid childPid = {.pid = pid, .pidversion = timestamp};
+    tree->HandleFork(timestamp++, *proc, childPid);
+    proc = *tree->Get(childPid);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tree->Ancestors(*proc));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProcessTreeAncestors)->Arg(8)->Arg(64);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,91 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_RECONFIGURATIONBATCHER_H
+#define SANTA_SANTAD_RECONFIGURATIONBATCHER_H
+
+#include <dispatch/dispatch.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Source/santad/EventProviders/AuthResultCache.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Collects the reactions to configuration changes that arrive close together,
+// e.g. from a single profile update, and applies them once the debounce
+// window passes. Reloads are run in the order they were first scheduled, then
+// the caches are flushed at most once no matter how many changes asked for it.
+class ReconfigurationBatcher
+    : public std::enable_shared_from_this<ReconfigurationBatcher> {
+ public:
+  using FlushCachesBlock = void (^)(FlushCacheReason reason);
+  using ClearAuthorizerCacheBlock = void (^)(void);
+
+  static std::shared_ptr<ReconfigurationBatcher> Create(
+      uint64_t debounce_ms, FlushCachesBlock flush_caches_block,
+      ClearAuthorizerCacheBlock clear_authorizer_cache_block);
+
+  ReconfigurationBatcher(
+      dispatch_queue_t q, uint64_t debounce_ms,
+      FlushCachesBlock flush_caches_block,
+      ClearAuthorizerCacheBlock clear_authorizer_cache_block);
+
+  // No moves, no copies
+  ReconfigurationBatcher(ReconfigurationBatcher&& other) = delete;
+  ReconfigurationBatcher& operator=(ReconfigurationBatcher&& rhs) = delete;
+  ReconfigurationBatcher(const ReconfigurationBatcher& other) = delete;
+  ReconfigurationBatcher& operator=(const ReconfigurationBatcher& other) =
+      delete;
+
+  // Run `reload` when the batch is applied. Scheduling another reload with the
+  // same key before then replaces the earlier one.
+  void ScheduleReload(std::string key, void (^reload)(void));
+
+  // Flush all caches when the batch is applied. If any request in the batch
+  // sets `clear_authorizer_cache`, the authorizer's ES cache is also cleared.
+  void RequestCacheFlush(FlushCacheReason reason,
+                         bool clear_authorizer_cache = false);
+
+  // Apply any pending changes immediately instead of waiting out the window.
+  void ApplyNow();
+
+  friend class ReconfigurationBatcherPeer;
+
+ private:
+  void ScheduleApplyLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  dispatch_queue_t q_;
+  uint64_t debounce_ms_;
+  FlushCachesBlock flush_caches_block_;
+  ClearAuthorizerCacheBlock clear_authorizer_cache_block_;
+
+  absl::Mutex lock_;
+  std::vector<std::pair<std::string, void (^)(void)>> reloads_
+      ABSL_GUARDED_BY(lock_);
+  size_t flush_requests_ ABSL_GUARDED_BY(lock_) = 0;
+  std::optional<FlushCacheReason> first_flush_reason_ ABSL_GUARDED_BY(lock_);
+  bool clear_authorizer_cache_ ABSL_GUARDED_BY(lock_) = false;
+  bool apply_scheduled_ ABSL_GUARDED_BY(lock_) = false;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_RECONFIGURATIONBATCHER_H
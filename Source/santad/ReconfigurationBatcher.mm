@@ -0,0 +1,110 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/ReconfigurationBatcher.h"
+
+#include <algorithm>
+
+#import "Source/common/SNTLogging.h"
+
+namespace santa {
+
+std::shared_ptr<ReconfigurationBatcher> ReconfigurationBatcher::Create(
+    uint64_t debounce_ms, FlushCachesBlock flush_caches_block,
+    ClearAuthorizerCacheBlock clear_authorizer_cache_block) {
+  dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.reconfiguration",
+                                             DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+  return std::make_shared<ReconfigurationBatcher>(q, debounce_ms, flush_caches_block,
+                                                  clear_authorizer_cache_block);
+}
+
+ReconfigurationBatcher::ReconfigurationBatcher(
+    dispatch_queue_t q, uint64_t debounce_ms, FlushCachesBlock flush_caches_block,
+    ClearAuthorizerCacheBlock clear_authorizer_cache_block)
+    : q_(q),
+      debounce_ms_(debounce_ms),
+      flush_caches_block_(flush_caches_block),
+      clear_authorizer_cache_block_(clear_authorizer_cache_block) {}
+
+void ReconfigurationBatcher::ScheduleReload(std::string key, void (^reload)(void)) {
+  absl::MutexLock lock(&lock_);
+  auto it = std::find_if(reloads_.begin(), reloads_.end(),
+                         [&key](const auto& pending) { return pending.first == key; });
+  if (it != reloads_.end()) {
+    it->second = reload;
+  } else {
+    reloads_.emplace_back(std::move(key), reload);
+  }
+  ScheduleApplyLocked();
+}
+
+void ReconfigurationBatcher::RequestCacheFlush(FlushCacheReason reason,
+                                               bool clear_authorizer_cache) {
+  absl::MutexLock lock(&lock_);
+  if (!first_flush_reason_.has_value()) {
+    first_flush_reason_ = reason;
+  }
+  flush_requests_++;
+  clear_authorizer_cache_ |= clear_authorizer_cache;
+  ScheduleApplyLocked();
+}
+
+void ReconfigurationBatcher::ScheduleApplyLocked() {
+  if (apply_scheduled_) {
+    return;
+  }
+  apply_scheduled_ = true;
+
+  std::weak_ptr<ReconfigurationBatcher> weak_self = weak_from_this();
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, debounce_ms_ * NSEC_PER_MSEC), q_, ^{
+    if (auto shared_self = weak_self.lock()) {
+      shared_self->ApplyNow();
+    }
+  });
+}
+
+void ReconfigurationBatcher::ApplyNow() {
+  std::vector<std::pair<std::string, void (^)(void)>> reloads;
+  std::optional<FlushCacheReason> flush_reason;
+  size_t flush_requests;
+  bool clear_authorizer_cache;
+  {
+    absl::MutexLock lock(&lock_);
+    std::swap(reloads, reloads_);
+    flush_reason = std::exchange(first_flush_reason_, std::nullopt);
+    flush_requests = std::exchange(flush_requests_, 0);
+    clear_authorizer_cache = std::exchange(clear_authorizer_cache_, false);
+    apply_scheduled_ = false;
+  }
+
+  // Reloads happen before the flush so that no decisions made with the old
+  // configuration are cached again after it
+  for (const auto& [key, reload] : reloads) {
+    reload();
+  }
+
+  if (flush_reason.has_value()) {
+    if (flush_requests > 1) {
+      LOGI(@"Coalesced %zu configuration changes into a single cache flush", flush_requests);
+    }
+    flush_caches_block_(*flush_reason);
+  }
+
+  if (clear_authorizer_cache && clear_authorizer_cache_block_) {
+    clear_authorizer_cache_block_();
+  }
+}
+
+}  // namespace santa
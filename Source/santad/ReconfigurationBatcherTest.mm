@@ -0,0 +1,122 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/ReconfigurationBatcher.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+
+#include "Source/santad/EventProviders/AuthResultCache.h"
+
+using santa::FlushCacheReason;
+using santa::ReconfigurationBatcher;
+
+@interface ReconfigurationBatcherTest : XCTestCase
+@end
+
+@implementation ReconfigurationBatcherTest
+
+- (void)testCoalescedFlush {
+  __block int flushCount = 0;
+  __block FlushCacheReason flushReason;
+  __block int clearCount = 0;
+  NSMutableArray<NSString*>* order = [NSMutableArray array];
+
+  // Long enough that only ApplyNow applies the batch
+  auto sut = ReconfigurationBatcher::Create(
+      60 * 1000,
+      ^(FlushCacheReason reason) {
+        [order addObject:@"flush"];
+        flushReason = reason;
+        flushCount++;
+      },
+      ^{
+        clearCount++;
+      });
+
+  sut->ScheduleReload("a", ^{
+    [order addObject:@"a1"];
+  });
+  sut->RequestCacheFlush(FlushCacheReason::kClientModeChanged);
+  sut->ScheduleReload("b", ^{
+    [order addObject:@"b"];
+  });
+  sut->RequestCacheFlush(FlushCacheReason::kPathRegexChanged);
+
+  // Replaces the earlier reload but keeps its position
+  sut->ScheduleReload("a", ^{
+    [order addObject:@"a2"];
+  });
+
+  sut->ApplyNow();
+
+  XCTAssertEqual(flushCount, 1);
+  XCTAssertEqual(flushReason, FlushCacheReason::kClientModeChanged);
+  XCTAssertEqual(clearCount, 0);
+  XCTAssertEqualObjects(order, (@[ @"a2", @"b", @"flush" ]));
+
+  // Nothing is left pending
+  sut->ApplyNow();
+  XCTAssertEqual(flushCount, 1);
+}
+
+- (void)testClearAuthorizerCache {
+  __block int flushCount = 0;
+  __block int clearCount = 0;
+  auto sut = ReconfigurationBatcher::Create(
+      60 * 1000,
+      ^(FlushCacheReason reason) {
+        flushCount++;
+      },
+      ^{
+        clearCount++;
+      });
+
+  sut->RequestCacheFlush(FlushCacheReason::kEntitlementsTeamIDFilterChanged, true);
+  sut->RequestCacheFlush(FlushCacheReason::kEntitlementsPrefixFilterChanged, true);
+  sut->RequestCacheFlush(FlushCacheReason::kStaticRulesChanged);
+  sut->ApplyNow();
+
+  XCTAssertEqual(flushCount, 1);
+  XCTAssertEqual(clearCount, 1);
+}
+
+- (void)testAppliedAfterDebounce {
+  XCTestExpectation* expect = [self expectationWithDescription:@"Batch applied"];
+  __block int flushCount = 0;
+  __block bool reloaded = false;
+
+  auto sut = ReconfigurationBatcher::Create(
+      50,
+      ^(FlushCacheReason reason) {
+        flushCount++;
+        [expect fulfill];
+      },
+      nil);
+
+  sut->ScheduleReload("a", ^{
+    reloaded = true;
+  });
+  sut->RequestCacheFlush(FlushCacheReason::kStaticRulesChanged);
+  sut->RequestCacheFlush(FlushCacheReason::kPathRegexChanged);
+
+  [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+  XCTAssertTrue(reloaded);
+  XCTAssertEqual(flushCount, 1);
+}
+
+@end
@@ -19,10 +19,14 @@
 #include <mach/mach.h>
 #include <sys/resource.h>
 
+#include "Source/common/BackgroundScheduler.h"
+#include "Source/common/MemoryAccounting.h"
+#include "Source/common/ReadBufferPool.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTSystemInfo.h"
+#include "Source/common/SelfProfiler.h"
 #import "Source/common/SystemResources.h"
 
 /**
@@ -68,6 +72,9 @@ static void RegisterEventLogType(SNTMetricSet* metricSet) {
       case SNTEventLogTypeProtobufStreamZstd:
         [logType set:@"protobufstreamzstd" forFieldValues:@[]];
         break;
+      case SNTEventLogTypeProtobufColumnar:
+        [logType set:@"protobufcolumnar" forFieldValues:@[]];
+        break;
       case SNTEventLogTypeSyslog: [logType set:@"syslog" forFieldValues:@[]]; break;
       case SNTEventLogTypeNull: [logType set:@"null" forFieldValues:@[]]; break;
       case SNTEventLogTypeFilelog: [logType set:@"file" forFieldValues:@[]]; break;
@@ -115,6 +122,103 @@ static void RegisterMemoryAndCPUMetrics(SNTMetricSet* metricSet) {
   }];
 }
 
+static void RegisterSelfProfileMetrics(SNTMetricSet* metricSet) {
+  SNTMetricDoubleGauge* cpuUsageBySubsystem = [metricSet
+      doubleGaugeWithName:@"/proc/cpu_usage_by_subsystem"
+               fieldNames:@[ @"subsystem", @"mode" ]  // mode is "user" or "system"
+                 helpText:@"Sampled CPU time consumed by each part of this process, in seconds"];
+
+  SNTMetricInt64Gauge* wakeups =
+      [metricSet int64GaugeWithName:@"/proc/wakeups"
+                         fieldNames:@[ @"type" ]  // "interrupt" or "idle"
+                           helpText:@"Wakeups caused by this process"];
+
+  [metricSet registerCallback:^(void) {
+    for (const auto& [subsystem, cpu] : santa::SelfProfiler::Shared().CPUTimeBySubsystem()) {
+      NSString* name = @(subsystem.c_str());
+      [cpuUsageBySubsystem set:cpu.user_nanos / (double)NSEC_PER_SEC
+                forFieldValues:@[ name, @"user" ]];
+      [cpuUsageBySubsystem set:cpu.system_nanos / (double)NSEC_PER_SEC
+                forFieldValues:@[ name, @"system" ]];
+    }
+
+    santa::SelfProfiler::Wakeups counts = santa::SelfProfiler::GetWakeups();
+    [wakeups set:(long long)counts.interrupt forFieldValues:@[ @"interrupt" ]];
+    [wakeups set:(long long)counts.platform_idle forFieldValues:@[ @"idle" ]];
+  }];
+}
+
+static void RegisterMemoryMetrics(SNTMetricSet* metricSet) {
+  SNTMetricInt64Gauge* bytesByStructure =
+      [metricSet int64GaugeWithName:@"/proc/memory/by_structure"
+                         fieldNames:@[ @"structure" ]
+                           helpText:@"Approximate bytes used by each large structure in santad"];
+
+  SNTMetricCounter* pressureEvents =
+      [metricSet counterWithName:@"/proc/memory/pressure_events"
+                      fieldNames:@[ @"level" ]  // "warning" or "critical"
+                        helpText:@"Memory pressure events handled by shrinking caches"];
+
+  [metricSet registerCallback:^(void) {
+    for (const auto& [structure, bytes] : santa::MemoryAccounting::Shared().Usage()) {
+      [bytesByStructure set:(long long)bytes forFieldValues:@[ @(structure.c_str()) ]];
+    }
+
+    santa::MemoryAccounting::Stats stats = santa::MemoryAccounting::Shared().GetStats(true);
+    [pressureEvents incrementBy:(long long)stats.warning_events forFieldValues:@[ @"warning" ]];
+    [pressureEvents incrementBy:(long long)stats.critical_events forFieldValues:@[ @"critical" ]];
+  }];
+}
+
+static void RegisterBackgroundSchedulerMetrics(SNTMetricSet* metricSet) {
+  SNTMetricCounter* jobCounts =
+      [metricSet counterWithName:@"/santa/background_jobs/count"
+                      fieldNames:@[ @"job", @"outcome" ]  // "deferred", "coalesced" or "forced"
+                        helpText:@"Background job submissions held until conditions improved"];
+
+  SNTMetricInt64Gauge* pendingJobs =
+      [metricSet int64GaugeWithName:@"/santa/background_jobs/pending"
+                         fieldNames:@[ @"job" ]
+                           helpText:@"Whether each background job is currently deferred"];
+
+  [metricSet registerCallback:^(void) {
+    for (const auto& [job, stats] : santa::BackgroundScheduler::Shared().GetStats(true)) {
+      NSString* name = @(job.c_str());
+      [jobCounts incrementBy:(long long)stats.deferred forFieldValues:@[ name, @"deferred" ]];
+      [jobCounts incrementBy:(long long)stats.coalesced forFieldValues:@[ name, @"coalesced" ]];
+      [jobCounts incrementBy:(long long)stats.forced forFieldValues:@[ name, @"forced" ]];
+      [pendingJobs set:stats.pending ? 1 : 0 forFieldValues:@[ name ]];
+    }
+  }];
+}
+
+static void RegisterReadBufferPoolMetrics(SNTMetricSet* metricSet) {
+  SNTMetricCounter* requests =
+      [metricSet counterWithName:@"/santa/read_buffer_pool/requests"
+                      fieldNames:@[ @"result" ]  // "hit" or "miss"
+                        helpText:@"File read buffers served from the pool or newly allocated"];
+
+  SNTMetricDoubleGauge* hitRate =
+      [metricSet doubleGaugeWithName:@"/santa/read_buffer_pool/hit_rate"
+                          fieldNames:@[]
+                            helpText:@"Fraction of file read buffers served from the pool since "
+                                     @"the last export"];
+
+  SNTMetricInt64Gauge* peakBytes =
+      [metricSet int64GaugeWithName:@"/santa/read_buffer_pool/peak_bytes"
+                         fieldNames:@[]
+                           helpText:@"Most bytes held by file read buffers since the last export"];
+
+  [metricSet registerCallback:^(void) {
+    santa::ReadBufferPool::Stats stats = santa::ReadBufferPool::GetStats(true);
+    [requests incrementBy:(long long)stats.hits forFieldValues:@[ @"hit" ]];
+    [requests incrementBy:(long long)stats.misses forFieldValues:@[ @"miss" ]];
+    uint64_t total = stats.hits + stats.misses;
+    [hitRate set:total ? (double)stats.hits / total : 0.0 forFieldValues:@[]];
+    [peakBytes set:(long long)stats.peak_bytes forFieldValues:@[]];
+  }];
+}
+
 static void RegisterHostnameAndUsernameLabels(SNTMetricSet* metricSet) {
   NSString* hostname = [NSProcessInfo processInfo].hostName;
 
@@ -170,5 +274,9 @@ void SNTRegisterCoreMetrics() {
   SNTMetricSet* metricSet = [SNTMetricSet sharedInstance];
   RegisterHostnameAndUsernameLabels(metricSet);
   RegisterMemoryAndCPUMetrics(metricSet);
+  RegisterSelfProfileMetrics(metricSet);
+  RegisterMemoryMetrics(metricSet);
+  RegisterBackgroundSchedulerMetrics(metricSet);
+  RegisterReadBufferPoolMetrics(metricSet);
   RegisterCommonSantaMetrics(metricSet);
 }
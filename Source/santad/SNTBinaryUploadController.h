@@ -18,45 +18,100 @@
 #include <dispatch/dispatch.h>
 
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "Source/santad/SleighLauncher.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "commands/v1.pb.h"
 
 namespace santa {
 
-// Drives a single binary upload: opens the requested file (as root)
-// regular-file only, computes BinaryMetadata from that same FD, reads the
-// upload filter expressions, and launches Sleigh to perform the upload. The CEL
-// filter itself runs in Sleigh — this controller only computes and forwards
-// inputs.
+// Drives binary uploads: opens the requested file (as root) regular-file
+// only, computes BinaryMetadata from that same FD, reads the upload filter
+// expressions, and launches Sleigh to perform the upload. The CEL filter
+// itself runs in Sleigh — this controller only computes and forwards inputs.
+//
+// Requests are queued. Requests for a SHA-256 that is already queued or
+// uploading share that upload's response, and a hash that uploaded recently
+// is not uploaded again. Several uploads run at once, bounded by a count and
+// by the total size of the files being uploaded.
 class SNTBinaryUploadController {
  public:
+  using Reply = void (^)(const ::santa::commands::v1::BinaryUploadResponse&);
+
+  static constexpr size_t kDefaultMaxConcurrentUploads = 3;
+  // A new upload only starts while the files already uploading total less
+  // than this, unless nothing is uploading. Sleigh does the network I/O, so
+  // this bounds bandwidth by limiting how much is in flight.
+  static constexpr uint64_t kDefaultMaxBytesInFlight = 256ull * 1024 * 1024;
+  // How long a completed upload is remembered for deduplication
+  static constexpr absl::Duration kCompletedUploadTTL = absl::Minutes(30);
+
   // launcher performs the Sleigh launch; timeout_seconds bounds it by
   // SIGKILLing the child on expiry. It must exceed Sleigh's own 5-min upload
   // deadline (callers pass 6 min) so Sleigh hits its deadline first and returns
   // a real response instead of being killed mid-upload.
-  SNTBinaryUploadController(std::unique_ptr<SleighLauncher> launcher,
-                            uint32_t timeout_seconds);
+  SNTBinaryUploadController(
+      std::unique_ptr<SleighLauncher> launcher, uint32_t timeout_seconds,
+      size_t max_concurrent_uploads = kDefaultMaxConcurrentUploads,
+      uint64_t max_bytes_in_flight = kDefaultMaxBytesInFlight,
+      std::function<absl::Time()> now = absl::Now);
   virtual ~SNTBinaryUploadController() = default;
 
   SNTBinaryUploadController(const SNTBinaryUploadController&) = delete;
   SNTBinaryUploadController& operator=(const SNTBinaryUploadController&) =
       delete;
 
-  // Handles one request and always returns a populated response (failures map
-  // to a disposition; never throws). Launches are serialized (K=1).
+  // Queues one request. `reply` is called exactly once, on an arbitrary
+  // queue, with a populated response (failures map to a disposition; never
+  // throws). The controller must outlive every queued request.
+  virtual void Enqueue(
+      const ::santa::commands::v1::BinaryUploadRequest& request, Reply reply);
+
+  // Queues one request and waits for its response.
   virtual ::santa::commands::v1::BinaryUploadResponse Handle(
       const ::santa::commands::v1::BinaryUploadRequest& request);
 
  private:
-  // Runs on serial_queue_ (one upload at a time).
-  ::santa::commands::v1::BinaryUploadResponse HandleSerial(
+  struct Upload {
+    ::santa::commands::v1::BinaryUploadRequest request;
+    // Size of the file when queued, counted against max_bytes_in_flight_
+    uint64_t size;
+    std::vector<Reply> replies;
+  };
+
+  // Starts queued uploads while the limits allow
+  void StartReadyLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void Run(std::shared_ptr<Upload> upload);
+
+  // Runs on upload_queue_, possibly alongside other uploads.
+  ::santa::commands::v1::BinaryUploadResponse HandleOne(
       const ::santa::commands::v1::BinaryUploadRequest& request);
 
   std::unique_ptr<SleighLauncher> launcher_;
   uint32_t timeout_seconds_;
-  dispatch_queue_t serial_queue_;
+  size_t max_concurrent_uploads_;
+  uint64_t max_bytes_in_flight_;
+  std::function<absl::Time()> now_;
+  dispatch_queue_t upload_queue_;
+
+  absl::Mutex mu_;
+  std::deque<std::shared_ptr<Upload>> pending_ ABSL_GUARDED_BY(mu_);
+  // Queued and running uploads by SHA-256
+  absl::flat_hash_map<std::string, std::shared_ptr<Upload>> by_sha256_
+      ABSL_GUARDED_BY(mu_);
+  // When each recently completed SHA-256 finished uploading
+  absl::flat_hash_map<std::string, absl::Time> completed_ ABSL_GUARDED_BY(mu_);
+  size_t running_ ABSL_GUARDED_BY(mu_) = 0;
+  uint64_t bytes_in_flight_ ABSL_GUARDED_BY(mu_) = 0;
 };
 
 }  // namespace santa
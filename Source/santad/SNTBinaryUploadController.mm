@@ -24,8 +24,10 @@
 #import <Foundation/Foundation.h>
 #import <Security/Security.h>
 
+#include <algorithm>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/cleanup/cleanup.h"
@@ -130,23 +132,111 @@ std::string MachoTypeFromFD(int fd) {
 }  // namespace
 
 SNTBinaryUploadController::SNTBinaryUploadController(std::unique_ptr<SleighLauncher> launcher,
-                                                     uint32_t timeout_seconds)
-    : launcher_(std::move(launcher)), timeout_seconds_(timeout_seconds) {
-  serial_queue_ = dispatch_queue_create("com.northpolesec.santa.binaryupload",
-                                        DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+                                                     uint32_t timeout_seconds,
+                                                     size_t max_concurrent_uploads,
+                                                     uint64_t max_bytes_in_flight,
+                                                     std::function<absl::Time()> now)
+    : launcher_(std::move(launcher)),
+      timeout_seconds_(timeout_seconds),
+      max_concurrent_uploads_(std::max<size_t>(max_concurrent_uploads, 1)),
+      max_bytes_in_flight_(max_bytes_in_flight),
+      now_(std::move(now)) {
+  upload_queue_ = dispatch_queue_create("com.northpolesec.santa.binaryupload",
+                                        DISPATCH_QUEUE_CONCURRENT_WITH_AUTORELEASE_POOL);
 }
 
 pbv1::BinaryUploadResponse SNTBinaryUploadController::Handle(
     const pbv1::BinaryUploadRequest& request) {
-  const pbv1::BinaryUploadRequest* req = &request;
   __block pbv1::BinaryUploadResponse response;
-  dispatch_sync(serial_queue_, ^{
-    response = this->HandleSerial(*req);
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  Enqueue(request, ^(const pbv1::BinaryUploadResponse& r) {
+    response = r;
+    dispatch_semaphore_signal(sema);
   });
+  dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER);
   return response;
 }
 
-pbv1::BinaryUploadResponse SNTBinaryUploadController::HandleSerial(
+void SNTBinaryUploadController::Enqueue(const pbv1::BinaryUploadRequest& request, Reply reply) {
+  // The size only orders the byte budget, so a stale or failed stat is fine
+  // here. HandleOne re-checks the file from its own fd.
+  struct stat st;
+  uint64_t size = (stat(request.path().c_str(), &st) == 0 && st.st_size > 0) ? st.st_size : 0;
+
+  absl::MutexLock lock(&mu_);
+  if (!request.sha256().empty()) {
+    if (auto it = completed_.find(request.sha256()); it != completed_.end()) {
+      if (now_() - it->second < kCompletedUploadTTL) {
+        reply(MakeResponse(pbv1::BinaryUploadResponse::DISPOSITION_COMPLETED,
+                           "already uploaded"));
+        return;
+      }
+      completed_.erase(it);
+    }
+
+    if (auto it = by_sha256_.find(request.sha256()); it != by_sha256_.end()) {
+      it->second->replies.push_back(reply);
+      return;
+    }
+  }
+
+  auto upload = std::make_shared<Upload>(Upload{request, size, {reply}});
+  if (!request.sha256().empty()) {
+    by_sha256_[request.sha256()] = upload;
+  }
+  pending_.push_back(std::move(upload));
+  StartReadyLocked();
+}
+
+void SNTBinaryUploadController::StartReadyLocked() {
+  // Uploads start in FIFO order so a large file at the head is not starved by
+  // smaller ones behind it. Anything may start when nothing is running, so a
+  // file larger than the whole budget still uploads.
+  while (!pending_.empty() && running_ < max_concurrent_uploads_) {
+    std::shared_ptr<Upload> upload = pending_.front();
+    if (running_ > 0 && bytes_in_flight_ + upload->size > max_bytes_in_flight_) {
+      break;
+    }
+    pending_.pop_front();
+    running_++;
+    bytes_in_flight_ += upload->size;
+    dispatch_async(upload_queue_, ^{
+      this->Run(upload);
+    });
+  }
+}
+
+void SNTBinaryUploadController::Run(std::shared_ptr<Upload> upload) {
+  pbv1::BinaryUploadResponse response = HandleOne(upload->request);
+
+  std::vector<Reply> replies;
+  {
+    absl::MutexLock lock(&mu_);
+    running_--;
+    bytes_in_flight_ -= upload->size;
+    replies = std::move(upload->replies);
+
+    const std::string& sha256 = upload->request.sha256();
+    if (!sha256.empty()) {
+      by_sha256_.erase(sha256);
+      if (response.disposition() == pbv1::BinaryUploadResponse::DISPOSITION_COMPLETED) {
+        absl::Time now = now_();
+        absl::erase_if(completed_, [now](const auto& entry) {
+          return now - entry.second >= kCompletedUploadTTL;
+        });
+        completed_[sha256] = now;
+      }
+    }
+    StartReadyLocked();
+  }
+
+  // Replies may block (e.g. Handle's semaphore) so they are sent unlocked
+  for (Reply reply : replies) {
+    reply(response);
+  }
+}
+
+pbv1::BinaryUploadResponse SNTBinaryUploadController::HandleOne(
     const pbv1::BinaryUploadRequest& request) {
   // C4: open once, regular-file only, non-blocking, NOT O_CLOEXEC (the child must
   // inherit the fd). O_NONBLOCK keeps the open from blocking on a FIFO and is a
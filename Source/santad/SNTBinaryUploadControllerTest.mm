@@ -19,6 +19,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <cstring>
 #include <map>
 #include <memory>
@@ -29,6 +30,7 @@
 #include "Source/santad/SNTBinaryUploadController.h"
 #include "Source/santad/SleighLauncher.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "commands/v1.pb.h"
 #include "telemetry/sleighconfig.pb.h"
 
@@ -71,6 +73,46 @@ class FakeSleighLauncher : public santa::SleighLauncher {
   std::vector<std::string> last_filter_expressions;
 };
 
+// A SleighLauncher whose launches block until released, recording how many ran
+// and the most that ran at once.
+class BlockingSleighLauncher : public santa::SleighLauncher {
+ public:
+  BlockingSleighLauncher()
+      : santa::SleighLauncher("/nonexistent/sleigh"),
+        started(dispatch_semaphore_create(0)),
+        release(dispatch_semaphore_create(0)) {}
+
+  absl::StatusOr<pbv1::BinaryUploadResponse> LaunchBinaryUpload(
+      int input_fd, const std::string& signed_post_url,
+      const std::map<std::string, std::string>& form_values, const std::string& expected_sha256,
+      const pbtel::BinaryMetadata& metadata, const std::vector<std::string>& filter_expressions,
+      uint32_t timeout_seconds) override {
+    if (input_fd >= 0) {
+      close(input_fd);
+    }
+    launches++;
+    int now_running = ++running;
+    int prev_max = max_running.load();
+    while (now_running > prev_max && !max_running.compare_exchange_weak(prev_max, now_running)) {
+    }
+
+    dispatch_semaphore_signal(started);
+    dispatch_semaphore_wait(release, DISPATCH_TIME_FOREVER);
+    running--;
+
+    pbv1::BinaryUploadResponse response;
+    response.set_disposition(pbv1::BinaryUploadResponse::DISPOSITION_COMPLETED);
+    return response;
+  }
+
+  // Signalled as each launch starts; signal `release` to let one finish.
+  dispatch_semaphore_t started;
+  dispatch_semaphore_t release;
+  std::atomic<int> launches{0};
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+};
+
 @interface SNTBinaryUploadControllerTest : XCTestCase
 @end
 
@@ -106,6 +148,12 @@ class FakeSleighLauncher : public santa::SleighLauncher {
   return path;
 }
 
+- (NSString*)writeFileOfSize:(size_t)size {
+  NSString* path = [self uniqueTempPath:@"file"];
+  [[NSMutableData dataWithLength:size] writeToFile:path atomically:YES];
+  return path;
+}
+
 - (pbv1::BinaryUploadRequest)requestForPath:(NSString*)path {
   pbv1::BinaryUploadRequest request;
   request.set_path(path.UTF8String);
@@ -166,4 +214,142 @@ class FakeSleighLauncher : public santa::SleighLauncher {
   XCTAssertFalse(fakePtr->launched);
 }
 
+// Requests for a SHA-256 that is already uploading share its response and
+// do not launch again.
+- (void)testEnqueueCoalescesSameSHA256 {
+  auto fake = std::make_unique<BlockingSleighLauncher>();
+  BlockingSleighLauncher* fakePtr = fake.get();
+  santa::SNTBinaryUploadController controller(std::move(fake), /*timeout_seconds=*/10);
+
+  pbv1::BinaryUploadRequest request = [self requestForPath:[self writeMachOExecutable]];
+  request.set_sha256("aaaa");
+
+  dispatch_group_t group = dispatch_group_create();
+  __block int completed = 0;
+  for (int i = 0; i < 3; i++) {
+    dispatch_group_enter(group);
+    controller.Enqueue(request, ^(const pbv1::BinaryUploadResponse& response) {
+      if (response.disposition() == pbv1::BinaryUploadResponse::DISPOSITION_COMPLETED) {
+        completed++;
+      }
+      dispatch_group_leave(group);
+    });
+  }
+
+  XCTAssertEqual(
+      dispatch_semaphore_wait(fakePtr->started, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+      0);
+  dispatch_semaphore_signal(fakePtr->release);
+  XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+                 0);
+
+  XCTAssertEqual(fakePtr->launches.load(), 1);
+  XCTAssertEqual(completed, 3);
+}
+
+// A recently completed SHA-256 is not uploaded again until the TTL passes.
+- (void)testCompletedUploadIsRememberedForTTL {
+  auto fake = std::make_unique<FakeSleighLauncher>();
+  FakeSleighLauncher* fakePtr = fake.get();
+  absl::Time now = absl::FromUnixSeconds(1000);
+  santa::SNTBinaryUploadController controller(
+      std::move(fake), /*timeout_seconds=*/10,
+      santa::SNTBinaryUploadController::kDefaultMaxConcurrentUploads,
+      santa::SNTBinaryUploadController::kDefaultMaxBytesInFlight, [&now] { return now; });
+
+  pbv1::BinaryUploadRequest request = [self requestForPath:[self writeMachOExecutable]];
+  request.set_sha256("bbbb");
+
+  XCTAssertEqual(controller.Handle(request).disposition(),
+                 pbv1::BinaryUploadResponse::DISPOSITION_COMPLETED);
+  XCTAssertTrue(fakePtr->launched);
+
+  fakePtr->launched = false;
+  now += santa::SNTBinaryUploadController::kCompletedUploadTTL - absl::Seconds(1);
+  pbv1::BinaryUploadResponse response = controller.Handle(request);
+  XCTAssertEqual(response.disposition(), pbv1::BinaryUploadResponse::DISPOSITION_COMPLETED);
+  XCTAssertEqual(response.message(), std::string("already uploaded"));
+  XCTAssertFalse(fakePtr->launched);
+
+  now += absl::Seconds(2);
+  XCTAssertEqual(controller.Handle(request).disposition(),
+                 pbv1::BinaryUploadResponse::DISPOSITION_COMPLETED);
+  XCTAssertTrue(fakePtr->launched);
+}
+
+// Distinct uploads run in parallel up to the concurrency limit.
+- (void)testEnqueueBoundsConcurrentUploads {
+  auto fake = std::make_unique<BlockingSleighLauncher>();
+  BlockingSleighLauncher* fakePtr = fake.get();
+  santa::SNTBinaryUploadController controller(std::move(fake), /*timeout_seconds=*/10,
+                                              /*max_concurrent_uploads=*/2);
+
+  NSString* path = [self writeMachOExecutable];
+  dispatch_group_t group = dispatch_group_create();
+  for (int i = 0; i < 5; i++) {
+    pbv1::BinaryUploadRequest request = [self requestForPath:path];
+    request.set_sha256(std::to_string(i));
+    dispatch_group_enter(group);
+    controller.Enqueue(request, ^(const pbv1::BinaryUploadResponse&) {
+      dispatch_group_leave(group);
+    });
+  }
+
+  for (int i = 0; i < 5; i++) {
+    XCTAssertEqual(dispatch_semaphore_wait(fakePtr->started,
+                                           dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+                   0);
+    XCTAssertLessThanOrEqual(fakePtr->running.load(), 2);
+    dispatch_semaphore_signal(fakePtr->release);
+  }
+  XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+                 0);
+
+  XCTAssertEqual(fakePtr->launches.load(), 5);
+  XCTAssertEqual(fakePtr->max_running.load(), 2);
+}
+
+// An upload waits while the bytes already in flight would exceed the budget,
+// but one larger than the whole budget still runs on its own.
+- (void)testEnqueueBoundsBytesInFlight {
+  auto fake = std::make_unique<BlockingSleighLauncher>();
+  BlockingSleighLauncher* fakePtr = fake.get();
+  santa::SNTBinaryUploadController controller(std::move(fake), /*timeout_seconds=*/10,
+                                              /*max_concurrent_uploads=*/4,
+                                              /*max_bytes_in_flight=*/1000);
+
+  NSString* big = [self writeFileOfSize:1500];
+  NSString* small = [self writeFileOfSize:100];
+  dispatch_group_t group = dispatch_group_create();
+  int i = 0;
+  for (NSString* path in @[ big, small ]) {
+    pbv1::BinaryUploadRequest request = [self requestForPath:path];
+    request.set_sha256(std::to_string(i++));
+    dispatch_group_enter(group);
+    controller.Enqueue(request, ^(const pbv1::BinaryUploadResponse&) {
+      dispatch_group_leave(group);
+    });
+  }
+
+  XCTAssertEqual(
+      dispatch_semaphore_wait(fakePtr->started, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+      0);
+  // The small upload must wait for the big one to finish
+  XCTAssertNotEqual(dispatch_semaphore_wait(fakePtr->started,
+                                            dispatch_time(DISPATCH_TIME_NOW, 200 * NSEC_PER_MSEC)),
+                    0);
+  XCTAssertEqual(fakePtr->launches.load(), 1);
+
+  dispatch_semaphore_signal(fakePtr->release);
+  XCTAssertEqual(
+      dispatch_semaphore_wait(fakePtr->started, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+      0);
+  dispatch_semaphore_signal(fakePtr->release);
+  XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+                 0);
+
+  XCTAssertEqual(fakePtr->launches.load(), 2);
+  XCTAssertEqual(fakePtr->max_running.load(), 1);
+}
+
 @end
@@ -30,4 +30,7 @@
 // Set whether or not the given audit token should be tracked as a compiler
 - (void)setProcess:(const audit_token_t&)tok isCompiler:(bool)isCompiler;
 
+// Synchronously commit any staged transitive rules to the rule table.
+- (void)flushTransitiveRules;
+
 @end
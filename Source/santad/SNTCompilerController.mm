@@ -21,12 +21,14 @@
 #include <string.h>
 
 #include <atomic>
+#include <vector>
 
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTFileInfo.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTRule.h"
+#import "Source/common/SNTStrengthify.h"
 #include "Source/common/String.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #import "Source/santad/SNTDatabaseController.h"
@@ -38,6 +40,23 @@ using santa::Message;
 static const pid_t PID_MAX = 99999;
 static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
 
+// Transitive rules are staged and written to the rule table in batches. A batch is committed once
+// this many rules are staged, or after the flush delay, whichever comes first. Until then the
+// pending decision saved for each file is what allows it to execute.
+static const size_t kMaxStagedTransitiveRules = 256;
+static const int64_t kTransitiveRuleFlushDelayNanos = 250 * NSEC_PER_MSEC;
+
+namespace {
+
+struct StagedTransitiveRule {
+  Message msg;
+  SNTFileInfo* file;
+  NSString* sha256;
+  std::shared_ptr<Logger> logger;
+};
+
+}  // namespace
+
 // Tracks compiler PIDs using pidversion to prevent PID reuse attacks.
 //
 // Each slot stores the pidversion of the active compiler at that PID index, or 0
@@ -57,11 +76,25 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
 // security issue, and is self-healing.
 @interface SNTCompilerController () {
   std::atomic<int32_t> _compilerPIDs[PID_MAX];
+  // Only accessed on _transitiveRuleQueue
+  std::vector<StagedTransitiveRule> _stagedRules;
 }
+@property dispatch_queue_t transitiveRuleQueue;
+@property BOOL flushScheduled;
 @end
 
 @implementation SNTCompilerController
 
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _transitiveRuleQueue =
+        dispatch_queue_create("com.northpolesec.santa.daemon.transitive_rules",
+                              DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+  }
+  return self;
+}
+
 - (BOOL)isCompiler:(const audit_token_t&)tok {
   pid_t pid = audit_token_to_pid(tok);
   if (pid < 0 || pid >= PID_MAX) return NO;
@@ -94,9 +127,15 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
 // is executed before we can create a transitive rule for it, then we can at
 // least log the pending decision info.
 - (void)saveFakeDecision:(SNTFileInfo*)fileInfo {
+  [self saveFakeDecision:fileInfo sha256:@"pending"];
+}
+
+// Once the file has been hashed, the pending decision carries its hash so that the policy
+// processor can allow the file to execute before its transitive rule is committed.
+- (void)saveFakeDecision:(SNTFileInfo*)fileInfo sha256:(NSString*)sha256 {
   SNTCachedDecision* cd = [[SNTCachedDecision alloc] initWithVnode:fileInfo.vnode];
   cd.decision = SNTEventStateAllowPendingTransitive;
-  cd.sha256 = @"pending";
+  cd.sha256 = sha256;
   [[SNTDecisionCache sharedCache] cacheDecision:cd];
 }
 
@@ -200,51 +239,118 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
 }
 
 // Assume that this method is called only when we already know that the writing process is a
-// compiler.  It checks if the closed file is executable, and if so, transitively allowlists it.
-// The passed in message contains the pid of the writing process and path of closed file.
+// compiler.  It checks if the closed file is executable, and if so, stages a transitive rule for
+// it. The passed in message contains the pid of the writing process and path of closed file.
 - (void)createTransitiveRule:(const Message&)esMsg
                       target:(SNTFileInfo*)targetFile
                       logger:(std::shared_ptr<Logger>)logger {
   [self saveFakeDecision:targetFile];
 
   // Check if this file is an executable.
-  if (targetFile.isExecutable) {
+  if (!targetFile.isExecutable) {
+    [self removeFakeDecision:targetFile];
+    return;
+  }
+
+  NSString* sha256 = targetFile.SHA256;
+  if (!sha256) {
+    LOGW(@"Failed to hash file for transitive rule: %@", targetFile.path);
+    [self removeFakeDecision:targetFile];
+    return;
+  }
+
+  [self saveFakeDecision:targetFile sha256:sha256];
+
+  // Blocks capture C++ objects as const, take the copy here so it can outlive the ES callback.
+  Message msgCopy = esMsg;
+  dispatch_async(self.transitiveRuleQueue, ^{
+    self->_stagedRules.push_back({msgCopy, targetFile, sha256, logger});
+    if (self->_stagedRules.size() >= kMaxStagedTransitiveRules) {
+      [self commitStagedTransitiveRulesSerialized];
+    } else {
+      [self scheduleFlushSerialized];
+    }
+  });
+}
+
+- (void)scheduleFlushSerialized {
+  if (self.flushScheduled) {
+    return;
+  }
+  self.flushScheduled = YES;
+
+  WEAKIFY(self);
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kTransitiveRuleFlushDelayNanos),
+                 self.transitiveRuleQueue, ^{
+                   STRONGIFY(self);
+                   self.flushScheduled = NO;
+                   [self commitStagedTransitiveRulesSerialized];
+                 });
+}
+
+- (void)flushTransitiveRules {
+  dispatch_sync(self.transitiveRuleQueue, ^{
+    [self commitStagedTransitiveRulesSerialized];
+  });
+}
+
+// Writes all staged transitive rules to the rule table in a single transaction.
+- (void)commitStagedTransitiveRulesSerialized {
+  if (_stagedRules.empty()) {
+    return;
+  }
+
+  std::vector<StagedTransitiveRule> staged;
+  std::swap(staged, _stagedRules);
+
+  SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
+  NSMutableDictionary<NSString*, SNTRule*>* rules = [NSMutableDictionary dictionary];
+  for (const StagedTransitiveRule& entry : staged) {
+    if (rules[entry.sha256]) {
+      continue;
+    }
+
     // Check if there is an existing (non-transitive) rule for this file.  We leave existing rules
     // alone, so that a allowlist or blocklist rule can't be overwritten by a transitive one.
-    SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
     SNTRule* prevRule =
         [ruleTable executionRuleForIdentifiers:(struct RuleIdentifiers){
-                                                   .binarySHA256 = targetFile.SHA256,
+                                                   .binarySHA256 = entry.sha256,
                                                }];
     // Note: Don't overwrite existing rules, unless it was a transitive rule which is allowed
     // in order to have timestamps updated.
-    if (!prevRule || prevRule.state == SNTRuleStateAllowTransitive) {
-      // Construct a new transitive allowlist rule for the executable.
-      SNTRule* rule = [[SNTRule alloc] initWithIdentifier:targetFile.SHA256
-                                                    state:SNTRuleStateAllowTransitive
-                                                     type:SNTRuleTypeBinary];
-
-      if (!rule) {
-        LOGW(@"Failed to create transitive rule: %@ (SHA-256: %@)", targetFile.path,
-             targetFile.SHA256);
-      } else {
-        // Add the new rule to the rules database.
-        NSArray<NSError*>* errors;
-        if (![ruleTable addExecutionRules:@[ rule ]
-                              ruleCleanup:SNTRuleCleanupNone
-                                   errors:&errors]) {
-          for (NSError* error in errors) {
-            LOGE(@"Unable to add new transitive rule to database: %@", error.localizedDescription);
-          }
-        } else {
-          logger->LogAllowlist(esMsg, santa::NSStringToUTF8StringView(targetFile.SHA256),
-                               santa::NSStringToUTF8StringView(targetFile.path));
-        }
-      }
+    if (prevRule && prevRule.state != SNTRuleStateAllowTransitive) {
+      continue;
     }
+
+    // Construct a new transitive allowlist rule for the executable.
+    SNTRule* rule = [[SNTRule alloc] initWithIdentifier:entry.sha256
+                                                  state:SNTRuleStateAllowTransitive
+                                                   type:SNTRuleTypeBinary];
+    if (!rule) {
+      LOGW(@"Failed to create transitive rule: %@ (SHA-256: %@)", entry.file.path, entry.sha256);
+      continue;
+    }
+    rules[entry.sha256] = rule;
   }
 
-  [self removeFakeDecision:targetFile];
+  // Add the new rules to the rules database.
+  NSArray<NSError*>* errors;
+  if (rules.count && ![ruleTable addExecutionRules:rules.allValues
+                                       ruleCleanup:SNTRuleCleanupNone
+                                            errors:&errors]) {
+    for (NSError* error in errors) {
+      LOGE(@"Unable to add new transitive rules to database: %@", error.localizedDescription);
+    }
+    [rules removeAllObjects];
+  }
+
+  for (const StagedTransitiveRule& entry : staged) {
+    if (rules[entry.sha256] && entry.logger) {
+      entry.logger->LogAllowlist(entry.msg, santa::NSStringToUTF8StringView(entry.sha256),
+                                 santa::NSStringToUTF8StringView(entry.file.path));
+    }
+    [self removeFakeDecision:entry.file];
+  }
 }
 
 @end
@@ -30,6 +30,9 @@
 #include "Source/common/es/Message.h"
 #include "Source/common/es/MockEndpointSecurityAPI.h"
 #include "Source/santad/Logs/EndpointSecurity/Logger.h"
+#import "Source/common/SNTRule.h"
+#import "Source/santad/DataLayer/SNTRuleTable.h"
+#import "Source/santad/SNTDatabaseController.h"
 #import "Source/santad/SNTDecisionCache.h"
 
 using santa::Logger;
@@ -192,6 +195,63 @@ static const pid_t PID_MAX = 99999;
   XCTAssertTrue(OCMVerifyAll(self.mockDecisionCache), "Unable to verify all expectations");
 }
 
+- (void)testCreateTransitiveRuleBatchesInserts {
+  es_file_t file = MakeESFile("foo");
+  es_process_t compilerProc = MakeESProcess(&file, MakeAuditToken(12, 34), {});
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &compilerProc);
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+  Message msg(mockESApi, &esMsg);
+
+  id mockRuleTable = OCMClassMock([SNTRuleTable class]);
+  id mockDatabaseController = OCMClassMock([SNTDatabaseController class]);
+  OCMStub([mockDatabaseController ruleTable]).andReturn(mockRuleTable);
+  OCMStub([mockRuleTable executionRuleForIdentifiers:{}]).ignoringNonObjectArgs().andReturn(nil);
+
+  // Both files are staged and written to the rule table in a single transaction
+  OCMExpect([mockRuleTable addExecutionRules:[OCMArg checkWithBlock:^BOOL(NSArray* rules) {
+                             return rules.count == 2;
+                           }]
+                                 ruleCleanup:SNTRuleCleanupNone
+                                      errors:[OCMArg anyObjectRef]])
+      .andReturn(NO);
+
+  SNTCompilerController* cc = [[SNTCompilerController alloc] init];
+  NSMutableArray* mockFiles = [NSMutableArray array];
+  for (uint64_t i = 1; i <= 2; i++) {
+    SantaVnode vnode{.fsid = 12, .fileid = i};
+    NSString* sha256 = [NSString stringWithFormat:@"%064llu", i];
+
+    id mockFileInfo = OCMClassMock([SNTFileInfo class]);
+    OCMStub([mockFileInfo vnode]).andReturn(vnode);
+    OCMStub([mockFileInfo isExecutable]).andReturn(YES);
+    OCMStub([mockFileInfo SHA256]).andReturn(sha256);
+    [mockFiles addObject:mockFileInfo];
+
+    // The pending decision carries the file's hash until the rule is committed
+    OCMExpect([self.mockDecisionCache
+        cacheDecision:[OCMArg checkWithBlock:^BOOL(SNTCachedDecision* cd) {
+          return cd.vnodeId == vnode && cd.decision == SNTEventStateAllowPendingTransitive &&
+                 [cd.sha256 isEqualToString:sha256];
+        }]]);
+    OCMExpect([self.mockDecisionCache forgetCachedDecisionForVnode:vnode]);
+
+    [cc createTransitiveRule:msg target:mockFileInfo logger:nullptr];
+  }
+
+  [cc flushTransitiveRules];
+
+  XCTAssertTrue(OCMVerifyAll(mockRuleTable), "Unable to verify all expectations");
+  XCTAssertTrue(OCMVerifyAll(self.mockDecisionCache), "Unable to verify all expectations");
+
+  for (id mockFileInfo in mockFiles) {
+    [mockFileInfo stopMocking];
+  }
+  [mockDatabaseController stopMocking];
+  [mockRuleTable stopMocking];
+}
+
 - (void)testHandleEventWithLogger {
   es_file_t file = MakeESFile("foo");
   es_file_t ignoredFile = MakeESFile("/dev/bar");
@@ -20,6 +20,7 @@
 #import "Source/common/SNTXPCControlInterface.h"
 #include "Source/common/SantaVnode.h"
 #include "Source/common/faa/WatchItems.h"
+#include "Source/common/processtree/process_tree.h"
 #include "Source/santad/EventProviders/AuthResultCache.h"
 #include "Source/santad/Logs/EndpointSecurity/Logger.h"
 #include "Source/santad/SNTBinaryUploadController.h"
@@ -43,11 +44,16 @@
                           (std::shared_ptr<santa::SandboxExpectations>)sandboxExpectations
                           flushCacheBlock:(void (^)(santa::FlushCacheMode,
                                                     santa::FlushCacheReason))flushCacheBlock
+                     invalidateCacheBlock:(void (^)(santa::FlushCacheReason,
+                                                    NSSet<NSString*>*))invalidateCacheBlock
                           cacheCountBlock:(NSArray<NSNumber*>* (^)(void))cacheCountBlock
                           checkCacheBlock:(SNTAction (^)(SantaVnode))checkCacheBlock
                        metricsExportBlock:(void (^)(void (^reply)(BOOL)))metricsExportBlock
                    binaryUploadController:
-                       (std::shared_ptr<santa::SNTBinaryUploadController>)binaryUploadController;
+                       (std::shared_ptr<santa::SNTBinaryUploadController>)binaryUploadController
+                              processTree:
+                                  (std::shared_ptr<santa::santad::process_tree::ProcessTree>)
+                                      processTree;
 
 /// Install the network extension, optionally checking whether an upgrade is needed first.
 /// When force is YES, delegates to installNetworkExtension: as long as installation is authorized.
@@ -14,6 +14,7 @@
 /// limitations under the License.
 
 #import "Source/santad/SNTDaemonControlController.h"
+#include <libproc.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,8 +25,11 @@
 
 #include <memory>
 
+#include "Source/common/HotBinaries.h"
+#include "Source/common/LatencyHistogram.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/MOLXPCConnection.h"
+#include "Source/common/MemoryAccounting.h"
 #include "Source/common/Pinning.h"
 #import "Source/common/SNTCELFallbackRule.h"
 #import "Source/common/SNTCachedDecision.h"
@@ -41,6 +45,7 @@
 #import "Source/common/SNTModeTransition.h"
 #import "Source/common/SNTRule.h"
 #import "Source/common/SNTRuleIdentifiers.h"
+#import "Source/common/SNTRuleStream.h"
 #import "Source/common/SNTSandboxExecRequest.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTStoredTemporaryMonitorModeAuditEvent.h"
@@ -48,12 +53,16 @@
 #import "Source/common/SNTTimer.h"
 #import "Source/common/SNTXPCNotifierInterface.h"
 #import "Source/common/SNTXPCSyncServiceInterface.h"
+#include "Source/common/SelfProfiler.h"
+#include "Source/common/Signposts.h"
+#include "Source/common/SlowestEvaluations.h"
 #include "Source/common/String.h"
 #include "Source/common/faa/WatchItems.h"
 #import "Source/common/ne/SNTSyncNetworkExtensionSettings.h"
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/KillingMachine.h"
+#include "Source/santad/Metrics.h"
 #import "Source/santad/SNTDatabaseController.h"
 #import "Source/santad/SNTNetworkExtensionQueue.h"
 #import "Source/santad/SNTNotificationQueue.h"
@@ -68,6 +77,13 @@ using santa::Logger;
 using santa::WatchItems;
 using santa::WatchItemsState;
 
+// Above this many changed execution rules, invalidating matching cache entries individually
+// costs more than flushing the caches.
+static const NSUInteger kMaxTargetedInvalidationRules = 1000;
+
+// Rules read from a stream are staged in batches of this size.
+static const NSUInteger kRuleStreamBatchSize = 10000;
+
 // Globals used by the santad watchdog thread
 uint64_t watchdogCPUEvents = 0;
 uint64_t watchdogRAMEvents = 0;
@@ -89,6 +105,12 @@ double watchdogRAMPeak = 0;
 ///
 @property(copy) void (^flushCacheBlock)(santa::FlushCacheMode, santa::FlushCacheReason);
 
+///
+///  Called when only cached decisions for files matching the given rule identifiers need to be
+///  invalidated.
+///
+@property(copy) void (^invalidateCacheBlock)(santa::FlushCacheReason, NSSet<NSString*>*);
+
 ///
 ///  Called to get cache counts (root cache count, non-root cache count).
 ///
@@ -109,6 +131,7 @@ double watchdogRAMPeak = 0;
   std::shared_ptr<santa::TemporaryMonitorMode> _temporaryMonitorMode;
   std::shared_ptr<santa::SandboxExpectations> _sandboxExpectations;
   std::shared_ptr<santa::SNTBinaryUploadController> _binaryUploadController;
+  std::shared_ptr<santa::santad::process_tree::ProcessTree> _processTree;
 }
 
 - (instancetype)initWithNotificationQueue:(SNTNotificationQueue*)notQueue
@@ -120,21 +143,28 @@ double watchdogRAMPeak = 0;
                           (std::shared_ptr<santa::SandboxExpectations>)sandboxExpectations
                           flushCacheBlock:(void (^)(santa::FlushCacheMode,
                                                     santa::FlushCacheReason))flushCacheBlock
+                     invalidateCacheBlock:(void (^)(santa::FlushCacheReason,
+                                                    NSSet<NSString*>*))invalidateCacheBlock
                           cacheCountBlock:(NSArray<NSNumber*>* (^)(void))cacheCountBlock
                           checkCacheBlock:(SNTAction (^)(SantaVnode))checkCacheBlock
                        metricsExportBlock:(void (^)(void (^reply)(BOOL)))metricsExportBlock
                    binaryUploadController:
-                       (std::shared_ptr<santa::SNTBinaryUploadController>)binaryUploadController {
+                       (std::shared_ptr<santa::SNTBinaryUploadController>)binaryUploadController
+                              processTree:
+                                  (std::shared_ptr<santa::santad::process_tree::ProcessTree>)
+                                      processTree {
   self = [super init];
   if (self) {
     _logger = logger;
     _binaryUploadController = std::move(binaryUploadController);
+    _processTree = std::move(processTree);
     _watchItems = std::move(watchItems);
     _sandboxExpectations = std::move(sandboxExpectations);
     _notQueue = notQueue;
     _syncdQueue = syncdQueue;
     _netExtQueue = netExtQueue;
     _flushCacheBlock = flushCacheBlock;
+    _invalidateCacheBlock = invalidateCacheBlock;
     _cacheCountsBlock = cacheCountBlock;
     _checkCacheBlock = checkCacheBlock;
     _metricsExportBlock = metricsExportBlock;
@@ -167,19 +197,26 @@ double watchdogRAMPeak = 0;
 
 - (void)uploadBinary:(NSData*)serializedRequest reply:(void (^)(NSData*))reply {
   dispatch_async(_binaryUploadQ, ^{
-    ::santa::commands::v1::BinaryUploadResponse response;
+    void (^sendReply)(const ::santa::commands::v1::BinaryUploadResponse&) =
+        ^(const ::santa::commands::v1::BinaryUploadResponse& response) {
+          std::string serialized;
+          response.SerializeToString(&serialized);
+          reply([NSData dataWithBytes:serialized.data() length:serialized.size()]);
+        };
+
     ::santa::commands::v1::BinaryUploadRequest request;
     if (self->_binaryUploadController &&
         request.ParseFromArray(serializedRequest.bytes, (int)serializedRequest.length)) {
-      response = self->_binaryUploadController->Handle(request);
+      // Queued uploads reply when they finish, so this queue is not held while
+      // they run.
+      self->_binaryUploadController->Enqueue(request, sendReply);
     } else {
+      ::santa::commands::v1::BinaryUploadResponse response;
       response.set_disposition(
           ::santa::commands::v1::BinaryUploadResponse::DISPOSITION_INTERNAL_ERROR);
       response.set_message("failed to parse BinaryUploadRequest");
+      sendReply(response);
     }
-    std::string serialized;
-    response.SerializeToString(&serialized);
-    reply([NSData dataWithBytes:serialized.data() length:serialized.size()]);
   });
 }
 
@@ -202,6 +239,10 @@ double watchdogRAMPeak = 0;
 #pragma mark Database ops
 
 - (void)databaseRuleCounts:(void (^)(RuleCounts ruleTypeCounts))reply {
+  reply([self ruleCounts]);
+}
+
+- (RuleCounts)ruleCounts {
   SNTRuleTable* rdb = [SNTDatabaseController ruleTable];
   __block RuleCounts ruleCounts{
       .binary = [rdb binaryRuleCount],
@@ -234,15 +275,11 @@ double watchdogRAMPeak = 0;
         }
       }];
 
-  reply(ruleCounts);
+  return ruleCounts;
 }
 
-- (void)databaseRuleAddExecutionRules:(NSArray<SNTRule*>*)executionRules
-                      fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
-                     networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
-                          ruleCleanup:(SNTRuleCleanup)cleanupType
-                               source:(SNTRuleAddSource)source
-                                reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
+// Returns an error if rules from `source` must not be added to the database.
+static NSError* RuleAddSourceError(SNTRuleAddSource source) {
 #ifndef DEBUG
   SNTConfigurator* config = [SNTConfigurator configurator];
   if (source == SNTRuleAddSourceSantactl && (config.syncBaseURL || config.staticRules.count > 0)) {
@@ -251,10 +288,22 @@ double watchdogRAMPeak = 0;
                    withCode:SNTErrorCodeManualRulesDisabled
                     message:@"Rejected by the Santa daemon"
                      detail:@"SyncBaseURL or StaticRules are set"];
+    return error;
+  }
+#endif
+  return nil;
+}
+
+- (void)databaseRuleAddExecutionRules:(NSArray<SNTRule*>*)executionRules
+                      fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+                     networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                          ruleCleanup:(SNTRuleCleanup)cleanupType
+                               source:(SNTRuleAddSource)source
+                                reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
+  if (NSError* error = RuleAddSourceError(source)) {
     reply(NO, @[ error ]);
     return;
   }
-#endif
 
   SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
 
@@ -276,8 +325,20 @@ double watchdogRAMPeak = 0;
 
   // The actual cache flushing happens after the new rules have been added to the database.
   if (flushCache) {
-    LOGI(@"Flushing caches");
-    if (self.flushCacheBlock) {
+    // When the change is limited to a modest set of execution rules, only the cached decisions
+    // for files matching those identifiers need to be invalidated.
+    BOOL targeted = (cleanupType == SNTRuleCleanupNone && fileAccessRules.count == 0 &&
+                     executionRules.count <= kMaxTargetedInvalidationRules);
+    if (targeted && self.invalidateCacheBlock) {
+      NSMutableSet<NSString*>* identifiers = [NSMutableSet setWithCapacity:executionRules.count];
+      for (SNTRule* rule in executionRules) {
+        if (rule.identifier) [identifiers addObject:rule.identifier];
+      }
+      LOGI(@"Invalidating cached decisions for %lu rule identifiers",
+           (unsigned long)identifiers.count);
+      self.invalidateCacheBlock(FlushCacheReason::kRulesChanged, identifiers);
+    } else if (self.flushCacheBlock) {
+      LOGI(@"Flushing caches");
       self.flushCacheBlock(FlushCacheMode::kAllCaches, FlushCacheReason::kRulesChanged);
     }
   }
@@ -285,12 +346,94 @@ double watchdogRAMPeak = 0;
   reply(success, errors);
 }
 
+- (void)databaseRuleDiscardStagedRules:(void (^)(void))reply {
+  [[SNTDatabaseController ruleTable] discardStagedExecutionRules];
+  reply();
+}
+
+- (void)databaseRuleStageExecutionRules:(NSArray<SNTRule*>*)executionRules
+                                 source:(SNTRuleAddSource)source
+                                  reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
+  if (NSError* error = RuleAddSourceError(source)) {
+    reply(NO, @[ error ]);
+    return;
+  }
+
+  NSArray<NSError*>* errors;
+  BOOL success = [[SNTDatabaseController ruleTable] stageExecutionRules:executionRules
+                                                                 errors:&errors];
+  reply(success, errors);
+}
+
+- (void)databaseRuleStageExecutionRulesFromStream:(NSFileHandle*)stream
+                                           source:(SNTRuleAddSource)source
+                                            reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
+  if (NSError* error = RuleAddSourceError(source)) {
+    [stream closeFile];
+    reply(NO, @[ error ]);
+    return;
+  }
+
+  __block NSArray<NSError*>* errors;
+  NSError* streamError;
+  BOOL success = [SNTRuleStream readRulesFromFileHandle:stream
+                                              batchSize:kRuleStreamBatchSize
+                                                handler:^BOOL(NSArray<SNTRule*>* rules) {
+                                                  return [[SNTDatabaseController ruleTable]
+                                                      stageExecutionRules:rules
+                                                                   errors:&errors];
+                                                }
+                                                  error:&streamError];
+  [stream closeFile];
+  if (!success && !errors.count && streamError) {
+    errors = @[ streamError ];
+  }
+  reply(success, errors);
+}
+
+- (void)databaseRuleAddStagedExecutionRules:(NSUInteger)count
+                            fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+                           networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                                ruleCleanup:(SNTRuleCleanup)cleanupType
+                                     source:(SNTRuleAddSource)source
+                                      reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
+  if (NSError* error = RuleAddSourceError(source)) {
+    reply(NO, @[ error ]);
+    return;
+  }
+
+  SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
+
+  NSArray<NSError*>* errors;
+  BOOL success = [ruleTable addStagedExecutionRules:count
+                                    fileAccessRules:fileAccessRules
+                                   networkFlowRules:networkFlowRules
+                                        ruleCleanup:cleanupType
+                                             errors:&errors];
+  if (!success) {
+    [ruleTable discardStagedExecutionRules];
+  }
+
+  [ruleTable removeOutdatedTransitiveRules];
+
+  // Staged sets are too large to compare against the existing rules or to invalidate by
+  // identifier, so every cache is flushed.
+  if (success && self.flushCacheBlock) {
+    LOGI(@"Flushing caches");
+    self.flushCacheBlock(FlushCacheMode::kAllCaches, FlushCacheReason::kRulesChanged);
+  }
+
+  reply(success, errors);
+}
+
 - (void)databaseEventCount:(void (^)(int64_t count))reply {
   reply([[SNTDatabaseController eventTable] pendingEventsCount]);
 }
 
-- (void)databaseEventsPending:(void (^)(NSArray<SNTStoredEvent*>* events))reply {
-  reply([[SNTDatabaseController eventTable] pendingEvents]);
+- (void)databaseEventsPendingAfterIndex:(NSNumber*)idx
+                                  limit:(NSUInteger)limit
+                                  reply:(void (^)(NSArray<SNTStoredEvent*>* events))reply {
+  reply([[SNTDatabaseController eventTable] pendingEventsAfterIndex:idx limit:limit]);
 }
 
 - (void)databaseRemoveEventsWithIDs:(NSArray*)ids {
@@ -302,6 +445,11 @@ double watchdogRAMPeak = 0;
   reply([[SNTDatabaseController ruleTable] executionRuleForIdentifiers:[identifiers toStruct]]);
 }
 
+- (void)databaseRulesForIdentifiers:(NSArray<SNTRuleIdentifiers*>*)identifiers
+                              reply:(void (^)(NSArray*))reply {
+  reply([[SNTDatabaseController ruleTable] executionRulesForIdentifiers:identifiers]);
+}
+
 - (void)staticDecisionForFilePath:(NSString*)filePath
                       identifiers:(SNTRuleIdentifiers*)identifiers
                             reply:(void (^)(SNTRule* rule, NSString* decision))reply {
@@ -431,6 +579,13 @@ double watchdogRAMPeak = 0;
         rulesHash.networkFlowRulesHash);
 }
 
+- (void)preflightInfo:(void (^)(RuleCounts, SNTClientMode, NSString*, NSString*, NSString*))reply {
+  SNTRuleTableRulesHash* rulesHash = [[SNTDatabaseController ruleTable] hashOfHashes];
+  reply([self ruleCounts], [[SNTConfigurator configurator] clientMode],
+        rulesHash.executionRulesHash, rulesHash.fileAccessRulesHash,
+        rulesHash.networkFlowRulesHash);
+}
+
 #pragma mark Config Ops
 
 - (void)isSyncV2Enabled:(void (^)(BOOL))reply {
@@ -441,6 +596,40 @@ double watchdogRAMPeak = 0;
   reply(watchdogCPUEvents, watchdogRAMEvents, watchdogCPUPeak, watchdogRAMPeak);
 }
 
+- (void)selfProfile:(void (^)(NSDictionary<NSString*, NSNumber*>*, uint64_t, uint64_t))reply {
+  NSMutableDictionary<NSString*, NSNumber*>* cpuSeconds = [NSMutableDictionary dictionary];
+  for (const auto& [subsystem, cpu] : santa::SelfProfiler::Shared().CPUTimeBySubsystem()) {
+    cpuSeconds[@(subsystem.c_str())] =
+        @((cpu.user_nanos + cpu.system_nanos) / (double)NSEC_PER_SEC);
+  }
+
+  santa::SelfProfiler::Wakeups wakeups = santa::SelfProfiler::GetWakeups();
+  reply(cpuSeconds, wakeups.interrupt, wakeups.platform_idle);
+}
+
+- (void)memoryUsage:(void (^)(NSDictionary<NSString*, NSNumber*>*))reply {
+  NSMutableDictionary<NSString*, NSNumber*>* bytesByStructure = [NSMutableDictionary dictionary];
+  for (const auto& [structure, bytes] : santa::MemoryAccounting::Shared().Usage()) {
+    bytesByStructure[@(structure.c_str())] = @(bytes);
+  }
+  reply(bytesByStructure);
+}
+
+- (void)hotBinaries:(void (^)(NSArray<NSDictionary*>*))reply {
+  NSMutableArray<NSDictionary*>* binaries = [NSMutableArray array];
+  for (const auto& entry : santa::HotBinaries::Shared().Top(10)) {
+    [binaries addObject:@{
+      @"key" : @(entry.key.c_str()) ?: @"",
+      @"path" : @(entry.path.c_str()) ?: @"",
+      @"count" : @(entry.count),
+      @"total" : @(entry.total_nanos),
+      @"max" : @(entry.max_nanos),
+      @"error" : @(entry.error_nanos),
+    }];
+  }
+  reply(binaries);
+}
+
 - (void)watchItemsState:(void (^)(BOOL, uint64_t, NSString*,
                                   santa::WatchItems::DataSource dataSource, NSString*,
                                   NSTimeInterval))reply {
@@ -529,7 +718,7 @@ double watchdogRAMPeak = 0;
   // and rules-newly-added cases.
   NSData* oldCELData = [SNTCELFallbackRule serializeArray:[configurator celFallbackRules]];
 
-  BOOL committed = [configurator performSyncStateBatch:^{
+  void (^applyBundle)(void) = ^{
     [result clearSyncStateBeforeApply:^(BOOL clear) {
       if (clear) {
         [configurator clearSyncState];
@@ -666,7 +855,18 @@ double watchdogRAMPeak = 0;
     [result pushNotificationsFullSyncInterval:^(NSUInteger val) {
       [configurator setSyncServerPushNotificationsFullSyncInterval:val];
     }];
-  }];
+  };
+
+  // Fields the server resent with their current values are dropped by the
+  // batch, so a sync that changes nothing does no reconfiguration work.
+  NSSet<NSString*>* changedKeys;
+  BOOL committed = [configurator performSyncStateBatch:applyBundle changedKeys:&changedKeys];
+
+  if (changedKeys.count > 0) {
+    LOGD(@"Sync settings changed: %@",
+         [[changedKeys.allObjects sortedArrayUsingSelector:@selector(compare:)]
+             componentsJoinedByString:@", "]);
+  }
 
   // Mode-transition enforcement and GUI notification run after the batch so
   // Available(nil) reads from the just-committed state. Bundle accessors are
@@ -678,9 +878,13 @@ double watchdogRAMPeak = 0;
   }];
 
   if (committed) {
-    NSData* newCELData = [SNTCELFallbackRule serializeArray:[configurator celFallbackRules]];
-    if (![oldCELData isEqualToData:newCELData] && self.flushCacheBlock) {
-      self.flushCacheBlock(FlushCacheMode::kAllCaches, FlushCacheReason::kCELFallbackRulesChanged);
+    // An unchanged sync state can't have changed the effective CEL rules
+    if (changedKeys.count > 0) {
+      NSData* newCELData = [SNTCELFallbackRule serializeArray:[configurator celFallbackRules]];
+      if (![oldCELData isEqualToData:newCELData] && self.flushCacheBlock) {
+        self.flushCacheBlock(FlushCacheMode::kAllCaches,
+                             FlushCacheReason::kCELFallbackRulesChanged);
+      }
     }
 
     // Postflight marks the sync boundary. Now that settings and rules (committed earlier in
@@ -701,10 +905,18 @@ double watchdogRAMPeak = 0;
 - (void)killProcesses:(SNTKillRequest*)killRequest reply:(void (^)(SNTKillResponse*))reply {
   // Perform work asynchronously to not hold up processing other XPC messages
   dispatch_async(self.commandQ, ^{
-    reply(santa::KillingMachine(killRequest));
+    reply(santa::KillingMachine(killRequest, self->_processTree));
   });
 }
 
+#pragma mark Debugging Ops
+
+- (void)setSignpostsEnabled:(BOOL)enabled reply:(void (^)(void))reply {
+  LOGI(@"Signposts %@", enabled ? @"enabled" : @"disabled");
+  santa::SetSignpostsEnabled(enabled, /*persist=*/true);
+  reply();
+}
+
 #pragma mark Metrics Ops
 
 - (void)metrics:(void (^)(NSDictionary*))reply {
@@ -712,6 +924,57 @@ double watchdogRAMPeak = 0;
   reply([metricSet export]);
 }
 
+- (void)performanceDiagnostics:(void (^)(NSDictionary*))reply {
+  NSMutableDictionary* diagnostics = [NSMutableDictionary dictionary];
+
+  struct proc_bsdinfo info;
+  if (proc_pidinfo(getpid(), PROC_PIDTBSDINFO, 0, &info, sizeof(info)) == sizeof(info)) {
+    diagnostics[@"uptime_seconds"] = @(MAX(0, time(NULL) - (time_t)info.pbi_start_tvsec));
+  }
+
+  diagnostics[@"metrics"] = [[SNTMetricSet sharedInstance] export];
+
+  // Peek without resetting so the next metrics export is unaffected
+  NSMutableArray* latencies = [NSMutableArray array];
+  santa::StageLatencies::Shared().ForEach(
+      false, [latencies](santa::LatencyStage stage, es_event_type_t eventType,
+                         const santa::LatencyHistogram::Snapshot& snapshot) {
+        [latencies addObject:@{
+          @"event" : santa::EventTypeToString(eventType),
+          @"stage" : santa::LatencyStageToString(stage),
+          @"count" : @(snapshot.count),
+          @"p50" : @(snapshot.Percentile(50)),
+          @"p99" : @(snapshot.Percentile(99)),
+          @"max" : @(snapshot.max),
+        }];
+      });
+  diagnostics[@"stage_latencies"] = latencies;
+
+  NSMutableArray* slowest = [NSMutableArray array];
+  for (const auto& entry : santa::SlowestEvaluations::Shared().Top(10)) {
+    [slowest addObject:@{
+      @"path" : @(entry.path.c_str()) ?: @"",
+      @"count" : @(entry.count),
+      @"max" : @(entry.max_nanos),
+      @"total" : @(entry.total_nanos),
+    }];
+  }
+  diagnostics[@"slowest_evaluations"] = slowest;
+
+  NSMutableDictionary* databases = [NSMutableDictionary dictionary];
+  for (SNTDatabaseTable* table in
+       @[ [SNTDatabaseController ruleTable], [SNTDatabaseController eventTable] ]) {
+    NSString* name = [table isKindOfClass:[SNTRuleTable class]] ? @"Rules" : @"Events";
+    databases[name] = @{
+      @"size" : @([table sizeInBytes]),
+      @"free_page_ratio" : @([table freePageRatio]),
+    };
+  }
+  diagnostics[@"databases"] = databases;
+
+  reply(diagnostics);
+}
+
 - (void)exportMetrics:(void (^)(BOOL))reply {
   if (![[SNTConfigurator configurator] exportMetrics]) {
     reply(NO);
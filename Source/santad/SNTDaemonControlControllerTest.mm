@@ -23,6 +23,7 @@
 
 #import "Source/common/AuditUtilities.h"
 #import "Source/common/MOLXPCConnection.h"
+#import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTError.h"
 #import "Source/common/SNTNetworkFlowRule.h"
 #import "Source/common/SNTRule.h"
@@ -50,6 +51,8 @@ static NSString* const kBinarySHA256 =
 @property id mockRuleTable;
 @property id mockMOLXPC;
 @property SNTDaemonControlController* sut;
+@property int flushCount;
+@property NSSet<NSString*>* invalidatedIdentifiers;
 @end
 
 @implementation SNTDaemonControlControllerTest {
@@ -70,6 +73,7 @@ static NSString* const kBinarySHA256 =
   // connection is currently dispatching (the default in unit tests).
   self.mockMOLXPC = OCMClassMock([MOLXPCConnection class]);
 
+  __weak __typeof(self) weakSelf = self;
   self.sut = [[SNTDaemonControlController alloc] initWithNotificationQueue:nil
       syncdQueue:nil
       netExtensionQueue:nil
@@ -77,6 +81,10 @@ static NSString* const kBinarySHA256 =
       watchItems:nullptr
       sandboxExpectations:_sandboxExpectations
       flushCacheBlock:^(santa::FlushCacheMode, santa::FlushCacheReason) {
+        weakSelf.flushCount++;
+      }
+      invalidateCacheBlock:^(santa::FlushCacheReason, NSSet<NSString*>* identifiers) {
+        weakSelf.invalidatedIdentifiers = identifiers;
       }
       cacheCountBlock:^NSArray<NSNumber*>*() {
         return @[];
@@ -86,7 +94,8 @@ static NSString* const kBinarySHA256 =
       }
       metricsExportBlock:^(void (^)(BOOL)) {
       }
-      binaryUploadController:nullptr];
+      binaryUploadController:nullptr
+      processTree:nullptr];
 }
 
 - (void)tearDown {
@@ -326,6 +335,51 @@ static NSString* const kBinarySHA256 =
   XCTAssertEqual(forwarded.firstObject.ruleId, 101);
 }
 
+- (void)testRuleAddInvalidatesMatchingCacheEntries {
+  SNTRule* rule = [[SNTRule alloc] initWithIdentifier:kBinarySHA256
+                                                state:SNTRuleStateBlock
+                                                 type:SNTRuleTypeBinary];
+  OCMStub([self.mockRuleTable addedRulesShouldFlushDecisionCache:OCMOCK_ANY]).andReturn(YES);
+  OCMStub([self.mockRuleTable addExecutionRules:OCMOCK_ANY
+                                fileAccessRules:OCMOCK_ANY
+                               networkFlowRules:OCMOCK_ANY
+                                    ruleCleanup:SNTRuleCleanupNone
+                                         errors:[OCMArg anyObjectRef]])
+      .andReturn(YES);
+
+  [self.sut databaseRuleAddExecutionRules:@[ rule ]
+                          fileAccessRules:@[]
+                         networkFlowRules:@[]
+                              ruleCleanup:SNTRuleCleanupNone
+                                   source:SNTRuleAddSourceSyncService
+                                    reply:^(BOOL success, NSArray<NSError*>* errors){
+                                    }];
+
+  XCTAssertEqual(self.flushCount, 0);
+  XCTAssertEqualObjects(self.invalidatedIdentifiers, [NSSet setWithObject:kBinarySHA256]);
+}
+
+- (void)testRuleAddWithCleanupFlushesAllCaches {
+  OCMStub([self.mockRuleTable addedRulesShouldFlushDecisionCache:OCMOCK_ANY]).andReturn(NO);
+  OCMStub([self.mockRuleTable addExecutionRules:OCMOCK_ANY
+                                fileAccessRules:OCMOCK_ANY
+                               networkFlowRules:OCMOCK_ANY
+                                    ruleCleanup:SNTRuleCleanupAll
+                                         errors:[OCMArg anyObjectRef]])
+      .andReturn(YES);
+
+  [self.sut databaseRuleAddExecutionRules:@[]
+                          fileAccessRules:@[]
+                         networkFlowRules:@[]
+                              ruleCleanup:SNTRuleCleanupAll
+                                   source:SNTRuleAddSourceSyncService
+                                    reply:^(BOOL success, NSArray<NSError*>* errors){
+                                    }];
+
+  XCTAssertEqual(self.flushCount, 1);
+  XCTAssertNil(self.invalidatedIdentifiers);
+}
+
 // ---- databaseRulesHash: returns three hashes -------------------------
 
 - (void)testDatabaseRulesHashReturnsThreeHashes {
@@ -364,4 +418,43 @@ static NSString* const kBinarySHA256 =
   XCTAssertEqual(got.networkFlow, 7);
 }
 
+// ---- preflightInfo: batches counts, mode and hashes ------------------
+
+- (void)testPreflightInfo {
+  OCMStub([self.mockRuleTable binaryRuleCount]).andReturn(3);
+  OCMStub([self.mockRuleTable networkFlowRuleCount]).andReturn(7);
+  OCMStub([self.mockRuleTable cachedStaticRules]).andReturn(@{});
+  id mockHash = OCMClassMock([SNTRuleTableRulesHash class]);
+  OCMStub([mockHash executionRulesHash]).andReturn(@"exec-hash");
+  OCMStub([mockHash fileAccessRulesHash]).andReturn(@"faa-hash");
+  OCMStub([mockHash networkFlowRulesHash]).andReturn(@"nf-hash");
+  OCMStub([self.mockRuleTable hashOfHashes]).andReturn(mockHash);
+  id mockConfigurator = OCMClassMock([SNTConfigurator class]);
+  OCMStub([mockConfigurator configurator]).andReturn(mockConfigurator);
+  OCMStub([mockConfigurator clientMode]).andReturn(SNTClientModeLockdown);
+
+  __block struct RuleCounts gotCounts = {};
+  __block SNTClientMode gotMode = SNTClientModeUnknown;
+  __block NSString* gotExec = nil;
+  __block NSString* gotFAA = nil;
+  __block NSString* gotNF = nil;
+  [self.sut preflightInfo:^(struct RuleCounts counts, SNTClientMode mode, NSString* exec,
+                            NSString* faa, NSString* nf) {
+    gotCounts = counts;
+    gotMode = mode;
+    gotExec = exec;
+    gotFAA = faa;
+    gotNF = nf;
+  }];
+
+  XCTAssertEqual(gotCounts.binary, 3);
+  XCTAssertEqual(gotCounts.networkFlow, 7);
+  XCTAssertEqual(gotMode, SNTClientModeLockdown);
+  XCTAssertEqualObjects(gotExec, @"exec-hash");
+  XCTAssertEqualObjects(gotFAA, @"faa-hash");
+  XCTAssertEqualObjects(gotNF, @"nf-hash");
+  [mockConfigurator stopMocking];
+  [mockHash stopMocking];
+}
+
 @end
@@ -18,6 +18,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
@@ -26,7 +27,10 @@
 
 static NSString* const kDatabasePath = @"/var/db/santa";
 static NSString* const kRulesDatabaseName = @"rules.db";
+static NSString* const kRulesSnapshotName = @"rules.snapshot";
 static NSString* const kEventsDatabaseName = @"events.db";
+// How often each database checks whether it has free pages to reclaim.
+static const uint64_t kIncrementalVacuumIntervalSeconds = 15 * 60;
 
 + (NSString* const)databasePath {
   return kDatabasePath;
@@ -48,6 +52,7 @@ static NSString* const kEventsDatabaseName = @"events.db";
 #endif
 
     eventDatabase = [[SNTEventTable alloc] initWithDatabaseQueue:dbq];
+    [eventDatabase scheduleIncrementalVacuumWithInterval:kIncrementalVacuumIntervalSeconds];
 
     chown([fullPath UTF8String], 0, 0);
     chmod([fullPath UTF8String], 0600);
@@ -72,9 +77,21 @@ static NSString* const kEventsDatabaseName = @"events.db";
 #endif
 
     ruleDatabase = [[SNTRuleTable alloc] initWithDatabaseQueue:dbq];
+    [ruleDatabase scheduleIncrementalVacuumWithInterval:kIncrementalVacuumIntervalSeconds];
 
     chown([fullPath UTF8String], 0, 0);
     chmod([fullPath UTF8String], 0600);
+
+    uint32_t readConnections = [[SNTConfigurator configurator] ruleDatabaseReadConnections];
+    if (readConnections > 0) {
+      [ruleDatabase enableReadPoolWithMaximumConnections:readConnections];
+    }
+
+    if ([[SNTConfigurator configurator] enableRuleSnapshot]) {
+      NSString* snapshotPath =
+          [[SNTDatabaseController databasePath] stringByAppendingPathComponent:kRulesSnapshotName];
+      [ruleDatabase enableRuleSnapshotAtPath:snapshotPath];
+    }
   });
   return ruleDatabase;
 }
@@ -17,9 +17,12 @@
 
 #import <Foundation/Foundation.h>
 
+#include <memory>
+
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTFileInfo.h"
 #import "Source/common/SantaVnode.h"
+#include "Source/common/processtree/process_tree.h"
 #include "Source/santad/EntitlementsFilter.h"
 
 @interface SNTDecisionCache : NSObject
@@ -30,6 +33,16 @@
 - (SNTCachedDecision*)cachedDecisionForFile:(const struct stat&)statInfo;
 - (SNTCachedDecision*)cachedDecisionForVnode:(SantaVnode)vnode;
 - (void)forgetCachedDecisionForVnode:(SantaVnode)vnode;
+// Approximate bytes used by cached decisions. Interned strings, certificate
+// chains and entitlements shared with other decisions are not included.
+- (uint64_t)approximateBytes;
+// Forget every cached decision, e.g. under memory pressure. Decisions for
+// running executables are rehydrated as they are needed again.
+- (void)forgetAllCachedDecisions;
+// Returns YES if a rule for any of the given identifiers could change the
+// decision for vnode. This is conservative: if no decision is cached for the
+// vnode, the identifiers of the file are unknown and YES is returned.
+- (BOOL)decisionForVnode:(SantaVnode)vnode mayMatchIdentifiers:(NSSet<NSString*>*)identifiers;
 - (SNTCachedDecision*)resetTimestampForCachedDecision:(const struct stat&)statInfo;
 // Must be called exactly once, during daemon initialization, before any
 // rehydrate or backfill caller can run. Subsequent calls trip an assert —
@@ -38,7 +51,11 @@
 // edges established by ES client enablement and the initial backfill
 // dispatch.
 - (void)setEntitlementsFilter:(std::shared_ptr<santa::EntitlementsFilter>)filter;
-- (void)backfillDecisionCacheAsync;
+// Pre-populates the cache with pseudo-decisions for the executables of running
+// processes. Executables are taken from `processTree` if it is set, otherwise
+// from a fresh pid listing. Each distinct executable is evaluated once.
+- (void)backfillDecisionCacheAsyncWithProcessTree:
+    (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree;
 // Synchronously hashes `fi` and inserts a pseudo-decision into the cache.
 // Caller contract: invoke only after observing a cache miss for `fi.vnode`
 // and only when the file is small enough that the SHA-256 fits within the
@@ -53,5 +70,27 @@
 // so repeated calls for the same vnode while a rehydrate is enqueued or
 // running are coalesced.
 - (void)asyncRehydrateAndCacheDecisionForFileInfo:(SNTFileInfo*)fi;
+// Hashes `esFile` on a low priority queue and attaches the SHA-256 to `cd`
+// once it is known, for decisions that were made and responded to without
+// hashing the file. The digest is only attached if the file that was read is
+// still the version described by esFile->stat. Sets cd.pendingSHA256 until
+// the hash completes.
+- (void)computeSHA256InBackgroundForDecision:(SNTCachedDecision*)cd file:(const es_file_t*)esFile;
+// Waits a bounded amount of time for a hash started by
+// computeSHA256InBackgroundForDecision:file: to complete. Returns
+// immediately if none is pending.
+- (void)waitForPendingSHA256OfDecision:(SNTCachedDecision*)cd;
+// Speculatively hashes and reads the code signature of a file that was just
+// written, on a background QoS queue, if it is a Mach-O executable. The digest
+// is stored in the file hash cache and the signing details are cached as a
+// pseudo-decision so the first execution doesn't pay for them inside the AUTH
+// deadline. Repeated calls for the same vnode while one is queued are
+// coalesced onto the most recent version of the file.
+- (void)prefetchDecisionForFile:(const es_file_t*)esFile;
+// Returns the signing identity of a pseudo-decision cached for the exec target,
+// either prefetched or backfilled, but only if its cdhash matches the one ES
+// reported for this exec. The SHA-256 is left out because the code directory
+// doesn't cover the whole file; it is looked up again per version of the file.
+- (SNTCachedDecision*)prefetchedIdentityForTargetProcess:(const es_process_t*)targetProc;
 
 @end
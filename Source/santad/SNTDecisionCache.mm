@@ -21,13 +21,23 @@
 #include <sys/param.h>
 #include <sys/qos.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "Source/common/AuditUtilities.h"
 #include "Source/common/CodeSigningIdentifierUtils.h"
+#include "Source/common/CompactCachedDecision.h"
+#include "Source/common/FileHashCache.h"
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLCodesignChecker.h"
+#include "Source/common/PathInternPool.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTFileInfo.h"
@@ -35,21 +45,44 @@
 #import "Source/common/SNTRule.h"
 #include "Source/common/SantaCache.h"
 #include "Source/common/SantaVnode.h"
+#include "Source/common/SelfProfiler.h"
 #import "Source/common/SigningIDHelpers.h"
+#include "Source/common/Signposts.h"
+#include "Source/common/String.h"
 #include "Source/common/SystemResources.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #import "Source/santad/SNTDatabaseController.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 
 @interface SNTDecisionCache ()
 // Cache for sha256 -> date of last timestamp reset.
 @property NSCache<NSString*, NSDate*>* timestampResetMap;
 @property dispatch_queue_t cachePopulateQ;
+@property dispatch_queue_t deferredHashQ;
+@property dispatch_queue_t prefetchQ;
 @end
 
+// How long telemetry waits for a deferred hash before logging without it
+static const int64_t kPendingSHA256WaitNanos = 1 * NSEC_PER_SEC;
+
+// Upper bound on the number of executables hashed concurrently during backfill
+static const size_t kMaxBackfillWorkers = 4;
+
+// Files larger than this aren't prefetched, reading them would take longer
+// than the first exec is likely to wait for
+static const off_t kMaxPrefetchFileSize = 256 * 1024 * 1024;
+
+// The most recent version of a file waiting to be prefetched
+struct PendingPrefetch {
+  santa::InternedPath path;
+  struct stat sb;
+};
+
 @implementation SNTDecisionCache {
-  SantaCache<SantaVnode, SNTCachedDecision*> _decisionCache;
+  SantaCache<SantaVnode, std::shared_ptr<const santa::CompactCachedDecision>> _decisionCache;
   absl::flat_hash_set<SantaVnode> _pendingRehydrates;
+  absl::flat_hash_map<SantaVnode, PendingPrefetch> _pendingPrefetches;
   os_unfair_lock _pendingLock;
   std::shared_ptr<santa::EntitlementsFilter> _entitlementsFilter;
 }
@@ -93,31 +126,69 @@
         "com.northpolesec.santa.cache-populate-q", DISPATCH_QUEUE_SERIAL,
         dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
 
+    // Hashes deferred off the AUTH EXEC path. Kept separate from the populate queue so a
+    // startup backfill doesn't hold back hashes that telemetry is waiting on.
+    _deferredHashQ = dispatch_queue_create_with_target(
+        "com.northpolesec.santa.deferred-hash-q", DISPATCH_QUEUE_SERIAL,
+        dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+
+    // Speculative work for files that may never be executed, kept out of the
+    // way of everything else.
+    _prefetchQ = dispatch_queue_create_with_target(
+        "com.northpolesec.santa.decision-prefetch-q", DISPATCH_QUEUE_SERIAL,
+        dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0));
+
+    santa::SelfProfiler::Shared().RegisterQueue(_cachePopulateQ, "decision_cache");
+    santa::SelfProfiler::Shared().RegisterQueue(_deferredHashQ, "decision_cache");
+    santa::SelfProfiler::Shared().RegisterQueue(_prefetchQ, "decision_cache");
+
     _pendingLock = OS_UNFAIR_LOCK_INIT;
   }
   return self;
 }
 
 - (bool)cacheDecision:(SNTCachedDecision*)cd {
-  return self->_decisionCache.set(cd.vnodeId, cd);
+  return self->_decisionCache.set(cd.vnodeId, santa::CompactCachedDecision::FromDecision(cd));
 }
 
 - (bool)cacheDecisionIfNotSet:(SNTCachedDecision*)cd {
-  return self->_decisionCache.set(cd.vnodeId, cd, nil);
+  return self->_decisionCache.set(cd.vnodeId, santa::CompactCachedDecision::FromDecision(cd),
+                                  nullptr);
 }
 
 - (SNTCachedDecision*)cachedDecisionForFile:(const struct stat&)statInfo {
-  return self->_decisionCache.get(SantaVnode::VnodeForFile(statInfo));
+  return [self cachedDecisionForVnode:SantaVnode::VnodeForFile(statInfo)];
 }
 
+// Entries are stored in compact form, each lookup returns a new view
 - (SNTCachedDecision*)cachedDecisionForVnode:(SantaVnode)vnode {
-  return self->_decisionCache.get(vnode);
+  std::shared_ptr<const santa::CompactCachedDecision> entry = self->_decisionCache.get(vnode);
+  return entry ? entry->ToDecision() : nil;
 }
 
 - (void)forgetCachedDecisionForVnode:(SantaVnode)vnode {
   self->_decisionCache.remove(vnode);
 }
 
+- (uint64_t)approximateBytes {
+  // Each entry is a CompactCachedDecision allocated with its shared_ptr control block
+  static constexpr uint64_t kEntryBytes = sizeof(santa::CompactCachedDecision) + 16;
+  return self->_decisionCache.approximate_bytes() + self->_decisionCache.count() * kEntryBytes;
+}
+
+- (void)forgetAllCachedDecisions {
+  self->_decisionCache.clear();
+}
+
+- (BOOL)decisionForVnode:(SantaVnode)vnode mayMatchIdentifiers:(NSSet<NSString*>*)identifiers {
+  std::shared_ptr<const santa::CompactCachedDecision> entry = self->_decisionCache.get(vnode);
+  if (!entry) {
+    return YES;
+  }
+
+  return entry->MayMatchIdentifiers(identifiers);
+}
+
 // Whenever a cached decision resulting from a transitive allowlist rule is used to allow the
 // execution of a binary, we update the timestamp on the transitive rule in the rules database.
 // To prevent writing to the database too often, we space out consecutive writes by 3600 seconds.
@@ -161,6 +232,7 @@
 
     cd.teamID = csc.teamID;
     cd.signingID = FormatSigningID(csc);
+    cd.rawSigningID = csc.signingID;
 
     // Ensure that if no teamID exists but a signingID does exist, that the binary
     // is a platform binary. If not, remove the signingID.
@@ -180,7 +252,7 @@
     if (_entitlementsFilter) {
       cd.entitlements = _entitlementsFilter->Filter(
           csc.platformBinary ? santa::kPlatformTeamID.UTF8String : csc.teamID.UTF8String,
-          csc.entitlements);
+          csc.cdhash, csc.entitlements);
       cd.entitlementsFiltered = (cd.entitlements.count != csc.entitlements.count);
     }
 
@@ -229,12 +301,152 @@
   });
 }
 
+- (void)computeSHA256InBackgroundForDecision:(SNTCachedDecision*)cd file:(const es_file_t*)esFile {
+  santa::InternedPath path = santa::PathInternPool::Shared().Intern(
+      std::string_view(esFile->path.data, esFile->path.length));
+  struct stat sb = esFile->stat;
+
+  dispatch_group_t group = dispatch_group_create();
+  cd.pendingSHA256 = group;
+  dispatch_group_async(group, self.deferredHashQ, ^{
+    es_file_t file = {
+        .path = {.length = path.View().length(), .data = path.c_str()},
+        .stat = sb,
+    };
+    SNTFileInfo* fi = [[SNTFileInfo alloc] initWithEndpointSecurityFile:&file error:NULL];
+    [fi SHA256];
+
+    // SNTFileInfo only records a digest in the hash cache after confirming the file it read
+    // still matches the stat it was given, so a digest found there is for the executed version.
+    NSString* sha256;
+    if (santa::FileHashCache::Shared().Lookup(sb, NULL, &sha256)) {
+      cd.sha256 = sha256;
+    }
+    cd.pendingSHA256 = nil;
+
+    // Fold the digest into the cached entry, unless the entry has since been
+    // replaced by a different decision
+    std::shared_ptr<const santa::CompactCachedDecision> entry =
+        self->_decisionCache.get(cd.vnodeId);
+    if (entry && entry->pending_sha256_source() == cd) {
+      self->_decisionCache.set(cd.vnodeId, entry->WithResolvedSHA256(), entry);
+    }
+  });
+}
+
+- (void)waitForPendingSHA256OfDecision:(SNTCachedDecision*)cd {
+  dispatch_group_t group = cd.pendingSHA256;
+  if (!group ||
+      dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, kPendingSHA256WaitNanos)) != 0) {
+    return;
+  }
+
+  // Views returned by the cache don't see the background update, pick up the
+  // digest from the cached entry instead
+  if (!cd.sha256) {
+    std::shared_ptr<const santa::CompactCachedDecision> entry =
+        self->_decisionCache.get(cd.vnodeId);
+    if (entry) {
+      cd.sha256 = entry->SHA256();
+    }
+  }
+  cd.pendingSHA256 = nil;
+}
+
+- (void)prefetchDecisionForFile:(const es_file_t*)esFile {
+  const struct stat& sb = esFile->stat;
+  if (!S_ISREG(sb.st_mode) || sb.st_size == 0 || sb.st_size > kMaxPrefetchFileSize) {
+    return;
+  }
+
+  SantaVnode v = SantaVnode::VnodeForFile(sb);
+  PendingPrefetch pending = {
+      .path = santa::PathInternPool::Shared().Intern(
+          std::string_view(esFile->path.data, esFile->path.length)),
+      .sb = sb,
+  };
+
+  os_unfair_lock_lock(&_pendingLock);
+  bool inserted = _pendingPrefetches.insert_or_assign(v, std::move(pending)).second;
+  os_unfair_lock_unlock(&_pendingLock);
+  if (!inserted) {
+    // Already queued, it will pick up this version of the file
+    return;
+  }
+
+  dispatch_async(self.prefetchQ, ^{
+    os_unfair_lock_lock(&self->_pendingLock);
+    auto node = self->_pendingPrefetches.extract(v);
+    os_unfair_lock_unlock(&self->_pendingLock);
+    if (node.empty()) {
+      return;
+    }
+    const PendingPrefetch& file = node.mapped();
+
+    es_file_t latest = {
+        .path = {.length = file.path.View().length(), .data = file.path.c_str()},
+        .stat = file.sb,
+    };
+    SNTFileInfo* fi = [[SNTFileInfo alloc] initWithEndpointSecurityFile:&latest error:NULL];
+    if (![fi isExecutable]) {
+      return;
+    }
+
+    SNTCachedDecision* cd = [self buildDecisionForFileInfo:fi];
+    if (!cd) {
+      return;
+    }
+
+    // Drop the result if the file was written to again while it was being read
+    struct stat current;
+    if (stat(file.path.c_str(), &current) != 0 ||
+        !santa::FileHashCache::IsSameVersion(current, file.sb)) {
+      return;
+    }
+
+    // Only replace other pseudo-decisions, never a decision that was evaluated
+    std::shared_ptr<const santa::CompactCachedDecision> existing =
+        self->_decisionCache.get(v);
+    if (existing && existing->decision() != SNTEventStateUnknown) {
+      return;
+    }
+    self->_decisionCache.set(v, santa::CompactCachedDecision::FromDecision(cd), existing);
+  });
+}
+
+- (SNTCachedDecision*)prefetchedIdentityForTargetProcess:(const es_process_t*)targetProc {
+  std::shared_ptr<const santa::CompactCachedDecision> entry =
+      self->_decisionCache.get(SantaVnode::VnodeForFile(targetProc->executable));
+  if (!entry || entry->decision() != SNTEventStateUnknown) {
+    return nil;
+  }
+
+  SNTCachedDecision* cd = entry->ToDecision();
+  if (!cd.cdhash.length) {
+    return nil;
+  }
+
+  // A matching cdhash means the signature that was read is the one the kernel validated
+  std::string cdhash = santa::BufToHexString(targetProc->cdhash, sizeof(targetProc->cdhash));
+  if ([cd.cdhash caseInsensitiveCompare:@(cdhash.c_str())] != NSOrderedSame) {
+    return nil;
+  }
+
+  cd.sha256 = nil;
+  return cd;
+}
+
 #ifdef DEBUG
 - (void)waitForCachePopulateQueueForTesting {
   dispatch_sync(self.cachePopulateQ, ^{
                 });
 }
 
+- (void)waitForPrefetchQueueForTesting {
+  dispatch_sync(self.prefetchQ, ^{
+                });
+}
+
 - (NSUInteger)pendingRehydrateCountForTesting {
   os_unfair_lock_lock(&_pendingLock);
   NSUInteger n = _pendingRehydrates.size();
@@ -244,66 +456,122 @@
 #endif
 
 // Backfill the decision cache with pseudo SNTCachedDecision entries. This is done
-// by getting a snapshot of PIDs and populating as much information as possible.
+// by getting a snapshot of running executables and populating as much information as possible.
 // IMPORTANT: Because the processes were not actually evaluated, some bits of
 // information are left in an "unknown" state, such as the client mode and decision.
-- (void)backfillDecisionCacheAsync {
+- (void)backfillDecisionCacheAsyncWithProcessTree:
+    (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree {
   dispatch_async(self.cachePopulateQ, ^{
-    [self backfillDecisionCacheSerialized];
+    [self backfillDecisionCacheSerializedWithProcessTree:processTree];
   });
 }
 
-- (void)backfillDecisionCacheSerialized {
-  std::optional<std::vector<pid_t>> pids = GetPidList();
-  if (!pids) {
-    LOGW(@"Unable to backfill data for running processes");
-    return;
-  }
-
-  size_t backfilled = 0;
-  size_t already_cached = 0;
-  size_t skipped = 0;
-
-  for (pid_t pid : *pids) {
-    if (pid == 0) {
-      skipped++;
-      continue;
-    }
-
-    char pathBuf[MAXPATHLEN] = {};
-    if (proc_pidpath(pid, pathBuf, sizeof(pathBuf)) <= 0) {
-      continue;
+// Returns the distinct executable paths of running processes, along with the
+// number of processes they were collected from
+static std::vector<std::string> RunningExecutables(
+    const std::shared_ptr<santa::santad::process_tree::ProcessTree>& processTree,
+    size_t* numProcs) {
+  absl::flat_hash_set<std::string> paths;
+  *numProcs = 0;
+
+  if (processTree) {
+    // The tree was backfilled at startup, so there is no need to query each pid again
+    processTree->Iterate([&](std::shared_ptr<const santa::santad::process_tree::Process> p) {
+      (*numProcs)++;
+      if (p->pid_.pid != 0 && p->program_ && !p->program_->executable.empty()) {
+        paths.insert(p->program_->executable);
+      }
+    });
+  } else {
+    std::optional<std::vector<pid_t>> pids = GetPidList();
+    if (!pids) {
+      return {};
     }
 
-    SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:@(pathBuf)];
-    if (!fi) {
-      continue;
+    for (pid_t pid : *pids) {
+      (*numProcs)++;
+      char pathBuf[MAXPATHLEN] = {};
+      if (pid == 0 || proc_pidpath(pid, pathBuf, sizeof(pathBuf)) <= 0) {
+        continue;
+      }
+      paths.insert(pathBuf);
     }
+  }
 
-    if ([self cachedDecisionForVnode:fi.vnode]) {
-      already_cached++;
-      continue;
-    }
+  return std::vector<std::string>(paths.begin(), paths.end());
+}
 
-    SNTCachedDecision* cd = [self buildDecisionForFileInfo:fi];
-    if (!cd) {
-      continue;
-    }
+- (void)backfillDecisionCacheSerializedWithProcessTree:
+    (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree {
+  santa::ScopedSignpost signpost(santa::SignpostPhase::kDecisionCacheBackfill);
+  size_t numProcs;
+  std::vector<std::string> paths = RunningExecutables(processTree, &numProcs);
+  if (paths.empty()) {
+    LOGW(@"Unable to backfill data for running processes");
+    return;
+  }
 
-    // cacheDecisionIfNotSet: is a first-writer-wins insert; a false return
-    // means another caller already populated this vnode, so it's effectively
-    // already cached.
-    if ([self cacheDecisionIfNotSet:cd]) {
-      backfilled++;
-    } else {
-      already_cached++;
+  // Shared by the workers below. dispatch_apply doesn't return until they are
+  // done, so they can safely refer to it on the stack.
+  struct {
+    std::atomic<size_t> backfilled{0};
+    std::atomic<size_t> alreadyCached{0};
+    std::atomic<size_t> failed{0};
+    // Different paths can still refer to the same file, e.g. hard links
+    absl::flat_hash_set<SantaVnode> seenVnodes;
+    os_unfair_lock seenLock = OS_UNFAIR_LOCK_INIT;
+  } stateStorage;
+  auto* state = &stateStorage;
+  const std::vector<std::string>* allPaths = &paths;
+
+  // Hashing is mostly I/O bound, so a handful of workers is enough to overlap
+  // it without competing with the rest of the daemon during startup
+  size_t numWorkers = std::min<size_t>(
+      {kMaxBackfillWorkers, [[NSProcessInfo processInfo] activeProcessorCount], paths.size()});
+
+  dispatch_apply(numWorkers, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t worker) {
+    for (size_t i = worker; i < allPaths->size(); i += numWorkers) {
+      @autoreleasepool {
+        SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:@((*allPaths)[i].c_str())];
+        if (!fi) {
+          state->failed++;
+          continue;
+        }
+
+        os_unfair_lock_lock(&state->seenLock);
+        bool inserted = state->seenVnodes.insert(fi.vnode).second;
+        os_unfair_lock_unlock(&state->seenLock);
+        if (!inserted) {
+          continue;
+        }
+
+        if ([self cachedDecisionForVnode:fi.vnode]) {
+          state->alreadyCached++;
+          continue;
+        }
+
+        SNTCachedDecision* cd = [self buildDecisionForFileInfo:fi];
+        if (!cd) {
+          state->failed++;
+          continue;
+        }
+
+        // cacheDecisionIfNotSet: is a first-writer-wins insert; a false return
+        // means another caller already populated this vnode, so it's effectively
+        // already cached.
+        if ([self cacheDecisionIfNotSet:cd]) {
+          state->backfilled++;
+        } else {
+          state->alreadyCached++;
+        }
+      }
     }
-  }
+  });
 
-  LOGI(@"Cache backfill complete. %zu total PIDs, %zu backfilled, %zu already cached, %zu skipped, "
-       @"%zu failed (likely exited)",
-       pids->size(), backfilled, already_cached, skipped,
-       pids->size() - (backfilled + already_cached + skipped));
+  LOGI(@"Cache backfill complete. %zu processes, %zu executables, %zu backfilled, "
+       @"%zu already cached, %zu failed (likely exited)",
+       numProcs, paths.size(), state->backfilled.load(), state->alreadyCached.load(),
+       state->failed.load());
 }
 
 @end
@@ -45,6 +45,7 @@ SNTCachedDecision* MakeCachedDecision(struct stat sb, SNTEventState decision) {
 
 @interface SNTDecisionCache (TestSupport)
 - (void)waitForCachePopulateQueueForTesting;
+- (void)waitForPrefetchQueueForTesting;
 - (NSUInteger)pendingRehydrateCountForTesting;
 - (dispatch_queue_t)cachePopulateQ;
 - (void)resetEntitlementsFilterForTesting;
@@ -85,6 +86,31 @@ SNTCachedDecision* MakeCachedDecision(struct stat sb, SNTEventState decision) {
   XCTAssertNil([dc cachedDecisionForFile:sb]);
 }
 
+- (void)testDecisionMayMatchIdentifiers {
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+
+  struct stat sb = MakeStat(200);
+  SantaVnode vnode = SantaVnode::VnodeForFile(sb);
+
+  // Unknown vnodes are always considered a match
+  XCTAssertTrue([dc decisionForVnode:vnode mayMatchIdentifiers:[NSSet set]]);
+
+  SNTCachedDecision* cd = MakeCachedDecision(sb, SNTEventStateAllowBinary);
+  cd.teamID = @"EQHXZ8M8AV";
+  cd.signingID = @"EQHXZ8M8AV:com.google.Chrome";
+  [dc cacheDecision:cd];
+
+  XCTAssertFalse([dc decisionForVnode:vnode mayMatchIdentifiers:[NSSet set]]);
+  XCTAssertFalse([dc decisionForVnode:vnode mayMatchIdentifiers:[NSSet setWithObject:@"ABCDEF"]]);
+  XCTAssertTrue([dc decisionForVnode:vnode mayMatchIdentifiers:[NSSet setWithObject:cd.sha256]]);
+  XCTAssertTrue([dc decisionForVnode:vnode
+                 mayMatchIdentifiers:[NSSet setWithObject:@"EQHXZ8M8AV"]]);
+  XCTAssertTrue([dc decisionForVnode:vnode
+                 mayMatchIdentifiers:[NSSet setWithObject:@"EQHXZ8M8AV:com.google.Chrome"]]);
+
+  [dc forgetCachedDecisionForVnode:vnode];
+}
+
 - (void)testResetTimestampForCachedDecision {
   SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
   struct stat sb = MakeStat();
@@ -135,7 +161,8 @@ SNTCachedDecision* MakeCachedDecision(struct stat sb, SNTEventState decision) {
   SNTCachedDecision* cached = [dc cachedDecisionForVnode:fi.vnode];
   XCTAssertNotNil(cached);
   XCTAssertEqualObjects(cached.sha256, fi.SHA256);
-  XCTAssertEqual(cached, cd);
+  XCTAssertEqual(cached.vnodeId.fileid, cd.vnodeId.fileid);
+  XCTAssertEqual(cached.decision, cd.decision);
 
   [dc forgetCachedDecisionForVnode:fi.vnode];
   [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
@@ -207,6 +234,113 @@ SNTCachedDecision* MakeCachedDecision(struct stat sb, SNTEventState decision) {
   [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
 }
 
+- (void)testComputeSHA256InBackground {
+  NSString* tmpPath = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"deferred-hash-%@",
+                                                                [[NSUUID UUID] UUIDString]]];
+  NSData* contents = [@"deferred hash" dataUsingEncoding:NSUTF8StringEncoding];
+  XCTAssertTrue([contents writeToFile:tmpPath atomically:YES]);
+  struct stat sb;
+  XCTAssertEqual(stat(tmpPath.UTF8String, &sb), 0);
+
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  NSString* want = [[SNTFileInfo alloc] initWithPath:tmpPath].SHA256;
+
+  es_file_t file = MakeESFile(tmpPath.UTF8String, sb);
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] initWithEndpointSecurityFile:&file];
+  [dc computeSHA256InBackgroundForDecision:cd file:&file];
+  [dc waitForPendingSHA256OfDecision:cd];
+  XCTAssertNil(cd.pendingSHA256);
+  XCTAssertEqualObjects(cd.sha256, want);
+
+  // A file that no longer matches the executed version gets no hash
+  sb.st_mtimespec.tv_sec -= 100;
+  file = MakeESFile(tmpPath.UTF8String, sb);
+  cd = [[SNTCachedDecision alloc] initWithEndpointSecurityFile:&file];
+  [dc computeSHA256InBackgroundForDecision:cd file:&file];
+  [dc waitForPendingSHA256OfDecision:cd];
+  XCTAssertNil(cd.pendingSHA256);
+  XCTAssertNil(cd.sha256);
+
+  // Nothing pending returns immediately
+  [dc waitForPendingSHA256OfDecision:[[SNTCachedDecision alloc] init]];
+
+  [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+}
+
+- (void)testPrefetchDecisionForExecutable {
+  NSString* tmpPath = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"prefetch-%@",
+                                                                [[NSUUID UUID] UUIDString]]];
+  XCTAssertTrue([[NSFileManager defaultManager] copyItemAtPath:@"/usr/bin/true"
+                                                        toPath:tmpPath
+                                                         error:nil]);
+  struct stat sb;
+  XCTAssertEqual(stat(tmpPath.UTF8String, &sb), 0);
+  SantaVnode vnode = SantaVnode::VnodeForFile(sb);
+
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  [dc forgetCachedDecisionForVnode:vnode];
+
+  es_file_t file = MakeESFile(tmpPath.UTF8String, sb);
+  [dc prefetchDecisionForFile:&file];
+  [dc waitForPrefetchQueueForTesting];
+
+  SNTCachedDecision* cached = [dc cachedDecisionForVnode:vnode];
+  XCTAssertNotNil(cached);
+  XCTAssertEqual(cached.decision, SNTEventStateUnknown);
+  XCTAssertNotNil(cached.sha256);
+  XCTAssertNotNil(cached.cdhash);
+  XCTAssertNotNil(cached.rawSigningID);
+
+  // The identity is only handed out when the cdhash matches the exec
+  es_process_t proc = MakeESProcess(&file);
+  XCTAssertNil([dc prefetchedIdentityForTargetProcess:&proc]);
+
+  for (NSUInteger i = 0; i < sizeof(proc.cdhash); i++) {
+    unsigned int byte;
+    sscanf([cached.cdhash substringWithRange:NSMakeRange(i * 2, 2)].UTF8String, "%02x", &byte);
+    proc.cdhash[i] = (uint8_t)byte;
+  }
+  SNTCachedDecision* identity = [dc prefetchedIdentityForTargetProcess:&proc];
+  XCTAssertNotNil(identity);
+  XCTAssertEqualObjects(identity.cdhash, cached.cdhash);
+  XCTAssertEqualObjects(identity.signingID, cached.signingID);
+  XCTAssertNil(identity.sha256);
+
+  // An evaluated decision is never replaced or handed out as a prefetched identity
+  SNTCachedDecision* evaluated = MakeCachedDecision(sb, SNTEventStateAllowBinary);
+  [dc cacheDecision:evaluated];
+  [dc prefetchDecisionForFile:&file];
+  [dc waitForPrefetchQueueForTesting];
+  XCTAssertEqual([dc cachedDecisionForVnode:vnode].decision, SNTEventStateAllowBinary);
+  XCTAssertNil([dc prefetchedIdentityForTargetProcess:&proc]);
+
+  [dc forgetCachedDecisionForVnode:vnode];
+  [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+}
+
+- (void)testPrefetchSkipsNonExecutables {
+  NSString* tmpPath = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"prefetch-text-%@",
+                                                                [[NSUUID UUID] UUIDString]]];
+  NSData* contents = [@"not a binary" dataUsingEncoding:NSUTF8StringEncoding];
+  XCTAssertTrue([contents writeToFile:tmpPath atomically:YES]);
+  struct stat sb;
+  XCTAssertEqual(stat(tmpPath.UTF8String, &sb), 0);
+  SantaVnode vnode = SantaVnode::VnodeForFile(sb);
+
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  [dc forgetCachedDecisionForVnode:vnode];
+
+  es_file_t file = MakeESFile(tmpPath.UTF8String, sb);
+  [dc prefetchDecisionForFile:&file];
+  [dc waitForPrefetchQueueForTesting];
+  XCTAssertNil([dc cachedDecisionForVnode:vnode]);
+
+  [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+}
+
 // Exercises buildDecisionForFileInfo:'s codesign-success branch using a real
 // Apple-signed binary. The temp-file fixtures used by the other tests are
 // unsigned, so this is the only place we verify certSHA256 / cdhash /
@@ -110,14 +110,6 @@ using LogExecutionBlock = void (^)(santa::Message esMsg);
 - (void)validateSuspendResumeEvent:(const santa::Message&)esMsg
                         postAction:(void (^)(bool))postAction;
 
-///
-///  Removes any record of the given process from the sandboxed-seatbelt tracking
-///  cache. Called on process exit (via the tree-aware authorizer) so the cache
-///  stays bounded by the set of live sandboxed seatbelt processes. Safe to call
-///  for processes that were never recorded.
-///
-- (void)forgetSandboxedSeatbeltProc:(const audit_token_t&)token;
-
 ///
 /// Perform light, synchronous processing of the given event to decide whether or not the
 /// event should undergo full processing. The checks done by this function MUST NOT block
@@ -137,4 +129,10 @@ using LogExecutionBlock = void (^)(santa::Message esMsg);
 ///
 - (void)flushTouchIDApprovalCache;
 
+///
+///  Flushes the policy processor's compiled CEL rule expressions. Should be
+///  called when rules change.
+///
+- (void)flushCompiledCELPrograms;
+
 @end
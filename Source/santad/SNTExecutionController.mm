@@ -23,14 +23,18 @@
 #include <sys/param.h>
 #include <utmpx.h>
 
+#include <algorithm>
 #include <cstring>
+#include <iterator>
 #include <memory>
 #include <set>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include "Source/common/BranchPrediction.h"
 #include "Source/common/CodeSigningIdentifierUtils.h"
+#include "Source/common/HotBinaries.h"
 #import "Source/common/MOLCodesignChecker.h"
 #include "Source/common/PrefixTree.h"
 #import "Source/common/SNTBlockMessage.h"
@@ -45,13 +49,16 @@
 #import "Source/common/SNTStoredExecutionEvent.h"
 #include "Source/common/SantaCache.h"
 #include "Source/common/SantaVnode.h"
+#include "Source/common/SlowestEvaluations.h"
 #include "Source/common/String.h"
 #include "Source/common/SystemResources.h"
 #include "Source/common/Unit.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
+#include "Source/common/processtree/annotations/seatbelt.h"
 #include "Source/common/processtree/process.h"
 #include "Source/common/processtree/process_tree.h"
 #include "Source/santad/CELActivation.h"
+#include "Source/santad/ConfigSnapshot.h"
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #import "Source/santad/SNTDecisionCache.h"
@@ -59,6 +66,7 @@
 #import "Source/santad/SNTSyncdQueue.h"
 #include "absl/synchronization/mutex.h"
 
+using santa::ConfigSnapshot;
 using santa::Message;
 using santa::PrefixTree;
 using santa::ProcessControl;
@@ -128,14 +136,6 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
 
   std::shared_ptr<santa::santad::process_tree::ProcessTree> _processTree;
   std::shared_ptr<santa::SandboxExpectations> _sandboxExpectations;
-
-  // Set of (pid, pidversion) of processes Santa authorized as sandboxed seatbelt
-  // processes. Because the OS sandbox is irreversible, membership implies the
-  // process is still sandboxed; it is used to relax the seatbelt requirement
-  // when such a process re-execs the same binary. Keyed like _procSignalCache;
-  // stale entries from exited processes are harmless because (pid, pidversion)
-  // is globally unique and never recurs.
-  std::unique_ptr<SantaCache<std::pair<pid_t, int>, bool>> _sandboxedSeatbeltProcs;
 }
 
 #pragma mark Initializers
@@ -162,7 +162,6 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
     _policyProcessor = policyProcessor;
     _procSignalCache = std::make_unique<SantaCache<std::pair<pid_t, int>, bool>>(100000);
     _touchIDApprovalCache = std::make_unique<SantaCache<std::string, uint64_t>>(100);
-    _sandboxedSeatbeltProcs = std::make_unique<SantaCache<std::pair<pid_t, int>, bool>>(100000);
     _processControlBlock = processControlBlock;
     _processTree = std::move(processTree);
     _sandboxExpectations = std::move(sandboxExpectations);
@@ -254,20 +253,11 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
 
 // Returns YES if `instigator` is, or descends via fork/exec from, a process
 // Santa authorized as a sandboxed seatbelt process. The OS sandbox is inherited
-// by all descendants, so a process that forked — possibly several times, e.g.
-// the classic double-fork daemonization — from a recorded sandboxed seatbelt
-// process is itself sandboxed even though its own (pid, pidversion) was never
-// recorded. The process tree's parent chain is held by shared_ptr, so the
-// ancestry remains walkable even after intermediate ancestors exit.
+// by all descendants, so the SeatbeltAnnotator propagates the mark from the
+// authorized process down through the tree, e.g. across the classic double-fork
+// daemonization. Without a process tree the lineage is unknown, so this fails
+// closed.
 - (BOOL)isSandboxedSeatbeltDescendant:(const es_process_t*)instigator {
-  // Fast path / fallback when the process tree is unavailable: the instigator
-  // itself was recorded (a direct self-exec with no intervening fork).
-  if (_sandboxedSeatbeltProcs->get(
-          std::make_pair(audit_token_to_pid(instigator->audit_token),
-                         audit_token_to_pidversion(instigator->audit_token)))) {
-    return YES;
-  }
-
   if (!_processTree) {
     return NO;
   }
@@ -279,15 +269,20 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
     return NO;
   }
 
-  // RootSlice walks from the process up to the root (it includes the process
-  // itself as the first element).
-  for (const auto& ancestor : _processTree->RootSlice(*proc)) {
-    if (_sandboxedSeatbeltProcs->get(
-            std::make_pair(ancestor->pid_.pid, (int)ancestor->pid_.pidversion))) {
-      return YES;
-    }
+  return santa::santad::process_tree::SeatbeltAnnotator::IsSandboxed(*_processTree, **proc);
+}
+
+- (void)markSandboxedSeatbeltProc:(const es_process_t*)proc {
+  if (!_processTree) {
+    return;
+  }
+
+  auto treeProc = _processTree->Get(santa::santad::process_tree::Pid{
+      .pid = audit_token_to_pid(proc->audit_token),
+      .pidversion = (uint64_t)audit_token_to_pidversion(proc->audit_token)});
+  if (treeProc) {
+    santa::santad::process_tree::SeatbeltAnnotator::MarkSandboxed(*_processTree, **treeProc);
   }
-  return NO;
 }
 
 // Returns YES if `instigator` is executing the same binary as `target`. For
@@ -307,9 +302,32 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   return SameBinary(instigator, instigatorSHA256, target, targetSHA256);
 }
 
-- (void)forgetSandboxedSeatbeltProc:(const audit_token_t&)token {
-  _sandboxedSeatbeltProcs->remove(
-      std::make_pair(audit_token_to_pid(token), audit_token_to_pidversion(token)));
+// Responds to an exec allowed by identityDecisionForTargetProcess:. Such decisions are always
+// allows that are neither held nor uploaded, so only the response and the bookkeeping the full
+// path does for allowed binaries are needed.
+- (void)respondWithIdentityDecision:(SNTCachedDecision*)cd
+                          forTarget:(const es_process_t*)targetProc
+                         postAction:(bool (^)(SNTAction, SNTCachedDecision*))postAction {
+  cd.codesigningFlags = targetProc->codesigning_flags;
+  cd.vnodeId = SantaVnode::VnodeForFile(targetProc->executable);
+
+  SNTAction action = cd.cacheable ? SNTActionRespondAllow : SNTActionRespondAllowNoCache;
+  if (cd.decision == SNTEventStateAllowCompilerBinary ||
+      cd.decision == SNTEventStateAllowCompilerSigningID ||
+      cd.decision == SNTEventStateAllowCompilerCDHash) {
+    action = SNTActionRespondAllowCompiler;
+  }
+
+  // The hash only runs once queued, off the AUTH path. Queue it before the decision is cached
+  // and responded to so that telemetry for this exec always sees the pending hash.
+  SNTDecisionCache* decisionCache = [SNTDecisionCache sharedCache];
+  if (!cd.sha256 && ConfigSnapshot::Current()->enable_deferred_exec_hashing) {
+    [decisionCache computeSHA256InBackgroundForDecision:cd file:targetProc->executable];
+  }
+
+  [decisionCache cacheDecision:cd];
+  postAction(action, cd);
+  [self incrementEventCounters:cd.decision];
 }
 
 - (void)validateExecEvent:(const Message&)esMsg
@@ -323,17 +341,37 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
         format:@"validateExecEvent:postAction: Unexpected event type: %d", esMsg->event_type];
   }
 
-  SNTConfigurator* config = [SNTConfigurator configurator];
-  SNTConfigState* configState = [[SNTConfigState alloc] initWithConfig:config];
+  std::shared_ptr<const ConfigSnapshot> config = ConfigSnapshot::Current();
+  SNTConfigState* configState = config->config_state;
 
   const es_process_t* targetProc = esMsg->event.exec.target;
 
+  // Signed binaries allowed by their identity alone don't need to be opened or hashed. Events
+  // that will be uploaded need the file's details, so those always take the full path.
+  if (!existingDecision && config->enable_identity_only_exec_decisions &&
+      !config->enable_all_event_upload) {
+    SNTCachedDecision* cd = [self.policyProcessor identityDecisionForTargetProcess:targetProc
+                                                                      configState:configState];
+    if (cd) {
+      [self respondWithIdentityDecision:cd forTarget:targetProc postAction:postAction];
+      return;
+    }
+  }
+
+  // Reuse signing details read when the file was written, if they are for this exact code
+  if (!existingDecision && config->enable_speculative_exec_prefetch) {
+    existingDecision =
+        [[SNTDecisionCache sharedCache] prefetchedIdentityForTargetProcess:targetProc];
+  }
+
+  uint64_t evaluationStart = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+
   // Get info about the file. If we can't get this info, respond appropriately and log an error.
   NSError* fileInfoError;
   SNTFileInfo* binInfo = [[SNTFileInfo alloc] initWithEndpointSecurityFile:targetProc->executable
                                                                      error:&fileInfoError];
   if (unlikely(!binInfo)) {
-    if (config.failClosed) {
+    if (config->fail_closed) {
       LOGE(@"Failed to read file %@: %@ and denying action", @(targetProc->executable->path.data),
            fileInfoError.localizedDescription);
       postAction(SNTActionRespondDeny, nil);
@@ -367,8 +405,22 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
                                                  activationCallback:activationBlock
                                                      cachedDecision:existingDecision];
 
+  uint64_t evaluationNanos = clock_gettime_nsec_np(CLOCK_MONOTONIC) - evaluationStart;
+  std::string_view targetPath(targetProc->executable->path.data,
+                              targetProc->executable->path.length);
+  santa::SlowestEvaluations::Shared().Record(targetPath, evaluationNanos);
+
+  // Unsigned binaries have no cdhash, so fall back to attributing their cost by path
+  bool hasCDHash = std::any_of(std::begin(targetProc->cdhash), std::end(targetProc->cdhash),
+                               [](uint8_t b) { return b != 0; });
+  santa::HotBinaries::Shared().Record(
+      hasCDHash ? santa::BufToHexString(targetProc->cdhash, sizeof(targetProc->cdhash))
+                : std::string(targetPath),
+      targetPath, evaluationNanos);
+
   cd.codesigningFlags = targetProc->codesigning_flags;
   cd.vnodeId = SantaVnode::VnodeForFile(targetProc->executable);
+  cd.cacheEUID = audit_token_to_euid(targetProc->audit_token);
 
   // Seatbelt expectation check: the sandboxed exec is authorized iff
   // santactl pre-registered an expectation for the caller's audit token,
@@ -386,7 +438,7 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   //
   // Transitive sandbox relaxation: the OS sandbox is transitive and
   // irreversible, so a process Santa already authorized as a sandboxed seatbelt
-  // process (recorded in _sandboxedSeatbeltProcs) — or any process that forked
+  // process (marked by the SeatbeltAnnotator) — or any process that forked
   // from it, possibly several times (e.g. double-fork daemonization), and is
   // still running that same binary's image — stays under the profile originally
   // applied for that binary. Such a re-exec carries no expectation (santactl is
@@ -395,7 +447,7 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   // seatbelt-required binary would inherit an unrelated profile and must still
   // go through santactl. Membership can only be seeded by first passing the
   // expectation check, so this introduces no new trust boundary. See
-  // -isSandboxedSeatbeltDescendant: for the fork-aware ancestry walk.
+  // -isSandboxedSeatbeltDescendant: for the fork-aware lineage lookup.
   //
   // Cache safety: flipping the decision here must not let a later exec of
   // the same vnode be auto-allowed without re-checking its expectation.
@@ -433,12 +485,11 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
 
     if (authorized) {
       cd.decision = BlockToAllowDecision(cd.decision);
-      // Record the now-sandboxed target so it may later re-exec itself. Covers
-      // both the expectation path (santactl -> binary) and the relaxed path.
-      _sandboxedSeatbeltProcs->set(
-          std::make_pair(audit_token_to_pid(targetProc->audit_token),
-                         audit_token_to_pidversion(targetProc->audit_token)),
-          true);
+      // Mark the now-sandboxed target so it and its descendants may later
+      // re-exec it. Covers both the expectation path (santactl -> binary) and
+      // the relaxed path. The tree handled this exec before it was evaluated,
+      // so the target's new image is already present.
+      [self markSandboxedSeatbeltProc:targetProc];
     }
   }
 
@@ -505,8 +556,8 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   [self incrementEventCounters:cd.decision];
 
   // Log to database if necessary.
-  if (config.enableAllEventUpload ||
-      (cd.decision == SNTEventStateAllowUnknown && !config.disableUnknownEventUpload) ||
+  if (config->enable_all_event_upload ||
+      (cd.decision == SNTEventStateAllowUnknown && !config->disable_unknown_event_upload) ||
       cd.auditReturn || (cd.decision & SNTEventStateAllow) == 0) {
     SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] init];
     se.occurrenceDate = [[NSDate alloc] init];
@@ -560,22 +611,22 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
     se.quarantineAgentBundleID = binInfo.quarantineAgentBundleID;
 
     // Only store events if there is a sync server configured.
-    if (config.syncBaseURL) {
+    if (config->has_sync_base_url) {
       dispatch_async(_eventQueue, ^{
-        [self.eventTable addStoredEvent:se];
+        [self.eventTable stageStoredEvent:se];
       });
     }
 
     // If binary was blocked, do the needful
     if (action != SNTActionRespondAllow && action != SNTActionRespondAllowCompiler &&
         action != SNTActionRespondAllowNoCache) {
-      if (config.enableBundles && binInfo.bundle) {
+      if (config->enable_bundles && binInfo.bundle) {
         // If the binary is part of a bundle, find and hash all the related binaries in the bundle.
         // Let the GUI know hashing is needed. Once the hashing is complete the GUI will send a
         // message to santad to perform the upload logic for bundles.
         // See syncBundleEvent:relatedEvents: for more info.
         se.needsBundleHash = YES;
-      } else if (config.syncBaseURL) {
+      } else if (config->has_sync_base_url) {
         // So the server has something to show the user straight away, initiate an event
         // upload for the blocked binary rather than waiting for the next sync.
         dispatch_async(_eventQueue, ^{
@@ -610,7 +661,7 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
                             se.parentName, se.ppid];
           NSURL* detailURL =
               [SNTBlockMessage eventDetailURLForEvent:se
-                                            customURL:(cd.customURL ?: config.eventDetailURL)];
+                                            customURL:(cd.customURL ?: config->event_detail_url)];
           if (detailURL) {
             [msg appendFormat:@"More info:\n%@\n", detailURL.absoluteString];
           }
@@ -680,7 +731,7 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
         // Let the user know what happened in the GUI.
         [self.notifierQueue addEvent:se
                    withCustomMessage:cd.customMsg
-                           customURL:cd.customURL ?: config.eventDetailURL
+                           customURL:cd.customURL ?: config->event_detail_url
                          configState:configState
                             andReply:replyBlock];
       }
@@ -788,4 +839,8 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   _touchIDApprovalCache->clear();
 }
 
+- (void)flushCompiledCELPrograms {
+  [self.policyProcessor flushCompiledCELPrograms];
+}
+
 @end
@@ -17,6 +17,7 @@
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 #include <dispatch/dispatch.h>
+#include "Source/common/processtree/annotations/seatbelt.h"
 #include "Source/common/processtree/process.h"
 #include "Source/common/processtree/process_tree.h"
 #include "Source/common/processtree/process_tree_test_helpers.h"
@@ -291,7 +292,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
 // Builds an SNTExecutionController backed by the given process tree, sharing the
 // same mocks and sandbox expectations as the default `self.sut`. Used by the
-// fork-descendant tests, which need a populated process tree (the default
+// seatbelt lineage tests, which need a populated process tree (the default
 // `self.sut` is built with a nullptr tree).
 - (SNTExecutionController*)makeControllerWithProcessTree:
     (std::shared_ptr<santa::santad::process_tree::ProcessTree>)tree {
@@ -312,6 +313,27 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
                                        sandboxExpectations:_sandboxExpectations];
 }
 
+// Replaces `self.sut` with a controller backed by a process tree that tracks
+// seatbelt lineage and contains each of the given processes, forked from init.
+// The tree-aware authorizer adds an exec target to the tree before the exec is
+// evaluated, so targets the tests expect to be marked must be present.
+- (std::shared_ptr<santa::santad::process_tree::ProcessTreeTestPeer>)useSeatbeltProcessTreeWith:
+    (std::vector<santa::santad::process_tree::Pid>)pids {
+  using namespace santa::santad::process_tree;
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  annotators.emplace_back(std::make_unique<SeatbeltAnnotator>());
+  auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  std::shared_ptr<const Process> init = tree->InsertInit();
+
+  uint64_t eventId = 1;
+  for (const Pid& pid : pids) {
+    tree->HandleFork(eventId++, *init, pid);
+  }
+
+  self.sut = [self makeControllerWithProcessTree:tree];
+  return tree;
+}
+
 - (void)stubRule:(SNTRule*)rule forIdentifiers:(struct RuleIdentifiers)wantIdentifiers {
   OCMStub([self.mockRuleDatabase executionRuleForIdentifiers:wantIdentifiers])
       .ignoringNonObjectArgs()
@@ -479,6 +501,52 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   [self checkMetricCounters:kAllowSigningID expected:@1];
 }
 
+- (void)testIdentityOnlyDecisionSkipsFileInfo {
+  // The file can't be read, so only a decision made without it can allow the exec
+  [self.mockFileInfo stopMocking];
+  self.mockFileInfo = OCMClassMock([SNTFileInfo class]);
+  OCMStub([self.mockFileInfo alloc]).andReturn(nil);
+  OCMStub([self.mockConfigurator failClosed]).andReturn(YES);
+  OCMStub([self.mockConfigurator enableIdentityOnlyExecDecisions]).andReturn(YES);
+
+  SNTRule* rule = [[SNTRule alloc] init];
+  rule.state = SNTRuleStateAllow;
+  rule.type = SNTRuleTypeSigningID;
+  OCMStub([self.mockRuleDatabase executionRuleForIdentityIdentifiers:(struct RuleIdentifiers){}])
+      .ignoringNonObjectArgs()
+      .andReturn(rule);
+
+  [self validateExecEvent:SNTActionRespondAllow
+             messageSetup:^(es_message_t* msg) {
+               msg->event.exec.target->signing_id = MakeESStringToken(kExampleSigningID);
+               msg->event.exec.target->team_id = MakeESStringToken(kExampleTeamID);
+             }];
+  [self checkMetricCounters:kAllowSigningID expected:@1];
+}
+
+- (void)testIdentityOnlyDecisionFallsBackForBlockRule {
+  [self.mockFileInfo stopMocking];
+  self.mockFileInfo = OCMClassMock([SNTFileInfo class]);
+  OCMStub([self.mockFileInfo alloc]).andReturn(nil);
+  OCMStub([self.mockConfigurator failClosed]).andReturn(YES);
+  OCMStub([self.mockConfigurator enableIdentityOnlyExecDecisions]).andReturn(YES);
+
+  // Blocks are uploaded and shown to the user, which needs the file
+  SNTRule* rule = [[SNTRule alloc] init];
+  rule.state = SNTRuleStateBlock;
+  rule.type = SNTRuleTypeSigningID;
+  OCMStub([self.mockRuleDatabase executionRuleForIdentityIdentifiers:(struct RuleIdentifiers){}])
+      .ignoringNonObjectArgs()
+      .andReturn(rule);
+
+  [self validateExecEvent:SNTActionRespondDeny
+             messageSetup:^(es_message_t* msg) {
+               msg->event.exec.target->signing_id = MakeESStringToken(kExampleSigningID);
+               msg->event.exec.target->team_id = MakeESStringToken(kExampleTeamID);
+             }];
+  [self checkMetricCounters:kDenyNoFileInfo expected:@1];
+}
+
 - (void)testSigningIDBlockRule {
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateBlock;
@@ -557,7 +625,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
   [self stubRule:rule forIdentifiers:{.certificateSHA256 = @"a"}];
 
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase stageStoredEvent:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondDeny];
 
@@ -622,7 +690,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"a"}];
 
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase stageStoredEvent:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondDeny];
 
@@ -667,7 +735,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"a"}];
 
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase stageStoredEvent:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondDeny];
 
@@ -728,7 +796,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   OCMStub([self.mockFileInfo SHA256]).andReturn(@"a");
 
   OCMExpect([self.mockConfigurator clientMode]).andReturn(SNTClientModeMonitor);
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase stageStoredEvent:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondAllow];
 
@@ -785,7 +853,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 - (void)testPageZero {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
   OCMStub([self.mockFileInfo isMissingPageZero]).andReturn(YES);
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase stageStoredEvent:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondDeny];
   OCMVerifyAllWithDelay(self.mockEventDatabase, 1);
@@ -797,7 +865,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   OCMStub([self.mockFileInfo SHA256]).andReturn(@"a");
 
   OCMExpect([self.mockConfigurator enableAllEventUpload]).andReturn(YES);
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase stageStoredEvent:OCMOCK_ANY]);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateAllow;
@@ -818,7 +886,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   OCMExpect([self.mockConfigurator disableUnknownEventUpload]).andReturn(YES);
 
   [self validateExecEvent:SNTActionRespondAllow];
-  OCMVerify(never(), [self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMVerify(never(), [self.mockEventDatabase stageStoredEvent:OCMOCK_ANY]);
   [self checkMetricCounters:kAllowUnknown expected:@1];
 }
 
@@ -1384,7 +1452,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 // ---------------- Transitive sandbox relaxation (self-exec) ----------------
 
 // A binary launched under seatbelt (expectation path) that re-execs itself is
-// allowed without a new expectation: it is recorded as sandboxed, and the
+// allowed without a new expectation: it is marked as sandboxed, and the
 // re-exec is a self-exec.
 - (void)testSeatbeltSandboxedSelfExecAllows {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
@@ -1394,11 +1462,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self useSeatbeltProcessTreeWith:{{.pid = 501, .pidversion = 1}}];
   // No cached decision for the instigator -> relaxation uses the (dev, ino) fallback.
   [self stubInstigatorSHA256:nil];
 
-  // Call 1: santactl -> binary authorizes via expectation and records the
-  // sandboxed target token (501, 1).
+  // Call 1: santactl -> binary authorizes via expectation and marks the
+  // sandboxed target (501, 1).
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
                msg->process->audit_token = santa::MakeStubAuditToken(500, 1);
@@ -1412,7 +1481,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
                                               MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
              }];
 
-  // Call 2: the recorded process (now the instigator (501, 1)) re-execs the
+  // Call 2: the marked process (now the instigator (501, 1)) re-execs the
   // same binary (matching dev/ino) with no expectation -> relaxed.
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
@@ -1437,7 +1506,8 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   [self stubRule:rule
       forIdentifiers:{.cdhash = @"7777777777777777777777777777777777777777", .binarySHA256 = @"a"}];
 
-  // Call 1: authorize via strict expectation, recording target token (511, 1).
+  [self useSeatbeltProcessTreeWith:{{.pid = 511, .pidversion = 1}}];
+  // Call 1: authorize via strict expectation, marking target (511, 1).
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
                uint8_t cdhash[20];
@@ -1452,7 +1522,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
                    MakeSandboxRequest(/*dev=*/0, /*ino=*/0, cdhash, /*sha256=*/nil));
              }];
 
-  // Call 2: recorded process (511, 1) re-execs the same binary (matching
+  // Call 2: marked process (511, 1) re-execs the same binary (matching
   // cdhash, both strictly enforced) with no expectation -> relaxed.
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
@@ -1490,7 +1560,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
              }];
 }
 
-// A recorded sandboxed process exec'ing a *different* seatbelt binary is denied:
+// A marked sandboxed process exec'ing a *different* seatbelt binary is denied:
 // the relaxation is limited to self-exec.
 - (void)testSeatbeltSandboxedNonSelfExecDenies {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
@@ -1500,10 +1570,11 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self useSeatbeltProcessTreeWith:{{.pid = 531, .pidversion = 1}}];
   // No cached decision for the instigator -> relaxation uses the (dev, ino) fallback.
   [self stubInstigatorSHA256:nil];
 
-  // Call 1: record sandboxed target token (531, 1).
+  // Call 1: mark sandboxed target (531, 1).
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
                msg->process->audit_token = santa::MakeStubAuditToken(530, 1);
@@ -1517,7 +1588,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
                                               MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
              }];
 
-  // Call 2: instigator (531, 1) is recorded, but the target is a different
+  // Call 2: instigator (531, 1) is marked, but the target is a different
   // binary (different dev/ino) -> not a self-exec -> denied.
   [self validateExecEvent:SNTActionRespondDeny
              messageSetup:^(es_message_t* msg) {
@@ -1533,11 +1604,13 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
 // A process that forks (possibly several times -- the classic double-fork
 // daemonization) from a sandboxed seatbelt process and then re-execs the same
-// binary is allowed, even though the forked descendant's own (pid, pidversion)
-// was never recorded. The ancestry walk finds the recorded sandboxed ancestor.
+// binary is allowed, even though the forked descendant itself was never
+// marked. It inherits the mark of its sandboxed ancestor through the tree.
 - (void)testSeatbeltSandboxedForkedDescendantSelfExecAllows {
   using namespace santa::santad::process_tree;
-  auto tree = std::make_shared<ProcessTreeTestPeer>(std::vector<std::unique_ptr<Annotator>>{});
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  annotators.emplace_back(std::make_unique<SeatbeltAnnotator>());
+  auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
   std::shared_ptr<const Process> init = tree->InsertInit();
 
   uint64_t eventId = 1;
@@ -1563,7 +1636,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   // No cached decision for the instigator -> relaxation uses the (dev, ino) fallback.
   [self stubInstigatorSHA256:nil];
 
-  // Call 1: B is authorized via expectation; its token (600, 1) is recorded.
+  // Call 1: B is authorized via expectation and (600, 1) is marked.
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
                msg->process->audit_token = santa::MakeStubAuditToken(599, 1);
@@ -1578,7 +1651,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
              }];
 
   // Call 2: the double-forked descendant D (602, 3) re-execs the same binary
-  // with no expectation -> relaxed via ancestry to recorded B.
+  // with no expectation -> relaxed via the mark inherited from B.
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
                msg->process->audit_token = santa::MakeStubAuditToken(602, 3);
@@ -1591,12 +1664,13 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
              }];
 }
 
-// A descendant of a process Santa never recorded as sandboxed is denied: the
-// ancestry walk finds no recorded ancestor, so the transitive guarantee does
-// not hold.
+// A descendant of a process Santa never marked as sandboxed is denied: no
+// ancestor carries the mark, so the transitive guarantee does not hold.
 - (void)testSeatbeltForkedDescendantOfUnsandboxedDenies {
   using namespace santa::santad::process_tree;
-  auto tree = std::make_shared<ProcessTreeTestPeer>(std::vector<std::unique_ptr<Annotator>>{});
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  annotators.emplace_back(std::make_unique<SeatbeltAnnotator>());
+  auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
   std::shared_ptr<const Process> init = tree->InsertInit();
 
   uint64_t eventId = 1;
@@ -1615,7 +1689,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   rule.type = SNTRuleTypeBinary;
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
 
-  // No ancestor was recorded -> C (701, 2) self-exec is denied.
+  // No ancestor was marked -> C (701, 2) self-exec is denied.
   [self validateExecEvent:SNTActionRespondDeny
              messageSetup:^(es_message_t* msg) {
                msg->process->audit_token = santa::MakeStubAuditToken(701, 2);
@@ -1638,10 +1712,11 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self useSeatbeltProcessTreeWith:{{.pid = 701, .pidversion = 1}}];
   // Cached instigator hash matches the target's SHA-256 (@"cafebabe").
   [self stubInstigatorSHA256:@"cafebabe"];
 
-  // Call 1: record sandboxed target token (701, 1).
+  // Call 1: mark sandboxed target (701, 1).
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
                msg->process->audit_token = santa::MakeStubAuditToken(700, 1);
@@ -1669,9 +1744,11 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
              }];
 }
 
-// After a process exits (forgetSandboxedSeatbeltProc:), a subsequent self-exec of
-// the same (pid, pidversion) is no longer relaxed.
-- (void)testForgetSandboxedSeatbeltProcDenies {
+// A target missing from the process tree cannot be marked, so its later
+// self-exec is not relaxed: the lineage lookup fails closed.
+- (void)testSeatbeltTargetMissingFromTreeNotMarked {
+  [self useSeatbeltProcessTreeWith:{}];
+
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
   OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
 
@@ -1679,8 +1756,10 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubInstigatorSHA256:nil];
 
-  // Call 1: record sandboxed target token (801, 1).
+  // Call 1: the expectation still authorizes target (801, 1), but there is no
+  // tree entry to mark.
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
                msg->process->audit_token = santa::MakeStubAuditToken(800, 1);
@@ -1694,11 +1773,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
                                               MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
              }];
 
-  // Evict the recorded process, as the tree-aware authorizer does on its exit.
-  audit_token_t exited = santa::MakeStubAuditToken(801, 1);
-  [self.sut forgetSandboxedSeatbeltProc:exited];
-
-  // Call 2: the now-forgotten (801, 1) re-execs -> no longer relaxed -> denied.
+  // Call 2: (801, 1) re-execs the same binary -> not relaxed -> denied.
   [self validateExecEvent:SNTActionRespondDeny
              messageSetup:^(es_message_t* msg) {
                msg->process->audit_token = santa::MakeStubAuditToken(801, 1);
@@ -185,9 +185,7 @@ NSString* const kSantaNetworkExtensionProtocolVersion = @"1.0";
       .tv_nsec = static_cast<long>((endSecs - static_cast<time_t>(endSecs)) * NSEC_PER_SEC),
   };
 
-  for (SNDProcessFlows* pf in processFlows) {
-    _logger->LogNetworkFlows(pf, windowStartTS, windowEndTS);
-  }
+  _logger->LogNetworkFlows(processFlows, windowStartTS, windowEndTS);
 }
 
 - (SNTNetworkExtensionSettings*)handleRegistrationWithProtocolVersion:(NSString*)protocolVersion
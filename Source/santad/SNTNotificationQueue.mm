@@ -19,14 +19,24 @@
 
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/RingBuffer.h"
+#import "Source/common/SNTBlockNotification.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTStrengthify.h"
 #import "Source/common/SNTXPCNotifierInterface.h"
 
+// Notifications without a reply block are held for this long before being sent so that repeated
+// blocks of the same binary can be coalesced and the rest sent to the GUI in a single batch.
+static const int64_t kCoalesceWindowNanos = 500 * NSEC_PER_MSEC;
+
+// Maximum number of notifications with a reply block that have been sent to the GUI and not yet
+// answered. Further notifications wait in the ring buffer until a reply frees up a slot.
+static const NSUInteger kMaxInFlightNotifications = 16;
+
 @interface SNTNotificationQueue ()
 @property dispatch_queue_t pendingQueue;
 @property NSMutableArray* sentToUser;
+@property BOOL flushScheduled;
 @end
 
 @implementation SNTNotificationQueue {
@@ -70,6 +80,11 @@
   [d setValue:[replyBlock copy] forKey:@"reply"];
 
   dispatch_sync(self.pendingQueue, ^{
+    // Hold and ask notifications each have a process waiting on them, only coalesce the others.
+    if (!replyBlock && [self coalesceEventSerialized:event]) {
+      return;
+    }
+
     NSDictionary* msg = _pendingNotifications->Enqueue(d).value_or(nil);
 
     if (msg != nil) {
@@ -83,6 +98,47 @@
       }
     }
 
+    if (replyBlock) {
+      [self flushQueueSerialized];
+    } else {
+      [self scheduleFlushSerialized];
+    }
+  });
+}
+
+/// If a pending notification without a reply block is for the same binary and user, bump its
+/// repeat count and return YES.
+- (BOOL)coalesceEventSerialized:(SNTStoredExecutionEvent*)event {
+  if (!event.fileSHA256) {
+    return NO;
+  }
+
+  for (NSMutableDictionary* d : *_pendingNotifications) {
+    if (d[@"reply"]) {
+      continue;
+    }
+
+    SNTStoredExecutionEvent* pending = d[@"event"];
+    if ([pending.fileSHA256 isEqualToString:event.fileSHA256] &&
+        (pending.executingUser == event.executingUser ||
+         [pending.executingUser isEqualToString:event.executingUser])) {
+      d[@"repeatCount"] = @(MAX([d[@"repeatCount"] unsignedIntegerValue], 1) + 1);
+      return YES;
+    }
+  }
+  return NO;
+}
+
+- (void)scheduleFlushSerialized {
+  if (self.flushScheduled) {
+    return;
+  }
+  self.flushScheduled = YES;
+
+  WEAKIFY(self);
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kCoalesceWindowNanos), self.pendingQueue, ^{
+    STRONGIFY(self);
+    self.flushScheduled = NO;
     [self flushQueueSerialized];
   });
 }
@@ -121,8 +177,13 @@
     return;
   }
 
+  // Notifications without a reply block are sent together after the loop.
+  NSMutableArray<SNTBlockNotification*>* batch = [NSMutableArray array];
+  // Notifications waiting for an in-flight slot, put back in the ring buffer after the loop.
+  NSMutableArray<NSMutableDictionary*>* waiting = [NSMutableArray array];
+
   while (!_pendingNotifications->Empty()) {
-    NSDictionary* d = _pendingNotifications->Dequeue().value_or(nil);
+    NSMutableDictionary* d = _pendingNotifications->Dequeue().value_or(nil);
     if (!d) {
       // This shouldn't ever be possible, but bail just in case.
       return;
@@ -130,10 +191,18 @@
 
     NotificationReplyBlock replyBlock = d[@"reply"];
     if (replyBlock == nil) {
-      // The reply block sent to the GUI cannot be nil. Provide one now if one was not given.
-      // The copy is necessary so the block is on the heap.
-      replyBlock = [^(BOOL _) {
-      } copy];
+      [batch addObject:[[SNTBlockNotification alloc]
+                           initWithEvent:d[@"event"]
+                           customMessage:d[@"message"]
+                               customURL:d[@"url"]
+                             configState:d[@"config"]
+                             repeatCount:MAX([d[@"repeatCount"] unsignedIntegerValue], 1)]];
+      continue;
+    }
+
+    if (self.sentToUser.count >= kMaxInFlightNotifications) {
+      [waiting addObject:d];
+      continue;
     }
 
     // Track the object we're going to send to the user and wrap the call to
@@ -147,6 +216,8 @@
       if (self) {
         dispatch_sync(self.pendingQueue, ^{
           [self.sentToUser removeObject:d];
+          // Send anything that was waiting for a free slot.
+          [self flushQueueSerialized];
         });
       }
       replyBlock(authenticated);
@@ -158,6 +229,15 @@
                    configState:d[@"config"]
                       andReply:wrappedReplyBlock];
   }
+
+  // The ring buffer was just drained so re-enqueueing will not drop anything.
+  for (NSMutableDictionary* d in waiting) {
+    _pendingNotifications->Enqueue(d);
+  }
+
+  if (batch.count) {
+    [rop postBlockNotifications:batch];
+  }
 }
 
 - (void)setNotifierConnection:(MOLXPCConnection*)notifierConnection {
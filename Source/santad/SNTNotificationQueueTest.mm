@@ -21,6 +21,7 @@
 #include <memory>
 
 #import "Source/common/MOLXPCConnection.h"
+#import "Source/common/SNTBlockNotification.h"
 #import "Source/common/SNTConfigState.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTXPCNotifierInterface.h"
@@ -234,6 +235,92 @@
   OCMVerifyAll(self.mockProxy);
 }
 
+- (void)testRepeatedEventsAreCoalescedAndBatched {
+  SNTStoredExecutionEvent* se1 = [[SNTStoredExecutionEvent alloc] init];
+  se1.fileSHA256 = @"aaaa";
+  se1.executingUser = @"nobody";
+  SNTStoredExecutionEvent* se2 = [[SNTStoredExecutionEvent alloc] init];
+  se2.fileSHA256 = @"bbbb";
+  se2.executingUser = @"nobody";
+
+  XCTestExpectation* batchExpectation = [self expectationWithDescription:@"Batch posted"];
+  __block NSArray<SNTBlockNotification*>* batch;
+  OCMStub([self.mockProxy postBlockNotifications:OCMOCK_ANY])
+      .andDo(^(NSInvocation* invocation) {
+        __unsafe_unretained NSArray* notifications;
+        [invocation getArgument:&notifications atIndex:2];
+        batch = notifications;
+        [batchExpectation fulfill];
+      });
+
+  for (SNTStoredExecutionEvent* se in @[ se1, se2, se1, se1 ]) {
+    [self.sut addEvent:se withCustomMessage:nil customURL:nil configState:nil andReply:nil];
+  }
+
+  // Nothing is sent until the coalescing window has passed.
+  XCTAssertNil(batch);
+
+  [self waitForExpectationsWithTimeout:3.0 handler:nil];
+
+  XCTAssertEqual(batch.count, 2);
+  XCTAssertEqualObjects(batch[0].event, se1);
+  XCTAssertEqual(batch[0].repeatCount, 3);
+  XCTAssertEqualObjects(batch[1].event, se2);
+  XCTAssertEqual(batch[1].repeatCount, 1);
+  XCTAssertTrue(self.ringbuf->Empty());
+
+  OCMVerify(never(), [self.mockProxy postBlockNotification:OCMOCK_ANY
+                                         withCustomMessage:OCMOCK_ANY
+                                                 customURL:OCMOCK_ANY
+                                               configState:OCMOCK_ANY
+                                                  andReply:OCMOCK_ANY]);
+}
+
+- (void)testInFlightNotificationsAreCapped {
+  auto rb = std::make_unique<santa::RingBuffer<NSMutableDictionary*>>(32);
+  santa::RingBuffer<NSMutableDictionary*>* ringbuf = rb.get();
+  SNTNotificationQueue* sut = [[SNTNotificationQueue alloc] initWithRingBuffer:std::move(rb)];
+  sut.notifierConnection = self.mockConnection;
+
+  XCTestExpectation* lastPosted = [self expectationWithDescription:@"Waiting event posted"];
+  NSMutableArray* replies = [NSMutableArray array];
+  OCMStub([self.mockProxy postBlockNotification:OCMOCK_ANY
+                              withCustomMessage:OCMOCK_ANY
+                                      customURL:OCMOCK_ANY
+                                    configState:OCMOCK_ANY
+                                       andReply:OCMOCK_ANY])
+      .andDo(^(NSInvocation* invocation) {
+        void (^__unsafe_unretained replyBlock)(BOOL);
+        [invocation getArgument:&replyBlock atIndex:6];
+        [replies addObject:[replyBlock copy]];
+        if (replies.count == 17) {
+          [lastPosted fulfill];
+        }
+      });
+
+  for (int i = 0; i < 17; i++) {
+    [sut addEvent:[[SNTStoredExecutionEvent alloc] init]
+        withCustomMessage:nil
+                customURL:nil
+              configState:nil
+                 andReply:^(BOOL) {
+                 }];
+  }
+
+  // Only 16 notifications can be waiting on the GUI, the last one stays queued.
+  XCTAssertEqual(replies.count, 16);
+  XCTAssertFalse(ringbuf->Empty());
+
+  // Answering one frees up a slot for it.
+  void (^firstReply)(BOOL) = replies[0];
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    firstReply(YES);
+  });
+
+  [self waitForExpectationsWithTimeout:3.0 handler:nil];
+  XCTAssertTrue(ringbuf->Empty());
+}
+
 - (void)testClearAllPendingWithRepliesSerialized {
   SNTStoredExecutionEvent* se1 = [[SNTStoredExecutionEvent alloc] init];
   SNTStoredExecutionEvent* se2 = [[SNTStoredExecutionEvent alloc] init];
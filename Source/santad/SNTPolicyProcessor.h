@@ -66,6 +66,18 @@ using ActivationCallbackBlock =
                                    (nullable ActivationCallbackBlock)activationCallback
                                    cachedDecision:(nullable SNTCachedDecision*)existingDecision;
 
+///
+///  Attempts a decision for a validly signed target using only the CDHash, Signing ID and Team ID
+///  reported by EndpointSecurity, without opening or hashing the file.
+///
+///  @return An allow decision, or nil if a Binary or Certificate rule could still change the
+///          outcome, the matching rule needs the file to be evaluated, or the binary would not
+///          be allowed. Callers must then fall back to decisionForFileInfo:.
+///
+- (nullable SNTCachedDecision*)
+    identityDecisionForTargetProcess:(nonnull const es_process_t*)targetProc
+                         configState:(nonnull SNTConfigState*)configState;
+
 ///
 /// Updates a decision for a given file and agent configuration.
 ///
@@ -75,4 +87,16 @@ using ActivationCallbackBlock =
          withTransitiveRules:(BOOL)transitive
     andCELActivationCallback:(nullable ActivationCallbackBlock)activationCallback;
 
+///
+/// Drops all compiled CEL rule expressions. Should be called when rules change
+/// so that plans for expressions no longer in use are released.
+///
+- (void)flushCompiledCELPrograms;
+
+///
+/// Approximate bytes allocated by the arenas backing compiled CEL expressions
+/// and the CEL compilers.
+///
+- (uint64_t)compiledCELBytes;
+
 @end
@@ -21,8 +21,13 @@
 #import <Security/SecCode.h>
 #import <Security/Security.h>
 
+#include <atomic>
+#include <memory>
+
 #import "Source/common/CertificateHelpers.h"
 #include "Source/common/CodeSigningIdentifierUtils.h"
+#include "Source/common/FileHashCache.h"
+#include "Source/common/LatencyHistogram.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/SNTCELFallbackRule.h"
 #import "Source/common/SNTCachedDecision.h"
@@ -32,10 +37,14 @@
 #import "Source/common/SNTKVOManager.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTRule.h"
+#include "Source/common/SelfProfiler.h"
 #import "Source/common/SigningIDHelpers.h"
 #include "Source/common/String.h"
 #include "Source/common/cel/Evaluator.h"
+#include "Source/common/cel/ProgramCache.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
+#include "Source/santad/ConfigSnapshot.h"
+#import "Source/santad/SNTDecisionCache.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
 #include "cel/v1.pb.h"
@@ -70,20 +79,30 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
   std::unique_ptr<santa::cel::Evaluator<false>> celEvaluatorV1_;
   std::unique_ptr<santa::cel::Evaluator<true>> celEvaluatorV2_;
   std::shared_ptr<santa::EntitlementsFilter> entitlementsFilter_;
-  // Arena used for constant folding during compilation of fallback rules.
-  // Declared before celFallbackRules_ so that C++ reverse destruction
-  // order destroys rules first, then the arena they reference.
-  std::shared_ptr<google::protobuf::Arena> celFallbackArena_;
   struct CompiledFallbackRule {
     std::shared_ptr<::google::api::expr::runtime::CelExpression> expression;
     NSString* customMsg;
     NSString* customURL;
+    // False if the rule is known to never make a decision for unsigned binaries
+    bool matchesUnsigned;
+  };
+  // An immutable set of compiled fallback rules. It is replaced as a whole
+  // when the rules change so evaluation never waits on compilation.
+  struct CompiledFallbackRules {
+    // Used for constant folding during compilation. Declared before rules so
+    // that C++ reverse destruction order destroys rules first, then the arena
+    // they reference.
+    google::protobuf::Arena arena;
+    std::vector<CompiledFallbackRule> rules;
+    bool anyMatchesUnsigned = false;
   };
-  std::vector<CompiledFallbackRule> celFallbackRules_;
+  // Only accessed with std::atomic_load/std::atomic_store
+  std::shared_ptr<const CompiledFallbackRules> celFallbackRules_;
+  // Compiled plans for rule-level CEL expressions
+  std::unique_ptr<santa::cel::ProgramCache> celProgramCache_;
 }
 @property SNTRuleTable* ruleTable;
 @property SNTConfigurator* configurator;
-@property dispatch_queue_t celFallbackQueue;
 @property SNTKVOManager* celFallbackRulesObserver;
 @end
 
@@ -110,8 +129,7 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
            std::string(evaluatorV2.status().message()).c_str());
     }
 
-    _celFallbackQueue =
-        dispatch_queue_create("com.northpolesec.santa.cel_fallback", DISPATCH_QUEUE_SERIAL);
+    celProgramCache_ = std::make_unique<santa::cel::ProgramCache>();
 
     // Pre-compile any existing fallback rules
     [self compileFallbackRules:_configurator.celFallbackRules];
@@ -152,35 +170,75 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
     return;
   }
 
-  // Create a fresh arena for this batch of compiled rules.
-  // The arena must outlive the compiled plans since constant folding stores
-  // data on it.
-  __block auto arena = std::make_shared<google::protobuf::Arena>();
-  __block std::vector<CompiledFallbackRule> compiled;
-  compiled.reserve(rules.count);
-  bool compileFailed = false;
+  auto compiled = std::make_shared<CompiledFallbackRules>();
+  compiled->rules.reserve(rules.count);
   for (SNTCELFallbackRule* rule in rules) {
-    auto result =
-        celEvaluatorV2_->Compile(santa::NSStringToUTF8StringView(rule.celExpr), arena.get());
-    if (result.ok()) {
-      compiled.push_back({std::move(*result), rule.customMsg, rule.customURL});
-    } else {
+    santa::cel::ExecAttributes referenced = 0;
+    auto result = celEvaluatorV2_->Compile(santa::NSStringToUTF8StringView(rule.celExpr),
+                                           &compiled->arena, &referenced);
+    if (!result.ok()) {
       LOGE(@"Failed to compile CEL fallback expression '%@': %s", rule.celExpr,
            std::string(result.status().message()).c_str());
-      compileFailed = true;
-      break;
+      return;
     }
+
+    std::shared_ptr<::google::api::expr::runtime::CelExpression> expression = std::move(*result);
+    bool matchesUnsigned = [self fallbackExpressionMatchesUnsigned:expression.get()
+                                              referencedAttributes:referenced];
+    compiled->anyMatchesUnsigned |= matchesUnsigned;
+    compiled->rules.push_back({expression, rule.customMsg, rule.customURL, matchesUnsigned});
   }
 
-  if (compileFailed) {
-    return;
+  std::atomic_store_explicit(&celFallbackRules_,
+                             std::shared_ptr<const CompiledFallbackRules>(std::move(compiled)),
+                             std::memory_order_release);
+}
+
+// Unsigned binaries have no signing information, so all of them present the
+// same target. An expression that reads nothing but the target therefore has
+// the same result for every unsigned binary and can be evaluated once here.
+- (bool)fallbackExpressionMatchesUnsigned:
+            (const ::google::api::expr::runtime::CelExpression*)expression
+                     referencedAttributes:(santa::cel::ExecAttributes)referenced {
+  if (referenced != 0) {
+    return true;
+  }
+
+  using Traits = santa::cel::CELProtoTraits<true>;
+  santa::cel::Activation<true> activation(
+      std::make_unique<Traits::ExecutableFileT>(),
+      ^std::vector<std::string>() {
+        return {};
+      },
+      ^std::map<std::string, std::string>() {
+        return {};
+      },
+      ^uid_t() {
+        return 0;
+      },
+      ^std::string() {
+        return "";
+      },
+      ^std::string() {
+        return "";
+      },
+      ^std::vector<Traits::AncestorT>() {
+        return {};
+      },
+      ^std::vector<Traits::FileDescriptorT>() {
+        return {};
+      });
+
+  google::protobuf::Arena evalArena;
+  auto result = celEvaluatorV2_->Evaluate(expression, activation, &evalArena);
+  if (!result.ok()) {
+    // Evaluation errors can still make a decision when failing closed
+    return true;
   }
 
-  dispatch_sync(self.celFallbackQueue, ^{
-    // Release old rules before the old arena (order matters).
-    celFallbackRules_ = std::move(compiled);
-    celFallbackArena_ = std::move(arena);
-  });
+  // Neither result makes a decision from a fallback rule
+  return result->value != Traits::ReturnValue::UNSPECIFIED &&
+         result->value != Traits::ReturnValue::SEATBELT;
 }
 
 - (BOOL)evaluateCELFallbackExpressions:(SNTCachedDecision*)cd
@@ -189,17 +247,16 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
     return NO;
   }
 
-  // Snapshot the compiled rules and arena under the lock so their
-  // lifetimes extend through evaluation even if compileFallbackRules
-  // swaps them concurrently.
-  __block std::vector<CompiledFallbackRule> rules;
-  __block std::shared_ptr<google::protobuf::Arena> arenaRef;
-  dispatch_sync(self.celFallbackQueue, ^{
-    rules = celFallbackRules_;
-    arenaRef = celFallbackArena_;
-  });
+  // Holding a reference keeps the rules and their arena alive through
+  // evaluation even if compileFallbackRules replaces them concurrently.
+  std::shared_ptr<const CompiledFallbackRules> compiled =
+      std::atomic_load_explicit(&celFallbackRules_, std::memory_order_acquire);
+  if (!compiled || compiled->rules.empty()) {
+    return NO;
+  }
 
-  if (rules.empty()) {
+  bool isUnsigned = (cd.signingStatus == SNTSigningStatusUnsigned);
+  if (isUnsigned && !compiled->anyMatchesUnsigned) {
     return NO;
   }
 
@@ -208,8 +265,12 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
   // Use a stack-local arena for evaluation temporaries.
   google::protobuf::Arena evalArena;
 
-  for (size_t i = 0; i < rules.size(); ++i) {
-    CELEvaluationResult celResult = [self evaluateCompiledCELExpression:rules[i].expression.get()
+  for (const CompiledFallbackRule& rule : compiled->rules) {
+    if (isUnsigned && !rule.matchesUnsigned) {
+      continue;
+    }
+
+    CELEvaluationResult celResult = [self evaluateCompiledCELExpression:rule.expression.get()
                                                                   useV2:true
                                                          cachedDecision:cd
                                                              activation:*activation
@@ -227,8 +288,8 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
                    celResult.resultState == SNTRuleStateAllowCompiler)
                       ? SNTEventStateAllowCELFallback
                       : SNTEventStateBlockCELFallback;
-    cd.customMsg = rules[i].customMsg;
-    cd.customURL = rules[i].customURL;
+    cd.customMsg = rule.customMsg;
+    cd.customURL = rule.customURL;
     return YES;
   }
 
@@ -242,6 +303,10 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
                        activation:(const ::google::api::expr::runtime::BaseActivation&)activation
                         evalArena:(google::protobuf::Arena*)evalArena
                 inFallbackContext:(BOOL)inFallbackContext {
+  // Policy decisions are only made for executions
+  santa::ScopedStageLatency latency(santa::LatencyStage::kCELEvaluation, ES_EVENT_TYPE_AUTH_EXEC);
+  santa::SelfProfiler::ScopedSubsystem subsystem("cel");
+
   int returnValue = 0;
   bool cacheable = true;
   std::optional<uint64_t> touchIDCooldownMinutes;
@@ -254,7 +319,7 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
     if (!evalResult.ok()) {
       LOGE(@"Failed to evaluate CEL expression: %s",
            std::string(evalResult.status().message()).c_str());
-      if ([SNTConfigurator configurator].failClosed) {
+      if (santa::ConfigSnapshot::Current()->fail_closed) {
         cd.decision = SNTEventStateBlockUnknown;
         return {.succeeded = false, .decisionMade = true, .resultState = {}};
       }
@@ -272,7 +337,7 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
     if (!evalResult.ok()) {
       LOGE(@"Failed to evaluate CEL expression: %s",
            std::string(evalResult.status().message()).c_str());
-      if ([SNTConfigurator configurator].failClosed) {
+      if (santa::ConfigSnapshot::Current()->fail_closed) {
         cd.decision = SNTEventStateBlockUnknown;
         return {.succeeded = false, .decisionMade = true, .resultState = {}};
       }
@@ -365,42 +430,86 @@ struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd) {
   bool useV2 = (rule.state == SNTRuleStateCELv2);
   auto activation = activationCallback(useV2);
 
-  google::protobuf::Arena arena;
+  google::protobuf::Arena evalArena;
 
   if ((useV2 && !celEvaluatorV2_) || (!useV2 && !celEvaluatorV1_)) {
     LOGE(@"CEL v%d evaluator unavailable", useV2 ? 2 : 1);
-    if ([SNTConfigurator configurator].failClosed) {
+    if (santa::ConfigSnapshot::Current()->fail_closed) {
       cd.decision = SNTEventStateBlockUnknown;
       return {.succeeded = false, .decisionMade = true, .resultState = {}};
     }
     return {.succeeded = false, .decisionMade = false, .resultState = {}};
   }
 
-  absl::StatusOr<std::unique_ptr<::google::api::expr::runtime::CelExpression>> compileResult;
+  santa::cel::ProgramCache::CompileFunction compile;
   if (useV2) {
     assert(dynamic_cast<santa::cel::Activation<true>*>(activation.get()) != nullptr);
-    compileResult = celEvaluatorV2_->Compile(santa::NSStringToUTF8StringView(rule.celExpr), &arena);
+    compile = [evaluator = celEvaluatorV2_.get()](absl::string_view expr,
+                                                  google::protobuf::Arena* arena,
+                                                  santa::cel::ExecAttributes* referenced) {
+      return evaluator->Compile(expr, arena, referenced);
+    };
   } else {
     assert(dynamic_cast<santa::cel::Activation<false>*>(activation.get()) != nullptr);
-    compileResult = celEvaluatorV1_->Compile(santa::NSStringToUTF8StringView(rule.celExpr), &arena);
+    compile = [evaluator = celEvaluatorV1_.get()](absl::string_view expr,
+                                                  google::protobuf::Arena* arena,
+                                                  santa::cel::ExecAttributes* referenced) {
+      return evaluator->Compile(expr, arena, referenced);
+    };
   }
 
-  if (!compileResult.ok()) {
+  auto program =
+      celProgramCache_->GetOrCompile(santa::NSStringToUTF8StringView(rule.celExpr), useV2, compile);
+  if (!program.ok()) {
     LOGE(@"Failed to compile CEL rule (%@): %s", rule.celExpr,
-         std::string(compileResult.status().message()).c_str());
-    if ([SNTConfigurator configurator].failClosed) {
+         std::string(program.status().message()).c_str());
+    if (santa::ConfigSnapshot::Current()->fail_closed) {
       cd.decision = SNTEventStateBlockUnknown;
       return {.succeeded = false, .decisionMade = true, .resultState = {}};
     }
     return {.succeeded = false, .decisionMade = false, .resultState = {}};
   }
 
-  return [self evaluateCompiledCELExpression:compileResult->get()
-                                       useV2:useV2
-                              cachedDecision:cd
-                                  activation:*activation
-                                   evalArena:&arena
-                           inFallbackContext:NO];
+  BOOL wasCacheable = cd.cacheable;
+  uint64_t start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  CELEvaluationResult result = [self evaluateCompiledCELExpression:(*program)->plan.get()
+                                                             useV2:useV2
+                                                    cachedDecision:cd
+                                                        activation:*activation
+                                                         evalArena:&evalArena
+                                                 inFallbackContext:NO];
+  santa::cel::ProgramCache::RecordEvaluation(clock_gettime_nsec_np(CLOCK_MONOTONIC) - start);
+
+  // A result that read per-exec attributes can't be cached for the file. If the EUID is the only
+  // one the expression could have read, the result still holds for other execs by the same user.
+  // TouchID and seatbelt results must be re-checked on every exec.
+  if (result.succeeded && wasCacheable && !cd.cacheable && !cd.holdAndAsk &&
+      result.resultState != SNTRuleStateSeatbelt &&
+      ((*program)->referenced & ~santa::cel::kExecAttributeEuid) == 0) {
+    cd.cacheableForEUID = YES;
+  }
+  return result;
+}
+
+- (void)flushCompiledCELPrograms {
+  celProgramCache_->Flush();
+}
+
+- (uint64_t)compiledCELBytes {
+  uint64_t bytes = celProgramCache_->ApproximateBytes();
+  if (celEvaluatorV1_) {
+    bytes += celEvaluatorV1_->ArenaBytes();
+  }
+  if (celEvaluatorV2_) {
+    bytes += celEvaluatorV2_->ArenaBytes();
+  }
+
+  std::shared_ptr<const CompiledFallbackRules> fallbackRules =
+      std::atomic_load_explicit(&celFallbackRules_, std::memory_order_acquire);
+  if (fallbackRules) {
+    bytes += fallbackRules->arena.SpaceAllocated();
+  }
+  return bytes;
 }
 
 // This method applies the rules to the cached decision object.
@@ -565,6 +674,16 @@ static void UpdateCachedDecisionSigningInfo(
   cd.signingTime = csInfo.signingTime;
 }
 
+// Transitive rules for compiler output are committed to the rule table in batches. Until then,
+// the compiler controller caches a pending decision for the file holding the hash it was written
+// with, which is honored only if the file being executed still has that hash.
+- (BOOL)hasPendingTransitiveRuleForFile:(SNTFileInfo*)fileInfo sha256:(NSString*)sha256 {
+  SNTCachedDecision* pending =
+      [[SNTDecisionCache sharedCache] cachedDecisionForVnode:fileInfo.vnode];
+  return pending.decision == SNTEventStateAllowPendingTransitive &&
+         [pending.sha256 isEqualToString:sha256];
+}
+
 - (nonnull SNTCachedDecision*)
            decisionForFileInfo:(nonnull SNTFileInfo*)fileInfo
                    configState:(nonnull SNTConfigState*)configState
@@ -584,6 +703,7 @@ static void UpdateCachedDecisionSigningInfo(
   }
 
   if (!cd.sha256) {
+    santa::ScopedStageLatency latency(santa::LatencyStage::kHashing, ES_EVENT_TYPE_AUTH_EXEC);
     cd.sha256 = fileInfo.SHA256;
   }
   cd.signingStatus = signingStatusCallback();
@@ -610,18 +730,26 @@ static void UpdateCachedDecisionSigningInfo(
     }
   }
 
-  SNTRule* rule = [self.ruleTable executionRuleForIdentifiers:CreateRuleIDs(cd)];
+  SNTRule* rule;
+  {
+    santa::ScopedStageLatency latency(santa::LatencyStage::kRuleLookup, ES_EVENT_TYPE_AUTH_EXEC);
+    rule = [self.ruleTable executionRuleForIdentifiers:CreateRuleIDs(cd)];
+  }
   if (rule) {
     // If we have a rule match we don't need to process any further.
     if ([self decision:cd
                              forRule:rule
-                 withTransitiveRules:self.configurator.enableTransitiveRules
+                 withTransitiveRules:santa::ConfigSnapshot::Current()->enable_transitive_rules
             andCELActivationCallback:activationCallback]) {
       return cd;
     }
+  } else if (santa::ConfigSnapshot::Current()->enable_transitive_rules &&
+             [self hasPendingTransitiveRuleForFile:fileInfo sha256:cd.sha256]) {
+    cd.decision = SNTEventStateAllowPendingTransitive;
+    return cd;
   }
 
-  if ([[SNTConfigurator configurator] enableBadSignatureProtection] && csInfoError &&
+  if (santa::ConfigSnapshot::Current()->enable_bad_signature_protection && csInfoError &&
       csInfoError.code != errSecCSUnsigned) {
     cd.decisionExtra =
         [NSString stringWithFormat:@"Blocked due to signature error: %ld", (long)csInfoError.code];
@@ -661,6 +789,60 @@ static void UpdateCachedDecisionSigningInfo(
   }
 }
 
+// Fills in the signing identity EndpointSecurity reported for the target and returns the team ID
+// to use when filtering its entitlements.
+static const char* PopulateIdentityFromTargetProcess(SNTCachedDecision* cd,
+                                                     const es_process_t* targetProc) {
+  const char* entitlementsFilterTeamID = NULL;
+
+  if (targetProc->codesigning_flags & CS_SIGNED && targetProc->codesigning_flags & CS_VALID) {
+    if (targetProc->signing_id.length > 0) {
+      if (targetProc->team_id.length > 0) {
+        entitlementsFilterTeamID = targetProc->team_id.data;
+        cd.teamID = [NSString stringWithUTF8String:targetProc->team_id.data];
+        cd.signingID = [NSString
+            stringWithFormat:@"%@:%@", cd.teamID,
+                             [NSString stringWithUTF8String:targetProc->signing_id.data]];
+      } else if (targetProc->is_platform_binary) {
+        entitlementsFilterTeamID = "platform";
+        cd.signingID = [NSString
+            stringWithFormat:@"platform:%@",
+                             [NSString stringWithUTF8String:targetProc->signing_id.data]];
+      }
+    }
+
+    // Only consider the CDHash for processes where the kernel will
+    // refuse invalid pages or kill the process if a page is loaded that
+    // does not match its CodeDirectory slot hash.
+    if (santa::CdhashStrictlyEnforced(targetProc->codesigning_flags)) {
+      static NSString* const kCDHashFormatString = @"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x"
+                                                    "%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x";
+
+      const uint8_t* buf = targetProc->cdhash;
+      cd.cdhash = [[NSString alloc]
+          initWithFormat:kCDHashFormatString, buf[0], buf[1], buf[2], buf[3], buf[4], buf[5],
+                         buf[6], buf[7], buf[8], buf[9], buf[10], buf[11], buf[12], buf[13],
+                         buf[14], buf[15], buf[16], buf[17], buf[18], buf[19]];
+    }
+  }
+
+  return entitlementsFilterTeamID;
+}
+
+static SNTSigningStatus SigningStatusForCodesigningFlags(uint32_t csFlags) {
+  if ((csFlags & CS_SIGNED) == 0) {
+    return SNTSigningStatusUnsigned;
+  } else if ((csFlags & CS_VALID) == 0) {
+    return SNTSigningStatusInvalid;
+  } else if ((csFlags & CS_ADHOC) == CS_ADHOC) {
+    return SNTSigningStatusAdhoc;
+  } else if ((csFlags & CS_DEV_CODE) == CS_DEV_CODE) {
+    return SNTSigningStatusDevelopment;
+  } else {
+    return SNTSigningStatusProduction;
+  }
+}
+
 - (nonnull SNTCachedDecision*)decisionForFileInfo:(nonnull SNTFileInfo*)fileInfo
                                     targetProcess:(nonnull const es_process_t*)targetProc
                                       configState:(nonnull SNTConfigState*)configState
@@ -686,37 +868,7 @@ static void UpdateCachedDecisionSigningInfo(
     }
   } else {
     cd = [[SNTCachedDecision alloc] init];
-
-    if (targetProc->codesigning_flags & CS_SIGNED && targetProc->codesigning_flags & CS_VALID) {
-      if (targetProc->signing_id.length > 0) {
-        if (targetProc->team_id.length > 0) {
-          entitlementsFilterTeamID = targetProc->team_id.data;
-          cd.teamID = [NSString stringWithUTF8String:targetProc->team_id.data];
-          cd.signingID = [NSString
-              stringWithFormat:@"%@:%@", cd.teamID,
-                               [NSString stringWithUTF8String:targetProc->signing_id.data]];
-        } else if (targetProc->is_platform_binary) {
-          entitlementsFilterTeamID = "platform";
-          cd.signingID = [NSString
-              stringWithFormat:@"platform:%@",
-                               [NSString stringWithUTF8String:targetProc->signing_id.data]];
-        }
-      }
-
-      // Only consider the CDHash for processes where the kernel will
-      // refuse invalid pages or kill the process if a page is loaded that
-      // does not match its CodeDirectory slot hash.
-      if (santa::CdhashStrictlyEnforced(targetProc->codesigning_flags)) {
-        static NSString* const kCDHashFormatString = @"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x"
-                                                      "%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x";
-
-        const uint8_t* buf = targetProc->cdhash;
-        cd.cdhash = [[NSString alloc]
-            initWithFormat:kCDHashFormatString, buf[0], buf[1], buf[2], buf[3], buf[4], buf[5],
-                           buf[6], buf[7], buf[8], buf[9], buf[10], buf[11], buf[12], buf[13],
-                           buf[14], buf[15], buf[16], buf[17], buf[18], buf[19]];
-      }
-    }
+    entitlementsFilterTeamID = PopulateIdentityFromTargetProcess(cd, targetProc);
   }
 
   return [self decisionForFileInfo:fileInfo
@@ -724,25 +876,70 @@ static void UpdateCachedDecisionSigningInfo(
       cachedDecision:cd
       platformBinaryState:pbs
       signingStatusCallback:^SNTSigningStatus {
-        uint32_t csFlags = targetProc->codesigning_flags;
-        if ((csFlags & CS_SIGNED) == 0) {
-          return SNTSigningStatusUnsigned;
-        } else if ((csFlags & CS_VALID) == 0) {
-          return SNTSigningStatusInvalid;
-        } else if ((csFlags & CS_ADHOC) == CS_ADHOC) {
-          return SNTSigningStatusAdhoc;
-        } else if ((csFlags & CS_DEV_CODE) == CS_DEV_CODE) {
-          return SNTSigningStatusDevelopment;
-        } else {
-          return SNTSigningStatusProduction;
-        }
+        return SigningStatusForCodesigningFlags(targetProc->codesigning_flags);
       }
       activationCallback:activationCallback
       entitlementsFilterCallback:^NSDictionary*(NSDictionary* entitlements) {
-        return entitlementsFilter_->Filter(entitlementsFilterTeamID, entitlements);
+        return entitlementsFilter_->Filter(entitlementsFilterTeamID, cd.cdhash, entitlements);
       }];
 }
 
+- (nullable SNTCachedDecision*)
+    identityDecisionForTargetProcess:(nonnull const es_process_t*)targetProc
+                         configState:(nonnull SNTConfigState*)configState {
+  uint32_t csFlags = targetProc->codesigning_flags;
+  if ((csFlags & CS_SIGNED) == 0 || (csFlags & CS_VALID) == 0) {
+    return nil;
+  }
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  PopulateIdentityFromTargetProcess(cd, targetProc);
+  if (!cd.cdhash && !cd.signingID && !cd.teamID) {
+    return nil;
+  }
+
+  SNTCachedDecision* systemCd = [self.ruleTable.criticalSystemBinaries[cd.signingID] copy];
+  if (systemCd) {
+    systemCd.decisionClientMode = configState.clientMode;
+    return systemCd;
+  }
+
+  cd.signingStatus = SigningStatusForCodesigningFlags(csFlags);
+  cd.platformBinary = targetProc->is_platform_binary;
+  cd.decisionClientMode = configState.clientMode;
+
+  SNTRule* rule;
+  {
+    santa::ScopedStageLatency latency(santa::LatencyStage::kRuleLookup, ES_EVENT_TYPE_AUTH_EXEC);
+    rule = [self.ruleTable executionRuleForIdentityIdentifiers:CreateRuleIDs(cd)];
+  }
+
+  // CEL rules are evaluated against the code signature, seatbelt rules can
+  // need the file's SHA-256 and transitive rules are only ever binary rules.
+  switch (rule.state) {
+    case SNTRuleStateAllow:
+    case SNTRuleStateAllowCompiler:
+    case SNTRuleStateAllowLocalSigningID: break;
+    default: return nil;
+  }
+
+  if (![self decision:cd
+                           forRule:rule
+               withTransitiveRules:santa::ConfigSnapshot::Current()->enable_transitive_rules
+          andCELActivationCallback:nil] ||
+      (cd.decision & SNTEventStateAllow) == 0) {
+    return nil;
+  }
+
+  // Logged without a file hash unless one is already known for this version of the file
+  NSString* sha256;
+  if (santa::FileHashCache::Shared().Lookup(targetProc->executable->stat, NULL, &sha256)) {
+    cd.sha256 = sha256;
+  }
+
+  return cd;
+}
+
 ///
 ///  Checks whether the file at @c path is in-scope for checking with Santa.
 ///
@@ -756,7 +953,7 @@ static void UpdateCachedDecisionSigningInfo(
   if (!fi) return nil;
 
   // Determine if file is within an allowed path
-  NSRegularExpression* re = [[SNTConfigurator configurator] allowedPathRegex];
+  NSRegularExpression* re = santa::ConfigSnapshot::Current()->allowed_path_regex;
   if ([re numberOfMatchesInString:fi.path options:0 range:NSMakeRange(0, fi.path.length)]) {
     return @"Allowed Path Regex";
   }
@@ -772,12 +969,12 @@ static void UpdateCachedDecisionSigningInfo(
 - (NSString*)fileIsScopeBlocked:(SNTFileInfo*)fi {
   if (!fi) return nil;
 
-  NSRegularExpression* re = [[SNTConfigurator configurator] blockedPathRegex];
+  NSRegularExpression* re = santa::ConfigSnapshot::Current()->blocked_path_regex;
   if ([re numberOfMatchesInString:fi.path options:0 range:NSMakeRange(0, fi.path.length)]) {
     return @"Blocked Path Regex";
   }
 
-  if ([[SNTConfigurator configurator] enablePageZeroProtection] && fi.isMissingPageZero) {
+  if (santa::ConfigSnapshot::Current()->enable_page_zero_protection && fi.isMissingPageZero) {
     return @"Missing __PAGEZERO";
   }
 
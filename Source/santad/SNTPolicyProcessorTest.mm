@@ -31,11 +31,14 @@
 #import "Source/common/SNTRuleIdentifiers.h"
 #import "Source/common/TestUtils.h"
 #import "Source/common/cel/Activation.h"
+#include "Source/common/cel/ProgramCache.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/EntitlementsFilter.h"
 
 #include "cel/v1.pb.h"
 
+using santa::cel::ProgramCache;
+
 extern struct RuleIdentifiers CreateRuleIDs(SNTCachedDecision* cd);
 
 @interface SNTPolicyProcessor (Testing)
@@ -770,6 +773,7 @@ BOOL RuleIdentifiersAreEqual(struct RuleIdentifiers r1, struct RuleIdentifiers r
     XCTAssertEqual(cd.decision, SNTEventStateAllowBinary);
     XCTAssertFalse(cd.silentBlock);
     XCTAssertFalse(cd.cacheable);
+    XCTAssertFalse(cd.cacheableForEUID);
   }
   {
     SNTRule* r = createCELRule(@"has(envs.ENV_VARIABLE1)", false);
@@ -806,6 +810,8 @@ BOOL RuleIdentifiersAreEqual(struct RuleIdentifiers r1, struct RuleIdentifiers r
     XCTAssertEqual(cd.decision, SNTEventStateBlockBinary);
     XCTAssertFalse(cd.silentBlock);
     XCTAssertFalse(cd.cacheable);
+    // The EUID is the only per-exec attribute the expression reads
+    XCTAssertTrue(cd.cacheableForEUID);
   }
   {
     SNTRule* r = createCELRule(@"cwd != '/Users/foo'", false);
@@ -831,6 +837,7 @@ BOOL RuleIdentifiersAreEqual(struct RuleIdentifiers r1, struct RuleIdentifiers r
     XCTAssertTrue(cd.holdAndAsk);
     XCTAssertFalse(cd.silentBlock);
     XCTAssertFalse(cd.cacheable);
+    XCTAssertFalse(cd.cacheableForEUID);
   }
   {
     // CELv2 expression returning SEATBELT: rule starts at the block state for
@@ -875,6 +882,35 @@ BOOL RuleIdentifiersAreEqual(struct RuleIdentifiers r1, struct RuleIdentifiers r
     XCTAssertTrue(cd.seatbeltRequired);
     XCTAssertFalse(cd.cacheable);
   }
+  {
+    // Compiled expressions are reused until the cache is flushed
+    ProgramCache::GetStats(true);
+    SNTRule* r = createCELRule(@"target.signing_time > timestamp(1717987000)", true);
+    for (int i = 0; i < 2; i++) {
+      SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+      cd.sha256 = r.identifier;
+      [self.processor decision:cd
+                           forRule:r
+               withTransitiveRules:YES
+          andCELActivationCallback:activation];
+      XCTAssertEqual(cd.decision, SNTEventStateAllowBinary);
+    }
+
+    ProgramCache::Stats stats = ProgramCache::GetStats(true);
+    XCTAssertEqual(stats.misses, 1);
+    XCTAssertEqual(stats.hits, 1);
+    XCTAssertEqual(stats.evaluations, 2);
+
+    [self.processor flushCompiledCELPrograms];
+    SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+    cd.sha256 = r.identifier;
+    [self.processor decision:cd
+                         forRule:r
+             withTransitiveRules:YES
+        andCELActivationCallback:activation];
+    XCTAssertEqual(cd.decision, SNTEventStateAllowBinary);
+    XCTAssertEqual(ProgramCache::GetStats(true).misses, 1);
+  }
 }
 
 - (void)testCELAncestors {
@@ -1239,6 +1275,7 @@ BOOL RuleIdentifiersAreEqual(struct RuleIdentifiers r1, struct RuleIdentifiers r
   ]];
   SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
   cd.sha256 = @"aabbccdd";
+  cd.signingStatus = SNTSigningStatusProduction;
 
   BOOL handled =
       [self.processor evaluateCELFallbackExpressions:cd
@@ -1247,6 +1284,52 @@ BOOL RuleIdentifiersAreEqual(struct RuleIdentifiers r1, struct RuleIdentifiers r
   XCTAssertEqual(cd.decision, SNTEventStateAllowCELFallback);
 }
 
+- (void)testCELFallbackSkipsTargetOnlyRulesForUnsigned {
+  // The first rule only reads the target, so it is known at compile time to
+  // never decide for an unsigned binary. The activation's signing ID is
+  // inconsistent with an unsigned binary to show the rule is skipped.
+  [[SNTConfigurator configurator] setSyncServerCELFallbackRules:@[
+    [self
+        ruleWithExpr:
+            @"target.signing_id == 'ZMCG7MLDV9:com.example.testbinary' ? BLOCKLIST : UNSPECIFIED"],
+    [self ruleWithExpr:@"ALLOWLIST"],
+  ]];
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.sha256 = @"aabbccdd";
+  cd.signingStatus = SNTSigningStatusUnsigned;
+  XCTAssertTrue(
+      [self.processor evaluateCELFallbackExpressions:cd
+                                  activationCallback:[self fallbackTestActivationCallback]]);
+  XCTAssertEqual(cd.decision, SNTEventStateAllowCELFallback);
+
+  cd = [[SNTCachedDecision alloc] init];
+  cd.sha256 = @"aabbccdd";
+  cd.signingStatus = SNTSigningStatusProduction;
+  XCTAssertTrue(
+      [self.processor evaluateCELFallbackExpressions:cd
+                                  activationCallback:[self fallbackTestActivationCallback]]);
+  XCTAssertEqual(cd.decision, SNTEventStateBlockCELFallback);
+
+  // When no rule can decide for an unsigned binary the activation isn't built
+  [[SNTConfigurator configurator] setSyncServerCELFallbackRules:@[
+    [self ruleWithExpr:@"target.team_id == 'ZMCG7MLDV9' ? ALLOWLIST : UNSPECIFIED"],
+  ]];
+  __block BOOL activationBuilt = NO;
+  ActivationCallbackBlock callback = [self fallbackTestActivationCallback];
+  cd = [[SNTCachedDecision alloc] init];
+  cd.sha256 = @"aabbccdd";
+  cd.signingStatus = SNTSigningStatusUnsigned;
+  XCTAssertFalse([self.processor
+      evaluateCELFallbackExpressions:cd
+                  activationCallback:^std::unique_ptr<::google::api::expr::runtime::BaseActivation>(
+                      bool useV2) {
+                    activationBuilt = YES;
+                    return callback(useV2);
+                  }]);
+  XCTAssertFalse(activationBuilt);
+}
+
 - (void)testCELFallbackUncacheableFieldsAreAvailable {
   // The full activation (including args) is passed through to fallback rules.
   [[SNTConfigurator configurator] setSyncServerCELFallbackRules:@[
@@ -23,8 +23,11 @@
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTStoredFileAccessEvent.h"
 #import "Source/common/SNTXPCSyncServiceInterface.h"
-#include "Source/common/SantaCache.h"
 #include "Source/common/String.h"
+#include "Source/santad/UploadBackoff.h"
+
+// Uploads for the same hash are skipped if one was started this recently.
+static const uint32_t kUploadBackoffSeconds = 600;
 
 @interface SNTSyncdQueue ()
 @property dispatch_queue_t syncdQueue;
@@ -34,14 +37,13 @@
 @end
 
 @implementation SNTSyncdQueue {
-  // TODO(https://github.com/northpolesec/santa/issues/344): Eventually replace with an LRU.
-  std::unique_ptr<SantaCache<std::string, NSDate*>> _uploadBackoff;
+  std::unique_ptr<santa::UploadBackoff> _uploadBackoff;
 }
 
 - (instancetype)initWithCacheSize:(uint64_t)cacheSize {
   self = [super init];
   if (self) {
-    _uploadBackoff = std::make_unique<SantaCache<std::string, NSDate*>>(cacheSize);
+    _uploadBackoff = santa::UploadBackoff::Create(cacheSize, kUploadBackoffSeconds);
     _syncdQueue = dispatch_queue_create("com.northpolesec.syncd_queue",
                                         DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
   }
@@ -177,7 +179,8 @@
         postEventsToSyncServer:events
                          reply:^(BOOL success) {
                            if (!success) {
-                             _uploadBackoff->remove(santa::NSStringToUTF8String(backoffHashKey));
+                             _uploadBackoff->Remove(
+                                 santa::NSStringToUTF8StringView(backoffHashKey));
                            }
                          }];
   }];
@@ -193,8 +196,8 @@
                                 // event will be included in the related events synced using
                                 // addEvents:isFromBundle:.
                                 if (action == SNTBundleEventActionSendEvents) {
-                                  _uploadBackoff->remove(
-                                      santa::NSStringToUTF8String(event.fileBundleHash));
+                                  _uploadBackoff->Remove(
+                                      santa::NSStringToUTF8StringView(event.fileBundleHash));
                                 }
                                 reply(action);
                               }];
@@ -212,11 +215,7 @@
 // The passed-in hash is fileBundleHash for a bundle event, or fileSHA256 for a normal event.
 // Returns YES if backoff is needed, NO otherwise.
 - (BOOL)backoffForPrimaryHash:(NSString*)hash {
-  NSDate* backoff = _uploadBackoff->get(santa::NSStringToUTF8String(hash));
-  NSDate* now = [NSDate date];
-  if (([now timeIntervalSince1970] - [backoff timeIntervalSince1970]) < 600) return YES;
-  _uploadBackoff->set(santa::NSStringToUTF8String(hash), now);
-  return NO;
+  return _uploadBackoff->ShouldBackoff(santa::NSStringToUTF8StringView(hash));
 }
 
 - (void)pushNotificationReconnect {
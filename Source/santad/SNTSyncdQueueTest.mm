@@ -37,37 +37,29 @@
 @implementation SNTSyncdQueueTest
 
 - (void)testBackoffForPrimaryHash {
-  SNTSyncdQueue* sut = [[SNTSyncdQueue alloc] initWithCacheSize:256];
+  // A capacity this small holds all keys in a single bucket
+  SNTSyncdQueue* sut = [[SNTSyncdQueue alloc] initWithCacheSize:4];
 
   // Fill up the cache.
-  for (int i = 0; i < 256; ++i) {
+  for (int i = 0; i < 4; ++i) {
     BOOL backoff = [sut backoffForPrimaryHash:[NSString stringWithFormat:@"%d", i]];
     XCTAssertFalse(backoff);
   }
 
   // These hashes should now backoff.
-  for (int i = 0; i < 256; ++i) {
+  for (int i = 0; i < 4; ++i) {
     BOOL backoff = [sut backoffForPrimaryHash:[NSString stringWithFormat:@"%d", i]];
     XCTAssertTrue(backoff);
   }
 
-  // Overfill the cache, the cache should now only contain "justonemorebyte".
+  // Overfill the cache. Only the oldest hash is replaced, the rest still backoff.
   XCTAssertFalse([sut backoffForPrimaryHash:@"justonemorebyte"]);
   XCTAssertTrue([sut backoffForPrimaryHash:@"justonemorebyte"]);
-
-  // These hashes should not backoff, remember the cache was just cleared. However, only check 255
-  // of the hashes, "justonemorebyte" takes us a slot. Checking the full 256 hashes here would
-  // overfill the cache again.
-  for (int i = 0; i < 255; ++i) {
-    BOOL backoff = [sut backoffForPrimaryHash:[NSString stringWithFormat:@"%d", i]];
-    XCTAssertFalse(backoff);
-  }
-
-  // Again, these hashes should now backoff.
-  for (int i = 0; i < 255; ++i) {
+  for (int i = 1; i < 4; ++i) {
     BOOL backoff = [sut backoffForPrimaryHash:[NSString stringWithFormat:@"%d", i]];
     XCTAssertTrue(backoff);
   }
+  XCTAssertFalse([sut backoffForPrimaryHash:@"0"]);
 
   // A new hash arrives, and is then checked over and over.
   XCTAssertFalse([sut backoffForPrimaryHash:@"yes"]);
@@ -46,7 +46,7 @@ void SantadMain(
     SNTNotificationQueue* notifier_queue, SNTSyncdQueue* syncd_queue,
     SNTNetworkExtensionQueue* netext_queue,
     SNTExecutionController* exec_controller,
-    std::shared_ptr<santa::PrefixTree<santa::Unit>> prefix_tree,
+    std::shared_ptr<santa::PublishedPrefixTree<santa::Unit>> prefix_tree,
     std::shared_ptr<santa::TTYWriter> tty_writer,
     std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree,
     std::shared_ptr<santa::EntitlementsFilter> entitlements_filter,
@@ -16,15 +16,20 @@
 #include "Source/santad/Santad.h"
 #include "Source/santad/SandboxExpectations.h"
 
+#include <CommonCrypto/CommonDigest.h>
+#include <signal.h>
+
 #include <cstdlib>
 #include <memory>
 
+#include "Source/common/BackgroundScheduler.h"
 #include "Source/common/PowerMonitor.h"
 #include "Source/common/PrefixTree.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTKVOManager.h"
 #import "Source/common/SNTLogging.h"
+#import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTStoredFileAccessEvent.h"
 #import "Source/common/SNTStoredNetworkMountEvent.h"
 #import "Source/common/SNTStoredUSBMountEvent.h"
@@ -35,6 +40,7 @@
 #include "Source/common/es/Enricher.h"
 #include "Source/common/faa/WatchItemPolicy.h"
 #include "Source/common/faa/WatchItems.h"
+#include "Source/santad/ConfigSnapshot.h"
 #include "Source/santad/DaemonConfigBundle.h"
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
@@ -51,6 +57,7 @@
 #import "Source/santad/SNTDaemonControlController.h"
 #import "Source/santad/SNTDatabaseController.h"
 #import "Source/santad/SNTDecisionCache.h"
+#include "Source/santad/ReconfigurationBatcher.h"
 #include "Source/santad/SleighLauncher.h"
 #include "Source/santad/TTYWriter.h"
 
@@ -61,11 +68,37 @@ using santa::FlushCacheMode;
 using santa::FlushCacheReason;
 using santa::Logger;
 using santa::Metrics;
-using santa::PrefixTree;
+using santa::PublishedPrefixTree;
 using santa::TTYWriter;
 using santa::Unit;
 using santa::WatchItems;
 
+static NSString* const kAuthCacheSnapshotPath = @"/var/db/santa/auth-cache.snapshot";
+static const uint64_t kAuthCacheSnapshotIntervalSec = 600;
+static const uint64_t kReconfigurationDebounceMs = 200;
+
+// Summarize the policy inputs that, if changed, invalidate cached exec
+// decisions. The auth result cache is flushed at runtime when any of these
+// change, so a snapshot is only valid if they all still match.
+static NSString* AuthCacheSnapshotGeneration(SNTConfigurator* configurator) {
+  NSString* policy = [NSString
+      stringWithFormat:@"%@|%ld|%@|%@|%@|%@",
+                       [[SNTDatabaseController ruleTable] hashOfHashes].executionRulesHash,
+                       (long)[configurator clientMode], [configurator allowedPathRegex].pattern,
+                       [configurator blockedPathRegex].pattern, [configurator staticRules],
+                       [configurator celFallbackRules]];
+  NSData* data = [policy dataUsingEncoding:NSUTF8StringEncoding];
+
+  unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256(data.bytes, (CC_LONG)data.length, digest);
+
+  NSMutableString* generation = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+  for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; ++i) {
+    [generation appendFormat:@"%02x", digest[i]];
+  }
+  return generation;
+}
+
 static NSString* ClientModeName(SNTClientMode mode) {
   switch (mode) {
     case SNTClientModeMonitor: return @"Monitor";
@@ -82,13 +115,16 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                 MOLXPCConnection* control_connection, SNTCompilerController* compiler_controller,
                 SNTNotificationQueue* notifier_queue, SNTSyncdQueue* syncd_queue,
                 SNTNetworkExtensionQueue* netext_queue, SNTExecutionController* exec_controller,
-                std::shared_ptr<santa::PrefixTree<santa::Unit>> prefix_tree,
+                std::shared_ptr<santa::PublishedPrefixTree<santa::Unit>> prefix_tree,
                 std::shared_ptr<TTYWriter> tty_writer,
                 std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree,
                 std::shared_ptr<santa::EntitlementsFilter> entitlements_filter,
                 std::shared_ptr<santa::SandboxExpectations> sandbox_expectations) {
   SNTConfigurator* configurator = [SNTConfigurator configurator];
 
+  // Event processing reads configuration from the snapshot from here on
+  santa::ConfigSnapshot::StartObserving(configurator);
+
   std::weak_ptr<Metrics> weak_metrics(metrics);
 
   // Binary upload via Sleigh. This timeout SIGKILLs the Sleigh child on expiry,
@@ -110,6 +146,15 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
           flushCacheBlock:^(FlushCacheMode mode, FlushCacheReason reason) {
             auth_result_cache->FlushCache(mode, reason);
             [exec_controller flushTouchIDApprovalCache];
+            [exec_controller flushCompiledCELPrograms];
+          }
+          invalidateCacheBlock:^(FlushCacheReason reason, NSSet<NSString*>* identifiers) {
+            SNTDecisionCache* decision_cache = [SNTDecisionCache sharedCache];
+            auth_result_cache->InvalidateEntries(reason, ^BOOL(SantaVnode vnode) {
+              return [decision_cache decisionForVnode:vnode mayMatchIdentifiers:identifiers];
+            });
+            [exec_controller flushTouchIDApprovalCache];
+            [exec_controller flushCompiledCELPrograms];
           }
           cacheCountBlock:^NSArray<NSNumber*>*() {
             return auth_result_cache->CacheCounts();
@@ -124,7 +169,8 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
               if (reply) reply(NO);
             }
           }
-          binaryUploadController:binary_upload_controller];
+          binaryUploadController:binary_upload_controller
+          processTree:process_tree];
 
   control_connection.exportedObject = dc;
   [control_connection resume];
@@ -133,6 +179,10 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
     metrics->StartPoll();
   }
 
+  if (uint32_t interval = [configurator metricSnapshotIntervalSec]) {
+    metrics->StartSnapshots(interval);
+  }
+
   SNTEndpointSecurityDeviceManager* device_client = [[SNTEndpointSecurityDeviceManager alloc]
                             initWithESAPI:esapi
                                   metrics:metrics
@@ -169,6 +219,11 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                                          authResultCache:auth_result_cache
                                               prefixTree:prefix_tree
                                              processTree:process_tree];
+  [monitor_client updatePrefixFilters:[configurator fileChangesPrefixFilters]];
+  __weak SNTEndpointSecurityRecorder* weak_monitor_client = monitor_client;
+  logger->SetTelemetryMaskObserver(^(santa::TelemetryEvent) {
+    [weak_monitor_client updateSubscriptions];
+  });
 
   SNTEndpointSecurityAuthorizer* authorizer_client =
       [[SNTEndpointSecurityAuthorizer alloc] initWithESAPI:esapi
@@ -208,6 +263,15 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
         }
       });
 
+  SNTMetricCounter* faa_telemetry_drops = [[SNTMetricSet sharedInstance]
+      counterWithName:@"/santa/faa/telemetry_drops"
+           fieldNames:@[]
+             helpText:@"Number of file access telemetry items dropped because the queue was full"];
+  [[SNTMetricSet sharedInstance] registerCallback:^{
+    santa::FAAPolicyProcessor::TelemetryStats stats = faaPolicyProcessor->GetTelemetryStats(true);
+    [faa_telemetry_drops incrementBy:(long long)stats.dropped forFieldValues:@[]];
+  }];
+
   SNTEndpointSecurityDataFileAccessAuthorizer* data_faa_client =
       [[SNTEndpointSecurityDataFileAccessAuthorizer alloc]
                         initWithESAPI:esapi
@@ -217,13 +281,14 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                    faaPolicyProcessor:std::make_shared<santa::DataFAAPolicyProcessorProxy>(
                                           faaPolicyProcessor)
                             ttyWriter:tty_writer
-          findPoliciesForTargetsBlock:^(santa::IterateTargetsBlock iterateBlock) {
-            watch_items->FindPoliciesForTargets(iterateBlock);
+          findPoliciesForTargetsBlock:^(const santa::TargetPaths& paths) {
+            return watch_items->FindPoliciesForTargets(paths);
           }];
 
   watch_items->RegisterDataWatchItemsUpdatedCallback(
       ^(size_t count, const santa::SetPairPathAndType& new_paths,
         const santa::SetPairPathAndType& removed_paths) {
+        faaPolicyProcessor->SetPolicyGeneration(watch_items->PolicyGeneration());
         [data_faa_client watchItemsCount:count newPaths:new_paths removedPaths:removed_paths];
       });
 
@@ -245,11 +310,13 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                               metrics:metrics
                    faaPolicyProcessor:std::make_shared<santa::ProcessFAAPolicyProcessorProxy>(
                                           faaPolicyProcessor)
-          iterateProcessPoliciesBlock:^(santa::CheckPolicyBlock checkPolicyBlock) {
-            watch_items->IterateProcessPolicies(checkPolicyBlock);
-          }];
+             findProcessPoliciesBlock:^(const santa::ProcessPolicyKeys& keys,
+                                        santa::CheckProcessCandidateBlock checkCandidateBlock) {
+               watch_items->FindProcessPolicies(keys, checkCandidateBlock);
+             }];
 
   watch_items->RegisterProcWatchItemsUpdatedCallback(^(size_t count) {
+    faaPolicyProcessor->SetPolicyGeneration(watch_items->PolicyGeneration());
     [proc_faa_client processWatchItemsCount:count];
   });
 
@@ -270,6 +337,18 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
 
   [syncd_queue reassessSyncServiceConnectionImmediately];
 
+  // A profile update often changes several keys at once. Reactions that rebuild
+  // state or flush caches go through the batcher so they run once per update.
+  std::shared_ptr<santa::ReconfigurationBatcher> reconfiguration =
+      santa::ReconfigurationBatcher::Create(
+          kReconfigurationDebounceMs,
+          ^(FlushCacheReason reason) {
+            auth_result_cache->FlushCache(FlushCacheMode::kAllCaches, reason);
+          },
+          ^{
+            [authorizer_client clearCache];
+          });
+
   NSMutableArray<SNTKVOManager*>* kvoObservers = [[NSMutableArray alloc] init];
   [kvoObservers addObjectsFromArray:@[
     [[SNTKVOManager alloc]
@@ -292,8 +371,7 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                     LOGI(@"ClientMode changed: %@ -> %@. Flushing caches.",
                          ClientModeName((SNTClientMode)[oldValue integerValue]),
                          ClientModeName((SNTClientMode)[newValue integerValue]));
-                    auth_result_cache->FlushCache(FlushCacheMode::kAllCaches,
-                                                  FlushCacheReason::kClientModeChanged);
+                    reconfiguration->RequestCacheFlush(FlushCacheReason::kClientModeChanged);
                     break;
                   case SNTClientModeMonitor: [[fallthrough]];
                   default:
@@ -362,8 +440,7 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                 }
 
                 LOGI(@"AllowedPathRegex changed. Flushing caches.");
-                auth_result_cache->FlushCache(FlushCacheMode::kAllCaches,
-                                              FlushCacheReason::kPathRegexChanged);
+                reconfiguration->RequestCacheFlush(FlushCacheReason::kPathRegexChanged);
               }],
     [[SNTKVOManager alloc]
         initWithObject:configurator
@@ -376,8 +453,7 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                 }
 
                 LOGI(@"BlockedPathRegex changed. Flushing caches.");
-                auth_result_cache->FlushCache(FlushCacheMode::kAllCaches,
-                                              FlushCacheReason::kPathRegexChanged);
+                reconfiguration->RequestCacheFlush(FlushCacheReason::kPathRegexChanged);
               }],
     [[SNTKVOManager alloc] initWithObject:configurator
                                  selector:@selector(removableMediaAction)
@@ -487,11 +563,11 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                   return;
                 }
 
-                [exec_controller.ruleTable updateStaticRules:newValue];
-
                 LOGI(@"StaticRules changed. Flushing caches.");
-                auth_result_cache->FlushCache(FlushCacheMode::kAllCaches,
-                                              FlushCacheReason::kStaticRulesChanged);
+                reconfiguration->ScheduleReload("StaticRules", ^{
+                  [exec_controller.ruleTable updateStaticRules:newValue];
+                });
+                reconfiguration->RequestCacheFlush(FlushCacheReason::kStaticRulesChanged);
               }],
     [[SNTKVOManager alloc]
         initWithObject:configurator
@@ -536,14 +612,15 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                      newValue);
 
                 // Get the value from the configurator since it ensures proper types
-                entitlements_filter->UpdateTeamIDFilter([configurator entitlementsTeamIDFilter]);
+                reconfiguration->ScheduleReload("EntitlementsTeamIDFilter", ^{
+                  entitlements_filter->UpdateTeamIDFilter([configurator entitlementsTeamIDFilter]);
+                });
 
                 // Clear the AuthResultCache, then clear the ES cache to ensure
                 // future execs get SNTCachedDecision entitlement values filtered
                 // with the new settings.
-                auth_result_cache->FlushCache(FlushCacheMode::kAllCaches,
-                                              FlushCacheReason::kEntitlementsTeamIDFilterChanged);
-                [authorizer_client clearCache];
+                reconfiguration->RequestCacheFlush(
+                    FlushCacheReason::kEntitlementsTeamIDFilterChanged, true);
               }],
     [[SNTKVOManager alloc]
         initWithObject:configurator
@@ -558,14 +635,15 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                      newValue);
 
                 // Get the value from the configurator since it ensures proper types
-                entitlements_filter->UpdatePrefixFilter([configurator entitlementsPrefixFilter]);
+                reconfiguration->ScheduleReload("EntitlementsPrefixFilter", ^{
+                  entitlements_filter->UpdatePrefixFilter([configurator entitlementsPrefixFilter]);
+                });
 
                 // Clear the AuthResultCache, then clear the ES cache to ensure
                 // future execs get SNTCachedDecision entitlement values filtered
                 // with the new settings.
-                auth_result_cache->FlushCache(FlushCacheMode::kAllCaches,
-                                              FlushCacheReason::kEntitlementsPrefixFilterChanged);
-                [authorizer_client clearCache];
+                reconfiguration->RequestCacheFlush(
+                    FlushCacheReason::kEntitlementsPrefixFilterChanged, true);
               }],
     [[SNTKVOManager alloc]
         initWithObject:configurator
@@ -593,6 +671,20 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                      [newValue componentsJoinedByString:@","]);
                 logger->SetTelemetryMask(santa::TelemetryConfigToBitmask(newValue));
               }],
+    [[SNTKVOManager alloc]
+        initWithObject:configurator
+              selector:@selector(fileChangesPrefixFilters)
+                  type:[NSArray class]
+              callback:^(NSArray* oldValue, NSArray* newValue) {
+                if ((!oldValue && !newValue) || [oldValue isEqualToArray:newValue]) {
+                  return;
+                }
+
+                LOGI(@"FileChangesPrefixFilters changed: %@ -> %@",
+                     [oldValue componentsJoinedByString:@","],
+                     [newValue componentsJoinedByString:@","]);
+                [monitor_client updatePrefixFilters:newValue];
+              }],
     [[SNTKVOManager alloc] initWithObject:configurator
                                  selector:@selector(enableSilentTTYMode)
                                      type:[NSNumber class]
@@ -745,7 +837,9 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                   }
 
                   LOGI(@"FileAccessPolicyPlist changed: %@ -> %@", oldValue, newValue);
-                  watch_items->SetConfigPath(newValue);
+                  reconfiguration->ScheduleReload("FileAccessPolicyPlist", ^{
+                    watch_items->SetConfigPath(newValue);
+                  });
                 }
               }],
     [[SNTKVOManager alloc] initWithObject:configurator
@@ -762,7 +856,9 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                                      }
 
                                      LOGI(@"FileAccessPolicy changed");
-                                     watch_items->SetConfig(newValue);
+                                     reconfiguration->ScheduleReload("FileAccessPolicy", ^{
+                                       watch_items->SetConfig(newValue);
+                                     });
                                    }
                                  }],
     [[SNTKVOManager alloc] initWithObject:configurator
@@ -821,13 +917,6 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
   // of the SNTKVOManager objects it contains.
   (void)kvoObservers;
 
-  if (process_tree) {
-    if (absl::Status status = process_tree->Backfill(); !status.ok()) {
-      std::string err = status.ToString();
-      LOGE(@"Failed to backfill process tree: %@", @(err.c_str()));
-    }
-  }
-
   // IMPORTANT: ES will hold up third party execs until early boot clients make
   // their first subscription. Ensuring the `Authorizer` client is enabled first
   // means that the AUTH EXEC event is subscribed first and Santa can apply
@@ -843,8 +932,13 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
 
   // Kickoff pre-populating the decision cache. This is done after the Authorizer ES client
   // is enabled to ensure that there is no gap between getting the list of processes to
-  // backill and the authorizer handling new execs.
-  [[SNTDecisionCache sharedCache] backfillDecisionCacheAsync];
+  // backill and the authorizer handling new execs. Hashing every running executable is
+  // expensive, so it waits a while for the machine to be on AC power and not under pressure.
+  santa::BackgroundScheduler::Shared().Submit(
+      "decision_cache_backfill", 10 * 60 * NSEC_PER_SEC,
+      dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        [[SNTDecisionCache sharedCache] backfillDecisionCacheAsyncWithProcessTree:process_tree];
+      });
 
   // Start monitoring any watched items
   watch_items->StartTimer();
@@ -852,6 +946,47 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
   [monitor_client enable];
   [device_client enable];
 
+  // Warm the auth result cache from the previous run. This happens after the
+  // recorder client is enabled so that any file modified while the snapshot
+  // is being restored still invalidates its cache entry.
+  dispatch_queue_t snapshot_queue =
+      dispatch_queue_create("com.northpolesec.santa.daemon.auth_cache_snapshot",
+                            dispatch_queue_attr_make_with_qos_class(
+                                DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL, QOS_CLASS_UTILITY, 0));
+  dispatch_source_t snapshot_timer = nullptr;
+  dispatch_source_t sigterm_source = nullptr;
+  if ([configurator enableAuthCacheWarmStart]) {
+    dispatch_async(snapshot_queue, ^{
+      size_t restored = auth_result_cache->RestoreSnapshot(
+          kAuthCacheSnapshotPath, AuthCacheSnapshotGeneration(configurator));
+      LOGI(@"Restored %zu auth result cache entries from snapshot", restored);
+    });
+
+    snapshot_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, snapshot_queue);
+    dispatch_source_set_timer(
+        snapshot_timer,
+        dispatch_time(DISPATCH_TIME_NOW, kAuthCacheSnapshotIntervalSec * NSEC_PER_SEC),
+        kAuthCacheSnapshotIntervalSec * NSEC_PER_SEC, 30 * NSEC_PER_SEC);
+    dispatch_source_set_event_handler(snapshot_timer, ^{
+      auth_result_cache->SaveSnapshot(kAuthCacheSnapshotPath,
+                                      AuthCacheSnapshotGeneration(configurator));
+    });
+    dispatch_resume(snapshot_timer);
+
+    // Take a final snapshot on shutdown, then terminate as if the signal had
+    // not been handled.
+    signal(SIGTERM, SIG_IGN);
+    sigterm_source =
+        dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL, SIGTERM, 0, snapshot_queue);
+    dispatch_source_set_event_handler(sigterm_source, ^{
+      auth_result_cache->SaveSnapshot(kAuthCacheSnapshotPath,
+                                      AuthCacheSnapshotGeneration(configurator));
+      signal(SIGTERM, SIG_DFL);
+      raise(SIGTERM);
+    });
+    dispatch_resume(sigterm_source);
+  }
+
   if ([configurator enableTelemetryExport]) {
     // Delay initial start to allow Santa to stabilize
     LOGW(@"WARNING - Telemetry export is currently in beta. Configuration and format are subject "
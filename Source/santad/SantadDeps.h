@@ -61,7 +61,7 @@ class SantadDeps {
       SNTNotificationQueue* notifier_queue, SNTSyncdQueue* syncd_queue,
       SNTNetworkExtensionQueue* netext_queue,
       SNTExecutionController* exec_controller,
-      std::shared_ptr<santa::PrefixTree<santa::Unit>> prefix_tree,
+      std::shared_ptr<santa::PublishedPrefixTree<santa::Unit>> prefix_tree,
       std::shared_ptr<santa::TTYWriter> tty_writer,
       std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree,
       std::shared_ptr<santa::EntitlementsFilter> entitlements_filter,
@@ -79,7 +79,7 @@ class SantadDeps {
   SNTSyncdQueue* SyncdQueue();
   SNTNetworkExtensionQueue* NetworkExtensionQueue();
   SNTExecutionController* ExecController();
-  std::shared_ptr<santa::PrefixTree<santa::Unit>> PrefixTree();
+  std::shared_ptr<santa::PublishedPrefixTree<santa::Unit>> PrefixTree();
   std::shared_ptr<santa::TTYWriter> TTYWriter();
   std::shared_ptr<santa::santad::process_tree::ProcessTree> ProcessTree();
   std::shared_ptr<santa::EntitlementsFilter> EntitlementsFilter();
@@ -98,7 +98,7 @@ class SantadDeps {
   SNTSyncdQueue* syncd_queue_;
   SNTNetworkExtensionQueue* netext_queue_;
   SNTExecutionController* exec_controller_;
-  std::shared_ptr<santa::PrefixTree<santa::Unit>> prefix_tree_;
+  std::shared_ptr<santa::PublishedPrefixTree<santa::Unit>> prefix_tree_;
   std::shared_ptr<santa::TTYWriter> tty_writer_;
   std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree_;
   std::shared_ptr<santa::EntitlementsFilter> entitlements_filter_;
@@ -15,43 +15,164 @@
 
 #include "Source/santad/SantadDeps.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
+#include <optional>
 
+#include "Source/common/BackgroundScheduler.h"
+#include "Source/common/MemoryAccounting.h"
 #include "Source/common/RingBuffer.h"
 #import "Source/common/SNTExportConfiguration.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTStrengthify.h"
 #import "Source/common/SNTXPCControlInterface.h"
+#include "Source/common/SelfProfiler.h"
+#import "Source/common/String.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
+#include "Source/common/es/NameCache.h"
 #include "Source/common/faa/WatchItems.h"
 #include "Source/common/processtree/annotations/originator.h"
+#include "Source/common/processtree/annotations/seatbelt.h"
 #include "Source/common/processtree/process_tree.h"
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/EntitlementsFilter.h"
+#include "Source/santad/Logs/EndpointSecurity/EventDeduplicator.h"
+#include "Source/santad/Logs/EndpointSecurity/TelemetryFilter.h"
 #import "Source/santad/SNTDatabaseController.h"
 #import "Source/santad/SNTDecisionCache.h"
 #import "Source/santad/SNTNetworkExtensionQueue.h"
 #import "Source/santad/SNTPolicyProcessor.h"
 #include "Source/santad/SleighLauncher.h"
+#include "Source/santad/StartupGraph.h"
 #include "Source/santad/TTYWriter.h"
 
 using santa::AuthResultCache;
 using santa::Enricher;
+using santa::EventDeduplicator;
 using santa::Logger;
 using santa::Metrics;
-using santa::PrefixTree;
+using santa::PublishedPrefixTree;
 using santa::SleighLauncher;
+using santa::TelemetryFilter;
 using santa::TTYWriter;
 using santa::WatchItems;
 
 namespace santa {
 
+static void ExportStartupTimings(const std::vector<StartupGraph::Timing>& timings) {
+  SNTMetricInt64Gauge* phaseTime = [[SNTMetricSet sharedInstance]
+      int64GaugeWithName:@"/santa/startup/phase_time"
+              fieldNames:@[ @"Phase" ]
+                helpText:@"Time taken by each santad startup phase, in microseconds"];
+  SNTMetricInt64Gauge* totalTime = [[SNTMetricSet sharedInstance]
+      int64GaugeWithName:@"/santa/startup/initialization_time"
+              fieldNames:@[]
+                helpText:@"Time taken for all santad startup phases to finish, in microseconds"];
+
+  uint64_t total_nanos = 0;
+  for (const StartupGraph::Timing& timing : timings) {
+    uint64_t phase_nanos = timing.end_nanos - timing.start_nanos;
+    LOGD(@"Startup phase %s took %llu us", timing.name.c_str(), phase_nanos / 1000);
+    [phaseTime set:(long long)(phase_nanos / 1000)
+        forFieldValues:@[ santa::StringToNSString(timing.name) ]];
+    total_nanos = std::max(total_nanos, timing.end_nanos);
+  }
+  [totalTime set:(long long)(total_nanos / 1000) forFieldValues:@[]];
+}
+
+// Structures are captured weakly so that accounting never extends their
+// lifetime. Those that are expensive to rebuild are only shrunk once memory
+// pressure is critical.
+static void RegisterMemoryAccounting(
+    SNTPolicyProcessor* policy_processor,
+    std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree,
+    std::shared_ptr<Logger> logger, std::shared_ptr<WatchItems> watch_items,
+    std::shared_ptr<AuthResultCache> auth_result_cache,
+    std::shared_ptr<PublishedPrefixTree<Unit>> prefix_tree) {
+  using ShrinkLevel = MemoryAccounting::ShrinkLevel;
+  MemoryAccounting& accounting = MemoryAccounting::Shared();
+
+  std::weak_ptr<AuthResultCache> weak_arc = auth_result_cache;
+  accounting.Register("auth_cache_root", [weak_arc] {
+    std::shared_ptr<AuthResultCache> arc = weak_arc.lock();
+    return arc ? (size_t)[arc->CacheBytes()[0] unsignedLongLongValue] : 0;
+  });
+  accounting.Register(
+      "auth_cache_nonroot",
+      [weak_arc] {
+        std::shared_ptr<AuthResultCache> arc = weak_arc.lock();
+        return arc ? (size_t)[arc->CacheBytes()[1] unsignedLongLongValue] : 0;
+      },
+      ShrinkLevel::kCritical,
+      [weak_arc] {
+        if (std::shared_ptr<AuthResultCache> arc = weak_arc.lock()) {
+          arc->FlushCache(FlushCacheMode::kNonRootOnly, FlushCacheReason::kMemoryPressure);
+        }
+      });
+
+  accounting.Register(
+      "decision_cache",
+      [] { return (size_t)[[SNTDecisionCache sharedCache] approximateBytes]; },
+      ShrinkLevel::kCritical, [] { [[SNTDecisionCache sharedCache] forgetAllCachedDecisions]; });
+
+  __weak SNTPolicyProcessor* weak_policy_processor = policy_processor;
+  accounting.Register(
+      "cel_programs",
+      [weak_policy_processor] { return (size_t)[weak_policy_processor compiledCELBytes]; },
+      ShrinkLevel::kWarning,
+      [weak_policy_processor] { [weak_policy_processor flushCompiledCELPrograms]; });
+
+  std::weak_ptr<santa::santad::process_tree::ProcessTree> weak_tree = process_tree;
+  accounting.Register("process_tree", [weak_tree] {
+    std::shared_ptr<santa::santad::process_tree::ProcessTree> tree = weak_tree.lock();
+    return tree ? tree->ApproximateBytes() : 0;
+  });
+
+  std::weak_ptr<PublishedPrefixTree<Unit>> weak_prefix_tree = prefix_tree;
+  accounting.Register("prefix_tree", [weak_prefix_tree] {
+    std::shared_ptr<PublishedPrefixTree<Unit>> tree = weak_prefix_tree.lock();
+    return tree ? tree->ApproximateBytes() : 0;
+  });
+
+  std::weak_ptr<WatchItems> weak_watch_items = watch_items;
+  accounting.Register("watch_items", [weak_watch_items] {
+    std::shared_ptr<WatchItems> items = weak_watch_items.lock();
+    return items ? items->ApproximateBytes() : 0;
+  });
+
+  std::weak_ptr<Logger> weak_logger = logger;
+  accounting.Register(
+      "spool_buffers",
+      [weak_logger] {
+        std::shared_ptr<Logger> l = weak_logger.lock();
+        return l ? l->BufferedBytes() : 0;
+      },
+      ShrinkLevel::kWarning,
+      [weak_logger] {
+        if (std::shared_ptr<Logger> l = weak_logger.lock()) {
+          l->TrimBuffers();
+        }
+      });
+
+  accounting.Register(
+      "enricher_names",
+      [] {
+        return NameCache::Usernames()->ApproximateBytes() +
+               NameCache::Groupnames()->ApproximateBytes();
+      },
+      ShrinkLevel::kWarning,
+      [] {
+        NameCache::Usernames()->Clear();
+        NameCache::Groupnames()->Clear();
+      });
+}
+
 std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
                                                SNTMetricSet* metric_set,
                                                santa::ProcessControlBlock processControlBlock) {
@@ -67,18 +188,6 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
   control_connection.privilegedInterface = [SNTXPCControlInterface controlInterface];
   control_connection.unprivilegedInterface = [SNTXPCUnprivilegedControlInterface controlInterface];
 
-  SNTRuleTable* rule_table = [SNTDatabaseController ruleTable];
-  if (!rule_table) {
-    LOGE(@"Failed to initialize rule table.");
-    exit(EXIT_FAILURE);
-  }
-
-  SNTEventTable* event_table = [SNTDatabaseController eventTable];
-  if (!event_table) {
-    LOGE(@"Failed to initialize event table.");
-    exit(EXIT_FAILURE);
-  }
-
   SNTCompilerController* compiler_controller = [[SNTCompilerController alloc] init];
   if (!compiler_controller) {
     LOGE(@"Failed to initialize compiler controller.");
@@ -109,63 +218,279 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
       configurator.entitlementsTeamIDFilter, configurator.entitlementsPrefixFilter);
   [[SNTDecisionCache sharedCache] setEntitlementsFilter:entitlements_filter];
 
-  // Create ProcessTree early so it can be passed to policy processor and exec controller
-  std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree;
-  std::vector<std::unique_ptr<santa::santad::process_tree::Annotator>> annotators;
+  std::shared_ptr<EndpointSecurityAPI> esapi = std::make_shared<EndpointSecurityAPI>();
+  if (!esapi) {
+    LOGE(@"Failed to create ES API wrapper.");
+    exit(EXIT_FAILURE);
+  }
+
+  // The initializers below are independent of each other, other than where
+  // dependencies are listed, and the slow ones wait on disk. Run them
+  // concurrently. No ES client is enabled until SantadMain runs, so the
+  // process tree is still backfilled before any event can reach it.
+  StartupGraph startup;
+  __block SNTRuleTable* rule_table;
+  __block SNTEventTable* event_table;
+  __block SNTPolicyProcessor* policy_processor;
+  __block std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree;
+  __block std::shared_ptr<::Logger> logger;
+  __block std::shared_ptr<::WatchItems> watch_items;
+  __block std::shared_ptr<::AuthResultCache> auth_result_cache;
+
+  startup.Add("RuleTable", {}, ^{
+    rule_table = [SNTDatabaseController ruleTable];
+    if (!rule_table) {
+      LOGE(@"Failed to initialize rule table.");
+      exit(EXIT_FAILURE);
+    }
+  });
+
+  startup.Add("EventTable", {}, ^{
+    event_table = [SNTDatabaseController eventTable];
+    if (!event_table) {
+      LOGE(@"Failed to initialize event table.");
+      exit(EXIT_FAILURE);
+    }
+  });
+
+  startup.Add("PolicyProcessor", {"RuleTable"}, ^{
+    policy_processor = [[SNTPolicyProcessor alloc] initWithRuleTable:rule_table
+                                                  entitlementsFilter:entitlements_filter];
+  });
+
+  startup.Add("ProcessTree", {}, ^{
+    std::vector<std::unique_ptr<santa::santad::process_tree::Annotator>> annotators;
+    // Seatbelt lineage is needed for enforcement, so it is always tracked.
+    annotators.emplace_back(std::make_unique<santa::santad::process_tree::SeatbeltAnnotator>());
+
+    for (NSString* annotation in [configurator enabledProcessAnnotations]) {
+      if ([[annotation lowercaseString] isEqualToString:@"originator"]) {
+        annotators.emplace_back(
+            std::make_unique<santa::santad::process_tree::OriginatorAnnotator>());
+      } else {
+        LOGW(@"Unrecognized process annotation %@", annotation);
+      }
+    }
+
+    auto tree_status = santa::santad::process_tree::CreateTree(std::move(annotators));
+    if (!tree_status.ok()) {
+      LOGE(@"Failed to create process tree: %@", @(tree_status.status().ToString().c_str()));
+      exit(EXIT_FAILURE);
+    }
+    process_tree = *tree_status;
+  });
 
-  for (NSString* annotation in [configurator enabledProcessAnnotations]) {
-    if ([[annotation lowercaseString] isEqualToString:@"originator"]) {
-      annotators.emplace_back(std::make_unique<santa::santad::process_tree::OriginatorAnnotator>());
+  startup.Add("ProcessTreeBackfill", {"ProcessTree"}, ^{
+    if (absl::Status status = process_tree->Backfill(); !status.ok()) {
+      std::string err = status.ToString();
+      LOGE(@"Failed to backfill process tree: %@", @(err.c_str()));
+    }
+  });
+
+  startup.Add("Logger", {}, ^{
+    size_t spool_file_threshold_bytes = [configurator spoolDirectoryFileSizeThresholdKB] * 1024;
+    size_t spool_dir_threshold_bytes = [configurator spoolDirectorySizeThresholdMB] * 1024 * 1024;
+    uint64_t spool_flush_timeout_ms = [configurator spoolDirectoryEventMaxFlushTimeSec] * 1000;
+    uint32_t telemetry_export_frequency_secs = [configurator telemetryExportIntervalSec];
+
+    logger = Logger::Create(
+        esapi, SleighLauncher::Create(std::string(SleighLauncher::kDefaultSleighPath)),
+        ^SNTExportConfiguration*() {
+          return [configurator exportConfig];
+        },
+        TelemetryConfigToBitmask([configurator telemetry]), [configurator eventLogType],
+        [SNTDecisionCache sharedCache], [configurator eventLogPath], [configurator spoolDirectory],
+        spool_dir_threshold_bytes, spool_file_threshold_bytes, spool_flush_timeout_ms,
+        telemetry_export_frequency_secs, [configurator telemetryExportTimeoutSec],
+        [configurator telemetryExportBatchThresholdSizeMB],
+        [configurator telemetryExportMaxFilesPerBatch]);
+    if (!logger) {
+      LOGE(@"Failed to create logger.");
+      exit(EXIT_FAILURE);
+    }
+  });
+
+  // Attempt to create WatchItems from the following data sources with
+  // decending order of precedence:
+  // 1. Rules stored in the rules database
+  // 2. Rules embedded in the Santa configuration
+  // 3. Rules obtained by reading the plist at the configured path
+  startup.Add("WatchItems", {"RuleTable"}, ^{
+    uint32_t interval = [configurator fileAccessPolicyUpdateIntervalSec];
+    if ([rule_table fileAccessRuleCount] > 0) {
+      watch_items = WatchItems::CreateFromRules([rule_table retrieveAllFileAccessRules], interval);
+    } else if ([configurator fileAccessPolicy]) {
+      watch_items = WatchItems::CreateFromEmbeddedConfig([configurator fileAccessPolicy], interval);
     } else {
-      LOGW(@"Unrecognized process annotation %@", annotation);
+      watch_items = WatchItems::CreateFromPath([configurator fileAccessPolicyPlist], interval);
+    }
+
+    if (!watch_items) {
+      LOGE(@"Failed to create watch items");
+      exit(EXIT_FAILURE);
     }
+  });
+
+  startup.Add("AuthResultCache", {}, ^{
+    AuthResultCacheTTLs ttls;
+    ttls.max_deny_ms = [configurator authCacheMaxDenyTimeMs];
+    auth_result_cache = AuthResultCache::Create(esapi, metric_set, ttls,
+                                                [configurator enableLockFreeAuthCacheReads]);
+    if (!auth_result_cache) {
+      LOGE(@"Failed to create auth result cache");
+      exit(EXIT_FAILURE);
+    }
+  });
+
+  startup.Run();
+  ExportStartupTimings(startup.Timings());
+
+  SNTMetricInt64Gauge* backfillTime = [[SNTMetricSet sharedInstance]
+      int64GaugeWithName:@"/santa/process_tree/backfill_time"
+              fieldNames:@[]
+                helpText:@"Time taken by the most recent process tree backfill, in microseconds"];
+  SNTMetricInt64Gauge* backfillProcesses = [[SNTMetricSet sharedInstance]
+      int64GaugeWithName:@"/santa/process_tree/backfill_processes"
+              fieldNames:@[]
+                helpText:@"Number of processes loaded by the most recent process tree backfill"];
+  [[SNTMetricSet sharedInstance] registerCallback:^{
+    santa::santad::process_tree::ProcessTree::BackfillStats stats =
+        process_tree->LastBackfillStats();
+    [backfillTime set:(long long)(stats.duration_nanos / 1000) forFieldValues:@[]];
+    [backfillProcesses set:(long long)stats.processes forFieldValues:@[]];
+  }];
+
+  // Populated by the Recorder from the FileChangesPrefixFilters config key
+  std::shared_ptr<PublishedPrefixTree<Unit>> prefix_tree =
+      std::make_shared<PublishedPrefixTree<Unit>>();
+
+  std::shared_ptr<TelemetryFilter> telemetry_filter =
+      TelemetryFilter::Create([configurator fileChangesTelemetryFilters]);
+  if (telemetry_filter) {
+    logger->SetTelemetryFilter(telemetry_filter);
+
+    SNTMetricCounter* filterHits = [[SNTMetricSet sharedInstance]
+        counterWithName:@"/santa/logger/telemetry_filter_hits"
+             fieldNames:@[ @"Filter" ]
+               helpText:@"Number of file change events dropped by each telemetry filter"];
+    [[SNTMetricSet sharedInstance] registerCallback:^{
+      telemetry_filter->ForEachHitCount(true, [filterHits](const std::string& name, uint64_t hits) {
+        [filterHits incrementBy:(long long)hits forFieldValues:@[ santa::StringToNSString(name) ]];
+      });
+    }];
   }
 
-  auto tree_status = santa::santad::process_tree::CreateTree(std::move(annotators));
-  if (!tree_status.ok()) {
-    LOGE(@"Failed to create process tree: %@", @(tree_status.status().ToString().c_str()));
-    exit(EXIT_FAILURE);
+  uint32_t dedup_window_ms = [configurator fileChangesDeduplicationWindowMs];
+  if (dedup_window_ms > 0) {
+    std::shared_ptr<EventDeduplicator> deduplicator =
+        EventDeduplicator::Create(dedup_window_ms * NSEC_PER_MSEC);
+    logger->SetEventDeduplicator(deduplicator);
+
+    SNTMetricCounter* suppressed = [[SNTMetricSet sharedInstance]
+        counterWithName:@"/santa/logger/deduplicated_events"
+             fieldNames:@[]
+               helpText:@"Number of repeated file change events that were not logged"];
+    [[SNTMetricSet sharedInstance] registerCallback:^{
+      [suppressed incrementBy:(long long)deduplicator->SuppressedCount(true) forFieldValues:@[]];
+    }];
   }
-  process_tree = *tree_status;
 
-  SNTPolicyProcessor* policy_processor =
-      [[SNTPolicyProcessor alloc] initWithRuleTable:rule_table
-                                 entitlementsFilter:entitlements_filter];
+  uint32_t serialization_workers = [configurator eventLogSerializationWorkers];
+  if (serialization_workers > 0) {
+    logger->EnableParallelSerialization(serialization_workers);
+
+    SNTMetricInt64Gauge* serializationDepth = [[SNTMetricSet sharedInstance]
+        int64GaugeWithName:@"/santa/logger/serialization_queue_depth"
+                fieldNames:@[]
+                  helpText:@"Number of events waiting to be serialized"];
+    SNTMetricCounter* serializationDrops = [[SNTMetricSet sharedInstance]
+        counterWithName:@"/santa/logger/serialization_drops"
+             fieldNames:@[]
+               helpText:@"Number of events dropped because the serialization queue was full"];
+    [[SNTMetricSet sharedInstance] registerCallback:^{
+      ::Logger::SerializationStats stats = logger->GetSerializationStats(true);
+      [serializationDepth set:stats.depth forFieldValues:@[]];
+      [serializationDrops incrementBy:(long long)stats.dropped forFieldValues:@[]];
+    }];
+  }
 
-  std::shared_ptr<::PrefixTree<Unit>> prefix_tree = std::make_shared<::PrefixTree<Unit>>();
+  if (logger->GetCompressionStats(false).has_value()) {
+    SNTMetricInt64Gauge* compressionLevel = [[SNTMetricSet sharedInstance]
+        int64GaugeWithName:@"/santa/logger/zstd_compression_level"
+                fieldNames:@[]
+                  helpText:@"Compression level used for new spool batches"];
+    SNTMetricDoubleGauge* compressionRatio = [[SNTMetricSet sharedInstance]
+        doubleGaugeWithName:@"/santa/logger/zstd_compression_ratio"
+                 fieldNames:@[]
+                   helpText:@"Compression ratio achieved by spool batches since the last export"];
+    [[SNTMetricSet sharedInstance] registerCallback:^{
+      std::optional<santa::ZstdLevelController::Stats> stats = logger->GetCompressionStats(true);
+      if (stats.has_value()) {
+        [compressionLevel set:stats->level forFieldValues:@[]];
+        if (stats->compression_ratio > 0) {
+          [compressionRatio set:stats->compression_ratio forFieldValues:@[]];
+        }
+      }
+    }];
+  }
 
-  // TODO(bur): Add KVO handling for fileChangesPrefixFilters.
-  NSArray<NSString*>* prefix_filters =
-      [@[ @"/.", @"/dev/" ] arrayByAddingObjectsFromArray:[configurator fileChangesPrefixFilters]];
-  for (NSString* filter in prefix_filters) {
-    prefix_tree->InsertPrefix([filter fileSystemRepresentation], Unit {});
+  SNTMetricCounter* exportedBytes = [[SNTMetricSet sharedInstance]
+      counterWithName:@"/santa/logger/telemetry_export_bytes"
+           fieldNames:@[]
+             helpText:@"Number of spooled telemetry bytes successfully exported"];
+  SNTMetricCounter* exportedFiles = [[SNTMetricSet sharedInstance]
+      counterWithName:@"/santa/logger/telemetry_export_files"
+           fieldNames:@[]
+             helpText:@"Number of spooled telemetry files successfully exported"];
+  SNTMetricDoubleGauge* exportBacklogAge = [[SNTMetricSet sharedInstance]
+      doubleGaugeWithName:@"/santa/logger/telemetry_export_backlog_age_seconds"
+               fieldNames:@[]
+                 helpText:@"Age of the oldest spooled telemetry file waiting to be exported"];
+  [[SNTMetricSet sharedInstance] registerCallback:^{
+    if (![configurator enableTelemetryExport]) {
+      return;
+    }
+    ::Logger::ExportStats stats = logger->GetExportStats(true);
+    [exportedBytes incrementBy:(long long)stats.bytes_exported forFieldValues:@[]];
+    [exportedFiles incrementBy:(long long)stats.files_exported forFieldValues:@[]];
+    [exportBacklogAge set:stats.backlog_age_seconds forFieldValues:@[]];
+  }];
+
+  SNTMetricCounter* transitiveRulesReaped = [[SNTMetricSet sharedInstance]
+      counterWithName:@"/santa/rules/transitive_rules_reaped"
+           fieldNames:@[]
+             helpText:@"Number of outdated transitive rules removed from the rule database"];
+  SNTMetricInt64Gauge* transitiveRuleReapBacklog = [[SNTMetricSet sharedInstance]
+      int64GaugeWithName:@"/santa/rules/transitive_rule_reap_backlog"
+              fieldNames:@[]
+                helpText:@"Number of outdated transitive rules waiting to be removed"];
+  [[SNTMetricSet sharedInstance] registerCallback:^{
+    SNTTransitiveRuleReapStats stats = [rule_table transitiveRuleReapStats:YES];
+    [transitiveRulesReaped incrementBy:(long long)stats.reaped forFieldValues:@[]];
+    [transitiveRuleReapBacklog set:(long long)stats.backlog forFieldValues:@[]];
+  }];
+
+  if ([configurator enableStreamingTelemetryExport]) {
+    logger->EnableStreamingExport(^bool {
+      return [configurator enableTelemetryExport];
+    });
   }
 
-  std::shared_ptr<EndpointSecurityAPI> esapi = std::make_shared<EndpointSecurityAPI>();
-  if (!esapi) {
-    LOGE(@"Failed to create ES API wrapper.");
-    exit(EXIT_FAILURE);
+  if (uint32_t interval = [configurator processTreeSnapshotIntervalSec]; interval > 0) {
+    logger->EnableProcessTreeSnapshots(process_tree, interval);
   }
 
-  size_t spool_file_threshold_bytes = [configurator spoolDirectoryFileSizeThresholdKB] * 1024;
-  size_t spool_dir_threshold_bytes = [configurator spoolDirectorySizeThresholdMB] * 1024 * 1024;
-  uint64_t spool_flush_timeout_ms = [configurator spoolDirectoryEventMaxFlushTimeSec] * 1000;
-  uint32_t telemetry_export_frequency_secs = [configurator telemetryExportIntervalSec];
+  santa::SelfProfiler::Shared().Start([configurator selfProfilingIntervalMs]);
 
-  std::shared_ptr<::Logger> logger = Logger::Create(
-      esapi, SleighLauncher::Create(std::string(SleighLauncher::kDefaultSleighPath)),
-      ^SNTExportConfiguration*() {
-        return [configurator exportConfig];
-      },
-      TelemetryConfigToBitmask([configurator telemetry]), [configurator eventLogType],
-      [SNTDecisionCache sharedCache], [configurator eventLogPath], [configurator spoolDirectory],
-      spool_dir_threshold_bytes, spool_file_threshold_bytes, spool_flush_timeout_ms,
-      telemetry_export_frequency_secs, [configurator telemetryExportTimeoutSec],
-      [configurator telemetryExportBatchThresholdSizeMB],
-      [configurator telemetryExportMaxFilesPerBatch]);
-  if (!logger) {
-    LOGE(@"Failed to create logger.");
-    exit(EXIT_FAILURE);
+  // Periodic export and policy reapplication wait for the machine to be on AC power and not
+  // under pressure
+  logger->SetBackgroundScheduler(&santa::BackgroundScheduler::Shared());
+  watch_items->SetBackgroundScheduler(&santa::BackgroundScheduler::Shared());
+
+  RegisterMemoryAccounting(policy_processor, process_tree, logger, watch_items, auth_result_cache,
+                           prefix_tree);
+  if ([configurator enableMemoryPressureCacheShrinking]) {
+    MemoryAccounting::Shared().EnableMemoryPressureHandler();
   }
 
   SNTNetworkExtensionQueue* netext_queue =
@@ -202,27 +527,6 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
     exit(EXIT_FAILURE);
   }
 
-  // Attempt to create WatchItems from the following data sources with
-  // decending order of precedence:
-  // 1. Rules stored in the rules database
-  // 2. Rules embedded in the Santa configuration
-  // 3. Rules obtained by reading the plist at the configured path
-  std::shared_ptr<::WatchItems> watch_items = ^{
-    uint32_t interval = [configurator fileAccessPolicyUpdateIntervalSec];
-    if ([rule_table fileAccessRuleCount] > 0) {
-      return WatchItems::CreateFromRules([rule_table retrieveAllFileAccessRules], interval);
-    } else if ([configurator fileAccessPolicy]) {
-      return WatchItems::CreateFromEmbeddedConfig([configurator fileAccessPolicy], interval);
-    } else {
-      return WatchItems::CreateFromPath([configurator fileAccessPolicyPlist], interval);
-    }
-  }();
-
-  if (!watch_items) {
-    LOGE(@"Failed to create watch items");
-    exit(EXIT_FAILURE);
-  }
-
   WEAKIFY(rule_table);
   rule_table.fileAccessRulesChangedCallback = ^(int64_t faaRuleCount) {
     if (faaRuleCount > 0) {
@@ -242,12 +546,6 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
     exit(EXIT_FAILURE);
   }
 
-  std::shared_ptr<::AuthResultCache> auth_result_cache = AuthResultCache::Create(esapi, metric_set);
-  if (!auth_result_cache) {
-    LOGE(@"Failed to create auth result cache");
-    exit(EXIT_FAILURE);
-  }
-
   return std::make_unique<SantadDeps>(
       esapi, logger, std::move(metrics), std::move(watch_items), std::move(auth_result_cache),
       control_connection, compiler_controller, notifier_queue, syncd_queue, netext_queue,
@@ -261,7 +559,8 @@ SantadDeps::SantadDeps(
     std::shared_ptr<santa::AuthResultCache> auth_result_cache, MOLXPCConnection* control_connection,
     SNTCompilerController* compiler_controller, SNTNotificationQueue* notifier_queue,
     SNTSyncdQueue* syncd_queue, SNTNetworkExtensionQueue* netext_queue,
-    SNTExecutionController* exec_controller, std::shared_ptr<::PrefixTree<Unit>> prefix_tree,
+    SNTExecutionController* exec_controller,
+    std::shared_ptr<::PublishedPrefixTree<Unit>> prefix_tree,
     std::shared_ptr<::TTYWriter> tty_writer,
     std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree,
     std::shared_ptr<santa::EntitlementsFilter> entitlements_filter,
@@ -331,7 +630,7 @@ SNTExecutionController* SantadDeps::ExecController() {
   return exec_controller_;
 }
 
-std::shared_ptr<PrefixTree<Unit>> SantadDeps::PrefixTree() {
+std::shared_ptr<PublishedPrefixTree<Unit>> SantadDeps::PrefixTree() {
   return prefix_tree_;
 }
 
@@ -0,0 +1,75 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_STARTUPGRAPH_H
+#define SANTA_SANTAD_STARTUPGRAPH_H
+
+#include <dispatch/dispatch.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Runs startup initializers concurrently while respecting their dependencies.
+// Each task starts as soon as every task it depends on has finished.
+class StartupGraph {
+ public:
+  struct Timing {
+    std::string name;
+    // Time from the start of Run until the task started and finished
+    uint64_t start_nanos;
+    uint64_t end_nanos;
+  };
+
+  StartupGraph();
+
+  // No moves, no copies
+  StartupGraph(StartupGraph&& other) = delete;
+  StartupGraph& operator=(StartupGraph&& rhs) = delete;
+  StartupGraph(const StartupGraph& other) = delete;
+  StartupGraph& operator=(const StartupGraph& other) = delete;
+
+  // Add a task that runs after the named tasks. Dependencies must already
+  // have been added, which also guarantees the graph has no cycles. Returns
+  // false if a dependency is unknown.
+  bool Add(std::string name, const std::vector<std::string>& deps,
+           void (^task)(void));
+
+  // Run all tasks and wait for them to finish. May only be called once.
+  void Run();
+
+  // Timings of each task in the order they were added. Only valid after Run.
+  std::vector<Timing> Timings();
+
+ private:
+  struct Task {
+    std::string name;
+    std::vector<size_t> deps;
+    void (^task)(void);
+  };
+
+  dispatch_queue_t q_;
+  std::vector<Task> tasks_;
+  absl::Mutex lock_;
+  std::vector<Timing> timings_ ABSL_GUARDED_BY(lock_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_STARTUPGRAPH_H
@@ -0,0 +1,101 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/StartupGraph.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "Source/common/SystemResources.h"
+
+namespace santa {
+
+StartupGraph::StartupGraph()
+    : q_(dispatch_queue_create(
+          "com.northpolesec.santa.daemon.startup",
+          dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT_WITH_AUTORELEASE_POOL,
+                                                  QOS_CLASS_USER_INTERACTIVE, 0))) {}
+
+bool StartupGraph::Add(std::string name, const std::vector<std::string>& deps,
+                       void (^task)(void)) {
+  std::vector<size_t> dep_indices;
+  for (const std::string& dep : deps) {
+    auto it = std::find_if(tasks_.begin(), tasks_.end(),
+                           [&dep](const Task& t) { return t.name == dep; });
+    if (it == tasks_.end()) {
+      return false;
+    }
+    dep_indices.push_back(it - tasks_.begin());
+  }
+
+  tasks_.push_back({.name = std::move(name), .deps = std::move(dep_indices), .task = task});
+  return true;
+}
+
+void StartupGraph::Run() {
+  uint64_t run_start = GetCurrentUptime();
+  dispatch_group_t all = dispatch_group_create();
+
+  {
+    absl::MutexLock lock(&lock_);
+    timings_.resize(tasks_.size());
+  }
+
+  // One group per task, left once the task finishes. Dependent tasks are
+  // started from a notify block on the groups they depend on.
+  std::vector<dispatch_group_t> done;
+  done.reserve(tasks_.size());
+  for (size_t i = 0; i < tasks_.size(); i++) {
+    done.push_back(dispatch_group_create());
+    dispatch_group_enter(done[i]);
+    dispatch_group_enter(all);
+  }
+
+  for (size_t i = 0; i < tasks_.size(); i++) {
+    dispatch_group_t ready = dispatch_group_create();
+    for (size_t dep : tasks_[i].deps) {
+      dispatch_group_enter(ready);
+      dispatch_group_notify(done[dep], q_, ^{
+        dispatch_group_leave(ready);
+      });
+    }
+
+    std::string name = tasks_[i].name;
+    void (^task)(void) = tasks_[i].task;
+    dispatch_group_t task_done = done[i];
+    dispatch_group_notify(ready, q_, ^{
+      uint64_t start = GetCurrentUptime();
+      task();
+      uint64_t end = GetCurrentUptime();
+      {
+        absl::MutexLock lock(&lock_);
+        timings_[i] = {.name = name,
+                       .start_nanos = start - run_start,
+                       .end_nanos = end - run_start};
+      }
+      dispatch_group_leave(task_done);
+      dispatch_group_leave(all);
+    });
+  }
+
+  dispatch_group_wait(all, DISPATCH_TIME_FOREVER);
+}
+
+std::vector<StartupGraph::Timing> StartupGraph::Timings() {
+  absl::MutexLock lock(&lock_);
+  return timings_;
+}
+
+}  // namespace santa
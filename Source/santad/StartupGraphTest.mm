@@ -0,0 +1,95 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/StartupGraph.h"
+
+#import <XCTest/XCTest.h>
+
+#include <atomic>
+#include <memory>
+
+using santa::StartupGraph;
+
+@interface StartupGraphTest : XCTestCase
+@end
+
+@implementation StartupGraphTest
+
+- (void)testUnknownDependency {
+  StartupGraph sut;
+  XCTAssertTrue(sut.Add("a", {}, ^{
+  }));
+  XCTAssertFalse(sut.Add("b", {"c"}, ^{
+  }));
+}
+
+- (void)testDependencyOrder {
+  StartupGraph sut;
+  NSMutableArray<NSString*>* order = [NSMutableArray array];
+  NSObject* lock = [[NSObject alloc] init];
+  void (^record)(NSString*) = ^(NSString* name) {
+    @synchronized(lock) {
+      [order addObject:name];
+    }
+  };
+
+  XCTAssertTrue(sut.Add("a", {}, ^{
+    record(@"a");
+  }));
+  XCTAssertTrue(sut.Add("b", {"a"}, ^{
+    record(@"b");
+  }));
+  XCTAssertTrue(sut.Add("c", {"a", "b"}, ^{
+    record(@"c");
+  }));
+
+  sut.Run();
+
+  XCTAssertEqualObjects(order, (@[ @"a", @"b", @"c" ]));
+
+  std::vector<StartupGraph::Timing> timings = sut.Timings();
+  XCTAssertEqual(timings.size(), 3);
+  XCTAssertEqual(timings[0].name, "a");
+  XCTAssertEqual(timings[2].name, "c");
+  XCTAssertLessThanOrEqual(timings[0].end_nanos, timings[1].start_nanos);
+  XCTAssertLessThanOrEqual(timings[1].end_nanos, timings[2].start_nanos);
+}
+
+- (void)testIndependentTasksRunConcurrently {
+  StartupGraph sut;
+  auto arrived = std::make_shared<std::atomic<int>>(0);
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+
+  // Each task waits for the other to start, which only finishes if both run
+  // at the same time
+  for (const char* name : {"a", "b"}) {
+    XCTAssertTrue(sut.Add(name, {}, ^{
+      if (arrived->fetch_add(1) == 1) {
+        dispatch_semaphore_signal(sema);
+      } else {
+        dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+      }
+    }));
+  }
+
+  sut.Run();
+
+  XCTAssertEqual(arrived->load(), 2);
+  std::vector<StartupGraph::Timing> timings = sut.Timings();
+  XCTAssertLessThan(timings[0].start_nanos, timings[1].end_nanos);
+  XCTAssertLessThan(timings[1].start_nanos, timings[0].end_nanos);
+}
+
+@end
@@ -26,11 +26,21 @@
 namespace santa {
 
 // Small helper class to synchronize writing to TTYs
+//
+// Identical messages written to the same TTY within a coalescing window of
+// the first are counted instead of written, and a single line with the count
+// is written when the window ends. TTY descriptors are kept open in a small
+// LRU cache while in use and closed once idle.
 class TTYWriter {
  public:
+  static constexpr uint64_t kDefaultCoalesceWindowMs = 2000;
+  static constexpr size_t kMaxCachedFds = 8;
+  static constexpr uint64_t kFdIdleTimeoutMs = 30000;
+
   static std::unique_ptr<TTYWriter> Create(bool silent_tty_mode);
 
-  TTYWriter(dispatch_queue_t q, bool silent_tty_mode);
+  TTYWriter(dispatch_queue_t q, bool silent_tty_mode,
+            uint64_t coalesce_window_ms = kDefaultCoalesceWindowMs);
 
   // Moves can be safe, but not currently needed/implemented
   TTYWriter(TTYWriter&& other) = delete;
@@ -45,14 +55,20 @@ class TTYWriter {
   void Write(const es_process_t* proc, NSString* (^messageCreator)(void));
   void Write(const es_process_t* proc, NSString* msg);
   void WriteWithoutSignal(const es_process_t* proc, NSString* msg);
+  void WriteWithoutSignal(const es_process_t* proc, NSString* (^messageCreator)(void));
 
   void EnableSilentTTYMode(bool silent_tty_mode);
 
  private:
+  // Per-TTY coalescing and descriptor state. Only accessed on q_. Blocks
+  // scheduled on q_ hold a reference so it outlives the writer if needed.
+  class State;
+
   void Write(const es_process_t* proc, bool send_signal, NSString* (^messageCreator)(void));
 
   dispatch_queue_t q_;
   std::atomic<bool> silent_tty_mode_;
+  std::shared_ptr<State> state_;
 };
 
 }  // namespace santa
@@ -15,18 +15,208 @@
 
 #include "Source/santad/TTYWriter.h"
 
+#include <fcntl.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/errno.h>
 #include <sys/ioctl.h>
 #include <sys/param.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
 
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
 #include "Source/common/String.h"
+#include "absl/container/flat_hash_map.h"
 
 namespace santa {
 
+class TTYWriter::State : public std::enable_shared_from_this<State> {
+ public:
+  State(dispatch_queue_t q, uint64_t coalesce_window_ns)
+      : q_(q), coalesce_window_ns_(coalesce_window_ns) {}
+
+  ~State() {
+    for (auto& [path, tty] : ttys_) {
+      if (tty.fd >= 0) {
+        close(tty.fd);
+      }
+    }
+  }
+
+  // Must be called on q_
+  void Write(const std::string& path, NSString* msg, bool send_signal) {
+    uint64_t now = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    TTY& tty = ttys_[path];
+
+    if (now < tty.window_end_ns && [tty.last_msg isEqualToString:msg]) {
+      tty.repeats++;
+      tty.repeats_send_signal = send_signal;
+      if (!tty.flush_scheduled) {
+        tty.flush_scheduled = true;
+        std::weak_ptr<State> weak_state = weak_from_this();
+        std::string path_copy = path;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(tty.window_end_ns - now)), q_,
+                       ^{
+                         if (auto state = weak_state.lock()) {
+                           state->FlushRepeats(path_copy);
+                         }
+                       });
+      }
+      return;
+    }
+
+    // Report repeats of the previous message before moving on from it
+    WriteRepeats(path, tty);
+    WriteToTTY(path, tty, santa::NSStringToUTF8StringView(msg), send_signal);
+    tty.last_msg = msg;
+    tty.window_end_ns = now + coalesce_window_ns_;
+  }
+
+ private:
+  struct TTY {
+    int fd = -1;
+    uint64_t last_used_ns = 0;
+    NSString* last_msg;
+    uint64_t window_end_ns = 0;
+    uint32_t repeats = 0;
+    bool repeats_send_signal = false;
+    bool flush_scheduled = false;
+  };
+
+  void FlushRepeats(const std::string& path) {
+    auto it = ttys_.find(path);
+    if (it == ttys_.end()) {
+      return;
+    }
+    it->second.flush_scheduled = false;
+    WriteRepeats(path, it->second);
+  }
+
+  void WriteRepeats(const std::string& path, TTY& tty) {
+    if (tty.repeats == 0) {
+      return;
+    }
+
+    NSString* msg = [NSString stringWithFormat:@"(last message repeated %u more time%@)\n",
+                                               tty.repeats, tty.repeats == 1 ? @"" : @"s"];
+    tty.repeats = 0;
+    WriteToTTY(path, tty, santa::NSStringToUTF8StringView(msg), tty.repeats_send_signal);
+  }
+
+  int OpenFd(const std::string& path, TTY& tty) {
+    if (tty.fd >= 0) {
+      return tty.fd;
+    }
+
+    if (open_fds_ >= kMaxCachedFds) {
+      // Evict the least recently used descriptor
+      TTY* lru = nullptr;
+      for (auto& [other_path, other] : ttys_) {
+        if (other.fd >= 0 && (!lru || other.last_used_ns < lru->last_used_ns)) {
+          lru = &other;
+        }
+      }
+      if (lru) {
+        CloseFd(*lru);
+      }
+    }
+
+    tty.fd = open(path.c_str(), O_WRONLY | O_NOCTTY | O_CLOEXEC);
+    if (tty.fd == -1) {
+      LOGW(@"Failed to open TTY for writing: %s", strerror(errno));
+      return -1;
+    }
+
+    open_fds_++;
+    ScheduleSweep();
+    return tty.fd;
+  }
+
+  void CloseFd(TTY& tty) {
+    if (tty.fd >= 0) {
+      close(tty.fd);
+      tty.fd = -1;
+      open_fds_--;
+    }
+  }
+
+  void WriteToTTY(const std::string& path, TTY& tty, std::string_view str, bool send_signal) {
+    int fd = OpenFd(path, tty);
+    if (fd == -1) {
+      return;
+    }
+
+    if (write(fd, str.data(), str.length()) == -1) {
+      // The cached descriptor may be stale, e.g. the terminal it belonged to
+      // was closed. Retry once with a fresh one.
+      CloseFd(tty);
+      fd = OpenFd(path, tty);
+      if (fd == -1) {
+        return;
+      }
+      write(fd, str.data(), str.length());
+    }
+    tty.last_used_ns = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+
+    // Send SIGWINCH to the foreground process group to trigger a shell prompt redraw.
+    // Without this, the prompt gets "buried" above our message because the shell
+    // redraws its prompt when the blocked process exits, but our async write
+    // happens after that.
+    pid_t pgrp = 0;
+    if (send_signal) {
+      ioctl(fd, TIOCGPGRP, &pgrp);
+    }
+
+    if (send_signal && pgrp > 1) {
+      kill(-pgrp, SIGWINCH);
+    }
+  }
+
+  // Close descriptors that have been idle for kFdIdleTimeoutMs and forget
+  // TTYs that have nothing left to coalesce
+  void ScheduleSweep() {
+    if (sweep_scheduled_) {
+      return;
+    }
+    sweep_scheduled_ = true;
+
+    std::weak_ptr<State> weak_state = weak_from_this();
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kFdIdleTimeoutMs * NSEC_PER_MSEC), q_, ^{
+      if (auto state = weak_state.lock()) {
+        state->Sweep();
+      }
+    });
+  }
+
+  void Sweep() {
+    sweep_scheduled_ = false;
+    uint64_t now = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    uint64_t idle_timeout_ns = kFdIdleTimeoutMs * NSEC_PER_MSEC;
+
+    absl::erase_if(ttys_, [&](auto& entry) {
+      TTY& tty = entry.second;
+      if (tty.fd >= 0 && now - tty.last_used_ns >= idle_timeout_ns) {
+        CloseFd(tty);
+      }
+      return tty.fd < 0 && !tty.flush_scheduled && now >= tty.window_end_ns;
+    });
+
+    if (open_fds_ > 0) {
+      ScheduleSweep();
+    }
+  }
+
+  dispatch_queue_t q_;
+  const uint64_t coalesce_window_ns_;
+  absl::flat_hash_map<std::string, TTY> ttys_;
+  size_t open_fds_ = 0;
+  bool sweep_scheduled_ = false;
+};
+
 std::unique_ptr<TTYWriter> TTYWriter::Create(bool silent_tty_mode) {
   dispatch_queue_t q = dispatch_queue_create_with_target(
       "com.northpolesec.santa.ttywriter", DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL,
@@ -40,8 +230,10 @@ std::unique_ptr<TTYWriter> TTYWriter::Create(bool silent_tty_mode) {
   return std::make_unique<TTYWriter>(q, silent_tty_mode);
 }
 
-TTYWriter::TTYWriter(dispatch_queue_t q, bool silent_tty_mode)
-    : q_(q), silent_tty_mode_(silent_tty_mode) {}
+TTYWriter::TTYWriter(dispatch_queue_t q, bool silent_tty_mode, uint64_t coalesce_window_ms)
+    : q_(q),
+      silent_tty_mode_(silent_tty_mode),
+      state_(std::make_shared<State>(q, coalesce_window_ms * NSEC_PER_MSEC)) {}
 
 bool TTYWriter::CanWrite(const es_process_t* proc) {
   return proc && proc->tty && proc->tty->path.length > 0;
@@ -55,7 +247,7 @@ void TTYWriter::Write(const es_process_t* proc, bool send_signal,
 
   // Copy the data from the es_process_t so the ES message doesn't
   // need to be retained
-  NSString* tty = santa::StringToNSString(proc->tty->path.data);
+  std::string tty(proc->tty->path.data, proc->tty->path.length);
   // Realize the message string before going async so as not to need to worry about
   // lifetimes of objects in the provided block.
   NSString* msg = messageCreator();
@@ -65,30 +257,9 @@ void TTYWriter::Write(const es_process_t* proc, bool send_signal,
   }
   msg = [msg stringByAppendingFormat:@"\n"];
 
+  std::shared_ptr<State> state = state_;
   dispatch_async(q_, ^{
-    int fd = open(tty.UTF8String, O_WRONLY | O_NOCTTY);
-    if (fd == -1) {
-      LOGW(@"Failed to open TTY for writing: %s", strerror(errno));
-      return;
-    }
-
-    std::string_view str = santa::NSStringToUTF8StringView(msg);
-    write(fd, str.data(), str.length());
-
-    // Send SIGWINCH to the foreground process group to trigger a shell prompt redraw.
-    // Without this, the prompt gets "buried" above our message because the shell
-    // redraws its prompt when the blocked process exits, but our async write
-    // happens after that.
-    pid_t pgrp = 0;
-    if (send_signal) {
-      ioctl(fd, TIOCGPGRP, &pgrp);
-    }
-
-    close(fd);
-
-    if (send_signal && pgrp > 1) {
-      kill(-pgrp, SIGWINCH);
-    }
+    state->Write(tty, msg, send_signal);
   });
 }
 
@@ -108,6 +279,10 @@ void TTYWriter::WriteWithoutSignal(const es_process_t* proc, NSString* msg) {
   });
 }
 
+void TTYWriter::WriteWithoutSignal(const es_process_t* proc, NSString* (^messageCreator)(void)) {
+  Write(proc, false, messageCreator);
+}
+
 void TTYWriter::EnableSilentTTYMode(bool silent_tty_mode) {
   silent_tty_mode_.store(silent_tty_mode, std::memory_order_relaxed);
 }
@@ -0,0 +1,149 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/TTYWriter.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include "Source/common/TestUtils.h"
+
+using santa::TTYWriter;
+
+@interface TTYWriterTest : XCTestCase
+@property NSString* ttyPath;
+@property dispatch_queue_t q;
+@end
+
+@implementation TTYWriterTest
+
+- (void)setUp {
+  // A regular file stands in for the TTY so the output can be inspected
+  self.ttyPath = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"tty_%@", [NSUUID UUID]]];
+  XCTAssertTrue([[NSFileManager defaultManager] createFileAtPath:self.ttyPath
+                                                        contents:nil
+                                                      attributes:nil]);
+  self.q = dispatch_queue_create("com.northpolesec.santa.ttywriter.test", DISPATCH_QUEUE_SERIAL);
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.ttyPath error:nil];
+}
+
+- (NSString*)ttyContents {
+  // Wait for writes already queued to finish
+  dispatch_sync(self.q, ^{
+                });
+  return [NSString stringWithContentsOfFile:self.ttyPath encoding:NSUTF8StringEncoding error:nil];
+}
+
+- (NSUInteger)countOf:(NSString*)needle in:(NSString*)haystack {
+  return [haystack componentsSeparatedByString:needle].count - 1;
+}
+
+- (void)testIdenticalMessagesAreCoalesced {
+  auto writer = std::make_unique<TTYWriter>(self.q, false, 200);
+  es_file_t ttyFile = MakeESFile(self.ttyPath.UTF8String);
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile);
+  proc.tty = &ttyFile;
+
+  for (int i = 0; i < 5; i++) {
+    writer->WriteWithoutSignal(&proc, @"blocked foo");
+  }
+
+  // Only the first message is written right away
+  NSString* got = [self ttyContents];
+  XCTAssertEqual([self countOf:@"blocked foo" in:got], 1);
+  XCTAssertEqual([self countOf:@"repeated" in:got], 0);
+
+  // The repeat count is written once the window ends
+  usleep(400 * 1000);
+  got = [self ttyContents];
+  XCTAssertEqual([self countOf:@"blocked foo" in:got], 1);
+  XCTAssertTrue([got hasSuffix:@"(last message repeated 4 more times)\n"], @"%@", got);
+
+  // After the window, the message is written again
+  writer->WriteWithoutSignal(&proc, @"blocked foo");
+  got = [self ttyContents];
+  XCTAssertEqual([self countOf:@"blocked foo" in:got], 2);
+}
+
+- (void)testDifferentMessagesAreWritten {
+  auto writer = std::make_unique<TTYWriter>(self.q, false, 10000);
+  es_file_t ttyFile = MakeESFile(self.ttyPath.UTF8String);
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile);
+  proc.tty = &ttyFile;
+
+  writer->WriteWithoutSignal(&proc, @"blocked foo");
+  writer->WriteWithoutSignal(&proc, @"blocked foo");
+  writer->WriteWithoutSignal(&proc, @"blocked bar");
+
+  // Switching messages reports the repeats of the previous one first
+  NSString* got = [self ttyContents];
+  XCTAssertEqual([self countOf:@"blocked foo" in:got], 1);
+  XCTAssertEqual([self countOf:@"(last message repeated 1 more time)\n" in:got], 1);
+  XCTAssertEqual([self countOf:@"blocked bar" in:got], 1);
+  XCTAssertLessThan([got rangeOfString:@"repeated"].location,
+                    [got rangeOfString:@"blocked bar"].location);
+}
+
+- (void)testSilentModeWritesNothing {
+  auto writer = std::make_unique<TTYWriter>(self.q, true);
+  es_file_t ttyFile = MakeESFile(self.ttyPath.UTF8String);
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile);
+  proc.tty = &ttyFile;
+
+  writer->Write(&proc, @"blocked foo");
+  XCTAssertEqualObjects([self ttyContents], @"");
+
+  writer->EnableSilentTTYMode(false);
+  writer->WriteWithoutSignal(&proc, @"blocked foo");
+  XCTAssertEqual([self countOf:@"blocked foo" in:[self ttyContents]], 1);
+}
+
+- (void)testMessageOnlyBuiltWhenWritten {
+  auto writer = std::make_unique<TTYWriter>(self.q, true);
+  es_file_t ttyFile = MakeESFile(self.ttyPath.UTF8String);
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile);
+  __block int built = 0;
+  NSString* (^messageCreator)(void) = ^NSString* {
+    built++;
+    return @"blocked foo";
+  };
+
+  // Neither silent mode nor a process without a TTY builds the message
+  proc.tty = &ttyFile;
+  writer->WriteWithoutSignal(&proc, messageCreator);
+  writer->EnableSilentTTYMode(false);
+  proc.tty = NULL;
+  writer->WriteWithoutSignal(&proc, messageCreator);
+  XCTAssertEqual(built, 0);
+
+  proc.tty = &ttyFile;
+  writer->WriteWithoutSignal(&proc, messageCreator);
+  XCTAssertEqual(built, 1);
+  XCTAssertEqual([self countOf:@"blocked foo" in:[self ttyContents]], 1);
+}
+
+@end
@@ -51,7 +51,9 @@ TemporaryMonitorMode::TemporaryMonitorMode(PassKey, SNTConfigurator* configurato
                                            HandleAuditEventBlock handle_audit_event_block)
     : Timer(kMinTemporaryMonitorModeMinutes, kMaxTemporaryMonitorModeMinutes,
             Timer::OnStart::kWaitOneCycle, "Temporary Monitor Mode",
-            Timer::RescheduleMode::kTrailingEdge, QOS_CLASS_USER_INITIATED),
+            Timer::RescheduleMode::kTrailingEdge, QOS_CLASS_USER_INITIATED,
+            // Users are told when monitor mode ends, so don't let it run over
+            /*leeway_percent=*/0),
       configurator_(configurator),
       notification_queue_(notification_queue),
       handle_audit_event_block_([handle_audit_event_block copy]),
@@ -0,0 +1,82 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#ifndef SANTA_SANTAD_UPLOADBACKOFF_H
+#define SANTA_SANTAD_UPLOADBACKOFF_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Tracks when uploads were last started for a set of keys so that repeated
+// uploads of the same key within a window can be skipped.
+//
+// Keys are stored as 64-bit xxhash values alongside a packed timestamp in a
+// fixed size set associative table. When every way of a bucket is in use, the
+// entry that was started longest ago is replaced, so memory stays constant and
+// a flood of new keys only evicts the oldest entries rather than resetting all
+// of them.
+class UploadBackoff {
+ public:
+  static constexpr size_t kWays = 4;
+
+  static std::unique_ptr<UploadBackoff> Create(size_t capacity,
+                                               uint32_t window_seconds);
+
+  // Capacity is rounded up to a multiple of kWays buckets with a power of two
+  // bucket count
+  UploadBackoff(size_t capacity, uint32_t window_seconds);
+
+  UploadBackoff(UploadBackoff&& other) = delete;
+  UploadBackoff& operator=(UploadBackoff&& rhs) = delete;
+  UploadBackoff(const UploadBackoff& other) = delete;
+  UploadBackoff& operator=(const UploadBackoff& other) = delete;
+
+  // Returns true if an upload for the key started within the window.
+  // Otherwise records that an upload is starting now and returns false.
+  bool ShouldBackoff(std::string_view key);
+  bool ShouldBackoff(std::string_view key, uint32_t now_seconds);
+
+  // Forget the key, e.g. after its upload failed, so the next attempt is
+  // allowed right away
+  void Remove(std::string_view key);
+
+ private:
+  struct Slot {
+    // Zero marks an empty slot
+    uint64_t key;
+    uint32_t started;
+  };
+
+  static uint64_t HashKey(std::string_view key);
+  uint32_t NowSeconds() const;
+  Slot* BucketForKey(uint64_t key) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_);
+
+  uint32_t window_seconds_;
+  uint64_t epoch_nanos_;
+  size_t bucket_mask_;
+  absl::Mutex mtx_;
+  std::vector<Slot> slots_ ABSL_GUARDED_BY(mtx_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_UPLOADBACKOFF_H
@@ -0,0 +1,97 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/UploadBackoff.h"
+
+#include <dispatch/dispatch.h>
+#include <time.h>
+
+#include <algorithm>
+#include <bit>
+
+#include "xxhash.h"
+
+namespace santa {
+
+std::unique_ptr<UploadBackoff> UploadBackoff::Create(size_t capacity, uint32_t window_seconds) {
+  return std::make_unique<UploadBackoff>(capacity, window_seconds);
+}
+
+UploadBackoff::UploadBackoff(size_t capacity, uint32_t window_seconds)
+    : window_seconds_(window_seconds),
+      epoch_nanos_(clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW)) {
+  size_t buckets = std::bit_ceil(std::max<size_t>(1, (capacity + kWays - 1) / kWays));
+  bucket_mask_ = buckets - 1;
+  slots_.resize(buckets * kWays, Slot{0, 0});
+}
+
+uint64_t UploadBackoff::HashKey(std::string_view key) {
+  uint64_t hash = XXH3_64bits(key.data(), key.length());
+  return hash ?: 1;
+}
+
+// Time is kept relative to when the table was created so it fits in 32 bits
+uint32_t UploadBackoff::NowSeconds() const {
+  return (uint32_t)((clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW) - epoch_nanos_) / NSEC_PER_SEC);
+}
+
+UploadBackoff::Slot* UploadBackoff::BucketForKey(uint64_t key) {
+  return &slots_[(key & bucket_mask_) * kWays];
+}
+
+bool UploadBackoff::ShouldBackoff(std::string_view key) {
+  return ShouldBackoff(key, NowSeconds());
+}
+
+bool UploadBackoff::ShouldBackoff(std::string_view key, uint32_t now_seconds) {
+  uint64_t hash = HashKey(key);
+
+  absl::MutexLock lock(&mtx_);
+  Slot* bucket = BucketForKey(hash);
+  Slot* victim = &bucket[0];
+  for (size_t i = 0; i < kWays; i++) {
+    Slot& slot = bucket[i];
+    if (slot.key == hash) {
+      if (now_seconds - slot.started < window_seconds_) {
+        return true;
+      }
+      victim = &slot;
+      break;
+    }
+
+    // Prefer empty slots, then the entry that was started longest ago
+    if (victim->key != 0 && (slot.key == 0 || slot.started < victim->started)) {
+      victim = &slot;
+    }
+  }
+
+  *victim = Slot{hash, now_seconds};
+  return false;
+}
+
+void UploadBackoff::Remove(std::string_view key) {
+  uint64_t hash = HashKey(key);
+
+  absl::MutexLock lock(&mtx_);
+  Slot* bucket = BucketForKey(hash);
+  for (size_t i = 0; i < kWays; i++) {
+    if (bucket[i].key == hash) {
+      bucket[i] = Slot{0, 0};
+      return;
+    }
+  }
+}
+
+}  // namespace santa
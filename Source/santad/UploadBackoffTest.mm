@@ -0,0 +1,74 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#include "Source/santad/UploadBackoff.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+
+using santa::UploadBackoff;
+
+@interface UploadBackoffTest : XCTestCase
+@end
+
+@implementation UploadBackoffTest
+
+- (void)testWindow {
+  auto sut = UploadBackoff::Create(1024, 600);
+
+  XCTAssertFalse(sut->ShouldBackoff("a", 100));
+  XCTAssertTrue(sut->ShouldBackoff("a", 100));
+  XCTAssertTrue(sut->ShouldBackoff("a", 699));
+  XCTAssertFalse(sut->ShouldBackoff("b", 699));
+
+  // Once the window passes, the next upload starts a new one
+  XCTAssertFalse(sut->ShouldBackoff("a", 700));
+  XCTAssertTrue(sut->ShouldBackoff("a", 701));
+  XCTAssertTrue(sut->ShouldBackoff("b", 701));
+}
+
+- (void)testRemove {
+  auto sut = UploadBackoff::Create(1024, 600);
+
+  XCTAssertFalse(sut->ShouldBackoff("a", 1));
+  XCTAssertFalse(sut->ShouldBackoff("b", 1));
+  sut->Remove("a");
+  sut->Remove("missing");
+
+  XCTAssertFalse(sut->ShouldBackoff("a", 2));
+  XCTAssertTrue(sut->ShouldBackoff("a", 2));
+  XCTAssertTrue(sut->ShouldBackoff("b", 2));
+}
+
+- (void)testOldestEntryIsReplaced {
+  // A single bucket, every key competes for the same slots
+  auto sut = UploadBackoff::Create(UploadBackoff::kWays, 600);
+
+  for (uint32_t i = 0; i < UploadBackoff::kWays; i++) {
+    XCTAssertFalse(sut->ShouldBackoff(std::to_string(i), i + 1));
+  }
+
+  // A new key only replaces the one started longest ago
+  XCTAssertFalse(sut->ShouldBackoff("new", 10));
+  for (uint32_t i = 1; i < UploadBackoff::kWays; i++) {
+    XCTAssertTrue(sut->ShouldBackoff(std::to_string(i), 11));
+  }
+  XCTAssertTrue(sut->ShouldBackoff("new", 11));
+  XCTAssertFalse(sut->ShouldBackoff("0", 11));
+}
+
+@end
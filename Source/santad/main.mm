@@ -22,6 +22,7 @@
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTSystemInfo.h"
+#include "Source/common/Signposts.h"
 #import "Source/common/SystemResources.h"
 #include "Source/santad/ProcessControl.h"
 #import "Source/santad/Santad.h"
@@ -131,9 +132,13 @@ int main(int argc, char* argv[]) {
       LOGE(@"Failed to start Santa watchdog");
     }
 
+    santa::LoadPersistedSignpostsSetting();
+
+    os_signpost_id_t signpost = santa::BeginSignpost(santa::SignpostPhase::kSantadDeps);
     std::unique_ptr<SantadDeps> deps =
         SantadDeps::Create([SNTConfigurator configurator], [SNTMetricSet sharedInstance],
                            santa::ProdSuspendResumeBlock());
+    santa::EndSignpost(santa::SignpostPhase::kSantadDeps, signpost);
 
     // This doesn't return
     SantadMain(deps->ESAPI(), deps->Logger(), deps->Metrics(), deps->WatchItems(), deps->Enricher(),
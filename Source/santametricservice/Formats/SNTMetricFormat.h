@@ -19,4 +19,14 @@
 - (NSArray<NSData*>*)convert:(NSDictionary*)metrics
                 endTimestamp:(NSDate*)endTimestamp
                        error:(NSError**)err;
+
+@optional
+/**
+ * Converts several exports, e.g. ones that couldn't be delivered earlier,
+ * into as few entries as the format allows. Each export is paired with the
+ * end timestamp at the same index.
+ */
+- (NSArray<NSData*>*)convertBatch:(NSArray<NSDictionary*>*)metricsBatch
+                    endTimestamps:(NSArray<NSDate*>*)endTimestamps
+                            error:(NSError**)err;
 @end
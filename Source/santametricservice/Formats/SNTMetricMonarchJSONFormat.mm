@@ -33,6 +33,8 @@ const NSString* kInt64Value = @"int64Value";
 const NSString* kInt64ValueType = @"INT64";
 const NSString* kStringValue = @"stringValue";
 const NSString* kStringValueType = @"STRING";
+const NSString* kDistributionValue = @"distributionValue";
+const NSString* kDistributionValueType = @"DISTRIBUTION";
 const NSString* kName = @"name";
 const NSString* kStartTimestamp = @"startTimestamp";
 const NSString* kEndTimestamp = @"endTimestamp";
@@ -92,6 +94,10 @@ const NSString* kKey = @"key";
       monarchMetric[kStreamKind] = @"CUMULATIVE";
       monarchMetric[kValueType] = kInt64ValueType;
       break;
+    case SNTMetricTypeHistogram:
+      monarchMetric[kStreamKind] = @"CUMULATIVE";
+      monarchMetric[kValueType] = kDistributionValueType;
+      break;
     default:
       LOGE(@"encountered unknown SNTMetricType - %ld for %@",
            static_cast<SNTMetricType>([metric[@"type"] integerValue]), metricName);
@@ -99,6 +105,16 @@ const NSString* kKey = @"key";
   }
 }
 
+- (NSDictionary*)encodeDistribution:(NSDictionary*)distribution {
+  return @{
+    @"count" : distribution[@"count"] ?: @0,
+    @"mean" : distribution[@"mean"] ?: @0,
+    @"sumOfSquaredDeviation" : distribution[@"sum_of_squared_deviation"] ?: @0,
+    @"bucketOptions" : @{@"explicitBuckets" : @{@"bounds" : distribution[@"bucket_bounds"] ?: @[]}},
+    @"bucketCounts" : distribution[@"bucket_counts"] ?: @[],
+  };
+}
+
 - (NSArray<NSDictionary*>*)encodeDataForMetric:(NSDictionary*)metric
                               withEndTimestamp:(NSDate*)endTimestamp {
   NSMutableArray<NSDictionary*>* monarchMetricData = [[NSMutableArray alloc] init];
@@ -145,6 +161,9 @@ const NSString* kKey = @"key";
         case SNTMetricTypeGaugeDouble: monarchDataEntry[@"doubleValue"] = entry[@"data"]; break;
         case SNTMetricTypeConstantString:
         case SNTMetricTypeGaugeString: monarchDataEntry[kStringValue] = entry[@"data"]; break;
+        case SNTMetricTypeHistogram:
+          monarchDataEntry[kDistributionValue] = [self encodeDistribution:entry[@"data"]];
+          break;
         default: LOGE(@"encountered unknown SNTMetricType %ld", [type longValue]); break;
       }
       [monarchMetricData addObject:monarchDataEntry];
@@ -234,7 +253,22 @@ const NSString* kKey = @"key";
 - (NSArray<NSData*>*)convert:(NSDictionary*)metrics
                 endTimestamp:(NSDate*)endTimestamp
                        error:(NSError**)err {
-  NSDictionary* normalizedMetrics = [self normalize:metrics endTimestamp:endTimestamp];
+  return [self convertBatch:@[ metrics ] endTimestamps:@[ endTimestamp ] error:err];
+}
+
+/*
+ * ConvertBatch serializes several exports as a single JSON object, with one
+ * metricsCollection entry per export.
+ */
+- (NSArray<NSData*>*)convertBatch:(NSArray<NSDictionary*>*)metricsBatch
+                    endTimestamps:(NSArray<NSDate*>*)endTimestamps
+                            error:(NSError**)err {
+  NSMutableArray<NSDictionary*>* collections = [[NSMutableArray alloc] init];
+  for (NSUInteger i = 0; i < metricsBatch.count; i++) {
+    NSDictionary* normalized = [self normalize:metricsBatch[i] endTimestamp:endTimestamps[i]];
+    [collections addObjectsFromArray:normalized[kMetricsCollection]];
+  }
+  NSDictionary* normalizedMetrics = @{kMetricsCollection : collections};
 
   NSData* json = [NSJSONSerialization dataWithJSONObject:normalizedMetrics
                                                  options:NSJSONWritingPrettyPrinted
@@ -15,6 +15,7 @@
 #import <XCTest/XCTest.h>
 
 #import <Foundation/Foundation.h>
+#import "Source/common/SNTMetricSet.h"
 #import "Source/santametricservice/Formats/SNTMetricFormatTestHelper.h"
 #import "Source/santametricservice/Formats/SNTMetricMonarchJSONFormat.h"
 
@@ -57,6 +58,70 @@
   XCTAssertEqualObjects(expectedJSONDict, jsonDict, @"generated JSON does not match golden file.");
 }
 
+- (void)testHistogramConversionToDistribution {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] initWithHostname:@"testHost"
+                                                          username:@"testUser"];
+  SNTMetricHistogram* h = [metricSet histogramWithName:@"/santa/latency"
+                                            fieldNames:@[ @"stage" ]
+                                              helpText:@"Latency in milliseconds"
+                                          bucketBounds:@[ @1, @10 ]];
+  [h record:2 forFieldValues:@[ @"auth" ]];
+  [h record:4 forFieldValues:@[ @"auth" ]];
+
+  SNTMetricMonarchJSONFormat* formatter = [[SNTMetricMonarchJSONFormat alloc] init];
+  NSError* err = nil;
+  NSArray<NSData*>* output = [formatter convert:[metricSet export]
+                                   endTimestamp:[NSDate date]
+                                          error:&err];
+  XCTAssertEqual(1, output.count);
+  XCTAssertNil(err);
+
+  NSDictionary* jsonDict = [NSJSONSerialization JSONObjectWithData:output[0]
+                                                           options:NSJSONReadingAllowFragments
+                                                             error:&err];
+  NSDictionary* metric;
+  for (NSDictionary* m in jsonDict[@"metricsCollection"][0][@"metricsDataSet"]) {
+    if ([m[@"metricName"] isEqualToString:@"/santa/latency"]) {
+      metric = m;
+    }
+  }
+  XCTAssertEqualObjects(metric[@"streamKind"], @"CUMULATIVE");
+  XCTAssertEqualObjects(metric[@"valueType"], @"DISTRIBUTION");
+
+  NSDictionary* want = @{
+    @"count" : @2,
+    @"mean" : @3,
+    @"sumOfSquaredDeviation" : @2,
+    @"bucketOptions" : @{@"explicitBuckets" : @{@"bounds" : @[ @1, @10 ]}},
+    @"bucketCounts" : @[ @0, @2, @0 ],
+  };
+  XCTAssertEqualObjects(metric[@"data"][0][@"distributionValue"], want);
+}
+
+- (void)testBatchConversionIsOneDocument {
+  NSDictionary* validMetricsDict = [SNTMetricFormatTestHelper createValidMetricsDictionary];
+  NSDate* first = [NSDate dateWithTimeIntervalSince1970:1631826490];
+  NSDate* second = [first dateByAddingTimeInterval:30];
+
+  SNTMetricMonarchJSONFormat* formatter = [[SNTMetricMonarchJSONFormat alloc] init];
+  NSError* err = nil;
+  NSArray<NSData*>* output = [formatter convertBatch:@[ validMetricsDict, validMetricsDict ]
+                                       endTimestamps:@[ first, second ]
+                                               error:&err];
+  XCTAssertEqual(1, output.count);
+  XCTAssertNil(err);
+
+  NSDictionary* jsonDict = [NSJSONSerialization JSONObjectWithData:output[0]
+                                                           options:NSJSONReadingAllowFragments
+                                                             error:&err];
+  NSArray* collections = jsonDict[@"metricsCollection"];
+  XCTAssertEqual(2, collections.count);
+  XCTAssertEqualObjects(collections[0][@"metricsDataSet"][0][@"data"][0][@"endTimestamp"],
+                        @"2021-09-16T21:08:10.000Z");
+  XCTAssertEqualObjects(collections[1][@"metricsDataSet"][0][@"data"][0][@"endTimestamp"],
+                        @"2021-09-16T21:08:40.000Z");
+}
+
 - (void)testPassingANilOrNullErrorDoesNotCrash {
   SNTMetricMonarchJSONFormat* formatter = [[SNTMetricMonarchJSONFormat alloc] init];
   NSDictionary* validMetricsDict = [SNTMetricFormatTestHelper createValidMetricsDictionary];
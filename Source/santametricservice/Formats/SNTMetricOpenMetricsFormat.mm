@@ -0,0 +1,252 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santametricservice/Formats/SNTMetricOpenMetricsFormat.h"
+
+#include <cmath>
+
+#import "Source/common/SNTLogging.h"
+#import "Source/common/SNTMetricSet.h"
+
+/**
+ * Converts a metric name such as /santa/events into a valid OpenMetrics
+ * metric name such as santa_events.
+ */
+static NSString* SanitizedName(NSString* name) {
+  NSMutableString* sanitized = [NSMutableString stringWithCapacity:name.length];
+  for (NSUInteger i = 0; i < name.length; i++) {
+    unichar c = [name characterAtIndex:i];
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+        c == '_' || c == ':') {
+      [sanitized appendFormat:@"%C", c];
+    } else if (sanitized.length > 0) {
+      [sanitized appendString:@"_"];
+    }
+  }
+
+  if (sanitized.length > 0 && [sanitized characterAtIndex:0] >= '0' &&
+      [sanitized characterAtIndex:0] <= '9') {
+    [sanitized insertString:@"_" atIndex:0];
+  }
+  return sanitized;
+}
+
+static NSString* EscapedLabelValue(NSString* value) {
+  NSString* escaped = [value stringByReplacingOccurrencesOfString:@"\\" withString:@"\\\\"];
+  escaped = [escaped stringByReplacingOccurrencesOfString:@"\"" withString:@"\\\""];
+  return [escaped stringByReplacingOccurrencesOfString:@"\n" withString:@"\\n"];
+}
+
+static NSString* EscapedHelp(NSString* help) {
+  NSString* escaped = [help stringByReplacingOccurrencesOfString:@"\\" withString:@"\\\\"];
+  return [escaped stringByReplacingOccurrencesOfString:@"\n" withString:@"\\n"];
+}
+
+static NSString* FormattedDouble(double value) {
+  if (std::isnan(value)) return @"NaN";
+  if (std::isinf(value)) return value > 0 ? @"+Inf" : @"-Inf";
+  return [@(value) stringValue];
+}
+
+/**
+ * Returns the label set for a sample, e.g. {rule_type="binary",client="authorizer"},
+ * or an empty string if there are no labels.
+ */
+static NSString* FormattedLabels(NSArray<NSString*>* names, NSArray<NSString*>* values) {
+  if (names.count == 0) {
+    return @"";
+  }
+
+  NSMutableArray<NSString*>* pairs = [NSMutableArray arrayWithCapacity:names.count];
+  for (NSUInteger i = 0; i < names.count; i++) {
+    [pairs addObject:[NSString stringWithFormat:@"%@=\"%@\"", SanitizedName(names[i]),
+                                                EscapedLabelValue(values[i])]];
+  }
+  return [NSString stringWithFormat:@"{%@}", [pairs componentsJoinedByString:@","]];
+}
+
+@implementation SNTMetricOpenMetricsFormat
+
+- (NSString*)familyTypeForMetricType:(SNTMetricType)type {
+  switch (type) {
+    case SNTMetricTypeConstantBool:
+    case SNTMetricTypeConstantInt64:
+    case SNTMetricTypeConstantDouble:
+    case SNTMetricTypeGaugeBool:
+    case SNTMetricTypeGaugeInt64:
+    case SNTMetricTypeGaugeDouble: return @"gauge";
+    case SNTMetricTypeConstantString:
+    case SNTMetricTypeGaugeString: return @"info";
+    case SNTMetricTypeCounter: return @"counter";
+    case SNTMetricTypeHistogram: return @"histogram";
+    default: return nil;
+  }
+}
+
+- (void)appendHistogram:(NSDictionary*)distribution
+                  named:(NSString*)family
+             fieldNames:(NSArray<NSString*>*)fieldNames
+            fieldValues:(NSArray<NSString*>*)fieldValues
+                     to:(NSMutableString*)output {
+  NSArray<NSNumber*>* bounds = distribution[@"bucket_bounds"];
+  NSArray<NSNumber*>* counts = distribution[@"bucket_counts"];
+  if (counts.count != bounds.count + 1) {
+    LOGE(@"malformed distribution encountered for %@", family);
+    return;
+  }
+
+  NSArray<NSString*>* bucketNames = [fieldNames arrayByAddingObject:@"le"];
+  long long cumulative = 0;
+  for (NSUInteger i = 0; i < bounds.count; i++) {
+    cumulative += [counts[i] longLongValue];
+    NSString* le = FormattedDouble([bounds[i] doubleValue]);
+    [output appendFormat:@"%@_bucket%@ %lld\n", family,
+                         FormattedLabels(bucketNames, [fieldValues arrayByAddingObject:le]),
+                         cumulative];
+  }
+
+  long long count = [distribution[@"count"] longLongValue];
+  NSString* labels = FormattedLabels(fieldNames, fieldValues);
+  [output appendFormat:@"%@_bucket%@ %lld\n", family,
+                       FormattedLabels(bucketNames, [fieldValues arrayByAddingObject:@"+Inf"]),
+                       count];
+  [output appendFormat:@"%@_sum%@ %@\n", family, labels,
+                       FormattedDouble([distribution[@"mean"] doubleValue] * count)];
+  [output appendFormat:@"%@_count%@ %lld\n", family, labels, count];
+}
+
+- (void)appendMetric:(NSDictionary*)metric
+               named:(NSString*)metricName
+                  to:(NSMutableString*)output {
+  if (![metric[@"type"] isKindOfClass:[NSNumber class]]) {
+    LOGE(@"metric type is missing for %@", metricName);
+    return;
+  }
+
+  SNTMetricType type = (SNTMetricType)[metric[@"type"] integerValue];
+  NSString* familyType = [self familyTypeForMetricType:type];
+  if (!familyType) {
+    LOGE(@"encountered unknown SNTMetricType %ld for %@", (long)type, metricName);
+    return;
+  }
+
+  NSString* family = SanitizedName(metricName);
+  // Counter samples get a _total suffix, so it must not be part of the family name
+  if (type == SNTMetricTypeCounter && [family hasSuffix:@"_total"]) {
+    family = [family substringToIndex:family.length - @"_total".length];
+  }
+
+  [output appendFormat:@"# TYPE %@ %@\n", family, familyType];
+  if ([metric[@"description"] length] > 0) {
+    [output appendFormat:@"# HELP %@ %@\n", family, EscapedHelp(metric[@"description"])];
+  }
+
+  NSArray<NSString*>* fieldKeys =
+      [[metric[@"fields"] allKeys] sortedArrayUsingSelector:@selector(compare:)];
+  for (NSString* fieldKey in fieldKeys) {
+    // Multiple fields are encoded as a single comma separated string.
+    NSArray<NSString*>* fieldNames =
+        fieldKey.length ? [fieldKey componentsSeparatedByString:@","] : @[];
+
+    NSArray<NSDictionary*>* entries = [metric[@"fields"][fieldKey]
+        sortedArrayUsingDescriptors:@[ [NSSortDescriptor sortDescriptorWithKey:@"value"
+                                                                     ascending:YES] ]];
+    for (NSDictionary* entry in entries) {
+      NSArray<NSString*>* fieldValues =
+          fieldNames.count ? [entry[@"value"] componentsSeparatedByString:@","] : @[];
+      if (fieldNames.count != fieldValues.count) {
+        LOGE(@"malformed metric data encountered: %@", fieldKey);
+        continue;
+      }
+
+      id data = entry[@"data"];
+      switch (type) {
+        case SNTMetricTypeCounter:
+          [output appendFormat:@"%@_total%@ %lld\n", family,
+                               FormattedLabels(fieldNames, fieldValues), [data longLongValue]];
+          break;
+        case SNTMetricTypeConstantBool:
+        case SNTMetricTypeGaugeBool:
+          [output appendFormat:@"%@%@ %d\n", family, FormattedLabels(fieldNames, fieldValues),
+                               [data boolValue] ? 1 : 0];
+          break;
+        case SNTMetricTypeConstantInt64:
+        case SNTMetricTypeGaugeInt64:
+          [output appendFormat:@"%@%@ %lld\n", family, FormattedLabels(fieldNames, fieldValues),
+                               [data longLongValue]];
+          break;
+        case SNTMetricTypeConstantDouble:
+        case SNTMetricTypeGaugeDouble:
+          [output appendFormat:@"%@%@ %@\n", family, FormattedLabels(fieldNames, fieldValues),
+                               FormattedDouble([data doubleValue])];
+          break;
+        case SNTMetricTypeConstantString:
+        case SNTMetricTypeGaugeString:
+          // Strings can't be sample values, so they're exposed as an info metric label
+          [output appendFormat:@"%@_info%@ 1\n", family,
+                               FormattedLabels([fieldNames arrayByAddingObject:@"value"],
+                                               [fieldValues arrayByAddingObject:data ?: @""])];
+          break;
+        case SNTMetricTypeHistogram:
+          [self appendHistogram:data
+                          named:family
+                     fieldNames:fieldNames
+                    fieldValues:fieldValues
+                             to:output];
+          break;
+        default: break;
+      }
+    }
+  }
+}
+
+/*
+ * Convert formats the metrics dictionary as OpenMetrics text. Root labels are
+ * exposed as a target_info metric rather than repeated on every sample, and
+ * samples carry no timestamps so that scrapers use their scrape time.
+ *
+ * @param metrics an NSDictionary exported by the SNTMetricSet
+ * @param error a pointer to an NSError to allow errors to bubble up.
+ *
+ * Returns an NSArray containing one entry of all metrics.
+ */
+- (NSArray<NSData*>*)convert:(NSDictionary*)metrics
+                endTimestamp:(NSDate*)endTimestamp
+                       error:(NSError**)err {
+  NSMutableString* output = [NSMutableString string];
+
+  NSDictionary* rootLabels = metrics[@"root_labels"];
+  if (rootLabels.count > 0) {
+    NSArray<NSString*>* names = [rootLabels.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    NSMutableArray<NSString*>* values = [NSMutableArray arrayWithCapacity:names.count];
+    for (NSString* name in names) {
+      [values addObject:[rootLabels[name] description]];
+    }
+    [output appendString:@"# TYPE target info\n"];
+    [output appendFormat:@"target_info%@ 1\n", FormattedLabels(names, values)];
+  }
+
+  NSArray<NSString*>* metricNames =
+      [[metrics[@"metrics"] allKeys] sortedArrayUsingSelector:@selector(compare:)];
+  for (NSString* metricName in metricNames) {
+    [self appendMetric:metrics[@"metrics"][metricName] named:metricName to:output];
+  }
+
+  [output appendString:@"# EOF\n"];
+
+  return @[ [output dataUsingEncoding:NSUTF8StringEncoding] ];
+}
+
+@end
@@ -0,0 +1,123 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <XCTest/XCTest.h>
+
+#import <Foundation/Foundation.h>
+#import "Source/common/SNTMetricSet.h"
+#import "Source/santametricservice/Formats/SNTMetricFormatTestHelper.h"
+#import "Source/santametricservice/Formats/SNTMetricOpenMetricsFormat.h"
+
+@interface SNTMetricOpenMetricsFormatTest : XCTestCase
+@end
+
+@implementation SNTMetricOpenMetricsFormatTest
+
+- (NSString*)convert:(NSDictionary*)metrics {
+  SNTMetricOpenMetricsFormat* formatter = [[SNTMetricOpenMetricsFormat alloc] init];
+  NSError* err = nil;
+  NSArray<NSData*>* output = [formatter convert:metrics endTimestamp:[NSDate date] error:&err];
+
+  XCTAssertEqual(1, output.count);
+  XCTAssertNil(err);
+  return [[NSString alloc] initWithData:output[0] encoding:NSUTF8StringEncoding];
+}
+
+- (void)testMetricsConversionToOpenMetrics {
+  NSString* got = [self convert:[SNTMetricFormatTestHelper createValidMetricsDictionary]];
+
+  NSString* want =
+      @"# TYPE target info\n"
+      @"target_info{hostname=\"testHost\",username=\"testUser\"} 1\n"
+      @"# TYPE build_label info\n"
+      @"# HELP build_label Software version running\n"
+      @"build_label_info{value=\"20210809.0.1\"} 1\n"
+      @"# TYPE proc_birth_timestamp gauge\n"
+      @"# HELP proc_birth_timestamp Start time of this santad instance, in microseconds since "
+      @"epoch\n"
+      @"proc_birth_timestamp 1250999830800\n"
+      @"# TYPE proc_memory_resident_size gauge\n"
+      @"# HELP proc_memory_resident_size The resident set size of this process\n"
+      @"proc_memory_resident_size 123456789\n"
+      @"# TYPE proc_memory_virtual_size gauge\n"
+      @"# HELP proc_memory_virtual_size The virtual memory size of this process\n"
+      @"proc_memory_virtual_size 987654321\n"
+      @"# TYPE santa_events counter\n"
+      @"# HELP santa_events Count of process exec events on the host\n"
+      @"santa_events_total{rule_type=\"binary\",client=\"authorizer\"} 1\n"
+      @"santa_events_total{rule_type=\"certificate\",client=\"authorizer\"} 2\n"
+      @"# TYPE santa_rules gauge\n"
+      @"# HELP santa_rules Number of rules\n"
+      @"santa_rules{rule_type=\"binary\"} 1\n"
+      @"santa_rules{rule_type=\"certificate\"} 3\n"
+      @"# TYPE santa_using_endpoint_security_framework gauge\n"
+      @"# HELP santa_using_endpoint_security_framework Is santad using the endpoint security "
+      @"framework\n"
+      @"santa_using_endpoint_security_framework 1\n"
+      @"# EOF\n";
+
+  XCTAssertEqualObjects(got, want);
+}
+
+- (void)testHistogramConversion {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] initWithHostname:@"testHost"
+                                                          username:@"testUser"];
+  SNTMetricHistogram* h = [metricSet histogramWithName:@"/santa/latency"
+                                            fieldNames:@[ @"stage" ]
+                                              helpText:@"Latency in milliseconds"
+                                          bucketBounds:@[ @1, @10 ]];
+  [h record:0.5 forFieldValues:@[ @"auth" ]];
+  [h record:2 forFieldValues:@[ @"auth" ]];
+  [h record:4 forFieldValues:@[ @"auth" ]];
+  [h record:20 forFieldValues:@[ @"auth" ]];
+
+  NSString* got = [self convert:[metricSet export]];
+
+  NSString* want = @"# TYPE santa_latency histogram\n"
+                   @"# HELP santa_latency Latency in milliseconds\n"
+                   @"santa_latency_bucket{stage=\"auth\",le=\"1\"} 1\n"
+                   @"santa_latency_bucket{stage=\"auth\",le=\"10\"} 3\n"
+                   @"santa_latency_bucket{stage=\"auth\",le=\"+Inf\"} 4\n"
+                   @"santa_latency_sum{stage=\"auth\"} 26.5\n"
+                   @"santa_latency_count{stage=\"auth\"} 4\n";
+  XCTAssertTrue([got containsString:want], @"%@", got);
+}
+
+- (void)testStringsAndLabelsAreEscaped {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] initWithHostname:@"testHost"
+                                                          username:@"testUser"];
+  SNTMetricStringGauge* g = [metricSet stringGaugeWithName:@"/santa/mode"
+                                                fieldNames:@[ @"path" ]
+                                                  helpText:@"Line one\nLine \\two"];
+  [g set:@"say \"hi\"" forFieldValues:@[ @"/a\\b" ]];
+
+  NSString* got = [self convert:[metricSet export]];
+
+  NSString* want = @"# TYPE santa_mode info\n"
+                   @"# HELP santa_mode Line one\\nLine \\\\two\n"
+                   @"santa_mode_info{path=\"/a\\\\b\",value=\"say \\\"hi\\\"\"} 1\n";
+  XCTAssertTrue([got containsString:want], @"%@", got);
+  XCTAssertTrue([got hasSuffix:@"# EOF\n"]);
+}
+
+- (void)testPassingANilOrNullErrorDoesNotCrash {
+  SNTMetricOpenMetricsFormat* formatter = [[SNTMetricOpenMetricsFormat alloc] init];
+  NSDictionary* validMetricsDict = [SNTMetricFormatTestHelper createValidMetricsDictionary];
+
+  [formatter convert:validMetricsDict endTimestamp:[NSDate date] error:nil];
+  [formatter convert:validMetricsDict endTimestamp:[NSDate date] error:NULL];
+}
+
+@end
@@ -14,6 +14,7 @@
 
 #import <XCTest/XCTest.h>
 
+#import "Source/common/SNTMetricSet.h"
 #import "Source/santametricservice/Formats/SNTMetricFormatTestHelper.h"
 #import "Source/santametricservice/Formats/SNTMetricRawJSONFormat.h"
 
@@ -55,6 +56,32 @@
   XCTAssertEqualObjects(expectedJSONDict, jsonDict, @"generated JSON does not match golden file.");
 }
 
+- (void)testHistogramConversionToJSON {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
+  SNTMetricHistogram* h = [metricSet histogramWithName:@"/santa/latency"
+                                            fieldNames:@[]
+                                              helpText:@"Latency in milliseconds"
+                                          bucketBounds:@[ @1, @10 ]];
+  [h record:20 forFieldValues:@[]];
+
+  SNTMetricRawJSONFormat* formatter = [[SNTMetricRawJSONFormat alloc] init];
+  NSError* err = nil;
+  NSArray<NSData*>* output = [formatter convert:[metricSet export]
+                                   endTimestamp:[NSDate date]
+                                          error:&err];
+  XCTAssertEqual(1, output.count);
+  XCTAssertNil(err);
+
+  NSDictionary* jsonDict = [NSJSONSerialization JSONObjectWithData:output[0]
+                                                           options:NSJSONReadingAllowFragments
+                                                             error:&err];
+  NSDictionary* data = jsonDict[@"metrics"][@"/santa/latency"][@"fields"][@""][0][@"data"];
+  XCTAssertEqualObjects(data[@"count"], @1);
+  XCTAssertEqualObjects(data[@"mean"], @20);
+  XCTAssertEqualObjects(data[@"bucket_bounds"], (@[ @1, @10 ]));
+  XCTAssertEqualObjects(data[@"bucket_counts"], (@[ @0, @0, @1 ]));
+}
+
 - (void)testPassingANilOrNullErrorDoesNotCrash {
   SNTMetricRawJSONFormat* formatter = [[SNTMetricRawJSONFormat alloc] init];
   NSDictionary* validMetricsDict = [SNTMetricFormatTestHelper createValidMetricsDictionary];
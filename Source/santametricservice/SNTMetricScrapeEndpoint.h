@@ -0,0 +1,49 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Serves metrics to local scrapers over HTTP on a unix domain socket. The
+ * content provider is called for every request so that metrics are only
+ * serialized when something asks for them. If the provider returns nil the
+ * request is answered with a 503.
+ */
+@interface SNTMetricScrapeEndpoint : NSObject
+
+@property(readonly) NSString* socketPath;
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithSocketPath:(NSString*)socketPath
+                       contentType:(NSString*)contentType
+                   contentProvider:(NSData* _Nullable (^)(void))contentProvider
+    NS_DESIGNATED_INITIALIZER;
+
+///
+/// Create the socket and start accepting connections. Any existing file at
+/// the socket path is replaced. Returns NO if the socket couldn't be created.
+///
+- (BOOL)start;
+
+///
+/// Stop accepting connections and remove the socket.
+///
+- (void)stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,191 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import "Source/santametricservice/SNTMetricScrapeEndpoint.h"
+
+#include <dispatch/dispatch.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#import "Source/common/SNTLogging.h"
+
+// The request is ignored, only this much of it is read
+static const size_t kMaxRequestSize = 4096;
+
+// Scrapers that stall don't get to block other scrapers for longer than this
+static const time_t kClientTimeoutSeconds = 5;
+
+static BOOL WriteAll(int fd, const void* buf, size_t len) {
+  const char* p = (const char*)buf;
+  while (len > 0) {
+    ssize_t written = write(fd, p, len);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return NO;
+    }
+    p += written;
+    len -= written;
+  }
+  return YES;
+}
+
+@implementation SNTMetricScrapeEndpoint {
+  NSString* _contentType;
+  NSData* _Nullable (^_contentProvider)(void);
+  dispatch_queue_t _queue;
+  dispatch_source_t _source;
+}
+
+- (instancetype)initWithSocketPath:(NSString*)socketPath
+                       contentType:(NSString*)contentType
+                   contentProvider:(NSData* _Nullable (^)(void))contentProvider {
+  self = [super init];
+  if (self) {
+    _socketPath = [socketPath copy];
+    _contentType = [contentType copy];
+    _contentProvider = contentProvider;
+    _queue = dispatch_queue_create("com.northpolesec.santa.metricservice.scrape",
+                                   DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+  }
+  return self;
+}
+
+- (void)dealloc {
+  [self stop];
+}
+
+- (BOOL)start {
+  if (_source) {
+    return YES;
+  }
+
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  if (strlcpy(addr.sun_path, self.socketPath.fileSystemRepresentation, sizeof(addr.sun_path)) >=
+      sizeof(addr.sun_path)) {
+    LOGE(@"Metric scrape socket path is too long: %@", self.socketPath);
+    return NO;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    LOGE(@"Unable to create metric scrape socket: %s", strerror(errno));
+    return NO;
+  }
+
+  // Replace a socket left behind by a previous instance
+  unlink(addr.sun_path);
+
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || chmod(addr.sun_path, 0600) != 0 ||
+      listen(fd, SOMAXCONN) != 0 || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+    LOGE(@"Unable to listen on metric scrape socket %@: %s", self.socketPath, strerror(errno));
+    close(fd);
+    unlink(addr.sun_path);
+    return NO;
+  }
+
+  _source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, _queue);
+  __weak SNTMetricScrapeEndpoint* weakSelf = self;
+  dispatch_source_set_event_handler(_source, ^{
+    [weakSelf acceptConnectionsOnSocket:fd];
+  });
+  dispatch_source_set_cancel_handler(_source, ^{
+    close(fd);
+  });
+  dispatch_resume(_source);
+
+  LOGI(@"Serving metrics on %@", self.socketPath);
+  return YES;
+}
+
+- (void)stop {
+  if (!_source) {
+    return;
+  }
+
+  dispatch_source_cancel(_source);
+  _source = nil;
+  unlink(self.socketPath.fileSystemRepresentation);
+}
+
+- (void)acceptConnectionsOnSocket:(int)fd {
+  while (true) {
+    int client = accept(fd, NULL, NULL);
+    if (client < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOGW(@"Unable to accept metric scrape connection: %s", strerror(errno));
+      }
+      return;
+    }
+
+    [self handleClient:client];
+    close(client);
+  }
+}
+
+- (void)handleClient:(int)client {
+  // Accepted sockets inherit O_NONBLOCK from the listening socket
+  int flags = fcntl(client, F_GETFL);
+  if (flags < 0 || fcntl(client, F_SETFL, flags & ~O_NONBLOCK) != 0) {
+    return;
+  }
+
+  struct timeval timeout = {.tv_sec = kClientTimeoutSeconds};
+  int on = 1;
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+
+  // Every request gets the metrics, so just wait for the end of the headers
+  char request[kMaxRequestSize];
+  size_t total = 0;
+  while (total < sizeof(request)) {
+    ssize_t n = read(client, request + total, sizeof(request) - total);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return;
+    total += n;
+    if (memmem(request, total, "\r\n\r\n", 4)) break;
+  }
+
+  NSData* body;
+  @autoreleasepool {
+    body = _contentProvider();
+  }
+
+  NSString* header;
+  if (body) {
+    header = [NSString stringWithFormat:@"HTTP/1.1 200 OK\r\n"
+                                        @"Content-Type: %@\r\n"
+                                        @"Content-Length: %lu\r\n"
+                                        @"Connection: close\r\n\r\n",
+                                        _contentType, (unsigned long)body.length];
+  } else {
+    header = @"HTTP/1.1 503 Service Unavailable\r\n"
+             @"Content-Length: 0\r\n"
+             @"Connection: close\r\n\r\n";
+  }
+
+  const char* headerBytes = header.UTF8String;
+  if (WriteAll(client, headerBytes, strlen(headerBytes)) && body) {
+    WriteAll(client, body.bytes, body.length);
+  }
+}
+
+@end
@@ -0,0 +1,133 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+#import <XCTest/XCTest.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#import "Source/santametricservice/SNTMetricScrapeEndpoint.h"
+
+@interface SNTMetricScrapeEndpointTest : XCTestCase
+@property NSString* tempDir;
+@property NSString* socketPath;
+@end
+
+@implementation SNTMetricScrapeEndpointTest
+
+- (void)setUp {
+  // Keep the path short, sun_path only holds 104 bytes
+  char dirTemplate[] = "/tmp/scrape.XXXXXX";
+  char* tempPath = mkdtemp(dirTemplate);
+  XCTAssertNotEqual(tempPath, nullptr, @"Unable to make temp dir");
+
+  self.tempDir = @(tempPath);
+  self.socketPath = [self.tempDir stringByAppendingPathComponent:@"metrics.sock"];
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.tempDir error:NULL];
+}
+
+- (NSString*)scrape {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  XCTAssertGreaterThanOrEqual(fd, 0);
+
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  strlcpy(addr.sun_path, self.socketPath.fileSystemRepresentation, sizeof(addr.sun_path));
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return nil;
+  }
+
+  const char request[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  XCTAssertEqual(write(fd, request, sizeof(request) - 1), sizeof(request) - 1);
+
+  NSMutableData* response = [NSMutableData data];
+  char buf[1024];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    [response appendBytes:buf length:n];
+  }
+  close(fd);
+
+  return [[NSString alloc] initWithData:response encoding:NSUTF8StringEncoding];
+}
+
+- (void)testServesContentOnEveryRequest {
+  __block int calls = 0;
+  SNTMetricScrapeEndpoint* sut =
+      [[SNTMetricScrapeEndpoint alloc] initWithSocketPath:self.socketPath
+                                              contentType:@"text/plain"
+                                          contentProvider:^NSData* {
+                                            calls++;
+                                            return [@"metric 1\n"
+                                                dataUsingEncoding:NSUTF8StringEncoding];
+                                          }];
+  XCTAssertTrue([sut start]);
+
+  NSString* want = @"HTTP/1.1 200 OK\r\n"
+                   @"Content-Type: text/plain\r\n"
+                   @"Content-Length: 9\r\n"
+                   @"Connection: close\r\n\r\n"
+                   @"metric 1\n";
+  XCTAssertEqualObjects([self scrape], want);
+  XCTAssertEqualObjects([self scrape], want);
+  XCTAssertEqual(calls, 2);
+
+  [sut stop];
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.socketPath]);
+  XCTAssertNil([self scrape]);
+}
+
+- (void)testNoContentIsUnavailable {
+  SNTMetricScrapeEndpoint* sut =
+      [[SNTMetricScrapeEndpoint alloc] initWithSocketPath:self.socketPath
+                                              contentType:@"text/plain"
+                                          contentProvider:^NSData* {
+                                            return nil;
+                                          }];
+  XCTAssertTrue([sut start]);
+  XCTAssertTrue([[self scrape] hasPrefix:@"HTTP/1.1 503 Service Unavailable\r\n"]);
+}
+
+- (void)testStartReplacesStaleSocket {
+  XCTAssertTrue([[NSFileManager defaultManager] createFileAtPath:self.socketPath
+                                                        contents:[NSData data]
+                                                      attributes:nil]);
+
+  SNTMetricScrapeEndpoint* sut =
+      [[SNTMetricScrapeEndpoint alloc] initWithSocketPath:self.socketPath
+                                              contentType:@"text/plain"
+                                          contentProvider:^NSData* {
+                                            return [NSData data];
+                                          }];
+  XCTAssertTrue([sut start]);
+  XCTAssertTrue([[self scrape] hasPrefix:@"HTTP/1.1 200 OK\r\n"]);
+}
+
+- (void)testPathTooLongFailsToStart {
+  NSString* path = [self.tempDir stringByPaddingToLength:200 withString:@"a" startingAtIndex:0];
+  SNTMetricScrapeEndpoint* sut =
+      [[SNTMetricScrapeEndpoint alloc] initWithSocketPath:path
+                                              contentType:@"text/plain"
+                                          contentProvider:^NSData* {
+                                            return [NSData data];
+                                          }];
+  XCTAssertFalse([sut start]);
+}
+
+@end
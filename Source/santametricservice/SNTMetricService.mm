@@ -18,15 +18,21 @@
 
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
+#import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTStrengthify.h"
 #import "Source/common/SNTXPCSyncServiceInterface.h"
 
 #import "SNTMetricService.h"
 #import "Source/santametricservice/Formats/SNTMetricMonarchJSONFormat.h"
+#import "Source/santametricservice/Formats/SNTMetricOpenMetricsFormat.h"
 #import "Source/santametricservice/Formats/SNTMetricRawJSONFormat.h"
+#import "Source/santametricservice/SNTMetricScrapeEndpoint.h"
 #import "Source/santametricservice/Writers/SNTMetricFileWriter.h"
 #import "Source/santametricservice/Writers/SNTMetricHTTPWriter.h"
 
+// How many undelivered exports are kept to be sent with the next HTTP export
+static const NSUInteger kMaxPendingExports = 10;
+
 @interface SNTMetricService ()
 @property MOLXPCConnection* notifierConnection;
 @property MOLXPCConnection* listener;
@@ -37,8 +43,14 @@
  @private
   SNTMetricRawJSONFormat* rawJSONFormatter;
   SNTMetricMonarchJSONFormat* monarchJSONFormatter;
+  SNTMetricOpenMetricsFormat* openMetricsFormatter;
   NSDictionary* metricWriters;
   MOLXPCConnection* syncServiceConnection;
+  SNTMetricScrapeEndpoint* scrapeEndpoint;
+  NSDictionary* latestMetrics;
+  NSMutableArray<NSDictionary*>* pendingMetrics;
+  NSMutableArray<NSDate*>* pendingEndTimestamps;
+  NSDictionary* previousMetrics;
 }
 
 - (instancetype)init {
@@ -46,6 +58,9 @@
   if (self) {
     rawJSONFormatter = [[SNTMetricRawJSONFormat alloc] init];
     monarchJSONFormatter = [[SNTMetricMonarchJSONFormat alloc] init];
+    openMetricsFormatter = [[SNTMetricOpenMetricsFormat alloc] init];
+    pendingMetrics = [[NSMutableArray alloc] init];
+    pendingEndTimestamps = [[NSMutableArray alloc] init];
 
     metricWriters = @{
       @"file" : [[SNTMetricFileWriter alloc] init],
@@ -80,11 +95,44 @@
 - (NSArray<NSData*>*)convertMetrics:(NSDictionary*)metrics
                            toFormat:(SNTMetricFormatType)format
                               error:(NSError**)err {
+  return [[self formatterForFormat:format] convert:metrics endTimestamp:[NSDate date] error:err];
+}
+
+/**
+ * Converts several exports at once, as a single entry if the format supports
+ * it.
+ *
+ *  @param batch The exported metrics dictionaries, oldest first
+ *  @param endTimestamps The time each of the exports was received
+ *  @param format SNTMetricFormatType the exported metrics format
+ *  @return An array of metrics formatted according to the specified format or
+ *          nil on error;
+ */
+- (NSArray<NSData*>*)convertMetricsBatch:(NSArray<NSDictionary*>*)batch
+                           endTimestamps:(NSArray<NSDate*>*)endTimestamps
+                                toFormat:(SNTMetricFormatType)format
+                                   error:(NSError**)err {
+  id<SNTMetricFormat> formatter = [self formatterForFormat:format];
+  if ([formatter respondsToSelector:@selector(convertBatch:endTimestamps:error:)]) {
+    return [formatter convertBatch:batch endTimestamps:endTimestamps error:err];
+  }
+
+  NSMutableArray<NSData*>* converted = [[NSMutableArray alloc] init];
+  for (NSUInteger i = 0; i < batch.count; i++) {
+    NSArray<NSData*>* entries = [formatter convert:batch[i]
+                                      endTimestamp:endTimestamps[i]
+                                             error:err];
+    if (!entries) return nil;
+    [converted addObjectsFromArray:entries];
+  }
+  return converted;
+}
+
+- (id<SNTMetricFormat>)formatterForFormat:(SNTMetricFormatType)format {
   switch (format) {
-    case SNTMetricFormatTypeRawJSON:
-      return [self->rawJSONFormatter convert:metrics endTimestamp:[NSDate date] error:err];
-    case SNTMetricFormatTypeMonarchJSON:
-      return [self->monarchJSONFormatter convert:metrics endTimestamp:[NSDate date] error:err];
+    case SNTMetricFormatTypeRawJSON: return self->rawJSONFormatter;
+    case SNTMetricFormatTypeMonarchJSON: return self->monarchJSONFormatter;
+    case SNTMetricFormatTypeOpenMetrics: return self->openMetricsFormatter;
     default: return nil;
   }
 }
@@ -114,11 +162,33 @@
     return;
   }
 
+  if ([config.metricURL.scheme isEqualToString:@"unix"]) {
+    [self serveMetricsForScraping:metrics
+                           format:config.metricFormat
+                             path:config.metricURL.path
+                            reply:reply];
+    return;
+  }
+
+  @synchronized(self) {
+    // The config no longer points at a socket, don't keep serving stale metrics
+    [scrapeEndpoint stop];
+    scrapeEndpoint = nil;
+    latestMetrics = nil;
+  }
+
   if (config.metricFormat == SNTMetricFormatTypeProto) {
     [self publishMetricsViaSyncService:metrics reply:reply];
     return;
   }
 
+  const id writer = metricWriters[config.metricURL.scheme];
+
+  if (writer && writer == metricWriters[@"http"]) {
+    [self postMetrics:metrics withWriter:writer config:config reply:reply];
+    return;
+  }
+
   NSError* err;
   NSArray<NSData*>* formattedMetrics = [self convertMetrics:metrics
                                                    toFormat:config.metricFormat
@@ -130,8 +200,6 @@
     return;
   }
 
-  const id writer = metricWriters[config.metricURL.scheme];
-
   if (writer) {
     BOOL ok = [writer write:formattedMetrics toURL:config.metricURL error:&err];
 
@@ -145,6 +213,121 @@
   }
 }
 
+/**
+ * Posts metrics to an HTTP collector. Exports that can't be delivered are kept
+ * and sent along with the next one, up to kMaxPendingExports of them. In delta
+ * mode only values that changed since the previous export are sent.
+ */
+- (void)postMetrics:(NSDictionary*)metrics
+         withWriter:(id<SNTMetricWriter>)writer
+             config:(SNTConfigurator*)config
+              reply:(void (^)(BOOL))reply {
+  NSArray<NSDictionary*>* batch;
+  NSArray<NSDate*>* endTimestamps;
+  @synchronized(self) {
+    if (config.metricExportDeltas) {
+      NSDictionary* changed = SNTMetricChangedSinceExport(previousMetrics, metrics);
+      previousMetrics = metrics;
+      metrics = changed;
+    } else {
+      previousMetrics = nil;
+    }
+
+    [pendingMetrics addObject:metrics];
+    [pendingEndTimestamps addObject:[NSDate date]];
+    batch = [pendingMetrics copy];
+    endTimestamps = [pendingEndTimestamps copy];
+  }
+
+  NSError* err;
+  NSArray<NSData*>* formattedMetrics = [self convertMetricsBatch:batch
+                                                   endTimestamps:endTimestamps
+                                                        toFormat:config.metricFormat
+                                                           error:&err];
+  BOOL formatted = (err == nil);
+  BOOL ok = NO;
+
+  if (!formatted) {
+    LOGE(@"unable to format metrics as  %@", [self messageFromError:err]);
+  } else {
+    ok = [writer write:formattedMetrics toURL:config.metricURL error:&err];
+    if (!ok) {
+      LOGE(@"unable to write metrics: %@",
+           err ? [self messageFromError:err] : @"no error provided");
+    }
+  }
+
+  @synchronized(self) {
+    if (ok) {
+      NSRange sent = NSMakeRange(0, MIN(batch.count, pendingMetrics.count));
+      [pendingMetrics removeObjectsInRange:sent];
+      [pendingEndTimestamps removeObjectsInRange:sent];
+    } else if (!formatted || pendingMetrics.count >= kMaxPendingExports) {
+      LOGW(@"dropping %lu undelivered metric exports", (unsigned long)pendingMetrics.count);
+      [pendingMetrics removeAllObjects];
+      [pendingEndTimestamps removeAllObjects];
+      // Deltas against the dropped exports would miss changes, start over with a full export
+      previousMetrics = nil;
+    }
+  }
+
+  if (reply) reply(ok);
+}
+
+/**
+ * Keeps the latest metrics to be served to scrapers on a unix socket. Metrics
+ * are only formatted when a scraper asks for them.
+ */
+- (void)serveMetricsForScraping:(NSDictionary*)metrics
+                         format:(SNTMetricFormatType)format
+                           path:(NSString*)path
+                          reply:(void (^)(BOOL))reply {
+  if (format != SNTMetricFormatTypeOpenMetrics) {
+    LOGE(@"unix metric URLs are only supported with the openmetrics format");
+    if (reply) reply(NO);
+    return;
+  }
+
+  BOOL ok = YES;
+  @synchronized(self) {
+    latestMetrics = metrics;
+
+    if (![scrapeEndpoint.socketPath isEqualToString:path]) {
+      [scrapeEndpoint stop];
+
+      WEAKIFY(self);
+      scrapeEndpoint = [[SNTMetricScrapeEndpoint alloc]
+           initWithSocketPath:path
+                  contentType:@"application/openmetrics-text; version=1.0.0; charset=utf-8"
+              contentProvider:^NSData* {
+                STRONGIFY(self);
+                return [self formattedMetricsForScraping];
+              }];
+      ok = [scrapeEndpoint start];
+      if (!ok) scrapeEndpoint = nil;
+    }
+  }
+
+  if (reply) reply(ok);
+}
+
+- (NSData*)formattedMetricsForScraping {
+  NSDictionary* metrics;
+  @synchronized(self) {
+    metrics = latestMetrics;
+  }
+  if (!metrics) return nil;
+
+  NSError* err;
+  NSArray<NSData*>* formatted = [self convertMetrics:metrics
+                                            toFormat:SNTMetricFormatTypeOpenMetrics
+                                               error:&err];
+  if (!formatted) {
+    LOGE(@"unable to format metrics for scraping: %@", [self messageFromError:err]);
+  }
+  return formatted.firstObject;
+}
+
 - (void)publishMetricsViaSyncService:(NSDictionary*)metrics reply:(void (^)(BOOL))reply {
   @synchronized(self) {
     if (!syncServiceConnection) {
@@ -24,6 +24,7 @@
 #import "Source/common/SNTMetricSet.h"
 #import "Source/santametricservice/Formats/SNTMetricFormatTestHelper.h"
 #import "Source/santametricservice/SNTMetricService.h"
+#import "Source/santametricservice/Writers/SNTMetricHTTPWriter.h"
 
 NSDictionary* validMetricsDict = nil;
 
@@ -230,4 +231,118 @@ NSDictionary* validMetricsDict = nil;
 
   XCTAssertEqualObjects(expectedJSONAsDict, parsedJSONAsDict, @"invalid JSON created");
 }
+
+- (void)testServingOpenMetricsOnUnixSocket {
+  NSString* socketPath = [self.tempDir stringByAppendingPathComponent:@"metrics.sock"];
+  NSURL* url = [NSURL URLWithString:[@"unix://" stringByAppendingString:socketPath]];
+  OCMStub([self.mockConfigurator exportMetrics]).andReturn(YES);
+  OCMStub([self.mockConfigurator metricFormat]).andReturn(SNTMetricFormatTypeOpenMetrics);
+  OCMStub([self.mockConfigurator metricURL]).andReturn(url);
+
+  SNTMetricService* ms = [[SNTMetricService alloc] init];
+  __block BOOL ok = NO;
+  [ms exportForMonitoring:[SNTMetricFormatTestHelper createValidMetricsDictionary]
+                    reply:^(BOOL success) {
+                      ok = success;
+                    }];
+  XCTAssertTrue(ok);
+
+  // Metrics are served from the socket rather than written anywhere
+  NSArray* items = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.tempDir
+                                                                       error:NULL];
+  XCTAssertEqualObjects(items, @[ @"metrics.sock" ]);
+}
+
+- (void)testUnixSocketRequiresOpenMetrics {
+  NSString* socketPath = [self.tempDir stringByAppendingPathComponent:@"metrics.sock"];
+  NSURL* url = [NSURL URLWithString:[@"unix://" stringByAppendingString:socketPath]];
+  OCMStub([self.mockConfigurator exportMetrics]).andReturn(YES);
+  OCMStub([self.mockConfigurator metricFormat]).andReturn(SNTMetricFormatTypeRawJSON);
+  OCMStub([self.mockConfigurator metricURL]).andReturn(url);
+
+  SNTMetricService* ms = [[SNTMetricService alloc] init];
+  __block BOOL ok = YES;
+  [ms exportForMonitoring:[SNTMetricFormatTestHelper createValidMetricsDictionary]
+                    reply:^(BOOL success) {
+                      ok = success;
+                    }];
+  XCTAssertFalse(ok);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:socketPath]);
+}
+
+/// Replaces the service's HTTP writer with a mock that records what it's asked to write and
+/// returns the value of `*succeed`.
+- (id)mockHTTPWriterRecordingWritesTo:(NSMutableArray<NSArray<NSData*>*>*)writes
+                              succeed:(BOOL*)succeed {
+  id mockWriter = OCMClassMock([SNTMetricHTTPWriter class]);
+  OCMStub([mockWriter alloc]).andReturn(mockWriter);
+  OCMStub([mockWriter init]).andReturn(mockWriter);
+  OCMStub([mockWriter write:[OCMArg any] toURL:[OCMArg any] error:[OCMArg anyObjectRef]])
+      .andDo(^(NSInvocation* inv) {
+        __unsafe_unretained NSArray<NSData*>* data;
+        [inv getArgument:&data atIndex:2];
+        [writes addObject:data];
+        BOOL ret = *succeed;
+        [inv setReturnValue:&ret];
+      });
+  return mockWriter;
+}
+
+- (void)testUndeliveredHTTPExportsAreBatched {
+  OCMStub([self.mockConfigurator exportMetrics]).andReturn(YES);
+  OCMStub([self.mockConfigurator metricFormat]).andReturn(SNTMetricFormatTypeMonarchJSON);
+  OCMStub([self.mockConfigurator metricURL]).andReturn([NSURL URLWithString:@"http://localhost"]);
+
+  NSMutableArray<NSArray<NSData*>*>* writes = [NSMutableArray array];
+  BOOL succeed = NO;
+  id mockWriter = [self mockHTTPWriterRecordingWritesTo:writes succeed:&succeed];
+
+  SNTMetricService* ms = [[SNTMetricService alloc] init];
+  NSDictionary* metrics = [SNTMetricFormatTestHelper createValidMetricsDictionary];
+
+  NSUInteger (^collectionsInWrite)(NSUInteger) = ^NSUInteger(NSUInteger i) {
+    XCTAssertEqual(writes[i].count, 1);
+    NSDictionary* json = [NSJSONSerialization JSONObjectWithData:writes[i][0] options:0 error:nil];
+    return [json[@"metricsCollection"] count];
+  };
+
+  [ms exportForMonitoring:metrics];
+  XCTAssertEqual(collectionsInWrite(0), 1);
+
+  // The failed export is sent again along with the new one, in a single request
+  succeed = YES;
+  [ms exportForMonitoring:metrics];
+  XCTAssertEqual(collectionsInWrite(1), 2);
+
+  [ms exportForMonitoring:metrics];
+  XCTAssertEqual(collectionsInWrite(2), 1);
+
+  [mockWriter stopMocking];
+}
+
+- (void)testHTTPExportDeltas {
+  OCMStub([self.mockConfigurator exportMetrics]).andReturn(YES);
+  OCMStub([self.mockConfigurator metricFormat]).andReturn(SNTMetricFormatTypeRawJSON);
+  OCMStub([self.mockConfigurator metricURL]).andReturn([NSURL URLWithString:@"http://localhost"]);
+  OCMStub([self.mockConfigurator metricExportDeltas]).andReturn(YES);
+
+  NSMutableArray<NSArray<NSData*>*>* writes = [NSMutableArray array];
+  BOOL succeed = YES;
+  id mockWriter = [self mockHTTPWriterRecordingWritesTo:writes succeed:&succeed];
+
+  SNTMetricService* ms = [[SNTMetricService alloc] init];
+  NSDictionary* metrics = [SNTMetricFormatTestHelper createValidMetricsDictionary];
+
+  [ms exportForMonitoring:metrics];
+  [ms exportForMonitoring:metrics];
+  XCTAssertEqual(writes.count, 2);
+
+  NSDictionary* first = [NSJSONSerialization JSONObjectWithData:writes[0][0] options:0 error:nil];
+  NSDictionary* second = [NSJSONSerialization JSONObjectWithData:writes[1][0] options:0 error:nil];
+  XCTAssertEqual([first[@"metrics"] count], [metrics[@"metrics"] count]);
+  XCTAssertEqualObjects(second[@"metrics"], @{});
+  XCTAssertEqualObjects(second[@"root_labels"], metrics[@"root_labels"]);
+
+  [mockWriter stopMocking];
+}
 @end
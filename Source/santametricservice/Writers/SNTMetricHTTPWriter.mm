@@ -24,7 +24,12 @@
 @property SNTConfigurator* configurator;
 @end
 
-@implementation SNTMetricHTTPWriter
+@implementation SNTMetricHTTPWriter {
+  // Kept between exports so that connections, and their TLS sessions, get reused.
+  MOLAuthenticatingURLSession* _authSession;
+  NSString* _sessionHost;
+  NSTimeInterval _sessionTimeout;
+}
 
 - (instancetype)init {
   self = [super init];
@@ -48,6 +53,22 @@
   return session;
 }
 
+/**
+ * Returns the session for the given URL, replacing the existing one if the
+ * host or timeout have changed.
+ **/
+- (MOLAuthenticatingURLSession*)sessionForURL:(NSURL*)url timeout:(NSTimeInterval)timeout {
+  @synchronized(self) {
+    if (!_authSession || ![_sessionHost isEqualToString:url.host] || _sessionTimeout != timeout) {
+      [_authSession.session finishTasksAndInvalidate];
+      _authSession = [self createSessionWithHostname:url Timeout:timeout];
+      _sessionHost = [url.host copy];
+      _sessionTimeout = timeout;
+    }
+    return _authSession;
+  }
+}
+
 /**
  * Post serialzied metrics to the specified URL one object at a time.
  **/
@@ -56,7 +77,7 @@
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
 
   MOLAuthenticatingURLSession* authSession =
-      [self createSessionWithHostname:url Timeout:self.configurator.metricExportTimeout];
+      [self sessionForURL:url timeout:self.configurator.metricExportTimeout];
 
   NSMutableURLRequest* request = [NSMutableURLRequest requestWithURL:url];
   request.HTTPMethod = @"POST";
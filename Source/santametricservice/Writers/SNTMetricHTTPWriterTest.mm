@@ -226,4 +226,23 @@
   BOOL result = [self.httpWriter write:@[ JSONdata ] toURL:url error:nil];
   XCTAssertEqual(NO, result);
 }
+
+- (void)testSessionIsReusedBetweenWrites {
+  NSURL* url = [NSURL URLWithString:@"http://localhost:9444"];
+  NSData* JSONdata = [@"{\"foo\": \"bar\"}\r\n" dataUsingEncoding:NSUTF8StringEncoding];
+
+  [self createMockResponseWithURL:url withCode:200 withData:nil withError:nil];
+  [self createMockResponseWithURL:url withCode:200 withData:nil withError:nil];
+  XCTAssertTrue([self.httpWriter write:@[ JSONdata ] toURL:url error:nil]);
+  XCTAssertTrue([self.httpWriter write:@[ JSONdata ] toURL:url error:nil]);
+  OCMVerify(times(1),
+            [self.mockMOLAuthenticatingURLSession initWithSessionConfiguration:[OCMArg any]]);
+
+  // A different host gets a new session
+  NSURL* otherURL = [NSURL URLWithString:@"http://otherhost:9444"];
+  [self createMockResponseWithURL:otherURL withCode:200 withData:nil withError:nil];
+  XCTAssertTrue([self.httpWriter write:@[ JSONdata ] toURL:otherURL error:nil]);
+  OCMVerify(times(2),
+            [self.mockMOLAuthenticatingURLSession initWithSessionConfiguration:[OCMArg any]]);
+}
 @end
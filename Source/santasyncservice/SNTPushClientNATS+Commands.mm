@@ -15,10 +15,15 @@
 #import "Source/santasyncservice/SNTPushClientNATS.h"
 
 #include <CommonCrypto/CommonHMAC.h>
+#include <dispatch/dispatch.h>
+#include <time.h>
+
+#include <algorithm>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include "Source/common/LatencyHistogram.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTKillCommand.h"
 #import "Source/common/SNTLogging.h"
@@ -47,8 +52,92 @@ static constexpr int64_t kMaxCommandAgeSeconds = 300;
 // Semi-arbitrary cap, averaging 1 command per second per time window
 static constexpr NSUInteger kMaxCommandNonceCacheCount = kMaxCommandAgeSeconds;
 
+// Maximum number of seconds a ping may wait for a free slot before it is
+// answered with an error instead. Pings are cheap, so anything waiting this
+// long means the lane is wedged and the sender has likely given up.
+static constexpr int64_t kPingQueueDeadlineSeconds = 30;
+
 namespace {
 
+// A bounded executor for a single command type. Up to `max_concurrent`
+// commands run at once on a concurrent queue; later commands wait in FIFO
+// order for a free slot, giving up once their deadline passes. Each type has
+// its own lane so that a slow command, e.g. a kill waiting on santad, never
+// delays an unrelated one.
+class CommandLane {
+ public:
+  CommandLane(const char* name, long max_concurrent, int64_t queue_deadline_seconds)
+      : name_(name),
+        queue_deadline_seconds_(queue_deadline_seconds),
+        slots_(dispatch_semaphore_create(max_concurrent)),
+        admission_queue_(dispatch_queue_create("com.northpolesec.santa.nats.command.admission",
+                                               DISPATCH_QUEUE_SERIAL)),
+        worker_queue_(dispatch_queue_create("com.northpolesec.santa.nats.command.worker",
+                                            DISPATCH_QUEUE_CONCURRENT)) {}
+
+  // Runs `work` once a slot is available. If no slot frees up before the
+  // lane's queue deadline, or before the command was issued more than
+  // kMaxCommandAgeSeconds ago, `expired` is called instead.
+  void Submit(int64_t issued_at, void (^work)(void), void (^expired)(void)) {
+    int64_t remaining = std::min(queue_deadline_seconds_,
+                                 issued_at + kMaxCommandAgeSeconds - (int64_t)time(nullptr));
+    dispatch_time_t deadline = dispatch_time(DISPATCH_TIME_NOW, remaining * NSEC_PER_SEC);
+    uint64_t enqueued = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW);
+
+    dispatch_async(admission_queue_, ^{
+      if (dispatch_semaphore_wait(slots_, deadline) != 0) {
+        LOGW(@"NATS: %s command expired after waiting %llu ms for a free slot", name_,
+             (clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW) - enqueued) / NSEC_PER_MSEC);
+        expired();
+        return;
+      }
+
+      uint64_t started = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW);
+      queue_latency_.Record(started - enqueued);
+
+      dispatch_async(worker_queue_, ^{
+        work();
+        uint64_t finished = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW);
+        exec_latency_.Record(finished - started);
+        dispatch_semaphore_signal(slots_);
+
+        LOGD(@"NATS: %s command finished (queued: %llu ms, ran: %llu ms, "
+             @"p99 queued: %llu ms, p99 ran: %llu ms)",
+             name_, (started - enqueued) / NSEC_PER_MSEC, (finished - started) / NSEC_PER_MSEC,
+             queue_latency_.TakeSnapshot(false).Percentile(99) / NSEC_PER_MSEC,
+             exec_latency_.TakeSnapshot(false).Percentile(99) / NSEC_PER_MSEC);
+      });
+    });
+  }
+
+ private:
+  const char* name_;
+  int64_t queue_deadline_seconds_;
+  dispatch_semaphore_t slots_;
+  dispatch_queue_t admission_queue_;
+  dispatch_queue_t worker_queue_;
+  santa::LatencyHistogram queue_latency_;
+  santa::LatencyHistogram exec_latency_;
+};
+
+// Returns the lane commands of the given type run on, or nullptr for command
+// types that have no handler. Lanes live for the lifetime of the process.
+CommandLane* LaneForCommand(::pbv1::SantaCommandRequest::CommandCase commandCase) {
+  static CommandLane* ping = new CommandLane("ping", 4, kPingQueueDeadlineSeconds);
+  static CommandLane* kill = new CommandLane("kill", 2, kKillResponseTimeoutSeconds);
+  static CommandLane* eventUpload = new CommandLane("event_upload", 2, kMaxCommandAgeSeconds);
+  static CommandLane* binaryUpload = new CommandLane("binary_upload", 2, kMaxCommandAgeSeconds);
+
+  switch (commandCase) {
+    case ::pbv1::SantaCommandRequest::kPing: return ping;
+    case ::pbv1::SantaCommandRequest::kKill: return kill;
+    case ::pbv1::SantaCommandRequest::kEventUpload: return eventUpload;
+    case ::pbv1::SantaCommandRequest::kBinaryUpload: return binaryUpload;
+    case ::pbv1::SantaCommandRequest::COMMAND_NOT_SET: return nullptr;
+  }
+  return nullptr;
+}
+
 bool VerifyCommandRequestHMAC(const ::pbv1::SantaCommandRequest& command, NSData* hmacKey) {
   if (hmacKey.length == 0) {
     LOGE(@"NATS: HMAC verification failed - no key available");
@@ -193,6 +282,13 @@ void SetKilledProcessError(SNTKilledProcessError error, ::pbv1::KillResponse::Pr
                                      (const ::pbv1::SantaCommandRequest&)command
                                                        onArena:(google::protobuf::Arena*)arena
                                                     replyTopic:(NSString*)replyTopic;
+- (::pbv1::SantaCommandResponse*)verifySantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                                            onArena:(google::protobuf::Arena*)arena;
+- (::pbv1::SantaCommandResponse*)executeSantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                                             onArena:(google::protobuf::Arena*)arena
+                                          replyTopic:(NSString*)replyTopic;
+- (void)submitSantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                replyTopic:(NSString*)replyTopic;
 - (BOOL)checkAndRecordNonce:(NSString*)uuid;
 @end
 
@@ -403,11 +499,24 @@ void SetKilledProcessError(SNTKilledProcessError error, ::pbv1::KillResponse::Pr
   return [self dispatchSantaCommandToHandler:command onArena:arena replyTopic:nil];
 }
 
-// Dispatch Santa command to appropriate handler based on command type
+// Verify then synchronously run a Santa command on the calling thread
+// Note: Must be called from messageQueue, see verifySantaCommand:onArena:
 - (::pbv1::SantaCommandResponse*)dispatchSantaCommandToHandler:
                                      (const ::pbv1::SantaCommandRequest&)command
                                                        onArena:(google::protobuf::Arena*)arena
                                                     replyTopic:(NSString*)replyTopic {
+  ::pbv1::SantaCommandResponse* errorResponse = [self verifySantaCommand:command onArena:arena];
+  if (errorResponse) {
+    return errorResponse;
+  }
+  return [self executeSantaCommand:command onArena:arena replyTopic:replyTopic];
+}
+
+// Verify a command's signature, freshness, nonce and allowlist status
+// Returns nullptr if the command may run, otherwise the error response to send
+// Note: Must be called from messageQueue since it records the command nonce
+- (::pbv1::SantaCommandResponse*)verifySantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                                            onArena:(google::protobuf::Arena*)arena {
   auto response = google::protobuf::Arena::Create<::pbv1::SantaCommandResponse>(arena);
 
   // Verify HMAC signature first
@@ -458,6 +567,17 @@ void SetKilledProcessError(SNTKilledProcessError error, ::pbv1::KillResponse::Pr
     }
   }
 
+  return nullptr;
+}
+
+// Run a verified Santa command on the appropriate handler based on command type
+- (::pbv1::SantaCommandResponse*)executeSantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                                             onArena:(google::protobuf::Arena*)arena
+                                          replyTopic:(NSString*)replyTopic {
+  auto response = google::protobuf::Arena::Create<::pbv1::SantaCommandResponse>(arena);
+  NSString* uuid = StringToNSString(command.uuid());
+  ::pbv1::SantaCommandRequest::CommandCase commandCase = command.command_case();
+
   switch (commandCase) {
     case ::pbv1::SantaCommandRequest::kPing: {
       LOGI(@"NATS: Dispatching PingRequest command");
@@ -490,7 +610,7 @@ void SetKilledProcessError(SNTKilledProcessError error, ::pbv1::KillResponse::Pr
       LOGI(@"NATS: Dispatching BinaryUploadRequest command");
       // Async: santad opens the file and launches sleigh; the XPC reply block
       // publishes the response. Returning nullptr tells the caller not to publish
-      // synchronously, keeping the shared command queue unblocked.
+      // synchronously, freeing the lane slot for the next upload.
       [self handleBinaryUploadRequest:command.binary_upload() replyTopic:replyTopic];
       return nullptr;
     }
@@ -505,6 +625,65 @@ void SetKilledProcessError(SNTKilledProcessError error, ::pbv1::KillResponse::Pr
   return response;
 }
 
+// Verify a command in arrival order on messageQueue, then hand it to the lane
+// for its type. The response is published as soon as that command finishes,
+// independent of any other commands still queued or running.
+- (void)submitSantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                replyTopic:(NSString*)replyTopic {
+  dispatch_async(self.messageQueue, ^{
+    if (self.isShuttingDown) {
+      return;
+    }
+
+    google::protobuf::Arena arena;
+    ::pbv1::SantaCommandResponse* errorResponse = [self verifySantaCommand:command
+                                                                   onArena:&arena];
+    if (errorResponse) {
+      [self publishResponse:*errorResponse toReplyTopic:replyTopic];
+      return;
+    }
+
+    CommandLane* lane = LaneForCommand(command.command_case());
+    if (!lane) {
+      ::pbv1::SantaCommandResponse* response = [self executeSantaCommand:command
+                                                                 onArena:&arena
+                                                              replyTopic:replyTopic];
+      [self publishResponse:*response toReplyTopic:replyTopic];
+      return;
+    }
+
+    lane->Submit(
+        command.issued_at(),
+        ^{
+          if (self.isShuttingDown) {
+            return;
+          }
+
+          google::protobuf::Arena workArena;
+          ::pbv1::SantaCommandResponse* response = [self executeSantaCommand:command
+                                                                     onArena:&workArena
+                                                                  replyTopic:replyTopic];
+
+          // A nullptr response means the handler published (or will publish) the
+          // response asynchronously (e.g. binary upload).
+          if (response) {
+            [self publishResponse:*response toReplyTopic:replyTopic];
+          }
+        },
+        ^{
+          // Kill has a dedicated timeout error, other commands are treated the
+          // same as if they had arrived with a stale timestamp.
+          ::pbv1::SantaCommandResponse response;
+          if (command.has_kill()) {
+            response.mutable_kill()->set_error(::pbv1::KillResponse::ERROR_TIMEOUT);
+          } else {
+            response.set_error(::pbv1::SantaCommandResponse::ERROR_INVALID_DATA);
+          }
+          [self publishResponse:response toReplyTopic:replyTopic];
+        });
+  });
+}
+
 @end
 
 // NATS command message handler - handles serialization/deserialization and
@@ -559,24 +738,9 @@ static void CommandMessageHandlerImpl(natsConnection* nc, natsSubscription* sub,
     return;
   }
 
-  // Process on message queue to serialize handling of messages
+  // Verification is serialized on the message queue, execution is not
   // Failures are logged but don't crash the client
-  dispatch_async(self.messageQueue, ^{
-    if (self.isShuttingDown) {
-      return;
-    }
-
-    google::protobuf::Arena arena;
-    ::pbv1::SantaCommandResponse* response = [self dispatchSantaCommandToHandler:command
-                                                                         onArena:&arena
-                                                                      replyTopic:replyTopic];
-
-    // A nullptr response means the handler published (or will publish) the response
-    // asynchronously (e.g. binary upload), so don't publish synchronously here.
-    if (response) {
-      [self publishResponse:*response toReplyTopic:replyTopic];
-    }
-  });
+  [self submitSantaCommand:command replyTopic:replyTopic];
 }
 
 __BEGIN_DECLS
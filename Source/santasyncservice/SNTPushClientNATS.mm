@@ -40,6 +40,18 @@ __END_DECLS
 
 namespace pbv1 = ::santa::commands::v1;
 
+// Push messages may carry a JSON payload, e.g. {"action": "rule_sync", "jitter_seconds": 300}.
+// The action takes the same values as FCM messages. The jitter is the window over which hosts
+// should spread the syncs the message triggers.
+static NSString* const kPushActionKey = @"action";
+static NSString* const kPushJitterSecondsKey = @"jitter_seconds";
+
+// Default jitter window for tag messages that don't supply one.
+static const uint32_t kDefaultTagJitterSeconds = 180;
+
+// Upper bound on a server supplied jitter window.
+static const uint32_t kMaxJitterSeconds = 3600;
+
 // Helper function to convert response code to readable string using protobuf generated code
 NSString* ResponseCodeToString(::pbv1::SantaCommandResponse::Error code) {
   // Try the generated _Name() function first
@@ -707,21 +719,44 @@ static int NATSSSLVerifyCallback(int preverifyOk, void* ctx) {
 // Tag subjects (santa.tag.*) get a random jitter delay of 0-180 seconds to
 // avoid thundering herd when many hosts share the same tag. Host subjects
 // (santa.host.*) trigger an immediate sync.
-- (void)handlePushNotificationForSubject:(NSString*)subject {
+- (void)handlePushNotificationForSubject:(NSString*)subject data:(NSString*)data {
   dispatch_async(self.messageQueue, ^{
     if (!self.isShuttingDown) {
-      uint32_t jitterSeconds = 0;
-      if ([subject hasPrefix:@"santa.tag."]) {
-        jitterSeconds = arc4random_uniform(181);
-        LOGI(@"NATS: Scheduling sync in %u seconds (jitter) due to tag message on %@",
-             jitterSeconds, subject);
+      NSDictionary* payload;
+      if (data.length) {
+        NSData* json = [data dataUsingEncoding:NSUTF8StringEncoding];
+        id obj = [NSJSONSerialization JSONObjectWithData:json options:0 error:NULL];
+        if ([obj isKindOfClass:[NSDictionary class]]) payload = obj;
+      }
+
+      // Messages sent to a tag reach many hosts at once. Spread their syncs out so the sync
+      // server isn't hit by all of them at the same moment.
+      uint32_t jitterWindow = [subject hasPrefix:@"santa.tag."] ? kDefaultTagJitterSeconds : 0;
+      if ([payload[kPushJitterSecondsKey] isKindOfClass:[NSNumber class]]) {
+        jitterWindow = (uint32_t)MIN(MAX([payload[kPushJitterSecondsKey] longLongValue], 0),
+                                     (long long)kMaxJitterSeconds);
+      }
+      uint32_t jitterSeconds = jitterWindow ? arc4random_uniform(jitterWindow + 1) : 0;
+
+      // Rule only messages trigger a rule download without the rest of a full sync.
+      NSString* action = payload[kPushActionKey];
+      BOOL ruleSync = [action isKindOfClass:[NSString class]] && [action isEqualToString:kRuleSync];
+
+      if (jitterSeconds) {
+        LOGI(@"NATS: Scheduling %@ in %u seconds (jitter) due to message on %@",
+             ruleSync ? @"rule sync" : @"sync", jitterSeconds, subject);
       } else {
-        LOGI(@"NATS: Triggering immediate sync due to message on %@", subject);
+        LOGI(@"NATS: Triggering immediate %@ due to message on %@",
+             ruleSync ? @"rule sync" : @"sync", subject);
       }
 
       dispatch_async(dispatch_get_main_queue(), ^{
         if (!self.isShuttingDown) {
-          [self.syncDelegate syncSecondsFromNow:jitterSeconds];
+          if (ruleSync) {
+            [self.syncDelegate ruleSyncSecondsFromNow:jitterSeconds];
+          } else {
+            [self.syncDelegate syncSecondsFromNow:jitterSeconds];
+          }
         }
       });
     }
@@ -764,7 +799,7 @@ static void messageHandler(natsConnection* nc, natsSubscription* sub, natsMsg* m
   //
   // IMPORTANT: Do not touch the nats objects in this block they are owned by
   // the nats library and will be destroyed after this block.
-  [self handlePushNotificationForSubject:msgSubject];
+  [self handlePushNotificationForSubject:msgSubject data:msgData];
 
   natsMsg_Destroy(msg);
 }
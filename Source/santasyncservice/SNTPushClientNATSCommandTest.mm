@@ -17,8 +17,10 @@
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 
+#import "Source/common/MOLXPCConnection.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTSyncConstants.h"
+#import "Source/common/SNTXPCControlInterface.h"
 #import "Source/santasyncservice/SNTPushClientNATS.h"
 #import "Source/santasyncservice/SNTPushNotifications.h"
 #include "commands/v1.pb.h"
@@ -65,6 +67,22 @@ static constexpr NSUInteger kMaxCommandNonceCacheCount = kMaxCommandAgeSeconds;
                                                        onArena:(google::protobuf::Arena*)arena;
 - (void)publishResponse:(const ::pbv1::SantaCommandResponse&)response
            toReplyTopic:(NSString*)replyTopic;
+- (void)submitSantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                replyTopic:(NSString*)replyTopic;
+@end
+
+// Captures published responses instead of sending them over NATS
+@interface SNTPushClientNATSRecordingClient : SNTPushClientNATS
+@property(copy) void (^onPublish)(const ::pbv1::SantaCommandResponse& response, NSString* topic);
+@end
+
+@implementation SNTPushClientNATSRecordingClient
+- (void)publishResponse:(const ::pbv1::SantaCommandResponse&)response
+           toReplyTopic:(NSString*)replyTopic {
+  if (self.onPublish) {
+    self.onPublish(response, replyTopic);
+  }
+}
 @end
 
 @interface SNTPushClientNATSCommandTest : XCTestCase
@@ -1136,4 +1154,68 @@ static constexpr NSUInteger kMaxCommandNonceCacheCount = kMaxCommandAgeSeconds;
                  @"Should return ERROR_INVALID_PATH on empty path");
 }
 
+#pragma mark - Command Execution Tests
+
+- (void)testSlowCommandDoesNotBlockOtherCommandTypes {
+  // Given: santad never replies to kill requests
+  id daemonConn = OCMClassMock([MOLXPCConnection class]);
+  id daemonConnRop = OCMProtocolMock(@protocol(SNTDaemonControlXPC));
+  OCMStub([daemonConn remoteObjectProxy]).andReturn(daemonConnRop);
+  OCMStub([self.mockSyncDelegate daemonConnection]).andReturn(daemonConn);
+
+  SNTPushClientNATSRecordingClient* client =
+      [[SNTPushClientNATSRecordingClient alloc] initWithSyncDelegate:self.mockSyncDelegate];
+  client.hmacKey = self.testHMACKey;
+
+  XCTestExpectation* pingPublished = [self expectationWithDescription:@"Ping response published"];
+  __block BOOL killPublished = NO;
+  client.onPublish = ^(const ::pbv1::SantaCommandResponse& response, NSString* topic) {
+    if ([topic isEqualToString:@"reply.kill"]) {
+      killPublished = YES;
+    } else if ([topic isEqualToString:@"reply.ping"]) {
+      XCTAssertEqual(response.result_case(), ::pbv1::SantaCommandResponse::kPing);
+      [pingPublished fulfill];
+    }
+  };
+
+  ::pbv1::SantaCommandRequest killCommand;
+  killCommand.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  killCommand.mutable_kill()->set_team_id("EQHXZ8M8AV");
+  [self signCommandRequest:&killCommand];
+
+  ::pbv1::SantaCommandRequest pingCommand;
+  pingCommand.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  pingCommand.mutable_ping();
+  [self signCommandRequest:&pingCommand];
+
+  // When: A ping arrives behind a kill that is still waiting on santad
+  [client submitSantaCommand:killCommand replyTopic:@"reply.kill"];
+  [client submitSantaCommand:pingCommand replyTopic:@"reply.ping"];
+
+  // Then: The ping response is published without waiting for the kill
+  [self waitForExpectations:@[ pingPublished ] timeout:5.0];
+  XCTAssertFalse(killPublished);
+}
+
+- (void)testSubmittedCommandFailingVerificationPublishesError {
+  SNTPushClientNATSRecordingClient* client =
+      [[SNTPushClientNATSRecordingClient alloc] initWithSyncDelegate:self.mockSyncDelegate];
+  client.hmacKey = self.testHMACKey;
+
+  XCTestExpectation* published = [self expectationWithDescription:@"Error response published"];
+  client.onPublish = ^(const ::pbv1::SantaCommandResponse& response, NSString* topic) {
+    XCTAssertEqualObjects(topic, @"reply");
+    XCTAssertEqual(response.error(), ::pbv1::SantaCommandResponse::ERROR_INVALID_DATA);
+    [published fulfill];
+  };
+
+  // Given: A command that was never signed
+  ::pbv1::SantaCommandRequest command;
+  command.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  command.mutable_ping();
+
+  [client submitSantaCommand:command replyTopic:@"reply"];
+  [self waitForExpectations:@[ published ] timeout:5.0];
+}
+
 @end
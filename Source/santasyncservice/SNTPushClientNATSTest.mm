@@ -84,7 +84,7 @@ static X509* CreateCertWithDNSSANBytes(const char* data, size_t len) {
                             jwt:(NSString*)jwt
                    pushDeviceID:(NSString*)deviceID
                            tags:(NSArray<NSString*>*)tags;
-- (void)handlePushNotificationForSubject:(NSString*)subject;
+- (void)handlePushNotificationForSubject:(NSString*)subject data:(NSString*)data;
 @end
 
 @interface SNTPushClientNATSTest : XCTestCase
@@ -644,7 +644,7 @@ static X509* CreateCertWithDNSSANBytes(const char* data, size_t len) {
       });
 
   // When: A tag push notification is received
-  [self.client handlePushNotificationForSubject:@"santa.tag.production"];
+  [self.client handlePushNotificationForSubject:@"santa.tag.production" data:nil];
 
   // Then: syncSecondsFromNow should be called with jitter in [0, 180]
   [self waitForExpectations:@[ expectation ] timeout:2.0];
@@ -667,12 +667,76 @@ static X509* CreateCertWithDNSSANBytes(const char* data, size_t len) {
       });
 
   // When: A host push notification is received
-  [self.client handlePushNotificationForSubject:@"santa.host.ABC123"];
+  [self.client handlePushNotificationForSubject:@"santa.host.ABC123" data:nil];
 
   // Then: syncSecondsFromNow should be called with 0 (no jitter)
   [self waitForExpectations:@[ expectation ] timeout:2.0];
 }
 
+- (void)testMessageJitterWindowOverridesDefault {
+  self.client = [[SNTPushClientNATS alloc] initWithSyncDelegate:self.mockSyncDelegate];
+
+  XCTestExpectation* expectation =
+      [self expectationWithDescription:@"syncSecondsFromNow called within the supplied window"];
+
+  OCMStub([self.mockSyncDelegate syncSecondsFromNow:0])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* invocation) {
+        uint64_t seconds;
+        [invocation getArgument:&seconds atIndex:2];
+        XCTAssertLessThanOrEqual(seconds, 5u);
+        [expectation fulfill];
+      });
+
+  [self.client handlePushNotificationForSubject:@"santa.tag.production"
+                                           data:@"{\"jitter_seconds\": 5}"];
+
+  [self waitForExpectations:@[ expectation ] timeout:2.0];
+}
+
+- (void)testRuleSyncMessageTriggersRuleSync {
+  self.client = [[SNTPushClientNATS alloc] initWithSyncDelegate:self.mockSyncDelegate];
+
+  XCTestExpectation* expectation =
+      [self expectationWithDescription:@"ruleSyncSecondsFromNow called for rule sync message"];
+
+  OCMReject([self.mockSyncDelegate syncSecondsFromNow:0]).ignoringNonObjectArgs();
+  OCMStub([self.mockSyncDelegate ruleSyncSecondsFromNow:0])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* invocation) {
+        uint64_t seconds;
+        [invocation getArgument:&seconds atIndex:2];
+        XCTAssertLessThanOrEqual(seconds, 60u);
+        [expectation fulfill];
+      });
+
+  [self.client handlePushNotificationForSubject:@"santa.tag.production"
+                                           data:@"{\"action\": \"rule_sync\", "
+                                                @"\"jitter_seconds\": 60}"];
+
+  [self waitForExpectations:@[ expectation ] timeout:2.0];
+}
+
+- (void)testNonJSONMessageTriggersSync {
+  self.client = [[SNTPushClientNATS alloc] initWithSyncDelegate:self.mockSyncDelegate];
+
+  XCTestExpectation* expectation =
+      [self expectationWithDescription:@"syncSecondsFromNow called for non-JSON message"];
+
+  OCMStub([self.mockSyncDelegate syncSecondsFromNow:0])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* invocation) {
+        uint64_t seconds;
+        [invocation getArgument:&seconds atIndex:2];
+        XCTAssertEqual(seconds, 0u);
+        [expectation fulfill];
+      });
+
+  [self.client handlePushNotificationForSubject:@"santa.host.ABC123" data:@"sync"];
+
+  [self waitForExpectations:@[ expectation ] timeout:2.0];
+}
+
 #pragma mark - SSL Certificate Domain Verification Tests
 
 - (void)testLeafCertHasPushDomain_validPushHost {
@@ -20,6 +20,10 @@
 
 @interface SNTSyncEventUpload : SNTSyncStage
 
+/// The most event batches that will be uploaded at once. The number actually in flight adapts to
+/// how quickly the server responds.
+@property NSUInteger maxBatchesInFlight;
+
 - (BOOL)uploadEvents:(NSArray<SNTStoredEvent*>*)events;
 
 @end
@@ -42,10 +42,87 @@ namespace pbv2 = ::santa::sync::v2;
 using santa::NSStringToUTF8String;
 using santa::NSStringToUTF8StringView;
 
+static const NSUInteger kDefaultMaxBatchesInFlight = 4;
+
+// Responses taking longer than this multiple of the fastest response seen are taken as a sign
+// that the server is struggling with the number of batches in flight.
+static const double kSlowResponseFactor = 2.0;
+
+/// Limits the number of event batches being uploaded at once. The limit starts at one and grows
+/// while the server responds about as quickly as its fastest response so far, and halves when
+/// responses slow down. Once any batch fails, no more are let through.
+@interface SNTEventUploadWindow : NSObject
+@property(readonly) NSUInteger limit;
+- (instancetype)initWithMaxBatches:(NSUInteger)maxBatches;
+/// Blocks until another batch may be sent. Returns NO if a batch has failed.
+- (BOOL)acquire;
+- (void)releaseWithSuccess:(BOOL)success duration:(CFTimeInterval)duration;
+/// Blocks until every batch that was sent has finished. Returns NO if any failed.
+- (BOOL)waitForAll;
+@end
+
+@implementation SNTEventUploadWindow {
+  NSCondition* _condition;
+  NSUInteger _maxBatches;
+  NSUInteger _inFlight;
+  CFTimeInterval _fastest;
+  BOOL _failed;
+}
+
+- (instancetype)initWithMaxBatches:(NSUInteger)maxBatches {
+  self = [super init];
+  if (self) {
+    _condition = [[NSCondition alloc] init];
+    _maxBatches = MAX(maxBatches, 1u);
+    _limit = 1;
+  }
+  return self;
+}
+
+- (BOOL)acquire {
+  [_condition lock];
+  while (!_failed && _inFlight >= _limit) {
+    [_condition wait];
+  }
+  BOOL acquired = !_failed;
+  if (acquired) _inFlight++;
+  [_condition unlock];
+  return acquired;
+}
+
+- (void)releaseWithSuccess:(BOOL)success duration:(CFTimeInterval)duration {
+  [_condition lock];
+  _inFlight--;
+  if (!success) {
+    _failed = YES;
+  } else {
+    if (_fastest == 0 || duration < _fastest) _fastest = duration;
+    if (duration <= _fastest * kSlowResponseFactor) {
+      _limit = MIN(_limit + 1, _maxBatches);
+    } else {
+      _limit = MAX(_limit / 2, 1u);
+    }
+  }
+  [_condition broadcast];
+  [_condition unlock];
+}
+
+- (BOOL)waitForAll {
+  [_condition lock];
+  while (_inFlight > 0) {
+    [_condition wait];
+  }
+  BOOL success = !_failed;
+  [_condition unlock];
+  return success;
+}
+
+@end
+
 namespace {
 
 template <bool IsV2>
-BOOL PerformRequest(SNTSyncEventUpload* self, google::protobuf::Message* req, int eventsInBatch);
+BOOL PerformRequest(SNTSyncEventUpload* self, NSURLRequest* request, int eventsInBatch);
 template <bool IsV2>
 typename santa::ProtoTraits<IsV2>::EventT* MessageForExecutionEvent(SNTStoredExecutionEvent* event,
                                                                     google::protobuf::Arena* arena);
@@ -60,39 +137,40 @@ typename santa::ProtoTraits<IsV2>::FileAccessEventT* MessageForFileAccessEvent(
                                                google::protobuf::Arena* arena);
 
 template <bool IsV2>
-BOOL PerformRequest(SNTSyncEventUpload* self, google::protobuf::Message* req, int eventsInBatch) {
+BOOL PerformRequest(SNTSyncEventUpload* self, NSURLRequest* request, int eventsInBatch) {
   using Traits = santa::ProtoTraits<IsV2>;
-  if (eventsInBatch == 0) {
-    return YES;
-  }
-
-  if (self.syncState.syncType == SNTSyncTypeNormal ||
-      [[SNTConfigurator configurator] enableCleanSyncEventUpload]) {
-    typename Traits::EventUploadResponseT response;
-    NSError* err = [self performRequest:[self requestWithMessage:req]
-                            intoMessage:&response
-                                timeout:30];
-    if (err) {
-      SLOGE(@"Failed to upload events: %@", err);
-      return NO;
-    }
+  if (!request) {
+    SLOGE(@"Failed to create event upload request");
+    return NO;
+  }
 
-    // A list of bundle hashes that require their related binary events to be uploaded.
-    if (response.event_upload_bundle_binaries_size()) {
-      self.syncState.bundleBinaryRequests =
-          [NSMutableArray arrayWithCapacity:response.event_upload_bundle_binaries_size()];
-      for (const std::string& bundle_binary : response.event_upload_bundle_binaries()) {
-        [(NSMutableArray*)self.syncState.bundleBinaryRequests
-            addObject:santa::StringToNSString(bundle_binary)];
-      }
+  typename Traits::EventUploadResponseT response;
+  NSError* err = [self performRequest:request intoMessage:&response timeout:30];
+  if (err) {
+    SLOGE(@"Failed to upload events: %@", err);
+    return NO;
+  }
+
+  // A list of bundle hashes that require their related binary events to be uploaded.
+  if (response.event_upload_bundle_binaries_size()) {
+    NSMutableArray* bundleBinaryRequests =
+        [NSMutableArray arrayWithCapacity:response.event_upload_bundle_binaries_size()];
+    for (const std::string& bundle_binary : response.event_upload_bundle_binaries()) {
+      [bundleBinaryRequests addObject:santa::StringToNSString(bundle_binary)];
     }
-    SLOGI(@"Uploaded %d events", eventsInBatch);
+    self.syncState.bundleBinaryRequests = bundleBinaryRequests;
   }
+  SLOGI(@"Uploaded %d events", eventsInBatch);
   return YES;
 }
 
+// Serializes each batch as soon as it's full and hands it to `window` to upload, so the next
+// batch is built while earlier ones are in flight. The events in a batch are removed from the
+// database once the server acknowledges it. Returns NO if a batch could not be sent because an
+// earlier one failed. Callers must wait on `window` for the uploads to finish.
 template <bool IsV2>
-BOOL EventUpload(SNTSyncEventUpload* self, NSArray<SNTStoredEvent*>* events) {
+BOOL EventUpload(SNTSyncEventUpload* self, NSArray<SNTStoredEvent*>* events,
+                 SNTEventUploadWindow* window) {
   using Traits = santa::ProtoTraits<IsV2>;
   google::protobuf::Arena arena;
   google::protobuf::Arena* pArena = &arena;
@@ -161,15 +239,29 @@ BOOL EventUpload(SNTSyncEventUpload* self, NSArray<SNTStoredEvent*>* events) {
     }
 
     if (totalEventCount >= self.syncState.eventBatchSize || idx == finalIdx) {
-      if (!PerformRequest<IsV2>(self, req, totalEventCount)) {
+      // Remove event IDs. For Bundle Events the ID is 0 so nothing happens.
+      NSArray* batchEventIds = [eventIds allObjects];
+      BOOL shouldUpload = totalEventCount > 0 &&
+                          (self.syncState.syncType == SNTSyncTypeNormal ||
+                           [[SNTConfigurator configurator] enableCleanSyncEventUpload]);
+      if (!shouldUpload) {
+        [[self.daemonConn remoteObjectProxy] databaseRemoveEventsWithIDs:batchEventIds];
+      } else if ([window acquire]) {
+        NSURLRequest* request = [self requestWithMessage:req];
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+          CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+          BOOL uploaded = PerformRequest<IsV2>(self, request, totalEventCount);
+          if (uploaded) {
+            [[self.daemonConn remoteObjectProxy] databaseRemoveEventsWithIDs:batchEventIds];
+          }
+          [window releaseWithSuccess:uploaded duration:CFAbsoluteTimeGetCurrent() - start];
+        });
+      } else {
         success = NO;
         *stop = YES;
         return;
       }
 
-      // Remove event IDs. For Bundle Events the ID is 0 so nothing happens.
-      [[self.daemonConn remoteObjectProxy] databaseRemoveEventsWithIDs:[eventIds allObjects]];
-
       [eventIds removeAllObjects];
       uploadEvents->Clear();
       uploadFAAEvents->Clear();
@@ -535,22 +627,64 @@ void MessageForTemporaryMonitorModeLeaveAuditEvent(
   return [NSURL URLWithString:stageName relativeToURL:self.syncState.syncBaseURL];
 }
 
+- (instancetype)initWithState:(SNTSyncState*)syncState {
+  self = [super initWithState:syncState];
+  if (self) {
+    _maxBatchesInFlight = kDefaultMaxBatchesInFlight;
+  }
+  return self;
+}
+
 - (BOOL)sync {
-  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
-  [[self.daemonConn remoteObjectProxy] databaseEventsPending:^(NSArray* events) {
-    if (events.count) {
-      [self uploadEvents:events];
+  // Events are fetched and uploaded one batch at a time so that a large backlog never has to be
+  // held in memory all at once. A few batches may be in flight at once to hide the round trip
+  // time, uploaded events are removed from the database as each batch is acknowledged.
+  SNTEventUploadWindow* window =
+      [[SNTEventUploadWindow alloc] initWithMaxBatches:self.maxBatchesInFlight];
+  NSUInteger pageSize = MAX(self.syncState.eventBatchSize, 1u);
+  NSNumber* cursor;
+  while (YES) {
+    __block NSArray<SNTStoredEvent*>* page;
+    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+    [[self.daemonConn remoteObjectProxy]
+        databaseEventsPendingAfterIndex:cursor
+                                  limit:pageSize
+                                  reply:^(NSArray<SNTStoredEvent*>* events) {
+                                    page = events;
+                                    dispatch_semaphore_signal(sema);
+                                  }];
+    if (dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER) != 0) {
+      [window waitForAll];
+      return NO;
     }
-    dispatch_semaphore_signal(sema);
-  }];
-  return (dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER) == 0);
+
+    @autoreleasepool {
+      if (page.count && ![self uploadEvents:page window:window]) {
+        break;
+      }
+    }
+
+    cursor = page.lastObject.idx;
+    if (page.count < pageSize || !cursor) {
+      break;
+    }
+  }
+  [window waitForAll];
+  return YES;
 }
 
 - (BOOL)uploadEvents:(NSArray<SNTStoredEvent*>*)events {
+  SNTEventUploadWindow* window =
+      [[SNTEventUploadWindow alloc] initWithMaxBatches:self.maxBatchesInFlight];
+  BOOL sent = [self uploadEvents:events window:window];
+  return [window waitForAll] && sent;
+}
+
+- (BOOL)uploadEvents:(NSArray<SNTStoredEvent*>*)events window:(SNTEventUploadWindow*)window {
   if (self.syncState.isSyncV2) {
-    return EventUpload<true>(self, events);
+    return EventUpload<true>(self, events, window);
   } else {
-    return EventUpload<false>(self, events);
+    return EventUpload<false>(self, events, window);
   }
 }
 
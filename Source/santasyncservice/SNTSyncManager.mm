@@ -54,6 +54,11 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 @property(nonatomic, readonly) dispatch_queue_t syncQueue;
 @property(nonatomic, readonly) dispatch_semaphore_t syncLimiter;
 
+// Full and rule only syncs waiting on syncQueue that haven't started yet. Requests that arrive
+// while one is waiting are merged into it. Guarded by @synchronized(self).
+@property(nonatomic) NSUInteger fullSyncsPending;
+@property(nonatomic) BOOL ruleSyncPending;
+
 @property(nonatomic) MOLXPCConnection* daemonConn;
 
 @property(nonatomic) BOOL reachable;
@@ -79,6 +84,11 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 
 @property(nonatomic, readonly) dispatch_queue_t metricsQueue;
 
+// Kept between syncs so that connections, and their TLS sessions, are reused. Replaced whenever
+// any of the settings in authURLSessionKey change. Guarded by @synchronized(self).
+@property MOLAuthenticatingURLSession* authURLSession;
+@property NSArray* authURLSessionKey;
+
 @end
 
 @implementation SNTSyncManager
@@ -350,13 +360,21 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 
 - (void)syncType:(SNTSyncType)syncType withReply:(void (^)(SNTSyncStatusType))reply {
   if (dispatch_semaphore_wait(self.syncLimiter, DISPATCH_TIME_NOW)) {
+    // A sync is already waiting to follow the one in progress and will pick up any changes.
+    LOGD(@"Sync already queued, merging request");
     if (reply) reply(SNTSyncStatusTypeTooManySyncsInProgress);
     return;
   }
+  @synchronized(self) {
+    self.fullSyncsPending++;
+  }
   dispatch_async(self.syncQueue, ^() {
     absl::Cleanup signalLimiter = ^{
       dispatch_semaphore_signal(self.syncLimiter);
     };
+    @synchronized(self) {
+      self.fullSyncsPending--;
+    }
     SLOGI(@"Starting sync...");
     if (syncType != SNTSyncTypeNormal) {
       dispatch_semaphore_t sema = dispatch_semaphore_create(0);
@@ -394,7 +412,20 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   // Rule only syncs are exclusively scheduled by self.ruleSyncTimer. We do not need to worry about
   // using self.syncLimiter here. However we do want to do the work on self.syncQueue so we do not
   // overlap with a full sync.
+  //
+  // A full sync that hasn't started yet will download rules anyway, as will a rule sync that's
+  // already waiting, so there's no need to queue another.
+  @synchronized(self) {
+    if (self.fullSyncsPending || self.ruleSyncPending) {
+      LOGD(@"Sync already queued, merging rule sync request");
+      return;
+    }
+    self.ruleSyncPending = YES;
+  }
   dispatch_async(self.syncQueue, ^() {
+    @synchronized(self) {
+      self.ruleSyncPending = NO;
+    }
     if (![[SNTConfigurator configurator] syncBaseURL]) return;
     SNTSyncStatusType status = SNTSyncStatusTypeUnknown;
     SNTSyncState* syncState = [self createSyncStateWithStatus:&status];
@@ -647,6 +678,10 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 }
 
 - (SNTSyncStatusType)eventUploadWithSyncState:(SNTSyncState*)syncState {
+  if ([[SNTConfigurator configurator] syncEnableConcurrentStages]) {
+    return [self concurrentEventUploadAndRuleDownloadWithSyncState:syncState];
+  }
+
   SLOGD(@"Event upload starting");
   SNTSyncEventUpload* p = [[SNTSyncEventUpload alloc] initWithState:syncState];
   if ([p sync]) {
@@ -670,6 +705,34 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   return SNTSyncStatusTypeRuleDownloadFailed;
 }
 
+// Event upload and rule download only depend on the results of preflight, so they can run at the
+// same time. Both have to succeed before postflight runs.
+- (SNTSyncStatusType)concurrentEventUploadAndRuleDownloadWithSyncState:(SNTSyncState*)syncState {
+  SLOGD(@"Event upload and rule download starting");
+  __block BOOL eventUploadSucceeded = NO;
+  dispatch_group_t group = dispatch_group_create();
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+    SNTSyncEventUpload* p = [[SNTSyncEventUpload alloc] initWithState:syncState];
+    eventUploadSucceeded = [p sync];
+  });
+
+  SNTSyncRuleDownload* p = [[SNTSyncRuleDownload alloc] initWithState:syncState];
+  BOOL ruleDownloadSucceeded = [p sync];
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+  if (!eventUploadSucceeded) {
+    SLOGE(@"Event upload failed, aborting run");
+    return SNTSyncStatusTypeEventUploadFailed;
+  }
+  if (!ruleDownloadSucceeded) {
+    SLOGE(@"Rule download failed, aborting run");
+    return SNTSyncStatusTypeRuleDownloadFailed;
+  }
+
+  SLOGD(@"Event upload and rule download complete");
+  return [self postflightWithSyncState:syncState];
+}
+
 - (SNTSyncStatusType)postflightWithSyncState:(SNTSyncState*)syncState {
   SLOGD(@"Postflight starting");
   SNTSyncPostflight* p = [[SNTSyncPostflight alloc] initWithState:syncState];
@@ -702,6 +765,106 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   return timerQueue;
 }
 
+// Returns the session to use for syncing with the server at syncBaseURL, reusing the one from the
+// previous sync unless any of the settings it was created with have changed.
+- (MOLAuthenticatingURLSession*)authURLSessionForSyncBaseURL:(NSURL*)syncBaseURL {
+  SNTConfigurator* config = [SNTConfigurator configurator];
+  BOOL pinned = santa::IsDomainPinned(syncBaseURL);
+
+  // Apply extra headers at the session level so all requests (including doctor checks) get them.
+  NSSet<NSString*>* restrictedHeaders = [NSSet setWithArray:@[
+    @"content-encoding",
+    @"content-length",
+    @"content-type",
+    @"connection",
+    @"host",
+    @"proxy-authenticate",
+    @"proxy-authorization",
+    @"www-authenticate",
+  ]];
+  NSMutableDictionary* filtered = [NSMutableDictionary dictionary];
+  [[config syncExtraHeaders] enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL* stop) {
+    if (![key isKindOfClass:[NSString class]] || ![object isKindOfClass:[NSString class]]) return;
+    if ([restrictedHeaders containsObject:((NSString*)key).lowercaseString]) return;
+    filtered[key] = object;
+  }];
+
+  NSString* rootsFile = [config syncServerAuthRootsFile];
+  NSDate* rootsFileModified =
+      rootsFile
+          ? [[NSFileManager defaultManager] attributesOfItemAtPath:rootsFile error:NULL]
+                .fileModificationDate
+          : nil;
+
+  NSNull* none = [NSNull null];
+  NSArray* key = @[
+    syncBaseURL.host ?: none,
+    @(pinned),
+    [config syncProxyConfig] ?: none,
+    filtered,
+    rootsFile ?: none,
+    rootsFileModified ?: none,
+    [config syncServerAuthRootsData] ?: none,
+    [config syncClientAuthCertificateFile] ?: none,
+    [config syncClientAuthCertificatePassword] ?: none,
+    [config syncClientAuthCertificateCn] ?: none,
+    [config syncClientAuthCertificateIssuer] ?: none,
+  ];
+
+  @synchronized(self) {
+    if (self.authURLSession && [self.authURLSessionKey isEqual:key]) {
+      return self.authURLSession;
+    }
+    [self.authURLSession.session finishTasksAndInvalidate];
+
+    NSURLSessionConfiguration* sessConfig =
+        [NSURLSessionConfiguration defaultSessionConfiguration];
+    sessConfig.connectionProxyDictionary = [config syncProxyConfig];
+    if (filtered.count) {
+      sessConfig.HTTPAdditionalHeaders = filtered;
+    }
+
+    MOLAuthenticatingURLSession* authURLSession =
+        [[MOLAuthenticatingURLSession alloc] initWithSessionConfiguration:sessConfig];
+    authURLSession.userAgent = @"santactl-sync/";
+    NSString* santactlVersion =
+        [[NSBundle mainBundle] objectForInfoDictionaryKey:@"CFBundleVersion"];
+    if (santactlVersion) {
+      authURLSession.userAgent = [authURLSession.userAgent stringByAppendingString:santactlVersion];
+    }
+    authURLSession.refusesRedirects = YES;
+    authURLSession.serverHostname = syncBaseURL.host;
+    authURLSession.loggingBlock = ^(NSString* line) {
+      SLOGD(@"%@", line);
+    };
+
+    // Configure server auth
+    if (pinned) {
+#ifndef DEBUG
+      authURLSession.serverRootsPemString = santa::PinnedCertPEMs();
+#endif
+    } else if (rootsFile) {
+      authURLSession.serverRootsPemFile = rootsFile;
+    } else if ([config syncServerAuthRootsData]) {
+      authURLSession.serverRootsPemData = [config syncServerAuthRootsData];
+    }
+
+    // Configure client auth
+    if ([config syncClientAuthCertificateFile]) {
+      authURLSession.clientCertFile = [config syncClientAuthCertificateFile];
+      authURLSession.clientCertPassword = [config syncClientAuthCertificatePassword];
+    } else if ([config syncClientAuthCertificateCn]) {
+      authURLSession.clientCertCommonName = [config syncClientAuthCertificateCn];
+    } else if ([config syncClientAuthCertificateIssuer]) {
+      authURLSession.clientCertIssuerCn = [config syncClientAuthCertificateIssuer];
+    }
+
+    self.authURLSession = authURLSession;
+    self.authURLSessionKey = key;
+    return authURLSession;
+  }
+}
+
 - (SNTSyncState*)createSyncStateWithStatus:(SNTSyncStatusType*)status {
   // Gather some data needed during some sync stages
   SNTSyncState* syncState = [[SNTSyncState alloc] init];
@@ -733,46 +896,6 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   syncState.xsrfToken = self.xsrfToken;
   syncState.xsrfTokenHeader = self.xsrfTokenHeader;
 
-  NSURLSessionConfiguration* sessConfig = [NSURLSessionConfiguration defaultSessionConfiguration];
-  sessConfig.connectionProxyDictionary = [[SNTConfigurator configurator] syncProxyConfig];
-
-  // Apply extra headers at the session level so all requests (including doctor checks) get them.
-  NSSet<NSString*>* restrictedHeaders = [NSSet setWithArray:@[
-    @"content-encoding",
-    @"content-length",
-    @"content-type",
-    @"connection",
-    @"host",
-    @"proxy-authenticate",
-    @"proxy-authorization",
-    @"www-authenticate",
-  ]];
-  NSDictionary* extraHeaders = [config syncExtraHeaders];
-  if (extraHeaders.count) {
-    NSMutableDictionary* filtered = [NSMutableDictionary dictionary];
-    [extraHeaders enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL* stop) {
-      if (![key isKindOfClass:[NSString class]] || ![object isKindOfClass:[NSString class]]) return;
-      if ([restrictedHeaders containsObject:((NSString*)key).lowercaseString]) return;
-      filtered[key] = object;
-    }];
-    if (filtered.count) {
-      sessConfig.HTTPAdditionalHeaders = filtered;
-    }
-  }
-
-  MOLAuthenticatingURLSession* authURLSession =
-      [[MOLAuthenticatingURLSession alloc] initWithSessionConfiguration:sessConfig];
-  authURLSession.userAgent = @"santactl-sync/";
-  NSString* santactlVersion = [[NSBundle mainBundle] objectForInfoDictionaryKey:@"CFBundleVersion"];
-  if (santactlVersion) {
-    authURLSession.userAgent = [authURLSession.userAgent stringByAppendingString:santactlVersion];
-  }
-  authURLSession.refusesRedirects = YES;
-  authURLSession.serverHostname = syncState.syncBaseURL.host;
-  authURLSession.loggingBlock = ^(NSString* line) {
-    SLOGD(@"%@", line);
-  };
-
   // Ask the daemon to determine if sync v2 is enabled. Sync v2 will be enabled
   // if a pinned domain is configured or if a valid push token chain is present.
   // The push token chain is stored in the sync state which is not accessible
@@ -781,17 +904,6 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
     syncState.isSyncV2 = reply;
   }];
 
-  // Configure server auth
-  if (santa::IsDomainPinned(syncState.syncBaseURL)) {
-#ifndef DEBUG
-    authURLSession.serverRootsPemString = santa::PinnedCertPEMs();
-#endif
-  } else if ([config syncServerAuthRootsFile]) {
-    authURLSession.serverRootsPemFile = [config syncServerAuthRootsFile];
-  } else if ([config syncServerAuthRootsData]) {
-    authURLSession.serverRootsPemData = [config syncServerAuthRootsData];
-  }
-
 // Force sync v2 via compile-time define
 #ifdef SANTA_FORCE_SYNC_V2
   syncState.isSyncV2 = YES;
@@ -799,17 +911,7 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 
   SLOGD(@"Using sync protocol version: %d", syncState.isSyncV2 ? 2 : 1);
 
-  // Configure client auth
-  if ([config syncClientAuthCertificateFile]) {
-    authURLSession.clientCertFile = [config syncClientAuthCertificateFile];
-    authURLSession.clientCertPassword = [config syncClientAuthCertificatePassword];
-  } else if ([config syncClientAuthCertificateCn]) {
-    authURLSession.clientCertCommonName = [config syncClientAuthCertificateCn];
-  } else if ([config syncClientAuthCertificateIssuer]) {
-    authURLSession.clientCertIssuerCn = [config syncClientAuthCertificateIssuer];
-  }
-
-  syncState.session = [authURLSession session];
+  syncState.session = [self authURLSessionForSyncBaseURL:syncState.syncBaseURL].session;
   syncState.daemonConn = self.daemonConn;
   syncState.contentEncoding = config.syncClientContentEncoding;
   syncState.pushNotificationsToken = self.pushNotifications.token;
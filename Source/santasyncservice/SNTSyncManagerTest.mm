@@ -17,6 +17,7 @@
 #import <dispatch/dispatch.h>
 
 #import "Source/common/MOLXPCConnection.h"
+#import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTSyncConstants.h"
 #import "Source/common/SNTXPCControlInterface.h"
 #import "Source/santasyncservice/SNTPushNotifications.h"
@@ -30,6 +31,10 @@
 @property NSUInteger persistedFullSyncInterval;
 @property(nonatomic) BOOL reachable;
 @property(nonatomic) BOOL hasInitialPathState;
+@property(nonatomic, readonly) dispatch_queue_t syncQueue;
+@property(nonatomic) NSUInteger fullSyncsPending;
+- (void)ruleSyncImpl;
+- (SNTSyncState*)createSyncStateWithStatus:(SNTSyncStatusType*)status;
 - (void)rescheduleTimerQueue:(dispatch_source_t)timerQueue secondsFromNow:(uint64_t)seconds;
 - (dispatch_source_t)createSyncTimerWithBlock:(void (^)(void))block;
 - (void)handlePathReachable:(BOOL)reachable;
@@ -262,4 +267,52 @@
   [syncManagerMock stopMocking];
 }
 
+#pragma mark - Sync Merging
+
+- (void)testQueuedRuleSyncsAreMerged {
+  id configMock = OCMClassMock([SNTConfigurator class]);
+  OCMStub([configMock configurator]).andReturn(configMock);
+  OCMStub([configMock syncBaseURL]).andReturn([NSURL URLWithString:@"https://myserver.local/"]);
+
+  id mockConnection = OCMClassMock([MOLXPCConnection class]);
+  SNTSyncManager* sm = [[SNTSyncManager alloc] initWithDaemonConnection:mockConnection];
+  id syncManagerMock = OCMPartialMock(sm);
+  __block int ruleSyncs = 0;
+  OCMStub([syncManagerMock createSyncStateWithStatus:[OCMArg anyPointer]])
+      .andDo(^(NSInvocation* inv) {
+        // Returns nil, so the rule sync stops here
+        ruleSyncs++;
+      });
+
+  // Hold up the sync queue as if a sync were in progress
+  void (^drain)(void) = ^{
+  };
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  dispatch_async(sm.syncQueue, ^{
+    dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER);
+  });
+
+  [sm ruleSyncImpl];
+  [sm ruleSyncImpl];
+  [sm ruleSyncImpl];
+
+  dispatch_semaphore_signal(sema);
+  dispatch_sync(sm.syncQueue, drain);
+  XCTAssertEqual(ruleSyncs, 1);
+
+  // Once the merged sync has started, new requests queue again
+  [sm ruleSyncImpl];
+  dispatch_sync(sm.syncQueue, drain);
+  XCTAssertEqual(ruleSyncs, 2);
+
+  // A full sync that hasn't started yet downloads rules too
+  sm.fullSyncsPending = 1;
+  [sm ruleSyncImpl];
+  dispatch_sync(sm.syncQueue, drain);
+  XCTAssertEqual(ruleSyncs, 2);
+
+  [syncManagerMock stopMocking];
+  [configMock stopMocking];
+}
+
 @end
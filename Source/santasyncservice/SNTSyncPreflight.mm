@@ -124,7 +124,8 @@ BOOL Preflight(SNTSyncPreflight* self, google::protobuf::Arena* arena,
     req->set_push_notification_sync(true);
   }
 
-  [rop databaseRuleCounts:^(struct RuleCounts counts) {
+  [rop preflightInfo:^(struct RuleCounts counts, SNTClientMode cm, NSString* execRulesHash,
+                       NSString* faaRulesHash, NSString* nfRulesHash) {
     req->set_binary_rule_count(static_cast<uint32_t>(counts.binary));
     req->set_certificate_rule_count(static_cast<uint32_t>(counts.certificate));
     req->set_compiler_rule_count(static_cast<uint32_t>(counts.compiler));
@@ -136,17 +137,13 @@ BOOL Preflight(SNTSyncPreflight* self, google::protobuf::Arena* arena,
       req->set_file_access_rule_count(static_cast<uint32_t>(counts.fileAccess));
       req->set_network_flow_rule_count(static_cast<uint32_t>(counts.networkFlow));
     }
-  }];
 
-  [rop databaseRulesHash:^(NSString* execRulesHash, NSString* faaRulesHash, NSString* nfRulesHash) {
     req->set_rules_hash(NSStringToUTF8String(execRulesHash));
     if constexpr (IsV2) {
       req->set_file_access_rules_hash(NSStringToUTF8String(faaRulesHash));
       req->set_network_flow_rules_hash(NSStringToUTF8String(nfRulesHash));
     }
-  }];
 
-  [rop clientMode:^(SNTClientMode cm) {
     switch (cm) {
       case SNTClientModeMonitor: req->set_client_mode(Traits::MONITOR); break;
       case SNTClientModeLockdown: req->set_client_mode(Traits::LOCKDOWN); break;
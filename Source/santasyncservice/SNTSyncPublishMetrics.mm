@@ -62,11 +62,15 @@ void SetMetricValue(Value* value, id data, SNTMetricType type) {
 void PopulateRequest(PublishMetricsRequest* request, NSDictionary* metrics) {
   for (NSString* metricName in metrics[@"metrics"]) {
     NSDictionary* metric = metrics[@"metrics"][metricName];
+    SNTMetricType type = static_cast<SNTMetricType>([metric[@"type"] integerValue]);
+
+    // The sync protocol has no distribution value, so histograms are only exported through
+    // the metric service.
+    if (type == SNTMetricTypeHistogram) continue;
 
     Metric* protoMetric = request->add_metrics();
     protoMetric->set_path(santa::NSStringToUTF8StringView(metricName));
 
-    SNTMetricType type = static_cast<SNTMetricType>([metric[@"type"] integerValue]);
     protoMetric->set_kind(MetricKindForType(type));
 
     for (NSString* fieldName in metric[@"fields"]) {
@@ -19,4 +19,11 @@
 @class SNTRule;
 
 @interface SNTSyncRuleDownload : SNTSyncStage
+
+///
+///  Once this many execution rules have been downloaded they are sent to santad to be staged,
+///  while the download continues, rather than all at once at the end of the download.
+///
+@property NSUInteger executionRuleBatchSize;
+
 @end
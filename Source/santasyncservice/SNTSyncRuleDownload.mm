@@ -22,6 +22,7 @@
 #import "Source/common/SNTFileAccessRule.h"
 #import "Source/common/SNTNetworkFlowRule.h"
 #import "Source/common/SNTRule.h"
+#import "Source/common/SNTRuleStream.h"
 #import "Source/common/SNTSyncConstants.h"
 #import "Source/common/SNTXPCControlInterface.h"
 #import "Source/common/String.h"
@@ -60,25 +61,121 @@ NSArray* ProcessesFromProtoFAARuleProcesses(
     const google::protobuf::RepeatedPtrField<::pbv2::FileAccessRule::Process>& pbProcesses);
 SNTNetworkFlowRule* NetworkFlowRuleFromProto(const ::pbv2::NetworkFlowRule& nr);
 
+// Execution rules are staged in batches of this size unless the stage is configured otherwise.
+static const NSUInteger kDefaultExecutionRuleBatchSize = 10000;
+// How long to wait for santad to stage or add rules.
+static const int64_t kRuleAddTimeoutSeconds = 300;
+
+// Sends batches of downloaded execution rules to santad to be staged. Only one batch is in
+// flight at a time, so santad writes a batch while the following pages are downloaded and
+// parsed, and syncservice never holds more than a couple of batches.
+@interface SNTExecutionRuleStager : NSObject
+@property(readonly) NSUInteger stagedCount;
+@property(readonly) NSArray<NSError*>* errors;
+- (instancetype)initWithDaemonConnection:(MOLXPCConnection*)daemonConn;
+- (BOOL)stageRules:(NSArray<SNTRule*>*)rules;
+- (BOOL)finish;
+- (void)discard;
+@end
+
+@implementation SNTExecutionRuleStager {
+  MOLXPCConnection* _daemonConn;
+  dispatch_semaphore_t _inFlight;
+  BOOL _failed;
+}
+
+- (instancetype)initWithDaemonConnection:(MOLXPCConnection*)daemonConn {
+  self = [super init];
+  if (self) {
+    _daemonConn = daemonConn;
+    _inFlight = dispatch_semaphore_create(1);
+  }
+  return self;
+}
+
+// Wait for the batch in flight, if any. Returns NO, and leaves the stager unusable, on timeout.
+- (BOOL)acquire {
+  if (_failed) return NO;
+  dispatch_time_t timeout = dispatch_time(DISPATCH_TIME_NOW, kRuleAddTimeoutSeconds * NSEC_PER_SEC);
+  if (dispatch_semaphore_wait(_inFlight, timeout)) {
+    SLOGE(@"Failed to stage rules: timeout sending rules to daemon");
+    _failed = YES;
+    return NO;
+  }
+  return !_failed;
+}
+
+// Send a batch of rules without waiting for santad to stage them. Returns NO if an earlier batch
+// failed to stage.
+- (BOOL)stageRules:(NSArray<SNTRule*>*)rules {
+  if (![self acquire]) return NO;
+
+  // Start from an empty staged set. The reply releases the semaphore acquired above.
+  if (_stagedCount == 0) {
+    [[_daemonConn remoteObjectProxy] databaseRuleDiscardStagedRules:^{
+      dispatch_semaphore_signal(self->_inFlight);
+    }];
+    if (![self acquire]) return NO;
+  }
+
+  _stagedCount += rules.count;
+  [[_daemonConn remoteObjectProxy]
+      databaseRuleStageExecutionRulesFromStream:[SNTRuleStream fileHandleStreamingRules:rules]
+                                         source:SNTRuleAddSourceSyncService
+                                          reply:^(BOOL success, NSArray<NSError*>* errors) {
+                                            if (!success) {
+                                              self->_errors = errors;
+                                              self->_failed = YES;
+                                            }
+                                            dispatch_semaphore_signal(self->_inFlight);
+                                          }];
+  return YES;
+}
+
+// Wait until every batch sent so far has been staged. Returns NO if any failed.
+- (BOOL)finish {
+  if (![self acquire]) return NO;
+  dispatch_semaphore_signal(_inFlight);
+  return YES;
+}
+
+- (void)discard {
+  [[_daemonConn remoteObjectProxy] databaseRuleDiscardStagedRules:^{
+  }];
+}
+
+@end
+
 // Small local object to more easily return the different sets of downloaded rules.
 @interface SNTDownloadedRuleSets : NSObject
+// Execution rules that haven't been sent to santad to be staged.
 @property(readonly) NSArray<SNTRule*>* executionRules;
 @property(readonly) NSArray<SNTFileAccessRule*>* fileAccessRules;
 @property(readonly) NSArray<SNTNetworkFlowRule*>* networkRules;
+// Set if some of the execution rules were sent to santad to be staged during the download.
+@property(readonly) SNTExecutionRuleStager* stager;
+// All downloaded execution rules, including staged ones.
+@property(readonly) NSUInteger executionRuleCount;
 @end
 
 @implementation SNTDownloadedRuleSets
 - (instancetype)initWithExecutionRules:(NSArray<SNTRule*>*)executionRules
                        fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
-                          networkRules:(NSArray<SNTNetworkFlowRule*>*)networkRules {
+                          networkRules:(NSArray<SNTNetworkFlowRule*>*)networkRules
+                                stager:(SNTExecutionRuleStager*)stager {
   self = [super init];
   if (self) {
     _executionRules = executionRules;
     _fileAccessRules = fileAccessRules;
     _networkRules = networkRules;
+    _stager = stager;
   }
   return self;
 }
+
+- (NSUInteger)executionRuleCount {
+  return self.stager.stagedCount + self.executionRules.count;
+}
 @end
 
 SNTRuleCleanup SyncTypeToRuleCleanup(SNTSyncType syncType) {
@@ -91,7 +188,9 @@ SNTRuleCleanup SyncTypeToRuleCleanup(SNTSyncType syncType) {
 }
 
 // Downloads new rules from server and converts them into SNTRule.
-// Returns an array of all converted rules, or nil if there was a server problem.
+// Returns all converted rules, or nil if there was a server problem or a batch of execution
+// rules could not be staged. Once more than executionRuleBatchSize execution rules have been
+// downloaded, they're sent to santad to be staged as the download continues.
 // Note that rules from the server are filtered.
 template <bool IsV2>
 SNTDownloadedRuleSets* DownloadNewRulesFromServer(SNTSyncRuleDownload* self) {
@@ -104,6 +203,7 @@ SNTDownloadedRuleSets* DownloadNewRulesFromServer(SNTSyncRuleDownload* self) {
   NSMutableArray<SNTRule*>* newRules = [NSMutableArray array];
   NSMutableArray<SNTFileAccessRule*>* newFileAccessRules = [NSMutableArray array];
   NSMutableArray<SNTNetworkFlowRule*>* newNetworkRules = [NSMutableArray array];
+  SNTExecutionRuleStager* stager;
   std::string cursor;
 
   do {
@@ -121,6 +221,7 @@ SNTDownloadedRuleSets* DownloadNewRulesFromServer(SNTSyncRuleDownload* self) {
 
       if (err) {
         SLOGE(@"Error downloading rules: %@", err);
+        [stager discard];
         return nil;
       }
 
@@ -154,6 +255,18 @@ SNTDownloadedRuleSets* DownloadNewRulesFromServer(SNTSyncRuleDownload* self) {
         }
       }
 
+      if (newRules.count >= self.executionRuleBatchSize) {
+        if (!stager) {
+          stager = [[SNTExecutionRuleStager alloc] initWithDaemonConnection:self.daemonConn];
+        }
+        if (![stager stageRules:newRules]) {
+          SLOGE(@"Failed to stage rules in daemon");
+          [stager discard];
+          return nil;
+        }
+        newRules = [NSMutableArray array];
+      }
+
       cursor = response.cursor();
       SLOGI(@"Received %lu rules", (unsigned long)response.rules_size());
       self.syncState.rulesReceived += response.rules_size();
@@ -164,13 +277,14 @@ SNTDownloadedRuleSets* DownloadNewRulesFromServer(SNTSyncRuleDownload* self) {
     }
   } while (!cursor.empty());
 
-  self.syncState.rulesProcessed = newRules.count;
+  self.syncState.rulesProcessed = stager.stagedCount + newRules.count;
   self.syncState.fileAccessRulesProcessed = newFileAccessRules.count;
   self.syncState.networkFlowRulesProcessed = newNetworkRules.count;
 
   return [[SNTDownloadedRuleSets alloc] initWithExecutionRules:newRules
                                                fileAccessRules:newFileAccessRules
-                                                  networkRules:newNetworkRules];
+                                                  networkRules:newNetworkRules
+                                                        stager:stager];
 }
 
 NSArray* PathsFromProtoFAARulePaths(
@@ -461,6 +575,14 @@ void ProcessDeprecatedBundleNotificationsForRule(
 
 @implementation SNTSyncRuleDownload
 
+- (instancetype)initWithState:(SNTSyncState*)state {
+  self = [super initWithState:state];
+  if (self) {
+    _executionRuleBatchSize = kDefaultExecutionRuleBatchSize;
+  }
+  return self;
+}
+
 - (NSURL*)stageURL {
   NSString* stageName = [@"ruledownload" stringByAppendingFormat:@"/%@", self.syncState.machineID];
   return [NSURL URLWithString:stageName relativeToURL:self.syncState.syncBaseURL];
@@ -479,8 +601,8 @@ void ProcessDeprecatedBundleNotificationsForRule(
     return NO;
   }
   // If the request was successfully completed, but no new rules received, just return
-  if (!newRules.executionRules.count && !newRules.fileAccessRules.count &&
-      !newRules.networkRules.count) {
+  NSUInteger executionRuleCount = newRules.executionRuleCount;
+  if (!executionRuleCount && !newRules.fileAccessRules.count && !newRules.networkRules.count) {
     return YES;
   }
 
@@ -489,21 +611,46 @@ void ProcessDeprecatedBundleNotificationsForRule(
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
   __block NSArray<NSError*>* errors;
   __block BOOL success;
-  [[self.daemonConn remoteObjectProxy]
-      databaseRuleAddExecutionRules:newRules.executionRules
-                    fileAccessRules:newRules.fileAccessRules
-                   networkFlowRules:newRules.networkRules
-                        ruleCleanup:SyncTypeToRuleCleanup(self.syncState.syncType)
-                             source:SNTRuleAddSourceSyncService
-                              reply:^(BOOL didSucceed, NSArray<NSError*>* e) {
-                                errors = e;
-                                success = didSucceed;
-                                dispatch_semaphore_signal(sema);
-                              }];
-  if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 300 * NSEC_PER_SEC))) {
+  void (^addReply)(BOOL, NSArray<NSError*>*) = ^(BOOL didSucceed, NSArray<NSError*>* e) {
+    errors = e;
+    success = didSucceed;
+    dispatch_semaphore_signal(sema);
+  };
+  NSDate* addStart = [NSDate date];
+  SNTExecutionRuleStager* stager = newRules.stager;
+  if (stager) {
+    // Stage whatever is left and apply the whole staged set
+    if ((newRules.executionRules.count && ![stager stageRules:newRules.executionRules]) ||
+        ![stager finish]) {
+      SLOGE(@"Failed to add rule(s) to database: staging failed");
+      for (NSError* e in stager.errors) {
+        SLOGE(@"\t%@. Reason: %@", e.localizedDescription, e.localizedFailureReason);
+      }
+      [stager discard];
+      return NO;
+    }
+    [[self.daemonConn remoteObjectProxy]
+        databaseRuleAddStagedExecutionRules:stager.stagedCount
+                            fileAccessRules:newRules.fileAccessRules
+                           networkFlowRules:newRules.networkRules
+                                ruleCleanup:SyncTypeToRuleCleanup(self.syncState.syncType)
+                                     source:SNTRuleAddSourceSyncService
+                                      reply:addReply];
+  } else {
+    [[self.daemonConn remoteObjectProxy]
+        databaseRuleAddExecutionRules:newRules.executionRules
+                      fileAccessRules:newRules.fileAccessRules
+                     networkFlowRules:newRules.networkRules
+                          ruleCleanup:SyncTypeToRuleCleanup(self.syncState.syncType)
+                               source:SNTRuleAddSourceSyncService
+                                reply:addReply];
+  }
+  if (dispatch_semaphore_wait(
+          sema, dispatch_time(DISPATCH_TIME_NOW, kRuleAddTimeoutSeconds * NSEC_PER_SEC))) {
     SLOGE(@"Failed to add rule(s) to database: timeout sending rules to daemon");
     return NO;
   }
+  NSTimeInterval addDuration = -[addStart timeIntervalSinceNow];
 
   if (!success) {
     SLOGE(@"Failed to add rule(s) to database:");
@@ -526,8 +673,9 @@ void ProcessDeprecatedBundleNotificationsForRule(
                                                     }];
   dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
 
-  if (newRules.executionRules.count) {
-    SLOGI(@"Processed %lu execution rules", newRules.executionRules.count);
+  if (executionRuleCount) {
+    SLOGI(@"Processed %lu execution rules in %.2fs (%.0f rules/sec)", executionRuleCount,
+          addDuration, executionRuleCount / MAX(addDuration, 0.001));
   }
 
   if (newRules.fileAccessRules.count) {
@@ -540,14 +688,14 @@ void ProcessDeprecatedBundleNotificationsForRule(
 
   // Send out push notifications about any newly allowed binaries
   // that had been previously blocked by santad.
-  [self announceUnblockingRules:newRules.executionRules];
+  [self announceUnblockingRules:executionRuleCount];
   return YES;
 }
 
 // Send out push notifications for allowed bundles/binaries whose rule download was preceded by
 // an associated announcing FCM message.
-- (void)announceUnblockingRules:(NSArray<SNTRule*>*)newRules {
-  if (newRules.count == 0) {
+- (void)announceUnblockingRules:(NSUInteger)newRuleCount {
+  if (newRuleCount == 0) {
     // No new execution rules received
     return;
   }
@@ -19,6 +19,7 @@
 
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/NSData+Zlib.h"
+#import "Source/common/NSData+Zstd.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTError.h"
@@ -29,10 +30,29 @@
 #import "Source/santasyncservice/SNTSyncLogging.h"
 #import "Source/santasyncservice/SNTSyncState.h"
 
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <google/protobuf/json/json.h>
 
 using santa::NSStringToUTF8String;
 
+namespace {
+
+// Feeds serialized bytes to a compressor so that a message is compressed as it is serialized,
+// without holding the serialized message in memory.
+class CompressorOutputStream : public google::protobuf::io::CopyingOutputStream {
+ public:
+  explicit CompressorOutputStream(SNTZlibCompressor* compressor) : compressor_(compressor) {}
+
+  bool Write(const void* buffer, int size) override {
+    return [compressor_ appendBytes:buffer length:(NSUInteger)size];
+  }
+
+ private:
+  SNTZlibCompressor* compressor_;
+};
+
+}  // namespace
+
 @interface SNTSyncStage ()
 
 @property(readwrite) NSURLSession* urlSession;
@@ -68,6 +88,9 @@ using santa::NSStringToUTF8String;
 
 #ifndef SANTA_STORE_SYNC_JSON
   if ([[SNTConfigurator configurator] syncEnableProtoTransfer]) {
+    NSMutableURLRequest* req = [self zlibRequestWithMessage:message];
+    if (req) return req;
+
     std::string data;
     if (!message->SerializeToString(&data)) {
       SLOGE(@"Failed to serialize protobuf");
@@ -99,7 +122,33 @@ using santa::NSStringToUTF8String;
   return [self requestWithData:data contentType:@"application/json"];
 }
 
-- (NSMutableURLRequest*)requestWithData:(NSData*)requestBody contentType:(NSString*)contentType {
+// Serializes a protobuf request straight into a deflate or gzip compressor. Returns nil if the
+// request isn't compressed with either, or compressing failed.
+- (NSMutableURLRequest*)zlibRequestWithMessage:(google::protobuf::Message*)message {
+  NSMutableURLRequest* req = [self requestWithContentType:@"application/x-protobuf"];
+  SNTSyncContentEncoding contentEncoding = [self contentEncodingForRequest:req];
+  if (contentEncoding != SNTSyncContentEncodingDeflate &&
+      contentEncoding != SNTSyncContentEncodingGzip) {
+    return nil;
+  }
+
+  BOOL gzip = (contentEncoding == SNTSyncContentEncodingGzip);
+  SNTZlibCompressor* compressor = [[SNTZlibCompressor alloc] initWithGzipHeader:gzip];
+  if (!compressor) return nil;
+
+  CompressorOutputStream compressorStream(compressor);
+  google::protobuf::io::CopyingOutputStreamAdaptor output(&compressorStream);
+  if (!message->SerializeToZeroCopyStream(&output) || !output.Flush()) return nil;
+
+  NSData* compressed = [compressor finish];
+  if (!compressed) return nil;
+
+  [req setValue:(gzip ? @"gzip" : @"deflate") forHTTPHeaderField:@"Content-Encoding"];
+  [req setHTTPBody:compressed];
+  return req;
+}
+
+- (NSMutableURLRequest*)requestWithContentType:(NSString*)contentType {
   if (!contentType.length) contentType = @"application/octet-stream";
 
   NSMutableURLRequest* req = [[NSMutableURLRequest alloc] initWithURL:[self stageURL]];
@@ -107,12 +156,35 @@ using santa::NSStringToUTF8String;
   [req setValue:contentType forHTTPHeaderField:@"Content-Type"];
   NSString* xsrfHeader = self.syncState.xsrfTokenHeader ?: kDefaultXSRFTokenHeader;
   [req setValue:self.syncState.xsrfToken forHTTPHeaderField:xsrfHeader];
+  return req;
+}
+
+// Sets the Accept-Encoding of `req` and returns the encoding its body should be compressed with.
+- (SNTSyncContentEncoding)contentEncodingForRequest:(NSMutableURLRequest*)req {
+  SNTSyncContentEncoding contentEncoding = self.syncState.contentEncoding;
+  if (contentEncoding == SNTSyncContentEncodingZstd) {
+    // Let the server compress responses with zstd too. NSURLSession decodes the others itself.
+    [req setValue:@"zstd, gzip, deflate" forHTTPHeaderField:@"Accept-Encoding"];
+
+    // Until the server says it can decode zstd, fall back to the default encoding.
+    if (!self.syncState.serverAcceptsZstd) contentEncoding = SNTSyncContentEncodingDeflate;
+  }
+  return contentEncoding;
+}
+
+- (NSMutableURLRequest*)requestWithData:(NSData*)requestBody contentType:(NSString*)contentType {
+  NSMutableURLRequest* req = [self requestWithContentType:contentType];
 
   NSData* compressed;
   NSString* contentEncodingHeader;
 
-  switch (self.syncState.contentEncoding) {
+  SNTSyncContentEncoding contentEncoding = [self contentEncodingForRequest:req];
+  switch (contentEncoding) {
     case SNTSyncContentEncodingNone: break;
+    case SNTSyncContentEncodingZstd:
+      compressed = [requestBody zstdCompressed];
+      contentEncodingHeader = @"zstd";
+      break;
     case SNTSyncContentEncodingGzip:
       compressed = [requestBody gzipCompressed];
       contentEncodingHeader = @"gzip";
@@ -194,6 +266,29 @@ using santa::NSStringToUTF8String;
     [SNTError populateError:error withCode:SNTErrorCodeFailedToHTTP format:@"%@", errStr ?: @""];
     return nil;
   }
+
+  if (self.syncState.contentEncoding == SNTSyncContentEncodingZstd) {
+    if (!self.syncState.serverAcceptsZstd &&
+        [self header:@"Accept-Encoding" ofResponse:response containsToken:@"zstd"]) {
+      SLOGD(@"Server accepts zstd, compressing requests with zstd");
+      self.syncState.serverAcceptsZstd = YES;
+    }
+
+    // Newer systems may have already decoded the body, in which case it won't start with a
+    // zstd frame.
+    if ([self header:@"Content-Encoding" ofResponse:response containsToken:@"zstd"] &&
+        [data hasZstdFrameHeader]) {
+      data = [data zstdDecompressed];
+      if (!data) {
+        SLOGE(@"Failed to decompress zstd response");
+        [SNTError populateError:error
+                       withCode:SNTErrorCodeFailedToHTTP
+                         format:@"Failed to decompress zstd response"];
+        return nil;
+      }
+    }
+  }
+
   return data;
 }
 
@@ -282,6 +377,20 @@ using santa::NSStringToUTF8String;
   return _data;
 }
 
+- (BOOL)header:(NSString*)header
+       ofResponse:(NSHTTPURLResponse*)response
+    containsToken:(NSString*)token {
+  NSString* value = [response valueForHTTPHeaderField:header];
+  for (NSString* item in [value componentsSeparatedByString:@","]) {
+    // Ignore any parameters, e.g. "zstd;q=0.5"
+    NSString* coding = [[item componentsSeparatedByString:@";"] firstObject];
+    NSString* trimmed =
+        [coding stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    if ([trimmed caseInsensitiveCompare:token] == NSOrderedSame) return YES;
+  }
+  return NO;
+}
+
 - (NSData*)stripXssi:(NSData*)data {
   static const char xssiOne[5] = {')', ']', '}', '\'', '\n'};
   static const char xssiTwo[3] = {']', ')', '}'};
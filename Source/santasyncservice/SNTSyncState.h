@@ -110,6 +110,10 @@
 /// The content-encoding to use for the client uploads during the sync session.
 @property SNTSyncContentEncoding contentEncoding;
 
+/// Whether the server has advertised that it accepts zstd compressed requests, set from the
+/// Accept-Encoding header of its responses.
+@property BOOL serverAcceptsZstd;
+
 /// Counts of execution and file access rules received and processed during rule download.
 @property NSUInteger rulesReceived;
 @property NSUInteger rulesProcessed;
@@ -18,10 +18,12 @@
 #import <XCTest/XCTest.h>
 
 #import "Source/common/MOLXPCConnection.h"
+#import "Source/common/NSData+Zstd.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTModeTransition.h"
 #import "Source/common/SNTRule.h"
+#import "Source/common/SNTRuleStream.h"
 #import "Source/common/SNTSIPStatus.h"
 #import "Source/common/SNTStoredEvent.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
@@ -204,14 +206,51 @@
   return [NSData dataWithContentsOfFile:path];
 }
 
+/**
+  Stub the daemon's paginated event retrieval to page through the given events in ID order.
+
+  @param events The events pending upload.
+*/
+- (void)stubPendingEvents:(NSArray<SNTStoredEvent*>*)events {
+  NSArray<SNTStoredEvent*>* sorted =
+      [events sortedArrayUsingComparator:^NSComparisonResult(SNTStoredEvent* a, SNTStoredEvent* b) {
+        return [a.idx compare:b.idx];
+      }];
+  OCMStub([self.daemonConnRop databaseEventsPendingAfterIndex:[OCMArg any]
+                                                         limit:0
+                                                         reply:[OCMArg any]])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* inv) {
+        NSNumber* __unsafe_unretained cursor = nil;
+        NSUInteger limit = 0;
+        void (^__unsafe_unretained replyBlock)(NSArray<SNTStoredEvent*>*) = nil;
+        [inv getArgument:&cursor atIndex:2];
+        [inv getArgument:&limit atIndex:3];
+        [inv getArgument:&replyBlock atIndex:4];
+
+        NSMutableArray<SNTStoredEvent*>* page = [NSMutableArray array];
+        for (SNTStoredEvent* event in sorted) {
+          if (page.count == limit) break;
+          if (!cursor || [event.idx compare:cursor] == NSOrderedDescending) {
+            [page addObject:event];
+          }
+        }
+        replyBlock(page);
+      });
+}
+
+- (void)stubPreflightInfoWithRuleCounts:(struct RuleCounts)ruleCounts {
+  OCMStub([self.daemonConnRop
+      preflightInfo:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(ruleCounts),
+                                                 OCMOCK_VALUE(SNTClientModeMonitor), @"the-hash",
+                                                 @"the-faa-hash", @"the-nf-hash", nil])]);
+}
+
 - (void)setupDefaultDaemonConnResponses {
   struct RuleCounts ruleCounts = {};
-  OCMStub([self.daemonConnRop
-      databaseRuleCounts:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(ruleCounts), nil])]);
+  [self stubPreflightInfoWithRuleCounts:ruleCounts];
   OCMStub([self.daemonConnRop
       syncTypeRequired:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(SNTSyncTypeNormal), nil])]);
-  OCMStub([self.daemonConnRop
-      clientMode:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(SNTClientModeMonitor), nil])]);
   OCMStub([self.daemonConnRop
       databaseRulesHash:([OCMArg invokeBlockWithArgs:@"the-hash", @"the-faa-hash", @"the-nf-hash",
                                                      nil])]);
@@ -370,6 +409,45 @@
   XCTAssertNil(self.syncState.overrideFileAccessAction);
 }
 
+- (void)testPreflightNegotiatesZstd {
+  [self setupDefaultDaemonConnResponses];
+  self.syncState.contentEncoding = SNTSyncContentEncodingZstd;
+  SNTSyncPreflight* sut = [[SNTSyncPreflight alloc] initWithState:self.syncState];
+
+  NSData* respData = [[self dataFromFixture:@"sync_preflight_basic.json"] zstdCompressed];
+  NSHTTPURLResponse* resp = [self responseWithCode:200
+                                        headerDict:@{
+                                          @"Content-Encoding" : @"zstd",
+                                          @"Accept-Encoding" : @"gzip, zstd",
+                                        }];
+  NSMutableArray<NSURLRequest*>* requests = [NSMutableArray array];
+  [self stubRequestBody:respData
+               response:resp
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            [requests addObject:req];
+            return YES;
+          }];
+
+  // The first request doesn't know yet that the server accepts zstd
+  XCTAssertTrue([sut sync]);
+  XCTAssertTrue(self.syncState.serverAcceptsZstd);
+  XCTAssertEqual(self.syncState.eventBatchSize, 100);
+
+  XCTAssertTrue([sut sync]);
+  XCTAssertEqual(requests.count, 2);
+  XCTAssertEqualObjects([requests[0] valueForHTTPHeaderField:@"Accept-Encoding"],
+                        @"zstd, gzip, deflate");
+  XCTAssertNotEqualObjects([requests[0] valueForHTTPHeaderField:@"Content-Encoding"], @"zstd");
+
+  XCTAssertEqualObjects([requests[1] valueForHTTPHeaderField:@"Content-Encoding"], @"zstd");
+  NSDictionary* gotReq = [NSJSONSerialization
+      JSONObjectWithData:[requests[1].HTTPBody zstdDecompressed]
+                 options:0
+                   error:NULL];
+  XCTAssertEqualObjects(gotReq[@"machine_id"], self.syncState.machineID);
+}
+
 - (void)testPreflightTurnOnBlockUSBMount {
   [self setupDefaultDaemonConnResponses];
   SNTSyncPreflight* sut = [[SNTSyncPreflight alloc] initWithState:self.syncState];
@@ -555,8 +633,7 @@
       .networkFlow = 77,
   };
 
-  OCMStub([self.daemonConnRop
-      databaseRuleCounts:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(ruleCounts), nil])]);
+  [self stubPreflightInfoWithRuleCounts:ruleCounts];
 
   [self stubRequestBody:nil
                response:nil
@@ -615,10 +692,7 @@
   SNTSyncPreflight* sut = [[SNTSyncPreflight alloc] initWithState:self.syncState];
 
   struct RuleCounts ruleCounts = {};
-  OCMStub([self.daemonConnRop
-      databaseRuleCounts:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(ruleCounts), nil])]);
-  OCMStub([self.daemonConnRop
-      clientMode:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(SNTClientModeMonitor), nil])]);
+  [self stubPreflightInfoWithRuleCounts:ruleCounts];
   OCMStub([self.daemonConnRop
       syncTypeRequired:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(requestedSyncType), nil])]);
 
@@ -872,7 +946,7 @@
   XCTAssertNil(err);
   XCTAssertEqual(events.count, 7);
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
@@ -1000,7 +1074,7 @@
                                                            error:&err];
   XCTAssertNil(err);
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
@@ -1032,6 +1106,8 @@
 - (void)testEventUploadBatching {
   SNTSyncEventUpload* sut = [[SNTSyncEventUpload alloc] initWithState:self.syncState];
   self.syncState.eventBatchSize = 1;
+  // Upload one batch at a time so the request count below isn't updated concurrently
+  sut.maxBatchesInFlight = 1;
   sut = OCMPartialMock(sut);
 
   NSSet* allowedClasses = [NSSet setWithObjects:[NSArray class], [SNTStoredEvent class], nil];
@@ -1044,7 +1120,7 @@
                                                            error:&err];
   XCTAssertNil(err);
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   __block int requestCount = 0;
 
@@ -1071,6 +1147,74 @@
   }
 }
 
+- (void)testEventUploadConcurrentBatches {
+  SNTSyncEventUpload* sut = [[SNTSyncEventUpload alloc] initWithState:self.syncState];
+  self.syncState.eventBatchSize = 1;
+  sut.maxBatchesInFlight = 4;
+
+  NSSet* allowedClasses = [NSSet setWithObjects:[NSArray class], [SNTStoredEvent class], nil];
+  NSData* eventData = [self dataFromFixture:@"sync_eventupload_input_basic.plist"];
+  NSArray* events = [NSKeyedUnarchiver unarchivedObjectOfClasses:allowedClasses
+                                                        fromData:eventData
+                                                           error:NULL];
+  [self stubPendingEvents:events];
+
+  NSMutableArray* removedIds = [NSMutableArray array];
+  OCMStub([self.daemonConnRop databaseRemoveEventsWithIDs:[OCMArg any]])
+      .andDo(^(NSInvocation* inv) {
+        NSArray* __unsafe_unretained ids = nil;
+        [inv getArgument:&ids atIndex:2];
+        @synchronized(removedIds) {
+          [removedIds addObjectsFromArray:ids];
+        }
+      });
+
+  __block int requestCount = 0;
+  [self stubRequestBody:nil
+               response:nil
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            @synchronized(removedIds) {
+              requestCount++;
+            }
+            return YES;
+          }];
+
+  XCTAssertTrue([sut sync]);
+
+  // Every batch was sent and every event removed once its batch was acknowledged
+  XCTAssertEqual(requestCount, self.syncState.isSyncV2 ? 7 : 3);
+  NSMutableSet* wantIds = [NSMutableSet set];
+  for (SNTStoredEvent* event in events) {
+    if (event.idx) [wantIds addObject:event.idx];
+  }
+  XCTAssertEqualObjects([NSSet setWithArray:removedIds], wantIds);
+}
+
+- (void)testEventUploadStopsAfterFailedBatch {
+  SNTSyncEventUpload* sut = [[SNTSyncEventUpload alloc] initWithState:self.syncState];
+  self.syncState.eventBatchSize = 1;
+
+  NSSet* allowedClasses = [NSSet setWithObjects:[NSArray class], [SNTStoredEvent class], nil];
+  NSData* eventData = [self dataFromFixture:@"sync_eventupload_input_basic.plist"];
+  NSArray* events = [NSKeyedUnarchiver unarchivedObjectOfClasses:allowedClasses
+                                                        fromData:eventData
+                                                           error:NULL];
+
+  __block int requestCount = 0;
+  [self stubRequestBody:nil
+               response:[self responseWithCode:400 headerDict:nil]
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            requestCount++;
+            return YES;
+          }];
+
+  // Only one batch is sent until the server has responded, after it fails no more are sent
+  XCTAssertFalse([sut uploadEvents:events]);
+  XCTAssertEqual(requestCount, 1);
+}
+
 #pragma mark - SNTSyncRuleDownload Tests
 
 - (void)testRuleDownload {
@@ -1151,6 +1295,70 @@
   OCMVerify([self.daemonConnRop postRuleSyncNotificationForApplication:@"yes" reply:OCMOCK_ANY]);
 }
 
+- (void)testRuleDownloadStagesLargeDownloads {
+  SNTSyncRuleDownload* sut = [[SNTSyncRuleDownload alloc] initWithState:self.syncState];
+  sut.executionRuleBatchSize = 2;
+
+  NSData* respData = [self dataFromFixture:@"sync_ruledownload_batch1.json"];
+  [self stubRequestBody:respData
+               response:nil
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            return [self dictFromRequest:req][@"cursor"] == nil;
+          }];
+
+  respData = [self dataFromFixture:@"sync_ruledownload_batch2.json"];
+  [self stubRequestBody:respData
+               response:nil
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            return [self dictFromRequest:req][@"cursor"] != nil;
+          }];
+
+  __block NSUInteger stagedCount = 0;
+  OCMStub([self.daemonConnRop databaseRuleDiscardStagedRules:([OCMArg invokeBlock])]);
+  OCMStub([self.daemonConnRop
+              databaseRuleStageExecutionRulesFromStream:OCMOCK_ANY
+                                                 source:SNTRuleAddSourceSyncService
+                                                  reply:([OCMArg
+                                                            invokeBlockWithArgs:OCMOCK_VALUE(YES),
+                                                                                [NSNull null],
+                                                                                nil])])
+      .andDo(^(NSInvocation* invocation) {
+        __unsafe_unretained NSFileHandle* stream;
+        [invocation getArgument:&stream atIndex:2];
+        stagedCount += [SNTRuleStream readRulesFromFileHandle:stream error:NULL].count;
+      });
+  OCMStub([self.daemonConnRop
+      databaseRuleAddStagedExecutionRules:5
+                          fileAccessRules:OCMOCK_ANY
+                         networkFlowRules:OCMOCK_ANY
+                              ruleCleanup:SNTRuleCleanupNone
+                                   source:SNTRuleAddSourceSyncService
+                                    reply:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(YES),
+                                                                       [NSNull null], nil])]);
+  OCMReject([self.daemonConnRop databaseRuleAddExecutionRules:OCMOCK_ANY
+                                              fileAccessRules:OCMOCK_ANY
+                                             networkFlowRules:OCMOCK_ANY
+                                                  ruleCleanup:SNTRuleCleanupNone
+                                                       source:SNTRuleAddSourceSyncService
+                                                        reply:OCMOCK_ANY]);
+  OCMStub([self.daemonConnRop postRuleSyncNotificationForApplication:[OCMArg any]
+                                                               reply:([OCMArg invokeBlock])]);
+
+  XCTAssertTrue([sut sync]);
+
+  // Every rule was staged before the staged set was added
+  XCTAssertEqual(stagedCount, 5);
+  OCMVerify([self.daemonConnRop databaseRuleAddStagedExecutionRules:5
+                                                    fileAccessRules:OCMOCK_ANY
+                                                   networkFlowRules:OCMOCK_ANY
+                                                        ruleCleanup:SNTRuleCleanupNone
+                                                             source:SNTRuleAddSourceSyncService
+                                                              reply:OCMOCK_ANY]);
+  XCTAssertEqual(self.syncState.rulesProcessed, 5);
+}
+
 - (void)testRuleDownloadCel {
   SNTSyncRuleDownload* sut = [[SNTSyncRuleDownload alloc] initWithState:self.syncState];
 
@@ -1614,7 +1822,7 @@
   faaEvent.process = proc;
 
   NSArray* events = @[ execEvent, faaEvent ];
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
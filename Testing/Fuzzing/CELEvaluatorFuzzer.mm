@@ -0,0 +1,90 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+// Fuzz target: compile arbitrary input as a CEL expression with both the
+// v1 and v2 evaluators and evaluate anything that compiles. Oracle: ASan.
+// The seed corpus doubles as the expression corpus for
+// //Testing/OneOffs:cel_bench.
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Source/common/cel/Activation.h"
+#include "Source/common/cel/CELProtoTraits.h"
+#include "Source/common/cel/Evaluator.h"
+#include "absl/strings/string_view.h"
+
+using santa::cel::Activation;
+using santa::cel::CELProtoTraits;
+using santa::cel::Evaluator;
+
+namespace {
+
+template <bool IsV2>
+void CompileAndEvaluate(absl::string_view expr) {
+  using Traits = CELProtoTraits<IsV2>;
+  static Evaluator<IsV2>* evaluator = Evaluator<IsV2>::Create().value().release();
+
+  google::protobuf::Arena arena;
+  auto plan = evaluator->Compile(expr, &arena);
+  if (!plan.ok()) {
+    return;
+  }
+
+  Activation<IsV2> activation(
+      ^std::unique_ptr<typename Traits::ExecutableFileT>() {
+        auto f = std::make_unique<typename Traits::ExecutableFileT>();
+        f->set_signing_id("EQHXZ8M8AV:com.google.Chrome");
+        f->set_team_id("EQHXZ8M8AV");
+        f->mutable_signing_time()->set_seconds(1748436989);
+        return f;
+      },
+      ^std::vector<std::string>() {
+        return {"/usr/local/bin/node", "--inspect", "index.js"};
+      },
+      ^std::map<std::string, std::string>() {
+        return {{"HOME", "/Users/user"}, {"DYLD_INSERT_LIBRARIES", "/tmp/x.dylib"}};
+      },
+      ^uid_t() {
+        return 0;
+      },
+      ^std::string() {
+        return "/Users/user";
+      },
+      ^std::string() {
+        return "/usr/local/bin/node";
+      },
+      ^std::vector<typename Traits::AncestorT>() {
+        return {};
+      },
+      ^std::vector<typename Traits::FileDescriptorT>() {
+        return {};
+      });
+
+  // Errors are expected for most inputs, only memory safety is checked
+  (void)evaluator->Evaluate(plan->get(), activation, &arena);
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  absl::string_view expr(reinterpret_cast<const char*>(data), size);
+  CompileAndEvaluate<false>(expr);
+  CompileAndEvaluate<true>(expr);
+  return 0;
+}
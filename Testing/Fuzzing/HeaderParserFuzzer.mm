@@ -14,7 +14,7 @@
 
 // Fuzz target: drive HeaderParser::Update() over chunk-arbitrary
 // inputs. Oracle: ASan (memory safety, OOB on malformed fat tables /
-// load commands).
+// load commands), plus PerfBudget under --config=fuzz-perf.
 #include <mach/machine.h>
 
 #include <algorithm>
@@ -22,9 +22,12 @@
 #include <cstdint>
 
 #include "Source/common/verifyinghasher/HeaderParser.h"
+#include "Testing/Fuzzing/PerfBudget.h"
 
 using santa::ArchSelector;
 using santa::HeaderParser;
+using santa::fuzzing::PerfBudget;
+using santa::fuzzing::PerfLimits;
 
 namespace {
 #if defined(__arm64__) || defined(__aarch64__)
@@ -39,9 +42,21 @@ constexpr ArchSelector kArch = {CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL};
 // large enough to make progress without driving libFuzzer iteration
 // counts into the noise floor.
 constexpr size_t kChunkSize = 256;
+
+// HeaderParser only buffers the load commands, which are capped at
+// kMaxSizeOfCmds (1 MiB), and the fat arch table, capped at kMaxFatArchs,
+// so allocations don't grow with the input. Work is a single pass over the
+// header bytes.
+constexpr PerfLimits kLimits = {
+    .base_ns = 10'000'000,  // 10 ms
+    .ns_per_byte = 100,
+    .base_alloc_bytes = 2u << 20,  // 2 * kMaxSizeOfCmds
+    .alloc_bytes_per_byte = 0,
+};
 }  // namespace
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  PerfBudget budget("HeaderParserFuzzer", data, size, kLimits);
   HeaderParser hp(kArch, static_cast<uint64_t>(size));
   // off matches `size`'s type (size_t) so the loop arithmetic is free
   // of mixed-width casts. The static_cast at the Update call site is
@@ -28,13 +28,28 @@
 // Apple code rather than ours. In practice a mutated blob almost never
 // forms a valid CMS, so the decoder bails early and trustd is rarely
 // reached; the 16 MiB kMaxCsBlobSize cap in ParseBytes bounds work.
+// Under --config=fuzz-perf PerfBudget checks that bound per input.
 #include <cstddef>
 #include <cstdint>
 #include <span>
 
 #include "Source/common/verifyinghasher/KernelCsBlob.h"
+#include "Testing/Fuzzing/PerfBudget.h"
+
+namespace {
+// The BlobIndex walk is linear in the blob and slot payloads are copied at
+// most once each. CMSDecoder dominates the fixed cost, so the base bounds
+// are generous.
+constexpr santa::fuzzing::PerfLimits kLimits = {
+    .base_ns = 250'000'000,  // 250 ms
+    .ns_per_byte = 1'000,
+    .base_alloc_bytes = 4u << 20,
+    .alloc_bytes_per_byte = 8,
+};
+}  // namespace
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  santa::fuzzing::PerfBudget budget("KernelCsBlobFuzzer", data, size, kLimits);
   santa::KernelCsBlob::ParseBytes(std::span<const uint8_t>(data, size),
                                   /*cd_bytes=*/{});
   return 0;
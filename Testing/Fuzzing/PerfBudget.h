@@ -0,0 +1,177 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+// Per-input performance oracle for the fuzz targets. When built with
+// --config=fuzz-perf (which defines SANTA_FUZZ_PERF), a PerfBudget scoped
+// around the code under test measures its wall time and the total bytes it
+// allocates. An input that exceeds either bound is copied into the slow
+// corpus and the process aborts, so libFuzzer also records it as a crash
+// artifact. Without SANTA_FUZZ_PERF the guard compiles to nothing and the
+// regular fuzz configuration is unaffected.
+//
+// Runtime knobs (environment):
+//   SANTA_FUZZ_SLOW_CORPUS  Directory for slow inputs. Defaults to
+//                           /tmp/fuzzing/slow_corpus/<target>.
+//   SANTA_FUZZ_PERF_SCALE   Multiplier applied to the time bound, for slow
+//                           or heavily loaded hosts. Defaults to 1.
+
+#ifndef SANTA_TESTING_FUZZING_PERFBUDGET_H
+#define SANTA_TESTING_FUZZING_PERFBUDGET_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef SANTA_FUZZ_PERF
+#include <sanitizer/allocator_interface.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#endif
+
+namespace santa::fuzzing {
+
+// Bounds for a single input. Both scale linearly with the input size since
+// every parser under test is documented to do at most linear work in the
+// bytes it is given, within its fixed caps.
+struct PerfLimits {
+  uint64_t base_ns;
+  uint64_t ns_per_byte;
+  uint64_t base_alloc_bytes;
+  uint64_t alloc_bytes_per_byte;
+};
+
+#ifdef SANTA_FUZZ_PERF
+
+namespace internal {
+
+inline std::atomic<bool> g_tracking{false};
+inline std::atomic<uint64_t> g_allocated{0};
+
+inline void MallocHook(const volatile void*, size_t size) {
+  if (g_tracking.load(std::memory_order_relaxed)) {
+    g_allocated.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
+inline void FreeHook(const volatile void*) {}
+
+inline void InstallHooksOnce() {
+  static bool installed = (__sanitizer_install_malloc_and_free_hooks(MallocHook, FreeHook), true);
+  (void)installed;
+}
+
+inline double TimeScale() {
+  static double scale = [] {
+    const char* env = getenv("SANTA_FUZZ_PERF_SCALE");
+    double v = env ? strtod(env, nullptr) : 0;
+    return v > 0 ? v : 1.0;
+  }();
+  return scale;
+}
+
+inline void SaveSlowInput(const char* target, const uint8_t* data, size_t size) {
+  std::string dir;
+  if (const char* env = getenv("SANTA_FUZZ_SLOW_CORPUS")) {
+    dir = env;
+  } else {
+    mkdir("/tmp/fuzzing", 0755);
+    mkdir("/tmp/fuzzing/slow_corpus", 0755);
+    dir = std::string("/tmp/fuzzing/slow_corpus/") + target;
+  }
+  mkdir(dir.c_str(), 0755);
+
+  // FNV-1a keeps names stable across runs so re-finding an input overwrites
+  // the earlier copy instead of piling up duplicates.
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 0x100000001b3ull;
+  }
+
+  char name[32];
+  snprintf(name, sizeof(name), "/slow-%016llx", (unsigned long long)hash);
+  std::string path = dir + name;
+  if (FILE* f = fopen(path.c_str(), "wb")) {
+    fwrite(data, 1, size, f);
+    fclose(f);
+    fprintf(stderr, "PerfBudget: saved slow input to %s\n", path.c_str());
+  }
+}
+
+}  // namespace internal
+
+class PerfBudget {
+ public:
+  PerfBudget(const char* target, const uint8_t* data, size_t size, const PerfLimits& limits)
+      : target_(target),
+        data_(data),
+        size_(size),
+        max_ns_((uint64_t)((limits.base_ns + limits.ns_per_byte * size) * internal::TimeScale())),
+        max_alloc_bytes_(limits.base_alloc_bytes + limits.alloc_bytes_per_byte * size) {
+    internal::InstallHooksOnce();
+    internal::g_allocated.store(0, std::memory_order_relaxed);
+    internal::g_tracking.store(true, std::memory_order_relaxed);
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  ~PerfBudget() {
+    uint64_t elapsed_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start_)
+                              .count();
+    internal::g_tracking.store(false, std::memory_order_relaxed);
+    uint64_t allocated = internal::g_allocated.load(std::memory_order_relaxed);
+
+    if (elapsed_ns <= max_ns_ && allocated <= max_alloc_bytes_) {
+      return;
+    }
+
+    fprintf(stderr,
+            "PerfBudget: %s exceeded its budget on a %zu byte input: %llu ns (limit %llu), "
+            "%llu bytes allocated (limit %llu)\n",
+            target_, size_, (unsigned long long)elapsed_ns, (unsigned long long)max_ns_,
+            (unsigned long long)allocated, (unsigned long long)max_alloc_bytes_);
+    internal::SaveSlowInput(target_, data_, size_);
+    abort();
+  }
+
+  PerfBudget(const PerfBudget&) = delete;
+  PerfBudget& operator=(const PerfBudget&) = delete;
+
+ private:
+  const char* target_;
+  const uint8_t* data_;
+  size_t size_;
+  uint64_t max_ns_;
+  uint64_t max_alloc_bytes_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#else
+
+class PerfBudget {
+ public:
+  PerfBudget(const char*, const uint8_t*, size_t, const PerfLimits&) {}
+  PerfBudget(const PerfBudget&) = delete;
+  PerfBudget& operator=(const PerfBudget&) = delete;
+};
+
+#endif  // SANTA_FUZZ_PERF
+
+}  // namespace santa::fuzzing
+
+#endif  // SANTA_TESTING_FUZZING_PERFBUDGET_H
@@ -18,6 +18,7 @@
 //   2. libFuzzer's default timeout (hangs)
 //   3. CountingMemoryFileReader::MaxReadsAnyByte() <= 1
 //      (the single-observation invariant)
+//   4. PerfBudget under --config=fuzz-perf (time and allocation volume)
 #include <mach/machine.h>
 
 #include <cstdint>
@@ -26,10 +27,13 @@
 
 #include "Source/common/verifyinghasher/CountingMemoryFileReader.h"
 #include "Source/common/verifyinghasher/VerifyingHasherCore.h"
+#include "Testing/Fuzzing/PerfBudget.h"
 
 using santa::ArchSelector;
 using santa::CountingMemoryFileReader;
 using santa::VerifyingHasherCore;
+using santa::fuzzing::PerfBudget;
+using santa::fuzzing::PerfLimits;
 
 namespace {
 #if defined(__arm64__) || defined(__aarch64__)
@@ -39,11 +43,23 @@ constexpr ArchSelector kArch = {CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL};
 #else
 #error "Unsupported host architecture"
 #endif
+
+// Run() allocates one buf_size (1 MiB) read chunk, the header phase buffer
+// (bounded by kMaxSizeOfCmds) and a CS blob buffer no larger than the file.
+// Hashing is a single pass, so time is linear in the input.
+constexpr PerfLimits kLimits = {
+    .base_ns = 50'000'000,  // 50 ms
+    .ns_per_byte = 1'000,
+    .base_alloc_bytes = 4u << 20,
+    .alloc_bytes_per_byte = 4,
+};
 }  // namespace
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   std::vector<uint8_t> bytes(data, data + size);
   CountingMemoryFileReader reader(std::move(bytes));
+  // Started after the copy above so only the hasher's own work is counted
+  PerfBudget budget("VerifyingHasherFuzzer", data, size, kLimits);
   VerifyingHasherCore v(reader, kArch);
   // Status is not an oracle; any return value (kOk, kPagesMismatched,
   // kMalformedSignature, kIoError, ...) is acceptable. The oracle is
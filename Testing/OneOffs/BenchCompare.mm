@@ -0,0 +1,243 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+/*
+
+Compare two google-benchmark JSON result files and report the change of each
+benchmark, failing if any got slower by more than the noise allows. Used by
+the perf_regression_gate target, which runs micro_bench against the baseline
+checked in next to this file:
+
+  bazel test //Testing/OneOffs:perf_regression_gate --test_output=streamed
+
+Results are most useful when each benchmark is repeated, e.g. with
+--benchmark_repetitions=5, so that the median is compared and the coefficient
+of variation can be used to tell regressions from noise. A benchmark only
+counts as a regression when its change exceeds both -t and -k times the
+larger of the two runs' coefficients of variation.
+
+Options:
+  -b  Baseline results (required)
+  -c  Current results (required)
+  -t  Minimum change in percent reported as a regression (default 10)
+  -k  Multiple of the coefficient of variation a change must exceed to be
+      reported as a regression (default 3)
+
+Exits 2 if there were regressions, 1 on errors.
+
+*/
+
+#import <Foundation/Foundation.h>
+
+#include <getopt.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+struct Config {
+  std::string baseline;
+  std::string current;
+  double thresholdPercent = 10;
+  double noiseMultiplier = 3;
+};
+
+// Summary of every run of one benchmark
+struct Stats {
+  double medianNanos = 0;
+  // Coefficient of variation, stddev / mean, or 0 if the benchmark ran once
+  double cv = 0;
+};
+
+static double ToNanos(double value, NSString* unit) {
+  if ([unit isEqualToString:@"us"]) return value * 1e3;
+  if ([unit isEqualToString:@"ms"]) return value * 1e6;
+  if ([unit isEqualToString:@"s"]) return value * 1e9;
+  return value;
+}
+
+static double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  size_t mid = values.size() / 2;
+  return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+static double CoefficientOfVariation(const std::vector<double>& values) {
+  if (values.size() < 2) return 0;
+  double mean = 0;
+  for (double v : values) mean += v;
+  mean /= values.size();
+  if (mean == 0) return 0;
+
+  double variance = 0;
+  for (double v : values) variance += (v - mean) * (v - mean);
+  variance /= (values.size() - 1);
+  return std::sqrt(variance) / mean;
+}
+
+// Results may contain individual repetitions, aggregates or both. Aggregates
+// computed by google-benchmark are used when present.
+static bool LoadResults(const std::string& path, std::map<std::string, Stats>* results) {
+  NSData* data = [NSData dataWithContentsOfFile:@(path.c_str())];
+  if (!data) {
+    std::cerr << "Error: Failed to read " << path << std::endl;
+    return false;
+  }
+
+  NSError* err;
+  NSDictionary* json = [NSJSONSerialization JSONObjectWithData:data options:0 error:&err];
+  if (![json isKindOfClass:[NSDictionary class]] ||
+      ![json[@"benchmarks"] isKindOfClass:[NSArray class]]) {
+    std::cerr << "Error: " << path << " is not google-benchmark JSON output" << std::endl;
+    return false;
+  }
+
+  std::map<std::string, std::vector<double>> samples;
+  std::map<std::string, double> medians;
+  std::map<std::string, double> cvs;
+  for (NSDictionary* bench in json[@"benchmarks"]) {
+    NSString* name = bench[@"run_name"] ?: bench[@"name"];
+    if (!name || ![bench[@"real_time"] isKindOfClass:[NSNumber class]]) continue;
+    double value = [bench[@"real_time"] doubleValue];
+
+    if ([bench[@"run_type"] isEqualToString:@"aggregate"]) {
+      NSString* aggregate = bench[@"aggregate_name"];
+      if ([aggregate isEqualToString:@"median"]) {
+        medians[name.UTF8String] = ToNanos(value, bench[@"time_unit"]);
+      } else if ([aggregate isEqualToString:@"cv"]) {
+        cvs[name.UTF8String] = value;
+      }
+    } else if (!bench[@"error_occurred"] || ![bench[@"error_occurred"] boolValue]) {
+      samples[name.UTF8String].push_back(ToNanos(value, bench[@"time_unit"]));
+    }
+  }
+
+  for (const auto& [name, values] : samples) {
+    (*results)[name] = {Median(values), CoefficientOfVariation(values)};
+  }
+  for (const auto& [name, median] : medians) {
+    (*results)[name].medianNanos = median;
+  }
+  for (const auto& [name, cv] : cvs) {
+    (*results)[name].cv = cv;
+  }
+  return true;
+}
+
+// Print a line for every benchmark and return the number of regressions
+static int Compare(const std::map<std::string, Stats>& baseline,
+                   const std::map<std::string, Stats>& current, const Config& config) {
+  int regressions = 0;
+  int improvements = 0;
+  std::cout << std::fixed << std::setprecision(1);
+
+  for (const auto& [name, cur] : current) {
+    auto base = baseline.find(name);
+    if (base == baseline.end() || base->second.medianNanos == 0) {
+      std::cout << "new name=" << name << " current_ns=" << cur.medianNanos << std::endl;
+      continue;
+    }
+
+    double change =
+        (cur.medianNanos - base->second.medianNanos) * 100.0 / base->second.medianNanos;
+    double threshold = std::max(config.thresholdPercent,
+                                config.noiseMultiplier * std::max(base->second.cv, cur.cv) * 100);
+
+    const char* status = "ok";
+    if (change > threshold) {
+      status = "regression";
+      regressions++;
+    } else if (change < -threshold) {
+      status = "improvement";
+      improvements++;
+    }
+
+    std::cout << status << " name=" << name << " baseline_ns=" << base->second.medianNanos
+              << " current_ns=" << cur.medianNanos << " change=" << std::showpos << change
+              << std::noshowpos << "% threshold=" << threshold << "%" << std::endl;
+  }
+
+  for (const auto& [name, base] : baseline) {
+    if (current.find(name) == current.end()) {
+      std::cout << "missing name=" << name << " baseline_ns=" << base.medianNanos << std::endl;
+    }
+  }
+
+  std::cout << "regressions=" << regressions << " improvements=" << improvements
+            << " benchmarks=" << current.size() << std::endl;
+  return regressions;
+}
+
+static void PrintUsage() {
+  std::cerr << "Usage: " << getprogname()
+            << " -b baseline.json -c current.json [-t threshold_percent] [-k noise_multiplier]"
+            << std::endl;
+}
+
+static bool ParseDouble(const char* arg, double* out) {
+  char* end;
+  double val = strtod(arg, &end);
+  if (*end != '\0' || val < 0) return false;
+  *out = val;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  @autoreleasepool {
+    Config config;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:c:t:k:h")) != -1) {
+      switch (opt) {
+        case 'b': config.baseline = optarg; break;
+        case 'c': config.current = optarg; break;
+        case 't':
+          if (!ParseDouble(optarg, &config.thresholdPercent)) {
+            std::cerr << "Error: Invalid threshold: " << optarg << std::endl;
+            return 1;
+          }
+          break;
+        case 'k':
+          if (!ParseDouble(optarg, &config.noiseMultiplier)) {
+            std::cerr << "Error: Invalid noise multiplier: " << optarg << std::endl;
+            return 1;
+          }
+          break;
+        case 'h': PrintUsage(); return 0;
+        default: PrintUsage(); return 1;
+      }
+    }
+
+    if (config.baseline.empty() || config.current.empty()) {
+      PrintUsage();
+      return 1;
+    }
+
+    std::map<std::string, Stats> baseline;
+    std::map<std::string, Stats> current;
+    if (!LoadResults(config.baseline, &baseline) || !LoadResults(config.current, &current)) {
+      return 1;
+    }
+
+    if (baseline.empty()) {
+      std::cerr << "Warning: The baseline has no results, every benchmark is new" << std::endl;
+    }
+    return Compare(baseline, current, config) > 0 ? 2 : 0;
+  }
+}
@@ -0,0 +1,489 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+
+/*
+
+Measure CEL compile time, evaluation latency and arena usage for every
+expression in a corpus, against both the v1 and v2 evaluators. Each
+expression is evaluated against a fresh activation modeled on a typical
+developer tool exec, so attribute conversion is included in the latency.
+
+The default corpus is the CEL fuzzer's seed corpus, one expression per file.
+Expressions that only compile with v2 are skipped for v1.
+
+Check a CEL library update for regressions by recording a baseline first:
+  BENCH=bazel-bin/Testing/OneOffs/cel_bench
+  $BENCH -o /tmp/cel_baseline.txt
+  # ... update the CEL dependency and rebuild ...
+  $BENCH -b /tmp/cel_baseline.txt
+
+Or compare overall runtime with hyperfine:
+  /opt/homebrew/bin/hyperfine --warmup 3 \
+      --parameter-list version v1,v2 \
+      "$BENCH -v {version} -i 20000"
+
+Options:
+  -c  Corpus directory (default Testing/Fuzzing/CELEvaluatorFuzzer_corpus)
+  -v  Evaluator to test: "v1", "v2" or "all" (default all)
+  -i  Evaluations per expression (default 10000)
+  -o  Also write results to this file, for later use with -b
+  -b  Compare against results previously written with -o and exit with
+      status 2 if any metric regressed
+  -r  Percentage increase that counts as a regression (default 20)
+
+*/
+
+#import <Foundation/Foundation.h>
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Source/common/LatencyHistogram.h"
+#include "Source/common/cel/Activation.h"
+#include "Source/common/cel/CELProtoTraits.h"
+#include "Source/common/cel/Evaluator.h"
+
+using santa::LatencyHistogram;
+using santa::cel::Activation;
+using santa::cel::CELProtoTraits;
+using santa::cel::Evaluator;
+
+// Plans are compiled this many times to measure compile latency
+static const int kCompileRounds = 100;
+
+static std::atomic<uint64_t> gSink;
+
+struct Config {
+  std::string corpus = "Testing/Fuzzing/CELEvaluatorFuzzer_corpus";
+  bool runV1 = true;
+  bool runV2 = true;
+  uint64_t iterations = 10000;
+  std::string output;
+  std::string baseline;
+  double thresholdPercent = 20;
+};
+
+struct Expression {
+  std::string name;
+  std::string expr;
+};
+
+// Metrics are kept as ordered (name, value) pairs so that results print,
+// save and compare in a stable order
+struct Result {
+  std::string name;
+  std::string version;
+  std::vector<std::pair<std::string, uint64_t>> metrics;
+};
+
+static std::vector<std::string> MakeArgs() {
+  std::vector<std::string> args = {
+      "/usr/local/bin/node", "--max-old-space-size=8192", "--enable-source-maps",
+      "/Users/user/src/app/node_modules/.bin/webpack", "serve", "--mode", "development",
+      "--config", "/Users/user/src/app/webpack.config.js", "--port", "8080",
+  };
+  for (int i = 0; i < 20; ++i) {
+    args.push_back("--env=FEATURE_" + std::to_string(i) + "=enabled");
+  }
+  return args;
+}
+
+static std::map<std::string, std::string> MakeEnvs() {
+  std::map<std::string, std::string> envs = {
+      {"HOME", "/Users/user"},
+      {"LANG", "en_US.UTF-8"},
+      {"LOGNAME", "user"},
+      {"PATH", "/opt/homebrew/bin:/usr/local/bin:/usr/bin:/bin:/usr/sbin:/sbin"},
+      {"PWD", "/Users/user/src/app"},
+      {"SHELL", "/bin/zsh"},
+      {"TERM", "xterm-256color"},
+      {"TMPDIR", "/var/folders/zz/zyxvpxvq6csfxvn_n0000000000000/T/"},
+      {"USER", "user"},
+  };
+  for (int i = 0; i < 30; ++i) {
+    envs["npm_config_option_" + std::to_string(i)] = "/Users/user/.npm/_cacache/" +
+                                                      std::to_string(i);
+  }
+  return envs;
+}
+
+template <bool IsV2>
+static std::unique_ptr<typename CELProtoTraits<IsV2>::ExecutableFileT> MakeTarget() {
+  auto f = std::make_unique<typename CELProtoTraits<IsV2>::ExecutableFileT>();
+  f->set_signing_id("EQHXZ8M8AV:com.google.Chrome");
+  f->set_team_id("EQHXZ8M8AV");
+  f->mutable_signing_time()->set_seconds(1748436989);
+  f->mutable_secure_signing_time()->set_seconds(1748436989);
+  f->set_is_platform_binary(false);
+  if constexpr (IsV2) {
+    auto* entitlements = f->mutable_entitlements();
+    (*entitlements)["com.apple.security.cs.allow-jit"] = "true";
+    (*entitlements)["com.apple.security.device.camera"] = "true";
+    (*entitlements)["keychain-access-groups"] = "[\"EQHXZ8M8AV.com.google.Chrome\"]";
+  }
+  return f;
+}
+
+template <bool IsV2>
+static std::vector<typename CELProtoTraits<IsV2>::AncestorT> MakeAncestors() {
+  if constexpr (IsV2) {
+    std::vector<typename CELProtoTraits<IsV2>::AncestorT> ancestors(4);
+    ancestors[0].set_path("/bin/zsh");
+    ancestors[0].set_signing_id("platform:com.apple.zsh");
+    ancestors[0].add_args("-zsh");
+    ancestors[1].set_path("/usr/bin/login");
+    ancestors[1].set_signing_id("platform:com.apple.login");
+    ancestors[1].add_args("login");
+    ancestors[1].add_args("-pf");
+    ancestors[1].add_args("user");
+    ancestors[2].set_path("/System/Applications/Utilities/Terminal.app/Contents/MacOS/Terminal");
+    ancestors[2].set_signing_id("platform:com.apple.Terminal");
+    ancestors[3].set_path("/sbin/launchd");
+    ancestors[3].set_signing_id("platform:com.apple.xpc.launchd");
+    return ancestors;
+  } else {
+    return {};
+  }
+}
+
+template <bool IsV2>
+static std::vector<typename CELProtoTraits<IsV2>::FileDescriptorT> MakeFds() {
+  if constexpr (IsV2) {
+    using FileDescriptorT = typename CELProtoTraits<IsV2>::FileDescriptorT;
+    std::vector<FileDescriptorT> fds(4);
+    fds[0].set_fd(0);
+    fds[0].set_type(FileDescriptorT::FD_TYPE_VNODE);
+    fds[1].set_fd(1);
+    fds[1].set_type(FileDescriptorT::FD_TYPE_PIPE);
+    fds[2].set_fd(2);
+    fds[2].set_type(FileDescriptorT::FD_TYPE_PIPE);
+    fds[3].set_fd(3);
+    fds[3].set_type(FileDescriptorT::FD_TYPE_SOCKET);
+    return fds;
+  } else {
+    return {};
+  }
+}
+
+template <bool IsV2>
+static std::unique_ptr<Activation<IsV2>> MakeActivation() {
+  using Traits = CELProtoTraits<IsV2>;
+  static const std::vector<std::string> args = MakeArgs();
+  static const std::map<std::string, std::string> envs = MakeEnvs();
+  static const std::vector<typename Traits::AncestorT> ancestors = MakeAncestors<IsV2>();
+  static const std::vector<typename Traits::FileDescriptorT> fds = MakeFds<IsV2>();
+
+  return std::make_unique<Activation<IsV2>>(
+      ^std::unique_ptr<typename Traits::ExecutableFileT>() {
+        return MakeTarget<IsV2>();
+      },
+      ^std::vector<std::string>() {
+        return args;
+      },
+      ^std::map<std::string, std::string>() {
+        return envs;
+      },
+      ^uid_t() {
+        return 501;
+      },
+      ^std::string() {
+        return "/Users/user/src/app";
+      },
+      ^std::string() {
+        return "/usr/local/bin/node";
+      },
+      ^std::vector<typename Traits::AncestorT>() {
+        return ancestors;
+      },
+      ^std::vector<typename Traits::FileDescriptorT>() {
+        return fds;
+      });
+}
+
+static std::optional<std::vector<Expression>> LoadCorpus(const std::string& dir) {
+  NSArray<NSString*>* files =
+      [[NSFileManager defaultManager] contentsOfDirectoryAtPath:@(dir.c_str()) error:nil];
+  if (!files) {
+    return std::nullopt;
+  }
+
+  std::vector<Expression> corpus;
+  for (NSString* file in [files sortedArrayUsingSelector:@selector(compare:)]) {
+    if ([file hasPrefix:@"."]) continue;
+    std::ifstream in(dir + "/" + file.UTF8String);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    if (!in || ss.str().empty()) continue;
+    corpus.push_back({file.UTF8String, ss.str()});
+  }
+  return corpus;
+}
+
+template <bool IsV2>
+static std::optional<Result> RunExpression(Evaluator<IsV2>* evaluator, const Expression& e,
+                                           const Config& config) {
+  const char* version = IsV2 ? "v2" : "v1";
+
+  google::protobuf::Arena planArena;
+  auto plan = evaluator->Compile(e.expr, &planArena);
+  if (!plan.ok()) {
+    std::cerr << "Skipping " << e.name << " for " << version << ": " << plan.status().message()
+              << std::endl;
+    return std::nullopt;
+  }
+  uint64_t planArenaBytes = planArena.SpaceUsed();
+
+  LatencyHistogram compileLatency;
+  for (int i = 0; i < kCompileRounds; ++i) {
+    google::protobuf::Arena arena;
+    uint64_t start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    auto p = evaluator->Compile(e.expr, &arena);
+    compileLatency.Record(clock_gettime_nsec_np(CLOCK_MONOTONIC) - start);
+    gSink.fetch_add(p.ok(), std::memory_order_relaxed);
+  }
+
+  LatencyHistogram evalLatency;
+  uint64_t evalArenaBytes = 0;
+  for (uint64_t i = 0; i < config.iterations; ++i) {
+    auto activation = MakeActivation<IsV2>();
+    google::protobuf::Arena arena;
+
+    uint64_t start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    auto result = evaluator->Evaluate(plan->get(), *activation, &arena);
+    evalLatency.Record(clock_gettime_nsec_np(CLOCK_MONOTONIC) - start);
+
+    if (!result.ok()) {
+      std::cerr << "Error: Failed to evaluate " << e.name << " for " << version << ": "
+                << result.status().message() << std::endl;
+      return std::nullopt;
+    }
+    gSink.fetch_add((uint64_t)result->value, std::memory_order_relaxed);
+
+    // Every evaluation does the same work so the last one is representative
+    evalArenaBytes = arena.SpaceUsed() + activation->ValuesSpaceUsed();
+  }
+
+  LatencyHistogram::Snapshot compile = compileLatency.TakeSnapshot(false);
+  LatencyHistogram::Snapshot eval = evalLatency.TakeSnapshot(false);
+  return Result{e.name,
+                version,
+                {
+                    {"compile_p50_ns", compile.Percentile(50)},
+                    {"compile_p99_ns", compile.Percentile(99)},
+                    {"plan_arena_bytes", planArenaBytes},
+                    {"eval_p50_ns", eval.Percentile(50)},
+                    {"eval_p90_ns", eval.Percentile(90)},
+                    {"eval_p99_ns", eval.Percentile(99)},
+                    {"eval_arena_bytes", evalArenaBytes},
+                }};
+}
+
+template <bool IsV2>
+static bool RunAll(const std::vector<Expression>& corpus, const Config& config,
+                   std::vector<Result>* results) {
+  auto evaluator = Evaluator<IsV2>::Create();
+  if (!evaluator.ok()) {
+    std::cerr << "Error: Failed to create evaluator: " << evaluator.status().message()
+              << std::endl;
+    return false;
+  }
+
+  for (const Expression& e : corpus) {
+    if (auto result = RunExpression<IsV2>(evaluator->get(), e, config)) {
+      results->push_back(std::move(*result));
+    }
+  }
+  return true;
+}
+
+static std::string FormatResult(const Result& result) {
+  std::string line = "name=" + result.name + " version=" + result.version;
+  for (const auto& [metric, value] : result.metrics) {
+    line += " " + metric + "=" + std::to_string(value);
+  }
+  return line;
+}
+
+// Parse lines written by FormatResult, keyed by "name/version"
+static std::map<std::string, std::map<std::string, uint64_t>> LoadBaseline(
+    const std::string& path) {
+  std::map<std::string, std::map<std::string, uint64_t>> baseline;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream tokens(line);
+    std::string token, name, version;
+    std::map<std::string, uint64_t> metrics;
+    while (tokens >> token) {
+      size_t eq = token.find('=');
+      if (eq == std::string::npos) continue;
+      std::string key = token.substr(0, eq);
+      std::string value = token.substr(eq + 1);
+      if (key == "name") {
+        name = value;
+      } else if (key == "version") {
+        version = value;
+      } else {
+        metrics[key] = strtoull(value.c_str(), nullptr, 10);
+      }
+    }
+    if (!name.empty()) {
+      baseline[name + "/" + version] = std::move(metrics);
+    }
+  }
+  return baseline;
+}
+
+// Print every metric that grew by more than the threshold and return the
+// number of regressions
+static int CompareToBaseline(const std::vector<Result>& results, const Config& config) {
+  auto baseline = LoadBaseline(config.baseline);
+  if (baseline.empty()) {
+    std::cerr << "Error: No results in baseline: " << config.baseline << std::endl;
+    return -1;
+  }
+
+  int regressions = 0;
+  for (const Result& result : results) {
+    auto it = baseline.find(result.name + "/" + result.version);
+    if (it == baseline.end()) {
+      std::cout << "new name=" << result.name << " version=" << result.version << std::endl;
+      continue;
+    }
+
+    for (const auto& [metric, value] : result.metrics) {
+      auto base = it->second.find(metric);
+      if (base == it->second.end() || base->second == 0) continue;
+
+      double change = ((double)value - base->second) * 100.0 / base->second;
+      if (change > config.thresholdPercent) {
+        regressions++;
+        std::cout << "regression name=" << result.name << " version=" << result.version
+                  << " metric=" << metric << " baseline=" << base->second
+                  << " current=" << value << " change=+" << (int)change << "%" << std::endl;
+      }
+    }
+  }
+
+  std::cout << "regressions=" << regressions << " threshold=" << config.thresholdPercent << "%"
+            << std::endl;
+  return regressions;
+}
+
+static void PrintUsage() {
+  std::cerr << "Usage: " << getprogname()
+            << " [-c corpus_dir] [-v v1|v2|all] [-i iterations] [-o output] [-b baseline]"
+               " [-r threshold_percent]"
+            << std::endl;
+}
+
+static bool ParseUInt(const char* arg, uint64_t* out) {
+  char* end;
+  long long val = strtoll(arg, &end, 10);
+  if (*end != '\0' || val <= 0) return false;
+  *out = (uint64_t)val;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  @autoreleasepool {
+    Config config;
+    int opt;
+    uint64_t val;
+
+    while ((opt = getopt(argc, argv, "c:v:i:o:b:r:h")) != -1) {
+      switch (opt) {
+        case 'c': config.corpus = optarg; break;
+        case 'v':
+          if (strcmp(optarg, "v1") == 0) {
+            config.runV2 = false;
+          } else if (strcmp(optarg, "v2") == 0) {
+            config.runV1 = false;
+          } else if (strcmp(optarg, "all") != 0) {
+            std::cerr << "Error: Invalid version: " << optarg << std::endl;
+            PrintUsage();
+            return 1;
+          }
+          break;
+        case 'i':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid iteration count: " << optarg << std::endl;
+            return 1;
+          }
+          config.iterations = val;
+          break;
+        case 'o': config.output = optarg; break;
+        case 'b': config.baseline = optarg; break;
+        case 'r':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid regression threshold: " << optarg << std::endl;
+            return 1;
+          }
+          config.thresholdPercent = (double)val;
+          break;
+        case 'h': PrintUsage(); return 0;
+        default: PrintUsage(); return 1;
+      }
+    }
+
+    auto corpus = LoadCorpus(config.corpus);
+    if (!corpus || corpus->empty()) {
+      std::cerr << "Error: No expressions found in corpus: " << config.corpus << std::endl;
+      return 1;
+    }
+
+    std::vector<Result> results;
+    if ((config.runV1 && !RunAll<false>(*corpus, config, &results)) ||
+        (config.runV2 && !RunAll<true>(*corpus, config, &results))) {
+      return 1;
+    }
+
+    std::ofstream out;
+    if (!config.output.empty()) {
+      out.open(config.output);
+      if (!out) {
+        std::cerr << "Error: Unable to open output file: " << config.output << std::endl;
+        return 1;
+      }
+    }
+
+    for (const Result& result : results) {
+      std::string line = FormatResult(result);
+      std::cout << line << std::endl;
+      if (out.is_open()) out << line << std::endl;
+    }
+
+    if (!config.baseline.empty()) {
+      int regressions = CompareToBaseline(results, config);
+      if (regressions < 0) return 1;
+      if (regressions > 0) return 2;
+    }
+    return 0;
+  }
+}
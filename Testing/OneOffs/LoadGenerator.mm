@@ -0,0 +1,506 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+/*
+
+Generate the kinds of ES event storms that have historically been hardest on
+santad, and report how santad coped. Run it against a live santad, ideally on
+an otherwise idle machine, to compare releases under the same load:
+
+  load_generator build          # make -j64 style storm of short-lived execs
+  load_generator churn          # npm install style file writes and renames
+  load_generator forktree       # deep, wide trees of forked processes
+
+Presets:
+  build     Each worker repeatedly spawns a command and waits for it, like a
+            make recipe invoking a compiler through the shell.
+  churn     Each worker writes packages into a staging directory, writing
+            each file under a temporary name then renaming it, and finally
+            renames the package directory into place.
+  forktree  Each iteration forks a tree of processes `-d` levels deep with
+            `-w` children per process. Leaves exit, or exec with `-x`.
+
+Options:
+  -j  Parallel workers for build and churn (default 64)
+  -n  Iterations: execs for build, packages for churn, trees for forktree
+      (default 20000, 2000 and 10 respectively)
+  -c  Command spawned by build, split on spaces
+      (default "/bin/sh -c /usr/bin/true")
+  -f  Files per package for churn (default 20)
+  -d  Depth of each forktree (default 8)
+  -w  Children per process for forktree (default 3)
+  -x  Have forktree leaves exec /usr/bin/true
+  -s  Path to santactl, or "none" to skip collecting santad stats
+      (default /usr/local/bin/santactl)
+  -W  Seconds to wait after the load before collecting santad stats. Most
+      counters are only updated when santad exports metrics, so this
+      defaults to the configured metric export interval.
+  -o  Directory to save the raw `santactl metrics` and `santactl status`
+      output from before and after the load
+
+*/
+
+#import <Foundation/Foundation.h>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Source/common/LatencyHistogram.h"
+#import "Source/common/SNTConfigurator.h"
+#import "Source/common/SNTMetricSet.h"
+
+using santa::LatencyHistogram;
+
+extern char** environ;
+
+// Forked processes can't allocate, so fan out is bounded by a fixed array
+static const int kMaxFanout = 16;
+
+// Refuse trees that would approach the per-user process limit
+static const uint64_t kMaxTreeProcesses = 4000;
+
+enum class Preset {
+  kBuild,
+  kChurn,
+  kForkTree,
+};
+
+struct Config {
+  Preset preset;
+  uint32_t workers = 64;
+  uint64_t iterations = 0;
+  std::vector<std::string> command = {"/bin/sh", "-c", "/usr/bin/true"};
+  uint32_t filesPerPackage = 20;
+  uint32_t depth = 8;
+  uint32_t fanout = 3;
+  bool execLeaves = false;
+  std::string santactl = "/usr/local/bin/santactl";
+  int64_t settleSecs = -1;
+  NSString* outputDir;
+};
+
+// What santad reported through santactl at a point in time
+struct SantadStats {
+  NSDictionary* metrics;
+  NSDictionary* status;
+};
+
+static std::atomic<uint64_t> gFailures;
+
+static uint64_t NowNanos() {
+  return clock_gettime_nsec_np(CLOCK_MONOTONIC);
+}
+
+static NSData* RunSantactl(const Config& config, NSArray<NSString*>* args) {
+  NSTask* task = [[NSTask alloc] init];
+  task.executableURL = [NSURL fileURLWithPath:@(config.santactl.c_str())];
+  task.arguments = args;
+  NSPipe* pipe = [NSPipe pipe];
+  task.standardOutput = pipe;
+  task.standardError = [NSFileHandle fileHandleWithNullDevice];
+
+  NSError* err;
+  if (![task launchAndReturnError:&err]) {
+    std::cerr << "Error: Failed to run santactl: " << err.localizedDescription.UTF8String
+              << std::endl;
+    return nil;
+  }
+  NSData* data = [pipe.fileHandleForReading readDataToEndOfFile];
+  [task waitUntilExit];
+  return task.terminationStatus == 0 ? data : nil;
+}
+
+static SantadStats CollectStats(const Config& config, NSString* label) {
+  SantadStats stats;
+  NSData* metrics = RunSantactl(config, @[ @"metrics", @"--json" ]);
+  NSData* status = RunSantactl(config, @[ @"status", @"--json" ]);
+
+  if (config.outputDir) {
+    [metrics writeToFile:[config.outputDir
+                             stringByAppendingFormat:@"/metrics_%@.json", label]
+              atomically:YES];
+    [status writeToFile:[config.outputDir stringByAppendingFormat:@"/status_%@.json", label]
+             atomically:YES];
+  }
+
+  if (metrics) {
+    stats.metrics = [NSJSONSerialization JSONObjectWithData:metrics options:0 error:nil];
+  }
+  if (status) {
+    stats.status = [NSJSONSerialization JSONObjectWithData:status options:0 error:nil];
+  }
+  return stats;
+}
+
+// Sum the values of a metric, optionally only those whose last field value
+// matches `lastFieldValue`
+static int64_t SumMetric(NSDictionary* metrics, NSString* name, NSString* lastFieldValue = nil) {
+  int64_t sum = 0;
+  NSDictionary* fields = metrics[@"metrics"][name][@"fields"];
+  for (NSString* fieldNames in fields) {
+    for (NSDictionary* field in fields[fieldNames]) {
+      if (lastFieldValue &&
+          ![[[field[@"value"] componentsSeparatedByString:@","] lastObject]
+              isEqualToString:lastFieldValue]) {
+        continue;
+      }
+      if ([field[@"data"] isKindOfClass:[NSNumber class]]) {
+        sum += [field[@"data"] longLongValue];
+      }
+    }
+  }
+  return sum;
+}
+
+static void PrintStatsDelta(const SantadStats& before, const SantadStats& after) {
+  if (!before.metrics || !after.metrics || !after.status) {
+    std::cerr << "Error: Unable to collect santad stats, is santad running?" << std::endl;
+    return;
+  }
+
+  // AuthResultCache::CacheCounts as reported by santactl status
+  NSDictionary* cache = after.status[@"cache"];
+  std::cout << "santad root_cache_count=" << [cache[@"root_cache_count"] longLongValue]
+            << " non_root_cache_count=" << [cache[@"non_root_cache_count"] longLongValue]
+            << std::endl;
+
+  NSString* budgets = @"/santa/auth_response_remaining_budget";
+  std::cout << "santad deadline_misses="
+            << SumMetric(after.metrics, budgets, @"Expired") -
+                   SumMetric(before.metrics, budgets, @"Expired")
+            << " auth_responses="
+            << SumMetric(after.metrics, budgets) - SumMetric(before.metrics, budgets)
+            << std::endl;
+
+  // Every counter that moved while the load ran
+  NSDictionary* afterMetrics = after.metrics[@"metrics"];
+  for (NSString* name in [afterMetrics.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+    if ([afterMetrics[name][@"type"] integerValue] != SNTMetricTypeCounter) {
+      continue;
+    }
+    int64_t delta = SumMetric(after.metrics, name) - SumMetric(before.metrics, name);
+    if (delta != 0) {
+      std::cout << "counter name=" << name.UTF8String << " delta=" << delta << std::endl;
+    }
+  }
+}
+
+static bool Spawn(const std::vector<char*>& argv) {
+  pid_t pid;
+  if (posix_spawn(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+    return false;
+  }
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) return false;
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void RunBuild(const Config& config, LatencyHistogram* latency) {
+  std::vector<char*> argv;
+  for (const std::string& arg : config.command) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  auto next = std::make_shared<std::atomic<uint64_t>>(0);
+  dispatch_apply(config.workers, DISPATCH_APPLY_AUTO, ^(size_t) {
+    while (next->fetch_add(1, std::memory_order_relaxed) < config.iterations) {
+      uint64_t start = NowNanos();
+      if (!Spawn(argv)) {
+        gFailures.fetch_add(1, std::memory_order_relaxed);
+      }
+      latency->Record(NowNanos() - start);
+    }
+  });
+}
+
+static bool WritePackage(NSString* root, uint64_t package, uint32_t files) {
+  static const char kContents[512] = {'x'};
+  NSString* staging = [root stringByAppendingFormat:@"/staging/pkg-%llu", package];
+  NSString* final = [root stringByAppendingFormat:@"/node_modules/pkg-%llu", package];
+  if (mkdir(staging.UTF8String, 0755) != 0) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < files; i++) {
+    std::string tmp = [staging stringByAppendingFormat:@"/file-%u.js.tmp", i].UTF8String;
+    std::string dst = [staging stringByAppendingFormat:@"/file-%u.js", i].UTF8String;
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      return false;
+    }
+    bool ok = write(fd, kContents, sizeof(kContents)) == sizeof(kContents);
+    close(fd);
+    if (!ok || rename(tmp.c_str(), dst.c_str()) != 0) {
+      return false;
+    }
+  }
+
+  return rename(staging.UTF8String, final.UTF8String) == 0;
+}
+
+static bool RunChurn(const Config& config, LatencyHistogram* latency) {
+  NSString* root = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"load_generator_%d", getpid()]];
+  NSFileManager* fm = [NSFileManager defaultManager];
+  if (![fm createDirectoryAtPath:[root stringByAppendingPathComponent:@"staging"]
+          withIntermediateDirectories:YES
+                           attributes:nil
+                                error:nil] ||
+      ![fm createDirectoryAtPath:[root stringByAppendingPathComponent:@"node_modules"]
+          withIntermediateDirectories:YES
+                           attributes:nil
+                                error:nil]) {
+    std::cerr << "Error: Failed to create " << root.UTF8String << std::endl;
+    return false;
+  }
+
+  auto next = std::make_shared<std::atomic<uint64_t>>(0);
+  dispatch_apply(config.workers, DISPATCH_APPLY_AUTO, ^(size_t) {
+    uint64_t package;
+    while ((package = next->fetch_add(1, std::memory_order_relaxed)) < config.iterations) {
+      @autoreleasepool {
+        uint64_t start = NowNanos();
+        if (!WritePackage(root, package, config.filesPerPackage)) {
+          gFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+        latency->Record(NowNanos() - start);
+      }
+    }
+  });
+
+  [fm removeItemAtPath:root error:nil];
+  return true;
+}
+
+// Runs in forked children of a multithreaded process, so must only make
+// async-signal-safe calls
+static void ForkTree(uint32_t depth, uint32_t fanout, bool execLeaves) {
+  if (depth == 0) {
+    if (execLeaves) {
+      execl("/usr/bin/true", "true", (char*)nullptr);
+    }
+    _exit(0);
+  }
+
+  pid_t children[kMaxFanout];
+  uint32_t started = 0;
+  for (uint32_t i = 0; i < fanout; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      ForkTree(depth - 1, fanout, execLeaves);
+    } else if (pid > 0) {
+      children[started++] = pid;
+    }
+  }
+
+  bool ok = started == fanout;
+  for (uint32_t i = 0; i < started; i++) {
+    int status;
+    while (waitpid(children[i], &status, 0) < 0 && errno == EINTR) {
+    }
+    ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+  _exit(ok ? 0 : 1);
+}
+
+static bool RunForkTree(const Config& config, LatencyHistogram* latency) {
+  uint64_t processes = 1;
+  uint64_t level = 1;
+  for (uint32_t i = 0; i < config.depth; i++) {
+    level *= config.fanout;
+    processes += level;
+  }
+  if (config.fanout > kMaxFanout || processes > kMaxTreeProcesses) {
+    std::cerr << "Error: A tree of depth " << config.depth << " and fan out " << config.fanout
+              << " would have more than " << kMaxTreeProcesses << " processes" << std::endl;
+    return false;
+  }
+  std::cout << "tree_processes=" << processes << std::endl;
+
+  for (uint64_t i = 0; i < config.iterations; i++) {
+    uint64_t start = NowNanos();
+    pid_t pid = fork();
+    if (pid == 0) {
+      ForkTree(config.depth, config.fanout, config.execLeaves);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      gFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+    latency->Record(NowNanos() - start);
+  }
+  return true;
+}
+
+static void PrintUsage() {
+  std::cerr << "Usage: " << getprogname()
+            << " build|churn|forktree [-j workers] [-n iterations] [-c command]"
+               " [-f files_per_package] [-d depth] [-w fanout] [-x] [-s santactl|none]"
+               " [-W settle_secs] [-o output_dir]"
+            << std::endl;
+}
+
+static bool ParseUInt(const char* arg, uint64_t* out) {
+  char* end;
+  long long val = strtoll(arg, &end, 10);
+  if (*end != '\0' || val <= 0) return false;
+  *out = (uint64_t)val;
+  return true;
+}
+
+static std::vector<std::string> SplitCommand(const char* command) {
+  std::vector<std::string> args;
+  for (NSString* arg in [@(command) componentsSeparatedByString:@" "]) {
+    if (arg.length > 0) {
+      args.push_back(arg.UTF8String);
+    }
+  }
+  return args;
+}
+
+int main(int argc, char* argv[]) {
+  @autoreleasepool {
+    if (argc < 2) {
+      PrintUsage();
+      return 1;
+    }
+
+    static const std::map<std::string, std::pair<Preset, uint64_t>> kPresets = {
+        {"build", {Preset::kBuild, 20000}},
+        {"churn", {Preset::kChurn, 2000}},
+        {"forktree", {Preset::kForkTree, 10}},
+    };
+    auto preset = kPresets.find(argv[1]);
+    if (preset == kPresets.end()) {
+      PrintUsage();
+      return 1;
+    }
+
+    Config config;
+    config.preset = preset->second.first;
+    config.iterations = preset->second.second;
+
+    // Options follow the preset
+    optind = 2;
+    int opt;
+    uint64_t val;
+    while ((opt = getopt(argc, argv, "j:n:c:f:d:w:xs:W:o:h")) != -1) {
+      switch (opt) {
+        case 'j':
+        case 'f':
+        case 'd':
+        case 'w':
+          if (!ParseUInt(optarg, &val) || val > UINT32_MAX) {
+            std::cerr << "Error: Invalid value for -" << (char)opt << ": " << optarg << std::endl;
+            return 1;
+          }
+          if (opt == 'j') config.workers = (uint32_t)val;
+          if (opt == 'f') config.filesPerPackage = (uint32_t)val;
+          if (opt == 'd') config.depth = (uint32_t)val;
+          if (opt == 'w') config.fanout = (uint32_t)val;
+          break;
+        case 'n':
+          if (!ParseUInt(optarg, &config.iterations)) {
+            std::cerr << "Error: Invalid iteration count: " << optarg << std::endl;
+            return 1;
+          }
+          break;
+        case 'c':
+          config.command = SplitCommand(optarg);
+          if (config.command.empty()) {
+            std::cerr << "Error: Empty command" << std::endl;
+            return 1;
+          }
+          break;
+        case 'x': config.execLeaves = true; break;
+        case 's': config.santactl = optarg; break;
+        case 'W':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid settle time: " << optarg << std::endl;
+            return 1;
+          }
+          config.settleSecs = (int64_t)val;
+          break;
+        case 'o': config.outputDir = @(optarg); break;
+        case 'h': PrintUsage(); return 0;
+        default: PrintUsage(); return 1;
+      }
+    }
+
+    bool collectStats = config.santactl != "none";
+    if (config.settleSecs < 0) {
+      config.settleSecs = collectStats ? [[SNTConfigurator configurator] metricExportInterval] : 0;
+    }
+    if (config.outputDir) {
+      [[NSFileManager defaultManager] createDirectoryAtPath:config.outputDir
+                                withIntermediateDirectories:YES
+                                                 attributes:nil
+                                                      error:nil];
+    }
+
+    SantadStats before;
+    if (collectStats) {
+      before = CollectStats(config, @"before");
+    }
+
+    auto latency = std::make_unique<LatencyHistogram>();
+    uint64_t start = NowNanos();
+    bool ok = true;
+    switch (config.preset) {
+      case Preset::kBuild: RunBuild(config, latency.get()); break;
+      case Preset::kChurn: ok = RunChurn(config, latency.get()); break;
+      case Preset::kForkTree: ok = RunForkTree(config, latency.get()); break;
+    }
+    uint64_t elapsed = NowNanos() - start;
+    if (!ok) {
+      return 1;
+    }
+
+    LatencyHistogram::Snapshot snapshot = latency->TakeSnapshot(false);
+    std::cout << "preset=" << argv[1] << " iterations=" << snapshot.count
+              << " failures=" << gFailures.load() << " elapsed_ms=" << elapsed / NSEC_PER_MSEC
+              << " per_sec=" << (uint64_t)(snapshot.count * (double)NSEC_PER_SEC / elapsed)
+              << " p50_ns=" << snapshot.Percentile(50) << " p90_ns=" << snapshot.Percentile(90)
+              << " p99_ns=" << snapshot.Percentile(99) << " max_ns=" << snapshot.max << std::endl;
+
+    if (collectStats) {
+      if (config.settleSecs > 0) {
+        std::cerr << "Waiting " << config.settleSecs << "s for santad to export metrics"
+                  << std::endl;
+        sleep((unsigned int)config.settleSecs);
+      }
+      PrintStatsDelta(before, CollectStats(config, @"after"));
+    }
+
+    return gFailures.load() == 0 ? 0 : 2;
+  }
+}
@@ -0,0 +1,200 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+/*
+
+Compare PrefixTree layouts with file path prefixes, mirroring the FAA data
+watch item and Recorder prefix filter lookups.
+
+Run benchmarks with hyperfine:
+  BENCH=bazel-bin/Testing/OneOffs/prefix_tree_bench
+  /opt/homebrew/bin/hyperfine --warmup 3 \
+      --parameter-list layout bytetrie,radix \
+      --parameter-list threads 1,4,8 \
+      "$BENCH -l {layout} -t {threads} -i 2000000"
+
+Options:
+  -l  Layout to test: "bytetrie" or "radix"
+  -t  Number of concurrent threads
+  -i  Lookups per thread
+  -p  Number of prefixes in the tree (default 500)
+  -m  Percentage of lookups that match a prefix (default 10)
+
+*/
+
+#import <Foundation/Foundation.h>
+
+#include <getopt.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Source/common/PrefixTree.h"
+
+using santa::PrefixTree;
+using santa::PrefixTreeLayout;
+
+static const uint32_t kSeed = 0xBEEFCAFE;
+
+static std::atomic<uint64_t> gSink;
+
+struct Config {
+  PrefixTreeLayout layout = PrefixTreeLayout::kByteTrie;
+  int threads = 1;
+  uint64_t iterations = 1000000;
+  uint64_t prefixes = 500;
+  int matchPercent = 10;
+};
+
+static std::string MakePrefix(uint64_t i) {
+  static const char* kRoots[] = {"/Users/user%llu/Library/Application Support/app%llu/",
+                                 "/private/var/db/service%llu/data%llu/",
+                                 "/Library/Preferences/com.example.product%llu.plist%llu"};
+  char buf[PATH_MAX];
+  snprintf(buf, sizeof(buf), kRoots[i % 3], i / 3, i % 7);
+  return buf;
+}
+
+template <PrefixTreeLayout Layout>
+static void RunBenchmark(const Config& config) {
+  auto tree = std::make_unique<PrefixTree<uint64_t, Layout>>();
+
+  std::vector<std::string> prefixes;
+  prefixes.reserve(config.prefixes);
+  for (uint64_t i = 0; i < config.prefixes; ++i) {
+    prefixes.push_back(MakePrefix(i));
+    tree->InsertPrefix(prefixes.back().c_str(), i + 1);
+  }
+
+  // Inputs share long runs with the prefixes so that misses still walk deep
+  // into the tree
+  std::mt19937_64 gen(kSeed);
+  std::uniform_int_distribution<uint64_t> prefixDist(0, prefixes.size() - 1);
+  std::uniform_int_distribution<int> matchDist(0, 99);
+  std::vector<std::string> inputs;
+  inputs.reserve(4096);
+  for (int i = 0; i < 4096; ++i) {
+    std::string input = prefixes[prefixDist(gen)];
+    if (matchDist(gen) >= config.matchPercent) {
+      input.back() = '~';
+    }
+    input += "Caches/com.example.cache/file.db";
+    inputs.push_back(std::move(input));
+  }
+
+  dispatch_group_t group = dispatch_group_create();
+  auto* treePtr = tree.get();
+  auto* inputsPtr = &inputs;
+
+  uint64_t start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  for (int t = 0; t < config.threads; ++t) {
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0), ^{
+      uint64_t sink = 0;
+      for (uint64_t i = 0; i < config.iterations; ++i) {
+        const std::string& input = (*inputsPtr)[(i + t) % inputsPtr->size()];
+        sink += treePtr->LookupLongestMatchingPrefix(input).value_or(0);
+      }
+      // Prevent the lookups from being optimized away
+      gSink.fetch_add(sink, std::memory_order_relaxed);
+    });
+  }
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+  uint64_t elapsed = clock_gettime_nsec_np(CLOCK_MONOTONIC) - start;
+
+  uint64_t totalOps = config.iterations * config.threads;
+  std::cout << "layout=" << (Layout == PrefixTreeLayout::kByteTrie ? "bytetrie" : "radix")
+            << " threads=" << config.threads << " nodes=" << tree->NodeCount()
+            << " ops=" << totalOps << " ns/op=" << (double)elapsed / totalOps
+            << " Mops/s=" << (double)totalOps * 1000.0 / elapsed << std::endl;
+}
+
+static void PrintUsage() {
+  std::cerr << "Usage: " << getprogname()
+            << " [-l bytetrie|radix] [-t threads] [-i iterations] [-p prefixes] [-m match_percent]"
+            << std::endl;
+}
+
+static bool ParseUInt(const char* arg, uint64_t* out) {
+  char* end;
+  long long val = strtoll(arg, &end, 10);
+  if (*end != '\0' || val <= 0) return false;
+  *out = (uint64_t)val;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  @autoreleasepool {
+    Config config;
+    int opt;
+    uint64_t val;
+
+    while ((opt = getopt(argc, argv, "l:t:i:p:m:h")) != -1) {
+      switch (opt) {
+        case 'l':
+          if (strcmp(optarg, "bytetrie") == 0) {
+            config.layout = PrefixTreeLayout::kByteTrie;
+          } else if (strcmp(optarg, "radix") == 0) {
+            config.layout = PrefixTreeLayout::kRadix;
+          } else {
+            std::cerr << "Error: Invalid layout: " << optarg << std::endl;
+            PrintUsage();
+            return 1;
+          }
+          break;
+        case 't':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid thread count: " << optarg << std::endl;
+            return 1;
+          }
+          config.threads = (int)val;
+          break;
+        case 'i':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid iteration count: " << optarg << std::endl;
+            return 1;
+          }
+          config.iterations = val;
+          break;
+        case 'p':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid prefix count: " << optarg << std::endl;
+            return 1;
+          }
+          config.prefixes = val;
+          break;
+        case 'm':
+          config.matchPercent = atoi(optarg);
+          if (config.matchPercent < 0 || config.matchPercent > 100) {
+            std::cerr << "Error: Invalid match percentage: " << optarg << std::endl;
+            return 1;
+          }
+          break;
+        case 'h': PrintUsage(); return 0;
+        default: PrintUsage(); return 1;
+      }
+    }
+
+    if (config.layout == PrefixTreeLayout::kByteTrie) {
+      RunBenchmark<PrefixTreeLayout::kByteTrie>(config);
+    } else {
+      RunBenchmark<PrefixTreeLayout::kRadix>(config);
+    }
+    return 0;
+  }
+}
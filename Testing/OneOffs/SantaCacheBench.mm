@@ -0,0 +1,179 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+/*
+
+Compare SantaCache storage layouts using SantaVnode keys, mirroring the
+AuthResultCache access pattern.
+
+Run benchmarks with hyperfine:
+  BENCH=bazel-bin/Testing/OneOffs/santa_cache_bench
+  /opt/homebrew/bin/hyperfine --warmup 3 \
+      --parameter-list layout chained,open \
+      --parameter-list threads 1,4,8 \
+      "$BENCH -l {layout} -t {threads} -i 2000000"
+
+Options:
+  -l  Layout to test: "chained" or "open"
+  -t  Number of concurrent threads
+  -i  Operations per thread
+  -k  Number of distinct keys (default 8000, below the cache size)
+  -w  Percentage of operations that are writes (default 5)
+
+*/
+
+#import <Foundation/Foundation.h>
+
+#include <getopt.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "Source/common/SantaCache.h"
+#include "Source/common/SantaVnode.h"
+
+static const uint32_t kSeed = 0xBEEFCAFE;
+
+static std::atomic<uint64_t> gSink;
+
+struct Config {
+  SantaCacheLayout layout = SantaCacheLayout::kChained;
+  int threads = 1;
+  uint64_t iterations = 1000000;
+  uint64_t keys = 8000;
+  int writePercent = 5;
+};
+
+template <SantaCacheLayout Layout>
+static void RunBenchmark(const Config& config) {
+  auto cache =
+      std::make_unique<SantaCache<SantaVnode, uint64_t, absl::Hash<SantaVnode>, Layout>>(10000);
+
+  std::vector<SantaVnode> keys;
+  keys.reserve(config.keys);
+  for (uint64_t i = 0; i < config.keys; ++i) {
+    keys.push_back(SantaVnode{.fsid = (dev_t)(16777220 + (i % 3)), .fileid = 1000 + i * 7});
+    cache->set(keys.back(), i + 1);
+  }
+
+  dispatch_group_t group = dispatch_group_create();
+  auto* cachePtr = cache.get();
+  auto* keysPtr = &keys;
+
+  uint64_t start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  for (int t = 0; t < config.threads; ++t) {
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0), ^{
+      std::mt19937_64 gen(kSeed + t);
+      std::uniform_int_distribution<uint64_t> keyDist(0, keysPtr->size() - 1);
+      std::uniform_int_distribution<int> opDist(0, 99);
+      uint64_t sink = 0;
+      for (uint64_t i = 0; i < config.iterations; ++i) {
+        const SantaVnode& key = (*keysPtr)[keyDist(gen)];
+        if (opDist(gen) < config.writePercent) {
+          cachePtr->set(key, i + 1);
+        } else {
+          sink += cachePtr->get(key);
+        }
+      }
+      // Prevent the lookups from being optimized away
+      gSink.fetch_add(sink, std::memory_order_relaxed);
+    });
+  }
+  dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+  uint64_t elapsed = clock_gettime_nsec_np(CLOCK_MONOTONIC) - start;
+
+  uint64_t totalOps = config.iterations * config.threads;
+  std::cout << "layout=" << (Layout == SantaCacheLayout::kChained ? "chained" : "open")
+            << " threads=" << config.threads << " ops=" << totalOps
+            << " ns/op=" << (double)elapsed / totalOps
+            << " Mops/s=" << (double)totalOps * 1000.0 / elapsed << std::endl;
+}
+
+static void PrintUsage() {
+  std::cerr << "Usage: " << getprogname()
+            << " [-l chained|open] [-t threads] [-i iterations] [-k keys] [-w write_percent]"
+            << std::endl;
+}
+
+static bool ParseUInt(const char* arg, uint64_t* out) {
+  char* end;
+  long long val = strtoll(arg, &end, 10);
+  if (*end != '\0' || val <= 0) return false;
+  *out = (uint64_t)val;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  @autoreleasepool {
+    Config config;
+    int opt;
+    uint64_t val;
+
+    while ((opt = getopt(argc, argv, "l:t:i:k:w:h")) != -1) {
+      switch (opt) {
+        case 'l':
+          if (strcmp(optarg, "chained") == 0) {
+            config.layout = SantaCacheLayout::kChained;
+          } else if (strcmp(optarg, "open") == 0) {
+            config.layout = SantaCacheLayout::kOpenAddressed;
+          } else {
+            std::cerr << "Error: Invalid layout: " << optarg << std::endl;
+            PrintUsage();
+            return 1;
+          }
+          break;
+        case 't':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid thread count: " << optarg << std::endl;
+            return 1;
+          }
+          config.threads = (int)val;
+          break;
+        case 'i':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid iteration count: " << optarg << std::endl;
+            return 1;
+          }
+          config.iterations = val;
+          break;
+        case 'k':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid key count: " << optarg << std::endl;
+            return 1;
+          }
+          config.keys = val;
+          break;
+        case 'w':
+          config.writePercent = atoi(optarg);
+          if (config.writePercent < 0 || config.writePercent > 100) {
+            std::cerr << "Error: Invalid write percentage: " << optarg << std::endl;
+            return 1;
+          }
+          break;
+        case 'h': PrintUsage(); return 0;
+        default: PrintUsage(); return 1;
+      }
+    }
+
+    if (config.layout == SantaCacheLayout::kChained) {
+      RunBenchmark<SantaCacheLayout::kChained>(config);
+    } else {
+      RunBenchmark<SantaCacheLayout::kOpenAddressed>(config);
+    }
+    return 0;
+  }
+}
@@ -0,0 +1,177 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+
+/*
+
+Compare the SHA-256 backends available to the verifying hasher, both hashing
+whole files (the full-file digest) and hashing them one code page at a time
+(page-hash verification).
+
+Run against the verifying hasher test binaries:
+  BENCH=bazel-bin/Testing/OneOffs/sha256_backend_bench
+  $BENCH -r 50 Source/common/verifyinghasher/testdata/hw_*
+
+Or compare backends on a large binary with hyperfine:
+  /opt/homebrew/bin/hyperfine --warmup 3 \
+      --parameter-list backend commoncrypto,armv8 \
+      "$BENCH -b {backend} -p 16384 -r 20 /Applications/Xcode.app/Contents/MacOS/Xcode"
+
+Options:
+  -b  Backend to test: "commoncrypto", "armv8" or "all" (default all)
+  -p  Page size for the per-page pass (default 4096)
+  -r  Repetitions over each file (default 10)
+
+*/
+
+#import <Foundation/Foundation.h>
+
+#include <getopt.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Source/common/verifyinghasher/Sha256Backend.h"
+
+using santa::Sha256Backend;
+
+// Prevent the digests from being optimized away
+static volatile uint8_t gSink;
+
+struct Config {
+  std::vector<Sha256Backend> backends = {Sha256Backend::kCommonCrypto, Sha256Backend::kArmv8};
+  size_t pageSize = 4096;
+  int repetitions = 10;
+};
+
+static double MBPerSecond(uint64_t bytes, uint64_t nanos) {
+  return (double)bytes * 1000.0 / (double)nanos;
+}
+
+static void RunBenchmark(const Config& config, const char* path, NSData* contents) {
+  const uint8_t* bytes = (const uint8_t*)contents.bytes;
+  const size_t size = contents.length;
+  uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+
+  for (Sha256Backend backend : config.backends) {
+    if (!santa::SetActiveSha256Backend(backend)) {
+      std::cerr << "backend=" << santa::Sha256BackendName(backend) << " unavailable" << std::endl;
+      continue;
+    }
+
+    uint64_t start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    for (int r = 0; r < config.repetitions; r++) {
+      santa::Sha256Ctx ctx;
+      santa::Sha256Init(&ctx);
+      santa::Sha256Update(&ctx, bytes, size);
+      santa::Sha256Final(digest, &ctx);
+      gSink = digest[0];
+    }
+    uint64_t fullNanos = clock_gettime_nsec_np(CLOCK_MONOTONIC) - start;
+
+    start = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    for (int r = 0; r < config.repetitions; r++) {
+      for (size_t off = 0; off < size; off += config.pageSize) {
+        santa::Sha256Ctx ctx;
+        santa::Sha256Init(&ctx);
+        santa::Sha256Update(&ctx, bytes + off, std::min(config.pageSize, size - off));
+        santa::Sha256Final(digest, &ctx);
+        gSink = digest[0];
+      }
+    }
+    uint64_t pageNanos = clock_gettime_nsec_np(CLOCK_MONOTONIC) - start;
+
+    uint64_t totalBytes = (uint64_t)size * config.repetitions;
+    std::cout << "file=" << path << " backend=" << santa::Sha256BackendName(backend)
+              << " bytes=" << size << " full_MB/s=" << MBPerSecond(totalBytes, fullNanos)
+              << " page" << config.pageSize << "_MB/s=" << MBPerSecond(totalBytes, pageNanos)
+              << std::endl;
+  }
+}
+
+static void PrintUsage() {
+  std::cerr << "Usage: " << getprogname()
+            << " [-b commoncrypto|armv8|all] [-p page_size] [-r repetitions] file..." << std::endl;
+}
+
+static bool ParseUInt(const char* arg, uint64_t* out) {
+  char* end;
+  long long val = strtoll(arg, &end, 10);
+  if (*end != '\0' || val <= 0) return false;
+  *out = (uint64_t)val;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  @autoreleasepool {
+    Config config;
+    int opt;
+    uint64_t val;
+
+    while ((opt = getopt(argc, argv, "b:p:r:h")) != -1) {
+      switch (opt) {
+        case 'b':
+          if (strcmp(optarg, "commoncrypto") == 0) {
+            config.backends = {Sha256Backend::kCommonCrypto};
+          } else if (strcmp(optarg, "armv8") == 0) {
+            config.backends = {Sha256Backend::kArmv8};
+          } else if (strcmp(optarg, "all") != 0) {
+            std::cerr << "Error: Invalid backend: " << optarg << std::endl;
+            PrintUsage();
+            return 1;
+          }
+          break;
+        case 'p':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid page size: " << optarg << std::endl;
+            return 1;
+          }
+          config.pageSize = (size_t)val;
+          break;
+        case 'r':
+          if (!ParseUInt(optarg, &val)) {
+            std::cerr << "Error: Invalid repetition count: " << optarg << std::endl;
+            return 1;
+          }
+          config.repetitions = (int)val;
+          break;
+        case 'h': PrintUsage(); return 0;
+        default: PrintUsage(); return 1;
+      }
+    }
+
+    if (optind >= argc) {
+      PrintUsage();
+      return 1;
+    }
+
+    std::cout << "default_backend=" << santa::Sha256BackendName(santa::ActiveSha256Backend())
+              << std::endl;
+
+    for (int i = optind; i < argc; i++) {
+      NSData* contents = [NSData dataWithContentsOfFile:@(argv[i])
+                                                options:0
+                                                  error:nil];
+      if (!contents.length) {
+        std::cerr << "Error: Unable to read " << argv[i] << std::endl;
+        continue;
+      }
+      RunBenchmark(config, argv[i], contents);
+    }
+    return 0;
+  }
+}
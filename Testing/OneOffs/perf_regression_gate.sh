@@ -0,0 +1,81 @@
+#!/bin/bash
+# Copyright 2026 North Pole Security, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Run micro_bench and compare the results against the checked-in baseline,
+# failing if any benchmark regressed by more than the noise allows:
+#
+#   bazel test -c opt //Testing/OneOffs:perf_regression_gate --test_output=streamed
+#
+# Baselines are only comparable on the hardware they were recorded on. To
+# record a new one, run on the reference machine with --update:
+#
+#   bazel run -c opt //Testing/OneOffs:perf_regression_gate -- --update
+#
+# Any other arguments are passed to micro_bench, e.g.
+# --benchmark_filter=SantaCache.
+
+set -euo pipefail
+
+BENCH="${BENCH:-./bazel-bin/Source/santad/micro_bench}"
+COMPARE="${COMPARE:-./bazel-bin/Testing/OneOffs/bench_compare}"
+BASELINE="${BASELINE:-Testing/OneOffs/micro_bench_baseline.json}"
+REPETITIONS="${REPETITIONS:-5}"
+THRESHOLD_PERCENT="${THRESHOLD_PERCENT:-10}"
+NOISE_MULTIPLIER="${NOISE_MULTIPLIER:-3}"
+
+update=0
+args=()
+for arg in "$@"; do
+    if [ "$arg" = "--update" ]; then
+        update=1
+    else
+        args+=("$arg")
+    fi
+done
+
+for bin in "$BENCH" "$COMPARE"; do
+    if [ ! -x "$bin" ]; then
+        echo "binary not found: $bin" >&2
+        exit 2
+    fi
+done
+
+TMP="${TEST_TMPDIR:-${TMPDIR:-/tmp}}/perf-regression-gate.$$"
+mkdir -p "$TMP"
+trap 'rm -rf "$TMP"' EXIT
+
+"$BENCH" --benchmark_repetitions="$REPETITIONS" \
+    --benchmark_report_aggregates_only=true \
+    --benchmark_out="$TMP/current.json" \
+    --benchmark_out_format=json \
+    ${args[@]+"${args[@]}"} >/dev/null
+
+if [ "$update" -eq 1 ]; then
+    if [ -z "${BUILD_WORKSPACE_DIRECTORY:-}" ]; then
+        echo "--update must be used with bazel run" >&2
+        exit 2
+    fi
+    cp "$TMP/current.json" "$BUILD_WORKSPACE_DIRECTORY/Testing/OneOffs/micro_bench_baseline.json"
+    echo "Updated Testing/OneOffs/micro_bench_baseline.json"
+    exit 0
+fi
+
+# Keep the results so that they can be inspected or promoted to a baseline
+if [ -n "${TEST_UNDECLARED_OUTPUTS_DIR:-}" ]; then
+    cp "$TMP/current.json" "$TEST_UNDECLARED_OUTPUTS_DIR/micro_bench.json"
+fi
+
+"$COMPARE" -b "$BASELINE" -c "$TMP/current.json" \
+    -t "$THRESHOLD_PERCENT" -k "$NOISE_MULTIPLIER"
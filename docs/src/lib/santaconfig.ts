@@ -120,6 +120,280 @@ export const SantaConfigKeyGroups: SantaConfigGroups = {
       type: "bool",
       defaultValue: false,
     },
+    {
+      key: "EnableLockFreeAuthCacheReads",
+      description: `If true, lookups in the exec decision cache do not take locks, which reduces
+        contention on hosts with very high exec rates. Requires restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "AuthCacheMaxDenyTimeMs",
+      description: `If greater than 1500, executables that are denied repeatedly are cached for twice
+        as long on each consecutive deny, up to this many milliseconds. Caches are not flushed when
+        allow rules are added, so a newly allowed executable may remain blocked for up to this long.
+        Requires restarting the daemon to take effect.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableAuthCacheWarmStart",
+      description: `If true, allowed entries in the exec decision cache are saved to disk periodically
+        and when the daemon exits, then restored on the next start. Entries are only restored if the
+        execution rules, client mode and the file itself have not changed.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "AuthQueueShardCount",
+      description: `If greater than zero, AUTH events are processed on this many serial queues
+        instead of a single concurrent queue. Events for the same executable are handled in order,
+        and new events are steered away from queues that are stuck on a slow event. Requires
+        restarting the daemon to take effect. Values above 64 are clamped.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "NotifyQueueShardCount",
+      description: `If greater than zero, NOTIFY events are processed on this many serial queues
+        instead of a single concurrent queue. Events from the same instigating process are handled
+        in the order they were received. Requires restarting the daemon to take effect. Values
+        above 64 are clamped.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableDeadlineAwareAuthScheduling",
+      description: `If true, pending AUTH events are processed in order of their deadline, with
+        events that can be answered cheaply, such as exec decision cache hits, handled first. This
+        reduces the number of events that reach their deadline under heavy load. Ignored when
+        AuthQueueShardCount is set. Requires restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableMultiplexedESClient",
+      description: `If true, the authorizer, recorder and device manager share a single
+        EndpointSecurity client instead of each creating their own. Events they have in common
+        are only delivered once. Requires restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableInMemoryRuleIndex",
+      description: `If true, the daemon keeps a copy of all execution rules in memory and answers
+        rule lookups from it instead of querying the rules database. The copy is rebuilt in the
+        background whenever rules change. Memory use grows with the number of rules. Requires
+        restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableRuleSnapshot",
+      description: `If true, the daemon writes a compact snapshot of the execution rules next to the
+        rules database and answers rule lookups from it instead of querying the database. The
+        snapshot is memory-mapped, so it uses less memory than EnableInMemoryRuleIndex, which takes
+        precedence when both are set. Requires restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "RuleDatabaseReadConnections",
+      description: `If greater than zero, the rules database is switched to WAL mode and up to this
+        many read-only connections are used for rule lookups, so that lookups no longer wait behind
+        rule updates or other queries. Requires restarting the daemon to take effect. Values above
+        16 are clamped.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableIdentityOnlyExecDecisions",
+      description: `If true, executions of validly signed binaries are first checked against CDHash,
+        Signing ID and Team ID rules using only the identity reported by EndpointSecurity. When that
+        alone resolves to an allow rule that no Binary or Certificate rule could override, the
+        binary is allowed without being opened or hashed. Such executions are logged without the
+        file's SHA-256 unless it was already cached, and without certificate or entitlement
+        details. Requires EnableInMemoryRuleIndex and is ignored when EnableAllEventUpload is set.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableDeferredExecHashing",
+      description: `If true, executions allowed by EnableIdentityOnlyExecDecisions are still hashed,
+        but only after the execution has been allowed, on a low priority background queue. The
+        SHA-256 is included in the execution's telemetry once known.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableSpeculativeExecPrefetch",
+      description: `If true, executables are hashed and have their code signature read on a
+        background queue as soon as they are written and closed, so that their first execution
+        finds that work already done instead of doing it inside the authorization deadline. The
+        cached signing details are only used for an execution whose cdhash matches. Files over
+        256MB are skipped.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableSyslogBatching",
+      description: `If true and EventLogType is syslog, up to four event lines are combined into
+        each log message, so that logd sees a fraction of the message rate and is less likely to
+        throttle Santa. Lines are held for at most a second before being logged. Requires
+        restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EventLogSerializationWorkers",
+      description: `If greater than zero, telemetry events are serialized on this many background
+        queues instead of on the thread that received them. Events about the same process are
+        still written in order. If too many events are waiting to be serialized, new events are
+        dropped. Requires restarting the daemon to take effect. Values above 16 are clamped.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EventLogZstdDictionaryPath",
+      description: `Path to a zstd dictionary used to compress telemetry when EventLogType is
+        \`protobufstreamzstd\`. Train the dictionary offline from existing spool files with
+        \`zstd --train\`. The dictionary ID is recorded in each batch and \`santactl printlog\`
+        uses the dictionary at this path to decompress them. If the dictionary cannot be loaded,
+        batches are compressed without one. Requires restarting the daemon to take effect.`,
+      type: "string",
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableAdaptiveEventLogCompression",
+      description: `If true and EventLogType is \`protobufstreamzstd\`, the compression level of
+        each spool batch is chosen from the current conditions: cheaper compression while on
+        battery power and stronger compression when the spool is close to
+        SpoolDirectorySizeThresholdMB, so that fewer events are dropped. Has no effect when
+        EventLogZstdDictionaryPath is set. Requires restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableEventLogBatchIndex",
+      description: `If true and EventLogType is one of the \`protobufstream\` types, each spool
+        batch ends with an index of the offset, event type and event time of its records. Zstd
+        batches are also split into independently decompressible frames described by a zstd
+        seekable format seek table, so that tools can read a time range or event type without decompressing the
+        whole batch. Requires restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableEventLogFrameChecksums",
+      description: `If true and EventLogType is \`protobufstreamgzip\` or \`protobufstreamzstd\`,
+        records in spool batches are no longer individually hashed. Each batch instead relies on
+        the checksums of its compressed stream: the gzip CRC-32, or a content checksum in every
+        zstd frame. This saves the per-record hash and most of the per-record framing.
+        \`santactl printlog\` reads both formats, but older readers can't read these batches.
+        Requires restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableColumnarProcessDictionary",
+      description: `If true and EventLogType is \`protobufcolumnar\`, each process referenced by
+        the events of a spool batch is stored once in a per-batch process dictionary instead of
+        being repeated in every event. \`santactl printlog\` expands the processes back into
+        their events, but older readers can't read these batches. Requires restarting the daemon
+        to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableStreamingTelemetryExport",
+      description: `If true and EnableTelemetryExport is also true, spool batches are exported
+        as soon as they are finalized instead of waiting for the next TelemetryExportIntervalSec.
+        The periodic export still runs to retry batches that failed to export. Requires
+        restarting the daemon to take effect.`,
+      type: "bool",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "ProcessTreeSnapshotIntervalSec",
+      description: `If greater than 0 and EventLogType is one of the \`protobuf\` types, a
+        snapshot of the process tree is logged this often. Each snapshot lists the pid,
+        pidversion, parent, cdhash and annotations of processes that changed since the previous
+        snapshot, and every 12th snapshot lists the whole tree. Values below 60 are raised to 60.
+        Requires restarting the daemon to take effect.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "SelfProfilingIntervalMs",
+      description: `How often, in milliseconds, the daemon samples its own threads to attribute
+        the CPU time it uses to subsystems such as auth, notify and the spool writer. The
+        breakdown is shown by \`santactl status --verbose\` and exported in metrics. Set to 0 to
+        disable. Values below 100 are raised to 100. Requires restarting the daemon to take
+        effect.`,
+      type: "integer",
+      defaultValue: 1000,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "MetricSnapshotIntervalSec",
+      description: `If greater than 0, the daemon publishes its metrics to a read-only shared
+        memory region this often. \`santactl metrics\` reads the latest snapshot from the region
+        instead of asking the daemon over XPC, so values may be up to this many seconds old.
+        Requires restarting the daemon to take effect.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "TelemetryExecArgsMaxBytes",
+      description: `If greater than 0, the total number of bytes of exec arguments logged for
+        each execution. Arguments past the limit are dropped, the argument that crosses it is cut
+        short, and the event is marked with \`args_truncated\`. CEL rules still see every
+        argument. Requires restarting the daemon to take effect.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "TelemetryExecEnvsMaxBytes",
+      description: `Like \`TelemetryExecArgsMaxBytes\`, but for the environment variables logged
+        for each execution. Truncated events are marked with \`envs_truncated\`. Requires
+        restarting the daemon to take effect.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
+    {
+      key: "EnableMemoryPressureCacheShrinking",
+      description: `If true, the daemon shrinks its caches when the system reports memory
+        pressure. On a warning, compiled CEL programs, pooled event log buffers and cached user
+        and group names are dropped. On critical pressure, cached non-root auth results and
+        execution decisions are dropped too. Requires restarting the daemon to take effect.`,
+      type: "boolean",
+      defaultValue: false,
+      versionAdded: "2026.6",
+    },
     {
       key: "AntiSuspendSigningIDs",
       description: "A list of Signing IDs to protect from `pid_suspend` calls.",
@@ -363,6 +637,46 @@ The following sequences will be replaced in the final URL:
       type: "string",
       repeated: true,
     },
+    {
+      key: "FileChangesTelemetryFilters",
+      description: `Array of filters for file change events that should be dropped before they are
+        enriched and logged. An event is dropped if it matches every list given in any filter.
+        The number of events dropped by each filter is reported in metrics. Requires restarting
+        the daemon to take effect.`,
+      type: "dict",
+      repeated: true,
+      subFields: [
+        {
+          key: "Name",
+          description: "Name of the filter, used when reporting metrics",
+          type: "string",
+        },
+        {
+          key: "PathPrefixes",
+          description: "Path prefixes matched against the target path of the event",
+          type: "string",
+          repeated: true,
+        },
+        {
+          key: "SigningIDs",
+          description: `Signing IDs matched against the process that caused the event, in
+            \`TEAMID:signing_id\` or \`platform:signing_id\` form`,
+          type: "string",
+          repeated: true,
+        },
+      ],
+      versionAdded: "2026.6",
+    },
+    {
+      key: "FileChangesDeduplicationWindowMs",
+      description: `If greater than zero, repeated writes to the same file by the same process are
+        only logged once per this many milliseconds. The number of events that were not logged is
+        reported in metrics. Requires restarting the daemon to take effect. Values above 60000 are
+        clamped.`,
+      type: "integer",
+      defaultValue: 0,
+      versionAdded: "2026.6",
+    },
     {
       key: "Telemetry",
       description: `Array of strings for events that should be logged`,
@@ -425,6 +739,11 @@ changes in the release notes of any future release that changes them.`,
           description:
             "(BETA) Sent to file on disk using a maildir-like format",
         },
+        {
+          value: "protobufcolumnar",
+          description:
+            "(BETA) Same as protobuf but each batch stores records by column for analytics tools",
+        },
         {
           value: "json",
           description:
@@ -443,6 +762,15 @@ changes in the release notes of any future release that changes them.`,
       enableIf: (data) =>
         data.EventLogType == "file" || data.EventLogType == "json",
     },
+    {
+      key: "EventTracePath",
+      description: `If set, exec, fork, exit, open, close and rename messages received from
+        EndpointSecurity are recorded to this path so that the workload can be replayed by the
+        \`es_replay_bench\` tool. Intended for short profiling sessions: the trace is not rotated and
+        contains unredacted paths and arguments. Requires restarting the daemon to take effect.`,
+      type: "string",
+      versionAdded: "2026.6",
+    },
     {
       key: "SpoolDirectory",
       description: `If \`EventLogType\` is set to \`protobuf\`, SpoolDirectory will provide the base directory used to
@@ -733,7 +1061,8 @@ changes in the release notes of any future release that changes them.`,
     {
       key: "FileAccessPolicyUpdateIntervalSec",
       description: `Number of seconds between re-reading the file access policy config and policies/monitored paths
-        updated. The minimum value is 15 seconds.`,
+        updated. The minimum value is 15 seconds. Path globs are re-expanded as the directories they match
+        change, and only fully re-expanded every few hours.`,
       type: "integer",
       defaultValue: 600,
     },
@@ -761,16 +1090,18 @@ changes in the release notes of any future release that changes them.`,
     {
       key: "FileAccessGlobalLogsPerSec",
       description: `Sets the average logs per second that will be emitted by File Access
-        Authorization rule violations. Setting to 0 will disable log rate limiting. Rate
-        limiting only applies to logging. FAA rules that are not audit only will still
-        block operations that violate the rule.`,
+        Authorization rule violations. Setting to 0 will disable log rate limiting. Each
+        rule and event type is additionally limited to a quarter of this budget so that a
+        single noisy rule cannot use all of it. Rate limiting only applies to logging. FAA
+        rules that are not audit only will still block operations that violate the rule.`,
       type: "integer",
       defaultValue: 60,
     },
     {
       key: "FileAccessGlobalWindowSizeSec",
       description: `Sets the window size over which the FileAccessGlobalLogsPerSec setting
-        is applied in order to allow for burts of logs. Setting to 0 will disable log rate
+        is applied in order to allow for burts of logs. The budget refills continuously
+        rather than resetting at the end of each window. Setting to 0 will disable log rate
         limiting. Rate limiting only applies to logging. FAA rules that are not audit only
         will still block operations that violate the rule.`,
       type: "integer",
@@ -899,11 +1230,18 @@ mount flags that are a superset of \`RemovableMediaRemountFlags\` or \`Encrypted
           description:
             "A format consumable by Google's internal Monarch tooling.",
         },
+        {
+          value: "openmetrics",
+          description:
+            "OpenMetrics text, as consumed by Prometheus. With a unix:// MetricURL, metrics are served to scrapers on that socket instead of being pushed.",
+        },
       ],
     },
     {
       key: "MetricURL",
-      description: "URL describing where monitoring metrics should be exported",
+      description: `URL describing where monitoring metrics should be exported.
+        With the openmetrics format this can be a unix:// URL, e.g. unix:///var/run/santa-metrics.sock, for a socket
+        that scrapers connect to. The socket is only accessible to root and the metric service user.`,
       type: "string",
       enableIf: (data) => data.MetricFormat !== "",
     },
@@ -930,6 +1268,14 @@ mount flags that are a superset of \`RemovableMediaRemountFlags\` or \`Encrypted
         Alternatively if a value is set for an existing key then the new value will override the old.`,
       enableIf: (data) => data.MetricFormat !== "",
     },
+    {
+      key: "MetricExportDeltas",
+      description: `If true, metrics exported over HTTP only include values that changed since the previous export.
+        Metrics that haven't changed are not sent again until they do, so collectors must carry the last value forward.`,
+      type: "bool",
+      defaultValue: false,
+      enableIf: (data) => data.MetricFormat !== "",
+    },
   ],
   rules: [
     {
@@ -1027,6 +1373,14 @@ thousand static rules working correctly, but we don't recommend using StaticRule
       type: "bool",
       defaultValue: false,
     },
+    {
+      key: "SyncEnableConcurrentStages",
+      description: `If true, event upload and rule download run at the same time after preflight
+        instead of one after the other. Only enable this if the sync server doesn't create rules
+        in response to events uploaded during the same sync.`,
+      type: "bool",
+      defaultValue: false,
+    },
     {
       key: "SyncProxyConfiguration",
       description: `The proxy configuration to use when syncing.
@@ -1141,9 +1495,12 @@ thousand static rules working correctly, but we don't recommend using StaticRule
     },
     {
       key: "SyncClientContentEncoding",
-      description: `Sets the Content-Encoding header for requests sent to the sync service`,
+      description: `Sets the Content-Encoding header for requests sent to the sync service. zstd
+        is only used after the sync service includes zstd in an Accept-Encoding response header,
+        until then deflate is used. zstd also allows the sync service to compress responses.`,
       type: "string",
       possibleValues: [
+        { value: "zstd" },
         { value: "deflate" },
         { value: "gzip" },
         { value: "none" },